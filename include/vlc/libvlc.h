@@ -323,6 +323,72 @@ LIBVLC_API void libvlc_event_detach( libvlc_event_manager_t *p_event_manager,
                                          libvlc_callback_t f_callback,
                                          void *p_user_data );
 
+/**
+ * Batched callback function notification
+ * \param p_events the events received during the interval, oldest first
+ * \param i_events number of events (never 0)
+ * \param p_user_data user provided data
+ */
+typedef void ( *libvlc_batch_callback_t )( const struct libvlc_event_t *p_events,
+                                           unsigned i_events,
+                                           void *p_user_data );
+
+/**
+ * Flags of libvlc_event_attach_batch()
+ */
+enum libvlc_event_batch_flags_t
+{
+    /** Keep only the last event of each type received during an interval:
+     * suited for time, position or buffering events, not for state
+     * changes that must all be seen */
+    libvlc_event_coalesce = 0x1,
+};
+
+/**
+ * Register for batched event notifications.
+ *
+ * Instead of calling the callback for each event, the events are queued,
+ * and delivered all at once from a separate thread, at most once per
+ * interval. The emitting object is not blocked by the callback.
+ *
+ * \note As with other asynchronous notifications, the pointers carried by
+ * the events (medias, strings...) may be invalid by the time the callback
+ * runs: this is meant for events with scalar values.
+ * \warning The callback must not detach its own listener.
+ *
+ * \param p_event_manager the event manager to which you want to attach to
+ * \param p_event_types the events to listen to
+ * \param i_event_types number of events in p_event_types
+ * \param f_callback the function to call with the queued events
+ * \param p_user_data user provided data to carry with the events
+ * \param i_interval delivery interval (in ms), e.g. a video frame duration
+ * \param i_flags zero or more of @ref libvlc_event_batch_flags_t
+ * \return 0 on success, ENOMEM on error
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API int libvlc_event_attach_batch( libvlc_event_manager_t *p_event_manager,
+                                          const libvlc_event_type_t *p_event_types,
+                                          unsigned i_event_types,
+                                          libvlc_batch_callback_t f_callback,
+                                          void *p_user_data,
+                                          libvlc_time_t i_interval,
+                                          unsigned i_flags );
+
+/**
+ * Unregister batched event notifications.
+ *
+ * Pending events are discarded: the callback is not called anymore once this
+ * function returns.
+ *
+ * \param p_event_manager the event manager
+ * \param f_callback the callback given to libvlc_event_attach_batch()
+ * \param p_user_data the user data given to libvlc_event_attach_batch()
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API void libvlc_event_detach_batch( libvlc_event_manager_t *p_event_manager,
+                                           libvlc_batch_callback_t f_callback,
+                                           void *p_user_data );
+
 /**
  * Get an event's type name.
  *
@@ -0,0 +1,112 @@
+/*****************************************************************************
+ * libvlc_compositor.h:  libvlc external API
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/**
+ * \file
+ * This file defines libvlc_compositor external API
+ */
+
+#ifndef VLC_LIBVLC_COMPOSITOR_H
+#define VLC_LIBVLC_COMPOSITOR_H 1
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/** \defgroup libvlc_compositor LibVLC compositor
+ * \ingroup libvlc
+ * LibVLC compositor shows many medias (tiles) in a single video output.
+ *
+ * Each tile is a media player without video or audio output of its own: its
+ * video is decoded in its input and handed over to the mosaic of the display
+ * player, which is the only one with a window, a video output and an audio
+ * output. A tile thus costs an input and a decoder, instead of a full player.
+ *
+ * The tiles are laid out in a grid, in the order they start playing.
+ * @{
+ */
+
+typedef struct libvlc_compositor_t libvlc_compositor_t;
+
+/**
+ * Create a compositor.
+ *
+ * \note There can be only one compositor per LibVLC instance.
+ *
+ * \param p_instance libvlc instance
+ * \param i_width width of the tiled area (in pixels)
+ * \param i_height height of the tiled area (in pixels)
+ * \return compositor object or NULL on error
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API libvlc_compositor_t *
+libvlc_compositor_new( libvlc_instance_t *p_instance,
+                       unsigned i_width, unsigned i_height );
+
+/**
+ * Release a compositor.
+ *
+ * The tiles and the display player obtained from it remain valid until they
+ * are released.
+ *
+ * \param p_compositor compositor object
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API void
+libvlc_compositor_release( libvlc_compositor_t *p_compositor );
+
+/**
+ * Get the display player of a compositor.
+ *
+ * This is the player to give a window to (e.g. with
+ * libvlc_media_player_set_xwindow()), and to play the background media on:
+ * the tiles are drawn over its video. The background is typically a picture
+ * or a video of the size of the tiled area.
+ *
+ * \param p_compositor compositor object
+ * \return the display player (to be released with
+ * libvlc_media_player_release())
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API libvlc_media_player_t *
+libvlc_compositor_get_display( libvlc_compositor_t *p_compositor );
+
+/**
+ * Create a tile of a compositor.
+ *
+ * The tile is a media player, controlled like any other, except it has no
+ * video or audio output: its audio and subtitle tracks are not decoded, and
+ * its video is drawn in the display player.
+ *
+ * \param p_compositor compositor object
+ * \return a media player (to be released with libvlc_media_player_release())
+ * or NULL on error
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API libvlc_media_player_t *
+libvlc_compositor_new_tile( libvlc_compositor_t *p_compositor );
+
+/** @} */
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif /* VLC_LIBVLC_COMPOSITOR_H */
@@ -149,6 +149,49 @@ typedef struct libvlc_media_stats_t
     int         i_sent_bytes;
     float       f_send_bitrate;
 } libvlc_media_stats_t;
+
+/**
+ * Stages of the playback pipeline with a latency histogram
+ */
+typedef enum libvlc_media_latency_stage_t
+{
+    libvlc_latency_demux = 0,    /**< duration of one demux call */
+    libvlc_latency_video_queue,  /**< time spent in the video decoder queue */
+    libvlc_latency_video_decode, /**< time spent decoding one video block */
+    libvlc_latency_video_output, /**< time until a picture is displayed */
+    libvlc_latency_audio_queue,  /**< time spent in the audio decoder queue */
+    libvlc_latency_audio_decode, /**< time spent decoding one audio block */
+    libvlc_latency_audio_output, /**< time until an audio buffer is played */
+} libvlc_media_latency_stage_t;
+
+#define LIBVLC_LATENCY_STAGES 7
+#define LIBVLC_LATENCY_BUCKETS 16
+
+/**
+ * Latency histogram of a pipeline stage, in microseconds.
+ *
+ * Bucket 0 counts the samples below 64 microseconds, bucket n those below
+ * twice the bound of bucket n-1, and the last bucket all the longer ones.
+ */
+typedef struct libvlc_media_latency_t
+{
+    uint64_t    i_count;
+    int64_t     i_total;
+    int64_t     i_max;
+    uint64_t    pi_buckets[LIBVLC_LATENCY_BUCKETS];
+} libvlc_media_latency_t;
+
+typedef struct libvlc_media_pipeline_stats_t
+{
+    /* Indexed by libvlc_media_latency_stage_t */
+    libvlc_media_latency_t latency[LIBVLC_LATENCY_STAGES];
+
+    /* Depths of the decoder queues, as last sampled */
+    int64_t     i_video_queue_blocks;
+    int64_t     i_video_queue_bytes;
+    int64_t     i_audio_queue_blocks;
+    int64_t     i_audio_queue_bytes;
+} libvlc_media_pipeline_stats_t;
 /** @}*/
 
 typedef struct libvlc_media_track_info_t
@@ -472,6 +515,24 @@ LIBVLC_API libvlc_state_t libvlc_media_get_state(
 LIBVLC_API int libvlc_media_get_stats( libvlc_media_t *p_md,
                                            libvlc_media_stats_t *p_stats );
 
+/**
+ * Get the latency histograms and queue depths of the playback pipeline.
+ *
+ * The histograms accumulate since the media started playing: a monitoring
+ * application polls them and computes the differences between two polls.
+ *
+ * \param p_md media descriptor object
+ * \param p_stats structure filled with the statistics
+ *                (this structure must be allocated by the caller)
+ * \return true if the statistics are available, false otherwise
+ * \version LibVLC 3.0.0 or later
+ *
+ * \libvlc_return_bool
+ */
+LIBVLC_API int
+libvlc_media_get_pipeline_stats( libvlc_media_t *p_md,
+                                 libvlc_media_pipeline_stats_t *p_stats );
+
 /* The following method uses libvlc_media_list_t, however, media_list usage is optionnal
  * and this is here for convenience */
 #define VLC_FORWARD_DECLARE_OBJECT(a) struct a
@@ -226,6 +226,35 @@ LIBVLC_API int libvlc_media_player_is_playing ( libvlc_media_player_t *p_mi );
  */
 LIBVLC_API int libvlc_media_player_play ( libvlc_media_player_t *p_mi );
 
+/**
+ * Open a media in standby, to switch to it instantly.
+ *
+ * The media is opened and read in the background, without being decoded,
+ * and the last few seconds of it are buffered (see the
+ * "input-standby-window" option). Once the media is set on the player,
+ * libvlc_media_player_play() plays it from the buffered data instead of
+ * opening it, which makes a channel change on live streams immediate.
+ * Files are only kept opened.
+ *
+ * At most four media are kept in standby: the oldest one is closed first.
+ * Stream output is not supported.
+ *
+ * \param p_mi the Media Player
+ * \param p_md the Media to open in standby
+ * eturn 0 on success, -1 on error
+ * ersion LibVLC 3.0.0 or later
+ */
+LIBVLC_API int libvlc_media_player_add_standby( libvlc_media_player_t *p_mi,
+                                                libvlc_media_t *p_md );
+
+/**
+ * Close all the media in standby.
+ *
+ * \param p_mi the Media Player
+ * ersion LibVLC 3.0.0 or later
+ */
+LIBVLC_API void libvlc_media_player_clear_standby( libvlc_media_player_t *p_mi );
+
 /**
  * Pause or resume (no effect if there is no media)
  *
@@ -392,6 +421,99 @@ void libvlc_video_set_format_callbacks( libvlc_media_player_t *mp,
                                         libvlc_video_format_cb setup,
                                         libvlc_video_cleanup_cb cleanup );
 
+/**
+ * Video frame shown by @ref libvlc_video_present_cb, until released with
+ * libvlc_video_frame_release().
+ */
+typedef struct libvlc_video_frame_t libvlc_video_frame_t;
+
+/**
+ * Callback prototype to allocate a picture buffer.
+ *
+ * The buffer is allocated once, when the video output starts, and is used
+ * for many frames until it is freed by @ref libvlc_video_free_cb.
+ *
+ * \param opaque private pointer as passed to
+ *               libvlc_video_set_async_callbacks() [IN]
+ * \param planes start address of the pixel planes (LibVLC allocates the array
+ *             of void pointers, this callback must initialize the array) [OUT]
+ * 
+eturn a private pointer identifying the buffer
+ */
+typedef void *(*libvlc_video_alloc_cb)(void *opaque, void **planes);
+
+/**
+ * Callback prototype to free a picture buffer.
+ *
+ * 
+ote This may be invoked after the video output has stopped, from the
+ * thread releasing the last frame of the buffer.
+ *
+ * \param opaque private pointer as passed to
+ *               libvlc_video_set_async_callbacks() [IN]
+ * \param picture private pointer returned by @ref libvlc_video_alloc_cb [IN]
+ */
+typedef void (*libvlc_video_free_cb)(void *opaque, void *picture);
+
+/**
+ * Callback prototype to present a picture.
+ *
+ * When the video frame needs to be shown, as determined by the media playback
+ * clock, the present callback is invoked. The application owns the frame
+ * until it calls libvlc_video_frame_release(), which it can do from any
+ * thread, at any later time: LibVLC decodes the next frames in the other
+ * buffers in the meantime.
+ *
+ * \param opaque private pointer as passed to
+ *               libvlc_video_set_async_callbacks() [IN]
+ * \param picture private pointer returned by @ref libvlc_video_alloc_cb [IN]
+ * \param planes pixel planes as defined by the @ref libvlc_video_alloc_cb
+ *               callback (this parameter is only for convenience) [IN]
+ * \param frame frame to release [IN]
+ */
+typedef void (*libvlc_video_present_cb)(void *opaque, void *picture,
+                                        void *const *planes,
+                                        libvlc_video_frame_t *frame);
+
+/**
+ * Set callbacks and private data to render decoded video to a pool of
+ * buffers in memory, which the application holds asynchronously.
+ *
+ * This is an alternative to libvlc_video_set_callbacks(). The number of
+ * buffers is returned by the libvlc_video_set_format_callbacks() setup
+ * callback: when the application holds all of them, the decoding waits.
+ *
+ * With direct rendering, the decoder writes directly into the buffers, and
+ * allocates as many as it needs for its reference frames (at least as many
+ * as requested by the setup callback), instead of the video output copying
+ * each frame into a buffer. Frames may then be presented out of the order
+ * in which their buffers were allocated, and their content must be
+ * considered read-only.
+ *
+ * \param mp the media player
+ * \param alloc callback to allocate a buffer (must not be NULL)
+ * \param free callback to free a buffer (or NULL if not needed)
+ * \param present callback to present a frame (must not be NULL)
+ * \param direct whether the decoder renders directly in the buffers
+ * \param opaque private pointer for the three callbacks (as first parameter)
+ * ersion LibVLC 3.0.0 or later
+ */
+LIBVLC_API
+void libvlc_video_set_async_callbacks( libvlc_media_player_t *mp,
+                                       libvlc_video_alloc_cb alloc,
+                                       libvlc_video_free_cb free,
+                                       libvlc_video_present_cb present,
+                                       bool direct, void *opaque );
+
+/**
+ * Release a frame given by @ref libvlc_video_present_cb.
+ *
+ * \param frame the frame to release
+ * ersion LibVLC 3.0.0 or later
+ */
+LIBVLC_API
+void libvlc_video_frame_release( libvlc_video_frame_t *frame );
+
 /**
  * Set the NSView handler where the media player should render its video output.
  *
@@ -0,0 +1,164 @@
+/*****************************************************************************
+ * libvlc_shm.h:  libvlc external API
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/**
+ * \file
+ * This file defines libvlc_shm_reader external API
+ */
+
+#ifndef VLC_LIBVLC_SHM_H
+#define VLC_LIBVLC_SHM_H 1
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/** \defgroup libvlc_shm LibVLC shared memory reader
+ * \ingroup libvlc
+ * LibVLC shared memory reader gets the frames published by the "shm" stream
+ * output of another process on the same host, e.g. with
+ * --sout="#transcode{vcodec=I420,acodec=s16l}:shm{file=/dev/shm/vlc}".
+ *
+ * The frames are decoded pictures and audio samples (or whatever the stream
+ * output is given), each with its timestamps and format. The reader needs no
+ * LibVLC instance. It polls the shared memory on its own, and does not slow
+ * down the publisher in any way: a reader that does not keep up loses the
+ * oldest frames, and any number of readers can attach and detach at any
+ * time.
+ * @{
+ */
+
+typedef struct libvlc_shm_reader_t libvlc_shm_reader_t;
+
+/**
+ * Description of a shared frame.
+ */
+typedef struct libvlc_shm_frame_t
+{
+    unsigned i_id; /**< Elementary stream of the frame */
+    libvlc_track_type_t i_type; /**< libvlc_track_video or libvlc_track_audio */
+    uint32_t i_codec; /**< Fourcc of the data, e.g. "I420" or "s16l" */
+    int64_t i_pts; /**< Presentation date in microseconds, 0 if unknown */
+    int64_t i_duration; /**< In microseconds */
+    union
+    {
+        struct
+        {
+            unsigned i_width;
+            unsigned i_height;
+            unsigned i_visible_width;
+            unsigned i_visible_height;
+            unsigned i_frame_rate;
+            unsigned i_frame_rate_base;
+        } video;
+        struct
+        {
+            unsigned i_rate;
+            unsigned i_channels;
+            unsigned i_bits_per_sample;
+        } audio;
+    } u;
+    size_t i_size; /**< Bytes of data */
+    uint64_t i_lost; /**< Frames lost by this reader so far */
+} libvlc_shm_frame_t;
+
+/**
+ * Attach to a shared memory ring.
+ *
+ * The first frame read is the latest one published.
+ *
+ * \param psz_path path of the shared memory file of the stream output
+ * \return reader object or NULL on error
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API libvlc_shm_reader_t *
+libvlc_shm_reader_open( const char *psz_path );
+
+/**
+ * Detach from a shared memory ring.
+ *
+ * \param p_reader reader object
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API void
+libvlc_shm_reader_close( libvlc_shm_reader_t *p_reader );
+
+/**
+ * Read the next frame, without waiting.
+ *
+ * \param p_reader reader object
+ * \param p_frame description of the frame [OUT]
+ * \param p_buf buffer the data of the frame is copied to
+ * \param i_buf size of the buffer: if the frame does not fit, it is left
+ * for the next call and only its description is returned
+ * \return 1 if a frame was read, 0 if there is no new frame (yet), -1 if the
+ * buffer is too small, -2 if the publisher is gone and there will be no more
+ * frames (reopen the ring to attach to a new publisher)
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API int
+libvlc_shm_reader_read( libvlc_shm_reader_t *p_reader,
+                        libvlc_shm_frame_t *p_frame,
+                        void *p_buf, size_t i_buf );
+
+/**
+ * Get the next frame in place, without copy and without waiting.
+ *
+ * The data may be overwritten by the publisher at any time: it is only
+ * known to be whole once libvlc_shm_reader_release() confirms it.
+ *
+ * \param p_reader reader object
+ * \param p_frame description of the frame [OUT]
+ * \return the data of the frame, or NULL if there is no new frame (see
+ * libvlc_shm_reader_is_live())
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API const void *
+libvlc_shm_reader_peek( libvlc_shm_reader_t *p_reader,
+                        libvlc_shm_frame_t *p_frame );
+
+/**
+ * Release the frame obtained by libvlc_shm_reader_peek().
+ *
+ * \param p_reader reader object
+ * \return 1 if the frame was left intact until now, 0 if the publisher
+ * overwrote it meanwhile (then it is counted as lost)
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API int
+libvlc_shm_reader_release( libvlc_shm_reader_t *p_reader );
+
+/**
+ * Whether the publisher is still running.
+ *
+ * \param p_reader reader object
+ * \return 0 once the stream output is closed, 1 before
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API int
+libvlc_shm_reader_is_live( libvlc_shm_reader_t *p_reader );
+
+/** @} */
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif /* VLC_LIBVLC_SHM_H */
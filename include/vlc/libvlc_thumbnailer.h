@@ -0,0 +1,116 @@
+/*****************************************************************************
+ * libvlc_thumbnailer.h:  libvlc external API
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/**
+ * \file
+ * This file defines libvlc_thumbnailer external API
+ */
+
+#ifndef VLC_LIBVLC_THUMBNAILER_H
+#define VLC_LIBVLC_THUMBNAILER_H 1
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/** \defgroup libvlc_thumbnailer LibVLC thumbnailer
+ * \ingroup libvlc
+ * LibVLC thumbnailer extracts still pictures from medias, without playing
+ * them: there is no media player, no video or audio output and no clock.
+ * The demuxer seeks to the key frame nearest to the requested time, and the
+ * first picture decoded from there is scaled and saved.
+ * @{
+ */
+
+typedef struct libvlc_thumbnailer_t libvlc_thumbnailer_t;
+
+/**
+ * Create a thumbnailer.
+ *
+ * The thumbnailer keeps its video decoder from one thumbnail to the next,
+ * as long as the medias have the same video format: use the same thumbnailer
+ * for a batch of medias to save the decoder initializations.
+ *
+ * \param p_instance libvlc instance
+ * \return thumbnailer object or NULL on error
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API libvlc_thumbnailer_t *
+libvlc_thumbnailer_new( libvlc_instance_t *p_instance );
+
+/**
+ * Release a thumbnailer.
+ *
+ * \param p_thumbnailer thumbnailer object
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API void
+libvlc_thumbnailer_release( libvlc_thumbnailer_t *p_thumbnailer );
+
+/**
+ * Save a thumbnail of a media, taken at a given time.
+ *
+ * This function blocks until the thumbnail is saved, the request fails or
+ * the timeout expires. Requests on the same thumbnailer are serialized.
+ *
+ * If i_width AND i_height is 0, original size is used.
+ * If i_width XOR i_height is 0, original aspect-ratio is preserved.
+ * The image format is inferred from the file extension (e.g. .png, .jpg).
+ *
+ * \param p_thumbnailer thumbnailer object
+ * \param p_md media to take the thumbnail of
+ * \param i_time time of the thumbnail (in ms)
+ * \param i_width the thumbnail's width
+ * \param i_height the thumbnail's height
+ * \param i_timeout maximum time to spend (in ms), or 0 for no limit
+ * \param psz_filepath the path where to save the thumbnail to
+ * \return 0 on success, -1 on error
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API int
+libvlc_thumbnailer_take( libvlc_thumbnailer_t *p_thumbnailer,
+                         libvlc_media_t *p_md, libvlc_time_t i_time,
+                         unsigned i_width, unsigned i_height,
+                         libvlc_time_t i_timeout, const char *psz_filepath );
+
+/**
+ * Save a thumbnail of a media, taken at a given position.
+ *
+ * This is libvlc_thumbnailer_take(), with a position instead of a time, for
+ * when the length of the media is not known.
+ *
+ * \param f_pos position of the thumbnail (0.0 - 1.0)
+ * \see libvlc_thumbnailer_take
+ * \version LibVLC 3.0.0 or later
+ */
+LIBVLC_API int
+libvlc_thumbnailer_take_at_position( libvlc_thumbnailer_t *p_thumbnailer,
+                                     libvlc_media_t *p_md, float f_pos,
+                                     unsigned i_width, unsigned i_height,
+                                     libvlc_time_t i_timeout,
+                                     const char *psz_filepath );
+
+/** @} */
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif /* VLC_LIBVLC_THUMBNAILER_H */
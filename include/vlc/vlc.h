@@ -45,6 +45,9 @@ extern "C" {
 #include <vlc/libvlc_media_list_player.h>
 #include <vlc/libvlc_media_library.h>
 #include <vlc/libvlc_media_discoverer.h>
+#include <vlc/libvlc_compositor.h>
+#include <vlc/libvlc_shm.h>
+#include <vlc/libvlc_thumbnailer.h>
 #include <vlc/libvlc_events.h>
 #include <vlc/libvlc_vlm.h>
 #include <vlc/deprecated.h>
@@ -56,6 +56,7 @@ enum access_query_e
     ACCESS_GET_CONTENT_TYPE,/* arg1=char **ppsz_content_type res=can fail */
 
     ACCESS_GET_SIGNAL,      /* arg1=double *pf_quality, arg2=double *pf_strength   res=can fail */
+    ACCESS_GET_STATS,       /* arg1=access_stats_t * res=can fail */
 
     /* */
     ACCESS_SET_PAUSE_STATE = 0x200, /* arg1= bool           can fail */
@@ -71,6 +72,17 @@ enum access_query_e
     ACCESS_GET_PRIVATE_ID_STATE,          /* arg1=int i_private_data arg2=bool *          res=can fail */
 };
 
+/**
+ * Transfer counters of a network access (ACCESS_GET_STATS).
+ * The throughput is i_bytes * CLOCK_FREQ / i_wait.
+ */
+typedef struct
+{
+    uint64_t i_bytes;    /**< bytes received */
+    uint64_t i_requests; /**< reads from the server */
+    mtime_t  i_wait;     /**< time spent waiting for the server */
+} access_stats_t;
+
 struct access_t
 {
     VLC_COMMON_MEMBERS
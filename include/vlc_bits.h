@@ -36,6 +36,9 @@ typedef struct bs_s
     uint8_t *p_end;
 
     ssize_t  i_left;    /* i_count number of available bits */
+
+    bool     b_rbsp;    /* skip the H.264/HEVC emulation prevention bytes */
+    unsigned i_zeros;   /* number of zero bytes just before p */
 } bs_t;
 
 static inline void bs_init( bs_t *s, const void *p_data, size_t i_data )
@@ -44,6 +47,38 @@ static inline void bs_init( bs_t *s, const void *p_data, size_t i_data )
     s->p       = s->p_start;
     s->p_end   = s->p_start + i_data;
     s->i_left  = 8;
+    s->b_rbsp  = false;
+    s->i_zeros = 0;
+}
+
+/**
+ * Initializes a reader of the RBSP of an H.264 or HEVC NAL unit payload:
+ * the emulation prevention bytes (the 0x03 of 0x00 0x00 0x03) are skipped
+ * as they are read, so the NAL does not have to be decoded to a copy first.
+ * Only reading is supported, and bs_pos() counts the skipped bytes.
+ */
+static inline void bs_init_rbsp( bs_t *s, const void *p_data, size_t i_data )
+{
+    bs_init( s, p_data, i_data );
+    s->b_rbsp = true;
+}
+
+/* Moves to the next byte */
+static inline void bs_forward( bs_t *s )
+{
+    if( !s->b_rbsp || s->p >= s->p_end )
+    {
+        s->p++;
+        return;
+    }
+
+    s->i_zeros = ( *s->p == 0x00 ) ? s->i_zeros + 1 : 0;
+    s->p++;
+    if( s->i_zeros >= 2 && s->p < s->p_end && *s->p == 0x03 )
+    {
+        s->p++;
+        s->i_zeros = 0;
+    }
 }
 
 static inline int bs_pos( const bs_t *s )
@@ -85,7 +120,7 @@ static inline uint32_t bs_read( bs_t *s, int i_count )
             s->i_left -= i_count;
             if( s->i_left == 0 )
             {
-                s->p++;
+                bs_forward( s );
                 s->i_left = 8;
             }
             return( i_result );
@@ -95,7 +130,7 @@ static inline uint32_t bs_read( bs_t *s, int i_count )
             /* less in the buffer than requested */
            i_result |= (*s->p&i_mask[s->i_left]) << -i_shr;
            i_count  -= s->i_left;
-           s->p++;
+           bs_forward( s );
            s->i_left = 8;
         }
     }
@@ -113,7 +148,7 @@ static inline uint32_t bs_read1( bs_t *s )
         i_result = ( *s->p >> s->i_left )&0x01;
         if( s->i_left == 0 )
         {
-            s->p++;
+            bs_forward( s );
             s->i_left = 8;
         }
         return i_result;
@@ -136,7 +171,13 @@ static inline void bs_skip( bs_t *s, ssize_t i_count )
     {
         const int i_bytes = ( -s->i_left + 8 ) / 8;
 
-        s->p += i_bytes;
+        if( s->b_rbsp )
+        {
+            for( int i = 0; i < i_bytes && s->p < s->p_end; i++ )
+                bs_forward( s );
+        }
+        else
+            s->p += i_bytes;
         s->i_left += 8 * i_bytes;
     }
 }
@@ -174,7 +215,7 @@ static inline void bs_align( bs_t *s )
     if( s->i_left != 8 )
     {
         s->i_left = 8;
-        s->p++;
+        bs_forward( s );
     }
 }
 
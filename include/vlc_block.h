@@ -134,9 +134,28 @@ struct block_t
  *      with preheader and or body (increase
  *      and decrease are supported). Use it as it is optimised.
  * - block_Duplicate : create a copy of a block.
+ * - block_Share : make the payload of a block shareable (read-only).
+ * - block_Clone : reference the payload of a shared block, or copy another
+ *      block.
+ * - block_Unshare : make the payload writable again, copying it if
+ *      still shared.
  ****************************************************************************/
 VLC_API void block_Init( block_t *, void *, size_t );
 VLC_API block_t *block_Alloc( size_t ) VLC_USED VLC_MALLOC;
+
+/**
+ * Block allocator statistics
+ */
+typedef struct
+{
+    uint64_t allocs;  /**< blocks allocated from per-thread size classes */
+    uint64_t hits;    /**< of which were recycled from a thread cache */
+    uint64_t spills;  /**< released blocks not kept because a cache was full */
+    size_t   cached;  /**< bytes currently held in thread caches */
+    unsigned arenas;  /**< number of live per-thread arenas */
+} block_alloc_stats_t;
+
+VLC_API void block_GetAllocStats( block_alloc_stats_t * );
 VLC_API block_t *block_Realloc( block_t *, ssize_t i_pre, size_t i_body ) VLC_USED;
 
 static inline void block_CopyProperties( block_t *dst, block_t *src )
@@ -161,6 +180,10 @@ static inline block_t *block_Duplicate( block_t *p_block )
     return p_dup;
 }
 
+VLC_API block_t *block_Share( block_t * ) VLC_USED;
+VLC_API block_t *block_Clone( block_t * ) VLC_USED;
+VLC_API block_t *block_Unshare( block_t * ) VLC_USED;
+
 static inline void block_Release( block_t *p_block )
 {
     p_block->pf_release( p_block );
@@ -294,6 +317,8 @@ static inline block_t *block_ChainGather( block_t *p_list )
  * Fifos of blocks.
  ****************************************************************************
  * - block_FifoNew : create and init a new fifo
+ * - block_FifoNewSPSC : create a fifo for exactly one producer and one
+ *      consumer thread, which does not lock unless either side must wait
  * - block_FifoRelease : destroy a fifo and free all blocks in it.
  * - block_FifoPace : wait for a fifo to drain to a specified number of packets or total data size
  * - block_FifoEmpty : free all blocks in a fifo
@@ -308,6 +333,7 @@ static inline block_t *block_ChainGather( block_t *p_list )
  ****************************************************************************/
 
 VLC_API block_fifo_t *block_FifoNew( void ) VLC_USED VLC_MALLOC;
+VLC_API block_fifo_t *block_FifoNewSPSC( void ) VLC_USED VLC_MALLOC;
 VLC_API void block_FifoRelease( block_fifo_t * );
 VLC_API void block_FifoPace( block_fifo_t *fifo, size_t max_depth, size_t max_size );
 VLC_API void block_FifoEmpty( block_fifo_t * );
@@ -444,9 +444,24 @@ static inline int block_PeekOffsetBytes( block_bytestream_t *p_bytestream,
     return VLC_SUCCESS;
 }
 
+/**
+ * Finds the first occurrence of a start code within a block, as the address
+ * of its first byte. The start code must be entirely in [p, end).
+ * \return the start code address, or NULL if there is none.
+ */
+typedef const uint8_t * (*block_startcode_helper_t)( const uint8_t *p,
+                                                     const uint8_t *end );
+
+/**
+ * Looks up a start code from the given offset of the bytestream.
+ *
+ * If p_startcode_helper is not NULL, it is used to scan each block, only the
+ * start codes straddling two blocks being looked up byte by byte.
+ */
 static inline int block_FindStartcodeFromOffset(
     block_bytestream_t *p_bytestream, size_t *pi_offset,
-    const uint8_t *p_startcode, int i_startcode_length )
+    const uint8_t *p_startcode, int i_startcode_length,
+    block_startcode_helper_t p_startcode_helper )
 {
     block_t *p_block, *p_block_backup = 0;
     int i_size = 0;
@@ -478,6 +493,22 @@ static inline int block_FindStartcodeFromOffset(
     {
         for( i_offset = i_size; i_offset < p_block->i_buffer; i_offset++ )
         {
+            /* Scans the block with the helper, up to the start codes that
+             * could straddle the next block */
+            if( p_startcode_helper != NULL && i_match == 0 &&
+                p_block->i_buffer - i_offset >= (size_t)i_startcode_length )
+            {
+                const uint8_t *p_res = p_startcode_helper(
+                                    &p_block->p_buffer[i_offset],
+                                    &p_block->p_buffer[p_block->i_buffer] );
+                if( p_res != NULL )
+                {
+                    *pi_offset += p_res - p_block->p_buffer;
+                    return VLC_SUCCESS;
+                }
+                i_offset = p_block->i_buffer - ( i_startcode_length - 1 );
+            }
+
             if( p_block->p_buffer[i_offset] == p_startcode[i_match] )
             {
                 if( !i_match )
@@ -124,6 +124,10 @@ struct decoder_t
      * XXX use decoder_GetDisplayRate */
     int             (*pf_get_display_rate)( decoder_t * );
 
+    /* Drop level
+     * XXX use decoder_GetDropLevel */
+    int             (*pf_get_drop_level)( decoder_t * );
+
     /* Private structure for the owner of the decoder */
     decoder_owner_sys_t *p_owner;
 
@@ -242,4 +246,23 @@ VLC_API mtime_t decoder_GetDisplayDate( decoder_t *, mtime_t ) VLC_USED;
  */
 VLC_API int decoder_GetDisplayRate( decoder_t * ) VLC_USED;
 
+/**
+ * Levels of work a video decoder may skip, before decoding, to catch up when
+ * its pictures are displayed late. Each level includes the previous ones.
+ */
+enum decoder_drop_level_e
+{
+    DECODER_DROP_NONE,       /**< decode everything */
+    DECODER_DROP_NONREF,     /**< skip the non-reference (B) frames */
+    DECODER_DROP_LOOPFILTER, /**< also skip the in-loop deblocking filter */
+    DECODER_DROP_NONKEY,     /**< decode the key frames only */
+};
+
+/**
+ * This function returns the drop level the decoder should apply to the next
+ * blocks (see decoder_drop_level_e), as decided by the decoder owner from the
+ * lateness of the displayed pictures.
+ */
+VLC_API int decoder_GetDropLevel( decoder_t * ) VLC_USED;
+
 #endif /* _VLC_CODEC_H */
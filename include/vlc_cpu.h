@@ -85,8 +85,14 @@ VLC_API unsigned vlc_CPU(void);
 
 # ifdef __SSSE3__
 #  define vlc_CPU_SSSE3() (1)
+#  define VLC_SSSE3
 # else
 #  define vlc_CPU_SSSE3() ((vlc_CPU() & VLC_CPU_SSSE3) != 0)
+#  if VLC_GCC_VERSION(4, 4) || defined(__clang__)
+#   define VLC_SSSE3 __attribute__ ((__target__ ("ssse3")))
+#  else
+#   define VLC_SSSE3 VLC_SSSE3_is_not_implemented_on_this_compiler
+#  endif
 # endif
 
 # ifdef __SSE4_1__
@@ -115,8 +121,14 @@ VLC_API unsigned vlc_CPU(void);
 
 # ifdef __AVX2__
 #  define vlc_CPU_AVX2() (1)
+#  define VLC_AVX2
 # else
 #  define vlc_CPU_AVX2() ((vlc_CPU() & VLC_CPU_AVX2) != 0)
+#  if VLC_GCC_VERSION(4, 9) || defined(__clang__)
+#   define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+#  else
+#   define VLC_AVX2 VLC_AVX2_is_not_implemented_on_this_compiler
+#  endif
 # endif
 
 # ifdef __3dNOW__
@@ -178,6 +190,9 @@ VLC_API unsigned vlc_CPU(void);
 
 # elif defined (__aarch64__)
 #  define HAVE_FPU 1
+/* Advanced SIMD is mandatory on ARMv8-A */
+#  define VLC_CPU_ARM_NEON 2
+#  define vlc_CPU_ARM_NEON() (1)
 
 # elif defined (__sparc__)
 #  define HAVE_FPU 1
@@ -64,6 +64,19 @@ typedef struct
     float      pf_gain[AUDIO_REPLAY_GAIN_MAX];
 } audio_replay_gain_t;
 
+/**
+ * audio priming and padding, for gapless playback
+ *
+ * The dates are relative to the start of the stream (VLC_TS_0).
+ */
+typedef struct
+{
+    /* samples decoded before the first one to play (0 if none) */
+    unsigned i_delay;
+    /* samples to play after the delay (0 if unknown) */
+    uint64_t i_samples;
+} audio_gapless_t;
+
 /**
  * audio format description
  */
@@ -406,6 +419,7 @@ struct es_format_t
 
     audio_format_t  audio;    /**< description of audio format */
     audio_replay_gain_t audio_replay_gain; /*< audio replay gain information */
+    audio_gapless_t audio_gapless; /*< audio priming and padding information */
     video_format_t video;     /**< description of video format */
     subs_format_t  subs;      /**< description of subtitle format */
 
@@ -166,6 +166,7 @@ typedef struct vlc_event_t
         struct vlc_input_item_subitem_tree_added
         {
             input_item_node_t * p_root;
+            bool b_partial; /* more sub-items of the same item will follow */
         } input_item_subitem_tree_added;
         struct vlc_input_item_duration_changed
         {
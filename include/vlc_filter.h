@@ -415,5 +415,16 @@ VLC_API int filter_chain_MouseEvent( filter_chain_t *, const vlc_mouse_t *, cons
 int filter_chain_ForEach( filter_chain_t *chain,
                           int (*cb)( filter_t *, void * ), void *opaque );
 
+/**
+ * Run the video filters of the chain in parallel.
+ *
+ * Each filter but the last one runs on its own thread, the pictures being
+ * passed from one to the next through short queues. Pictures are still
+ * output in order; filter_chain_VideoFilter() may then return NULL while
+ * pictures are in flight, and must be called with a NULL picture to drain
+ * them.
+ */
+void filter_chain_SetPipelined( filter_chain_t *, bool );
+
 #endif /* _VLC_FILTER_H */
 
@@ -321,6 +321,12 @@
 /* VDPAU output surface RGBA */
 #define VLC_CODEC_VDPAU_OUTPUT    VLC_FOURCC('V','D','O','R')
 
+/* VA-API surface YCbCr 4:2:0 */
+#define VLC_CODEC_VAAPI_420       VLC_FOURCC('V','A','O','P')
+
+/* Direct3D9 surface (DXVA2) */
+#define VLC_CODEC_D3D9_OPAQUE     VLC_FOURCC('D','X','A','9')
+
 /* MediaCodec/IOMX opaque buffer type */
 #define VLC_CODEC_ANDROID_OPAQUE  VLC_FOURCC('A','N','O','P')
 
@@ -93,4 +93,49 @@ VLC_API bool vlc_http_cookies_append( vlc_http_cookie_jar_t * p_jar, const char
  */
 VLC_API char *vlc_http_cookies_for_url( vlc_http_cookie_jar_t * p_jar, const vlc_url_t * p_url );
 
+/* Persistent connections */
+
+struct vlc_tls;
+
+typedef struct vlc_http_pool_stats_t
+{
+    uint64_t i_reused; /**< requests served through an idle connection */
+    uint64_t i_missed; /**< requests for which a connection was opened */
+    unsigned i_idle; /**< idle connections currently kept */
+} vlc_http_pool_stats_t;
+
+/**
+ * Takes an idle connection out of the HTTP connection pool of the instance.
+ *
+ * Connections are identified by a key made by the caller, which must cover
+ * everything the connection depends on (scheme, server, port, proxy).
+ *
+ * @param psz_key connection key
+ * @param pp_tls TLS session of the connection, or NULL [OUT]
+ * @return a connected socket, or -1 if no usable connection is idle
+ *
+ * @note A TLS session comes with its credentials (its parent object), which
+ * the caller then owns and must release with vlc_tls_Delete().
+ */
+VLC_API int vlc_http_pool_Take( vlc_object_t *, const char *psz_key,
+                                struct vlc_tls **pp_tls ) VLC_USED;
+
+/**
+ * Gives a connection back to the HTTP connection pool of the instance.
+ *
+ * The connection must be idle: the last response must have been read
+ * completely and the server must not have asked for the connection to be
+ * closed. The pool takes ownership of the socket, of the TLS session if any,
+ * and of the TLS credentials of the session.
+ */
+VLC_API void vlc_http_pool_Give( vlc_object_t *, const char *psz_key,
+                                 int fd, struct vlc_tls *p_tls );
+
+/**
+ * Returns the reuse statistics of the pool for a key.
+ * @return VLC_SUCCESS, or VLC_EGENERIC if the key was never used
+ */
+VLC_API int vlc_http_pool_GetStats( vlc_object_t *, const char *psz_key,
+                                    vlc_http_pool_stats_t * );
+
 #endif /* VLC_HTTP_H */
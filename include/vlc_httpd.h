@@ -71,6 +71,19 @@ VLC_API httpd_host_t *vlc_rtsp_HostNew( vlc_object_t * ) VLC_USED;
 /* delete a host */
 VLC_API void httpd_HostDelete( httpd_host_t * );
 
+typedef struct
+{
+    unsigned i_workers;     /* threads serving the host */
+    unsigned i_clients;     /* connections currently open */
+    size_t   i_backlog;     /* bytes queued but not sent yet */
+    uint64_t i_accepted;    /* connections accepted so far */
+    uint64_t i_sent;        /* bytes sent so far */
+    uint64_t i_lagged;      /* times a stream client fell behind and skipped data */
+} httpd_host_stats_t;
+
+/* get the host statistics */
+VLC_API void httpd_HostGetStats( httpd_host_t *, httpd_host_stats_t * );
+
 typedef struct
 {
     char * name;
@@ -145,6 +158,14 @@ VLC_API int httpd_StreamHeader( httpd_stream_t *, uint8_t *p_data, int i_data );
 VLC_API int httpd_StreamSend( httpd_stream_t *, const block_t *p_block );
 VLC_API int httpd_StreamSetHTTPHeaders(httpd_stream_t *, httpd_header *, size_t);
 
+/* what to do with clients falling behind the stream buffer */
+enum
+{
+    HTTPD_STREAM_SLOW_SKIP, /* skip them forward to the last keyframe (default) */
+    HTTPD_STREAM_SLOW_DROP, /* close their connection */
+};
+VLC_API void httpd_StreamSetSlowClients( httpd_stream_t *, int );
+
 /* Msg functions facilities */
 VLC_API void httpd_MsgAdd( httpd_message_t *, const char *psz_name, const char *psz_value, ... ) VLC_FORMAT( 3, 4 );
 /* return "" if not found. The string is not allocated */
@@ -52,9 +52,13 @@ struct image_handler_t
 
     /* Private properties */
     vlc_object_t *p_parent;
-    decoder_t *p_dec;
     encoder_t *p_enc;
-    filter_t  *p_filter;
+
+    /* Decoders (per codec) and converters (per pair of chromas) kept for
+     * the next images, the most recently used first */
+#define IMAGE_HANDLER_CACHE 4
+    decoder_t *pp_dec[IMAGE_HANDLER_CACHE];
+    filter_t  *pp_filter[IMAGE_HANDLER_CACHE];
 };
 
 VLC_API image_handler_t * image_HandlerCreate( vlc_object_t * ) VLC_USED;
@@ -480,6 +480,9 @@ enum input_query_e
     /* External clock managments */
     INPUT_GET_PCR_SYSTEM,   /* arg1=mtime_t *, arg2=mtime_t *       res=can fail */
     INPUT_MODIFY_PCR_SYSTEM,/* arg1=int absolute, arg2=mtime_t      res=can fail */
+
+    /* Standby (see input_CreateStandby) */
+    INPUT_LEAVE_STANDBY,    /* res=can fail */
 };
 
 /** @}*/
@@ -494,6 +497,9 @@ VLC_API input_thread_t * input_Create( vlc_object_t *p_parent, input_item_t *, c
 VLC_API input_thread_t * input_CreateAndStart( vlc_object_t *p_parent, input_item_t *, const char *psz_log ) VLC_USED;
 #define input_CreateAndStart(a,b,c) input_CreateAndStart(VLC_OBJECT(a),b,c)
 
+VLC_API input_thread_t * input_CreateStandby( vlc_object_t *p_parent, input_item_t *, const char *psz_log, input_resource_t * ) VLC_USED;
+#define input_CreateStandby(a,b,c,d) input_CreateStandby(VLC_OBJECT(a),b,c,d)
+
 VLC_API int input_Start( input_thread_t * );
 
 VLC_API void input_Stop( input_thread_t *, bool b_abort );
@@ -164,6 +164,16 @@ VLC_API void input_item_node_Delete( input_item_node_t *p_node );
  */
 VLC_API void input_item_node_PostAndDelete( input_item_node_t *p_node );
 
+/**
+ * Post the subitems added so far, before the end.
+ *
+ * Sends the same events as input_item_node_PostAndDelete(), marked as
+ * partial, then deletes the children of the node, but not the node, which
+ * must still be posted with input_item_node_PostAndDelete() in the end.
+ * This lets the items of a long enumeration appear as it goes.
+ */
+VLC_API void input_item_node_PostPartial( input_item_node_t *p_node );
+
 
 /**
  * Option flags
@@ -197,6 +207,7 @@ VLC_API void input_item_SetURI( input_item_t * p_i, const char *psz_uri );
 VLC_API mtime_t input_item_GetDuration( input_item_t * p_i );
 VLC_API void input_item_SetDuration( input_item_t * p_i, mtime_t i_duration );
 VLC_API bool input_item_IsPreparsed( input_item_t *p_i );
+VLC_API void input_item_SetPreparsed( input_item_t *p_i, bool b_preparsed );
 VLC_API bool input_item_IsArtFetched( input_item_t *p_i );
 
 #define INPUT_META( name ) \
@@ -289,7 +300,8 @@ typedef enum input_item_meta_request_option_t
     META_REQUEST_OPTION_NONE          = 0x00,
     META_REQUEST_OPTION_SCOPE_LOCAL   = 0x01,
     META_REQUEST_OPTION_SCOPE_NETWORK = 0x02,
-    META_REQUEST_OPTION_SCOPE_ANY     = 0x03
+    META_REQUEST_OPTION_SCOPE_ANY     = 0x03,
+    META_REQUEST_OPTION_PRIORITY      = 0x04, /**< item is visible to the user */
 } input_item_meta_request_option_t;
 
 VLC_API int libvlc_MetaRequest(libvlc_int_t *, input_item_t *,
@@ -300,6 +312,35 @@ VLC_API int libvlc_ArtRequest(libvlc_int_t *, input_item_t *,
 /******************
  * Input stats
  ******************/
+
+/** Stages of the playback pipeline with a latency histogram */
+enum input_latency_stage_e
+{
+    INPUT_LATENCY_DEMUX,        /**< duration of one demux call */
+    INPUT_LATENCY_VIDEO_QUEUE,  /**< time spent in the video decoder fifo */
+    INPUT_LATENCY_VIDEO_DECODE, /**< time spent decoding one video block */
+    INPUT_LATENCY_VIDEO_OUTPUT, /**< time until the picture is displayed */
+    INPUT_LATENCY_AUDIO_QUEUE,  /**< time spent in the audio decoder fifo */
+    INPUT_LATENCY_AUDIO_DECODE, /**< time spent decoding one audio block */
+    INPUT_LATENCY_AUDIO_OUTPUT, /**< time until the buffer is played */
+    INPUT_LATENCY_STAGES
+};
+
+/** Number of buckets of a latency histogram: bucket 0 counts the samples
+ * below INPUT_LATENCY_BUCKET_BASE, bucket n those below twice the bound of
+ * bucket n-1, and the last one all the others. Negative samples (late
+ * pictures or buffers) are counted as zero */
+#define INPUT_LATENCY_BUCKETS 16
+#define INPUT_LATENCY_BUCKET_BASE 64 /* microseconds */
+
+typedef struct
+{
+    uint64_t i_count;
+    mtime_t  i_total; /**< sum of the samples (microseconds) */
+    mtime_t  i_max;
+    uint64_t pi_buckets[INPUT_LATENCY_BUCKETS];
+} input_latency_histogram_t;
+
 struct input_stats_t
 {
     vlc_mutex_t         lock;
@@ -309,6 +350,9 @@ struct input_stats_t
     int64_t i_read_bytes;
     float f_input_bitrate;
     float f_average_input_bitrate;
+    int64_t i_prefetch_hits;
+    int64_t i_prefetch_misses;
+    mtime_t i_prefetch_stall;
 
     /* Demux */
     int64_t i_demux_read_packets;
@@ -317,6 +361,9 @@ struct input_stats_t
     float f_average_demux_bitrate;
     int64_t i_demux_corrupted;
     int64_t i_demux_discontinuity;
+    /* Clock recovery: drift of the source (ppm), jitter (microseconds) */
+    float f_clock_drift;
+    mtime_t i_clock_jitter;
 
     /* Decoders */
     int64_t i_decoded_audio;
@@ -325,6 +372,23 @@ struct input_stats_t
     /* Vout */
     int64_t i_displayed_pictures;
     int64_t i_lost_pictures;
+    /* Video latency per stage, in microseconds */
+    mtime_t i_latency_queue;
+    mtime_t i_latency_decode;
+    mtime_t i_latency_output;
+
+    /* Pipeline */
+    input_latency_histogram_t latency[INPUT_LATENCY_STAGES];
+    /* Depths of the decoder fifos, as last sampled */
+    int64_t i_video_fifo_blocks;
+    int64_t i_video_fifo_bytes;
+    int64_t i_audio_fifo_blocks;
+    int64_t i_audio_fifo_bytes;
+    /* Video drop policy: current level (see decoder_drop_level_e), number of
+     * escalations, and blocks decoded at a level other than none */
+    int64_t i_video_drop_level;
+    int64_t i_video_drop_escalations;
+    int64_t i_video_degraded_blocks;
 
     /* Sout */
     int64_t i_sent_packets;
@@ -0,0 +1,138 @@
+/*****************************************************************************
+ * vlc_interrupt.h: interruptible waits
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_INTERRUPT_H
+# define VLC_INTERRUPT_H 1
+
+# include <vlc_threads.h>
+
+/**
+ * \defgroup interrupt Interruptible waits
+ * \ingroup threads
+ * An interrupt context can be attached to a thread. Another thread can then
+ * interrupt the current or next interruptible wait of that thread (once,
+ * with vlc_interrupt_raise()), or all of its waits until the context is
+ * released (with vlc_interrupt_kill()).
+ *
+ * Unlike thread cancellation, an interrupted wait returns an error
+ * (EINTR) to its caller, which can then unwind and clean up normally.
+ * The waits of a thread without interrupt context are not interruptible.
+ * @{
+ * \file
+ * Interrupt contexts and interruptible waits
+ */
+
+struct pollfd;
+
+typedef struct vlc_interrupt vlc_interrupt_t;
+
+/**
+ * Creates an interrupt context.
+ * @return the context, or NULL on error
+ */
+VLC_API vlc_interrupt_t *vlc_interrupt_create(void) VLC_USED;
+
+/**
+ * Destroys an interrupt context. It must not be set on any thread.
+ */
+VLC_API void vlc_interrupt_destroy(vlc_interrupt_t *);
+
+/**
+ * Sets the interrupt context of the calling thread.
+ *
+ * @param ctx context to set, or NULL to make the waits not interruptible
+ * @return the previous context of the thread, if any
+ */
+VLC_API vlc_interrupt_t *vlc_interrupt_set(vlc_interrupt_t *ctx);
+
+/**
+ * Interrupts the current interruptible wait of the thread using the context,
+ * or the next one if the thread is not waiting.
+ */
+VLC_API void vlc_interrupt_raise(vlc_interrupt_t *);
+
+/**
+ * Interrupts all the current and future interruptible waits of the thread
+ * using the context.
+ */
+VLC_API void vlc_interrupt_kill(vlc_interrupt_t *);
+
+/**
+ * Checks if the interrupt context of the calling thread was killed.
+ */
+VLC_API bool vlc_killed(void) VLC_USED;
+
+/**
+ * Discards a pending interruption (but not a kill) of the calling thread.
+ */
+VLC_API void vlc_interrupt_forget(void);
+
+/**
+ * Registers a function which interrupts a custom wait of the calling thread.
+ *
+ * The function is called, from the interrupting thread, if the context of
+ * the calling thread is interrupted before vlc_interrupt_unregister(); it
+ * is called immediately if an interruption is already pending. It is
+ * called with the context locked, so it must not wait for anything that
+ * the calling thread could hold.
+ *
+ * @note Nothing is done if the calling thread has no interrupt context.
+ */
+VLC_API void vlc_interrupt_register(void (*cb)(void *), void *opaque);
+
+/**
+ * Unregisters the function registered by vlc_interrupt_register().
+ *
+ * @return EINTR if the wait was interrupted, 0 otherwise
+ */
+VLC_API int vlc_interrupt_unregister(void);
+
+/**
+ * Interruptible poll().
+ *
+ * @return like poll(), or -1 with errno set to EINTR if interrupted. The
+ * signals do not interrupt infinite waits.
+ */
+VLC_API int vlc_poll_i11e(struct pollfd *, unsigned, int);
+
+/**
+ * Interruptible vlc_sem_wait().
+ *
+ * @return 0 on success, EINTR if interrupted (the semaphore is unchanged)
+ */
+VLC_API int vlc_sem_wait_i11e(vlc_sem_t *);
+
+/**
+ * Interruptible mwait().
+ *
+ * @return 0 once the deadline is reached, EINTR if interrupted before
+ */
+VLC_API int vlc_mwait_i11e(mtime_t);
+
+/**
+ * Interruptible msleep().
+ */
+static inline int vlc_msleep_i11e(mtime_t delay)
+{
+    return vlc_mwait_i11e(mdate() + delay);
+}
+
+/** @} */
+#endif
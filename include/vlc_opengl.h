@@ -54,6 +54,23 @@ struct vlc_gl_t
     void (*unlock)(vlc_gl_t *);
 #endif
     void*(*getProcAddress)(vlc_gl_t *, const char *);
+
+    enum {
+        VLC_GL_EXT_DEFAULT,
+        VLC_GL_EXT_EGL,
+    } ext;
+    union {
+        /* if ext == VLC_GL_EXT_EGL */
+        struct {
+            /* calls eglQueryString() with the current display */
+            const char *(*queryString)(vlc_gl_t *, int32_t name);
+            /* calls eglCreateImageKHR() with the current display */
+            void *(*createImageKHR)(vlc_gl_t *, unsigned target, void *buffer,
+                                    const int32_t *attrib_list);
+            /* calls eglDestroyImageKHR() with the current display */
+            bool (*destroyImageKHR)(vlc_gl_t *, void *image);
+        } egl;
+    };
 };
 
 enum {
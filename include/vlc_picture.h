@@ -58,6 +58,35 @@ typedef struct plane_t
 #define PICTURE_PLANE_MAX (VOUT_MAX_PLANES)
 
 
+/**
+ * Quantizer table of a picture, one value per macroblock, as exported by the
+ * decoder for the post processing filters. It is shared by the pictures the
+ * properties are copied to.
+ */
+typedef struct picture_qp_t
+{
+    atomic_uintptr_t refs;
+    unsigned i_width;  /**< Width of the picture the table applies to */
+    unsigned i_height; /**< Height of the picture the table applies to */
+    int      i_stride; /**< Bytes per line of macroblocks */
+    int      i_type;   /**< Quantizer scale type: 0 MPEG-1, 1 MPEG-2 */
+    int8_t  *p_table;
+} picture_qp_t;
+
+/**
+ * Creates a quantizer table of i_lines lines of macroblocks, to be filled.
+ */
+VLC_API picture_qp_t *picture_qp_New( unsigned i_width, unsigned i_height,
+                                      int i_stride, int i_lines ) VLC_USED;
+
+static inline picture_qp_t *picture_qp_Hold( picture_qp_t *p_qp )
+{
+    atomic_fetch_add( &p_qp->refs, 1 );
+    return p_qp;
+}
+
+VLC_API void picture_qp_Release( picture_qp_t * );
+
 /**
  * A private definition to help overloading picture release
  */
@@ -93,6 +122,7 @@ struct picture_t
     unsigned int    i_nb_fields;                  /**< # of displayed fields */
     void          * context;          /**< video format-specific data pointer,
              * must point to a (void (*)(void*)) pointer to free the context */
+    picture_qp_t  * p_qp;                 /**< quantizer table, or NULL */
     /**@}*/
 
     /** Private data - the video output plugin might want to put stuff here to
@@ -206,6 +236,26 @@ VLC_API void plane_CopyPixels( plane_t *p_dst, const plane_t *p_src );
  */
 VLC_API void picture_Copy( picture_t *p_dst, const picture_t *p_src );
 
+/**
+ * Process-wide picture copy statistics, to track unneeded copies
+ */
+typedef struct {
+    uint64_t pictures;    /**< pictures copied */
+    uint64_t planes;      /**< planes copied */
+    uint64_t bytes;       /**< bytes copied */
+    uint64_t bulk_planes; /**< planes copied at once, the pitches matching */
+    uint64_t streamed;    /**< bytes copied bypassing the caches */
+    uint64_t parallel;    /**< planes split across the thread pool */
+    uint64_t elided;      /**< planes copied onto themselves, skipped */
+} picture_copy_stats_t;
+
+/**
+ * Fetches the picture copy statistics of the process.
+ * @note The values are not a consistent snapshot if pictures are copied
+ * concurrently.
+ */
+VLC_API void picture_GetCopyStats( picture_copy_stats_t * );
+
 /**
  * This function will export a picture to an encoded bitstream.
  *
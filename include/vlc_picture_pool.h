@@ -179,6 +179,24 @@ VLC_USED;
  */
 VLC_API unsigned picture_pool_GetSize(const picture_pool_t *);
 
+/**
+ * Picture pool usage statistics
+ */
+typedef struct {
+    unsigned hits;       /**< pictures successfully obtained */
+    unsigned misses;     /**< picture_pool_Get() calls that returned NULL */
+    unsigned exhausted;  /**< times the last free picture was obtained */
+    unsigned in_use;     /**< pictures currently allocated */
+    unsigned high_water; /**< largest number of pictures allocated at once */
+} picture_pool_stats_t;
+
+/**
+ * Fetches usage statistics of a pool, e.g. to tune its size.
+ * @note This function is thread-safe, but the values are not a consistent
+ * snapshot if pictures are obtained or released concurrently.
+ */
+VLC_API void picture_pool_GetStats(picture_pool_t *, picture_pool_stats_t *);
+
 
 #endif /* VLC_PICTURE_POOL_H */
 
@@ -139,6 +139,8 @@ struct playlist_item_t
     playlist_item_t       *p_parent;    /**< Item parent */
     int                    i_children;  /**< Number of children, -1 if not a node */
     unsigned               i_nb_played; /**< Times played */
+    int                    i_partial;   /**< Items inserted for the sub-items
+                                             posted so far, while expanding */
 
     int                    i_id;        /**< Playlist item specific id */
     uint8_t                i_flags;     /**< Flags \see playlist_item_flags_e */
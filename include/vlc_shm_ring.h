@@ -0,0 +1,125 @@
+/*****************************************************************************
+ * vlc_shm_ring.h: shared memory ring of elementary stream frames
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SHM_RING_H
+#define VLC_SHM_RING_H 1
+
+/**
+ * \file
+ * Layout of the shared memory ring written by the "shm" stream output, and
+ * read by the libvlc_shm_reader API from other processes.
+ *
+ * The ring is a memory mapped file: a header followed by a fixed number of
+ * slots of a fixed size, each holding one frame (a picture or a buffer of
+ * audio samples) and its metadata. There is a single writer and any number
+ * of readers, which never write to the mapping: they can attach and detach
+ * at any time without the writer knowing or waiting for them.
+ *
+ * Frame n goes in slot n % slot_count. Each slot is guarded by a sequence
+ * lock: its sequence number is odd while the writer fills it, and 2 * n + 2
+ * once frame n is complete. A reader checks the sequence before and after
+ * copying the frame, and drops it if it changed (the writer lapped it).
+ * The writer then publishes n + 1 as the count of written frames.
+ *
+ * All the fields are in host byte order: the ring is not meant to be shared
+ * between hosts.
+ */
+
+#include <vlc_atomic.h>
+
+#define SHM_RING_MAGIC   "VLCSHMR"
+#define SHM_RING_VERSION 1
+
+/* Slots and their payloads are aligned on a cache line */
+#define SHM_RING_ALIGN   64
+
+enum
+{
+    SHM_RING_LIVE = 1,   /* the writer is running */
+    SHM_RING_CLOSED = 2, /* the writer is gone, no more frames will come */
+};
+
+typedef struct
+{
+    char     magic[8];     /* SHM_RING_MAGIC */
+    uint32_t version;      /* SHM_RING_VERSION */
+    uint32_t slot_count;
+    uint64_t slot_size;    /* bytes, metadata included */
+    atomic_uint_least64_t written; /* frames written so far */
+    atomic_uint_least32_t state;
+} shm_ring_header_t;
+
+typedef struct
+{
+    atomic_uint_least64_t seq; /* sequence lock, see above */
+    uint32_t es_id;     /* elementary stream of the frame */
+    uint32_t cat;       /* VIDEO_ES or AUDIO_ES */
+    uint32_t codec;     /* fourcc of the payload, usually a raw one */
+    uint32_t flags;     /* BLOCK_FLAG_* */
+    int64_t  pts;       /* VLC_TS_INVALID if none, in microseconds */
+    int64_t  dts;
+    int64_t  length;    /* duration in microseconds */
+    union
+    {
+        struct
+        {
+            uint32_t width;
+            uint32_t height;
+            uint32_t visible_width;
+            uint32_t visible_height;
+            uint32_t frame_rate;
+            uint32_t frame_rate_base;
+        } video;
+        struct
+        {
+            uint32_t rate;
+            uint32_t channels;
+            uint32_t bits_per_sample;
+        } audio;
+    };
+    uint64_t size;      /* bytes of payload */
+} shm_ring_slot_t;
+
+static inline size_t shm_ring_HeaderSize( void )
+{
+    return ( sizeof( shm_ring_header_t ) + SHM_RING_ALIGN - 1 )
+           & ~(size_t)( SHM_RING_ALIGN - 1 );
+}
+
+/* Offset of the payload in a slot */
+static inline size_t shm_ring_PayloadOffset( void )
+{
+    return ( sizeof( shm_ring_slot_t ) + SHM_RING_ALIGN - 1 )
+           & ~(size_t)( SHM_RING_ALIGN - 1 );
+}
+
+static inline shm_ring_slot_t *shm_ring_Slot( shm_ring_header_t *p_ring,
+                                              uint64_t i_frame )
+{
+    return (shm_ring_slot_t *)( (uint8_t *)p_ring + shm_ring_HeaderSize()
+           + ( i_frame % p_ring->slot_count ) * p_ring->slot_size );
+}
+
+static inline uint8_t *shm_ring_Payload( shm_ring_slot_t *p_slot )
+{
+    return (uint8_t *)p_slot + shm_ring_PayloadOffset();
+}
+
+#endif
@@ -184,10 +184,27 @@ static inline char *stream_ContentType( stream_t *s )
 VLC_API stream_t * stream_DemuxNew( demux_t *p_demux, const char *psz_demux, es_out_t *out );
 
 /**
- * Send data to a stream handle created by stream_DemuxNew().
+ * Create a special stream and a demuxer running synchronously, without a
+ * thread of its own: stream_DemuxSend() runs the demuxer in the calling
+ * thread, as long as more than i_reserve bytes are queued, so that the
+ * demuxer does not hit the end of the data in the middle of a unit.
+ * You must delete it using stream_Delete.
+ */
+VLC_API stream_t * stream_DemuxNewSync( demux_t *p_demux, const char *psz_demux, es_out_t *out, size_t i_reserve );
+
+/**
+ * Send data to a stream handle created by stream_DemuxNew() or
+ * stream_DemuxNewSync().
  */
 VLC_API void stream_DemuxSend( stream_t *s, block_t *p_block );
 
+/**
+ * Demux all the data queued in a stream handle created by
+ * stream_DemuxNewSync(), once no more data will be sent.
+ * This does nothing for a stream handle created by stream_DemuxNew().
+ */
+VLC_API void stream_DemuxDrain( stream_t *s );
+
 /**
  * Perform a <b>demux</b> (i.e. DEMUX_...) control request on a stream handle
  * created by stream_DemuxNew().
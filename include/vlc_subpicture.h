@@ -89,6 +89,14 @@ struct subpicture_region_t
  */
 VLC_API subpicture_region_t * subpicture_region_New( const video_format_t *p_fmt );
 
+/**
+ * This function will create a new subpicture region sharing the given
+ * picture, which must not be modified afterwards (a reference is taken).
+ *
+ * You must use subpicture_region_Delete to destroy it.
+ */
+VLC_API subpicture_region_t * subpicture_region_NewFromPicture( const video_format_t *p_fmt, picture_t *p_picture );
+
 /**
  * This function will destroy a subpicture region allocated by
  * subpicture_region_New.
@@ -0,0 +1,100 @@
+/*****************************************************************************
+ * vlc_threadpool.h: shared worker threads
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_THREADPOOL_H
+# define VLC_THREADPOOL_H 1
+
+/**
+ * \defgroup threadpool Thread pool
+ * \ingroup threads
+ * Worker threads shared by the whole process, one per CPU, which run the
+ * tasks submitted by the core and the modules.
+ *
+ * The pool is meant for computations that can be split and run in
+ * parallel: bands of a picture, independent items or segments. A task
+ * should not block for long (on network I/O, or on a condition set by
+ * another task), as it would hold one of the few workers meanwhile.
+ * @{
+ * \file
+ * Thread pool and tasks
+ */
+
+typedef struct vlc_task vlc_task_t;
+
+enum vlc_task_priority
+{
+    VLC_TASK_PRIORITY_LOW,    /**< Background work (prefetching...) */
+    VLC_TASK_PRIORITY_NORMAL,
+    VLC_TASK_PRIORITY_HIGH,   /**< Work the playback is waiting for */
+};
+
+/**
+ * Submits a task.
+ *
+ * The task runs on a worker thread, or on the thread waiting for it if no
+ * worker has started it yet. Queued tasks of a higher priority are started
+ * first.
+ *
+ * @param run function running the task
+ * @param opaque data passed to the function
+ * @param priority a vlc_task_priority value
+ * @return the task, which must be waited for with vlc_task_Wait(),
+ *         or NULL on error (the function will not be called)
+ */
+VLC_API vlc_task_t *vlc_task_Submit(void (*run)(void *), void *opaque,
+                                    int priority) VLC_USED;
+
+/**
+ * Cancels a task which has not started yet.
+ *
+ * @return true if the task will not run, false if it has run or is running
+ * @note vlc_task_Wait() must be called in either case.
+ */
+VLC_API bool vlc_task_Cancel(vlc_task_t *);
+
+/**
+ * Waits for the end of a task, and releases it.
+ *
+ * If no worker has started the task yet, the calling thread runs it, so that
+ * a task can submit and wait for other tasks. This is not a cancellation
+ * point.
+ */
+VLC_API void vlc_task_Wait(vlc_task_t *);
+
+/**
+ * Runs a function count times in parallel, and waits for all the runs.
+ *
+ * The calling thread takes part, so the function runs on the calling thread
+ * only if the workers are busy or cannot be started.
+ *
+ * @param run function, called with the index of the run and count
+ * @param count number of runs
+ * @param priority a vlc_task_priority value
+ */
+VLC_API void vlc_task_Parallel(void (*run)(void *, unsigned, unsigned),
+                               void *opaque, unsigned count, int priority);
+
+/**
+ * Number of worker threads of the pool (at least one).
+ */
+VLC_API unsigned vlc_threadpool_Size(void) VLC_USED;
+
+/** @} */
+#endif
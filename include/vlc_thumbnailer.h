@@ -0,0 +1,77 @@
+/*****************************************************************************
+ * vlc_thumbnailer.h: single picture extraction
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_THUMBNAILER_H
+#define VLC_THUMBNAILER_H 1
+
+/**
+ * \file
+ * This file defines the thumbnailer, which extracts one picture from a media
+ * without any playback (no input thread, no video or audio output).
+ */
+
+#include <vlc_picture.h>
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+typedef struct vlc_thumbnailer_t vlc_thumbnailer_t;
+
+/**
+ * Creates a thumbnailer.
+ *
+ * The video decoder (and packetizer) are kept from one request to the next,
+ * as long as the video format does not change: reusing the same thumbnailer
+ * for a batch of similar files saves their initialization.
+ * A thumbnailer handles one request at a time.
+ */
+VLC_API vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t * ) VLC_USED;
+#define vlc_thumbnailer_Create( a ) vlc_thumbnailer_Create( VLC_OBJECT(a) )
+
+VLC_API void vlc_thumbnailer_Release( vlc_thumbnailer_t * );
+
+/**
+ * Extracts a picture from the first video track of a media.
+ *
+ * The demuxer seeks to the nearest key frame before the requested time or
+ * position, if it can, and the first picture decoded from there is returned.
+ *
+ * \param psz_mrl media to open
+ * \param i_time time to seek to, or a negative value to use f_pos
+ * \param f_pos position to seek to (0.0 - 1.0), if i_time is negative
+ * \param p_fmt requested format of the picture: a zero width or height
+ * preserves the aspect ratio, both zero keep the original size, a zero
+ * chroma keeps the decoder one. On success, this is set to the format of
+ * the returned picture.
+ * \param i_timeout maximum time spent in the request, or 0 for no limit
+ * \return a picture (to be released with picture_Release()) or NULL
+ */
+VLC_API picture_t *vlc_thumbnailer_Request( vlc_thumbnailer_t *,
+                                            const char *psz_mrl,
+                                            mtime_t i_time, float f_pos,
+                                            video_format_t *p_fmt,
+                                            mtime_t i_timeout ) VLC_USED;
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif
@@ -91,6 +91,11 @@ struct video_splitter_t
     int                     i_output;
     video_splitter_output_t *p_output;
 
+    /* Set in the open() function when pf_filter returns pictures which
+     * reference the source picture, instead of pictures from pf_picture_new.
+     * The owner then copies them where its outputs need it. */
+    bool                    b_source_ref;
+
     int             (*pf_filter)( video_splitter_t *, picture_t *pp_dst[],
                                   picture_t *p_src );
     int             (*pf_mouse) ( video_splitter_t *, vlc_mouse_t *,
@@ -0,0 +1,134 @@
+/*****************************************************************************
+ * compositor.c: libvlc new API tiled players
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc/libvlc.h>
+#include <vlc/libvlc_media.h>
+#include <vlc/libvlc_media_player.h>
+#include <vlc/libvlc_compositor.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+
+#include "libvlc_internal.h"
+#include "media_player_internal.h"
+
+/*
+ * The compositor is built on the mosaic: each tile streams its video to the
+ * mosaic-bridge stream output, which decodes it in the tile input, and the
+ * mosaic sub source of the display player blends all the bridged pictures
+ * in its only video output. The bridge is global to the LibVLC instance.
+ */
+
+struct libvlc_compositor_t
+{
+    libvlc_instance_t     *p_libvlc_instance;
+    libvlc_media_player_t *p_display;
+    atomic_uint            i_tiles; /**< Used to name the tiles */
+};
+
+libvlc_compositor_t *libvlc_compositor_new( libvlc_instance_t *p_instance,
+                                            unsigned i_width,
+                                            unsigned i_height )
+{
+    libvlc_compositor_t *p_compositor = malloc( sizeof( *p_compositor ) );
+    if( unlikely(p_compositor == NULL) )
+    {
+        libvlc_printerr( "Not enough memory" );
+        return NULL;
+    }
+
+    libvlc_media_player_t *p_display = libvlc_media_player_new( p_instance );
+    if( p_display == NULL )
+    {
+        free( p_compositor );
+        return NULL;
+    }
+
+    /* Inherited by the video output of the display, and its mosaic */
+    var_Create( p_display, "sub-source", VLC_VAR_STRING );
+    var_SetString( p_display, "sub-source", "mosaic" );
+    var_Create( p_display, "mosaic-width", VLC_VAR_INTEGER );
+    var_SetInteger( p_display, "mosaic-width", i_width );
+    var_Create( p_display, "mosaic-height", VLC_VAR_INTEGER );
+    var_SetInteger( p_display, "mosaic-height", i_height );
+    var_Create( p_display, "mosaic-position", VLC_VAR_INTEGER );
+    var_SetInteger( p_display, "mosaic-position", 0 /* automatic grid */ );
+    var_Create( p_display, "mosaic-keep-aspect-ratio", VLC_VAR_BOOL );
+    var_SetBool( p_display, "mosaic-keep-aspect-ratio", true );
+
+    p_compositor->p_display = p_display;
+    atomic_init( &p_compositor->i_tiles, 0 );
+    p_compositor->p_libvlc_instance = p_instance;
+    libvlc_retain( p_instance );
+    return p_compositor;
+}
+
+void libvlc_compositor_release( libvlc_compositor_t *p_compositor )
+{
+    libvlc_media_player_release( p_compositor->p_display );
+    libvlc_release( p_compositor->p_libvlc_instance );
+    free( p_compositor );
+}
+
+libvlc_media_player_t *
+libvlc_compositor_get_display( libvlc_compositor_t *p_compositor )
+{
+    libvlc_media_player_retain( p_compositor->p_display );
+    return p_compositor->p_display;
+}
+
+libvlc_media_player_t *
+libvlc_compositor_new_tile( libvlc_compositor_t *p_compositor )
+{
+    char *psz_sout;
+    unsigned i_tile = atomic_fetch_add( &p_compositor->i_tiles, 1 );
+
+    if( asprintf( &psz_sout, "#mosaic-bridge{id=tile%u}", i_tile ) == -1 )
+    {
+        libvlc_printerr( "Not enough memory" );
+        return NULL;
+    }
+
+    libvlc_media_player_t *p_tile =
+        libvlc_media_player_new( p_compositor->p_libvlc_instance );
+    if( p_tile == NULL )
+    {
+        free( psz_sout );
+        return NULL;
+    }
+
+    /* Inherited by the input: only the video is selected, and decoded by
+     * the bridge, so there is neither video nor audio output. The stream
+     * output (and the bridge slot) is kept from one media to the next. */
+    var_Create( p_tile, "sout", VLC_VAR_STRING );
+    var_SetString( p_tile, "sout", psz_sout );
+    var_Create( p_tile, "sout-audio", VLC_VAR_BOOL );
+    var_Create( p_tile, "sout-spu", VLC_VAR_BOOL );
+    var_Create( p_tile, "sout-keep", VLC_VAR_BOOL );
+    var_SetBool( p_tile, "sout-keep", true );
+    free( psz_sout );
+    return p_tile;
+}
@@ -86,6 +86,7 @@ libvlc_event_manager_new( void * p_obj, libvlc_instance_t * p_libvlc_inst )
 
     libvlc_retain( p_libvlc_inst );
     vlc_array_init( &p_em->listeners_groups );
+    vlc_array_init( &p_em->batch_listeners );
     vlc_mutex_init( &p_em->object_lock );
     vlc_mutex_init_recursive( &p_em->event_sending_lock );
     return p_em;
@@ -102,6 +103,7 @@ void libvlc_event_manager_release( libvlc_event_manager_t * p_em )
     int i,j ;
 
     libvlc_event_async_fini(p_em);
+    libvlc_event_batch_fini(p_em);
 
     vlc_mutex_destroy( &p_em->event_sending_lock );
     vlc_mutex_destroy( &p_em->object_lock );
@@ -159,6 +161,9 @@ void libvlc_event_send( libvlc_event_manager_t * p_em,
 
     vlc_mutex_lock( &p_em->event_sending_lock );
     vlc_mutex_lock( &p_em->object_lock );
+    /* Batch listeners only queue the event, they never call back from here */
+    libvlc_event_batch_dispatch( p_em, p_event );
+
     for( i = 0; i < vlc_array_count(&p_em->listeners_groups); i++)
     {
         listeners_group = vlc_array_item_at_index(&p_em->listeners_groups, i);
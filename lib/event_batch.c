@@ -0,0 +1,260 @@
+/*****************************************************************************
+ * event_batch.c: batched and coalesced libvlc events
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+
+#include <vlc/libvlc.h>
+
+#include "libvlc_internal.h"
+#include "event_internal.h"
+
+/*
+ * A batch listener queues the events it listens to, and a one-shot timer,
+ * armed by the first queued event, hands all of them to the callback at the
+ * end of the interval. The emitter only takes the listener lock to append an
+ * event (or, when coalescing, to overwrite the previous one of the same
+ * type): it is never blocked by the callback.
+ *
+ * Two event buffers are swapped by the timer, so that the emitters fill one
+ * while the callback reads the other, and nothing is allocated once they
+ * have grown to the usual batch size.
+ */
+typedef struct
+{
+    libvlc_batch_callback_t pf_callback;
+    void                   *p_user_data;
+    mtime_t                 i_interval;
+    bool                    b_coalesce;
+
+    unsigned                i_types;
+    libvlc_event_type_t    *p_types;
+
+    vlc_timer_t             timer;
+    vlc_mutex_t             lock;
+    bool                    b_armed;
+    libvlc_event_t         *p_pending;
+    unsigned                i_pending;
+    unsigned                i_pending_max;
+    libvlc_event_t         *p_ready;
+    unsigned                i_ready_max;
+} libvlc_event_batch_listener_t;
+
+static bool batch_listens_to( const libvlc_event_batch_listener_t *p_bl,
+                              libvlc_event_type_t type )
+{
+    for( unsigned i = 0; i < p_bl->i_types; i++ )
+        if( p_bl->p_types[i] == type )
+            return true;
+    return false;
+}
+
+/**************************************************************************
+ *       batch_flush (private) :
+ *
+ * Timer callback: deliver the queued events.
+ **************************************************************************/
+static void batch_flush( void *data )
+{
+    libvlc_event_batch_listener_t *p_bl = data;
+
+    vlc_mutex_lock( &p_bl->lock );
+    libvlc_event_t *p_events = p_bl->p_pending;
+    unsigned i_events = p_bl->i_pending;
+    unsigned i_max = p_bl->i_pending_max;
+
+    p_bl->p_pending = p_bl->p_ready;
+    p_bl->i_pending_max = p_bl->i_ready_max;
+    p_bl->i_pending = 0;
+    p_bl->p_ready = p_events;
+    p_bl->i_ready_max = i_max;
+    p_bl->b_armed = false;
+    vlc_mutex_unlock( &p_bl->lock );
+
+    if( i_events > 0 )
+        p_bl->pf_callback( p_events, i_events, p_bl->p_user_data );
+}
+
+/**************************************************************************
+ *       batch_push (private) :
+ *
+ * Queue an event for a listener.
+ **************************************************************************/
+static void batch_push( libvlc_event_batch_listener_t *p_bl,
+                        const libvlc_event_t *p_event )
+{
+    vlc_mutex_lock( &p_bl->lock );
+    if( p_bl->b_coalesce )
+    {
+        for( unsigned i = 0; i < p_bl->i_pending; i++ )
+            if( p_bl->p_pending[i].type == p_event->type )
+            {
+                p_bl->p_pending[i] = *p_event;
+                goto out;
+            }
+    }
+
+    if( p_bl->i_pending >= p_bl->i_pending_max )
+    {
+        unsigned i_max = p_bl->i_pending_max ? 2 * p_bl->i_pending_max : 16;
+        libvlc_event_t *p_events = realloc( p_bl->p_pending,
+                                            i_max * sizeof( *p_events ) );
+        if( unlikely(p_events == NULL) )
+            goto out; /* drop the event */
+        p_bl->p_pending = p_events;
+        p_bl->i_pending_max = i_max;
+    }
+    p_bl->p_pending[p_bl->i_pending++] = *p_event;
+
+    if( !p_bl->b_armed )
+    {
+        vlc_timer_schedule( p_bl->timer, false, p_bl->i_interval, 0 );
+        p_bl->b_armed = true;
+    }
+out:
+    vlc_mutex_unlock( &p_bl->lock );
+}
+
+static void batch_listener_delete( libvlc_event_batch_listener_t *p_bl )
+{
+    /* Waits for the callback, if it is running */
+    vlc_timer_destroy( p_bl->timer );
+    vlc_mutex_destroy( &p_bl->lock );
+    free( p_bl->p_ready );
+    free( p_bl->p_pending );
+    free( p_bl->p_types );
+    free( p_bl );
+}
+
+/**************************************************************************
+ *       libvlc_event_batch_dispatch (internal) :
+ *
+ * Queue an event for the batch listeners. The object lock must be held.
+ **************************************************************************/
+void libvlc_event_batch_dispatch( libvlc_event_manager_t * p_em,
+                                  libvlc_event_t * p_event )
+{
+    for( int i = 0; i < vlc_array_count( &p_em->batch_listeners ); i++ )
+    {
+        libvlc_event_batch_listener_t *p_bl =
+            vlc_array_item_at_index( &p_em->batch_listeners, i );
+
+        if( batch_listens_to( p_bl, p_event->type ) )
+            batch_push( p_bl, p_event );
+    }
+}
+
+/**************************************************************************
+ *       libvlc_event_batch_fini (internal) :
+ *
+ * Release the batch listeners that were not detached.
+ **************************************************************************/
+void libvlc_event_batch_fini( libvlc_event_manager_t * p_em )
+{
+    for( int i = 0; i < vlc_array_count( &p_em->batch_listeners ); i++ )
+        batch_listener_delete( vlc_array_item_at_index( &p_em->batch_listeners,
+                                                        i ) );
+    vlc_array_clear( &p_em->batch_listeners );
+}
+
+/**************************************************************************
+ *       libvlc_event_attach_batch (public) :
+ *
+ * Add a batched callback for some events.
+ **************************************************************************/
+int libvlc_event_attach_batch( libvlc_event_manager_t * p_em,
+                               const libvlc_event_type_t * p_event_types,
+                               unsigned i_event_types,
+                               libvlc_batch_callback_t pf_callback,
+                               void *p_user_data, libvlc_time_t i_interval,
+                               unsigned i_flags )
+{
+    assert( i_event_types > 0 );
+
+    libvlc_event_batch_listener_t *p_bl = calloc( 1, sizeof( *p_bl ) );
+    if( unlikely(p_bl == NULL) )
+        return ENOMEM;
+
+    p_bl->p_types = malloc( i_event_types * sizeof( *p_bl->p_types ) );
+    if( unlikely(p_bl->p_types == NULL) )
+    {
+        free( p_bl );
+        return ENOMEM;
+    }
+    memcpy( p_bl->p_types, p_event_types,
+            i_event_types * sizeof( *p_bl->p_types ) );
+    p_bl->i_types = i_event_types;
+
+    p_bl->pf_callback = pf_callback;
+    p_bl->p_user_data = p_user_data;
+    /* A zero delay would disarm the timer */
+    p_bl->i_interval = (i_interval > 0) ? i_interval * 1000 : 1;
+    p_bl->b_coalesce = (i_flags & libvlc_event_coalesce) != 0;
+
+    if( vlc_timer_create( &p_bl->timer, batch_flush, p_bl ) )
+    {
+        free( p_bl->p_types );
+        free( p_bl );
+        return ENOMEM;
+    }
+    vlc_mutex_init( &p_bl->lock );
+
+    vlc_mutex_lock( &p_em->object_lock );
+    vlc_array_append( &p_em->batch_listeners, p_bl );
+    vlc_mutex_unlock( &p_em->object_lock );
+    return 0;
+}
+
+/**************************************************************************
+ *       libvlc_event_detach_batch (public) :
+ *
+ * Remove a batched callback.
+ **************************************************************************/
+void libvlc_event_detach_batch( libvlc_event_manager_t * p_em,
+                                libvlc_batch_callback_t pf_callback,
+                                void *p_user_data )
+{
+    libvlc_event_batch_listener_t *p_bl = NULL;
+
+    vlc_mutex_lock( &p_em->object_lock );
+    for( int i = 0; i < vlc_array_count( &p_em->batch_listeners ); i++ )
+    {
+        libvlc_event_batch_listener_t *p_cur =
+            vlc_array_item_at_index( &p_em->batch_listeners, i );
+
+        if( p_cur->pf_callback == pf_callback
+         && p_cur->p_user_data == p_user_data )
+        {
+            vlc_array_remove( &p_em->batch_listeners, i );
+            p_bl = p_cur;
+            break;
+        }
+    }
+    vlc_mutex_unlock( &p_em->object_lock );
+
+    assert( p_bl != NULL );
+    /* The emitters cannot see the listener anymore: drop what is queued */
+    if( p_bl != NULL )
+        batch_listener_delete( p_bl );
+}
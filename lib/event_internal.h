@@ -92,6 +92,7 @@ typedef struct libvlc_event_manager_t
     vlc_mutex_t object_lock;
     vlc_mutex_t event_sending_lock;
     struct libvlc_event_async_queue * async_event_queue;
+    vlc_array_t batch_listeners;
 } libvlc_event_sender_t;
 
 
@@ -110,4 +111,8 @@ void libvlc_event_async_fini(libvlc_event_manager_t * p_em);
 void libvlc_event_async_dispatch(libvlc_event_manager_t * p_em, libvlc_event_listener_t * listener, libvlc_event_t * event);
 void libvlc_event_async_ensure_listener_removal(libvlc_event_manager_t * p_em, libvlc_event_listener_t * listener);
 
+/* event_batch.c */
+void libvlc_event_batch_fini(libvlc_event_manager_t * p_em);
+void libvlc_event_batch_dispatch(libvlc_event_manager_t * p_em, libvlc_event_t * event);
+
 #endif
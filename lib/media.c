@@ -647,6 +647,37 @@ int libvlc_media_get_stats( libvlc_media_t *p_md,
     return true;
 }
 
+int libvlc_media_get_pipeline_stats( libvlc_media_t *p_md,
+                                     libvlc_media_pipeline_stats_t *p_stats )
+{
+    static_assert( LIBVLC_LATENCY_STAGES == INPUT_LATENCY_STAGES
+                && LIBVLC_LATENCY_BUCKETS == INPUT_LATENCY_BUCKETS,
+                   "Mismatched latency histograms" );
+
+    if( !p_md->p_input_item )
+        return false;
+
+    input_stats_t *p_itm_stats = p_md->p_input_item->p_stats;
+    vlc_mutex_lock( &p_itm_stats->lock );
+    for( unsigned i = 0; i < LIBVLC_LATENCY_STAGES; i++ )
+    {
+        const input_latency_histogram_t *p_in = &p_itm_stats->latency[i];
+        libvlc_media_latency_t *p_out = &p_stats->latency[i];
+
+        p_out->i_count = p_in->i_count;
+        p_out->i_total = p_in->i_total;
+        p_out->i_max = p_in->i_max;
+        memcpy( p_out->pi_buckets, p_in->pi_buckets,
+                sizeof( p_out->pi_buckets ) );
+    }
+    p_stats->i_video_queue_blocks = p_itm_stats->i_video_fifo_blocks;
+    p_stats->i_video_queue_bytes = p_itm_stats->i_video_fifo_bytes;
+    p_stats->i_audio_queue_blocks = p_itm_stats->i_audio_fifo_blocks;
+    p_stats->i_audio_queue_bytes = p_itm_stats->i_audio_fifo_bytes;
+    vlc_mutex_unlock( &p_itm_stats->lock );
+    return true;
+}
+
 /**************************************************************************
  * event_manager
  **************************************************************************/
@@ -148,6 +148,57 @@ static void release_input_thread( libvlc_media_player_t *p_mi, bool b_input_abor
     input_Close( p_input_thread );
 }
 
+/*
+ * Remove a standby input from the list, and return it.
+ *
+ * Input lock is held or instance is being destroyed.
+ */
+static input_thread_t *remove_standby( libvlc_media_player_t *p_mi,
+                                       unsigned i )
+{
+    assert( i < p_mi->input.i_standby );
+
+    input_thread_t *p_input_thread = p_mi->input.standby[i].p_thread;
+    libvlc_media_release( p_mi->input.standby[i].p_md );
+
+    p_mi->input.i_standby--;
+    memmove( &p_mi->input.standby[i], &p_mi->input.standby[i + 1],
+             (p_mi->input.i_standby - i) * sizeof(p_mi->input.standby[0]) );
+    return p_input_thread;
+}
+
+static void release_standby( libvlc_media_player_t *p_mi, unsigned i )
+{
+    input_thread_t *p_input_thread = remove_standby( p_mi, i );
+
+    input_Stop( p_input_thread, true );
+    input_Close( p_input_thread );
+}
+
+/*
+ * Take the standby input of a media, if it is still usable.
+ *
+ * Input lock is held.
+ */
+static input_thread_t *take_standby( libvlc_media_player_t *p_mi,
+                                     libvlc_media_t *p_md )
+{
+    for( unsigned i = 0; i < p_mi->input.i_standby; i++ )
+    {
+        if( p_mi->input.standby[i].p_md != p_md )
+            continue;
+
+        int i_state = var_GetInteger( p_mi->input.standby[i].p_thread, "state" );
+        if( i_state == ERROR_S || i_state == END_S )
+        {
+            release_standby( p_mi, i );
+            return NULL;
+        }
+        return remove_standby( p_mi, i );
+    }
+    return NULL;
+}
+
 /*
  * Retrieve the input thread. Be sure to release the object
  * once you are done with it. (libvlc Internal)
@@ -502,6 +553,10 @@ libvlc_media_player_new( libvlc_instance_t *instance )
     var_Create (mp, "vmem-data", VLC_VAR_ADDRESS);
     var_Create (mp, "vmem-setup", VLC_VAR_ADDRESS);
     var_Create (mp, "vmem-cleanup", VLC_VAR_ADDRESS);
+    var_Create (mp, "vmem-alloc", VLC_VAR_ADDRESS);
+    var_Create (mp, "vmem-free", VLC_VAR_ADDRESS);
+    var_Create (mp, "vmem-present", VLC_VAR_ADDRESS);
+    var_Create (mp, "vmem-direct", VLC_VAR_BOOL);
     var_Create (mp, "vmem-chroma", VLC_VAR_STRING | VLC_VAR_DOINHERIT);
     var_Create (mp, "vmem-width", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
     var_Create (mp, "vmem-height", VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
@@ -589,6 +644,7 @@ libvlc_media_player_new( libvlc_instance_t *instance )
     mp->state = libvlc_NothingSpecial;
     mp->p_libvlc_instance = instance;
     mp->input.p_thread = NULL;
+    mp->input.i_standby = 0;
     mp->input.p_resource = input_resource_New(VLC_OBJECT(mp));
     if (unlikely(mp->input.p_resource == NULL))
     {
@@ -686,6 +742,8 @@ static void libvlc_media_player_destroy( libvlc_media_player_t *p_mi )
     /* No need for lock_input() because no other threads knows us anymore */
     if( p_mi->input.p_thread )
         release_input_thread(p_mi, true);
+    while( p_mi->input.i_standby > 0 )
+        release_standby( p_mi, 0 );
     input_resource_Terminate( p_mi->input.p_resource );
     input_resource_Release( p_mi->input.p_resource );
     vlc_mutex_destroy( &p_mi->input.lock );
@@ -852,8 +910,11 @@ int libvlc_media_player_play( libvlc_media_player_t *p_mi )
         return -1;
     }
 
-    p_input_thread = input_Create( p_mi, p_mi->p_md->p_input_item, NULL,
-                                   p_mi->input.p_resource );
+    p_input_thread = take_standby( p_mi, p_mi->p_md );
+    const bool b_standby = p_input_thread != NULL;
+    if( !b_standby )
+        p_input_thread = input_Create( p_mi, p_mi->p_md->p_input_item, NULL,
+                                       p_mi->input.p_resource );
     unlock(p_mi);
     if( !p_input_thread )
     {
@@ -868,7 +929,9 @@ int libvlc_media_player_play( libvlc_media_player_t *p_mi )
     var_AddCallback( p_input_thread, "intf-event", input_event_changed, p_mi );
     add_es_callbacks( p_input_thread, p_mi );
 
-    if( input_Start( p_input_thread ) )
+    if( b_standby )
+        input_Control( p_input_thread, INPUT_LEAVE_STANDBY );
+    else if( input_Start( p_input_thread ) )
     {
         unlock_input(p_mi);
         del_es_callbacks( p_input_thread, p_mi );
@@ -885,6 +948,61 @@ int libvlc_media_player_play( libvlc_media_player_t *p_mi )
     return 0;
 }
 
+int libvlc_media_player_add_standby( libvlc_media_player_t *p_mi,
+                                     libvlc_media_t *p_md )
+{
+    char *psz_sout = var_InheritString( p_mi, "sout" );
+    free( psz_sout );
+    if( psz_sout != NULL )
+    {
+        libvlc_printerr( "Standby is not supported with stream output" );
+        return -1;
+    }
+
+    lock_input( p_mi );
+    for( unsigned i = 0; i < p_mi->input.i_standby; i++ )
+        if( p_mi->input.standby[i].p_md == p_md )
+        {
+            unlock_input( p_mi );
+            return 0;
+        }
+
+    input_thread_t *p_input_thread =
+        input_CreateStandby( p_mi, p_md->p_input_item, NULL,
+                             p_mi->input.p_resource );
+    if( !p_input_thread )
+    {
+        unlock_input( p_mi );
+        libvlc_printerr( "Not enough memory" );
+        return -1;
+    }
+    if( input_Start( p_input_thread ) )
+    {
+        unlock_input( p_mi );
+        vlc_object_release( p_input_thread );
+        libvlc_printerr( "Input initialization failure" );
+        return -1;
+    }
+
+    if( p_mi->input.i_standby == ARRAY_SIZE(p_mi->input.standby) )
+        release_standby( p_mi, 0 );
+
+    libvlc_media_retain( p_md );
+    p_mi->input.standby[p_mi->input.i_standby].p_md = p_md;
+    p_mi->input.standby[p_mi->input.i_standby].p_thread = p_input_thread;
+    p_mi->input.i_standby++;
+    unlock_input( p_mi );
+    return 0;
+}
+
+void libvlc_media_player_clear_standby( libvlc_media_player_t *p_mi )
+{
+    lock_input( p_mi );
+    while( p_mi->input.i_standby > 0 )
+        release_standby( p_mi, 0 );
+    unlock_input( p_mi );
+}
+
 void libvlc_media_player_set_pause( libvlc_media_player_t *p_mi, int paused )
 {
     input_thread_t * p_input_thread = libvlc_get_input_thread( p_mi );
@@ -974,6 +1092,26 @@ void libvlc_video_set_callbacks( libvlc_media_player_t *mp,
     var_SetString( mp, "avcodec-hw", "none" );
 }
 
+void libvlc_video_set_async_callbacks( libvlc_media_player_t *mp,
+    void *(*alloc_cb) (void *, void **),
+    void (*free_cb) (void *, void *),
+    void (*present_cb) (void *, void *, void *const *, libvlc_video_frame_t *),
+    bool direct, void *opaque )
+{
+    var_SetAddress( mp, "vmem-alloc", alloc_cb );
+    var_SetAddress( mp, "vmem-free", free_cb );
+    var_SetAddress( mp, "vmem-present", present_cb );
+    var_SetBool( mp, "vmem-direct", direct );
+    var_SetAddress( mp, "vmem-data", opaque );
+    var_SetString( mp, "vout", "vmem" );
+    var_SetString( mp, "avcodec-hw", "none" );
+}
+
+void libvlc_video_frame_release( libvlc_video_frame_t *frame )
+{
+    picture_Release( (picture_t *)frame );
+}
+
 void libvlc_video_set_format_callbacks( libvlc_media_player_t *mp,
                                         libvlc_video_format_cb setup,
                                         libvlc_video_cleanup_cb cleanup )
@@ -47,6 +47,13 @@ struct libvlc_media_player_t
     {
         input_thread_t   *p_thread;
         input_resource_t *p_resource;
+        /* Inputs opened ahead, see libvlc_media_player_add_standby() */
+        struct
+        {
+            libvlc_media_t *p_md;
+            input_thread_t *p_thread;
+        } standby[4];
+        unsigned          i_standby;
         vlc_mutex_t       lock;
     } input;
 
@@ -0,0 +1,247 @@
+/*****************************************************************************
+ * shm.c: libvlc new API shared memory reader functions
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
+
+#include <vlc/libvlc.h>
+#include <vlc/libvlc_media.h>
+#include <vlc/libvlc_shm.h>
+
+#include <vlc_common.h>
+#include <vlc_es.h>
+#include <vlc_fs.h>
+#include <vlc_shm_ring.h>
+
+#include "libvlc_internal.h"
+
+struct libvlc_shm_reader_t
+{
+    shm_ring_header_t *p_ring;
+    size_t             i_length; /**< of the mapping */
+    uint64_t           i_next; /**< next frame to read */
+    uint64_t           i_lost;
+    uint64_t           i_seq; /**< of the peeked frame, 0 if none */
+};
+
+libvlc_shm_reader_t *libvlc_shm_reader_open( const char *psz_path )
+{
+#ifdef HAVE_MMAP
+    int fd = vlc_open( psz_path, O_RDONLY );
+    if( fd == -1 )
+    {
+        libvlc_printerr( "Cannot open %s: %s", psz_path,
+                         vlc_strerror_c(errno) );
+        return NULL;
+    }
+
+    struct stat st;
+    if( fstat( fd, &st ) || (uint64_t)st.st_size < shm_ring_HeaderSize() )
+    {
+        libvlc_printerr( "%s is not a shared memory ring", psz_path );
+        close( fd );
+        return NULL;
+    }
+
+    void *p_map = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if( p_map == MAP_FAILED )
+    {
+        libvlc_printerr( "Cannot map %s: %s", psz_path,
+                         vlc_strerror_c(errno) );
+        return NULL;
+    }
+
+    shm_ring_header_t *p_ring = p_map;
+    if( memcmp( p_ring->magic, SHM_RING_MAGIC, sizeof( SHM_RING_MAGIC ) )
+     || p_ring->version != SHM_RING_VERSION || p_ring->slot_count == 0
+     || p_ring->slot_size <= shm_ring_PayloadOffset()
+     || p_ring->slot_size > ( (uint64_t)st.st_size - shm_ring_HeaderSize() )
+                            / p_ring->slot_count )
+    {
+        libvlc_printerr( "%s is not a shared memory ring of this version",
+                         psz_path );
+        munmap( p_map, st.st_size );
+        return NULL;
+    }
+    atomic_thread_fence( memory_order_acquire );
+
+    libvlc_shm_reader_t *p_reader = malloc( sizeof( *p_reader ) );
+    if( unlikely(p_reader == NULL) )
+    {
+        libvlc_printerr( "Not enough memory" );
+        munmap( p_map, st.st_size );
+        return NULL;
+    }
+
+    const uint64_t i_written = atomic_load_explicit( &p_ring->written,
+                                                     memory_order_acquire );
+    p_reader->p_ring = p_ring;
+    p_reader->i_length = st.st_size;
+    p_reader->i_next = i_written > 0 ? i_written - 1 : 0;
+    p_reader->i_lost = 0;
+    p_reader->i_seq = 0;
+    return p_reader;
+#else
+    VLC_UNUSED( psz_path );
+    libvlc_printerr( "Shared memory is not supported on this system" );
+    return NULL;
+#endif
+}
+
+void libvlc_shm_reader_close( libvlc_shm_reader_t *p_reader )
+{
+#ifdef HAVE_MMAP
+    munmap( p_reader->p_ring, p_reader->i_length );
+#endif
+    free( p_reader );
+}
+
+int libvlc_shm_reader_is_live( libvlc_shm_reader_t *p_reader )
+{
+    return atomic_load( &p_reader->p_ring->state ) == SHM_RING_LIVE;
+}
+
+const void *libvlc_shm_reader_peek( libvlc_shm_reader_t *p_reader,
+                                    libvlc_shm_frame_t *p_frame )
+{
+    shm_ring_header_t *p_ring = p_reader->p_ring;
+
+    p_reader->i_seq = 0;
+    for( ;; )
+    {
+        const uint64_t i_written = atomic_load_explicit( &p_ring->written,
+                                                         memory_order_acquire );
+        if( p_reader->i_next >= i_written )
+            return NULL;
+
+        /* Lapped: skip to the oldest frame not being overwritten */
+        if( i_written - p_reader->i_next >= p_ring->slot_count )
+        {
+            const uint64_t i_oldest = i_written - p_ring->slot_count + 1;
+            p_reader->i_lost += i_oldest - p_reader->i_next;
+            p_reader->i_next = i_oldest;
+        }
+
+        shm_ring_slot_t *p_slot = shm_ring_Slot( p_ring, p_reader->i_next );
+        const uint64_t i_seq = atomic_load_explicit( &p_slot->seq,
+                                                     memory_order_acquire );
+        if( i_seq != 2 * p_reader->i_next + 2 )
+        {
+            /* Overwritten since the count was read */
+            p_reader->i_lost++;
+            p_reader->i_next++;
+            continue;
+        }
+
+        p_frame->i_id = p_slot->es_id;
+        p_frame->i_codec = p_slot->codec;
+        p_frame->i_pts = p_slot->pts;
+        p_frame->i_duration = p_slot->length;
+        if( p_slot->cat == VIDEO_ES )
+        {
+            p_frame->i_type = libvlc_track_video;
+            p_frame->u.video.i_width = p_slot->video.width;
+            p_frame->u.video.i_height = p_slot->video.height;
+            p_frame->u.video.i_visible_width = p_slot->video.visible_width;
+            p_frame->u.video.i_visible_height = p_slot->video.visible_height;
+            p_frame->u.video.i_frame_rate = p_slot->video.frame_rate;
+            p_frame->u.video.i_frame_rate_base =
+                p_slot->video.frame_rate_base;
+        }
+        else
+        {
+            p_frame->i_type = libvlc_track_audio;
+            p_frame->u.audio.i_rate = p_slot->audio.rate;
+            p_frame->u.audio.i_channels = p_slot->audio.channels;
+            p_frame->u.audio.i_bits_per_sample =
+                p_slot->audio.bits_per_sample;
+        }
+        /* A torn size is caught on release, it must only not overflow */
+        p_frame->i_size = __MIN( p_slot->size,
+                                 p_ring->slot_size - shm_ring_PayloadOffset() );
+        p_frame->i_lost = p_reader->i_lost;
+
+        p_reader->i_seq = i_seq;
+        return shm_ring_Payload( p_slot );
+    }
+}
+
+int libvlc_shm_reader_release( libvlc_shm_reader_t *p_reader )
+{
+    if( p_reader->i_seq == 0 )
+        return 0;
+
+    shm_ring_slot_t *p_slot = shm_ring_Slot( p_reader->p_ring,
+                                             p_reader->i_next );
+
+    /* The frame was read before checking it was not overwritten */
+    atomic_thread_fence( memory_order_acquire );
+    const bool b_intact = atomic_load_explicit( &p_slot->seq,
+                                   memory_order_relaxed ) == p_reader->i_seq;
+    if( !b_intact )
+        p_reader->i_lost++;
+    p_reader->i_next++;
+    p_reader->i_seq = 0;
+    return b_intact;
+}
+
+int libvlc_shm_reader_read( libvlc_shm_reader_t *p_reader,
+                            libvlc_shm_frame_t *p_frame,
+                            void *p_buf, size_t i_buf )
+{
+    for( ;; )
+    {
+        /* Checked first, not to miss the last frames */
+        const bool b_live = libvlc_shm_reader_is_live( p_reader );
+        const void *p_data = libvlc_shm_reader_peek( p_reader, p_frame );
+        if( p_data == NULL )
+            return b_live ? 0 : -2;
+
+        if( p_frame->i_size > i_buf )
+        {
+            /* Left for the next call, unless it was a torn size */
+            p_reader->i_seq = 0;
+            shm_ring_slot_t *p_slot = shm_ring_Slot( p_reader->p_ring,
+                                                     p_reader->i_next );
+            atomic_thread_fence( memory_order_acquire );
+            if( atomic_load_explicit( &p_slot->seq, memory_order_relaxed )
+                                                    == 2 * p_reader->i_next + 2 )
+                return -1;
+            continue;
+        }
+
+        memcpy( p_buf, p_data, p_frame->i_size );
+        if( libvlc_shm_reader_release( p_reader ) )
+        {
+            p_frame->i_lost = p_reader->i_lost;
+            return 1;
+        }
+    }
+}
@@ -0,0 +1,152 @@
+/*****************************************************************************
+ * thumbnailer.c: libvlc new API thumbnailer functions
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc/libvlc.h>
+#include <vlc/libvlc_media.h>
+#include <vlc/libvlc_thumbnailer.h>
+
+#include <vlc_common.h>
+#include <vlc_image.h>
+#include <vlc_input_item.h>
+#include <vlc_thumbnailer.h>
+
+#include "libvlc_internal.h"
+#include "media_internal.h"
+
+struct libvlc_thumbnailer_t
+{
+    libvlc_instance_t *p_libvlc_instance;
+    vlc_mutex_t        lock; /**< Serializes the requests */
+    vlc_thumbnailer_t *p_thumb;
+    image_handler_t   *p_image;
+};
+
+libvlc_thumbnailer_t *libvlc_thumbnailer_new( libvlc_instance_t *p_instance )
+{
+    libvlc_thumbnailer_t *p_thumbnailer = malloc( sizeof( *p_thumbnailer ) );
+    if( unlikely(p_thumbnailer == NULL) )
+    {
+        libvlc_printerr( "Not enough memory" );
+        return NULL;
+    }
+
+    p_thumbnailer->p_thumb =
+        vlc_thumbnailer_Create( p_instance->p_libvlc_int );
+    p_thumbnailer->p_image = image_HandlerCreate( p_instance->p_libvlc_int );
+    if( p_thumbnailer->p_thumb == NULL || p_thumbnailer->p_image == NULL )
+    {
+        if( p_thumbnailer->p_thumb != NULL )
+            vlc_thumbnailer_Release( p_thumbnailer->p_thumb );
+        if( p_thumbnailer->p_image != NULL )
+            image_HandlerDelete( p_thumbnailer->p_image );
+        free( p_thumbnailer );
+        libvlc_printerr( "Not enough memory" );
+        return NULL;
+    }
+
+    vlc_mutex_init( &p_thumbnailer->lock );
+    p_thumbnailer->p_libvlc_instance = p_instance;
+    libvlc_retain( p_instance );
+    return p_thumbnailer;
+}
+
+void libvlc_thumbnailer_release( libvlc_thumbnailer_t *p_thumbnailer )
+{
+    vlc_thumbnailer_Release( p_thumbnailer->p_thumb );
+    image_HandlerDelete( p_thumbnailer->p_image );
+    vlc_mutex_destroy( &p_thumbnailer->lock );
+    libvlc_release( p_thumbnailer->p_libvlc_instance );
+    free( p_thumbnailer );
+}
+
+static int Take( libvlc_thumbnailer_t *p_thumbnailer, libvlc_media_t *p_md,
+                 mtime_t i_time, float f_pos, unsigned i_width,
+                 unsigned i_height, libvlc_time_t i_timeout,
+                 const char *psz_filepath )
+{
+    assert( psz_filepath );
+
+    char *psz_uri = input_item_GetURI( p_md->p_input_item );
+    if( psz_uri == NULL )
+    {
+        libvlc_printerr( "Media has no location" );
+        return -1;
+    }
+
+    video_format_t fmt;
+    video_format_Init( &fmt, 0 );
+    fmt.i_width = i_width;
+    fmt.i_height = i_height;
+
+    int i_ret = -1;
+
+    vlc_mutex_lock( &p_thumbnailer->lock );
+    picture_t *p_pic = vlc_thumbnailer_Request( p_thumbnailer->p_thumb,
+                                                psz_uri, i_time, f_pos, &fmt,
+                                                i_timeout * 1000 );
+    if( p_pic != NULL )
+    {
+        /* The picture is already at the requested size */
+        video_format_t fmt_out;
+        video_format_Init( &fmt_out, 0 );
+        fmt_out.i_width = fmt.i_visible_width;
+        fmt_out.i_height = fmt.i_visible_height;
+
+        if( image_WriteUrl( p_thumbnailer->p_image, p_pic, &fmt, &fmt_out,
+                            psz_filepath ) == VLC_SUCCESS )
+            i_ret = 0;
+        else
+            libvlc_printerr( "Cannot write the thumbnail to %s",
+                             psz_filepath );
+        picture_Release( p_pic );
+    }
+    else
+        libvlc_printerr( "Cannot take a thumbnail of %s", psz_uri );
+    vlc_mutex_unlock( &p_thumbnailer->lock );
+
+    free( psz_uri );
+    return i_ret;
+}
+
+int libvlc_thumbnailer_take( libvlc_thumbnailer_t *p_thumbnailer,
+                             libvlc_media_t *p_md, libvlc_time_t i_time,
+                             unsigned i_width, unsigned i_height,
+                             libvlc_time_t i_timeout,
+                             const char *psz_filepath )
+{
+    return Take( p_thumbnailer, p_md, (i_time > 0) ? i_time * 1000 : 0, 0.f,
+                 i_width, i_height, i_timeout, psz_filepath );
+}
+
+int libvlc_thumbnailer_take_at_position( libvlc_thumbnailer_t *p_thumbnailer,
+                                         libvlc_media_t *p_md, float f_pos,
+                                         unsigned i_width, unsigned i_height,
+                                         libvlc_time_t i_timeout,
+                                         const char *psz_filepath )
+{
+    return Take( p_thumbnailer, p_md, -1, f_pos, i_width, i_height,
+                 i_timeout, psz_filepath );
+}
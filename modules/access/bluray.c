@@ -116,6 +116,14 @@ typedef struct bluray_overlay_t
     subpicture_t        *p_pic;
     OverlayStatus       status;
     subpicture_region_t *p_regions;
+
+    /* ARGB (BD-J) plane: the pictures of the regions are shared with the
+     * vout. While it uses the front one, the drawings go to the back one,
+     * which only lacks the rectangle drawn before the last swap. */
+    picture_t           *p_back;
+    struct {
+        int i_x, i_y, i_width, i_height;
+    } back_dirty;
 } bluray_overlay_t;
 
 struct  demux_sys_t
@@ -680,12 +688,15 @@ static int subpictureUpdaterValidate(subpicture_t *p_subpic,
     return res;
 }
 
-/* This should probably be moved to subpictures.c afterward */
+/* This should probably be moved to subpictures.c afterward.
+ * The picture is shared, not copied: it is not drawn into anymore while the
+ * clone holds it (see blurayDrawOverlay and blurayDrawArgbOverlay). */
 static subpicture_region_t* subpicture_region_Clone(subpicture_region_t *p_region_src)
 {
     if (!p_region_src)
         return NULL;
-    subpicture_region_t *p_region_dst = subpicture_region_New(&p_region_src->fmt);
+    subpicture_region_t *p_region_dst =
+        subpicture_region_NewFromPicture(&p_region_src->fmt, p_region_src->p_picture);
     if (unlikely(!p_region_dst))
         return NULL;
 
@@ -701,12 +712,6 @@ static subpicture_region_t* subpicture_region_Clone(subpicture_region_t *p_regio
         p_region_dst->p_style = text_style_Copy(p_region_dst->p_style,
                                                 p_region_src->p_style);
     }
-
-    //Palette is already copied by subpicture_region_New, we just have to duplicate p_pixels
-    for (int i = 0; i < p_region_src->p_picture->i_planes; i++)
-        memcpy(p_region_dst->p_picture->p[i].p_pixels,
-               p_region_src->p_picture->p[i].p_pixels,
-               p_region_src->p_picture->p[i].i_lines * p_region_src->p_picture->p[i].i_pitch);
     return p_region_dst;
 }
 
@@ -800,6 +805,8 @@ static void blurayCleanOverlayStruct(bluray_overlay_t *p_overlay)
      */
     vlc_mutex_destroy(&p_overlay->lock);
     subpicture_region_ChainDelete(p_overlay->p_regions);
+    if (p_overlay->p_back)
+        picture_Release(p_overlay->p_back);
     free(p_overlay);
 }
 
@@ -924,6 +931,10 @@ static void blurayClearOverlay(demux_t *p_demux, int plane)
 
     subpicture_region_ChainDelete(ov->p_regions);
     ov->p_regions = NULL;
+    if (ov->p_back) {
+        picture_Release(ov->p_back);
+        ov->p_back = NULL;
+    }
     ov->status = Outdated;
 
     vlc_mutex_unlock(&ov->lock);
@@ -964,6 +975,10 @@ static void blurayDrawOverlay(demux_t *p_demux, const BD_OVERLAY* const ov)
         video_format_Setup(&fmt, VLC_CODEC_YUVP, ov->w, ov->h, ov->w, ov->h, 1, 1);
 
         p_reg = subpicture_region_New(&fmt);
+        if (unlikely(p_reg == NULL)) {
+            vlc_mutex_unlock(&p_sys->p_overlays[ov->plane]->lock);
+            return;
+        }
         p_reg->i_x = ov->x;
         p_reg->i_y = ov->y;
         /* Append it to our list. */
@@ -971,6 +986,16 @@ static void blurayDrawOverlay(demux_t *p_demux, const BD_OVERLAY* const ov)
             p_last->p_next = p_reg;
         else /* If we don't have a last region, then our list empty */
             p_sys->p_overlays[ov->plane]->p_regions = p_reg;
+    } else if (picture_IsReferenced(p_reg->p_picture)) {
+        /* The vout still uses the picture: the whole region is redrawn,
+         * into a new one */
+        picture_t *p_pic = picture_NewFromFormat(&p_reg->fmt);
+        if (unlikely(p_pic == NULL)) {
+            vlc_mutex_unlock(&p_sys->p_overlays[ov->plane]->lock);
+            return;
+        }
+        picture_Release(p_reg->p_picture);
+        p_reg->p_picture = p_pic;
     }
 
     /* Now we can update the region, regardless it's an update or an insert */
@@ -1055,6 +1080,70 @@ static void blurayInitArgbOverlay(demux_t *p_demux, int plane, int width, int he
     }
 }
 
+static void blurayCopyArgbRect(picture_t *p_dst, const picture_t *p_src,
+                               int x, int y, int w, int h)
+{
+    const plane_t *src = &p_src->p[0];
+    plane_t *dst = &p_dst->p[0];
+
+    for (int i = y; i < y + h; i++)
+        memcpy(&dst->p_pixels[i * dst->i_pitch + x * 4],
+               &src->p_pixels[i * src->i_pitch + x * 4], w * 4);
+}
+
+/*
+ * Returns the picture of the ARGB region to draw the given rectangle into.
+ * Only the rectangles that changed are copied between the front and back
+ * pictures, never the whole plane, unless the vout still holds both.
+ */
+static picture_t *blurayGetArgbPicture(bluray_overlay_t *p_ov, subpicture_region_t *p_reg,
+                                       int x, int y, int w, int h)
+{
+    picture_t *p_front = p_reg->p_picture;
+
+    if (!picture_IsReferenced(p_front)) {
+        /* The back picture will lack this rectangle too */
+        if (p_ov->back_dirty.i_width > 0 && p_ov->back_dirty.i_height > 0) {
+            int right  = __MAX(x + w, p_ov->back_dirty.i_x + p_ov->back_dirty.i_width);
+            int bottom = __MAX(y + h, p_ov->back_dirty.i_y + p_ov->back_dirty.i_height);
+            p_ov->back_dirty.i_x = __MIN(x, p_ov->back_dirty.i_x);
+            p_ov->back_dirty.i_y = __MIN(y, p_ov->back_dirty.i_y);
+            p_ov->back_dirty.i_width  = right - p_ov->back_dirty.i_x;
+            p_ov->back_dirty.i_height = bottom - p_ov->back_dirty.i_y;
+        } else {
+            p_ov->back_dirty.i_x = x;
+            p_ov->back_dirty.i_y = y;
+            p_ov->back_dirty.i_width  = w;
+            p_ov->back_dirty.i_height = h;
+        }
+        return p_front;
+    }
+
+    picture_t *p_back = p_ov->p_back;
+    if (p_back != NULL && !picture_IsReferenced(p_back)) {
+        blurayCopyArgbRect(p_back, p_front,
+                           p_ov->back_dirty.i_x, p_ov->back_dirty.i_y,
+                           p_ov->back_dirty.i_width, p_ov->back_dirty.i_height);
+    } else {
+        if (p_back != NULL)
+            picture_Release(p_back);
+        p_ov->p_back = NULL;
+        p_back = picture_NewFromFormat(&p_reg->fmt);
+        if (unlikely(p_back == NULL))
+            return NULL;
+        picture_Copy(p_back, p_front);
+    }
+
+    /* Swap, the new back picture lacks the rectangle about to be drawn */
+    p_ov->p_back = p_front;
+    p_reg->p_picture = p_back;
+    p_ov->back_dirty.i_x = x;
+    p_ov->back_dirty.i_y = y;
+    p_ov->back_dirty.i_width  = w;
+    p_ov->back_dirty.i_height = h;
+    return p_back;
+}
+
 static void blurayDrawArgbOverlay(demux_t *p_demux, const BD_ARGB_OVERLAY* const ov)
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -1068,10 +1157,17 @@ static void blurayDrawArgbOverlay(demux_t *p_demux, const BD_ARGB_OVERLAY* const
         return;
     }
 
-    /* Now we can update the region */
+    picture_t *p_pic = blurayGetArgbPicture(p_sys->p_overlays[ov->plane], p_reg,
+                                            ov->x, ov->y, ov->w, ov->h);
+    if (unlikely(p_pic == NULL)) {
+        vlc_mutex_unlock(&p_sys->p_overlays[ov->plane]->lock);
+        return;
+    }
+
+    /* Now we can update the region, only the rectangle libbluray drew */
     const uint32_t *src0 = ov->argb;
-    uint8_t        *dst0 = p_reg->p_picture->p[0].p_pixels +
-                           p_reg->p_picture->p[0].i_pitch * ov->y +
+    uint8_t        *dst0 = p_pic->p[0].p_pixels +
+                           p_pic->p[0].i_pitch * ov->y +
                            ov->x * 4;
 
     for (int y = 0; y < ov->h; y++) {
@@ -1085,7 +1181,7 @@ static void blurayDrawArgbOverlay(demux_t *p_demux, const BD_ARGB_OVERLAY* const
         }
 
         src0 += ov->stride;
-        dst0 += p_reg->p_picture->p[0].i_pitch;
+        dst0 += p_pic->p[0].i_pitch;
     }
 
     vlc_mutex_unlock(&p_sys->p_overlays[ov->plane]->lock);
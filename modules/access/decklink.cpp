@@ -270,6 +270,49 @@ private:
     demux_t *demux_;
 };
 
+/* The card only has a few capture buffers: past this count of frames held
+ * downstream, the frames are copied so that the capture does not stall. */
+#define WRAPPED_FRAMES_MAX 8
+
+static atomic_uint wrapped_frames = ATOMIC_VAR_INIT(0);
+
+struct frame_block_t
+{
+    block_t self;
+    IDeckLinkVideoInputFrame *frame;
+};
+
+static void ReleaseFrameBlock(block_t *block)
+{
+    frame_block_t *fb = (frame_block_t *)block;
+
+    fb->frame->Release();
+    atomic_fetch_sub(&wrapped_frames, 1);
+    free(fb);
+}
+
+/* Wraps the captured picture as is, when its lines are not padded */
+static block_t *WrapFrame(IDeckLinkVideoInputFrame *frame, void *bytes,
+                          size_t size)
+{
+    if (atomic_fetch_add(&wrapped_frames, 1) >= WRAPPED_FRAMES_MAX) {
+        atomic_fetch_sub(&wrapped_frames, 1);
+        return NULL;
+    }
+
+    frame_block_t *fb = (frame_block_t *)malloc(sizeof (*fb));
+    if (unlikely(fb == NULL)) {
+        atomic_fetch_sub(&wrapped_frames, 1);
+        return NULL;
+    }
+
+    block_Init(&fb->self, bytes, size);
+    fb->self.pf_release = ReleaseFrameBlock;
+    fb->frame = frame;
+    frame->AddRef();
+    return &fb->self;
+}
+
 HRESULT DeckLinkCaptureDelegate::VideoInputFrameArrived(IDeckLinkVideoInputFrame* videoFrame, IDeckLinkAudioInputPacket* audioFrame)
 {
     demux_sys_t *sys = demux_->p_sys;
@@ -284,14 +327,20 @@ HRESULT DeckLinkCaptureDelegate::VideoInputFrameArrived(IDeckLinkVideoInputFrame
         const int height = videoFrame->GetHeight();
         const int stride = videoFrame->GetRowBytes();
 
+        const uint32_t *frame_bytes;
+        videoFrame->GetBytes((void**)&frame_bytes);
+
         int bpp = sys->tenbits ? 4 : 2;
-        block_t *video_frame = block_Alloc(width * height * bpp);
+        block_t *video_frame = NULL;
+        if (!sys->tenbits && stride == width * 2)
+            video_frame = WrapFrame(videoFrame, (void *)frame_bytes,
+                                    stride * height);
+        bool wrapped = video_frame != NULL;
+        if (!wrapped)
+            video_frame = block_Alloc(width * height * bpp);
         if (!video_frame)
             return S_OK;
 
-        const uint32_t *frame_bytes;
-        videoFrame->GetBytes((void**)&frame_bytes);
-
         BMDTimeValue stream_time, frame_duration;
         videoFrame->GetStreamTime(&stream_time, &frame_duration, CLOCK_FREQ);
         video_frame->i_flags = BLOCK_FLAG_TYPE_I | sys->dominance_flags;
@@ -330,7 +379,7 @@ HRESULT DeckLinkCaptureDelegate::VideoInputFrameArrived(IDeckLinkVideoInputFrame
                 }
                 vanc->Release();
             }
-        } else {
+        } else if (!wrapped) {
             for (int y = 0; y < height; ++y) {
                 const uint8_t *src = (const uint8_t *)frame_bytes + stride * y;
                 uint8_t *dst = video_frame->p_buffer + width * 2 * y;
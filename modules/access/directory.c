@@ -38,6 +38,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <assert.h>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -49,6 +50,7 @@
 
 enum
 {
+    ENTRY_UNKNOWN   = 1,
     ENTRY_DIR       = 0,
     ENTRY_ENOTDIR   = -1,
     ENTRY_EACCESS   = -2,
@@ -61,14 +63,45 @@ enum
     MODE_EXPAND,
 };
 
+/* Threads listing the subdirectories ahead of the expansion, at most */
+#define DIR_WORKERS  4
+/* Subdirectories listed ahead, at most */
+#define DIR_PREFETCH 32
+/* Minimum delay between two posts of the expanded items */
+#define DIR_POST_INTERVAL (CLOCK_FREQ / 4)
+
 typedef struct directory directory;
+typedef struct dir_listing dir_listing;
+
+typedef struct
+{
+    char        *name; /* first, so that entries sort as strings */
+    int          type;
+    dir_listing *listing; /* listed ahead, if any */
+} dir_entry;
+
+/* Contents of a directory, listed by the reading thread or by a worker */
+struct dir_listing
+{
+    dir_listing     *next; /* in the queue of the workers */
+    const directory *parent;
+    const char      *name;
+    enum { LISTING_QUEUED, LISTING_RUNNING, LISTING_DONE } state;
+
+    int              res;
+    DIR             *handle;
+    dir_entry       *entv;
+    int              entc;
+};
+
 struct directory
 {
     directory   *parent;
     DIR         *handle;
     char        *uri;
-    char       **filev;
-    int          filec, i;
+    dir_entry   *entv;
+    int          entc, i;
+    int          prefetch; /* next entry to list ahead */
 #ifdef HAVE_OPENAT
     dev_t        device;
     ino_t        inode;
@@ -83,6 +116,18 @@ struct access_sys_t
     char      *ignored_exts;
     char       mode;
     int        (*compar) (const char **a, const char **b);
+    mtime_t    next_post;
+
+    /* Workers */
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait;
+    vlc_cond_t    done;
+    dir_listing  *queue;
+    unsigned      ahead; /* listings not consumed yet */
+    unsigned      idle;
+    bool          closing;
+    unsigned      workerc;
+    vlc_thread_t  workerv[DIR_WORKERS];
 };
 
 /* Select non-hidden files only */
@@ -160,7 +205,8 @@ static bool has_inode_loop (const directory *dir, dev_t dev, ino_t inode)
 
 /* success -> returns ENTRY_DIR and the handle parameter is set to the handle,
  * error -> return ENTRY_ENOTDIR or ENTRY_EACCESS */
-static int directory_open (directory *p_dir, char *psz_entry, DIR **handle)
+static int directory_open (const directory *p_dir, const char *psz_entry,
+                           DIR **handle)
 {
     *handle = NULL;
 
@@ -201,7 +247,247 @@ static int directory_open (directory *p_dir, char *psz_entry, DIR **handle)
     return ENTRY_DIR;
 }
 
-static bool directory_push (access_sys_t *p_sys, DIR *handle, char *psz_uri)
+static void entries_free (dir_entry *entv, int entc)
+{
+    for (int i = 0; i < entc; i++)
+    {
+        assert (entv[i].listing == NULL);
+        free (entv[i].name);
+    }
+    free (entv);
+}
+
+/* Loads the visible entries of a directory. The type of the entries is
+ * taken from the directory itself when it can, not to open every entry. */
+static int entries_load (access_sys_t *p_sys, DIR *handle, dir_entry **pentv)
+{
+    dir_entry *entv = NULL;
+    int entc = 0;
+
+    rewinddir (handle);
+
+    for (int size = 0;;)
+    {
+#ifdef HAVE_OPENAT
+        errno = 0;
+        struct dirent *ent = readdir (handle);
+        if (ent == NULL)
+        {
+            if (errno)
+                goto error;
+            break;
+        }
+        const char *psz_entry = ent->d_name;
+#else
+        errno = 0;
+        const char *psz_entry = vlc_readdir (handle);
+        if (psz_entry == NULL)
+        {
+            if (errno)
+                goto error;
+            break;
+        }
+#endif
+        if (!visible (psz_entry))
+            continue;
+
+        if (entc >= size)
+        {
+            size = size ? (2 * size) : 16;
+            dir_entry *newv = realloc (entv, sizeof (*entv) * size);
+            if (unlikely(newv == NULL))
+                goto error;
+            entv = newv;
+        }
+
+        dir_entry *e = &entv[entc];
+        e->name = strdup (psz_entry);
+        if (unlikely(e->name == NULL))
+            continue;
+        e->type = ENTRY_UNKNOWN;
+        e->listing = NULL;
+#if defined (HAVE_OPENAT) && defined (DT_DIR)
+        if (ent->d_type == DT_DIR)
+            e->type = ENTRY_DIR;
+        else if (ent->d_type == DT_REG)
+            e->type = ENTRY_ENOTDIR;
+#endif
+        entc++;
+    }
+
+    if (p_sys->compar != NULL && entc > 1)
+        qsort (entv, entc, sizeof (*entv),
+               (int (*)( const void *, const void *))p_sys->compar);
+    *pentv = entv;
+    return entc;
+
+error:
+    entries_free (entv, entc);
+    *pentv = NULL;
+    return -1;
+}
+
+/* Opens and loads a subdirectory, on any thread */
+static void directory_list (access_sys_t *p_sys, dir_listing *p_list)
+{
+    p_list->res = directory_open (p_list->parent, p_list->name,
+                                  &p_list->handle);
+    if (p_list->res != ENTRY_DIR)
+        return;
+
+    /* Only the expansion needs the contents */
+    if (p_sys->mode == MODE_EXPAND)
+        p_list->entc = entries_load (p_sys, p_list->handle, &p_list->entv);
+}
+
+static dir_listing *listing_new (const directory *p_dir, const char *psz_entry)
+{
+    dir_listing *p_list = malloc (sizeof (*p_list));
+    if (unlikely(p_list == NULL))
+        return NULL;
+
+    p_list->next = NULL;
+    p_list->parent = p_dir;
+    p_list->name = psz_entry;
+    p_list->state = LISTING_RUNNING;
+    p_list->res = ENTRY_EACCESS;
+    p_list->handle = NULL;
+    p_list->entv = NULL;
+    p_list->entc = 0;
+    return p_list;
+}
+
+static void listing_free (dir_listing *p_list)
+{
+    if (p_list->handle != NULL)
+        closedir (p_list->handle);
+    entries_free (p_list->entv, p_list->entc);
+    free (p_list);
+}
+
+static void *Worker (void *data)
+{
+    access_sys_t *p_sys = data;
+
+    vlc_mutex_lock (&p_sys->lock);
+    for (;;)
+    {
+        while (!p_sys->closing && p_sys->queue == NULL)
+        {
+            p_sys->idle++;
+            vlc_cond_wait (&p_sys->wait, &p_sys->lock);
+            p_sys->idle--;
+        }
+        if (p_sys->closing)
+            break;
+
+        dir_listing *p_list = p_sys->queue;
+        p_sys->queue = p_list->next;
+        p_list->state = LISTING_RUNNING;
+        vlc_mutex_unlock (&p_sys->lock);
+
+        directory_list (p_sys, p_list);
+
+        vlc_mutex_lock (&p_sys->lock);
+        p_list->state = LISTING_DONE;
+        vlc_cond_broadcast (&p_sys->done);
+    }
+    vlc_mutex_unlock (&p_sys->lock);
+    return NULL;
+}
+
+/* Queues the listing of the next subdirectories of the current directory */
+static void directory_prefetch (access_sys_t *p_sys)
+{
+    directory *p_dir = p_sys->current;
+
+    if (p_sys->mode != MODE_EXPAND || p_dir == NULL || p_sys->closing)
+        return;
+
+    if (p_dir->prefetch < p_dir->i)
+        p_dir->prefetch = p_dir->i;
+
+    while (p_sys->ahead < DIR_PREFETCH && p_dir->prefetch < p_dir->entc)
+    {
+        dir_entry *e = &p_dir->entv[p_dir->prefetch++];
+        if (e->type != ENTRY_DIR)
+            continue;
+
+        dir_listing *p_list = listing_new (p_dir, e->name);
+        if (unlikely(p_list == NULL))
+            break;
+        p_list->state = LISTING_QUEUED;
+
+        vlc_mutex_lock (&p_sys->lock);
+        dir_listing **pp = &p_sys->queue;
+        while (*pp != NULL)
+            pp = &(*pp)->next;
+        *pp = p_list;
+
+        if (p_sys->idle > 0)
+            vlc_cond_signal (&p_sys->wait);
+        else if (p_sys->workerc < DIR_WORKERS
+              && !vlc_clone (&p_sys->workerv[p_sys->workerc], Worker, p_sys,
+                             VLC_THREAD_PRIORITY_LOW))
+            p_sys->workerc++;
+        vlc_mutex_unlock (&p_sys->lock);
+
+        e->listing = p_list;
+        p_sys->ahead++;
+    }
+}
+
+/* Takes the listing of an entry listed ahead. Returns false if it was not
+ * started yet, and is no longer queued. */
+static bool listing_take (access_sys_t *p_sys, dir_listing *p_list)
+{
+    bool b_done = true;
+
+    p_sys->ahead--;
+
+    vlc_mutex_lock (&p_sys->lock);
+    if (p_list->state == LISTING_QUEUED)
+    {
+        dir_listing **pp = &p_sys->queue;
+        while (*pp != p_list)
+            pp = &(*pp)->next;
+        *pp = p_list->next;
+        p_list->state = LISTING_RUNNING;
+        b_done = false;
+    }
+    else
+        while (p_list->state != LISTING_DONE)
+            vlc_cond_wait (&p_sys->done, &p_sys->lock);
+    vlc_mutex_unlock (&p_sys->lock);
+    return b_done;
+}
+
+/* Takes the listing of an entry, listing it now if it was not ahead */
+static dir_listing *directory_get (access_sys_t *p_sys, directory *p_dir,
+                                   dir_entry *e)
+{
+    dir_listing *p_list = e->listing;
+
+    if (p_list != NULL)
+    {
+        e->listing = NULL;
+        /* if not started yet, do not wait behind the others */
+        if (listing_take (p_sys, p_list))
+            return p_list;
+    }
+    else
+    {
+        p_list = listing_new (p_dir, e->name);
+        if (unlikely(p_list == NULL))
+            return NULL;
+    }
+
+    directory_list (p_sys, p_list);
+    return p_list;
+}
+
+static bool directory_push (access_sys_t *p_sys, DIR *handle,
+                            dir_entry *entv, int entc, char *psz_uri)
 {
     directory *p_dir = malloc (sizeof (*p_dir));
 
@@ -212,32 +498,34 @@ static bool directory_push (access_sys_t *p_sys, DIR *handle, char *psz_uri)
     p_dir->parent = p_sys->current;
     p_dir->handle = handle;
     p_dir->uri = psz_uri;
-    p_dir->filec = vlc_loaddir (handle, &p_dir->filev, visible, p_sys->compar);
-    if (p_dir->filec < 0)
-        p_dir->filev = NULL;
+    p_dir->entv = entv;
+    p_dir->entc = entc;
+    if (p_dir->entc < 0)
+    {
+        p_dir->entv = NULL;
+        p_dir->entc = 0;
+    }
     p_dir->i = 0;
+    p_dir->prefetch = 0;
 
 #ifdef HAVE_OPENAT
     struct stat st;
     if (fstat (dirfd (handle), &st))
-        goto error_filev;
+        goto error;
     p_dir->device = st.st_dev;
     p_dir->inode = st.st_ino;
 #else
     p_dir->path = make_path (psz_uri);
     if (p_dir->path == NULL)
-        goto error_filev;
+        goto error;
 #endif
 
     p_sys->current = p_dir;
+    directory_prefetch (p_sys);
     return true;
 
-error_filev:
-    for (int i = 0; i < p_dir->filec; i++)
-        free (p_dir->filev[i]);
-    free (p_dir->filev);
-
 error:
+    entries_free (entv, entc);
     closedir (handle);
     free (p_dir);
     free (psz_uri);
@@ -251,17 +539,28 @@ static bool directory_pop (access_sys_t *p_sys)
     if (p_old == NULL)
         return false;
 
+    /* Discard what was listed ahead and not used */
+    for (int i = p_old->i; i < p_old->entc; i++)
+    {
+        dir_entry *e = &p_old->entv[i];
+        if (e->listing != NULL)
+        {
+            listing_take (p_sys, e->listing);
+            listing_free (e->listing);
+            e->listing = NULL;
+        }
+    }
+
     p_sys->current = p_old->parent;
     closedir (p_old->handle);
     free (p_old->uri);
-    for (int i = 0; i < p_old->filec; i++)
-        free (p_old->filev[i]);
-    free (p_old->filev);
+    entries_free (p_old->entv, p_old->entc);
 #ifndef HAVE_OPENAT
     free (p_old->path);
 #endif
     free (p_old);
 
+    directory_prefetch (p_sys);
     return p_sys->current != NULL;
 }
 
@@ -300,6 +599,26 @@ int DirInit (access_t *p_access, DIR *handle)
         p_sys->compar = collate;
     free(psz_sort);
 
+    /* Handle mode */
+    char *psz_rec = var_InheritString (p_access, "recursive");
+    if (psz_rec == NULL || !strcasecmp (psz_rec, "none"))
+        p_sys->mode = MODE_NONE;
+    else if (!strcasecmp (psz_rec, "collapse"))
+        p_sys->mode = MODE_COLLAPSE;
+    else
+        p_sys->mode = MODE_EXPAND;
+    free (psz_rec);
+
+    vlc_mutex_init (&p_sys->lock);
+    vlc_cond_init (&p_sys->wait);
+    vlc_cond_init (&p_sys->done);
+    p_sys->queue = NULL;
+    p_sys->ahead = 0;
+    p_sys->idle = 0;
+    p_sys->closing = false;
+    p_sys->workerc = 0;
+    p_sys->next_post = 0;
+
     char *uri;
     if (!strcmp (p_access->psz_access, "fd"))
     {
@@ -311,37 +630,33 @@ int DirInit (access_t *p_access, DIR *handle)
     if (unlikely (uri == NULL))
     {
         closedir (handle);
-        goto error;
+        goto error_sys;
     }
 
     /* "Open" the base directory */
+    dir_entry *entv;
+    int entc = entries_load (p_sys, handle, &entv);
+
     p_sys->current = NULL;
-    if (!directory_push (p_sys, handle, uri))
+    if (!directory_push (p_sys, handle, entv, entc, uri))
     {
         free (uri);
-        goto error;
+        goto error_sys;
     }
     free (uri);
 
     p_access->p_sys = p_sys;
     p_sys->ignored_exts = var_InheritString (p_access, "ignore-filetypes");
 
-
-    /* Handle mode */
-    char *psz_rec = var_InheritString (p_access, "recursive");
-    if (psz_rec == NULL || !strcasecmp (psz_rec, "none"))
-        p_sys->mode = MODE_NONE;
-    else if (!strcasecmp (psz_rec, "collapse"))
-        p_sys->mode = MODE_COLLAPSE;
-    else
-        p_sys->mode = MODE_EXPAND;
-    free (psz_rec);
-
     p_access->pf_readdir = DirRead;
     p_access->pf_control = DirControl;
 
     return VLC_SUCCESS;
 
+error_sys:
+    vlc_cond_destroy (&p_sys->done);
+    vlc_cond_destroy (&p_sys->wait);
+    vlc_mutex_destroy (&p_sys->lock);
 error:
     free (p_sys);
     return VLC_EGENERIC;
@@ -355,46 +670,94 @@ void DirClose( vlc_object_t * p_this )
     access_t *p_access = (access_t*)p_this;
     access_sys_t *p_sys = p_access->p_sys;
 
+    /* Stop the workers, past their current listings */
+    vlc_mutex_lock (&p_sys->lock);
+    p_sys->closing = true;
+    vlc_cond_broadcast (&p_sys->wait);
+    vlc_mutex_unlock (&p_sys->lock);
+
     while (directory_pop (p_sys))
         ;
 
+    for (unsigned i = 0; i < p_sys->workerc; i++)
+        vlc_join (p_sys->workerv[i], NULL);
+    assert (p_sys->queue == NULL && p_sys->ahead == 0);
+
+    vlc_cond_destroy (&p_sys->done);
+    vlc_cond_destroy (&p_sys->wait);
+    vlc_mutex_destroy (&p_sys->lock);
     free (p_sys->ignored_exts);
     free (p_sys);
 }
 
 /* This function is a little bit too complex for what it seems to do, but the
  * point is to de-recursify directory recusion to avoid overruning the stack
- * in case there's a high directory depth */
+ * in case there's a high directory depth.
+ * The subdirectories are listed ahead by worker threads, and the items are
+ * posted as they are expanded, between the entries of the base directory. */
 int DirRead (access_t *p_access, input_item_node_t *p_current_node)
 {
     access_sys_t *p_sys = p_access->p_sys;
 
     while (p_sys->current != NULL
-           && p_sys->current->i <= p_sys->current->filec)
+           && p_sys->current->i <= p_sys->current->entc)
     {
         directory *p_current = p_sys->current;
 
         /* End of the current folder, let's pop directory and node */
-        if (p_current->i == p_current->filec)
+        if (p_current->i == p_current->entc)
         {
             directory_pop (p_sys);
             p_current_node = p_current_node->p_parent;
             continue;
         }
 
-        char *psz_entry = p_current->filev[p_current->i++];
+        /* Post the items of the entries of the base directory done so far */
+        if (p_current->parent == NULL && p_sys->mode == MODE_EXPAND)
+        {
+            mtime_t now = mdate ();
+
+            if (p_sys->next_post == 0)
+                p_sys->next_post = now + DIR_POST_INTERVAL;
+            else if (now >= p_sys->next_post)
+            {
+                input_item_node_PostPartial (p_current_node);
+                p_sys->next_post = now + DIR_POST_INTERVAL;
+            }
+        }
+
+        dir_entry *p_entry = &p_current->entv[p_current->i++];
+        const char *psz_entry = p_entry->name;
         char *psz_full_uri, *psz_uri;
-        DIR *handle;
+        dir_listing *p_list = NULL;
         input_item_t *p_new = NULL;
-        int i_res;
+        int i_res = p_entry->type;
 
-        /* Check if it is a directory or even readable */
-        i_res = directory_open (p_current, psz_entry, &handle);
+        /* Check if it is a directory or even readable, unless its type is
+         * already known and it does not need to be opened */
+        if (i_res == ENTRY_UNKNOWN
+         || (i_res == ENTRY_DIR && p_sys->mode == MODE_EXPAND))
+        {
+            p_list = directory_get (p_sys, p_current, p_entry);
+            directory_prefetch (p_sys);
+            if (p_list == NULL)
+                continue;
+            i_res = p_list->res;
+            if (i_res != ENTRY_DIR || p_sys->mode != MODE_EXPAND)
+            {
+                listing_free (p_list);
+                p_list = NULL;
+            }
+        }
 
         if (i_res == ENTRY_EACCESS
             || (i_res == ENTRY_DIR && p_sys->mode == MODE_NONE)
             || (i_res == ENTRY_ENOTDIR && has_ext (p_sys->ignored_exts, psz_entry)))
+        {
+            if (p_list != NULL)
+                listing_free (p_list);
             continue;
+        }
 
 
         /* Create an input item for the current entry */
@@ -406,7 +769,8 @@ int DirRead (access_t *p_access, input_item_node_t *p_current_node)
         free (psz_uri);
         if (psz_full_uri == NULL)
         {
-            closedir (handle);
+            if (p_list != NULL)
+                listing_free (p_list);
             continue;
         }
 
@@ -416,7 +780,8 @@ int DirRead (access_t *p_access, input_item_node_t *p_current_node)
         if (p_new == NULL)
         {
             free (psz_full_uri);
-            closedir (handle);
+            if (p_list != NULL)
+                listing_free (p_list);
             continue;
         }
 
@@ -424,13 +789,20 @@ int DirRead (access_t *p_access, input_item_node_t *p_current_node)
         input_item_node_t *p_new_node = input_item_node_AppendItem (p_current_node, p_new);
 
         /* Handle directory flags and recursion if in EXPAND mode  */
-        if (i_res == ENTRY_DIR)
+        if (p_list != NULL)
         {
-            if (p_sys->mode == MODE_EXPAND
-                && directory_push (p_sys, handle, psz_full_uri))
-            {
+            /* the handle and entries now belong to the directory */
+            DIR *handle = p_list->handle;
+            dir_entry *entv = p_list->entv;
+            int entc = p_list->entc;
+
+            p_list->handle = NULL;
+            p_list->entv = NULL;
+            p_list->entc = 0;
+            listing_free (p_list);
+
+            if (directory_push (p_sys, handle, entv, entc, psz_full_uri))
                 p_current_node = p_new_node;
-            }
         }
 
         free (psz_full_uri);
@@ -121,11 +121,18 @@ static void ApplicationInformationOpen( cam_t *, unsigned i_session_id );
 static void ConditionalAccessOpen( cam_t *, unsigned i_session_id );
 static void DateTimeOpen( cam_t *, unsigned i_session_id );
 static void MMIOpen( cam_t *, unsigned i_session_id );
+static void *Thread( void * );
 
 #define MAX_CI_SLOTS 16
 #define MAX_SESSIONS 32
 #define MAX_PROGRAMS 24
 
+typedef struct cam_pmt_t
+{
+    struct cam_pmt_t *p_next;
+    dvbpsi_pmt_t *p_pmt;
+} cam_pmt_t;
+
 struct cam
 {
     vlc_object_t *obj;
@@ -133,6 +140,14 @@ struct cam
     int i_ca_type;
     mtime_t i_timeout, i_next_event;
 
+    /* The CAM is only talked to from its thread: the PMTs to send are
+     * queued, so that the TS reading never waits for the CAM. */
+    vlc_thread_t thread;
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    cam_pmt_t *p_pending, **pp_pending_last;
+    bool b_exit;
+
     unsigned i_nb_slots;
     bool pb_active_slot[MAX_CI_SLOTS];
     bool pb_tc_has_data[MAX_CI_SLOTS];
@@ -2087,6 +2102,18 @@ cam_t *en50221_Init( vlc_object_t *obj, int fd )
         msg_Err( obj, "CAM interface incompatible" );
         goto error;
     }
+
+    vlc_mutex_init( &p_cam->lock );
+    vlc_cond_init( &p_cam->wait );
+    p_cam->p_pending = NULL;
+    p_cam->pp_pending_last = &p_cam->p_pending;
+    p_cam->b_exit = false;
+    if( vlc_clone( &p_cam->thread, Thread, p_cam, VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_cond_destroy( &p_cam->wait );
+        vlc_mutex_destroy( &p_cam->lock );
+        goto error;
+    }
     return p_cam;
 
 error:
@@ -2096,9 +2123,9 @@ error:
 
 
 /*****************************************************************************
- * en50221_Poll : Poll the CAM for TPDUs
+ * Poll : Poll the CAM for TPDUs
  *****************************************************************************/
-void en50221_Poll( cam_t * p_cam )
+static void Poll( cam_t * p_cam )
 {
     switch( p_cam->i_ca_type )
     {
@@ -2246,9 +2273,9 @@ void en50221_Poll( cam_t * p_cam )
 
 
 /*****************************************************************************
- * en50221_SetCAPMT :
+ * SetCAPMT :
  *****************************************************************************/
-int en50221_SetCAPMT( cam_t * p_cam, dvbpsi_pmt_t *p_pmt )
+static void SetCAPMT( cam_t * p_cam, dvbpsi_pmt_t *p_pmt )
 {
     bool b_update = false;
     bool b_needs_descrambling = CAPMTNeedsDescrambling( p_pmt );
@@ -2310,7 +2337,72 @@ int en50221_SetCAPMT( cam_t * p_cam, dvbpsi_pmt_t *p_pmt )
     {
         dvbpsi_DeletePMT( p_pmt );
     }
+}
 
+/*****************************************************************************
+ * Thread : Send the queued PMTs and poll the CAM
+ *****************************************************************************/
+static void *Thread( void *data )
+{
+    cam_t *p_cam = data;
+
+    vlc_mutex_lock( &p_cam->lock );
+    while( !p_cam->b_exit )
+    {
+        cam_pmt_t *p_request = p_cam->p_pending;
+
+        if( p_request != NULL )
+        {
+            p_cam->p_pending = p_request->p_next;
+            if( p_cam->p_pending == NULL )
+                p_cam->pp_pending_last = &p_cam->p_pending;
+            vlc_mutex_unlock( &p_cam->lock );
+
+            SetCAPMT( p_cam, p_request->p_pmt );
+            free( p_request );
+        }
+        else if( p_cam->i_ca_type != CA_CI_LINK )
+        {
+            vlc_cond_wait( &p_cam->wait, &p_cam->lock );
+            continue;
+        }
+        else if( mdate() > p_cam->i_next_event )
+        {
+            vlc_mutex_unlock( &p_cam->lock );
+            Poll( p_cam );
+        }
+        else
+        {
+            vlc_cond_timedwait( &p_cam->wait, &p_cam->lock,
+                                p_cam->i_next_event );
+            continue;
+        }
+        vlc_mutex_lock( &p_cam->lock );
+    }
+    vlc_mutex_unlock( &p_cam->lock );
+    return NULL;
+}
+
+/*****************************************************************************
+ * en50221_SetCAPMT : Queue a PMT for the CAM thread
+ *****************************************************************************/
+int en50221_SetCAPMT( cam_t * p_cam, dvbpsi_pmt_t *p_pmt )
+{
+    cam_pmt_t *p_request = malloc( sizeof( *p_request ) );
+    if( unlikely(p_request == NULL) )
+    {
+        dvbpsi_DeletePMT( p_pmt );
+        return VLC_ENOMEM;
+    }
+
+    p_request->p_next = NULL;
+    p_request->p_pmt = p_pmt;
+
+    vlc_mutex_lock( &p_cam->lock );
+    *p_cam->pp_pending_last = p_request;
+    p_cam->pp_pending_last = &p_request->p_next;
+    vlc_cond_signal( &p_cam->wait );
+    vlc_mutex_unlock( &p_cam->lock );
     return VLC_SUCCESS;
 }
 
@@ -2680,6 +2772,23 @@ out:
  *****************************************************************************/
 void en50221_End( cam_t * p_cam )
 {
+    vlc_mutex_lock( &p_cam->lock );
+    p_cam->b_exit = true;
+    vlc_cond_signal( &p_cam->wait );
+    vlc_mutex_unlock( &p_cam->lock );
+    vlc_join( p_cam->thread, NULL );
+
+    for( cam_pmt_t *p_request = p_cam->p_pending; p_request != NULL; )
+    {
+        cam_pmt_t *p_next = p_request->p_next;
+
+        dvbpsi_DeletePMT( p_request->p_pmt );
+        free( p_request );
+        p_request = p_next;
+    }
+    vlc_cond_destroy( &p_cam->wait );
+    vlc_mutex_destroy( &p_cam->lock );
+
     for( unsigned i = 0; i < MAX_PROGRAMS; i++ )
     {
         if( p_cam->pp_selected_programs[i] != NULL )
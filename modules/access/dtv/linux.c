@@ -327,11 +327,6 @@ ssize_t dvb_read (dvb_device_t *d, void *buf, size_t len)
     struct pollfd ufd[2];
     int n;
 
-#ifdef HAVE_DVBPSI
-    if (d->cam != NULL)
-        en50221_Poll (d->cam);
-#endif
-
     ufd[0].fd = d->demux;
     ufd[0].events = POLLIN;
     if (d->frontend != -1)
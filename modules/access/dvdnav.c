@@ -59,6 +59,8 @@
 
 
 #include <dvdnav/dvdnav.h>
+#include <dvdread/ifo_read.h>
+#include <dvdread/dvd_udf.h>
 
 #include "../demux/ps.h"
 
@@ -100,6 +102,12 @@ vlc_module_end ()
 #define DVD_READ_CACHE 1
 #endif
 
+/* Read-ahead of the disc images, so that the reads of libdvdnav, notably at
+ * cell boundaries, find the sectors in the cache of the system rather than
+ * on a slow (network) storage */
+#define DVD_READAHEAD_SECTORS 4096 /* 8 MiB */
+#define DVD_READAHEAD_CHUNK    256 /* sectors per read */
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -147,6 +155,25 @@ struct demux_sys_t
     mtime_t     i_pgc_length;
     int         i_vobu_index;
     int         i_vobu_flush;
+
+    /* read-ahead of the disc image */
+    struct
+    {
+        bool          b_created;
+        vlc_thread_t  thread;
+        vlc_mutex_t   lock;
+        vlc_cond_t    wait;
+        int           fd;
+        uint8_t      *p_buffer;
+
+        dvd_reader_t *p_reader;
+        ifo_handle_t *p_vmg;
+        int32_t       i_title; /* title of i_vob */
+        uint32_t      i_vob;   /* first sector of its VOBs in the image */
+
+        uint32_t      i_next;  /* next sector to read */
+        uint32_t      i_end;   /* first sector not to read */
+    } readahead;
 };
 
 static int Control( demux_t *, int, va_list );
@@ -167,6 +194,10 @@ static int ControlInternal( demux_t *, int, ... );
 
 static void StillTimer( void * );
 
+static void ReadAheadInit( demux_t *, const char * );
+static void ReadAheadUpdate( demux_t * );
+static void ReadAheadClean( demux_t * );
+
 static int EventMouse( vlc_object_t *, char const *,
                        vlc_value_t, vlc_value_t, void * );
 static int EventIntf( vlc_object_t *, char const *,
@@ -232,11 +263,13 @@ static int Open( vlc_object_t *p_this )
         free( psz_file );
         return VLC_EGENERIC;
     }
-    free( psz_file );
 
     /* Fill p_demux field */
     DEMUX_INIT_COMMON(); p_sys = p_demux->p_sys;
     p_sys->dvdnav = p_dvdnav;
+
+    ReadAheadInit( p_demux, psz_file );
+    free( psz_file );
     p_sys->b_reset_pcr = false;
 
     ps_track_init( p_sys->tk );
@@ -329,6 +362,7 @@ static int Open( vlc_object_t *p_this )
             dialog_Fatal( p_demux, _("Playback failure"), "%s",
                             _("VLC cannot set the DVD's title. It possibly "
                               "cannot decrypt the entire disc.") );
+            ReadAheadClean( p_demux );
             dvdnav_close( p_sys->dvdnav );
             free( p_sys );
             return VLC_EGENERIC;
@@ -416,6 +450,7 @@ static void Close( vlc_object_t *p_this )
         vlc_input_title_Delete( p_sys->title[i] );
     TAB_CLEAN( p_sys->i_title, p_sys->title );
 
+    ReadAheadClean( p_demux );
     dvdnav_close( p_sys->dvdnav );
     free( p_sys );
 }
@@ -891,6 +926,7 @@ static int Demux( demux_t *p_demux )
          *  - ...
          */
         DemuxBlock( p_demux, packet, i_len );
+        ReadAheadUpdate( p_demux );
         if( p_sys->b_spu_change )
         {
             ButtonUpdate( p_demux, false );
@@ -1384,6 +1420,160 @@ static void StillTimer( void *p_data )
     vlc_mutex_unlock( &p_sys->still.lock );
 }
 
+/*****************************************************************************
+ * Read-ahead of the disc images
+ *****************************************************************************/
+static void *ReadAheadThread( void *p_data )
+{
+    demux_sys_t *p_sys = p_data;
+
+    vlc_mutex_lock( &p_sys->readahead.lock );
+    mutex_cleanup_push( &p_sys->readahead.lock );
+    for( ;; )
+    {
+        while( p_sys->readahead.i_next >= p_sys->readahead.i_end )
+            vlc_cond_wait( &p_sys->readahead.wait, &p_sys->readahead.lock );
+
+        const uint32_t i_sector = p_sys->readahead.i_next;
+        const uint32_t i_count = __MIN( p_sys->readahead.i_end - i_sector,
+                                        DVD_READAHEAD_CHUNK );
+        vlc_mutex_unlock( &p_sys->readahead.lock );
+
+        /* The data is dropped: it only needs to be in the system cache */
+        int canc = vlc_savecancel();
+        ssize_t i_read = -1;
+        if( lseek( p_sys->readahead.fd, (off_t)i_sector * DVD_VIDEO_LB_LEN,
+                   SEEK_SET ) != (off_t)-1 )
+            i_read = read( p_sys->readahead.fd, p_sys->readahead.p_buffer,
+                           i_count * DVD_VIDEO_LB_LEN );
+        vlc_restorecancel( canc );
+
+        vlc_mutex_lock( &p_sys->readahead.lock );
+        if( p_sys->readahead.i_next != i_sector )
+            continue; /* moved meanwhile */
+        if( i_read < DVD_VIDEO_LB_LEN )
+            p_sys->readahead.i_end = i_sector; /* end of the image or error */
+        else
+            p_sys->readahead.i_next += i_read / DVD_VIDEO_LB_LEN;
+    }
+    vlc_cleanup_pop();
+    return NULL;
+}
+
+/* Only for the images in regular files: the drives have their own cache,
+ * and reading ahead of libdvdnav would only make them seek */
+static void ReadAheadInit( demux_t *p_demux, const char *psz_file )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    struct stat st;
+
+    p_sys->readahead.b_created = false;
+    if( vlc_stat( psz_file, &st ) || !S_ISREG( st.st_mode ) )
+        return;
+
+    p_sys->readahead.fd = vlc_open( psz_file, O_RDONLY );
+    if( p_sys->readahead.fd == -1 )
+        return;
+
+    const char *psz_path = ToLocale( psz_file );
+    p_sys->readahead.p_reader = DVDOpen( psz_path );
+    LocaleFree( psz_path );
+    p_sys->readahead.p_vmg = p_sys->readahead.p_reader != NULL
+                           ? ifoOpen( p_sys->readahead.p_reader, 0 ) : NULL;
+    p_sys->readahead.p_buffer = malloc( DVD_READAHEAD_CHUNK * DVD_VIDEO_LB_LEN );
+    if( p_sys->readahead.p_vmg == NULL || p_sys->readahead.p_buffer == NULL )
+        goto error;
+
+    p_sys->readahead.i_title = 0;
+    p_sys->readahead.i_vob = 0;
+    p_sys->readahead.i_next = 0;
+    p_sys->readahead.i_end = 0;
+    vlc_mutex_init( &p_sys->readahead.lock );
+    vlc_cond_init( &p_sys->readahead.wait );
+    if( vlc_clone( &p_sys->readahead.thread, ReadAheadThread, p_sys,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_cond_destroy( &p_sys->readahead.wait );
+        vlc_mutex_destroy( &p_sys->readahead.lock );
+        goto error;
+    }
+    p_sys->readahead.b_created = true;
+    return;
+
+error:
+    msg_Warn( p_demux, "cannot read ahead of %s", psz_file );
+    free( p_sys->readahead.p_buffer );
+    if( p_sys->readahead.p_vmg != NULL )
+        ifoClose( p_sys->readahead.p_vmg );
+    if( p_sys->readahead.p_reader != NULL )
+        DVDClose( p_sys->readahead.p_reader );
+    close( p_sys->readahead.fd );
+}
+
+/* Follows the current VOBU: the sectors of the next VOBUs and cells of the
+ * title are read ahead of libdvdnav, as they are stored in sequence */
+static void ReadAheadUpdate( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    int32_t i_title, i_part;
+
+    if( !p_sys->readahead.b_created )
+        return;
+
+    /* Nothing to do in the menus, they are small */
+    if( dvdnav_current_title_info( p_sys->dvdnav, &i_title, &i_part )
+            != DVDNAV_STATUS_OK || i_title <= 0 )
+        return;
+
+    if( i_title != p_sys->readahead.i_title )
+    {
+        const tt_srpt_t *p_tt_srpt = p_sys->readahead.p_vmg->tt_srpt;
+        char psz_name[sizeof("/VIDEO_TS/VTS_00_1.VOB")];
+        uint32_t i_size;
+
+        p_sys->readahead.i_title = i_title;
+        p_sys->readahead.i_vob = 0;
+        if( i_title <= p_tt_srpt->nr_of_srpts )
+        {
+            snprintf( psz_name, sizeof(psz_name), "/VIDEO_TS/VTS_%02d_1.VOB",
+                      p_tt_srpt->title[i_title - 1].title_set_nr );
+            p_sys->readahead.i_vob = UDFFindFile( p_sys->readahead.p_reader,
+                                                  psz_name, &i_size );
+        }
+    }
+    if( p_sys->readahead.i_vob == 0 )
+        return;
+
+    const dsi_t *p_dsi = dvdnav_get_current_nav_dsi( p_sys->dvdnav );
+    const uint32_t i_pos = p_sys->readahead.i_vob + p_dsi->dsi_gi.nv_pck_lbn;
+
+    vlc_mutex_lock( &p_sys->readahead.lock );
+    /* Restart from the current position after a jump */
+    if( p_sys->readahead.i_next < i_pos
+     || p_sys->readahead.i_next > i_pos + DVD_READAHEAD_SECTORS )
+        p_sys->readahead.i_next = i_pos;
+    p_sys->readahead.i_end = i_pos + DVD_READAHEAD_SECTORS;
+    vlc_cond_signal( &p_sys->readahead.wait );
+    vlc_mutex_unlock( &p_sys->readahead.lock );
+}
+
+static void ReadAheadClean( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->readahead.b_created )
+        return;
+
+    vlc_cancel( p_sys->readahead.thread );
+    vlc_join( p_sys->readahead.thread, NULL );
+    vlc_cond_destroy( &p_sys->readahead.wait );
+    vlc_mutex_destroy( &p_sys->readahead.lock );
+    free( p_sys->readahead.p_buffer );
+    ifoClose( p_sys->readahead.p_vmg );
+    DVDClose( p_sys->readahead.p_reader );
+    close( p_sys->readahead.fd );
+}
+
 static int EventMouse( vlc_object_t *p_vout, char const *psz_var,
                        vlc_value_t oldval, vlc_value_t val, void *p_data )
 {
@@ -51,6 +51,9 @@
 #else
 #   include <unistd.h>
 #endif
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 #include <dirent.h>
 
 #include <vlc_common.h>
@@ -70,6 +73,9 @@ struct access_sys_t
 
     bool b_pace_control;
     uint64_t size;
+#ifdef HAVE_MMAP
+    size_t page_mask;
+#endif
 };
 
 #if !defined (_WIN32) && !defined (__OS2__)
@@ -129,6 +135,9 @@ static bool IsRemote (const char *path)
 #endif
 
 static ssize_t FileRead (access_t *, uint8_t *, size_t);
+#ifdef HAVE_MMAP
+static block_t *FileBlock (access_t *);
+#endif
 static int FileSeek (access_t *, uint64_t);
 static ssize_t StreamRead (access_t *, uint8_t *, size_t);
 static int NoSeek (access_t *, uint64_t);
@@ -243,6 +252,25 @@ int FileOpen( vlc_object_t *p_this )
             fcntl (fd, F_RDAHEAD, 0);
         else
             fcntl (fd, F_RDAHEAD, 1);
+#endif
+#ifdef HAVE_MMAP
+        /* Map local regular files directly into the stream block cache
+         * instead of copying them with read(). Block devices report no
+         * size, and mapped network files may vanish under our feet. */
+        if (S_ISREG (st.st_mode) && !IsRemote(fd, p_access->psz_filepath)
+         && var_InheritBool (p_access, "file-mmap") && st.st_size > 0)
+        {
+            /* Not all file systems support mmap() */
+            void *addr = mmap (NULL, 1, PROT_READ, MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                munmap (addr, 1);
+                p_access->pf_read = NULL;
+                p_access->pf_block = FileBlock;
+                p_sys->page_mask = sysconf (_SC_PAGESIZE) - 1;
+                msg_Dbg (p_access, "using memory mapping");
+            }
+        }
 #endif
     }
     else
@@ -267,7 +295,7 @@ void FileClose (vlc_object_t * p_this)
 {
     access_t     *p_access = (access_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_read == NULL && p_access->pf_block == NULL)
     {
         DirClose (p_this);
         return;
@@ -319,6 +347,71 @@ static ssize_t FileRead (access_t *p_access, uint8_t *p_buffer, size_t i_len)
     return val;
 }
 
+#ifdef HAVE_MMAP
+/* Keep the mappings small on 32-bits hosts, where address space is scarce:
+ * the stream cache holds a few of them at once. */
+#define MMAP_WINDOW ((sizeof (void *) > 4) ? (4 << 20) : (1 << 20))
+
+/**
+ * Maps the next window of a regular file.
+ */
+static block_t *FileBlock (access_t *p_access)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    uint64_t pos = p_access->info.i_pos;
+
+    if (pos >= p_sys->size)
+    {
+        struct stat st;
+
+        /* The file may be growing */
+        if (fstat (p_sys->fd, &st) == 0)
+            p_sys->size = st.st_size;
+        if (pos >= p_sys->size)
+        {
+            p_access->info.b_eof = true;
+            return NULL;
+        }
+    }
+
+    /* The mapping offset must be page-aligned */
+    uint64_t offset = pos & ~(uint64_t)p_sys->page_mask;
+    size_t length = MMAP_WINDOW;
+
+    if (length > p_sys->size - offset)
+        length = p_sys->size - offset;
+
+    void *addr = mmap (NULL, length, PROT_READ, MAP_SHARED, p_sys->fd,
+                       offset);
+    if (addr == MAP_FAILED)
+    {
+        msg_Err (p_access, "memory mapping error: %s",
+                 vlc_strerror_c(errno));
+        dialog_Fatal (p_access, _("File reading failed"),
+                      _("VLC could not read the file (%s)."),
+                      vlc_strerror(errno));
+        p_access->info.b_eof = true;
+        return NULL;
+    }
+#ifdef HAVE_POSIX_MADVISE
+    posix_madvise (addr, length, POSIX_MADV_SEQUENTIAL);
+    posix_madvise (addr, length, POSIX_MADV_WILLNEED);
+#endif
+    /* Start reading the following window ahead of time */
+    posix_fadvise (p_sys->fd, offset + length, MMAP_WINDOW,
+                   POSIX_FADV_WILLNEED);
+
+    block_t *block = block_mmap_Alloc (addr, length);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    block->p_buffer += pos - offset;
+    block->i_buffer -= pos - offset;
+    p_access->info.i_pos += block->i_buffer;
+    return block;
+}
+#endif
+
 
 /*****************************************************************************
  * Seek: seek to a specific location in a file
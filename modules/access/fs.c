@@ -58,6 +58,12 @@ static const char *const psz_sort_list_text[] = {
 #define SORT_LONGTEXT N_( \
     "Define the sort algorithm used when adding items from a directory." )
 
+#define MMAP_TEXT N_("Memory-map local files")
+#define MMAP_LONGTEXT N_( \
+    "Read local files through memory mappings instead of copying them. " \
+    "This saves CPU time with very large files, but VLC will crash if a " \
+    "file is truncated while it is being played." )
+
 vlc_module_begin ()
     set_description( N_("File input") )
     set_shortname( N_("File") )
@@ -67,6 +73,7 @@ vlc_module_begin ()
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
+    add_bool( "file-mmap", false, MMAP_TEXT, MMAP_LONGTEXT, true )
 
     add_submodule()
     set_section( N_("Directory" ), NULL )
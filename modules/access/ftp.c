@@ -143,6 +143,9 @@ struct access_sys_t
     bool       out;
     bool       directory;
     uint64_t   size;
+
+    access_stats_t stats;
+    mtime_t    i_restart; /* duration of the last data connection setup */
 };
 #define GET_OUT_SYS( p_this ) \
     ((access_sys_t *)(((sout_access_out_t *)(p_this))->p_sys))
@@ -654,6 +657,7 @@ static int InOpen( vlc_object_t *p_this )
         p_sys->directory = true;
 
     /* Start the 'stream' */
+    mtime_t i_start = mdate();
     if( ftp_StartStream( p_this, p_sys, 0 ) < 0 )
     {
         msg_Err( p_this, "cannot retrieve file" );
@@ -661,6 +665,7 @@ static int InOpen( vlc_object_t *p_this )
         net_Close( p_sys->cmd.fd );
         goto exit_error;
     }
+    p_sys->i_restart = mdate() - i_start;
 
     return VLC_SUCCESS;
 
@@ -767,15 +772,56 @@ static int _Seek( vlc_object_t *p_access, access_sys_t *p_sys, uint64_t i_pos )
 {
     msg_Dbg( p_access, "seeking to %"PRIu64, i_pos );
 
+    mtime_t i_start = mdate();
     ftp_StopStream( (vlc_object_t *)p_access, p_sys );
     if( ftp_StartStream( (vlc_object_t *)p_access, p_sys, i_pos ) < 0 )
         return VLC_EGENERIC;
+    p_sys->i_restart = mdate() - i_start;
+
+    return VLC_SUCCESS;
+}
+
+/* Reads up to the position when that is faster than restarting the
+ * transfer, which takes several round trips */
+static int Skip( access_t *p_access, uint64_t i_pos )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    uint8_t p_buffer[16384];
+
+    if( i_pos <= p_access->info.i_pos || p_sys->directory ||
+        p_sys->stats.i_bytes == 0 )
+        return VLC_EGENERIC;
+
+    uint64_t i_skip = i_pos - p_access->info.i_pos;
+    double f_skip = (double)i_skip * p_sys->stats.i_wait / p_sys->stats.i_bytes;
+    if( f_skip >= p_sys->i_restart )
+        return VLC_EGENERIC;
 
+    while( i_skip > 0 )
+    {
+        mtime_t i_start = mdate();
+        ssize_t i_read = net_Read( p_access, p_sys->data.fd, p_sys->data.p_vs,
+                                   p_buffer, __MIN(i_skip, sizeof (p_buffer)),
+                                   false );
+        p_sys->stats.i_wait += mdate() - i_start;
+        if( i_read <= 0 )
+            return VLC_EGENERIC;
+        p_sys->stats.i_requests++;
+        p_sys->stats.i_bytes += i_read;
+        p_access->info.i_pos += i_read;
+        i_skip -= i_read;
+    }
     return VLC_SUCCESS;
 }
 
 static int Seek( access_t *p_access, uint64_t i_pos )
 {
+    if( Skip( p_access, i_pos ) == VLC_SUCCESS )
+    {
+        p_access->info.b_eof = false;
+        return VLC_SUCCESS;
+    }
+
     int val = _Seek( (vlc_object_t *)p_access, p_access->p_sys, i_pos );
     if( val )
         return val;
@@ -827,8 +873,15 @@ static ssize_t Read( access_t *p_access, uint8_t *p_buffer, size_t i_len )
     }
     else
     {
+        mtime_t i_start = mdate();
         int i_read = net_Read( p_access, p_sys->data.fd, p_sys->data.p_vs,
                                p_buffer, i_len, false );
+        p_sys->stats.i_wait += mdate() - i_start;
+        if( i_read > 0 )
+        {
+            p_sys->stats.i_requests++;
+            p_sys->stats.i_bytes += i_read;
+        }
         if( i_read == 0 )
             p_access->info.b_eof = true;
         else if( i_read > 0 )
@@ -900,6 +953,10 @@ static int Control( access_t *p_access, int i_query, va_list args )
                    * var_InheritInteger( p_access, "network-caching" );
             break;
 
+        case ACCESS_GET_STATS:
+            *va_arg( args, access_stats_t * ) = p_access->p_sys->stats;
+            break;
+
         case ACCESS_SET_PAUSE_STATE:
             pb_bool = (bool*)va_arg( args, bool* );
             if ( !pb_bool )
@@ -82,6 +82,13 @@ static void Close( vlc_object_t * );
     "You should not globally enable this option as it will break all other " \
     "types of HTTP streams." )
 
+#define SEGMENTS_TEXT N_("Parallel connections")
+#define SEGMENTS_LONGTEXT N_( \
+    "Download a seekable file through up to this many concurrent range " \
+    "requests. The number of connections and the size of the requests " \
+    "adapt to the throughput and round trip time of the link. " \
+    "1 disables segmented downloading." )
+
 #define FORWARD_COOKIES_TEXT N_("Forward Cookies")
 #define FORWARD_COOKIES_LONGTEXT N_("Forward Cookies across http redirections.")
 
@@ -116,6 +123,8 @@ vlc_module_begin ()
     add_bool( "http-continuous", false, CONTINUOUS_TEXT,
               CONTINUOUS_LONGTEXT, true )
         change_safe()
+    add_integer_with_range( "http-segments", 1, 1, 8, SEGMENTS_TEXT,
+                            SEGMENTS_LONGTEXT, true )
     add_bool( "http-forward-cookies", true, FORWARD_COOKIES_TEXT,
               FORWARD_COOKIES_LONGTEXT, true )
     /* 'itpc' = iTunes Podcast */
@@ -127,13 +136,48 @@ vlc_module_end ()
  * Local prototypes
  *****************************************************************************/
 
+/* Segmented download */
+#define SEG_MAX_WORKERS 8
+#define SEG_QUEUE       16           /* segments queued ahead at most */
+#define SEG_MIN_SIZE    (256 << 10)
+#define SEG_MAX_SIZE    (8 << 20)
+#define SEG_MAX_AHEAD   (64 << 20)   /* bytes queued ahead of the reader */
+#define SEG_DRAIN_SIZE  (64 << 10)   /* bytes read to keep a connection */
+#define SEG_MAX_ERRORS  3
+
+/* A range of the file, received in its own buffer */
+typedef struct
+{
+    uint64_t i_start;
+    size_t   i_size;
+    size_t   i_filled;  /* bytes received */
+    unsigned i_errors;
+    bool     b_busy;    /* a worker is receiving it */
+    bool     b_cancel;  /* dropped, the worker frees it */
+    uint8_t  p_buffer[];
+} http_segment_t;
+
+/* A thread with its own connection, receiving segments one by one */
+typedef struct
+{
+    access_t       *p_access;
+    vlc_thread_t    thread;
+    unsigned        i_index;
+    int             fd;
+    vlc_tls_t      *p_tls;
+    bool            b_idle;     /* the connection can take a new request */
+    http_segment_t *p_seg;
+} http_worker_t;
+
 struct access_sys_t
 {
     int fd;
     bool b_error;
+    bool b_tls;
     vlc_tls_creds_t *p_creds;
     vlc_tls_t *p_tls;
     v_socket_t *p_vs;
+    char *psz_conn_key; /* key of the connection in the pool */
 
     /* From uri */
     vlc_url_t url;
@@ -187,6 +231,35 @@ struct access_sys_t
     bool b_pace_control;
     bool b_persist;
     bool b_has_size;
+
+    /* Segmented download: the workers fill the queued segments, and the
+     * reader consumes them in order */
+    bool b_segmented;
+    struct
+    {
+        vlc_mutex_t     lock;
+        vlc_cond_t      wait;   /* for the workers */
+        vlc_cond_t      data;   /* for the reader */
+        http_segment_t *queue[SEG_QUEUE];
+        unsigned        i_queued;
+        uint64_t        i_pos;  /* reader position */
+        uint64_t        i_next; /* start of the next segment to queue */
+        size_t          i_size; /* size of the next segments */
+        bool            b_error;
+        bool            b_starved; /* the reader waited */
+
+        unsigned        i_workers;
+        unsigned        i_active;  /* workers allowed to fetch */
+        unsigned        i_max;     /* workers worth activating */
+        http_worker_t  *p_workers;
+
+        /* Link estimation */
+        mtime_t         i_rtt;
+        double          f_conn_rate; /* bytes per second of a connection */
+        double          f_rate;      /* bytes per second of all of them */
+        uint64_t        i_received;
+        mtime_t         i_date;
+    } seg;
 };
 
 /* */
@@ -204,6 +277,11 @@ static int Connect( access_t *, uint64_t );
 static int Request( access_t *p_access, uint64_t i_tell );
 static void Disconnect( access_t * );
 
+static int SegStart( access_t * );
+static void SegStop( access_t * );
+static ssize_t SegRead( access_t *, uint8_t *, size_t );
+static int SegSeek( access_t *, uint64_t );
+
 
 static void AuthReply( access_t *p_acces, const char *psz_prefix,
                        vlc_url_t *p_url, http_auth_t *p_auth );
@@ -241,6 +319,10 @@ static int OpenRedirected( vlc_object_t *p_this, const char *psz_access,
     p_access->pf_read = ReadCompressed;
 #endif
     p_sys->fd = -1;
+    p_sys->b_segmented = false;
+    p_sys->b_tls = false;
+    p_sys->p_creds = NULL;
+    p_sys->psz_conn_key = NULL;
     p_sys->b_proxy = false;
     p_sys->psz_proxy_passbuf = NULL;
     p_sys->i_version = 1;
@@ -301,9 +383,7 @@ static int OpenRedirected( vlc_object_t *p_this, const char *psz_access,
     if( !strncmp( psz_access, "https", 5 ) )
     {
         /* HTTP over SSL */
-        p_sys->p_creds = vlc_tls_ClientCreate( p_this );
-        if( p_sys->p_creds == NULL )
-            goto error;
+        p_sys->b_tls = true;
         if( p_sys->url.i_port <= 0 )
             p_sys->url.i_port = 443;
     }
@@ -510,6 +590,7 @@ connect:
 
         Disconnect( p_access );
         vlc_tls_Delete( p_sys->p_creds );
+        free( p_sys->psz_conn_key );
 #ifdef HAVE_ZLIB_H
         inflateEnd( &p_sys->inflate.stream );
 #endif
@@ -580,6 +661,9 @@ connect:
 
     if( p_sys->b_reconnect ) msg_Dbg( p_access, "auto re-connect enabled" );
 
+    /* Fetch the file through concurrent range requests, if it allows */
+    SegStart( p_access );
+
     return VLC_SUCCESS;
 
 error:
@@ -594,6 +678,7 @@ error:
 
     Disconnect( p_access );
     vlc_tls_Delete( p_sys->p_creds );
+    free( p_sys->psz_conn_key );
 
 #ifdef HAVE_ZLIB_H
     inflateEnd( &p_sys->inflate.stream );
@@ -610,6 +695,9 @@ static void Close( vlc_object_t *p_this )
     access_t     *p_access = (access_t*)p_this;
     access_sys_t *p_sys = p_access->p_sys;
 
+    if( p_sys->b_segmented )
+        SegStop( p_access );
+
     vlc_UrlClean( &p_sys->url );
     http_auth_Reset( &p_sys->auth );
     vlc_UrlClean( &p_sys->proxy );
@@ -626,8 +714,17 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->psz_user_agent );
     free( p_sys->psz_referrer );
 
+    vlc_http_pool_stats_t stats;
+    if( p_sys->psz_conn_key != NULL &&
+        !vlc_http_pool_GetStats( VLC_OBJECT(p_access), p_sys->psz_conn_key,
+                                 &stats ) )
+        msg_Dbg( p_access, "connections to %s: %"PRIu64" reused, "
+                 "%"PRIu64" opened", p_sys->psz_conn_key, stats.i_reused,
+                 stats.i_missed );
+
     Disconnect( p_access );
     vlc_tls_Delete( p_sys->p_creds );
+    free( p_sys->psz_conn_key );
 
 #ifdef HAVE_ZLIB_H
     inflateEnd( &p_sys->inflate.stream );
@@ -663,6 +760,14 @@ static int ReadData( access_t *p_access, int *pi_read,
             if( p_sys->i_chunk <= 0 )   /* eof */
             {
                 p_sys->i_chunk = -1;
+                /* skip the trailer, so that the connection can be reused */
+                while( ( psz = net_Gets( p_access, p_sys->fd, p_sys->p_vs ) ) != NULL
+                       && *psz != '\0' )
+                    free( psz );
+                if( psz == NULL )
+                    p_sys->b_persist = false;
+                free( psz );
+                Disconnect( p_access );
                 return VLC_EGENERIC;
             }
         }
@@ -779,6 +884,9 @@ static ssize_t Read( access_t *p_access, uint8_t *p_buffer, size_t i_len )
         assert( p_access->info.i_pos <= p_sys->size );
         assert( (unsigned)i_read <= p_sys->i_remaining );
         p_sys->i_remaining -= i_read;
+        /* Hand the connection over as soon as the response is complete */
+        if( p_sys->i_remaining == 0 && p_sys->b_persist && !p_sys->b_chunked )
+            Disconnect( p_access );
     }
 
     return i_read;
@@ -991,6 +1099,26 @@ static int Control( access_t *p_access, int i_query, va_list args )
     return VLC_SUCCESS;
 }
 
+/* Identifies the connections a request can be sent through */
+static char *ConnectionKey( bool b_tls, const vlc_url_t *p_url,
+                            const vlc_url_t *p_proxy )
+{
+    char *psz_key;
+    int i_ret;
+
+    if( p_proxy == NULL )
+        i_ret = asprintf( &psz_key, "%s://%s:%d", b_tls ? "https" : "http",
+                          p_url->psz_host, p_url->i_port );
+    else if( b_tls ) /* tunnel to the server */
+        i_ret = asprintf( &psz_key, "https://%s:%d via %s:%d",
+                          p_url->psz_host, p_url->i_port,
+                          p_proxy->psz_host, p_proxy->i_port );
+    else /* any server through the proxy */
+        i_ret = asprintf( &psz_key, "http://*:* via %s:%d",
+                          p_proxy->psz_host, p_proxy->i_port );
+    return i_ret >= 0 ? psz_key : NULL;
+}
+
 /*****************************************************************************
  * Connect:
  *****************************************************************************/
@@ -1027,8 +1155,41 @@ static int Connect( access_t *p_access, uint64_t i_tell )
     p_access->info.i_pos  = i_tell;
     p_access->info.b_eof  = false;
 
-    /* Open connection */
+    /* Reuse an idle connection to the same server if possible */
     assert( p_sys->fd == -1 ); /* No open sockets (leaking fds is BAD) */
+    free( p_sys->psz_conn_key );
+    p_sys->psz_conn_key = ConnectionKey( p_sys->b_tls, &p_sys->url,
+                                p_sys->b_proxy ? &p_sys->proxy : NULL );
+
+    if( p_sys->psz_conn_key != NULL && p_sys->i_version == 1 )
+    {
+        vlc_tls_t *p_tls;
+        int fd = vlc_http_pool_Take( VLC_OBJECT(p_access),
+                                     p_sys->psz_conn_key, &p_tls );
+        if( fd != -1 )
+        {
+            p_sys->fd = fd;
+            if( p_tls != NULL )
+            {
+                /* The session comes with its own credentials */
+                vlc_tls_Delete( p_sys->p_creds );
+                p_sys->p_creds = (vlc_tls_creds_t *)p_tls->p_parent;
+                p_sys->p_tls = p_tls;
+                p_sys->p_vs = &p_tls->sock;
+            }
+
+            if( Request( p_access, i_tell ) == VLC_SUCCESS )
+                return 0;
+            /* The server may have closed the connection in the meantime:
+             * retry on a new connection unless it did answer. */
+            if( p_sys->i_code != 0 || !vlc_object_alive( p_access ) )
+                return -2;
+            msg_Dbg( p_access, "persistent connection lost, reconnecting" );
+            Disconnect( p_access );
+        }
+    }
+
+    /* Open connection */
     p_sys->fd = net_ConnectTCP( p_access, srv.psz_host, srv.i_port );
     if( p_sys->fd == -1 )
     {
@@ -1038,7 +1199,7 @@ static int Connect( access_t *p_access, uint64_t i_tell )
     setsockopt (p_sys->fd, SOL_SOCKET, SO_KEEPALIVE, &(int){ 1 }, sizeof (int));
 
     /* Initialize TLS/SSL session */
-    if( p_sys->p_creds != NULL )
+    if( p_sys->b_tls )
     {
         /* CONNECT to establish TLS tunnel through HTTP proxy */
         if( p_sys->b_proxy )
@@ -1104,6 +1265,19 @@ static int Connect( access_t *p_access, uint64_t i_tell )
         /* TLS/SSL handshake */
         const char *alpn[] = { "http/1.1", NULL };
 
+        if( p_sys->p_creds == NULL )
+        {
+            /* The credentials follow the session to the connection pool,
+             * which may outlive this access and its input. */
+            p_sys->p_creds =
+                vlc_tls_ClientCreate( VLC_OBJECT(p_access->p_libvlc) );
+            if( p_sys->p_creds == NULL )
+            {
+                Disconnect( p_access );
+                return -1;
+            }
+        }
+
         p_sys->p_tls = vlc_tls_ClientSessionCreate( p_sys->p_creds, p_sys->fd,
                 p_sys->url.psz_host, "https",
                 p_sys->i_version ? alpn : NULL, NULL );
@@ -1125,8 +1299,10 @@ static int Request( access_t *p_access, uint64_t i_tell )
     access_sys_t   *p_sys = p_access->p_sys;
     char           *psz ;
     v_socket_t     *pvs = p_sys->p_vs;
+    bool            b_persist = false, b_length = false;
     p_sys->b_persist = false;
 
+    p_sys->i_code = 0;
     p_sys->i_remaining = 0;
 
     const char *psz_path = p_sys->url.psz_path;
@@ -1158,10 +1334,9 @@ static int Request( access_t *p_access, uint64_t i_tell )
     /* Offset */
     if( p_sys->i_version == 1 && ! p_sys->b_continuous )
     {
-        p_sys->b_persist = true;
+        /* HTTP/1.1 connections are persistent by default */
         net_Printf( p_access, p_sys->fd, pvs,
                     "Range: bytes=%"PRIu64"-\r\n", i_tell );
-        net_Printf( p_access, p_sys->fd, pvs, "Connection: close\r\n" );
     }
 
     /* Cookies */
@@ -1206,6 +1381,8 @@ static int Request( access_t *p_access, uint64_t i_tell )
     {
         p_sys->psz_protocol = "HTTP";
         p_sys->i_code = atoi( &psz[9] );
+        b_persist = psz[7] == '1' && p_sys->i_version == 1 &&
+                    !p_sys->b_continuous;
     }
     else if( !strncmp( psz, "ICY", 3 ) )
     {
@@ -1292,6 +1469,7 @@ static int Request( access_t *p_access, uint64_t i_tell )
         if( !strcasecmp( psz, "Content-Length" ) )
         {
             uint64_t i_size = i_tell + (p_sys->i_remaining = (uint64_t)atoll( p ));
+            b_length = true;
             if(i_size > p_sys->size) {
                 p_sys->b_has_size = true;
                 p_sys->size = i_size;
@@ -1321,7 +1499,7 @@ static int Request( access_t *p_access, uint64_t i_tell )
             int i = -1;
             sscanf(p, "close%n",&i);
             if( i >= 0 ) {
-                p_sys->b_persist = false;
+                b_persist = false;
             }
         }
         else if( !strcasecmp( psz, "Location" ) )
@@ -1514,6 +1692,10 @@ static int Request( access_t *p_access, uint64_t i_tell )
 
         free( psz );
     }
+    /* The connection can be reused if the end of the response is known
+     * without the server closing the connection. */
+    p_sys->b_persist = b_persist && ( b_length || p_sys->b_chunked );
+
     /* We close the stream for zero length data, unless of course the
      * server has already promised to do this for us.
      */
@@ -1534,6 +1716,24 @@ static void Disconnect( access_t *p_access )
 {
     access_sys_t *p_sys = p_access->p_sys;
 
+    /* Keep the connection for a next request if the response was read
+     * completely */
+    if( p_sys->fd != -1 && p_sys->b_persist && !p_sys->b_error &&
+        p_sys->psz_conn_key != NULL &&
+        ( p_sys->b_chunked ? p_sys->i_chunk < 0 : p_sys->i_remaining == 0 ) )
+    {
+        vlc_http_pool_Give( VLC_OBJECT(p_access), p_sys->psz_conn_key,
+                            p_sys->fd, p_sys->p_tls );
+        if( p_sys->p_tls != NULL )
+            p_sys->p_creds = NULL; /* owned by the pool with the session */
+        p_sys->p_tls = NULL;
+        p_sys->p_vs = NULL;
+        p_sys->fd = -1;
+        p_sys->b_persist = false;
+        return;
+    }
+    p_sys->b_persist = false;
+
     if( p_sys->p_tls != NULL)
     {
         vlc_tls_SessionDelete( p_sys->p_tls );
@@ -1548,6 +1748,595 @@ static void Disconnect( access_t *p_access )
 
 }
 
+/*****************************************************************************
+ * Segmented download
+ *****************************************************************************
+ * A seekable file of known size is split into segments, requested through
+ * concurrent range requests on persistent connections. The reader waits for
+ * the segment at its position, so that the data come out in order. A seek
+ * only drops the queued segments: the connections remain.
+ *****************************************************************************/
+
+/* Frees a segment, or leaves that to the worker receiving it.
+ * This function must be entered WITH the segments lock */
+static void SegDrop( http_segment_t *p_seg )
+{
+    if( p_seg->b_busy )
+        p_seg->b_cancel = true;
+    else
+        free( p_seg );
+}
+
+/* Returns the segment a worker should receive next, queuing a new one if
+ * needed. This function must be entered WITH the segments lock */
+static http_segment_t *SegNext( access_t *p_access, const http_worker_t *w )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->seg.b_error || w->i_index >= p_sys->seg.i_active )
+        return NULL;
+
+    /* The first segments first, including those to resume after an error */
+    for( unsigned i = 0; i < p_sys->seg.i_queued; i++ )
+    {
+        http_segment_t *p_seg = p_sys->seg.queue[i];
+        if( !p_seg->b_busy && p_seg->i_filled < p_seg->i_size )
+            return p_seg;
+    }
+
+    if( p_sys->seg.i_queued == SEG_QUEUE ||
+        p_sys->seg.i_next >= p_sys->size ||
+        p_sys->seg.i_next - p_sys->seg.i_pos >= SEG_MAX_AHEAD )
+        return NULL;
+
+    size_t i_size = __MIN( p_sys->seg.i_size,
+                           p_sys->size - p_sys->seg.i_next );
+    http_segment_t *p_seg = malloc( sizeof (*p_seg) + i_size );
+    if( unlikely(p_seg == NULL) )
+    {
+        p_sys->seg.b_error = true;
+        vlc_cond_signal( &p_sys->seg.data );
+        return NULL;
+    }
+    p_seg->i_start = p_sys->seg.i_next;
+    p_seg->i_size = i_size;
+    p_seg->i_filled = 0;
+    p_seg->i_errors = 0;
+    p_seg->b_busy = false;
+    p_seg->b_cancel = false;
+
+    p_sys->seg.queue[p_sys->seg.i_queued++] = p_seg;
+    p_sys->seg.i_next += i_size;
+    return p_seg;
+}
+
+/* Adapts the segments and the number of connections to the link.
+ * This function must be entered WITH the segments lock */
+static void SegEstimate( access_t *p_access, mtime_t i_sent, mtime_t i_first,
+                         mtime_t i_done, size_t i_size )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    mtime_t i_rtt = i_first - i_sent;
+    p_sys->seg.i_rtt = p_sys->seg.i_rtt > 0 ?
+                       (3 * p_sys->seg.i_rtt + i_rtt) / 4 : i_rtt;
+    if( i_done > i_first )
+    {
+        double f_rate = (double)i_size * CLOCK_FREQ / (i_done - i_first);
+        p_sys->seg.f_conn_rate = p_sys->seg.f_conn_rate > 0. ?
+                                 (3. * p_sys->seg.f_conn_rate + f_rate) / 4. :
+                                 f_rate;
+    }
+
+    /* A request should last several round trips, so that the time it waits
+     * for the first byte is small */
+    uint64_t i_seg = p_sys->seg.f_conn_rate * p_sys->seg.i_rtt * 8
+                   / CLOCK_FREQ;
+    i_seg = VLC_CLIP( i_seg, SEG_MIN_SIZE, SEG_MAX_SIZE );
+    p_sys->seg.i_size = i_seg & ~UINT64_C(0xffff);
+
+    /* Add a connection while the reader waits, as long as the last one
+     * increased the throughput */
+    if( i_done - p_sys->seg.i_date < CLOCK_FREQ )
+        return;
+
+    double f_rate = (double)p_sys->seg.i_received * CLOCK_FREQ
+                  / (i_done - p_sys->seg.i_date);
+    if( p_sys->seg.b_starved && p_sys->seg.i_active < p_sys->seg.i_max )
+    {
+        if( f_rate > p_sys->seg.f_rate * 1.1 )
+        {
+            p_sys->seg.i_active++;
+            vlc_cond_broadcast( &p_sys->seg.wait );
+        }
+        else /* the link is saturated */
+            p_sys->seg.i_max = p_sys->seg.i_active;
+        msg_Dbg( p_access, "%u connections, %.0f kB/s, RTT %"PRId64" ms, "
+                 "segments of %zu kB", p_sys->seg.i_active, f_rate / 1000.,
+                 p_sys->seg.i_rtt / 1000, p_sys->seg.i_size >> 10 );
+    }
+    p_sys->seg.f_rate = f_rate;
+    p_sys->seg.i_received = 0;
+    p_sys->seg.i_date = i_done;
+    p_sys->seg.b_starved = false;
+}
+
+/* Closes the connection of a worker, or keeps it in the pool if idle */
+static void SegClose( http_worker_t *w, bool b_keep )
+{
+    access_t *p_access = w->p_access;
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( w->fd == -1 )
+        return;
+
+    if( b_keep && w->b_idle )
+        vlc_http_pool_Give( VLC_OBJECT(p_access), p_sys->psz_conn_key,
+                            w->fd, w->p_tls );
+    else
+    {
+        if( w->p_tls != NULL )
+        {
+            vlc_tls_creds_t *p_creds = (vlc_tls_creds_t *)w->p_tls->p_parent;
+
+            vlc_tls_SessionDelete( w->p_tls );
+            vlc_tls_Delete( p_creds );
+        }
+        net_Close( w->fd );
+    }
+    w->fd = -1;
+    w->p_tls = NULL;
+    w->b_idle = false;
+}
+
+static int SegConnect( http_worker_t *w, bool *pb_reused )
+{
+    access_t *p_access = w->p_access;
+    access_sys_t *p_sys = p_access->p_sys;
+    const vlc_url_t *srv = p_sys->b_proxy ? &p_sys->proxy : &p_sys->url;
+
+    w->fd = vlc_http_pool_Take( VLC_OBJECT(p_access), p_sys->psz_conn_key,
+                                &w->p_tls );
+    *pb_reused = w->fd != -1;
+    if( w->fd != -1 )
+        return VLC_SUCCESS;
+
+    w->fd = net_ConnectTCP( p_access, srv->psz_host, srv->i_port );
+    if( w->fd == -1 )
+        return VLC_EGENERIC;
+    setsockopt( w->fd, SOL_SOCKET, SO_KEEPALIVE, &(int){ 1 }, sizeof (int) );
+
+    if( p_sys->b_tls )
+    {
+        const char *alpn[] = { "http/1.1", NULL };
+        /* Each session has its own credentials, for the connection pool */
+        vlc_tls_creds_t *p_creds =
+            vlc_tls_ClientCreate( VLC_OBJECT(p_access->p_libvlc) );
+
+        if( p_creds != NULL )
+        {
+            w->p_tls = vlc_tls_ClientSessionCreate( p_creds, w->fd,
+                                p_sys->url.psz_host, "https", alpn, NULL );
+            if( w->p_tls == NULL )
+                vlc_tls_Delete( p_creds );
+        }
+        if( w->p_tls == NULL )
+        {
+            msg_Err( p_access, "cannot establish HTTP/TLS session" );
+            net_Close( w->fd );
+            w->fd = -1;
+            return VLC_EGENERIC;
+        }
+    }
+    return VLC_SUCCESS;
+}
+
+/* Requests the bytes from i_start to i_end (excluded), and reads the header
+ * of the response */
+static int SegRequest( http_worker_t *w, uint64_t i_start, uint64_t i_end,
+                       bool *pb_persist )
+{
+    access_t *p_access = w->p_access;
+    access_sys_t *p_sys = p_access->p_sys;
+    v_socket_t *pvs = w->p_tls != NULL ? &w->p_tls->sock : NULL;
+    uint64_t i_range = UINT64_MAX, i_length = UINT64_MAX;
+    bool b_persist;
+    int i_code;
+    char *psz;
+
+    const char *psz_path = p_sys->url.psz_path;
+    if( !psz_path || !*psz_path )
+        psz_path = "/";
+    if( p_sys->b_proxy )
+        net_Printf( p_access, w->fd, NULL,
+                    "GET http://%s:%d%s HTTP/1.1\r\n",
+                    p_sys->url.psz_host, p_sys->url.i_port, psz_path );
+    else
+        net_Printf( p_access, w->fd, pvs, "GET %s HTTP/1.1\r\n", psz_path );
+    if( p_sys->url.i_port != (p_sys->b_tls ? 443 : 80) )
+        net_Printf( p_access, w->fd, pvs, "Host: %s:%d\r\n",
+                    p_sys->url.psz_host, p_sys->url.i_port );
+    else
+        net_Printf( p_access, w->fd, pvs, "Host: %s\r\n",
+                    p_sys->url.psz_host );
+    net_Printf( p_access, w->fd, pvs, "User-Agent: %s\r\n",
+                p_sys->psz_user_agent );
+    if( p_sys->psz_referrer )
+        net_Printf( p_access, w->fd, pvs, "Referer: %s\r\n",
+                    p_sys->psz_referrer );
+    net_Printf( p_access, w->fd, pvs, "Range: bytes=%"PRIu64"-%"PRIu64"\r\n",
+                i_start, i_end - 1 );
+    if( p_sys->cookies )
+    {
+        char *psz_cookies = vlc_http_cookies_for_url( p_sys->cookies,
+                                                      &p_sys->url );
+        if( psz_cookies )
+        {
+            net_Printf( p_access, w->fd, pvs, "Cookie: %s\r\n", psz_cookies );
+            free( psz_cookies );
+        }
+    }
+    if( net_Printf( p_access, w->fd, pvs, "\r\n" ) < 0 )
+    {
+        msg_Err( p_access, "failed to send range request" );
+        return VLC_EGENERIC;
+    }
+
+    /* Read Answer */
+    psz = net_Gets( p_access, w->fd, pvs );
+    if( psz == NULL || strncmp( psz, "HTTP/1.", 7 ) )
+    {
+        free( psz );
+        return VLC_EGENERIC;
+    }
+    b_persist = psz[7] == '1';
+    i_code = atoi( &psz[9] );
+    free( psz );
+
+    for( ;; )
+    {
+        char *p;
+
+        psz = net_Gets( p_access, w->fd, pvs );
+        if( psz == NULL )
+            return VLC_EGENERIC;
+        if( *psz == '\0' )
+        {
+            free( psz );
+            break;
+        }
+        if( ( p = strchr( psz, ':' ) ) == NULL )
+        {
+            free( psz );
+            return VLC_EGENERIC;
+        }
+        *p++ = '\0';
+        p += strspn( p, " \t" );
+
+        if( !strcasecmp( psz, "Content-Length" ) )
+            i_length = strtoull( p, NULL, 10 );
+        else if( !strcasecmp( psz, "Content-Range" ) )
+            sscanf( p, "bytes %"SCNu64, &i_range );
+        else if( !strcasecmp( psz, "Connection" ) )
+        {
+            if( !strncasecmp( p, "close", 5 ) )
+                b_persist = false;
+        }
+        else if( !strcasecmp( psz, "Transfer-Encoding" ) ||
+                 ( !strcasecmp( psz, "Content-Encoding" ) &&
+                   strcasecmp( p, "identity" ) ) )
+            i_code = 0; /* not the plain range */
+        free( psz );
+    }
+
+    if( i_code != 206 || i_range != i_start || i_length != i_end - i_start )
+    {
+        msg_Err( p_access, "unexpected answer to range request (%d)", i_code );
+        return VLC_EGENERIC;
+    }
+    *pb_persist = b_persist;
+    return VLC_SUCCESS;
+}
+
+static void SegCleanup( void *data )
+{
+    http_worker_t *w = data;
+    access_sys_t *p_sys = w->p_access->p_sys;
+
+    vlc_mutex_lock( &p_sys->seg.lock );
+    if( w->p_seg != NULL && w->p_seg->b_cancel )
+        free( w->p_seg );
+    w->p_seg = NULL;
+    vlc_mutex_unlock( &p_sys->seg.lock );
+
+    SegClose( w, true );
+}
+
+static void *SegThread( void *data )
+{
+    http_worker_t *w = data;
+    access_t *p_access = w->p_access;
+    access_sys_t *p_sys = p_access->p_sys;
+
+    vlc_cleanup_push( SegCleanup, w );
+    for( ;; )
+    {
+        http_segment_t *p_seg;
+
+        vlc_mutex_lock( &p_sys->seg.lock );
+        mutex_cleanup_push( &p_sys->seg.lock );
+        while( ( p_seg = SegNext( p_access, w ) ) == NULL )
+            vlc_cond_wait( &p_sys->seg.wait, &p_sys->seg.lock );
+        vlc_cleanup_pop();
+        p_seg->b_busy = true;
+        w->p_seg = p_seg;
+        size_t i_offset = p_seg->i_filled;
+        const uint64_t i_start = p_seg->i_start + i_offset;
+        const uint64_t i_end = p_seg->i_start + p_seg->i_size;
+        vlc_mutex_unlock( &p_sys->seg.lock );
+
+        /* The TLS sessions are not cancellation-safe: killing the access
+         * interrupts the connection and the request instead */
+        int canc = vlc_savecancel();
+        mtime_t i_sent = mdate();
+        bool b_reused = true, b_persist = false;
+        int i_ret = VLC_EGENERIC;
+
+        if( w->fd != -1 || SegConnect( w, &b_reused ) == VLC_SUCCESS )
+        {
+            w->b_idle = false;
+            i_ret = SegRequest( w, i_start, i_end, &b_persist );
+            /* The server may have closed an idle connection meanwhile */
+            if( i_ret != VLC_SUCCESS && b_reused &&
+                vlc_object_alive( p_access ) )
+            {
+                msg_Dbg( p_access, "persistent connection lost, "
+                         "reconnecting" );
+                SegClose( w, false );
+                i_sent = mdate();
+                if( SegConnect( w, &b_reused ) == VLC_SUCCESS )
+                    i_ret = SegRequest( w, i_start, i_end, &b_persist );
+            }
+        }
+        vlc_restorecancel( canc );
+
+        mtime_t i_first = mdate();
+        v_socket_t *pvs = w->p_tls != NULL ? &w->p_tls->sock : NULL;
+        size_t i_left = i_ret == VLC_SUCCESS ? i_end - i_start : 0;
+        bool b_cancel = false;
+
+        /* Receive the segment, or skip the end of a dropped one to reuse
+         * the connection */
+        while( i_left > 0 && !( b_cancel && i_left > SEG_DRAIN_SIZE ) )
+        {
+            ssize_t i_read = net_Read( p_access, w->fd, pvs,
+                                       &p_seg->p_buffer[i_offset], i_left,
+                                       false );
+            if( i_read <= 0 )
+                break;
+            i_offset += i_read;
+            i_left -= i_read;
+            if( b_cancel )
+                continue;
+
+            vlc_mutex_lock( &p_sys->seg.lock );
+            p_seg->i_filled = i_offset;
+            p_sys->seg.i_received += i_read;
+            b_cancel = p_seg->b_cancel;
+            vlc_cond_signal( &p_sys->seg.data );
+            vlc_mutex_unlock( &p_sys->seg.lock );
+        }
+
+        const bool b_done = i_ret == VLC_SUCCESS && i_left == 0;
+        w->b_idle = b_done && b_persist;
+        if( !w->b_idle )
+            SegClose( w, false );
+
+        vlc_mutex_lock( &p_sys->seg.lock );
+        p_seg->b_busy = false;
+        w->p_seg = NULL;
+        if( b_done )
+            SegEstimate( p_access, i_sent, i_first, mdate(),
+                         i_end - i_start );
+        else if( !p_seg->b_cancel && ++p_seg->i_errors >= SEG_MAX_ERRORS )
+        {
+            msg_Err( p_access, "cannot receive bytes %"PRIu64" to %"PRIu64,
+                     p_seg->i_start, i_end );
+            p_sys->seg.b_error = true;
+            vlc_cond_signal( &p_sys->seg.data );
+        }
+        if( p_seg->b_cancel )
+            free( p_seg );
+        /* The segment may be resumed by another worker */
+        vlc_cond_broadcast( &p_sys->seg.wait );
+        vlc_mutex_unlock( &p_sys->seg.lock );
+    }
+    vlc_cleanup_pop();
+    return NULL;
+}
+
+static ssize_t SegRead( access_t *p_access, uint8_t *p_buffer, size_t i_len )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    http_segment_t *p_seg;
+    size_t i_offset;
+
+    vlc_mutex_lock( &p_sys->seg.lock );
+    for( ;; )
+    {
+        if( p_sys->seg.i_pos >= p_sys->size || p_sys->seg.b_error )
+        {
+            vlc_mutex_unlock( &p_sys->seg.lock );
+            p_access->info.b_eof = true;
+            return 0;
+        }
+
+        p_seg = p_sys->seg.i_queued > 0 ? p_sys->seg.queue[0] : NULL;
+        if( p_seg != NULL )
+        {
+            i_offset = p_sys->seg.i_pos - p_seg->i_start;
+            if( i_offset < p_seg->i_filled )
+                break;
+        }
+
+        if( !vlc_object_alive( p_access ) )
+        {
+            vlc_mutex_unlock( &p_sys->seg.lock );
+            return 0;
+        }
+        p_sys->seg.b_starved = true;
+        vlc_cond_timedwait( &p_sys->seg.data, &p_sys->seg.lock,
+                            mdate() + CLOCK_FREQ / 10 );
+    }
+
+    if( i_len > p_seg->i_filled - i_offset )
+        i_len = p_seg->i_filled - i_offset;
+    memcpy( p_buffer, &p_seg->p_buffer[i_offset], i_len );
+    p_sys->seg.i_pos += i_len;
+
+    /* Make room for the next segments */
+    if( i_offset + i_len == p_seg->i_size )
+    {
+        p_sys->seg.i_queued--;
+        memmove( &p_sys->seg.queue[0], &p_sys->seg.queue[1],
+                 p_sys->seg.i_queued * sizeof (p_sys->seg.queue[0]) );
+        SegDrop( p_seg );
+        vlc_cond_broadcast( &p_sys->seg.wait );
+    }
+    vlc_mutex_unlock( &p_sys->seg.lock );
+
+    p_access->info.i_pos += i_len;
+    return i_len;
+}
+
+static int SegSeek( access_t *p_access, uint64_t i_pos )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    vlc_mutex_lock( &p_sys->seg.lock );
+    uint64_t i_first = p_sys->seg.i_queued > 0 ?
+                       p_sys->seg.queue[0]->i_start : p_sys->seg.i_next;
+
+    if( i_pos < i_first || i_pos >= p_sys->seg.i_next )
+    {
+        /* Outside of the queued segments: start over from there */
+        for( unsigned i = 0; i < p_sys->seg.i_queued; i++ )
+            SegDrop( p_sys->seg.queue[i] );
+        p_sys->seg.i_queued = 0;
+        p_sys->seg.i_next = i_pos;
+    }
+    else
+    {
+        /* Keep the segments from the new position on */
+        unsigned i_drop = 0;
+        while( p_sys->seg.queue[i_drop]->i_start
+               + p_sys->seg.queue[i_drop]->i_size <= i_pos )
+            SegDrop( p_sys->seg.queue[i_drop++] );
+        p_sys->seg.i_queued -= i_drop;
+        memmove( &p_sys->seg.queue[0], &p_sys->seg.queue[i_drop],
+                 p_sys->seg.i_queued * sizeof (p_sys->seg.queue[0]) );
+    }
+    p_sys->seg.i_pos = i_pos;
+    p_sys->seg.b_error = false; /* try again */
+    vlc_cond_broadcast( &p_sys->seg.wait );
+    vlc_mutex_unlock( &p_sys->seg.lock );
+
+    p_access->info.i_pos = i_pos;
+    p_access->info.b_eof = false;
+    return VLC_SUCCESS;
+}
+
+static int SegStart( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    unsigned i_workers = var_InheritInteger( p_access, "http-segments" );
+
+    /* Only for a plain file of known size, served with range requests,
+     * without tunnel nor authentication */
+    if( i_workers < 2 || p_sys->fd == -1 || p_sys->i_code != 206 ||
+        !p_sys->b_seekable || !p_sys->b_has_size ||
+        p_sys->size < 4 * SEG_MIN_SIZE || p_sys->i_version != 1 ||
+        p_sys->b_continuous || p_sys->b_chunked || p_sys->i_icy_meta > 0 ||
+        p_sys->psz_conn_key == NULL || ( p_sys->b_tls && p_sys->b_proxy ) ||
+        p_sys->url.psz_username != NULL || p_sys->proxy.psz_username != NULL )
+        return VLC_EGENERIC;
+#ifdef HAVE_ZLIB_H
+    if( p_sys->b_compressed )
+        return VLC_EGENERIC;
+#endif
+    if( i_workers > SEG_MAX_WORKERS )
+        i_workers = SEG_MAX_WORKERS;
+
+    p_sys->seg.p_workers = malloc( i_workers * sizeof (http_worker_t) );
+    if( unlikely(p_sys->seg.p_workers == NULL) )
+        return VLC_ENOMEM;
+
+    vlc_mutex_init( &p_sys->seg.lock );
+    vlc_cond_init( &p_sys->seg.wait );
+    vlc_cond_init( &p_sys->seg.data );
+    p_sys->seg.i_queued = 0;
+    p_sys->seg.i_pos = p_access->info.i_pos;
+    p_sys->seg.i_next = p_access->info.i_pos;
+    p_sys->seg.i_size = SEG_MIN_SIZE;
+    p_sys->seg.b_error = false;
+    p_sys->seg.b_starved = false;
+    p_sys->seg.i_active = __MIN( 2, i_workers );
+    p_sys->seg.i_max = i_workers;
+    p_sys->seg.i_rtt = 0;
+    p_sys->seg.f_conn_rate = 0.;
+    p_sys->seg.f_rate = 0.;
+    p_sys->seg.i_received = 0;
+    p_sys->seg.i_date = mdate();
+
+    p_sys->seg.i_workers = 0;
+    for( unsigned i = 0; i < i_workers; i++ )
+    {
+        http_worker_t *w = &p_sys->seg.p_workers[i];
+
+        w->p_access = p_access;
+        w->i_index = i;
+        w->fd = -1;
+        w->p_tls = NULL;
+        w->b_idle = false;
+        w->p_seg = NULL;
+        if( vlc_clone( &w->thread, SegThread, w, VLC_THREAD_PRIORITY_INPUT ) )
+            break;
+        p_sys->seg.i_workers++;
+    }
+    if( p_sys->seg.i_workers == 0 )
+    {
+        SegStop( p_access );
+        return VLC_EGENERIC;
+    }
+
+    /* The workers do not need the first response */
+    Disconnect( p_access );
+    p_access->pf_read = SegRead;
+    p_access->pf_seek = SegSeek;
+    p_sys->b_segmented = true;
+    msg_Dbg( p_access, "segmented download with up to %u connections",
+             p_sys->seg.i_workers );
+    return VLC_SUCCESS;
+}
+
+static void SegStop( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    /* The idle connections go to the pool */
+    for( unsigned i = 0; i < p_sys->seg.i_workers; i++ )
+        vlc_cancel( p_sys->seg.p_workers[i].thread );
+    for( unsigned i = 0; i < p_sys->seg.i_workers; i++ )
+        vlc_join( p_sys->seg.p_workers[i].thread, NULL );
+
+    for( unsigned i = 0; i < p_sys->seg.i_queued; i++ )
+        free( p_sys->seg.queue[i] );
+    vlc_cond_destroy( &p_sys->seg.data );
+    vlc_cond_destroy( &p_sys->seg.wait );
+    vlc_mutex_destroy( &p_sys->seg.lock );
+    free( p_sys->seg.p_workers );
+}
+
 /*****************************************************************************
  * HTTP authentication
  *****************************************************************************/
@@ -96,6 +96,10 @@ static void Close( vlc_object_t * );
     "track, can be increased in case of broken pictures due " \
     "to too small buffer.")
 #define DEFAULT_FRAME_BUFFER_SIZE 100000
+#define SOCKET_BUFFER_SIZE_TEXT N_("RTP socket buffer size")
+#define SOCKET_BUFFER_SIZE_LONGTEXT N_("Size of the receive buffer of the " \
+    "RTP sockets in bytes, so that no packet is lost while VLC is busy. " \
+    "With 0, it is sized after the bitrate announced by the server.")
 
 vlc_module_begin ()
     set_description( N_("RTP/RTSP/SDP demuxer (using Live555)" ) )
@@ -144,6 +148,9 @@ vlc_module_begin ()
         add_integer( "rtsp-frame-buffer-size", DEFAULT_FRAME_BUFFER_SIZE,
                      FRAME_BUFFER_SIZE_TEXT, FRAME_BUFFER_SIZE_LONGTEXT,
                      true )
+        add_integer( "rtsp-socket-buffer-size", 0,
+                     SOCKET_BUFFER_SIZE_TEXT, SOCKET_BUFFER_SIZE_LONGTEXT,
+                     true )
 vlc_module_end ()
 
 
@@ -176,6 +183,10 @@ typedef struct
 
     bool            b_selected;
 
+    /* RTP reception statistics, as last reported */
+    unsigned        i_received;
+    int             i_lost;
+
 } live_track_t;
 
 struct timeout_thread_t
@@ -223,6 +234,7 @@ struct demux_sys_t
     bool             b_multicast;   /* if one of the tracks is multicasted */
     bool             b_no_data;     /* if we never received any data */
     int              i_no_data_ti;  /* consecutive number of TaskInterrupt */
+    mtime_t          i_stats_date;  /* last check of the RTP losses */
 
     char             event_rtsp;
     char             event_data;
@@ -270,6 +282,7 @@ static void TaskInterruptData( void * );
 static void TaskInterruptRTSP( void * );
 
 static void* TimeoutPrevention( void * );
+static void StatsUpdate( demux_t *, bool );
 
 static unsigned char* parseH264ConfigStr( char const* configStr,
                                           unsigned int& configSize );
@@ -438,6 +451,8 @@ static void Close( vlc_object_t *p_this )
         free( p_sys->p_timeout );
     }
 
+    StatsUpdate( p_demux, true );
+
     if( p_sys->rtsp && p_sys->ms ) p_sys->rtsp->sendTeardownCommand( *p_sys->ms, NULL );
     if( p_sys->ms ) Medium::close( p_sys->ms );
     if( p_sys->rtsp ) RTSPClient::close( p_sys->rtsp );
@@ -683,6 +698,7 @@ static int SessionsSetup( demux_t *p_demux )
     int            i_client_port;
     int            i_return = VLC_SUCCESS;
     unsigned int   i_receive_buffer = 0;
+    int            i_socket_buffer;
     int            i_frame_buffer = DEFAULT_FRAME_BUFFER_SIZE;
     unsigned const thresh = 200000; /* RTP reorder threshold .2 second (default .1) */
     const char     *p_sess_lang = NULL;
@@ -691,6 +707,7 @@ static int SessionsSetup( demux_t *p_demux )
     b_rtsp_tcp    = var_CreateGetBool( p_demux, "rtsp-tcp" ) ||
                     var_GetBool( p_demux, "rtsp-http" );
     i_client_port = var_InheritInteger( p_demux, "rtp-client-port" );
+    i_socket_buffer = var_InheritInteger( p_demux, "rtsp-socket-buffer-size" );
 
 
     /* Create the session from the SDP */
@@ -772,9 +789,27 @@ static int SessionsSetup( demux_t *p_demux )
             {
                 int fd = sub->rtpSource()->RTPgs()->socketNum();
 
-                /* Increase the buffer size */
+                /* Increase the buffer size, so that it holds about a
+                 * second of a high bitrate stream (b=AS: is in kbit/s) */
+                if( i_socket_buffer > 0 )
+                    i_receive_buffer = i_socket_buffer;
+                else if( i_receive_buffer > 0 &&
+                         sub->bandwidth() * 125 > i_receive_buffer )
+                    i_receive_buffer = __MIN( sub->bandwidth() * 125,
+                                              32 * 1024 * 1024 );
                 if( i_receive_buffer > 0 )
-                    increaseReceiveBufferTo( *p_sys->env, fd, i_receive_buffer );
+                {
+                    unsigned i_got = increaseReceiveBufferTo( *p_sys->env, fd,
+                                                              i_receive_buffer );
+                    if( i_got < i_receive_buffer )
+                        msg_Warn( p_demux, "RTP socket buffer of %u bytes "
+                                  "instead of %u, packets may be lost (see "
+                                  "the system limits)", i_got,
+                                  i_receive_buffer );
+                    else
+                        msg_Dbg( p_demux, "RTP socket buffer of %u bytes",
+                                 i_got );
+                }
 
                 /* Increase the RTP reorder timebuffer just a bit */
                 sub->rtpSource()->setPacketReorderingThresholdTime(thresh);
@@ -839,6 +874,8 @@ static int SessionsSetup( demux_t *p_demux )
             tk->i_pts       = VLC_TS_INVALID;
             tk->f_npt       = 0.;
             tk->b_selected  = true;
+            tk->i_received  = 0;
+            tk->i_lost      = 0;
             tk->i_buffer    = i_frame_buffer;
             tk->p_buffer    = (uint8_t *)malloc( i_frame_buffer );
 
@@ -1356,6 +1393,13 @@ static int Demux( demux_t *p_demux )
     /* remove the task */
     p_sys->scheduler->unscheduleDelayedTask( task );
 
+    /* Report the RTP losses from time to time */
+    if( mdate() - p_sys->i_stats_date > 5 * CLOCK_FREQ )
+    {
+        StatsUpdate( p_demux, false );
+        p_sys->i_stats_date = mdate();
+    }
+
     /* Check for gap in pts value */
     for( i = 0; i < p_sys->i_track; i++ )
     {
@@ -1413,6 +1457,47 @@ static int Demux( demux_t *p_demux )
     return p_sys->b_error ? 0 : 1;
 }
 
+/*****************************************************************************
+ * StatsUpdate: reports the RTP packets lost per subsession, as seen by the
+ * live555 reception statistics (after its own reordering)
+ *****************************************************************************/
+static void StatsUpdate( demux_t *p_demux, bool b_final )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( int i = 0; i < p_sys->i_track; i++ )
+    {
+        live_track_t *tk = p_sys->track[i];
+        RTPSource *src = tk->sub->rtpSource();
+
+        if( src == NULL )
+            continue;
+
+        unsigned i_received = 0, i_expected = 0;
+        RTPReceptionStatsDB::Iterator it( src->receptionStatsDB() );
+        RTPReceptionStats *stats;
+        while( ( stats = it.next( True ) ) != NULL )
+        {
+            i_received += stats->totNumPacketsReceived();
+            i_expected += stats->totNumPacketsExpected();
+        }
+
+        /* negative with duplicated packets */
+        int i_lost = (int)( i_expected - i_received );
+        if( b_final )
+            msg_Dbg( p_demux, "RTP subsession '%s/%s': %u packets received, "
+                     "%d lost", tk->sub->mediumName(), tk->sub->codecName(),
+                     i_received, i_lost );
+        else if( i_lost > tk->i_lost )
+            msg_Warn( p_demux, "RTP subsession '%s/%s': %d packets lost "
+                      "out of %u", tk->sub->mediumName(),
+                      tk->sub->codecName(), i_lost - tk->i_lost,
+                      i_received - tk->i_received + i_lost - tk->i_lost );
+        tk->i_received = i_received;
+        tk->i_lost = i_lost;
+    }
+}
+
 /*****************************************************************************
  * Control:
  *****************************************************************************/
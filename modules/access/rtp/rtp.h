@@ -51,6 +51,7 @@ void xiph_decode (demux_t *demux, void *data, block_t *block);
 rtp_session_t *rtp_session_create (demux_t *);
 void rtp_session_destroy (demux_t *, rtp_session_t *);
 void rtp_queue (demux_t *, rtp_session_t *, block_t *);
+void rtp_fec_queue (demux_t *, rtp_session_t *, block_t *);
 bool rtp_dequeue (demux_t *, const rtp_session_t *, mtime_t *);
 void rtp_dequeue_force (demux_t *, const rtp_session_t *);
 int rtp_add_type (demux_t *demux, rtp_session_t *ses, const rtp_pt_t *pt);
@@ -68,6 +69,7 @@ struct demux_sys_t
 #endif
     int           fd;
     int           rtcp_fd;
+    int           fec_fd[2]; /**< SMPTE 2022-1 column and row FEC sockets */
     vlc_thread_t  thread;
 
     mtime_t       timeout;
@@ -76,5 +78,6 @@ struct demux_sys_t
     uint8_t       max_src; /**< Max simultaneous RTP sources */
     bool          thread_ready;
     bool          autodetect; /**< Payload type autodetection pending */
+    bool          fec; /**< FEC recovery enabled */
 };
 
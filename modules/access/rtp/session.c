@@ -35,6 +35,13 @@
 
 typedef struct rtp_source_t rtp_source_t;
 
+#define RTP_HISTORY      256  /* packets kept for FEC recovery (power of 2) */
+#define RTP_FEC_PENDING  64   /* FEC packets waiting for media packets */
+#define RTP_DELAY_BINS   2048 /* de-jitter delay histogram, 1 ms per bin */
+#define RTP_DELAY_WINDOW 8192 /* samples before the histogram decays */
+#define RTP_DELAY_MIN    (CLOCK_FREQ / 40)
+#define RTP_REPORT_INTERVAL (10 * CLOCK_FREQ)
+
 /** State for a RTP session: */
 struct rtp_session_t
 {
@@ -42,6 +49,8 @@ struct rtp_session_t
     unsigned       srcc;
     uint8_t        ptc;
     rtp_pt_t      *ptv;
+    block_t       *fecv[RTP_FEC_PENDING]; /* FEC packets, by arrival order */
+    unsigned       fecc;
 };
 
 static rtp_source_t *
@@ -50,6 +59,8 @@ static void
 rtp_source_destroy (demux_t *, const rtp_session_t *, rtp_source_t *);
 
 static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
+static void rtp_source_report (demux_t *, const rtp_source_t *);
+static void rtp_source_queue (demux_t *, rtp_source_t *, block_t *);
 
 /**
  * Creates a new RTP session.
@@ -65,6 +76,7 @@ rtp_session_create (demux_t *demux)
     session->srcc = 0;
     session->ptc = 0;
     session->ptv = NULL;
+    session->fecc = 0;
 
     (void)demux;
     return session;
@@ -78,6 +90,8 @@ void rtp_session_destroy (demux_t *demux, rtp_session_t *session)
 {
     for (unsigned i = 0; i < session->srcc; i++)
         rtp_source_destroy (demux, session, session->srcv[i]);
+    for (unsigned i = 0; i < session->fecc; i++)
+        block_Release (session->fecv[i]);
 
     free (session->srcv);
     free (session->ptv);
@@ -149,6 +163,25 @@ struct rtp_source_t
 
     uint16_t last_seq; /* sequence of the next dequeued packet */
     block_t *blocks; /* re-ordered blocks queue */
+
+    /* De-jitter buffer depth, from the distribution of the transit delays
+     * above the lowest one (RFC 3550 §A.8 relative transit time) */
+    int64_t  ext_ts;      /* extended RTP timestamp of the last packet */
+    mtime_t  transit_base; /* lowest transit delay */
+    mtime_t  transit_min; /* lowest transit delay in the current window */
+    uint32_t delay_hist[RTP_DELAY_BINS];
+    unsigned delay_count;
+    mtime_t  depth;       /* 99.9th percentile of the delays */
+    mtime_t  fec_delay;   /* delay until FEC packets can recover losses */
+    block_t **history;    /* recent packets by sequence, for FEC recovery */
+
+    /* Statistics */
+    uint64_t received;
+    uint64_t lost;
+    uint64_t late;
+    uint64_t recovered;
+    mtime_t  last_report;
+
     void    *opaque[]; /* Per-source private payload data */
 };
 
@@ -174,6 +207,27 @@ rtp_source_create (demux_t *demux, const rtp_session_t *session,
     source->last_seq = init_seq - 1;
     source->blocks = NULL;
 
+    source->ext_ts = 0;
+    source->transit_base = INT64_MAX;
+    source->transit_min = INT64_MAX;
+    memset (source->delay_hist, 0, sizeof (source->delay_hist));
+    source->delay_count = 0;
+    source->depth = RTP_DELAY_MIN;
+    source->fec_delay = 0;
+    source->history = NULL;
+    if (((demux_sys_t *)demux->p_sys)->fec)
+    {
+        source->history = calloc (RTP_HISTORY, sizeof (block_t *));
+        if (unlikely(source->history == NULL))
+        {
+            free (source);
+            return NULL;
+        }
+    }
+
+    source->received = source->lost = source->late = source->recovered = 0;
+    source->last_report = mdate ();
+
     /* Initializes all payload */
     for (unsigned i = 0; i < session->ptc; i++)
         source->opaque[i] = session->ptv[i].init (demux);
@@ -191,13 +245,76 @@ rtp_source_destroy (demux_t *demux, const rtp_session_t *session,
                     rtp_source_t *source)
 {
     msg_Dbg (demux, "removing RTP source (%08x)", source->ssrc);
+    rtp_source_report (demux, source);
 
     for (unsigned i = 0; i < session->ptc; i++)
         session->ptv[i].destroy (demux, source->opaque[i]);
     block_ChainRelease (source->blocks);
+    if (source->history != NULL)
+    {
+        for (unsigned i = 0; i < RTP_HISTORY; i++)
+            if (source->history[i] != NULL)
+                block_Release (source->history[i]);
+        free (source->history);
+    }
     free (source);
 }
 
+static void rtp_source_report (demux_t *demux, const rtp_source_t *src)
+{
+    msg_Dbg (demux, "RTP source (%08x): %"PRIu64" packet(s) received, "
+             "%"PRIu64" lost, %"PRIu64" late, %"PRIu64" recovered, "
+             "buffer depth %"PRId64" ms", src->ssrc, src->received, src->lost,
+             src->late, src->recovered,
+             __MAX(src->depth, src->fec_delay) / (CLOCK_FREQ / 1000));
+}
+
+/**
+ * Accounts the transit delay of a packet, and updates the depth of the
+ * de-jitter buffer to hold 99.9% of the packets.
+ */
+static void rtp_source_delay (rtp_source_t *src, mtime_t now, uint32_t ts,
+                              uint32_t freq)
+{
+    src->ext_ts += (int32_t)(ts - src->last_ts);
+
+    mtime_t transit = now - src->ext_ts * CLOCK_FREQ / freq;
+    if (transit < src->transit_base)
+        src->transit_base = transit;
+    if (transit < src->transit_min)
+        src->transit_min = transit;
+
+    mtime_t delay = (transit - src->transit_base) / (CLOCK_FREQ / 1000);
+    src->delay_hist[__MIN(delay, RTP_DELAY_BINS - 1)]++;
+    src->delay_count++;
+
+    if (src->delay_count % 64 == 0)
+    {
+        unsigned target = src->delay_count - src->delay_count / 1000;
+        unsigned bin = 0;
+
+        for (unsigned sum = 0; bin < RTP_DELAY_BINS - 1; bin++)
+        {
+            sum += src->delay_hist[bin];
+            if (sum >= target)
+                break;
+        }
+        src->depth = __MAX((bin + 1) * (CLOCK_FREQ / 1000), RTP_DELAY_MIN);
+    }
+
+    if (src->delay_count >= RTP_DELAY_WINDOW)
+    {   /* Forget old samples, and follow the clock drift */
+        src->delay_count = 0;
+        for (unsigned i = 0; i < RTP_DELAY_BINS; i++)
+        {
+            src->delay_hist[i] /= 2;
+            src->delay_count += src->delay_hist[i];
+        }
+        src->transit_base = src->transit_min;
+        src->transit_min = INT64_MAX;
+    }
+}
+
 static inline uint16_t rtp_seq (const block_t *block)
 {
     assert (block->i_buffer >= 4);
@@ -317,11 +434,36 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
             d        -=    ts - src->last_ts;
             if (d < 0) d = -d;
             src->jitter += ((d - src->jitter) + 8) >> 4;
+
+            rtp_source_delay (src, now, ts, freq);
         }
     }
     src->last_rx = now;
     block->i_pts = now; /* store reception time until dequeued */
     src->last_ts = rtp_timestamp (block);
+    src->received++;
+
+    if (now - src->last_report >= RTP_REPORT_INTERVAL)
+    {
+        rtp_source_report (demux, src);
+        src->last_report = now;
+    }
+
+    rtp_source_queue (demux, src, block);
+    return;
+
+drop:
+    block_Release (block);
+}
+
+/**
+ * Queues a packet of a source in sequence order.
+ */
+static void
+rtp_source_queue (demux_t *demux, rtp_source_t *src, block_t *block)
+{
+    demux_sys_t *p_sys = demux->p_sys;
+    const uint16_t seq = rtp_seq (block);
 
     /* Check sequence number */
     /* NOTE: the sequence number is per-source,
@@ -365,6 +507,21 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
         }
         pp = &prev->p_next;
     }
+
+    if (src->history != NULL)
+    {   /* Keep a reference for FEC recovery */
+        block = block_Share (block);
+
+        block_t *ref = block_Clone (block);
+        block_t **slot = &src->history[seq % RTP_HISTORY];
+        if (likely(ref != NULL))
+        {
+            if (*slot != NULL)
+                block_Release (*slot);
+            *slot = ref;
+        }
+    }
+
     block->p_next = *pp;
     *pp = block;
 
@@ -375,6 +532,177 @@ drop:
     block_Release (block);
 }
 
+/*
+ * SMPTE 2022-1 forward error correction
+ *
+ * Each FEC packet carries the XOR of the protected media packets (the
+ * payloads, lengths, payload types and timestamps), NA packets evenly spaced
+ * by Offset from SNBase: a column of the matrix (Offset = L, NA = D) or a row
+ * (Offset = 1, NA = L). Any single missing packet can be rebuilt. Media
+ * packets are assumed to have no CSRC, extension or padding, as MPEG-TS
+ * senders do.
+ */
+
+/**
+ * Tries to recover a packet with a FEC packet.
+ * @return 0 if the FEC packet is no longer needed, 1 if more than one
+ * protected packet is still missing.
+ */
+static int rtp_fec_recover (demux_t *demux, rtp_source_t *src,
+                            const block_t *fec)
+{
+    const uint8_t *hdr = fec->p_buffer + 12;
+    const uint16_t base = GetWBE (hdr);
+    const unsigned offset = hdr[13], na = hdr[14];
+
+    if ((hdr[12] & 0x38) != 0 /* not XOR */
+     || offset == 0 || na == 0 || (na - 1) * offset >= RTP_HISTORY)
+        return 0;
+    /* Too late if all protected packets were dequeued */
+    if ((int16_t)(base + (na - 1) * offset - src->last_seq) <= 0)
+        return 0;
+
+    const block_t *ref = NULL;
+    unsigned missing = 0;
+    uint16_t lost_seq = 0;
+
+    for (unsigned i = 0; i < na; i++)
+    {
+        uint16_t seq = base + i * offset;
+        const block_t *pkt = src->history[seq % RTP_HISTORY];
+
+        if (pkt == NULL || rtp_seq (pkt) != seq)
+        {
+            missing++;
+            lost_seq = seq;
+        }
+        else
+            ref = pkt;
+    }
+
+    if (missing == 0
+     || (int16_t)(lost_seq - src->last_seq) <= 0 /* given up already */)
+        return 0;
+    if (missing > 1)
+        return 1;
+    if (ref == NULL)
+        return 0;
+
+    /* Rebuild the missing packet */
+    size_t len = GetWBE (hdr + 2);
+    uint8_t ptype = hdr[4] & 0x7F;
+    uint32_t ts = GetDWBE (hdr + 8);
+
+    for (unsigned i = 0; i < na; i++)
+    {
+        uint16_t seq = base + i * offset;
+        const block_t *pkt = src->history[seq % RTP_HISTORY];
+
+        if (seq == lost_seq)
+            continue;
+        len ^= pkt->i_buffer - 12;
+        ptype ^= rtp_ptype (pkt);
+        ts ^= rtp_timestamp (pkt);
+    }
+
+    if (len > fec->i_buffer - 28)
+        return 0;
+
+    block_t *block = block_Alloc (12 + len);
+    if (unlikely(block == NULL))
+        return 0;
+
+    block->p_buffer[0] = 0x80;
+    block->p_buffer[1] = ptype;
+    SetWBE (block->p_buffer + 2, lost_seq);
+    SetDWBE (block->p_buffer + 4, ts);
+    memcpy (block->p_buffer + 8, ref->p_buffer + 8, 4); /* SSRC */
+    memcpy (block->p_buffer + 12, fec->p_buffer + 28, len);
+
+    for (unsigned i = 0; i < na; i++)
+    {
+        uint16_t seq = base + i * offset;
+        const block_t *pkt = src->history[seq % RTP_HISTORY];
+
+        if (seq == lost_seq)
+            continue;
+
+        size_t n = __MIN(len, pkt->i_buffer - 12);
+        for (size_t j = 0; j < n; j++)
+            block->p_buffer[12 + j] ^= pkt->p_buffer[12 + j];
+    }
+
+    msg_Dbg (demux, "recovered packet (sequence: %"PRIu16")", lost_seq);
+    block->i_pts = mdate ();
+    src->recovered++;
+    rtp_source_queue (demux, src, block);
+    return 0;
+}
+
+/**
+ * Receives a FEC packet, and recovers the media packets it can.
+ * Not a cancellation point.
+ */
+void rtp_fec_queue (demux_t *demux, rtp_session_t *session, block_t *block)
+{
+    /* FEC protects the most recently active source */
+    rtp_source_t *src = NULL;
+    for (unsigned i = 0; i < session->srcc; i++)
+        if (src == NULL || session->srcv[i]->last_rx > src->last_rx)
+            src = session->srcv[i];
+
+    if (src == NULL || src->history == NULL
+     || block->i_buffer < 12 + 16 || (block->p_buffer[0] >> 6) != 2)
+    {
+        block_Release (block);
+        return;
+    }
+
+    /* Measure how long after the first protected packet the FEC packet
+     * arrives: losses must be waited for at least as long. */
+    mtime_t now = mdate ();
+    uint16_t base = GetWBE (block->p_buffer + 12);
+    const block_t *first = src->history[base % RTP_HISTORY];
+    if (first != NULL && rtp_seq (first) == base)
+    {
+        mtime_t delay = now - first->i_pts;
+        if (delay > src->fec_delay)
+            src->fec_delay = delay;
+        else
+            src->fec_delay -= (src->fec_delay - delay) / 64;
+    }
+
+    if (session->fecc == RTP_FEC_PENDING)
+    {
+        block_Release (session->fecv[0]);
+        memmove (session->fecv, session->fecv + 1,
+                 --session->fecc * sizeof (session->fecv[0]));
+    }
+    session->fecv[session->fecc++] = block;
+
+    /* A recovered packet can make another recovery possible */
+    bool progress;
+    do
+    {
+        progress = false;
+        for (unsigned i = 0; i < session->fecc; i++)
+        {
+            uint64_t recovered = src->recovered;
+
+            if (rtp_fec_recover (demux, src, session->fecv[i]) == 0)
+            {
+                block_Release (session->fecv[i]);
+                memmove (session->fecv + i, session->fecv + i + 1,
+                         (--session->fecc - i) * sizeof (session->fecv[0]));
+                i--;
+            }
+            if (src->recovered != recovered)
+                progress = true;
+        }
+    }
+    while (progress);
+}
+
 
 static void rtp_decode (demux_t *, const rtp_session_t *, rtp_source_t *);
 
@@ -427,19 +755,11 @@ bool rtp_dequeue (demux_t *demux, const rtp_session_t *session,
                 continue;
             }
 
-            /* Wait for 3 times the inter-arrival delay variance (about 99.7%
-             * match for random gaussian jitter).
+            /* Wait as long as 99.9% of the packets are delayed (from the
+             * measured distribution, at least 25 msec), or for FEC packets
+             * to recover the missing ones, whichever is longer.
              */
-            mtime_t deadline;
-            const rtp_pt_t *pt = rtp_find_ptype (session, src, block, NULL);
-            if (pt)
-                deadline = CLOCK_FREQ * 3 * src->jitter / pt->frequency;
-            else
-                deadline = 0; /* no jitter estimate with no frequency :( */
-
-            /* Make sure we wait at least for 25 msec */
-            if (deadline < (CLOCK_FREQ / 40))
-                deadline = CLOCK_FREQ / 40;
+            mtime_t deadline = __MAX(src->depth, src->fec_delay);
 
             /* Additionnaly, we implicitly wait for the packetization time
              * multiplied by the number of missing packets. block is the first
@@ -497,9 +817,11 @@ rtp_decode (demux_t *demux, const rtp_session_t *session, rtp_source_t *src)
         {   /* Trash too late packets (and PIM Assert duplicates) */
             msg_Dbg (demux, "ignoring late packet (sequence: %"PRIu16")",
                       rtp_seq (block));
+            src->late++;
             goto drop;
         }
         msg_Warn (demux, "%"PRIu16" packet(s) lost", delta_seq);
+        src->lost += delta_seq;
         block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
     }
     src->last_seq = rtp_seq (block);
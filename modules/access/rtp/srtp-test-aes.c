@@ -18,6 +18,7 @@
  */
 
 #include <stdio.h>
+#include <time.h>
 #include "srtp.c"
 
 static void printhex (const void *buf, size_t len)
@@ -141,10 +142,170 @@ static void test_keystream (void)
     free (buf);
 }
 
+#define BATCH_PACKETS 256
+#define BATCH_SIZE    1500
+
+/** Writes a RTP header (with CSRCs for some packets), and a payload */
+static size_t fill_packet (uint8_t *buf, unsigned i, uint16_t seq, size_t len)
+{
+    unsigned cc = i % 3;
+
+    if (len < 12 + 4 * cc)
+        len = 12 + 4 * cc;
+    for (size_t j = 0; j < len; j++)
+        buf[j] = i + j;
+    buf[0] = 0x80 | cc;
+    buf[2] = seq >> 8;
+    buf[3] = seq;
+    return len;
+}
+
+static srtp_session_t *batch_session (unsigned flags, bool hw)
+{
+    srtp_session_t *s = srtp_create (SRTP_ENCR_AES_CM, SRTP_AUTH_HMAC_SHA1,
+                                     10, SRTP_PRF_AES_CM, flags);
+    if (s == NULL
+     || srtp_setkeystring (s, "123456789ABCDEF0123456789ABCDEF0",
+                           "1234567890123456789012345678"))
+        fatal ("Session initialization error");
+
+    /* Without the CPU instructions, everything goes through libgcrypt */
+    if (!hw)
+    {
+#ifdef SRTP_AES_HW
+        s->rtp.aes_hw = false;
+#endif
+#ifdef SRTP_SHA_HW
+        s->rtp.sha1_hw = false;
+#endif
+    }
+    return s;
+}
+
+/** Batched encryption must match the libgcrypt packet per packet one */
+static void test_batch (unsigned flags)
+{
+    static uint8_t ref[BATCH_PACKETS][BATCH_SIZE + 10];
+    static uint8_t bat[BATCH_PACKETS][BATCH_SIZE + 10];
+    uint8_t *bufv[BATCH_PACKETS];
+    size_t lenv[BATCH_PACKETS], sizev[BATCH_PACKETS];
+    int errv[BATCH_PACKETS];
+
+    printf ("SRTP batch test (flags 0x%02X)...\n", flags);
+    srtp_session_t *sr = batch_session (flags, false);
+    srtp_session_t *sb = batch_session (flags, true);
+
+    for (unsigned i = 0; i < BATCH_PACKETS; i++)
+    {
+        /* 0xfff0 + i: the Roll-Over-Counter increments within the batch.
+         * Some sequence numbers are replayed and must be rejected. */
+        uint16_t seq = 0xfff0 + ((i % 17) ? i : i / 2);
+        size_t len = fill_packet (ref[i], i, seq, (i * 97) % BATCH_SIZE);
+
+        memcpy (bat[i], ref[i], len);
+        bufv[i] = bat[i];
+        lenv[i] = len;
+        sizev[i] = (i == 5) ? len : len + 10; /* one too small buffer */
+
+        errv[i] = srtp_send (sr, ref[i], &len, sizev[i]);
+        if (errv[i] == 0 && len != lenv[i] + ((flags & SRTP_UNAUTHENTICATED)
+                                              ? 0 : 10))
+            fatal ("Bad packet length");
+    }
+
+    int refv[BATCH_PACKETS];
+    memcpy (refv, errv, sizeof (refv));
+
+    unsigned errc = srtp_send_batch (sb, bufv, lenv, sizev, errv,
+                                     BATCH_PACKETS);
+    for (unsigned i = 0; i < BATCH_PACKETS; i++)
+    {
+        if (errv[i] != refv[i])
+            fatal ("Batch error code mismatch");
+        if (errv[i] == 0)
+        {
+            errc++;
+            if (memcmp (ref[i], bat[i], lenv[i]))
+                fatal ("Batch test failed");
+        }
+    }
+    if (errc != BATCH_PACKETS)
+        fatal ("Batch error count mismatch");
+
+    srtp_destroy (sb);
+    srtp_destroy (sr);
+}
+
+/**
+ * Compares the throughput of srtp_send() with libgcrypt only, srtp_send()
+ * and srtp_send_batch(), keeping the best of a few runs
+ */
+static void bench_batch (size_t size)
+{
+    static uint8_t bat[BATCH_PACKETS][BATCH_SIZE + 10];
+    static const char *const names[3] = {
+        "srtp_send (libgcrypt):", "srtp_send:", "srtp_send_batch:" };
+    uint8_t *bufv[BATCH_PACKETS];
+    size_t lenv[BATCH_PACKETS], sizev[BATCH_PACKETS];
+    int errv[BATCH_PACKETS];
+    const unsigned runs = 5, loops = 20;
+
+    printf ("SRTP batch benchmark (%zu bytes packets)...\n", size);
+    for (unsigned i = 0; i < BATCH_PACKETS; i++)
+    {
+        bufv[i] = bat[i];
+        sizev[i] = sizeof (bat[i]);
+    }
+
+    for (int mode = 0; mode < 3; mode++)
+    {
+        srtp_session_t *s = batch_session (0, mode > 0);
+        clock_t best = 0;
+        uint16_t seq = 0;
+
+        for (unsigned run = 0; run < runs; run++)
+        {
+            clock_t total = 0;
+
+            for (unsigned n = 0; n < loops; n++)
+            {
+                for (unsigned i = 0; i < BATCH_PACKETS; i++)
+                    lenv[i] = fill_packet (bat[i], i, seq++, size);
+
+                clock_t start = clock ();
+                if (mode == 2)
+                {
+                    if (srtp_send_batch (s, bufv, lenv, sizev, errv,
+                                         BATCH_PACKETS))
+                        fatal ("Batch encryption error");
+                }
+                else
+                    for (unsigned i = 0; i < BATCH_PACKETS; i++)
+                        if (srtp_send (s, bufv[i], lenv + i, sizev[i]))
+                            fatal ("Encryption error");
+                total += clock () - start;
+            }
+            if (run == 0 || total < best)
+                best = total;
+        }
+
+        double secs = (double)best / CLOCKS_PER_SEC;
+        printf (" %-22s %8.1f MB/s\n", names[mode],
+                (secs > 0.) ? loops * BATCH_PACKETS * size / secs / 1e6 : 0.);
+        srtp_destroy (s);
+    }
+}
+
 static void srtp_test (void)
 {
     test_derivation ();
     test_keystream ();
+    test_batch (0);
+    test_batch (SRTP_RCC_MODE2);
+    test_batch (SRTP_UNAUTHENTICATED);
+    test_batch (SRTP_UNENCRYPTED);
+    bench_batch (172); /* audio */
+    bench_batch (1328); /* video */
 }
 
 int main (void)
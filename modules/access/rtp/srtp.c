@@ -45,14 +45,41 @@
 # include <netinet/in.h>
 #endif
 
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+# include <cpuid.h>
+# include <immintrin.h>
+# define SRTP_AES_HW 1 /* AES-NI, if the CPU has it */
+# define SRTP_SHA_HW 1 /* SHA extensions, if the CPU has them */
+#elif (defined (__ARM_FEATURE_CRYPTO) || defined (__ARM_FEATURE_AES)) \
+   && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+# include <arm_neon.h>
+# define SRTP_AES_HW 1 /* ARMv8 Cryptography Extensions */
+#endif
+
 #define debug( ... ) (void)0
 
+/** Maximum number of packets encrypted in one pass by srtp_send_batch() */
+#define SRTP_BATCH 64
+/** Payload length from which libgcrypt encrypts the whole blocks */
+#define SRTP_BULK_MIN 256
+
 typedef struct srtp_proto_t
 {
     gcry_cipher_hd_t cipher;
     gcry_md_hd_t     mac;
     uint64_t         window;
     uint32_t         salt[4];
+    bool             aes;
+    bool             sha1;
+#ifdef SRTP_AES_HW
+    bool             aes_hw; /**< aes_rk is usable by the CPU instructions */
+    uint8_t          aes_rk[11][16]; /**< expanded AES-128 session key */
+#endif
+#ifdef SRTP_SHA_HW
+    bool             sha1_hw; /**< sha1_pads are usable */
+    uint32_t         sha1_pads[2][5]; /**< HMAC inner and outer states */
+    uint8_t          tag[20]; /**< last computed HMAC */
+#endif
 } srtp_proto_t;
 
 struct srtp_session_t
@@ -107,6 +134,8 @@ void srtp_destroy (srtp_session_t *s)
 
 static int proto_create (srtp_proto_t *p, int gcipher, int gmd)
 {
+    p->aes = gcipher == GCRY_CIPHER_AES;
+    p->sha1 = gmd == GCRY_MD_SHA1;
     if (gcry_cipher_open (&p->cipher, gcipher, GCRY_CIPHER_MODE_CTR, 0) == 0)
     {
         if (gcry_md_open (&p->mac, gmd, GCRY_MD_FLAG_HMAC) == 0)
@@ -229,6 +258,385 @@ do_ctr_crypt (gcry_cipher_hd_t hd, const void *ctr, uint8_t *data, size_t len)
 }
 
 
+/**
+ * Counter Mode state of a packet within a batch
+ */
+typedef struct
+{
+    uint8_t *data; /**< remaining text */
+    size_t   len; /**< remaining text length (less than 2^20 bytes) */
+    uint32_t ctr[4]; /**< first counter block */
+    uint32_t block; /**< index of the next counter block */
+} srtp_ctr_t;
+
+#ifdef SRTP_AES_HW
+/* Number of blocks encrypted in parallel, to hide the rounds latency */
+# define AES_LANES 8
+
+/*
+ * The low 16 bits of the first counter block are nul (see rtp_counter()),
+ * and a packet has less than 2^16 blocks: the counter never carries out of
+ * its last 32-bits word.
+ */
+
+/**
+ * Gathers the next counter blocks of a batch, going from a packet to the
+ * next one, so that the lanes stay busy whatever the packet lengths.
+ * A block is returned as its packet first block and its last word.
+ *
+ * @return the number of gathered blocks (0 at the end of the batch)
+ */
+static inline unsigned
+ctr_gather (srtp_ctr_t *ctrv, unsigned ctrc, unsigned *cur,
+            const uint32_t **iv, uint32_t *lo, uint8_t **dst, size_t *len)
+{
+    unsigned n = 0;
+
+    while (n < AES_LANES && *cur < ctrc)
+    {
+        srtp_ctr_t *c = ctrv + *cur;
+        uint8_t *data = c->data;
+        size_t left = c->len;
+        uint32_t block = c->block;
+
+        if (left == 0)
+        {
+            (*cur)++;
+            continue;
+        }
+
+        do
+        {
+            iv[n] = c->ctr;
+            lo[n] = htonl (ntohl (c->ctr[3]) + block++);
+            dst[n] = data;
+            len[n] = (left < 16) ? left : 16;
+            data += len[n];
+            left -= len[n];
+            n++;
+        }
+        while (n < AES_LANES && left > 0);
+
+        c->data = data;
+        c->len = left;
+        c->block = block;
+    }
+    return n;
+}
+
+# if defined (__x86_64__) || defined (__i386__)
+#  define AES_TARGET __attribute__((target("aes,sse4.1")))
+
+static AES_TARGET uint32_t aes_subword (uint32_t w)
+{
+    return _mm_cvtsi128_si32 (_mm_aeskeygenassist_si128 (_mm_set1_epi32 (w),
+                                                          0));
+}
+
+/** AES-128 Counter Mode for a batch of packets, with AES-NI */
+static AES_TARGET void
+aes_ctr_batch (const srtp_proto_t *p, srtp_ctr_t *ctrv, unsigned ctrc)
+{
+    const uint32_t *iv[AES_LANES];
+    uint32_t lo[AES_LANES] = { 0 };
+    uint8_t *dst[AES_LANES];
+    size_t len[AES_LANES];
+    unsigned cur = 0, n;
+    __m128i k[11], b[AES_LANES];
+
+    for (unsigned r = 0; r < 11; r++)
+        k[r] = _mm_loadu_si128 ((const __m128i *)p->aes_rk[r]);
+    for (unsigned i = 0; i < AES_LANES; i++)
+        iv[i] = ctrv->ctr;
+
+    while ((n = ctr_gather (ctrv, ctrc, &cur, iv, lo, dst, len)) > 0)
+    {
+        /* Unrolled, to keep the lanes in registers */
+#pragma GCC unroll 8
+        for (unsigned i = 0; i < AES_LANES; i++)
+            b[i] = _mm_xor_si128 (_mm_insert_epi32 (
+                        _mm_loadu_si128 ((const __m128i *)iv[i]), lo[i], 3),
+                                  k[0]);
+#pragma GCC unroll 9
+        for (unsigned r = 1; r < 10; r++)
+#pragma GCC unroll 8
+            for (unsigned i = 0; i < AES_LANES; i++)
+                b[i] = _mm_aesenc_si128 (b[i], k[r]);
+#pragma GCC unroll 8
+        for (unsigned i = 0; i < AES_LANES; i++)
+            b[i] = _mm_aesenclast_si128 (b[i], k[10]);
+
+#pragma GCC unroll 8
+        for (unsigned i = 0; i < AES_LANES && i < n; i++)
+        {
+            if (len[i] == 16)
+            {
+                __m128i *d = (__m128i *)dst[i];
+                _mm_storeu_si128 (d, _mm_xor_si128 (_mm_loadu_si128 (d),
+                                                    b[i]));
+                continue;
+            }
+            /* Truncated last block */
+            uint8_t ks[16];
+
+            _mm_storeu_si128 ((__m128i *)ks, b[i]);
+            for (size_t j = 0; j < len[i]; j++)
+                dst[i][j] ^= ks[j];
+        }
+    }
+}
+
+static bool aes_hw_available (void)
+{
+    unsigned eax, ebx, ecx, edx;
+
+    return __get_cpuid (1, &eax, &ebx, &ecx, &edx)
+        && (ecx & bit_AES) && (ecx & bit_SSE4_1);
+}
+# else
+static uint32_t aes_subword (uint32_t w)
+{
+    /* ShiftRows is a no-op on four identical columns */
+    uint8x16_t v = vreinterpretq_u8_u32 (vdupq_n_u32 (w));
+
+    v = vaeseq_u8 (v, vdupq_n_u8 (0));
+    return vgetq_lane_u32 (vreinterpretq_u32_u8 (v), 0);
+}
+
+/** AES-128 Counter Mode for a batch of packets, with ARMv8 instructions */
+static void
+aes_ctr_batch (const srtp_proto_t *p, srtp_ctr_t *ctrv, unsigned ctrc)
+{
+    const uint32_t *iv[AES_LANES];
+    uint32_t lo[AES_LANES] = { 0 };
+    uint8_t *dst[AES_LANES];
+    size_t len[AES_LANES];
+    unsigned cur = 0, n;
+    uint8x16_t k[11], b[AES_LANES];
+
+    for (unsigned r = 0; r < 11; r++)
+        k[r] = vld1q_u8 (p->aes_rk[r]);
+    for (unsigned i = 0; i < AES_LANES; i++)
+        iv[i] = ctrv->ctr;
+
+    while ((n = ctr_gather (ctrv, ctrc, &cur, iv, lo, dst, len)) > 0)
+    {
+        /* Unrolled, to keep the lanes in registers */
+#pragma GCC unroll 8
+        for (unsigned i = 0; i < AES_LANES; i++)
+            b[i] = vreinterpretq_u8_u32 (vsetq_lane_u32 (lo[i],
+                                                vld1q_u32 (iv[i]), 3));
+#pragma GCC unroll 9
+        for (unsigned r = 0; r < 9; r++)
+#pragma GCC unroll 8
+            for (unsigned i = 0; i < AES_LANES; i++)
+                b[i] = vaesmcq_u8 (vaeseq_u8 (b[i], k[r]));
+#pragma GCC unroll 8
+        for (unsigned i = 0; i < AES_LANES; i++)
+            b[i] = veorq_u8 (vaeseq_u8 (b[i], k[9]), k[10]);
+
+#pragma GCC unroll 8
+        for (unsigned i = 0; i < AES_LANES && i < n; i++)
+        {
+            if (len[i] == 16)
+            {
+                vst1q_u8 (dst[i], veorq_u8 (vld1q_u8 (dst[i]), b[i]));
+                continue;
+            }
+            /* Truncated last block */
+            uint8_t ks[16];
+
+            vst1q_u8 (ks, b[i]);
+            for (size_t j = 0; j < len[i]; j++)
+                dst[i][j] ^= ks[j];
+        }
+    }
+}
+
+static bool aes_hw_available (void)
+{
+    return true;
+}
+# endif
+
+/**
+ * Expands the AES-128 session key for the CPU instructions, if any.
+ * libgcrypt keeps its own copy for the other operations.
+ */
+static void proto_setkey_hw (srtp_proto_t *p, const uint8_t *key)
+{
+    static const uint8_t rcon[10] = {
+        0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
+    uint32_t w[44]; /* little endian words */
+
+    p->aes_hw = p->aes && aes_hw_available ();
+    if (!p->aes_hw)
+        return;
+
+    memcpy (w, key, 16);
+    for (unsigned i = 4; i < 44; i++)
+    {
+        uint32_t t = w[i - 1];
+
+        if ((i % 4) == 0)
+            t = aes_subword ((t >> 8) | (t << 24)) ^ rcon[i / 4 - 1];
+        w[i] = w[i - 4] ^ t;
+    }
+    memcpy (p->aes_rk, w, sizeof (p->aes_rk));
+}
+#else
+static void proto_setkey_hw (srtp_proto_t *p, const uint8_t *key)
+{
+    (void) p; (void) key;
+}
+#endif
+
+#ifdef SRTP_SHA_HW
+# define SHA_TARGET __attribute__((target("sha,sse4.1")))
+
+/*
+ * Four rounds of SHA-1 (k-th quarter of the 80 rounds, function f), and the
+ * message schedule of the next words, as in the Intel SHA extensions
+ * reference code. m[] holds four quarters of the schedule, e[] the E words.
+ */
+# define SHA1_STEP(k, f) \
+    do { \
+        if ((k) == 0) \
+            e[0] = _mm_add_epi32 (e[0], m[0]); \
+        else \
+            e[(k) & 1] = _mm_sha1nexte_epu32 (e[(k) & 1], m[(k) & 3]); \
+        e[~(k) & 1] = abcd; \
+        if ((k) >= 3 && (k) <= 18) \
+            m[((k) + 1) & 3] = _mm_sha1msg2_epu32 (m[((k) + 1) & 3], \
+                                                   m[(k) & 3]); \
+        abcd = _mm_sha1rnds4_epu32 (abcd, e[(k) & 1], f); \
+        if ((k) >= 1 && (k) <= 16) \
+            m[((k) + 3) & 3] = _mm_sha1msg1_epu32 (m[((k) + 3) & 3], \
+                                                   m[(k) & 3]); \
+        if ((k) >= 2 && (k) <= 17) \
+            m[((k) + 2) & 3] = _mm_xor_si128 (m[((k) + 2) & 3], m[(k) & 3]); \
+    } while (0)
+
+/** SHA-1 compression of 64 bytes blocks */
+static SHA_TARGET void
+sha1_compress (uint32_t *state, const uint8_t *data, size_t blocks)
+{
+    const __m128i bswap = _mm_set_epi64x (INT64_C(0x0001020304050607),
+                                          INT64_C(0x08090a0b0c0d0e0f));
+    __m128i abcd = _mm_loadu_si128 ((const __m128i *)state);
+    __m128i e0 = _mm_set_epi32 (state[4], 0, 0, 0);
+
+    abcd = _mm_shuffle_epi32 (abcd, 0x1B);
+    for (; blocks > 0; blocks--, data += 64)
+    {
+        __m128i abcd_save = abcd, e[2] = { e0, e0 }, m[4];
+
+        for (unsigned i = 0; i < 4; i++)
+            m[i] = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)
+                                                      (data + 16 * i)), bswap);
+
+        SHA1_STEP (0, 0);  SHA1_STEP (1, 0);  SHA1_STEP (2, 0);
+        SHA1_STEP (3, 0);  SHA1_STEP (4, 0);  SHA1_STEP (5, 1);
+        SHA1_STEP (6, 1);  SHA1_STEP (7, 1);  SHA1_STEP (8, 1);
+        SHA1_STEP (9, 1);  SHA1_STEP (10, 2); SHA1_STEP (11, 2);
+        SHA1_STEP (12, 2); SHA1_STEP (13, 2); SHA1_STEP (14, 2);
+        SHA1_STEP (15, 3); SHA1_STEP (16, 3); SHA1_STEP (17, 3);
+        SHA1_STEP (18, 3); SHA1_STEP (19, 3);
+
+        e0 = _mm_sha1nexte_epu32 (e[0], e0);
+        abcd = _mm_add_epi32 (abcd, abcd_save);
+    }
+
+    _mm_storeu_si128 ((__m128i *)state, _mm_shuffle_epi32 (abcd, 0x1B));
+    state[4] = _mm_extract_epi32 (e0, 3);
+}
+
+/** Appends the SHA-1 padding of a message of the given total length */
+static size_t sha1_pad (uint8_t *block, size_t len, uint64_t total)
+{
+    size_t end = (len + 9 > 64) ? 128 : 64;
+
+    block[len] = 0x80;
+    memset (block + len + 1, 0, end - len - 9);
+    total *= 8;
+    memcpy (block + end - 8, &(uint32_t){ htonl (total >> 32) }, 4);
+    memcpy (block + end - 4, &(uint32_t){ htonl (total) }, 4);
+    return end / 64;
+}
+
+/**
+ * HMAC-SHA1 of a RTP packet and its Roll-Over-Counter, from the inner and
+ * outer states of the session key.
+ */
+static void
+hmac_sha1 (srtp_proto_t *p, const uint8_t *data, size_t len, uint32_t roc)
+{
+    uint32_t state[5];
+    uint8_t block[128];
+    size_t bulk = len & ~(size_t)63, rest = len - bulk;
+
+    /* Inner hash */
+    memcpy (state, p->sha1_pads[0], sizeof (state));
+    sha1_compress (state, data, bulk / 64);
+    memcpy (block, data + bulk, rest);
+    memcpy (block + rest, &(uint32_t){ htonl (roc) }, 4);
+    sha1_compress (state, block, sha1_pad (block, rest + 4, 64 + len + 4));
+
+    /* Outer hash */
+    for (unsigned i = 0; i < 5; i++)
+        memcpy (block + 4 * i, &(uint32_t){ htonl (state[i]) }, 4);
+    memcpy (state, p->sha1_pads[1], sizeof (state));
+    sha1_compress (state, block, sha1_pad (block, 20, 64 + 20));
+
+    for (unsigned i = 0; i < 5; i++)
+        memcpy (p->tag + 4 * i, &(uint32_t){ htonl (state[i]) }, 4);
+}
+
+/**
+ * Computes the HMAC inner and outer states of the session key, so that
+ * the key pads are not hashed again for every packet.
+ */
+static void proto_setmac_hw (srtp_proto_t *p, const uint8_t *key, size_t len)
+{
+    static const uint32_t iv[5] = {
+        0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    unsigned eax, ebx, ecx, edx;
+    uint8_t pad[64];
+
+    p->sha1_hw = p->sha1
+        && __get_cpuid (1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_1)
+        && __get_cpuid_count (7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA);
+    if (!p->sha1_hw)
+        return;
+
+    assert (len <= sizeof (pad));
+    for (unsigned i = 0; i < 2; i++)
+    {
+        memset (pad, i ? 0x5c : 0x36, sizeof (pad));
+        for (size_t j = 0; j < len; j++)
+            pad[j] ^= key[j];
+        memcpy (p->sha1_pads[i], iv, sizeof (iv));
+        sha1_compress (p->sha1_pads[i], pad, 1);
+    }
+}
+#else
+static void proto_setmac_hw (srtp_proto_t *p, const uint8_t *key, size_t len)
+{
+    (void) p; (void) key; (void) len;
+}
+#endif
+
+static inline bool proto_aes_hw (const srtp_proto_t *p)
+{
+#ifdef SRTP_AES_HW
+    return p->aes_hw;
+#else
+    (void) p;
+    return false;
+#endif
+}
+
+
 /**
  * AES-CM key derivation (saltlen = 14 bytes)
  */
@@ -294,10 +702,14 @@ srtp_setkey (srtp_session_t *s, const void *key, size_t keylen,
 #endif
         memset (r, 0, sizeof (r));
     if (do_derive (prf, salt, r, 6, SRTP_CRYPT, keybuf, 16)
-     || gcry_cipher_setkey (s->rtp.cipher, keybuf, 16)
-     || do_derive (prf, salt, r, 6, SRTP_AUTH, keybuf, 20)
-     || gcry_md_setkey (s->rtp.mac, keybuf, 20)
-     || do_derive (prf, salt, r, 6, SRTP_SALT, s->rtp.salt, 14))
+     || gcry_cipher_setkey (s->rtp.cipher, keybuf, 16))
+        return -1;
+    proto_setkey_hw (&s->rtp, keybuf);
+    if (do_derive (prf, salt, r, 6, SRTP_AUTH, keybuf, 20)
+     || gcry_md_setkey (s->rtp.mac, keybuf, 20))
+        return -1;
+    proto_setmac_hw (&s->rtp, keybuf, 20);
+    if (do_derive (prf, salt, r, 6, SRTP_SALT, s->rtp.salt, 14))
         return -1;
 
     /* SRTCP key derivation */
@@ -388,18 +800,26 @@ void srtp_setrcc_rate (srtp_session_t *s, uint16_t rate)
 }
 
 
+/** Determines the AES-CM cryptographic counter (IV) of a RTP packet */
+static void
+rtp_counter (uint32_t *counter, uint32_t ssrc, uint32_t roc, uint16_t seq,
+             const uint32_t *salt)
+{
+    counter[0] = salt[0];
+    counter[1] = salt[1] ^ ssrc;
+    counter[2] = salt[2] ^ htonl (roc);
+    counter[3] = salt[3] ^ htonl (seq << 16);
+}
+
+
 /** AES-CM for RTP (salt = 14 bytes + 2 nul bytes) */
 static int
 rtp_crypt (gcry_cipher_hd_t hd, uint32_t ssrc, uint32_t roc, uint16_t seq,
            const uint32_t *salt, uint8_t *data, size_t len)
 {
-    /* Determines cryptographic counter (IV) */
     uint32_t counter[4];
-    counter[0] = salt[0];
-    counter[1] = salt[1] ^ ssrc;
-    counter[2] = salt[2] ^ htonl (roc);
-    counter[3] = salt[3] ^ htonl (seq << 16);
 
+    rtp_counter (counter, ssrc, roc, seq, salt);
     /* Encryption */
     return do_ctr_crypt (hd, counter, data, len);
 }
@@ -436,9 +856,18 @@ static inline uint16_t rtp_seq (const uint8_t *buf)
 
 /** Message Authentication and Integrity for RTP */
 static const uint8_t *
-rtp_digest (gcry_md_hd_t md, const uint8_t *data, size_t len,
+rtp_digest (srtp_proto_t *p, const uint8_t *data, size_t len,
             uint32_t roc)
 {
+    gcry_md_hd_t md = p->mac;
+
+#ifdef SRTP_SHA_HW
+    if (p->sha1_hw)
+    {
+        hmac_sha1 (p, data, len, roc);
+        return p->tag;
+    }
+#endif
     gcry_md_reset (md);
     gcry_md_write (md, data, len);
     gcry_md_write (md, &(uint32_t){ htonl (roc) }, 4);
@@ -447,18 +876,19 @@ rtp_digest (gcry_md_hd_t md, const uint8_t *data, size_t len,
 
 
 /**
- * Encrypts/decrypts a RTP packet and updates SRTP context
- * (CTR block cypher mode of operation has identical encryption and
- * decryption function).
+ * Checks a RTP packet and updates SRTP context.
  *
  * @param buf RTP packet to be en-/decrypted
  * @param len RTP packet length
+ * @param offsetp set to the offset of the encrypted payload
+ * @param rocp set to the Roll-Over-Counter of the packet
  *
  * @return 0 on success, in case of error:
  *  EINVAL  malformatted RTP packet
  *  EACCES  replayed packet or out-of-window or sync lost
  */
-static int srtp_crypt (srtp_session_t *s, uint8_t *buf, size_t len)
+static int srtp_update (srtp_session_t *s, const uint8_t *buf, size_t len,
+                        uint16_t *offsetp, uint32_t *rocp)
 {
     assert (s != NULL);
     assert (len >= 12u);
@@ -485,10 +915,9 @@ static int srtp_crypt (srtp_session_t *s, uint8_t *buf, size_t len)
     if (len < offset)
         return EINVAL;
 
-    /* Determines RTP 48-bits counter and SSRC */
+    /* Determines RTP 48-bits counter */
     uint16_t seq = rtp_seq (buf);
-    uint32_t roc = srtp_compute_roc (s, seq), ssrc;
-    memcpy (&ssrc, buf + 8, 4);
+    uint32_t roc = srtp_compute_roc (s, seq);
 
     /* Updates ROC and sequence (it's safe now) */
     int16_t diff = seq - s->rtp_seq;
@@ -508,11 +937,39 @@ static int srtp_crypt (srtp_session_t *s, uint8_t *buf, size_t len)
         s->rtp.window |= UINT64_C(1) << diff;
     }
 
+    *offsetp = offset;
+    *rocp = roc;
+    return 0;
+}
+
+
+/**
+ * Encrypts/decrypts a RTP packet and updates SRTP context
+ * (CTR block cypher mode of operation has identical encryption and
+ * decryption function).
+ *
+ * @param buf RTP packet to be en-/decrypted
+ * @param len RTP packet length
+ *
+ * @return 0 on success, in case of error:
+ *  EINVAL  malformatted RTP packet
+ *  EACCES  replayed packet or out-of-window or sync lost
+ */
+static int srtp_crypt (srtp_session_t *s, uint8_t *buf, size_t len)
+{
+    uint16_t offset;
+    uint32_t roc, ssrc;
+
+    int val = srtp_update (s, buf, len, &offset, &roc);
+    if (val)
+        return val;
+
     /* Encrypt/Decrypt */
     if (s->flags & SRTP_UNENCRYPTED)
         return 0;
 
-    if (rtp_crypt (s->rtp.cipher, ssrc, roc, seq, s->rtp.salt,
+    memcpy (&ssrc, buf + 8, 4);
+    if (rtp_crypt (s->rtp.cipher, ssrc, roc, rtp_seq (buf), s->rtp.salt,
                    buf + offset, len - offset))
         return EINVAL;
 
@@ -521,23 +978,16 @@ static int srtp_crypt (srtp_session_t *s, uint8_t *buf, size_t len)
 
 
 /**
- * Turns a RTP packet into a SRTP packet: encrypt it, then computes
- * the authentication tag and appends it.
- * Note that you can encrypt packet in disorder.
+ * Computes the SRTP length of a RTP packet.
  *
- * @param buf RTP packet to be encrypted/digested
- * @param lenp pointer to the RTP packet length on entry,
- *             set to the SRTP length on exit (undefined on non-ENOSPC error)
- * @param bufsize size (bytes) of the packet buffer
+ * @param roc_lenp set to the length of the carried Roll-Over-Counter
+ * @param tag_lenp set to the length of the authentication tag
  *
- * @return 0 on success, in case of error:
- *  EINVAL  malformatted RTP packet or internal error
- *  ENOSPC  bufsize is too small to add authentication tag
- *          (<lenp> will hold the required byte size)
- *  EACCES  packet would trigger a replay error on receiver
+ * @return 0 on success, or an error code of srtp_send()
  */
-int
-srtp_send (srtp_session_t *s, uint8_t *buf, size_t *lenp, size_t bufsize)
+static int
+srtp_send_size (const srtp_session_t *s, const uint8_t *buf, size_t *lenp,
+                size_t bufsize, size_t *roc_lenp, size_t *tag_lenp)
 {
     size_t len = *lenp;
     size_t tag_len;
@@ -578,8 +1028,66 @@ srtp_send (srtp_session_t *s, uint8_t *buf, size_t *lenp, size_t bufsize)
     if (bufsize < *lenp)
         return ENOSPC;
 
+    *roc_lenp = roc_len;
+    *tag_lenp = tag_len;
+    return 0;
+}
+
+
+/**
+ * Appends the carried Roll-Over-Counter and the authentication tag to an
+ * encrypted packet.
+ *
+ * @param tag packet digest
+ * @param rcc Roll-Over-Counter to carry
+ */
+static void
+srtp_send_tag (uint8_t *buf, size_t len, const uint8_t *tag, uint32_t rcc,
+               size_t roc_len, size_t tag_len)
+{
+    if (roc_len)
+    {
+        memcpy (buf + len, &(uint32_t){ htonl (rcc) }, 4);
+        len += 4;
+    }
+    memcpy (buf + len, tag, tag_len);
+#if 0
+    printf ("Sent    : 0x");
+    for (unsigned i = 0; i < tag_len; i++)
+        printf ("%02x", tag[i]);
+    puts ("");
+#endif
+}
+
+
+/**
+ * Turns a RTP packet into a SRTP packet: encrypt it, then computes
+ * the authentication tag and appends it.
+ * Note that you can encrypt packet in disorder.
+ *
+ * @param buf RTP packet to be encrypted/digested
+ * @param lenp pointer to the RTP packet length on entry,
+ *             set to the SRTP length on exit (undefined on non-ENOSPC error)
+ * @param bufsize size (bytes) of the packet buffer
+ *
+ * @return 0 on success, in case of error:
+ *  EINVAL  malformatted RTP packet or internal error
+ *  ENOSPC  bufsize is too small to add authentication tag
+ *          (<lenp> will hold the required byte size)
+ *  EACCES  packet would trigger a replay error on receiver
+ */
+int
+srtp_send (srtp_session_t *s, uint8_t *buf, size_t *lenp, size_t bufsize)
+{
+    size_t len = *lenp;
+    size_t roc_len, tag_len;
+
+    int val = srtp_send_size (s, buf, lenp, bufsize, &roc_len, &tag_len);
+    if (val)
+        return val;
+
     /* Encrypt payload */
-    int val = srtp_crypt (s, buf, len);
+    val = srtp_crypt (s, buf, len);
     if (val)
         return val;
 
@@ -587,23 +1095,131 @@ srtp_send (srtp_session_t *s, uint8_t *buf, size_t *lenp, size_t bufsize)
     if (!(s->flags & SRTP_UNAUTHENTICATED))
     {
         uint32_t roc = srtp_compute_roc (s, rtp_seq (buf));
-        const uint8_t *tag = rtp_digest (s->rtp.mac, buf, len, roc);
 
-        if (roc_len)
+        srtp_send_tag (buf, len, rtp_digest (&s->rtp, buf, len, roc),
+                       s->rtp_roc, roc_len, tag_len);
+    }
+    return 0;
+}
+
+
+static unsigned
+srtp_send_chunk (srtp_session_t *s, uint8_t *const *bufv, size_t *lenv,
+                 const size_t *sizev, int *errv, unsigned count)
+{
+    struct
+    {
+        size_t   len, roc_len, tag_len;
+        uint32_t roc, rcc;
+    } tagv[SRTP_BATCH];
+    srtp_ctr_t ctrv[SRTP_BATCH];
+    unsigned ctrc = 0, errc = 0;
+    const bool hw = proto_aes_hw (&s->rtp);
+
+    assert (count <= SRTP_BATCH);
+
+    /* Checks the packets, and sets up their encryption */
+    for (unsigned i = 0; i < count; i++)
+    {
+        uint8_t *buf = bufv[i];
+        size_t len = lenv[i];
+        uint16_t offset;
+        uint32_t roc, ssrc;
+
+        int val = srtp_send_size (s, buf, lenv + i, sizev[i],
+                                  &tagv[i].roc_len, &tagv[i].tag_len);
+        if (val == 0)
+            val = srtp_update (s, buf, len, &offset, &roc);
+        if (val == 0 && !(s->flags & SRTP_UNENCRYPTED))
         {
-            memcpy (buf + len, &(uint32_t){ htonl (s->rtp_roc) }, 4);
-            len += 4;
+            memcpy (&ssrc, buf + 8, 4);
+            if (hw && len - offset < (1 << 20))
+            {
+                srtp_ctr_t *c = ctrv + ctrc++;
+
+                rtp_counter (c->ctr, ssrc, roc, rtp_seq (buf), s->rtp.salt);
+                c->data = buf + offset;
+                c->len = len - offset;
+                c->block = 0;
+
+                /* libgcrypt bulk code is as fast for the most part of long
+                 * packets: only the remaining bytes are left to the lanes */
+                if (c->len >= SRTP_BULK_MIN)
+                {
+                    size_t bulk = c->len & ~(size_t)15;
+
+                    if (do_ctr_crypt (s->rtp.cipher, c->ctr, c->data, bulk))
+                    {
+                        val = EINVAL;
+                        ctrc--;
+                    }
+                    c->data += bulk;
+                    c->len -= bulk;
+                    c->block = bulk / 16;
+                }
+            }
+            else if (rtp_crypt (s->rtp.cipher, ssrc, roc, rtp_seq (buf),
+                                s->rtp.salt, buf + offset, len - offset))
+                val = EINVAL;
         }
-        memcpy (buf + len, tag, tag_len);
-#if 0
-        printf ("Sent    : 0x");
-        for (unsigned i = 0; i < tag_len; i++)
-            printf ("%02x", tag[i]);
-        puts ("");
-#endif
+
+        errv[i] = val;
+        if (val)
+        {
+            errc++;
+            continue;
+        }
+        tagv[i].len = len;
+        tagv[i].roc = roc;
+        tagv[i].rcc = s->rtp_roc;
     }
 
-    return 0;
+    /* Encrypts all the packets together */
+#ifdef SRTP_AES_HW
+    if (ctrc > 0)
+        aes_ctr_batch (&s->rtp, ctrv, ctrc);
+#endif
+
+    /* Authenticates them */
+    if (!(s->flags & SRTP_UNAUTHENTICATED))
+        for (unsigned i = 0; i < count; i++)
+            if (errv[i] == 0)
+                srtp_send_tag (bufv[i], tagv[i].len,
+                               rtp_digest (&s->rtp, bufv[i], tagv[i].len,
+                                           tagv[i].roc),
+                               tagv[i].rcc, tagv[i].roc_len, tagv[i].tag_len);
+    return errc;
+}
+
+
+/**
+ * Turns a batch of RTP packets into SRTP packets, as srtp_send() does with
+ * each of them in turn. With AES hardware instructions, the key streams of
+ * all the packets are generated together, in interleaved blocks, from the
+ * expanded session key.
+ *
+ * @param bufv RTP packets to be encrypted/digested
+ * @param lenv RTP packet lengths on entry, set as by srtp_send() on exit
+ * @param sizev sizes (bytes) of the packet buffers
+ * @param errv set to the srtp_send() error code of each packet
+ * @param count number of packets
+ *
+ * @return the number of packets in error
+ */
+unsigned
+srtp_send_batch (srtp_session_t *s, uint8_t *const *bufv, size_t *lenv,
+                 const size_t *sizev, int *errv, unsigned count)
+{
+    unsigned errc = 0;
+
+    for (unsigned i = 0; i < count; i += SRTP_BATCH)
+    {
+        unsigned n = (count - i < SRTP_BATCH) ? count - i : SRTP_BATCH;
+
+        errc += srtp_send_chunk (s, bufv + i, lenv + i, sizev + i, errv + i,
+                                 n);
+    }
+    return errc;
 }
 
 
@@ -660,7 +1276,7 @@ srtp_recv (srtp_session_t *s, uint8_t *buf, size_t *lenp)
         else
             rcc = roc;
 
-        const uint8_t *tag = rtp_digest (s->rtp.mac, buf, len, rcc);
+        const uint8_t *tag = rtp_digest (&s->rtp, buf, len, rcc);
 #if 0
         printf ("Computed: 0x");
         for (unsigned i = 0; i < tag_len; i++)
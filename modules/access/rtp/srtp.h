@@ -71,6 +71,9 @@ int srtp_setkeystring (srtp_session_t *s, const char *key, const char *salt);
 void srtp_setrcc_rate (srtp_session_t *s, uint16_t rate);
 
 int srtp_send (srtp_session_t *s, uint8_t *buf, size_t *lenp, size_t maxsize);
+unsigned srtp_send_batch (srtp_session_t *s, uint8_t *const *bufv,
+                          size_t *lenv, const size_t *sizev, int *errv,
+                          unsigned count);
 int srtp_recv (srtp_session_t *s, uint8_t *buf, size_t *lenp);
 int srtcp_send (srtp_session_t *s, uint8_t *buf, size_t *lenp, size_t maxsiz);
 int srtcp_recv (srtp_session_t *s, uint8_t *buf, size_t *lenp);
@@ -32,6 +32,9 @@
 # include <sys/shm.h>
 # include <xcb/shm.h>
 #endif
+#ifdef HAVE_XCB_DAMAGE
+# include <xcb/damage.h>
+#endif
 #include <vlc_common.h>
 #include <vlc_demux.h>
 #include <vlc_plugin.h>
@@ -60,6 +63,11 @@
 #define FOLLOW_MOUSE_LONGTEXT N_( \
     "Follow the mouse when capturing a subscreen." )
 
+#define DAMAGE_TEXT N_( "Capture changes only" )
+#define DAMAGE_LONGTEXT N_( \
+    "Skip the frames where nothing changed in the capture region " \
+    "(requires the X Damage extension)." )
+
 static int  Open (vlc_object_t *);
 static void Close (vlc_object_t *);
 
@@ -89,6 +97,7 @@ vlc_module_begin ()
         change_safe ()
     add_bool ("screen-follow-mouse", false, FOLLOW_MOUSE_TEXT,
               FOLLOW_MOUSE_LONGTEXT, true)
+    add_bool ("screen-damage", true, DAMAGE_TEXT, DAMAGE_LONGTEXT, true)
 
     add_shortcut ("screen", "window")
 vlc_module_end ()
@@ -101,6 +110,34 @@ static int Control (demux_t *, int, va_list);
 static es_out_id_t *InitES (demux_t *, uint_fast16_t, uint_fast16_t,
                             uint_fast8_t, uint8_t *);
 
+#ifdef HAVE_SYS_SHM_H
+/*
+ * Shared memory segments are attached to the X server and to VLC once, and
+ * recycled: each captured frame is a block pointing straight into a segment,
+ * which returns to the pool when the block is released (from any thread).
+ * The pool outlives the demux if blocks are still pending.
+ */
+typedef struct screen_shm_pool screen_shm_pool_t;
+
+typedef struct screen_shm
+{
+    block_t            self;
+    screen_shm_pool_t *pool;
+    struct screen_shm *next;
+    xcb_shm_seg_t      segment; /**< SHM segment XID */
+    void              *addr;
+    size_t             size;
+} screen_shm_t;
+
+struct screen_shm_pool
+{
+    vlc_mutex_t       lock;
+    screen_shm_t     *idle; /**< Segments ready for capture */
+    unsigned          refs; /**< Demux and pending blocks */
+    bool              alive; /**< Whether the demux still uses the pool */
+};
+#endif
+
 struct demux_sys_t
 {
     /* All owned by timer thread while timer is armed: */
@@ -109,30 +146,228 @@ struct demux_sys_t
     float             rate; /**< Frame rate */
     xcb_window_t      window; /**< Captured window XID  */
     xcb_pixmap_t      pixmap; /**< Pixmap for composited capture */
-    xcb_shm_seg_t     segment; /**< SHM segment XID */
+#ifdef HAVE_SYS_SHM_H
+    screen_shm_pool_t *shm_pool; /**< MIT-SHM segments (or NULL) */
+#endif
+#ifdef HAVE_XCB_DAMAGE
+    xcb_damage_damage_t damage; /**< Damage XID (or 0) */
+    uint8_t           damage_event; /**< DamageNotify event type */
+#endif
     int16_t           x, y; /**< Requested capture top-left coordinates */
     uint16_t          w, h; /**< Requested capture pixel dimensions */
     uint8_t           bpp; /**< Actual bytes per pixel *es */
-    bool              shm; /**< Whether to use MIT-SHM */
     bool              follow_mouse;
+    bool              dirty; /**< Whether to capture regardless of damage */
+    int16_t           cur_x, cur_y; /**< Actual capture top-left coordinates */
     uint16_t          cur_w, cur_h; /**< Actual capture pixel dimensions */
     /* Timer does not use this, only input thread: */
     vlc_timer_t       timer;
 };
 
+#ifdef HAVE_SYS_SHM_H
 /** Checks MIT-SHM shared memory support */
 static bool CheckSHM (xcb_connection_t *conn)
 {
-#ifdef HAVE_SYS_SHM_H
     xcb_shm_query_version_cookie_t ck = xcb_shm_query_version (conn);
     xcb_shm_query_version_reply_t *r;
 
     r = xcb_shm_query_version_reply (conn, ck, NULL);
     free (r);
     return r != NULL;
+}
+
+static screen_shm_pool_t *ShmPoolCreate (void)
+{
+    screen_shm_pool_t *pool = malloc (sizeof (*pool));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    vlc_mutex_init (&pool->lock);
+    pool->idle = NULL;
+    pool->refs = 1;
+    pool->alive = true;
+    return pool;
+}
+
+/**
+ * Destroys a segment.
+ * @param conn X connection to detach the segment from, or NULL if the
+ * connection is gone (the server detaches on disconnection)
+ */
+static void ShmDelete (xcb_connection_t *conn, screen_shm_t *shm)
+{
+    if (conn != NULL)
+        xcb_shm_detach (conn, shm->segment);
+    shmdt (shm->addr);
+    free (shm);
+}
+
+/** Drops a reference to the pool, and unlocks it. */
+static void ShmPoolUnref (screen_shm_pool_t *pool)
+{
+    bool last = --pool->refs == 0;
+
+    vlc_mutex_unlock (&pool->lock);
+    if (last)
+    {
+        vlc_mutex_destroy (&pool->lock);
+        free (pool);
+    }
+}
+
+/** Drops the demux reference, and the idle segments. */
+static void ShmPoolRelease (xcb_connection_t *conn, screen_shm_pool_t *pool)
+{
+    vlc_mutex_lock (&pool->lock);
+    screen_shm_t *shm = pool->idle;
+    pool->idle = NULL;
+    pool->alive = false;
+    ShmPoolUnref (pool);
+
+    while (shm != NULL)
+    {
+        screen_shm_t *next = shm->next;
+
+        ShmDelete (conn, shm);
+        shm = next;
+    }
+}
+
+static void ShmRelease (block_t *block)
+{
+    screen_shm_t *shm = (screen_shm_t *)block;
+    screen_shm_pool_t *pool = shm->pool;
+
+    vlc_mutex_lock (&pool->lock);
+    if (pool->alive)
+    {   /* Recycle the segment */
+        shm->next = pool->idle;
+        pool->idle = shm;
+        shm = NULL;
+    }
+    ShmPoolUnref (pool);
+
+    if (shm != NULL)
+        ShmDelete (NULL, shm);
+}
+
+/**
+ * Gets a segment of the given size, attached to both X and VLC, and
+ * wrapped in a block.
+ */
+static block_t *ShmGet (demux_t *demux, size_t size)
+{
+    demux_sys_t *sys = demux->p_sys;
+    screen_shm_pool_t *pool = sys->shm_pool;
+    xcb_connection_t *conn = sys->conn;
+    screen_shm_t *shm;
+
+    vlc_mutex_lock (&pool->lock);
+    shm = pool->idle;
+    if (shm != NULL)
+        pool->idle = shm->next;
+    vlc_mutex_unlock (&pool->lock);
+
+    if (shm != NULL && shm->size != size)
+    {   /* The capture size changed */
+        ShmDelete (conn, shm);
+        shm = NULL;
+    }
+
+    if (shm == NULL)
+    {
+        shm = malloc (sizeof (*shm));
+        if (unlikely(shm == NULL))
+            return NULL;
+
+        int id = shmget (IPC_PRIVATE, size, IPC_CREAT | 0600);
+        if (id == -1)
+        {
+            msg_Err (demux, "shared memory allocation error: %s",
+                     vlc_strerror_c(errno));
+            free (shm);
+            return NULL;
+        }
+
+        shm->addr = shmat (id, NULL, 0 /* read/write */);
+        if (-1 == (intptr_t)shm->addr)
+        {
+            msg_Err (demux, "shared memory attachment error: %s",
+                     vlc_strerror_c(errno));
+            shmctl (id, IPC_RMID, 0);
+            free (shm);
+            return NULL;
+        }
+
+        /* The segment can only be removed once X has attached it too */
+        xcb_void_cookie_t ck;
+        xcb_generic_error_t *err;
+
+        shm->segment = xcb_generate_id (conn);
+        ck = xcb_shm_attach_checked (conn, shm->segment, id, 0 /* r/w */);
+        err = xcb_request_check (conn, ck);
+        shmctl (id, IPC_RMID, 0);
+        if (err != NULL)
+        {
+            msg_Err (demux, "shared memory X11 error %d", err->error_code);
+            free (err);
+            shmdt (shm->addr);
+            free (shm);
+            return NULL;
+        }
+        shm->size = size;
+        shm->pool = pool;
+    }
+
+    vlc_mutex_lock (&pool->lock);
+    pool->refs++;
+    vlc_mutex_unlock (&pool->lock);
+
+    block_Init (&shm->self, shm->addr, size);
+    shm->self.pf_release = ShmRelease;
+    return &shm->self;
+}
+#endif
+
+/**
+ * Checks whether the capture region may have changed since the last capture.
+ */
+static bool CheckDamage (demux_t *demux, int x, int y, unsigned w, unsigned h)
+{
+    demux_sys_t *sys = demux->p_sys;
+    bool changed = sys->dirty;
+
+    sys->dirty = false;
+#ifdef HAVE_XCB_DAMAGE
+    if (sys->damage == 0)
+        return true;
+
+    xcb_generic_event_t *ev;
+    bool damaged = false;
+
+    while ((ev = xcb_poll_for_event (sys->conn)) != NULL)
+    {
+        if ((ev->response_type & 0x7f) == sys->damage_event)
+        {
+            const xcb_damage_notify_event_t *dn = (void *)ev;
+            const xcb_rectangle_t *r = &dn->area;
+
+            if (r->x < x + (int)w && x < r->x + r->width
+             && r->y < y + (int)h && y < r->y + r->height)
+                changed = true;
+            damaged = true;
+        }
+        free (ev);
+    }
+
+    /* Reset the damage, so that the next change is notified again */
+    if (damaged)
+        xcb_damage_subtract (sys->conn, sys->damage, XCB_NONE, XCB_NONE);
+    return changed;
 #else
-    (void) conn;
-    return false;
+    (void) x; (void) y; (void) w; (void) h;
+    (void) changed;
+    return true;
 #endif
 }
 
@@ -216,8 +451,32 @@ static int Open (vlc_object_t *obj)
 
     /* Window properties */
     p_sys->pixmap = xcb_generate_id (conn);
-    p_sys->segment = xcb_generate_id (conn);
-    p_sys->shm = CheckSHM (conn);
+#ifdef HAVE_SYS_SHM_H
+    p_sys->shm_pool = CheckSHM (conn) ? ShmPoolCreate () : NULL;
+#endif
+#ifdef HAVE_XCB_DAMAGE
+    p_sys->damage = 0;
+    if (var_InheritBool (obj, "screen-damage"))
+    {
+        const xcb_query_extension_reply_t *ext =
+            xcb_get_extension_data (conn, &xcb_damage_id);
+        xcb_damage_query_version_reply_t *r = NULL;
+
+        if (ext != NULL && ext->present)
+            r = xcb_damage_query_version_reply (conn,
+                                 xcb_damage_query_version (conn, 1, 1), NULL);
+        if (r != NULL)
+        {
+            msg_Dbg (obj, "using Damage extension v%"PRIu32".%"PRIu32,
+                     r->major_version, r->minor_version);
+            free (r);
+            p_sys->damage = xcb_generate_id (conn);
+            p_sys->damage_event = ext->first_event + XCB_DAMAGE_NOTIFY;
+            xcb_damage_create (conn, p_sys->damage, p_sys->window,
+                               XCB_DAMAGE_REPORT_LEVEL_BOUNDING_BOX);
+        }
+    }
+#endif
     p_sys->w = var_InheritInteger (obj, "screen-width");
     p_sys->h = var_InheritInteger (obj, "screen-height");
     if (p_sys->w != 0 || p_sys->h != 0)
@@ -239,6 +498,9 @@ static int Open (vlc_object_t *obj)
     if (!interval)
         goto error;
 
+    p_sys->dirty = true;
+    p_sys->cur_x = 0;
+    p_sys->cur_y = 0;
     p_sys->cur_w = 0;
     p_sys->cur_h = 0;
     p_sys->bpp = 0;
@@ -253,6 +515,10 @@ static int Open (vlc_object_t *obj)
     return VLC_SUCCESS;
 
 error:
+#ifdef HAVE_SYS_SHM_H
+    if (p_sys->shm_pool != NULL)
+        ShmPoolRelease (p_sys->conn, p_sys->shm_pool);
+#endif
     xcb_disconnect (p_sys->conn);
     free (p_sys);
     return VLC_EGENERIC;
@@ -268,6 +534,10 @@ static void Close (vlc_object_t *obj)
     demux_sys_t *p_sys = demux->p_sys;
 
     vlc_timer_destroy (p_sys->timer);
+#ifdef HAVE_SYS_SHM_H
+    if (p_sys->shm_pool != NULL)
+        ShmPoolRelease (p_sys->conn, p_sys->shm_pool);
+#endif
     xcb_disconnect (p_sys->conn);
     free (p_sys);
 }
@@ -424,6 +694,14 @@ discard:
             sys->cur_h = h;
             sys->bpp /= 8; /* bits -> bytes */
         }
+        sys->dirty = true;
+    }
+
+    if (x != sys->cur_x || y != sys->cur_y)
+    {
+        sys->cur_x = x;
+        sys->cur_y = y;
+        sys->dirty = true;
     }
 
     /* Capture screen */
@@ -431,50 +709,33 @@ discard:
         (sys->window != geo->root) ? sys->pixmap : sys->window;
     free (geo);
 
+    if (!CheckDamage (demux, x, y, w, h))
+    {   /* Nothing changed: only keep the clock running */
+        es_out_Control (demux->out, ES_OUT_SET_PCR, mdate ());
+        return;
+    }
+
     block_t *block = NULL;
-#if HAVE_SYS_SHM_H
-    if (sys->shm)
-    {   /* Capture screen through shared memory */
-        size_t size = w * h * sys->bpp;
-        int id = shmget (IPC_PRIVATE, size, IPC_CREAT | 0777);
-        if (id == -1) /* XXX: fallback */
-        {
-            msg_Err (demux, "shared memory allocation error: %s",
-                     vlc_strerror_c(errno));
+#ifdef HAVE_SYS_SHM_H
+    if (sys->shm_pool != NULL)
+    {   /* Capture screen through shared memory - zero copy */
+        block = ShmGet (demux, w * h * sys->bpp);
+        if (block == NULL)
             goto noshm;
-        }
 
-        /* Attach the segment to X and capture */
         xcb_shm_get_image_reply_t *img;
-        xcb_shm_get_image_cookie_t ck;
-
-        xcb_shm_attach (conn, sys->segment, id, 0 /* read/write */);
-        ck = xcb_shm_get_image (conn, drawable, x, y, w, h, ~0,
-                                XCB_IMAGE_FORMAT_Z_PIXMAP, sys->segment, 0);
-        xcb_shm_detach (conn, sys->segment);
-        img = xcb_shm_get_image_reply (conn, ck, NULL);
-        xcb_flush (conn); /* ensure eventual detach */
 
+        img = xcb_shm_get_image_reply (conn,
+            xcb_shm_get_image (conn, drawable, x, y, w, h, ~0,
+                               XCB_IMAGE_FORMAT_Z_PIXMAP,
+                               ((screen_shm_t *)block)->segment, 0), NULL);
         if (img == NULL)
         {
-            shmctl (id, IPC_RMID, 0);
+            block_Release (block);
+            block = NULL;
             goto noshm;
         }
         free (img);
-
-        /* Attach the segment to VLC */
-        void *shm = shmat (id, NULL, 0 /* read/write */);
-        shmctl (id, IPC_RMID, 0);
-        if (-1 == (intptr_t)shm)
-        {
-            msg_Err (demux, "shared memory attachment error: %s",
-                     vlc_strerror_c(errno));
-            return;
-        }
-
-        block = block_shm_Alloc (shm, size);
-        if (unlikely(block == NULL))
-            shmdt (shm);
     }
 noshm:
 #endif
@@ -22,6 +22,12 @@
 
 #include "sdi.h"
 
+#include <vlc_cpu.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <tmmintrin.h>
+#endif
+
 static inline uint32_t av_le2ne32(uint32_t val)
 {
     union {
@@ -32,6 +38,50 @@ static inline uint32_t av_le2ne32(uint32_t val)
     return (u.b[0] << 0) | (u.b[1] << 8) | (u.b[2] << 16) | (u.b[3] << 24);
 }
 
+#ifdef HAVE_SSE2_INTRINSICS
+/* Unpacks the 6 pixels of each 4 words of a line, as long as the 8 lumas and
+ * 4 chromas stored at once stay within the line. Returns the pixels done. */
+VLC_SSSE3
+static int v210_unpack_ssse3(uint16_t *y, uint16_t *u, uint16_t *v,
+                             const uint32_t *src, int width)
+{
+    const __m128i mask = _mm_set1_epi32(0x3FF);
+    /* a, b and c are the 1st, 2nd and 3rd components of the 4 words:
+     * ab = a0..a3 b0..b3, cc = c0..c3 c0..c3 */
+    const __m128i y_ab = _mm_setr_epi8(8, 9, 2, 3, -1, -1, 12, 13,
+                                       6, 7, -1, -1, -1, -1, -1, -1);
+    const __m128i y_cc = _mm_setr_epi8(-1, -1, -1, -1, 2, 3, -1, -1,
+                                       -1, -1, 6, 7, -1, -1, -1, -1);
+    const __m128i uv_ab = _mm_setr_epi8(0, 1, 10, 11, -1, -1, -1, -1,
+                                        -1, -1, 4, 5, 14, 15, -1, -1);
+    const __m128i uv_cc = _mm_setr_epi8(-1, -1, -1, -1, 4, 5, -1, -1,
+                                        0, 1, -1, -1, -1, -1, -1, -1);
+    int w;
+
+    for (w = 0; w + 8 <= width; w += 6) {
+        __m128i val = _mm_loadu_si128((const __m128i *)src);
+        __m128i a = _mm_and_si128(val, mask);
+        __m128i b = _mm_and_si128(_mm_srli_epi32(val, 10), mask);
+        __m128i c = _mm_and_si128(_mm_srli_epi32(val, 20), mask);
+        __m128i ab = _mm_packs_epi32(a, b);
+        __m128i cc = _mm_packs_epi32(c, c);
+
+        __m128i luma = _mm_or_si128(_mm_shuffle_epi8(ab, y_ab),
+                                    _mm_shuffle_epi8(cc, y_cc));
+        __m128i chroma = _mm_or_si128(_mm_shuffle_epi8(ab, uv_ab),
+                                      _mm_shuffle_epi8(cc, uv_cc));
+        _mm_storeu_si128((__m128i *)y, luma);
+        _mm_storel_epi64((__m128i *)u, chroma);
+        _mm_storel_epi64((__m128i *)v, _mm_srli_si128(chroma, 8));
+        src += 4;
+        y += 6;
+        u += 3;
+        v += 3;
+    }
+    return w;
+}
+#endif
+
 void v210_convert(uint16_t *dst, const uint32_t *bytes, const int width, const int height)
 {
     const int stride = ((width + 47) / 48) * 48 * 8 / 3 / 4;
@@ -47,11 +97,24 @@ void v210_convert(uint16_t *dst, const uint32_t *bytes, const int width, const i
         *c++ = (val >> 20) & 0x3FF;  \
     } while (0)
 
+#ifdef HAVE_SSE2_INTRINSICS
+    const bool ssse3 = vlc_CPU_SSSE3();
+#endif
+
     for (int h = 0; h < height; h++) {
         const uint32_t *src = bytes;
         uint32_t val = 0;
-        int w;
-        for (w = 0; w < width - 5; w += 6) {
+        int w = 0;
+#ifdef HAVE_SSE2_INTRINSICS
+        if (ssse3) {
+            w = v210_unpack_ssse3(y, u, v, src, width);
+            y += w;
+            u += w / 2;
+            v += w / 2;
+            src += w / 6 * 4;
+        }
+#endif
+        for (; w < width - 5; w += 6) {
             READ_PIXELS(u, y, v);
             READ_PIXELS(y, u, y);
             READ_PIXELS(v, y, u);
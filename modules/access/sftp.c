@@ -52,6 +52,9 @@ static void Close( vlc_object_t* );
 #define PORT_LONGTEXT N_("SFTP port number to use on the server")
 #define MTU_TEXT N_("Read size")
 #define MTU_LONGTEXT N_("Size of the request for reading access")
+#define REQUESTS_TEXT N_("Outstanding read requests")
+#define REQUESTS_LONGTEXT N_("Number of read requests sent ahead to the " \
+    "server, so that the transfer is not limited by the round trip time")
 
 vlc_module_begin ()
     set_shortname( "SFTP" )
@@ -59,7 +62,9 @@ vlc_module_begin ()
     set_capability( "access", 0 )
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_ACCESS )
-    add_integer( "sftp-readsize", 8192, MTU_TEXT, MTU_LONGTEXT, true )
+    add_integer( "sftp-readsize", 32768, MTU_TEXT, MTU_LONGTEXT, true )
+    add_integer_with_range( "sftp-requests", 16, 1, 256, REQUESTS_TEXT,
+                            REQUESTS_LONGTEXT, true )
     add_integer( "sftp-port", 22, PORT_TEXT, PORT_LONGTEXT, true )
     add_shortcut( "sftp" )
     set_callbacks( Open, Close )
@@ -82,6 +87,7 @@ struct access_sys_t
     LIBSSH2_SFTP_HANDLE* file;
     uint64_t filesize;
     size_t i_read_size;
+    access_stats_t stats;
 };
 
 
@@ -236,7 +242,10 @@ static int Open( vlc_object_t* p_this )
     }
     p_sys->filesize = attributes.filesize;
 
-    p_sys->i_read_size = var_InheritInteger( p_access, "sftp-readsize" );
+    /* libssh2 splits a large read into pipelined requests, and keeps those
+     * beyond the buffer in flight for the next reads */
+    p_sys->i_read_size = var_InheritInteger( p_access, "sftp-readsize" )
+                       * var_InheritInteger( p_access, "sftp-requests" );
 
     free( psz_password );
     free( psz_username );
@@ -283,34 +292,47 @@ static block_t* Block( access_t* p_access )
         return NULL;
 
     /* Read the specified size */
-    ssize_t i_ret = libssh2_sftp_read( p_access->p_sys->file, (char*)p_block->p_buffer, i_len );
-
-    if( i_ret < 0 )
+    mtime_t i_start = mdate();
+    size_t i_total = 0;
+    while( i_total < i_len )
     {
-        block_Release( p_block );
-        msg_Err( p_access, "read failed" );
-        return NULL;
+        ssize_t i_ret = libssh2_sftp_read( p_sys->file,
+                                           (char*)p_block->p_buffer + i_total,
+                                           i_len - i_total );
+        if( i_ret < 0 )
+        {
+            block_Release( p_block );
+            msg_Err( p_access, "read failed" );
+            return NULL;
+        }
+        p_sys->stats.i_requests++;
+        if( i_ret == 0 )
+            break;
+        i_total += i_ret;
     }
-    else if( i_ret == 0 )
+    p_sys->stats.i_bytes += i_total;
+    p_sys->stats.i_wait += mdate() - i_start;
+
+    if( i_total == 0 )
     {
         p_access->info.b_eof = true;
         block_Release( p_block );
         return NULL;
     }
-    else
-    {
-        p_access->info.i_pos += i_ret;
-        return p_block;
-    }
+    p_block->i_buffer = i_total;
+    p_access->info.i_pos += i_total;
+    return p_block;
 }
 
 
 static int Seek( access_t* p_access, uint64_t i_pos )
 {
+    /* Seeking drops the requests in flight */
+    if( i_pos != p_access->info.i_pos )
+        libssh2_sftp_seek64( p_access->p_sys->file, i_pos );
+
     p_access->info.i_pos = i_pos;
     p_access->info.b_eof = false;
-
-    libssh2_sftp_seek( p_access->p_sys->file, i_pos );
     return VLC_SUCCESS;
 }
 
@@ -348,6 +370,10 @@ static int Control( access_t* p_access, int i_query, va_list args )
                * var_InheritInteger( p_access, "network-caching" );
         break;
 
+    case ACCESS_GET_STATS:
+        *va_arg( args, access_stats_t * ) = p_access->p_sys->stats;
+        break;
+
     case ACCESS_SET_PAUSE_STATE:
         break;
 
@@ -63,6 +63,10 @@ static void Close( vlc_object_t * );
 #define DOMAIN_LONGTEXT N_("Domain/Workgroup that " \
     "will be used for the connection.")
 
+#define READSIZE_TEXT N_("Read size")
+#define READSIZE_LONGTEXT N_("Size of the reads from the server. Large " \
+    "reads take fewer round trips.")
+
 #define SMB_HELP N_("Samba (Windows network shares) input")
 vlc_module_begin ()
     set_shortname( "SMB" )
@@ -77,6 +81,8 @@ vlc_module_begin ()
                   PASS_LONGTEXT, false )
     add_string( "smb-domain", NULL, DOMAIN_TEXT,
                 DOMAIN_LONGTEXT, false )
+    add_integer_with_range( "smb-readsize", 1 << 20, 1 << 16, 1 << 23,
+                            READSIZE_TEXT, READSIZE_LONGTEXT, true )
     add_shortcut( "smb" )
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -92,6 +98,14 @@ struct access_sys_t
 {
     int i_smb;
     uint64_t size;
+
+    /* Data of the last large read */
+    uint8_t *p_buffer;
+    size_t   i_buffer_size;
+    size_t   i_buffered;
+    size_t   i_offset;     /* bytes of the buffer already read */
+
+    access_stats_t stats;
 };
 
 #ifdef _WIN32
@@ -241,6 +255,15 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->i_smb = i_smb;
 
+    p_sys->i_buffer_size = var_InheritInteger( p_access, "smb-readsize" );
+    p_sys->p_buffer = malloc( p_sys->i_buffer_size );
+    if( unlikely(p_sys->p_buffer == NULL) )
+    {
+        smbc_close( i_smb );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
     return VLC_SUCCESS;
 }
 
@@ -253,6 +276,7 @@ static void Close( vlc_object_t *p_this )
     access_sys_t *p_sys = p_access->p_sys;
 
     smbc_close( p_sys->i_smb );
+    free( p_sys->p_buffer );
     free( p_sys );
 }
 
@@ -267,6 +291,16 @@ static int Seek( access_t *p_access, uint64_t i_pos )
     if( i_pos >= INT64_MAX )
         return VLC_EGENERIC;
 
+    /* Within the last read: nothing to ask to the server */
+    uint64_t i_start = p_access->info.i_pos - p_sys->i_offset;
+    if( i_pos >= i_start && i_pos < i_start + p_sys->i_buffered )
+    {
+        p_sys->i_offset = i_pos - i_start;
+        p_access->info.b_eof = false;
+        p_access->info.i_pos = i_pos;
+        return VLC_SUCCESS;
+    }
+
     msg_Dbg( p_access, "seeking to %"PRId64, i_pos );
 
     i_ret = smbc_lseek( p_sys->i_smb, i_pos, SEEK_SET );
@@ -275,6 +309,7 @@ static int Seek( access_t *p_access, uint64_t i_pos )
         msg_Err( p_access, "seek failed (%s)", vlc_strerror_c(errno) );
         return VLC_EGENERIC;
     }
+    p_sys->i_buffered = p_sys->i_offset = 0;
 
     p_access->info.b_eof = false;
     p_access->info.i_pos = i_ret;
@@ -292,15 +327,43 @@ static ssize_t Read( access_t *p_access, uint8_t *p_buffer, size_t i_len )
 
     if( p_access->info.b_eof ) return 0;
 
-    i_read = smbc_read( p_sys->i_smb, p_buffer, i_len );
-    if( i_read < 0 )
+    if( p_sys->i_offset == p_sys->i_buffered )
     {
-        msg_Err( p_access, "read failed (%s)", vlc_strerror_c(errno) );
-        return -1;
+        /* Read much more than asked, as the server answers large reads
+         * with large (multi-credit) responses in a single round trip */
+        bool b_direct = i_len >= p_sys->i_buffer_size;
+        uint8_t *p_dst = b_direct ? p_buffer : p_sys->p_buffer;
+        mtime_t i_start = mdate();
+
+        i_read = smbc_read( p_sys->i_smb, p_dst,
+                            b_direct ? i_len : p_sys->i_buffer_size );
+        p_sys->stats.i_wait += mdate() - i_start;
+        if( i_read < 0 )
+        {
+            msg_Err( p_access, "read failed (%s)", vlc_strerror_c(errno) );
+            return -1;
+        }
+        p_sys->stats.i_requests++;
+        p_sys->stats.i_bytes += i_read;
+
+        if( i_read == 0 )
+        {
+            p_access->info.b_eof = true;
+            return 0;
+        }
+        if( b_direct )
+        {
+            p_access->info.i_pos += i_read;
+            return i_read;
+        }
+        p_sys->i_buffered = i_read;
+        p_sys->i_offset = 0;
     }
 
-    if( i_read == 0 ) p_access->info.b_eof = true;
-    else if( i_read > 0 ) p_access->info.i_pos += i_read;
+    i_read = __MIN( i_len, p_sys->i_buffered - p_sys->i_offset );
+    memcpy( p_buffer, &p_sys->p_buffer[p_sys->i_offset], i_read );
+    p_sys->i_offset += i_read;
+    p_access->info.i_pos += i_read;
 
     return i_read;
 }
@@ -328,6 +391,10 @@ static int Control( access_t *p_access, int i_query, va_list args )
             * var_InheritInteger( p_access, "network-caching" );
         break;
 
+    case ACCESS_GET_STATS:
+        *va_arg( args, access_stats_t * ) = p_access->p_sys->stats;
+        break;
+
     case ACCESS_SET_PAUSE_STATE:
         /* Nothing to do */
         break;
@@ -45,6 +45,20 @@
 
 #define MTU 65535
 
+#ifdef HAVE_RECVMMSG
+/* Number of datagrams received per system call */
+# define UDP_BATCH 32
+#endif
+
+#if defined(HAVE_RECVMMSG) && defined(IP_PKTINFO) && defined(IPV6_RECVPKTINFO) \
+ && defined(MCAST_JOIN_SOURCE_GROUP)
+/* Multicast groups received on a single socket per port */
+# define UDP_SHARED 1
+# include <assert.h>
+# include <poll.h>
+# include <net/if.h>
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -53,6 +67,10 @@ static void Close( vlc_object_t * );
 
 #define BUFFER_TEXT N_("Receive buffer")
 #define BUFFER_LONGTEXT N_("UDP receive buffer size (bytes)" )
+#define SHARED_TEXT N_("Share the multicast sockets")
+#define SHARED_LONGTEXT N_("Receive all the multicast groups of a port " \
+    "with a single socket and thread, rather than one per input. This " \
+    "saves resources when many groups are received at once." )
 
 vlc_module_begin ()
     set_shortname( N_("UDP" ) )
@@ -62,6 +80,9 @@ vlc_module_begin ()
 
     add_obsolete_integer( "server-port" ) /* since 2.0.0 */
     add_integer( "udp-buffer", 0x400000, BUFFER_TEXT, BUFFER_LONGTEXT, true )
+#ifdef UDP_SHARED
+    add_bool( "udp-shared", false, SHARED_TEXT, SHARED_LONGTEXT, true )
+#endif
 
     set_capability( "access", 0 )
     add_shortcut( "udp", "udpstream", "udp4", "udp6" )
@@ -69,12 +90,22 @@ vlc_module_begin ()
     set_callbacks( Open, Close )
 vlc_module_end ()
 
+#ifdef UDP_SHARED
+typedef struct udp_member udp_member_t;
+typedef struct udp_receiver udp_receiver_t;
+#endif
+
 struct access_sys_t
 {
     int fd;
     size_t fifo_size;
     block_fifo_t *fifo;
     vlc_thread_t thread;
+#ifdef UDP_SHARED
+    udp_receiver_t *receiver; /* NULL if the socket is not shared */
+    udp_member_t *member;
+    mtime_t stats_date;
+#endif
 };
 
 /*****************************************************************************
@@ -83,6 +114,11 @@ struct access_sys_t
 static block_t *BlockUDP( access_t * );
 static int Control( access_t *, int, va_list );
 static void* ThreadRead( void *data );
+#ifdef UDP_SHARED
+static int SharedOpen( access_t *, const char *, int, const char * );
+static void SharedClose( access_t * );
+static void SharedStats( access_t *, bool );
+#endif
 
 /*****************************************************************************
  * Open: open the socket
@@ -150,6 +186,17 @@ static int Open( vlc_object_t *p_this )
     msg_Dbg( p_access, "opening server=%s:%d local=%s:%d",
              psz_server_addr, i_server_port, psz_bind_addr, i_bind_port );
 
+#ifdef UDP_SHARED
+    sys->receiver = NULL;
+    if( var_InheritBool( p_access, "udp-shared" )
+     && SharedOpen( p_access, psz_bind_addr, i_bind_port,
+                    psz_server_addr ) == VLC_SUCCESS )
+    {
+        free( psz_name );
+        return VLC_SUCCESS;
+    }
+#endif
+
     sys->fd = net_OpenDgram( p_access, psz_bind_addr, i_bind_port,
                              psz_server_addr, i_server_port, IPPROTO_UDP );
     free( psz_name );
@@ -159,7 +206,7 @@ static int Open( vlc_object_t *p_this )
         goto error;
     }
 
-    sys->fifo = block_FifoNew();
+    sys->fifo = block_FifoNewSPSC();
     if( unlikely( sys->fifo == NULL ) )
     {
         net_Close( sys->fd );
@@ -189,6 +236,14 @@ static void Close( vlc_object_t *p_this )
     access_t     *p_access = (access_t*)p_this;
     access_sys_t *sys = p_access->p_sys;
 
+#ifdef UDP_SHARED
+    if( sys->receiver != NULL )
+    {
+        SharedClose( p_access );
+        free( sys );
+        return;
+    }
+#endif
     vlc_cancel( sys->thread );
     vlc_join( sys->thread, NULL );
     block_FifoRelease( sys->fifo );
@@ -233,9 +288,117 @@ static block_t *BlockUDP( access_t *p_access )
 {
     access_sys_t *sys = p_access->p_sys;
 
-    return block_FifoGet( sys->fifo );
+#ifdef UDP_SHARED
+    if( sys->receiver != NULL && mdate() - sys->stats_date > 10 * CLOCK_FREQ )
+    {
+        SharedStats( p_access, false );
+        sys->stats_date = mdate();
+    }
+#endif
+    block_t *block = block_FifoGet( sys->fifo );
+
+    /* Only the reader thread wakes the FIFO up, as it terminates: do not
+     * wait for more data that will never come. */
+    if( block == NULL )
+        p_access->info.b_eof = true;
+    return block;
 }
 
+#ifdef HAVE_RECVMMSG
+static void ReleaseSlots( void *data )
+{
+    block_t **slots = data;
+
+    for( unsigned i = 0; i < UDP_BATCH; i++ )
+        if( slots[i] != NULL )
+            block_Release( slots[i] );
+}
+
+/*****************************************************************************
+ * ThreadRead: Pull packets from socket as soon as possible.
+ *****************************************************************************
+ * Once a datagram has arrived, the ones already queued in the socket are
+ * received with a single system call, up to UDP_BATCH in total, into a ring
+ * of pre-allocated blocks. The received blocks are then queued to the FIFO
+ * as a single chain, and only the consumed slots are reallocated.
+ *****************************************************************************/
+static void* ThreadRead( void *data )
+{
+    access_t *access = data;
+    access_sys_t *sys = access->p_sys;
+    block_t *slots[UDP_BATCH];
+    struct iovec iov[UDP_BATCH];
+    struct mmsghdr msgs[UDP_BATCH];
+
+    for( unsigned i = 0; i < UDP_BATCH; i++ )
+        slots[i] = NULL;
+
+    vlc_cleanup_push( ReleaseSlots, slots );
+    for( ;; )
+    {
+        unsigned n;
+
+        block_FifoPace( sys->fifo, SIZE_MAX, sys->fifo_size );
+
+        for( n = 0; n < UDP_BATCH; n++ )
+        {
+            if( slots[n] == NULL )
+            {
+                slots[n] = block_Alloc( MTU );
+                if( unlikely(slots[n] == NULL) )
+                    break;
+            }
+
+            iov[n].iov_base = slots[n]->p_buffer;
+            iov[n].iov_len = MTU;
+            memset( &msgs[n].msg_hdr, 0, sizeof( msgs[n].msg_hdr ) );
+            msgs[n].msg_hdr.msg_iov = &iov[n];
+            msgs[n].msg_hdr.msg_iovlen = 1;
+        }
+
+        if( unlikely(n == 0) )
+            break;
+
+        /* Wait for the first datagram, then take whatever else is queued */
+        ssize_t len = net_Read( access, sys->fd, NULL, slots[0]->p_buffer, MTU,
+                                false );
+        if( len == -1 )
+        {
+            if( errno == EINTR )
+                break;
+            continue;
+        }
+        msgs[0].msg_len = len;
+
+        int val = 1;
+        if( n > 1 )
+        {
+            int more = recvmmsg( sys->fd, msgs + 1, n - 1, MSG_DONTWAIT,
+                                 NULL );
+            if( more > 0 )
+                val += more;
+        }
+
+        block_t *chain = NULL, **pp = &chain;
+
+        for( int i = 0; i < val; i++ )
+        {
+            block_t *pkt = slots[i];
+
+            pkt->i_buffer = msgs[i].msg_len;
+            *pp = pkt;
+            pp = &pkt->p_next;
+            slots[i] = NULL;
+        }
+
+        block_FifoPut( sys->fifo, chain );
+    }
+    vlc_cleanup_run();
+
+    block_FifoWake( sys->fifo );
+    return NULL;
+}
+#else
 /*****************************************************************************
  * ThreadRead: Pull packets from socket as soon as possible.
  *****************************************************************************/
@@ -275,3 +438,533 @@ static void* ThreadRead( void *data )
     block_FifoWake( sys->fifo );
     return NULL;
 }
+#endif
+
+#ifdef UDP_SHARED
+/*****************************************************************************
+ * Shared multicast reception
+ *****************************************************************************
+ * All the inputs of multicast groups on the same port share one socket bound
+ * to the wildcard address, and one thread. The socket joins every group, and
+ * the thread dispatches each batch of datagrams to the FIFO of the input of
+ * their destination (and source, for SSM) address, as told by IP_PKTINFO.
+ *****************************************************************************/
+#define UDP_SHARED_BUCKETS 64
+
+struct udp_member
+{
+    udp_member_t *next; /* in its hash bucket */
+    struct sockaddr_storage group;
+    struct sockaddr_storage source; /* AF_UNSPEC for any-source multicast */
+    unsigned ifindex;
+    block_fifo_t *fifo;
+    size_t fifo_depth; /* datagrams */
+
+    block_t *batch; /* datagrams of the current batch */
+    block_t **batch_last;
+
+    /* Statistics */
+    uint64_t packets;
+    uint64_t bytes;
+    unsigned dropped; /* FIFO overflows */
+    unsigned discontinuities; /* MPEG-TS continuity errors */
+    unsigned reported_dropped;
+    unsigned reported_discontinuities;
+    uint8_t cc[8192]; /* last continuity counter per PID, 0xff if none */
+};
+
+struct udp_receiver
+{
+    udp_receiver_t *next;
+    int family;
+    int port;
+    int fd;
+    unsigned refs;
+    vlc_thread_t thread;
+    vlc_mutex_t lock; /* protects the buckets and the members */
+    udp_member_t *buckets[UDP_SHARED_BUCKETS];
+};
+
+static vlc_mutex_t receivers_lock = VLC_STATIC_MUTEX;
+static udp_receiver_t *receivers = NULL;
+
+static const uint8_t *AddrBytes( const struct sockaddr *addr, size_t *len )
+{
+    if( addr->sa_family == AF_INET6 )
+    {
+        *len = 16;
+        return ((const struct sockaddr_in6 *)addr)->sin6_addr.s6_addr;
+    }
+    *len = 4;
+    return (const uint8_t *)&((const struct sockaddr_in *)addr)->sin_addr;
+}
+
+static unsigned AddrHash( const struct sockaddr *addr )
+{
+    size_t len;
+    const uint8_t *p = AddrBytes( addr, &len );
+    unsigned hash = 0;
+
+    while( len-- > 0 )
+        hash = hash * 31 + *(p++);
+    return hash % UDP_SHARED_BUCKETS;
+}
+
+/* Compares the addresses, not the ports */
+static bool AddrEqual( const struct sockaddr *a, const struct sockaddr *b )
+{
+    size_t len_a, len_b;
+
+    if( a->sa_family != b->sa_family )
+        return false;
+
+    const uint8_t *pa = AddrBytes( a, &len_a );
+    const uint8_t *pb = AddrBytes( b, &len_b );
+    return !memcmp( pa, pb, len_a );
+}
+
+/* Joins or leaves the group of the member on the shared socket */
+static int SharedSubscribe( udp_receiver_t *r, udp_member_t *m, bool join )
+{
+    int level = ( r->family == AF_INET6 ) ? SOL_IPV6 : SOL_IP;
+
+    if( m->source.ss_family == AF_UNSPEC )
+    {
+        struct group_req gr;
+
+        memset( &gr, 0, sizeof (gr) );
+        gr.gr_interface = m->ifindex;
+        memcpy( &gr.gr_group, &m->group, sizeof (gr.gr_group) );
+        return setsockopt( r->fd, level,
+                           join ? MCAST_JOIN_GROUP : MCAST_LEAVE_GROUP,
+                           &gr, sizeof (gr) );
+    }
+    else
+    {
+        struct group_source_req gsr;
+
+        memset( &gsr, 0, sizeof (gsr) );
+        gsr.gsr_interface = m->ifindex;
+        memcpy( &gsr.gsr_group, &m->group, sizeof (gsr.gsr_group) );
+        memcpy( &gsr.gsr_source, &m->source, sizeof (gsr.gsr_source) );
+        return setsockopt( r->fd, level,
+                           join ? MCAST_JOIN_SOURCE_GROUP
+                                : MCAST_LEAVE_SOURCE_GROUP,
+                           &gsr, sizeof (gsr) );
+    }
+}
+
+/* Counts the continuity errors of MPEG-TS datagrams, ignores anything else */
+static void CheckContinuity( udp_member_t *m, const uint8_t *p, size_t len )
+{
+    for( ; len >= 188 && p[0] == 0x47; p += 188, len -= 188 )
+    {
+        unsigned pid = ((p[1] & 0x1f) << 8) | p[2];
+        uint8_t cc = p[3] & 0x0f;
+
+        if( pid == 0x1fff || !(p[3] & 0x10) ) /* null or no payload */
+            continue;
+        if( m->cc[pid] != 0xff && cc != m->cc[pid] /* duplicate */
+         && cc != ((m->cc[pid] + 1) & 0xf) )
+            m->discontinuities++;
+        m->cc[pid] = cc;
+    }
+}
+
+/* Destination address of a received datagram, from IP_PKTINFO */
+static bool GetDestination( struct msghdr *hdr, struct sockaddr_storage *dst )
+{
+    for( struct cmsghdr *cmsg = CMSG_FIRSTHDR( hdr ); cmsg != NULL;
+         cmsg = CMSG_NXTHDR( hdr, cmsg ) )
+    {
+        if( cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_PKTINFO )
+        {
+            struct in_pktinfo info;
+            struct sockaddr_in *sin = (struct sockaddr_in *)dst;
+
+            memcpy( &info, CMSG_DATA( cmsg ), sizeof (info) );
+            sin->sin_family = AF_INET;
+            sin->sin_addr = info.ipi_addr;
+            return true;
+        }
+        if( cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO )
+        {
+            struct in6_pktinfo info;
+            struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)dst;
+
+            memcpy( &info, CMSG_DATA( cmsg ), sizeof (info) );
+            sin6->sin6_family = AF_INET6;
+            sin6->sin6_addr = info.ipi6_addr;
+            return true;
+        }
+    }
+    return false;
+}
+
+static udp_member_t *SharedLookup( udp_receiver_t *r,
+                                   const struct sockaddr *dst,
+                                   const struct sockaddr *src )
+{
+    for( udp_member_t *m = r->buckets[AddrHash( dst )]; m; m = m->next )
+        if( AddrEqual( (struct sockaddr *)&m->group, dst )
+         && ( m->source.ss_family == AF_UNSPEC
+           || AddrEqual( (struct sockaddr *)&m->source, src ) ) )
+            return m;
+    return NULL;
+}
+
+static void* SharedThread( void *data )
+{
+    udp_receiver_t *r = data;
+    block_t *slots[UDP_BATCH];
+    struct iovec iov[UDP_BATCH];
+    struct mmsghdr msgs[UDP_BATCH];
+    struct sockaddr_storage sources[UDP_BATCH];
+    union
+    {
+        char buf[CMSG_SPACE(sizeof (struct in6_pktinfo))];
+        struct cmsghdr align;
+    } control[UDP_BATCH];
+    udp_member_t *touched[UDP_BATCH];
+
+    for( unsigned i = 0; i < UDP_BATCH; i++ )
+        slots[i] = NULL;
+
+    vlc_cleanup_push( ReleaseSlots, slots );
+    for( ;; )
+    {
+        unsigned n;
+
+        for( n = 0; n < UDP_BATCH; n++ )
+        {
+            if( slots[n] == NULL )
+            {
+                slots[n] = block_Alloc( MTU );
+                if( unlikely(slots[n] == NULL) )
+                    break;
+            }
+
+            iov[n].iov_base = slots[n]->p_buffer;
+            iov[n].iov_len = MTU;
+            memset( &msgs[n].msg_hdr, 0, sizeof( msgs[n].msg_hdr ) );
+            msgs[n].msg_hdr.msg_name = &sources[n];
+            msgs[n].msg_hdr.msg_namelen = sizeof (sources[n]);
+            msgs[n].msg_hdr.msg_iov = &iov[n];
+            msgs[n].msg_hdr.msg_iovlen = 1;
+            msgs[n].msg_hdr.msg_control = control[n].buf;
+            msgs[n].msg_hdr.msg_controllen = sizeof (control[n].buf);
+        }
+
+        if( unlikely(n == 0) )
+            break;
+
+        struct pollfd ufd = { .fd = r->fd, .events = POLLIN };
+        if( poll( &ufd, 1, -1 ) < 0 )
+            continue;
+
+        int val = recvmmsg( r->fd, msgs, n, MSG_DONTWAIT, NULL );
+        if( val <= 0 )
+            continue;
+
+        unsigned count = 0;
+        int canc = vlc_savecancel();
+        vlc_mutex_lock( &r->lock );
+        for( int i = 0; i < val; i++ )
+        {
+            struct sockaddr_storage dst;
+            udp_member_t *m;
+
+            if( msgs[i].msg_hdr.msg_flags & MSG_TRUNC
+             || !GetDestination( &msgs[i].msg_hdr, &dst )
+             || ( m = SharedLookup( r, (struct sockaddr *)&dst,
+                                    (struct sockaddr *)&sources[i] ) ) == NULL )
+                continue; /* the slot is reused */
+
+            block_t *pkt = slots[i];
+            slots[i] = NULL;
+            pkt->i_buffer = msgs[i].msg_len;
+
+            m->packets++;
+            m->bytes += pkt->i_buffer;
+            CheckContinuity( m, pkt->p_buffer, pkt->i_buffer );
+
+            /* the other groups must not wait for a slow input */
+            if( block_FifoCount( m->fifo ) >= m->fifo_depth )
+            {
+                m->dropped++;
+                block_Release( pkt );
+                continue;
+            }
+
+            if( m->batch == NULL )
+            {
+                m->batch_last = &m->batch;
+                touched[count++] = m;
+            }
+            *m->batch_last = pkt;
+            m->batch_last = &pkt->p_next;
+        }
+
+        /* queue the datagrams of a batch at once to each input */
+        for( unsigned i = 0; i < count; i++ )
+        {
+            block_FifoPut( touched[i]->fifo, touched[i]->batch );
+            touched[i]->batch = NULL;
+        }
+        vlc_mutex_unlock( &r->lock );
+        vlc_restorecancel( canc );
+    }
+    vlc_cleanup_run();
+    return NULL;
+}
+
+static udp_receiver_t *ReceiverNew( access_t *access, int family, int port )
+{
+    udp_receiver_t *r = calloc( 1, sizeof (*r) );
+    if( unlikely(r == NULL) )
+        return NULL;
+
+    r->family = family;
+    r->port = port;
+    r->fd = vlc_socket( family, SOCK_DGRAM, IPPROTO_UDP, true );
+    if( r->fd == -1 )
+    {
+        free( r );
+        return NULL;
+    }
+
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+
+    memset( &addr, 0, sizeof (addr) );
+    if( family == AF_INET6 )
+    {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&addr;
+
+        setsockopt( r->fd, SOL_IPV6, IPV6_V6ONLY, &(int){ 1 }, sizeof (int) );
+        setsockopt( r->fd, SOL_IPV6, IPV6_RECVPKTINFO, &(int){ 1 },
+                    sizeof (int) );
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_addr = in6addr_any;
+        sin6->sin6_port = htons( port );
+        addrlen = sizeof (*sin6);
+    }
+    else
+    {
+        struct sockaddr_in *sin = (struct sockaddr_in *)&addr;
+
+        setsockopt( r->fd, SOL_IP, IP_PKTINFO, &(int){ 1 }, sizeof (int) );
+        sin->sin_family = AF_INET;
+        sin->sin_addr.s_addr = htonl( INADDR_ANY );
+        sin->sin_port = htons( port );
+        addrlen = sizeof (*sin);
+    }
+    setsockopt( r->fd, SOL_SOCKET, SO_REUSEADDR, &(int){ 1 }, sizeof (int) );
+    /* the kernel buffer is shared by all the groups */
+    setsockopt( r->fd, SOL_SOCKET, SO_RCVBUF,
+                &(int){ var_InheritInteger( access, "udp-buffer" ) },
+                sizeof (int) );
+
+    if( bind( r->fd, (struct sockaddr *)&addr, addrlen ) )
+    {
+        msg_Err( access, "socket bind error: %s", vlc_strerror_c(errno) );
+        goto error;
+    }
+
+    vlc_mutex_init( &r->lock );
+    if( vlc_clone( &r->thread, SharedThread, r, VLC_THREAD_PRIORITY_INPUT ) )
+    {
+        vlc_mutex_destroy( &r->lock );
+        goto error;
+    }
+    msg_Dbg( access, "shared multicast socket for port %d", port );
+    return r;
+
+error:
+    net_Close( r->fd );
+    free( r );
+    return NULL;
+}
+
+static void ReceiverDelete( udp_receiver_t *r )
+{
+    vlc_cancel( r->thread );
+    vlc_join( r->thread, NULL );
+    vlc_mutex_destroy( &r->lock );
+    net_Close( r->fd );
+    free( r );
+}
+
+/* Resolves the numeric or host name address of a shared input */
+static bool SharedResolve( const char *host, int port,
+                          int family, struct sockaddr_storage *addr )
+{
+    struct addrinfo hints = {
+        .ai_family = family,
+        .ai_socktype = SOCK_DGRAM,
+        .ai_protocol = IPPROTO_UDP,
+        .ai_flags = AI_NUMERICSERV | AI_IDN,
+    }, *res;
+
+    if( vlc_getaddrinfo( host, port, &hints, &res ) )
+        return false;
+
+    bool ok = res->ai_addrlen <= sizeof (*addr)
+           && ( res->ai_family == AF_INET || res->ai_family == AF_INET6 );
+    if( ok )
+    {
+        memset( addr, 0, sizeof (*addr) );
+        memcpy( addr, res->ai_addr, res->ai_addrlen );
+    }
+    freeaddrinfo( res );
+    return ok;
+}
+
+/*****************************************************************************
+ * SharedOpen: receives the multicast group through the shared socket of its
+ * port; fails if the input is not a multicast one, so that it gets its own
+ * socket instead
+ *****************************************************************************/
+static int SharedOpen( access_t *access, const char *group, int port,
+                       const char *source )
+{
+    access_sys_t *sys = access->p_sys;
+    udp_member_t *m = malloc( sizeof (*m) );
+    if( unlikely(m == NULL) )
+        return VLC_ENOMEM;
+
+    memset( m, 0, offsetof (udp_member_t, cc) );
+    memset( m->cc, 0xff, sizeof (m->cc) );
+
+    if( *group == '\0'
+     || !SharedResolve( group, port, AF_UNSPEC, &m->group )
+     || !net_SockAddrIsMulticast( (struct sockaddr *)&m->group,
+                                  sizeof (m->group) ) )
+        goto error;
+
+    m->source.ss_family = AF_UNSPEC;
+    if( *source != '\0'
+     && !SharedResolve( source, 0, m->group.ss_family, &m->source ) )
+        goto error;
+
+    char *ifname = var_InheritString( access, "miface" );
+    if( ifname != NULL )
+    {
+        m->ifindex = if_nametoindex( ifname );
+        free( ifname );
+    }
+
+    m->fifo = block_FifoNewSPSC();
+    if( unlikely(m->fifo == NULL) )
+        goto error;
+    sys->fifo = m->fifo;
+    sys->fifo_size = var_InheritInteger( access, "udp-buffer" );
+    /* in datagrams of 7 TS packets, for the shared thread never blocks */
+    m->fifo_depth = __MAX( sys->fifo_size / (7 * 188), 1 );
+
+    vlc_mutex_lock( &receivers_lock );
+    udp_receiver_t *r;
+    for( r = receivers; r != NULL; r = r->next )
+        if( r->family == m->group.ss_family && r->port == port )
+            break;
+
+    if( r == NULL )
+    {
+        r = ReceiverNew( access, m->group.ss_family, port );
+        if( r == NULL )
+        {
+            vlc_mutex_unlock( &receivers_lock );
+            block_FifoRelease( m->fifo );
+            goto error;
+        }
+        r->next = receivers;
+        receivers = r;
+    }
+
+    if( SharedSubscribe( r, m, true ) )
+    {
+        msg_Err( access, "cannot join multicast group: %s",
+                 vlc_strerror_c(errno) );
+        if( r->refs == 0 )
+        {
+            receivers = r->next;
+            ReceiverDelete( r );
+        }
+        vlc_mutex_unlock( &receivers_lock );
+        block_FifoRelease( m->fifo );
+        goto error;
+    }
+
+    unsigned bucket = AddrHash( (struct sockaddr *)&m->group );
+    vlc_mutex_lock( &r->lock );
+    m->next = r->buckets[bucket];
+    r->buckets[bucket] = m;
+    vlc_mutex_unlock( &r->lock );
+    r->refs++;
+    vlc_mutex_unlock( &receivers_lock );
+
+    sys->receiver = r;
+    sys->member = m;
+    sys->stats_date = mdate();
+    msg_Dbg( access, "receiving through the shared socket of port %d", port );
+    return VLC_SUCCESS;
+
+error:
+    free( m );
+    return VLC_EGENERIC;
+}
+
+static void SharedClose( access_t *access )
+{
+    access_sys_t *sys = access->p_sys;
+    udp_receiver_t *r = sys->receiver;
+    udp_member_t *m = sys->member;
+
+    SharedStats( access, true );
+
+    vlc_mutex_lock( &receivers_lock );
+    vlc_mutex_lock( &r->lock );
+    udp_member_t **pp = &r->buckets[AddrHash( (struct sockaddr *)&m->group )];
+    while( *pp != m )
+        pp = &(*pp)->next;
+    *pp = m->next;
+    vlc_mutex_unlock( &r->lock );
+
+    SharedSubscribe( r, m, false );
+
+    assert( r->refs > 0 );
+    if( --r->refs == 0 )
+    {
+        udp_receiver_t **pr = &receivers;
+        while( *pr != r )
+            pr = &(*pr)->next;
+        *pr = r->next;
+        ReceiverDelete( r );
+    }
+    vlc_mutex_unlock( &receivers_lock );
+
+    block_FifoRelease( m->fifo );
+    free( m );
+}
+
+/* Reports the losses of the group, if any since the last report */
+static void SharedStats( access_t *access, bool final )
+{
+    access_sys_t *sys = access->p_sys;
+    udp_member_t *m = sys->member;
+
+    vlc_mutex_lock( &sys->receiver->lock );
+    if( final )
+        msg_Dbg( access, "%"PRIu64" datagrams (%"PRIu64" bytes) received, "
+                 "%u dropped, %u continuity errors", m->packets, m->bytes,
+                 m->dropped, m->discontinuities );
+    else if( m->dropped > m->reported_dropped
+          || m->discontinuities > m->reported_discontinuities )
+        msg_Warn( access, "%u datagrams dropped, %u continuity errors",
+                  m->dropped - m->reported_dropped,
+                  m->discontinuities - m->reported_discontinuities );
+    m->reported_dropped = m->dropped;
+    m->reported_discontinuities = m->discontinuities;
+    vlc_mutex_unlock( &sys->receiver->lock );
+}
+#endif
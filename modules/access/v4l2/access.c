@@ -45,7 +45,7 @@ struct access_sys_t
         uint32_t bufc;
         uint32_t blocksize;
     };
-    struct buffer_t *bufv;
+    vlc_v4l2_buffers_t *bufv;
     vlc_v4l2_ctrl_t *controls;
 };
 
@@ -162,7 +162,7 @@ int InitVideo (access_t *access, int fd, uint32_t caps)
     /* Init I/O method */
     if (caps & V4L2_CAP_STREAMING)
     {
-        sys->bufc = 4;
+        sys->bufc = GetBufferCount (VLC_OBJECT(access), &fmt, &parm);
         sys->bufv = StartMmap (VLC_OBJECT(access), fd, &sys->bufc);
         if (sys->bufv == NULL)
             return -1;
@@ -189,7 +189,7 @@ void AccessClose( vlc_object_t *obj )
     access_sys_t *sys = access->p_sys;
 
     if (sys->bufv != NULL)
-        StopMmap (sys->fd, sys->bufv, sys->bufc);
+        StopMmap (obj, sys->bufv);
     ControlsDeinit( obj, sys->controls );
     v4l2_close (sys->fd);
     free( sys );
@@ -47,7 +47,7 @@ struct demux_sys_t
     int fd;
     vlc_thread_t thread;
 
-    struct buffer_t *bufv;
+    vlc_v4l2_buffers_t *bufv;
     union
     {
         uint32_t bufc;
@@ -431,7 +431,7 @@ static int InitVideo (demux_t *demux, int fd, uint32_t caps)
         }
         else /* fall back to memory map */
         {
-            sys->bufc = 4;
+            sys->bufc = GetBufferCount (VLC_OBJECT(demux), &fmt, &parm);
             sys->bufv = StartMmap (VLC_OBJECT(demux), fd, &sys->bufc);
             if (sys->bufv == NULL)
                 return -1;
@@ -470,7 +470,7 @@ static int InitVideo (demux_t *demux, int fd, uint32_t caps)
             CloseVBI (sys->vbi);
 #endif
         if (sys->bufv != NULL)
-            StopMmap (sys->fd, sys->bufv, sys->bufc);
+            StopMmap (VLC_OBJECT(demux), sys->bufv);
         return -1;
     }
     return 0;
@@ -484,7 +484,7 @@ void DemuxClose( vlc_object_t *obj )
     vlc_cancel (sys->thread);
     vlc_join (sys->thread, NULL);
     if (sys->bufv != NULL)
-        StopMmap (sys->fd, sys->bufv, sys->bufc);
+        StopMmap (VLC_OBJECT(demux), sys->bufv);
     ControlsDeinit( obj, sys->controls );
     v4l2_close (sys->fd);
 
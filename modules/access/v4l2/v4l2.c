@@ -69,6 +69,13 @@
     "(if both width and height are strictly positive)." )
 #define FPS_TEXT N_( "Frame rate" )
 #define FPS_LONGTEXT N_( "Maximum frame rate to use (0 = no limits)." )
+#define BUFFERS_TEXT N_( "Capture buffers" )
+#define BUFFERS_LONGTEXT N_( \
+    "Number of memory-mapped capture buffers (0 = automatic)." )
+#define ZERO_COPY_TEXT N_( "Zero-copy capture" )
+#define ZERO_COPY_LONGTEXT N_( \
+    "Pass the memory-mapped capture buffers on, instead of copying the " \
+    "frames. A buffer is given back to the device once it is released." )
 
 #define RADIO_DEVICE_TEXT N_( "Radio device" )
 #define RADIO_DEVICE_LONGTEXT N_("Radio tuner device node." )
@@ -312,6 +319,13 @@ vlc_module_begin ()
         change_safe()
     add_string( CFG_PREFIX "fps", "60", FPS_TEXT, FPS_LONGTEXT, false )
         change_safe()
+    add_integer( CFG_PREFIX "buffers", 0, BUFFERS_TEXT, BUFFERS_LONGTEXT,
+                 true )
+        change_integer_range( 0, 32 )
+        change_safe()
+    add_bool( CFG_PREFIX "zero-copy", true, ZERO_COPY_TEXT,
+              ZERO_COPY_LONGTEXT, true )
+        change_safe()
     add_obsolete_bool( CFG_PREFIX "use-libv4l2" ) /* since 2.1.0 */
 
     set_section( N_( "Tuner" ), NULL )
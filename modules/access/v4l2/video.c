@@ -35,6 +35,7 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 
 #include "v4l2.h"
 
@@ -579,11 +580,89 @@ mtime_t GetBufferPTS (const struct v4l2_buffer *buf)
     return pts;
 }
 
+/*
+ * Memory-mapped buffers
+ *
+ * In zero-copy mode, a dequeued buffer is wrapped in a block and passed on
+ * as is. It is queued back to the device when the block is released, from
+ * whichever thread that happens. A copy is made instead when too few buffers
+ * are left to the device, lest frames be dropped while the decoder holds
+ * onto them. The pool is reference counted by the pending blocks, so that
+ * the mappings outlive StopMmap() if need be.
+ */
+struct vlc_v4l2_buffer
+{
+    block_t             self;
+    vlc_v4l2_buffers_t *pool;
+    uint32_t            index;
+    void               *start;
+    size_t              length;
+};
+
+struct vlc_v4l2_buffers
+{
+    int         fd;
+    bool        zero_copy;
+    bool        streaming; /**< Protected by lock */
+    vlc_mutex_t lock;
+    atomic_uint refs;
+    atomic_uint queued; /**< Buffers owned by the device */
+
+    /* Statistics (capture thread only) */
+    uint32_t    sequence;
+    unsigned    frames;
+    unsigned    lost;
+    unsigned    gaps;
+    unsigned    errors;
+    unsigned    copies;
+
+    uint32_t    count;
+    struct vlc_v4l2_buffer bufv[];
+};
+
+static void ReleaseBuffers (vlc_v4l2_buffers_t *pool)
+{
+    if (atomic_fetch_sub (&pool->refs, 1) != 1)
+        return;
+
+    for (uint32_t i = 0; i < pool->count; i++)
+        v4l2_munmap (pool->bufv[i].start, pool->bufv[i].length);
+    vlc_mutex_destroy (&pool->lock);
+    free (pool);
+}
+
+static int QueueBuffer (vlc_v4l2_buffers_t *pool, uint32_t index)
+{
+    struct v4l2_buffer buf = {
+        .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+        .memory = V4L2_MEMORY_MMAP,
+        .index = index,
+    };
+
+    if (v4l2_ioctl (pool->fd, VIDIOC_QBUF, &buf) < 0)
+        return -1;
+    atomic_fetch_add (&pool->queued, 1);
+    return 0;
+}
+
+static void ReleaseBlock (block_t *block)
+{
+    struct vlc_v4l2_buffer *b = (struct vlc_v4l2_buffer *)block;
+    vlc_v4l2_buffers_t *pool = b->pool;
+
+    /* The device must not be closed while the buffer is queued */
+    vlc_mutex_lock (&pool->lock);
+    if (pool->streaming)
+        QueueBuffer (pool, b->index);
+    vlc_mutex_unlock (&pool->lock);
+    ReleaseBuffers (pool);
+}
+
 /*****************************************************************************
  * GrabVideo: Grab a video frame
  *****************************************************************************/
 block_t *GrabVideo (vlc_object_t *demux, int fd,
-                    const struct buffer_t *restrict bufv)
+                    vlc_v4l2_buffers_t *restrict pool)
 {
     struct v4l2_buffer buf = {
         .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
@@ -605,20 +684,59 @@ block_t *GrabVideo (vlc_object_t *demux, int fd,
                 return NULL;
         }
     }
+    unsigned queued = atomic_fetch_sub (&pool->queued, 1) - 1;
 
-    /* Copy frame */
-    block_t *block = block_Alloc (buf.bytesused);
-    if (unlikely(block == NULL))
-        return NULL;
-    block->i_pts = block->i_dts = GetBufferPTS (&buf);
-    memcpy (block->p_buffer, bufv[buf.index].start, buf.bytesused);
+    /* Frames skipped by the device show up as sequence number gaps */
+    if (pool->frames > 0
+     && (int32_t)(buf.sequence - pool->sequence) > 1)
+    {
+        uint32_t lost = buf.sequence - pool->sequence - 1;
+
+        msg_Dbg (demux, "%"PRIu32" frame(s) lost", lost);
+        pool->lost += lost;
+        pool->gaps++;
+    }
+    pool->sequence = buf.sequence;
+    pool->frames++;
 
-    /* Unlock */
-    if (v4l2_ioctl (fd, VIDIOC_QBUF, &buf) < 0)
+    block_t *block;
+
+    if (pool->zero_copy && queued >= 2)
     {
-        msg_Err (demux, "queue error: %s", vlc_strerror_c(errno));
-        block_Release (block);
-        return NULL;
+        struct vlc_v4l2_buffer *b = &pool->bufv[buf.index];
+
+        block = &b->self;
+        block_Init (block, b->start, buf.bytesused);
+        block->pf_release = ReleaseBlock;
+        atomic_fetch_add (&pool->refs, 1);
+    }
+    else
+    {
+        /* Copy frame */
+        block = block_Alloc (buf.bytesused);
+        if (likely(block != NULL))
+            memcpy (block->p_buffer, pool->bufv[buf.index].start,
+                    buf.bytesused);
+        if (pool->zero_copy)
+            pool->copies++;
+
+        /* Unlock */
+        if (QueueBuffer (pool, buf.index))
+        {
+            msg_Err (demux, "queue error: %s", vlc_strerror_c(errno));
+            if (block != NULL)
+                block_Release (block);
+            return NULL;
+        }
+        if (unlikely(block == NULL))
+            return NULL;
+    }
+
+    block->i_pts = block->i_dts = GetBufferPTS (&buf);
+    if (buf.flags & V4L2_BUF_FLAG_ERROR)
+    {
+        block->i_flags |= BLOCK_FLAG_CORRUPTED;
+        pool->errors++;
     }
     return block;
 }
@@ -648,12 +766,43 @@ int StartUserPtr (vlc_object_t *obj, int fd)
     return 0;
 }
 
+/**
+ * Computes how many memory-mapped buffers to request: the user setting if
+ * any, otherwise enough for about 200 ms of video (plus the buffers held by
+ * the decoder in zero-copy mode), within a 64 MiB budget.
+ */
+uint32_t GetBufferCount (vlc_object_t *obj, const struct v4l2_format *fmt,
+                         const struct v4l2_streamparm *parm)
+{
+    uint32_t n = var_InheritInteger (obj, CFG_PREFIX"buffers");
+    if (n > 0)
+        return n;
+
+    const struct v4l2_fract *tpf = &parm->parm.capture.timeperframe;
+
+    n = 4;
+    if (tpf->numerator != 0 && tpf->denominator != 0)
+    {
+        uint64_t num = 5 * (uint64_t)tpf->numerator;
+
+        n = (tpf->denominator + num - 1) / num;
+    }
+    if (var_InheritBool (obj, CFG_PREFIX"zero-copy"))
+        n += 2;
+
+    if (fmt->fmt.pix.sizeimage > 0)
+        n = __MIN(n, (64 << 20) / fmt->fmt.pix.sizeimage);
+    n = VLC_CLIP(n, 4, 32);
+    msg_Dbg (obj, "requesting %"PRIu32" buffers", n);
+    return n;
+}
+
 /**
  * Allocates memory-mapped buffers, queues them and start streaming.
  * @param n requested buffers count [IN], allocated buffers count [OUT]
- * @return array of allocated buffers (use free()), or NULL on error.
+ * @return allocated buffers (use StopMmap()), or NULL on error.
  */
-struct buffer_t *StartMmap (vlc_object_t *obj, int fd, uint32_t *restrict n)
+vlc_v4l2_buffers_t *StartMmap (vlc_object_t *obj, int fd, uint32_t *restrict n)
 {
     struct v4l2_requestbuffers req = {
         .count = *n,
@@ -673,41 +822,54 @@ struct buffer_t *StartMmap (vlc_object_t *obj, int fd, uint32_t *restrict n)
         return NULL;
     }
 
-    struct buffer_t *bufv = malloc (req.count * sizeof (*bufv));
-    if (unlikely(bufv == NULL))
+    vlc_v4l2_buffers_t *pool = malloc (sizeof (*pool)
+                                       + req.count * sizeof (pool->bufv[0]));
+    if (unlikely(pool == NULL))
         return NULL;
 
-    uint32_t bufc = 0;
-    while (bufc < req.count)
+    pool->fd = fd;
+    pool->zero_copy = var_InheritBool (obj, CFG_PREFIX"zero-copy");
+    pool->streaming = false;
+    vlc_mutex_init (&pool->lock);
+    atomic_init (&pool->refs, 1);
+    atomic_init (&pool->queued, 0);
+    pool->sequence = 0;
+    pool->frames = pool->lost = pool->gaps = pool->errors = pool->copies = 0;
+    pool->count = 0;
+
+    while (pool->count < req.count)
     {
+        struct vlc_v4l2_buffer *b = &pool->bufv[pool->count];
         struct v4l2_buffer buf = {
             .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
             .memory = V4L2_MEMORY_MMAP,
-            .index = bufc,
+            .index = pool->count,
         };
 
         if (v4l2_ioctl (fd, VIDIOC_QUERYBUF, &buf) < 0)
         {
-            msg_Err (obj, "cannot query buffer %"PRIu32": %s", bufc,
+            msg_Err (obj, "cannot query buffer %"PRIu32": %s", pool->count,
                      vlc_strerror_c(errno));
             goto error;
         }
 
-        bufv[bufc].start = v4l2_mmap (NULL, buf.length, PROT_READ | PROT_WRITE,
-                                      MAP_SHARED, fd, buf.m.offset);
-        if (bufv[bufc].start == MAP_FAILED)
+        b->start = v4l2_mmap (NULL, buf.length, PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fd, buf.m.offset);
+        if (b->start == MAP_FAILED)
         {
-            msg_Err (obj, "cannot map buffer %"PRIu32": %s", bufc,
+            msg_Err (obj, "cannot map buffer %"PRIu32": %s", pool->count,
                      vlc_strerror_c(errno));
             goto error;
         }
-        bufv[bufc].length = buf.length;
-        bufc++;
+        b->length = buf.length;
+        b->pool = pool;
+        b->index = pool->count;
+        pool->count++;
 
         /* Some drivers refuse to queue buffers before they are mapped. Bug? */
-        if (v4l2_ioctl (fd, VIDIOC_QBUF, &buf) < 0)
+        if (QueueBuffer (pool, b->index))
         {
-            msg_Err (obj, "cannot queue buffer %"PRIu32": %s", bufc,
+            msg_Err (obj, "cannot queue buffer %"PRIu32": %s", b->index,
                      vlc_strerror_c(errno));
             goto error;
         }
@@ -719,20 +881,27 @@ struct buffer_t *StartMmap (vlc_object_t *obj, int fd, uint32_t *restrict n)
         msg_Err (obj, "cannot start streaming: %s", vlc_strerror_c(errno));
         goto error;
     }
-    *n = bufc;
-    return bufv;
+    pool->streaming = true;
+    *n = pool->count;
+    return pool;
 error:
-    StopMmap (fd, bufv, bufc);
+    StopMmap (obj, pool);
     return NULL;
 }
 
-void StopMmap (int fd, struct buffer_t *bufv, uint32_t bufc)
+void StopMmap (vlc_object_t *obj, vlc_v4l2_buffers_t *pool)
 {
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
     /* STREAMOFF implicitly dequeues all buffers */
-    v4l2_ioctl (fd, VIDIOC_STREAMOFF, &type);
-    for (uint32_t i = 0; i < bufc; i++)
-        v4l2_munmap (bufv[i].start, bufv[i].length);
-    free (bufv);
+    vlc_mutex_lock (&pool->lock);
+    pool->streaming = false;
+    v4l2_ioctl (pool->fd, VIDIOC_STREAMOFF, &type);
+    vlc_mutex_unlock (&pool->lock);
+
+    if (pool->frames > 0)
+        msg_Dbg (obj, "captured %u frames: %u lost in %u gaps, %u corrupted"
+                 ", %u copied", pool->frames, pool->lost, pool->gaps,
+                 pool->errors, pool->copies);
+    ReleaseBuffers (pool);
 }
@@ -34,6 +34,28 @@
 #include "zip.h"
 #include <vlc_access.h>
 
+#include <zlib.h>
+
+/* Inflate checkpoints: one every ZIP_CHECKPOINT_SPAN bytes of a deflated
+ * file at first, the span doubles whenever ZIP_CHECKPOINT_MAX are taken */
+#define ZIP_CHECKPOINT_SPAN (1 << 20)
+#define ZIP_CHECKPOINT_MAX  128
+
+/* Archives whose central directory is kept */
+#define ZIP_DIR_CACHE 8
+
+/** **************************************************************************
+ * Inflate state at a deflate block boundary, to restart from
+ *****************************************************************************/
+typedef struct
+{
+    uint64_t i_in;        /* compressed offset */
+    uint64_t i_out;       /* uncompressed offset */
+    int      i_bits;      /* bits of the previous byte left to inflate */
+    uInt     i_window;
+    uint8_t *p_window;    /* dictionary */
+} zip_checkpoint_t;
+
 /** **************************************************************************
  * This is our own access_sys_t for zip files
  *****************************************************************************/
@@ -42,15 +64,38 @@ struct access_sys_t
     /* zlib / unzip members */
     unzFile            zipFile;
     zlib_filefunc_def *fileFunctions;
+    stream_t          *p_stream;      /* archive, as opened by unzip */
 
     /* file in zip information */
     char              *psz_fileInzip;
+    unz_file_pos       filePos;
+
+    /* Stored and deflated files are read directly from the archive */
+    bool               b_direct;
+    bool               b_deflate;
+    bool               b_end;         /* end of the deflate stream */
+    uint64_t           i_data;        /* offset of the data in the archive */
+    uint64_t           i_csize;
+    uint64_t           i_usize;
+    uint64_t           i_in;          /* compressed bytes given to zlib */
+    z_stream           zstream;
+    uint8_t           *p_in;
+
+    zip_checkpoint_t  *p_points;
+    size_t             i_points;
+    uint64_t           i_span;
 };
 
 static int AccessControl( access_t *p_access, int i_query, va_list args );
 static ssize_t AccessRead( access_t *, uint8_t *, size_t );
 static int AccessSeek( access_t *, uint64_t );
+static int LocateFileInZip( access_t *p_access, const char *psz_archive );
 static int OpenFileInZip( access_t *p_access );
+static int OpenDirect( access_t *p_access );
+static void CloseDirect( access_sys_t *p_sys );
+static int RestartDirect( access_t *, const zip_checkpoint_t * );
+static ssize_t ReadDirect( access_t *, uint8_t *, size_t );
+static int SeekDirect( access_t *, uint64_t );
 static char *unescapeXml( const char *psz_text );
 
 /** **************************************************************************
@@ -165,6 +210,10 @@ int AccessOpen( vlc_object_t *p_this )
     }
 
     /* Open file in zip */
+    if( ( i_ret = LocateFileInZip( p_access, psz_pathToZip ) ) != VLC_SUCCESS )
+        goto exit;
+    if( OpenDirect( p_access ) != VLC_SUCCESS )
+        CloseDirect( p_sys );
     if( ( i_ret = OpenFileInZip( p_access ) ) != VLC_SUCCESS )
         goto exit;
 
@@ -184,6 +233,7 @@ exit:
             unzCloseCurrentFile( p_access->p_sys->zipFile );
             unzClose( p_access->p_sys->zipFile );
         }
+        CloseDirect( p_sys );
         free( p_sys->psz_fileInzip );
         free( p_sys->fileFunctions );
         free( p_sys );
@@ -209,6 +259,7 @@ void AccessClose( vlc_object_t *p_this )
             unzCloseCurrentFile( file );
             unzClose( file );
         }
+        CloseDirect( p_sys );
         free( p_sys->psz_fileInzip );
         free( p_sys->fileFunctions );
         free( p_sys );
@@ -234,7 +285,8 @@ static int AccessControl( access_t *p_access, int i_query, va_list args )
 
         case ACCESS_CAN_FASTSEEK:
             pb_bool = (bool*)va_arg( args, bool* );
-            *pb_bool = false;
+            *pb_bool = p_access->p_sys->b_direct
+                    && !p_access->p_sys->b_deflate;
             break;
 
         case ACCESS_GET_SIZE:
@@ -278,6 +330,9 @@ static ssize_t AccessRead( access_t *p_access, uint8_t *p_buffer, size_t sz )
         return VLC_EGENERIC;
     }
 
+    if( p_sys->b_direct )
+        return ReadDirect( p_access, p_buffer, sz );
+
     int i_read = 0;
     i_read = unzReadCurrentFile( file, p_buffer, sz );
 
@@ -300,6 +355,9 @@ static int AccessSeek( access_t *p_access, uint64_t seek_len )
         return VLC_EGENERIC;
     }
 
+    if( p_sys->b_direct )
+        return SeekDirect( p_access, seek_len );
+
     /* Reopen file in zip if needed */
     if( p_access->info.i_pos > seek_len )
     {
@@ -307,7 +365,7 @@ static int AccessSeek( access_t *p_access, uint64_t seek_len )
     }
 
     /* Read seek_len data and drop it */
-    unsigned i_seek = 0;
+    uint64_t i_seek = p_access->info.i_pos;
     int i_read = 1;
     char *p_buffer = ( char* ) calloc( 1, ZIP_BUFFER_LEN );
     if( unlikely( !p_buffer ) )
@@ -349,12 +407,14 @@ static int OpenFileInZip( access_t *p_access )
     p_access->info.i_pos = 0;
 
     unzCloseCurrentFile( file ); /* returns UNZ_PARAMERROR if file not opened */
-    if( unzLocateFile( file, p_sys->psz_fileInzip, 0 ) != UNZ_OK )
+    if( unzGoToFilePos( file, &p_sys->filePos ) != UNZ_OK )
     {
         msg_Err( p_access, "could not [re]locate file in zip: '%s'",
                  p_sys->psz_fileInzip );
         return VLC_EGENERIC;
     }
+    if( p_sys->b_direct )
+        return RestartDirect( p_access, NULL );
     if( unzOpenCurrentFile( file ) != UNZ_OK )
     {
         msg_Err( p_access, "could not [re]open file in zip: '%s'",
@@ -365,6 +425,467 @@ static int OpenFileInZip( access_t *p_access )
     return VLC_SUCCESS;
 }
 
+/** **************************************************************************
+ * Central directory cache
+ * The positions of the files in the last archives are kept, so that the
+ * central directory is walked once per archive instead of once per file.
+ *****************************************************************************/
+typedef struct
+{
+    char         *psz_name;
+    unz_file_pos  pos;
+} zip_dir_entry_t;
+
+typedef struct
+{
+    char            *psz_archive;
+    uint64_t         i_size;      /* size of the archive */
+    uLong            i_entries;   /* as given by the end of central dir */
+    size_t           i_count;
+    zip_dir_entry_t *p_entries;   /* sorted by name */
+} zip_dir_t;
+
+static vlc_mutex_t dir_cache_lock = VLC_STATIC_MUTEX;
+static zip_dir_t *dir_cache[ZIP_DIR_CACHE]; /* most recently used first */
+
+static int ZipDirEntryCmp( const void *a, const void *b )
+{
+    return strcmp( ((const zip_dir_entry_t *)a)->psz_name,
+                   ((const zip_dir_entry_t *)b)->psz_name );
+}
+
+static void ZipDirDelete( zip_dir_t *p_dir )
+{
+    for( size_t i = 0; i < p_dir->i_count; i++ )
+        free( p_dir->p_entries[i].psz_name );
+    free( p_dir->p_entries );
+    free( p_dir->psz_archive );
+    free( p_dir );
+}
+
+static zip_dir_t *ZipDirLoad( unzFile file, const char *psz_archive,
+                              uint64_t i_size, uLong i_entries )
+{
+    zip_dir_t *p_dir = malloc( sizeof( *p_dir ) );
+    if( unlikely( !p_dir ) )
+        return NULL;
+
+    p_dir->psz_archive = strdup( psz_archive );
+    p_dir->i_size = i_size;
+    p_dir->i_entries = i_entries;
+    p_dir->i_count = 0;
+    p_dir->p_entries = calloc( i_entries ? i_entries : 1,
+                               sizeof( *p_dir->p_entries ) );
+    if( unlikely( !p_dir->psz_archive || !p_dir->p_entries ) )
+    {
+        ZipDirDelete( p_dir );
+        return NULL;
+    }
+
+    for( int i_ret = unzGoToFirstFile( file );
+         i_ret == UNZ_OK && p_dir->i_count < i_entries;
+         i_ret = unzGoToNextFile( file ) )
+    {
+        zip_dir_entry_t *p_entry = &p_dir->p_entries[p_dir->i_count];
+        char psz_name[ZIP_FILENAME_LEN];
+        unz_file_info info;
+
+        if( unzGetCurrentFileInfo( file, &info, psz_name, sizeof( psz_name ),
+                                   NULL, 0, NULL, 0 ) != UNZ_OK
+         || unzGetFilePos( file, &p_entry->pos ) != UNZ_OK )
+            break;
+        if( info.size_filename >= sizeof( psz_name ) )
+            continue; /* truncated, left to unzLocateFile() */
+        p_entry->psz_name = strdup( psz_name );
+        if( unlikely( !p_entry->psz_name ) )
+            break;
+        p_dir->i_count++;
+    }
+
+    qsort( p_dir->p_entries, p_dir->i_count, sizeof( *p_dir->p_entries ),
+           ZipDirEntryCmp );
+    return p_dir;
+}
+
+static bool ZipDirFind( const zip_dir_t *p_dir, const char *psz_name,
+                        unz_file_pos *p_pos )
+{
+    const zip_dir_entry_t key = { .psz_name = (char *)psz_name };
+    const zip_dir_entry_t *p_entry =
+        bsearch( &key, p_dir->p_entries, p_dir->i_count,
+                 sizeof( *p_dir->p_entries ), ZipDirEntryCmp );
+    if( p_entry == NULL )
+        return false;
+    *p_pos = p_entry->pos;
+    return true;
+}
+
+/* Looks the archive up and moves it first; the lock must be held */
+static zip_dir_t *ZipDirGet( const char *psz_archive, uint64_t i_size,
+                             uLong i_entries, bool b_drop )
+{
+    for( size_t i = 0; i < ZIP_DIR_CACHE && dir_cache[i] != NULL; i++ )
+    {
+        zip_dir_t *p_dir = dir_cache[i];
+        if( strcmp( p_dir->psz_archive, psz_archive ) )
+            continue;
+
+        memmove( &dir_cache[1], &dir_cache[0], i * sizeof( *dir_cache ) );
+        if( b_drop || p_dir->i_size != i_size || p_dir->i_entries != i_entries )
+        {   /* the archive changed */
+            memmove( &dir_cache[0], &dir_cache[1],
+                     ( ZIP_DIR_CACHE - 1 ) * sizeof( *dir_cache ) );
+            dir_cache[ZIP_DIR_CACHE - 1] = NULL;
+            ZipDirDelete( p_dir );
+            return NULL;
+        }
+        dir_cache[0] = p_dir;
+        return p_dir;
+    }
+    return NULL;
+}
+
+/** **************************************************************************
+ * \brief Locate the file in zip, through the central directory cache
+ *****************************************************************************/
+static int LocateFileInZip( access_t *p_access, const char *psz_archive )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    unzFile file = p_sys->zipFile;
+    unz_global_info gi;
+    bool b_found = false;
+
+    if( p_sys->p_stream != NULL && unzGetGlobalInfo( file, &gi ) == UNZ_OK )
+    {
+        uint64_t i_size = stream_Size( p_sys->p_stream );
+
+        vlc_mutex_lock( &dir_cache_lock );
+        zip_dir_t *p_dir = ZipDirGet( psz_archive, i_size, gi.number_entry,
+                                      false );
+        if( p_dir != NULL )
+            b_found = ZipDirFind( p_dir, p_sys->psz_fileInzip,
+                                  &p_sys->filePos );
+        vlc_mutex_unlock( &dir_cache_lock );
+
+        if( p_dir == NULL
+         && ( p_dir = ZipDirLoad( file, psz_archive, i_size,
+                                  gi.number_entry ) ) != NULL )
+        {
+            msg_Dbg( p_access, "cached %zu files of %s", p_dir->i_count,
+                     psz_archive );
+            b_found = ZipDirFind( p_dir, p_sys->psz_fileInzip,
+                                  &p_sys->filePos );
+
+            vlc_mutex_lock( &dir_cache_lock );
+            if( dir_cache[ZIP_DIR_CACHE - 1] != NULL )
+                ZipDirDelete( dir_cache[ZIP_DIR_CACHE - 1] );
+            memmove( &dir_cache[1], &dir_cache[0],
+                     ( ZIP_DIR_CACHE - 1 ) * sizeof( *dir_cache ) );
+            dir_cache[0] = p_dir;
+            vlc_mutex_unlock( &dir_cache_lock );
+        }
+    }
+
+    if( b_found )
+    {
+        char psz_name[ZIP_FILENAME_LEN];
+
+        if( unzGoToFilePos( file, &p_sys->filePos ) == UNZ_OK
+         && unzGetCurrentFileInfo( file, NULL, psz_name, sizeof( psz_name ),
+                                   NULL, 0, NULL, 0 ) == UNZ_OK
+         && !strcmp( psz_name, p_sys->psz_fileInzip ) )
+            return VLC_SUCCESS;
+
+        msg_Dbg( p_access, "outdated directory of %s", psz_archive );
+        vlc_mutex_lock( &dir_cache_lock );
+        ZipDirGet( psz_archive, 0, 0, true );
+        vlc_mutex_unlock( &dir_cache_lock );
+    }
+
+    if( unzLocateFile( file, p_sys->psz_fileInzip, 0 ) != UNZ_OK
+     || unzGetFilePos( file, &p_sys->filePos ) != UNZ_OK )
+    {
+        msg_Err( p_access, "could not locate file in zip: '%s'",
+                 p_sys->psz_fileInzip );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+/** **************************************************************************
+ * \brief Prepare to read the current file directly from the archive
+ * Only stored and deflated files without encryption are handled; the others
+ * go through unzip. Seeking then needs not restart from the beginning of the
+ * file: stored files are seeked in, and inflate restarts from checkpoints.
+ *****************************************************************************/
+static int OpenDirect( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    stream_t *s = p_sys->p_stream;
+    unz_file_info info;
+    uint8_t hdr[46];
+
+    if( s == NULL
+     || unzGetCurrentFileInfo( p_sys->zipFile, &info, NULL, 0,
+                               NULL, 0, NULL, 0 ) != UNZ_OK
+     || ( info.flag & 1 ) /* encrypted */
+     || ( info.compression_method != 0
+       && info.compression_method != Z_DEFLATED ) )
+        return VLC_EGENERIC;
+
+    /* Offset of the local header, from the central directory entry, then
+     * offset of the data past the local header */
+    uLong i_central = unzGetOffset( p_sys->zipFile );
+    if( i_central == 0
+     || stream_Seek( s, i_central ) || stream_Read( s, hdr, 46 ) != 46
+     || GetDWLE( hdr ) != 0x02014b50 )
+        return VLC_EGENERIC;
+
+    uint64_t i_local = GetDWLE( &hdr[42] );
+    if( stream_Seek( s, i_local ) || stream_Read( s, hdr, 30 ) != 30
+     || GetDWLE( hdr ) != 0x04034b50 )
+        return VLC_EGENERIC;
+
+    p_sys->i_data = i_local + 30 + GetWLE( &hdr[26] ) + GetWLE( &hdr[28] );
+    p_sys->i_csize = info.compressed_size;
+    p_sys->i_usize = info.uncompressed_size;
+    p_sys->b_deflate = info.compression_method == Z_DEFLATED;
+    p_sys->i_span = ZIP_CHECKPOINT_SPAN;
+
+    if( p_sys->b_deflate )
+    {
+        p_sys->p_in = malloc( ZIP_BUFFER_LEN );
+        if( unlikely( !p_sys->p_in ) )
+            return VLC_ENOMEM;
+        /* raw deflate data */
+        if( inflateInit2( &p_sys->zstream, -MAX_WBITS ) != Z_OK )
+        {
+            FREENULL( p_sys->p_in );
+            return VLC_EGENERIC;
+        }
+    }
+    p_sys->b_direct = true;
+    return VLC_SUCCESS;
+}
+
+static void CloseDirect( access_sys_t *p_sys )
+{
+    if( p_sys->b_direct && p_sys->b_deflate )
+        inflateEnd( &p_sys->zstream );
+    for( size_t i = 0; i < p_sys->i_points; i++ )
+        free( p_sys->p_points[i].p_window );
+    FREENULL( p_sys->p_points );
+    p_sys->i_points = 0;
+    FREENULL( p_sys->p_in );
+    p_sys->b_direct = false;
+}
+
+/** **************************************************************************
+ * \brief Restart reading from a checkpoint, or from the beginning if NULL
+ *****************************************************************************/
+static int RestartDirect( access_t *p_access, const zip_checkpoint_t *p_point )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    stream_t *s = p_sys->p_stream;
+
+    p_access->info.i_pos = 0;
+    p_access->info.b_eof = false;
+    if( !p_sys->b_deflate )
+        return stream_Seek( s, p_sys->i_data );
+
+    z_stream *zs = &p_sys->zstream;
+    inflateReset( zs );
+    zs->avail_in = 0;
+    p_sys->b_end = false;
+    p_sys->i_in = 0;
+    if( p_point == NULL )
+        return stream_Seek( s, p_sys->i_data );
+
+    uint64_t i_offset = p_sys->i_data + p_point->i_in;
+    if( p_point->i_bits )
+    {
+        uint8_t i_byte;
+
+        if( stream_Seek( s, i_offset - 1 ) || stream_Read( s, &i_byte, 1 ) != 1 )
+            return VLC_EGENERIC;
+        inflatePrime( zs, p_point->i_bits, i_byte >> ( 8 - p_point->i_bits ) );
+    }
+    else if( stream_Seek( s, i_offset ) )
+        return VLC_EGENERIC;
+    inflateSetDictionary( zs, p_point->p_window, p_point->i_window );
+
+    p_sys->i_in = p_point->i_in;
+    p_access->info.i_pos = p_point->i_out;
+    return VLC_SUCCESS;
+}
+
+/** **************************************************************************
+ * \brief Take a checkpoint at the current deflate block boundary, if due
+ *****************************************************************************/
+static void Checkpoint( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    uint64_t i_out = p_access->info.i_pos;
+    uint64_t i_last = p_sys->i_points
+                    ? p_sys->p_points[p_sys->i_points - 1].i_out : 0;
+
+    if( i_out < i_last + p_sys->i_span )
+        return;
+
+    if( p_sys->i_points == ZIP_CHECKPOINT_MAX )
+    {   /* Keep every other checkpoint, the span doubles */
+        size_t i_kept = 0;
+        for( size_t i = 0; i < p_sys->i_points; i++ )
+        {
+            if( i & 1 )
+                p_sys->p_points[i_kept++] = p_sys->p_points[i];
+            else
+                free( p_sys->p_points[i].p_window );
+        }
+        p_sys->i_points = i_kept;
+        p_sys->i_span *= 2;
+        i_last = p_sys->p_points[i_kept - 1].i_out;
+        if( i_out < i_last + p_sys->i_span )
+            return;
+    }
+    else if( ( p_sys->i_points & 15 ) == 0 )
+    {
+        zip_checkpoint_t *p_points =
+            realloc( p_sys->p_points, ( p_sys->i_points + 16 )
+                                      * sizeof( *p_points ) );
+        if( unlikely( !p_points ) )
+            return;
+        p_sys->p_points = p_points;
+    }
+
+    zip_checkpoint_t *p_point = &p_sys->p_points[p_sys->i_points];
+    p_point->p_window = malloc( 1 << MAX_WBITS );
+    if( unlikely( !p_point->p_window ) )
+        return;
+    if( inflateGetDictionary( &p_sys->zstream, p_point->p_window,
+                              &p_point->i_window ) != Z_OK )
+    {
+        free( p_point->p_window );
+        return;
+    }
+    p_point->i_in = p_sys->i_in - p_sys->zstream.avail_in;
+    p_point->i_out = i_out;
+    p_point->i_bits = p_sys->zstream.data_type & 7;
+    p_sys->i_points++;
+}
+
+/** **************************************************************************
+ * \brief Read the current file directly from the archive
+ *****************************************************************************/
+static ssize_t ReadDirect( access_t *p_access, uint8_t *p_buffer, size_t sz )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( !p_sys->b_deflate )
+    {
+        uint64_t i_left = p_sys->i_usize - p_access->info.i_pos;
+        if( sz > i_left )
+            sz = i_left;
+        if( sz == 0 )
+            return 0;
+
+        ssize_t i_read = stream_Read( p_sys->p_stream, p_buffer, sz );
+        if( i_read > 0 )
+            p_access->info.i_pos += i_read;
+        return i_read;
+    }
+
+    z_stream *zs = &p_sys->zstream;
+    zs->next_out = p_buffer;
+    zs->avail_out = sz;
+
+    while( zs->avail_out > 0 && !p_sys->b_end )
+    {
+        if( zs->avail_in == 0 )
+        {
+            uint64_t i_left = p_sys->i_csize - p_sys->i_in;
+            int i_read = stream_Read( p_sys->p_stream, p_sys->p_in,
+                                      __MIN( i_left, ZIP_BUFFER_LEN ) );
+            if( i_read <= 0 )
+                break; /* truncated */
+            zs->next_in = p_sys->p_in;
+            zs->avail_in = i_read;
+            p_sys->i_in += i_read;
+        }
+
+        uInt i_avail = zs->avail_out;
+        int i_ret = inflate( zs, Z_BLOCK );
+        p_access->info.i_pos += i_avail - zs->avail_out;
+
+        if( i_ret == Z_STREAM_END )
+            p_sys->b_end = true;
+        else if( i_ret != Z_OK )
+        {
+            msg_Err( p_access, "inflate error %d: %s", i_ret,
+                     zs->msg ? zs->msg : "?" );
+            if( sz == zs->avail_out )
+                return -1;
+            break;
+        }
+        /* End of a block header, but not of the last block */
+        else if( ( zs->data_type & 128 ) && !( zs->data_type & 64 ) )
+            Checkpoint( p_access );
+    }
+    return sz - zs->avail_out;
+}
+
+/** **************************************************************************
+ * \brief Seek in the current file read directly from the archive
+ *****************************************************************************/
+static int SeekDirect( access_t *p_access, uint64_t i_pos )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    if( i_pos > p_sys->i_usize )
+        i_pos = p_sys->i_usize;
+
+    if( !p_sys->b_deflate )
+    {
+        if( stream_Seek( p_sys->p_stream, p_sys->i_data + i_pos ) )
+            return VLC_EGENERIC;
+        p_access->info.i_pos = i_pos;
+        p_access->info.b_eof = false;
+        return VLC_SUCCESS;
+    }
+
+    /* Restart from the last checkpoint before the target, unless inflating
+     * from the current position is shorter */
+    const zip_checkpoint_t *p_point = NULL;
+    for( size_t i = 0; i < p_sys->i_points
+                    && p_sys->p_points[i].i_out <= i_pos; i++ )
+        p_point = &p_sys->p_points[i];
+
+    if( i_pos < p_access->info.i_pos
+     || ( p_point != NULL && p_point->i_out > p_access->info.i_pos ) )
+    {
+        if( RestartDirect( p_access, p_point ) )
+        {
+            msg_Warn( p_access, "could not seek in file" );
+            return VLC_EGENERIC;
+        }
+    }
+    p_access->info.b_eof = false;
+
+    /* Inflate and drop the rest */
+    uint8_t *p_buffer = malloc( ZIP_BUFFER_LEN );
+    if( unlikely( !p_buffer ) )
+        return VLC_ENOMEM;
+    while( p_access->info.i_pos < i_pos )
+    {
+        ssize_t i_read = ReadDirect( p_access, p_buffer,
+                        __MIN( i_pos - p_access->info.i_pos, ZIP_BUFFER_LEN ) );
+        if( i_read <= 0 )
+            break;
+    }
+    free( p_buffer );
+    return VLC_SUCCESS;
+}
+
 /** **************************************************************************
  * \brief I/O functions for the ioapi: open (read only)
  *****************************************************************************/
@@ -390,6 +911,7 @@ static void* ZCALLBACK ZipIO_Open( void* opaque, const char* file, int mode )
 
     stream_t *s = stream_UrlNew( p_access, fileUri );
     free( fileUri );
+    p_access->p_sys->p_stream = s;
     return s;
 }
 
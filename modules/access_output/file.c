@@ -76,6 +76,16 @@ static void Close( vlc_object_t * );
     "on the file path")
 #define SYNC_TEXT N_("Synchronous writing")
 #define SYNC_LONGTEXT N_( "Open the file with synchronous writing.")
+#define BUFFER_TEXT N_("Write buffer size (kB)")
+#define BUFFER_LONGTEXT N_( "Data to a regular file is written by a " \
+    "separate thread, in large chunks, with up to this amount of data " \
+    "waiting. 0 writes directly.")
+#define PREALLOC_TEXT N_("Preallocation extent (MB)")
+#define PREALLOC_LONGTEXT N_( "Reserve the disk space of the file ahead " \
+    "of the written data, by this amount at a time. 0 disables it.")
+#define SYNC_INTERVAL_TEXT N_("Flush interval (seconds)")
+#define SYNC_INTERVAL_LONGTEXT N_( "Flush the written data to the disk at " \
+    "this interval. 0 leaves it to the system.")
 
 vlc_module_begin ()
     set_description( N_("File stream output") )
@@ -94,6 +104,15 @@ vlc_module_begin ()
     add_bool( SOUT_CFG_PREFIX "sync", false, SYNC_TEXT,SYNC_LONGTEXT,
               false )
 #endif
+    add_integer( SOUT_CFG_PREFIX "buffer", 0, BUFFER_TEXT, BUFFER_LONGTEXT,
+                 true )
+        change_integer_range( 0, 1024 * 1024 )
+    add_integer( SOUT_CFG_PREFIX "prealloc", 0, PREALLOC_TEXT,
+                 PREALLOC_LONGTEXT, true )
+        change_integer_range( 0, 4096 )
+    add_integer( SOUT_CFG_PREFIX "sync-interval", 0, SYNC_INTERVAL_TEXT,
+                 SYNC_INTERVAL_LONGTEXT, true )
+        change_integer_range( 0, 3600 )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -108,13 +127,56 @@ static const char *const ppsz_sout_options[] = {
 #ifdef O_SYNC
     "sync",
 #endif
+    "buffer",
+    "prealloc",
+    "sync-interval",
     NULL
 };
 
 static ssize_t Write( sout_access_out_t *, block_t * );
+static ssize_t WriteAsync( sout_access_out_t *, block_t * );
 static int Seek ( sout_access_out_t *, off_t  );
 static ssize_t Read ( sout_access_out_t *, block_t * );
 static int Control( sout_access_out_t *, int, va_list );
+static void *Thread( void * );
+
+/* Size of the writes of the writer thread */
+#define FILE_CHUNK (1 << 20)
+
+struct sout_access_out_sys_t
+{
+    int fd;
+
+    /* Asynchronous writer */
+    bool b_async;
+    vlc_thread_t thread;
+    vlc_mutex_t lock;
+    vlc_cond_t wait; /* for the writer: data or flush request */
+    vlc_cond_t done; /* for the sout thread: room or flush completion */
+    block_t *p_queue;
+    block_t **pp_last;
+    size_t i_queued;
+    size_t i_max;
+    bool b_flush;
+    bool b_closing;
+    bool b_error;
+
+    /* Data waiting to fill a chunk (writer thread only) */
+    uint8_t *p_chunk;
+    size_t i_chunk;
+
+    off_t i_pos; /* file offset */
+    off_t i_allocated;
+    off_t i_prealloc;
+    mtime_t i_sync_interval;
+    mtime_t i_next_sync;
+
+    /* Statistics */
+    size_t i_high_water;
+    unsigned i_writes;
+    mtime_t i_latency;
+    mtime_t i_latency_max;
+};
 
 /*****************************************************************************
  * Open: open the file
@@ -213,16 +275,70 @@ static int Open( vlc_object_t *p_this )
             return VLC_EGENERIC;
     }
 
-    p_access->pf_write = Write;
-    p_access->pf_read  = Read;
-    p_access->pf_seek  = Seek;
-    p_access->pf_control = Control;
-    p_access->p_sys    = (void *)(intptr_t)fd;
+    sout_access_out_sys_t *p_sys = calloc( 1, sizeof( *p_sys ) );
+    if( unlikely(p_sys == NULL) )
+    {
+        close( fd );
+        return VLC_ENOMEM;
+    }
+    p_sys->fd = fd;
+    p_sys->i_sync_interval = CLOCK_FREQ *
+        var_GetInteger( p_access, SOUT_CFG_PREFIX "sync-interval" );
+    p_sys->i_next_sync = mdate() + p_sys->i_sync_interval;
 
     msg_Dbg( p_access, "file access output opened (%s)", p_access->psz_path );
     if (append)
         lseek (fd, 0, SEEK_END);
 
+    /* Only a regular file benefits from large writes: a pipe reader wants
+     * the data as soon as possible */
+    struct stat st;
+    bool b_regular = fstat( fd, &st ) == 0 && S_ISREG( st.st_mode );
+
+    p_sys->i_pos = b_regular ? lseek( fd, 0, SEEK_CUR ) : 0;
+    p_sys->i_allocated = p_sys->i_pos;
+#ifdef FALLOC_FL_KEEP_SIZE
+    if( b_regular )
+        p_sys->i_prealloc = (off_t)(1 << 20) *
+            var_GetInteger( p_access, SOUT_CFG_PREFIX "prealloc" );
+#endif
+
+    p_sys->i_max = 1024 * var_GetInteger( p_access, SOUT_CFG_PREFIX "buffer" );
+    if( p_sys->i_max > 0 && b_regular )
+    {
+        p_sys->p_chunk = malloc( FILE_CHUNK );
+        if( unlikely(p_sys->p_chunk == NULL) )
+        {
+            close( fd );
+            free( p_sys );
+            return VLC_ENOMEM;
+        }
+
+        vlc_mutex_init( &p_sys->lock );
+        vlc_cond_init( &p_sys->wait );
+        vlc_cond_init( &p_sys->done );
+        p_sys->pp_last = &p_sys->p_queue;
+        p_sys->b_async = true;
+
+        if( vlc_clone( &p_sys->thread, Thread, p_access,
+                       VLC_THREAD_PRIORITY_OUTPUT ) )
+        {
+            vlc_cond_destroy( &p_sys->done );
+            vlc_cond_destroy( &p_sys->wait );
+            vlc_mutex_destroy( &p_sys->lock );
+            free( p_sys->p_chunk );
+            close( fd );
+            free( p_sys );
+            return VLC_EGENERIC;
+        }
+    }
+
+    p_access->pf_write = p_sys->b_async ? WriteAsync : Write;
+    p_access->pf_read  = Read;
+    p_access->pf_seek  = Seek;
+    p_access->pf_control = Control;
+    p_access->p_sys    = p_sys;
+
     return VLC_SUCCESS;
 }
 
@@ -232,14 +348,60 @@ static int Open( vlc_object_t *p_this )
 static void Close( vlc_object_t * p_this )
 {
     sout_access_out_t *p_access = (sout_access_out_t*)p_this;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
 
-    close( (intptr_t)p_access->p_sys );
+    if( p_sys->b_async )
+    {
+        /* The writer writes all the pending data before leaving */
+        vlc_mutex_lock( &p_sys->lock );
+        p_sys->b_closing = true;
+        vlc_cond_signal( &p_sys->wait );
+        vlc_mutex_unlock( &p_sys->lock );
+        vlc_join( p_sys->thread, NULL );
+
+        vlc_cond_destroy( &p_sys->done );
+        vlc_cond_destroy( &p_sys->wait );
+        vlc_mutex_destroy( &p_sys->lock );
+        free( p_sys->p_chunk );
+
+        msg_Dbg( p_access, "buffer high water: %zu bytes", p_sys->i_high_water );
+    }
+
+    if( p_sys->i_writes > 0 )
+        msg_Dbg( p_access, "%u writes, latency average: %"PRId64" us, "
+                 "max: %"PRId64" us", p_sys->i_writes,
+                 p_sys->i_latency / p_sys->i_writes, p_sys->i_latency_max );
+
+    close( p_sys->fd );
+    free( p_sys );
 
     msg_Dbg( p_access, "file access output closed" );
 }
 
+/*****************************************************************************
+ * Flush: wait for the writer to write all the pending data
+ *****************************************************************************/
+static int Flush( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( !p_sys->b_async )
+        return VLC_SUCCESS;
+
+    vlc_mutex_lock( &p_sys->lock );
+    p_sys->b_flush = true;
+    vlc_cond_signal( &p_sys->wait );
+    while( p_sys->b_flush )
+        vlc_cond_wait( &p_sys->done, &p_sys->lock );
+    int ret = p_sys->b_error ? VLC_EGENERIC : VLC_SUCCESS;
+    vlc_mutex_unlock( &p_sys->lock );
+    return ret;
+}
+
 static int Control( sout_access_out_t *p_access, int i_query, va_list args )
 {
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
     switch( i_query )
     {
         case ACCESS_OUT_CONTROLS_PACE:
@@ -253,7 +415,7 @@ static int Control( sout_access_out_t *p_access, int i_query, va_list args )
         {
             bool *pb = va_arg( args, bool * );
             struct stat st;
-            if( fstat( (intptr_t)p_access->p_sys, &st ) == -1 )
+            if( fstat( p_sys->fd, &st ) == -1 )
                 *pb = false;
             else
                 *pb = S_ISREG( st.st_mode ) || S_ISBLK( st.st_mode );
@@ -271,15 +433,78 @@ static int Control( sout_access_out_t *p_access, int i_query, va_list args )
  *****************************************************************************/
 static ssize_t Read( sout_access_out_t *p_access, block_t *p_buffer )
 {
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
     ssize_t val;
 
+    if( Flush( p_access ) )
+        return -1;
+
     do
-        val = read( (intptr_t)p_access->p_sys, p_buffer->p_buffer,
-                    p_buffer->i_buffer );
+        val = read( p_sys->fd, p_buffer->p_buffer, p_buffer->i_buffer );
     while (val == -1 && errno == EINTR);
+    if( val > 0 )
+        p_sys->i_pos += val;
     return val;
 }
 
+/*****************************************************************************
+ * WriteData: write a buffer entirely, reserving the disk space ahead
+ *****************************************************************************/
+static int WriteData( sout_access_out_t *p_access, const uint8_t *p_data,
+                      size_t i_data )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    if( p_sys->i_prealloc > 0 && p_sys->i_pos + (off_t)i_data > p_sys->i_allocated )
+    {
+        off_t i_end = p_sys->i_pos + i_data + p_sys->i_prealloc;
+
+        i_end -= i_end % p_sys->i_prealloc;
+        if( fallocate( p_sys->fd, FALLOC_FL_KEEP_SIZE, p_sys->i_allocated,
+                       i_end - p_sys->i_allocated ) )
+        {
+            msg_Warn( p_access, "cannot preallocate: %s",
+                      vlc_strerror_c(errno) );
+            p_sys->i_prealloc = 0;
+        }
+        else
+            p_sys->i_allocated = i_end;
+    }
+#endif
+
+    while( i_data > 0 )
+    {
+        mtime_t i_start = mdate();
+        ssize_t val = write( p_sys->fd, p_data, i_data );
+        mtime_t i_latency = mdate() - i_start;
+
+        if (val <= 0)
+        {
+            if (errno == EINTR)
+                continue;
+            msg_Err( p_access, "cannot write: %s", vlc_strerror_c(errno) );
+            return VLC_EGENERIC;
+        }
+
+        p_sys->i_writes++;
+        p_sys->i_latency += i_latency;
+        if( i_latency > p_sys->i_latency_max )
+            p_sys->i_latency_max = i_latency;
+
+        p_data += val;
+        i_data -= val;
+        p_sys->i_pos += val;
+    }
+
+    if( p_sys->i_sync_interval > 0 && mdate() >= p_sys->i_next_sync )
+    {
+        fdatasync( p_sys->fd );
+        p_sys->i_next_sync = mdate() + p_sys->i_sync_interval;
+    }
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
  * Write: standard write on a file descriptor.
  *****************************************************************************/
@@ -289,31 +514,165 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
 
     while( p_buffer )
     {
-        ssize_t val = write ((intptr_t)p_access->p_sys,
-                             p_buffer->p_buffer, p_buffer->i_buffer);
-        if (val <= 0)
+        if( WriteData( p_access, p_buffer->p_buffer, p_buffer->i_buffer ) )
         {
-            if (errno == EINTR)
-                continue;
             block_ChainRelease (p_buffer);
-            msg_Err( p_access, "cannot write: %s", vlc_strerror_c(errno) );
             return -1;
         }
 
-        if ((size_t)val >= p_buffer->i_buffer)
+        i_write += p_buffer->i_buffer;
+
+        block_t *p_next = p_buffer->p_next;
+        block_Release (p_buffer);
+        p_buffer = p_next;
+    }
+    return i_write;
+}
+
+/*****************************************************************************
+ * WriteAsync: queue the data for the writer thread
+ *****************************************************************************/
+static ssize_t WriteAsync( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    size_t i_write;
+
+    block_ChainProperties( p_buffer, NULL, &i_write, NULL );
+
+    vlc_mutex_lock( &p_sys->lock );
+    /* Wait for room, unless the queue is empty (large chain) */
+    while( p_sys->i_queued > 0 && p_sys->i_queued + i_write > p_sys->i_max
+        && !p_sys->b_error )
+        vlc_cond_wait( &p_sys->done, &p_sys->lock );
+
+    if( p_sys->b_error )
+    {
+        vlc_mutex_unlock( &p_sys->lock );
+        block_ChainRelease( p_buffer );
+        return -1;
+    }
+
+    block_ChainLastAppend( &p_sys->pp_last, p_buffer );
+    p_sys->i_queued += i_write;
+    if( p_sys->i_queued > p_sys->i_high_water )
+        p_sys->i_high_water = p_sys->i_queued;
+    vlc_cond_signal( &p_sys->wait );
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return i_write;
+}
+
+/*****************************************************************************
+ * WriteChain: write the blocks, in chunks ending at chunk boundaries in the
+ * file, keeping the rest for later, unless flushing
+ *****************************************************************************/
+static int WriteChain( sout_access_out_t *p_access, block_t *p_chain,
+                       bool b_flush )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    int ret = VLC_SUCCESS;
+
+    while( p_chain != NULL )
+    {
+        const uint8_t *p_data = p_chain->p_buffer;
+        size_t i_data = p_chain->i_buffer;
+
+        while( i_data > 0 && ret == VLC_SUCCESS )
+        {
+            size_t i_room = FILE_CHUNK - (p_sys->i_pos + p_sys->i_chunk) % FILE_CHUNK;
+
+            if( p_sys->i_chunk == 0 && i_data >= i_room )
+            {
+                /* Write the whole chunks directly, without copy */
+                size_t i_direct = i_room + (i_data - i_room) / FILE_CHUNK * FILE_CHUNK;
+
+                ret = WriteData( p_access, p_data, i_direct );
+                p_data += i_direct;
+                i_data -= i_direct;
+                continue;
+            }
+
+            size_t i_copy = __MIN(i_data, i_room);
+            memcpy( &p_sys->p_chunk[p_sys->i_chunk], p_data, i_copy );
+            p_sys->i_chunk += i_copy;
+            p_data += i_copy;
+            i_data -= i_copy;
+
+            if( i_copy == i_room )
+            {
+                ret = WriteData( p_access, p_sys->p_chunk, p_sys->i_chunk );
+                p_sys->i_chunk = 0;
+            }
+        }
+
+        block_t *p_next = p_chain->p_next;
+        block_Release( p_chain );
+        p_chain = p_next;
+    }
+
+    if( b_flush && p_sys->i_chunk > 0 && ret == VLC_SUCCESS )
+        ret = WriteData( p_access, p_sys->p_chunk, p_sys->i_chunk );
+    if( b_flush || ret != VLC_SUCCESS )
+        p_sys->i_chunk = 0;
+    return ret;
+}
+
+static void *Thread( void *data )
+{
+    sout_access_out_t *p_access = data;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    for( ;; )
+    {
+        bool b_sync_due = false;
+
+        while( p_sys->p_queue == NULL && !p_sys->b_flush && !p_sys->b_closing )
         {
-            block_t *p_next = p_buffer->p_next;
-            block_Release (p_buffer);
-            p_buffer = p_next;
+            /* Write the pending partial chunk when a flush to disk is due */
+            if( p_sys->i_sync_interval > 0 && p_sys->i_chunk > 0 )
+            {
+                if( vlc_cond_timedwait( &p_sys->wait, &p_sys->lock,
+                                        p_sys->i_next_sync ) )
+                {
+                    b_sync_due = true;
+                    break;
+                }
+            }
+            else
+                vlc_cond_wait( &p_sys->wait, &p_sys->lock );
         }
+
+        block_t *p_chain = p_sys->p_queue;
+        bool b_flush = p_sys->b_flush || p_sys->b_closing || b_sync_due;
+        bool b_closing = p_sys->b_closing;
+        bool b_flushing = p_sys->b_flush;
+
+        p_sys->p_queue = NULL;
+        p_sys->pp_last = &p_sys->p_queue;
+        p_sys->i_queued = 0;
+        vlc_cond_broadcast( &p_sys->done );
+        vlc_mutex_unlock( &p_sys->lock );
+
+        int ret = VLC_SUCCESS;
+        if( !p_sys->b_error )
+            ret = WriteChain( p_access, p_chain, b_flush );
         else
+            block_ChainRelease( p_chain );
+
+        vlc_mutex_lock( &p_sys->lock );
+        if( ret != VLC_SUCCESS )
+            p_sys->b_error = true;
+        if( b_flushing )
         {
-            p_buffer->p_buffer += val;
-            p_buffer->i_buffer -= val;
+            p_sys->b_flush = false;
+            vlc_cond_broadcast( &p_sys->done );
         }
-        i_write += val;
+        if( b_closing )
+            break;
     }
-    return i_write;
+    vlc_mutex_unlock( &p_sys->lock );
+    return NULL;
 }
 
 /*****************************************************************************
@@ -321,5 +680,13 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
  *****************************************************************************/
 static int Seek( sout_access_out_t *p_access, off_t i_pos )
 {
-    return lseek( (intptr_t)p_access->p_sys, i_pos, SEEK_SET );
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( Flush( p_access ) )
+        return -1;
+
+    off_t i_ret = lseek( p_sys->fd, i_pos, SEEK_SET );
+    if( i_ret >= 0 )
+        p_sys->i_pos = i_ret;
+    return i_ret;
 }
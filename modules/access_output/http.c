@@ -61,6 +61,10 @@ static void Close( vlc_object_t * );
 #define METACUBE_TEXT N_("Metacube")
 #define METACUBE_LONGTEXT N_("Use the Metacube protocol. Needed for streaming " \
                              "to the Cubemap reflector.")
+#define DROP_SLOW_TEXT N_("Drop slow clients")
+#define DROP_SLOW_LONGTEXT N_("Close the connection of clients falling " \
+                              "behind the stream, instead of skipping them " \
+                              "forward to the last keyframe.")
 
 
 vlc_module_begin ()
@@ -78,6 +82,8 @@ vlc_module_begin ()
                 MIME_TEXT, MIME_LONGTEXT, true )
     add_bool( SOUT_CFG_PREFIX "metacube", false,
               METACUBE_TEXT, METACUBE_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "drop-slow", false,
+              DROP_SLOW_TEXT, DROP_SLOW_LONGTEXT, true )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -86,7 +92,7 @@ vlc_module_end ()
  * Exported prototypes
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
-    "user", "pwd", "mime", "metacube", NULL
+    "user", "pwd", "mime", "metacube", "drop-slow", NULL
 };
 
 static ssize_t Write( sout_access_out_t *, block_t * );
@@ -275,6 +281,10 @@ static int Open( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
+    if( var_GetBool( p_access, SOUT_CFG_PREFIX "drop-slow" ) )
+        httpd_StreamSetSlowClients( p_sys->p_httpd_stream,
+                                    HTTPD_STREAM_SLOW_DROP );
+
     if( p_sys->b_metacube )
     {
         httpd_header headers[] = {{ "Content-encoding", "metacube" }};
@@ -306,6 +316,12 @@ static void Close( vlc_object_t * p_this )
     sout_access_out_t       *p_access = (sout_access_out_t*)p_this;
     sout_access_out_sys_t   *p_sys = p_access->p_sys;
 
+    httpd_host_stats_t stats;
+    httpd_HostGetStats( p_sys->p_httpd_host, &stats );
+    msg_Dbg( p_access, "HTTP host: %u client(s) on %u thread(s), "
+             "%zu bytes backlog, %"PRIu64" bytes sent",
+             stats.i_clients, stats.i_workers, stats.i_backlog, stats.i_sent );
+
     httpd_StreamDelete( p_sys->p_httpd_stream );
     httpd_HostDelete( p_sys->p_httpd_host );
 
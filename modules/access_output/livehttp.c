@@ -43,6 +43,7 @@
 #include <vlc_fs.h>
 #include <vlc_strings.h>
 #include <vlc_charset.h>
+#include <vlc_httpd.h>
 
 #include <gcrypt.h>
 #include <vlc_gcrypt.h>
@@ -105,6 +106,11 @@ static void Close( vlc_object_t * );
 #define INTITIAL_SEG_TEXT N_("Number of first segment")
 #define INITIAL_SEG_LONGTEXT N_("The number of the first segment generated")
 
+#define HTTPD_TEXT N_("Serve from memory")
+#define HTTPD_LONGTEXT N_("Keep the segments and the index in memory, and " \
+                          "serve them with the built-in HTTP server at their " \
+                          "paths, instead of writing them to files")
+
 vlc_module_begin ()
     set_description( N_("HTTP Live streaming output") )
     set_shortname( N_("LiveHTTP" ))
@@ -135,6 +141,8 @@ vlc_module_begin ()
                 KEYFILE_TEXT, KEYFILE_LONGTEXT, true )
     add_loadfile( SOUT_CFG_PREFIX "key-loadfile", NULL,
                 KEYLOADFILE_TEXT, KEYLOADFILE_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "httpd", false,
+              HTTPD_TEXT, HTTPD_LONGTEXT, true )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -156,6 +164,7 @@ static const char *const ppsz_sout_options[] = {
     "key-loadfile",
     "generate-iv",
     "initial-segment-number",
+    "httpd",
     NULL
 };
 
@@ -172,6 +181,8 @@ typedef struct output_segment
     float f_seglength;
     uint32_t i_segment_number;
     uint8_t aes_ivs[16];
+    block_t *p_data; /* complete segment, when served from memory */
+    httpd_file_t *p_file;
 } output_segment_t;
 
 struct sout_access_out_sys_t
@@ -189,6 +200,7 @@ struct sout_access_out_sys_t
     float   f_seglen;
     block_t *block_buffer;
     int i_handle;
+    bool b_segment_open;
     unsigned i_numsegs;
     unsigned i_initial_segment;
     bool b_delsegs;
@@ -203,6 +215,15 @@ struct sout_access_out_sys_t
     uint8_t stuffing_bytes[16];
     ssize_t stuffing_size;
     vlc_array_t *segments_t;
+
+    /* Serving from memory */
+    httpd_host_t *p_httpd_host;
+    httpd_file_t *p_index_file;
+    vlc_mutex_t index_lock;
+    char *psz_index;
+    size_t i_index;
+    block_t *p_segment_data; /* current segment */
+    block_t **pp_segment_last;
 };
 
 static int LoadCryptFile( sout_access_out_t *p_access);
@@ -210,6 +231,8 @@ static int CryptSetup( sout_access_out_t *p_access, char *keyfile );
 static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer );
 static ssize_t writeSegment( sout_access_out_t *p_access );
 static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys );
+static int indexFill( httpd_file_sys_t *, httpd_file_t *, uint8_t *,
+                      uint8_t **, int * );
 /*****************************************************************************
  * Open: open the file
  *****************************************************************************/
@@ -262,10 +285,13 @@ static int Open( vlc_object_t *p_this )
             free( p_sys );
             return VLC_ENOMEM;
         }
-        path_sanitize( psz_tmp );
         p_sys->psz_indexPath = psz_tmp;
-        if( p_sys->i_initial_segment != 1 )
-            vlc_unlink( p_sys->psz_indexPath );
+        if( !var_GetBool( p_access, SOUT_CFG_PREFIX "httpd" ) )
+        {
+            path_sanitize( psz_tmp );
+            if( p_sys->i_initial_segment != 1 )
+                vlc_unlink( p_sys->psz_indexPath );
+        }
     }
 
     p_sys->psz_indexUrl = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "index-url" );
@@ -292,9 +318,41 @@ static int Open( vlc_object_t *p_this )
     }
 
     p_sys->i_handle = -1;
+    p_sys->b_segment_open = false;
     p_sys->i_segment = p_sys->i_initial_segment-1;
     p_sys->psz_cursegPath = NULL;
 
+    if( var_GetBool( p_access, SOUT_CFG_PREFIX "httpd" ) )
+    {
+        p_sys->p_httpd_host = vlc_http_HostNew( VLC_OBJECT(p_access) );
+        if( p_sys->p_httpd_host == NULL )
+        {
+            if( p_sys->key_uri )
+            {
+                gcry_cipher_close( p_sys->aes_ctx );
+                free( p_sys->key_uri );
+            }
+            vlc_array_destroy( p_sys->segments_t );
+            free( p_sys->psz_keyfile );
+            free( p_sys->psz_indexUrl );
+            free( p_sys->psz_indexPath );
+            free( p_sys );
+            return VLC_EGENERIC;
+        }
+
+        vlc_mutex_init( &p_sys->index_lock );
+        p_sys->psz_index = NULL;
+        p_sys->i_index = 0;
+        p_sys->p_segment_data = NULL;
+        p_sys->pp_segment_last = &p_sys->p_segment_data;
+        if( p_sys->psz_indexPath )
+            p_sys->p_index_file = httpd_FileNew( p_sys->p_httpd_host,
+                                     p_sys->psz_indexPath,
+                                     "application/vnd.apple.mpegurl",
+                                     NULL, NULL, indexFill,
+                                     (httpd_file_sys_t *)p_sys );
+    }
+
     p_access->pf_write = Write;
     p_access->pf_seek  = Seek;
     p_access->pf_control = Control;
@@ -504,6 +562,11 @@ static char *formatSegmentPath( char *psz_path, uint32_t i_seg, bool b_sanitize
 
 static void destroySegment( output_segment_t *segment )
 {
+    /* No request is being served after this */
+    if( segment->p_file )
+        httpd_FileDelete( segment->p_file );
+    if( segment->p_data )
+        block_Release( segment->p_data );
     free( segment->psz_filename );
     free( segment->psz_duration );
     free( segment->psz_uri );
@@ -553,6 +616,155 @@ static bool isFirstItemRemovable( sout_access_out_sys_t *p_sys, uint32_t i_first
     return duration >= (first->f_seglength + (float)(p_sys->i_numsegs * p_sys->i_seglen));
 }
 
+/************************************************************************
+ * writeIndex: write the index of the given segments
+ ************************************************************************/
+static int writeIndex( sout_access_out_sys_t *p_sys, FILE *fp, uint32_t i_firstseg,
+                       unsigned i_index_offset, bool b_isend )
+{
+    if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
+                      "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s", p_sys->i_seglen,
+                      p_sys->b_caching ? "YES" : "NO",
+                      p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
+                      i_firstseg, ((p_sys->i_initial_segment > 1) && (p_sys->i_initial_segment == i_firstseg)) ? "#EXT-X-DISCONTINUITY\n" : ""
+                      ) < 0 )
+        return -1;
+
+    char *psz_current_uri=NULL;
+
+    for ( uint32_t i = i_firstseg; i <= p_sys->i_segment; i++ )
+    {
+        //scale to i_index_offset..numsegs + i_index_offset
+        uint32_t index = i - i_firstseg + i_index_offset;
+
+        output_segment_t *segment = (output_segment_t *)vlc_array_item_at_index( p_sys->segments_t, index );
+        if( p_sys->key_uri &&
+            ( !psz_current_uri ||  strcmp( psz_current_uri, segment->psz_key_uri ) )
+          )
+        {
+            int ret = 0;
+            free( psz_current_uri );
+            psz_current_uri = strdup( segment->psz_key_uri );
+            if( p_sys->b_generate_iv )
+            {
+                unsigned long long iv_hi = segment->aes_ivs[0];
+                unsigned long long iv_lo = segment->aes_ivs[8];
+                for( unsigned short i = 1; i < 8; i++ )
+                {
+                    iv_hi <<= 8;
+                    iv_hi |= segment->aes_ivs[i] & 0xff;
+                    iv_lo <<= 8;
+                    iv_lo |= segment->aes_ivs[8+i] & 0xff;
+                }
+                ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
+                               segment->psz_key_uri, iv_hi, iv_lo );
+
+            } else {
+                ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", segment->psz_key_uri );
+            }
+            if( ret < 0 )
+            {
+                free( psz_current_uri );
+                return -1;
+            }
+        }
+
+        if ( fprintf( fp, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri) < 0 )
+        {
+            free( psz_current_uri );
+            return -1;
+        }
+    }
+    free( psz_current_uri );
+
+    if ( b_isend && fputs ( STR_ENDLIST, fp ) < 0 )
+        return -1;
+    return 0;
+}
+
+/************************************************************************
+ * updateIndexMemory: replace the index served from memory
+ ************************************************************************/
+static int updateIndexMemory( sout_access_out_sys_t *p_sys, uint32_t i_firstseg,
+                              unsigned i_index_offset, bool b_isend )
+{
+    char *psz_index;
+    size_t i_index;
+#ifdef HAVE_OPEN_MEMSTREAM
+    FILE *fp = open_memstream( &psz_index, &i_index );
+#else
+    FILE *fp = tmpfile();
+#endif
+    if ( !fp )
+        return -1;
+
+    int ret = writeIndex( p_sys, fp, i_firstseg, i_index_offset, b_isend );
+#ifdef HAVE_OPEN_MEMSTREAM
+    if ( fclose( fp ) )
+        return -1;
+    if ( ret < 0 )
+    {
+        free( psz_index );
+        return -1;
+    }
+#else
+    long i_size = ret < 0 ? -1 : ftell( fp );
+    psz_index = i_size >= 0 ? malloc( i_size ) : NULL;
+    i_index = i_size;
+    if ( psz_index )
+    {
+        rewind( fp );
+        if ( fread( psz_index, 1, i_index, fp ) != i_index )
+        {
+            free( psz_index );
+            psz_index = NULL;
+        }
+    }
+    fclose( fp );
+    if ( !psz_index )
+        return -1;
+#endif
+
+    vlc_mutex_lock( &p_sys->index_lock );
+    free( p_sys->psz_index );
+    p_sys->psz_index = psz_index;
+    p_sys->i_index = i_index;
+    vlc_mutex_unlock( &p_sys->index_lock );
+    return 0;
+}
+
+static int indexFill( httpd_file_sys_t *opaque, httpd_file_t *file,
+                      uint8_t *psz_request, uint8_t **pp_data, int *pi_data )
+{
+    sout_access_out_sys_t *p_sys = (sout_access_out_sys_t *)opaque;
+    VLC_UNUSED(file); VLC_UNUSED(psz_request);
+
+    vlc_mutex_lock( &p_sys->index_lock );
+    *pp_data = p_sys->i_index ? malloc( p_sys->i_index ) : NULL;
+    *pi_data = *pp_data ? p_sys->i_index : 0;
+    if( *pp_data )
+        memcpy( *pp_data, p_sys->psz_index, p_sys->i_index );
+    vlc_mutex_unlock( &p_sys->index_lock );
+
+    return VLC_SUCCESS;
+}
+
+static int segmentFill( httpd_file_sys_t *opaque, httpd_file_t *file,
+                        uint8_t *psz_request, uint8_t **pp_data, int *pi_data )
+{
+    /* The segment is complete: its data cannot change, nor be released
+     * before the file is deleted */
+    const block_t *p_data = ((output_segment_t *)opaque)->p_data;
+    VLC_UNUSED(file); VLC_UNUSED(psz_request);
+
+    *pp_data = p_data->i_buffer ? malloc( p_data->i_buffer ) : NULL;
+    *pi_data = *pp_data ? p_data->i_buffer : 0;
+    if( *pp_data )
+        memcpy( *pp_data, p_data->p_buffer, p_data->i_buffer );
+
+    return VLC_SUCCESS;
+}
+
 /************************************************************************
  * updateIndexAndDel: If necessary, update index file & delete old segments
  ************************************************************************/
@@ -575,7 +787,12 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
     }
 
     // First update index
-    if ( p_sys->psz_indexPath )
+    if ( p_sys->psz_indexPath && p_sys->p_httpd_host )
+    {
+        if ( updateIndexMemory( p_sys, i_firstseg, i_index_offset, b_isend ) < 0 )
+            return -1;
+    }
+    else if ( p_sys->psz_indexPath )
     {
         int val;
         FILE *fp;
@@ -591,80 +808,12 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
             return -1;
         }
 
-        if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
-                          "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s", p_sys->i_seglen,
-                          p_sys->b_caching ? "YES" : "NO",
-                          p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
-                          i_firstseg, ((p_sys->i_initial_segment > 1) && (p_sys->i_initial_segment == i_firstseg)) ? "#EXT-X-DISCONTINUITY\n" : ""
-                          ) < 0 )
+        if ( writeIndex( p_sys, fp, i_firstseg, i_index_offset, b_isend ) < 0 )
         {
             free( psz_idxTmp );
             fclose( fp );
             return -1;
         }
-        char *psz_current_uri=NULL;
-
-
-        for ( uint32_t i = i_firstseg; i <= p_sys->i_segment; i++ )
-        {
-            //scale to i_index_offset..numsegs + i_index_offset
-            uint32_t index = i - i_firstseg + i_index_offset;
-
-            output_segment_t *segment = (output_segment_t *)vlc_array_item_at_index( p_sys->segments_t, index );
-            if( p_sys->key_uri &&
-                ( !psz_current_uri ||  strcmp( psz_current_uri, segment->psz_key_uri ) )
-              )
-            {
-                int ret = 0;
-                free( psz_current_uri );
-                psz_current_uri = strdup( segment->psz_key_uri );
-                if( p_sys->b_generate_iv )
-                {
-                    unsigned long long iv_hi = segment->aes_ivs[0];
-                    unsigned long long iv_lo = segment->aes_ivs[8];
-                    for( unsigned short i = 1; i < 8; i++ )
-                    {
-                        iv_hi <<= 8;
-                        iv_hi |= segment->aes_ivs[i] & 0xff;
-                        iv_lo <<= 8;
-                        iv_lo |= segment->aes_ivs[8+i] & 0xff;
-                    }
-                    ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
-                                   segment->psz_key_uri, iv_hi, iv_lo );
-
-                } else {
-                    ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", segment->psz_key_uri );
-                }
-                if( ret < 0 )
-                {
-                    free( psz_current_uri );
-                    free( psz_idxTmp );
-                    fclose( fp );
-                    return -1;
-                }
-            }
-
-            val = fprintf( fp, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri);
-            if ( val < 0 )
-            {
-                free( psz_current_uri );
-                free( psz_idxTmp );
-                fclose( fp );
-                return -1;
-            }
-        }
-        free( psz_current_uri );
-
-        if ( b_isend )
-        {
-            if ( fputs ( STR_ENDLIST, fp ) < 0)
-            {
-                free( psz_idxTmp );
-                fclose( fp ) ;
-                return -1;
-            }
-
-        }
         fclose( fp );
 
         val = vlc_rename ( psz_idxTmp, p_sys->psz_indexPath);
@@ -690,7 +839,7 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
          msg_Dbg( p_access, "Removing segment number %d", segment->i_segment_number );
          vlc_array_remove( p_sys->segments_t, 0 );
 
-         if ( segment->psz_filename )
+         if ( segment->psz_filename && !p_sys->p_httpd_host )
          {
              vlc_unlink( segment->psz_filename );
          }
@@ -708,7 +857,7 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
  *****************************************************************************/
 static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys, bool b_isend )
 {
-    if ( p_sys->i_handle >= 0 )
+    if ( p_sys->b_segment_open )
     {
         output_segment_t *segment = (output_segment_t *)vlc_array_item_at_index( p_sys->segments_t, vlc_array_count( p_sys->segments_t ) - 1 );
 
@@ -720,6 +869,13 @@ static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sy
 
             if( err ) {
                msg_Err( p_access, "Couldn't encrypt 16 bytes: %s", gpg_strerror(err) );
+            } else if( p_sys->p_httpd_host ) {
+                block_t *p_stuffing = block_Alloc( 16 );
+                if( likely(p_stuffing != NULL) )
+                {
+                    memcpy( p_stuffing->p_buffer, p_sys->stuffing_bytes, 16 );
+                    block_ChainLastAppend( &p_sys->pp_segment_last, p_stuffing );
+                }
             } else {
             int ret = write( p_sys->i_handle, p_sys->stuffing_bytes, 16 );
             if( ret != 16 )
@@ -728,9 +884,30 @@ static void closeCurrentSegment( sout_access_out_t *p_access, sout_access_out_sy
             p_sys->stuffing_size = 0;
         }
 
-
-        close( p_sys->i_handle );
-        p_sys->i_handle = -1;
+        if( p_sys->p_httpd_host )
+        {
+            /* Publish the complete segment */
+            segment->p_data = p_sys->p_segment_data
+                            ? block_ChainGather( p_sys->p_segment_data )
+                            : block_Alloc( 0 );
+            p_sys->p_segment_data = NULL;
+            p_sys->pp_segment_last = &p_sys->p_segment_data;
+            if( likely(segment->p_data != NULL) )
+                segment->p_file = httpd_FileNew( p_sys->p_httpd_host,
+                                                 segment->psz_filename,
+                                                 "video/MP2T", NULL, NULL,
+                                                 segmentFill,
+                                                 (httpd_file_sys_t *)segment );
+            if( segment->p_file == NULL )
+                msg_Err( p_access, "cannot serve segment %s",
+                         segment->psz_filename );
+        }
+        else
+        {
+            close( p_sys->i_handle );
+            p_sys->i_handle = -1;
+        }
+        p_sys->b_segment_open = false;
 
         if( ! ( us_asprintf( &segment->psz_duration, "%.2f", p_sys->f_seglen ) ) )
         {
@@ -808,7 +985,8 @@ static void Close( vlc_object_t * p_this )
     {
         output_segment_t *segment = vlc_array_item_at_index( p_sys->segments_t, 0 );
         vlc_array_remove( p_sys->segments_t, 0 );
-        if( p_sys->b_delsegs && p_sys->i_numsegs && segment->psz_filename )
+        if( p_sys->b_delsegs && p_sys->i_numsegs && segment->psz_filename &&
+            !p_sys->p_httpd_host )
         {
             msg_Dbg( p_access, "Removing segment number %d name %s", segment->i_segment_number, segment->psz_filename );
             vlc_unlink( segment->psz_filename );
@@ -818,6 +996,16 @@ static void Close( vlc_object_t * p_this )
     }
     vlc_array_destroy( p_sys->segments_t );
 
+    if( p_sys->p_httpd_host )
+    {
+        if( p_sys->p_index_file )
+            httpd_FileDelete( p_sys->p_index_file );
+        httpd_HostDelete( p_sys->p_httpd_host );
+        block_ChainRelease( p_sys->p_segment_data );
+        vlc_mutex_destroy( &p_sys->index_lock );
+        free( p_sys->psz_index );
+    }
+
     free( p_sys->psz_indexUrl );
     free( p_sys->psz_indexPath );
     free( p_sys );
@@ -860,7 +1048,8 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
         return -1;
 
     segment->i_segment_number = i_newseg;
-    segment->psz_filename = formatSegmentPath( p_access->psz_path, i_newseg, true );
+    segment->psz_filename = formatSegmentPath( p_access->psz_path, i_newseg,
+                                               !p_sys->p_httpd_host );
     char *psz_idxFormat = p_sys->psz_indexUrl ? p_sys->psz_indexUrl : p_access->psz_path;
     segment->psz_uri = formatSegmentPath( psz_idxFormat , i_newseg, false );
 
@@ -871,9 +1060,15 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
         return -1;
     }
 
-    fd = vlc_open( segment->psz_filename, O_WRONLY | O_CREAT | O_LARGEFILE |
-                     O_TRUNC, 0666 );
-    if ( fd == -1 )
+    if ( p_sys->p_httpd_host )
+    {
+        /* Kept in memory until the segment is complete */
+        fd = -1;
+        p_sys->p_segment_data = NULL;
+        p_sys->pp_segment_last = &p_sys->p_segment_data;
+    }
+    else if ( ( fd = vlc_open( segment->psz_filename, O_WRONLY | O_CREAT |
+                               O_LARGEFILE | O_TRUNC, 0666 ) ) == -1 )
     {
         msg_Err( p_access, "cannot open `%s' (%s)", segment->psz_filename,
                  vlc_strerror_c(errno) );
@@ -899,9 +1094,10 @@ static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t
 
     p_sys->psz_cursegPath = strdup(segment->psz_filename);
     p_sys->i_handle = fd;
+    p_sys->b_segment_open = true;
     p_sys->i_segment = i_newseg;
     p_sys->b_segment_has_data = false;
-    return fd;
+    return 0;
 }
 /*****************************************************************************
  * CheckSegmentChange: Check if segment needs to be closed and new opened
@@ -923,14 +1119,14 @@ static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer )
         msg_Dbg( p_access, "dts offset %"PRId64, p_sys->i_dts_offset );
     }
 
-    if( p_sys->i_handle > 0 && p_sys->b_segment_has_data &&
+    if( p_sys->b_segment_open && p_sys->b_segment_has_data &&
        (( p_buffer->i_length + p_buffer->i_dts - p_sys->i_opendts +
           p_sys->i_dts_offset ) >= p_sys->i_seglenm ) )
     {
         closeCurrentSegment( p_access, p_sys, false );
     }
 
-    if ( unlikely( p_sys->i_handle < 0 ) )
+    if ( unlikely( !p_sys->b_segment_open ) )
     {
         p_sys->i_dts_offset = 0;
         p_sys->i_opendts = output ? output->i_dts : p_buffer->i_dts;
@@ -984,6 +1180,23 @@ static ssize_t writeSegment( sout_access_out_t *p_access )
             crypted=true;
 
         }
+
+        p_sys->f_seglen =
+            (float)(output->i_length +
+                    output->i_dts - p_sys->i_opendts + p_sys->i_dts_offset) / CLOCK_FREQ;
+
+        if ( p_sys->p_httpd_host )
+        {
+            /* Keep the block itself */
+            block_t *p_next = output->p_next;
+            output->p_next = NULL;
+            i_write += output->i_buffer;
+            block_ChainLastAppend( &p_sys->pp_segment_last, output );
+            output = p_next;
+            crypted=false;
+            continue;
+        }
+
         ssize_t val = write( p_sys->i_handle, output->p_buffer, output->i_buffer );
         if ( val == -1 )
         {
@@ -992,10 +1205,6 @@ static ssize_t writeSegment( sout_access_out_t *p_access )
            return -1;
         }
 
-        p_sys->f_seglen =
-            (float)(output->i_length +
-                    output->i_dts - p_sys->i_opendts + p_sys->i_dts_offset) / CLOCK_FREQ;
-
         if ( (size_t)val >= output->i_buffer )
         {
            block_t *p_next = output->p_next;
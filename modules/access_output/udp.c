@@ -45,12 +45,21 @@
 #   include <ws2tcpip.h>
 #else
 #   include <sys/socket.h>
+#   include <sys/uio.h>
+#endif
+#ifdef __linux__
+#   include <netinet/udp.h>
 #endif
 
 #include <vlc_network.h>
 
 #define MAX_EMPTY_BLOCKS 200
 
+/* Maximum number of data chunks gathered into one datagram */
+#define UDP_MAX_CHUNKS 16
+/* Maximum number of datagrams sent at once */
+#define UDP_BATCH 32
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -110,6 +119,21 @@ static int Control( sout_access_out_t *, int, va_list );
 static void* ThreadWrite( void * );
 static block_t *NewUDPPacket( sout_access_out_t *, mtime_t );
 
+/* A datagram refers to the payload of the blocks written by the muxer
+ * rather than to a copy of it. */
+typedef struct
+{
+    block_t      self; /* i_buffer is the total payload size */
+    unsigned     chunks;
+    struct
+    {
+        void    *base;
+        size_t   len;
+    } chunk[UDP_MAX_CHUNKS];
+    block_t     *owned; /* blocks to release once the datagram is gone */
+    block_t    **owned_last;
+} udp_datagram_t;
+
 struct sout_access_out_sys_t
 {
     mtime_t       i_caching;
@@ -120,8 +144,18 @@ struct sout_access_out_sys_t
     block_fifo_t *p_fifo;
     block_fifo_t *p_empty_blocks;
     block_t      *p_buffer;
+    block_t      *p_orphans; /* blocks not owned by any datagram (yet) */
 
     vlc_thread_t  thread;
+
+#ifdef UDP_SEGMENT
+    bool          b_gso;
+#endif
+    /* Statistics, owned by the sender thread */
+    unsigned      i_datagrams;
+    unsigned      i_bursts;
+    unsigned      i_max_burst;
+    unsigned      i_late;
 };
 
 #define DEFAULT_PORT 1234
@@ -210,9 +244,17 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
-    p_sys->p_fifo = block_FifoNew();
-    p_sys->p_empty_blocks = block_FifoNew();
+    p_sys->p_fifo = block_FifoNewSPSC();
+    p_sys->p_empty_blocks = block_FifoNewSPSC();
     p_sys->p_buffer = NULL;
+    p_sys->p_orphans = NULL;
+#ifdef UDP_SEGMENT
+    p_sys->b_gso = true;
+#endif
+    p_sys->i_datagrams = 0;
+    p_sys->i_bursts = 0;
+    p_sys->i_max_burst = 0;
+    p_sys->i_late = 0;
 
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
@@ -246,6 +288,11 @@ static void Close( vlc_object_t * p_this )
     block_FifoRelease( p_sys->p_empty_blocks );
 
     if( p_sys->p_buffer ) block_Release( p_sys->p_buffer );
+    block_ChainRelease( p_sys->p_orphans );
+
+    msg_Dbg( p_access, "sent %u datagrams in %u bursts (%u at most), "
+             "%u late", p_sys->i_datagrams, p_sys->i_bursts,
+             p_sys->i_max_burst, p_sys->i_late );
 
     net_Close( p_sys->i_handle );
     free( p_sys );
@@ -267,8 +314,22 @@ static int Control( sout_access_out_t *p_access, int i_query, va_list args )
     return VLC_SUCCESS;
 }
 
+static void FlushUDPPacket( sout_access_out_t *p_access, mtime_t now )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->p_buffer->i_dts + p_sys->i_caching < now )
+        msg_Dbg( p_access, "late packet for UDP input (%"PRId64 ")",
+                 now - p_sys->p_buffer->i_dts - p_sys->i_caching );
+    block_FifoPut( p_sys->p_fifo, p_sys->p_buffer );
+    p_sys->p_buffer = NULL;
+}
+
 /*****************************************************************************
  * Write: standard write on a file descriptor.
+ *****************************************************************************
+ * Datagrams reference the payload of the written blocks: nothing is copied.
+ * A block is owned by the last datagram referring to it.
  *****************************************************************************/
 static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
 {
@@ -277,9 +338,13 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
 
     while( p_buffer )
     {
-        block_t *p_next;
+        block_t *p_next = p_buffer->p_next;
         int i_packets = 0;
         mtime_t now = mdate();
+        uint8_t *p_data = p_buffer->p_buffer;
+        size_t i_data = p_buffer->i_buffer;
+
+        p_buffer->p_next = NULL;
 
         if( !p_sys->b_mtu_warning && p_buffer->i_buffer > p_sys->i_mtu )
         {
@@ -291,22 +356,12 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
         /* Check if there is enough space in the buffer */
         if( p_sys->p_buffer &&
             p_sys->p_buffer->i_buffer + p_buffer->i_buffer > p_sys->i_mtu )
-        {
-            if( p_sys->p_buffer->i_dts + p_sys->i_caching < now )
-            {
-                msg_Dbg( p_access, "late packet for UDP input (%"PRId64 ")",
-                         now - p_sys->p_buffer->i_dts
-                          - p_sys->i_caching );
-            }
-            block_FifoPut( p_sys->p_fifo, p_sys->p_buffer );
-            p_sys->p_buffer = NULL;
-        }
+            FlushUDPPacket( p_access, now );
 
         i_len += p_buffer->i_buffer;
-        while( p_buffer->i_buffer )
+        while( i_data > 0 )
         {
-            size_t i_payload_size = p_sys->i_mtu;
-            size_t i_write = __MIN( p_buffer->i_buffer, i_payload_size );
+            udp_datagram_t *dg;
 
             i_packets++;
 
@@ -316,35 +371,43 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                 if( !p_sys->p_buffer ) break;
             }
 
-            memcpy( p_sys->p_buffer->p_buffer + p_sys->p_buffer->i_buffer,
-                    p_buffer->p_buffer, i_write );
+            dg = (udp_datagram_t *)p_sys->p_buffer;
+
+            size_t i_write = __MIN( i_data,
+                                    p_sys->i_mtu - dg->self.i_buffer );
+
+            dg->chunk[dg->chunks].base = p_data;
+            dg->chunk[dg->chunks].len = i_write;
+            dg->chunks++;
+            dg->self.i_buffer += i_write;
+            p_data += i_write;
+            i_data -= i_write;
 
-            p_sys->p_buffer->i_buffer += i_write;
-            p_buffer->p_buffer += i_write;
-            p_buffer->i_buffer -= i_write;
             if ( p_buffer->i_flags & BLOCK_FLAG_CLOCK )
             {
-                if ( p_sys->p_buffer->i_flags & BLOCK_FLAG_CLOCK )
+                if ( dg->self.i_flags & BLOCK_FLAG_CLOCK )
                     msg_Warn( p_access, "putting two PCRs at once" );
-                p_sys->p_buffer->i_flags |= BLOCK_FLAG_CLOCK;
+                dg->self.i_flags |= BLOCK_FLAG_CLOCK;
             }
 
-            if( p_sys->p_buffer->i_buffer == p_sys->i_mtu || i_packets > 1 )
-            {
-                /* Flush */
-                if( p_sys->p_buffer->i_dts + p_sys->i_caching < now )
-                {
-                    msg_Dbg( p_access, "late packet for udp input (%"PRId64 ")",
-                             mdate() - p_sys->p_buffer->i_dts
-                              - p_sys->i_caching );
-                }
-                block_FifoPut( p_sys->p_fifo, p_sys->p_buffer );
-                p_sys->p_buffer = NULL;
+            if( i_data == 0 )
+            {   /* Last reference to the block */
+                *dg->owned_last = p_buffer;
+                dg->owned_last = &p_buffer->p_next;
+                p_buffer = NULL;
             }
+
+            if( dg->self.i_buffer == p_sys->i_mtu || i_packets > 1
+             || dg->chunks == UDP_MAX_CHUNKS )
+                FlushUDPPacket( p_access, mdate() );
         }
 
-        p_next = p_buffer->p_next;
-        block_Release( p_buffer );
+        if( p_buffer != NULL )
+        {   /* Out of memory: earlier datagrams may still refer to the block,
+             * so it is handed to the next datagram instead of released. */
+            p_buffer->p_next = p_sys->p_orphans;
+            p_sys->p_orphans = p_buffer;
+        }
         p_buffer = p_next;
     }
 
@@ -361,6 +424,24 @@ static int Seek( sout_access_out_t *p_access, off_t i_pos )
     return -1;
 }
 
+static void ReleaseUDPPacketData( udp_datagram_t *dg )
+{
+    block_ChainRelease( dg->owned );
+    dg->owned = NULL;
+    dg->owned_last = &dg->owned;
+    dg->chunks = 0;
+    dg->self.i_buffer = 0;
+    dg->self.i_flags = 0;
+}
+
+static void DestroyUDPPacket( block_t *p_buffer )
+{
+    udp_datagram_t *dg = (udp_datagram_t *)p_buffer;
+
+    ReleaseUDPPacketData( dg );
+    free( dg );
+}
+
 /*****************************************************************************
  * NewUDPPacket: allocate a new UDP packet of size p_sys->i_mtu
  *****************************************************************************/
@@ -377,23 +458,234 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
 
     if( block_FifoCount( p_sys->p_empty_blocks ) == 0 )
     {
-        p_buffer = block_Alloc( p_sys->i_mtu );
+        udp_datagram_t *dg = malloc( sizeof( *dg ) );
+        if( unlikely(dg == NULL) )
+            return NULL;
+
+        block_Init( &dg->self, NULL, 0 );
+        dg->self.pf_release = DestroyUDPPacket;
+        dg->chunks = 0;
+        dg->owned = NULL;
+        dg->owned_last = &dg->owned;
+        p_buffer = &dg->self;
     }
     else
+        p_buffer = block_FifoGet( p_sys->p_empty_blocks );
+
+    udp_datagram_t *dg = (udp_datagram_t *)p_buffer;
+
+    /* Blocks that could not be queued so far go with this datagram */
+    if( p_sys->p_orphans != NULL )
     {
-        p_buffer = block_FifoGet(p_sys->p_empty_blocks );
-        p_buffer->i_flags = 0;
-        p_buffer = block_Realloc( p_buffer, 0, p_sys->i_mtu );
+        block_t *p_last = p_sys->p_orphans;
+
+        while( p_last->p_next != NULL )
+            p_last = p_last->p_next;
+        *dg->owned_last = p_sys->p_orphans;
+        dg->owned_last = &p_last->p_next;
+        p_sys->p_orphans = NULL;
     }
 
     p_buffer->i_dts = i_dts;
-    p_buffer->i_buffer = 0;
-
     return p_buffer;
 }
 
+static void RecycleUDPPacket( sout_access_out_sys_t *p_sys, block_t *p_pk )
+{
+    ReleaseUDPPacketData( (udp_datagram_t *)p_pk );
+    block_FifoPut( p_sys->p_empty_blocks, p_pk );
+}
+
+typedef struct
+{
+    unsigned  count;
+    block_t  *dgram[UDP_BATCH];
+    block_t  *next;
+} udp_batch_t;
+
+static void ReleaseBatch( void *data )
+{
+    udp_batch_t *batch = data;
+
+    for( unsigned i = 0; i < batch->count; i++ )
+        block_Release( batch->dgram[i] );
+    if( batch->next != NULL )
+        block_Release( batch->next );
+}
+
+#ifndef _WIN32
+static unsigned FillIOVec( struct iovec *iov, const udp_datagram_t *dg )
+{
+    for( unsigned i = 0; i < dg->chunks; i++ )
+    {
+        iov[i].iov_base = dg->chunk[i].base;
+        iov[i].iov_len = dg->chunk[i].len;
+    }
+    return dg->chunks;
+}
+#endif
+
+#ifdef UDP_SEGMENT
+/**
+ * Sends a run of same-size datagrams with a single segmentation offload
+ * (GSO) system call.
+ * @return the number of datagrams sent, or 0 if nothing was sent
+ */
+static unsigned SendSegments( sout_access_out_t *p_access,
+                              block_t *const *dgram, unsigned count )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    const size_t size = dgram[0]->i_buffer;
+    struct iovec iov[UDP_BATCH * UDP_MAX_CHUNKS];
+    size_t total = 0;
+    unsigned n = 0, iovcnt = 0;
+
+    /* All segments but the last must be of the same size, and the whole
+     * must fit in a single IP packet before segmentation. */
+    while( n < count && total + dgram[n]->i_buffer <= 65000 )
+    {
+        if( dgram[n]->i_buffer > size )
+            break;
+        iovcnt += FillIOVec( iov + iovcnt,
+                             (const udp_datagram_t *)dgram[n] );
+        total += dgram[n]->i_buffer;
+        if( dgram[n++]->i_buffer < size )
+            break;
+    }
+    if( n < 2 )
+        return 0;
+
+    union
+    {
+        char buf[CMSG_SPACE(sizeof (uint16_t))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {
+        .msg_iov = iov,
+        .msg_iovlen = iovcnt,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof (control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    uint16_t segment = size;
+
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof (segment));
+    memcpy( CMSG_DATA(cmsg), &segment, sizeof (segment) );
+
+    if( sendmsg( p_sys->i_handle, &msg, 0 ) == -1 )
+    {
+        if( errno == EINVAL || errno == ENOPROTOOPT || errno == EIO
+         || errno == EOPNOTSUPP )
+        {
+            msg_Dbg( p_access, "segmentation offload not available: %s",
+                     vlc_strerror_c(errno) );
+            p_sys->b_gso = false;
+        }
+        return 0;
+    }
+    return n;
+}
+#endif
+
+/*****************************************************************************
+ * SendBatch: send all datagrams of a batch, as few system calls as possible
+ *****************************************************************************/
+static void SendBatch( sout_access_out_t *p_access, udp_batch_t *batch )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    unsigned sent = 0;
+
+#ifdef UDP_SEGMENT
+    while( p_sys->b_gso && sent < batch->count )
+    {
+        unsigned n = SendSegments( p_access, batch->dgram + sent,
+                                   batch->count - sent );
+        if( n == 0 )
+            break;
+        sent += n;
+    }
+#endif
+
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgs[UDP_BATCH];
+    struct iovec iov[UDP_BATCH][UDP_MAX_CHUNKS];
+
+    for( unsigned i = sent; i < batch->count; i++ )
+    {
+        memset( &msgs[i].msg_hdr, 0, sizeof( msgs[i].msg_hdr ) );
+        msgs[i].msg_hdr.msg_iov = iov[i];
+        msgs[i].msg_hdr.msg_iovlen = FillIOVec( iov[i],
+                                 (const udp_datagram_t *)batch->dgram[i] );
+    }
+
+    while( sent < batch->count )
+    {
+        int val = sendmmsg( p_sys->i_handle, msgs + sent,
+                            batch->count - sent, 0 );
+        if( val <= 0 )
+        {
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            break;
+        }
+        sent += val;
+    }
+#else
+    for( unsigned i = sent; i < batch->count; i++ )
+    {
+        const udp_datagram_t *dg = (const udp_datagram_t *)batch->dgram[i];
+# ifndef _WIN32
+        struct iovec iov[UDP_MAX_CHUNKS];
+        struct msghdr msg = {
+            .msg_iov = iov,
+            .msg_iovlen = FillIOVec( iov, dg ),
+        };
+
+        if( sendmsg( p_sys->i_handle, &msg, 0 ) == -1 )
+# else
+        uint8_t buf[dg->self.i_buffer];
+        size_t len = 0;
+
+        for( unsigned j = 0; j < dg->chunks; j++ )
+        {
+            memcpy( buf + len, dg->chunk[j].base, dg->chunk[j].len );
+            len += dg->chunk[j].len;
+        }
+        if( send( p_sys->i_handle, (const char *)buf, len, 0 ) == -1 )
+# endif
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+    }
+#endif
+
+    /* Statistics */
+    mtime_t i_sent = mdate();
+
+    p_sys->i_datagrams += batch->count;
+    p_sys->i_bursts++;
+    if( batch->count > p_sys->i_max_burst )
+        p_sys->i_max_burst = batch->count;
+
+    unsigned i_late = 0;
+
+    for( unsigned i = 0; i < batch->count; i++ )
+    {
+        block_t *p_pk = batch->dgram[i];
+        mtime_t i_date = p_sys->i_caching + p_pk->i_dts;
+
+        if ( i_sent > i_date + 20000 && i_late++ == 0 )
+            msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
+                     i_sent - i_date );
+        RecycleUDPPacket( p_sys, p_pk );
+    }
+    p_sys->i_late += i_late;
+    batch->count = 0;
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
+ *****************************************************************************
+ * Datagrams that are due are sent together, up to UDP_BATCH at a time.
  *****************************************************************************/
 static void* ThreadWrite( void *data )
 {
@@ -404,11 +696,23 @@ static void* ThreadWrite( void *data )
                                              SOUT_CFG_PREFIX "group" );
     mtime_t i_to_send = i_group;
     unsigned i_dropped_packets = 0;
+    udp_batch_t batch = { .count = 0, .next = NULL };
 
+    vlc_cleanup_push( ReleaseBatch, &batch );
     for (;;)
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
-        mtime_t       i_date, i_sent;
+        /* Send what is pending rather than wait for more */
+        if( batch.count == UDP_BATCH
+         || (batch.count > 0 && block_FifoCount( p_sys->p_fifo ) == 0) )
+        {
+            SendBatch( p_access, &batch );
+            continue;
+        }
+
+        batch.next = block_FifoGet( p_sys->p_fifo );
+
+        block_t *p_pk = batch.next;
+        mtime_t       i_date;
 
         i_date = p_sys->i_caching + p_pk->i_dts;
         if( i_date_last > 0 )
@@ -419,7 +723,8 @@ static void* ThreadWrite( void *data )
                     msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
                              i_date - i_date_last );
 
-                block_FifoPut( p_sys->p_empty_blocks, p_pk );
+                batch.next = NULL;
+                RecycleUDPPacket( p_sys, p_pk );
 
                 i_date_last = i_date;
                 i_dropped_packets++;
@@ -433,16 +738,19 @@ static void* ThreadWrite( void *data )
             }
         }
 
-        block_cleanup_push( p_pk );
         i_to_send--;
         if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
         {
-            mwait( i_date );
+            if( i_date > mdate() )
+            {
+                if( batch.count > 0 )
+                    SendBatch( p_access, &batch );
+                mwait( i_date );
+            }
             i_to_send = i_group;
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
-        vlc_cleanup_pop();
+        batch.dgram[batch.count++] = p_pk;
+        batch.next = NULL;
 
         if( i_dropped_packets )
         {
@@ -450,18 +758,8 @@ static void* ThreadWrite( void *data )
             i_dropped_packets = 0;
         }
 
-#if 1
-        i_sent = mdate();
-        if ( i_sent > i_date + 20000 )
-        {
-            msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
-                     i_sent - i_date );
-        }
-#endif
-
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
-
         i_date_last = i_date;
     }
+    vlc_cleanup_pop();
     return NULL;
 }
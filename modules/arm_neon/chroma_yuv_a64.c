@@ -0,0 +1,186 @@
+/*****************************************************************************
+ * chroma_yuv_a64.c : AArch64 Advanced SIMD YUV to YUV chroma conversions
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* The 32-bits ARM assembly cannot be assembled for AArch64. These are the
+ * same conversions written with intrinsics, with the same entry points and
+ * the same constraints: lines are processed 16 pixels (8 for the chroma
+ * deinterleaving) at a time, so pitches must be rounded accordingly. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <arm_neon.h>
+#include "arm_neon/chroma_neon.h"
+
+/* Packs one line of 16 pixels, with the chroma samples already interleaved */
+static inline void pack_yuyv(uint8_t *out, uint8x16_t y, uint8x16_t uv,
+                             bool chroma_first)
+{
+    uint8x16x2_t px;
+
+    px.val[chroma_first] = y;
+    px.val[!chroma_first] = uv;
+    vst2q_u8(out, px);
+}
+
+static inline uint8x16_t zip_chroma(const uint8_t *u, const uint8_t *v)
+{
+    uint8x8x2_t uv = vzip_u8(vld1_u8(u), vld1_u8(v));
+
+    return vcombine_u8(uv.val[0], uv.val[1]);
+}
+
+static inline void i420_pack(struct yuv_pack *const out,
+                             const struct yuv_planes *const in,
+                             int width, int height, bool chroma_first)
+{
+    const size_t ipitch = in->pitch, opitch = out->pitch;
+
+    for (int j = 0; j < height; j += 2)
+    {
+        const uint8_t *y1 = (const uint8_t *)in->y + j * ipitch;
+        const uint8_t *y2 = y1 + ipitch;
+        const uint8_t *u = (const uint8_t *)in->u + (j / 2) * (ipitch / 2);
+        const uint8_t *v = (const uint8_t *)in->v + (j / 2) * (ipitch / 2);
+        uint8_t *o1 = (uint8_t *)out->yuv + j * opitch;
+        uint8_t *o2 = o1 + opitch;
+
+        for (int i = 0; i < width; i += 16)
+        {
+            uint8x16_t uv = zip_chroma(u + i / 2, v + i / 2);
+
+            pack_yuyv(o1 + 2 * i, vld1q_u8(y1 + i), uv, chroma_first);
+            pack_yuyv(o2 + 2 * i, vld1q_u8(y2 + i), uv, chroma_first);
+        }
+    }
+}
+
+static inline void i422_pack(struct yuv_pack *const out,
+                             const struct yuv_planes *const in,
+                             int width, int height, bool chroma_first)
+{
+    const size_t ipitch = in->pitch, opitch = out->pitch;
+
+    for (int j = 0; j < height; j++)
+    {
+        const uint8_t *y = (const uint8_t *)in->y + j * ipitch;
+        const uint8_t *u = (const uint8_t *)in->u + j * (ipitch / 2);
+        const uint8_t *v = (const uint8_t *)in->v + j * (ipitch / 2);
+        uint8_t *o = (uint8_t *)out->yuv + j * opitch;
+
+        for (int i = 0; i < width; i += 16)
+            pack_yuyv(o + 2 * i, vld1q_u8(y + i),
+                      zip_chroma(u + i / 2, v + i / 2), chroma_first);
+    }
+}
+
+static inline void i422_unpack(struct yuv_planes *const out,
+                               const struct yuv_pack *const in,
+                               int width, int height, bool chroma_first)
+{
+    const size_t ipitch = in->pitch, opitch = out->pitch;
+
+    for (int j = 0; j < height; j++)
+    {
+        const uint8_t *p = (const uint8_t *)in->yuv + j * ipitch;
+        uint8_t *y = (uint8_t *)out->y + j * opitch;
+        uint8_t *u = (uint8_t *)out->u + j * (opitch / 2);
+        uint8_t *v = (uint8_t *)out->v + j * (opitch / 2);
+
+        for (int i = 0; i < width; i += 16)
+        {
+            uint8x16x2_t px = vld2q_u8(p + 2 * i);
+            uint8x16_t c = px.val[!chroma_first];
+            uint8x8x2_t uv = vuzp_u8(vget_low_u8(c), vget_high_u8(c));
+
+            vst1q_u8(y + i, px.val[chroma_first]);
+            vst1_u8(u + i / 2, uv.val[0]);
+            vst1_u8(v + i / 2, uv.val[1]);
+        }
+    }
+}
+
+void i420_yuyv_neon(struct yuv_pack *const out,
+                    const struct yuv_planes *const in,
+                    int width, int height)
+{
+    i420_pack(out, in, width, height, false);
+}
+
+void i420_uyvy_neon(struct yuv_pack *const out,
+                    const struct yuv_planes *const in,
+                    int width, int height)
+{
+    i420_pack(out, in, width, height, true);
+}
+
+void i422_yuyv_neon(struct yuv_pack *const out,
+                    const struct yuv_planes *const in,
+                    int width, int height)
+{
+    i422_pack(out, in, width, height, false);
+}
+
+void i422_uyvy_neon(struct yuv_pack *const out,
+                    const struct yuv_planes *const in,
+                    int width, int height)
+{
+    i422_pack(out, in, width, height, true);
+}
+
+void yuyv_i422_neon(struct yuv_planes *const out,
+                    const struct yuv_pack *const in,
+                    int width, int height)
+{
+    i422_unpack(out, in, width, height, false);
+}
+
+void uyvy_i422_neon(struct yuv_planes *const out,
+                    const struct yuv_pack *const in,
+                    int width, int height)
+{
+    i422_unpack(out, in, width, height, true);
+}
+
+void deinterleave_chroma_neon(struct uv_planes *const out,
+                              const struct yuv_pack *const in,
+                              int width, int height)
+{
+    const size_t ipitch = in->pitch, opitch = out->pitch;
+
+    for (int j = 0; j < height; j++)
+    {
+        const uint8_t *p = (const uint8_t *)in->yuv + j * ipitch;
+        uint8_t *u = (uint8_t *)out->u + j * opitch;
+        uint8_t *v = (uint8_t *)out->v + j * opitch;
+
+        for (int i = 0; i < width; i += 8)
+        {
+            uint8x8x2_t uv = vld2_u8(p + 2 * i);
+
+            vst1_u8(u + i, uv.val[0]);
+            vst1_u8(v + i, uv.val[1]);
+        }
+    }
+}
@@ -0,0 +1,166 @@
+/*****************************************************************************
+ * yuv_rgb_a64.c : AArch64 Advanced SIMD YUV to RGB chroma conversions
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Intrinsics versions of i420_rgb.S, i420_rv16.S, nv12_rgb.S and nv21_rgb.S
+ * for AArch64. The fixed point arithmetic (coefficients scaled by 64) is the
+ * same, and so is the output. Lines are processed 16 pixels at a time. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <arm_neon.h>
+#include "arm_neon/chroma_neon.h"
+
+struct chroma
+{
+    int16x8_t r, g, b;
+};
+
+static inline struct chroma chroma_coefs(uint8x8_t u, uint8x8_t v)
+{
+    struct chroma c;
+    uint16x8_t g = vmull_u8(u, vdup_n_u8(14));
+
+    g = vmlal_u8(g, v, vdup_n_u8(34));
+    /* The products are unsigned: wrap-around is intended here */
+    c.r = vaddq_s16(vdupq_n_s16(-15872),
+                    vreinterpretq_s16_u16(vmull_u8(v, vdup_n_u8(115))));
+    c.g = vsubq_s16(vdupq_n_s16(4992), vreinterpretq_s16_u16(g));
+    c.b = vaddq_s16(vdupq_n_s16(-18432),
+                    vreinterpretq_s16_u16(vmull_u8(u, vdup_n_u8(135))));
+    return c;
+}
+
+/* Clamps and divides by 64 the even and odd pixels, then puts them back in
+ * order */
+static inline uint8x16_t mix(int16x8_t even, int16x8_t odd, int16x8_t c)
+{
+    uint8x8x2_t px = vzip_u8(vqrshrun_n_s16(vqaddq_s16(even, c), 6),
+                             vqrshrun_n_s16(vqaddq_s16(odd, c), 6));
+
+    return vcombine_u8(px.val[0], px.val[1]);
+}
+
+static inline void convert16(uint8_t *out, const uint8_t *y,
+                             const struct chroma *c, bool rv16)
+{
+    uint8x8x2_t luma = vld2_u8(y);
+    int16x8_t even = vreinterpretq_s16_u16(vmull_u8(luma.val[0],
+                                                    vdup_n_u8(74)));
+    int16x8_t odd = vreinterpretq_s16_u16(vmull_u8(luma.val[1],
+                                                   vdup_n_u8(74)));
+    uint8x16_t r = mix(even, odd, c->r);
+    uint8x16_t g = mix(even, odd, c->g);
+    uint8x16_t b = mix(even, odd, c->b);
+
+    if (rv16)
+    {
+        uint8x16x2_t px;
+
+        px.val[0] = vsriq_n_u8(vshlq_n_u8(g, 3), b, 3);
+        px.val[1] = vsriq_n_u8(r, g, 5);
+        vst2q_u8(out, px);
+    }
+    else
+    {
+        uint8x16x4_t px;
+
+        px.val[0] = r;
+        px.val[1] = g;
+        px.val[2] = b;
+        px.val[3] = vdupq_n_u8(255);
+        vst4q_u8(out, px);
+    }
+}
+
+static inline void yuv420_rgb(struct yuv_pack *const out,
+                              const struct yuv_planes *const in,
+                              int width, int height,
+                              bool semiplanar, bool swap, bool rv16)
+{
+    const size_t ypitch = in->pitch, opitch = out->pitch;
+    const size_t cpitch = semiplanar ? ypitch : ypitch / 2;
+    const unsigned bpp = rv16 ? 2 : 4;
+
+    for (int j = 0; j < height; j += 2)
+    {
+        const uint8_t *y1 = (const uint8_t *)in->y + j * ypitch;
+        const uint8_t *y2 = y1 + ypitch;
+        const uint8_t *u = (const uint8_t *)in->u + (j / 2) * cpitch;
+        const uint8_t *v = (const uint8_t *)in->v + (j / 2) * cpitch;
+        uint8_t *o1 = (uint8_t *)out->yuv + j * opitch;
+        uint8_t *o2 = o1 + opitch;
+
+        for (int i = 0; i < width; i += 16)
+        {
+            uint8x8_t cu, cv;
+
+            if (semiplanar)
+            {
+                uint8x8x2_t uv = vld2_u8(u + i);
+
+                cu = uv.val[swap];
+                cv = uv.val[!swap];
+            }
+            else
+            {
+                cu = vld1_u8(u + i / 2);
+                cv = vld1_u8(v + i / 2);
+            }
+
+            struct chroma c = chroma_coefs(cu, cv);
+
+            convert16(o1 + bpp * i, y1 + i, &c, rv16);
+            convert16(o2 + bpp * i, y2 + i, &c, rv16);
+        }
+    }
+}
+
+void i420_rgb_neon(struct yuv_pack *const out,
+                   const struct yuv_planes *const in,
+                   int width, int height)
+{
+    yuv420_rgb(out, in, width, height, false, false, false);
+}
+
+void i420_rv16_neon(struct yuv_pack *const out,
+                    const struct yuv_planes *const in,
+                    int width, int height)
+{
+    yuv420_rgb(out, in, width, height, false, false, true);
+}
+
+void nv12_rgb_neon(struct yuv_pack *const out,
+                   const struct yuv_planes *const in,
+                   int width, int height)
+{
+    yuv420_rgb(out, in, width, height, true, false, false);
+}
+
+void nv21_rgb_neon(struct yuv_pack *const out,
+                   const struct yuv_planes *const in,
+                   int width, int height)
+{
+    yuv420_rgb(out, in, width, height, true, true, false);
+}
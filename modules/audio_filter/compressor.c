@@ -38,6 +38,11 @@
 
 #include <vlc_aout.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <xmmintrin.h>
+#endif
 
 /*****************************************************************************
 * Local prototypes.
@@ -131,7 +136,13 @@ static float    Max             ( float, float );
 static float    Clamp           ( float, float, float );
 static int      Round           ( float );
 static float    RmsEnvProcess   ( rms_env *, const float );
+static float    EnvProcess      ( float, float, float, float );
+static float    PeakLevel       ( const float *, int );
 static void     BufferProcess   ( float *, int, float, float, lookahead * );
+#ifdef HAVE_SSE2_INTRINSICS
+static float    PeakLevelSSE    ( const float *, int );
+static void     BufferProcessSSE( float *, int, float, float, lookahead * );
+#endif
 
 static int RMSPeakCallback      ( vlc_object_t *, char const *, vlc_value_t,
                                   vlc_value_t, void * );
@@ -339,6 +350,10 @@ static block_t * DoWork( filter_t * p_filter, block_t * p_in_buf )
     float f_knee_max = Db2Lin( f_threshold + f_knee, p_sys );
     float f_ef_a     = f_ga * 0.25f;
     float f_ef_ai    = 1.0f - f_ef_a;
+#ifdef HAVE_SSE2_INTRINSICS
+    /* below 4 channels, the vectors would be mostly empty */
+    const bool b_sse = vlc_CPU_SSE() && i_channels >= 4;
+#endif
 
     /* Process the current buffer */
     for( int i = 0; i < i_samples; i++ )
@@ -353,37 +368,20 @@ static block_t * DoWork( filter_t * p_filter, block_t * p_in_buf )
 
         /* Find the peak value of current sample.  This becomes the new delayed
          * buffer value that replaces the old one in the lookahead array */
-        f_lev_in_new = fabs( pf_buf[0] );
-        for( int i_chan = 1; i_chan < i_channels; i_chan++ )
-        {
-            f_lev_in_new = Max( f_lev_in_new, fabs( pf_buf[i_chan] ) );
-        }
+#ifdef HAVE_SSE2_INTRINSICS
+        if( b_sse )
+            f_lev_in_new = PeakLevelSSE( pf_buf, i_channels );
+        else
+#endif
+            f_lev_in_new = PeakLevel( pf_buf, i_channels );
         p_la->p_buf[p_la->i_pos].f_lev_in = f_lev_in_new;
 
         /* Add the square of the peak value to a running sum */
         f_sum += f_lev_in_new * f_lev_in_new;
 
-        /* Update the RMS envelope */
-        if( f_amp > f_env_rms )
-        {
-            f_env_rms = f_env_rms * f_ga + f_amp * ( 1.0f - f_ga );
-        }
-        else
-        {
-            f_env_rms = f_env_rms * f_gr + f_amp * ( 1.0f - f_gr );
-        }
-        RoundToZero( &f_env_rms );
-
-        /* Update the peak envelope */
-        if( f_lev_in_old > f_env_peak )
-        {
-            f_env_peak = f_env_peak * f_ga + f_lev_in_old * ( 1.0f - f_ga );
-        }
-        else
-        {
-            f_env_peak = f_env_peak * f_gr + f_lev_in_old * ( 1.0f - f_gr );
-        }
-        RoundToZero( &f_env_peak );
+        /* Update the RMS and peak envelopes */
+        f_env_rms = EnvProcess( f_env_rms, f_amp, f_ga, f_gr );
+        f_env_peak = EnvProcess( f_env_peak, f_lev_in_old, f_ga, f_gr );
 
         /* Process the RMS value and update the output gain every 4 samples */
         if( ( p_sys->i_count++ & 3 ) == 3 )
@@ -427,7 +425,12 @@ static block_t * DoWork( filter_t * p_filter, block_t * p_in_buf )
         f_gain = f_gain * f_ef_a + f_gain_out * f_ef_ai;
 
         /* Write the resulting buffer to the output */
-        BufferProcess( pf_buf, i_channels, f_gain, f_mug, p_la );
+#ifdef HAVE_SSE2_INTRINSICS
+        if( b_sse )
+            BufferProcessSSE( pf_buf, i_channels, f_gain, f_mug, p_la );
+        else
+#endif
+            BufferProcess( pf_buf, i_channels, f_gain, f_mug, p_la );
         pf_buf += i_channels;
     }
 
@@ -604,6 +607,73 @@ static float RmsEnvProcess( rms_env * p_r, const float f_x )
     return sqrt( p_r->f_sum / p_r->i_count );
 }
 
+/* Follow the level with the attack or release coefficient. The coefficient
+ * is selected rather than branched to, as the level is unpredictable. */
+static float EnvProcess( float f_env, float f_in, float f_ga, float f_gr )
+{
+    const float f_g = f_in > f_env ? f_ga : f_gr;
+
+    f_env = f_env * f_g + f_in * ( 1.0f - f_g );
+    RoundToZero( &f_env );
+    return f_env;
+}
+
+/* Peak absolute value of the channels of one frame */
+static float PeakLevel( const float *pf_buf, int i_channels )
+{
+    float f_lev = fabsf( pf_buf[0] );
+
+    for( int i_chan = 1; i_chan < i_channels; i_chan++ )
+        f_lev = Max( f_lev, fabsf( pf_buf[i_chan] ) );
+    return f_lev;
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE
+static float PeakLevelSSE( const float *pf_buf, int i_channels )
+{
+    const __m128 sign = _mm_set1_ps( -0.0f );
+    __m128 lev = _mm_setzero_ps();
+    int i_chan = 0;
+
+    for( ; i_chan + 4 <= i_channels; i_chan += 4 )
+        lev = _mm_max_ps( lev, _mm_andnot_ps( sign,
+                                              _mm_loadu_ps( pf_buf + i_chan ) ) );
+    for( ; i_chan < i_channels; i_chan++ )
+        lev = _mm_max_ss( lev, _mm_andnot_ps( sign,
+                                              _mm_load_ss( pf_buf + i_chan ) ) );
+    lev = _mm_max_ps( lev, _mm_movehl_ps( lev, lev ) );
+    lev = _mm_max_ss( lev, _mm_shuffle_ps( lev, lev, 1 ) );
+    return _mm_cvtss_f32( lev );
+}
+
+VLC_SSE
+static void BufferProcessSSE( float * pf_buf, int i_channels, float f_gain,
+                              float f_mug, lookahead * p_la )
+{
+    float *pf_vals = p_la->p_buf[p_la->i_pos].pf_vals;
+    const __m128 gain = _mm_set1_ps( f_gain * f_mug );
+    int i_chan = 0;
+
+    for( ; i_chan + 4 <= i_channels; i_chan += 4 )
+    {
+        __m128 x = _mm_loadu_ps( pf_buf + i_chan );
+        _mm_storeu_ps( pf_buf + i_chan,
+                       _mm_mul_ps( _mm_loadu_ps( pf_vals + i_chan ), gain ) );
+        _mm_storeu_ps( pf_vals + i_chan, x );
+    }
+    for( ; i_chan < i_channels; i_chan++ )
+    {
+        float f_x = pf_buf[i_chan];
+
+        pf_buf[i_chan] = pf_vals[i_chan] * f_gain * f_mug;
+        pf_vals[i_chan] = f_x;
+    }
+
+    p_la->i_pos = ( p_la->i_pos + 1 ) % ( p_la->i_count );
+}
+#endif
+
 /* Output the compressed delayed buffer and store the current buffer.  Uses a
  * circular array, just like the one used in calculating the RMS of the buffer
  */
@@ -36,9 +36,16 @@
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
+#include <vlc_cpu.h>
 #include <vlc_aout.h>
 #include <vlc_block.h>
 #include <vlc_filter.h>
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
 
 /*****************************************************************************
  * Module descriptor
@@ -59,6 +66,7 @@ vlc_module_end()
 
 typedef block_t *(*cvt_t)(filter_t *, block_t *);
 static cvt_t FindConversion(vlc_fourcc_t src, vlc_fourcc_t dst);
+static cvt_t FindConversionSIMD(vlc_fourcc_t src, vlc_fourcc_t dst);
 
 static int Open(vlc_object_t *object)
 {
@@ -76,6 +84,10 @@ static int Open(vlc_object_t *object)
     if (filter->pf_audio_filter == NULL)
         return VLC_EGENERIC;
 
+    cvt_t simd = FindConversionSIMD(src->i_codec, dst->i_codec);
+    if (simd != NULL)
+        filter->pf_audio_filter = simd;
+
     msg_Dbg(filter, "%4.4s->%4.4s, bits per sample: %i->%i",
             (char *)&src->i_codec, (char *)&dst->i_codec,
             src->audio.i_bitspersample, dst->audio.i_bitspersample);
@@ -297,6 +309,145 @@ static block_t *Fl32toS32(filter_t *filter, block_t *b)
     return b;
 }
 
+/* The SIMD versions scale, clip and round (to nearest even) in one pass,
+ * like the C ones. The conversions are in place: each store is behind the
+ * loads of the same iteration. */
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE
+static block_t *Fl32toS16SSE2(filter_t *filter, block_t *b)
+{
+    VLC_UNUSED(filter);
+    float   *src = (float *)b->p_buffer;
+    int16_t *dst = (int16_t *)src;
+    size_t count = b->i_buffer / 4;
+    const __m128 scale = _mm_set1_ps(32768.f);
+    const __m128 max = _mm_set1_ps(32767.f);
+    const __m128 min = _mm_set1_ps(-32768.f);
+
+    for (; count >= 8; count -= 8, src += 8, dst += 8)
+    {
+        __m128 lo = _mm_mul_ps(_mm_loadu_ps(src), scale);
+        __m128 hi = _mm_mul_ps(_mm_loadu_ps(src + 4), scale);
+        lo = _mm_max_ps(_mm_min_ps(lo, max), min);
+        hi = _mm_max_ps(_mm_min_ps(hi, max), min);
+        _mm_storeu_si128((__m128i *)dst,
+                         _mm_packs_epi32(_mm_cvtps_epi32(lo),
+                                         _mm_cvtps_epi32(hi)));
+    }
+    for (; count > 0; count--)
+    {
+        float s = *(src++) * 32768.f;
+        if (s >= 32767.f)
+            *(dst++) = 32767;
+        else if (s <= -32768.f)
+            *(dst++) = -32768;
+        else
+            *(dst++) = lrintf(s);
+    }
+    b->i_buffer /= 2;
+    return b;
+}
+
+VLC_SSE
+static block_t *Fl32toS32SSE2(filter_t *filter, block_t *b)
+{
+    VLC_UNUSED(filter);
+    float   *src = (float *)b->p_buffer;
+    int32_t *dst = (int32_t *)src;
+    size_t count = b->i_buffer / 4;
+    const __m128 scale = _mm_set1_ps(2147483648.f);
+
+    for (; count >= 4; count -= 4, src += 4, dst += 4)
+    {
+        __m128 s = _mm_mul_ps(_mm_loadu_ps(src), scale);
+        /* Out of range values convert to INT32_MIN: flip the positive ones
+         * to INT32_MAX */
+        __m128i over = _mm_castps_si128(_mm_cmpge_ps(s, scale));
+        _mm_storeu_si128((__m128i *)dst,
+                         _mm_xor_si128(_mm_cvtps_epi32(s), over));
+    }
+    for (; count > 0; count--)
+    {
+        float s = *(src++) * 2147483648.f;
+        if (s >= 2147483647.f)
+            *(dst++) = 2147483647;
+        else if (s <= -2147483648.f)
+            *(dst++) = -2147483648;
+        else
+            *(dst++) = lrintf(s);
+    }
+    return b;
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static block_t *Fl32toS16AVX2(filter_t *filter, block_t *b)
+{
+    VLC_UNUSED(filter);
+    float   *src = (float *)b->p_buffer;
+    int16_t *dst = (int16_t *)src;
+    size_t count = b->i_buffer / 4;
+    const __m256 scale = _mm256_set1_ps(32768.f);
+    const __m256 max = _mm256_set1_ps(32767.f);
+    const __m256 min = _mm256_set1_ps(-32768.f);
+
+    for (; count >= 16; count -= 16, src += 16, dst += 16)
+    {
+        __m256 lo = _mm256_mul_ps(_mm256_loadu_ps(src), scale);
+        __m256 hi = _mm256_mul_ps(_mm256_loadu_ps(src + 8), scale);
+        lo = _mm256_max_ps(_mm256_min_ps(lo, max), min);
+        hi = _mm256_max_ps(_mm256_min_ps(hi, max), min);
+        /* The pack works within 128-bit lanes: restore the order */
+        __m256i s16 = _mm256_packs_epi32(_mm256_cvtps_epi32(lo),
+                                         _mm256_cvtps_epi32(hi));
+        _mm256_storeu_si256((__m256i *)dst,
+                            _mm256_permute4x64_epi64(s16, 0xd8));
+    }
+    for (; count > 0; count--)
+    {
+        float s = *(src++) * 32768.f;
+        if (s >= 32767.f)
+            *(dst++) = 32767;
+        else if (s <= -32768.f)
+            *(dst++) = -32768;
+        else
+            *(dst++) = lrintf(s);
+    }
+    b->i_buffer /= 2;
+    return b;
+}
+
+VLC_AVX2
+static block_t *Fl32toS32AVX2(filter_t *filter, block_t *b)
+{
+    VLC_UNUSED(filter);
+    float   *src = (float *)b->p_buffer;
+    int32_t *dst = (int32_t *)src;
+    size_t count = b->i_buffer / 4;
+    const __m256 scale = _mm256_set1_ps(2147483648.f);
+
+    for (; count >= 8; count -= 8, src += 8, dst += 8)
+    {
+        __m256 s = _mm256_mul_ps(_mm256_loadu_ps(src), scale);
+        __m256i over = _mm256_castps_si256(_mm256_cmp_ps(s, scale, _CMP_GE_OQ));
+        _mm256_storeu_si256((__m256i *)dst,
+                            _mm256_xor_si256(_mm256_cvtps_epi32(s), over));
+    }
+    for (; count > 0; count--)
+    {
+        float s = *(src++) * 2147483648.f;
+        if (s >= 2147483647.f)
+            *(dst++) = 2147483647;
+        else if (s <= -2147483648.f)
+            *(dst++) = -2147483648;
+        else
+            *(dst++) = lrintf(s);
+    }
+    return b;
+}
+#endif
+
 static block_t *Fl32toFl64(filter_t *filter, block_t *bsrc)
 {
     block_t *bdst = block_Alloc(bsrc->i_buffer * 2);
@@ -474,6 +625,32 @@ static const struct {
     { 0, 0, NULL }
 };
 
+static cvt_t FindConversionSIMD(vlc_fourcc_t src, vlc_fourcc_t dst)
+{
+    if (src != VLC_CODEC_FL32)
+        return NULL;
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+    {
+        if (dst == VLC_CODEC_S16N)
+            return Fl32toS16AVX2;
+        if (dst == VLC_CODEC_S32N)
+            return Fl32toS32AVX2;
+    }
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+    {
+        if (dst == VLC_CODEC_S16N)
+            return Fl32toS16SSE2;
+        if (dst == VLC_CODEC_S32N)
+            return Fl32toS32SSE2;
+    }
+#endif
+    VLC_UNUSED(dst);
+    return NULL;
+}
+
 static cvt_t FindConversion(vlc_fourcc_t src, vlc_fourcc_t dst)
 {
     for (int i = 0; cvt_directs[i].convert; i++) {
@@ -0,0 +1,266 @@
+/*****************************************************************************
+ * dspbench.c : audio filter benchmark plugin for vlc
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_modules.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int  Create ( vlc_object_t * );
+static void Destroy( vlc_object_t * );
+
+static block_t *Filter( filter_t *, block_t * );
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+
+#define LOOPS_TEXT N_("Number of buffers")
+#define LOOPS_LONGTEXT N_("The number of audio buffers processed by each " \
+                          "filter, for each channel layout")
+
+#define FILTERS_TEXT N_("Filters")
+#define FILTERS_LONGTEXT N_("Comma-separated list of the audio filters " \
+                            "to benchmark")
+
+#define SAMPLES_TEXT N_("Buffer length")
+#define SAMPLES_LONGTEXT N_("Number of samples per channel in each buffer")
+
+#define CFG_PREFIX "dspbench-"
+
+vlc_module_begin ()
+    set_description( N_("Audio filter benchmark") )
+    set_shortname( N_("DSP benchmark") )
+    set_category( CAT_AUDIO )
+    set_subcategory( SUBCAT_AUDIO_AFILTER )
+    set_capability( "audio filter", 0 )
+
+    set_section( N_("Benchmarking"), NULL )
+    add_integer( CFG_PREFIX "loops", 1000, LOOPS_TEXT,
+                 LOOPS_LONGTEXT, false )
+    add_string( CFG_PREFIX "filters", "equalizer,compressor,normvol",
+                FILTERS_TEXT, FILTERS_LONGTEXT, false )
+    add_integer( CFG_PREFIX "samples", 1024, SAMPLES_TEXT,
+                 SAMPLES_LONGTEXT, false )
+
+    set_callbacks( Create, Destroy )
+vlc_module_end ()
+
+static const struct
+{
+    const char *psz_name;
+    uint32_t i_channels;
+} layouts[] = {
+    { "5.1", AOUT_CHANS_5_1 },
+    { "7.1", AOUT_CHANS_7_1 },
+};
+
+/*****************************************************************************
+ * filter_sys_t: filter method descriptor
+ *****************************************************************************/
+struct filter_sys_t
+{
+    bool b_done;
+    int i_loops;
+    int i_samples;
+};
+
+/*****************************************************************************
+ * Create: allocates the benchmark filter
+ *****************************************************************************/
+static int Create( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys;
+
+    p_sys = p_filter->p_sys = malloc( sizeof( *p_sys ) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+
+    p_sys->b_done = false;
+    p_sys->i_loops = var_InheritInteger( p_filter, CFG_PREFIX "loops" );
+    p_sys->i_samples = var_InheritInteger( p_filter, CFG_PREFIX "samples" );
+    if( p_sys->i_loops <= 0 || p_sys->i_samples <= 0 )
+    {
+        msg_Err( p_filter, "invalid benchmark size" );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
+    p_filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    p_filter->fmt_out.audio = p_filter->fmt_in.audio;
+    p_filter->pf_audio_filter = Filter;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Destroy: destroys the benchmark filter
+ *****************************************************************************/
+static void Destroy( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    free( p_filter->p_sys );
+}
+
+/* Fills the source buffer with a tone in a bit of noise, so that dynamic
+ * filters do not settle on silence */
+static void dspbench_FillBlock( block_t *p_block, unsigned i_channels )
+{
+    float *p = (float *)p_block->p_buffer;
+    uint32_t i_seed = 0x12345678;
+
+    for( unsigned i = 0; i < p_block->i_nb_samples; i++ )
+        for( unsigned c = 0; c < i_channels; c++ )
+        {
+            i_seed = i_seed * 1103515245 + 12345;
+            *(p++) = .5f * sinf( i * (c + 1) * .01f )
+                   + (int32_t)i_seed * (.1f / 2147483648.f);
+        }
+}
+
+/* Runs the source buffer i_loops times through the named filter.
+ * Returns the elapsed time, or -1 if the filter cannot be loaded. */
+static mtime_t dspbench_Run( filter_t *p_filter, const char *psz_name,
+                             uint32_t i_layout, const block_t *p_src )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    filter_t *p_dsp;
+    mtime_t time = -1;
+
+    p_dsp = vlc_object_create( p_filter, sizeof(filter_t) );
+    if( !p_dsp )
+        return -1;
+
+    es_format_Init( &p_dsp->fmt_in, AUDIO_ES, VLC_CODEC_FL32 );
+    p_dsp->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    p_dsp->fmt_in.audio.i_rate = 48000;
+    p_dsp->fmt_in.audio.i_physical_channels =
+    p_dsp->fmt_in.audio.i_original_channels = i_layout;
+    aout_FormatPrepare( &p_dsp->fmt_in.audio );
+    es_format_Copy( &p_dsp->fmt_out, &p_dsp->fmt_in );
+
+    p_dsp->p_module = module_need( p_dsp, "audio filter", psz_name, true );
+    if( p_dsp->p_module )
+    {
+        time = 0;
+        for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
+        {
+            block_t *p_block = block_Alloc( p_src->i_buffer );
+            if( unlikely(p_block == NULL) )
+            {
+                time = -1;
+                break;
+            }
+            memcpy( p_block->p_buffer, p_src->p_buffer, p_src->i_buffer );
+            p_block->i_nb_samples = p_src->i_nb_samples;
+
+            mtime_t start = mdate();
+            p_block = p_dsp->pf_audio_filter( p_dsp, p_block );
+            time += mdate() - start;
+            if( p_block == NULL )
+            {
+                msg_Warn( p_filter, "%s failed to filter", psz_name );
+                time = -1;
+                break;
+            }
+            block_Release( p_block );
+        }
+        module_unneed( p_dsp, p_dsp->p_module );
+    }
+
+    es_format_Clean( &p_dsp->fmt_in );
+    es_format_Clean( &p_dsp->fmt_out );
+    vlc_object_release( p_dsp );
+    return time;
+}
+
+/*****************************************************************************
+ * Filter: benchmarks every listed filter, once, then passes audio through
+ *****************************************************************************/
+static block_t *Filter( filter_t *p_filter, block_t *p_block )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->b_done )
+        return p_block;
+    p_sys->b_done = true;
+
+    char *psz_list = var_InheritString( p_filter, CFG_PREFIX "filters" );
+    if( psz_list == NULL )
+        return p_block;
+
+    for( size_t l = 0; l < ARRAY_SIZE(layouts); l++ )
+    {
+        const unsigned i_channels = popcount( layouts[l].i_channels );
+        block_t *p_src = block_Alloc( p_sys->i_samples * i_channels
+                                      * sizeof (float) );
+        if( p_src == NULL )
+            break;
+        p_src->i_nb_samples = p_sys->i_samples;
+        dspbench_FillBlock( p_src, i_channels );
+
+        msg_Info( p_filter, "Filtering %d buffers of %d %s samples",
+                  p_sys->i_loops, p_sys->i_samples, layouts[l].psz_name );
+
+        char *psz_names = strdup( psz_list ), *psz_state;
+        if( unlikely(psz_names == NULL) )
+        {
+            block_Release( p_src );
+            break;
+        }
+        for( char *psz_name = strtok_r( psz_names, ",", &psz_state );
+             psz_name != NULL;
+             psz_name = strtok_r( NULL, ",", &psz_state ) )
+        {
+            mtime_t time = dspbench_Run( p_filter, psz_name,
+                                         layouts[l].i_channels, p_src );
+            if( time < 0 )
+            {
+                msg_Warn( p_filter, "%s: cannot run", psz_name );
+                continue;
+            }
+
+            const double f_samples = (double)p_sys->i_loops
+                                   * p_sys->i_samples * i_channels;
+            msg_Info( p_filter, "%s (%s): %f sec, %.2f ns/sample",
+                      psz_name, layouts[l].psz_name, time / 1000000.0,
+                      time * 1000. / f_samples );
+        }
+        free( psz_names );
+        block_Release( p_src );
+    }
+    free( psz_list );
+    return p_block;
+}
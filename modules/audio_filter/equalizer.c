@@ -37,11 +37,15 @@
 
 #include <vlc_aout.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <xmmintrin.h>
+#endif
 
 #include "equalizer_presets.h"
 
 /* TODO:
- *  - optimize a bit (you can hardly do slower ;)
  *  - add tables for more bands (15 and 32 would be cool), maybe with auto coeffs
  *    computation (not too hard once the Q is found).
  *  - support for external preset
@@ -114,13 +118,14 @@ struct filter_sys_t
     float f_gamp;   /* Global preamp */
     bool b_2eqz;
 
-    /* Filter state */
-    float x[32][2];
-    float y[32][128][2];
+    /* Filter state, with the channels innermost so that consecutive
+     * channels of an interleaved frame are filtered together */
+    float x[2][32];
+    float y[EQZ_BANDS_MAX][2][32];
 
     /* Second filter state */
-    float x2[32][2];
-    float y2[32][128][2];
+    float x2[2][32];
+    float y2[EQZ_BANDS_MAX][2][32];
 
     vlc_mutex_t lock;
 };
@@ -280,7 +285,7 @@ static int EqzInit( filter_t *p_filter, int i_rate )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
     eqz_config_t cfg;
-    int i, ch;
+    int i;
     vlc_value_t val1, val2, val3;
     vlc_object_t *p_aout = p_filter->p_parent;
     int i_ret = VLC_ENOMEM;
@@ -316,21 +321,10 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     }
 
     /* Filter state */
-    for( ch = 0; ch < 32; ch++ )
-    {
-        p_sys->x[ch][0]  =
-        p_sys->x[ch][1]  =
-        p_sys->x2[ch][0] =
-        p_sys->x2[ch][1] = 0.0f;
-
-        for( i = 0; i < p_sys->i_band; i++ )
-        {
-            p_sys->y[ch][i][0]  =
-            p_sys->y[ch][i][1]  =
-            p_sys->y2[ch][i][0] =
-            p_sys->y2[ch][i][1] = 0.0f;
-        }
-    }
+    memset( p_sys->x, 0, sizeof(p_sys->x) );
+    memset( p_sys->y, 0, sizeof(p_sys->y) );
+    memset( p_sys->x2, 0, sizeof(p_sys->x2) );
+    memset( p_sys->y2, 0, sizeof(p_sys->y2) );
 
     var_Create( p_aout, "equalizer-bands", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
     var_Create( p_aout, "equalizer-preset", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
@@ -385,13 +379,11 @@ error:
     return i_ret;
 }
 
-static void EqzFilter( filter_t *p_filter, float *out, float *in,
-                       int i_samples, int i_channels )
+static void EqzFilterC( filter_sys_t *p_sys, float *out, const float *in,
+                        int i_samples, int i_channels )
 {
-    filter_sys_t *p_sys = p_filter->p_sys;
     int i, ch, j;
 
-    vlc_mutex_lock( &p_sys->lock );
     for( i = 0; i < i_samples; i++ )
     {
         for( ch = 0; ch < i_channels; ch++ )
@@ -401,17 +393,17 @@ static void EqzFilter( filter_t *p_filter, float *out, float *in,
 
             for( j = 0; j < p_sys->i_band; j++ )
             {
-                float y = p_sys->f_alpha[j] * ( x - p_sys->x[ch][1] ) +
-                          p_sys->f_gamma[j] * p_sys->y[ch][j][0] -
-                          p_sys->f_beta[j]  * p_sys->y[ch][j][1];
+                float y = p_sys->f_alpha[j] * ( x - p_sys->x[1][ch] ) +
+                          p_sys->f_gamma[j] * p_sys->y[j][0][ch] -
+                          p_sys->f_beta[j]  * p_sys->y[j][1][ch];
 
-                p_sys->y[ch][j][1] = p_sys->y[ch][j][0];
-                p_sys->y[ch][j][0] = y;
+                p_sys->y[j][1][ch] = p_sys->y[j][0][ch];
+                p_sys->y[j][0][ch] = y;
 
                 o += y * p_sys->f_amp[j];
             }
-            p_sys->x[ch][1] = p_sys->x[ch][0];
-            p_sys->x[ch][0] = x;
+            p_sys->x[1][ch] = p_sys->x[0][ch];
+            p_sys->x[0][ch] = x;
 
             /* Second filter */
             if( p_sys->b_2eqz )
@@ -420,17 +412,17 @@ static void EqzFilter( filter_t *p_filter, float *out, float *in,
                 o = 0.0f;
                 for( j = 0; j < p_sys->i_band; j++ )
                 {
-                    float y = p_sys->f_alpha[j] * ( x2 - p_sys->x2[ch][1] ) +
-                              p_sys->f_gamma[j] * p_sys->y2[ch][j][0] -
-                              p_sys->f_beta[j]  * p_sys->y2[ch][j][1];
+                    float y = p_sys->f_alpha[j] * ( x2 - p_sys->x2[1][ch] ) +
+                              p_sys->f_gamma[j] * p_sys->y2[j][0][ch] -
+                              p_sys->f_beta[j]  * p_sys->y2[j][1][ch];
 
-                    p_sys->y2[ch][j][1] = p_sys->y2[ch][j][0];
-                    p_sys->y2[ch][j][0] = y;
+                    p_sys->y2[j][1][ch] = p_sys->y2[j][0][ch];
+                    p_sys->y2[j][0][ch] = y;
 
                     o += y * p_sys->f_amp[j];
                 }
-                p_sys->x2[ch][1] = p_sys->x2[ch][0];
-                p_sys->x2[ch][0] = x2;
+                p_sys->x2[1][ch] = p_sys->x2[0][ch];
+                p_sys->x2[0][ch] = x2;
 
                 /* We add source PCM + filtered PCM */
                 out[ch] = p_sys->f_gamp * p_sys->f_gamp *( EQZ_IN_FACTOR * x2 + o );
@@ -445,6 +437,124 @@ static void EqzFilter( filter_t *p_filter, float *out, float *in,
         in  += i_channels;
         out += i_channels;
     }
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+/* Runs the band filters of one pass on 4 channels */
+VLC_SSE
+static inline __m128 EqzPassSSE( float y[][2][32], int i_band, int ch,
+                                 __m128 x, __m128 x_2,
+                                 const __m128 *alpha, const __m128 *beta,
+                                 const __m128 *gamma, const __m128 *amp )
+{
+    const __m128 dx = _mm_sub_ps( x, x_2 );
+    __m128 o = _mm_setzero_ps();
+
+    for( int j = 0; j < i_band; j++ )
+    {
+        __m128 y_1 = _mm_loadu_ps( &y[j][0][ch] );
+        __m128 y_2 = _mm_loadu_ps( &y[j][1][ch] );
+        __m128 v = _mm_sub_ps( _mm_add_ps( _mm_mul_ps( alpha[j], dx ),
+                                           _mm_mul_ps( gamma[j], y_1 ) ),
+                               _mm_mul_ps( beta[j], y_2 ) );
+
+        _mm_storeu_ps( &y[j][1][ch], y_1 );
+        _mm_storeu_ps( &y[j][0][ch], v );
+        o = _mm_add_ps( o, _mm_mul_ps( v, amp[j] ) );
+    }
+    return o;
+}
+
+/* Same as EqzFilterC, with the channels of each frame processed 4 by 4.
+ * The unused lanes of the last group run on silence. */
+VLC_SSE
+static void EqzFilterSSE( filter_sys_t *p_sys, float *out, const float *in,
+                          int i_samples, int i_channels )
+{
+    __m128 alpha[EQZ_BANDS_MAX], beta[EQZ_BANDS_MAX], gamma[EQZ_BANDS_MAX];
+    __m128 amp[EQZ_BANDS_MAX];
+    const __m128 in_factor = _mm_set1_ps( EQZ_IN_FACTOR );
+    const __m128 gamp = _mm_set1_ps( p_sys->b_2eqz
+                                     ? p_sys->f_gamp * p_sys->f_gamp
+                                     : p_sys->f_gamp );
+
+    for( int j = 0; j < p_sys->i_band; j++ )
+    {
+        alpha[j] = _mm_set1_ps( p_sys->f_alpha[j] );
+        beta[j]  = _mm_set1_ps( p_sys->f_beta[j] );
+        gamma[j] = _mm_set1_ps( p_sys->f_gamma[j] );
+        amp[j]   = _mm_set1_ps( p_sys->f_amp[j] );
+    }
+
+    for( int ch = 0; ch < i_channels; ch += 4 )
+    {
+        const int n = __MIN( i_channels - ch, 4 );
+        __m128 x_1 = _mm_loadu_ps( &p_sys->x[0][ch] );
+        __m128 x_2 = _mm_loadu_ps( &p_sys->x[1][ch] );
+        __m128 x2_1 = _mm_loadu_ps( &p_sys->x2[0][ch] );
+        __m128 x2_2 = _mm_loadu_ps( &p_sys->x2[1][ch] );
+
+        for( int i = 0; i < i_samples; i++ )
+        {
+            const float *p_in = in + i * i_channels + ch;
+            float *p_out = out + i * i_channels + ch;
+            float tmp[4] = { 0.f, 0.f, 0.f, 0.f };
+            __m128 x, o;
+
+            if( n == 4 )
+                x = _mm_loadu_ps( p_in );
+            else
+            {
+                memcpy( tmp, p_in, n * sizeof(float) );
+                x = _mm_loadu_ps( tmp );
+            }
+
+            o = EqzPassSSE( p_sys->y, p_sys->i_band, ch, x, x_2,
+                            alpha, beta, gamma, amp );
+            x_2 = x_1;
+            x_1 = x;
+            x = _mm_add_ps( _mm_mul_ps( in_factor, x ), o );
+
+            /* Second filter */
+            if( p_sys->b_2eqz )
+            {
+                o = EqzPassSSE( p_sys->y2, p_sys->i_band, ch, x, x2_2,
+                                alpha, beta, gamma, amp );
+                x2_2 = x2_1;
+                x2_1 = x;
+                x = _mm_add_ps( _mm_mul_ps( in_factor, x ), o );
+            }
+
+            /* We add source PCM + filtered PCM */
+            x = _mm_mul_ps( gamp, x );
+            if( n == 4 )
+                _mm_storeu_ps( p_out, x );
+            else
+            {
+                _mm_storeu_ps( tmp, x );
+                memcpy( p_out, tmp, n * sizeof(float) );
+            }
+        }
+        _mm_storeu_ps( &p_sys->x[0][ch], x_1 );
+        _mm_storeu_ps( &p_sys->x[1][ch], x_2 );
+        _mm_storeu_ps( &p_sys->x2[0][ch], x2_1 );
+        _mm_storeu_ps( &p_sys->x2[1][ch], x2_2 );
+    }
+}
+#endif
+
+static void EqzFilter( filter_t *p_filter, float *out, float *in,
+                       int i_samples, int i_channels )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE() )
+        EqzFilterSSE( p_sys, out, in, i_samples, i_channels );
+    else
+#endif
+        EqzFilterC( p_sys, out, in, i_samples, i_channels );
     vlc_mutex_unlock( &p_sys->lock );
 }
 
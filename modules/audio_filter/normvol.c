@@ -43,6 +43,11 @@
 
 #include <vlc_aout.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <xmmintrin.h>
+#endif
 
 /*****************************************************************************
  * Local prototypes
@@ -52,11 +57,20 @@ static int  Open     ( vlc_object_t * );
 static void Close    ( vlc_object_t * );
 static block_t *DoWork( filter_t *, block_t * );
 
+/* The interleaved samples are processed as a flat array, in runs of
+ * i_period floats: a multiple of both the channel count and the vector
+ * size, so that each lane always sees the same channel. */
+#define NORM_PERIOD_MAX (4 * AOUT_CHAN_MAX)
+
 struct filter_sys_t
 {
     int i_nb;
     float *p_last;
     float f_max;
+
+    unsigned i_period;
+    float pf_sum[NORM_PERIOD_MAX];  /* sigma(value²) per lane */
+    float pf_gain[NORM_PERIOD_MAX]; /* 1/gain per lane */
 };
 
 /*****************************************************************************
@@ -98,6 +112,8 @@ static int Open( vlc_object_t *p_this )
     filter_sys_t *p_sys;
 
     i_channels = aout_FormatNbChannels( &p_filter->fmt_in.audio );
+    if( i_channels == 0 || i_channels > AOUT_CHAN_MAX )
+        return VLC_EGENERIC;
 
     p_sys = p_filter->p_sys = malloc( sizeof( *p_sys ) );
     if( !p_sys )
@@ -107,6 +123,10 @@ static int Open( vlc_object_t *p_this )
 
     if( p_sys->f_max <= 0 ) p_sys->f_max = 0.01;
 
+    p_sys->i_period = i_channels;
+    while( p_sys->i_period % 4 )
+        p_sys->i_period += i_channels;
+
     /* We need to store (nb_buffers+1)*nb_channels floats */
     p_sys->p_last = calloc( i_channels * (p_filter->p_sys->i_nb + 2), sizeof(float) );
     if( !p_sys->p_last )
@@ -122,44 +142,100 @@ static int Open( vlc_object_t *p_this )
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * Power and gain loops
+ *****************************************************************************/
+static void SumSquares( float *pf_sum, const float *p_in, size_t i_count,
+                        unsigned i_period )
+{
+    for( size_t i = 0; i < i_count; i += i_period )
+        for( unsigned j = 0; j < i_period; j++ )
+            pf_sum[j] += p_in[i + j] * p_in[i + j];
+}
+
+static void ApplyGain( float *p_out, const float *pf_gain, size_t i_count,
+                       unsigned i_period )
+{
+    for( size_t i = 0; i < i_count; i += i_period )
+        for( unsigned j = 0; j < i_period; j++ )
+            p_out[i + j] *= pf_gain[j];
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE
+static void SumSquaresSSE( float *pf_sum, const float *p_in, size_t i_count,
+                           unsigned i_period )
+{
+    for( unsigned j = 0; j < i_period; j += 4 )
+    {
+        __m128 sum = _mm_loadu_ps( pf_sum + j );
+
+        for( size_t i = j; i < i_count; i += i_period )
+        {
+            __m128 x = _mm_loadu_ps( p_in + i );
+            sum = _mm_add_ps( sum, _mm_mul_ps( x, x ) );
+        }
+        _mm_storeu_ps( pf_sum + j, sum );
+    }
+}
+
+VLC_SSE
+static void ApplyGainSSE( float *p_out, const float *pf_gain, size_t i_count,
+                          unsigned i_period )
+{
+    for( unsigned j = 0; j < i_period; j += 4 )
+    {
+        const __m128 gain = _mm_loadu_ps( pf_gain + j );
+
+        for( size_t i = j; i < i_count; i += i_period )
+            _mm_storeu_ps( p_out + i,
+                           _mm_mul_ps( _mm_loadu_ps( p_out + i ), gain ) );
+    }
+}
+#endif
+
 /*****************************************************************************
  * DoWork : normalizes and sends a buffer
  *****************************************************************************/
 static block_t *DoWork( filter_t *p_filter, block_t *p_in_buf )
 {
-    float *pf_sum;
-    float *pf_gain;
     float f_average = 0;
     int i, i_chan;
 
-    int i_samples = p_in_buf->i_nb_samples;
     int i_channels = aout_FormatNbChannels( &p_filter->fmt_in.audio );
-    float *p_out = (float*)p_in_buf->p_buffer;
-    float *p_in =  (float*)p_in_buf->p_buffer;
+    float *p_buf = (float*)p_in_buf->p_buffer;
+    const size_t i_count = (size_t)p_in_buf->i_nb_samples * i_channels;
 
     struct filter_sys_t *p_sys = p_filter->p_sys;
-
-    pf_sum = calloc( i_channels, sizeof(float) );
-    if( !pf_sum )
-        goto out;
-
-    pf_gain = malloc( sizeof(float) * i_channels );
-    if( !pf_gain )
+    const unsigned i_period = p_sys->i_period;
+    /* The whole periods go to the vector loops, the rest to the C loops */
+    const size_t i_main = i_count - i_count % i_period;
+    float pf_sum[AOUT_CHAN_MAX];
+
+    void (*pf_sum_squares)( float *, const float *, size_t, unsigned ) =
+        SumSquares;
+    void (*pf_apply_gain)( float *, const float *, size_t, unsigned ) =
+        ApplyGain;
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE() )
     {
-        free( pf_sum );
-        goto out;
+        pf_sum_squares = SumSquaresSSE;
+        pf_apply_gain = ApplyGainSSE;
     }
+#endif
 
     /* Calculate the average power level on this buffer */
-    for( i = 0 ; i < i_samples; i++ )
-    {
-        for( i_chan = 0; i_chan < i_channels; i_chan++ )
-        {
-            float f_sample = p_in[i_chan];
-            pf_sum[i_chan] += f_sample * f_sample;
-        }
-        p_in += i_channels;
-    }
+    memset( p_sys->pf_sum, 0, sizeof( p_sys->pf_sum ) );
+    pf_sum_squares( p_sys->pf_sum, p_buf, i_main, i_period );
+    SumSquares( p_sys->pf_sum, p_buf + i_main, i_count - i_main, i_channels );
+
+    for( i_chan = 0; i_chan < i_channels; i_chan++ )
+        pf_sum[i_chan] = 0.f;
+    for( unsigned j = 0; j < i_period; j++ )
+        pf_sum[j % i_channels] += p_sys->pf_sum[j];
+
+    /* Seuil arbitraire */
+    p_sys->f_max = var_GetFloat( p_filter->p_parent, "norm-max-level" );
 
     /* sum now contains for each channel the sigma(value²) */
     for( i_chan = 0; i_chan < i_channels; i_chan++ )
@@ -173,8 +249,6 @@ static block_t *DoWork( filter_t *p_filter, block_t *p_in_buf )
         p_sys->p_last[ i_chan * p_sys->i_nb + p_sys->i_nb - 1] =
                 sqrt( pf_sum[i_chan] );
 
-        pf_sum[i_chan] = 0;
-
         /* Get the average power on the lastbuff */
         f_average = 0;
         for( i = 0; i < p_sys->i_nb ; i++)
@@ -183,37 +257,24 @@ static block_t *DoWork( filter_t *p_filter, block_t *p_in_buf )
         }
         f_average = f_average / p_sys->i_nb;
 
-        /* Seuil arbitraire */
-        p_sys->f_max = var_GetFloat( p_filter->p_parent, "norm-max-level" );
-
         //fprintf(stderr,"Average %f, max %f\n", f_average, p_sys->f_max );
         if( f_average > p_sys->f_max )
         {
-             pf_gain[i_chan] = f_average / p_sys->f_max;
+             p_sys->pf_gain[i_chan] = p_sys->f_max / f_average;
         }
         else
         {
-           pf_gain[i_chan] = 1;
+             p_sys->pf_gain[i_chan] = 1;
         }
     }
+    for( unsigned j = i_channels; j < i_period; j++ )
+        p_sys->pf_gain[j] = p_sys->pf_gain[j % i_channels];
 
     /* Apply gain */
-    for( i = 0; i < i_samples; i++)
-    {
-        for( i_chan = 0; i_chan < i_channels; i_chan++ )
-        {
-            p_out[i_chan] /= pf_gain[i_chan];
-        }
-        p_out += i_channels;
-    }
-
-    free( pf_sum );
-    free( pf_gain );
+    pf_apply_gain( p_buf, p_sys->pf_gain, i_main, i_period );
+    ApplyGain( p_buf + i_main, p_sys->pf_gain, i_count - i_main, i_channels );
 
     return p_in_buf;
-out:
-    block_Release( p_in_buf );
-    return NULL;
 }
 
 /**********************************************************************
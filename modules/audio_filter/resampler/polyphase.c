@@ -0,0 +1,456 @@
+/*****************************************************************************
+ * polyphase.c : polyphase FIR audio resampler
+ *****************************************************************************
+ * Copyright (C) 2014 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble:
+ *
+ * The Kaiser-windowed sinc low-pass filter is tabulated for a fixed number
+ * of phases (sub-sample offsets). The coefficients for the exact offset of
+ * each output sample are linearly interpolated between the two closest
+ * phases, so that the ratio can change on every block (clock drift
+ * compensation) without rebuilding anything.
+ *
+ * The signal history is kept planar, one buffer per channel, so that the
+ * inner product runs over contiguous samples.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_block.h>
+#include <vlc_cpu.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <xmmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define CAN_COMPILE_NEON_INTRINSICS 1
+#endif
+
+#define QUALITY_TEXT N_("Resampling quality")
+#define QUALITY_LONGTEXT N_( \
+    "The low latency preset uses a short filter, delaying the signal by " \
+    "8 samples only, at the cost of a wider transition band.")
+
+static const int quality_values[] = { 0, 1, 2 };
+static const char *const quality_texts[] = {
+    N_("Low latency"), N_("Normal"), N_("High") };
+
+static int  Open ( vlc_object_t * );
+static int  OpenResampler( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+vlc_module_begin ()
+    set_shortname( N_("Polyphase resampler") )
+    set_description( N_("Polyphase FIR audio resampler") )
+    set_category( CAT_AUDIO )
+    set_subcategory( SUBCAT_AUDIO_MISC )
+    add_integer( "polyphase-resampler-quality", 1,
+                 QUALITY_TEXT, QUALITY_LONGTEXT, true )
+        change_integer_list( quality_values, quality_texts )
+    set_capability( "audio converter", 30 )
+    set_callbacks( Open, Close )
+
+    add_submodule ()
+    set_capability( "audio resampler", 30 )
+    set_callbacks( OpenResampler, Close )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local structures
+ *****************************************************************************/
+#define PHASES 256
+
+static const struct
+{
+    unsigned taps;
+    float    cutoff; /* relative to the lowest Nyquist frequency */
+    float    beta;   /* Kaiser window shape */
+} presets[] = {
+    { 16, .80f, 6.f },
+    { 32, .90f, 8.f },
+    { 64, .95f, 9.f },
+};
+
+typedef float (*dot_fn)( const float *, const float *, unsigned );
+typedef void (*interp_fn)( float *, const float *, const float *, float,
+                           unsigned );
+
+struct filter_sys_t
+{
+    unsigned taps;
+    unsigned channels;
+    float *table;       /* (PHASES + 1) rows of taps coefficients */
+    float *coefs;       /* coefficients of the current output sample */
+
+    float *history;     /* channels planes of i_size samples */
+    size_t i_size;
+    size_t i_length;    /* valid samples in each plane */
+    double d_pos;       /* position of the next output in the planes */
+
+    dot_fn    dot;
+    interp_fn interp;
+};
+
+/*****************************************************************************
+ * Inner loops
+ *****************************************************************************/
+static float Dot( const float *x, const float *h, unsigned n )
+{
+    float a0 = 0.f, a1 = 0.f, a2 = 0.f, a3 = 0.f;
+
+    for( unsigned i = 0; i < n; i += 4 )
+    {
+        a0 += x[i] * h[i];
+        a1 += x[i + 1] * h[i + 1];
+        a2 += x[i + 2] * h[i + 2];
+        a3 += x[i + 3] * h[i + 3];
+    }
+    return (a0 + a1) + (a2 + a3);
+}
+
+static void Interp( float *h, const float *a, const float *b, float f,
+                    unsigned n )
+{
+    for( unsigned i = 0; i < n; i++ )
+        h[i] = a[i] + f * (b[i] - a[i]);
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE
+static float DotSSE( const float *x, const float *h, unsigned n )
+{
+    __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps();
+
+    for( unsigned i = 0; i < n; i += 8 )
+    {
+        a0 = _mm_add_ps( a0, _mm_mul_ps( _mm_loadu_ps( x + i ),
+                                         _mm_load_ps( h + i ) ) );
+        a1 = _mm_add_ps( a1, _mm_mul_ps( _mm_loadu_ps( x + i + 4 ),
+                                         _mm_load_ps( h + i + 4 ) ) );
+    }
+    a0 = _mm_add_ps( a0, a1 );
+    a0 = _mm_add_ps( a0, _mm_movehl_ps( a0, a0 ) );
+    a0 = _mm_add_ss( a0, _mm_shuffle_ps( a0, a0, 1 ) );
+    return _mm_cvtss_f32( a0 );
+}
+
+VLC_SSE
+static void InterpSSE( float *h, const float *a, const float *b, float f,
+                       unsigned n )
+{
+    const __m128 vf = _mm_set1_ps( f );
+
+    for( unsigned i = 0; i < n; i += 4 )
+    {
+        __m128 va = _mm_load_ps( a + i );
+        __m128 vb = _mm_load_ps( b + i );
+        _mm_store_ps( h + i,
+                      _mm_add_ps( va, _mm_mul_ps( vf, _mm_sub_ps( vb, va ) ) ) );
+    }
+}
+#endif
+
+#ifdef CAN_COMPILE_NEON_INTRINSICS
+static float DotNEON( const float *x, const float *h, unsigned n )
+{
+    float32x4_t a0 = vdupq_n_f32( 0.f ), a1 = vdupq_n_f32( 0.f );
+
+    for( unsigned i = 0; i < n; i += 8 )
+    {
+        a0 = vmlaq_f32( a0, vld1q_f32( x + i ), vld1q_f32( h + i ) );
+        a1 = vmlaq_f32( a1, vld1q_f32( x + i + 4 ), vld1q_f32( h + i + 4 ) );
+    }
+    a0 = vaddq_f32( a0, a1 );
+    float32x2_t s = vadd_f32( vget_low_f32( a0 ), vget_high_f32( a0 ) );
+    return vget_lane_f32( vpadd_f32( s, s ), 0 );
+}
+
+static void InterpNEON( float *h, const float *a, const float *b, float f,
+                        unsigned n )
+{
+    for( unsigned i = 0; i < n; i += 4 )
+    {
+        float32x4_t va = vld1q_f32( a + i );
+        float32x4_t vb = vld1q_f32( b + i );
+        vst1q_f32( h + i, vmlaq_n_f32( va, vsubq_f32( vb, va ), f ) );
+    }
+}
+#endif
+
+/*****************************************************************************
+ * Filter design
+ *****************************************************************************/
+/* Modified Bessel function of the first kind, order 0 */
+static double BesselI0( double x )
+{
+    double sum = 1., term = 1.;
+
+    for( unsigned k = 1; k < 32; k++ )
+    {
+        term *= (x / (2. * k)) * (x / (2. * k));
+        sum += term;
+        if( term < sum * 1e-12 )
+            break;
+    }
+    return sum;
+}
+
+static void BuildTable( float *table, unsigned taps, double cutoff,
+                        double beta )
+{
+    const double half = taps / 2;
+    const double norm = BesselI0( beta );
+
+    for( unsigned p = 0; p <= PHASES; p++ )
+    {
+        float *row = table + p * taps;
+        double sum = 0.;
+
+        for( unsigned k = 0; k < taps; k++ )
+        {
+            /* distance of tap k to the output sample, in input samples */
+            double t = (double)k - (half - 1.) - (double)p / PHASES;
+            double x = t / half;
+            double w = (fabs( x ) >= 1.) ? 0.
+                     : BesselI0( beta * sqrt( 1. - x * x ) ) / norm;
+            double s = (t == 0.) ? cutoff
+                     : sin( M_PI * cutoff * t ) / (M_PI * t);
+
+            row[k] = s * w;
+            sum += row[k];
+        }
+        /* unity gain at DC for every phase */
+        for( unsigned k = 0; k < taps; k++ )
+            row[k] /= sum;
+    }
+}
+
+/*****************************************************************************
+ * Processing
+ *****************************************************************************/
+static void Reset( filter_sys_t *p_sys )
+{
+    /* start with the first input sample at the center of the filter */
+    p_sys->i_length = p_sys->taps / 2 - 1;
+    memset( p_sys->history, 0,
+            p_sys->channels * p_sys->i_size * sizeof (float) );
+    p_sys->d_pos = p_sys->i_length;
+}
+
+static bool Reserve( filter_sys_t *p_sys, size_t i_samples )
+{
+    if( p_sys->i_length + i_samples <= p_sys->i_size )
+        return true;
+
+    size_t i_size = p_sys->i_length + i_samples;
+    float *p_hist = malloc( p_sys->channels * i_size * sizeof (float) );
+    if( unlikely(p_hist == NULL) )
+        return false;
+
+    for( unsigned c = 0; c < p_sys->channels; c++ )
+        memcpy( p_hist + c * i_size, p_sys->history + c * p_sys->i_size,
+                p_sys->i_length * sizeof (float) );
+    free( p_sys->history );
+    p_sys->history = p_hist;
+    p_sys->i_size = i_size;
+    return true;
+}
+
+static block_t *Resample( filter_t *p_filter, block_t *p_in )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned channels = p_sys->channels;
+    const unsigned taps = p_sys->taps;
+
+    if( p_in->i_flags & BLOCK_FLAG_DISCONTINUITY )
+        Reset( p_sys );
+
+    if( !Reserve( p_sys, p_in->i_nb_samples ) )
+    {
+        block_Release( p_in );
+        return NULL;
+    }
+
+    /* Deinterleave the input after the history */
+    const float *p_src = (const float *)p_in->p_buffer;
+    for( unsigned i = 0; i < p_in->i_nb_samples; i++ )
+        for( unsigned c = 0; c < channels; c++ )
+            p_sys->history[c * p_sys->i_size + p_sys->i_length + i] =
+                *(p_src++);
+    p_sys->i_length += p_in->i_nb_samples;
+
+    /* The input rate is adjusted on the fly for drift compensation */
+    const double d_step = (double)p_filter->fmt_in.audio.i_rate
+                        / (double)p_filter->fmt_out.audio.i_rate;
+    /* The last usable center sample leaves taps/2 samples after it */
+    const double d_end = (double)(p_sys->i_length - taps / 2);
+    size_t i_out = 0;
+    if( p_sys->d_pos < d_end )
+        i_out = (size_t)ceil( (d_end - p_sys->d_pos) / d_step ) + 1;
+
+    block_t *p_out = block_Alloc( i_out * p_filter->fmt_out.audio.i_bytes_per_frame );
+    if( unlikely(p_out == NULL) )
+    {
+        block_Release( p_in );
+        return NULL;
+    }
+
+    float *p_dst = (float *)p_out->p_buffer;
+    double d_pos = p_sys->d_pos;
+    size_t n = 0;
+
+    while( n < i_out && d_pos < d_end )
+    {
+        size_t i_center = (size_t)d_pos;
+        double d_phase = (d_pos - i_center) * PHASES;
+        unsigned i_phase = (unsigned)d_phase;
+        const float *h = p_sys->table + i_phase * taps;
+
+        p_sys->interp( p_sys->coefs, h, h + taps,
+                       (float)(d_phase - i_phase), taps );
+
+        const float *x = p_sys->history + i_center - (taps / 2 - 1);
+        for( unsigned c = 0; c < channels; c++ )
+            *(p_dst++) = p_sys->dot( x + c * p_sys->i_size,
+                                     p_sys->coefs, taps );
+        n++;
+        d_pos += d_step;
+    }
+
+    /* Drop the samples that the next output will not need */
+    size_t i_drop = __MIN( (size_t)d_pos, p_sys->i_length ) - (taps / 2 - 1);
+    for( unsigned c = 0; c < channels; c++ )
+    {
+        float *p_plane = p_sys->history + c * p_sys->i_size;
+        memmove( p_plane, p_plane + i_drop,
+                 (p_sys->i_length - i_drop) * sizeof (float) );
+    }
+    p_sys->i_length -= i_drop;
+    p_sys->d_pos = d_pos - i_drop;
+
+    p_out->i_buffer = n * p_filter->fmt_out.audio.i_bytes_per_frame;
+    p_out->i_nb_samples = n;
+    p_out->i_pts = p_in->i_pts;
+    p_out->i_length = n * CLOCK_FREQ / p_filter->fmt_out.audio.i_rate;
+    p_out->i_flags = p_in->i_flags;
+    block_Release( p_in );
+    return p_out;
+}
+
+/*****************************************************************************
+ * Open/Close
+ *****************************************************************************/
+static int OpenResampler( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    if( p_filter->fmt_in.audio.i_format != VLC_CODEC_FL32
+     || p_filter->fmt_out.audio.i_format != VLC_CODEC_FL32
+     || p_filter->fmt_in.audio.i_physical_channels
+            != p_filter->fmt_out.audio.i_physical_channels
+     || p_filter->fmt_in.audio.i_original_channels
+            != p_filter->fmt_out.audio.i_original_channels )
+        return VLC_EGENERIC;
+
+    unsigned q = var_InheritInteger( p_this, "polyphase-resampler-quality" );
+    if( q >= ARRAY_SIZE(presets) )
+        q = 1;
+
+    filter_sys_t *p_sys = malloc( sizeof (*p_sys) );
+    if( unlikely(p_sys == NULL) )
+        return VLC_ENOMEM;
+
+    const unsigned taps = presets[q].taps;
+    p_sys->taps = taps;
+    p_sys->channels = aout_FormatNbChannels( &p_filter->fmt_in.audio );
+    p_sys->table = vlc_memalign( 16, (PHASES + 1) * taps * sizeof (float) );
+    p_sys->coefs = vlc_memalign( 16, taps * sizeof (float) );
+    p_sys->i_size = 4096;
+    p_sys->history = malloc( p_sys->channels * p_sys->i_size
+                             * sizeof (float) );
+    if( unlikely(p_sys->table == NULL || p_sys->coefs == NULL
+              || p_sys->history == NULL) )
+    {
+        vlc_free( p_sys->table );
+        vlc_free( p_sys->coefs );
+        free( p_sys->history );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
+    /* The cut-off follows the nominal rates: drift compensation only moves
+     * the ratio by a fraction of a percent. */
+    double ratio = (double)p_filter->fmt_out.audio.i_rate
+                 / (double)p_filter->fmt_in.audio.i_rate;
+    BuildTable( p_sys->table, taps, presets[q].cutoff * __MIN(ratio, 1.),
+                presets[q].beta );
+    Reset( p_sys );
+
+    p_sys->dot = Dot;
+    p_sys->interp = Interp;
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE() )
+    {
+        p_sys->dot = DotSSE;
+        p_sys->interp = InterpSSE;
+    }
+#endif
+#ifdef CAN_COMPILE_NEON_INTRINSICS
+    p_sys->dot = DotNEON;
+    p_sys->interp = InterpNEON;
+#endif
+
+    p_filter->p_sys = p_sys;
+    p_filter->pf_audio_filter = Resample;
+    msg_Dbg( p_filter, "%u taps, %u phases, %u Hz -> %u Hz", taps, PHASES,
+             p_filter->fmt_in.audio.i_rate, p_filter->fmt_out.audio.i_rate );
+    return VLC_SUCCESS;
+}
+
+static int Open( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    /* Will change rate */
+    if( p_filter->fmt_in.audio.i_rate == p_filter->fmt_out.audio.i_rate )
+        return VLC_EGENERIC;
+    return OpenResampler( p_this );
+}
+
+static void Close( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    vlc_free( p_sys->table );
+    vlc_free( p_sys->coefs );
+    free( p_sys->history );
+    free( p_sys );
+}
@@ -32,10 +32,19 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
 
 #include <string.h> /* for memset */
 #include <limits.h> /* form INT_MIN */
 
+#ifdef HAVE_SSE2_INTRINSICS
+# include <xmmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define CAN_COMPILE_NEON_INTRINSICS 1
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -43,6 +52,18 @@ static int  Open( vlc_object_t * );
 static void Close( vlc_object_t * );
 static block_t *DoWork( filter_t *, block_t * );
 
+#define QUALITY_TEXT N_("Search quality")
+#define QUALITY_LONGTEXT N_( \
+    "The faster presets look for the best overlap position on a coarse " \
+    "grid first, then only around the best match, with fewer correlations.")
+
+static const int quality_values[] = { 0, 1, 2 };
+static const char *const quality_texts[] = {
+    N_("Fast"), N_("Normal"), N_("High") };
+
+/* frames between the positions of the coarse search, per quality preset */
+static const unsigned search_steps[] = { 8, 4, 1 };
+
 vlc_module_begin ()
     set_description( N_("Audio tempo scaler synched with rate") )
     set_shortname( N_("Scaletempo") )
@@ -56,6 +77,8 @@ vlc_module_begin ()
         N_("Overlap Length"), N_("Percentage of stride to overlap"), true )
     add_integer_with_range( "scaletempo-search", 14, 0, 200,
         N_("Search Length"), N_("Length in milliseconds to search for best overlap position"), true )
+    add_integer( "scaletempo-quality", 2, QUALITY_TEXT, QUALITY_LONGTEXT, true )
+        change_integer_list( quality_values, quality_texts )
 
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -76,6 +99,10 @@ vlc_module_end ()
  * frame: a single set of samples, one for each channel
  * VLC uses these terms differently
  */
+typedef float (*dot_fn)( const float *, const float *, unsigned );
+typedef void (*blend_fn)( float *, const float *, const float *,
+                          const float *, unsigned );
+
 struct filter_sys_t
 {
     /* Filter static config */
@@ -84,6 +111,7 @@ struct filter_sys_t
     unsigned  ms_stride;
     double    percent_overlap;
     unsigned  ms_search;
+    unsigned  frames_search_step;
     /* audio format */
     unsigned  samples_per_frame;  /* AKA number of channels */
     unsigned  bytes_per_sample;
@@ -111,8 +139,98 @@ struct filter_sys_t
     void     *buf_pre_corr;
     void     *table_window;
     unsigned(*best_overlap_offset)( filter_t *p_filter );
+    /* kernels */
+    dot_fn    dot;
+    blend_fn  blend;
 };
 
+/*****************************************************************************
+ * Inner loops
+ *****************************************************************************/
+static float dot( const float *a, const float *b, unsigned n )
+{
+    float corr = 0;
+    for( unsigned i = 0; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+
+/* out = o - blend * ( o - in ) */
+static void blend( float *out, const float *o, const float *pb,
+                   const float *in, unsigned n )
+{
+    for( unsigned i = 0; i < n; i++ )
+        out[i] = o[i] - pb[i] * ( o[i] - in[i] );
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE
+static float dot_sse( const float *a, const float *b, unsigned n )
+{
+    __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps();
+    unsigned i = 0;
+
+    for( ; i + 8 <= n; i += 8 )
+    {
+        a0 = _mm_add_ps( a0, _mm_mul_ps( _mm_loadu_ps( a + i ),
+                                         _mm_loadu_ps( b + i ) ) );
+        a1 = _mm_add_ps( a1, _mm_mul_ps( _mm_loadu_ps( a + i + 4 ),
+                                         _mm_loadu_ps( b + i + 4 ) ) );
+    }
+    a0 = _mm_add_ps( a0, a1 );
+    a0 = _mm_add_ps( a0, _mm_movehl_ps( a0, a0 ) );
+    a0 = _mm_add_ss( a0, _mm_shuffle_ps( a0, a0, 1 ) );
+    return _mm_cvtss_f32( a0 ) + dot( a + i, b + i, n - i );
+}
+
+VLC_SSE
+static void blend_sse( float *out, const float *o, const float *pb,
+                       const float *in, unsigned n )
+{
+    unsigned i = 0;
+
+    for( ; i + 4 <= n; i += 4 )
+    {
+        __m128 vo = _mm_loadu_ps( o + i );
+        __m128 vd = _mm_sub_ps( vo, _mm_loadu_ps( in + i ) );
+        _mm_storeu_ps( out + i,
+                       _mm_sub_ps( vo, _mm_mul_ps( _mm_loadu_ps( pb + i ), vd ) ) );
+    }
+    blend( out + i, o + i, pb + i, in + i, n - i );
+}
+#endif
+
+#ifdef CAN_COMPILE_NEON_INTRINSICS
+static float dot_neon( const float *a, const float *b, unsigned n )
+{
+    float32x4_t a0 = vdupq_n_f32( 0.f ), a1 = vdupq_n_f32( 0.f );
+    unsigned i = 0;
+
+    for( ; i + 8 <= n; i += 8 )
+    {
+        a0 = vmlaq_f32( a0, vld1q_f32( a + i ), vld1q_f32( b + i ) );
+        a1 = vmlaq_f32( a1, vld1q_f32( a + i + 4 ), vld1q_f32( b + i + 4 ) );
+    }
+    a0 = vaddq_f32( a0, a1 );
+    float32x2_t s = vadd_f32( vget_low_f32( a0 ), vget_high_f32( a0 ) );
+    return vget_lane_f32( vpadd_f32( s, s ), 0 ) + dot( a + i, b + i, n - i );
+}
+
+static void blend_neon( float *out, const float *o, const float *pb,
+                        const float *in, unsigned n )
+{
+    unsigned i = 0;
+
+    for( ; i + 4 <= n; i += 4 )
+    {
+        float32x4_t vo = vld1q_f32( o + i );
+        float32x4_t vd = vsubq_f32( vo, vld1q_f32( in + i ) );
+        vst1q_f32( out + i, vmlsq_f32( vo, vld1q_f32( pb + i ), vd ) );
+    }
+    blend( out + i, o + i, pb + i, in + i, n - i );
+}
+#endif
+
 /*****************************************************************************
  * best_overlap_offset: calculate best offset for overlap
  *****************************************************************************/
@@ -123,6 +241,8 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
     float best_corr = INT_MIN;
     unsigned best_off = 0;
     unsigned i, off;
+    const unsigned samples = p->samples_overlap - p->samples_per_frame;
+    const unsigned step = p->frames_search_step;
 
     pw  = p->table_window;
     po  = p->buf_overlap;
@@ -132,19 +252,32 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
       *ppc++ = *pw++ * *po++;
     }
 
+    /* Coarse search over the whole window, then fine search around the
+     * best coarse position (the whole window at the highest quality) */
     search_start = (float *)p->buf_queue + p->samples_per_frame;
-    for( off = 0; off < p->frames_search; off++ ) {
-      float corr = 0;
-      float *ps = search_start;
-      ppc = p->buf_pre_corr;
-      for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-        corr += *ppc++ * *ps++;
-      }
+    for( off = 0; off < p->frames_search; off += step ) {
+      float corr = p->dot( p->buf_pre_corr,
+                           search_start + off * p->samples_per_frame, samples );
       if( corr > best_corr ) {
         best_corr = corr;
         best_off  = off;
       }
-      search_start += p->samples_per_frame;
+    }
+
+    if( step > 1 ) {
+      unsigned coarse_off = best_off;
+      unsigned end = __MIN( coarse_off + step, p->frames_search );
+      off = coarse_off >= step ? coarse_off - step + 1 : 0;
+      for( ; off < end; off++ ) {
+        if( off == coarse_off )
+          continue;
+        float corr = p->dot( p->buf_pre_corr,
+                             search_start + off * p->samples_per_frame, samples );
+        if( corr > best_corr ) {
+          best_corr = corr;
+          best_off  = off;
+        }
+      }
     }
 
     return best_off * p->bytes_per_frame;
@@ -162,10 +295,7 @@ static void output_overlap_float( filter_t        *p_filter,
     float *pb   = p->table_blend;
     float *po   = p->buf_overlap;
     float *pin  = (float *)( p->buf_queue + bytes_off );
-    unsigned i;
-    for( i = 0; i < p->samples_overlap; i++ ) {
-        *pout++ = *po - *pb++ * ( *po - *pin++ ); po++;
-    }
+    p->blend( pout, po, pb, pin, p->samples_overlap );
 }
 
 /*****************************************************************************
@@ -407,9 +537,26 @@ static int Open( vlc_object_t *p_this )
     p_sys->ms_stride       = var_InheritInteger( p_this, "scaletempo-stride" );
     p_sys->percent_overlap = var_InheritFloat( p_this, "scaletempo-overlap" );
     p_sys->ms_search       = var_InheritInteger( p_this, "scaletempo-search" );
+    unsigned quality = var_InheritInteger( p_this, "scaletempo-quality" );
+    p_sys->frames_search_step = search_steps[__MIN(quality, 2)];
+
+    msg_Dbg( p_this, "params: %i stride, %.3f overlap, %i search, %u step",
+             p_sys->ms_stride, p_sys->percent_overlap, p_sys->ms_search,
+             p_sys->frames_search_step );
 
-    msg_Dbg( p_this, "params: %i stride, %.3f overlap, %i search",
-             p_sys->ms_stride, p_sys->percent_overlap, p_sys->ms_search );
+    p_sys->dot   = dot;
+    p_sys->blend = blend;
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE() )
+    {
+        p_sys->dot   = dot_sse;
+        p_sys->blend = blend_sse;
+    }
+#endif
+#ifdef CAN_COMPILE_NEON_INTRINSICS
+    p_sys->dot   = dot_neon;
+    p_sys->blend = blend_neon;
+#endif
 
     p_sys->buf_queue      = NULL;
     p_sys->buf_overlap    = NULL;
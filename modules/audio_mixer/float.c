@@ -32,8 +32,15 @@
 #include <stddef.h>
 #include <vlc_common.h>
 #include <vlc_plugin.h>
+#include <vlc_cpu.h>
 #include <vlc_aout.h>
 #include <vlc_aout_volume.h>
+#ifdef HAVE_SSE2_INTRINSICS
+# include <xmmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
 
 /*****************************************************************************
  * Local prototypes
@@ -67,6 +74,68 @@ static void FilterFL32( audio_volume_t *p_volume, block_t *p_buffer,
     (void) p_volume;
 }
 
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE
+static void FilterFL32SSE( audio_volume_t *p_volume, block_t *p_buffer,
+                           float f_multiplier )
+{
+    if( f_multiplier == 1.f )
+        return; /* nothing to do */
+
+    float *p = (float *)p_buffer->p_buffer;
+    size_t i_count = p_buffer->i_buffer / sizeof(*p);
+    const __m128 mult = _mm_set1_ps( f_multiplier );
+
+    for( ; i_count >= 16; i_count -= 16, p += 16 )
+    {
+        __m128 a = _mm_loadu_ps( p );
+        __m128 b = _mm_loadu_ps( p + 4 );
+        __m128 c = _mm_loadu_ps( p + 8 );
+        __m128 d = _mm_loadu_ps( p + 12 );
+        _mm_storeu_ps( p,      _mm_mul_ps( a, mult ) );
+        _mm_storeu_ps( p + 4,  _mm_mul_ps( b, mult ) );
+        _mm_storeu_ps( p + 8,  _mm_mul_ps( c, mult ) );
+        _mm_storeu_ps( p + 12, _mm_mul_ps( d, mult ) );
+    }
+    for( ; i_count > 0; i_count-- )
+        *(p++) *= f_multiplier;
+
+    (void) p_volume;
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static void FilterFL32AVX2( audio_volume_t *p_volume, block_t *p_buffer,
+                            float f_multiplier )
+{
+    if( f_multiplier == 1.f )
+        return; /* nothing to do */
+
+    float *p = (float *)p_buffer->p_buffer;
+    size_t i_count = p_buffer->i_buffer / sizeof(*p);
+    const __m256 mult = _mm256_set1_ps( f_multiplier );
+
+    for( ; i_count >= 32; i_count -= 32, p += 32 )
+    {
+        __m256 a = _mm256_loadu_ps( p );
+        __m256 b = _mm256_loadu_ps( p + 8 );
+        __m256 c = _mm256_loadu_ps( p + 16 );
+        __m256 d = _mm256_loadu_ps( p + 24 );
+        _mm256_storeu_ps( p,      _mm256_mul_ps( a, mult ) );
+        _mm256_storeu_ps( p + 8,  _mm256_mul_ps( b, mult ) );
+        _mm256_storeu_ps( p + 16, _mm256_mul_ps( c, mult ) );
+        _mm256_storeu_ps( p + 24, _mm256_mul_ps( d, mult ) );
+    }
+    for( ; i_count >= 8; i_count -= 8, p += 8 )
+        _mm256_storeu_ps( p, _mm256_mul_ps( _mm256_loadu_ps( p ), mult ) );
+    for( ; i_count > 0; i_count-- )
+        *(p++) *= f_multiplier;
+
+    (void) p_volume;
+}
+#endif
+
 static void FilterFL64( audio_volume_t *p_volume, block_t *p_buffer,
                         float f_multiplier )
 {
@@ -92,6 +161,14 @@ static int Create( vlc_object_t *p_this )
     {
         case VLC_CODEC_FL32:
             p_volume->amplify = FilterFL32;
+#ifdef HAVE_SSE2_INTRINSICS
+            if( vlc_CPU_SSE() )
+                p_volume->amplify = FilterFL32SSE;
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+            if( vlc_CPU_AVX2() )
+                p_volume->amplify = FilterFL32AVX2;
+#endif
             break;
         case VLC_CODEC_FL64:
             p_volume->amplify = FilterFL64;
@@ -48,6 +48,10 @@ struct aout_sys_t
     uint8_t chans_table[AOUT_CHAN_MAX]; /**< Channels order table */
     uint8_t chans_to_reorder; /**< Number of channels to reorder */
 
+    bool mmap; /**< Writing directly to the hardware ring buffer */
+    bool monotonic; /**< Status time stamps are on the mdate() clock */
+    unsigned xruns; /**< Number of buffer underruns */
+
     bool soft_mute;
     float soft_gain;
     char *device;
@@ -64,6 +68,12 @@ static int EnumDevices (vlc_object_t *, char const *, char ***, char ***);
 #define AUDIO_DEV_TEXT N_("Audio output device")
 #define AUDIO_DEV_LONGTEXT N_("Audio output device (using ALSA syntax).")
 
+#define LATENCY_TEXT N_("Low latency buffer (ms)")
+#define LATENCY_LONGTEXT N_( \
+    "Size of the hardware buffer in milliseconds, written to directly " \
+    "(memory mapped) in small periods. " \
+    "0 uses a large buffer with the normal read/write mode.")
+
 #define AUDIO_CHAN_TEXT N_("Audio output channels")
 #define AUDIO_CHAN_LONGTEXT N_("Channels available for audio output. " \
     "If the input has more channels than the output, it will be down-mixed. " \
@@ -88,6 +98,8 @@ vlc_module_begin ()
     add_integer ("alsa-audio-channels", AOUT_CHANS_FRONT,
                  AUDIO_CHAN_TEXT, AUDIO_CHAN_LONGTEXT, false)
         change_integer_list (channels, channels_text)
+    add_integer ("alsa-latency", 0, LATENCY_TEXT, LATENCY_LONGTEXT, true)
+        change_integer_range (0, 1000)
     add_sw_gain ()
     set_capability( "audio output", 150 )
     set_callbacks( Open, Close )
@@ -275,6 +287,7 @@ out:
 
 static int TimeGet (audio_output_t *aout, mtime_t *);
 static void Play (audio_output_t *, block_t *);
+static void PlayMmap (audio_output_t *, block_t *);
 static void Pause (audio_output_t *, bool, mtime_t);
 static void PauseDummy (audio_output_t *, bool, mtime_t);
 static void Flush (audio_output_t *, bool);
@@ -406,8 +419,21 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
         goto error;
     }
 
+    unsigned latency = var_InheritInteger (aout, "alsa-latency");
+
+    sys->mmap = false;
+    if (latency > 0)
+    {
+        if (snd_pcm_hw_params_test_access (pcm, hw,
+                                           SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0)
+            sys->mmap = true;
+        else
+            msg_Warn (aout, "device cannot be memory mapped");
+    }
+
     val = snd_pcm_hw_params_set_access (pcm, hw,
-                                        SND_PCM_ACCESS_RW_INTERLEAVED);
+                                        sys->mmap ? SND_PCM_ACCESS_MMAP_INTERLEAVED
+                                                  : SND_PCM_ACCESS_RW_INTERLEAVED);
     if (val)
     {
         msg_Err (aout, "cannot set access mode: %s", snd_strerror (val));
@@ -487,22 +513,44 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     }
     sys->rate = fmt->i_rate;
 
-#if 1 /* work-around for period-long latency outputs (e.g. PulseAudio): */
-    param = AOUT_MIN_PREPARE_TIME;
-    val = snd_pcm_hw_params_set_period_time_near (pcm, hw, &param, NULL);
-    if (val)
-    {
-        msg_Err (aout, "cannot set period: %s", snd_strerror (val));
-        goto error;
+    if (latency > 0)
+    {   /* Low latency: a few short periods, the buffer first as it matters
+         * most */
+        param = latency * 1000;
+        val = snd_pcm_hw_params_set_buffer_time_near (pcm, hw, &param, NULL);
+        if (val)
+        {
+            msg_Err (aout, "cannot set buffer duration: %s",
+                     snd_strerror (val));
+            goto error;
+        }
+        param /= 4;
+        val = snd_pcm_hw_params_set_period_time_near (pcm, hw, &param, NULL);
+        if (val)
+        {
+            msg_Err (aout, "cannot set period: %s", snd_strerror (val));
+            goto error;
+        }
     }
-#endif
-    /* Set buffer size */
-    param = AOUT_MAX_ADVANCE_TIME;
-    val = snd_pcm_hw_params_set_buffer_time_near (pcm, hw, &param, NULL);
-    if (val)
+    else
     {
-        msg_Err (aout, "cannot set buffer duration: %s", snd_strerror (val));
-        goto error;
+#if 1 /* work-around for period-long latency outputs (e.g. PulseAudio): */
+        param = AOUT_MIN_PREPARE_TIME;
+        val = snd_pcm_hw_params_set_period_time_near (pcm, hw, &param, NULL);
+        if (val)
+        {
+            msg_Err (aout, "cannot set period: %s", snd_strerror (val));
+            goto error;
+        }
+#endif
+        /* Set buffer size */
+        param = AOUT_MAX_ADVANCE_TIME;
+        val = snd_pcm_hw_params_set_buffer_time_near (pcm, hw, &param, NULL);
+        if (val)
+        {
+            msg_Err (aout, "cannot set buffer duration: %s", snd_strerror (val));
+            goto error;
+        }
     }
 #if 0
     val = snd_pcm_hw_params_get_buffer_time (hw, &param, NULL);
@@ -531,6 +579,10 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     }
     Dump (aout, "final HW setup:\n", snd_pcm_hw_params_dump, hw);
 
+    snd_pcm_uframes_t period_size;
+    if (snd_pcm_hw_params_get_period_size (hw, &period_size, NULL))
+        period_size = 1;
+
     /* Get Initial software parameters */
     snd_pcm_sw_params_t *sw;
 
@@ -539,7 +591,8 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     Dump (aout, "initial software parameters:\n", snd_pcm_sw_params_dump, sw);
 
     /* START REVISIT */
-    //snd_pcm_sw_params_set_avail_min( pcm, sw, i_period_size );
+    if (latency > 0)
+        snd_pcm_sw_params_set_avail_min (pcm, sw, period_size);
     // FIXME: useful?
     val = snd_pcm_sw_params_set_start_threshold (pcm, sw, 1);
     if( val < 0 )
@@ -550,6 +603,17 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     }
     /* END REVISIT */
 
+    /* Time stamp the status on the monotonic clock, like mdate(), so that
+     * TimeGet() can account for the time elapsed since */
+    sys->monotonic = false;
+    if (snd_pcm_sw_params_set_tstamp_mode (pcm, sw, SND_PCM_TSTAMP_ENABLE) == 0)
+    {
+#if (SND_LIB_VERSION >= 0x01001D)
+        sys->monotonic = snd_pcm_sw_params_set_tstamp_type (pcm, sw,
+                                        SND_PCM_TSTAMP_TYPE_MONOTONIC) == 0;
+#endif
+    }
+
     /* Commit software parameters. */
     val = snd_pcm_sw_params (pcm, sw);
     if (val)
@@ -575,8 +639,13 @@ static int Start (audio_output_t *aout, audio_sample_format_t *restrict fmt)
     }
     sys->format = fmt->i_format;
 
+    sys->xruns = 0;
+    if (latency > 0)
+        msg_Dbg (aout, "low latency: periods of %lu frames, %s access",
+                 (unsigned long)period_size, sys->mmap ? "mmap" : "read/write");
+
     aout->time_get = TimeGet;
-    aout->play = Play;
+    aout->play = sys->mmap ? PlayMmap : Play;
     if (snd_pcm_hw_params_can_pause (hw))
         aout->pause = Pause;
     else
@@ -598,16 +667,74 @@ static int TimeGet (audio_output_t *aout, mtime_t *restrict delay)
     aout_sys_t *sys = aout->sys;
     snd_pcm_sframes_t frames;
 
-    int val = snd_pcm_delay (sys->pcm, &frames);
+    if (!sys->mmap)
+    {   /* Plugins (e.g. PulseAudio) compute their own delay */
+        int val = snd_pcm_delay (sys->pcm, &frames);
+        if (val)
+        {
+            msg_Err (aout, "cannot estimate delay: %s", snd_strerror (val));
+            return -1;
+        }
+        *delay = frames * CLOCK_FREQ / sys->rate;
+        return 0;
+    }
+
+    snd_pcm_status_t *status;
+
+    snd_pcm_status_alloca (&status);
+    int val = snd_pcm_status (sys->pcm, status);
     if (val)
     {
         msg_Err (aout, "cannot estimate delay: %s", snd_strerror (val));
         return -1;
     }
+
+    frames = snd_pcm_status_get_delay (status);
     *delay = frames * CLOCK_FREQ / sys->rate;
+
+    /* The delay dates back to the last hardware pointer update, which can be
+     * up to a period ago: subtract what has been played since. */
+    if (sys->monotonic
+     && snd_pcm_status_get_state (status) == SND_PCM_STATE_RUNNING)
+    {
+        snd_htimestamp_t ts;
+
+        snd_pcm_status_get_htstamp (status, &ts);
+        mtime_t stamp = ts.tv_sec * CLOCK_FREQ + ts.tv_nsec / 1000;
+        if (stamp != 0)
+        {
+            mtime_t elapsed = mdate () - stamp;
+            if (elapsed > 0)
+                *delay = __MAX(*delay - elapsed, 0);
+        }
+    }
     return 0;
 }
 
+/**
+ * Recovers from an error of the playback stream, counting the underruns.
+ */
+static int Recover (audio_output_t *aout, int err)
+{
+    aout_sys_t *sys = aout->sys;
+
+    if (err == -EPIPE)
+    {
+        sys->xruns++;
+        msg_Warn (aout, "buffer underrun (%u so far)", sys->xruns);
+        var_SetInteger (aout, "alsa-xruns", sys->xruns);
+    }
+
+    int val = snd_pcm_recover (sys->pcm, err, 1);
+    if (val)
+    {
+        msg_Err (aout, "cannot recover playback stream: %s",
+                 snd_strerror (val));
+        DumpDeviceStatus (aout, sys->pcm);
+    }
+    return val;
+}
+
 /**
  * Queues one audio buffer to the hardware.
  */
@@ -639,15 +766,92 @@ static void Play (audio_output_t *aout, block_t *block)
         }
         else  
         {
-            int val = snd_pcm_recover (pcm, frames, 1);
-            if (val)
+            if (Recover (aout, frames))
+                break;
+            msg_Warn (aout, "cannot write samples: %s", snd_strerror (frames));
+        }
+    }
+    block_Release (block);
+}
+
+/**
+ * Copies one audio buffer directly into the hardware ring buffer.
+ */
+static void PlayMmap (audio_output_t *aout, block_t *block)
+{
+    aout_sys_t *sys = aout->sys;
+    snd_pcm_t *pcm = sys->pcm;
+
+    if (sys->chans_to_reorder != 0)
+        aout_ChannelReorder(block->p_buffer, block->i_buffer,
+                           sys->chans_to_reorder, sys->chans_table, sys->format);
+
+    while (block->i_nb_samples > 0)
+    {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update (pcm);
+        if (avail < 0)
+        {
+            if (Recover (aout, avail))
+                break;
+            continue;
+        }
+
+        if (avail == 0)
+        {   /* The ring is full: make sure it is being played, then wait
+             * for the next period */
+            if (snd_pcm_state (pcm) == SND_PCM_STATE_PREPARED)
+                snd_pcm_start (pcm);
+
+            int val = snd_pcm_wait (pcm, 1000);
+            if (val < 0 && Recover (aout, val))
+                break;
+            if (val == 0)
             {
-                msg_Err (aout, "cannot recover playback stream: %s",
-                         snd_strerror (val));
+                msg_Err (aout, "device stalled");
                 DumpDeviceStatus (aout, pcm);
                 break;
             }
-            msg_Warn (aout, "cannot write samples: %s", snd_strerror (frames));
+            continue;
+        }
+
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t frames = __MIN((snd_pcm_uframes_t)avail,
+                                         block->i_nb_samples);
+
+        int val = snd_pcm_mmap_begin (pcm, &areas, &offset, &frames);
+        if (val < 0)
+        {
+            if (Recover (aout, val))
+                break;
+            continue;
+        }
+
+        /* Interleaved access: all channels share the first area */
+        size_t bytes = snd_pcm_frames_to_bytes (pcm, frames);
+        memcpy ((uint8_t *)areas[0].addr
+                    + (areas[0].first + offset * areas[0].step) / 8,
+                block->p_buffer, bytes);
+
+        snd_pcm_sframes_t done = snd_pcm_mmap_commit (pcm, offset, frames);
+        if (done < 0 || (snd_pcm_uframes_t)done != frames)
+        {
+            if (Recover (aout, done >= 0 ? -EPIPE : done))
+                break;
+            continue;
+        }
+
+        block->i_nb_samples -= frames;
+        block->p_buffer += bytes;
+        block->i_buffer -= bytes;
+
+        /* Committing to the ring does not start the device */
+        if (snd_pcm_state (pcm) == SND_PCM_STATE_PREPARED)
+        {
+            val = snd_pcm_start (pcm);
+            if (val < 0)
+                msg_Warn (aout, "cannot start playback: %s",
+                          snd_strerror (val));
         }
     }
     block_Release (block);
@@ -702,6 +906,8 @@ static void Stop (audio_output_t *aout)
 
     snd_pcm_drop (pcm);
     snd_pcm_close (pcm);
+    if (sys->xruns > 0)
+        msg_Dbg (aout, "%u buffer underrun(s)", sys->xruns);
 }
 
 /**
@@ -773,6 +979,8 @@ static int Open(vlc_object_t *obj)
     if (unlikely(sys->device == NULL))
         goto error;
 
+    var_Create (aout, "alsa-xruns", VLC_VAR_INTEGER);
+
     aout->sys = sys;
     aout->start = Start;
     aout->stop = Stop;
@@ -806,6 +1014,7 @@ static void Close(vlc_object_t *obj)
     audio_output_t *aout = (audio_output_t *)obj;
     aout_sys_t *sys = aout->sys;
 
+    var_Destroy (aout, "alsa-xruns");
     free (sys->device);
     free (sys);
 }
@@ -30,6 +30,7 @@
 
 #include <dlfcn.h>
 #include <assert.h>
+#include <time.h>
 
 #define SIZE_OF_AUDIOTRACK 256
 
@@ -38,13 +39,21 @@
 
 enum pcm_sub_format {
     PCM_SUB_16_BIT          = 0x1, // must be 1 for backward compatibility
-    PCM_SUB_8_BIT           = 0x2  // must be 2 for backward compatibility
+    PCM_SUB_8_BIT           = 0x2, // must be 2 for backward compatibility
+    PCM_SUB_FLOAT           = 0x5  // Android 5.0 and later
 };
 
 enum audio_format {
     PCM                 = 0x00000000, // must be 0 for backward compatibility
     PCM_16_BIT          = (PCM|PCM_SUB_16_BIT),
-    PCM_8_BIT           = (PCM|PCM_SUB_8_BIT)
+    PCM_8_BIT           = (PCM|PCM_SUB_8_BIT),
+    PCM_FLOAT           = (PCM|PCM_SUB_FLOAT)
+};
+
+/* From AudioTimestamp.h */
+struct AudioTimestamp {
+    uint32_t mPosition; // frames presented, since the track was started
+    struct timespec mTime; // CLOCK_MONOTONIC time of the presentation
 };
 
 enum audio_channels {
@@ -91,6 +100,8 @@ typedef int (*AudioTrack_write)(void *, void  const*, unsigned int);
 typedef int (*AudioTrack_flush)(void *);
 // _ZN7android10AudioTrack5pauseEv
 typedef int (*AudioTrack_pause)(void *);
+// _ZN7android10AudioTrack12getTimestampERNS_14AudioTimestampE
+typedef int (*AudioTrack_getTimestamp)(void *, struct AudioTimestamp *);
 
 struct aout_sys_t {
     float soft_gain;
@@ -119,6 +130,7 @@ struct aout_sys_t {
     AudioTrack_flush at_flush;
     AudioTrack_pause at_pause;
     AudioTrack_getRenderPosition at_getRenderPosition;
+    AudioTrack_getTimestamp at_getTimestamp;
 };
 
 /* Soft volume helper */
@@ -179,6 +191,9 @@ static void *InitLibrary(struct aout_sys_t *p_sys)
     if (!p_sys->at_getRenderPosition)
         p_sys->at_getRenderPosition = (AudioTrack_getRenderPosition)(dlsym(p_library, "_ZN7android11AudioSystem17getRenderPositionEPjS1_19audio_stream_type_t"));
 
+    /* 4.4 KitKat and later, optional */
+    p_sys->at_getTimestamp = (AudioTrack_getTimestamp)(dlsym(p_library, "_ZN7android10AudioTrack12getTimestampERNS_14AudioTimestampE"));
+
     /* We need the first 3 or the last 1 */
     if (!((p_sys->as_getOutputFrameCount && p_sys->as_getOutputLatency && p_sys->as_getOutputSamplingRate)
         || p_sys->at_getMinFrameCount)) {
@@ -195,11 +210,38 @@ static void *InitLibrary(struct aout_sys_t *p_sys)
     return p_library;
 }
 
+/* Delay from the last frame presented by the mixer and the time it was
+ * presented at, precise to the sample unlike the render position which only
+ * moves once per mixer period */
+static int TimestampGet(audio_output_t *p_aout, mtime_t *restrict delay)
+{
+    aout_sys_t *p_sys = p_aout->sys;
+    struct AudioTimestamp ts;
+
+    if (p_sys->at_getTimestamp(p_sys->AudioTrack, &ts))
+        return -1; /* not started yet */
+
+    mtime_t now = mdate();
+    mtime_t then = CLOCK_FREQ * ts.mTime.tv_sec + ts.mTime.tv_nsec / 1000;
+    int32_t pending = p_sys->samples_written - ts.mPosition;
+    if (pending < 0)
+        return -1;
+
+    *delay = (mtime_t)pending * CLOCK_FREQ / p_sys->rate - (now - then);
+    if (*delay < 0)
+        *delay = 0;
+    return 0;
+}
+
 static int TimeGet(audio_output_t *p_aout, mtime_t *restrict delay)
 {
     aout_sys_t *p_sys = p_aout->sys;
     uint32_t hal, dsp;
 
+    if (delay && p_sys->at_getTimestamp && p_sys->samples_written
+     && !TimestampGet(p_aout, delay))
+        return 0;
+
     if (!p_sys->at_getRenderPosition)
         return -1;
 
@@ -221,6 +263,32 @@ static int TimeGet(audio_output_t *p_aout, mtime_t *restrict delay)
     return 0;
 }
 
+/* Constructs the AudioTrack, returns its initCheck() status */
+static int CreateTrack(aout_sys_t *p_sys, int stream_type, int rate,
+                       int format, int channel, int size)
+{
+    *((uint32_t *) ((uint32_t)p_sys->AudioTrack + SIZE_OF_AUDIOTRACK - 4)) = 0xbaadbaad;
+    // Higher than android 2.2
+    if (p_sys->at_ctor)
+        p_sys->at_ctor(p_sys->AudioTrack, stream_type, rate, format, channel, size, 0, NULL, NULL, 0, 0);
+    // Higher than android 1.6
+    else if (p_sys->at_ctor_legacy)
+        p_sys->at_ctor_legacy(p_sys->AudioTrack, stream_type, rate, format, channel, size, 0, NULL, NULL, 0);
+
+    assert( (*((uint32_t *) ((uint32_t)p_sys->AudioTrack + SIZE_OF_AUDIOTRACK - 4)) == 0xbaadbaad) );
+
+    /* And Init */
+    int status = p_sys->at_initCheck(p_sys->AudioTrack);
+
+    /* android 1.6 uses channel count instead of stream_type */
+    if (status != 0 && p_sys->at_ctor_legacy) {
+        channel = (channel == CHANNEL_OUT_STEREO) ? 2 : 1;
+        p_sys->at_ctor_legacy(p_sys->AudioTrack, stream_type, rate, format, channel, size, 0, NULL, NULL, 0);
+        status = p_sys->at_initCheck(p_sys->AudioTrack);
+    }
+    return status;
+}
+
 static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
 {
     struct aout_sys_t *p_sys = aout->sys;
@@ -228,6 +296,19 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
     int status, size;
     int afSampleRate, afFrameCount, afLatency, minBufCount, minFrameCount;
     int stream_type, channel, rate, format;
+    bool native = false;
+
+    stream_type = MUSIC;
+
+    /* The mixer only gives fast tracks to the streams at its own rate, and
+     * would resample anyway: leave that to the audio output core */
+    if (p_sys->as_getOutputSamplingRate && p_sys->as_getOutputFrameCount
+     && !p_sys->as_getOutputSamplingRate(&afSampleRate, stream_type)
+     && !p_sys->as_getOutputFrameCount(&afFrameCount, stream_type)
+     && afSampleRate > 0 && afFrameCount > 0) {
+        fmt->i_rate = afSampleRate;
+        native = true;
+    }
 
     /* 4000 <= frequency <= 48000 */
     rate = fmt->i_rate;
@@ -236,12 +317,14 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
     if (rate > 48000)
         rate = 48000;
 
-    stream_type = MUSIC;
-
-    /* We can only accept U8 and S16N */
-    if (fmt->i_format != VLC_CODEC_U8 && fmt->i_format != VLC_CODEC_S16N)
-        fmt->i_format = VLC_CODEC_S16N;
-    format = (fmt->i_format == VLC_CODEC_S16N) ? PCM_16_BIT : PCM_8_BIT;
+    /* Float is accepted by Android 5.0 and later, we fall back to S16N on
+     * older versions */
+    if (fmt->i_format == VLC_CODEC_U8)
+        format = PCM_8_BIT;
+    else if (fmt->i_format == VLC_CODEC_S16N)
+        format = PCM_16_BIT;
+    else
+        format = PCM_FLOAT;
 
     /* TODO: android supports more channels */
     fmt->i_original_channels = fmt->i_physical_channels;
@@ -280,31 +363,31 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
         }
     }
 
-    size = minFrameCount * (channel == CHANNEL_OUT_STEREO ? 2 : 1) * 4;
+    /* Whole mixer periods, so that each of them finds a full buffer */
+    if (native)
+        minFrameCount = (minFrameCount + afFrameCount - 1)
+                      / afFrameCount * afFrameCount;
 
     /* Sizeof(AudioTrack) == 0x58 (not sure) on 2.2.1, this should be enough */
     p_sys->AudioTrack = malloc(SIZE_OF_AUDIOTRACK);
     if (!p_sys->AudioTrack)
         return VLC_ENOMEM;
 
-    *((uint32_t *) ((uint32_t)p_sys->AudioTrack + SIZE_OF_AUDIOTRACK - 4)) = 0xbaadbaad;
-    // Higher than android 2.2
-    if (p_sys->at_ctor)
-        p_sys->at_ctor(p_sys->AudioTrack, stream_type, rate, format, channel, size, 0, NULL, NULL, 0, 0);
-    // Higher than android 1.6
-    else if (p_sys->at_ctor_legacy)
-        p_sys->at_ctor_legacy(p_sys->AudioTrack, stream_type, rate, format, channel, size, 0, NULL, NULL, 0);
+    for (;;) {
+        int bytes_per_sample = format == PCM_FLOAT ? 4
+                             : format == PCM_16_BIT ? 2 : 1;
 
-    assert( (*((uint32_t *) ((uint32_t)p_sys->AudioTrack + SIZE_OF_AUDIOTRACK - 4)) == 0xbaadbaad) );
+        p_sys->bytes_per_frame = bytes_per_sample
+                               * (channel == CHANNEL_OUT_STEREO ? 2 : 1);
+        size = minFrameCount * p_sys->bytes_per_frame;
 
-    /* And Init */
-    status = p_sys->at_initCheck(p_sys->AudioTrack);
+        status = CreateTrack(p_sys, stream_type, rate, format, channel, size);
+        if (status == 0 || format != PCM_FLOAT)
+            break;
 
-    /* android 1.6 uses channel count instead of stream_type */
-    if (status != 0) {
-        channel = (channel == CHANNEL_OUT_STEREO) ? 2 : 1;
-        p_sys->at_ctor_legacy(p_sys->AudioTrack, stream_type, rate, format, channel, size, 0, NULL, NULL, 0);
-        status = p_sys->at_initCheck(p_sys->AudioTrack);
+        msg_Dbg(aout, "float output not supported, using S16N");
+        p_sys->at_dtor(p_sys->AudioTrack);
+        format = PCM_16_BIT;
     }
     if (status != 0) {
         msg_Err(aout, "Cannot create AudioTrack!");
@@ -312,6 +395,21 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
         return VLC_EGENERIC;
     }
 
+    switch (format) {
+    case PCM_FLOAT:
+        fmt->i_format = VLC_CODEC_FL32;
+        break;
+    case PCM_16_BIT:
+        fmt->i_format = VLC_CODEC_S16N;
+        break;
+    default:
+        fmt->i_format = VLC_CODEC_U8;
+        break;
+    }
+    msg_Dbg(aout, "%4.4s at %d Hz, %d frames of buffer%s",
+            (const char *)&fmt->i_format, rate, minFrameCount,
+            native ? " (native rate)" : "");
+
     aout_SoftVolumeStart(aout);
 
     aout->sys = p_sys;
@@ -322,7 +420,6 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
 
     p_sys->rate = rate;
     p_sys->samples_written = 0;
-    p_sys->bytes_per_frame = aout_FormatNbChannels(fmt) * (format == PCM_16_BIT) ? 2 : 1;
 
     p_sys->at_start(p_sys->AudioTrack);
     TimeGet(aout, NULL); /* Gets the initial value of DAC samples counter */
@@ -42,12 +42,16 @@
 #include <SLES/OpenSLES_Android.h>
 
 int aout_get_native_sample_rate(void);
+/* Size of the mixer bursts in frames (AudioManager's
+ * PROPERTY_OUTPUT_FRAMES_PER_BUFFER), optional */
+int aout_get_native_frames_per_buffer(void) __attribute__((weak));
 
 #define OPENSLES_BUFFERS 255 /* maximum number of buffers */
-#define OPENSLES_BUFLEN  10   /* ms */
+#define OPENSLES_BUFLEN  10   /* ms, when the burst size is unknown */
 /*
- * 10ms of precision when mesasuring latency should be enough,
- * with 255 buffers we can buffer 2.55s of audio.
+ * The buffers are as long as a mixer burst, so that a fast track gets one
+ * of them per mixer period: the latency is measured with that precision.
+ * With 10ms buffers, we can buffer 2.55s of audio.
  */
 
 #define CHECK_OPENSL_ERROR(msg)                \
@@ -107,8 +111,10 @@ struct aout_sys_t
     uint8_t                        *buf;
     size_t                          samples_per_buf;
     int                             next_buf;
+    int                             queued; /* buffers */
 
     int                             rate;
+    int                             bytes_per_frame;
 
     /* if we can measure latency already */
     bool                            started;
@@ -144,34 +150,24 @@ vlc_module_end ()
  *
  *****************************************************************************/
 
-static inline int bytesPerSample(void)
-{
-    return 2 /* S16 */ * 2 /* stereo */;
-}
-
 static int TimeGet(audio_output_t* aout, mtime_t* restrict drift)
 {
     aout_sys_t *sys = aout->sys;
 
-    SLAndroidSimpleBufferQueueState st;
-    SLresult res = GetState(sys->playerBufferQueue, &st);
-    if (unlikely(res != SL_RESULT_SUCCESS)) {
-        msg_Err(aout, "Could not query buffer queue state in TimeGet (%lu)", res);
-        return -1;
-    }
-
+    /* The queued buffers are counted by the callback: no need to query
+     * the state of the buffer queue */
     vlc_mutex_lock(&sys->lock);
     bool started = sys->started;
+    size_t samples = sys->queued * sys->samples_per_buf + sys->samples;
     vlc_mutex_unlock(&sys->lock);
 
     if (!started)
         return -1;
 
-    *drift = (CLOCK_FREQ * OPENSLES_BUFLEN * st.count / 1000)
-        + sys->samples * CLOCK_FREQ / sys->rate;
+    *drift = samples * CLOCK_FREQ / sys->rate;
 
     /* msg_Dbg(aout, "latency %"PRId64" ms, %d/%d buffers", *drift / 1000,
-        (int)st.count, OPENSLES_BUFFERS); */
+        sys->queued, OPENSLES_BUFFERS); */
 
     return 0;
 }
@@ -196,6 +192,7 @@ static void Flush(audio_output_t *aout, bool drain)
         sys->pp_buffer_last = &sys->p_buffer_chain;
 
         sys->samples = 0;
+        sys->queued = 0;
         sys->started = false;
 
         vlc_mutex_unlock(&sys->lock);
@@ -241,7 +238,7 @@ static void Pause(audio_output_t *aout, bool pause, mtime_t date)
 static int WriteBuffer(audio_output_t *aout)
 {
     aout_sys_t *sys = aout->sys;
-    const size_t unit_size = sys->samples_per_buf * bytesPerSample();
+    const size_t unit_size = sys->samples_per_buf * sys->bytes_per_frame;
 
     block_t *b = sys->p_buffer_chain;
     if (!b)
@@ -262,14 +259,7 @@ static int WriteBuffer(audio_output_t *aout)
             return false;
     }
 
-    SLAndroidSimpleBufferQueueState st;
-    SLresult res = GetState(sys->playerBufferQueue, &st);
-    if (unlikely(res != SL_RESULT_SUCCESS)) {
-        msg_Err(aout, "Could not query buffer queue state in %s (%lu)", __func__, res);
-        return false;
-    }
-
-    if (st.count == OPENSLES_BUFFERS)
+    if (sys->queued == OPENSLES_BUFFERS)
         return false;
 
     size_t done = 0;
@@ -307,11 +297,12 @@ static int WriteBuffer(audio_output_t *aout)
     if (r == SL_RESULT_SUCCESS) {
         if (++sys->next_buf == OPENSLES_BUFFERS)
             sys->next_buf = 0;
+        sys->queued++;
         return true;
     } else {
         /* XXX : if writing fails, we don't retry */
-        msg_Err(aout, "error %lu when writing %d bytes %s",
-                r, b->i_buffer,
+        msg_Err(aout, "error %lu when writing %zu bytes %s",
+                r, unit_size,
                 (r == SL_RESULT_BUFFER_INSUFFICIENT) ? " (buffer insufficient)" : "");
         return false;
     }
@@ -327,18 +318,20 @@ static void Play(audio_output_t *aout, block_t *p_buffer)
     p_buffer->p_next = NULL; /* Make sur our linked list doesn't use old references */
     vlc_mutex_lock(&sys->lock);
 
-    sys->samples += p_buffer->i_buffer / bytesPerSample();
+    sys->samples += p_buffer->i_buffer / sys->bytes_per_frame;
 
     /* Hold this block until we can write it into the OpenSL buffer */
     block_ChainLastAppend(&sys->pp_buffer_last, p_buffer);
 
-    /* Fill OpenSL buffer */
+    /* Fill OpenSL buffer, the callback takes over once it is full */
     while (WriteBuffer(aout))
         ;
 
     vlc_mutex_unlock(&sys->lock);
 }
 
+/* Called by OpenSL each time a buffer was consumed: refill the queue from
+ * the pending blocks, without waiting for the next Play() */
 static void PlayedCallback (SLAndroidSimpleBufferQueueItf caller, void *pContext)
 {
     (void)caller;
@@ -348,7 +341,11 @@ static void PlayedCallback (SLAndroidSimpleBufferQueueItf caller, void *pContext
     assert (caller == sys->playerBufferQueue);
 
     vlc_mutex_lock(&sys->lock);
+    if (sys->queued > 0)
+        sys->queued--;
     sys->started = true;
+    while (WriteBuffer(aout))
+        ;
     vlc_mutex_unlock(&sys->lock);
 }
 /*****************************************************************************
@@ -366,6 +363,12 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
         OPENSLES_BUFFERS
     };
 
+    /* Only the streams at the native rate get a fast track, the audio
+     * output core resamples the others */
+    int native_rate = aout_get_native_sample_rate();
+    if (native_rate > 0)
+        fmt->i_rate = native_rate;
+
     SLDataFormat_PCM format_pcm;
     format_pcm.formatType       = SL_DATAFORMAT_PCM;
     format_pcm.numChannels      = 2;
@@ -376,6 +379,25 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
     format_pcm.endianness       = SL_BYTEORDER_LITTLEENDIAN;
 
     SLDataSource audioSrc = {&loc_bufq, &format_pcm};
+    vlc_fourcc_t format = VLC_CODEC_S16N;
+
+#ifdef SL_ANDROID_DATAFORMAT_PCM_EX
+    /* Float samples, without conversion, on Android 5.0 and later */
+    SLAndroidDataFormat_PCM_EX format_float;
+    format_float.formatType     = SL_ANDROID_DATAFORMAT_PCM_EX;
+    format_float.numChannels    = 2;
+    format_float.sampleRate     = ((SLuint32) fmt->i_rate * 1000) ;
+    format_float.bitsPerSample  = SL_PCMSAMPLEFORMAT_FIXED_32;
+    format_float.containerSize  = SL_PCMSAMPLEFORMAT_FIXED_32;
+    format_float.channelMask    = SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT;
+    format_float.endianness     = SL_BYTEORDER_LITTLEENDIAN;
+    format_float.representation = SL_ANDROID_PCM_REPRESENTATION_FLOAT;
+
+    if (fmt->i_format != VLC_CODEC_S16N && fmt->i_format != VLC_CODEC_U8) {
+        audioSrc.pFormat = &format_float;
+        format = VLC_CODEC_FL32;
+    }
+#endif
 
     // configure audio sink
     SLDataLocator_OutputMix loc_outmix = {
@@ -388,10 +410,18 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
     const SLInterfaceID ids2[] = { sys->SL_IID_ANDROIDSIMPLEBUFFERQUEUE, sys->SL_IID_VOLUME };
     static const SLboolean req2[] = { SL_BOOLEAN_TRUE, SL_BOOLEAN_TRUE };
 
-    if (aout_get_native_sample_rate() >= fmt->i_rate) {
+    if (native_rate >= (int)fmt->i_rate) {
         result = CreateAudioPlayer(sys->engineEngine, &sys->playerObject, &audioSrc,
                                     &audioSnk, sizeof(ids2) / sizeof(*ids2),
                                     ids2, req2);
+        if (result != SL_RESULT_SUCCESS && format == VLC_CODEC_FL32) {
+            msg_Dbg(aout, "float output not supported, using S16N");
+            audioSrc.pFormat = &format_pcm;
+            format = VLC_CODEC_S16N;
+            result = CreateAudioPlayer(sys->engineEngine, &sys->playerObject,
+                                       &audioSrc, &audioSnk,
+                                       sizeof(ids2) / sizeof(*ids2), ids2, req2);
+        }
     } else {
         // Don't try to play back a sample rate higher than the native one,
         // since OpenSL ES will try to use the fast path, which AudioFlinger
@@ -405,6 +435,8 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
         /* Try again with a more sensible samplerate */
         fmt->i_rate = 44100;
         format_pcm.samplesPerSec = ((SLuint32) 44100 * 1000) ;
+        audioSrc.pFormat = &format_pcm;
+        format = VLC_CODEC_S16N;
         result = CreateAudioPlayer(sys->engineEngine, &sys->playerObject, &audioSrc,
                 &audioSnk, sizeof(ids2) / sizeof(*ids2),
                 ids2, req2);
@@ -434,20 +466,31 @@ static int Start(audio_output_t *aout, audio_sample_format_t *restrict fmt)
 
     /* XXX: rounding shouldn't affect us at normal sampling rate */
     sys->rate = fmt->i_rate;
-    sys->samples_per_buf = OPENSLES_BUFLEN * fmt->i_rate / 1000;
-    sys->buf = malloc(OPENSLES_BUFFERS * sys->samples_per_buf * bytesPerSample());
+    sys->bytes_per_frame = 2 /* stereo */
+                         * (format == VLC_CODEC_FL32 ? 4 : 2);
+    if (aout_get_native_frames_per_buffer != NULL
+     && (int)fmt->i_rate == native_rate
+     && aout_get_native_frames_per_buffer() > 0)
+        sys->samples_per_buf = aout_get_native_frames_per_buffer();
+    else
+        sys->samples_per_buf = OPENSLES_BUFLEN * fmt->i_rate / 1000;
+    sys->buf = malloc(OPENSLES_BUFFERS * sys->samples_per_buf * sys->bytes_per_frame);
     if (!sys->buf)
         goto error;
 
+    msg_Dbg(aout, "%4.4s at %u Hz, buffers of %zu frames",
+            (const char *)&format, fmt->i_rate, sys->samples_per_buf);
+
     sys->started = false;
     sys->next_buf = 0;
+    sys->queued = 0;
 
     sys->p_buffer_chain = NULL;
     sys->pp_buffer_last = &sys->p_buffer_chain;
     sys->samples = 0;
 
-    // we want 16bit signed data native endian.
-    fmt->i_format              = VLC_CODEC_S16N;
+    // we want float or 16bit signed data native endian.
+    fmt->i_format              = format;
     fmt->i_physical_channels   = AOUT_CHAN_LEFT | AOUT_CHAN_RIGHT;
 
     SetPositionUpdatePeriod(sys->playerPlay, AOUT_MIN_PREPARE_TIME * 1000 / CLOCK_FREQ);
@@ -473,11 +516,12 @@ static void Stop(audio_output_t *aout)
     //Flush remaining buffers if any.
     Clear(sys->playerBufferQueue);
 
-    free(sys->buf);
-    block_ChainRelease(sys->p_buffer_chain);
-
+    /* No more callbacks once the player is destroyed */
     Destroy(sys->playerObject);
     sys->playerObject = NULL;
+
+    free(sys->buf);
+    block_ChainRelease(sys->p_buffer_chain);
 }
 
 /*****************************************************************************
@@ -77,6 +77,17 @@ typedef struct aout_stream_sys
     unsigned bytes_per_frame;
     UINT64 written; /**< Frames written to the buffer */
     UINT32 frames; /**< Total buffer size (frames) */
+
+    /* Exclusive mode: the device reads one period while the next one is
+     * written, when the event is signaled */
+    bool exclusive;
+    bool started;
+    HANDLE event; /**< Period ready to be written */
+    uint8_t *staging; /**< Period being filled */
+    UINT32 staged; /**< Frames in the period being filled */
+
+    unsigned glitches; /**< Periods written late (exclusive mode) */
+    mtime_t delay_min, delay_max; /**< Observed latency */
 } aout_stream_sys_t;
 
 
@@ -116,7 +127,91 @@ static HRESULT TimeGet(aout_stream_t *s, mtime_t *restrict delay)
            + ((w.rem * CLOCK_FREQ) / sys->rate)
            - ((r.rem * CLOCK_FREQ) / freq)
            - ((GetQPC() - qpcpos) / (10000000 / CLOCK_FREQ));
+    /* The period being filled is not written yet */
+    *delay += sys->staged * CLOCK_FREQ / sys->rate;
 
+    if (*delay < sys->delay_min)
+        sys->delay_min = *delay;
+    if (*delay > sys->delay_max)
+        sys->delay_max = *delay;
+    return hr;
+}
+
+/* Writes the staging period to the device, waiting for the previous one to
+ * be read first, if the stream is started */
+static HRESULT WritePeriod(aout_stream_t *s, IAudioRenderClient *render)
+{
+    aout_stream_sys_t *sys = s->sys;
+    HRESULT hr;
+
+    if (sys->started)
+    {
+        /* One period of margin before counting a glitch */
+        DWORD timeout = 2 * 1000 * sys->frames / sys->rate + 1;
+
+        if (WaitForSingleObject(sys->event, timeout) != WAIT_OBJECT_0)
+        {
+            sys->glitches++;
+            msg_Warn(s, "period not requested in time (%u glitches)",
+                     sys->glitches);
+        }
+    }
+
+    BYTE *dst;
+    hr = IAudioRenderClient_GetBuffer(render, sys->frames, &dst);
+    if (FAILED(hr))
+    {
+        msg_Err(s, "cannot get buffer (error 0x%lx)", hr);
+        return hr;
+    }
+
+    memcpy(dst, sys->staging, sys->frames * sys->bytes_per_frame);
+    hr = IAudioRenderClient_ReleaseBuffer(render, sys->frames, 0);
+    if (FAILED(hr))
+    {
+        msg_Err(s, "cannot release buffer (error 0x%lx)", hr);
+        return hr;
+    }
+
+    sys->written += sys->frames;
+    sys->staged = 0;
+    if (!sys->started)
+    {   /* The first period is written before starting */
+        hr = IAudioClient_Start(sys->client);
+        sys->started = SUCCEEDED(hr);
+    }
+    return hr;
+}
+
+static HRESULT PlayExclusive(aout_stream_t *s, block_t *block,
+                             IAudioRenderClient *render)
+{
+    aout_stream_sys_t *sys = s->sys;
+    HRESULT hr = S_OK;
+
+    /* The device reads whole periods: the blocks are cut into periods */
+    while (block->i_nb_samples > 0)
+    {
+        UINT32 frames = sys->frames - sys->staged;
+        if (frames > block->i_nb_samples)
+            frames = block->i_nb_samples;
+
+        const size_t copy = frames * sys->bytes_per_frame;
+
+        memcpy(sys->staging + sys->staged * sys->bytes_per_frame,
+               block->p_buffer, copy);
+        block->p_buffer += copy;
+        block->i_buffer -= copy;
+        block->i_nb_samples -= frames;
+        sys->staged += frames;
+
+        if (sys->staged == sys->frames)
+        {
+            hr = WritePeriod(s, render);
+            if (FAILED(hr))
+                break;
+        }
+    }
     return hr;
 }
 
@@ -138,6 +233,13 @@ static HRESULT Play(aout_stream_t *s, block_t *block)
     }
 
     IAudioRenderClient *render = pv;
+    if (sys->exclusive)
+    {
+        hr = PlayExclusive(s, block, render);
+        IAudioRenderClient_Release(render);
+        goto out;
+    }
+
     for (;;)
     {
         UINT32 frames;
@@ -196,6 +298,8 @@ static HRESULT Pause(aout_stream_t *s, bool paused)
 
     if (paused)
         hr = IAudioClient_Stop(sys->client);
+    else if (sys->exclusive && !sys->started)
+        hr = S_OK; /* started once the first period is written */
     else
         hr = IAudioClient_Start(sys->client);
     if (FAILED(hr))
@@ -216,6 +320,8 @@ static HRESULT Flush(aout_stream_t *s)
     {
         msg_Dbg(s, "reset");
         sys->written = 0;
+        sys->staged = 0;
+        sys->started = false;
     }
     else
         msg_Warn(s, "cannot reset stream (error 0x%lx)", hr);
@@ -251,6 +357,7 @@ static void vlc_ToWave(WAVEFORMATEXTENSIBLE *restrict wf,
         case VLC_CODEC_U8:
             audio->i_format = VLC_CODEC_S16N;
         case VLC_CODEC_S16N:
+        case VLC_CODEC_S32N:
             wf->SubFormat = KSDATAFORMAT_SUBTYPE_PCM;
             break;
 
@@ -348,38 +455,108 @@ static unsigned vlc_CheckWaveOrder (const WAVEFORMATEX *restrict wf,
     return aout_CheckChannelReorder(chans_in, chans_out, mask, table);
 }
 
-static HRESULT Start(aout_stream_t *s, audio_sample_format_t *restrict fmt,
-                     const GUID *sid)
+/* Negotiates a device format and initializes the client in exclusive mode,
+ * driven by the period event, with buffers of the minimum device period */
+static HRESULT StartExclusive(aout_stream_t *s,
+                              audio_sample_format_t *restrict fmt,
+                              const GUID *sid)
 {
-    if (!s->b_force && var_InheritBool(s, "spdif") && AOUT_FMT_SPDIF(fmt))
-        /* Fallback to other plugin until pass-through is implemented */
-        return E_NOTIMPL;
+    aout_stream_sys_t *sys = s->sys;
+    const vlc_fourcc_t formats[] = {
+        fmt->i_format, VLC_CODEC_FL32, VLC_CODEC_S32N, VLC_CODEC_S16N,
+    };
+    audio_sample_format_t devfmt;
+    WAVEFORMATEXTENSIBLE wf;
+    HRESULT hr = AUDCLNT_E_UNSUPPORTED_FORMAT;
 
-    aout_stream_sys_t *sys = malloc(sizeof (*sys));
-    if (unlikely(sys == NULL))
-        return E_OUTOFMEMORY;
-    sys->client = NULL;
+    /* Without the Windows mixer, the device must take the format as is */
+    for (size_t i = 0; i < sizeof (formats) / sizeof (formats[0]) && hr != S_OK;
+         i++)
+    {
+        devfmt = *fmt;
+        devfmt.i_format = formats[i];
+        vlc_ToWave(&wf, &devfmt);
+        hr = IAudioClient_IsFormatSupported(sys->client,
+                                            AUDCLNT_SHAREMODE_EXCLUSIVE,
+                                            &wf.Format, NULL);
+    }
+    if (hr != S_OK)
+    {
+        msg_Warn(s, "no exclusive mode format (error 0x%lx)", hr);
+        return FAILED(hr) ? hr : AUDCLNT_E_UNSUPPORTED_FORMAT;
+    }
 
-    void *pv;
-    HRESULT hr = aout_stream_Activate(s, &IID_IAudioClient, NULL, &pv);
+    REFERENCE_TIME period, defT;
+    hr = IAudioClient_GetDevicePeriod(sys->client, &defT, &period);
     if (FAILED(hr))
     {
-        msg_Err(s, "cannot activate client (error 0x%lx)", hr);
-        goto error;
+        msg_Err(s, "cannot get device period (error 0x%lx)", hr);
+        return hr;
     }
-    sys->client = pv;
 
-    /* Configure audio stream */
+    hr = IAudioClient_Initialize(sys->client, AUDCLNT_SHAREMODE_EXCLUSIVE,
+                                 AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                                 period, period, &wf.Format, sid);
+    if (hr == AUDCLNT_E_BUFFER_SIZE_NOT_ALIGNED)
+    {   /* Round the period to the frames the device takes, on a new client */
+        UINT32 frames;
+        void *pv;
+
+        hr = IAudioClient_GetBufferSize(sys->client, &frames);
+        if (FAILED(hr))
+            return hr;
+        IAudioClient_Release(sys->client);
+        sys->client = NULL;
+
+        period = (10000000 * (REFERENCE_TIME)frames + devfmt.i_rate / 2)
+                 / devfmt.i_rate;
+        hr = aout_stream_Activate(s, &IID_IAudioClient, NULL, &pv);
+        if (FAILED(hr))
+            return hr;
+        sys->client = pv;
+        hr = IAudioClient_Initialize(sys->client, AUDCLNT_SHAREMODE_EXCLUSIVE,
+                                     AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                                     period, period, &wf.Format, sid);
+    }
+    if (FAILED(hr))
+    {
+        msg_Err(s, "cannot initialize exclusive mode (error 0x%lx)", hr);
+        return hr;
+    }
+
+    sys->event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (sys->event == NULL)
+        return E_OUTOFMEMORY;
+    hr = IAudioClient_SetEventHandle(sys->client, sys->event);
+    if (FAILED(hr))
+    {
+        msg_Err(s, "cannot set event (error 0x%lx)", hr);
+        return hr;
+    }
+
+    msg_Dbg(s, "exclusive mode period: %"PRIu64"00 ns", period);
+    *fmt = devfmt;
+    sys->chans_to_reorder = vlc_CheckWaveOrder(&wf.Format, sys->chans_table);
+    sys->format = fmt->i_format;
+    return S_OK;
+}
+
+static HRESULT StartShared(aout_stream_t *s,
+                           audio_sample_format_t *restrict fmt,
+                           const GUID *sid)
+{
+    aout_stream_sys_t *sys = s->sys;
     WAVEFORMATEXTENSIBLE wf;
     WAVEFORMATEX *pwf;
 
     vlc_ToWave(&wf, fmt);
-    hr = IAudioClient_IsFormatSupported(sys->client, AUDCLNT_SHAREMODE_SHARED,
-                                        &wf.Format, &pwf);
+    HRESULT hr = IAudioClient_IsFormatSupported(sys->client,
+                                                AUDCLNT_SHAREMODE_SHARED,
+                                                &wf.Format, &pwf);
     if (FAILED(hr))
     {
         msg_Err(s, "cannot negotiate audio format (error 0x%lx)", hr);
-        goto error;
+        return hr;
     }
 
     if (hr == S_FALSE)
@@ -389,8 +566,7 @@ static HRESULT Start(aout_stream_t *s, audio_sample_format_t *restrict fmt,
         {
             CoTaskMemFree(pwf);
             msg_Err(s, "unsupported audio format");
-            hr = E_INVALIDARG;
-            goto error;
+            return E_INVALIDARG;
         }
         msg_Dbg(s, "modified format");
     }
@@ -406,10 +582,67 @@ static HRESULT Start(aout_stream_t *s, audio_sample_format_t *restrict fmt,
                                  (hr == S_OK) ? &wf.Format : pwf, sid);
     CoTaskMemFree(pwf);
     if (FAILED(hr))
-    {
         msg_Err(s, "cannot initialize audio client (error 0x%lx)", hr);
+    return hr;
+}
+
+static HRESULT Start(aout_stream_t *s, audio_sample_format_t *restrict fmt,
+                     const GUID *sid)
+{
+    if (!s->b_force && var_InheritBool(s, "spdif") && AOUT_FMT_SPDIF(fmt))
+        /* Fallback to other plugin until pass-through is implemented */
+        return E_NOTIMPL;
+
+    aout_stream_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return E_OUTOFMEMORY;
+    sys->client = NULL;
+    sys->event = NULL;
+    sys->staging = NULL;
+    s->sys = sys;
+
+    void *pv;
+    HRESULT hr = aout_stream_Activate(s, &IID_IAudioClient, NULL, &pv);
+    if (FAILED(hr))
+    {
+        msg_Err(s, "cannot activate client (error 0x%lx)", hr);
         goto error;
     }
+    sys->client = pv;
+
+    /* Configure audio stream */
+    sys->exclusive = var_InheritBool(s, "wasapi-exclusive");
+    if (sys->exclusive)
+    {
+        hr = StartExclusive(s, fmt, sid);
+        if (FAILED(hr))
+        {   /* A client that failed to initialize cannot be reused */
+            msg_Warn(s, "exclusive mode failed, using shared mode");
+            sys->exclusive = false;
+            if (sys->event != NULL)
+            {
+                CloseHandle(sys->event);
+                sys->event = NULL;
+            }
+            if (sys->client != NULL)
+                IAudioClient_Release(sys->client);
+            sys->client = NULL;
+
+            hr = aout_stream_Activate(s, &IID_IAudioClient, NULL, &pv);
+            if (FAILED(hr))
+            {
+                msg_Err(s, "cannot activate client (error 0x%lx)", hr);
+                goto error;
+            }
+            sys->client = pv;
+        }
+    }
+    if (!sys->exclusive)
+    {
+        hr = StartShared(s, fmt, sid);
+        if (FAILED(hr))
+            goto error;
+    }
 
     hr = IAudioClient_GetBufferSize(sys->client, &sys->frames);
     if (FAILED(hr))
@@ -428,10 +661,24 @@ static HRESULT Start(aout_stream_t *s, audio_sample_format_t *restrict fmt,
         msg_Dbg(s, "minimum period : %"PRIu64"00 ns", minT);
     }
 
+    if (sys->exclusive)
+    {
+        sys->staging = malloc(sys->frames * fmt->i_bytes_per_frame);
+        if (unlikely(sys->staging == NULL))
+        {
+            hr = E_OUTOFMEMORY;
+            goto error;
+        }
+    }
+
     sys->rate = fmt->i_rate;
     sys->bytes_per_frame = fmt->i_bytes_per_frame;
     sys->written = 0;
-    s->sys = sys;
+    sys->started = false;
+    sys->staged = 0;
+    sys->glitches = 0;
+    sys->delay_min = INT64_MAX;
+    sys->delay_max = 0;
     s->time_get = TimeGet;
     s->play = Play;
     s->pause = Pause;
@@ -440,6 +687,9 @@ static HRESULT Start(aout_stream_t *s, audio_sample_format_t *restrict fmt,
 error:
     if (sys->client != NULL)
         IAudioClient_Release(sys->client);
+    if (sys->event != NULL)
+        CloseHandle(sys->event);
+    free(sys->staging);
     free(sys);
     return hr;
 }
@@ -448,17 +698,33 @@ static void Stop(aout_stream_t *s)
 {
     aout_stream_sys_t *sys = s->sys;
 
+    if (sys->delay_max > 0)
+        msg_Dbg(s, "latency: %"PRId64" to %"PRId64" us, %u glitch(es)",
+                sys->delay_min, sys->delay_max, sys->glitches);
+
     IAudioClient_Stop(sys->client); /* should not be needed */
     IAudioClient_Release(sys->client);
+    if (sys->event != NULL)
+        CloseHandle(sys->event);
 
+    free(sys->staging);
     free(sys);
 }
 
+#define EXCLUSIVE_TEXT N_("Exclusive mode")
+#define EXCLUSIVE_LONGTEXT N_( \
+    "Take the device for the lowest latency, bypassing the Windows audio " \
+    "engine. Other applications cannot play meanwhile, and the samples are " \
+    "neither mixed nor resampled. Shared mode is used if the device " \
+    "refuses the audio format.")
+
 vlc_module_begin()
     set_shortname("WASAPI")
     set_description(N_("Windows Audio Session API output"))
     set_capability("aout stream", 50)
     set_category(CAT_AUDIO)
     set_subcategory(SUBCAT_AUDIO_AOUT)
+    add_bool("wasapi-exclusive", false, EXCLUSIVE_TEXT, EXCLUSIVE_LONGTEXT,
+             true)
     set_callbacks(Start, Stop)
 vlc_module_end()
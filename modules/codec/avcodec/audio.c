@@ -401,21 +401,30 @@ static block_t *DecodeAudio( decoder_t *p_dec, block_t **pp_block )
         goto drop;
 
     /* Interleave audio if required */
+    bool b_extract = p_sys->b_extract;
     if( av_sample_fmt_is_planar( ctx->sample_fmt ) )
 #if (LIBAVCODEC_VERSION_MAJOR >= 55)
     {
-        p_block = block_Alloc(frame->linesize[0] * ctx->channels);
+        /* Reorder the channels while interleaving, rather than in a second
+         * pass over the interleaved samples */
+        unsigned channels = b_extract ? p_dec->fmt_out.audio.i_channels
+                                      : (unsigned)ctx->channels;
+
+        p_block = block_Alloc(p_dec->fmt_out.audio.i_bytes_per_frame
+                              * frame->nb_samples);
         if (unlikely(p_block == NULL))
             goto drop;
 
-        const void *planes[ctx->channels];
-        for (int i = 0; i < ctx->channels; i++)
-            planes[i] = frame->extended_data[i];
+        const void *planes[channels];
+        for (unsigned i = 0; i < channels; i++)
+            planes[i] = frame->extended_data[b_extract ? p_sys->pi_extraction[i]
+                                                       : (int)i];
 
         aout_Interleave(p_block->p_buffer, planes, frame->nb_samples,
-                        ctx->channels, p_dec->fmt_out.audio.i_format);
+                        channels, p_dec->fmt_out.audio.i_format);
         p_block->i_nb_samples = frame->nb_samples;
         av_frame_free(&frame);
+        b_extract = false;
     }
     else
     {
@@ -443,7 +452,7 @@ static block_t *DecodeAudio( decoder_t *p_dec, block_t **pp_block )
     p_block->i_nb_samples = frame->nb_samples;
 #endif
 
-    if (p_sys->b_extract)
+    if (b_extract)
     {   /* TODO: do not drop channels... at least not here */
         block_t *p_buffer = block_Alloc( p_dec->fmt_out.audio.i_bytes_per_frame
                                          * p_block->i_nb_samples );
@@ -61,6 +61,10 @@ static const int  nloopf_list[] = { 0, 1, 2, 3, 4 };
 static const char *const nloopf_list_text[] =
   { N_("None"), N_("Non-ref"), N_("Bidir"), N_("Non-key"), N_("All") };
 
+static const int  thread_type_values[] = { 0, 1, 2 };
+static const char *const thread_type_texts[] =
+  { N_("Automatic"), N_("Frame"), N_("Slice") };
+
 #ifdef ENABLE_SOUT
 static const char *const enc_hq_list[] = { "rd", "bits", "simple" };
 static const char *const enc_hq_list_text[] = {
@@ -132,6 +136,11 @@ vlc_module_begin ()
 #if defined(FF_THREAD_FRAME)
     add_obsolete_integer( "ffmpeg-threads" ) /* removed since 2.1.0 */
     add_integer( "avcodec-threads", 0, THREADS_TEXT, THREADS_LONGTEXT, true );
+    add_integer( "avcodec-thread-budget", 0, THREAD_BUDGET_TEXT,
+                 THREAD_BUDGET_LONGTEXT, true )
+    add_integer( "avcodec-thread-type", 0, THREAD_TYPE_TEXT,
+                 THREAD_TYPE_LONGTEXT, true )
+        change_integer_list( thread_type_values, thread_type_texts )
 #endif
     add_string( "avcodec-options", NULL, AV_OPTIONS_TEXT, AV_OPTIONS_LONGTEXT, true )
 
@@ -86,8 +86,9 @@ void ffmpeg_CloseCodec( decoder_t *p_dec );
 #define HURRYUP_TEXT N_("Hurry up")
 #define HURRYUP_LONGTEXT N_( \
     "The decoder can partially decode or skip frame(s) " \
-    "when there is not enough time. It's useful with low CPU power " \
-    "but it can produce distorted pictures.")
+    "when the pictures are displayed late: first the non-reference frames, " \
+    "then the loop filter, then all but the key frames. It's useful with " \
+    "low CPU power but it can produce distorted pictures.")
 
 #define FAST_TEXT N_("Allow speed tricks")
 #define FAST_LONGTEXT N_( \
@@ -123,6 +124,16 @@ void ffmpeg_CloseCodec( decoder_t *p_dec );
 #define THREADS_TEXT N_( "Threads" )
 #define THREADS_LONGTEXT N_( "Number of threads used for decoding, 0 meaning auto" )
 
+#define THREAD_BUDGET_TEXT N_( "Decoder thread budget" )
+#define THREAD_BUDGET_LONGTEXT N_( "Total number of threads shared by all " \
+    "the video decoders of the process when the number of threads is " \
+    "automatic, 0 meaning twice the number of CPUs." )
+
+#define THREAD_TYPE_TEXT N_( "Threading mode" )
+#define THREAD_TYPE_LONGTEXT N_( "Frame threading gives the best throughput " \
+    "but delays pictures by one frame per thread. Slice threading adds no " \
+    "delay but only helps with streams coded with many slices." )
+
 /*
  * Encoder options
  */
@@ -51,7 +51,8 @@
 #include "va.h"
 #include "../../video_chroma/copy.h"
 
-static int Open(vlc_va_t *, AVCodecContext *, const es_format_t *);
+static int Open(vlc_va_t *, AVCodecContext *, const es_format_t *,
+                picture_sys_t *);
 static void Close(vlc_va_t *, AVCodecContext *);
 
 vlc_module_begin()
@@ -70,6 +71,8 @@ vlc_module_end()
 #include <d3d9.h>
 #include <dxva2api.h>
 
+#include "../../video_chroma/d3d9_fmt.h"
+
 #include <initguid.h> /* must be last included to not redefine existing GUIDs */
 
 /* dxva2api.h GUIDs: http://msdn.microsoft.com/en-us/library/windows/desktop/ms697067(v=vs100).aspx
@@ -272,6 +275,10 @@ struct vlc_va_sys_t
     D3DFORMAT                    output;
     copy_cache_t                 surface_cache;
 
+    /* Video output surfaces, when the device is shared with the output */
+    bool                         opaque;
+    D3DFORMAT                    opaque_format;
+
     /* */
     struct dxva_context hw;
 
@@ -289,7 +296,8 @@ struct vlc_va_sys_t
 };
 
 /* */
-static int D3dCreateDevice(vlc_va_t *);
+static int D3dCreateDevice(vlc_va_t *, picture_sys_t *);
+static int D3dShareDevice(vlc_va_t *, picture_sys_t *);
 static void D3dDestroyDevice(vlc_va_sys_t *);
 static char *DxDescribe(vlc_va_sys_t *);
 
@@ -341,23 +349,67 @@ static int Setup(vlc_va_t *va, AVCodecContext *avctx, vlc_fourcc_t *chroma)
     sys->hw.surface = sys->hw_surface;
 
     /* */
-    DxCreateVideoConversion(sys);
+    if (!sys->opaque)
+        DxCreateVideoConversion(sys);
 
     /* */
 ok:
     avctx->hwaccel_context = &sys->hw;
-    const d3d_format_t *output = D3dFindFormat(sys->output);
-    *chroma = output->codec;
+    if (sys->opaque) {
+        *chroma = VLC_CODEC_D3D9_OPAQUE;
+    } else {
+        const d3d_format_t *output = D3dFindFormat(sys->output);
+        *chroma = output->codec;
+    }
 
     return VLC_SUCCESS;
 }
 
+/**
+ * It copies the decoded surface into the surface of the video output
+ * picture, without leaving the GPU.
+ */
+static int ExtractOpaque(vlc_va_t *va, picture_t *picture,
+                         LPDIRECT3DSURFACE9 d3d)
+{
+    vlc_va_sys_t *sys = va->sys;
+    picture_sys_t *p_sys = picture->p_sys;
+    LPDIRECT3DDEVICE9 d3ddev;
+
+    /* The video output may have been recreated with a new device */
+    if (p_sys == NULL
+     || FAILED(IDirect3DSurface9_GetDevice(p_sys->surface, &d3ddev)))
+        return VLC_EGENERIC;
+    IDirect3DDevice9_Release(d3ddev);
+    if (d3ddev != sys->d3ddev) {
+        msg_Err(va, "picture surface of another device");
+        return VLC_EGENERIC;
+    }
+
+    RECT visible = {
+        .right  = picture->format.i_visible_width,
+        .bottom = picture->format.i_visible_height,
+    };
+    HRESULT hr = IDirect3DDevice9_StretchRect(sys->d3ddev, d3d, &visible,
+                                              p_sys->surface, NULL,
+                                              D3DTEXF_NONE);
+    if (FAILED(hr)) {
+        msg_Err(va, "Failed to copy surface (hr=0x%lX)", hr);
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
 static int Extract(vlc_va_t *va, picture_t *picture, void *opaque,
                    uint8_t *data)
 {
     vlc_va_sys_t *sys = va->sys;
     LPDIRECT3DSURFACE9 d3d = (LPDIRECT3DSURFACE9)(uintptr_t)data;
 
+    (void) opaque;
+    if (sys->opaque)
+        return ExtractOpaque(va, picture, d3d);
+
     if (!sys->surface_cache.buffer)
         return VLC_EGENERIC;
 
@@ -412,7 +464,6 @@ static int Extract(vlc_va_t *va, picture_t *picture, void *opaque,
 
     /* */
     IDirect3DSurface9_UnlockRect(d3d);
-    (void) opaque;
     return VLC_SUCCESS;
 }
 
@@ -483,7 +534,8 @@ static void Close(vlc_va_t *va, AVCodecContext *ctx)
     free(sys);
 }
 
-static int Open(vlc_va_t *va, AVCodecContext *ctx, const es_format_t *fmt)
+static int Open(vlc_va_t *va, AVCodecContext *ctx, const es_format_t *fmt,
+                picture_sys_t *p_sys)
 {
     vlc_va_sys_t *sys = calloc(1, sizeof (*sys));
     if (unlikely(sys == NULL))
@@ -507,7 +559,7 @@ static int Open(vlc_va_t *va, AVCodecContext *ctx, const es_format_t *fmt)
     msg_Dbg(va, "DLLs loaded");
 
     /* */
-    if (D3dCreateDevice(va)) {
+    if (D3dCreateDevice(va, p_sys)) {
         msg_Err(va, "Failed to create Direct3D device");
         goto error;
     }
@@ -528,6 +580,10 @@ static int Open(vlc_va_t *va, AVCodecContext *ctx, const es_format_t *fmt)
         msg_Err(va, "DxFindVideoServiceConversion failed");
         goto error;
     }
+    if (sys->opaque && sys->render != sys->opaque_format) {
+        msg_Dbg(va, "decoder surfaces are copied to system memory");
+        sys->opaque = false;
+    }
 
     sys->thread_count = ctx->thread_count;
 
@@ -549,10 +605,13 @@ error:
 /**
  * It creates a Direct3D device usable for DXVA 2
  */
-static int D3dCreateDevice(vlc_va_t *va)
+static int D3dCreateDevice(vlc_va_t *va, picture_sys_t *p_sys)
 {
     vlc_va_sys_t *sys = va->sys;
 
+    if (p_sys != NULL && !D3dShareDevice(va, p_sys))
+        return VLC_SUCCESS;
+
     /* */
     LPDIRECT3D9 (WINAPI *Create9)(UINT SDKVersion);
     Create9 = (void *)GetProcAddress(sys->hd3d9_dll, "Direct3DCreate9");
@@ -610,6 +669,44 @@ static int D3dCreateDevice(vlc_va_t *va)
     return VLC_SUCCESS;
 }
 
+/**
+ * It uses the Direct3D device of the video output pictures, so that the
+ * decoded surfaces can be copied into them
+ */
+static int D3dShareDevice(vlc_va_t *va, picture_sys_t *p_sys)
+{
+    vlc_va_sys_t *sys = va->sys;
+
+    D3DSURFACE_DESC dsc;
+    LPDIRECT3DDEVICE9 d3ddev;
+    if (FAILED(IDirect3DSurface9_GetDesc(p_sys->surface, &dsc))
+     || FAILED(IDirect3DSurface9_GetDevice(p_sys->surface, &d3ddev)))
+        return VLC_EGENERIC;
+
+    LPDIRECT3D9 d3dobj;
+    D3DDEVICE_CREATION_PARAMETERS params;
+    if (FAILED(IDirect3DDevice9_GetDirect3D(d3ddev, &d3dobj))) {
+        IDirect3DDevice9_Release(d3ddev);
+        return VLC_EGENERIC;
+    }
+    sys->d3dobj = d3dobj;
+    sys->d3ddev = d3ddev;
+
+    /* */
+    D3DADAPTER_IDENTIFIER9 *d3dai = &sys->d3dai;
+    if (FAILED(IDirect3DDevice9_GetCreationParameters(d3ddev, &params))
+     || FAILED(IDirect3D9_GetAdapterIdentifier(d3dobj, params.AdapterOrdinal,
+                                               0, d3dai))) {
+        msg_Warn(va, "IDirect3D9_GetAdapterIdentifier failed");
+        ZeroMemory(d3dai, sizeof(*d3dai));
+    }
+
+    sys->opaque = true;
+    sys->opaque_format = dsc.Format;
+    msg_Dbg(va, "using the Direct3D device of the video output");
+    return VLC_SUCCESS;
+}
+
 /**
  * It releases a Direct3D device and its resources.
  */
@@ -811,6 +908,20 @@ static int DxFindVideoServiceConversion(vlc_va_t *va, GUID *input, D3DFORMAT *ou
             }
         }
 
+        /* Decode in the format of the video output surfaces if possible */
+        for (unsigned k = 0; sys->opaque && k < output_count; k++) {
+            if (output_list[k] != sys->opaque_format)
+                continue;
+
+            msg_Dbg(va, "Using '%s' to decode to the video output surfaces",
+                    mode->name);
+            *input  = *mode->guid;
+            *output = sys->opaque_format;
+            CoTaskMemFree(output_list);
+            CoTaskMemFree(input_list);
+            return VLC_SUCCESS;
+        }
+
         /* */
         for (unsigned j = 0; d3d_formats[j].name; j++) {
             const d3d_format_t *format = &d3d_formats[j];
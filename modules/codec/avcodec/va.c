@@ -33,9 +33,11 @@ static int vlc_va_Start(void *func, va_list ap)
     vlc_va_t *va = va_arg(ap, vlc_va_t *);
     AVCodecContext *ctx = va_arg(ap, AVCodecContext *);
     const es_format_t *fmt = va_arg(ap, const es_format_t *);
-    int (*open)(vlc_va_t *, AVCodecContext *, const es_format_t *) = func;
+    picture_sys_t *p_sys = va_arg(ap, picture_sys_t *);
+    int (*open)(vlc_va_t *, AVCodecContext *, const es_format_t *,
+                picture_sys_t *) = func;
 
-    return open(va, ctx, fmt);
+    return open(va, ctx, fmt, p_sys);
 }
 
 static void vlc_va_Stop(void *func, va_list ap)
@@ -47,15 +49,26 @@ static void vlc_va_Stop(void *func, va_list ap)
     close(va, ctx);
 }
 
+vlc_fourcc_t vlc_va_GetChroma(enum PixelFormat hwfmt)
+{
+    switch (hwfmt)
+    {
+        case PIX_FMT_DXVA2_VLD:
+            return VLC_CODEC_D3D9_OPAQUE;
+        default:
+            return 0;
+    }
+}
+
 vlc_va_t *vlc_va_New(vlc_object_t *obj, AVCodecContext *avctx,
-                     const es_format_t *fmt)
+                     const es_format_t *fmt, picture_sys_t *p_sys)
 {
     vlc_va_t *va = vlc_object_create(obj, sizeof (*va));
     if (unlikely(va == NULL))
         return NULL;
 
     va->module = vlc_module_load(va, "hw decoder", "$avcodec-hw", true,
-                                 vlc_va_Start, va, avctx, fmt);
+                                 vlc_va_Start, va, avctx, fmt, p_sys);
     if (va->module == NULL)
     {
         vlc_object_release(va);
@@ -47,9 +47,19 @@ struct vlc_va_t {
  * Creates an accelerated video decoding back-end for libavcodec.
  * @param obj parent VLC object
  * @param fmt VLC format of the content to decode
+ * @param p_sys private data of a picture of the video output pool, if the
+ * pool holds hardware surfaces (see vlc_va_GetChroma()), NULL otherwise
  * @return a new VLC object on success, NULL on error.
  */
-vlc_va_t *vlc_va_New(vlc_object_t *obj, AVCodecContext *, const es_format_t *fmt);
+vlc_va_t *vlc_va_New(vlc_object_t *obj, AVCodecContext *, const es_format_t *fmt,
+                     picture_sys_t *p_sys);
+
+/**
+ * Returns the opaque chroma of the video output pictures the back-ends of
+ * the given hardware pixel format can decode into directly, if any.
+ * @return a VLC chroma, or 0 if the surfaces are always copied
+ */
+vlc_fourcc_t vlc_va_GetChroma(enum PixelFormat hwfmt);
 
 /**
  * Initializes the acceleration video decoding back-end for libavcodec.
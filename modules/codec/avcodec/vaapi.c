@@ -30,6 +30,8 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_fourcc.h>
+#include <vlc_picture.h>
+#include <vlc_atomic.h>
 
 #ifdef VLC_VA_BACKEND_XLIB
 # include <vlc_xlib.h>
@@ -48,28 +50,51 @@
 #include "avcodec.h"
 #include "va.h"
 #include "../../video_chroma/copy.h"
+#include "../../hw/vaapi/vlc_vaapi.h"
 
 #ifndef VA_SURFACE_ATTRIB_SETTABLE
 #define vaCreateSurfaces(d, f, w, h, s, ns, a, na) \
     vaCreateSurfaces(d, w, h, f, ns, s)
 #endif
 
-typedef struct
-{
-    VASurfaceID  i_id;
-    int          i_refcount;
-    unsigned int i_order;
-    vlc_mutex_t *p_lock;
-} vlc_va_surface_t;
+/* Surfaces queued in or displayed by the video output */
+#define VAAPI_OUTPUT_SURFACES 4
 
-struct vlc_va_sys_t
+#define ZERO_COPY_TEXT N_("Zero-copy output")
+#define ZERO_COPY_LONGTEXT N_( \
+    "Pass the decoded VA surfaces to the video output rather than copying " \
+    "them to system memory.")
+
+typedef struct
 {
 #ifdef VLC_VA_BACKEND_XLIB
-        Display  *p_display_x11;
+    Display         *p_display_x11;
 #endif
 #ifdef VLC_VA_BACKEND_DRM
-        int       drm_fd;
+    int              drm_fd;
 #endif
+    VADisplay        p_display;
+    atomic_uintptr_t refs;
+} vlc_va_instance_t;
+
+/* A VA surface is referenced by its decoder surface pool, by libavcodec
+ * frames and by the pictures it is attached to. */
+typedef struct
+{
+    VASurfaceID        i_id;
+    atomic_uintptr_t   refs;
+    vlc_va_instance_t *p_instance;
+} vlc_va_surface_t;
+
+typedef struct
+{
+    vlc_vaapi_surface_t context; /* must be first */
+    vlc_va_surface_t   *p_surface;
+} vlc_va_picture_t;
+
+struct vlc_va_sys_t
+{
+    vlc_va_instance_t *p_instance;
     VADisplay     p_display;
 
     VAConfigID    i_config_id;
@@ -78,21 +103,55 @@ struct vlc_va_sys_t
     struct vaapi_context hw_ctx;
 
     /* */
-    vlc_mutex_t  lock;
     int          i_surface_count;
-    unsigned int i_surface_order;
     int          i_surface_width;
     int          i_surface_height;
     vlc_fourcc_t i_surface_chroma;
 
-    vlc_va_surface_t *p_surface;
+    vlc_va_surface_t **pp_surface;
 
     VAImage      image;
     copy_cache_t image_cache;
 
     bool b_supports_derive;
+    bool b_opaque;
 };
 
+static void InstanceRelease( vlc_va_instance_t *p_instance )
+{
+    if( atomic_fetch_sub( &p_instance->refs, 1 ) != 1 )
+        return;
+
+    vaTerminate( p_instance->p_display );
+#ifdef VLC_VA_BACKEND_XLIB
+    XCloseDisplay( p_instance->p_display_x11 );
+#endif
+#ifdef VLC_VA_BACKEND_DRM
+    close( p_instance->drm_fd );
+#endif
+    free( p_instance );
+}
+
+static void SurfaceRelease( vlc_va_surface_t *p_surface )
+{
+    if( atomic_fetch_sub( &p_surface->refs, 1 ) != 1 )
+        return;
+
+    vlc_va_instance_t *p_instance = p_surface->p_instance;
+
+    vaDestroySurfaces( p_instance->p_display, &p_surface->i_id, 1 );
+    free( p_surface );
+    InstanceRelease( p_instance );
+}
+
+static void PictureDestroy( void *opaque )
+{
+    vlc_va_picture_t *p_pic = opaque;
+
+    SurfaceRelease( p_pic->p_surface );
+    free( p_pic );
+}
+
 static void DestroySurfaces( vlc_va_sys_t *sys )
 {
     if( sys->image.image_id != VA_INVALID_ID )
@@ -108,22 +167,18 @@ static void DestroySurfaces( vlc_va_sys_t *sys )
     if( sys->i_context_id != VA_INVALID_ID )
         vaDestroyContext( sys->p_display, sys->i_context_id );
 
-    for( int i = 0; i < sys->i_surface_count && sys->p_surface; i++ )
-    {
-        vlc_va_surface_t *p_surface = &sys->p_surface[i];
-
-        if( p_surface->i_id != VA_INVALID_SURFACE )
-            vaDestroySurfaces( sys->p_display, &p_surface->i_id, 1 );
-    }
-    free( sys->p_surface );
+    /* Surfaces still attached to pictures are destroyed with them */
+    for( int i = 0; i < sys->i_surface_count && sys->pp_surface; i++ )
+        if( sys->pp_surface[i] != NULL )
+            SurfaceRelease( sys->pp_surface[i] );
+    free( sys->pp_surface );
 
     /* */
     sys->image.image_id = VA_INVALID_ID;
     sys->i_context_id = VA_INVALID_ID;
-    sys->p_surface = NULL;
+    sys->pp_surface = NULL;
     sys->i_surface_width = 0;
     sys->i_surface_height = 0;
-    vlc_mutex_destroy(&sys->lock);
 }
 
 static int CreateSurfaces( vlc_va_sys_t *sys, void **pp_hw_ctx, vlc_fourcc_t *pi_chroma,
@@ -132,8 +187,8 @@ static int CreateSurfaces( vlc_va_sys_t *sys, void **pp_hw_ctx, vlc_fourcc_t *pi
     assert( i_width > 0 && i_height > 0 );
 
     /* */
-    sys->p_surface = calloc( sys->i_surface_count, sizeof(*sys->p_surface) );
-    if( !sys->p_surface )
+    sys->pp_surface = calloc( sys->i_surface_count, sizeof(*sys->pp_surface) );
+    if( !sys->pp_surface )
         return VLC_EGENERIC;
     sys->image.image_id = VA_INVALID_ID;
     sys->i_context_id   = VA_INVALID_ID;
@@ -142,20 +197,23 @@ static int CreateSurfaces( vlc_va_sys_t *sys, void **pp_hw_ctx, vlc_fourcc_t *pi
     VASurfaceID pi_surface_id[sys->i_surface_count];
     if( vaCreateSurfaces( sys->p_display, VA_RT_FORMAT_YUV420, i_width, i_height,
                           pi_surface_id, sys->i_surface_count, NULL, 0 ) )
-    {
-        for( int i = 0; i < sys->i_surface_count; i++ )
-            sys->p_surface[i].i_id = VA_INVALID_SURFACE;
         goto error;
-    }
 
     for( int i = 0; i < sys->i_surface_count; i++ )
     {
-        vlc_va_surface_t *p_surface = &sys->p_surface[i];
+        vlc_va_surface_t *p_surface = malloc( sizeof(*p_surface) );
+        if( unlikely(p_surface == NULL) )
+        {
+            vaDestroySurfaces( sys->p_display, &pi_surface_id[i],
+                               sys->i_surface_count - i );
+            goto error;
+        }
 
         p_surface->i_id = pi_surface_id[i];
-        p_surface->i_refcount = 0;
-        p_surface->i_order = 0;
-        p_surface->p_lock = &sys->lock;
+        atomic_init( &p_surface->refs, 1 );
+        p_surface->p_instance = sys->p_instance;
+        atomic_fetch_add( &sys->p_instance->refs, 1 );
+        sys->pp_surface[i] = p_surface;
     }
 
     /* Create a context */
@@ -167,6 +225,14 @@ static int CreateSurfaces( vlc_va_sys_t *sys, void **pp_hw_ctx, vlc_fourcc_t *pi
         goto error;
     }
 
+    vlc_fourcc_t  i_chroma = 0;
+    if( sys->b_opaque )
+    {
+        /* The surfaces are handed over to the video output as is */
+        i_chroma = VLC_CODEC_VAAPI_420;
+        goto done;
+    }
+
     /* Find and create a supported image chroma */
     int i_fmt_count = vaMaxNumImageFormats( sys->p_display );
     VAImageFormat *p_fmt = calloc( i_fmt_count, sizeof(*p_fmt) );
@@ -188,7 +254,6 @@ static int CreateSurfaces( vlc_va_sys_t *sys, void **pp_hw_ctx, vlc_fourcc_t *pi
         vaDestroyImage(sys->p_display, test_image.image_id);
     }
 
-    vlc_fourcc_t  i_chroma = 0;
     int nv12support = -1;
     for( int i = 0; i < i_fmt_count; i++ )
     {
@@ -242,7 +307,6 @@ static int CreateSurfaces( vlc_va_sys_t *sys, void **pp_hw_ctx, vlc_fourcc_t *pi
     free( p_fmt );
     if( !i_chroma )
         goto error;
-    *pi_chroma = i_chroma;
 
     if(sys->b_supports_derive)
     {
@@ -253,6 +317,9 @@ static int CreateSurfaces( vlc_va_sys_t *sys, void **pp_hw_ctx, vlc_fourcc_t *pi
     if( unlikely(CopyInitCache( &sys->image_cache, i_width )) )
         goto error;
 
+done:
+    *pi_chroma = i_chroma;
+
     /* Setup the ffmpeg hardware context */
     *pp_hw_ctx = &sys->hw_ctx;
 
@@ -272,6 +339,23 @@ error:
     return VLC_EGENERIC;
 }
 
+static int Attach( picture_t *p_picture, vlc_va_surface_t *p_surface )
+{
+    vlc_va_picture_t *p_pic = malloc( sizeof(*p_pic) );
+    if( unlikely(p_pic == NULL) )
+        return VLC_ENOMEM;
+
+    p_pic->context.destroy = PictureDestroy;
+    p_pic->context.display = p_surface->p_instance->p_display;
+    p_pic->context.id = p_surface->i_id;
+    p_pic->p_surface = p_surface;
+    atomic_fetch_add( &p_surface->refs, 1 );
+
+    assert( p_picture->context == NULL );
+    p_picture->context = p_pic;
+    return VLC_SUCCESS;
+}
+
 static int Extract( vlc_va_t *va, picture_t *p_picture, void *opaque,
                     uint8_t *data )
 {
@@ -285,6 +369,9 @@ static int Extract( vlc_va_t *va, picture_t *p_picture, void *opaque,
 #endif
         return VLC_EGENERIC;
 
+    if( sys->b_opaque )
+        return Attach( p_picture, opaque );
+
     if(sys->b_supports_derive)
     {
         if(vaDeriveImage(sys->p_display, i_surface_id, &(sys->image)) != VA_STATUS_SUCCESS)
@@ -346,37 +433,38 @@ static int Extract( vlc_va_t *va, picture_t *p_picture, void *opaque,
         vaDestroyImage( sys->p_display, sys->image.image_id );
         sys->image.image_id = VA_INVALID_ID;
     }
-    (void) opaque;
     return VLC_SUCCESS;
 }
 
+static vlc_va_surface_t *GetSurface( vlc_va_sys_t *sys )
+{
+    for( int i = 0; i < sys->i_surface_count; i++ )
+    {
+        vlc_va_surface_t *p_surface = sys->pp_surface[i];
+        uintptr_t expected = 1;
+
+        /* Only the pool holds the surface: it is free */
+        if( atomic_compare_exchange_strong( &p_surface->refs, &expected, 2 ) )
+            return p_surface;
+    }
+    return NULL;
+}
+
 static int Get( vlc_va_t *va, void **opaque, uint8_t **data )
 {
     vlc_va_sys_t *sys = va->sys;
-    int i_old;
-    int i;
+    vlc_va_surface_t *p_surface;
+    unsigned tries = (CLOCK_FREQ + VOUT_OUTMEM_SLEEP) / VOUT_OUTMEM_SLEEP;
 
-    vlc_mutex_lock( &sys->lock );
-    /* Grab an unused surface, in case none are, try the oldest
-     * XXX using the oldest is a workaround in case a problem happens with ffmpeg */
-    for( i = 0, i_old = 0; i < sys->i_surface_count; i++ )
+    while( (p_surface = GetSurface( sys )) == NULL )
     {
-        vlc_va_surface_t *p_surface = &sys->p_surface[i];
-
-        if( !p_surface->i_refcount )
-            break;
-
-        if( p_surface->i_order < sys->p_surface[i_old].i_order )
-            i_old = i;
+        if( --tries == 0 )
+            return VLC_ENOMEM;
+        /* All surfaces are either references or pending display: wait for
+         * the video output to release some as in src/input/decoder.c. */
+        msleep( VOUT_OUTMEM_SLEEP );
     }
-    if( i >= sys->i_surface_count )
-        i = i_old;
-    vlc_mutex_unlock( &sys->lock );
-
-    vlc_va_surface_t *p_surface = &sys->p_surface[i];
 
-    p_surface->i_refcount = 1;
-    p_surface->i_order = sys->i_surface_order++;
     *data = (void *)(uintptr_t)p_surface->i_id;
     *opaque = p_surface;
     return VLC_SUCCESS;
@@ -384,11 +472,7 @@ static int Get( vlc_va_t *va, void **opaque, uint8_t **data )
 
 static void Release( void *opaque, uint8_t *data )
 {
-    vlc_va_surface_t *p_surface = opaque;
-
-    vlc_mutex_lock( p_surface->p_lock );
-    p_surface->i_refcount--;
-    vlc_mutex_unlock( p_surface->p_lock );
+    SurfaceRelease( opaque );
     (void) data;
 }
 
@@ -426,19 +510,16 @@ static void Delete( vlc_va_t *va, AVCodecContext *avctx )
 
     if( sys->i_config_id != VA_INVALID_ID )
         vaDestroyConfig( sys->p_display, sys->i_config_id );
-    vaTerminate( sys->p_display );
-#ifdef VLC_VA_BACKEND_XLIB
-    XCloseDisplay( sys->p_display_x11 );
-#endif
-#ifdef VLC_VA_BACKEND_DRM
-    close( sys->drm_fd );
-#endif
+    /* The display outlives the decoder if pictures are still displayed */
+    InstanceRelease( sys->p_instance );
     free( sys );
 }
 
-static int Create( vlc_va_t *va, AVCodecContext *ctx, const es_format_t *fmt )
+static int Create( vlc_va_t *va, AVCodecContext *ctx, const es_format_t *fmt,
+                   picture_sys_t *p_sys )
 {
     (void) fmt;
+    (void) p_sys;
 #ifdef VLC_VA_BACKEND_XLIB
     if( !vlc_xlib_init( VLC_OBJECT(va) ) )
     {
@@ -450,6 +531,12 @@ static int Create( vlc_va_t *va, AVCodecContext *ctx, const es_format_t *fmt )
     vlc_va_sys_t *sys = calloc( 1, sizeof(*sys) );
     if ( unlikely(sys == NULL) )
        return VLC_ENOMEM;
+    vlc_va_instance_t *p_instance = calloc( 1, sizeof(*p_instance) );
+    if ( unlikely(p_instance == NULL) )
+    {
+       free( sys );
+       return VLC_ENOMEM;
+    }
 
     VAProfile i_profile, *p_profiles_list;
     bool b_supported_profile = false;
@@ -481,6 +568,7 @@ static int Create( vlc_va_t *va, AVCodecContext *ctx, const es_format_t *fmt )
         i_surface_count = 16 + ctx->thread_count + 2;
         break;;
     default:
+        free( p_instance );
         free( sys );
         return VLC_EGENERIC;
     }
@@ -492,26 +580,26 @@ static int Create( vlc_va_t *va, AVCodecContext *ctx, const es_format_t *fmt )
 
     /* Create a VA display */
 #ifdef VLC_VA_BACKEND_XLIB
-    sys->p_display_x11 = XOpenDisplay(NULL);
-    if( !sys->p_display_x11 )
+    p_instance->p_display_x11 = XOpenDisplay(NULL);
+    if( !p_instance->p_display_x11 )
     {
         msg_Err( va, "Could not connect to X server" );
         goto error;
     }
 
-    sys->p_display = vaGetDisplay( sys->p_display_x11 );
+    p_instance->p_display = vaGetDisplay( p_instance->p_display_x11 );
 #endif
 #ifdef VLC_VA_BACKEND_DRM
-    sys->drm_fd = vlc_open("/dev/dri/card0", O_RDWR);
-    if( sys->drm_fd == -1 )
+    p_instance->drm_fd = vlc_open("/dev/dri/card0", O_RDWR);
+    if( p_instance->drm_fd == -1 )
     {
         msg_Err( va, "Could not access rendering device: %m" );
         goto error;
     }
 
-    sys->p_display = vaGetDisplayDRM( sys->drm_fd );
+    p_instance->p_display = vaGetDisplayDRM( p_instance->drm_fd );
 #endif
-    if( !sys->p_display )
+    if( !p_instance->p_display )
     {
         msg_Err( va, "Could not get a VAAPI device" );
         goto error;
@@ -519,11 +607,14 @@ static int Create( vlc_va_t *va, AVCodecContext *ctx, const es_format_t *fmt )
 
     int major, minor;
 
-    if( vaInitialize( sys->p_display, &major, &minor ) )
+    if( vaInitialize( p_instance->p_display, &major, &minor ) )
     {
         msg_Err( va, "Failed to initialize the VAAPI device" );
         goto error;
     }
+    atomic_init( &p_instance->refs, 1 );
+    sys->p_instance = p_instance;
+    sys->p_display = p_instance->p_display;
 
     /* Check if the selected profile is supported */
     i_profiles_nb = vaMaxNumProfiles( sys->p_display );
@@ -571,8 +662,15 @@ static int Create( vlc_va_t *va, AVCodecContext *ctx, const es_format_t *fmt )
     sys->i_surface_count = i_surface_count;
 
     sys->b_supports_derive = false;
-
-    vlc_mutex_init(&sys->lock);
+#ifdef VLC_VA_BACKEND_DRM
+    /* Pass the surfaces to the video output, which either imports them
+     * directly or converts them through the vaapi chroma filter. */
+    sys->b_opaque = var_InheritBool( va, "vaapi-zero-copy" );
+    if( sys->b_opaque )
+        sys->i_surface_count += VAAPI_OUTPUT_SURFACES;
+#else
+    sys->b_opaque = false;
+#endif
 
     va->sys = sys;
     va->description = vaQueryVendorString( sys->p_display );
@@ -584,16 +682,25 @@ static int Create( vlc_va_t *va, AVCodecContext *ctx, const es_format_t *fmt )
     return VLC_SUCCESS;
 
 error:
-    if( sys->p_display != NULL )
-        vaTerminate( sys->p_display );
+    if( sys->p_instance != NULL )
+    {
+        if( sys->i_config_id != VA_INVALID_ID )
+            vaDestroyConfig( sys->p_display, sys->i_config_id );
+        InstanceRelease( p_instance );
+        free( sys );
+        return VLC_EGENERIC;
+    }
+    if( p_instance->p_display != NULL )
+        vaTerminate( p_instance->p_display );
 #ifdef VLC_VA_BACKEND_XLIB
-    if( sys->p_display_x11 != NULL )
-        XCloseDisplay( sys->p_display_x11 );
+    if( p_instance->p_display_x11 != NULL )
+        XCloseDisplay( p_instance->p_display_x11 );
 #endif
 #ifdef VLC_VA_BACKEND_DRM
-    if( sys->drm_fd != -1 )
-        close( sys->drm_fd );
+    if( p_instance->drm_fd != -1 )
+        close( p_instance->drm_fd );
 #endif
+    free( p_instance );
     free( sys );
     return VLC_EGENERIC;
 }
@@ -609,4 +716,8 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_VCODEC )
     set_callbacks( Create, Delete )
     add_shortcut( "vaapi" )
+#if defined (VLC_VA_BACKEND_DRM)
+    add_bool( "vaapi-zero-copy", true, ZERO_COPY_TEXT, ZERO_COPY_LONGTEXT,
+              true )
+#endif
 vlc_module_end ()
@@ -44,7 +44,8 @@
 
 #pragma mark prototypes and definitions
 
-static int Open( vlc_va_t *, AVCodecContext *, const es_format_t * );
+static int Open( vlc_va_t *, AVCodecContext *, const es_format_t *,
+                 picture_sys_t * );
 static void Close( vlc_va_t * , AVCodecContext *);
 static int Setup( vlc_va_t *, AVCodecContext *, vlc_fourcc_t *);
 static int Get( vlc_va_t *, void **, uint8_t ** );
@@ -117,8 +118,9 @@ static vlc_va_vda_t *vlc_va_vda_Get( vlc_va_t *va )
 #pragma mark - module handling
 
 static int Open( vlc_va_t *va, AVCodecContext *ctx,
-                 const es_format_t *fmt )
+                 const es_format_t *fmt, picture_sys_t *p_sys )
 {
+    VLC_UNUSED( p_sys );
     msg_Dbg( va, "opening VDA module" );
     if( ctx->codec_id != AV_CODEC_ID_H264 )
     {
@@ -322,7 +324,8 @@ vlc_module_begin ()
     set_callbacks( Open, Close )
 vlc_module_end ()
 
-static int Open( vlc_va_t *va, AVCodecContext *avctx, const es_format_t *fmt )
+static int Open( vlc_va_t *va, AVCodecContext *avctx, const es_format_t *fmt,
+                 picture_sys_t *p_sys )
 {
     msg_Dbg( va, "VDA decoder Open");
 
@@ -336,6 +339,7 @@ static int Open( vlc_va_t *va, AVCodecContext *avctx, const es_format_t *fmt )
 
     (void) fmt;
     (void) avctx;
+    (void) p_sys;
 
     return VLC_SUCCESS;
 }
@@ -41,6 +41,7 @@
 
 #include "avcodec.h"
 #include "va.h"
+#include "../decoder_threads.h"
 
 /*****************************************************************************
  * decoder_sys_t : decoder descriptor
@@ -57,6 +58,7 @@ struct decoder_sys_t
     /* for frame skipping algo */
     bool b_hurry_up;
     enum AVDiscard i_skip_frame;
+    enum AVDiscard i_skip_loop_filter;
 
     /* how many decoded frames are late */
     int     i_late_frames;
@@ -80,8 +82,12 @@ struct decoder_sys_t
 
     /* VA API */
     vlc_va_t *p_va;
+    bool b_va_surfaces; /* fmt_out holds a hardware surface chroma */
 
     vlc_sem_t sem_mt;
+
+    /* Threads taken from the decoder thread budget */
+    int i_threads;
 };
 
 #ifdef HAVE_AVCODEC_MT
@@ -97,6 +103,7 @@ struct decoder_sys_t
  *****************************************************************************/
 static void ffmpeg_InitCodec      ( decoder_t * );
 static void ffmpeg_CopyPicture    ( decoder_t *, picture_t *, AVFrame * );
+static void ffmpeg_SetQP          ( picture_t *, AVFrame * );
 #if LIBAVCODEC_VERSION_MAJOR >= 55
 static int lavc_GetFrame(struct AVCodecContext *, AVFrame *, int);
 #else
@@ -124,8 +131,9 @@ static inline picture_t *ffmpeg_NewPictBuf( decoder_t *p_dec,
     decoder_sys_t *p_sys = p_dec->p_sys;
     int width = p_context->coded_width;
     int height = p_context->coded_height;
+    bool b_hwaccel = p_sys->p_va != NULL || p_sys->b_va_surfaces;
 
-    if( p_sys->p_va == NULL )
+    if( !b_hwaccel )
     {
         int aligns[AV_NUM_DATA_POINTERS];
 
@@ -152,7 +160,7 @@ static inline picture_t *ffmpeg_NewPictBuf( decoder_t *p_dec,
         p_dec->fmt_out.video.i_visible_height = height;
     }
 
-    if( !p_sys->p_va && GetVlcChroma( &p_dec->fmt_out.video, p_context->pix_fmt ) )
+    if( !b_hwaccel && GetVlcChroma( &p_dec->fmt_out.video, p_context->pix_fmt ) )
     {
         /* we are doomed, but not really, because most codecs set their pix_fmt
          * much later
@@ -196,6 +204,143 @@ static inline picture_t *ffmpeg_NewPictBuf( decoder_t *p_dec,
     return decoder_NewPicture( p_dec );
 }
 
+#ifdef HAVE_AVCODEC_MT
+/*****************************************************************************
+ * Decoder thread budget (see decoder_threads.h)
+ *****************************************************************************/
+static int GetWantedThreads( decoder_t *p_dec )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+    int i_thread_count = var_InheritInteger( p_dec, "avcodec-threads" );
+
+    if( i_thread_count > 0 )
+        return __MIN( i_thread_count, 16 );
+
+    const unsigned i_pixels = p_sys->p_context->width
+                            * p_sys->p_context->height;
+    if( i_pixels == 0 )
+        return 4;
+
+    /* One thread per quarter of 1080p, more for the heavier codecs */
+    i_thread_count = ( i_pixels + 518399 ) / 518400;
+    switch( p_sys->p_codec->id )
+    {
+#if LIBAVCODEC_VERSION_CHECK( 55, 24, 0, 37, 100 )
+        case AV_CODEC_ID_HEVC:
+#endif
+#if LIBAVCODEC_VERSION_CHECK( 54, 41, 0, 89, 100 )
+        case AV_CODEC_ID_VP9:
+#endif
+            i_thread_count += i_thread_count / 2;
+            break;
+        default:
+            break;
+    }
+    return VLC_CLIP( i_thread_count, 1, 16 );
+}
+
+static int AcquireThreads( decoder_t *p_dec, int i_wanted )
+{
+    /* An explicit thread count is honored as is */
+    return decoder_threads_Acquire( p_dec, i_wanted,
+                   var_InheritInteger( p_dec, "avcodec-thread-budget" ),
+                   var_InheritInteger( p_dec, "avcodec-threads" ) > 0 );
+}
+
+static void ReleaseThreads( decoder_t *p_dec )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+
+    if( p_sys->i_threads == 0 )
+        return;
+
+    decoder_threads_Release( p_dec, p_sys->i_threads );
+    p_sys->i_threads = 0;
+}
+
+static void SetupThreads( decoder_t *p_dec )
+{
+    decoder_sys_t *p_sys = p_dec->p_sys;
+    AVCodecContext *p_context = p_sys->p_context;
+
+    p_sys->i_threads = AcquireThreads( p_dec, GetWantedThreads( p_dec ) );
+    p_context->thread_count = p_sys->i_threads;
+    p_context->thread_safe_callbacks = true;
+
+    switch( p_sys->p_codec->id )
+    {
+        case AV_CODEC_ID_MPEG4:
+        case AV_CODEC_ID_H263:
+            p_context->thread_type = 0;
+            break;
+        case AV_CODEC_ID_MPEG1VIDEO:
+        case AV_CODEC_ID_MPEG2VIDEO:
+            p_context->thread_type &= ~FF_THREAD_SLICE;
+            /* fall through */
+# if (LIBAVCODEC_VERSION_INT < AV_VERSION_INT(55, 1, 0))
+        case AV_CODEC_ID_H264:
+        case AV_CODEC_ID_VC1:
+        case AV_CODEC_ID_WMV3:
+            p_context->thread_type &= ~FF_THREAD_FRAME;
+# endif
+        default:
+            break;
+    }
+
+    /* Frame threading delays the output by one frame per thread, while
+     * slice threading adds no latency but only scales with the number of
+     * slices. Intra-only codecs are coded with many slices and gain nothing
+     * from frame threading but the delay. */
+    switch( var_InheritInteger( p_dec, "avcodec-thread-type" ) )
+    {
+        case 1: /* frame */
+            if( p_context->thread_type & FF_THREAD_FRAME )
+                p_context->thread_type = FF_THREAD_FRAME;
+            break;
+        case 2: /* slice */
+            if( p_context->thread_type & FF_THREAD_SLICE )
+                p_context->thread_type = FF_THREAD_SLICE;
+            break;
+        default:
+            switch( p_sys->p_codec->id )
+            {
+                case AV_CODEC_ID_DVVIDEO:
+                case AV_CODEC_ID_DNXHD:
+                case AV_CODEC_ID_FFV1:
+                case AV_CODEC_ID_PRORES:
+                    if( p_context->thread_type & FF_THREAD_SLICE )
+                        p_context->thread_type = FF_THREAD_SLICE;
+                    break;
+                default:
+                    break;
+            }
+            break;
+    }
+
+    /* Frame threading delays pictures, which defeats the low-latency mode */
+    if( var_InheritBool( p_dec, "low-latency" ) )
+        p_context->thread_type &= ~FF_THREAD_FRAME;
+
+    /* Workaround: frame multithreading is not compatible with
+     * DXVA2. When a frame is being copied to host memory, the frame
+     * is locked and cannot be used as a reference frame
+     * simultaneously and thus decoding fails for some frames. This
+     * causes major image corruption. */
+# if defined(_WIN32)
+    char *avcodec_hw = var_InheritString( p_dec, "avcodec-hw" );
+    if( avcodec_hw == NULL || strcasecmp( avcodec_hw, "none" ) )
+    {
+        msg_Warn( p_dec, "threaded frame decoding is not compatible with DXVA2, disabled" );
+        p_context->thread_type &= ~FF_THREAD_FRAME;
+    }
+    free( avcodec_hw );
+# endif
+
+    if( p_context->thread_type & FF_THREAD_FRAME )
+        p_dec->i_extra_picture_buffers = 2 * p_context->thread_count;
+}
+#endif
+
 static int OpenVideoCodec( decoder_t *p_dec )
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
@@ -223,9 +368,18 @@ static int OpenVideoCodec( decoder_t *p_dec )
         p_sys->p_context->coded_height = p_dec->fmt_in.video.i_height;
     p_sys->p_context->bits_per_coded_sample = p_dec->fmt_in.video.i_bits_per_pixel;
 
+#ifdef HAVE_AVCODEC_MT
+    SetupThreads( p_dec );
+#endif
+
     int ret = ffmpeg_OpenCodec( p_dec );
     if( ret < 0 )
+    {
+#ifdef HAVE_AVCODEC_MT
+        ReleaseThreads( p_dec );
+#endif
         return ret;
+    }
 
 #ifdef HAVE_AVCODEC_MT
     switch( p_sys->p_context->active_thread_type )
@@ -272,6 +426,7 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     p_sys->p_ff_pic = avcodec_alloc_frame();
     p_sys->b_delayed_open = true;
     p_sys->p_va = NULL;
+    p_sys->b_va_surfaces = false;
     vlc_sem_init( &p_sys->sem_mt, 0 );
 
     /* ***** Fill p_context with init values ***** */
@@ -297,10 +452,15 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     else if( i_val == 3 ) p_context->skip_loop_filter = AVDISCARD_NONKEY;
     else if( i_val == 2 ) p_context->skip_loop_filter = AVDISCARD_BIDIR;
     else if( i_val == 1 ) p_context->skip_loop_filter = AVDISCARD_NONREF;
+    p_sys->i_skip_loop_filter = p_context->skip_loop_filter;
 
     if( var_CreateGetBool( p_dec, "avcodec-fast" ) )
         p_context->flags2 |= CODEC_FLAG2_FAST;
 
+    /* Do not hold back pictures to reorder them */
+    if( var_InheritBool( p_dec, "low-latency" ) )
+        p_context->flags |= CODEC_FLAG_LOW_DELAY;
+
     /* ***** libavcodec frame skipping ***** */
     p_sys->b_hurry_up = var_CreateGetBool( p_dec, "avcodec-hurry-up" );
 
@@ -360,60 +520,6 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
 #endif
     p_context->opaque = p_dec;
 
-#ifdef HAVE_AVCODEC_MT
-    int i_thread_count = var_InheritInteger( p_dec, "avcodec-threads" );
-    if( i_thread_count <= 0 )
-    {
-        i_thread_count = vlc_GetCPUCount();
-        if( i_thread_count > 1 )
-            i_thread_count++;
-
-        //FIXME: take in count the decoding time
-        i_thread_count = __MIN( i_thread_count, 4 );
-    }
-    i_thread_count = __MIN( i_thread_count, 16 );
-    msg_Dbg( p_dec, "allowing %d thread(s) for decoding", i_thread_count );
-    p_context->thread_count = i_thread_count;
-    p_context->thread_safe_callbacks = true;
-
-    switch( p_codec->id )
-    {
-        case AV_CODEC_ID_MPEG4:
-        case AV_CODEC_ID_H263:
-            p_context->thread_type = 0;
-            break;
-        case AV_CODEC_ID_MPEG1VIDEO:
-        case AV_CODEC_ID_MPEG2VIDEO:
-            p_context->thread_type &= ~FF_THREAD_SLICE;
-            /* fall through */
-# if (LIBAVCODEC_VERSION_INT < AV_VERSION_INT(55, 1, 0))
-        case AV_CODEC_ID_H264:
-        case AV_CODEC_ID_VC1:
-        case AV_CODEC_ID_WMV3:
-            p_context->thread_type &= ~FF_THREAD_FRAME;
-# endif
-        default:
-            break;
-    }
-
-    /* Workaround: frame multithreading is not compatible with
-     * DXVA2. When a frame is being copied to host memory, the frame
-     * is locked and cannot be used as a reference frame
-     * simultaneously and thus decoding fails for some frames. This
-     * causes major image corruption. */
-# if defined(_WIN32)
-    char *avcodec_hw = var_InheritString( p_dec, "avcodec-hw" );
-    if( avcodec_hw == NULL || strcasecmp( avcodec_hw, "none" ) )
-    {
-        msg_Warn( p_dec, "threaded frame decoding is not compatible with DXVA2, disabled" );
-        p_context->thread_type &= ~FF_THREAD_FRAME;
-    }
-    free( avcodec_hw );
-# endif
-
-    if( p_context->thread_type & FF_THREAD_FRAME )
-        p_dec->i_extra_picture_buffers = 2 * p_context->thread_count;
-#endif
 
     /* ***** misc init ***** */
     p_sys->i_pts = VLC_TS_INVALID;
@@ -529,38 +635,34 @@ static picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
         return NULL;
     }
 
-    /* A good idea could be to decode all I pictures and see for the other */
-    if( !p_dec->b_pace_control &&
-        p_sys->b_hurry_up &&
-        (p_sys->i_late_frames > 4) )
+    /* Skip the work the drop policy of the decoder owner asks to, before
+     * decoding: non-reference frames, then the loop filter, then all but
+     * the key frames */
+    if( p_sys->b_hurry_up )
     {
-        b_drawpicture = 0;
-        if( p_sys->i_late_frames < 12 )
-        {
-            p_context->skip_frame =
-                    (p_sys->i_skip_frame <= AVDISCARD_NONREF) ?
-                    AVDISCARD_NONREF : p_sys->i_skip_frame;
-        }
-        else
+        int i_skip_frame = p_sys->i_skip_frame;
+        int i_skip_loop_filter = p_sys->i_skip_loop_filter;
+
+        switch( decoder_GetDropLevel( p_dec ) )
         {
-            /* picture too late, won't decode
-             * but break picture until a new I, and for mpeg4 ...*/
-            p_sys->i_late_frames--; /* needed else it will never be decrease */
-            if( p_block )
-                block_Release( p_block );
-            msg_Warn( p_dec, "More than 4 late frames, dropping frame" );
-            return NULL;
+            case DECODER_DROP_NONKEY:
+                i_skip_frame = __MAX( i_skip_frame, AVDISCARD_NONKEY );
+                /* fall through */
+            case DECODER_DROP_LOOPFILTER:
+                i_skip_loop_filter = __MAX( i_skip_loop_filter, AVDISCARD_ALL );
+                /* fall through */
+            case DECODER_DROP_NONREF:
+                i_skip_frame = __MAX( i_skip_frame, AVDISCARD_NONREF );
+                break;
         }
+        p_context->skip_frame = i_skip_frame;
+        p_context->skip_loop_filter = i_skip_loop_filter;
     }
+
+    if( !p_block || !(p_block->i_flags & BLOCK_FLAG_PREROLL) )
+        b_drawpicture = 1;
     else
-    {
-        if( p_sys->b_hurry_up )
-            p_context->skip_frame = p_sys->i_skip_frame;
-        if( !p_block || !(p_block->i_flags & BLOCK_FLAG_PREROLL) )
-            b_drawpicture = 1;
-        else
-            b_drawpicture = 0;
-    }
+        b_drawpicture = 0;
 
     if( p_context->width <= 0 || p_context->height <= 0 )
     {
@@ -757,6 +859,7 @@ static picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
             p_pic = (picture_t *)p_sys->p_ff_pic->opaque;
             picture_Hold( p_pic );
         }
+        ffmpeg_SetQP( p_pic, p_sys->p_ff_pic );
 
         if( !p_dec->fmt_in.video.i_sar_num || !p_dec->fmt_in.video.i_sar_den )
         {
@@ -821,6 +924,9 @@ void EndVideoDec( decoder_t *p_dec )
     wait_mt( p_sys );
 
     ffmpeg_CloseCodec( p_dec );
+#ifdef HAVE_AVCODEC_MT
+    ReleaseThreads( p_dec );
+#endif
 
     if( p_sys->p_ff_pic )
         avcodec_free_frame( &p_sys->p_ff_pic );
@@ -954,6 +1060,43 @@ static void ffmpeg_CopyPicture( decoder_t *p_dec,
     }
 }
 
+/*****************************************************************************
+ * ffmpeg_SetQP: attach the quantizers of the frame to the picture, for the
+ *               post processing filters
+ *****************************************************************************/
+static void ffmpeg_SetQP( picture_t *p_pic, AVFrame *p_ff_pic )
+{
+    picture_qp_t *p_qp = NULL;
+
+#if LIBAVUTIL_VERSION_MICRO >= 100 \
+ && LIBAVUTIL_VERSION_INT >= AV_VERSION_INT( 54, 0, 100 ) \
+ && ( !defined(FF_API_FRAME_QP) || FF_API_FRAME_QP )
+    int i_stride, i_type;
+    const int8_t *p_table = av_frame_get_qp_table( p_ff_pic, &i_stride,
+                                                   &i_type );
+    if( p_table != NULL && i_stride > 0 )
+    {
+        /* One value per 16x16 macroblock */
+        const int i_lines = ( p_ff_pic->height + 15 ) / 16;
+
+        p_qp = picture_qp_New( p_pic->format.i_width, p_pic->format.i_height,
+                               i_stride, i_lines );
+        if( p_qp != NULL )
+        {
+            memcpy( p_qp->p_table, p_table, (size_t)i_stride * i_lines );
+            p_qp->i_type = i_type;
+        }
+    }
+#else
+    VLC_UNUSED( p_ff_pic );
+#endif
+
+    /* A picture of the direct rendering pool may hold the previous table */
+    if( p_pic->p_qp != NULL )
+        picture_qp_Release( p_pic->p_qp );
+    p_pic->p_qp = p_qp;
+}
+
 #if LIBAVCODEC_VERSION_MAJOR >= 55
 static int lavc_va_GetFrame(struct AVCodecContext *ctx, AVFrame *frame,
                             int flags)
@@ -1309,7 +1452,10 @@ static enum PixelFormat ffmpeg_GetFormat( AVCodecContext *p_context,
     vlc_va_t *p_va = p_sys->p_va;
 
     if( p_va != NULL )
+    {
         vlc_va_Delete( p_va, p_context );
+        p_sys->p_va = NULL;
+    }
 
     /* Enumerate available formats */
     bool can_hwaccel = false;
@@ -1336,7 +1482,26 @@ static enum PixelFormat ffmpeg_GetFormat( AVCodecContext *p_context,
     if( p_context->level != FF_LEVEL_UNKNOWN)
         p_dec->fmt_in.i_level = p_context->level;
 
-    p_va = vlc_va_New( VLC_OBJECT(p_dec), p_context, &p_dec->fmt_in );
+    /* Get a picture of the video output with the hardware surface chroma:
+     * if the video output allocates such surfaces, the back-end copies its
+     * surfaces into them on the GPU instead of into system memory. */
+    picture_t *p_test = NULL;
+    for( size_t i = 0; pi_fmt[i] != PIX_FMT_NONE && p_test == NULL; i++ )
+    {
+        vlc_fourcc_t i_chroma = vlc_va_GetChroma( pi_fmt[i] );
+        if( i_chroma == 0 )
+            continue;
+
+        p_dec->fmt_out.video.i_chroma = i_chroma;
+        p_sys->b_va_surfaces = true;
+        p_test = ffmpeg_NewPictBuf( p_dec, p_context );
+        p_sys->b_va_surfaces = false;
+    }
+
+    p_va = vlc_va_New( VLC_OBJECT(p_dec), p_context, &p_dec->fmt_in,
+                       p_test != NULL ? p_test->p_sys : NULL );
+    if( p_test != NULL )
+        picture_Release( p_test );
     if( p_va == NULL )
         goto end;
 
@@ -0,0 +1,76 @@
+/*****************************************************************************
+ * decoder_threads.h: thread budget shared by the video decoders
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_CODEC_DECODER_THREADS_H
+#define VLC_CODEC_DECODER_THREADS_H
+
+/*
+ * All the video decoders of the process draw their threads from one budget,
+ * whatever their module, so that a mosaic or a transcoder running many
+ * decoders does not oversubscribe the CPU. The threads in use are counted in
+ * the "decoder-threads" variable of the libvlc instance, which is updated
+ * atomically. A decoder takes its share when the codec is opened and gives
+ * it back when it is closed, for the next decoders to use.
+ */
+
+/* Takes up to i_wanted threads, at least one, from a budget of i_budget
+ * threads (0 meaning twice the number of CPUs), unless b_force in which case
+ * i_wanted threads are taken whatever the budget. Returns the count taken. */
+static inline int decoder_threads_Acquire( decoder_t *p_dec, int i_wanted,
+                                           int i_budget, bool b_force )
+{
+    vlc_value_t val;
+
+    if( i_budget <= 0 )
+        i_budget = 2 * vlc_GetCPUCount();
+
+    var_Create( p_dec->p_libvlc, "decoder-threads", VLC_VAR_INTEGER );
+
+    val.i_int = i_wanted;
+    var_GetAndSet( VLC_OBJECT(p_dec->p_libvlc), "decoder-threads",
+                   VLC_VAR_INTEGER_ADD, &val );
+
+    int i_count = i_wanted;
+    if( !b_force && val.i_int > i_budget )
+    {
+        /* Give back what is over the budget */
+        const int i_over = __MIN( val.i_int - i_budget, i_wanted - 1 );
+        i_count -= i_over;
+        val.i_int = -i_over;
+        var_GetAndSet( VLC_OBJECT(p_dec->p_libvlc), "decoder-threads",
+                       VLC_VAR_INTEGER_ADD, &val );
+    }
+
+    msg_Dbg( p_dec, "allowing %d of %d wanted thread(s) for decoding "
+             "(%"PRId64" of %d in use)", i_count, i_wanted, val.i_int,
+             i_budget );
+    return i_count;
+}
+
+static inline void decoder_threads_Release( decoder_t *p_dec, int i_count )
+{
+    vlc_value_t val = { .i_int = -i_count };
+
+    var_GetAndSet( VLC_OBJECT(p_dec->p_libvlc), "decoder-threads",
+                   VLC_VAR_INTEGER_ADD, &val );
+    var_Destroy( p_dec->p_libvlc, "decoder-threads" );
+}
+
+#endif
@@ -158,6 +158,7 @@ typedef struct dvbsub_objectdef_s
     int i_y;
     int i_fg_pc;
     int i_bg_pc;
+    int i_version; /* of the object data last decoded, -1 if none */
     char *psz_text; /* for string of characters objects */
 
 } dvbsub_objectdef_t;
@@ -218,6 +219,14 @@ typedef struct dvbsub_region_s
     int i_clut;
 
     uint8_t *p_pixbuf;
+    bool     b_dirty; /* p_pixbuf changed since p_picture was rendered */
+
+    /* Last rendering of the region, handed out again while unchanged */
+    picture_t     *p_picture;
+    video_palette_t palette;
+    int            i_palette_clut;
+    int            i_palette_version; /* of the CLUT, -1 if not converted */
+    int            i_palette_depth;
 
     int                    i_object_defs;
     dvbsub_objectdef_t     *p_object_defs;
@@ -874,6 +883,8 @@ static void decode_region_composition( decoder_t *p_dec, bs_t *s )
             return;
         p_region->p_object_defs = NULL;
         p_region->p_pixbuf = NULL;
+        p_region->p_picture = NULL;
+        p_region->i_palette_version = -1;
         p_region->p_next = NULL;
     }
 
@@ -934,6 +945,7 @@ static void decode_region_composition( decoder_t *p_dec, bs_t *s )
         int i_background = ( p_region->i_depth == 1 ) ? i_2_bg :
             ( ( p_region->i_depth == 2 ) ? i_4_bg : i_8_bg );
         memset( p_region->p_pixbuf, i_background, i_width * i_height );
+        p_region->b_dirty = true;
     }
 
     p_region->i_width = i_width;
@@ -961,6 +973,7 @@ static void decode_region_composition( decoder_t *p_dec, bs_t *s )
         p_obj->i_x          = bs_read( s, 12 );
         bs_skip( s, 4 ); /* Reserved */
         p_obj->i_y          = bs_read( s, 12 );
+        p_obj->i_version    = -1;
         p_obj->psz_text     = NULL;
 
         i_processed_length += 6;
@@ -1052,14 +1065,14 @@ static void decode_object( decoder_t *p_dec, bs_t *s )
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
     dvbsub_region_t *p_region;
-    int i_segment_length, i_coding_method, i_id, i;
+    int i_segment_length, i_coding_method, i_id, i_version, i;
 
     /* ETSI 300-743 paragraph 7.2.4
      * sync_byte, segment_type and page_id have already been processed.
      */
     i_segment_length = bs_read( s, 16 );
     i_id             = bs_read( s, 16 );
-    bs_skip( s, 4 ); /* version */
+    i_version        = bs_read( s, 4 );
     i_coding_method  = bs_read( s, 2 );
 
     if( i_coding_method > 1 )
@@ -1070,12 +1083,13 @@ static void decode_object( decoder_t *p_dec, bs_t *s )
     }
 
     /* Check if the object needs to be rendered in at least one
-     * of the regions */
+     * of the regions, that is not already showing this version of it */
     for( p_region = p_sys->p_regions; p_region != NULL;
          p_region = p_region->p_next )
     {
         for( i = 0; i < p_region->i_object_defs; i++ )
-            if( p_region->p_object_defs[i].i_id == i_id ) break;
+            if( p_region->p_object_defs[i].i_id == i_id &&
+                p_region->p_object_defs[i].i_version != i_version ) break;
 
         if( i != p_region->i_object_defs ) break;
     }
@@ -1117,7 +1131,10 @@ static void decode_object( decoder_t *p_dec, bs_t *s )
         {
             for( i = 0; i < p_region->i_object_defs; i++ )
             {
-                if( p_region->p_object_defs[i].i_id != i_id ) continue;
+                if( p_region->p_object_defs[i].i_id != i_id ||
+                    p_region->p_object_defs[i].i_version == i_version )
+                    continue;
+                p_region->p_object_defs[i].i_version = i_version;
 
                 dvbsub_render_pdata( p_dec, p_region,
                                      p_region->p_object_defs[i].i_x,
@@ -1163,7 +1180,10 @@ static void decode_object( decoder_t *p_dec, bs_t *s )
             {
                 int j;
 
-                if( p_region->p_object_defs[i].i_id != i_id ) continue;
+                if( p_region->p_object_defs[i].i_id != i_id ||
+                    p_region->p_object_defs[i].i_version == i_version )
+                    continue;
+                p_region->p_object_defs[i].i_version = i_version;
 
                 p_region->p_object_defs[i].psz_text =
                     xrealloc( p_region->p_object_defs[i].psz_text,
@@ -1207,6 +1227,7 @@ static void dvbsub_render_pdata( decoder_t *p_dec, dvbsub_region_t *p_region,
     }
 
     p_pixbuf = p_region->p_pixbuf + i_y * p_region->i_width;
+    p_region->b_dirty = true;
     bs_init( &bs, p_field, i_field );
 
     while( !bs_eof( &bs ) )
@@ -1456,6 +1477,8 @@ static void free_all( decoder_t *p_dec )
             free( p_reg->p_object_defs[i].psz_text );
         if( p_reg->i_object_defs ) free( p_reg->p_object_defs );
         free( p_reg->p_pixbuf );
+        if( p_reg->p_picture )
+            picture_Release( p_reg->p_picture );
         free( p_reg );
     }
     p_sys->p_regions = NULL;
@@ -1532,7 +1555,6 @@ static subpicture_t *render( decoder_t *p_dec )
         subpicture_region_t *p_spu_region;
         uint8_t *p_src, *p_dst;
         video_format_t fmt;
-        video_palette_t palette;
         int i_pitch;
 
         p_regiondef = &p_sys->p_page->p_region_defs[i];
@@ -1588,20 +1610,58 @@ static subpicture_t *render( decoder_t *p_dec )
         fmt.i_width = fmt.i_visible_width = p_region->i_width;
         fmt.i_height = fmt.i_visible_height = p_region->i_height;
         fmt.i_x_offset = fmt.i_y_offset = 0;
-        fmt.p_palette = &palette;
-        fmt.p_palette->i_entries = ( p_region->i_depth == 1 ) ? 4 :
-            ( ( p_region->i_depth == 2 ) ? 16 : 256 );
-        p_color = ( p_region->i_depth == 1 ) ? p_clut->c_2b :
-            ( ( p_region->i_depth == 2 ) ? p_clut->c_4b : p_clut->c_8b );
-        for( j = 0; j < fmt.p_palette->i_entries; j++ )
+        fmt.p_palette = &p_region->palette;
+
+        /* Convert the CLUT only when it, or the depth using it, changed */
+        if( p_region->i_palette_version != p_clut->i_version ||
+            p_region->i_palette_clut != p_clut->i_id ||
+            p_region->i_palette_depth != p_region->i_depth )
         {
-            fmt.p_palette->palette[j][0] = p_color[j].Y;
-            fmt.p_palette->palette[j][1] = p_color[j].Cb; /* U == Cb */
-            fmt.p_palette->palette[j][2] = p_color[j].Cr; /* V == Cr */
-            fmt.p_palette->palette[j][3] = 0xff - p_color[j].T;
+            fmt.p_palette->i_entries = ( p_region->i_depth == 1 ) ? 4 :
+                ( ( p_region->i_depth == 2 ) ? 16 : 256 );
+            p_color = ( p_region->i_depth == 1 ) ? p_clut->c_2b :
+                ( ( p_region->i_depth == 2 ) ? p_clut->c_4b : p_clut->c_8b );
+            for( j = 0; j < fmt.p_palette->i_entries; j++ )
+            {
+                fmt.p_palette->palette[j][0] = p_color[j].Y;
+                fmt.p_palette->palette[j][1] = p_color[j].Cb; /* U == Cb */
+                fmt.p_palette->palette[j][2] = p_color[j].Cr; /* V == Cr */
+                fmt.p_palette->palette[j][3] = 0xff - p_color[j].T;
+            }
+            p_region->i_palette_clut = p_clut->i_id;
+            p_region->i_palette_version = p_clut->i_version;
+            p_region->i_palette_depth = p_region->i_depth;
         }
 
-        p_spu_region = subpicture_region_New( &fmt );
+        /* Copy the pixel buffer only if objects were drawn into it since the
+         * last page. The previous picture may still be on display, so it is
+         * replaced rather than overwritten. */
+        if( p_region->b_dirty || !p_region->p_picture )
+        {
+            if( p_region->p_picture )
+                picture_Release( p_region->p_picture );
+            p_region->p_picture = picture_NewFromFormat( &fmt );
+            if( !p_region->p_picture )
+            {
+                msg_Err( p_dec, "cannot allocate SPU region" );
+                continue;
+            }
+
+            p_src = p_region->p_pixbuf;
+            p_dst = p_region->p_picture->Y_PIXELS;
+            i_pitch = p_region->p_picture->Y_PITCH;
+
+            for( j = 0; j < p_region->i_height; j++ )
+            {
+                memcpy( p_dst, p_src, p_region->i_width );
+                p_src += p_region->i_width;
+                p_dst += i_pitch;
+            }
+            p_region->b_dirty = false;
+        }
+
+        p_spu_region = subpicture_region_NewFromPicture( &fmt,
+                                                         p_region->p_picture );
         if( !p_spu_region )
         {
             msg_Err( p_dec, "cannot allocate SPU region" );
@@ -1613,18 +1673,6 @@ static subpicture_t *render( decoder_t *p_dec )
         *pp_spu_region = p_spu_region;
         pp_spu_region = &p_spu_region->p_next;
 
-        p_src = p_region->p_pixbuf;
-        p_dst = p_spu_region->p_picture->Y_PIXELS;
-        i_pitch = p_spu_region->p_picture->Y_PITCH;
-
-        /* Copy pixel buffer */
-        for( j = 0; j < p_region->i_height; j++ )
-        {
-            memcpy( p_dst, p_src, p_region->i_width );
-            p_src += p_region->i_width;
-            p_dst += i_pitch;
-        }
-
         /* Check subtitles encoded as strings of characters
          * (since there are not rendered in the pixbuffer) */
         for( j = 0; j < p_region->i_object_defs; j++ )
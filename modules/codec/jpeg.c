@@ -69,6 +69,10 @@ struct decoder_sys_t
     JPEG_SYS_COMMON_MEMBERS
 
     struct jpeg_decompress_struct p_jpeg;
+
+    /* Size of the last output picture */
+    unsigned i_width;
+    unsigned i_height;
 };
 
 static int  OpenDecoder(vlc_object_t *);
@@ -167,6 +171,7 @@ static int OpenDecoder(vlc_object_t *p_this)
     p_dec->p_sys = p_sys;
 
     p_sys->p_obj = p_this;
+    p_sys->i_width = p_sys->i_height = 0;
 
     p_sys->p_jpeg.err = jpeg_std_error(&p_sys->err);
     p_sys->err.error_exit = user_error_exit;
@@ -218,7 +223,29 @@ static picture_t *DecodeBlock(decoder_t *p_dec, block_t **pp_block)
 
     p_sys->p_jpeg.out_color_space = JCS_RGB;
 
+    /* If the owner changed the output size, it wants a smaller picture
+     * (thumbnail): scale it down in the IDCT, to the nearest size above */
+    unsigned i_req_width = p_dec->fmt_out.video.i_width;
+    unsigned i_req_height = p_dec->fmt_out.video.i_height;
+    if ((i_req_width != p_sys->i_width || i_req_height != p_sys->i_height)
+     && (i_req_width > 0 || i_req_height > 0))
+    {
+        for (unsigned i_denom = 8; i_denom > 1; i_denom /= 2)
+        {
+            unsigned w = (p_sys->p_jpeg.image_width + i_denom - 1) / i_denom;
+            unsigned h = (p_sys->p_jpeg.image_height + i_denom - 1) / i_denom;
+            if (w >= i_req_width && h >= i_req_height)
+            {
+                p_sys->p_jpeg.scale_num = 1;
+                p_sys->p_jpeg.scale_denom = i_denom;
+                break;
+            }
+        }
+    }
+
     jpeg_start_decompress(&p_sys->p_jpeg);
+    p_sys->i_width = p_sys->p_jpeg.output_width;
+    p_sys->i_height = p_sys->p_jpeg.output_height;
 
     /* Set output properties */
     p_dec->fmt_out.i_codec = VLC_CODEC_RGB24;
@@ -66,6 +66,17 @@ vlc_module_end ()
  *****************************************************************************/
 static subpicture_t *DecodeBlock( decoder_t *, block_t ** );
 
+typedef struct
+{
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+} rectangle_t;
+
+/* Maximum number of regions of a subpicture */
+#define ASS_MAX_REGION 4
+
 /* */
 struct decoder_sys_t
 {
@@ -79,9 +90,22 @@ struct decoder_sys_t
     ASS_Library    *p_library;
     ASS_Renderer   *p_renderer;
     video_format_t fmt;
+    double         f_aspect;
 
     /* */
     ASS_Track      *p_track;
+
+    /* Last frame rendered by libass, shared by the subpictures displayed
+     * at the same date */
+    mtime_t        i_render_date;
+    ASS_Image      *p_img;
+
+    /* Regions drawn from the last rendered frame, reused as long as
+     * libass reports no change */
+    bool           b_cache;
+    int            i_cache;
+    rectangle_t    cache_region[ASS_MAX_REGION];
+    picture_t      *pp_cache[ASS_MAX_REGION];
 };
 static void DecSysRelease( decoder_sys_t *p_sys );
 static void DecSysHold( decoder_sys_t *p_sys );
@@ -107,14 +131,6 @@ struct subpicture_updater_sys_t
     ASS_Image     *p_img;
 };
 
-typedef struct
-{
-    int x0;
-    int y0;
-    int x1;
-    int y1;
-} rectangle_t;
-
 static int BuildRegions( rectangle_t *p_region, int i_max_region, ASS_Image *p_img_list, int i_width, int i_height );
 static void RegionDraw( subpicture_region_t *p_region, ASS_Image *p_img );
 
@@ -141,7 +157,12 @@ static int Create( vlc_object_t *p_this )
     vlc_mutex_init( &p_sys->lock );
     p_sys->i_refcount = 1;
     memset( &p_sys->fmt, 0, sizeof(p_sys->fmt) );
+    p_sys->f_aspect   = 0.0;
     p_sys->i_max_stop = VLC_TS_INVALID;
+    p_sys->i_render_date = VLC_TS_INVALID;
+    p_sys->p_img      = NULL;
+    p_sys->b_cache    = false;
+    p_sys->i_cache    = 0;
     p_sys->p_library  = NULL;
     p_sys->p_renderer = NULL;
     p_sys->p_track    = NULL;
@@ -264,6 +285,15 @@ static void Destroy( vlc_object_t *p_this )
     DecSysRelease( p_dec->p_sys );
 }
 
+/* Must be called with the lock held */
+static void CacheFlush( decoder_sys_t *p_sys )
+{
+    for( int i = 0; i < p_sys->i_cache; i++ )
+        picture_Release( p_sys->pp_cache[i] );
+    p_sys->i_cache = 0;
+    p_sys->b_cache = false;
+}
+
 static void DecSysHold( decoder_sys_t *p_sys )
 {
     vlc_mutex_lock( &p_sys->lock );
@@ -283,6 +313,7 @@ static void DecSysRelease( decoder_sys_t *p_sys )
     vlc_mutex_unlock( &p_sys->lock );
     vlc_mutex_destroy( &p_sys->lock );
 
+    CacheFlush( p_sys );
     if( p_sys->p_track )
         ass_free_track( p_sys->p_track );
     if( p_sys->p_renderer )
@@ -309,6 +340,7 @@ static subpicture_t *DecodeBlock( decoder_t *p_dec, block_t **pp_block )
     p_block = *pp_block;
     if( p_block->i_flags & (BLOCK_FLAG_DISCONTINUITY|BLOCK_FLAG_CORRUPTED) )
     {
+        /* The library, its fonts and the renderer are kept across seeks */
         p_sys->i_max_stop = VLC_TS_INVALID;
         block_Release( p_block );
         return NULL;
@@ -369,6 +401,8 @@ static subpicture_t *DecodeBlock( decoder_t *p_dec, block_t **pp_block )
     {
         ass_process_chunk( p_sys->p_track, p_spu_sys->p_subs_data, p_spu_sys->i_subs_len,
                            p_block->i_pts / 1000, p_block->i_length / 1000 );
+        /* The frame must be rendered again */
+        p_sys->i_render_date = VLC_TS_INVALID;
     }
     vlc_mutex_unlock( &p_sys->lock );
 
@@ -400,18 +434,39 @@ static int SubpictureValidate( subpicture_t *p_subpic,
     fmt.i_y_offset       = 0;
     if( b_fmt_src || b_fmt_dst )
     {
-        ass_set_frame_size( p_sys->p_renderer, fmt.i_width, fmt.i_height );
         const double src_ratio = (double)p_fmt_src->i_width / p_fmt_src->i_height;
         const double dst_ratio = (double)p_fmt_dst->i_width / p_fmt_dst->i_height;
-        ass_set_aspect_ratio( p_sys->p_renderer, dst_ratio / src_ratio, 1 );
-        p_sys->fmt = fmt;
+        const double f_aspect = dst_ratio / src_ratio;
+
+        /* Every new subpicture reports new formats: only reconfigure the
+         * renderer (which drops its caches) when they really change */
+        if( fmt.i_width != p_sys->fmt.i_width ||
+            fmt.i_height != p_sys->fmt.i_height ||
+            f_aspect != p_sys->f_aspect )
+        {
+            ass_set_frame_size( p_sys->p_renderer, fmt.i_width, fmt.i_height );
+            ass_set_aspect_ratio( p_sys->p_renderer, f_aspect, 1 );
+            p_sys->fmt = fmt;
+            p_sys->f_aspect = f_aspect;
+            p_sys->i_render_date = VLC_TS_INVALID;
+            CacheFlush( p_sys );
+        }
     }
 
-    /* */
+    /* The subpictures displayed together share the same rendered frame */
     const mtime_t i_stream_date = p_subpic->updater.p_sys->i_pts + (i_ts - p_subpic->i_start);
-    int i_changed;
-    ASS_Image *p_img = ass_render_frame( p_sys->p_renderer, p_sys->p_track,
-                                         i_stream_date/1000, &i_changed );
+    int i_changed = 0;
+    ASS_Image *p_img = p_sys->p_img;
+
+    if( i_stream_date != p_sys->i_render_date )
+    {
+        p_img = ass_render_frame( p_sys->p_renderer, p_sys->p_track,
+                                  i_stream_date/1000, &i_changed );
+        p_sys->p_img = p_img;
+        p_sys->i_render_date = i_stream_date;
+        if( i_changed )
+            CacheFlush( p_sys );
+    }
 
     if( !i_changed && !b_fmt_src && !b_fmt_dst &&
         (p_img != NULL) == (p_subpic->p_region != NULL) )
@@ -447,9 +502,19 @@ static void SubpictureUpdate( subpicture_t *p_subpic,
      * reinstanciate a lot the scaler, and as we do not support subpel blending
      * it looks ugly (text unaligned).
      */
-    const int i_max_region = 4;
-    rectangle_t region[i_max_region];
-    const int i_region = BuildRegions( region, i_max_region, p_img, fmt.i_width, fmt.i_height );
+    rectangle_t region[ASS_MAX_REGION];
+    int i_region;
+
+    if( p_sys->b_cache )
+    {
+        i_region = p_sys->i_cache;
+        memcpy( region, p_sys->cache_region, sizeof(*region) * i_region );
+    }
+    else
+    {
+        i_region = BuildRegions( region, ASS_MAX_REGION, p_img, fmt.i_width, fmt.i_height );
+        p_sys->b_cache = true;
+    }
 
     if( i_region <= 0 )
     {
@@ -479,8 +544,16 @@ static void SubpictureUpdate( subpicture_t *p_subpic,
         r->i_y = region[i].y0;
         r->i_align = SUBPICTURE_ALIGN_TOP | SUBPICTURE_ALIGN_LEFT;
 
-        /* */
-        RegionDraw( r, p_img );
+        /* Draw the region once, then copy it while the frame is the same */
+        if( i < p_sys->i_cache )
+            picture_CopyPixels( r->p_picture, p_sys->pp_cache[i] );
+        else
+        {
+            RegionDraw( r, p_img );
+            p_sys->cache_region[i] = region[i];
+            p_sys->pp_cache[i] = picture_Hold( r->p_picture );
+            p_sys->i_cache++;
+        }
 
         /* */
         *pp_region_last = r;
@@ -30,10 +30,13 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_codec.h>
+#include <vlc_cpu.h>
 
 #include <vpx/vpx_decoder.h>
 #include <vpx/vp8dx.h>
 
+#include "decoder_threads.h"
+
 /****************************************************************************
  * Local prototypes
  ****************************************************************************/
@@ -43,6 +46,14 @@ static void Close(vlc_object_t *);
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads used for decoding, " \
+    "0 meaning auto (taken from the decoder thread budget)")
+
+#define FRAME_THREADS_TEXT N_("Frame-parallel decoding")
+#define FRAME_THREADS_LONGTEXT N_("Decode several VP9 frames in parallel, " \
+    "if the library supports it. This scales better than tiles alone " \
+    "but delays the output by one frame per thread.")
 
 vlc_module_begin ()
     set_shortname("vpx")
@@ -51,6 +62,10 @@ vlc_module_begin ()
     set_callbacks(Open, Close)
     set_category(CAT_INPUT)
     set_subcategory(SUBCAT_INPUT_VCODEC)
+    add_integer_with_range("vpx-threads", 0, 0, 16,
+                           THREADS_TEXT, THREADS_LONGTEXT, true)
+    add_bool("vpx-frame-threads", false,
+             FRAME_THREADS_TEXT, FRAME_THREADS_LONGTEXT, true)
 vlc_module_end ()
 
 /*****************************************************************************
@@ -59,14 +74,40 @@ vlc_module_end ()
 struct decoder_sys_t
 {
     struct vpx_codec_ctx ctx;
+    int threads; /* taken from the decoder thread budget */
+
+    /* Decoding time statistics */
+    unsigned frames;
+    mtime_t  time_total;
+    mtime_t  time_max;
 };
 
+/* Threads to decode with: one per quarter of 1080p, more for VP9 which
+ * spreads them over its tile columns and superblock rows */
+static int GetWantedThreads(decoder_t *dec, int vp_version)
+{
+    int threads = var_InheritInteger(dec, "vpx-threads");
+    if (threads > 0)
+        return threads;
+
+    const unsigned pixels = dec->fmt_in.video.i_width
+                          * dec->fmt_in.video.i_height;
+    if (pixels == 0)
+        return __MIN(vlc_GetCPUCount(), 4);
+
+    threads = (pixels + 518399) / 518400;
+    if (vp_version == 9)
+        threads += threads / 2;
+    return VLC_CLIP(threads, 1, 16);
+}
+
 /****************************************************************************
  * Decode: the whole thing
  ****************************************************************************/
 static picture_t *Decode(decoder_t *dec, block_t **pp_block)
 {
-    struct vpx_codec_ctx *ctx = &dec->p_sys->ctx;
+    decoder_sys_t *sys = dec->p_sys;
+    struct vpx_codec_ctx *ctx = &sys->ctx;
 
     block_t *block = *pp_block;
     if (!block)
@@ -85,9 +126,16 @@ static picture_t *Decode(decoder_t *dec, block_t **pp_block)
 
     *pkt_pts = block->i_pts;
 
+    mtime_t start = mdate();
     vpx_codec_err_t err;
     err = vpx_codec_decode(ctx, block->p_buffer, block->i_buffer, pkt_pts, 0);
 
+    mtime_t elapsed = mdate() - start;
+    sys->frames++;
+    sys->time_total += elapsed;
+    if (elapsed > sys->time_max)
+        sys->time_max = elapsed;
+
     block_Release(block);
     *pp_block = NULL;
 
@@ -179,20 +227,52 @@ static int Open(vlc_object_t *p_this)
         return VLC_ENOMEM;
     dec->p_sys = sys;
 
+    sys->frames = 0;
+    sys->time_total = 0;
+    sys->time_max = 0;
+
+    /* An explicit thread count is honored as is */
+    sys->threads = decoder_threads_Acquire(dec,
+                        GetWantedThreads(dec, vp_version), 0,
+                        var_InheritInteger(dec, "vpx-threads") > 0);
+
     struct vpx_codec_dec_cfg deccfg = {
-        .threads = __MIN(vlc_GetCPUCount(), 16)
+        .threads = sys->threads
     };
+    vpx_codec_flags_t flags = 0;
+    bool frame_threads = false;
+
+#ifdef VPX_CODEC_USE_FRAME_THREADING
+    if (vp_version == 9 && sys->threads > 1
+     && var_InheritBool(dec, "vpx-frame-threads")
+     && (vpx_codec_get_caps(iface) & VPX_CODEC_CAP_FRAME_THREADING))
+    {
+        flags |= VPX_CODEC_USE_FRAME_THREADING;
+        frame_threads = true;
+    }
+#endif
 
-    msg_Dbg(p_this, "VP%d: using libvpx version %s (build options %s)", 
+    msg_Dbg(p_this, "VP%d: using libvpx version %s (build options %s)",
         vp_version, vpx_codec_version_str(), vpx_codec_build_config());
 
-    if (vpx_codec_dec_init(&sys->ctx, iface, &deccfg, 0) != VPX_CODEC_OK) {
+    if (vpx_codec_dec_init(&sys->ctx, iface, &deccfg, flags) != VPX_CODEC_OK) {
         const char *error = vpx_codec_error(&sys->ctx);
         msg_Err(p_this, "Failed to initialize decoder: %s\n", error);
+        decoder_threads_Release(dec, sys->threads);
         free(sys);
         return VLC_EGENERIC;;
     }
 
+#ifdef VPX_CTRL_VP9D_SET_ROW_MT
+    /* Threads decode the superblock rows of a tile in a pipeline, so that
+     * they are not limited by the number of tile columns */
+    if (vp_version == 9 && sys->threads > 1
+     && vpx_codec_control(&sys->ctx, VP9D_SET_ROW_MT, 1) != VPX_CODEC_OK)
+        msg_Warn(p_this, "row multithreading not supported");
+#endif
+    msg_Dbg(p_this, "decoding with %d thread(s)%s", sys->threads,
+            frame_threads ? ", frame-parallel" : "");
+
     dec->pf_decode_video = Decode;
 
     dec->fmt_out.i_cat = VIDEO_ES;
@@ -212,6 +292,9 @@ static void Close(vlc_object_t *p_this)
     decoder_t *dec = (decoder_t *)p_this;
     decoder_sys_t *sys = dec->p_sys;
 
+    /* Get the frames still being decoded by the frame threads */
+    vpx_codec_decode(&sys->ctx, NULL, 0, NULL, 0);
+
     /* Free our PTS */
     const void *iter = NULL;
     for (;;) {
@@ -222,6 +305,13 @@ static void Close(vlc_object_t *p_this)
     }
 
     vpx_codec_destroy(&sys->ctx);
+    decoder_threads_Release(dec, sys->threads);
+
+    if (sys->frames > 0)
+        msg_Dbg(dec, "decoded %u frames in %"PRId64" ms with %d thread(s): "
+                "%"PRId64" us per frame on average, %"PRId64" us at most",
+                sys->frames, sys->time_total / 1000, sys->threads,
+                sys->time_total / sys->frames, sys->time_max);
 
     free(sys);
 }
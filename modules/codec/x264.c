@@ -413,6 +413,12 @@ static void x264_log( void *, int i_level, const char *psz, va_list );
 #define LOOKAHEAD_LONGTEXT N_("Framecount to use on frametype lookahead. " \
     "Currently default can cause sync-issues on unmuxable output, like rtsp-output without ts-mux" )
 
+#define LIVE_TEXT N_("Low latency live streaming")
+#define LIVE_LONGTEXT N_("Output each picture as soon as it is encoded: " \
+    "no lookahead nor B-frames, threads working on slices of the same " \
+    "picture, and periodic intra refresh instead of keyframes, so that " \
+    "the bitrate stays even.")
+
 #define HRD_TEXT N_("HRD-timing information")
 #define TUNE_TEXT N_("Default tune setting used" )
 #define PRESET_TEXT N_("Default preset setting used" )
@@ -691,6 +697,8 @@ vlc_module_begin ()
     add_bool( SOUT_CFG_PREFIX "intra-refresh", false, INTRAREFRESH_TEXT,
               INTRAREFRESH_LONGTEXT, true )
 
+    add_bool( SOUT_CFG_PREFIX "live", false, LIVE_TEXT, LIVE_LONGTEXT, false )
+
     add_bool( SOUT_CFG_PREFIX "mbtree", true, MBTREE_TEXT, MBTREE_LONGTEXT, true )
 
     add_bool( SOUT_CFG_PREFIX "fast-pskip", true, FAST_PSKIP_TEXT,
@@ -774,7 +782,7 @@ static const char *const ppsz_sout_options[] = {
     "aq-mode", "aq-strength", "psy-rd", "psy", "profile", "lookahead", "slices",
     "slice-max-size", "slice-max-mbs", "intra-refresh", "mbtree", "hrd",
     "tune","preset", "opengop", "bluray-compat", "frame-packing", "options",
-    "fullrange",
+    "fullrange", "live",
     NULL
 };
 
@@ -791,6 +799,12 @@ struct encoder_sys_t
     int             i_sei_size;
     uint32_t         i_colorspace;
     uint8_t         *p_sei;
+
+    /* Statistics */
+    unsigned        i_pictures;
+    mtime_t         i_busy;
+    mtime_t         i_busy_max;
+    int             i_delayed_max;
 };
 
 #ifdef PTW32_STATIC_LIB
@@ -898,6 +912,10 @@ static int  Open ( vlc_object_t *p_this )
     p_sys->psz_stat_name = NULL;
     p_sys->i_sei_size = 0;
     p_sys->p_sei = NULL;
+    p_sys->i_pictures = 0;
+    p_sys->i_busy = 0;
+    p_sys->i_busy_max = 0;
+    p_sys->i_delayed_max = 0;
 
     char *psz_preset = var_GetString( p_enc, SOUT_CFG_PREFIX  "preset" );
     char *psz_tune = var_GetString( p_enc, SOUT_CFG_PREFIX  "tune" );
@@ -1372,6 +1390,19 @@ static int  Open ( vlc_object_t *p_this )
        p_sys->param.rc.i_lookahead = var_GetInteger( p_enc, SOUT_CFG_PREFIX "lookahead" );
     }
 
+    /* Same as the zerolatency tune, whatever the other settings, plus
+     * intra refresh; the raw options below can still override it */
+    if( var_GetBool( p_enc, SOUT_CFG_PREFIX "live" ) )
+    {
+        p_sys->param.rc.i_lookahead = 0;
+        p_sys->param.i_sync_lookahead = 0;
+        p_sys->param.i_bframe = 0;
+        p_sys->param.b_sliced_threads = 1;
+        p_sys->param.b_vfr_input = 0;
+        p_sys->param.rc.b_mb_tree = 0;
+        p_sys->param.b_intra_refresh = 1;
+    }
+
     /* We don't want repeated headers, we repeat p_extra ourself if needed */
     p_sys->param.b_repeat_headers = 0;
 
@@ -1495,13 +1526,24 @@ static block_t *Encode( encoder_t *p_enc, picture_t *p_pict )
        pic.i_pts = p_pict->date;
        pic.img.i_csp = p_sys->i_colorspace;
        pic.img.i_plane = p_pict->i_planes;
+       /* libx264 reads the planes in place */
        for( i = 0; i < p_pict->i_planes; i++ )
        {
            pic.img.plane[i] = p_pict->p[i].p_pixels;
            pic.img.i_stride[i] = p_pict->p[i].i_pitch;
        }
 
+       mtime_t i_start = mdate();
        x264_encoder_encode( p_sys->h, &nal, &i_nal, &pic, &pic );
+       mtime_t i_busy = mdate() - i_start;
+
+       int i_delayed = x264_encoder_delayed_frames( p_sys->h );
+       p_sys->i_pictures++;
+       p_sys->i_busy += i_busy;
+       if( i_busy > p_sys->i_busy_max )
+           p_sys->i_busy_max = i_busy;
+       if( i_delayed > p_sys->i_delayed_max )
+           p_sys->i_delayed_max = i_delayed;
     } else {
        if( x264_encoder_delayed_frames( p_sys->h ) ) {
            x264_encoder_encode( p_sys->h, &nal, &i_nal, NULL, &pic );
@@ -1565,6 +1607,12 @@ static void Close( vlc_object_t *p_this )
 
     if( p_sys->h )
     {
+        if( p_sys->i_pictures > 0 )
+            msg_Dbg( p_enc, "%u pictures encoded in %"PRId64" ms on average "
+                     "(%"PRId64" ms at most), up to %d pictures delayed",
+                     p_sys->i_pictures,
+                     p_sys->i_busy / p_sys->i_pictures / 1000,
+                     p_sys->i_busy_max / 1000, p_sys->i_delayed_max );
         msg_Dbg( p_enc, "framecount still in libx264 buffer: %d", x264_encoder_delayed_frames( p_sys->h ) );
         x264_encoder_close( p_sys->h );
     }
@@ -142,6 +142,7 @@ struct decoder_sys_t
 {
     vbi_decoder *     p_vbi_dec;
     vbi_sliced        p_vbi_sliced[MAX_SLICES];
+    uint8_t           pi_pages[(900 + 7) / 8]; /* listed in "vbi-pages" */
     unsigned int      i_last_page;
     bool              b_update;
     bool              b_text;   /* Subtitles as text */
@@ -255,6 +256,10 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_text = var_CreateGetBool( p_dec, "vbi-text" );
 //    var_AddCallback( p_dec, "vbi-text", Text, p_sys );
 
+    /* The pages in the cache of the VBI decoder, for the interfaces to
+     * list (as choices, in the order of reception) and show immediately */
+    var_Create( p_dec, "vbi-pages", VLC_VAR_INTEGER );
+
     /* Listen for keys */
     var_AddCallback( p_dec->p_libvlc, "key-pressed", EventKey, p_dec );
 
@@ -280,6 +285,7 @@ static void Close( vlc_object_t *p_this )
     var_DelCallback( p_dec, "vbi-opaque", Opaque, p_sys );
     var_DelCallback( p_dec, "vbi-page", RequestPage, p_sys );
     var_DelCallback( p_dec->p_libvlc, "key-pressed", EventKey, p_dec );
+    var_Destroy( p_dec, "vbi-pages" );
 
     vlc_mutex_destroy( &p_sys->lock );
 
@@ -555,8 +561,26 @@ static void EventHandler( vbi_event *ev, void *user_data )
                     ev->ev.ttx_page.pgno,
                     ev->ev.ttx_page.subno & 0xFF);
 #endif
-        if( p_sys->i_last_page == vbi_bcd2dec( ev->ev.ttx_page.pgno ) )
+        const unsigned i_page = vbi_bcd2dec( ev->ev.ttx_page.pgno );
+
+        if( p_sys->i_last_page == i_page )
             p_sys->b_update = true;
+
+        /* libzvbi caches every page and sub-page as it is received, so that
+         * any of them can be fetched at once: make the page known to the
+         * interfaces the first time. Hexadecimal pages are not for display. */
+        if( vbi_is_bcd( ev->ev.ttx_page.pgno ) && i_page < 900 &&
+            !( p_sys->pi_pages[i_page / 8] & ( 1 << ( i_page % 8 ) ) ) )
+        {
+            vlc_value_t val, text;
+            char psz_page[4];
+
+            p_sys->pi_pages[i_page / 8] |= 1 << ( i_page % 8 );
+            snprintf( psz_page, sizeof( psz_page ), "%u", i_page );
+            val.i_int = i_page;
+            text.psz_string = psz_page;
+            var_Change( p_dec, "vbi-pages", VLC_VAR_ADDCHOICE, &val, &text );
+        }
 #ifdef ZVBI_DEBUG
         if( ev->ev.ttx_page.clock_update )
             msg_Dbg( p_dec, "clock" );
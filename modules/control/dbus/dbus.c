@@ -75,6 +75,12 @@
 
 #define SEEK_THRESHOLD 1000 /* µsec */
 
+#define SIGNAL_INTERVAL_TEXT N_("Minimum interval between signals (ms)")
+#define SIGNAL_INTERVAL_LONGTEXT N_( \
+    "The changes of the player state are gathered during this interval and " \
+    "sent as a single signal per interface, which spares the wake-ups of " \
+    "the D-Bus daemon and of the MPRIS clients.")
+
 /*****************************************************************************
  * Local prototypes.
  *****************************************************************************/
@@ -139,6 +145,9 @@ vlc_module_begin ()
     set_description( N_("D-Bus control interface") )
     set_capability( "interface", 0 )
     set_callbacks( Open, Close )
+    add_integer_with_range( "dbus-signal-interval", 100, 0, 5000,
+                            SIGNAL_INTERVAL_TEXT, SIGNAL_INTERVAL_LONGTEXT,
+                            true )
 vlc_module_end ()
 
 /*****************************************************************************
@@ -161,6 +170,11 @@ static int Open( vlc_object_t *p_this )
     DBusConnection  *p_conn;
     p_sys->i_player_caps   = PLAYER_CAPS_NONE;
     p_sys->i_playing_state = PLAYBACK_STATE_INVALID;
+    p_sys->i_signal_interval = var_InheritInteger( p_intf,
+                                                   "dbus-signal-interval" )
+                             * 1000;
+    p_sys->i_next_signal = VLC_TS_INVALID;
+    p_sys->b_meta_changed = true;
 
     if( vlc_pipe( p_sys->p_pipe_fds ) )
     {
@@ -328,6 +342,8 @@ static void Close   ( vlc_object_t *p_this )
         callback_info_t* info = vlc_array_item_at_index( p_sys->p_events, i );
         free( info );
     }
+    if( p_sys->p_meta_cache )
+        dbus_message_unref( p_sys->p_meta_cache );
     vlc_mutex_destroy( &p_sys->lock );
     vlc_array_destroy( p_sys->p_events );
     vlc_array_destroy( p_sys->p_timeouts );
@@ -535,6 +551,7 @@ static void ProcessEvents( intf_thread_t *p_intf,
                            callback_info_t **p_events, int i_events )
 {
     bool b_can_play = p_intf->p_sys->b_can_play;
+    bool b_seeked = false;
 
     vlc_dictionary_t player_properties, tracklist_properties, root_properties;
     vlc_dictionary_init( &player_properties,    0 );
@@ -624,8 +641,9 @@ static void ProcessEvents( intf_thread_t *p_intf,
                 p_item = input_GetItem( p_input );
                 vlc_object_release( p_input );
 
+                /* a single Seeked signal for the seeks of the batch */
                 if( p_item && ( p_item->i_id == p_events[i]->i_item ) )
-                    SeekedEmit( p_intf );
+                    b_seeked = true;
             }
             break;
         }
@@ -635,6 +653,9 @@ static void ProcessEvents( intf_thread_t *p_intf,
         free( p_events[i] );
     }
 
+    if( b_seeked )
+        SeekedEmit( p_intf );
+
     if( vlc_dictionary_keys_count( &player_properties ) )
         PlayerPropertiesChangedEmit( p_intf, &player_properties );
 
@@ -798,6 +819,16 @@ static void *Run( void *data )
         int i_fds = GetPollFds( p_intf, fds );
         int timeout = next_timeout(p_intf);
 
+        /* Pending events wait for the end of the signal interval */
+        if( vlc_array_count( p_sys->p_events ) > 0 )
+        {
+            mtime_t i_wait = p_sys->i_next_signal - mdate();
+            if( i_wait < 0 )
+                timeout = 0;
+            else if( timeout < 0 || timeout > ( i_wait + 999 ) / 1000 )
+                timeout = ( i_wait + 999 ) / 1000;
+        }
+
         vlc_mutex_unlock( &p_sys->lock );
 
         /* thread cancellation is allowed while the main loop sleeps */
@@ -839,8 +870,18 @@ static void *Run( void *data )
             p_watches[i] = vlc_array_item_at_index( p_sys->p_watches, i );
         }
 
-        /* Get the list of events to process */
+        /* Get the list of events to process, if the interval since the
+         * last batch has elapsed, so that they are merged into one signal
+         * per interface */
         int i_events = vlc_array_count( p_intf->p_sys->p_events );
+        if( i_events > 0 )
+        {
+            mtime_t i_now = mdate();
+            if( i_now < p_sys->i_next_signal )
+                i_events = 0;
+            else
+                p_sys->i_next_signal = i_now + p_sys->i_signal_interval;
+        }
         callback_info_t* p_info[i_events ? i_events : 1];
         for( int i = i_events - 1; i >= 0; i-- )
         {
@@ -961,13 +1002,19 @@ static int InputCallback( vlc_object_t *p_this, const char *psz_var,
         p_sys->i_playing_state = i_state;
         p_info->signal = SIGNAL_STATE;
     }
-    if( p_info->signal )
+    if( p_info->signal == SIGNAL_INPUT_METADATA )
+        p_sys->b_meta_changed = true;
+    bool b_signal = p_info->signal != SIGNAL_NONE;
+    if( b_signal )
         vlc_array_append( p_intf->p_sys->p_events, p_info );
     else
         free( p_info );
     vlc_mutex_unlock( &p_intf->p_sys->lock );
 
-    wakeup_main_loop( p_intf );
+    /* The position events are frequent: only wake up the main loop if
+     * there is something to signal */
+    if( b_signal )
+        wakeup_main_loop( p_intf );
 
     (void)psz_var;
     (void)oldval;
@@ -107,6 +107,17 @@ struct intf_sys_t
 
     mtime_t         i_last_input_pos; /* Only access from input thread */
     mtime_t         i_last_input_pos_event; /* Same as above */
+
+    /* Events are processed, and the signals sent, at most once per interval */
+    mtime_t         i_signal_interval;
+    mtime_t         i_next_signal;
+
+    /* Serialized metadata of the current item, only rebuilt when the item,
+     * its duration or its meta change (b_meta_changed is under lock) */
+    DBusMessage    *p_meta_cache;
+    int             i_meta_cache_id;
+    mtime_t         i_meta_cache_duration;
+    bool            b_meta_changed;
 };
 
 enum
@@ -522,6 +522,101 @@ DBUS_METHOD( LoopStatusSet )
     REPLY_SEND;
 }
 
+/* Copies the values of an iterator, and of its containers, to another */
+static bool
+CopyIter( DBusMessageIter *from, DBusMessageIter *to )
+{
+    int type;
+
+    while( ( type = dbus_message_iter_get_arg_type( from ) )
+                                                        != DBUS_TYPE_INVALID )
+    {
+        if( dbus_type_is_basic( type ) )
+        {
+            DBusBasicValue value;
+            dbus_message_iter_get_basic( from, &value );
+            if( !dbus_message_iter_append_basic( to, type, &value ) )
+                return false;
+        }
+        else
+        {
+            DBusMessageIter sub_from, sub_to;
+            char *psz_sig = NULL;
+            const char *psz_contained = NULL;
+
+            dbus_message_iter_recurse( from, &sub_from );
+            if( type == DBUS_TYPE_ARRAY )
+            {
+                psz_sig = dbus_message_iter_get_signature( from );
+                psz_contained = psz_sig ? psz_sig + 1 : NULL;
+            }
+            else if( type == DBUS_TYPE_VARIANT )
+                psz_contained = psz_sig =
+                    dbus_message_iter_get_signature( &sub_from );
+
+            bool b_ok = ( psz_contained || ( type != DBUS_TYPE_ARRAY &&
+                                             type != DBUS_TYPE_VARIANT ) )
+                     && dbus_message_iter_open_container( to, type,
+                                                          psz_contained,
+                                                          &sub_to );
+            if( b_ok )
+            {
+                b_ok = CopyIter( &sub_from, &sub_to );
+                b_ok = dbus_message_iter_close_container( to, &sub_to )
+                    && b_ok;
+            }
+            dbus_free( psz_sig );
+            if( !b_ok )
+                return false;
+        }
+        dbus_message_iter_next( from );
+    }
+    return true;
+}
+
+/* Metadata dictionary of the item, from the cache if it is up to date */
+static int
+GetCachedInputMeta( intf_thread_t *p_intf, input_item_t *p_item,
+                    DBusMessageIter *container )
+{
+    intf_sys_t *p_sys = p_intf->p_sys;
+    mtime_t i_duration = input_item_GetDuration( p_item );
+    DBusMessageIter it;
+
+    vlc_mutex_lock( &p_sys->lock );
+    bool b_changed = p_sys->b_meta_changed;
+    p_sys->b_meta_changed = false;
+    vlc_mutex_unlock( &p_sys->lock );
+
+    if( b_changed || p_sys->p_meta_cache == NULL
+     || p_sys->i_meta_cache_id != p_item->i_id
+     || p_sys->i_meta_cache_duration != i_duration )
+    {
+        if( p_sys->p_meta_cache )
+            dbus_message_unref( p_sys->p_meta_cache );
+
+        p_sys->p_meta_cache =
+            dbus_message_new( DBUS_MESSAGE_TYPE_METHOD_RETURN );
+        if( !p_sys->p_meta_cache )
+            return VLC_ENOMEM;
+
+        dbus_message_iter_init_append( p_sys->p_meta_cache, &it );
+        if( GetInputMeta( p_item, &it ) != VLC_SUCCESS )
+        {
+            dbus_message_unref( p_sys->p_meta_cache );
+            p_sys->p_meta_cache = NULL;
+            return VLC_ENOMEM;
+        }
+        p_sys->i_meta_cache_id = p_item->i_id;
+        p_sys->i_meta_cache_duration = i_duration;
+    }
+
+    if( !dbus_message_iter_init( p_sys->p_meta_cache, &it )
+     || !CopyIter( &it, container ) )
+        return VLC_ENOMEM;
+    return VLC_SUCCESS;
+}
+
 static int
 MarshalMetadata( intf_thread_t *p_intf, DBusMessageIter *container )
 {
@@ -535,7 +630,7 @@ MarshalMetadata( intf_thread_t *p_intf, DBusMessageIter *container )
 
         if( p_item )
         {
-            int result = GetInputMeta( p_item, container );
+            int result = GetCachedInputMeta( p_intf, p_item, container );
 
             if (result != VLC_SUCCESS)
             {
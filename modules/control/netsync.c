@@ -174,13 +174,19 @@ static mtime_t GetPcrSystem(input_thread_t *input)
     return system;
 }
 
+/*
+ * Protocol: the slave sends its PCR system date and its send date (t1), the
+ * master answers with its send date (t3), its PCR system date, its receive
+ * date (t2) and the echo of t1. Older peers only send and read the first
+ * fields, so the exchange remains compatible with them.
+ */
 static void *Master(void *handle)
 {
     intf_thread_t *intf = handle;
     intf_sys_t *sys = intf->p_sys;
     for (;;) {
         struct pollfd ufd = { .fd = sys->fd, .events = POLLIN, };
-        uint64_t data[2];
+        uint64_t data[4];
 
         if (poll(&ufd, 1, -1) < 0)
             continue;
@@ -189,41 +195,51 @@ static void *Master(void *handle)
         struct sockaddr_storage from;
         socklen_t fromlen = sizeof (from);
 
-        if (recvfrom(sys->fd, data, 8, 0,
-                     (struct sockaddr *)&from, &fromlen) < 8)
+        ssize_t len = recvfrom(sys->fd, data, 16, 0,
+                               (struct sockaddr *)&from, &fromlen);
+        const mtime_t receive_date = mdate();
+        if (len < 8)
             continue;
 
         mtime_t master_system = GetPcrSystem(sys->input);
         if (master_system < 0)
             continue;
 
-        data[0] = hton64(mdate());
+        data[3] = (len >= 16) ? data[1] : 0;
+        data[2] = hton64(receive_date);
         data[1] = hton64(master_system);
+        data[0] = hton64(mdate());
 
         /* Reply to the sender */
-        sendto(sys->fd, data, 16, 0,
+        sendto(sys->fd, data, (len >= 16) ? 32 : 24, 0,
                (struct sockaddr *)&from, fromlen);
-#if 0
-        /* not sure we need the client information to sync,
-           since we are the master anyway */
-        mtime_t client_system = ntoh64(data[0]);
-        msg_Dbg(intf, "Master clockref: %"PRId64" -> %"PRId64", from %s "
-                 "(date: %"PRId64")", client_system, master_system,
-                 (from.ss_family == AF_INET) ? inet_ntoa(((struct sockaddr_in *)&from)->sin_addr)
-                 : "non-IPv4", /*date*/ 0);
-#endif
     }
     return NULL;
 }
 
+/* Exchanges kept to estimate the clock offset */
+#define NETSYNC_SAMPLES 8
+/* Smallest error of the slave clock corrected */
+#define NETSYNC_THRESHOLD (CLOCK_FREQ / 1000)
+
 static void *Slave(void *handle)
 {
     intf_thread_t *intf = handle;
     intf_sys_t *sys = intf->p_sys;
+    struct {
+        mtime_t offset; /* slave minus master clock */
+        mtime_t delay;  /* round trip, without the master processing */
+    } samples[NETSYNC_SAMPLES];
+    unsigned sample_count = 0, sample_next = 0;
+
+    /* Statistics, reported every 10 seconds */
+    mtime_t stats_date = mdate();
+    mtime_t error_sum = 0, error_max = 0;
+    unsigned error_count = 0, corrections = 0;
 
     for (;;) {
         struct pollfd ufd = { .fd = sys->fd, .events = POLLIN, };
-        uint64_t data[2];
+        uint64_t data[4];
 
         mtime_t system = GetPcrSystem(sys->input);
         if (system < 0)
@@ -233,39 +249,76 @@ static void *Slave(void *handle)
         const mtime_t send_date = mdate();
 
         data[0] = hton64(system);
-        send(sys->fd, data, 8, 0);
+        data[1] = hton64(send_date);
+        send(sys->fd, data, 16, 0);
 
         /* Don't block */
         if (poll(&ufd, 1, sys->timeout) <= 0)
             continue;
 
+        ssize_t len = recv(sys->fd, data, 32, 0);
         const mtime_t receive_date = mdate();
-        if (recv(sys->fd, data, 16, 0) < 16)
+        if (len < 16)
             goto wait;
+        /* drop the late answer to a previous request */
+        if (len >= 32 && (mtime_t)ntoh64(data[3]) != send_date)
+            continue;
 
         const mtime_t master_date   = ntoh64(data[0]);
         const mtime_t master_system = ntoh64(data[1]);
-        const mtime_t diff_date = receive_date -
-                                  ((receive_date - send_date) / 2 + master_date);
+        const mtime_t master_receive_date = (len >= 24) ? (mtime_t)ntoh64(data[2])
+                                                        : master_date;
+
+        /* Two-way exchange: the offset is exact if both ways take as long,
+         * so keep the one of the fastest recent exchange */
+        samples[sample_next].offset = ((send_date - master_receive_date) +
+                                       (receive_date - master_date)) / 2;
+        samples[sample_next].delay = (receive_date - send_date) -
+                                     (master_date - master_receive_date);
+        sample_next = (sample_next + 1) % NETSYNC_SAMPLES;
+        if (sample_count < NETSYNC_SAMPLES)
+            sample_count++;
+
+        unsigned best = 0;
+        for (unsigned i = 1; i < sample_count; i++)
+            if (samples[i].delay < samples[best].delay)
+                best = i;
+        const mtime_t diff_date = samples[best].offset;
 
         if (master_system > 0) {
             int canc = vlc_savecancel();
 
             mtime_t client_system;
             if (!input_GetPcrSystem(sys->input, &client_system, NULL)) {
-                const mtime_t diff_system = client_system - master_system - diff_date;
-                if (diff_system != 0) {
-                    input_ModifyPcrSystem(sys->input, true, master_system - diff_date);
-#if 0
-                    msg_Dbg(intf, "Slave clockref: %"PRId64" -> %"PRId64" -> %"PRId64","
-                             " clock diff: %"PRId64", diff: %"PRId64"",
-                             system, master_system, client_system,
-                             diff_system, diff_date);
-#endif
+                /* the master system date in the slave clock */
+                const mtime_t target = master_system + diff_date;
+                const mtime_t diff_system = client_system - target;
+                const mtime_t error = diff_system < 0 ? -diff_system
+                                                      : diff_system;
+
+                error_sum += error;
+                error_count++;
+                if (error > error_max)
+                    error_max = error;
+
+                /* small errors come from the estimate, not the clocks */
+                if (error >= NETSYNC_THRESHOLD) {
+                    input_ModifyPcrSystem(sys->input, true, target);
+                    corrections++;
                 }
             }
             vlc_restorecancel(canc);
         }
+
+        if (mdate() - stats_date >= 10 * CLOCK_FREQ && error_count > 0) {
+            msg_Dbg(intf, "sync error: mean %"PRId64" us, max %"PRId64" us, "
+                    "%u corrections, round trip %"PRId64" us",
+                    error_sum / error_count, error_max, corrections,
+                    samples[best].delay);
+            error_sum = error_max = 0;
+            error_count = corrections = 0;
+            stats_date = mdate();
+        }
     wait:
         msleep(INTF_IDLE_SLEEP);
     }
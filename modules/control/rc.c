@@ -1748,6 +1748,12 @@ static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item )
             (float)(p_item->p_stats->i_read_bytes)/1024 );
     msg_rc(_("| input bitrate    :   %6.0f kb/s"),
             (float)(p_item->p_stats->f_input_bitrate)*8000 );
+    msg_rc(_("| prefetch hits    :    %5"PRIi64),
+            p_item->p_stats->i_prefetch_hits );
+    msg_rc(_("| prefetch misses  :    %5"PRIi64),
+            p_item->p_stats->i_prefetch_misses );
+    msg_rc(_("| prefetch stalls  :   %6"PRIi64" ms"),
+            p_item->p_stats->i_prefetch_stall / 1000 );
     msg_rc(_("| demux bytes read : %8.0f KiB"),
             (float)(p_item->p_stats->i_demux_read_bytes)/1024 );
     msg_rc(_("| demux bitrate    :   %6.0f kb/s"),
@@ -1756,15 +1762,28 @@ static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item )
             p_item->p_stats->i_demux_corrupted );
     msg_rc(_("| discontinuities  :    %5"PRIi64),
             p_item->p_stats->i_demux_discontinuity );
+    msg_rc(_("| clock drift      :   %6.1f ppm"),
+            p_item->p_stats->f_clock_drift );
+    msg_rc(_("| clock jitter     :   %6"PRIi64" ms"),
+            p_item->p_stats->i_clock_jitter / 1000 );
     msg_rc("|");
     /* Video */
     msg_rc("%s", _("+-[Video Decoding]"));
+    if( var_Type( p_intf->p_libvlc, "decoder-threads" ) )
+        msg_rc(_("| decoder threads  :    %5"PRId64" (all decoders)"),
+                var_GetInteger( p_intf->p_libvlc, "decoder-threads" ) );
     msg_rc(_("| video decoded    :    %5"PRIi64),
             p_item->p_stats->i_decoded_video );
     msg_rc(_("| frames displayed :    %5"PRIi64),
             p_item->p_stats->i_displayed_pictures );
     msg_rc(_("| frames lost      :    %5"PRIi64),
             p_item->p_stats->i_lost_pictures );
+    msg_rc(_("| queue latency    :   %6"PRIi64" ms"),
+            p_item->p_stats->i_latency_queue / 1000 );
+    msg_rc(_("| decode latency   :   %6"PRIi64" ms"),
+            p_item->p_stats->i_latency_decode / 1000 );
+    msg_rc(_("| output latency   :   %6"PRIi64" ms"),
+            p_item->p_stats->i_latency_output / 1000 );
     msg_rc("|");
     /* Audio*/
     msg_rc("%s", _("+-[Audio Decoding]"));
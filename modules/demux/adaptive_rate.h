@@ -0,0 +1,88 @@
+/*****************************************************************************
+ * adaptive_rate.h: download rate estimate of the adaptive streaming modules
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_DEMUX_ADAPTIVE_RATE_H
+#define VLC_DEMUX_ADAPTIVE_RATE_H
+
+/*
+ * Estimate of the available bandwidth from the segment downloads, shared by
+ * DASH, HLS and Smooth Streaming so that they adapt the same way. It is the
+ * harmonic mean of the throughput of the last downloads: a single fast
+ * download (e.g. from a cache) does not inflate it, a slow one lowers it at
+ * once. Not thread-safe, the caller locks if needed.
+ */
+
+/* Throughput samples of the estimate */
+#define ADAPTIVE_RATE_SAMPLES 5
+
+typedef struct
+{
+    uint64_t samples[ADAPTIVE_RATE_SAMPLES]; /* bits per second */
+    unsigned count;
+    unsigned next;
+    uint64_t bps; /* current estimate, 0 until the first download */
+
+    /* Statistics */
+    uint64_t bytes;    /* downloaded */
+    mtime_t  busy;     /* time spent downloading */
+    unsigned segments; /* downloaded */
+} adaptive_rate_t;
+
+static inline void adaptive_rate_Init( adaptive_rate_t *p_rate )
+{
+    memset( p_rate, 0, sizeof(*p_rate) );
+}
+
+/* Adds the download of a segment, that took the given time while the given
+ * number of downloads (including this one) shared the link, and returns the
+ * new estimate in bits per second */
+static inline uint64_t adaptive_rate_Add( adaptive_rate_t *p_rate,
+                                          uint64_t i_bytes, mtime_t i_time,
+                                          unsigned i_parallel )
+{
+    if( i_time <= 0 )
+        i_time = 1;
+
+    p_rate->bytes += i_bytes;
+    p_rate->busy += i_time;
+    p_rate->segments++;
+
+    uint64_t i_sample = i_bytes * 8 * CLOCK_FREQ / i_time
+                      * ( i_parallel ? i_parallel : 1 );
+    p_rate->samples[p_rate->next] = i_sample ? i_sample : 1;
+    p_rate->next = ( p_rate->next + 1 ) % ADAPTIVE_RATE_SAMPLES;
+    if( p_rate->count < ADAPTIVE_RATE_SAMPLES )
+        p_rate->count++;
+
+    double f_sum = 0.;
+    for( unsigned i = 0; i < p_rate->count; i++ )
+        f_sum += 1. / p_rate->samples[i];
+    p_rate->bps = p_rate->count / f_sum;
+    return p_rate->bps;
+}
+
+/* Average throughput of the downloads so far, in bits per second */
+static inline uint64_t adaptive_rate_Average( const adaptive_rate_t *p_rate )
+{
+    return p_rate->busy > 0 ? p_rate->bytes * 8 * CLOCK_FREQ / p_rate->busy
+                            : 0;
+}
+
+#endif
@@ -94,6 +94,7 @@ static int IORead( void *opaque, uint8_t *buf, int buf_size );
 static int64_t IOSeek( void *opaque, int64_t offset, int whence );
 
 static block_t *BuildSsaFrame( const AVPacket *p_pkt, unsigned i_order );
+static block_t *BuildFrame( AVPacket *p_pkt );
 static void UpdateSeekPoint( demux_t *p_demux, int64_t i_time );
 static void ResetTime( demux_t *p_demux, int64_t i_time );
 
@@ -265,8 +266,11 @@ int OpenDemux( vlc_object_t *p_this )
     TAB_INIT( p_sys->i_attachments, p_sys->attachments);
     p_sys->p_title = NULL;
 
-    /* Create I/O wrapper */
-    p_sys->io_buffer_size = 32768;  /* FIXME */
+    /* Create I/O wrapper: reads from local files are cheap, so fewer and
+     * larger ones; other accesses would wait for the whole buffer to fill */
+    bool b_fast_seek = false;
+    stream_Control( p_demux->s, STREAM_CAN_FASTSEEK, &b_fast_seek );
+    p_sys->io_buffer_size = b_fast_seek ? 131072 : 32768;
     p_sys->io_buffer = xmalloc( p_sys->io_buffer_size );
 
     p_sys->ic = avformat_alloc_context();
@@ -712,12 +716,11 @@ static int Demux( demux_t *p_demux )
     }
     else
     {
-        if( ( p_frame = block_Alloc( pkt.size ) ) == NULL )
+        if( ( p_frame = BuildFrame( &pkt ) ) == NULL )
         {
             av_free_packet( &pkt );
             return 0;
         }
-        memcpy( p_frame->p_buffer, pkt.data, pkt.size );
     }
 
     if( pkt.flags & AV_PKT_FLAG_KEY )
@@ -841,6 +844,55 @@ static void ResetTime( demux_t *p_demux, int64_t i_time )
     }
 }
 
+#if (LIBAVCODEC_VERSION_MAJOR >= 55)
+typedef struct
+{
+    block_t  self;
+    AVPacket pkt;
+} vlc_av_packet_t;
+
+static void vlc_av_packet_Release( block_t *p_block )
+{
+    vlc_av_packet_t *b = (vlc_av_packet_t *)p_block;
+
+    av_free_packet( &b->pkt );
+    free( b );
+}
+#endif
+
+/* Takes the data of the packet, without copying it if the packet owns it
+ * alone. The packet must still be freed. */
+static block_t *BuildFrame( AVPacket *p_pkt )
+{
+    block_t *p_frame;
+
+#if (LIBAVCODEC_VERSION_MAJOR >= 55)
+    if( p_pkt->buf != NULL && av_buffer_is_writable( p_pkt->buf ) )
+    {
+        vlc_av_packet_t *b = malloc( sizeof( *b ) );
+        if( unlikely(b == NULL) )
+            return NULL;
+
+        p_frame = &b->self;
+        block_Init( p_frame, p_pkt->data, p_pkt->size );
+        p_frame->pf_release = vlc_av_packet_Release;
+        b->pkt = *p_pkt;
+        /* The timestamps and flags of the packet are still read after */
+        p_pkt->buf = NULL;
+        p_pkt->data = NULL;
+        p_pkt->size = 0;
+        p_pkt->side_data = NULL;
+        p_pkt->side_data_elems = 0;
+        return p_frame;
+    }
+#endif
+
+    p_frame = block_Alloc( p_pkt->size );
+    if( p_frame != NULL )
+        memcpy( p_frame->p_buffer, p_pkt->data, p_pkt->size );
+    return p_frame;
+}
+
 static block_t *BuildSsaFrame( const AVPacket *p_pkt, unsigned i_order )
 {
     if( p_pkt->size <= 0 )
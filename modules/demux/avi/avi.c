@@ -160,6 +160,11 @@ typedef struct
     /* Avi Index */
     avi_index_t     idx;
 
+    /* OpenDML super index whose sub-indexes are loaded on demand, starting
+     * with i_superindx_next. NULL once they are all loaded. */
+    avi_chunk_indx_t *p_superindx;
+    unsigned int    i_superindx_next;
+
     unsigned int    i_idxposc;  /* numero of chunk */
     unsigned int    i_idxposb;  /* byte in the current chunk */
 
@@ -223,6 +228,8 @@ static int AVI_PacketRead     ( demux_t *, avi_packet_t *, block_t **);
 static int AVI_PacketSearch   ( demux_t * );
 
 static void AVI_IndexLoad    ( demux_t * );
+static int  AVI_IndexLoadNext( demux_t *, avi_track_t * );
+static int64_t AVI_IndexSuperDuration( const avi_track_t * );
 static void AVI_IndexCreate  ( demux_t * );
 
 static void AVI_ExtractSubtitle( demux_t *, unsigned int i_stream, avi_chunk_list_t *, avi_chunk_STRING_t * );
@@ -710,7 +717,10 @@ aviindex:
     for( unsigned int i = 0; i < p_sys->i_track; i++ )
     {
         const avi_track_t *tk = p_sys->track[i];
-        if( tk->i_cat == VIDEO_ES && tk->idx.p_entry )
+        if( tk->i_cat == VIDEO_ES && tk->p_superindx )
+            i_idx_totalframes = __MAX(i_idx_totalframes,
+                                      AVI_IndexSuperDuration( tk ));
+        else if( tk->i_cat == VIDEO_ES && tk->idx.p_entry )
             i_idx_totalframes = __MAX(i_idx_totalframes, tk->idx.i_size);
     }
     if( i_idx_totalframes != p_avih->i_totalframes &&
@@ -769,7 +779,7 @@ aviindex:
         {
             continue;
         }
-        if( tk->idx.i_size < 1 ||
+        if( tk->idx.i_size < 1 || tk->p_superindx ||
             tk->i_scale != 1 ||
             tk->i_samplesize != 0 )
         {
@@ -1013,6 +1023,9 @@ static int Demux_Seekable( demux_t *p_demux )
         avi_track_t *tk = p_sys->track[i_track];
 
         toread[i_track].b_ok = tk->b_activated && !tk->b_eof;
+        while( tk->b_activated && tk->p_superindx &&
+               tk->i_idxposc >= tk->idx.i_size )
+            AVI_IndexLoadNext( p_demux, tk );
         if( tk->i_idxposc < tk->idx.i_size )
         {
             toread[i_track].i_posf = tk->idx.p_entry[tk->i_idxposc].i_pos;
@@ -1113,8 +1126,11 @@ static int Demux_Seekable( demux_t *p_demux )
                              "cannot get packet header, track disabled" );
                     return( AVI_TrackStopFinishedStreams( p_demux ) ? 0 : 1 );
                 }
+                /* chunks of a track with pending sub-indexes will be
+                 * indexed from them */
                 if( avi_pk.i_stream >= p_sys->i_track ||
-                    ( avi_pk.i_cat != AUDIO_ES && avi_pk.i_cat != VIDEO_ES ) )
+                    ( avi_pk.i_cat != AUDIO_ES && avi_pk.i_cat != VIDEO_ES ) ||
+                    p_sys->track[avi_pk.i_stream]->p_superindx )
                 {
                     if( AVI_PacketNext( p_demux ) )
                     {
@@ -1255,6 +1271,8 @@ static int Demux_Seekable( demux_t *p_demux )
             toread[i_track].i_toread--;
         }
 
+        while( tk->p_superindx && tk->i_idxposc >= tk->idx.i_size )
+            AVI_IndexLoadNext( p_demux, tk );
         if( tk->i_idxposc < tk->idx.i_size)
         {
             toread[i_track].i_posf =
@@ -1783,7 +1801,8 @@ static int AVI_StreamChunkFind( demux_t *p_demux, unsigned int i_stream )
             return VLC_EGENERIC;
         }
         if( avi_pk.i_stream >= p_sys->i_track ||
-            ( avi_pk.i_cat != AUDIO_ES && avi_pk.i_cat != VIDEO_ES ) )
+            ( avi_pk.i_cat != AUDIO_ES && avi_pk.i_cat != VIDEO_ES ) ||
+            p_sys->track[avi_pk.i_stream]->p_superindx )
         {
             if( AVI_PacketNext( p_demux ) )
             {
@@ -1838,6 +1857,9 @@ static int AVI_StreamChunkSet( demux_t *p_demux, unsigned int i_stream,
     p_stream->i_idxposc = i_ck;
     p_stream->i_idxposb = 0;
 
+    while( p_stream->p_superindx && i_ck >= p_stream->idx.i_size )
+        AVI_IndexLoadNext( p_demux, p_stream );
+
     if(  i_ck >= p_stream->idx.i_size )
     {
         p_stream->i_idxposc = p_stream->idx.i_size - 1;
@@ -1863,6 +1885,12 @@ static int AVI_StreamBytesSet( demux_t    *p_demux,
     demux_sys_t *p_sys = p_demux->p_sys;
     avi_track_t *p_stream = p_sys->track[i_stream];
 
+    while( p_stream->p_superindx &&
+           ( p_stream->idx.i_size == 0 ||
+             i_byte >= p_stream->idx.p_entry[p_stream->idx.i_size - 1].i_lengthtotal +
+                       p_stream->idx.p_entry[p_stream->idx.i_size - 1].i_length ) )
+        AVI_IndexLoadNext( p_demux, p_stream );
+
     if( ( p_stream->idx.i_size > 0 )
         &&( i_byte < p_stream->idx.p_entry[p_stream->idx.i_size - 1].i_lengthtotal +
                 p_stream->idx.p_entry[p_stream->idx.i_size - 1].i_length ) )
@@ -2414,6 +2442,49 @@ static void __Parse_indx( demux_t *p_demux, avi_index_t *p_index, off_t *pi_max_
     }
 }
 
+static int __Parse_subindx( demux_t *p_demux, avi_index_t *p_index,
+                            off_t *pi_max_offset, avi_chunk_indx_t *p_indx,
+                            unsigned i )
+{
+    avi_chunk_t ck_sub;
+
+    if( stream_Seek( p_demux->s, p_indx->idx.super[i].i_offset ) ||
+        AVI_ChunkRead( p_demux->s, &ck_sub, NULL ) )
+        return VLC_EGENERIC;
+
+    if( ck_sub.indx.i_indextype == AVI_INDEX_OF_CHUNKS )
+        __Parse_indx( p_demux, p_index, pi_max_offset, &ck_sub.indx );
+    AVI_ChunkFree( p_demux->s, &ck_sub );
+    return VLC_SUCCESS;
+}
+
+/* Total duration of a super index, in stream ticks */
+static int64_t AVI_IndexSuperDuration( const avi_track_t *tk )
+{
+    int64_t i_duration = 0;
+
+    for( unsigned i = 0; i < tk->p_superindx->i_entriesinuse; i++ )
+        i_duration += tk->p_superindx->idx.super[i].i_duration;
+    return i_duration;
+}
+
+/* Loads the next pending sub-index of a track, keeping the stream position.
+ * On failure the remaining ones are dropped and the track falls back to
+ * scanning the movi list, as with a missing index. */
+static int AVI_IndexLoadNext( demux_t *p_demux, avi_track_t *tk )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const uint64_t i_pos = stream_Tell( p_demux->s );
+
+    int i_ret = __Parse_subindx( p_demux, &tk->idx, &p_sys->i_movi_lastchunk_pos,
+                                 tk->p_superindx, tk->i_superindx_next );
+    if( i_ret || ++tk->i_superindx_next >= tk->p_superindx->i_entriesinuse )
+        tk->p_superindx = NULL;
+
+    stream_Seek( p_demux->s, i_pos );
+    return i_ret;
+}
+
 static void AVI_IndexLoad_indx( demux_t *p_demux,
                                 avi_index_t p_index[], off_t *pi_last_offset )
 {
@@ -2433,6 +2504,7 @@ static void AVI_IndexLoad_indx( demux_t *p_demux,
 #define p_stream  p_sys->track[i_stream]
         p_strl = AVI_ChunkFind( p_hdrl, AVIFOURCC_strl, i_stream );
         p_indx = AVI_ChunkFind( p_strl, AVIFOURCC_indx, 0 );
+        p_stream->p_superindx = NULL;
 
         if( !p_indx )
         {
@@ -2450,17 +2522,22 @@ static void AVI_IndexLoad_indx( demux_t *p_demux,
         {
             if ( !p_sys->b_seekable )
                 return;
-            avi_chunk_t    ck_sub;
-            for( unsigned i = 0; i < p_indx->i_entriesinuse; i++ )
+
+            /* Without idx1 to compare with, only the first sub-index is
+             * loaded now, the others as playback or seeking reach them */
+            const unsigned i_count = p_sys->b_odml ? __MIN( p_indx->i_entriesinuse, 1 )
+                                                   : p_indx->i_entriesinuse;
+            unsigned i;
+            for( i = 0; i < i_count; i++ )
             {
-                if( stream_Seek( p_demux->s, p_indx->idx.super[i].i_offset )||
-                    AVI_ChunkRead( p_demux->s, &ck_sub, NULL  ) )
-                {
+                if( __Parse_subindx( p_demux, &p_index[i_stream],
+                                     pi_last_offset, p_indx, i ) )
                     break;
-                }
-                if( ck_sub.indx.i_indextype == AVI_INDEX_OF_CHUNKS )
-                    __Parse_indx( p_demux, &p_index[i_stream], pi_last_offset, &ck_sub.indx );
-                AVI_ChunkFree( p_demux->s, &ck_sub );
+            }
+            if( i == i_count && i_count < p_indx->i_entriesinuse )
+            {
+                p_stream->p_superindx = p_indx;
+                p_stream->i_superindx_next = i_count;
             }
         }
         else
@@ -2911,7 +2988,7 @@ static int AVI_TrackStopFinishedStreams( demux_t *p_demux )
     for( i = 0; i < p_sys->i_track; i++ )
     {
         avi_track_t *tk = p_sys->track[i];
-        if( tk->i_idxposc >= tk->idx.i_size )
+        if( tk->i_idxposc >= tk->idx.i_size && !tk->p_superindx )
         {
             tk->b_eof = true;
         }
@@ -2938,12 +3015,17 @@ static mtime_t  AVI_MovieGetLength( demux_t *p_demux )
         mtime_t i_length;
 
         /* fix length for each stream */
-        if( tk->idx.i_size < 1 || !tk->idx.p_entry )
+        if( tk->p_superindx )
+        {
+            /* durations are in stream ticks, that is samples for PCM */
+            i_length = AVI_GetDPTS( tk, AVI_IndexSuperDuration( tk ) *
+                                        __MAX( tk->i_samplesize, 1 ) );
+        }
+        else if( tk->idx.i_size < 1 || !tk->idx.p_entry )
         {
             continue;
         }
-
-        if( tk->i_samplesize )
+        else if( tk->i_samplesize )
         {
             i_length = AVI_GetDPTS( tk,
                                     tk->idx.p_entry[tk->idx.i_size-1].i_lengthtotal +
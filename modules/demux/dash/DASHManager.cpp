@@ -35,9 +35,8 @@
 #include <inttypes.h>
 
 #include "DASHManager.h"
-#include "mpd/MPDFactory.h"
 #include "mpd/SegmentTimeline.h"
-#include "xml/DOMParser.h"
+#include "mpd/TimelineUpdateParser.h"
 #include "adaptationlogic/AdaptationLogicFactory.h"
 #include "SegmentTracker.hpp"
 #include <vlc_stream.h>
@@ -49,7 +48,6 @@ using namespace dash::mpd;
 
 DASHManager::DASHManager    ( MPD *mpd,
                               AbstractAdaptationLogic::LogicType type, stream_t *stream) :
-             conManager     ( NULL ),
              logicType      ( type ),
              mpd            ( mpd ),
              stream         ( stream ),
@@ -61,7 +59,6 @@ DASHManager::DASHManager    ( MPD *mpd,
 
 DASHManager::~DASHManager   ()
 {
-    delete conManager;
     for(int i=0; i<Streams::count; i++)
         delete streams[i];
 }
@@ -104,10 +101,6 @@ bool DASHManager::start(demux_t *demux)
         }
     }
 
-    conManager = new (std::nothrow) HTTPConnectionManager(stream);
-    if(!conManager)
-        return false;
-
     mpd->playbackStart.Set(time(NULL));
     nextMPDupdate = mpd->playbackStart.Get();
 
@@ -121,11 +114,37 @@ size_t DASHManager::read()
     {
         if(!streams[type])
             continue;
-        i_ret += streams[type]->read(conManager);
+        i_ret += streams[type]->read();
+    }
+
+    if(i_ret == 0)
+    {
+        /* Wait for the stream lagging behind, as demuxing needs it first,
+         * but not too long as the others may get data meanwhile */
+        Streams::Stream *lagging = NULL;
+        for(int type=0; type<Streams::count; type++)
+        {
+            if(!streams[type] || streams[type]->isEOF())
+                continue;
+            if(!lagging || streams[type]->getPCR() < lagging->getPCR())
+                lagging = streams[type];
+        }
+        if(lagging)
+            lagging->waitData(mdate() + CLOCK_FREQ / 10);
     }
     return i_ret;
 }
 
+bool DASHManager::isEOF() const
+{
+    for(int type=0; type<Streams::count; type++)
+    {
+        if(streams[type] && !streams[type]->isEOF())
+            return false;
+    }
+    return true;
+}
+
 mtime_t DASHManager::getPCR() const
 {
     mtime_t pcr = VLC_TS_INVALID;
@@ -223,7 +242,9 @@ bool DASHManager::updateMPD()
         if(!mpdstream)
             return false;
 
-        xml::DOMParser parser(mpdstream);
+        /* Only look for new segments: rebuilding the whole MPD on each
+         * refresh is costly with long live timelines */
+        TimelineUpdateParser parser(mpdstream, mpd);
         if(!parser.parse())
         {
             stream_Delete(mpdstream);
@@ -240,12 +261,15 @@ bool DASHManager::updateMPD()
                 minsegmentTime = segmentTime;
         }
 
-        MPD *newmpd = MPDFactory::create(parser.getRootNode(), mpdstream, parser.getProfile());
-        if(newmpd)
-        {
-            mpd->mergeWith(newmpd, minsegmentTime);
-            delete newmpd;
-        }
+        for(int type=0; type<Streams::count; type++)
+            if(streams[type])
+                streams[type]->lockSegments();
+        parser.merge(minsegmentTime);
+        for(int type=0; type<Streams::count; type++)
+            if(streams[type])
+                streams[type]->unlockSegments();
+        msg_Dbg(stream, "MPD update: %zu new timeline elements",
+                parser.getNewElementsCount());
         stream_Delete(mpdstream);
     }
 
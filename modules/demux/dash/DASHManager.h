@@ -40,6 +40,7 @@ namespace dash
 
             bool    start         (demux_t *);
             size_t  read();
+            bool    isEOF() const;
             mtime_t getDuration() const;
             mtime_t getPCR() const;
             int     getGroup() const;
@@ -49,7 +50,6 @@ namespace dash
             bool    updateMPD();
 
         private:
-            http::HTTPConnectionManager         *conManager;
             logic::AbstractAdaptationLogic::LogicType  logicType;
             mpd::MPD                            *mpd;
             stream_t                            *stream;
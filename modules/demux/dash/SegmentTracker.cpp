@@ -28,6 +28,7 @@ using namespace dash::mpd;
 SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, mpd::MPD *mpd_)
 {
     count = 0;
+    chunkDuration = 0;
     initializing = true;
     prevRepresentation = NULL;
     currentPeriod = mpd_->getFirstPeriod();
@@ -78,7 +79,10 @@ Chunk * SegmentTracker::getNextChunk(Streams::Type type)
         initializing = false;
         segment = rep->getSegment(Representation::INFOTYPE_INIT);
         if(segment)
+        {
+            chunkDuration = 0;
             return segment->toChunk(count, rep);
+        }
     }
 
     segment = rep->getSegment(Representation::INFOTYPE_MEDIA, count);
@@ -91,7 +95,14 @@ Chunk * SegmentTracker::getNextChunk(Streams::Type type)
 
     Chunk *chunk = segment->toChunk(count, rep);
     if(chunk)
+    {
+        /* Unknown (0) when segments have no timing information */
+        chunkDuration = rep->getPlaybackTimeBySegmentNumber(count + 1) -
+                        rep->getPlaybackTimeBySegmentNumber(count);
+        if(chunkDuration < 0)
+            chunkDuration = 0;
         count++;
+    }
 
     return chunk;
 }
@@ -116,3 +127,8 @@ mtime_t SegmentTracker::getSegmentStart() const
     else
         return 0;
 }
+
+mtime_t SegmentTracker::getChunkDuration() const
+{
+    return chunkDuration;
+}
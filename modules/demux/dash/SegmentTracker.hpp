@@ -58,10 +58,12 @@ namespace dash
             http::Chunk* getNextChunk(Streams::Type);
             bool setPosition(mtime_t, bool);
             mtime_t getSegmentStart() const;
+            mtime_t getChunkDuration() const;
 
         private:
             bool initializing;
             uint64_t count;
+            mtime_t chunkDuration;
             logic::AbstractAdaptationLogic *logic;
             mpd::MPD *mpd;
             mpd::Period *currentPeriod;
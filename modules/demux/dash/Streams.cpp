@@ -45,17 +45,42 @@ void Stream::init(const Type type_, const Format format_)
     format = format_;
     output = NULL;
     adaptationLogic = NULL;
-    currentChunk = NULL;
     eof = false;
     segmentTracker = NULL;
+    connManager = NULL;
+    fifo = NULL;
+    bufferSize = 0;
+    threadCreated = false;
+    generation = 0;
+    closing = false;
+    bufferLevel = 0;
+    bufferDate = 0;
+    vlc_mutex_init(&lock);
+    vlc_cond_init(&wait);
+    vlc_cond_init(&dataWait);
 }
 
 Stream::~Stream()
 {
-    delete currentChunk;
+    if(threadCreated)
+    {
+        vlc_mutex_lock(&lock);
+        closing = true;
+        vlc_cond_signal(&wait);
+        vlc_mutex_unlock(&lock);
+        /* Wakes the downloader up if it waits for room */
+        block_FifoEmpty(fifo);
+        vlc_join(thread, NULL);
+    }
+    if(fifo)
+        block_FifoRelease(fifo);
+    delete connManager;
     delete adaptationLogic;
     delete output;
     delete segmentTracker;
+    vlc_cond_destroy(&dataWait);
+    vlc_cond_destroy(&wait);
+    vlc_mutex_destroy(&lock);
 }
 
 Type Stream::mimeToType(const std::string &mime)
@@ -101,13 +126,31 @@ void Stream::create(demux_t *demux, AbstractAdaptationLogic *logic, SegmentTrack
             throw VLC_EBADVAR;
             break;
     }
+
+    connManager = new (std::nothrow) HTTPConnectionManager(demux->s);
+    fifo = block_FifoNewSPSC();
+    if(!connManager || !fifo)
+        throw VLC_ENOMEM;
+    bufferSize = var_InheritInteger(demux, "dash-buffersize") * 1024;
+
     adaptationLogic = logic;
     segmentTracker = tracker;
+    if(vlc_clone(&thread, downloadThread, this, VLC_THREAD_PRIORITY_INPUT))
+    {
+        /* still owned by the caller */
+        adaptationLogic = NULL;
+        segmentTracker = NULL;
+        throw VLC_EGENERIC;
+    }
+    threadCreated = true;
 }
 
 bool Stream::isEOF() const
 {
-    return false;
+    vlc_mutex_lock(&lock);
+    bool ret = eof && block_FifoCount(fifo) == 0;
+    vlc_mutex_unlock(&lock);
+    return ret;
 }
 
 mtime_t Stream::getPCR() const
@@ -130,33 +173,100 @@ bool Stream::operator ==(const Stream &stream) const
     return stream.type == type;
 }
 
-Chunk * Stream::getChunk()
+
+bool Stream::seekAble() const
+{
+    return (output && output->seekAble());
+}
+
+size_t Stream::read()
 {
-    if (currentChunk == NULL)
+    /* Never waits: the downloader queues whole blocks */
+    if(block_FifoCount(fifo) == 0)
     {
-        currentChunk = segmentTracker->getNextChunk(type);
-        if (currentChunk == NULL)
-            eof = true;
+        /* The demuxer keeps some data queued until the end */
+        if(isEOF())
+            output->drain();
+        return 0;
     }
-    return currentChunk;
+
+    block_t *block = block_FifoGet(fifo);
+    if(!block)
+        return 0;
+
+    size_t readsize = block->i_buffer;
+    output->pushBlock(block);
+    return readsize;
 }
 
-bool Stream::seekAble() const
+void Stream::waitData(mtime_t deadline)
 {
-    return (output && output->seekAble());
+    vlc_mutex_lock(&lock);
+    while(!eof && block_FifoCount(fifo) == 0)
+        if(vlc_cond_timedwait(&dataWait, &lock, deadline))
+            break;
+    vlc_mutex_unlock(&lock);
 }
 
-size_t Stream::read(HTTPConnectionManager *connManager)
+bool Stream::setPosition(mtime_t time, bool tryonly)
 {
-    Chunk *chunk = getChunk();
-    if(!chunk)
-        return 0;
+    vlc_mutex_lock(&lock);
+    bool ret = segmentTracker->setPosition(time, tryonly);
+    if(!tryonly && ret)
+    {
+        /* The downloader drops its current segment and restarts from the
+         * new position, without queuing anything more of the old one */
+        generation++;
+        eof = false;
+        vlc_cond_signal(&wait);
+    }
+    vlc_mutex_unlock(&lock);
 
-    if(!chunk->getConnection())
+    if(!tryonly && ret)
     {
-       if(!connManager->connectChunk(chunk))
-        return 0;
+        block_FifoEmpty(fifo);
+        output->setPosition(time);
     }
+    return ret;
+}
+
+mtime_t Stream::getPosition() const
+{
+    vlc_mutex_lock(&lock);
+    mtime_t time = segmentTracker->getSegmentStart();
+    vlc_mutex_unlock(&lock);
+    return time;
+}
+
+void Stream::lockSegments()
+{
+    vlc_mutex_lock(&lock);
+}
+
+void Stream::unlockSegments()
+{
+    vlc_mutex_unlock(&lock);
+}
+
+void *Stream::downloadThread(void *data)
+{
+    static_cast<Stream *>(data)->download();
+    return NULL;
+}
+
+void Stream::releaseChunk(Chunk *chunk)
+{
+    /* closes the connection if the response was not read entirely */
+    if(chunk->getConnection())
+        chunk->getConnection()->releaseChunk();
+    delete chunk;
+}
+
+/* Reads the next block of a segment, without holding the lock */
+block_t * Stream::readChunk(Chunk *chunk)
+{
+    if(!chunk->getConnection() && !connManager->connectChunk(chunk))
+        return NULL;
 
     size_t readsize = 0;
 
@@ -179,7 +289,7 @@ size_t Stream::read(HTTPConnectionManager *connManager)
 
     block_t *block = block_Alloc(readsize);
     if(!block)
-        return 0;
+        return NULL;
 
     mtime_t time = mdate();
     ssize_t ret = chunk->getConnection()->read(block->p_buffer, readsize);
@@ -188,44 +298,96 @@ size_t Stream::read(HTTPConnectionManager *connManager)
     if(ret <= 0)
     {
         block_Release(block);
-        chunk->getConnection()->releaseChunk();
-        currentChunk = NULL;
-        delete chunk;
-        return 0;
+        return NULL;
     }
-    else
+
+    block->i_buffer = (size_t)ret;
+    adaptationLogic->updateDownloadRate(block->i_buffer, time);
+    return block;
+}
+
+void Stream::download()
+{
+    Chunk *chunk = NULL;
+    unsigned current = 0;
+
+    vlc_mutex_lock(&lock);
+    while(!closing)
     {
-        block->i_buffer = (size_t)ret;
+        if(current != generation)
+        {
+            /* seeked */
+            if(chunk)
+            {
+                releaseChunk(chunk);
+                chunk = NULL;
+            }
+            current = generation;
+            bufferLevel = 0;
+            bufferDate = 0;
+            adaptationLogic->updateBufferLevel(0);
+        }
+
+        if(!chunk)
+        {
+            if(eof)
+            {
+                vlc_cond_wait(&wait, &lock);
+                continue;
+            }
+            chunk = segmentTracker->getNextChunk(type);
+            if(!chunk)
+            {
+                eof = true;
+                vlc_cond_signal(&dataWait);
+                continue;
+            }
+        }
+        mtime_t duration = segmentTracker->getChunkDuration();
+        vlc_mutex_unlock(&lock);
 
-        adaptationLogic->updateDownloadRate(block->i_buffer, time);
+        block_FifoPace(fifo, SIZE_MAX, bufferSize);
+        block_t *block = readChunk(chunk);
 
-        if (chunk->getBytesToRead() == 0)
+        vlc_mutex_lock(&lock);
+        if(closing || current != generation)
         {
-            chunk->onDownload(block->p_buffer, block->i_buffer);
-            chunk->getConnection()->releaseChunk();
-            currentChunk = NULL;
-            delete chunk;
+            if(block)
+                block_Release(block);
+            continue;
         }
-    }
 
-    readsize = block->i_buffer;
+        if(!block)
+        {
+            releaseChunk(chunk);
+            chunk = NULL;
+            continue;
+        }
 
-    output->pushBlock(block);
+        if (chunk->getBytesToRead() == 0)
+        {
+            /* Playback drains the buffer in real time */
+            mtime_t now = mdate();
+            if(bufferDate)
+                bufferLevel -= now - bufferDate;
+            if(bufferLevel < 0)
+                bufferLevel = 0;
+            bufferLevel += duration;
+            bufferDate = now;
+            adaptationLogic->updateBufferLevel(bufferLevel);
 
-    return readsize;
-}
+            chunk->onDownload(block->p_buffer, block->i_buffer);
+            releaseChunk(chunk);
+            chunk = NULL;
+        }
 
-bool Stream::setPosition(mtime_t time, bool tryonly)
-{
-    bool ret = segmentTracker->setPosition(time, tryonly);
-    if(!tryonly && ret)
-        output->setPosition(time);
-    return ret;
-}
+        block_FifoPut(fifo, block);
+        vlc_cond_signal(&dataWait);
+    }
+    vlc_mutex_unlock(&lock);
 
-mtime_t Stream::getPosition() const
-{
-    return segmentTracker->getSegmentStart();
+    if(chunk)
+        releaseChunk(chunk);
 }
 
 AbstractStreamOutput::AbstractStreamOutput(demux_t *demux)
@@ -276,6 +438,11 @@ void AbstractStreamOutput::pushBlock(block_t *block)
     stream_DemuxSend(demuxstream, block);
 }
 
+void AbstractStreamOutput::drain()
+{
+    stream_DemuxDrain(demuxstream);
+}
+
 bool AbstractStreamOutput::seekAble() const
 {
     return (demuxstream && seekable);
@@ -336,7 +503,7 @@ void AbstractStreamOutput::esOutDestroy(es_out_t *fakees)
 MP4StreamOutput::MP4StreamOutput(demux_t *demux) :
     AbstractStreamOutput(demux)
 {
-    demuxstream = stream_DemuxNew(demux, "mp4", fakeesout);
+    demuxstream = stream_DemuxNewSync(demux, "mp4", fakeesout, 4 * 1024 * 1024);
     if(!demuxstream)
         throw VLC_EGENERIC;
 }
@@ -344,7 +511,7 @@ MP4StreamOutput::MP4StreamOutput(demux_t *demux) :
 MPEG2TSStreamOutput::MPEG2TSStreamOutput(demux_t *demux) :
     AbstractStreamOutput(demux)
 {
-    demuxstream = stream_DemuxNew(demux, "ts", fakeesout);
+    demuxstream = stream_DemuxNewSync(demux, "ts", fakeesout, 64 * 1024);
     if(!demuxstream)
         throw VLC_EGENERIC;
 }
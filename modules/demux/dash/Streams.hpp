@@ -26,6 +26,7 @@
 
 #include <string>
 #include <vlc_common.h>
+#include <vlc_block.h>
 #include "StreamsType.hpp"
 #include "adaptationlogic/AbstractAdaptationLogic.h"
 #include "http/HTTPConnectionManager.h"
@@ -39,6 +40,9 @@ namespace dash
     {
         class AbstractStreamOutput;
 
+        /* Segments are downloaded by a thread per stream, ahead of the
+         * demuxer, up to a byte budget. Only queuing and dequeuing data, and
+         * segment tracking, are shared with the demux thread. */
         class Stream
         {
             public:
@@ -54,20 +58,39 @@ namespace dash
                 int getGroup() const;
                 int esCount() const;
                 bool seekAble() const;
-                size_t read(http::HTTPConnectionManager *);
+                size_t read();
+                void waitData(mtime_t);
                 bool setPosition(mtime_t, bool);
                 mtime_t getPosition() const;
+                /* Keeps the downloader off the segments (MPD updates) */
+                void lockSegments();
+                void unlockSegments();
 
             private:
-                http::Chunk *getChunk();
+                static void *downloadThread(void *);
+                void download();
+                block_t *readChunk(http::Chunk *);
+                void releaseChunk(http::Chunk *);
                 void init(const Type, const Format);
                 Type type;
                 Format format;
                 AbstractStreamOutput *output;
                 logic::AbstractAdaptationLogic *adaptationLogic;
                 SegmentTracker *segmentTracker;
-                http::Chunk *currentChunk;
+                http::HTTPConnectionManager *connManager;
+                block_fifo_t *fifo;
+                size_t bufferSize;
+                vlc_thread_t thread;
+                bool threadCreated;
+                mutable vlc_mutex_t lock;
+                vlc_cond_t wait;     /* downloader, waiting for a seek */
+                vlc_cond_t dataWait; /* demuxer, waiting for data */
+                unsigned generation; /* bumped by seeking */
+                bool closing;
                 bool eof;
+                /* media time downloaded ahead, as of bufferDate */
+                mtime_t bufferLevel;
+                mtime_t bufferDate;
         };
 
         class AbstractStreamOutput
@@ -77,6 +100,7 @@ namespace dash
                 virtual ~AbstractStreamOutput();
 
                 virtual void pushBlock(block_t *);
+                void drain();
                 mtime_t getPCR() const;
                 int getGroup() const;
                 int esCount() const;
@@ -31,14 +31,35 @@ using namespace dash::logic;
 using namespace dash::mpd;
 
 AbstractAdaptationLogic::AbstractAdaptationLogic    (MPD *mpd_) :
-                         mpd                        (mpd_)
+                         mpd                        (mpd_),
+                         windowSize                 (0),
+                         windowTime                 (0)
 {
+    adaptive_rate_Init(&rate);
 }
 
 AbstractAdaptationLogic::~AbstractAdaptationLogic   ()
 {
 }
 
-void AbstractAdaptationLogic::updateDownloadRate    (size_t, mtime_t)
+void AbstractAdaptationLogic::updateDownloadRate    (size_t size, mtime_t time)
+{
+    /* Reads are small: measure over windows of at least 250 ms */
+    windowSize += size;
+    windowTime += time;
+    if(windowTime < CLOCK_FREQ / 4)
+        return;
+
+    adaptive_rate_Add(&rate, windowSize, windowTime, 1);
+    windowSize = 0;
+    windowTime = 0;
+}
+
+uint64_t AbstractAdaptationLogic::getThroughput     () const
+{
+    return rate.bps;
+}
+
+void AbstractAdaptationLogic::updateBufferLevel     (mtime_t)
 {
 }
@@ -27,6 +27,7 @@
 
 #include <adaptationlogic/IDownloadRateObserver.h>
 #include "StreamsType.hpp"
+#include "../../adaptive_rate.h"
 
 //struct stream_t;
 
@@ -49,6 +50,7 @@ namespace dash
 
                 virtual mpd::Representation* getCurrentRepresentation(Streams::Type, mpd::Period *) const = 0;
                 virtual void                updateDownloadRate     (size_t, mtime_t);
+                virtual void                updateBufferLevel      (mtime_t);
 
                 enum LogicType
                 {
@@ -56,11 +58,20 @@ namespace dash
                     AlwaysBest,
                     AlwaysLowest,
                     RateBased,
-                    FixedRate
+                    FixedRate,
+                    BufferBased
                 };
 
             protected:
+                /* estimated throughput (bits per second), 0 if unknown */
+                uint64_t                getThroughput          () const;
+
                 dash::mpd::MPD         *mpd;
+
+            private:
+                adaptive_rate_t         rate;
+                size_t                  windowSize;
+                mtime_t                 windowTime;
         };
     }
 }
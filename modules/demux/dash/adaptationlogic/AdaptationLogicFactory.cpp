@@ -29,6 +29,7 @@
 #include "adaptationlogic/AlwaysBestAdaptationLogic.h"
 #include "adaptationlogic/RateBasedAdaptationLogic.h"
 #include "adaptationlogic/AlwaysLowestAdaptationLogic.hpp"
+#include "adaptationlogic/BufferBasedAdaptationLogic.hpp"
 
 #include <new>
 
@@ -46,6 +47,8 @@ AbstractAdaptationLogic* AdaptationLogicFactory::create (
             return new (std::nothrow) AlwaysLowestAdaptationLogic(mpd);
         case AbstractAdaptationLogic::FixedRate:
             return new (std::nothrow) FixedRateAdaptationLogic(mpd);
+        case AbstractAdaptationLogic::BufferBased:
+            return new (std::nothrow) BufferBasedAdaptationLogic(mpd);
         case AbstractAdaptationLogic::Default:
         case AbstractAdaptationLogic::RateBased:
             return new (std::nothrow) RateBasedAdaptationLogic(mpd);
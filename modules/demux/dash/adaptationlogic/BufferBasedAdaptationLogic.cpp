@@ -0,0 +1,171 @@
+/*
+ * BufferBasedAdaptationLogic.cpp
+ *****************************************************************************
+ * Copyright (C) 2015 - VideoLAN authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "BufferBasedAdaptationLogic.hpp"
+#include "mpd/MPD.h"
+#include "mpd/Period.h"
+#include "mpd/AdaptationSet.h"
+#include "mpd/Representation.h"
+
+#include <vlc_common.h>
+#include <vlc_variables.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace dash::logic;
+using namespace dash::mpd;
+
+/* Buffer levels (in seconds) at which the lowest and the highest
+ * representations are chosen */
+#define BUFFER_MIN     6.0
+#define BUFFER_TARGET 15.0
+/* Buffer level change needed to switch back (seconds) */
+#define HYSTERESIS     1.5
+/* Share of the throughput the representation may use */
+#define RATE_SAFETY    0.9
+
+static bool compareBandwidth(const Representation *a, const Representation *b)
+{
+    return a->getBandwidth() < b->getBandwidth();
+}
+
+BufferBasedAdaptationLogic::BufferBasedAdaptationLogic(MPD *mpd) :
+    AbstractAdaptationLogic(mpd),
+    bufferLevel(0),
+    startup(true), previous(NULL)
+{
+    trace = var_InheritBool(mpd->getVLCObject(), "dash-trace");
+}
+
+size_t BufferBasedAdaptationLogic::selectByRate(const std::vector<Representation *> &reps) const
+{
+    size_t index = 0;
+    for(size_t i = 1; i < reps.size(); i++)
+        if(reps[i]->getBandwidth() <= RATE_SAFETY * getThroughput())
+            index = i;
+    return index;
+}
+
+size_t BufferBasedAdaptationLogic::selectByBuffer(const std::vector<Representation *> &reps,
+                                                  mtime_t level) const
+{
+    if(reps.size() < 2 || reps[0]->getBandwidth() == 0)
+        return 0;
+
+    /* Utilities are the log of the bitrates, the lowest one being 1 */
+    const double lowest = reps[0]->getBandwidth();
+    const double maxutility = log(reps.back()->getBandwidth() / lowest) + 1.0;
+    if(maxutility <= 1.0)
+        return 0;
+    const double gp = (maxutility - 1.0) / (BUFFER_TARGET / BUFFER_MIN - 1.0);
+    const double vp = BUFFER_MIN / gp;
+    const double q = (double) level / CLOCK_FREQ;
+
+    size_t index = 0;
+    double best = 0.;
+    for(size_t i = 0; i < reps.size(); i++)
+    {
+        const double bitrate = reps[i]->getBandwidth();
+        const double utility = log(bitrate / lowest) + 1.0;
+        const double score = (vp * (utility + gp) - q) / bitrate;
+        if(i == 0 || score > best)
+        {
+            best = score;
+            index = i;
+        }
+    }
+    return index;
+}
+
+Representation *BufferBasedAdaptationLogic::getCurrentRepresentation(Streams::Type type,
+                                                                    Period *period) const
+{
+    if(period == NULL)
+        return NULL;
+
+    std::vector<Representation *> reps;
+    std::vector<AdaptationSet *> sets = period->getAdaptationSets(type);
+    std::vector<AdaptationSet *>::const_iterator it;
+    for(it = sets.begin(); it != sets.end(); ++it)
+    {
+        std::vector<Representation *> &setreps = (*it)->getRepresentations();
+        reps.insert(reps.end(), setreps.begin(), setreps.end());
+    }
+    if(reps.empty())
+        return NULL;
+    std::stable_sort(reps.begin(), reps.end(), compareBandwidth);
+
+    const size_t rateIndex = selectByRate(reps);
+    size_t index = selectByBuffer(reps, bufferLevel);
+
+    if(startup)
+    {
+        /* Ramp up on the throughput until the buffer takes over */
+        if(bufferLevel >= BUFFER_MIN * CLOCK_FREQ || (getThroughput() > 0 && index >= rateIndex))
+            startup = false;
+        else
+            index = rateIndex;
+    }
+
+    if(!startup)
+    {
+        std::vector<Representation *>::const_iterator prevIt =
+                std::find(reps.begin(), reps.end(), previous);
+        if(prevIt != reps.end())
+        {
+            const size_t prevIndex = prevIt - reps.begin();
+            const mtime_t hysteresis = HYSTERESIS * CLOCK_FREQ;
+            if(index > prevIndex)
+            {
+                /* Do not switch up further than the throughput allows, nor
+                 * because of a buffer level just above the threshold */
+                index = std::min(index, std::max(prevIndex, rateIndex));
+                index = std::min(index, std::max(prevIndex,
+                                 selectByBuffer(reps, bufferLevel - hysteresis)));
+            }
+            else if(index < prevIndex)
+            {
+                index = std::max(index, std::min(prevIndex,
+                                 selectByBuffer(reps, bufferLevel + hysteresis)));
+            }
+        }
+    }
+
+    Representation *rep = reps[index];
+    if(trace)
+        msg_Dbg(mpd->getVLCObject(), "buffer based logic: type %d, buffer %" PRId64
+                " ms, throughput %" PRIu64 " bps, %s %" PRIu64 " bps (%zu/%zu)%s",
+                (int) type, bufferLevel / 1000, getThroughput(),
+                (rep == previous) ? "keeping" : "choosing", rep->getBandwidth(),
+                index + 1, reps.size(), startup ? ", startup" : "");
+    previous = rep;
+    return rep;
+}
+
+void BufferBasedAdaptationLogic::updateBufferLevel(mtime_t level)
+{
+    bufferLevel = level;
+    if(level == 0) /* (re)starting, for instance after seeking */
+        startup = true;
+}
@@ -0,0 +1,57 @@
+/*
+ * BufferBasedAdaptationLogic.hpp
+ *****************************************************************************
+ * Copyright (C) 2015 - VideoLAN authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef BUFFERBASEDADAPTATIONLOGIC_HPP
+#define BUFFERBASEDADAPTATIONLOGIC_HPP
+
+#include "AbstractAdaptationLogic.h"
+
+#include <vector>
+
+namespace dash
+{
+    namespace logic
+    {
+        /* BOLA: chooses the representation maximizing the utility of the
+         * next segment, weighted by the buffer level (Spiteri, Urgaonkar and
+         * Sitaraman, "BOLA: Near-Optimal Bitrate Adaptation for Online
+         * Videos", 2016). The throughput only drives the startup phase and
+         * caps switching up. */
+        class BufferBasedAdaptationLogic : public AbstractAdaptationLogic
+        {
+            public:
+                BufferBasedAdaptationLogic(mpd::MPD *mpd);
+
+                virtual mpd::Representation *getCurrentRepresentation(Streams::Type, mpd::Period *) const;
+                virtual void updateBufferLevel(mtime_t);
+
+            private:
+                size_t selectByBuffer(const std::vector<mpd::Representation *> &,
+                                      mtime_t) const;
+                size_t selectByRate(const std::vector<mpd::Representation *> &) const;
+
+                bool                    trace;
+                mtime_t                 bufferLevel;
+                mutable bool            startup;
+                mutable mpd::Representation *previous;
+        };
+    }
+}
+
+#endif // BUFFERBASEDADAPTATIONLOGIC_HPP
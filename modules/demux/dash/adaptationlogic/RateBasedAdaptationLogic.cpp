@@ -36,9 +36,7 @@ using namespace dash::logic;
 using namespace dash::mpd;
 
 RateBasedAdaptationLogic::RateBasedAdaptationLogic  (MPD *mpd) :
-                          AbstractAdaptationLogic   (mpd),
-                          bpsAvg(0), bpsSamplecount(0),
-                          currentBps(0)
+                          AbstractAdaptationLogic   (mpd)
 {
     width  = var_InheritInteger(mpd->getVLCObject(), "dash-prefwidth");
     height = var_InheritInteger(mpd->getVLCObject(), "dash-prefheight");
@@ -50,7 +48,7 @@ Representation *RateBasedAdaptationLogic::getCurrentRepresentation(Streams::Type
         return NULL;
 
     RepresentationSelector selector;
-    Representation *rep = selector.select(period, type, currentBps, width, height);
+    Representation *rep = selector.select(period, type, getThroughput(), width, height);
     if ( rep == NULL )
     {
         rep = selector.select(period, type);
@@ -60,24 +58,6 @@ Representation *RateBasedAdaptationLogic::getCurrentRepresentation(Streams::Type
     return rep;
 }
 
-void RateBasedAdaptationLogic::updateDownloadRate(size_t size, mtime_t time)
-{
-    if(unlikely(time == 0))
-        return;
-
-    size_t current = size * 8000 / time;
-
-    if (current >= bpsAvg)
-        bpsAvg = bpsAvg + (current - bpsAvg) / (bpsSamplecount + 1);
-    else
-        bpsAvg = bpsAvg - (bpsAvg - current) / (bpsSamplecount + 1);
-
-    bpsSamplecount++;
-
-    if(bpsSamplecount % 5 == 0)
-        currentBps = bpsAvg;
-}
-
 FixedRateAdaptationLogic::FixedRateAdaptationLogic(mpd::MPD *mpd) :
     AbstractAdaptationLogic(mpd)
 {
@@ -39,14 +39,10 @@ namespace dash
                 RateBasedAdaptationLogic            (mpd::MPD *mpd);
 
                 dash::mpd::Representation *getCurrentRepresentation(Streams::Type, mpd::Period *) const;
-                virtual void updateDownloadRate(size_t, mtime_t);
 
             private:
                 int                     width;
                 int                     height;
-                size_t                  bpsAvg;
-                size_t                  bpsSamplecount;
-                size_t                  currentBps;
         };
 
         class FixedRateAdaptationLogic : public AbstractAdaptationLogic
@@ -61,15 +61,26 @@ static void Close   (vlc_object_t *);
 
 #define DASH_LOGIC_TEXT N_("Adaptation Logic")
 
+#define DASH_BUFFER_TEXT N_("Download buffer per stream (KiB)")
+#define DASH_BUFFER_LONGTEXT N_("Amount of data downloaded ahead of the " \
+                                "demuxer for each of the audio and video streams")
+
+#define DASH_TRACE_TEXT N_("Trace adaptation decisions")
+#define DASH_TRACE_LONGTEXT N_("Log every representation choice of the buffer " \
+                               "based logic, with the buffer level and the " \
+                               "measured throughput")
+
 static const int pi_logics[] = {dash::logic::AbstractAdaptationLogic::RateBased,
                                 dash::logic::AbstractAdaptationLogic::FixedRate,
                                 dash::logic::AbstractAdaptationLogic::AlwaysLowest,
-                                dash::logic::AbstractAdaptationLogic::AlwaysBest};
+                                dash::logic::AbstractAdaptationLogic::AlwaysBest,
+                                dash::logic::AbstractAdaptationLogic::BufferBased};
 
 static const char *const ppsz_logics[] = { N_("Bandwidth Adaptive"),
                                            N_("Fixed Bandwidth"),
                                            N_("Lowest Bandwidth/Quality"),
-                                           N_("Highest Bandwith/Quality")};
+                                           N_("Highest Bandwith/Quality"),
+                                           N_("Buffer Based")};
 
 vlc_module_begin ()
         set_shortname( N_("DASH"))
@@ -83,6 +94,9 @@ vlc_module_begin ()
         add_integer( "dash-prefwidth",  480, DASH_WIDTH_TEXT,  DASH_WIDTH_LONGTEXT,  true )
         add_integer( "dash-prefheight", 360, DASH_HEIGHT_TEXT, DASH_HEIGHT_LONGTEXT, true )
         add_integer( "dash-prefbw",     250, DASH_BW_TEXT,     DASH_BW_LONGTEXT,     false )
+        add_integer( "dash-buffersize", 4096, DASH_BUFFER_TEXT, DASH_BUFFER_LONGTEXT, true )
+            change_integer_range( 64, 65536 )
+        add_bool(    "dash-trace",      false, DASH_TRACE_TEXT, DASH_TRACE_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -182,14 +196,15 @@ static int Demux(demux_t *p_demux)
             else
                 es_out_Control(p_demux->out, ES_OUT_SET_PCR, pcr);
         }
-
-        if( !p_sys->p_dashManager->updateMPD() )
-            return VLC_DEMUXER_EOF;
-
-        return VLC_DEMUXER_SUCCESS;
     }
-    else
+    else if ( p_sys->p_dashManager->isEOF() )
         return VLC_DEMUXER_EOF;
+    /* else still downloading */
+
+    if( !p_sys->p_dashManager->updateMPD() )
+        return VLC_DEMUXER_EOF;
+
+    return VLC_DEMUXER_SUCCESS;
 }
 
 static int  Control         (demux_t *p_demux, int i_query, va_list args)
@@ -64,19 +64,23 @@ bool AtomsReader::parseBlock(void *buffer, size_t size, Representation *rep)
             MP4_BoxDumpStructure(stream, rootbox);
 #endif
             MP4_Box_t *sidxbox = MP4_BoxGet(rootbox, "sidx");
-            if (sidxbox)
+            if (sidxbox && sidxbox->data.p_sidx)
             {
+                /* Split points are relative to the first subsegment */
+                MP4_Box_data_sidx_t *sidx = sidxbox->data.p_sidx;
+                MP4_FragIndex_t index;
+                MP4_FragIndexInit(&index, sidx->i_timescale);
+                MP4_FragIndexAddSidx(&index, sidxbox, 0);
+
                 Representation::SplitPoint point;
                 std::vector<Representation::SplitPoint> splitlist;
-                MP4_Box_data_sidx_t *sidx = sidxbox->data.p_sidx;
-                point.offset = sidx->i_first_offset;
-                point.time = 0;
-                for(uint16_t i=0; i<sidx->i_reference_count; i++)
+                for(unsigned i=0; i<index.i_entries; i++)
                 {
+                    point.offset = index.p_entries[i].i_offset;
+                    point.time = index.p_entries[i].i_time - sidx->i_earliest_presentation_time;
                     splitlist.push_back(point);
-                    point.offset += sidx->p_items[i].i_referenced_size;
-                    point.time += sidx->p_items[i].i_subsegment_duration;
                 }
+                MP4_FragIndexClean(&index);
                 rep->SplitUsingIndex(splitlist);
             }
         }
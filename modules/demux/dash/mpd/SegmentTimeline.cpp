@@ -195,6 +195,15 @@ mtime_t SegmentTimeline::end() const
     return CLOCK_FREQ * scaled / inheritTimescale();
 }
 
+/* Elements starting before this one are ignored when merging */
+bool SegmentTimeline::lastScaledStart(mtime_t *scaled) const
+{
+    if(elements.empty())
+        return false;
+    *scaled = elements.back()->t;
+    return true;
+}
+
 SegmentTimeline::Element::Element(mtime_t d_, uint64_t r_, mtime_t t_)
 {
     d = d_;
@@ -46,6 +46,7 @@ namespace dash
                 void mergeWith(SegmentTimeline &);
                 mtime_t start() const;
                 mtime_t end() const;
+                bool lastScaledStart(mtime_t *) const;
 
             private:
                 std::list<Element *> elements;
@@ -0,0 +1,211 @@
+/*
+ * TimelineUpdateParser.cpp
+ *****************************************************************************
+ * Copyright (C) 2015 - VideoLAN authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "TimelineUpdateParser.h"
+#include "MPD.h"
+#include "Period.h"
+#include "SegmentTimeline.h"
+#include "IsoffMainParser.h"
+
+#include <vlc_xml.h>
+#include <vlc_stream.h>
+
+#include <cstring>
+
+using namespace dash::mpd;
+
+TimelineUpdateParser::TimelineUpdateParser(stream_t *stream_, MPD *mpd_) :
+    stream(stream_), reader(NULL), mpd(mpd_),
+    period(-1), timeline(NULL), timelineValid(false),
+    hasLastStart(false), lastStart(0), next(0), newElements(0)
+{
+    const std::vector<Period *> &periods = mpd->getPeriods();
+    current.resize(periods.size());
+    updates.resize(periods.size());
+    for(size_t i = 0; i < periods.size(); i++)
+        periods.at(i)->collectTimelines(&current.at(i));
+}
+
+TimelineUpdateParser::~TimelineUpdateParser()
+{
+    delete timeline;
+    for(size_t i = 0; i < updates.size(); i++)
+        vlc_delete_all(updates.at(i));
+}
+
+bool TimelineUpdateParser::parse()
+{
+    xml_t *xml = xml_Create(stream);
+    if(!xml)
+        return false;
+    reader = xml_ReaderCreate(xml, stream);
+    if(!reader)
+    {
+        xml_Delete(xml);
+        return false;
+    }
+
+    bool inTemplate = false; /* with a media URL, as IsoffMainParser wants */
+    bool inTimeline = false;
+    const char *name;
+    int type;
+
+    while((type = xml_ReaderNextNode(reader, &name)) > 0)
+    {
+        if(type == XML_READER_STARTELEM)
+        {
+            bool empty = xml_ReaderIsEmptyElement(reader);
+
+            if(!strcmp(name, "Period"))
+            {
+                period++;
+            }
+            else if(!strcmp(name, "SegmentTemplate"))
+            {
+                const char *attr, *value;
+                bool media = false;
+                while((attr = xml_ReaderNextAttr(reader, &value)) != NULL)
+                    if(!strcmp(attr, "media") && *value)
+                        media = true;
+                inTemplate = media && !empty;
+            }
+            else if(!strcmp(name, "SegmentTimeline") && inTemplate && !empty)
+            {
+                startTimeline();
+                inTimeline = true;
+            }
+            else if(!strcmp(name, "S") && inTimeline)
+            {
+                parseElement();
+            }
+        }
+        else if(type == XML_READER_ENDELEM)
+        {
+            if(!strcmp(name, "SegmentTimeline") && inTimeline)
+            {
+                endTimeline();
+                inTimeline = false;
+            }
+            else if(!strcmp(name, "SegmentTemplate"))
+            {
+                inTemplate = false;
+            }
+        }
+    }
+
+    xml_ReaderDelete(reader);
+    reader = NULL;
+    xml_Delete(xml);
+
+    return type == 0 && period >= 0;
+}
+
+void TimelineUpdateParser::startTimeline()
+{
+    size_t index = 0;
+    if(period >= 0 && (size_t)period < updates.size())
+        index = updates.at(period).size();
+
+    delete timeline;
+    timeline = new (std::nothrow) SegmentTimeline();
+    timelineValid = false;
+    next = 0;
+    hasLastStart = period >= 0 && (size_t)period < current.size() &&
+                   index < current.at(period).size() &&
+                   current.at(period).at(index)->lastScaledStart(&lastStart);
+}
+
+void TimelineUpdateParser::parseElement()
+{
+    const char *attr, *value;
+    bool hasDuration = false;
+    bool hasTime = false;
+    mtime_t d = 0, t = 0;
+    uint64_t r = 0;
+
+    while((attr = xml_ReaderNextAttr(reader, &value)) != NULL)
+    {
+        if(!strcmp(attr, "d"))
+        {
+            d = Integer<mtime_t>(value);
+            hasDuration = true;
+        }
+        else if(!strcmp(attr, "r"))
+            r = Integer<uint64_t>(value);
+        else if(!strcmp(attr, "t"))
+        {
+            t = Integer<mtime_t>(value);
+            hasTime = true;
+        }
+    }
+
+    if(!hasDuration) /* Mandatory */
+        return;
+    timelineValid = true;
+
+    if(!hasTime)
+        t = next;
+    next = t + d * (mtime_t)(r + 1);
+
+    /* Already known: skip it rather than allocating it for nothing */
+    if(hasLastStart && t < lastStart)
+        return;
+
+    if(timeline)
+    {
+        timeline->addElement(d, r, t);
+        newElements++;
+    }
+}
+
+void TimelineUpdateParser::endTimeline()
+{
+    /* As IsoffMainParser, ignore timelines without any valid element, so
+     * that the next ones keep matching */
+    if(timeline && timelineValid && period >= 0 &&
+       (size_t)period < updates.size())
+    {
+        updates.at(period).push_back(timeline);
+        timeline = NULL;
+    }
+    delete timeline;
+    timeline = NULL;
+}
+
+void TimelineUpdateParser::merge(mtime_t prunebarrier)
+{
+    for(size_t i = 0; i < current.size(); i++)
+    {
+        for(size_t j = 0; j < current.at(i).size() && j < updates.at(i).size(); j++)
+        {
+            current.at(i).at(j)->mergeWith(*updates.at(i).at(j));
+            if(prunebarrier)
+                current.at(i).at(j)->prune(prunebarrier);
+        }
+    }
+}
+
+size_t TimelineUpdateParser::getNewElementsCount() const
+{
+    return newElements;
+}
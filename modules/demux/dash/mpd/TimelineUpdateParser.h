@@ -0,0 +1,76 @@
+/*
+ * TimelineUpdateParser.h
+ *****************************************************************************
+ * Copyright (C) 2015 - VideoLAN authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef TIMELINEUPDATEPARSER_H_
+#define TIMELINEUPDATEPARSER_H_
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include <vector>
+
+namespace dash
+{
+    namespace mpd
+    {
+        class MPD;
+        class SegmentTimeline;
+
+        /* Reads a live MPD refresh as a stream of XML events, without
+         * building a document tree nor a new MPD: only the SegmentTimeline
+         * elements which are not known yet are kept, then merged into the
+         * current MPD. Timelines are matched by position, in the same order
+         * as SegmentInformation::collectTimelines(). */
+        class TimelineUpdateParser
+        {
+            public:
+                TimelineUpdateParser(stream_t *, MPD *);
+                ~TimelineUpdateParser();
+
+                bool    parse   ();
+                void    merge   (mtime_t prunebarrier);
+                size_t  getNewElementsCount () const;
+
+            private:
+                void    startTimeline   ();
+                void    endTimeline     ();
+                void    parseElement    ();
+
+                stream_t                *stream;
+                xml_reader_t            *reader;
+                MPD                     *mpd;
+                std::vector<std::vector<SegmentTimeline *> > current;
+                std::vector<std::vector<SegmentTimeline *> > updates;
+
+                /* parsing state */
+                int                     period;
+                SegmentTimeline         *timeline;
+                bool                    timelineValid;
+                bool                    hasLastStart;
+                mtime_t                 lastStart;
+                mtime_t                 next;
+                size_t                  newElements;
+        };
+    }
+}
+
+#endif /* TIMELINEUPDATEPARSER_H_ */
@@ -60,6 +60,8 @@ vlc_module_end ()
  *****************************************************************************/
 static int Demux  ( demux_t * );
 static int Control( demux_t *, int, va_list );
+static bool SeekpointInsert( demux_sys_t *, int64_t i_time, int64_t i_offset,
+                             int64_t i_interval );
 
 static int  ReadMeta( demux_t *, uint8_t **pp_streaminfo, int *pi_streaminfo );
 
@@ -77,11 +79,16 @@ struct demux_sys_t
 
     int64_t i_length; /* Length from stream info */
     int64_t i_data_pos;
+    int     i_rate;   /* Sample rate from stream info */
 
     /* */
     int         i_seekpoint;
     seekpoint_t **seekpoint;
 
+    /* Position of the next frame, relative to i_data_pos, while it is known */
+    bool        b_exact;
+    int64_t     i_next_offset;
+
     /* */
     int                i_attachments;
     input_attachment_t **attachments;
@@ -92,6 +99,15 @@ struct demux_sys_t
 #define STREAMINFO_SIZE 34
 #define FLAC_PACKET_SIZE 16384
 
+#define FLAC_HEADER_SIZE_MAX 16
+/* Interval between the seekpoints added during the playback */
+#define FLAC_SEEKPOINT_INTERVAL (CLOCK_FREQ * 5)
+/* Seeks decode forward from a seekpoint up to this duration... */
+#define FLAC_SEEK_FORWARD CLOCK_FREQ
+/* ...or this size, before looking for closer frames */
+#define FLAC_SEEK_PEEK (FLAC_PACKET_SIZE * 4)
+#define FLAC_SEEK_STEPS 32
+
 /*****************************************************************************
  * Open: initializes ES structures
  *****************************************************************************/
@@ -135,7 +151,10 @@ static int Open( vlc_object_t * p_this )
     p_sys->b_start = true;
     p_sys->p_meta = NULL;
     p_sys->i_length = 0;
+    p_sys->i_rate = 0;
     p_sys->i_pts = 0;
+    p_sys->b_exact = true;
+    p_sys->i_next_offset = 0;
     p_sys->p_es = NULL;
     TAB_INIT( p_sys->i_seekpoint, p_sys->seekpoint );
     TAB_INIT( p_sys->i_attachments, p_sys->attachments);
@@ -233,6 +252,16 @@ static int Demux( demux_t *p_demux )
 
             p_sys->i_pts = p_block_out->i_dts;
 
+            /* Index the frames while their position is known */
+            if( p_sys->b_exact )
+            {
+                if( p_block_out->i_dts > VLC_TS_INVALID )
+                    SeekpointInsert( p_sys, p_block_out->i_dts - VLC_TS_0,
+                                     p_sys->i_next_offset,
+                                     FLAC_SEEKPOINT_INTERVAL );
+                p_sys->i_next_offset += p_block_out->i_buffer;
+            }
+
             /* set PCR */
             es_out_Control( p_demux->out, ES_OUT_SET_PCR, p_block_out->i_dts );
 
@@ -244,6 +273,219 @@ static int Demux( demux_t *p_demux )
     return !b_eof;
 }
 
+/*****************************************************************************
+ * Seek table
+ *****************************************************************************/
+
+/* Inserts a seekpoint in the table, which is sorted by time */
+static bool SeekpointInsert( demux_sys_t *p_sys, int64_t i_time,
+                             int64_t i_offset, int64_t i_interval )
+{
+    int i;
+
+    for( i = p_sys->i_seekpoint; i > 0; i-- )
+    {
+        if( p_sys->seekpoint[i-1]->i_time_offset <= i_time )
+            break;
+    }
+    if( ( i > 0 &&
+          i_time - p_sys->seekpoint[i-1]->i_time_offset <= i_interval ) ||
+        ( i < p_sys->i_seekpoint &&
+          p_sys->seekpoint[i]->i_time_offset - i_time <= i_interval ) )
+        return false;
+
+    seekpoint_t *s = vlc_seekpoint_New();
+    if( unlikely(s == NULL) )
+        return false;
+    s->i_time_offset = i_time;
+    s->i_byte_offset = i_offset;
+    TAB_INSERT( p_sys->i_seekpoint, p_sys->seekpoint, s, i );
+    return true;
+}
+
+static uint8_t FrameHeaderCrc8( const uint8_t *p, int i_size )
+{
+    uint8_t i_crc = 0;
+
+    while( i_size-- > 0 )
+    {
+        i_crc ^= *p++;
+        for( int i = 0; i < 8; i++ )
+            i_crc = i_crc & 0x80 ? ( i_crc << 1 ) ^ 0x07 : i_crc << 1;
+    }
+    return i_crc;
+}
+
+/* Parses a frame header, and returns the time of the frame, or -1 */
+static int64_t ParseFrameHeader( demux_t *p_demux, const uint8_t *p, int i_size )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( i_size < FLAC_HEADER_SIZE_MAX || p_sys->i_rate <= 0 )
+        return -1;
+    if( p[0] != 0xFF || (p[1] & 0xFE) != 0xF8 || p[2] == 0xFF || p[3] == 0xFF )
+        return -1;
+
+    const unsigned i_blocksize_code = p[2] >> 4;
+    const unsigned i_rate_code = p[2] & 0x0F;
+    const unsigned i_bps_code = (p[3] >> 1) & 0x07;
+    if( i_blocksize_code == 0 || i_rate_code == 15 || (p[3] >> 4) >= 11 ||
+        i_bps_code == 3 || i_bps_code == 7 || (p[3] & 0x01) )
+        return -1;
+
+    /* Frame number, or sample number for variable block sizes, coded like
+     * UTF-8 on up to 7 bytes */
+    int i_header = 4;
+    int i_extra;
+    uint64_t i_number = p[i_header++];
+
+    if( i_number < 0x80 )
+        i_extra = 0;
+    else if( i_number == 0xFE )
+        i_extra = 6, i_number = 0;
+    else
+    {
+        for( i_extra = 0; i_number & ( 0x40 >> i_extra ); i_extra++ );
+        if( i_extra == 0 || i_extra > 5 )
+            return -1;
+        i_number &= 0x3F >> i_extra;
+    }
+    for( ; i_extra > 0; i_extra-- )
+    {
+        if( (p[i_header] & 0xC0) != 0x80 )
+            return -1;
+        i_number = ( i_number << 6 ) | ( p[i_header++] & 0x3F );
+    }
+
+    unsigned i_blocksize;
+    if( i_blocksize_code == 1 )
+        i_blocksize = 192;
+    else if( i_blocksize_code <= 5 )
+        i_blocksize = 576 << ( i_blocksize_code - 2 );
+    else if( i_blocksize_code == 6 )
+        i_blocksize = p[i_header++] + 1;
+    else if( i_blocksize_code == 7 )
+    {
+        i_blocksize = GetWBE( &p[i_header] ) + 1;
+        i_header += 2;
+    }
+    else
+        i_blocksize = 256 << ( i_blocksize_code - 8 );
+
+    if( i_rate_code == 12 )
+        i_header++;
+    else if( i_rate_code > 12 )
+        i_header += 2;
+
+    if( FrameHeaderCrc8( p, i_header ) != p[i_header] )
+        return -1;
+
+    const uint64_t i_sample = (p[1] & 0x01) ? i_number : i_number * i_blocksize;
+    return i_sample * CLOCK_FREQ / p_sys->i_rate;
+}
+
+/* Finds the first frame from the offset, which is dated between the bounds
+ * (exclusive) */
+static int FindFrame( demux_t *p_demux, int64_t i_offset, int64_t i_end,
+                      int64_t i_time_min, int64_t i_time_max,
+                      int64_t *pi_offset, int64_t *pi_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const uint8_t *p_peek;
+
+    if( stream_Seek( p_demux->s, p_sys->i_data_pos + i_offset ) )
+        return VLC_EGENERIC;
+
+    const int i_peek = stream_Peek( p_demux->s, &p_peek,
+                                    __MIN( FLAC_SEEK_PEEK,
+                                           i_end - i_offset + FLAC_HEADER_SIZE_MAX ) );
+    for( int i = 0; i + FLAC_HEADER_SIZE_MAX <= i_peek && i_offset + i < i_end; i++ )
+    {
+        const int64_t i_time = ParseFrameHeader( p_demux, &p_peek[i], i_peek - i );
+
+        if( i_time > i_time_min && i_time < i_time_max )
+        {
+            *pi_offset = i_offset + i;
+            *pi_time = i_time;
+            return VLC_SUCCESS;
+        }
+    }
+    return VLC_EGENERIC;
+}
+
+/* Adds seekpoints around the time, by parsing the frame headers found
+ * between the seekpoints which surround it */
+static void RefineSeekpoints( demux_t *p_demux, int64_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const int64_t i_size = stream_Size( p_demux->s ) - p_sys->i_data_pos;
+
+    for( int i_step = 0; i_step < FLAC_SEEK_STEPS; i_step++ )
+    {
+        int i;
+
+        for( i = p_sys->i_seekpoint-1; i > 0; i-- )
+        {
+            if( p_sys->seekpoint[i]->i_time_offset <= i_time )
+                break;
+        }
+
+        const seekpoint_t *s = p_sys->seekpoint[i];
+        const bool b_last = i+1 >= p_sys->i_seekpoint;
+        const int64_t i_end = b_last ? i_size : p_sys->seekpoint[i+1]->i_byte_offset;
+        const int64_t i_end_time = b_last ? p_sys->i_length : p_sys->seekpoint[i+1]->i_time_offset;
+
+        if( i_time - s->i_time_offset < FLAC_SEEK_FORWARD ||
+            i_end - s->i_byte_offset < FLAC_SEEK_PEEK ||
+            i_end_time <= s->i_time_offset )
+            break;
+
+        /* Interpolate the position, but keep it away from the bounds */
+        int64_t i_delta = ( i_end - s->i_byte_offset ) / 8;
+        int64_t i_offset = s->i_byte_offset + ( i_end - s->i_byte_offset ) *
+            (double)( i_time - s->i_time_offset ) / ( i_end_time - s->i_time_offset );
+        i_offset = __MIN( __MAX( i_offset, s->i_byte_offset + i_delta ),
+                          i_end - i_delta );
+
+        int64_t i_frame_offset, i_frame_time;
+        if( FindFrame( p_demux, i_offset, i_end,
+                       s->i_time_offset, b_last ? INT64_MAX : i_end_time,
+                       &i_frame_offset, &i_frame_time ) ||
+            !SeekpointInsert( p_sys, i_frame_time, i_frame_offset, 0 ) )
+            break;
+    }
+}
+
+/* Checks that a frame starts at the seekpoint */
+static bool CheckSeekpoint( demux_t *p_demux, const seekpoint_t *s )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const uint8_t *p_peek;
+
+    if( stream_Seek( p_demux->s, p_sys->i_data_pos + s->i_byte_offset ) )
+        return false;
+
+    const int i_peek = stream_Peek( p_demux->s, &p_peek, FLAC_HEADER_SIZE_MAX );
+    const int64_t i_time = ParseFrameHeader( p_demux, p_peek, i_peek );
+    return i_time >= 0 && llabs( i_time - s->i_time_offset ) <= 1;
+}
+
+/* Empties the packetizer after a seek */
+static void ResetPacketizer( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    block_t *p_block = block_Alloc( 0 );
+
+    if( p_block == NULL )
+        return;
+    p_block->i_flags |= BLOCK_FLAG_DISCONTINUITY | BLOCK_FLAG_CORRUPTED;
+
+    block_t *p_out = p_sys->p_packetizer->pf_packetize( p_sys->p_packetizer,
+                                                        &p_block );
+    if( p_out )
+        block_ChainRelease( p_out );
+}
+
 /*****************************************************************************
  * Control:
  *****************************************************************************/
@@ -293,20 +535,35 @@ static int ControlSetTime( demux_t *p_demux, int64_t i_time )
 
     /* */
     assert( p_sys->i_seekpoint > 0 );   /* ReadMeta ensure at least (0,0) */
-    for( i = p_sys->i_seekpoint-1; i >= 0; i-- )
+    RefineSeekpoints( p_demux, i_time );
+    for( ;; )
     {
-        if( p_sys->seekpoint[i]->i_time_offset <= i_time )
+        for( i = p_sys->i_seekpoint-1; i > 0; i-- )
+        {
+            if( p_sys->seekpoint[i]->i_time_offset <= i_time )
+                break;
+        }
+        /* Drop the seekpoints which do not point to a frame */
+        if( i == 0 || CheckSeekpoint( p_demux, p_sys->seekpoint[i] ) )
             break;
+        msg_Warn( p_demux, "invalid seekpoint at %"PRId64,
+                  p_sys->seekpoint[i]->i_byte_offset );
+        vlc_seekpoint_Delete( p_sys->seekpoint[i] );
+        TAB_REMOVE( p_sys->i_seekpoint, p_sys->seekpoint, p_sys->seekpoint[i] );
     }
     i_delta_time = i_time - p_sys->seekpoint[i]->i_time_offset;
 
+    ResetPacketizer( p_demux );
+
     /* XXX We do exact seek if it's not too far away(45s) */
     if( i_delta_time < CLOCK_FREQ * 45 )
     {
         if( stream_Seek( p_demux->s, p_sys->seekpoint[i]->i_byte_offset+p_sys->i_data_pos ) )
             return VLC_EGENERIC;
 
-        es_out_Control( p_demux->out, ES_OUT_SET_NEXT_DISPLAY_TIME, i_time );
+        p_sys->b_exact = true;
+        p_sys->i_next_offset = p_sys->seekpoint[i]->i_byte_offset;
+        es_out_Control( p_demux->out, ES_OUT_SET_NEXT_DISPLAY_TIME, VLC_TS_0 + i_time );
     }
     else
     {
@@ -337,6 +594,8 @@ static int ControlSetTime( demux_t *p_demux, int64_t i_time )
 
         if( stream_Seek( p_demux->s, p_sys->seekpoint[i]->i_byte_offset+p_sys->i_data_pos + i_delta_offset ) )
             return VLC_EGENERIC;
+
+        p_sys->b_exact = false;
     }
     return VLC_SUCCESS;
 }
@@ -498,6 +757,7 @@ static int  ReadMeta( demux_t *p_demux, uint8_t **pp_streaminfo, int *pi_streami
             ParseStreamInfo( &i_sample_rate, &i_sample_count, *pp_streaminfo );
             if( i_sample_rate > 0 )
                 p_sys->i_length = i_sample_count * CLOCK_FREQ /i_sample_rate;
+            p_sys->i_rate = i_sample_rate;
             continue;
         }
         else if( i_type == META_SEEKTABLE )
@@ -27,6 +27,7 @@
 #include "demux.hpp"
 #include "util.hpp"
 #include "Ebml_parser.hpp"
+#include "stream_io_callback.hpp"
 
 matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estream )
     :segment(NULL)
@@ -62,12 +63,21 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,ep(NULL)
     ,b_preloaded(false)
     ,b_ref_external_segments(false)
+    ,b_indexer(false)
+    ,b_indexer_closing(false)
+    ,psz_indexer_url(NULL)
+    ,i_indexer_start(0)
+    ,i_indexer_end(0)
 {
     p_indexes = (mkv_index_t*)malloc( sizeof( mkv_index_t ) * i_index_max );
+    vlc_mutex_init( &indexer_lock );
 }
 
 matroska_segment_c::~matroska_segment_c()
 {
+    IndexerStop();
+    vlc_mutex_destroy( &indexer_lock );
+
     for( size_t i_track = 0; i_track < tracks.size(); i_track++ )
     {
         delete tracks[i_track]->p_compression_data;
@@ -586,12 +596,18 @@ void matroska_segment_c::InformationCreate( )
  *****************************************************************************/
 
 void matroska_segment_c::IndexAppendCluster( KaxCluster *cluster )
+{
+    IndexAppend( cluster->GetElementPosition(),
+                 cluster->GlobalTimecode() / (mtime_t) 1000 );
+}
+
+void matroska_segment_c::IndexAppend( int64_t i_position, mtime_t i_time )
 {
 #define idx p_indexes[i_index]
     idx.i_track       = -1;
     idx.i_block_number= -1;
-    idx.i_position    = cluster->GetElementPosition();
-    idx.i_time        = cluster->GlobalTimecode()/ (mtime_t) 1000;
+    idx.i_position    = i_position;
+    idx.i_time        = i_time;
     idx.b_key         = true;
 
     i_index++;
@@ -604,6 +620,188 @@ void matroska_segment_c::IndexAppendCluster( KaxCluster *cluster )
 #undef idx
 }
 
+/* EBML IDs, with their length marker */
+#define MKV_ID_CLUSTER           0x1F43B675
+#define MKV_ID_CLUSTER_TIMECODE  0xE7
+#define MKV_ID_BLOCKGROUP        0xA0
+#define MKV_ID_SIMPLEBLOCK       0xA3
+
+/* Reads an element ID, or an element size (UINT64_MAX if unknown) */
+static bool IndexerReadVint( stream_t *s, bool b_id, uint64_t *pi_value )
+{
+    uint8_t p_buf[8];
+    if( stream_Read( s, p_buf, 1 ) != 1 )
+        return false;
+
+    unsigned i_len = 1;
+    while( i_len <= 8 && !( p_buf[0] & ( 0x80 >> ( i_len - 1 ) ) ) )
+        i_len++;
+    if( i_len > ( b_id ? 4 : 8 ) )
+        return false;
+    if( i_len > 1 && stream_Read( s, &p_buf[1], i_len - 1 ) != (int)( i_len - 1 ) )
+        return false;
+
+    uint64_t i_value = b_id ? p_buf[0] : p_buf[0] & ( 0xFF >> i_len );
+    bool b_unknown = i_value == (uint64_t)( 0xFF >> i_len );
+    for( unsigned i = 1; i < i_len; i++ )
+    {
+        i_value = ( i_value << 8 ) | p_buf[i];
+        b_unknown = b_unknown && p_buf[i] == 0xFF;
+    }
+    *pi_value = ( !b_id && b_unknown ) ? UINT64_MAX : i_value;
+    return true;
+}
+
+/* Reads the timecode of a cluster, which precedes its blocks */
+static bool IndexerReadTimecode( stream_t *s, uint64_t i_cluster_size,
+                                 uint64_t *pi_timecode )
+{
+    const uint64_t i_end = stream_Tell( s ) + i_cluster_size;
+
+    while( (uint64_t)stream_Tell( s ) < i_end )
+    {
+        uint64_t i_id, i_size;
+        if( !IndexerReadVint( s, true, &i_id ) ||
+            !IndexerReadVint( s, false, &i_size ) || i_size == UINT64_MAX )
+            return false;
+
+        if( i_id == MKV_ID_CLUSTER_TIMECODE )
+        {
+            uint8_t p_buf[8];
+            if( i_size > 8 || stream_Read( s, p_buf, i_size ) != (int)i_size )
+                return false;
+            *pi_timecode = 0;
+            for( unsigned i = 0; i < i_size; i++ )
+                *pi_timecode = ( *pi_timecode << 8 ) | p_buf[i];
+            return true;
+        }
+        if( i_id == MKV_ID_BLOCKGROUP || i_id == MKV_ID_SIMPLEBLOCK )
+            return false;
+        if( stream_Seek( s, stream_Tell( s ) + i_size ) )
+            return false;
+    }
+    return false;
+}
+
+void *matroska_segment_c::IndexerThread( void *data )
+{
+    static_cast<matroska_segment_c *>( data )->IndexerRun();
+    return NULL;
+}
+
+/* Walks the level 1 elements from their headers, skipping the clusters
+ * payload, on a stream of its own */
+void matroska_segment_c::IndexerRun()
+{
+    stream_t *s = stream_UrlNew( &sys.demuxer, psz_indexer_url );
+    if( s == NULL )
+        return;
+
+    int64_t i_pos = i_indexer_start;
+    unsigned i_clusters = 0;
+
+    while( i_pos < i_indexer_end )
+    {
+        vlc_mutex_lock( &indexer_lock );
+        bool b_closing = b_indexer_closing;
+        vlc_mutex_unlock( &indexer_lock );
+        if( b_closing )
+            break;
+
+        uint64_t i_id, i_size;
+        if( stream_Seek( s, i_pos ) ||
+            !IndexerReadVint( s, true, &i_id ) ||
+            !IndexerReadVint( s, false, &i_size ) || i_size == UINT64_MAX )
+            break;
+        const int64_t i_data = stream_Tell( s );
+
+        uint64_t i_timecode;
+        if( i_id == MKV_ID_CLUSTER &&
+            IndexerReadTimecode( s, i_size, &i_timecode ) )
+        {
+            mkv_index_t idx;
+            idx.i_track        = -1;
+            idx.i_block_number = -1;
+            idx.i_position     = i_pos;
+            idx.i_time         = i_timecode * i_timescale / 1000;
+            idx.b_key          = true;
+
+            vlc_mutex_lock( &indexer_lock );
+            indexer_pending.push_back( idx );
+            vlc_mutex_unlock( &indexer_lock );
+            i_clusters++;
+        }
+        i_pos = i_data + i_size;
+    }
+
+    msg_Dbg( &sys.demuxer, "indexed %u clusters up to %" PRId64,
+             i_clusters, i_pos );
+    stream_Delete( s );
+}
+
+void matroska_segment_c::IndexerStart()
+{
+    if( b_indexer || b_cues || segment == NULL )
+        return;
+
+    /* The indexer opens the file again, so only the segments of the main
+     * file are indexed, and only when it is a local one */
+    if( sys.demuxer.psz_file == NULL || sys.streams.empty() ||
+        sys.streams[0]->p_estream != &es )
+        return;
+
+    if( asprintf( &psz_indexer_url, "%s://%s", sys.demuxer.psz_access,
+                  sys.demuxer.psz_location ) == -1 )
+    {
+        psz_indexer_url = NULL;
+        return;
+    }
+
+    i_indexer_start = i_index > 0 ? p_indexes[i_index - 1].i_position : i_start_pos;
+    i_indexer_end = segment->IsFiniteSize() ? (int64_t)segment->GetEndPosition()
+                                            : INT64_MAX;
+    b_indexer_closing = false;
+
+    if( vlc_clone( &indexer_thread, IndexerThread, this,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        free( psz_indexer_url );
+        psz_indexer_url = NULL;
+        return;
+    }
+    b_indexer = true;
+}
+
+void matroska_segment_c::IndexerStop()
+{
+    if( !b_indexer )
+        return;
+
+    vlc_mutex_lock( &indexer_lock );
+    b_indexer_closing = true;
+    vlc_mutex_unlock( &indexer_lock );
+    vlc_join( indexer_thread, NULL );
+    b_indexer = false;
+
+    IndexerMerge();
+    free( psz_indexer_url );
+    psz_indexer_url = NULL;
+}
+
+/* Appends the clusters found by the indexer past the ones already known */
+void matroska_segment_c::IndexerMerge()
+{
+    vlc_mutex_lock( &indexer_lock );
+    for( size_t i = 0; i < indexer_pending.size(); i++ )
+    {
+        const mkv_index_t &idx = indexer_pending[i];
+        if( i_index == 0 || p_indexes[i_index - 1].i_position < idx.i_position )
+            IndexAppend( idx.i_position, idx.i_time );
+    }
+    indexer_pending.clear();
+    vlc_mutex_unlock( &indexer_lock );
+}
+
 bool matroska_segment_c::PreloadFamily( const matroska_segment_c & of_segment )
 {
     if ( b_preloaded )
@@ -861,6 +1059,8 @@ void matroska_segment_c::Seek( mtime_t i_date, mtime_t i_time_offset, int64_t i_
     for( size_t i = 0; i < tracks.size(); i++)
         tracks[i]->i_last_dts = VLC_TS_INVALID;
 
+    IndexerMerge();
+
     if( i_global_position >= 0 )
     {
         /* Special case for seeking in files with no cues */
@@ -1203,11 +1403,15 @@ bool matroska_segment_c::Select( mtime_t i_start_time )
     delete ep;
     ep = new EbmlParser( &es, segment, &sys.demuxer );
 
+    if( !b_cues )
+        IndexerStart();
+
     return true;
 }
 
 void matroska_segment_c::UnSelect( )
 {
+    IndexerStop();
     sys.p_ev->ResetPci();
     for( size_t i_track = 0; i_track < tracks.size(); i_track++ )
     {
@@ -1337,6 +1541,13 @@ int matroska_segment_c::BlockGet( KaxBlock * & pp_block, KaxSimpleBlock * & pp_s
                             tracks[i]->b_silent = false;
                         }
 
+                        /* read the whole cluster at once, rather than
+                         * element by element */
+                        vlc_stream_io_callback *p_io =
+                            dynamic_cast<vlc_stream_io_callback *>( &es.I_O() );
+                        if( p_io != NULL && cluster->IsFiniteSize() )
+                            p_io->ReadAhead( cluster->GetSize() );
+
                         ep->Down();
                     }
                     else if( MKV_IS_ID( el, KaxCues ) )
@@ -145,6 +145,11 @@ public:
     bool Select( mtime_t i_start_time );
     void UnSelect();
 
+    /* Clusters index built by a thread, for segments without cues */
+    void IndexerStart();
+    void IndexerStop();
+    void IndexerMerge();
+
     static bool CompareSegmentUIDs( const matroska_segment_c * item_a, const matroska_segment_c * item_b );
 
 private:
@@ -161,8 +166,21 @@ private:
     void ParseCluster( bool b_update_start_time = true );
     SimpleTag * ParseSimpleTags( KaxTagSimple *tag, int level = 50 );
     void IndexAppendCluster( KaxCluster *cluster );
+    void IndexAppend( int64_t i_position, mtime_t i_time );
     int32_t TrackInit( mkv_track_t * p_tk );
     void ComputeTrackPriority();
+
+    static void *IndexerThread( void * );
+    void IndexerRun();
+
+    vlc_thread_t             indexer_thread;
+    vlc_mutex_t              indexer_lock;
+    bool                     b_indexer;
+    bool                     b_indexer_closing;
+    char                     *psz_indexer_url;
+    int64_t                  i_indexer_start;
+    int64_t                  i_indexer_end;
+    std::vector<mkv_index_t> indexer_pending; /* found but not merged yet */
 };
 
 
@@ -32,6 +32,7 @@
 #include "Ebml_parser.hpp"
 
 #include "stream_io_callback.hpp"
+#include "segment_cache.hpp"
 
 #include <vlc_fs.h>
 #include <vlc_url.h>
@@ -60,7 +61,7 @@ vlc_module_begin ()
 
     add_bool( "mkv-preload-local-dir", true,
             N_("Preload MKV files in the same directory"),
-            N_("Preload matroska files in the same directory to find linked segments (not good for broken files)."), false );
+            N_("Look for the linked segments in the matroska files of the same directory. The segments of the files are remembered, so that only the needed files get opened (not good for broken files)."), false );
 
     add_bool( "mkv-seek-percent", false,
             N_("Seek based on percent not time"),
@@ -79,6 +80,221 @@ static int  Demux  ( demux_t * );
 static int  Control( demux_t *, int, va_list );
 static void Seek   ( demux_t *, mtime_t i_date, double f_percent, virtual_chapter_c *p_chapter );
 
+/*****************************************************************************
+ * Linked segments: the local files holding the segments referenced by the
+ * opened ones are looked up by UID in a cache of the directory, so that only
+ * the files actually needed get opened. The directory is scanned only when
+ * a referenced segment is not found in the cache, for the files it lacks.
+ *****************************************************************************/
+static void GetLinkedUIDs( const chapter_item_c *p_chap,
+                           std::vector<const EbmlBinary*> & uids )
+{
+    if( p_chap->p_segment_uid )
+        uids.push_back( p_chap->p_segment_uid );
+    for( size_t i = 0; i < p_chap->sub_chapters.size(); i++ )
+        GetLinkedUIDs( p_chap->sub_chapters[i], uids );
+}
+
+static void GetLinkedUIDs( const matroska_segment_c *p_segment,
+                           std::vector<const EbmlBinary*> & uids )
+{
+    if( p_segment->p_prev_segment_uid )
+        uids.push_back( p_segment->p_prev_segment_uid );
+    if( p_segment->p_next_segment_uid )
+        uids.push_back( p_segment->p_next_segment_uid );
+    for( size_t i = 0; i < p_segment->stored_editions.size(); i++ )
+        GetLinkedUIDs( p_segment->stored_editions[i], uids );
+}
+
+static void CacheSegmentUIDs( segment_uid_cache_c & cache, const std::string & file,
+                              const matroska_stream_c *p_stream )
+{
+    std::vector<std::string> uids;
+
+    for( size_t i = 0; p_stream && i < p_stream->segments.size(); i++ )
+        if( p_stream->segments[i]->p_segment_uid )
+            uids.push_back( segment_uid_cache_c::UIDToString(
+                                *p_stream->segments[i]->p_segment_uid ) );
+    cache.Set( file, uids );
+}
+
+static matroska_stream_c *OpenLinkedFile( demux_t *p_demux, const std::string & dir,
+                                          const std::string & file )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    std::string s_filename = dir + DIR_SEP_CHAR + file;
+    const uint8_t *p_peek;
+
+    char *psz_url = vlc_path2uri( s_filename.c_str(), "file" );
+    if( psz_url == NULL )
+        return NULL;
+    stream_t *p_file_stream = stream_UrlNew( p_demux, psz_url );
+    free( psz_url );
+
+    /* peek the begining */
+    if( p_file_stream == NULL ||
+        stream_Peek( p_file_stream, &p_peek, 4 ) < 4 ||
+        p_peek[0] != 0x1a || p_peek[1] != 0x45 ||
+        p_peek[2] != 0xdf || p_peek[3] != 0xa3 )
+    {
+        if( p_file_stream )
+            stream_Delete( p_file_stream );
+        msg_Dbg( p_demux, "the file '%s' cannot be opened", s_filename.c_str() );
+        return NULL;
+    }
+
+    vlc_stream_io_callback *p_file_io = new vlc_stream_io_callback( p_file_stream, true );
+    EbmlStream *p_estream = new EbmlStream(*p_file_io);
+
+    matroska_stream_c *p_stream = p_sys->AnalyseAllSegmentsFound( p_demux, p_estream );
+    if ( p_stream == NULL )
+    {
+        msg_Dbg( p_demux, "the file '%s' will not be used", s_filename.c_str() );
+        delete p_estream;
+        delete p_file_io;
+        return NULL;
+    }
+
+    p_stream->p_io_callback = p_file_io;
+    p_stream->p_estream = p_estream;
+    return p_stream;
+}
+
+static void DropLinkedFile( demux_sys_t *p_sys, matroska_stream_c *p_stream )
+{
+    for( size_t i = 0; i < p_stream->segments.size(); i++ )
+    {
+        std::vector<matroska_segment_c*>::iterator it =
+            std::find( p_sys->opened_segments.begin(), p_sys->opened_segments.end(),
+                       p_stream->segments[i] );
+        if( it != p_sys->opened_segments.end() )
+            p_sys->opened_segments.erase( it );
+        delete p_stream->segments[i];
+    }
+    delete p_stream;
+}
+
+static void PreloadLinkedFiles( demux_t *p_demux, const std::string & dir,
+                                const std::string & self, bool b_need_preload )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    segment_uid_cache_c cache( VLC_OBJECT(p_demux), dir );
+
+    /* the UIDs of the opened file are cached, also when preparsing it */
+    if( !self.empty() )
+        CacheSegmentUIDs( cache, self, p_sys->streams[0] );
+    if( !b_need_preload )
+        return;
+
+    std::vector<matroska_segment_c*> pending = p_sys->streams[0]->segments;
+    std::vector<const EbmlBinary*> missing;
+    bool b_scanned = false;
+
+    for( ;; )
+    {
+        /* resolve the references of the segments not yet looked at */
+        while( !pending.empty() )
+        {
+            std::vector<const EbmlBinary*> uids;
+
+            GetLinkedUIDs( pending.back(), uids );
+            pending.pop_back();
+
+            for( size_t i = 0; i < uids.size(); i++ )
+            {
+                std::string file;
+                matroska_stream_c *p_stream = NULL;
+
+                if( p_sys->FindSegment( *uids[i] ) )
+                    continue;
+                if( cache.Find( *uids[i], file ) && cache.Known( file ) )
+                    p_stream = OpenLinkedFile( p_demux, dir, file );
+                if( p_stream == NULL )
+                {
+                    missing.push_back( uids[i] );
+                    continue;
+                }
+                msg_Dbg( p_demux, "linked segment found in '%s'", file.c_str() );
+                p_sys->streams.push_back( p_stream );
+                pending.insert( pending.end(), p_stream->segments.begin(),
+                                p_stream->segments.end() );
+            }
+        }
+
+        for( size_t i = 0; i < missing.size(); )
+        {
+            if( p_sys->FindSegment( *missing[i] ) )
+                missing.erase( missing.begin() + i );
+            else
+                i++;
+        }
+        if( missing.empty() || b_scanned )
+            break;
+
+        /* scan the files of the directory missing from the cache */
+        msg_Dbg( p_demux, "Scanning local dir for %zu linked segments", missing.size() );
+        b_scanned = true;
+
+        DIR *p_src_dir = vlc_opendir( dir.c_str() );
+        if( p_src_dir == NULL )
+            break;
+
+        const char *psz_file;
+        while ( !missing.empty() && (psz_file = vlc_readdir(p_src_dir)) != NULL )
+        {
+            std::string file = psz_file;
+
+            if( file.length() <= 4 )
+                continue;
+#if defined(_WIN32) || defined(__OS2__)
+            if( !strcasecmp( file.c_str(), self.c_str() ) )
+#else
+            if( !file.compare( self ) )
+#endif
+                continue; // don't reuse the original opened file
+
+            if( file.compare( file.length() - 4, 4, ".mkv" ) &&
+                file.compare( file.length() - 4, 4, ".mka" ) &&
+                file.compare( file.length() - 4, 4, ".mks" ) )
+                continue;
+            if( cache.Known( file ) )
+                continue; // its segments would have been found
+
+            matroska_stream_c *p_stream = OpenLinkedFile( p_demux, dir, file );
+            CacheSegmentUIDs( cache, file, p_stream );
+            if( p_stream == NULL )
+                continue;
+
+            bool b_used = false;
+            for( size_t i = 0; i < missing.size(); )
+            {
+                if( p_sys->FindSegment( *missing[i] ) )
+                {
+                    missing.erase( missing.begin() + i );
+                    b_used = true;
+                }
+                else
+                    i++;
+            }
+
+            if( !b_used )
+            {
+                DropLinkedFile( p_sys, p_stream );
+                continue;
+            }
+            msg_Dbg( p_demux, "linked segment found in '%s'", file.c_str() );
+            p_sys->streams.push_back( p_stream );
+            pending.insert( pending.end(), p_stream->segments.begin(),
+                            p_stream->segments.end() );
+        }
+        closedir( p_src_dir );
+    }
+
+    for( size_t i = 0; i < missing.size(); i++ )
+        msg_Warn( p_demux, "linked segment %s not found",
+                  segment_uid_cache_c::UIDToString( *missing[i] ).c_str() );
+}
+
 /*****************************************************************************
  * Open: initializes matroska demux structures
  *****************************************************************************/
@@ -141,10 +357,9 @@ static int Open( vlc_object_t * p_this )
         goto error;
     }
 
-    if (b_need_preload && var_InheritBool( p_demux, "mkv-preload-local-dir" ))
+    if (var_InheritBool( p_demux, "mkv-preload-local-dir" ))
     {
-        msg_Dbg( p_demux, "Preloading local dir" );
-        /* get the files from the same dir from the same family (based on p_demux->psz_path) */
+        /* find the linked segments in the same dir (based on p_demux->psz_path) */
         if ( p_demux->psz_file && !strcmp( p_demux->psz_access, "file" ) )
         {
             // assume it's a regular file
@@ -161,79 +376,14 @@ static int Open( vlc_object_t * p_this )
                     s_path = s_path.substr(0,s_path.find_last_of(DIR_SEP_CHAR));
                 }
             }
+            s_filename = p_demux->psz_file;
+            s_filename = s_filename.substr( std::min( s_path.length() + 1, s_filename.length() ) );
 
-            DIR *p_src_dir = vlc_opendir(s_path.c_str());
-
-            if (p_src_dir != NULL)
-            {
-                const char *psz_file;
-                while ((psz_file = vlc_readdir(p_src_dir)) != NULL)
-                {
-                    if (strlen(psz_file) > 4)
-                    {
-                        s_filename = s_path + DIR_SEP_CHAR + psz_file;
-
-#if defined(_WIN32) || defined(__OS2__)
-                        if (!strcasecmp(s_filename.c_str(), p_demux->psz_file))
-#else
-                        if (!s_filename.compare(p_demux->psz_file))
-#endif
-                        {
-                            continue; // don't reuse the original opened file
-                        }
-
-                        if (!s_filename.compare(s_filename.length() - 3, 3, "mkv") ||
-                            !s_filename.compare(s_filename.length() - 3, 3, "mka"))
-                        {
-                            // test whether this file belongs to our family
-                            const uint8_t *p_peek;
-                            bool          file_ok = false;
-#warning Memory leak!
-                            std::string   s_url = vlc_path2uri( s_filename.c_str(), "file" );
-                            stream_t      *p_file_stream = stream_UrlNew(
-                                                            p_demux,
-                                                            s_url.c_str() );
-                            /* peek the begining */
-                            if( p_file_stream &&
-                                stream_Peek( p_file_stream, &p_peek, 4 ) >= 4
-                                && p_peek[0] == 0x1a && p_peek[1] == 0x45 &&
-                                p_peek[2] == 0xdf && p_peek[3] == 0xa3 ) file_ok = true;
-
-                            if ( file_ok )
-                            {
-                                vlc_stream_io_callback *p_file_io = new vlc_stream_io_callback( p_file_stream, true );
-                                EbmlStream *p_estream = new EbmlStream(*p_file_io);
-
-                                p_stream = p_sys->AnalyseAllSegmentsFound( p_demux, p_estream );
-
-                                if ( p_stream == NULL )
-                                {
-                                    msg_Dbg( p_demux, "the file '%s' will not be used", s_filename.c_str() );
-                                    delete p_estream;
-                                    delete p_file_io;
-                                }
-                                else
-                                {
-                                    p_stream->p_io_callback = p_file_io;
-                                    p_stream->p_estream = p_estream;
-                                    p_sys->streams.push_back( p_stream );
-                                }
-                            }
-                            else
-                            {
-                                if( p_file_stream ) {
-                                    stream_Delete( p_file_stream );
-                                }
-                                msg_Dbg( p_demux, "the file '%s' cannot be opened", s_filename.c_str() );
-                            }
-                        }
-                    }
-                }
-                closedir( p_src_dir );
-            }
+            PreloadLinkedFiles( p_demux, s_path, s_filename, b_need_preload );
         }
 
-        p_sys->PreloadFamily( *p_segment );
+        if (b_need_preload)
+            p_sys->PreloadFamily( *p_segment );
     }
     else if (b_need_preload)
         msg_Warn( p_demux, "This file references other files, you may want to enable the preload of local directory");
@@ -460,6 +610,8 @@ static void Seek( demux_t *p_demux, mtime_t i_date, double f_percent, virtual_ch
         {
             int64_t i_pos = int64_t( f_percent * stream_Size( p_demux->s ) );
 
+            p_segment->IndexerMerge();
+
             msg_Dbg( p_demux, "lengthy way of seeking for pos:%" PRId64, i_pos );
             for( i_index = 0; i_index < p_segment->i_index; i_index++ )
             {
@@ -535,11 +687,29 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
 
     size_t frame_size = 0;
     size_t block_size = 0;
+    uint64_t i_block_end;
 
     if( simpleblock != NULL )
+    {
         block_size = simpleblock->GetSize();
+        i_block_end = simpleblock->GetElementPosition() + simpleblock->HeadSize() + block_size;
+    }
     else
+    {
         block_size = block->GetSize();
+        i_block_end = block->GetElementPosition() + block->HeadSize() + block_size;
+    }
+
+    /* Frames are stored last in the block, whatever the lacing: they can be
+     * located in the cluster read ahead, to be referenced rather than copied */
+    vlc_stream_io_callback *p_io =
+        dynamic_cast<vlc_stream_io_callback *>( &p_segment->es.I_O() );
+    size_t frames_size = 0;
+    for( unsigned int i = 0;
+         ( block != NULL && i < block->NumberFrames()) || ( simpleblock != NULL && i < simpleblock->NumberFrames() );
+         i++ )
+        frames_size += ( simpleblock != NULL ) ? simpleblock->GetBuffer(i).Size()
+                                               : block->GetBuffer(i).Size();
  
     for( unsigned int i = 0;
          ( block != NULL && i < block->NumberFrames()) || ( simpleblock != NULL && i < simpleblock->NumberFrames() );
@@ -572,7 +742,21 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
         else if( unlikely( tk->fmt.i_codec == VLC_CODEC_WAVPACK ) )
             p_block = packetize_wavpack(tk, data->Buffer(), data->Size());
         else
-            p_block = MemToBlock( data->Buffer(), data->Size(), 0 );
+        {
+            p_block = NULL;
+            if( p_io != NULL && frames_size <= block_size )
+                p_block = p_io->Slice( i_block_end - frames_size + frame_size - data->Size(),
+                                       data->Size() );
+            /* cheap check that the frame was located right */
+            if( p_block != NULL &&
+                memcmp( p_block->p_buffer, data->Buffer(), __MIN( data->Size(), 16u ) ) )
+            {
+                block_Release( p_block );
+                p_block = NULL;
+            }
+            if( p_block == NULL )
+                p_block = MemToBlock( data->Buffer(), data->Size(), 0 );
+        }
 
         if( p_block == NULL )
         {
@@ -628,10 +812,14 @@ void BlockDecode( demux_t *p_demux, KaxBlock *block, KaxSimpleBlock *simpleblock
             else if( tk->fmt.i_cat == AUDIO_ES )
             {
                 if( tk->i_chans_to_reorder )
+                {
+                    p_block = block_Unshare( p_block );
+                    if( p_block == NULL )
+                        break;
                     aout_ChannelReorder( p_block->p_buffer, p_block->i_buffer,
                                          tk->fmt.audio.i_channels,
                                          tk->pi_chan_table, tk->fmt.i_codec );
-
+                }
             }
             p_block->i_dts = p_block->i_pts = i_pts;
         }
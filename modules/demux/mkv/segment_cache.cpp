@@ -0,0 +1,233 @@
+/*****************************************************************************
+ * segment_cache.cpp : matroska demuxer
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#include "segment_cache.hpp"
+
+#include <vlc_fs.h>
+#include <vlc_configuration.h>
+
+#include <errno.h>
+#include <sys/stat.h>
+
+/* Cached entries, at most: the cache of a directory is still used if more
+ * files are found, only the rest is not saved */
+#define MKV_UID_CACHE_MAX 4096
+
+segment_uid_cache_c::segment_uid_cache_c( vlc_object_t *obj, const std::string & d )
+    :p_obj(obj)
+    ,dir(d)
+    ,psz_path(NULL)
+    ,b_dirty(false)
+{
+    /* FNV-1a hash of the directory path */
+    uint64_t i_hash = UINT64_C(0xcbf29ce484222325);
+    for( size_t i = 0; i < dir.length(); i++ )
+        i_hash = ( i_hash ^ (uint8_t)dir[i] ) * UINT64_C(0x100000001b3);
+
+    char *psz_dir = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_dir == NULL
+     || asprintf( &psz_path, "%s" DIR_SEP "mkv" DIR_SEP "%016" PRIx64, psz_dir,
+                  i_hash ) == -1 )
+        psz_path = NULL;
+    free( psz_dir );
+
+    Load();
+}
+
+segment_uid_cache_c::~segment_uid_cache_c()
+{
+    Save();
+    free( psz_path );
+}
+
+std::string segment_uid_cache_c::UIDToString( const EbmlBinary & uid )
+{
+    static const char hex[] = "0123456789abcdef";
+    const binary *p_data = uid.GetBuffer();
+    std::string s;
+
+    for( size_t i = 0; i < uid.GetSize(); i++ )
+    {
+        s += hex[p_data[i] >> 4];
+        s += hex[p_data[i] & 0xf];
+    }
+    return s.empty() ? "-" : s;
+}
+
+bool segment_uid_cache_c::Stat( const std::string & file, uint64_t *pi_size,
+                                int64_t *pi_mtime ) const
+{
+    struct stat st;
+    std::string path = dir + DIR_SEP_CHAR + file;
+
+    if( vlc_stat( path.c_str(), &st ) )
+        return false;
+    *pi_size = st.st_size;
+    *pi_mtime = st.st_mtime;
+    return true;
+}
+
+bool segment_uid_cache_c::Find( const EbmlBinary & uid, std::string & file ) const
+{
+    std::string s_uid = UIDToString( uid );
+
+    for( size_t i = 0; i < entries.size(); i++ )
+    {
+        if( entries[i].uid == s_uid )
+        {
+            file = entries[i].file;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool segment_uid_cache_c::Known( const std::string & file )
+{
+    uint64_t i_size;
+    int64_t i_mtime;
+    bool b_known = false;
+
+    if( !Stat( file, &i_size, &i_mtime ) )
+        return false;
+
+    for( size_t i = 0; i < entries.size(); )
+    {
+        if( entries[i].file != file )
+            i++;
+        else if( entries[i].i_size == i_size && entries[i].i_mtime == i_mtime )
+        {
+            b_known = true;
+            i++;
+        }
+        else
+        {
+            /* the file changed since */
+            entries.erase( entries.begin() + i );
+            b_dirty = true;
+        }
+    }
+    return b_known;
+}
+
+void segment_uid_cache_c::Set( const std::string & file,
+                               const std::vector<std::string> & uids )
+{
+    entry_t entry;
+
+    if( file.find( '\n' ) != std::string::npos
+     || !Stat( file, &entry.i_size, &entry.i_mtime ) )
+        return;
+
+    for( size_t i = 0; i < entries.size(); )
+    {
+        if( entries[i].file == file )
+            entries.erase( entries.begin() + i );
+        else
+            i++;
+    }
+
+    entry.file = file;
+    if( uids.empty() )
+    {
+        entry.uid = "-";
+        entries.push_back( entry );
+    }
+    for( size_t i = 0; i < uids.size(); i++ )
+    {
+        entry.uid = uids[i];
+        entries.push_back( entry );
+    }
+    b_dirty = true;
+}
+
+/* One line per segment: UID, size, modification time, then the file name */
+void segment_uid_cache_c::Load()
+{
+    if( psz_path == NULL )
+        return;
+
+    FILE *file = vlc_fopen( psz_path, "rt" );
+    if( file == NULL )
+        return;
+
+    char *psz_line = NULL;
+    size_t i_line = 0;
+    ssize_t i_read;
+
+    while( entries.size() < MKV_UID_CACHE_MAX
+        && ( i_read = getline( &psz_line, &i_line, file ) ) != -1 )
+    {
+        char psz_uid[129];
+        unsigned long long i_size;
+        long long i_mtime;
+        int i_name;
+
+        if( i_read > 0 && psz_line[i_read - 1] == '\n' )
+            psz_line[i_read - 1] = '\0';
+
+        if( sscanf( psz_line, "%128s %llu %lld %n", psz_uid, &i_size,
+                    &i_mtime, &i_name ) != 3 || psz_line[i_name] == '\0' )
+            continue;
+
+        entry_t entry;
+        entry.uid = psz_uid;
+        entry.file = &psz_line[i_name];
+        entry.i_size = i_size;
+        entry.i_mtime = i_mtime;
+        entries.push_back( entry );
+    }
+    free( psz_line );
+    fclose( file );
+
+    msg_Dbg( p_obj, "loaded %zu segment UIDs from %s", entries.size(), psz_path );
+}
+
+void segment_uid_cache_c::Save()
+{
+    if( psz_path == NULL || !b_dirty )
+        return;
+
+    /* Make sure the sub-directory exists */
+    char *psz_sep = strrchr( psz_path, DIR_SEP_CHAR );
+    *psz_sep = '\0';
+    vlc_mkdir( psz_path, 0700 );
+    *psz_sep = DIR_SEP_CHAR;
+
+    std::string tmp = std::string( psz_path ) + ".tmp";
+    FILE *file = vlc_fopen( tmp.c_str(), "wt" );
+    if( file == NULL )
+    {
+        msg_Warn( p_obj, "cannot write segment UIDs %s: %s", tmp.c_str(),
+                  vlc_strerror_c(errno) );
+        return;
+    }
+
+    bool b_ok = true;
+    for( size_t i = 0; i < entries.size() && i < MKV_UID_CACHE_MAX; i++ )
+        b_ok &= fprintf( file, "%s %llu %lld %s\n", entries[i].uid.c_str(),
+                         (unsigned long long)entries[i].i_size,
+                         (long long)entries[i].i_mtime,
+                         entries[i].file.c_str() ) >= 0;
+
+    if( fclose( file ) == 0 && b_ok && !vlc_rename( tmp.c_str(), psz_path ) )
+        b_dirty = false;
+    else
+        vlc_unlink( tmp.c_str() );
+}
@@ -0,0 +1,65 @@
+/*****************************************************************************
+ * segment_cache.hpp : matroska demuxer
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_MKV_SEGMENT_CACHE_HPP_
+#define VLC_MKV_SEGMENT_CACHE_HPP_
+
+#include "mkv.hpp"
+
+/* Segment UIDs of the matroska files of a local directory, kept in the
+ * cache directory, so that linked segments are found without opening all
+ * the files of the directory. An entry is valid as long as the size and the
+ * modification time of its file are unchanged. */
+class segment_uid_cache_c
+{
+public:
+    segment_uid_cache_c( vlc_object_t *p_obj, const std::string & dir );
+    ~segment_uid_cache_c();
+
+    /* Name of the file holding the segment, if known */
+    bool Find( const EbmlBinary & uid, std::string & file ) const;
+    /* Whether the UIDs of the file are known and up to date */
+    bool Known( const std::string & file );
+    /* Sets the UIDs of the segments of the file (none if empty) */
+    void Set( const std::string & file, const std::vector<std::string> & uids );
+
+    static std::string UIDToString( const EbmlBinary & uid );
+
+private:
+    struct entry_t
+    {
+        std::string uid; /* hexadecimal, "-" for a file without segment */
+        std::string file;
+        uint64_t    i_size;
+        int64_t     i_mtime;
+    };
+
+    bool Stat( const std::string & file, uint64_t *pi_size, int64_t *pi_mtime ) const;
+    void Load();
+    void Save();
+
+    vlc_object_t         *p_obj;
+    std::string          dir;
+    char                 *psz_path;
+    std::vector<entry_t> entries;
+    bool                 b_dirty;
+};
+
+#endif
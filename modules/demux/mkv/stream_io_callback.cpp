@@ -34,6 +34,10 @@ vlc_stream_io_callback::vlc_stream_io_callback( stream_t *s_, bool b_owner_ )
                        : s( s_), b_owner( b_owner_ )
 {
     mb_eof = false;
+    p_ahead = NULL;
+    b_ahead_shared = false;
+    i_ahead_pos = 0;
+    i_ahead_offset = 0;
 }
 
 uint32 vlc_stream_io_callback::read( void *p_buffer, size_t i_size )
@@ -41,13 +45,24 @@ uint32 vlc_stream_io_callback::read( void *p_buffer, size_t i_size )
     if( i_size <= 0 || mb_eof )
         return 0;
 
-    return stream_Read( s, p_buffer, i_size );
+    size_t i_copy = 0;
+    if( AheadActive() )
+    {
+        i_copy = __MIN( i_size, p_ahead->i_buffer - i_ahead_offset );
+        memcpy( p_buffer, p_ahead->p_buffer + i_ahead_offset, i_copy );
+        i_ahead_offset += i_copy;
+        if( i_copy == i_size )
+            return i_copy;
+    }
+
+    int i_ret = stream_Read( s, (uint8_t *)p_buffer + i_copy, i_size - i_copy );
+    return i_copy + __MAX( i_ret, 0 );
 }
 
 void vlc_stream_io_callback::setFilePointer(int64_t i_offset, seek_mode mode )
 {
     int64_t i_pos, i_size;
-    int64_t i_current = stream_Tell( s );
+    int64_t i_current = getFilePointer();
 
     switch( mode )
     {
@@ -65,6 +80,17 @@ void vlc_stream_io_callback::setFilePointer(int64_t i_offset, seek_mode mode )
     if(i_pos == i_current)
         return;
 
+    /* Stay in the data read ahead if possible */
+    if( p_ahead != NULL && i_pos >= (int64_t)i_ahead_pos &&
+        i_pos < (int64_t)( i_ahead_pos + p_ahead->i_buffer ) )
+    {
+        mb_eof = false;
+        i_ahead_offset = i_pos - i_ahead_pos;
+        return;
+    }
+    if( p_ahead != NULL )
+        i_ahead_offset = p_ahead->i_buffer;
+
     if( i_pos < 0 || ( ( i_size = stream_Size( s ) ) != 0 && i_pos >= i_size ) )
     {
         mb_eof = true;
@@ -83,6 +109,8 @@ uint64 vlc_stream_io_callback::getFilePointer( void )
 {
     if ( s == NULL )
         return 0;
+    if( AheadActive() )
+        return i_ahead_pos + i_ahead_offset;
     return stream_Tell( s );
 }
 
@@ -103,6 +131,56 @@ uint64 vlc_stream_io_callback::toRead( void )
     if( i_size == 0 )
         return UINT64_MAX;
 
-    return (uint64) i_size - stream_Tell( s );
+    return (uint64) i_size - getFilePointer();
+}
+
+void vlc_stream_io_callback::ReadAhead( size_t i_size )
+{
+    if( mb_eof || i_size == 0 || i_size > MKV_READAHEAD_MAX )
+        return;
+
+    const uint64_t i_start = getFilePointer();
+    if( AheadActive() )
+    {
+        if( i_start + i_size <= i_ahead_pos + p_ahead->i_buffer )
+            return; /* already there */
+        if( stream_Seek( s, i_start ) )
+            return;
+        i_ahead_offset = p_ahead->i_buffer;
+    }
+
+    block_t *p_block = block_Alloc( i_size );
+    if( unlikely( p_block == NULL ) )
+        return;
+
+    int i_ret = stream_Read( s, p_block->p_buffer, i_size );
+    if( i_ret <= 0 )
+    {
+        block_Release( p_block );
+        return;
+    }
+    p_block->i_buffer = i_ret;
+
+    if( p_ahead != NULL )
+        block_Release( p_ahead );
+    /* Frames are handed out as references to the data, if it can be shared */
+    p_ahead = block_Share( p_block );
+    b_ahead_shared = p_ahead != p_block;
+    i_ahead_pos = i_start;
+    i_ahead_offset = 0;
+}
+
+block_t * vlc_stream_io_callback::Slice( uint64_t i_pos, size_t i_size )
+{
+    if( p_ahead == NULL || !b_ahead_shared || i_pos < i_ahead_pos ||
+        i_pos + i_size > i_ahead_pos + p_ahead->i_buffer )
+        return NULL;
+
+    block_t *p_block = block_Clone( p_ahead );
+    if( unlikely( p_block == NULL ) )
+        return NULL;
+    p_block->p_buffer += i_pos - i_ahead_pos;
+    p_block->i_buffer = i_size;
+    return p_block;
 }
 
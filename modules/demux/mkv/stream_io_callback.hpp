@@ -26,6 +26,9 @@
 /*****************************************************************************
  * Stream managment
  *****************************************************************************/
+/* Largest cluster read at once */
+#define MKV_READAHEAD_MAX (16 * 1024 * 1024)
+
 class vlc_stream_io_callback: public IOCallback
 {
   private:
@@ -33,11 +36,25 @@ class vlc_stream_io_callback: public IOCallback
     bool           mb_eof;
     bool           b_owner;
 
+    /* Data read ahead, from i_ahead_pos. The stream is at its end, and the
+     * reads are served from i_ahead_offset until it is reached. */
+    block_t        *p_ahead;
+    bool           b_ahead_shared;
+    uint64_t       i_ahead_pos;
+    size_t         i_ahead_offset;
+
+    bool           AheadActive() const
+    {
+        return p_ahead != NULL && i_ahead_offset < p_ahead->i_buffer;
+    }
+
   public:
     vlc_stream_io_callback( stream_t *, bool );
 
     virtual ~vlc_stream_io_callback()
     {
+        if( p_ahead )
+            block_Release( p_ahead );
         if( b_owner )
             stream_Delete( s );
     }
@@ -48,5 +65,10 @@ class vlc_stream_io_callback: public IOCallback
     virtual uint64   getFilePointer  ( void );
     virtual void     close           ( void ) { return; }
     uint64           toRead          ( void );
+
+    /* Reads the next i_size bytes at once, for the following reads */
+    void             ReadAhead       ( size_t i_size );
+    /* Returns a block sharing read ahead data, or NULL if not available */
+    block_t *        Slice           ( uint64_t i_pos, size_t i_size );
 };
 
@@ -4483,3 +4483,107 @@ int MP4_BoxCount( MP4_Box_t *p_box, const char *psz_fmt, ... )
     }
     return( i_count );
 }
+
+/*****************************************************************************
+ * MP4_FragIndex: index of the fragments of a file, by time
+ *****************************************************************************/
+void MP4_FragIndexInit( MP4_FragIndex_t *p_index, uint32_t i_timescale )
+{
+    p_index->i_timescale = i_timescale;
+    p_index->i_entries = 0;
+    p_index->i_alloc = 0;
+    p_index->p_entries = NULL;
+}
+
+void MP4_FragIndexClean( MP4_FragIndex_t *p_index )
+{
+    free( p_index->p_entries );
+    MP4_FragIndexInit( p_index, p_index->i_timescale );
+}
+
+/* Index of the first entry starting after i_time */
+static unsigned FragIndexUpperBound( const MP4_FragIndex_t *p_index,
+                                     uint64_t i_time )
+{
+    unsigned i_low = 0, i_high = p_index->i_entries;
+
+    while( i_low < i_high )
+    {
+        unsigned i_mid = i_low + ( i_high - i_low ) / 2;
+        if( p_index->p_entries[i_mid].i_time <= i_time )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+int MP4_FragIndexAdd( MP4_FragIndex_t *p_index, uint64_t i_offset,
+                      uint64_t i_time, uint32_t i_timescale )
+{
+    if( !i_timescale || !p_index->i_timescale )
+        return VLC_EGENERIC;
+    if( i_timescale != p_index->i_timescale )
+        i_time = i_time * p_index->i_timescale / i_timescale;
+
+    unsigned i_pos = FragIndexUpperBound( p_index, i_time );
+
+    /* Sources disagree slightly on fragment times: look for the same
+     * position among the neighbours. */
+    if( ( i_pos > 0 && p_index->p_entries[i_pos - 1].i_offset == i_offset ) ||
+        ( i_pos < p_index->i_entries && p_index->p_entries[i_pos].i_offset == i_offset ) )
+        return VLC_SUCCESS;
+
+    if( p_index->i_entries == p_index->i_alloc )
+    {
+        unsigned i_alloc = p_index->i_alloc ? p_index->i_alloc * 2 : 64;
+        MP4_FragIndexEntry_t *p_entries =
+            realloc( p_index->p_entries, i_alloc * sizeof(*p_entries) );
+        if( unlikely(p_entries == NULL) )
+            return VLC_ENOMEM;
+        p_index->p_entries = p_entries;
+        p_index->i_alloc = i_alloc;
+    }
+
+    memmove( &p_index->p_entries[i_pos + 1], &p_index->p_entries[i_pos],
+             ( p_index->i_entries - i_pos ) * sizeof(*p_index->p_entries) );
+    p_index->p_entries[i_pos].i_offset = i_offset;
+    p_index->p_entries[i_pos].i_time = i_time;
+    p_index->i_entries++;
+    return VLC_SUCCESS;
+}
+
+int MP4_FragIndexAddSidx( MP4_FragIndex_t *p_index, const MP4_Box_t *p_sidx,
+                          uint64_t i_anchor )
+{
+    const MP4_Box_data_sidx_t *p_data = p_sidx->data.p_sidx;
+    if( !p_data || !p_data->i_timescale )
+        return VLC_EGENERIC;
+
+    uint64_t i_offset = i_anchor + p_data->i_first_offset;
+    uint64_t i_time = p_data->i_earliest_presentation_time;
+
+    for( uint16_t i = 0; i < p_data->i_reference_count; i++ )
+    {
+        const MP4_Box_sidx_item_t *p_item = &p_data->p_items[i];
+
+        /* Items referencing other sidx boxes have no media by themselves */
+        if( !p_item->b_reference_type &&
+            MP4_FragIndexAdd( p_index, i_offset, i_time,
+                              p_data->i_timescale ) == VLC_ENOMEM )
+            return VLC_ENOMEM;
+        i_offset += p_item->i_referenced_size;
+        i_time += p_item->i_subsegment_duration;
+    }
+    return VLC_SUCCESS;
+}
+
+const MP4_FragIndexEntry_t *MP4_FragIndexLookup( const MP4_FragIndex_t *p_index,
+                                                 uint64_t i_time )
+{
+    if( p_index->i_entries == 0 )
+        return NULL;
+
+    unsigned i_pos = FragIndexUpperBound( p_index, i_time );
+    return &p_index->p_entries[i_pos > 0 ? i_pos - 1 : 0];
+}
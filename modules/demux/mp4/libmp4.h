@@ -1703,6 +1703,45 @@ MP4_Box_t *MP4_BoxGet( MP4_Box_t *p_box, const char *psz_fmt, ... );
  *****************************************************************************/
 int MP4_BoxCount( MP4_Box_t *p_box, const char *psz_fmt, ... );
 
+/*****************************************************************************
+ * MP4_FragIndex: index of the fragments of a file, by time
+ *****************************************************************************
+ * Entries are the position of a fragment (moof, or sidx referenced
+ * subsegment) and its start time, kept sorted by time. They can be added in
+ * any order, from a mfra/tfra or sidx index or as fragments are discovered.
+ *****************************************************************************/
+typedef struct
+{
+    uint64_t i_offset;
+    uint64_t i_time;  /* in the index timescale */
+} MP4_FragIndexEntry_t;
+
+typedef struct
+{
+    uint32_t              i_timescale;
+    unsigned              i_entries;
+    unsigned              i_alloc;
+    MP4_FragIndexEntry_t *p_entries;
+} MP4_FragIndex_t;
+
+void MP4_FragIndexInit( MP4_FragIndex_t *, uint32_t i_timescale );
+void MP4_FragIndexClean( MP4_FragIndex_t * );
+
+/* Adds a fragment starting at i_time, expressed in i_timescale. Fragments
+ * already known at that position are ignored. */
+int MP4_FragIndexAdd( MP4_FragIndex_t *, uint64_t i_offset,
+                      uint64_t i_time, uint32_t i_timescale );
+
+/* Adds the subsegments referenced by a sidx box. Offsets are relative to
+ * i_anchor, which is the end of the sidx box for absolute positions. */
+int MP4_FragIndexAddSidx( MP4_FragIndex_t *, const MP4_Box_t *p_sidx,
+                          uint64_t i_anchor );
+
+/* Returns the last fragment starting at or before i_time (in the index
+ * timescale), the first one if none, or NULL if the index is empty. */
+const MP4_FragIndexEntry_t *MP4_FragIndexLookup( const MP4_FragIndex_t *,
+                                                 uint64_t i_time );
+
 /* Internal functions exposed for MKV demux */
 int MP4_ReadBoxCommon( stream_t *p_stream, MP4_Box_t *p_box );
 int MP4_ReadBoxContainerChildren( stream_t *p_stream, MP4_Box_t *p_container,
@@ -90,6 +90,8 @@ struct demux_sys_t
     bool            b_fragments_probed;
     mp4_fragment_t  moovfragment; /* moov */
     mp4_fragment_t *p_fragments;  /* known fragments (moof following moov) */
+    MP4_FragIndex_t fragindex;    /* fragments positions by time, possibly
+                                   * not yet in the fragments list */
 
     struct
     {
@@ -146,8 +148,7 @@ static int  ProbeIndex( demux_t *p_demux );
 static mp4_fragment_t *GetFragmentByPos( demux_t *p_demux, uint64_t i_pos, bool b_exact );
 static mp4_fragment_t *GetFragmentByTime( demux_t *p_demux, const mtime_t i_time );
 
-static int LeafIndexGetMoofPosByTime( demux_t *p_demux, const mtime_t i_target_time,
-                                      uint64_t *pi_pos, mtime_t *pi_mooftime );
+static void IndexAddBoxes( demux_t *p_demux );
 static mtime_t LeafGetTrackFragmentTimeOffset( demux_t *p_demux, mp4_fragment_t *, unsigned int );
 static int LeafGetTrackAndChunkByMOOVPos( demux_t *p_demux, uint64_t *pi_pos,
                                       mp4_track_t **pp_tk, unsigned int *pi_chunk );
@@ -230,35 +231,123 @@ static MP4_Box_t * MP4_GetTrakByTrackID( MP4_Box_t *p_moov, const uint32_t i_id
     return p_trak;
 }
 
+/* Return the dts of a sample described in the moov, in track timescale.
+ * Samples are looked up in the stts table from the last position, so that
+ * reading them in order is O(1). */
+static int64_t TrackSampleDTS( mp4_track_t *p_track, uint32_t i_sample )
+{
+    const MP4_Box_data_stts_t *stts = p_track->p_stts;
+    mp4_rle_cursor_t *p_cur = &p_track->stts_cursor;
+
+    if( stts == NULL )
+        return 0;
+
+    if( i_sample < p_cur->i_entry_sample )
+        memset( p_cur, 0, sizeof( *p_cur ) ); /* going backward */
+
+    while( p_cur->i_entry < stts->i_entry_count &&
+           i_sample - p_cur->i_entry_sample >= stts->pi_sample_count[p_cur->i_entry] )
+    {
+        p_cur->i_entry_dts += (int64_t)stts->pi_sample_count[p_cur->i_entry] *
+                              stts->pi_sample_delta[p_cur->i_entry];
+        p_cur->i_entry_sample += stts->pi_sample_count[p_cur->i_entry];
+        p_cur->i_entry++;
+    }
+
+    if( p_cur->i_entry >= stts->i_entry_count ) /* past the table */
+        return p_cur->i_entry_dts;
+
+    return p_cur->i_entry_dts + (int64_t)( i_sample - p_cur->i_entry_sample ) *
+                                stts->pi_sample_delta[p_cur->i_entry];
+}
+
+/* Return the pts - dts offset of a sample described in the moov, in track
+ * timescale, the same way as TrackSampleDTS(). */
+static bool TrackSamplePTSOffset( mp4_track_t *p_track, uint32_t i_sample,
+                                  int32_t *pi_offset )
+{
+    const MP4_Box_data_ctts_t *ctts = p_track->p_ctts;
+    mp4_rle_cursor_t *p_cur = &p_track->ctts_cursor;
+
+    if( ctts == NULL )
+        return false;
+
+    if( i_sample < p_cur->i_entry_sample )
+        memset( p_cur, 0, sizeof( *p_cur ) );
+
+    while( p_cur->i_entry < ctts->i_entry_count &&
+           i_sample - p_cur->i_entry_sample >= ctts->pi_sample_count[p_cur->i_entry] )
+    {
+        p_cur->i_entry_sample += ctts->pi_sample_count[p_cur->i_entry];
+        p_cur->i_entry++;
+    }
+
+    if( p_cur->i_entry >= ctts->i_entry_count )
+        return false;
+
+    *pi_offset = ctts->pi_sample_offset[p_cur->i_entry];
+    return true;
+}
+
+/* Return the first sample whose dts is not before i_dts (track timescale),
+ * and leave the stts cursor there */
+static uint32_t TrackDTSToSample( mp4_track_t *p_track, int64_t i_dts )
+{
+    const MP4_Box_data_stts_t *stts = p_track->p_stts;
+    mp4_rle_cursor_t *p_cur = &p_track->stts_cursor;
+
+    memset( p_cur, 0, sizeof( *p_cur ) );
+    if( stts == NULL )
+        return 0;
+
+    for( ; p_cur->i_entry < stts->i_entry_count; p_cur->i_entry++ )
+    {
+        const int32_t i_delta = stts->pi_sample_delta[p_cur->i_entry];
+        const int64_t i_duration =
+            (int64_t)stts->pi_sample_count[p_cur->i_entry] * i_delta;
+
+        if( i_dts <= p_cur->i_entry_dts )
+            return p_cur->i_entry_sample;
+        if( i_delta > 0 && i_dts < p_cur->i_entry_dts + i_duration )
+            return p_cur->i_entry_sample + ( i_dts - p_cur->i_entry_dts ) / i_delta;
+
+        p_cur->i_entry_dts += i_duration;
+        p_cur->i_entry_sample += stts->pi_sample_count[p_cur->i_entry];
+    }
+    return p_cur->i_entry_sample;
+}
+
 /* Return time in microsecond of a track */
 static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const mp4_chunk_t *p_chunk;
-    if( p_sys->b_fragmented )
-        p_chunk = p_track->cchunk;
-    else
-        p_chunk = &p_track->chunk[p_track->i_chunk];
-
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - p_chunk->i_sample_first;
-    int64_t i_dts = p_chunk->i_first_dts;
+    int64_t i_dts;
 
-    while( i_sample > 0 )
+    if( p_sys->b_fragmented )
     {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
-        {
-            i_dts += p_chunk->p_sample_count_dts[i_index] *
-                p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index];
-            i_index++;
-        }
-        else
+        const mp4_chunk_t *p_chunk = p_track->cchunk;
+        unsigned int i_index = 0;
+        unsigned int i_sample = p_track->i_sample - p_chunk->i_sample_first;
+
+        i_dts = p_chunk->i_first_dts;
+        while( i_sample > 0 )
         {
-            i_dts += i_sample * p_chunk->p_sample_delta_dts[i_index];
-            break;
+            if( i_sample > p_chunk->p_sample_count_dts[i_index] )
+            {
+                i_dts += p_chunk->p_sample_count_dts[i_index] *
+                    p_chunk->p_sample_delta_dts[i_index];
+                i_sample -= p_chunk->p_sample_count_dts[i_index];
+                i_index++;
+            }
+            else
+            {
+                i_dts += i_sample * p_chunk->p_sample_delta_dts[i_index];
+                break;
+            }
         }
     }
+    else
+        i_dts = TrackSampleDTS( p_track, p_track->i_sample );
 
     /* now handle elst */
     if( p_track->p_elst )
@@ -289,11 +378,17 @@ static inline bool MP4_TrackGetPTSDelta( demux_t *p_demux, mp4_track_t *p_track,
 {
     demux_sys_t *p_sys = p_demux->p_sys;
     mp4_chunk_t *ck;
-    if( p_sys->b_fragmented )
-        ck = p_track->cchunk;
-    else
-        ck = &p_track->chunk[p_track->i_chunk];
 
+    if( !p_sys->b_fragmented )
+    {
+        int32_t i_offset;
+        if( !TrackSamplePTSOffset( p_track, p_track->i_sample, &i_offset ) )
+            return false;
+        *pi_delta = i_offset * CLOCK_FREQ / (int64_t)p_track->i_timescale;
+        return true;
+    }
+
+    ck = p_track->cchunk;
     unsigned int i_index = 0;
     unsigned int i_sample = p_track->i_sample - ck->i_sample_first;
 
@@ -596,6 +691,7 @@ static int Open( vlc_object_t * p_this )
     p_demux->pf_control = Control;
 
     p_sys->context.i_lastseqnumber = 1;
+    MP4_FragIndexInit( &p_sys->fragindex, CLOCK_FREQ );
 
     p_demux->p_sys = p_sys;
 
@@ -1280,10 +1376,13 @@ static int LeafSeekToTime( demux_t *p_demux, mtime_t i_nztime )
     p_fragment = GetFragmentByTime( p_demux, i_nztime );
     if ( !p_fragment )
     {
-        mtime_t i_mooftime;
+        const MP4_FragIndexEntry_t *p_entry;
         msg_Dbg( p_demux, "seek can't find matching fragment for %"PRId64", trying index", i_nztime );
-        if ( LeafIndexGetMoofPosByTime( p_demux, i_nztime, &i64, &i_mooftime ) == VLC_SUCCESS )
+        p_entry = MP4_FragIndexLookup( &p_sys->fragindex, __MAX(i_nztime, 0) );
+        if ( p_entry )
         {
+            mtime_t i_mooftime = p_entry->i_time;
+            i64 = p_entry->i_offset;
             msg_Dbg( p_demux, "seek trying to go to unknown but indexed fragment at %"PRId64, i64 );
             if( stream_Seek( p_demux->s, i64 ) )
             {
@@ -1295,9 +1394,9 @@ static int LeafSeekToTime( demux_t *p_demux, mtime_t i_nztime )
             p_sys->context.p_fragment = NULL;
             for( unsigned int i_track = 0; i_track < p_sys->i_tracks; i_track++ )
             {
-                p_sys->track[i_track].i_time = i_mooftime / CLOCK_FREQ * p_sys->track[i_track].i_timescale;
+                p_sys->track[i_track].i_time = i_mooftime * p_sys->track[i_track].i_timescale / CLOCK_FREQ;
             }
-            p_sys->i_time = i_mooftime / CLOCK_FREQ * p_sys->i_timescale;
+            p_sys->i_time = i_mooftime * p_sys->i_timescale / CLOCK_FREQ;
             p_sys->i_pcr  = VLC_TS_INVALID;
         }
         else
@@ -1726,6 +1825,7 @@ static void Close ( vlc_object_t * p_this )
         p_sys->moovfragment.p_next = p_fragment;
     }
     free( p_sys->moovfragment.p_durations );
+    MP4_FragIndexClean( &p_sys->fragindex );
 
     free( p_sys );
 }
@@ -1925,54 +2025,6 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
-static int xTTS_CountEntries( demux_t *p_demux, uint32_t *pi_entry /* out */,
-                              const uint32_t i_index,
-                              uint32_t i_index_samples_left,
-                              uint32_t i_sample_count,
-                              const uint32_t *pi_index_sample_count,
-                              const uint32_t i_table_count )
-{
-    uint32_t i_array_offset;
-    while( i_sample_count > 0 )
-    {
-        if ( likely((UINT32_MAX - i_index) >= *pi_entry) )
-            i_array_offset = i_index + *pi_entry;
-        else
-            return VLC_EGENERIC;
-
-        if ( i_array_offset >= i_table_count )
-        {
-            msg_Err( p_demux, "invalid index counting total samples %u %u", i_array_offset,  i_table_count );
-            return VLC_EGENERIC;
-        }
-
-        if ( i_index_samples_left )
-        {
-            if ( i_index_samples_left > i_sample_count )
-            {
-                i_index_samples_left -= i_sample_count;
-                i_sample_count = 0;
-                *pi_entry +=1; /* No samples left, go copy */
-                break;
-            }
-            else
-            {
-                i_sample_count -= i_index_samples_left;
-                i_index_samples_left = 0;
-                *pi_entry += 1;
-                continue;
-            }
-        }
-        else
-        {
-            i_sample_count -= __MIN( i_sample_count, pi_index_sample_count[i_array_offset] );
-            *pi_entry += 1;
-        }
-    }
-
-    return VLC_SUCCESS;
-}
-
 static int TrackCreateSamplesIndex( demux_t *p_demux,
                                     mp4_track_t *p_demux_track )
 {
@@ -2005,18 +2057,9 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     }
     else
     {
-        /* 2: each sample can have a different size */
+        /* 2: each sample can have a different size, use the table as is */
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( uint32_t i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+        p_demux_track->p_sample_size = stsz->i_entry_size;
     }
 
     if ( p_demux_track->i_chunk_count )
@@ -2047,212 +2090,84 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
             p_sys->moovfragment.i_chunk_range_max_offset = i_total_size;
     }
 
-    /* Use stts table to create a sample number -> dts table.
-     * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
-
-     /* FIXME: refactor STTS & CTTS, STTS having now only few extra lines and
-      *        differing in 2/2 fields and 1 signedness */
+    /* The stts and ctts tables are run-length encoded already: keep them as
+     * they are, and look samples up on demand (see TrackSampleDTS()). Only
+     * the first and last dts of each chunk are computed here, in a single
+     * pass, for seeking. */
+    uint32_t i_needed = 0;
+    if( p_demux_track->i_chunk_count )
+    {
+        const mp4_chunk_t *lastchunk = &p_demux_track->chunk[p_demux_track->i_chunk_count - 1];
+        i_needed = lastchunk->i_sample_first + lastchunk->i_sample_count;
+    }
 
-    mtime_t i_next_dts = 0;
     /* Find stts
      *  Gives mapping between sample and decoding time
      */
     p_box = MP4_BoxGet( p_demux_track->p_stbl, "stts" );
-    if( !p_box )
+    if( !p_box || !p_box->data.p_stts )
     {
         msg_Warn( p_demux, "cannot find STTS box" );
         return VLC_EGENERIC;
     }
     else
     {
-        MP4_Box_data_stts_t *stts = p_box->data.p_stts;
+        const MP4_Box_data_stts_t *stts = p_box->data.p_stts;
+        uint64_t i_total = 0;
 
         msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
 
-        /* Create sample -> dts table per chunk */
-        uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        for( uint32_t i = 0; i < stts->i_entry_count; i++ )
+            i_total += stts->pi_sample_count[i];
+        if( i_total < i_needed )
+        {
+            msg_Err( p_demux, "invalid stts table: %"PRIu64" samples for %"PRIu32,
+                     i_total, i_needed );
+            return VLC_EGENERIC;
+        }
+
+        p_demux_track->p_stts = stts;
+        memset( &p_demux_track->stts_cursor, 0, sizeof( mp4_rle_cursor_t ) );
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_entry, i_sample_count;
-
-            /* save first dts */
-            ck->i_first_dts = i_next_dts;
-            ck->i_last_dts  = i_next_dts;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            i_entry = 0;
-
-            int i_ret = xTTS_CountEntries( p_demux, &i_entry, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           stts->pi_sample_count,
-                                           stts->i_entry_count );
-            if ( i_ret != VLC_SUCCESS )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_dts = calloc( i_entry, sizeof( uint32_t ) );
-            ck->p_sample_delta_dts = calloc( i_entry, sizeof( uint32_t ) );
-            if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
-            {
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, i_entry );
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
 
-            for( uint32_t i = 0; i < i_entry; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        if ( i_sample_count ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == i_entry - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        if ( i_current_index_samples_left ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_current_index_samples_left;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( stts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        if ( i_sample_count ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_current_index_samples_left = stts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == i_entry - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        if ( stts->pi_sample_count[i_index] ) ck->i_last_dts = i_next_dts;
-                        ck->p_sample_count_dts[i] = stts->pi_sample_count[i_index];
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        i_sample_count -= stts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-            }
+            ck->i_first_dts = TrackSampleDTS( p_demux_track, ck->i_sample_first );
+            if( ck->i_sample_count )
+                ck->i_last_dts = TrackSampleDTS( p_demux_track,
+                                    ck->i_sample_first + ck->i_sample_count - 1 );
+            else
+                ck->i_last_dts = ck->i_first_dts;
         }
     }
 
-
     /* Find ctts
      *  Gives the delta between decoding time (dts) and composition table (pts)
      */
     p_box = MP4_BoxGet( p_demux_track->p_stbl, "ctts" );
     if( p_box && p_box->data.p_ctts )
     {
-        MP4_Box_data_ctts_t *ctts = p_box->data.p_ctts;
+        const MP4_Box_data_ctts_t *ctts = p_box->data.p_ctts;
+        uint64_t i_total = 0;
 
         msg_Warn( p_demux, "CTTS table of %"PRIu32" entries", ctts->i_entry_count );
 
-        /* Create pts-dts table per chunk */
-        uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
-
-        for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
+        for( uint32_t i = 0; i < ctts->i_entry_count; i++ )
+            i_total += ctts->pi_sample_count[i];
+        if( i_total < i_needed )
         {
-            mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_entry, i_sample_count;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_offset_pts and p_sample_count_pts */
-            i_entry = 0;
-            int i_ret = xTTS_CountEntries( p_demux, &i_entry, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           ctts->pi_sample_count,
-                                           ctts->i_entry_count );
-            if ( i_ret != VLC_SUCCESS )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( i_entry, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( i_entry, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-            {
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, i_entry );
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < i_entry; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == i_entry - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = i_current_index_samples_left;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( ctts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_current_index_samples_left = ctts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == i_entry - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = ctts->pi_sample_count[i_index];
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index];
-                        i_sample_count -= ctts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-
-            }
+            msg_Err( p_demux, "invalid ctts table: %"PRIu64" samples for %"PRIu32,
+                     i_total, i_needed );
+            return VLC_EGENERIC;
         }
+
+        p_demux_track->p_ctts = ctts;
+        memset( &p_demux_track->ctts_cursor, 0, sizeof( mp4_rle_cursor_t ) );
     }
 
+    int64_t i_next_dts = TrackSampleDTS( p_demux_track, i_needed );
+
     msg_Dbg( p_demux, "track[Id 0x%x] read %"PRIu32" samples length:%"PRId64"s",
              p_demux_track->i_track_ID, p_demux_track->i_sample_count,
              i_next_dts / p_demux_track->i_timescale );
@@ -2412,10 +2327,8 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
 {
     demux_sys_t *p_sys = p_demux->p_sys;
     MP4_Box_t   *p_box_stss;
-    uint64_t     i_dts;
     unsigned int i_sample;
     unsigned int i_chunk;
-    int          i_index;
 
     /* FIXME see if it's needed to check p_track->i_chunk_count */
     if( p_track->i_chunk_count == 0 )
@@ -2459,52 +2372,24 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_start = i_start * p_track->i_timescale / CLOCK_FREQ;
     }
 
-    /* we start from sample 0/chunk 0, hope it won't take too much time */
-    /* *** find good chunk *** */
-    for( i_chunk = 0; ; i_chunk++ )
-    {
-        if( i_chunk + 1 >= p_track->i_chunk_count )
-        {
-            /* at the end and can't check if i_start in this chunk,
-               it will be check while searching i_sample */
-            i_chunk = p_track->i_chunk_count - 1;
-            break;
-        }
-
-        if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
-            (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
-        {
-            break;
-        }
-    }
+    /* *** find the sample, then its chunk *** */
+    i_sample = TrackDTSToSample( p_track, i_start );
 
-    /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
+    unsigned int i_low = 0, i_high = p_track->i_chunk_count;
+    while( i_high - i_low > 1 )
     {
-        if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
-        {
-            i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
-
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
-            i_index++;
-        }
+        unsigned int i_mid = ( i_low + i_high ) / 2;
+        if( p_track->chunk[i_mid].i_sample_first <= i_sample )
+            i_low = i_mid;
         else
-        {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
-            {
-                break;
-            }
-            i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
-            break;
-        }
+            i_high = i_mid;
     }
+    i_chunk = i_low;
+    /* skip empty chunks */
+    while( i_chunk + 1 < p_track->i_chunk_count &&
+           i_sample >= p_track->chunk[i_chunk].i_sample_first +
+                       p_track->chunk[i_chunk].i_sample_count )
+        i_chunk++;
 
     if( i_sample >= p_track->i_sample_count )
     {
@@ -2894,35 +2779,21 @@ static void FreeAndResetChunk( mp4_chunk_t *ck )
  ****************************************************************************/
 static void MP4_TrackDestroy( mp4_track_t *p_track )
 {
-    unsigned int i_chunk;
-
     p_track->b_ok = false;
     p_track->b_enable   = false;
     p_track->b_selected = false;
 
     es_format_Clean( &p_track->fmt );
 
-    for( i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
-    {
-        if( p_track->chunk )
-        {
-           FREENULL(p_track->chunk[i_chunk].p_sample_count_dts);
-           FREENULL(p_track->chunk[i_chunk].p_sample_delta_dts );
-
-           FREENULL(p_track->chunk[i_chunk].p_sample_count_pts);
-           FREENULL(p_track->chunk[i_chunk].p_sample_offset_pts );
-        }
-    }
     FREENULL( p_track->chunk );
     if( p_track->cchunk ) {
         FreeAndResetChunk( p_track->cchunk );
         FREENULL( p_track->cchunk );
     }
 
-    if( !p_track->i_sample_size )
-    {
-        FREENULL( p_track->p_sample_size );
-    }
+    p_track->p_sample_size = NULL; /* owned by the stsz box */
+    p_track->p_stts = NULL;
+    p_track->p_ctts = NULL;
 
     if ( p_track->asfinfo.p_frame )
         block_ChainRelease( p_track->asfinfo.p_frame );
@@ -4072,6 +3943,7 @@ static bool AddFragment( demux_t *p_demux, MP4_Box_t *p_moox )
 
     MP4_Box_t *p_traf = MP4_BoxGet( p_new->p_moox, "traf" );
     unsigned int i_durationindex = 0;
+    bool b_indexed = false;
     while ( p_traf )
     {
         if ( p_traf->i_type != ATOM_traf )
@@ -4121,6 +3993,16 @@ static bool AddFragment( demux_t *p_demux, MP4_Box_t *p_moox )
            continue;
         }
 
+        /* Index the fragment, for seeking before it's in the list */
+        const MP4_Box_t *p_tfdt = MP4_BoxGet( p_traf, "tfdt" );
+        if ( p_tfdt && BOXDATA(p_tfdt) && !b_indexed )
+        {
+            MP4_FragIndexAdd( &p_sys->fragindex, p_new->p_moox->i_pos,
+                              BOXDATA(p_tfdt)->i_base_media_decode_time,
+                              i_track_timescale );
+            b_indexed = true;
+        }
+
         if ( BOXDATA(p_tfhd)->i_flags & MP4_TFHD_BASE_DATA_OFFSET )
         {
             i_traf_base_data_offset = BOXDATA(p_tfhd)->i_base_data_offset;
@@ -4239,7 +4121,10 @@ static int ProbeIndex( demux_t *p_demux )
     assert( p_sys->b_seekable );
 
     if ( MP4_BoxCount( p_sys->p_root, "/mfra" ) )
+    {
+        IndexAddBoxes( p_demux );
         return VLC_SUCCESS;
+    }
 
     i_stream_size = stream_Size( p_demux->s );
     if ( ( i_stream_size >> 62 ) ||
@@ -4249,6 +4134,7 @@ static int ProbeIndex( demux_t *p_demux )
        )
     {
         msg_Dbg( p_demux, "Probing tail for mfro has failed" );
+        IndexAddBoxes( p_demux );
         return VLC_EGENERIC;
     }
 
@@ -4265,6 +4151,7 @@ static int ProbeIndex( demux_t *p_demux )
             MP4_ReadBoxContainerChildren( p_demux->s, p_sys->p_root, ATOM_mfra );
         }
     }
+    IndexAddBoxes( p_demux );
 
     return stream_Seek( p_demux->s, i_backup_pos );
 }
@@ -4579,30 +4466,6 @@ static int LeafMOOVGetSamplesSize( const mp4_track_t *p_track, const uint32_t i_
     return VLC_SUCCESS;
 }
 
-static inline mtime_t LeafGetMOOVTimeInChunk( const mp4_chunk_t *p_chunk, uint32_t i_sample )
-{
-    mtime_t i_time = 0;
-    uint32_t i_index = 0;
-
-    while( i_sample > 0 )
-    {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
-        {
-            i_time += p_chunk->p_sample_count_dts[i_index] *
-                p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index];
-            i_index++;
-        }
-        else
-        {
-            i_time += i_sample * p_chunk->p_sample_delta_dts[i_index];
-            break;
-        }
-    }
-
-    return i_time;
-}
-
 static int LeafParseMDATwithMOOV( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -4699,8 +4562,8 @@ static int LeafParseMDATwithMOOV( demux_t *p_demux )
                 p_sys->context.i_mdatbytesleft -= i_samplessize;
 
                 /* dts */
-                mtime_t i_time = LeafGetMOOVTimeInChunk( p_chunk, i_nb_samples );
-                i_time += p_chunk->i_first_dts;
+                mtime_t i_time = TrackSampleDTS( p_track,
+                                        i_nb_samples_at_chunk_start + i_nb_samples );
                 p_track->i_time = i_time;
                 p_block->i_dts = VLC_TS_0 + CLOCK_FREQ * i_time / p_track->i_timescale;
 
@@ -4836,55 +4699,88 @@ static int LeafMapTrafTrunContextes( demux_t *p_demux, MP4_Box_t *p_moof )
     return VLC_SUCCESS;
 }
 
-static int LeafIndexGetMoofPosByTime( demux_t *p_demux, const mtime_t i_target_time,
-                                      uint64_t *pi_pos, mtime_t *pi_mooftime )
+/* Adds the moofs of a tfra to the fragments index. Entries point to random
+ * access samples, which are usually but not always the first of the moof. */
+static void IndexAddTfra( demux_t *p_demux, MP4_Box_t *p_tfra )
 {
-    MP4_Box_t *p_tfra = MP4_BoxGet( p_demux->p_sys->p_root, "mfra/tfra" );
-    while ( p_tfra )
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const MP4_Box_data_tfra_t *p_data = BOXDATA(p_tfra);
+    if ( !p_data )
+        return;
+
+    mp4_track_t *p_track = MP4_frg_GetTrackByID( p_demux, p_data->i_track_ID );
+    if ( !p_track || !p_track->i_timescale ||
+         (p_track->fmt.i_cat != AUDIO_ES && p_track->fmt.i_cat != VIDEO_ES) )
+        return;
+
+    uint32_t i_sample_duration = 0;
+    const MP4_Box_t *p_trex = MP4_GetTrexByTrackID( p_sys->moovfragment.p_moox,
+                                                    p_data->i_track_ID );
+    if ( p_trex && BOXDATA(p_trex) )
+        i_sample_duration = BOXDATA(p_trex)->i_default_sample_duration;
+    else if ( p_track->fmt.i_cat == VIDEO_ES && p_sys->f_fps > 0 )
+        i_sample_duration = p_track->i_timescale / p_sys->f_fps;
+
+    for ( uint32_t i = 0; i < p_data->i_number_of_entries; i++ )
     {
-        if ( p_tfra->i_type == ATOM_tfra )
+        uint64_t i_time, i_offset;
+        uint32_t i_sample;
+
+        if ( p_data->i_version == 1 )
         {
-            int64_t i_pos = -1;
-            const MP4_Box_data_tfra_t *p_data = BOXDATA(p_tfra);
-            mp4_track_t *p_track = MP4_frg_GetTrackByID( p_demux, p_data->i_track_ID );
-            if ( p_track && (p_track->fmt.i_cat == AUDIO_ES || p_track->fmt.i_cat == VIDEO_ES) )
-            {
-                for ( uint32_t i = 0; i<p_data->i_number_of_entries; i += ( p_data->i_version == 1 ) ? 2 : 1 )
-                {
-                    mtime_t i_time;
-                    uint64_t i_offset;
-                    if ( p_data->i_version == 1 )
-                    {
-                        i_time = *((uint64_t *)(p_data->p_time + i));
-                        i_offset = *((uint64_t *)(p_data->p_moof_offset + i));
-                    }
-                    else
-                    {
-                        i_time = p_data->p_time[i];
-                        i_offset = p_data->p_moof_offset[i];
-                    }
+            i_time = ((const uint64_t *)p_data->p_time)[i];
+            i_offset = ((const uint64_t *)p_data->p_moof_offset)[i];
+        }
+        else
+        {
+            i_time = p_data->p_time[i];
+            i_offset = p_data->p_moof_offset[i];
+        }
 
-                    if ( CLOCK_FREQ * i_time / p_track->i_timescale >= i_target_time )
-                    {
-                        if ( i_pos == -1 ) /* Not in this traf */
-                            break;
-
-                        *pi_pos = (uint64_t) i_pos;
-                        *pi_mooftime = CLOCK_FREQ * i_time / p_track->i_timescale;
-                        if ( p_track->fmt.i_cat == AUDIO_ES )
-                            *pi_mooftime -= CLOCK_FREQ / p_track->fmt.audio.i_rate * p_data->p_sample_number[i];
-                        else
-                            *pi_mooftime -= CLOCK_FREQ / p_demux->p_sys->f_fps * p_data->p_sample_number[i];
-                        return VLC_SUCCESS;
-                    }
-                    else
-                        i_pos = i_offset;
-                }
-            }
+        switch ( p_data->i_length_size_of_sample_num )
+        {
+            case 0:
+                i_sample = p_data->p_sample_number[i];
+                break;
+            case 1:
+                i_sample = ((const uint16_t *)p_data->p_sample_number)[i];
+                break;
+            default:
+                i_sample = ((const uint32_t *)p_data->p_sample_number)[i];
+                break;
         }
-        p_tfra = p_tfra->p_next;
+
+        /* Samples are numbered from 1 */
+        if ( i_sample > 1 )
+            i_time -= __MIN( i_time, (uint64_t)( i_sample - 1 ) * i_sample_duration );
+
+        if ( MP4_FragIndexAdd( &p_sys->fragindex, i_offset, i_time,
+                               p_track->i_timescale ) == VLC_ENOMEM )
+            return;
     }
-    return VLC_EGENERIC;
+}
+
+/* Fills the fragments index from the sidx and mfra boxes read so far */
+static void IndexAddBoxes( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for ( MP4_Box_t *p_box = p_sys->p_root->p_first; p_box; p_box = p_box->p_next )
+    {
+        if ( p_box->i_type == ATOM_sidx )
+            MP4_FragIndexAddSidx( &p_sys->fragindex, p_box,
+                                  p_box->i_pos + p_box->i_size );
+    }
+
+    MP4_Box_t *p_tfra = MP4_BoxGet( p_sys->p_root, "mfra/tfra" );
+    for ( ; p_tfra; p_tfra = p_tfra->p_next )
+    {
+        if ( p_tfra->i_type == ATOM_tfra )
+            IndexAddTfra( p_demux, p_tfra );
+    }
+
+    msg_Dbg( p_demux, "fragments index has %u entries",
+             p_sys->fragindex.i_entries );
 }
 
 static void MP4_GetDefaultSizeAndDuration( demux_t *p_demux,
@@ -5047,6 +4943,11 @@ static int DemuxAsLeaf( demux_t *p_demux )
                     return 1;
                 }
 
+                MP4_Box_t *p_sidx = MP4_BoxGet( p_vroot, "sidx" );
+                if( p_sidx )
+                    MP4_FragIndexAddSidx( &p_sys->fragindex, p_sidx,
+                                          p_sidx->i_pos + p_sidx->i_size );
+
                 MP4_Box_t *p_mfhd = MP4_BoxGet( p_fragbox, "mfhd" );
                 if( p_mfhd && BOXDATA(p_mfhd) )
                 {
@@ -5055,7 +4956,6 @@ static int DemuxAsLeaf( demux_t *p_demux )
                     {
                         msg_Info( p_demux, "Fragment sequence discontinuity detected %"PRIu32" != %"PRIu32,
                                   BOXDATA(p_mfhd)->i_sequence_number, p_sys->context.i_lastseqnumber + 1 );
-                        MP4_Box_t *p_sidx = MP4_BoxGet( p_vroot, "sidx" );
                         if( p_sidx && BOXDATA(p_sidx) && BOXDATA(p_sidx)->i_timescale )
                         {
                             mtime_t i_time_base = BOXDATA(p_sidx)->i_earliest_presentation_time;
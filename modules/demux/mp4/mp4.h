@@ -61,6 +61,15 @@ typedef struct
 
 } mp4_chunk_t;
 
+/* Position in a run-length (stts or ctts) table, so that looking samples up
+ * in order does not need to walk the table from its start */
+typedef struct
+{
+    uint32_t     i_entry;        /* current table entry */
+    uint32_t     i_entry_sample; /* first sample of that entry */
+    int64_t      i_entry_dts;    /* dts of that sample (stts only) */
+} mp4_rle_cursor_t;
+
  /* Contain all needed information for read all track with vlc */
 typedef struct
 {
@@ -108,8 +117,13 @@ typedef struct
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-                                    too much time to do sumations each time*/
+    const uint32_t   *p_sample_size; /* points to the stsz box data */
+
+    /* timing of the samples described in the moov, looked up on demand */
+    const MP4_Box_data_stts_t *p_stts;
+    const MP4_Box_data_ctts_t *p_ctts; /* may be NULL */
+    mp4_rle_cursor_t stts_cursor;
+    mp4_rle_cursor_t ctts_cursor;
 
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
@@ -97,8 +97,23 @@ typedef struct
     int   i_lowpass;
     float pf_replay_gain[AUDIO_REPLAY_GAIN_MAX];
     float pf_replay_peak[AUDIO_REPLAY_GAIN_MAX];
+    int   i_enc_delay;   /* encoder priming, in samples */
+    int   i_enc_padding; /* encoder padding, in samples */
 } lame_extra_t;
 
+typedef struct
+{
+    int64_t  i_offset;
+    uint64_t i_sample;
+} mpga_seekpoint_t;
+
+typedef struct
+{
+    mpga_seekpoint_t *p_points;
+    int i_count;
+    int i_alloc;
+} mpga_seektable_t;
+
 struct demux_sys_t
 {
     codec_t codec;
@@ -134,11 +149,26 @@ struct demux_sys_t
         int i_frame_samples;
         lame_extra_t lame;
         bool b_lame;
+        bool b_skip_frame; /* drop the Xing frame, it is not audio */
+        mpga_seektable_t toc; /* from the Xing or VBRI header, approximate */
     } xing;
+
+    /* Mpga frame index, exact */
+    struct
+    {
+        mpga_seektable_t table;
+        uint32_t i_header; /* bits common to all the frame headers */
+        unsigned i_rate;
+        bool     b_exact;  /* the position of the next frame is known */
+        int64_t  i_offset; /* of the next frame */
+        uint64_t i_sample; /* of the next frame */
+    } index;
 };
 
 static int MpgaProbe( demux_t *p_demux, int64_t *pi_offset );
 static int MpgaInit( demux_t *p_demux );
+static void MpgaIndexFrame( demux_t *p_demux, const block_t *p_block );
+static int MpgaSeek( demux_t *p_demux, mtime_t i_time );
 
 static int AacProbe( demux_t *p_demux, int64_t *pi_offset );
 static int AacInit( demux_t *p_demux );
@@ -237,6 +267,21 @@ static int OpenCommon( demux_t *p_demux,
                 p_fmt->audio_replay_gain.pf_peak[i] = p_lame->pf_replay_peak[i];
             }
         }
+
+        if( p_sys->xing.b_skip_frame )
+        {
+            /* The dates are counted from the (dropped) Xing frame, and the
+             * decoders output the samples 529 samples late */
+            const int i_samples = p_sys->xing.i_frame_samples;
+
+            p_fmt->audio_gapless.i_delay = i_samples + p_lame->i_enc_delay + 529;
+            if( p_sys->xing.i_frames > 0 &&
+                (int64_t)p_sys->xing.i_frames * i_samples >
+                    p_lame->i_enc_delay + p_lame->i_enc_padding )
+                p_fmt->audio_gapless.i_samples =
+                    (uint64_t)p_sys->xing.i_frames * i_samples
+                    - p_lame->i_enc_delay - p_lame->i_enc_padding;
+        }
     }
 
     while( vlc_object_alive( p_demux ) )
@@ -302,6 +347,17 @@ static int Demux( demux_t *p_demux )
     {
         block_t *p_next = p_block_out->p_next;
 
+        if( p_sys->codec.i_codec == VLC_CODEC_MPGA )
+            MpgaIndexFrame( p_demux, p_block_out );
+
+        if( p_sys->xing.b_skip_frame )
+        {
+            p_sys->xing.b_skip_frame = false;
+            block_Release( p_block_out );
+            p_block_out = p_next;
+            continue;
+        }
+
         /* Correct timestamp */
         if( p_sys->p_packetizer->fmt_out.i_cat == VIDEO_ES )
         {
@@ -350,6 +406,8 @@ static void Close( vlc_object_t * p_this )
     if( p_sys->p_packetized_data )
         block_ChainRelease( p_sys->p_packetized_data );
     demux_PacketizerDestroy( p_sys->p_packetizer );
+    free( p_sys->xing.toc.p_points );
+    free( p_sys->index.table.p_points );
     free( p_sys );
 }
 
@@ -406,8 +464,17 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         }
 
         case DEMUX_SET_TIME:
-            /* FIXME TODO: implement a high precision seek (with mp3 parsing)
-             * needed for multi-input */
+            if( p_sys->codec.i_codec == VLC_CODEC_MPGA )
+            {
+                va_list ap;
+
+                va_copy( ap, args );
+                i_ret = MpgaSeek( p_demux, (int64_t)va_arg( ap, int64_t ) );
+                va_end( ap );
+                if( !i_ret )
+                    return VLC_SUCCESS;
+            }
+            /* Fall back to the average bitrate */
         default:
             i_ret = demux_vaControlHelper( p_demux->s, p_sys->i_stream_offset, -1,
                                             p_sys->i_bitrate_avg, 1, i_query,
@@ -421,6 +488,8 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
                 /* Fix time_offset */
                 if( i_time >= 0 )
                     p_sys->i_time_offset = i_time - p_sys->i_pts;
+                /* The frame positions are lost */
+                p_sys->index.b_exact = false;
                 /* And reset buffered data */
                 if( p_sys->p_packetized_data )
                     block_ChainRelease( p_sys->p_packetized_data );
@@ -700,6 +769,281 @@ static int MpgaGetFrameSamples( uint32_t h )
     }
 }
 
+/* Bits which do not change from a frame to the next: sync, version, layer,
+ * and sampling rate */
+#define MPGA_HEADER_MASK    0xFFFE0C00
+
+/* Interval between the points of the frame index, in seconds */
+#define MPGA_INDEX_INTERVAL 5
+/* Beyond this distance from the nearest indexed point, in seconds, an
+ * approximate seek with the table of contents is preferred */
+#define MPGA_SEEK_MAX_FORWARD (2 * MPGA_INDEX_INTERVAL)
+
+static unsigned MpgaGetSampleRate( uint32_t h )
+{
+    static const unsigned pi_rate[4] = { 44100, 48000, 32000, 0 };
+
+    /* MPEG 2 halves the rates, MPEG 2.5 halves them again */
+    return pi_rate[(h >> 10) & 0x03] >> ( MPGA_VERSION(h) + !((h >> 20) & 0x01) );
+}
+
+static int MpgaGetFrameSize( uint32_t h )
+{
+    static const uint16_t pppi_bitrate[2][3][16] =
+    {
+        {
+            { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },
+            { 0, 32, 48, 56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },
+            { 0, 32, 40, 48,  56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320, 0 },
+        },
+        {
+            { 0, 32, 48, 56,  64,  80,  96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },
+            { 0,  8, 16, 24,  32,  40,  48,  56,  64,  80,  96, 112, 128, 144, 160, 0 },
+            { 0,  8, 16, 24,  32,  40,  48,  56,  64,  80,  96, 112, 128, 144, 160, 0 },
+        },
+    };
+    const int i_layer = 3 - ((h >> 17) & 0x03);
+    const unsigned i_rate = MpgaGetSampleRate( h );
+    const int i_padding = (h >> 9) & 0x01;
+
+    if( i_layer < 0 || i_layer > 2 || i_rate == 0 )
+        return 0;
+
+    /* No size for the free format */
+    const int i_bitrate = pppi_bitrate[MPGA_VERSION(h)][i_layer][(h >> 12) & 0x0F];
+    if( i_bitrate == 0 )
+        return 0;
+
+    if( i_layer == 0 )
+        return ( 12000 * i_bitrate / i_rate + i_padding ) * 4;
+    return MpgaGetFrameSamples( h ) / 8 * 1000 * i_bitrate / i_rate + i_padding;
+}
+
+static int MpgaSeekTableAppend( mpga_seektable_t *p_table,
+                                int64_t i_offset, uint64_t i_sample )
+{
+    if( p_table->i_count >= p_table->i_alloc )
+    {
+        const int i_alloc = p_table->i_alloc > 0 ? 2 * p_table->i_alloc : 64;
+        mpga_seekpoint_t *p_points = realloc( p_table->p_points,
+                                              i_alloc * sizeof(*p_points) );
+        if( unlikely(p_points == NULL) )
+            return VLC_ENOMEM;
+        p_table->p_points = p_points;
+        p_table->i_alloc = i_alloc;
+    }
+    p_table->p_points[p_table->i_count].i_offset = i_offset;
+    p_table->p_points[p_table->i_count].i_sample = i_sample;
+    p_table->i_count++;
+    return VLC_SUCCESS;
+}
+
+/* Returns the last point at or before the sample, or -1 */
+static int MpgaSeekTableFind( const mpga_seektable_t *p_table, uint64_t i_sample )
+{
+    int i_low = 0;
+    int i_high = p_table->i_count - 1;
+    int i_found = -1;
+
+    while( i_low <= i_high )
+    {
+        const int i_mid = ( i_low + i_high ) / 2;
+
+        if( p_table->p_points[i_mid].i_sample <= i_sample )
+        {
+            i_found = i_mid;
+            i_low = i_mid + 1;
+        }
+        else
+            i_high = i_mid - 1;
+    }
+    return i_found;
+}
+
+static uint64_t MpgaIndexLast( demux_sys_t *p_sys )
+{
+    const mpga_seektable_t *p_table = &p_sys->index.table;
+
+    return p_table->p_points[p_table->i_count - 1].i_sample;
+}
+
+/* Adds a point to the index if the last one is far enough */
+static void MpgaIndexAdd( demux_sys_t *p_sys, int64_t i_offset, uint64_t i_sample )
+{
+    if( i_sample >= MpgaIndexLast( p_sys ) +
+                    (uint64_t)MPGA_INDEX_INTERVAL * p_sys->index.i_rate )
+        MpgaSeekTableAppend( &p_sys->index.table, i_offset, i_sample );
+}
+
+/* Follows the frames sent by the demuxer, while their position in the
+ * stream is known, to index them */
+static void MpgaIndexFrame( demux_t *p_demux, const block_t *p_block )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_sys->index.b_exact )
+        return;
+
+    const uint32_t h = p_block->i_buffer >= 4 ? GetDWBE( p_block->p_buffer ) : 0;
+    if( ( h & MPGA_HEADER_MASK ) != p_sys->index.i_header )
+    {
+        msg_Dbg( p_demux, "lost the frame positions, not indexing" );
+        p_sys->index.b_exact = false;
+        return;
+    }
+
+    MpgaIndexAdd( p_sys, p_sys->index.i_offset, p_sys->index.i_sample );
+    p_sys->index.i_offset += p_block->i_buffer;
+    p_sys->index.i_sample += MpgaGetFrameSamples( h );
+}
+
+/* Walks the frame headers from the last indexed point up to the sample,
+ * when the stream can seek cheaply. The frames are not read. */
+static void MpgaIndexScan( demux_t *p_demux, uint64_t i_target )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    bool b_fast;
+
+    if( stream_Control( p_demux->s, STREAM_CAN_FASTSEEK, &b_fast ) || !b_fast )
+        return;
+
+    const mpga_seektable_t *p_table = &p_sys->index.table;
+    int64_t i_offset = p_table->p_points[p_table->i_count - 1].i_offset;
+    uint64_t i_sample = MpgaIndexLast( p_sys );
+    const int64_t i_saved = stream_Tell( p_demux->s );
+
+    if( stream_Seek( p_demux->s, i_offset ) )
+        return;
+
+    while( i_sample < i_target && vlc_object_alive( p_demux ) )
+    {
+        const uint8_t *p_peek;
+
+        if( stream_Peek( p_demux->s, &p_peek, 4 ) < 4 )
+            break;
+
+        const uint32_t h = GetDWBE( p_peek );
+        if( !MpgaCheckSync( p_peek ) ||
+            ( h & MPGA_HEADER_MASK ) != p_sys->index.i_header )
+            break;
+
+        const int i_size = MpgaGetFrameSize( h );
+        if( i_size <= 4 || stream_Read( p_demux->s, NULL, i_size ) < i_size )
+            break;
+
+        i_offset += i_size;
+        i_sample += MpgaGetFrameSamples( h );
+        MpgaIndexAdd( p_sys, i_offset, i_sample );
+    }
+    msg_Dbg( p_demux, "indexed %d points, up to %"PRId64" s",
+             p_table->i_count,
+             (int64_t)( MpgaIndexLast( p_sys ) / p_sys->index.i_rate ) );
+
+    stream_Seek( p_demux->s, i_saved );
+}
+
+/* Resets the packetizer, and the data it has output, after a seek */
+static void MpgaResetPacketizer( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    block_t *p_block = block_Alloc( 0 );
+
+    if( p_block )
+    {
+        p_block->i_flags |= BLOCK_FLAG_DISCONTINUITY | BLOCK_FLAG_CORRUPTED;
+
+        block_t *p_out = p_sys->p_packetizer->pf_packetize( p_sys->p_packetizer,
+                                                            &p_block );
+        if( p_out )
+            block_ChainRelease( p_out );
+    }
+    if( p_sys->p_packetized_data )
+        block_ChainRelease( p_sys->p_packetized_data );
+    p_sys->p_packetized_data = NULL;
+
+    /* The first block is dated from the time offset */
+    p_sys->b_start = true;
+    p_sys->i_pts = 0;
+}
+
+/* Seeks to an indexed frame, and lets the decoder discard the samples up
+ * to the requested time */
+static int MpgaSeekExact( demux_t *p_demux, const mpga_seekpoint_t *p_point,
+                          mtime_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const uint8_t *p_peek;
+
+    if( stream_Seek( p_demux->s, p_point->i_offset ) ||
+        stream_Peek( p_demux->s, &p_peek, 4 ) < 4 ||
+        ( GetDWBE( p_peek ) & MPGA_HEADER_MASK ) != p_sys->index.i_header )
+        return VLC_EGENERIC;
+
+    MpgaResetPacketizer( p_demux );
+    p_sys->i_time_offset = CLOCK_FREQ * p_point->i_sample / p_sys->index.i_rate;
+
+    p_sys->index.b_exact = true;
+    p_sys->index.i_offset = p_point->i_offset;
+    p_sys->index.i_sample = p_point->i_sample;
+    p_sys->xing.b_skip_frame = p_point->i_offset == p_sys->i_stream_offset &&
+        p_sys->p_packetizer->fmt_out.audio_gapless.i_delay > 0;
+
+    es_out_Control( p_demux->out, ES_OUT_SET_NEXT_DISPLAY_TIME, VLC_TS_0 + i_time );
+    return VLC_SUCCESS;
+}
+
+/* Seeks with the table of contents of the Xing or VBRI header */
+static int MpgaSeekToc( demux_t *p_demux, uint64_t i_target, mtime_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const mpga_seektable_t *p_toc = &p_sys->xing.toc;
+    const int i = MpgaSeekTableFind( p_toc, i_target );
+
+    if( i < 0 )
+        return VLC_EGENERIC;
+
+    const mpga_seekpoint_t *p_point = &p_toc->p_points[i];
+    int64_t i_offset = p_point->i_offset;
+    if( i + 1 < p_toc->i_count &&
+        p_point[1].i_sample > p_point->i_sample )
+        i_offset += ( p_point[1].i_offset - p_point->i_offset ) *
+                    (int64_t)( i_target - p_point->i_sample ) /
+                    (int64_t)( p_point[1].i_sample - p_point->i_sample );
+
+    if( stream_Seek( p_demux->s, i_offset ) )
+        return VLC_EGENERIC;
+
+    MpgaResetPacketizer( p_demux );
+    p_sys->i_time_offset = i_time;
+    p_sys->index.b_exact = false;
+    p_sys->xing.b_skip_frame = false;
+    return VLC_SUCCESS;
+}
+
+static int MpgaSeek( demux_t *p_demux, mtime_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->index.i_rate == 0 || p_sys->index.table.i_count <= 0 ||
+        i_time < 0 )
+        return VLC_EGENERIC;
+
+    const uint64_t i_target = i_time * p_sys->index.i_rate / CLOCK_FREQ;
+
+    if( MpgaIndexLast( p_sys ) < i_target )
+        MpgaIndexScan( p_demux, i_target );
+
+    const int i = MpgaSeekTableFind( &p_sys->index.table, i_target );
+    const mpga_seekpoint_t *p_point = &p_sys->index.table.p_points[i];
+    const bool b_near = i_target - p_point->i_sample <=
+                        (uint64_t)MPGA_SEEK_MAX_FORWARD * p_sys->index.i_rate;
+
+    if( b_near && !MpgaSeekExact( p_demux, p_point, i_time ) )
+        return VLC_SUCCESS;
+
+    return MpgaSeekToc( p_demux, i_target, i_time );
+}
+
 static int MpgaProbe( demux_t *p_demux, int64_t *pi_offset )
 {
     const int pi_wav[] = { WAVE_FORMAT_MPEG, WAVE_FORMAT_MPEGLAYER3, WAVE_FORMAT_UNKNOWN };
@@ -797,6 +1141,60 @@ static double MpgaXingLameConvertPeak( uint32_t x )
     return x / 8388608.0; /* pow(2, 23) */
 }
 
+static void MpgaVbriParse( demux_t *p_demux, uint32_t header )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const uint8_t *p_peek;
+
+    if( stream_Peek( p_demux->s, &p_peek, 36 + 26 ) < 36 + 26 )
+        return;
+
+    const uint8_t *p_vbri = &p_peek[36];
+    const uint32_t i_bytes = GetDWBE( &p_vbri[10] );
+    const uint32_t i_frames = GetDWBE( &p_vbri[14] );
+    const unsigned i_entries = GetWBE( &p_vbri[18] );
+    const unsigned i_scale = GetWBE( &p_vbri[20] );
+    const unsigned i_entry_size = GetWBE( &p_vbri[22] );
+    const unsigned i_entry_frames = GetWBE( &p_vbri[24] );
+    const int i_frame_samples = MpgaGetFrameSamples( header );
+
+    if( i_bytes == 0 || i_frames == 0 || i_frame_samples == 0 ||
+        i_bytes > INT32_MAX || i_frames > INT32_MAX )
+        return;
+
+    p_sys->xing.i_bytes = i_bytes;
+    p_sys->xing.i_frames = i_frames;
+    p_sys->xing.i_frame_samples = i_frame_samples;
+    msg_Dbg( p_demux, "vbri header present (%u bytes, %u frames, %u entries)",
+             i_bytes, i_frames, i_entries );
+
+    /* The table of contents gives the size of each group of frames */
+    if( i_entry_size < 1 || i_entry_size > 4 || i_entry_frames == 0 )
+        return;
+
+    const int i_toc = 36 + 26 + i_entries * i_entry_size;
+    if( stream_Peek( p_demux->s, &p_peek, i_toc ) < i_toc )
+        return;
+
+    const uint8_t *p_entry = &p_peek[36 + 26];
+    int64_t i_offset = p_sys->i_stream_offset;
+    uint64_t i_sample = 0;
+
+    for( unsigned i = 0; i <= i_entries; i++ )
+    {
+        if( MpgaSeekTableAppend( &p_sys->xing.toc, i_offset, i_sample ) ||
+            i == i_entries )
+            break;
+
+        uint32_t i_size = 0;
+        for( unsigned j = 0; j < i_entry_size; j++ )
+            i_size = ( i_size << 8 ) | *p_entry++;
+
+        i_offset += (int64_t)i_size * i_scale;
+        i_sample += (uint64_t)i_entry_frames * i_frame_samples;
+    }
+}
+
 static int MpgaInit( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -816,6 +1214,22 @@ static int MpgaInit( demux_t *p_demux )
     if( !MpgaCheckSync( p_peek ) )
         return VLC_SUCCESS;
 
+    /* The frame index starts on the first frame */
+    p_sys->index.i_header = header & MPGA_HEADER_MASK;
+    p_sys->index.i_rate = MpgaGetSampleRate( header );
+    p_sys->index.i_offset = p_sys->i_stream_offset;
+    p_sys->index.b_exact = p_sys->index.i_rate > 0 &&
+        !MpgaSeekTableAppend( &p_sys->index.table, p_sys->i_stream_offset, 0 );
+    if( !p_sys->index.b_exact )
+        p_sys->index.i_rate = 0;
+
+    /* VBRI header, always 32 bytes after the frame header */
+    if( i_peek >= 36 + 26 && !memcmp( &p_peek[36], "VBRI", 4 ) )
+    {
+        MpgaVbriParse( p_demux, header );
+        return VLC_SUCCESS;
+    }
+
     /* Xing header */
     const uint8_t *p_xing = p_peek;
     int i_xing = i_peek;
@@ -837,8 +1251,15 @@ static int MpgaInit( demux_t *p_demux )
         p_sys->xing.i_frames = MpgaXingGetDWBE( &p_xing, &i_xing, 0 );
     if( i_flags&0x02 )
         p_sys->xing.i_bytes = MpgaXingGetDWBE( &p_xing, &i_xing, 0 );
-    if( i_flags&0x04 ) /* TODO Support XING TOC to improve seeking accuracy */
+    uint8_t p_toc[100];
+    bool b_toc = false;
+    if( i_flags&0x04 )
+    {
+        b_toc = i_xing >= 100;
+        if( b_toc )
+            memcpy( p_toc, p_xing, 100 );
         MpgaXingSkip( &p_xing, &i_xing, 100 );
+    }
     if( i_flags&0x08 )
     {
         /* FIXME: doesn't return the right bitrage average, at least
@@ -855,6 +1276,18 @@ static int MpgaInit( demux_t *p_demux )
                  "(%d bytes, %d frames, %d samples/frame)",
                  p_sys->xing.i_bytes, p_sys->xing.i_frames,
                  p_sys->xing.i_frame_samples );
+
+        /* The table of contents gives the position of each percent of the
+         * duration, in 256th of the size */
+        const uint64_t i_samples = (uint64_t)p_sys->xing.i_frames *
+                                   p_sys->xing.i_frame_samples;
+        for( int i = 0; b_toc && i < 100; i++ )
+        {
+            if( MpgaSeekTableAppend( &p_sys->xing.toc, p_sys->i_stream_offset +
+                        (int64_t)p_toc[i] * p_sys->xing.i_bytes / 256,
+                        i_samples * i / 100 ) )
+                break;
+        }
     }
 
     if( i_xing >= 20 && memcmp( p_xing, "LAME", 4 ) == 0)
@@ -880,6 +1313,24 @@ static int MpgaInit( demux_t *p_demux )
         p_lame->pf_replay_gain[AUDIO_REPLAY_GAIN_ALBUM] = (float) MpgaXingLameConvertGain( album );
 
         MpgaXingSkip( &p_xing, &i_xing, 1 ); /* flags */
+
+        if( i_xing >= 4 && p_sys->xing.i_frame_samples > 0 )
+        {
+            MpgaXingSkip( &p_xing, &i_xing, 1 ); /* abr/vbr bitrate */
+
+            p_lame->i_enc_delay = ( p_xing[0] << 4 ) | ( p_xing[1] >> 4 );
+            p_lame->i_enc_padding = ( ( p_xing[1] & 0x0f ) << 8 ) | p_xing[2];
+            MpgaXingSkip( &p_xing, &i_xing, 3 );
+
+            /* Without the encoder delay, the tag is likely not from LAME */
+            if( p_lame->i_enc_delay > 0 )
+            {
+                p_sys->xing.b_skip_frame = true;
+                msg_Dbg( p_demux, "lame gapless info present "
+                         "(%d delay, %d padding)",
+                         p_lame->i_enc_delay, p_lame->i_enc_padding );
+            }
+        }
     }
 
     return VLC_SUCCESS;
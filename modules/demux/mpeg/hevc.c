@@ -224,35 +224,16 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 }
 
 
-static uint8_t * CreateDecodedNAL( int *pi_ret,
-                              const uint8_t *src, int i_src )
-{
-    uint8_t *dst = malloc( i_src );
-    if( !dst )
-        return NULL;
-
-    *pi_ret = nal_decode( src, dst, i_src );
-    return dst;
-}
-
 static int32_t getFPS( demux_t *p_demux, block_t * p_block )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
     bs_t bs;
-    uint8_t * p_decoded_nal;
-    int i_decoded_nal;
 
     if( p_block->i_buffer < 5 )
         return -1;
 
-    p_decoded_nal = CreateDecodedNAL(&i_decoded_nal,
-                                     p_block->p_buffer+4, p_block->i_buffer-4);
-
-    if( !p_decoded_nal )
-        return -1;
-
-    bs_init( &bs, p_decoded_nal, i_decoded_nal );
+    bs_init_rbsp( &bs, p_block->p_buffer+4, p_block->i_buffer-4 );
     bs_skip( &bs, 12 );
     int32_t max_sub_layer_minus1 = bs_read( &bs, 3 );
     bs_skip( &bs, 17 );
@@ -292,6 +273,5 @@ static int32_t getFPS( demux_t *p_demux, block_t * p_block )
         msg_Err( p_demux, "No timing info in VPS defaulting to 25 fps");
         p_sys->f_fps = 25.0f;
     }
-    free(p_decoded_nal);
     return 0;
 }
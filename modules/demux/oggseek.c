@@ -48,6 +48,14 @@
 #define SEGMENT_NOT_FOUND -1
 
 #define MAX_PAGE_SIZE 65307
+/* A page of a stream and the time its last complete packet ends at */
+typedef struct
+{
+    int64_t i_pos;
+    int64_t i_timestamp;
+    int64_t i_granule;
+} oggseek_point_t;
+
 typedef struct packetStartCoordinates
 {
     int64_t i_pos;
@@ -97,30 +105,20 @@ static demux_index_entry_t *index_entry_new( void )
    time stamps) */
 const demux_index_entry_t *OggSeek_IndexAdd ( logical_stream_t *p_stream,
                                              int64_t i_timestamp,
-                                             int64_t i_pagepos )
+                                             int64_t i_pagepos,
+                                             int64_t i_granule )
 {
     demux_index_entry_t *idx;
-    demux_index_entry_t *oidx;
     demux_index_entry_t *last_idx = NULL;
 
     if ( p_stream == NULL ) return NULL;
 
-    oidx = idx = p_stream->idx;
-
     if ( i_timestamp < 1 || i_pagepos < 1 ) return NULL;
 
-    if ( idx == NULL )
-    {
-        demux_index_entry_t *ie = index_entry_new();
-        if ( !ie ) return NULL;
-        ie->i_value = i_timestamp;
-        ie->i_pagepos = i_pagepos;
-        p_stream->idx = ie;
-        return ie;
-    }
-
+    idx = p_stream->idx;
     while ( idx != NULL )
     {
+        if ( idx->i_pagepos == i_pagepos ) return idx;
         if ( idx->i_pagepos > i_pagepos ) break;
         last_idx = idx;
         idx = idx->p_next;
@@ -137,8 +135,8 @@ const demux_index_entry_t *OggSeek_IndexAdd ( logical_stream_t *p_stream,
     }
     else
     {
-        idx->p_next = oidx;
-        oidx = idx;
+        idx->p_next = p_stream->idx;
+        p_stream->idx = idx;
     }
 
     if ( idx->p_next != NULL )
@@ -148,6 +146,7 @@ const demux_index_entry_t *OggSeek_IndexAdd ( logical_stream_t *p_stream,
 
     idx->i_value = i_timestamp;
     idx->i_pagepos = i_pagepos;
+    idx->i_granule = i_granule;
 
     return idx;
 }
@@ -745,22 +744,30 @@ int64_t Oggseek_GranuleToAbsTimestamp( logical_stream_t *p_stream,
     return i_timestamp;
 }
 
+/* Tightens the search bounds with the pages found by previous searches */
+static void OggSeekIndexBounds( logical_stream_t *p_stream, int64_t i_timestamp,
+                                oggseek_point_t *p_lower, oggseek_point_t *p_upper )
+{
+    for ( demux_index_entry_t *idx = p_stream->idx; idx != NULL; idx = idx->p_next )
+    {
+        if ( idx->i_pagepos <= p_lower->i_pos ) continue;
+        if ( idx->i_pagepos >= p_upper->i_pos ) break;
+
+        oggseek_point_t *p_point = ( idx->i_value <= i_timestamp ) ? p_lower : p_upper;
+        p_point->i_pos = idx->i_pagepos;
+        p_point->i_timestamp = idx->i_value;
+        p_point->i_granule = idx->i_granule;
+        if ( p_point == p_upper ) break;
+    }
+}
+
 /* returns pos */
 static int64_t OggBisectSearchByTime( demux_t *p_demux, logical_stream_t *p_stream,
             int64_t i_targettime, int64_t i_pos_lower, int64_t i_pos_upper)
 {
-    int64_t i_start_pos;
-    int64_t i_end_pos;
-    int64_t i_segsize;
-
-    struct
-    {
-        int64_t i_pos;
-        int64_t i_timestamp;
-        int64_t i_granule;
-    } bestlower = { p_stream->i_data_start, -1, -1 },
-      current = { -1, -1, -1 },
-      lowestupper = { -1, -1, -1 };
+    oggseek_point_t bestlower = { p_stream->i_data_start, -1, -1 },
+                    current = { -1, -1, -1 },
+                    lowestupper = { -1, -1, -1 };
 
     demux_sys_t *p_sys  = p_demux->p_sys;
 
@@ -768,36 +775,79 @@ static int64_t OggBisectSearchByTime( demux_t *p_demux, logical_stream_t *p_stre
     i_pos_upper = __MIN( i_pos_upper, p_sys->i_total_length );
     if ( i_pos_upper < 0 ) i_pos_upper = p_sys->i_total_length;
 
-    i_start_pos = i_pos_lower;
-    i_end_pos = i_pos_upper;
-
-    i_segsize = ( i_end_pos - i_start_pos + 1 ) >> 1;
-    i_start_pos += i_segsize;
-
-    OggDebug( msg_Dbg(p_demux, "Bisecting for time=%"PRId64" between %"PRId64" and %"PRId64,
-            i_targettime, i_pos_lower, i_pos_upper ) );
-
-    do
+    /* Current bounds, with their times when known so that we can
+     * interpolate rather than bisect */
+    oggseek_point_t lower = { i_pos_lower, -1, -1 },
+                    upper = { i_pos_upper, -1, -1 };
+    if ( i_pos_lower == p_stream->i_data_start )
+        lower.i_timestamp = 0;
+    if ( i_pos_upper == p_sys->i_total_length && p_sys->i_length > 0 )
+        upper.i_timestamp = p_sys->i_length * CLOCK_FREQ;
+
+    OggSeekIndexBounds( p_stream, i_targettime, &lower, &upper );
+    if ( lower.i_granule != -1 ) bestlower = lower;
+    if ( upper.i_granule != -1 ) lowestupper = upper;
+
+    OggDebug( msg_Dbg(p_demux, "Searching for time=%"PRId64" between %"PRId64" and %"PRId64,
+            i_targettime, lower.i_pos, upper.i_pos ) );
+
+    bool b_bisect = false;
+    bool b_linear = false;
+    while ( upper.i_pos - lower.i_pos > 1 )
     {
-        /* see if the frame lies in current segment */
-        i_start_pos = __MAX( i_start_pos, i_pos_lower );
-        i_end_pos = __MIN( i_end_pos, i_pos_upper );
+        const int64_t i_span = upper.i_pos - lower.i_pos;
+        int64_t i_probe;
 
-        if ( i_start_pos >= i_end_pos )
+        if ( b_linear )
+        {
+            /* next page after the lower bound */
+            i_probe = lower.i_pos + 1;
+        }
+        else if ( !b_bisect && lower.i_timestamp >= 0 &&
+                  upper.i_timestamp > lower.i_timestamp )
         {
-            if ( i_start_pos == i_pos_lower)
+            i_probe = lower.i_pos + (double) i_span *
+                      ( i_targettime - lower.i_timestamp ) /
+                      ( upper.i_timestamp - lower.i_timestamp );
+            if ( i_probe - lower.i_pos <= OGGSEEK_BYTES_TO_READ )
             {
-                return i_start_pos;
+                /* the target page is within a read */
+                i_probe = lower.i_pos + 1;
+                b_linear = true;
             }
-            return -1;
+            else
+            {
+                /* aim early, so as to land just before the target page */
+                i_probe -= OGGSEEK_BYTES_TO_READ / 2;
+            }
+        }
+        else
+        {
+            i_probe = lower.i_pos + i_span / 2;
         }
 
+        /* Probe at aligned offsets, so that reads are shared by nearby
+         * probes and by later seeks */
+        if ( !b_linear )
+            i_probe &= ~(int64_t)( OGGSEEK_ALIGN - 1 );
+        i_probe = __MIN( __MAX( i_probe, lower.i_pos + 1 ), upper.i_pos - 1 );
 
         current.i_pos = find_first_page_granule( p_demux,
-                                                 i_start_pos, i_end_pos,
+                                                 i_probe, upper.i_pos,
                                                  p_stream,
                                                  &current.i_granule );
 
+        if ( current.i_pos == -1 || current.i_granule == -1 ||
+             current.i_pos >= upper.i_pos )
+        {
+            /* no page of ours in there */
+            if ( i_probe == lower.i_pos + 1 )
+                break;
+            upper.i_pos = i_probe;
+            b_linear = true;
+            continue;
+        }
+
         current.i_timestamp = Oggseek_GranuleToAbsTimestamp( p_stream,
                                                              current.i_granule, false );
 
@@ -811,41 +861,31 @@ static int64_t OggBisectSearchByTime( demux_t *p_demux, logical_stream_t *p_stre
             current.i_timestamp = 0;
         }
 
-        if ( current.i_pos != -1 && current.i_granule != -1 )
-        {
-            /* found a page */
+        /* Remember that page for the next searches */
+        OggSeek_IndexAdd( p_stream, current.i_timestamp, current.i_pos,
+                          current.i_granule );
 
-            if ( current.i_timestamp <= i_targettime )
-            {
-                /* set our lower bound */
-                if ( current.i_timestamp > bestlower.i_timestamp )
-                    bestlower = current;
-                i_start_pos = current.i_pos;
-            }
-            else if ( current.i_timestamp > i_targettime )
-            {
-                if ( lowestupper.i_timestamp == -1 || current.i_timestamp < lowestupper.i_timestamp )
-                    lowestupper = current;
-                /* check lower half of segment */
-                i_start_pos -= i_segsize;
-                i_end_pos -= i_segsize;
-            }
+        if ( current.i_timestamp <= i_targettime )
+        {
+            /* set our lower bound */
+            bestlower = lower = current;
+            b_linear = false;
         }
         else
         {
-            /* no keyframe found, check lower segment */
-            i_end_pos -= i_segsize;
-            i_start_pos -= i_segsize;
+            lowestupper = upper = current;
+            if ( i_probe == lower.i_pos + 1 )
+                break; /* next page is past the target */
         }
 
-        OggDebug( msg_Dbg(p_demux, "Bisect restart i_segsize=%"PRId64" between %"PRId64
-                                   " and %"PRId64 " bl %"PRId64" lu %"PRId64,
-                i_segsize, i_start_pos, i_end_pos, bestlower.i_granule, lowestupper.i_granule  ) );
-
-        i_segsize = ( i_end_pos - i_start_pos + 1 ) >> 1;
-        i_start_pos += i_segsize;
+        /* Interpolation may converge slowly on uneven bitrates: bisect
+         * whenever it did not halve the range */
+        b_bisect = !b_bisect && upper.i_pos - lower.i_pos > i_span / 2;
 
-    } while ( i_segsize > 64 );
+        OggDebug( msg_Dbg(p_demux, "Search restart between %"PRId64
+                                   " and %"PRId64 " bl %"PRId64" lu %"PRId64,
+                lower.i_pos, upper.i_pos, bestlower.i_granule, lowestupper.i_granule  ) );
+    }
 
     if ( bestlower.i_granule == -1 )
     {
@@ -999,10 +1039,6 @@ int Oggseek_SeektoAbsolutetime( demux_t *p_demux, logical_stream_t *p_stream,
     }
     OggDebug( msg_Dbg( p_demux, "Search bounds set to %"PRId64" %"PRId64" using skeleton index", i_offset_lower, i_offset_upper ) );
 
-    OggNoDebug(
-        OggSeekIndexFind( p_stream, i_time, &i_offset_lower, &i_offset_upper )
-    );
-
     i_offset_lower = __MAX( i_offset_lower, p_stream->i_data_start );
     i_offset_upper = __MIN( i_offset_upper, p_sys->i_total_length );
 
@@ -1014,12 +1050,6 @@ int Oggseek_SeektoAbsolutetime( demux_t *p_demux, logical_stream_t *p_stream,
         ogg_stream_reset( &p_stream->os );
         seek_byte( p_demux, p_sys->i_input_position );
     }
-    /* Insert keyframe position into index */
-    OggNoDebug(
-    if ( i_pagepos >= p_stream->i_data_start )
-        OggSeek_IndexAdd( p_stream, i_time, i_pagepos )
-    );
-
     OggDebug( msg_Dbg( p_demux, "=================== Seeked To %"PRId64" time %"PRId64, i_pagepos, i_time ) );
     return i_pagepos;
 }
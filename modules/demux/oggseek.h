@@ -29,11 +29,10 @@
 #define PAGE_HEADER_BYTES 27
 
 #define OGGSEEK_BYTES_TO_READ 8500
+#define OGGSEEK_ALIGN 4096 /* power of 2 */
 
-/* index entries are structured as follows:
- *   - for theora, highest granulepos -> pagepos (bytes) where keyframe begins
- *  - for dirac, kframe (sync point) -> pagepos of sequence start (?)
- */
+/* index entries are the pages met while seeking, kept across seeks to
+ * narrow the next searches: page time -> pagepos (bytes) */
 
 /* this is typedefed to demux_index_entry_t in ogg.h */
 struct oggseek_index_entry
@@ -41,9 +40,10 @@ struct oggseek_index_entry
     demux_index_entry_t *p_next;
     demux_index_entry_t *p_prev;
 
-    /* value is highest granulepos for theora, sync frame for dirac */
+    /* time of the last complete packet of the page */
     int64_t i_value;
     int64_t i_pagepos;
+    int64_t i_granule;
 
     /* not used for theora because the granulepos tells us this */
     int64_t i_pagepos_end;
@@ -57,7 +57,7 @@ int64_t Oggseek_GranuleToAbsTimestamp ( logical_stream_t *p_stream, int64_t i_gr
 int     Oggseek_BlindSeektoAbsoluteTime ( demux_t *, logical_stream_t *, int64_t, bool );
 int     Oggseek_BlindSeektoPosition ( demux_t *, logical_stream_t *, double f, bool );
 int     Oggseek_SeektoAbsolutetime ( demux_t *, logical_stream_t *, int64_t i_granulepos );
-const demux_index_entry_t *OggSeek_IndexAdd ( logical_stream_t *, int64_t, int64_t );
+const demux_index_entry_t *OggSeek_IndexAdd ( logical_stream_t *, int64_t, int64_t, int64_t );
 void    Oggseek_ProbeEnd( demux_t * );
 
 void oggseek_index_entries_free ( demux_index_entry_t * );
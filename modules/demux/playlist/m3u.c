@@ -172,6 +172,7 @@ static int Demux( demux_t *p_demux )
     int        i_options = 0;
     bool b_cleanup = false;
     input_item_t *p_input;
+    mtime_t    i_next_post = mdate() + PLAYLIST_POST_INTERVAL;
 
     input_item_t *p_current_input = GetCurrentItem(p_demux);
     input_item_node_t *p_subitems = input_item_node_Create( p_current_input );
@@ -268,6 +269,13 @@ static int Demux( demux_t *p_demux )
 
             input_item_node_AppendItem( p_subitems, p_input );
             vlc_gc_decref( p_input );
+
+            /* Show the items of long playlists as they come */
+            if( mdate() >= i_next_post )
+            {
+                input_item_node_PostPartial( p_subitems );
+                i_next_post = mdate() + PLAYLIST_POST_INTERVAL;
+            }
         }
 
  error:
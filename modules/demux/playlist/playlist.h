@@ -86,6 +86,9 @@ extern input_item_t * GetCurrentItem(demux_t *p_demux);
 
 bool CheckContentType( stream_t * p_stream, const char * psz_ctype );
 
+/* Minimum delay between two partial posts of the items of a long playlist */
+#define PLAYLIST_POST_INTERVAL (CLOCK_FREQ / 4)
+
 #define STANDARD_DEMUX_INIT_MSG( msg ) do { \
     DEMUX_INIT_COMMON();                    \
     msg_Dbg( p_demux, "%s", msg ); } while(0)
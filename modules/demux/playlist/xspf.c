@@ -300,6 +300,7 @@ static bool parse_tracklist_node COMPLEX_INTERFACE
     const char *name;
     unsigned i_ntracks = 0;
     int i_node;
+    mtime_t i_next_post = mdate() + PLAYLIST_POST_INTERVAL;
 
     /* now parse the <track>s */
     while ((i_node = xml_ReaderNextNode(p_xml_reader, &name)) > 0)
@@ -316,6 +317,14 @@ static bool parse_tracklist_node COMPLEX_INTERFACE
             /* parse the track data in a separate function */
             if (parse_track_node(p_demux, p_input_node, p_xml_reader, "track"))
                 i_ntracks++;
+
+            /* Show the tracks of long playlists as they come; the tracks with
+             * an identifier wait for the extension which lays them out */
+            if (mdate() >= i_next_post)
+            {
+                input_item_node_PostPartial(p_input_node);
+                i_next_post = mdate() + PLAYLIST_POST_INTERVAL;
+            }
         }
         else if (i_node == XML_READER_ENDELEM)
             break;
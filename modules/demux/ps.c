@@ -34,6 +34,7 @@
 #include <vlc_demux.h>
 
 #include "ps.h"
+#include "seek_index.h"
 
 /* TODO:
  *  - re-add pre-scanning.
@@ -45,6 +46,12 @@
     "to calculate position and duration. However sometimes this might not " \
     "be usable. Disable this option to calculate from the bitrate instead." )
 
+#define SEEK_INDEX_TEXT N_("Keep a seek index")
+#define SEEK_INDEX_LONGTEXT N_( \
+    "Store the positions of the key frames found in local files in the " \
+    "cache directory, and complete them in the background, so that the " \
+    "file does not have to be probed on next openings and seeks are faster." )
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -64,6 +71,7 @@ vlc_module_begin ()
     add_bool( "ps-trust-timestamps", true, TIME_TEXT,
                  TIME_LONGTEXT, true )
         change_safe ()
+    add_bool( "ps-seek-index", false, SEEK_INDEX_TEXT, SEEK_INDEX_LONGTEXT, true )
 
     add_submodule ()
     set_description( N_("MPEG-PS demuxer") )
@@ -90,17 +98,31 @@ struct demux_sys_t
 
     int         i_aob_mlp_count;
 
+    /* Seek index of the packs starting a key frame */
+    seek_index_t *p_index;
+    int64_t     i_pack_pos;   /* position of the current pack, or -1 */
+    int64_t     i_pack_scr;
+    vlc_fourcc_t i_key_codec; /* video codec the key frames are found in */
+    vlc_fourcc_t i_scan_codec;
+    int         i_scan_wait;  /* packets before starting the scanner */
+
     bool  b_lost_sync;
     bool  b_have_pack;
     bool  b_seekable;
 };
 
 static int Demux  ( demux_t *p_demux );
+static void SeekIndexStartScan( demux_t *p_demux );
 static int Control( demux_t *p_demux, int i_query, va_list args );
 
 static int      ps_pkt_resynch( stream_t *, uint32_t *pi_code );
 static block_t *ps_pkt_read   ( stream_t *, uint32_t i_code );
 
+static void SeekIndexInit ( demux_t *p_demux );
+static void SeekIndexClean( demux_t *p_demux );
+static void SeekIndexPacket( demux_t *p_demux, ps_track_t *tk, block_t *p_pkt );
+static int  SeekIndexSeek ( demux_t *p_demux, mtime_t i_time );
+
 /*****************************************************************************
  * Open
  *****************************************************************************/
@@ -151,6 +173,8 @@ static int OpenCommon( vlc_object_t *p_this, bool b_force )
     ps_psm_init( &p_sys->psm );
     ps_track_init( p_sys->tk );
 
+    SeekIndexInit( p_demux );
+
     /* TODO prescanning of ES */
 
     return VLC_SUCCESS;
@@ -185,6 +209,7 @@ static void Close( vlc_object_t *p_this )
         }
     }
 
+    SeekIndexClean( p_demux );
     ps_psm_destroy( &p_sys->psm );
 
     free( p_sys );
@@ -311,6 +336,8 @@ static int Demux( demux_t *p_demux )
     if( p_sys->i_length < 0 && p_sys->b_seekable )
         FindLength( p_demux );
 
+    const int64_t i_pos = p_sys->p_index ? stream_Tell( p_demux->s ) : -1;
+
     if( ( p_pkt = ps_pkt_read( p_demux->s, i_code ) ) == NULL )
     {
         return 0;
@@ -325,6 +352,8 @@ static int Demux( demux_t *p_demux )
     case 0x1ba:
         if( !ps_pkt_parse_pack( p_pkt, &p_sys->i_scr, &i_mux_rate ) )
         {
+            p_sys->i_pack_pos = i_pos;
+            p_sys->i_pack_scr = p_sys->i_scr;
             p_sys->i_last_scr = p_sys->i_scr;
             if( !p_sys->b_have_pack ) p_sys->b_have_pack = true;
             /* done later on to work around bad vcd/svcd streams */
@@ -400,6 +429,7 @@ static int Demux( demux_t *p_demux )
             {
                 p_sys->i_scr = -1;
                 p_sys->i_last_scr = -1;
+                p_sys->i_pack_pos = -1;
             }
 
             if( p_sys->i_scr >= 0 )
@@ -431,6 +461,7 @@ static int Demux( demux_t *p_demux )
                     p_sys->i_current_pts = (int64_t)p_pkt->i_pts;
                 }
 
+                SeekIndexPacket( p_demux, tk, p_pkt );
                 es_out_Send( p_demux->out, tk->es, p_pkt );
             }
             else
@@ -445,6 +476,9 @@ static int Demux( demux_t *p_demux )
         break;
     }
 
+    if( p_sys->i_scan_wait > 0 )
+        SeekIndexStartScan( p_demux );
+
     demux_UpdateTitleFromStream( p_demux );
     return 1;
 }
@@ -479,6 +513,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             i64 = stream_Size( p_demux->s );
             p_sys->i_current_pts = 0;
             p_sys->i_last_scr = -1;
+            p_sys->i_pack_pos = -1;
 
             return stream_Seek( p_demux->s, (int64_t)(i64 * f) );
 
@@ -516,6 +551,9 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_SET_TIME:
             i64 = (int64_t)va_arg( args, int64_t );
+            if( p_sys->i_time_track >= 0 && !SeekIndexSeek( p_demux, i64 ) )
+                return VLC_SUCCESS;
+
             if( p_sys->i_time_track >= 0 && p_sys->i_current_pts > 0 )
             {
                 int64_t i_now = p_sys->i_current_pts - p_sys->tk[p_sys->i_time_track].i_first_pts;
@@ -526,6 +564,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
                 p_sys->i_current_pts = 0;
                 p_sys->i_last_scr = -1;
+                p_sys->i_pack_pos = -1;
                 i_pos *= (float)i64 / (float)i_now;
                 stream_Seek( p_demux->s, i_pos );
                 return VLC_SUCCESS;
@@ -543,9 +582,11 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         }
 
         case DEMUX_SET_TITLE:
+            p_sys->i_pack_pos = -1;
             return stream_vaControl( p_demux->s, STREAM_SET_TITLE, args );
 
         case DEMUX_SET_SEEKPOINT:
+            p_sys->i_pack_pos = -1;
             return stream_vaControl( p_demux->s, STREAM_SET_SEEKPOINT, args );
 
         case DEMUX_GET_META:
@@ -557,6 +598,232 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 }
 
+/*****************************************************************************
+ * Seek index:
+ *****************************************************************************
+ * The packs holding the start of a key frame are indexed by SCR while
+ * playing, and by a background scanner if the index is kept in the cache.
+ *****************************************************************************/
+#define SEEK_INDEX_MAGIC    "VLCPSIX1"
+#define SEEK_INDEX_INTERVAL CLOCK_FREQ
+#define SEEK_INDEX_CHUNK    (512 * 1024)
+/* Packets read before scanning, if no known video codec shows up */
+#define SEEK_INDEX_WAIT     256
+/* Largest delay between the SCR of a pack and the PTS of its payload */
+#define SEEK_INDEX_MARGIN   CLOCK_FREQ
+
+/* Extra data of the side-car file, saving FindLength() */
+typedef struct
+{
+    int64_t  i_length;
+    int32_t  i_time_track;
+    int32_t  i_reserved;
+    int64_t  i_first_pts;
+    int64_t  i_last_pts;
+} ps_seek_index_extra_t;
+
+/* Checks if a start code of the video codec begins a key frame: a sequence
+ * or GOP header for MPEG video, a sequence parameter set for H.264 */
+static bool SeekIndexIsKey( vlc_fourcc_t i_codec, uint8_t i_code )
+{
+    if( i_codec == VLC_CODEC_H264 )
+        return ( i_code & 0x9f ) == 0x07;
+    return i_code == 0xb3 || i_code == 0xb8;
+}
+
+static void SeekIndexInit( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ps_seek_index_extra_t extra;
+
+    p_sys->p_index = NULL;
+    p_sys->i_pack_pos = -1;
+    p_sys->i_pack_scr = -1;
+    p_sys->i_key_codec = 0;
+    p_sys->i_scan_codec = 0;
+    p_sys->i_scan_wait = 0;
+
+    if( !p_sys->b_seekable )
+        return;
+
+    seek_index_t *idx = p_sys->p_index = seek_index_New( SEEK_INDEX_INTERVAL );
+    if( idx == NULL || !var_InheritBool( p_demux, "ps-seek-index" )
+     || !seek_index_SetFile( idx, p_demux->psz_file, "ps-index" ) )
+        return;
+
+    p_sys->i_scan_wait = SEEK_INDEX_WAIT;
+
+    if( !seek_index_Load( idx, SEEK_INDEX_MAGIC, &extra, sizeof( extra ) )
+     || extra.i_time_track < 0 || extra.i_time_track >= PS_TK_COUNT
+     || !var_CreateGetBool( p_demux, "ps-trust-timestamps" ) )
+        return;
+
+    p_sys->i_length = extra.i_length;
+    p_sys->i_time_track = extra.i_time_track;
+    p_sys->tk[extra.i_time_track].i_first_pts = extra.i_first_pts;
+    p_sys->tk[extra.i_time_track].i_last_pts = extra.i_last_pts;
+
+    msg_Dbg( p_demux, "loaded %zu seek points from %s", idx->i_points,
+             idx->psz_path );
+}
+
+static void SeekIndexClean( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    seek_index_t *idx = p_sys->p_index;
+
+    if( idx == NULL )
+        return;
+
+    seek_index_StopScan( idx );
+
+    if( p_sys->i_time_track >= 0 )
+    {
+        const ps_track_t *tk = &p_sys->tk[p_sys->i_time_track];
+        ps_seek_index_extra_t extra = {
+            .i_length = p_sys->i_length,
+            .i_time_track = p_sys->i_time_track,
+            .i_first_pts = tk->i_first_pts,
+            .i_last_pts = tk->i_last_pts,
+        };
+
+        seek_index_Save( VLC_OBJECT(p_demux), idx, SEEK_INDEX_MAGIC,
+                         &extra, sizeof( extra ) );
+    }
+
+    seek_index_Delete( idx );
+    p_sys->p_index = NULL;
+}
+
+/* Indexes the current pack if the packet starts a key frame, or if there is
+ * no video to find key frames in */
+static void SeekIndexPacket( demux_t *p_demux, ps_track_t *tk, block_t *p_pkt )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->p_index == NULL || p_sys->i_pack_pos < 0 )
+        return;
+
+    if( tk->fmt.i_cat == VIDEO_ES && p_sys->i_key_codec == 0 &&
+        ( tk->fmt.i_codec == VLC_CODEC_MPGV ||
+          tk->fmt.i_codec == VLC_CODEC_H264 ) )
+        p_sys->i_key_codec = tk->fmt.i_codec;
+
+    if( p_sys->i_key_codec != 0 )
+    {
+        if( tk->fmt.i_codec != p_sys->i_key_codec )
+            return;
+
+        const uint8_t *p = p_pkt->p_buffer;
+        size_t i;
+
+        for( i = 0; i + 4 <= p_pkt->i_buffer; i++ )
+        {
+            if( p[i] == 0 && p[i+1] == 0 && p[i+2] == 1 &&
+                SeekIndexIsKey( p_sys->i_key_codec, p[i+3] ) )
+                break;
+        }
+        if( i + 4 > p_pkt->i_buffer )
+            return;
+    }
+
+    seek_index_Add( p_sys->p_index, p_sys->i_pack_pos, p_sys->i_pack_scr );
+    p_sys->i_pack_pos = -1;
+}
+
+/* Finds the first pack starting a key frame in a chunk of the file */
+static void SeekIndexProbe( demux_t *p_demux, stream_t *s, int64_t i_pos,
+                            uint8_t *p_buf )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const vlc_fourcc_t i_codec = p_sys->i_scan_codec;
+    int64_t i_pack = -1, i_scr = -1;
+    bool b_video = false, b_found = false;
+
+    if( stream_Seek( s, i_pos ) )
+        return;
+
+    int i_read = stream_Read( s, p_buf, SEEK_INDEX_CHUNK );
+
+    for( int i = 0; !b_found && i + 14 <= i_read; i++ )
+    {
+        if( p_buf[i] != 0 || p_buf[i+1] != 0 || p_buf[i+2] != 1 )
+            continue;
+
+        const uint8_t i_code = p_buf[i+3];
+        if( i_code == 0xba )
+        {
+            block_t pack;
+            int i_mux_rate;
+
+            block_Init( &pack, &p_buf[i], i_read - i );
+            if( ps_pkt_parse_pack( &pack, &i_scr, &i_mux_rate ) )
+                continue;
+            i_pack = i_pos + i;
+            b_video = false;
+            b_found = i_codec == 0;
+        }
+        else if( i_code >= 0xe0 && i_code <= 0xef )
+            b_video = true;
+        else if( i_pack >= 0 && b_video )
+            b_found = SeekIndexIsKey( i_codec, i_code );
+    }
+
+    if( b_found )
+        seek_index_Add( p_sys->p_index, i_pack, i_scr );
+}
+
+/* Starts the scanner once the video codec is known, or after a while without
+ * video */
+static void SeekIndexStartScan( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->i_key_codec == 0 && --p_sys->i_scan_wait > 0 )
+        return;
+
+    p_sys->i_scan_wait = 0;
+    p_sys->i_scan_codec = p_sys->i_key_codec;
+    seek_index_StartScan( p_demux, p_sys->p_index, SeekIndexProbe,
+                          SEEK_INDEX_CHUNK, 2048 );
+}
+
+/* Jumps to the indexed key frame before the time, or in between the closest
+ * known packs */
+static int SeekIndexSeek( demux_t *p_demux, mtime_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const ps_track_t *tk = &p_sys->tk[p_sys->i_time_track];
+    seek_point_t before = { -1, -1 }, after = { -1, -1 };
+    const mtime_t i_scr = tk->i_first_pts - VLC_TS_0 + i_time - SEEK_INDEX_MARGIN;
+    int64_t i_pos;
+
+    seek_index_Lookup( p_sys->p_index, i_scr, &before, &after );
+    if( before.i_pos < 0 )
+        return VLC_EGENERIC;
+
+    /* Points are an interval apart at least, plus up to a GOP */
+    const bool b_exact = i_scr - before.i_time <= 2 * SEEK_INDEX_INTERVAL;
+    if( b_exact )
+        i_pos = before.i_pos;
+    else if( after.i_pos > before.i_pos && after.i_time > before.i_time )
+        i_pos = before.i_pos + ( after.i_pos - before.i_pos ) *
+                (double)( i_scr - before.i_time ) / ( after.i_time - before.i_time );
+    else
+        return VLC_EGENERIC;
+
+    if( stream_Seek( p_demux->s, i_pos ) )
+        return VLC_EGENERIC;
+
+    p_sys->i_current_pts = 0;
+    p_sys->i_last_scr = -1;
+    p_sys->i_pack_pos = -1;
+    if( b_exact )
+        es_out_Control( p_demux->out, ES_OUT_SET_NEXT_DISPLAY_TIME,
+                        tk->i_first_pts + i_time );
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
  * Divers:
  *****************************************************************************/
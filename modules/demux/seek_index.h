@@ -0,0 +1,401 @@
+/*****************************************************************************
+ * seek_index.h: timestamp positions index for the MPEG demuxers
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_DEMUX_SEEK_INDEX_H
+#define VLC_DEMUX_SEEK_INDEX_H
+
+#include <errno.h>
+#include <sys/stat.h>
+
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+
+/*
+ * Positions of the clock references (PCR, SCR) of a file, so that seeking is
+ * a single read once the area was played, sought or scanned. The index can
+ * survive in a side-car file of the user cache directory, and be completed
+ * from a second stream by a background thread.
+ */
+
+/* Number of positions probed by the background scanner */
+#define SEEK_INDEX_PROBES 1024
+
+/* Known position of a clock reference */
+typedef struct
+{
+    int64_t i_pos;
+    mtime_t i_time; /* in the unit of the demuxer, growing */
+} seek_point_t;
+
+/* Finds the first clock reference in a chunk of the file, read from the
+ * given stream into the buffer, and adds it to the index */
+typedef void (*seek_index_probe_cb)( demux_t *, stream_t *, int64_t i_pos,
+                                     uint8_t *p_buf );
+
+typedef struct
+{
+    vlc_mutex_t   lock;
+    seek_point_t *p_points; /* sorted by position */
+    size_t        i_points;
+    size_t        i_alloc;
+    mtime_t       i_interval; /* minimum time between two points */
+    bool          b_dirty;
+    bool          b_complete; /* scanned through */
+
+    /* Side-car file, and the file state it is valid for */
+    char         *psz_path;
+    int64_t       i_size;
+    int64_t       i_mtime;
+
+    /* Background scanner */
+    bool          b_scanner;
+    vlc_thread_t  scanner;
+    demux_t      *p_demux;
+    seek_index_probe_cb pf_probe;
+    int           i_chunk;
+    int           i_align;
+} seek_index_t;
+
+/* Side-car file header, in host byte order. It is followed by the extra
+ * data of the demuxer, then by the points. */
+typedef struct
+{
+    char     magic[8];
+    int64_t  i_size;
+    int64_t  i_mtime;
+    uint64_t i_extra;
+    uint32_t b_complete;
+    uint32_t i_reserved;
+    uint64_t i_points;
+} seek_index_header_t;
+
+static inline seek_index_t *seek_index_New( mtime_t i_interval )
+{
+    seek_index_t *idx = malloc( sizeof( *idx ) );
+
+    if( unlikely(idx == NULL) )
+        return NULL;
+
+    vlc_mutex_init( &idx->lock );
+    idx->p_points = NULL;
+    idx->i_points = 0;
+    idx->i_alloc = 0;
+    idx->i_interval = i_interval;
+    idx->b_dirty = false;
+    idx->b_complete = false;
+    idx->psz_path = NULL;
+    idx->i_size = 0;
+    idx->i_mtime = 0;
+    idx->b_scanner = false;
+    return idx;
+}
+
+static inline void seek_index_StopScan( seek_index_t *idx )
+{
+    if( idx->b_scanner )
+    {
+        vlc_cancel( idx->scanner );
+        vlc_join( idx->scanner, NULL );
+        idx->b_scanner = false;
+    }
+}
+
+static inline void seek_index_Delete( seek_index_t *idx )
+{
+    seek_index_StopScan( idx );
+    free( idx->psz_path );
+    free( idx->p_points );
+    vlc_mutex_destroy( &idx->lock );
+    free( idx );
+}
+
+/* Returns the index of the first point at or after i_pos */
+static inline size_t seek_index_Bisect( const seek_index_t *idx, int64_t i_pos )
+{
+    size_t lo = 0, hi = idx->i_points;
+
+    while( lo < hi )
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if( idx->p_points[mid].i_pos < i_pos )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static inline void seek_index_Add( seek_index_t *idx, int64_t i_pos,
+                                   mtime_t i_time )
+{
+    if( idx == NULL || i_pos < 0 )
+        return;
+
+    vlc_mutex_lock( &idx->lock );
+    size_t i = seek_index_Bisect( idx, i_pos );
+
+    if( ( i > 0 && i_time - idx->p_points[i-1].i_time < idx->i_interval )
+     || ( i < idx->i_points
+       && idx->p_points[i].i_time - i_time < idx->i_interval ) )
+        goto out;
+
+    if( idx->i_points == idx->i_alloc )
+    {
+        size_t i_alloc = idx->i_alloc ? 2 * idx->i_alloc : 256;
+        seek_point_t *p_points = realloc( idx->p_points,
+                                          i_alloc * sizeof( *p_points ) );
+        if( unlikely(p_points == NULL) )
+            goto out;
+        idx->p_points = p_points;
+        idx->i_alloc = i_alloc;
+    }
+
+    memmove( &idx->p_points[i + 1], &idx->p_points[i],
+             ( idx->i_points - i ) * sizeof( *idx->p_points ) );
+    idx->p_points[i].i_pos = i_pos;
+    idx->p_points[i].i_time = i_time;
+    idx->i_points++;
+    idx->b_dirty = true;
+out:
+    vlc_mutex_unlock( &idx->lock );
+}
+
+/* Finds the last known point before the target time, and the first one
+ * after it. Either is left untouched if there are none. */
+static inline void seek_index_Lookup( seek_index_t *idx, mtime_t i_time,
+                                      seek_point_t *p_before,
+                                      seek_point_t *p_after )
+{
+    if( idx == NULL )
+        return;
+
+    vlc_mutex_lock( &idx->lock );
+    /* The clock grows with the position, except on discontinuities */
+    size_t lo = 0, hi = idx->i_points;
+    while( lo < hi )
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if( idx->p_points[mid].i_time <= i_time )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if( lo > 0 )
+        *p_before = idx->p_points[lo - 1];
+    if( lo < idx->i_points )
+        *p_after = idx->p_points[lo];
+    vlc_mutex_unlock( &idx->lock );
+}
+
+/* Prepares the side-car file of a local file, in the given sub-directory of
+ * the cache directory. Returns false if there can be none. */
+static inline bool seek_index_SetFile( seek_index_t *idx, const char *psz_file,
+                                       const char *psz_subdir )
+{
+    struct md5_s md5;
+    struct stat st;
+
+    if( psz_file == NULL || vlc_stat( psz_file, &st ) )
+        return false;
+
+    InitMD5( &md5 );
+    AddMD5( &md5, psz_file, strlen( psz_file ) );
+    EndMD5( &md5 );
+
+    char *psz_hash = psz_md5_hash( &md5 );
+    char *psz_dir = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_hash == NULL || psz_dir == NULL
+     || asprintf( &idx->psz_path, "%s"DIR_SEP"%s"DIR_SEP"%s", psz_dir,
+                  psz_subdir, psz_hash ) == -1 )
+        idx->psz_path = NULL;
+    free( psz_dir );
+    free( psz_hash );
+
+    idx->i_size = st.st_size;
+    idx->i_mtime = st.st_mtime;
+    return idx->psz_path != NULL;
+}
+
+/* Loads the side-car file, if it matches the file state, its magic and the
+ * size of the extra data of the demuxer */
+static inline bool seek_index_Load( seek_index_t *idx, const char *psz_magic,
+                                    void *p_extra, size_t i_extra )
+{
+    seek_index_header_t hdr;
+    bool b_ok = false;
+
+    if( idx->psz_path == NULL )
+        return false;
+
+    FILE *file = vlc_fopen( idx->psz_path, "rb" );
+    if( file == NULL )
+        return false;
+
+    if( fread( &hdr, sizeof( hdr ), 1, file ) != 1
+     || memcmp( hdr.magic, psz_magic, 8 )
+     || hdr.i_size != idx->i_size || hdr.i_mtime != idx->i_mtime
+     || hdr.i_extra != i_extra
+     || hdr.i_points > SIZE_MAX / sizeof( seek_point_t ) )
+        goto out;
+
+    seek_point_t *p_points = malloc( hdr.i_points * sizeof( *p_points ) );
+    if( p_points == NULL
+     || fread( p_extra, 1, i_extra, file ) != i_extra
+     || fread( p_points, sizeof( *p_points ), hdr.i_points, file ) != hdr.i_points )
+    {
+        free( p_points );
+        goto out;
+    }
+
+    vlc_mutex_lock( &idx->lock );
+    free( idx->p_points );
+    idx->p_points = p_points;
+    idx->i_points = idx->i_alloc = hdr.i_points;
+    idx->b_complete = hdr.b_complete;
+    vlc_mutex_unlock( &idx->lock );
+    b_ok = true;
+out:
+    fclose( file );
+    return b_ok;
+}
+
+static inline void seek_index_Save( vlc_object_t *obj, seek_index_t *idx,
+                                    const char *psz_magic,
+                                    const void *p_extra, size_t i_extra )
+{
+    seek_index_header_t hdr;
+    char *psz_tmp;
+
+    if( idx->psz_path == NULL || !idx->b_dirty )
+        return;
+
+    /* Make sure the sub-directory exists */
+    char *psz_sep = strrchr( idx->psz_path, DIR_SEP_CHAR );
+    *psz_sep = '\0';
+    vlc_mkdir( idx->psz_path, 0700 );
+    *psz_sep = DIR_SEP_CHAR;
+
+    if( asprintf( &psz_tmp, "%s.tmp", idx->psz_path ) == -1 )
+        return;
+
+    FILE *file = vlc_fopen( psz_tmp, "wb" );
+    if( file == NULL )
+    {
+        msg_Warn( obj, "cannot write seek index %s: %s", psz_tmp,
+                  vlc_strerror_c(errno) );
+        free( psz_tmp );
+        return;
+    }
+
+    memset( &hdr, 0, sizeof( hdr ) );
+    memcpy( hdr.magic, psz_magic, 8 );
+    hdr.i_size = idx->i_size;
+    hdr.i_mtime = idx->i_mtime;
+    hdr.i_extra = i_extra;
+    hdr.b_complete = idx->b_complete;
+    hdr.i_points = idx->i_points;
+
+    bool b_ok =
+        fwrite( &hdr, sizeof( hdr ), 1, file ) == 1
+     && fwrite( p_extra, 1, i_extra, file ) == i_extra
+     && fwrite( idx->p_points, sizeof( *idx->p_points ), idx->i_points,
+                file ) == idx->i_points;
+
+    if( fclose( file ) == 0 && b_ok && !vlc_rename( psz_tmp, idx->psz_path ) )
+        msg_Dbg( obj, "saved %zu seek points to %s", idx->i_points,
+                 idx->psz_path );
+    else
+        vlc_unlink( psz_tmp );
+    free( psz_tmp );
+}
+
+static void seek_index_ScanCleanup( void *data )
+{
+    void **cleanup = data;
+
+    stream_Delete( cleanup[0] );
+    free( cleanup[1] );
+}
+
+/* Background scanner: probes the whole file, in a second stream */
+static void *seek_index_Scan( void *data )
+{
+    seek_index_t *idx = data;
+    demux_t *p_demux = idx->p_demux;
+    char *psz_url;
+    int canc = vlc_savecancel();
+
+    if( asprintf( &psz_url, "%s://%s", p_demux->psz_access,
+                  p_demux->psz_location ) == -1 )
+        return NULL;
+
+    stream_t *s = stream_UrlNew( p_demux, psz_url );
+    free( psz_url );
+    if( s == NULL )
+        return NULL;
+
+    uint8_t *p_buf = malloc( idx->i_chunk );
+    void *cleanup[2] = { s, p_buf };
+    int64_t i_size = stream_Size( s );
+
+    vlc_cleanup_push( seek_index_ScanCleanup, cleanup );
+    for( int i = 1; p_buf != NULL && i < SEEK_INDEX_PROBES; i++ )
+    {
+        int64_t i_pos = i_size / SEEK_INDEX_PROBES * i;
+
+        idx->pf_probe( p_demux, s, i_pos - i_pos % idx->i_align, p_buf );
+
+        /* Yield the I/O to the playback between probes */
+        vlc_restorecancel( canc );
+        msleep( CLOCK_FREQ / 100 );
+        canc = vlc_savecancel();
+    }
+    if( p_buf != NULL )
+    {
+        msg_Dbg( p_demux, "seek index scan completed" );
+        vlc_mutex_lock( &idx->lock );
+        idx->b_complete = true;
+        idx->b_dirty = true;
+        vlc_mutex_unlock( &idx->lock );
+    }
+    vlc_cleanup_run();
+    vlc_restorecancel( canc );
+    return NULL;
+}
+
+/* Starts the background scanner, unless the index is complete or has no
+ * side-car file to be kept in */
+static inline void seek_index_StartScan( demux_t *p_demux, seek_index_t *idx,
+                                         seek_index_probe_cb pf_probe,
+                                         int i_chunk, int i_align )
+{
+    if( idx == NULL || idx->psz_path == NULL || idx->b_complete
+     || idx->b_scanner )
+        return;
+
+    idx->p_demux = p_demux;
+    idx->pf_probe = pf_probe;
+    idx->i_chunk = i_chunk;
+    idx->i_align = i_align > 0 ? i_align : 1;
+    idx->b_scanner = !vlc_clone( &idx->scanner, seek_index_Scan, idx,
+                                 VLC_THREAD_PRIORITY_LOW );
+}
+
+#endif
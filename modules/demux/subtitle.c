@@ -116,14 +116,25 @@ enum
     SUB_TYPE_VTT
 };
 
+/* Files at least this big are indexed, and their text parsed on demand */
+#define SUB_INDEX_MIN_SIZE (1 << 20)
+
 typedef struct
 {
     int     i_line_count;
     int     i_line;
     char    **line;
+
+    /* Indexed mode: the lines are read from the stream, one at a time */
+    stream_t *s;
+    char     *psz_line;
+    uint64_t i_offset; /* of psz_line */
+    bool     b_previous;
+    bool     b_index; /* only the timings are wanted */
 } text_t;
 
 static int  TextLoad( text_t *, stream_t *s );
+static void TextOpen( text_t *, stream_t *s );
 static void TextUnload( text_t * );
 
 typedef struct
@@ -132,6 +143,7 @@ typedef struct
     int64_t i_stop;
 
     char    *psz_text;
+    uint64_t i_offset; /* of the timing line, in indexed mode */
 } subtitle_t;
 
 
@@ -145,6 +157,7 @@ struct demux_sys_t
     int64_t     i_microsecperframe;
 
     char        *psz_header;
+    int         (*pf_read)( demux_t *, subtitle_t*, int );
     int         i_subtitle;
     int         i_subtitles;
     subtitle_t  *subtitle;
@@ -492,10 +505,32 @@ static int Open ( vlc_object_t *p_this )
         }
     }
 
-    msg_Dbg( p_demux, "loading all subtitles..." );
+    p_sys->pf_read = pf_read;
+
+    /* Index the big files instead of loading them, when the entries can be
+     * parsed back one by one */
+    bool b_seekable;
+    if( stream_Control( p_demux->s, STREAM_CAN_SEEK, &b_seekable ) )
+        b_seekable = false;
+
+    if( b_seekable && stream_Size( p_demux->s ) >= SUB_INDEX_MIN_SIZE &&
+        ( p_sys->i_type == SUB_TYPE_SUBRIP ||
+          p_sys->i_type == SUB_TYPE_SUBVIEWER ||
+          p_sys->i_type == SUB_TYPE_SSA1 ||
+          p_sys->i_type == SUB_TYPE_SSA2_4 ||
+          p_sys->i_type == SUB_TYPE_ASS ||
+          p_sys->i_type == SUB_TYPE_VTT ) )
+    {
+        msg_Dbg( p_demux, "indexing all subtitles..." );
+        TextOpen( &p_sys->txt, p_demux->s );
+    }
+    else
+    {
+        msg_Dbg( p_demux, "loading all subtitles..." );
 
-    /* Load the whole file */
-    TextLoad( &p_sys->txt, p_demux->s );
+        /* Load the whole file */
+        TextLoad( &p_sys->txt, p_demux->s );
+    }
 
     /* Parse it */
     for( i_max = 0;; )
@@ -518,10 +553,27 @@ static int Open ( vlc_object_t *p_this )
 
         p_sys->i_subtitles++;
     }
-    /* Unload */
-    TextUnload( &p_sys->txt );
 
-    msg_Dbg(p_demux, "loaded %d subtitles", p_sys->i_subtitles );
+    if( p_sys->txt.s != NULL )
+    {
+        /* Keep only the index */
+        p_sys->txt.b_index = false;
+        if( p_sys->i_subtitles > 0 )
+        {
+            subtitle_t *p_index = realloc( p_sys->subtitle,
+                                    sizeof(subtitle_t) * p_sys->i_subtitles );
+            if( p_index != NULL )
+                p_sys->subtitle = p_index;
+        }
+        msg_Dbg(p_demux, "indexed %d subtitles", p_sys->i_subtitles );
+    }
+    else
+    {
+        /* Unload */
+        TextUnload( &p_sys->txt );
+
+        msg_Dbg(p_demux, "loaded %d subtitles", p_sys->i_subtitles );
+    }
 
     /* Fix subtitle (order and time) *** */
     p_sys->i_subtitle = 0;
@@ -534,14 +586,14 @@ static int Open ( vlc_object_t *p_this )
             p_sys->i_length = p_sys->subtitle[p_sys->i_subtitles-1].i_start+1;
     }
 
+    /* The seeks search the start dates */
+    Fix( p_demux );
+
     /* *** add subtitle ES *** */
     if( p_sys->i_type == SUB_TYPE_SSA1 ||
              p_sys->i_type == SUB_TYPE_SSA2_4 ||
              p_sys->i_type == SUB_TYPE_ASS )
-    {
-        Fix( p_demux );
         es_format_Init( &fmt, SPU_ES, VLC_CODEC_SSA );
-    }
     else
         es_format_Init( &fmt, SPU_ES, VLC_CODEC_SUBT );
 
@@ -586,10 +638,32 @@ static void Close( vlc_object_t *p_this )
         free( p_sys->subtitle[i].psz_text );
     free( p_sys->subtitle );
     free( p_sys->psz_header );
+    if( p_sys->txt.s != NULL )
+        TextUnload( &p_sys->txt );
 
     free( p_sys );
 }
 
+/*****************************************************************************
+ * Search: find the first subtitle starting after a date
+ *****************************************************************************/
+static int Search( demux_sys_t *p_sys, int64_t i_date )
+{
+    int i_low = 0;
+    int i_high = p_sys->i_subtitles;
+
+    while( i_low < i_high )
+    {
+        int i_mid = ( i_low + i_high ) / 2;
+
+        if( p_sys->subtitle[i_mid].i_start > i_date )
+            i_high = i_mid;
+        else
+            i_low = i_mid + 1;
+    }
+    return i_low;
+}
+
 /*****************************************************************************
  * Control:
  *****************************************************************************/
@@ -617,17 +691,16 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_SET_TIME:
             i64 = (int64_t)va_arg( args, int64_t );
-            p_sys->i_subtitle = 0;
-            while( p_sys->i_subtitle < p_sys->i_subtitles )
+            p_sys->i_subtitle = Search( p_sys, i64 );
+            /* Go back to the subtitles still displayed at that time */
+            while( p_sys->i_subtitle > 0 )
             {
-                const subtitle_t *p_subtitle = &p_sys->subtitle[p_sys->i_subtitle];
+                const subtitle_t *p_subtitle = &p_sys->subtitle[p_sys->i_subtitle - 1];
 
-                if( p_subtitle->i_start > i64 )
-                    break;
-                if( p_subtitle->i_stop > p_subtitle->i_start && p_subtitle->i_stop > i64 )
+                if( p_subtitle->i_stop <= p_subtitle->i_start || p_subtitle->i_stop <= i64 )
                     break;
 
-                p_sys->i_subtitle++;
+                p_sys->i_subtitle--;
             }
 
             if( p_sys->i_subtitle >= p_sys->i_subtitles )
@@ -655,12 +728,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             f = (double)va_arg( args, double );
             i64 = f * p_sys->i_length;
 
-            p_sys->i_subtitle = 0;
-            while( p_sys->i_subtitle < p_sys->i_subtitles &&
-                   p_sys->subtitle[p_sys->i_subtitle].i_start < i64 )
-            {
-                p_sys->i_subtitle++;
-            }
+            p_sys->i_subtitle = Search( p_sys, i64 - 1 );
             if( p_sys->i_subtitle >= p_sys->i_subtitles )
                 return VLC_EGENERIC;
             return VLC_SUCCESS;
@@ -684,6 +752,22 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 }
 
+/*****************************************************************************
+ * GetIndexedText: parse the text of a subtitle of an indexed file
+ *****************************************************************************/
+static char *GetIndexedText( demux_t *p_demux, int i_subtitle )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    subtitle_t subtitle;
+
+    p_sys->txt.b_previous = false;
+    if( stream_Seek( p_demux->s, p_sys->subtitle[i_subtitle].i_offset ) ||
+        p_sys->pf_read( p_demux, &subtitle, i_subtitle ) )
+        return NULL;
+
+    return subtitle.psz_text;
+}
+
 /*****************************************************************************
  * Demux: Send subtitle to decoder
  *****************************************************************************/
@@ -706,18 +790,33 @@ static int Demux( demux_t *p_demux )
            p_sys->subtitle[p_sys->i_subtitle].i_start < i_maxdate )
     {
         const subtitle_t *p_subtitle = &p_sys->subtitle[p_sys->i_subtitle];
+        char *psz_text = p_subtitle->psz_text;
 
-        block_t *p_block;
-        int i_len = strlen( p_subtitle->psz_text ) + 1;
-
-        if( i_len <= 1 || p_subtitle->i_start < 0 )
+        if( p_subtitle->i_start < 0 )
         {
             p_sys->i_subtitle++;
             continue;
         }
 
-        if( ( p_block = block_Alloc( i_len ) ) == NULL )
+        if( p_sys->txt.s != NULL )
         {
+            psz_text = GetIndexedText( p_demux, p_sys->i_subtitle );
+            if( psz_text == NULL )
+            {
+                p_sys->i_subtitle++;
+                continue;
+            }
+        }
+
+        block_t *p_block = NULL;
+        int i_len = strlen( psz_text ) + 1;
+
+        if( i_len > 1 )
+            p_block = block_Alloc( i_len );
+        if( p_block == NULL )
+        {
+            if( p_sys->txt.s != NULL )
+                free( psz_text );
             p_sys->i_subtitle++;
             continue;
         }
@@ -727,7 +826,9 @@ static int Demux( demux_t *p_demux )
         if( p_subtitle->i_stop >= 0 && p_subtitle->i_stop >= p_subtitle->i_start )
             p_block->i_length = p_subtitle->i_stop - p_subtitle->i_start;
 
-        memcpy( p_block->p_buffer, p_subtitle->psz_text, i_len );
+        memcpy( p_block->p_buffer, psz_text, i_len );
+        if( p_sys->txt.s != NULL )
+            free( psz_text );
 
         es_out_Send( p_demux->out, p_sys->es, p_block );
 
@@ -784,6 +885,8 @@ static int TextLoad( text_t *txt, stream_t *s )
     i_line_max          = 500;
     txt->i_line_count   = 0;
     txt->i_line         = 0;
+    txt->s              = NULL;
+    txt->b_index        = false;
     txt->line           = calloc( i_line_max, sizeof( char * ) );
     if( !txt->line )
         return VLC_ENOMEM;
@@ -814,10 +917,30 @@ static int TextLoad( text_t *txt, stream_t *s )
 
     return VLC_SUCCESS;
 }
+/* Reads the lines from the stream as the parsers ask for them */
+static void TextOpen( text_t *txt, stream_t *s )
+{
+    txt->i_line_count   = 0;
+    txt->i_line         = 0;
+    txt->line           = NULL;
+    txt->s              = s;
+    txt->psz_line       = NULL;
+    txt->i_offset       = 0;
+    txt->b_previous     = false;
+    txt->b_index        = true;
+}
 static void TextUnload( text_t *txt )
 {
     int i;
 
+    if( txt->s != NULL )
+    {
+        free( txt->psz_line );
+        txt->psz_line = NULL;
+        txt->s = NULL;
+        return;
+    }
+
     for( i = 0; i < txt->i_line_count; i++ )
     {
         free( txt->line[i] );
@@ -829,6 +952,19 @@ static void TextUnload( text_t *txt )
 
 static char *TextGetLine( text_t *txt )
 {
+    if( txt->s != NULL )
+    {
+        if( txt->b_previous )
+        {
+            txt->b_previous = false;
+            return txt->psz_line;
+        }
+        free( txt->psz_line );
+        txt->i_offset = stream_Tell( txt->s );
+        txt->psz_line = stream_ReadLine( txt->s );
+        return txt->psz_line;
+    }
+
     if( txt->i_line >= txt->i_line_count )
         return( NULL );
 
@@ -836,10 +972,23 @@ static char *TextGetLine( text_t *txt )
 }
 static void TextPreviousLine( text_t *txt )
 {
-    if( txt->i_line > 0 )
+    if( txt->s != NULL )
+        txt->b_previous = txt->psz_line != NULL;
+    else if( txt->i_line > 0 )
         txt->i_line--;
 }
 
+/* Skips the text of an entry while indexing, up to an empty line */
+static int TextSkipEntry( text_t *txt, subtitle_t *p_subtitle )
+{
+    const char *s;
+
+    while( ( s = TextGetLine( txt ) ) != NULL && *s != '\0' );
+
+    p_subtitle->psz_text = NULL;
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
  * Specific Subtitle function
  *****************************************************************************/
@@ -934,10 +1083,14 @@ static int ParseSubRipSubViewer( demux_t *p_demux, subtitle_t *p_subtitle,
         if( pf_parse_timing( p_subtitle, s) == VLC_SUCCESS &&
             p_subtitle->i_start < p_subtitle->i_stop )
         {
+            p_subtitle->i_offset = txt->i_offset;
             break;
         }
     }
 
+    if( txt->b_index )
+        return TextSkipEntry( txt, p_subtitle );
+
     /* Now read text until an empty line */
     psz_text = strdup("");
     if( !psz_text )
@@ -1150,6 +1303,12 @@ static int  ParseSSA( demux_t *p_demux, subtitle_t *p_subtitle,
                                     (int64_t)m2 * 60*1000 +
                                     (int64_t)s2 * 1000 +
                                     (int64_t)c2 * 10 ) * 1000;
+            p_subtitle->i_offset = txt->i_offset;
+            if( txt->b_index )
+            {
+                free( psz_text );
+                psz_text = NULL;
+            }
             p_subtitle->psz_text = psz_text;
             return VLC_SUCCESS;
         }
@@ -2203,10 +2362,16 @@ static int  ParseVTT( demux_t *p_demux, subtitle_t *p_subtitle, int i_idx )
                                     (int64_t)s2 * 1000 +
                                     (int64_t)d2 ) * 1000;
             if( p_subtitle->i_start < p_subtitle->i_stop )
+            {
+                p_subtitle->i_offset = txt->i_offset;
                 break;
+            }
         }
     }
 
+    if( txt->b_index )
+        return TextSkipEntry( txt, p_subtitle );
+
     /* Now read text until an empty line */
     psz_text = strdup("");
     if( !psz_text )
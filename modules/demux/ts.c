@@ -44,6 +44,7 @@
 #include <vlc_bits.h>
 
 #include "../mux/mpeg/csa.h"
+#include "seek_index.h"
 
 /* Include dvbpsi headers */
 # include <dvbpsi/dvbpsi.h>
@@ -152,6 +153,18 @@ static const int const arib_mode_list[] =
 static const char *const arib_mode_list_text[] =
   { N_("Auto"), N_("Enabled"), N_("Disabled") };
 
+#define PES_THREADS_TEXT N_("PES worker threads")
+#define PES_THREADS_LONGTEXT N_( \
+    "Number of threads reassembling elementary stream packets in parallel " \
+    "with the demultiplexing. Zero reassembles them in the demuxer thread, " \
+    "and is recommended unless demuxing large multiplexes." )
+
+#define SEEK_INDEX_TEXT N_("Keep a seek index")
+#define SEEK_INDEX_LONGTEXT N_( \
+    "Store the positions of the PCR found in local files in the cache " \
+    "directory, and complete them in the background, so that the file " \
+    "does not have to be probed on next openings and seeks are faster." )
+
 #define SUPPORT_ARIB_TEXT N_("ARIB STD-B24 mode")
 #define SUPPORT_ARIB_LONGTEXT N_( \
     "Forces ARIB STD-B24 mode for decoding characters." \
@@ -179,10 +192,14 @@ vlc_module_begin ()
 
     add_bool( "ts-split-es", true, SPLIT_ES_TEXT, SPLIT_ES_LONGTEXT, false )
     add_bool( "ts-seek-percent", false, SEEK_PERCENT_TEXT, SEEK_PERCENT_LONGTEXT, true )
+    add_bool( "ts-seek-index", false, SEEK_INDEX_TEXT, SEEK_INDEX_LONGTEXT, true )
 
     add_integer( "ts-arib", ARIBMODE_AUTO, SUPPORT_ARIB_TEXT, SUPPORT_ARIB_LONGTEXT, false )
         change_integer_list( arib_mode_list, arib_mode_list_text )
 
+    add_integer_with_range( "ts-pes-threads", 0, 0, 16, PES_THREADS_TEXT,
+                            PES_THREADS_LONGTEXT, true )
+
     add_obsolete_bool( "ts-silent" );
 
     set_capability( "demux", 10 )
@@ -319,6 +336,30 @@ typedef struct
     int i_service;
 } vdr_info_t;
 
+/* A gathered PES waiting for, or parsed by, a worker thread */
+typedef struct ts_pes_job_t
+{
+    struct ts_pes_job_t *p_next;
+    ts_pid_t    *pid;
+    block_t     *p_data; /* gathered PES, then parsed blocks */
+    bool         b_done;
+} ts_pes_job_t;
+
+typedef struct
+{
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait; /* a job was queued */
+    vlc_cond_t    done; /* a job was parsed */
+
+    /* Jobs are sent in the order they were queued */
+    ts_pes_job_t  *p_first;
+    ts_pes_job_t **pp_last;
+    ts_pes_job_t  *p_todo; /* first job not taken by a worker yet */
+
+    int           i_threads;
+    vlc_thread_t  threads[];
+} ts_pes_workers_t;
+
 #define MIN_ES_PID 32
 #define MAX_ES_PID 8190
 
@@ -337,6 +378,14 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     int         i_ts_read;
 
+    /* TS packets read in bulk by Demux() but not parsed yet */
+    struct
+    {
+        uint8_t *p_buffer;
+        size_t   i_offset;
+        size_t   i_length;
+    } bulk;
+
     /* to determine length and time */
     int         i_pid_ref_pcr;
     mtime_t     i_first_pcr;
@@ -347,6 +396,9 @@ struct demux_sys_t
     mtime_t     *p_pcrs;
     int64_t     *p_pos;
 
+    /* PCR positions seen so far (NULL if the stream cannot seek) */
+    seek_index_t *p_seek_index;
+
     struct
     {
         arib_modes_e e_mode;
@@ -405,6 +457,9 @@ struct demux_sys_t
 
     vdr_info_t  vdr;
 
+    /* PES reassembly in parallel (NULL if disabled) */
+    ts_pes_workers_t *pes_workers;
+
     /* */
     bool        b_start_record;
 };
@@ -434,9 +489,16 @@ static inline int PIDGet( block_t *p )
 }
 
 static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk );
+static int  PESWorkersStart( demux_t *p_demux, int i_threads );
+static void PESWorkersStop( demux_t *p_demux );
+static void PESWorkersFlush( demux_t *p_demux, int i_group );
 static void AddAndCreateES( demux_t *p_demux, ts_pid_t *pid );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static block_t* ReadTSPacketBulk( demux_t *p_demux );
+static int64_t TSTell( demux_t *p_demux );
+static void BulkReset( demux_t *p_demux );
+static void BulkDescramble( demux_t *p_demux );
 static int Seek( demux_t *p_demux, double f_percent );
 static void GetFirstPCR( demux_t *p_demux );
 static void GetLastPCR( demux_t *p_demux );
@@ -444,6 +506,11 @@ static void CheckPCR( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, block_t * );
 static void PCRFixHandle( demux_t *, block_t * );
 
+static bool SeekIndexInit( demux_t *p_demux );
+static void SeekIndexStartScan( demux_t *p_demux );
+static void SeekIndexClean( demux_t *p_demux );
+static mtime_t AdjustPCRWrapAroundAt( demux_sys_t *, int64_t i_pos, mtime_t i_pcr );
+
 static void              IODFree( iod_descriptor_t * );
 
 #define TS_USER_PMT_NUMBER (0)
@@ -457,6 +524,9 @@ static void SetPrgFilter( demux_t *, int i_prg, bool b_selected );
 #define TS_PACKET_SIZE_204 204
 #define TS_PACKET_SIZE_MAX 204
 
+/* how many TS packets Demux() reads from the stream at once */
+#define TS_BULK_PACKETS 64
+
 static int DetectPacketSize( demux_t *p_demux, int *pi_header_size, int i_offset )
 {
     const uint8_t *p_peek;
@@ -1153,21 +1223,33 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_pcrs_num = 10;
     p_sys->p_pcrs = (mtime_t *)calloc( p_sys->i_pcrs_num, sizeof( mtime_t ) );
     p_sys->p_pos = (int64_t *)calloc( p_sys->i_pcrs_num, sizeof( int64_t ) );
+    p_sys->bulk.p_buffer = malloc( TS_BULK_PACKETS * p_sys->i_packet_size );
 
     p_sys->arib.e_mode = var_InheritInteger( p_demux, "ts-arib" );
 
-    if( !p_sys->p_pcrs || !p_sys->p_pos )
+    if( !p_sys->p_pcrs || !p_sys->p_pos || !p_sys->bulk.p_buffer )
     {
         Close( p_this );
         return VLC_ENOMEM;
     }
 
+    int i_pes_threads = var_InheritInteger( p_demux, "ts-pes-threads" );
+    if( i_pes_threads > 0 )
+    {
+        if( PESWorkersStart( p_demux, i_pes_threads ) == VLC_SUCCESS )
+            p_sys->i_ts_read = 1000;
+        else
+            msg_Warn( p_demux, "cannot start PES worker threads" );
+    }
+
     bool b_can_fastseek = false;
     stream_Control( p_sys->stream, STREAM_CAN_SEEK, &p_sys->b_canseek );
     stream_Control( p_sys->stream, STREAM_CAN_FASTSEEK, &b_can_fastseek );
     if ( p_sys->b_canseek )
     {
-        if( b_can_fastseek )
+        bool b_indexed = SeekIndexInit( p_demux );
+
+        if( b_can_fastseek && !b_indexed )
         {
             GetFirstPCR( p_demux );
             CheckPCR( p_demux );
@@ -1179,6 +1261,7 @@ static int Open( vlc_object_t *p_this )
             msg_Dbg( p_demux, "Force Seek Per Percent: PCR's not found,");
             p_sys->b_force_seek_per_percent = true;
         }
+        SeekIndexStartScan( p_demux );
     }
 
     while( p_sys->i_pmt_es <= 0 && vlc_object_alive( p_demux )
@@ -1208,6 +1291,9 @@ static void Close( vlc_object_t *p_this )
     demux_t     *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    PESWorkersStop( p_demux );
+    SeekIndexClean( p_demux );
+
     msg_Dbg( p_demux, "pid list:" );
     for( int i = 0; i < 8192; i++ )
     {
@@ -1279,6 +1365,7 @@ static void Close( vlc_object_t *p_this )
 
     free( p_sys->p_pcrs );
     free( p_sys->p_pos );
+    free( p_sys->bulk.p_buffer );
 
 #ifdef HAVE_ARIBB24
     if ( p_sys->arib.p_instance )
@@ -1325,13 +1412,15 @@ static int Demux( demux_t *p_demux )
     demux_sys_t *p_sys = p_demux->p_sys;
     bool b_wait_es = p_sys->i_pmt_es <= 0;
 
-    /* We read at most 100 TS packet or until a frame is completed */
+    /* We read at most i_ts_read TS packet or until a frame is completed,
+     * unless PES are reassembled by the workers */
     for( int i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
     {
         bool         b_frame = false;
         block_t     *p_pkt;
-        if( !(p_pkt = ReadTSPacket( p_demux )) )
+        if( !(p_pkt = ReadTSPacketBulk( p_demux )) )
         {
+            PESWorkersFlush( p_demux, -1 );
             return 0;
         }
 
@@ -1360,12 +1449,17 @@ static int Demux( demux_t *p_demux )
             {
                 if( p_pid->i_pid == 0 || ( p_sys->b_dvb_meta && ( p_pid->i_pid == 0x11 || p_pid->i_pid == 0x12 || p_pid->i_pid == 0x14 ) ) )
                 {
+                    if( p_pid->i_pid == 0 )
+                        PESWorkersFlush( p_demux, -1 );
                     dvbpsi_PushPacket( p_pid->psi->handle, p_pkt->p_buffer );
                 }
                 else
                 {
                     for( int i_prg = 0; i_prg < p_pid->psi->i_prg; i_prg++ )
                     {
+                        /* The PMT may change or delete the program ES */
+                        PESWorkersFlush( p_demux,
+                                         p_pid->psi->prg[i_prg]->i_number );
                         dvbpsi_PushPacket( p_pid->psi->prg[i_prg]->handle,
                                            p_pkt->p_buffer );
                     }
@@ -1375,8 +1469,12 @@ static int Demux( demux_t *p_demux )
             else
             {
                 if(p_sys->b_delay_es_creation) /* No longer delay ES since that pid's program sends data */
+                {
+                    PESWorkersFlush( p_demux, -1 );
                     AddAndCreateES( p_demux, NULL );
-                b_frame = GatherData( p_demux, p_pid, p_pkt );
+                }
+                b_frame = GatherData( p_demux, p_pid, p_pkt )
+                       && p_sys->pes_workers == NULL;
             }
         }
         else
@@ -1395,6 +1493,7 @@ static int Demux( demux_t *p_demux )
             break;
     }
 
+    PESWorkersFlush( p_demux, -1 );
     demux_UpdateTitleFromStream( p_demux );
     return 1;
 }
@@ -1450,7 +1549,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
                 *pf = (double)i_time/(double)i_length;
             else if( (i64 = stream_Size( p_sys->stream) ) > 0 )
             {
-                int64_t offset = stream_Tell( p_sys->stream );
+                int64_t offset = TSTell( p_demux );
 
                 *pf = (double)offset / (double)i64;
             }
@@ -1469,6 +1568,8 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         if(!p_sys->b_canseek)
             return VLC_EGENERIC;
 
+        BulkReset( p_demux );
+
         if( p_sys->b_force_seek_per_percent ||
             (p_sys->b_dvb_meta && p_sys->b_access_control) ||
             p_sys->i_last_pcr - p_sys->i_first_pcr <= 0 )
@@ -1584,9 +1685,11 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 
     case DEMUX_SET_TITLE:
+        BulkReset( p_demux );
         return stream_vaControl( p_sys->stream, STREAM_SET_TITLE, args );
 
     case DEMUX_SET_SEEKPOINT:
+        BulkReset( p_demux );
         return stream_vaControl( p_sys->stream, STREAM_SET_SEEKPOINT, args );
 
     case DEMUX_GET_META:
@@ -2054,9 +2157,11 @@ static block_t *Opus_Parse(demux_t *demux, block_t *block)
 /****************************************************************************
  * gathering stuff
  ****************************************************************************/
-static void ParsePES( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
+/* Parses a gathered PES and returns the resulting block(s). This only reads
+ * the PID state that PSI or PCR processing may change: it can run on a PES
+ * worker thread, however the result must be sent through SendPES(). */
+static block_t *ParsePES( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
 {
-    demux_sys_t *p_sys = p_demux->p_sys;
     uint8_t header[34];
     unsigned i_pes_size = 0;
     unsigned i_skip = 0;
@@ -2073,7 +2178,7 @@ static void ParsePES( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
             msg_Warn( p_demux, "invalid header [0x%02x:%02x:%02x:%02x] (pid: %d)",
                         header[0], header[1],header[2],header[3], pid->i_pid );
         block_ChainRelease( p_pes );
-        return;
+        return NULL;
     }
 
     /* TODO check size */
@@ -2114,7 +2219,7 @@ static void ParsePES( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
             {
                 msg_Err( p_demux, "too much MPEG-1 stuffing" );
                 block_ChainRelease( p_pes );
-                return;
+                return NULL;
             }
             if( ( header[i_skip] & 0xC0 ) == 0x40 )
             {
@@ -2220,27 +2325,9 @@ static void ParsePES( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
             /* Append a \0 */
             p_block = block_Realloc( p_block, 0, p_block->i_buffer + 1 );
             if( !p_block )
-                return;
+                return NULL;
             p_block->p_buffer[p_block->i_buffer -1] = '\0';
         }
-        else if( pid->es->fmt.i_codec == VLC_CODEC_TELETEXT )
-        {
-            if( p_block->i_pts <= VLC_TS_INVALID )
-            {
-                /* Teletext may have missing PTS (ETSI EN 300 472 Annexe A)
-                 * In this case use the last PCR + 40ms */
-                for( int i = 0; pid->p_owner && i < pid->p_owner->i_prg; i++ )
-                {
-                    if( pid->i_owner_number == pid->p_owner->prg[i]->i_number )
-                    {
-                        mtime_t i_pcr = pid->p_owner->prg[i]->i_pcr_value;
-                        if( i_pcr > VLC_TS_INVALID )
-                            p_block->i_pts = VLC_TS_0 + i_pcr * 100 / 9 + 40000;
-                        break;
-                    }
-                }
-            }
-        }
         else if( pid->es->fmt.i_codec == VLC_CODEC_ARIB_A ||
                  pid->es->fmt.i_codec == VLC_CODEC_ARIB_C )
         {
@@ -2253,7 +2340,7 @@ static void ParsePES( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
                 /* Append a \0 */
                 p_block = block_Realloc( p_block, 0, p_block->i_buffer + 1 );
                 if( !p_block )
-                    return;
+                    return NULL;
                 p_block->p_buffer[p_block->i_buffer -1] = '\0';
             }
         }
@@ -2261,36 +2348,216 @@ static void ParsePES( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
         {
             p_block = Opus_Parse(p_demux, p_block);
         }
+        return p_block;
+    }
+    else
+    {
+        msg_Warn( p_demux, "empty pes" );
+        return NULL;
+    }
+}
 
-        while (p_block) {
-            block_t *p_next = p_block->p_next;
-            p_block->p_next = NULL;
-            for( int i = 0; i < pid->i_extra_es; i++ )
+/* Sends the blocks parsed from a PES, in PES order, from the demux thread. */
+static void SendPES( demux_t *p_demux, ts_pid_t *pid, block_t *p_block )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_block != NULL && pid->es->fmt.i_codec == VLC_CODEC_TELETEXT &&
+        p_block->i_pts <= VLC_TS_INVALID )
+    {
+        /* Teletext may have missing PTS (ETSI EN 300 472 Annexe A)
+         * In this case use the last PCR + 40ms */
+        for( int i = 0; pid->p_owner && i < pid->p_owner->i_prg; i++ )
+        {
+            if( pid->i_owner_number == pid->p_owner->prg[i]->i_number )
             {
-                es_out_Send( p_demux->out, pid->extra_es[i]->id,
-                        block_Duplicate( p_block ) );
+                mtime_t i_pcr = pid->p_owner->prg[i]->i_pcr_value;
+                if( i_pcr > VLC_TS_INVALID )
+                    p_block->i_pts = VLC_TS_0 + i_pcr * 100 / 9 + 40000;
+                break;
             }
+        }
+    }
 
-            PCRFixHandle( p_demux, p_block );
+    while (p_block) {
+        block_t *p_next = p_block->p_next;
+        p_block->p_next = NULL;
+        for( int i = 0; i < pid->i_extra_es; i++ )
+        {
+            es_out_Send( p_demux->out, pid->extra_es[i]->id,
+                    block_Duplicate( p_block ) );
+        }
+
+        PCRFixHandle( p_demux, p_block );
 
-            if ( p_sys->b_disable_pcr && p_block->i_dts > VLC_TS_INVALID )
-                es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR,
-                        pid->i_owner_number, p_block->i_dts);
+        if ( p_sys->b_disable_pcr && p_block->i_dts > VLC_TS_INVALID )
+            es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR,
+                    pid->i_owner_number, p_block->i_dts);
 
-            if( !p_sys->b_disable_pcr && p_block->i_dts > VLC_TS_INVALID &&
-                 p_block->i_dts < (VLC_TS_0 + p_sys->i_current_pcr * 100 / 9) )
-                msg_Warn( p_demux, "Broken stream: pid %d sends packets with dts %"PRId64"us later than pcr",
-                          pid->i_pid, (p_sys->i_current_pcr * 100 / 9) - p_block->i_dts + VLC_TS_0  );
+        if( !p_sys->b_disable_pcr && p_block->i_dts > VLC_TS_INVALID &&
+             p_block->i_dts < (VLC_TS_0 + p_sys->i_current_pcr * 100 / 9) )
+            msg_Warn( p_demux, "Broken stream: pid %d sends packets with dts %"PRId64"us later than pcr",
+                      pid->i_pid, (p_sys->i_current_pcr * 100 / 9) - p_block->i_dts + VLC_TS_0  );
 
-            es_out_Send( p_demux->out, pid->es->id, p_block );
+        es_out_Send( p_demux->out, pid->es->id, p_block );
 
-            p_block = p_next;
-        }
+        p_block = p_next;
     }
-    else
+}
+
+/*****************************************************************************
+ * PES workers: ParsePES() is run by a pool of threads, so that the
+ * reassembly of the PES of a large multiplex is not bound to a single CPU.
+ *
+ * PSI, PCR and ES output are still handled by the demux thread: the parsed
+ * PES are sent in their TS order by PESWorkersFlush(), which must be called
+ * before the PID state or the program clock change.
+ *****************************************************************************/
+static void *PESWorkerThread( void *data )
+{
+    demux_t *p_demux = data;
+    ts_pes_workers_t *w = p_demux->p_sys->pes_workers;
+
+    vlc_mutex_lock( &w->lock );
+    mutex_cleanup_push( &w->lock );
+    for( ;; )
     {
-        msg_Warn( p_demux, "empty pes" );
+        while( w->p_todo == NULL )
+            vlc_cond_wait( &w->wait, &w->lock );
+
+        ts_pes_job_t *job = w->p_todo;
+        w->p_todo = job->p_next;
+        vlc_mutex_unlock( &w->lock );
+
+        int canc = vlc_savecancel();
+        job->p_data = ParsePES( p_demux, job->pid, job->p_data );
+        vlc_restorecancel( canc );
+
+        vlc_mutex_lock( &w->lock );
+        job->b_done = true;
+        vlc_cond_signal( &w->done );
+    }
+    vlc_cleanup_pop();
+    return NULL;
+}
+
+static int PESWorkersStart( demux_t *p_demux, int i_threads )
+{
+    ts_pes_workers_t *w = malloc( sizeof( *w )
+                                  + i_threads * sizeof( vlc_thread_t ) );
+    if( unlikely(w == NULL) )
+        return VLC_ENOMEM;
+
+    vlc_mutex_init( &w->lock );
+    vlc_cond_init( &w->wait );
+    vlc_cond_init( &w->done );
+    w->p_first = NULL;
+    w->pp_last = &w->p_first;
+    w->p_todo = NULL;
+    w->i_threads = 0;
+    p_demux->p_sys->pes_workers = w;
+
+    while( w->i_threads < i_threads )
+    {
+        if( vlc_clone( &w->threads[w->i_threads], PESWorkerThread, p_demux,
+                       VLC_THREAD_PRIORITY_INPUT ) )
+            break;
+        w->i_threads++;
+    }
+
+    if( w->i_threads == 0 )
+    {
+        PESWorkersStop( p_demux );
+        return VLC_EGENERIC;
+    }
+    msg_Dbg( p_demux, "reassembling PES with %d threads", w->i_threads );
+    return VLC_SUCCESS;
+}
+
+static void PESWorkersStop( demux_t *p_demux )
+{
+    ts_pes_workers_t *w = p_demux->p_sys->pes_workers;
+
+    if( w == NULL )
+        return;
+
+    PESWorkersFlush( p_demux, -1 );
+
+    for( int i = 0; i < w->i_threads; i++ )
+        vlc_cancel( w->threads[i] );
+    for( int i = 0; i < w->i_threads; i++ )
+        vlc_join( w->threads[i], NULL );
+
+    vlc_cond_destroy( &w->done );
+    vlc_cond_destroy( &w->wait );
+    vlc_mutex_destroy( &w->lock );
+    free( w );
+    p_demux->p_sys->pes_workers = NULL;
+}
+
+static bool PESWorkersQueue( demux_t *p_demux, ts_pid_t *pid, block_t *p_pes )
+{
+    ts_pes_workers_t *w = p_demux->p_sys->pes_workers;
+
+    if( w == NULL )
+        return false;
+
+    ts_pes_job_t *job = malloc( sizeof( *job ) );
+    if( unlikely(job == NULL) )
+        return false;
+
+    job->p_next = NULL;
+    job->pid = pid;
+    job->p_data = p_pes;
+    job->b_done = false;
+
+    vlc_mutex_lock( &w->lock );
+    *w->pp_last = job;
+    w->pp_last = &job->p_next;
+    if( w->p_todo == NULL )
+        w->p_todo = job;
+    vlc_cond_signal( &w->wait );
+    vlc_mutex_unlock( &w->lock );
+    return true;
+}
+
+/* Waits for the PES queued for a program (or for all, if i_group is
+ * negative) and sends them. */
+static void PESWorkersFlush( demux_t *p_demux, int i_group )
+{
+    ts_pes_workers_t *w = p_demux->p_sys->pes_workers;
+
+    if( w == NULL )
+        return;
+
+    vlc_mutex_lock( &w->lock );
+    for( ts_pes_job_t **pp = &w->p_first; *pp != NULL; )
+    {
+        ts_pes_job_t *job = *pp;
+        const ts_pid_t *pid = job->pid;
+
+        /* PID shared by several programs are always flushed */
+        if( i_group >= 0 && pid->i_owner_number != i_group &&
+            pid->p_owner != NULL && pid->p_owner->i_prg <= 1 )
+        {
+            pp = &job->p_next;
+            continue;
+        }
+
+        while( !job->b_done )
+            vlc_cond_wait( &w->done, &w->lock );
+
+        *pp = job->p_next;
+        if( *pp == NULL )
+            w->pp_last = pp;
+        vlc_mutex_unlock( &w->lock );
+
+        SendPES( p_demux, job->pid, job->p_data );
+        free( job );
+
+        vlc_mutex_lock( &w->lock );
     }
+    vlc_mutex_unlock( &w->lock );
 }
 
 static void ParseTableSection( demux_t *p_demux, ts_pid_t *pid, block_t *p_data )
@@ -2355,7 +2622,11 @@ static void ParseData( demux_t *p_demux, ts_pid_t *pid )
 
     if( pid->es->data_type == TS_ES_DATA_PES )
     {
-        ParsePES( p_demux, pid, p_data );
+        if( !PESWorkersQueue( p_demux, pid, p_data ) )
+        {
+            PESWorkersFlush( p_demux, -1 );
+            SendPES( p_demux, pid, ParsePES( p_demux, pid, p_data ) );
+        }
     }
     else if( pid->es->data_type == TS_ES_DATA_TABLE_SECTION )
     {
@@ -2431,15 +2702,181 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     return p_pkt;
 }
 
-static mtime_t AdjustPCRWrapAround( demux_t *p_demux, mtime_t i_pcr )
+/* Returns the stream position of the next packet to demux */
+static int64_t TSTell( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    return stream_Tell( p_sys->stream )
+         - ( p_sys->bulk.i_length - p_sys->bulk.i_offset );
+}
+
+/* Gives the bulk data back to the stream, before moving in it */
+static void BulkReset( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->bulk.i_offset < p_sys->bulk.i_length && p_sys->b_canseek )
+        stream_Seek( p_sys->stream, TSTell( p_demux ) );
+    p_sys->bulk.i_offset = 0;
+    p_sys->bulk.i_length = 0;
+}
+
+/* Appends data from the stream to the bulk buffer */
+static bool BulkFill( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    size_t i_avail = p_sys->bulk.i_length - p_sys->bulk.i_offset;
+
+    memmove( p_sys->bulk.p_buffer,
+             &p_sys->bulk.p_buffer[p_sys->bulk.i_offset], i_avail );
+    p_sys->bulk.i_offset = 0;
+    p_sys->bulk.i_length = i_avail;
+
+    int i_read = stream_Read( p_sys->stream, &p_sys->bulk.p_buffer[i_avail],
+                              TS_BULK_PACKETS * p_sys->i_packet_size - i_avail );
+    if( i_read <= 0 )
+        return false;
+    p_sys->bulk.i_length += i_read;
+
+    if( p_sys->csa )
+        BulkDescramble( p_demux );
+    return true;
+}
+
+/* Skips garbage up to the next pair of sync bytes in the bulk buffer */
+static bool BulkResync( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_size = p_sys->i_packet_size;
+    const size_t i_header = p_sys->i_packet_header_size;
+
+    while( vlc_object_alive (p_demux) )
+    {
+        const uint8_t *p = &p_sys->bulk.p_buffer[p_sys->bulk.i_offset];
+        size_t i_avail = p_sys->bulk.i_length - p_sys->bulk.i_offset;
+        size_t i_skip = 0;
+
+        while( i_skip + i_header + i_size < i_avail )
+        {
+            if( p[i_skip + i_header] == 0x47 &&
+                p[i_skip + i_header + i_size] == 0x47 )
+            {
+                msg_Dbg( p_demux, "skipping %zu bytes of garbage", i_skip );
+                p_sys->bulk.i_offset += i_skip;
+                return true;
+            }
+            i_skip++;
+        }
+
+        msg_Dbg( p_demux, "skipping %zu bytes of garbage", i_skip );
+        p_sys->bulk.i_offset += i_skip;
+        if( !BulkFill( p_demux ) )
+            break;
+    }
+    return false;
+}
+
+/* Whether a packet would be dropped by Demux() without being parsed:
+ * its PID is not decoded nor probed, and it carries no PCR. */
+static bool PacketIsIgnored( demux_sys_t *p_sys, const uint8_t *p )
+{
+    const ts_pid_t *pid = &p_sys->pid[((p[1]&0x1f)<<8)|p[2]];
+
+    if( pid->b_valid || !pid->b_seen || !p_sys->pid[0].b_seen )
+        return false;
+    return !( ( p[3]&0x20 ) && p[4] > 0 && ( p[5]&0x10 ) );
+}
+
+/* Descrambles the packets of the bulk buffer in a batch. GatherData()
+ * descrambles the ones left, past a synchro loss, one by one */
+static void BulkDescramble( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_size = p_sys->i_packet_size;
+    const size_t i_header = p_sys->i_packet_header_size;
+    uint8_t *pp_pkt[TS_BULK_PACKETS];
+    int i_pkt = 0;
+
+    for( size_t i = p_sys->bulk.i_offset;
+         i + i_size <= p_sys->bulk.i_length; i += i_size )
+    {
+        uint8_t *p = &p_sys->bulk.p_buffer[i + i_header];
+
+        if( p[0] != 0x47 )
+            break;
+        if( ( p[3] & 0x80 ) && !PacketIsIgnored( p_sys, p ) )
+            pp_pkt[i_pkt++] = p;
+    }
+
+    vlc_mutex_lock( &p_sys->csa_lock );
+    if( p_sys->csa && i_pkt > 0 )
+        csa_DecryptBatch( p_sys->csa, pp_pkt, i_pkt, p_sys->i_csa_pkt_size );
+    vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
+/* Reads a TS packet for Demux(). Packets are read TS_BULK_PACKETS at a time
+ * from the stream, and ignored ones are skipped without allocating a block.
+ * Other callers have to use ReadTSPacket(), after BulkReset(). */
+static block_t* ReadTSPacketBulk( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_size = p_sys->i_packet_size;
+    const size_t i_header = p_sys->i_packet_header_size;
+
+    for( ;; )
+    {
+        while( p_sys->bulk.i_length - p_sys->bulk.i_offset < i_size )
+        {
+            if( !BulkFill( p_demux ) )
+            {
+                msg_Dbg( p_demux, "eof ?" );
+                return NULL;
+            }
+        }
+
+        const uint8_t *p = &p_sys->bulk.p_buffer[p_sys->bulk.i_offset];
+
+        /* Check sync byte and re-sync if needed */
+        if( p[i_header] != 0x47 )
+        {
+            msg_Warn( p_demux, "lost synchro" );
+            if( !BulkResync( p_demux ) )
+            {
+                msg_Dbg( p_demux, "eof ?" );
+                return NULL;
+            }
+            continue;
+        }
+
+        if( PacketIsIgnored( p_sys, p + i_header ) )
+        {
+            p_sys->bulk.i_offset += i_size;
+            continue;
+        }
+
+        block_t *p_pkt = block_Alloc( i_size );
+        if( unlikely(p_pkt == NULL) )
+            return NULL;
+
+        memcpy( p_pkt->p_buffer, p, i_size );
+        p_sys->bulk.i_offset += i_size;
+
+        /* Skip header (BluRay streams), see ReadTSPacket() */
+        p_pkt->p_buffer += i_header;
+        p_pkt->i_buffer -= i_header;
+        return p_pkt;
+    }
+}
+
+static mtime_t AdjustPCRWrapAroundAt( demux_sys_t *p_sys, int64_t i_pos,
+                                      mtime_t i_pcr )
 {
-    demux_sys_t   *p_sys = p_demux->p_sys;
     /*
      * PCR is 33bit. If PCR reaches to 0x1FFFFFFFF (26:30:43.717), ressets from 0.
      * So, need to add 0x1FFFFFFFF, for calculating duration or current position.
      */
     mtime_t i_adjust = 0;
-    int64_t i_pos = stream_Tell( p_sys->stream );
     int i;
     for( i = 1; i < p_sys->i_pcrs_num && p_sys->p_pos[i] <= i_pos; ++i )
     {
@@ -2452,6 +2889,11 @@ static mtime_t AdjustPCRWrapAround( demux_t *p_demux, mtime_t i_pcr )
     return i_pcr + i_adjust;
 }
 
+static mtime_t AdjustPCRWrapAround( demux_t *p_demux, mtime_t i_pcr )
+{
+    return AdjustPCRWrapAroundAt( p_demux->p_sys, TSTell( p_demux ), i_pcr );
+}
+
 static mtime_t GetPCR( block_t *p_pkt )
 {
     const uint8_t *p = p_pkt->p_buffer;
@@ -2472,6 +2914,163 @@ static mtime_t GetPCR( block_t *p_pkt )
     return i_pcr;
 }
 
+/*****************************************************************************
+ * Seek index (see seek_index.h). The side-car file also holds the first and
+ * last PCR and the wrap-around probes, so that the next opening skips
+ * GetFirstPCR(), CheckPCR() and GetLastPCR().
+ *****************************************************************************/
+#define SEEK_INDEX_MAGIC    "VLCTSIX2"
+#define SEEK_INDEX_INTERVAL (90000) /* one second in PCR units */
+#define SEEK_INDEX_CHUNK    (TS_PACKET_SIZE_MAX * 512)
+
+/* Extra data of the side-car file, followed by the wrap-around probes */
+typedef struct
+{
+    int32_t  i_pid_ref_pcr;
+    int32_t  i_pcrs_num;
+    int64_t  i_first_pcr;
+    int64_t  i_last_pcr;
+} ts_seek_index_extra_t;
+
+static size_t SeekIndexExtraSize( demux_sys_t *p_sys )
+{
+    return sizeof( ts_seek_index_extra_t ) +
+           p_sys->i_pcrs_num * ( sizeof( *p_sys->p_pcrs ) + sizeof( *p_sys->p_pos ) );
+}
+
+/* Creates the seek index, and loads the side-car file if enabled. If it was
+ * valid, the first and last PCR are known and the file need not be probed.
+ * Returns whether the side-car file was loaded. */
+static bool SeekIndexInit( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    seek_index_t *idx = seek_index_New( SEEK_INDEX_INTERVAL );
+
+    p_sys->p_seek_index = idx;
+    if( idx == NULL || !var_InheritBool( p_demux, "ts-seek-index" )
+     || !seek_index_SetFile( idx, p_demux->psz_file, "ts-index" ) )
+        return false;
+
+    const size_t i_extra = SeekIndexExtraSize( p_sys );
+    uint8_t *p_extra = malloc( i_extra );
+    if( p_extra == NULL || !seek_index_Load( idx, SEEK_INDEX_MAGIC, p_extra, i_extra ) )
+    {
+        free( p_extra );
+        return false;
+    }
+
+    ts_seek_index_extra_t hdr;
+    memcpy( &hdr, p_extra, sizeof( hdr ) );
+    if( hdr.i_pcrs_num != p_sys->i_pcrs_num )
+    {
+        free( p_extra );
+        return false;
+    }
+
+    const uint8_t *p = &p_extra[sizeof( hdr )];
+    memcpy( p_sys->p_pcrs, p, p_sys->i_pcrs_num * sizeof( *p_sys->p_pcrs ) );
+    p += p_sys->i_pcrs_num * sizeof( *p_sys->p_pcrs );
+    memcpy( p_sys->p_pos, p, p_sys->i_pcrs_num * sizeof( *p_sys->p_pos ) );
+    p_sys->i_pid_ref_pcr = hdr.i_pid_ref_pcr;
+    p_sys->i_first_pcr = hdr.i_first_pcr;
+    p_sys->i_current_pcr = hdr.i_first_pcr;
+    p_sys->i_last_pcr = hdr.i_last_pcr;
+    free( p_extra );
+
+    msg_Dbg( p_demux, "loaded %zu seek points from %s", idx->i_points,
+             idx->psz_path );
+    return true;
+}
+
+static void SeekIndexClean( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    seek_index_t *idx = p_sys->p_seek_index;
+
+    if( idx == NULL )
+        return;
+
+    seek_index_StopScan( idx );
+
+    if( p_sys->i_first_pcr >= 0 && p_sys->i_last_pcr >= 0 )
+    {
+        const size_t i_extra = SeekIndexExtraSize( p_sys );
+        uint8_t *p_extra = malloc( i_extra );
+
+        if( p_extra != NULL )
+        {
+            ts_seek_index_extra_t hdr = {
+                .i_pid_ref_pcr = p_sys->i_pid_ref_pcr,
+                .i_pcrs_num = p_sys->i_pcrs_num,
+                .i_first_pcr = p_sys->i_first_pcr,
+                .i_last_pcr = p_sys->i_last_pcr,
+            };
+            uint8_t *p = p_extra;
+
+            memcpy( p, &hdr, sizeof( hdr ) );
+            p += sizeof( hdr );
+            memcpy( p, p_sys->p_pcrs, p_sys->i_pcrs_num * sizeof( *p_sys->p_pcrs ) );
+            p += p_sys->i_pcrs_num * sizeof( *p_sys->p_pcrs );
+            memcpy( p, p_sys->p_pos, p_sys->i_pcrs_num * sizeof( *p_sys->p_pos ) );
+
+            seek_index_Save( VLC_OBJECT(p_demux), idx, SEEK_INDEX_MAGIC,
+                             p_extra, i_extra );
+            free( p_extra );
+        }
+    }
+
+    seek_index_Delete( idx );
+    p_sys->p_seek_index = NULL;
+}
+
+/* Finds the first PCR of the reference PID in a chunk of the file */
+static void SeekIndexProbe( demux_t *p_demux, stream_t *s, int64_t i_pos,
+                            uint8_t *p_buf )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const int i_size = p_sys->i_packet_size;
+    const int i_header = p_sys->i_packet_header_size;
+
+    if( stream_Seek( s, i_pos ) )
+        return;
+
+    int i_read = stream_Read( s, p_buf, SEEK_INDEX_CHUNK );
+    int i = 0;
+
+    /* Synchronize */
+    while( i + i_header + i_size < i_read &&
+           ( p_buf[i + i_header] != 0x47 ||
+             p_buf[i + i_header + i_size] != 0x47 ) )
+        i++;
+
+    for( ; i + i_size <= i_read; i += i_size )
+    {
+        const uint8_t *p = &p_buf[i + i_header];
+
+        if( p[0] != 0x47 || (((p[1]&0x1f)<<8)|p[2]) != p_sys->i_pid_ref_pcr
+         || !( p[3]&0x20 ) || !( p[5]&0x10 ) || p[4] < 7 )
+            continue;
+
+        mtime_t i_pcr = ( (mtime_t)p[6] << 25 ) | ( (mtime_t)p[7] << 17 ) |
+                        ( (mtime_t)p[8] << 9 ) | ( (mtime_t)p[9] << 1 ) |
+                        ( (mtime_t)p[10] >> 7 );
+        i_pcr = AdjustPCRWrapAroundAt( p_sys, i_pos + i, i_pcr );
+        seek_index_Add( p_sys->p_seek_index, i_pos + i, i_pcr );
+        break;
+    }
+}
+
+static void SeekIndexStartScan( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->i_pid_ref_pcr < 0 || p_sys->b_force_seek_per_percent )
+        return;
+
+    seek_index_StartScan( p_demux, p_sys->p_seek_index, SeekIndexProbe,
+                          SEEK_INDEX_CHUNK, p_sys->i_packet_size );
+}
+
 static int SeekToPCR( demux_t *p_demux, int64_t i_pos )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -2545,6 +3144,24 @@ static int Seek( demux_t *p_demux, double f_percent )
         i_head_pos = p_sys->p_pos[i-1];
         i_tail_pos = ( i < p_sys->i_pcrs_num ) ?  p_sys->p_pos[i] : stream_Size( p_sys->stream );
     }
+
+    /* Use the closest known positions */
+    seek_point_t before = { .i_pos = -1 }, after = { .i_pos = -1 };
+    seek_index_Lookup( p_sys->p_seek_index, i_target_pcr, &before, &after );
+    if( before.i_pos >= 0 &&
+        i_target_pcr - before.i_time <= SEEK_INDEX_INTERVAL &&
+        !SeekToPCR( p_demux, before.i_pos ) )
+    {
+        msg_Dbg( p_demux, "Seek(): found in the seek index" );
+        p_sys->i_current_pcr = before.i_time;
+        p_sys->pcrfix.i_first_dts = 0;
+        return VLC_SUCCESS;
+    }
+    if( before.i_pos > i_head_pos )
+        i_head_pos = before.i_pos;
+    if( after.i_pos >= 0 && after.i_pos < i_tail_pos )
+        i_tail_pos = after.i_pos;
+
     msg_Dbg( p_demux, "Seek():i_head_pos:%"PRId64", i_tail_pos:%"PRId64, i_head_pos, i_tail_pos);
 
     bool b_found = false;
@@ -2585,6 +3202,9 @@ static int Seek( demux_t *p_demux, double f_percent )
     else
     {
         msg_Dbg( p_demux, "Seek():can find a time position. i_cnt:%d", i_cnt );
+        seek_index_Add( p_sys->p_seek_index,
+                        stream_Tell( p_sys->stream ) - p_sys->i_packet_size,
+                        p_sys->i_current_pcr );
         p_demux->p_sys->pcrfix.i_first_dts = 0;
         return VLC_SUCCESS;
     }
@@ -2718,7 +3338,12 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
         return;
 
     if( p_sys->i_pid_ref_pcr == pid->i_pid )
+    {
         p_sys->i_current_pcr = AdjustPCRWrapAround( p_demux, i_pcr );
+        seek_index_Add( p_sys->p_seek_index,
+                        TSTell( p_demux ) - p_sys->i_packet_size,
+                        p_sys->i_current_pcr );
+    }
 
     /* Search program and set the PCR */
     int i_group = -1;
@@ -2759,6 +3384,8 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
         }
         if ( !p_sys->b_disable_pcr && i_group > 0 && p_sys->i_pmt_es )
         {
+            /* Data preceding the PCR must be sent first */
+            PESWorkersFlush( p_demux, i_group );
             es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR,
               i_group, VLC_TS_0 + i_pcr * 100 / 9 );
         }
@@ -2900,6 +3527,8 @@ static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
         msg_Warn( p_demux, "scrambled state changed on pid %d (%d->%d)",
                   pid->i_pid, pid->b_scrambled, b_scrambled );
 
+        PESWorkersFlush( p_demux, -1 );
+
         pid->b_scrambled = b_scrambled;
 
         for( int i = 0; i < pid->i_extra_es; i++ )
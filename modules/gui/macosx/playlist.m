@@ -528,7 +528,7 @@
             continue;
         }
 
-        libvlc_MetaRequest(p_intf->p_libvlc, [o_item input], META_REQUEST_OPTION_NONE);
+        libvlc_MetaRequest(p_intf->p_libvlc, [o_item input], META_REQUEST_OPTION_PRIORITY);
 
     }
     [self playlistUpdated];
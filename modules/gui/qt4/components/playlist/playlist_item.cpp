@@ -61,6 +61,8 @@ void PLItem::init( playlist_item_t *_playlist_item, PLItem *parent )
     i_playlist_id = _playlist_item->i_id;           /* Playlist item specific id */
     p_input = _playlist_item->p_input;
     vlc_gc_incref( p_input );
+    i_fetched = 0;
+    b_more = _playlist_item->i_children > 0;
 }
 
 /*
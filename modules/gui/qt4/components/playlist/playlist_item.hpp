@@ -95,6 +95,10 @@ private:
     void init( playlist_item_t *, PLItem * );
     int i_playlist_id;
     input_item_t *p_input;
+
+    /* The children are fetched on demand, in the core order */
+    int i_fetched; /* Number of core children already fetched (or skipped) */
+    bool b_more; /* Some core children are still to be fetched */
 };
 
 #endif
@@ -40,6 +40,10 @@
 #include <assert.h>
 #include <QFont>
 #include <QAction>
+#include <QSet>
+
+/* Number of children fetched at once from the core playlist */
+#define PL_FETCH_ROWS 512
 
 /*************************************************************************
  * Playlist model implementation
@@ -56,6 +60,10 @@ PLModel::PLModel( playlist_t *_p_playlist,  /* THEPL */
     rootItem          = NULL; /* PLItem rootItem, will be set in rebuild( ) */
     latestSearch      = QString();
 
+    appendTimer.setSingleShot( true );
+    appendTimer.setInterval( 0 );
+    CONNECT( &appendTimer, timeout(), this, processPendingAppends() );
+
     rebuild( p_root );
     DCONNECT( THEMIM->getIM(), metaChanged( input_item_t *),
               this, processInputItemUpdate( input_item_t *) );
@@ -263,7 +271,14 @@ void PLModel::dropMove( const PlMimeData * plMimeData, PLItem *target, int row )
     foreach( PLItem *item, model_items )
         takeItem( item );
 
-    insertChildren( target, model_items, model_pos );
+    /* Moved among the children not fetched yet: they will be fetched */
+    if( target->b_more && new_pos >= target->i_fetched )
+        qDeleteAll( model_items );
+    else
+    {
+        target->i_fetched += model_items.count();
+        insertChildren( target, model_items, model_pos );
+    }
     free( pp_items );
 }
 
@@ -482,6 +497,35 @@ int PLModel::rowCount( const QModelIndex &parent ) const
     return parentItem->childCount();
 }
 
+bool PLModel::hasChildren( const QModelIndex &parent ) const
+{
+    PLItem *parentItem = parent.isValid() ? getItem( parent ) : rootItem;
+    return parentItem->childCount() > 0 || parentItem->b_more;
+}
+
+bool PLModel::canFetchMore( const QModelIndex &parent ) const
+{
+    PLItem *parentItem = parent.isValid() ? getItem( parent ) : rootItem;
+    return parentItem->b_more;
+}
+
+void PLModel::fetchMore( const QModelIndex &parent )
+{
+    PLItem *parentItem = parent.isValid() ? getItem( parent ) : rootItem;
+    QList<PLItem*> items;
+
+    PL_LOCK;
+    playlist_item_t *p_node =
+        playlist_ItemGetById( p_playlist, parentItem->id( PLAYLIST_ID ) );
+    if( p_node )
+        items = fetchChildren( p_node, parentItem );
+    else
+        parentItem->b_more = false;
+    PL_UNLOCK;
+
+    insertChildren( parentItem, items, parentItem->childCount() );
+}
+
 /************************* Lookups *****************************/
 PLItem *PLModel::findByPLId( PLItem *root, int i_plitemid ) const
 {
@@ -588,38 +632,92 @@ void PLModel::processItemRemoval( int i_pl_itemid )
 
 void PLModel::processItemAppend( int i_pl_itemid, int i_pl_itemidparent )
 {
-    playlist_item_t *p_item = NULL;
-    PLItem *newItem = NULL;
+    /* Coalesce the appends of a bulk insertion */
+    pendingAppends.append( qMakePair( i_pl_itemid, i_pl_itemidparent ) );
+    if( !appendTimer.isActive() )
+        appendTimer.start();
+}
+
+/* A new item, with its parent and its core position */
+struct pl_append_t
+{
+    PLItem *parent;
+    PLItem *item;
     int pos;
+};
 
-    /* Find the Parent */
-    PLItem *nodeParentItem = findByPLId( rootItem, i_pl_itemidparent );
-    if( !nodeParentItem ) return;
+void PLModel::processPendingAppends()
+{
+    QList<QPair<int, int> > appends = pendingAppends;
+    pendingAppends.clear();
 
-    /* Search for an already matching children */
-    foreach( AbstractPLItem *existing, nodeParentItem->children )
-        if( existing->id( PLAYLIST_ID ) == i_pl_itemid ) return;
+    QList<pl_append_t> news;
+    PLItem *nodeParentItem = NULL;
+    QSet<int> existing;
 
-    /* Find the child */
     PL_LOCK;
-    p_item = playlist_ItemGetById( p_playlist, i_pl_itemid );
-    if( !p_item || p_item->i_flags & PLAYLIST_DBL_FLAG )
+    for( int i = 0; i < appends.count(); i++ )
     {
-        PL_UNLOCK; return;
-    }
+        const int i_pl_itemid = appends[i].first;
+        const int i_pl_itemidparent = appends[i].second;
 
-    for( pos = p_item->p_parent->i_children - 1; pos >= 0; pos-- )
-        if( p_item->p_parent->pp_children[pos] == p_item ) break;
+        /* Find the Parent */
+        if( !nodeParentItem ||
+            nodeParentItem->id( PLAYLIST_ID ) != i_pl_itemidparent )
+        {
+            nodeParentItem = findByPLId( rootItem, i_pl_itemidparent );
+            if( !nodeParentItem ) continue;
 
-    newItem = new PLItem( p_item, nodeParentItem );
+            /* Search for already matching children */
+            existing.clear();
+            foreach( AbstractPLItem *child, nodeParentItem->children )
+                existing.insert( child->id( PLAYLIST_ID ) );
+        }
+        if( existing.contains( i_pl_itemid ) ) continue;
+
+        /* Find the child */
+        playlist_item_t *p_item = playlist_ItemGetById( p_playlist, i_pl_itemid );
+        if( !p_item || p_item->i_flags & PLAYLIST_DBL_FLAG || !p_item->p_parent ||
+            p_item->p_parent->i_id != i_pl_itemidparent )
+            continue;
+
+        int pos;
+        for( pos = p_item->p_parent->i_children - 1; pos >= 0; pos-- )
+            if( p_item->p_parent->pp_children[pos] == p_item ) break;
+
+        /* It will be fetched with the rest of the node */
+        if( nodeParentItem->b_more && pos >= nodeParentItem->i_fetched )
+            continue;
+        nodeParentItem->i_fetched++;
+
+        pl_append_t add = { nodeParentItem, new PLItem( p_item, nodeParentItem ), pos };
+        news.append( add );
+        existing.insert( i_pl_itemid );
+    }
     PL_UNLOCK;
 
-    /* We insert the newItem (children) inside the parent */
-    beginInsertRows( index( nodeParentItem, 0 ), pos, pos );
-    nodeParentItem->insertChild( newItem, pos );
-    endInsertRows();
-    if ( newItem->inputItem() == THEMIM->currentInputItem() )
-        emit currentIndexChanged( index( newItem, 0 ) );
+    if( news.isEmpty() ) return;
+
+    /* We insert the consecutive new items (children) inside their parent
+     * at once */
+    QList<PLItem*> items;
+    for( int i = 0; i < news.count(); i++ )
+    {
+        items.append( news[i].item );
+        if( i + 1 < news.count() && news[i + 1].parent == news[i].parent &&
+            news[i + 1].pos == news[i].pos + 1 )
+            continue;
+
+        PLItem *parent = news[i].parent;
+        int first = news[i].pos - items.count() + 1;
+        insertChildren( parent, items, qMin( first, parent->childCount() ) );
+        items.clear();
+    }
+
+    input_item_t *p_current = THEMIM->currentInputItem();
+    for( int i = 0; i < news.count(); i++ )
+        if( news[i].item->inputItem() == p_current )
+            emit currentIndexChanged( index( news[i].item, 0 ) );
 
     if( latestSearch.isEmpty() ) return;
     filter( latestSearch, index( rootItem, 0), false /*FIXME*/ );
@@ -655,6 +753,7 @@ void PLModel::takeItem( PLItem *item )
 
     beginRemoveRows( index( parent, 0 ), i_index, i_index );
     parent->takeChildAt( i_index );
+    parent->i_fetched--;
     endRemoveRows();
 }
 
@@ -680,6 +779,7 @@ void PLModel::removeItem( PLItem *item )
         int i = item->parent()->indexOf( item );
         beginRemoveRows( index( static_cast<PLItem*>(item->parent()), 0), i, i );
         item->parent()->children.removeAt(i);
+        static_cast<PLItem*>(item->parent())->i_fetched--;
         delete item;
         endRemoveRows();
     }
@@ -702,14 +802,42 @@ void PLModel::updateChildren( PLItem *root )
 /* This function must be entered WITH the playlist lock */
 void PLModel::updateChildren( playlist_item_t *p_node, PLItem *root )
 {
-    for( int i = 0; i < p_node->i_children ; i++ )
-    {
-        if( p_node->pp_children[i]->i_flags & PLAYLIST_DBL_FLAG ) continue;
-        PLItem *newItem =  new PLItem( p_node->pp_children[i], root );
+    root->i_fetched = 0;
+    foreach( PLItem *newItem, fetchChildren( p_node, root ) )
         root->appendChild( newItem );
-        if( p_node->pp_children[i]->i_children != -1 )
-            updateChildren( p_node->pp_children[i], newItem );
+}
+
+/* Creates the items of the next children of a node, the views fetch the
+ * others (and the grandchildren) as they show them.
+ * This function must be entered WITH the playlist lock */
+QList<PLItem*> PLModel::fetchChildren( playlist_item_t *p_node, PLItem *root )
+{
+    QList<PLItem*> items;
+
+    while( root->i_fetched < p_node->i_children &&
+           items.count() < PL_FETCH_ROWS )
+    {
+        playlist_item_t *p_child = p_node->pp_children[root->i_fetched++];
+        if( p_child->i_flags & PLAYLIST_DBL_FLAG ) continue;
+        items.append( new PLItem( p_child, root ) );
     }
+    root->b_more = root->i_fetched < p_node->i_children;
+    return items;
+}
+
+/* Fetches the children of an emptied item again.
+ * This function must be entered WITH the playlist lock */
+void PLModel::refetchChildren( PLItem *root )
+{
+    playlist_item_t *p_node =
+        playlist_ItemGetById( p_playlist, root->id( PLAYLIST_ID ) );
+
+    root->i_fetched = 0;
+    root->b_more = false;
+    if( !p_node ) return;
+
+    QList<PLItem*> items = fetchChildren( p_node, root );
+    insertChildren( root, items, 0 );
 }
 
 /* Function doesn't need playlist-lock, as we don't touch playlist_item_t stuff here*/
@@ -801,11 +929,7 @@ void PLModel::sort( QModelIndex caller, QModelIndex rootIndex, const int column,
     }
 
     if( count )
-    {
-        beginInsertRows( qIndex, 0, count - 1 );
-        updateChildren( item );
-        endInsertRows( );
-    }
+        refetchChildren( item );
     PL_UNLOCK;
     /* if we have popup item, try to make sure that you keep that item visible */
     if( caller.isValid() ) emit currentIndexChanged( caller );
@@ -833,9 +957,7 @@ void PLModel::filter( const QString& search_text, const QModelIndex & idx, bool
             searchRoot->clearChildren();
             endRemoveRows();
 
-            beginInsertRows( idx, 0, searchRoot->childCount() - 1 );
-            updateChildren( searchRoot ); // The PL_LOCK is needed here
-            endInsertRows();
+            refetchChildren( searchRoot ); // The PL_LOCK is needed here
 
             PL_UNLOCK;
             return;
@@ -42,6 +42,8 @@
 #include <QVariant>
 #include <QModelIndex>
 #include <QAction>
+#include <QTimer>
+#include <QPair>
 
 class PLItem;
 class PlMimeData;
@@ -74,6 +76,9 @@ public:
     /* Data structure */
     QVariant data( const QModelIndex &index, const int role ) const Q_DECL_OVERRIDE;
     int rowCount( const QModelIndex &parent = QModelIndex() ) const Q_DECL_OVERRIDE;
+    bool hasChildren( const QModelIndex &parent = QModelIndex() ) const Q_DECL_OVERRIDE;
+    bool canFetchMore( const QModelIndex &parent ) const Q_DECL_OVERRIDE;
+    void fetchMore( const QModelIndex &parent ) Q_DECL_OVERRIDE;
     Qt::ItemFlags flags( const QModelIndex &index ) const Q_DECL_OVERRIDE;
     QModelIndex index( const int r, const int c, const QModelIndex &parent ) const Q_DECL_OVERRIDE;
     QModelIndex parent( const QModelIndex &index ) const Q_DECL_OVERRIDE;
@@ -128,9 +133,11 @@ private:
     void recurseDelete( QList<AbstractPLItem*> children, QModelIndexList *fullList );
     void takeItem( PLItem * ); //will not delete item
     void insertChildren( PLItem *node, QList<PLItem*>& items, int i_pos );
+    void refetchChildren( PLItem * );
     /* ...of which  the following will not update the views */
     void updateChildren( PLItem * );
     void updateChildren( playlist_item_t *, PLItem * );
+    QList<PLItem*> fetchChildren( playlist_item_t *, PLItem * );
 
     /* Deep actions (affect core playlist) */
     void dropAppendCopy( const PlMimeData * data, PLItem *target, int pos );
@@ -154,11 +161,16 @@ private:
     /* */
     QString latestSearch;
 
+    /* Appends (item, parent ids) coalesced until the event loop runs */
+    QList<QPair<int, int> > pendingAppends;
+    QTimer appendTimer;
+
 private slots:
     void processInputItemUpdate( input_item_t *);
     void processInputItemUpdate();
     void processItemRemoval( int i_pl_itemid );
     void processItemAppend( int i_pl_itemid, int i_pl_itemidparent );
+    void processPendingAppends();
     void activateItem( playlist_item_t *p_item );
     void activateItem( const QModelIndex &index );
 };
@@ -25,6 +25,8 @@
 #include "input_manager.hpp"                            /* THEMIM */
 #include "pixmaps/types/type_unknown.xpm"
 
+#include <vlc_configuration.h>
+
 VLCModelSubInterface::VLCModelSubInterface()
 {
 }
@@ -74,6 +76,34 @@ QString VLCModel::getMeta( const QModelIndex & index, int meta )
         data().toString();
 }
 
+/* Scaled copy of an image of the art cache, saved next to it, so that the
+ * views do not decode the full size image every time. Empty if there is no
+ * such variant for that image and that size. */
+static QString artVariant( const QString & artUrl, const QSize & size )
+{
+    static const int variantSizes[] = { 64, 128, 256 };
+    static QString contentDir;
+
+    if( contentDir.isEmpty() )
+    {
+        char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+        if( !psz_cachedir )
+            return QString();
+        contentDir = qfu( psz_cachedir ) +
+                     DIR_SEP "art" DIR_SEP "content" DIR_SEP;
+        free( psz_cachedir );
+    }
+
+    if( !artUrl.startsWith( contentDir ) )
+        return QString();
+
+    int side = qMax( size.width(), size.height() );
+    for( unsigned i = 0; i < sizeof(variantSizes) / sizeof(*variantSizes); i++ )
+        if( side <= variantSizes[i] )
+            return artUrl + QString( ".%1.png" ).arg( variantSizes[i] );
+    return QString();
+}
+
 QPixmap VLCModel::getArtPixmap( const QModelIndex & index, const QSize & size )
 {
     QString artUrl = index.sibling( index.row(),
@@ -84,7 +114,13 @@ QPixmap VLCModel::getArtPixmap( const QModelIndex & index, const QSize & size )
 
     if( !QPixmapCache::find( key, artPix ))
     {
-        if( artUrl.isEmpty() || !artPix.load( artUrl ) )
+        QString variant = artVariant( artUrl, size );
+        if( !variant.isEmpty() && artPix.load( variant ) )
+        {
+            artPix = artPix.scaled( size, Qt::KeepAspectRatio, Qt::SmoothTransformation );
+            QPixmapCache::insert( key, artPix );
+        }
+        else if( artUrl.isEmpty() || !artPix.load( artUrl ) )
         {
             key = QString("noart%1%2").arg(size.width()).arg(size.height());
             if( !QPixmapCache::find( key, artPix ) )
@@ -97,6 +133,13 @@ QPixmap VLCModel::getArtPixmap( const QModelIndex & index, const QSize & size )
         }
         else
         {
+            /* Once per image and variant size */
+            if( !variant.isEmpty() )
+            {
+                int side = variant.section( '.', -2, -2 ).toInt();
+                artPix.scaled( side, side, Qt::KeepAspectRatio,
+                               Qt::SmoothTransformation ).save( variant, "PNG" );
+            }
             artPix = artPix.scaled( size, Qt::KeepAspectRatio, Qt::SmoothTransformation );
             QPixmapCache::insert( key, artPix );
         }
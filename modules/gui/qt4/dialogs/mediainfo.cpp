@@ -143,6 +143,21 @@ void MediaInfoDialog::showTab( panel i_tab = META_PANEL )
     show();
 }
 
+/* The input only posts its statistics while they are shown */
+void MediaInfoDialog::showEvent( QShowEvent *event )
+{
+    QVLCFrame::showEvent( event );
+    if( isMainInputInfo )
+        THEMIM->getIM()->setStatisticsWanted( true );
+}
+
+void MediaInfoDialog::hideEvent( QHideEvent *event )
+{
+    QVLCFrame::hideEvent( event );
+    if( isMainInputInfo )
+        THEMIM->getIM()->setStatisticsWanted( false );
+}
+
 void MediaInfoDialog::saveMeta()
 {
     MP->saveMeta();
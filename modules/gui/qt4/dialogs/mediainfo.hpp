@@ -66,6 +66,10 @@ private:
     QPushButton *saveMetaButton;
     QLineEdit   *uriLine;
 
+protected:
+    void showEvent( QShowEvent * ) Q_DECL_OVERRIDE;
+    void hideEvent( QHideEvent * ) Q_DECL_OVERRIDE;
+
 private slots:
     void updateAllTabs( input_item_t * );
     void clearAllTabs();
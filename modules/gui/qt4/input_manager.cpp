@@ -32,6 +32,7 @@
 
 #include "input_manager.hpp"
 #include "recents.hpp"
+#include "main_interface.hpp"   /* frame rate of the updates */
 
 #include <vlc_keys.h>           /* ACTION_ID */
 #include <vlc_url.h>            /* decode_URI */
@@ -43,9 +44,14 @@
 #include <QDir>
 #include <QSignalMapper>
 #include <QMessageBox>
+#include <QTimer>
 
 #include <assert.h>
 
+/* Interval of the batched updates, when the interface is shown or not (ms) */
+#define UPDATE_INTERVAL         (1000 / 60)
+#define UPDATE_INTERVAL_HIDDEN  (1000 / 4)
+
 static int ItemChanged( vlc_object_t *, const char *,
                         vlc_value_t, vlc_value_t, void * );
 static int LeafToParent( vlc_object_t *, const char *,
@@ -90,6 +96,12 @@ InputManager::InputManager( QObject *parent, intf_thread_t *_p_intf) :
     timeA        = 0;
     timeB        = 0;
     f_cache      = -1.; /* impossible initial value, different from all */
+    atomic_init( &updatesPosted, 0u );
+    atomic_init( &statsWanted, false );
+    updatesPending = 0;
+    updateTimer  = new QTimer( this );
+    updateTimer->setSingleShot( true );
+    CONNECT( updateTimer, timeout(), this, flushUpdates() );
     registerAndCheckEventIds( IMEvent::PositionUpdate, IMEvent::FullscreenControlPlanHide );
     registerAndCheckEventIds( PLEvent::PLItemAppended, PLEvent::PLEmpty );
 }
@@ -173,6 +185,8 @@ void InputManager::delInput()
     RecentsMRL::getInstance( p_intf )->setTime( p_item->psz_uri, i_time );
 
     delCallbacks();
+    updatesPending       = 0;
+    updateTimer->stop();
     i_old_playing_status = END_S;
     p_item               = NULL;
     oldName              = "";
@@ -224,6 +238,9 @@ void InputManager::customEvent( QEvent *event )
     if( i_type == IMEvent::ItemChanged )
         UpdateMeta( ple->item() );
 
+    /* The next update of this kind can be posted */
+    atomic_fetch_and( &updatesPosted, ~updateOfEvent( i_type ) );
+
     if( !hasInput() )
         return;
 
@@ -231,10 +248,10 @@ void InputManager::customEvent( QEvent *event )
     switch( i_type )
     {
     case IMEvent::PositionUpdate:
-        UpdatePosition();
+        scheduleUpdate( UPDATE_POSITION );
         break;
     case IMEvent::StatisticsUpdate:
-        UpdateStats();
+        scheduleUpdate( UPDATE_STATISTICS );
         break;
     case IMEvent::ItemChanged:
         /* Ignore ItemChanged_Type event that does not apply to our input */
@@ -282,7 +299,7 @@ void InputManager::customEvent( QEvent *event )
         emit synchroChanged();
         break;
     case IMEvent::CachingEvent:
-        UpdateCaching();
+        scheduleUpdate( UPDATE_CACHING );
         break;
     case IMEvent::BookmarksChanged:
         emit bookmarksChanged();
@@ -305,6 +322,64 @@ void InputManager::customEvent( QEvent *event )
     }
 }
 
+/* Called from the input thread. An event of the frequent updates is not
+ * posted again while the previous one is still queued, and the statistics
+ * not at all if nobody shows them. */
+unsigned InputManager::updateOfEvent( int type )
+{
+    switch( type )
+    {
+    case IMEvent::PositionUpdate:
+        return UPDATE_POSITION;
+    case IMEvent::CachingEvent:
+        return UPDATE_CACHING;
+    case IMEvent::StatisticsUpdate:
+        return UPDATE_STATISTICS;
+    default:
+        return 0;
+    }
+}
+
+bool InputManager::wantsEvent( IMEvent::event_types type )
+{
+    unsigned update = updateOfEvent( type );
+
+    if( update == 0 )
+        return true;
+    if( update == UPDATE_STATISTICS && !atomic_load( &statsWanted ) )
+        return false;
+    return !( atomic_fetch_or( &updatesPosted, update ) & update );
+}
+
+/* The first update is applied at once, the following ones are gathered
+ * until the end of the frame */
+void InputManager::scheduleUpdate( unsigned update )
+{
+    updatesPending |= update;
+    if( !updateTimer->isActive() )
+        flushUpdates();
+}
+
+void InputManager::flushUpdates()
+{
+    if( !updatesPending || !hasInput() )
+        return;
+
+    unsigned updates = updatesPending;
+    updatesPending = 0;
+
+    if( updates & UPDATE_POSITION )
+        UpdatePosition();
+    if( updates & UPDATE_CACHING )
+        UpdateCaching();
+    if( updates & UPDATE_STATISTICS )
+        UpdateStats();
+
+    MainInterface *p_mi = p_intf->p_sys->p_mi;
+    bool b_hidden = p_mi && ( p_mi->isHidden() || p_mi->isMinimized() );
+    updateTimer->start( b_hidden ? UPDATE_INTERVAL_HIDDEN : UPDATE_INTERVAL );
+}
+
 /* Add the callbacks on Input. Self explanatory */
 inline void InputManager::addCallbacks()
 {
@@ -422,7 +497,12 @@ static int InputEvent( vlc_object_t *p_this, const char *,
     }
 
     if( event )
-        QApplication::postEvent( im, event );
+    {
+        if( im->wantsEvent( (IMEvent::event_types)event->type() ) )
+            QApplication::postEvent( im, event );
+        else
+            delete event;
+    }
     return VLC_SUCCESS;
 }
 
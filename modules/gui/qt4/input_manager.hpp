@@ -30,6 +30,7 @@
 #endif
 
 #include <vlc_input.h>
+#include <vlc_atomic.h>
 
 #include "qt4.hpp"
 #include "util/singleton.hpp"
@@ -38,6 +39,7 @@
 #include <QObject>
 #include <QEvent>
 class QSignalMapper;
+class QTimer;
 
 enum { NORMAL,    /* loop: 0, repeat: 0 */
        REPEAT_ONE,/* loop: 0, repeat: 1 */
@@ -147,6 +149,11 @@ public:
     QString getName() { return oldName; }
     static const QString decodeArtURL( input_item_t *p_item );
 
+    /* Called from the input thread: whether the event must be posted */
+    bool wantsEvent( IMEvent::event_types );
+    /* Whether someone displays the statistics */
+    void setStatisticsWanted( bool b ) { atomic_store( &statsWanted, b ); }
+
 private:
     intf_thread_t  *p_intf;
     input_thread_t *p_input;
@@ -161,7 +168,22 @@ private:
     bool            b_video;
     mtime_t         timeA, timeB;
 
+    /* The frequent updates (position, buffering, statistics) are batched
+     * and applied at most once per UI frame */
+    enum
+    {
+        UPDATE_POSITION   = 0x1,
+        UPDATE_CACHING    = 0x2,
+        UPDATE_STATISTICS = 0x4,
+    };
+    atomic_uint     updatesPosted; /* events in the Qt queue */
+    atomic_bool     statsWanted;
+    unsigned        updatesPending;
+    QTimer         *updateTimer;
+
     void customEvent( QEvent * );
+    static unsigned updateOfEvent( int );
+    void scheduleUpdate( unsigned );
 
     void addCallbacks();
     void delCallbacks();
@@ -213,6 +235,7 @@ public slots:
 
 private slots:
     void AtoBLoop( float, int64_t, int );
+    void flushUpdates();
 
 signals:
     /// Send new position, new time and new length
@@ -37,6 +37,7 @@
 #include <QPainter>
 #include <QBitmap>
 #include <QStyleOptionSlider>
+#include <QStyle>
 #include <QLinearGradient>
 #include <QTimer>
 #include <QRadialGradient>
@@ -179,7 +180,15 @@ void SeekSlider::setPosition( float pos, int64_t time, int length )
         setEnabled( b_seekable );
 
     if( !isSliding )
-        setValue( (int)( pos * 1000.0 ) );
+    {
+        /* Only repaint when the handle moves by a pixel at least */
+        int i_value = (int)( pos * 1000.0 );
+        int i_span = orientation() == Qt::Horizontal ? width() : height();
+        if( i_span <= 0
+         || QStyle::sliderPositionFromValue( minimum(), maximum(), i_value, i_span )
+         != QStyle::sliderPositionFromValue( minimum(), maximum(), value(), i_span ) )
+            setValue( i_value );
+    }
 
     inputLength = length;
 }
@@ -51,7 +51,8 @@ CtrlText::CtrlText( intf_thread_t *pIntf, VarText &rVariable,
     m_cmdMove( this ), m_pEvt( NULL ), m_rFont( rFont ),
     m_color( color ), m_scrollMode( scrollMode ), m_alignment( alignment ),
     m_pFocus( pFocus), m_pImg( NULL ), m_pImgDouble( NULL ),
-    m_pCurrImg( NULL ), m_xPos( 0 ), m_xOffset( 0 ),
+    m_text( pIntf, "" ), m_textColor( color ), m_pCurrImg( NULL ),
+    m_xPos( 0 ), m_xOffset( 0 ),
     m_cmdUpdateText( this )
 {
     m_pTimer = OSFactory::instance( pIntf )->createOSTimer( m_cmdUpdateText );
@@ -246,17 +247,21 @@ void CtrlText::onUpdate( Subject<VarBool> &rVariable, void *arg  )
 
 void CtrlText::setPictures( const UString &rText )
 {
+    // The text is rendered again when the control is shown
+    if( m_pImg && rText == m_text && m_color == m_textColor )
+        return;
+    m_text = rText;
+    m_textColor = m_color;
+
     // reset the images ('normal' and 'double') from the text
     // 'Normal' image
     delete m_pImg;
     m_pImg = m_rFont.drawString( rText, m_color );
-    if( !m_pImg )
-        return;
 
-    // 'Double' image
-    const UString doubleStringWithSep = rText + SEPARATOR_STRING + rText;
+    // 'Double' image, rendered by updateContext() if needed
     delete m_pImgDouble;
-    m_pImgDouble = m_rFont.drawString( doubleStringWithSep, m_color );
+    m_pImgDouble = NULL;
+    m_pCurrImg = NULL;
 }
 
 
@@ -276,6 +281,13 @@ void CtrlText::updateContext()
     }
     else
     {
+        if( !m_pImgDouble )
+        {
+            const UString doubleStringWithSep =
+                m_text + SEPARATOR_STRING + m_text;
+            m_pImgDouble = m_rFont.drawString( doubleStringWithSep,
+                                               m_textColor );
+        }
         m_pCurrImg = m_pImgDouble;
     }
 
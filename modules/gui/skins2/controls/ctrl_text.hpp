@@ -109,7 +109,11 @@ private:
     GenericBitmap *m_pImg;
     /// Image of the text, repeated twice and with some blank between;
     /// useful to display a 'circular' moving text...
+    /// Only rendered when the text is wider than the control
     GenericBitmap *m_pImgDouble;
+    /// Text and color of the images, rendered again only when they change
+    UString m_text;
+    uint32_t m_textColor;
     /// Current image (should always be equal to m_pImg or m_pImgDouble)
     GenericBitmap *m_pCurrImg;
     /// Position of the left side of the moving text (always <= 0)
@@ -83,11 +83,15 @@ ArtBitmap* ArtManager::getArtBitmap( string uriName )
         return NULL;
 
     // check whether art is already loaded
-    list<ArtBitmap*>::const_iterator it;
+    list<ArtBitmap*>::iterator it;
     for( it = m_listBitmap.begin(); it != m_listBitmap.end(); ++it )
     {
         if( (*it)->getUriName() == uriName )
-            return *it;
+        {
+            // keep the most recently used art at the back
+            m_listBitmap.splice( m_listBitmap.end(), m_listBitmap, it );
+            return m_listBitmap.back();
+        }
     }
 
     // create and retain a new ArtBitmap since uri is not yet known
@@ -313,14 +313,8 @@ void Win32Graphics::drawRect( int left, int top, int width, int height,
 
 void Win32Graphics::applyMaskToWindow( OSWindow &rWindow )
 {
-    // Get window handle
-    HWND hWnd = ((Win32Window&)rWindow).getHandle();
-
     // Apply the mask
-    // We need to copy the mask, because SetWindowRgn modifies it in our back
-    HRGN mask = CreateRectRgn( 0, 0, 0, 0 );
-    CombineRgn( mask, m_mask, NULL, RGN_COPY );
-    SetWindowRgn( hWnd, mask, TRUE );
+    ((Win32Window&)rWindow).setShape( m_mask );
 }
 
 
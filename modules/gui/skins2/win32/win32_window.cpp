@@ -50,7 +50,7 @@ Win32Window::Win32Window( intf_thread_t *pIntf, GenericWindow &rWindow,
                           Win32Window *pParentWindow,
                           GenericWindow::WindowType_t type ):
     OSWindow( pIntf ), m_dragDrop( dragDrop ), m_isLayered( false ),
-    m_pParent( pParentWindow ), m_type ( type )
+    m_pParent( pParentWindow ), m_type ( type ), m_shape( NULL )
 {
     (void)hParentWindow;
     Win32Factory *pFactory = (Win32Factory*)Win32Factory::instance( getIntf() );
@@ -142,6 +142,8 @@ Win32Window::~Win32Window()
 
         DestroyWindow( m_hWnd );
     }
+    if( m_shape )
+        DeleteObject( m_shape );
 }
 
 
@@ -164,6 +166,24 @@ bool Win32Window::invalidateRect( int x, int y, int w, int h) const
 }
 
 
+void Win32Window::setShape( HRGN mask )
+{
+    // Most redraws of a layout leave its mask unchanged, and
+    // SetWindowRgn() repaints the whole window
+    if( m_shape && EqualRgn( m_shape, mask ) )
+        return;
+
+    // We need to copy the mask, because SetWindowRgn modifies it in our back
+    HRGN windowMask = CreateRectRgn( 0, 0, 0, 0 );
+    CombineRgn( windowMask, mask, NULL, RGN_COPY );
+    SetWindowRgn( m_hWnd, windowMask, TRUE );
+
+    if( !m_shape )
+        m_shape = CreateRectRgn( 0, 0, 0, 0 );
+    CombineRgn( m_shape, mask, NULL, RGN_COPY );
+}
+
+
 void Win32Window::show() const
 {
 
@@ -71,6 +71,9 @@ public:
     /// invalidate a window surface
     bool invalidateRect( int x, int y, int w, int h ) const;
 
+    /// Set the shape of the window, if it changed
+    void setShape( HRGN mask );
+
 private:
     /// Window handle
     HWND m_hWnd;
@@ -86,6 +89,8 @@ private:
     Win32Window *m_pParent;
     /// window type
     GenericWindow::WindowType_t m_type;
+    /// Copy of the current shape of the window (NULL if not set yet)
+    HRGN m_shape;
 
 };
 
@@ -26,7 +26,6 @@
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
-#include <X11/extensions/shape.h>
 
 #include "x11_display.hpp"
 #include "x11_graphics.hpp"
@@ -318,12 +317,8 @@ void X11Graphics::drawRect( int left, int top, int width, int height,
 
 void X11Graphics::applyMaskToWindow( OSWindow &rWindow )
 {
-    // Get the target window
-    Window win = ((X11Window&)rWindow).getDrawable();
-
     // Change the shape of the window
-    XShapeCombineRegion( XDISPLAY, win, ShapeBounding, 0, 0, m_mask,
-                         ShapeSet );
+    ((X11Window&)rWindow).setShape( m_mask );
 }
 
 
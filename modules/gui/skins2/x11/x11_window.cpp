@@ -25,6 +25,7 @@
 #ifdef X11_SKINS
 
 #include <X11/Xatom.h>
+#include <X11/extensions/shape.h>
 
 #include "../src/generic_window.hpp"
 #include "../src/vlcproc.hpp"
@@ -42,7 +43,8 @@ X11Window::X11Window( intf_thread_t *pIntf, GenericWindow &rWindow,
                       X11Display &rDisplay, bool dragDrop, bool playOnDrop,
                       X11Window *pParentWindow, GenericWindow::WindowType_t type ):
     OSWindow( pIntf ), m_rDisplay( rDisplay ), m_pParent( pParentWindow ),
-    m_dragDrop( dragDrop ), m_pDropTarget( NULL ), m_type ( type )
+    m_dragDrop( dragDrop ), m_pDropTarget( NULL ), m_type ( type ),
+    m_shape( NULL )
 {
     XSetWindowAttributes attr;
     unsigned long valuemask;
@@ -232,10 +234,28 @@ X11Window::~X11Window()
 
     delete m_pDropTarget;
 
+    if( m_shape )
+        XDestroyRegion( m_shape );
     XDestroyWindow( XDISPLAY, m_wnd );
     XSync( XDISPLAY, False );
 }
 
+void X11Window::setShape( Region mask )
+{
+    // Most redraws of a layout leave its mask unchanged: reshaping the
+    // window would make the window manager redraw all of it
+    if( m_shape && XEqualRegion( m_shape, mask ) )
+        return;
+
+    XShapeCombineRegion( XDISPLAY, m_wnd, ShapeBounding, 0, 0, mask,
+                         ShapeSet );
+
+    if( !m_shape )
+        m_shape = XCreateRegion();
+    XSubtractRegion( m_shape, m_shape, m_shape );
+    XUnionRegion( m_shape, mask, m_shape );
+}
+
 void X11Window::reparent( uint32_t OSHandle, int x, int y, int w, int h )
 {
     // Reparent the window
@@ -26,6 +26,7 @@
 #define X11_WINDOW_HPP
 
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
 #include <X11/Xatom.h>
 
 #include "../src/generic_window.hpp"
@@ -79,6 +80,9 @@ public:
     /// invalidate a window surface
     bool invalidateRect( int x, int y, int w, int h ) const;
 
+    /// Set the shape of the window, if it changed
+    void setShape( Region mask );
+
     void setFullscreen() const;
 
 private:
@@ -96,6 +100,8 @@ private:
     X11DragDrop *m_pDropTarget;
     /// window type
     GenericWindow::WindowType_t m_type;
+    /// Current shape of the window (NULL if not set yet)
+    Region m_shape;
 };
 
 
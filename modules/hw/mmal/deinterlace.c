@@ -249,7 +249,8 @@ static int Open(filter_t *filter)
         goto out;
     }
 
-    sys->output->buffer_num = sys->output->buffer_num_recommended;
+    sys->output->buffer_num = sys->output->buffer_num_recommended +
+            NUM_VOUT_HELD_PICTURES;
     status = mmal_port_enable(sys->output, output_port_cb);
     if (status != MMAL_SUCCESS) {
         msg_Err(filter, "Failed to enable output port %s (status=%"PRIx32" %s)",
@@ -383,8 +384,9 @@ out:
 static void fill_output_port(filter_t *filter)
 {
     filter_sys_t *sys = filter->p_sys;
-    /* allow at least 2 buffers in transit */
-    unsigned max_buffers_in_transit = __MAX(sys->output->buffer_num,
+    /* allow at least 2 buffers in transit, the rest of the pool is for the
+     * pictures held by the video output */
+    unsigned max_buffers_in_transit = __MAX(sys->output->buffer_num_recommended,
             MIN_NUM_BUFFERS_IN_TRANSIT);
     unsigned buffers_available = mmal_queue_length(sys->output_pool->queue);
     unsigned buffers_to_send = max_buffers_in_transit - sys->output_in_transit;
@@ -27,6 +27,15 @@
 /* Think twice before changing this. Incorrect values cause havoc. */
 #define NUM_ACTUAL_OPAQUE_BUFFERS 40
 
+/* Pictures queued by the video output to the renderer */
+#define MMAL_VOUT_BUFFERS_IN_TRANSIT 1
+
+/* Pictures held downstream of a filter by the video output: the current and
+ * next pictures of the core, and those queued to the renderer. A filter
+ * producing opaque pictures from its own pool needs as many on top of the
+ * ones its component works on, or it waits on the display for every frame. */
+#define NUM_VOUT_HELD_PICTURES (2 + MMAL_VOUT_BUFFERS_IN_TRANSIT)
+
 struct picture_sys_t {
     vlc_object_t *owner;
 
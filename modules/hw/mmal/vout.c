@@ -42,9 +42,12 @@
 #include <interface/vmcs_host/vc_tvservice.h>
 #include <interface/vmcs_host/vc_dispmanx.h>
 
-#define MAX_BUFFERS_IN_TRANSIT 1
 #define VC_TV_MAX_MODE_IDS 127
 
+/* Attributes changed by vc_dispmanx_element_change_attributes() */
+#define ELEMENT_CHANGE_OPACITY (1 << 1)
+#define ELEMENT_CHANGE_DEST_RECT (1 << 2)
+
 #define MMAL_LAYER_NAME "mmal-layer"
 #define MMAL_LAYER_TEXT N_("VideoCore layer where the video is displayed.")
 #define MMAL_LAYER_LONGTEXT N_("VideoCore layer where the video is displayed. Subpictures are displayed directly above and a black background directly below.")
@@ -80,7 +83,7 @@ vlc_module_end()
 
 struct dmx_region_t {
     struct dmx_region_t *next;
-    picture_t *picture;
+    uint8_t *pixels; /* copy of the bitmap last written to the resource */
     VC_RECT_T bmp_rect;
     VC_RECT_T src_rect;
     VC_RECT_T dst_rect;
@@ -166,8 +169,12 @@ static void display_subpicture(vout_display_t *vd, subpicture_t *subpicture);
 static void close_dmx(vout_display_t *vd);
 static struct dmx_region_t *dmx_region_new(vout_display_t *vd,
                 DISPMANX_UPDATE_HANDLE_T update, subpicture_region_t *region);
+static bool dmx_region_changed(struct dmx_region_t *dmx_region,
+                picture_t *picture);
 static void dmx_region_update(struct dmx_region_t *dmx_region,
                 DISPMANX_UPDATE_HANDLE_T update, picture_t *picture);
+static void dmx_region_move(struct dmx_region_t *dmx_region,
+                DISPMANX_UPDATE_HANDLE_T update, subpicture_region_t *region);
 static void dmx_region_delete(struct dmx_region_t *dmx_region,
                 DISPMANX_UPDATE_HANDLE_T update);
 static void show_background(vout_display_t *vd, bool enable);
@@ -590,7 +597,7 @@ static void vd_display(vout_display_t *vd, picture_t *picture,
     sys->next_phase_check = (sys->next_phase_check + 1) % PHASE_CHECK_INTERVAL;
 
     vlc_mutex_lock(&sys->buffer_mutex);
-    while (sys->buffers_in_transit >= MAX_BUFFERS_IN_TRANSIT)
+    while (sys->buffers_in_transit >= MMAL_VOUT_BUFFERS_IN_TRANSIT)
         vlc_cond_wait(&sys->buffer_cond, &sys->buffer_mutex);
     vlc_mutex_unlock(&sys->buffer_mutex);
 }
@@ -823,6 +830,7 @@ static void display_subpicture(vout_display_t *vd, subpicture_t *subpicture)
     struct dmx_region_t **dmx_region = &sys->dmx_region;
     struct dmx_region_t *unused_dmx_region;
     DISPMANX_UPDATE_HANDLE_T update = 0;
+    bool deleted = false;
     picture_t *picture;
     video_format_t *fmt;
     struct dmx_region_t *dmx_region_next;
@@ -838,20 +846,30 @@ static void display_subpicture(vout_display_t *vd, subpicture_t *subpicture)
                     update = vc_dispmanx_update_start(10);
                 *dmx_region = dmx_region_new(vd, update, region);
             } else if(((*dmx_region)->bmp_rect.width != (int32_t)fmt->i_visible_width) ||
-                    ((*dmx_region)->bmp_rect.height != (int32_t)fmt->i_visible_height) ||
-                    ((*dmx_region)->pos_x != region->i_x) ||
-                    ((*dmx_region)->pos_y != region->i_y) ||
-                    ((*dmx_region)->alpha.opacity != (uint32_t)region->i_alpha)) {
+                    ((*dmx_region)->bmp_rect.height != (int32_t)fmt->i_visible_height)) {
                 dmx_region_next = (*dmx_region)->next;
                 if(!update)
                     update = vc_dispmanx_update_start(10);
                 dmx_region_delete(*dmx_region, update);
+                deleted = true;
                 *dmx_region = dmx_region_new(vd, update, region);
                 (*dmx_region)->next = dmx_region_next;
-            } else if((*dmx_region)->picture != picture) {
-                if(!update)
-                    update = vc_dispmanx_update_start(10);
-                dmx_region_update(*dmx_region, update, picture);
+            } else {
+                /* Fades and moves only change the attributes of the element */
+                if(((*dmx_region)->pos_x != region->i_x) ||
+                        ((*dmx_region)->pos_y != region->i_y) ||
+                        ((*dmx_region)->alpha.opacity != (uint32_t)region->i_alpha)) {
+                    if(!update)
+                        update = vc_dispmanx_update_start(10);
+                    dmx_region_move(*dmx_region, update, region);
+                }
+                /* Text is rendered again for every frame, mostly to the same
+                 * bitmap: only upload it when it changed */
+                if(dmx_region_changed(*dmx_region, picture)) {
+                    if(!update)
+                        update = vc_dispmanx_update_start(10);
+                    dmx_region_update(*dmx_region, update, picture);
+                }
             }
 
             dmx_region = &(*dmx_region)->next;
@@ -866,12 +884,19 @@ static void display_subpicture(vout_display_t *vd, subpicture_t *subpicture)
         if(!update)
             update = vc_dispmanx_update_start(10);
         dmx_region_delete(unused_dmx_region, update);
+        deleted = true;
         unused_dmx_region = dmx_region_next;
     }
     *dmx_region = NULL;
 
-    if(update)
-        vc_dispmanx_update_submit_sync(update);
+    /* Waiting for the vsync would stall the display of the next picture;
+     * only do so when removed elements must be gone before returning. */
+    if(update) {
+        if(deleted)
+            vc_dispmanx_update_submit_sync(update);
+        else
+            vc_dispmanx_update_submit(update, NULL, NULL);
+    }
 }
 
 static void close_dmx(vout_display_t *vd)
@@ -922,6 +947,19 @@ static struct dmx_region_t *dmx_region_new(vout_display_t *vd,
                     region->p_picture->p[0].i_pitch,
                     region->p_picture->p[0].p_pixels, &dmx_region->bmp_rect);
 
+    dmx_region->pixels = malloc(dmx_region->bmp_rect.width * 4 *
+                    dmx_region->bmp_rect.height);
+    if(dmx_region->pixels) {
+        const uint8_t *src = region->p_picture->p[0].p_pixels;
+        uint8_t *dst = dmx_region->pixels;
+
+        for(int32_t y = 0; y < dmx_region->bmp_rect.height; y++) {
+            memcpy(dst, src, dmx_region->bmp_rect.width * 4);
+            src += region->p_picture->p[0].i_pitch;
+            dst += dmx_region->bmp_rect.width * 4;
+        }
+    }
+
     dmx_region->alpha.flags = DISPMANX_FLAGS_ALPHA_FROM_SOURCE | DISPMANX_FLAGS_ALPHA_MIX;
     dmx_region->alpha.opacity = region->i_alpha;
     dmx_region->alpha.mask = DISPMANX_NO_HANDLE;
@@ -931,18 +969,56 @@ static struct dmx_region_t *dmx_region_new(vout_display_t *vd,
                     &dmx_region->alpha, NULL, VC_IMAGE_ROT0);
 
     dmx_region->next = NULL;
-    dmx_region->picture = region->p_picture;
 
     return dmx_region;
 }
 
+/* Compares the bitmap with the copy of the last one written, and updates the
+ * copy from the first line that differs */
+static bool dmx_region_changed(struct dmx_region_t *dmx_region,
+                picture_t *picture)
+{
+    const size_t line = dmx_region->bmp_rect.width * 4;
+    const uint8_t *src = picture->p[0].p_pixels;
+    uint8_t *dst = dmx_region->pixels;
+    bool changed = false;
+
+    if(!dst)
+        return true;
+
+    for(int32_t y = 0; y < dmx_region->bmp_rect.height; y++) {
+        if(changed || memcmp(dst, src, line)) {
+            memcpy(dst, src, line);
+            changed = true;
+        }
+        src += picture->p[0].i_pitch;
+        dst += line;
+    }
+
+    return changed;
+}
+
 static void dmx_region_update(struct dmx_region_t *dmx_region,
                 DISPMANX_UPDATE_HANDLE_T update, picture_t *picture)
 {
     vc_dispmanx_resource_write_data(dmx_region->resource, VC_IMAGE_RGBA32,
                     picture->p[0].i_pitch, picture->p[0].p_pixels, &dmx_region->bmp_rect);
     vc_dispmanx_element_change_source(update, dmx_region->element, dmx_region->resource);
-    dmx_region->picture = picture;
+}
+
+static void dmx_region_move(struct dmx_region_t *dmx_region,
+                DISPMANX_UPDATE_HANDLE_T update, subpicture_region_t *region)
+{
+    dmx_region->pos_x = region->i_x;
+    dmx_region->pos_y = region->i_y;
+    vc_dispmanx_rect_set(&dmx_region->dst_rect, region->i_x, region->i_y,
+                    dmx_region->bmp_rect.width, dmx_region->bmp_rect.height);
+    dmx_region->alpha.opacity = region->i_alpha;
+
+    vc_dispmanx_element_change_attributes(update, dmx_region->element,
+                    ELEMENT_CHANGE_OPACITY | ELEMENT_CHANGE_DEST_RECT, 0,
+                    region->i_alpha, &dmx_region->dst_rect, NULL,
+                    DISPMANX_NO_HANDLE, VC_IMAGE_ROT0);
 }
 
 static void dmx_region_delete(struct dmx_region_t *dmx_region,
@@ -950,6 +1026,7 @@ static void dmx_region_delete(struct dmx_region_t *dmx_region,
 {
     vc_dispmanx_element_remove(update, dmx_region->element);
     vc_dispmanx_resource_delete(dmx_region->resource);
+    free(dmx_region->pixels);
     free(dmx_region);
 }
 
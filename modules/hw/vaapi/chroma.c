@@ -0,0 +1,240 @@
+/*****************************************************************************
+ * chroma.c: VA-API surface download to system memory
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include "vlc_vaapi.h"
+#include "../../video_chroma/copy.h"
+
+/* This is the fallback for video outputs that cannot import VA surfaces:
+ * the surfaces are copied back to system memory, as the decoder used to. */
+
+struct filter_sys_t
+{
+    VADisplay    display; /* display of the current image */
+    VAImage      image;   /* VA_INVALID_ID if vaDeriveImage() is used */
+    picture_t   *ref;     /* keeps the display of the image alive */
+    bool         derive;
+    copy_cache_t cache;
+};
+
+static void ImageDestroy(filter_sys_t *sys)
+{
+    if (sys->image.image_id != VA_INVALID_ID)
+        vaDestroyImage(sys->display, sys->image.image_id);
+    if (sys->ref != NULL)
+        picture_Release(sys->ref);
+    sys->image.image_id = VA_INVALID_ID;
+    sys->ref = NULL;
+    sys->display = NULL;
+}
+
+static bool IsSupported(uint32_t fourcc)
+{
+    return fourcc == VA_FOURCC_NV12 || fourcc == VA_FOURCC_YV12
+        || fourcc == VA_FOURCC_IYUV;
+}
+
+/* Selects how to read the surfaces of a (new) VA display */
+static int ImageSetup(filter_t *filter, picture_t *pic)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const vlc_vaapi_surface_t *surface = vlc_vaapi_PictureGetSurface(pic);
+    unsigned width = filter->fmt_in.video.i_width;
+    unsigned height = filter->fmt_in.video.i_height;
+    VAImage image;
+
+    ImageDestroy(sys);
+    sys->display = surface->display;
+    sys->derive = false;
+
+    if (vaDeriveImage(sys->display, surface->id, &image) == VA_STATUS_SUCCESS)
+    {
+        sys->derive = IsSupported(image.format.fourcc);
+        vaDestroyImage(sys->display, image.image_id);
+        if (sys->derive)
+            return VLC_SUCCESS;
+    }
+
+    int count = vaMaxNumImageFormats(sys->display);
+    VAImageFormat *fmts = calloc(count, sizeof (*fmts));
+    if (unlikely(fmts == NULL))
+        return VLC_ENOMEM;
+
+    if (vaQueryImageFormats(sys->display, fmts, &count) == VA_STATUS_SUCCESS)
+        for (int i = 0; i < count; i++)
+        {
+            if (!IsSupported(fmts[i].fourcc))
+                continue;
+            if (vaCreateImage(sys->display, &fmts[i], width, height,
+                              &sys->image) == VA_STATUS_SUCCESS)
+                break;
+            sys->image.image_id = VA_INVALID_ID;
+        }
+    free(fmts);
+
+    if (sys->image.image_id == VA_INVALID_ID)
+    {
+        msg_Err(filter, "no supported VA image format");
+        sys->display = NULL;
+        return VLC_EGENERIC;
+    }
+    sys->ref = picture_Hold(pic);
+    return VLC_SUCCESS;
+}
+
+static picture_t *Download(filter_t *filter, picture_t *src)
+{
+    filter_sys_t *sys = filter->p_sys;
+    vlc_vaapi_surface_t *surface = vlc_vaapi_PictureGetSurface(src);
+    unsigned width = filter->fmt_in.video.i_width;
+    unsigned height = filter->fmt_in.video.i_height;
+    picture_t *dst = NULL;
+    VAImage image;
+    void *base;
+
+    if (unlikely(surface == NULL))
+    {
+        msg_Err(filter, "corrupt VA surface %p", src);
+        goto out;
+    }
+
+    if (sys->display != surface->display
+     && ImageSetup(filter, src) != VLC_SUCCESS)
+        goto out;
+
+    if (sys->derive)
+    {
+        if (vaDeriveImage(sys->display, surface->id, &image))
+            goto out;
+    }
+    else
+    {
+        if (vaGetImage(sys->display, surface->id, 0, 0, width, height,
+                       sys->image.image_id))
+            goto out;
+        image = sys->image;
+    }
+
+    if (vaMapBuffer(sys->display, image.buf, &base))
+        goto error;
+
+    dst = filter_NewPicture(filter);
+    if (dst != NULL)
+    {
+        uint8_t *planes[3];
+        size_t pitches[3];
+
+        picture_CopyProperties(dst, src);
+        if (image.format.fourcc == VA_FOURCC_NV12)
+        {
+            for (unsigned i = 0; i < 2; i++)
+            {
+                planes[i] = (uint8_t *)base + image.offsets[i];
+                pitches[i] = image.pitches[i];
+            }
+            CopyFromNv12(dst, planes, pitches, width, height, &sys->cache);
+        }
+        else
+        {
+            bool swap_uv = image.format.fourcc == VA_FOURCC_IYUV;
+
+            for (unsigned i = 0; i < 3; i++)
+            {
+                unsigned plane = (swap_uv && i != 0) ? (3 - i) : i;
+
+                planes[i] = (uint8_t *)base + image.offsets[plane];
+                pitches[i] = image.pitches[plane];
+            }
+            CopyFromYv12(dst, planes, pitches, width, height, &sys->cache);
+        }
+    }
+    vaUnmapBuffer(sys->display, image.buf);
+error:
+    if (sys->derive)
+        vaDestroyImage(sys->display, image.image_id);
+out:
+    picture_Release(src);
+    return dst;
+}
+
+static int Open(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+
+    if (filter->fmt_in.video.i_chroma != VLC_CODEC_VAAPI_420
+     || filter->fmt_out.video.i_chroma != VLC_CODEC_YV12)
+        return VLC_EGENERIC;
+
+    if (filter->fmt_in.video.i_visible_width
+                                       != filter->fmt_out.video.i_visible_width
+     || filter->fmt_in.video.i_visible_height
+                                      != filter->fmt_out.video.i_visible_height
+     || filter->fmt_in.video.i_x_offset != filter->fmt_out.video.i_x_offset
+     || filter->fmt_in.video.i_y_offset != filter->fmt_out.video.i_y_offset
+     || (filter->fmt_in.video.i_sar_num * filter->fmt_out.video.i_sar_den
+          != filter->fmt_in.video.i_sar_den * filter->fmt_out.video.i_sar_num))
+        return VLC_EGENERIC;
+
+    filter_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    if (CopyInitCache(&sys->cache, filter->fmt_in.video.i_width))
+    {
+        free(sys);
+        return VLC_ENOMEM;
+    }
+    sys->display = NULL;
+    sys->image.image_id = VA_INVALID_ID;
+    sys->ref = NULL;
+    sys->derive = false;
+
+    filter->pf_video_filter = Download;
+    filter->p_sys = sys;
+    return VLC_SUCCESS;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    filter_sys_t *sys = filter->p_sys;
+
+    ImageDestroy(sys);
+    CopyCleanCache(&sys->cache);
+    free(sys);
+}
+
+vlc_module_begin()
+    set_shortname(N_("VA-API"))
+    set_description(N_("VA-API surface conversions"))
+    set_capability("video filter2", 10)
+    set_category(CAT_VIDEO)
+    set_subcategory(SUBCAT_VIDEO_VFILTER)
+    set_callbacks(Open, Close)
+vlc_module_end()
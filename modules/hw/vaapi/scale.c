@@ -0,0 +1,293 @@
+/*****************************************************************************
+ * scale.c: VA-API video post-processing scaler
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_atomic.h>
+#include <va/va_vpp.h>
+#include "vlc_vaapi.h"
+
+/* Resizes VA surfaces on the GPU, so that the pictures stay in video memory
+ * until they are downloaded, if ever, and are downloaded at the output size.
+ * A filter chain resizing VLC_CODEC_VAAPI_420 pictures picks it before the
+ * conversion to system memory. */
+
+/* Scaled surfaces, as many as the pictures held downstream at once */
+#define SCALE_SURFACES 8
+
+/* The surfaces are referenced by the filter and by the pictures they are
+ * attached to, and destroyed with the last of them */
+typedef struct
+{
+    atomic_uintptr_t refs;
+    VADisplay        display;
+    picture_t       *ref; /* keeps the VA display alive */
+    VAConfigID       config;
+    VAContextID      context;
+    VASurfaceID      surfaces[SCALE_SURFACES];
+    atomic_bool      used[SCALE_SURFACES];
+} scale_pool_t;
+
+typedef struct
+{
+    vlc_vaapi_surface_t context; /* must be first */
+    scale_pool_t       *pool;
+    unsigned            index;
+} scale_picture_t;
+
+struct filter_sys_t
+{
+    scale_pool_t *pool;
+};
+
+static void PoolRelease(scale_pool_t *pool)
+{
+    if (atomic_fetch_sub(&pool->refs, 1) != 1)
+        return;
+
+    if (pool->context != VA_INVALID_ID)
+        vaDestroyContext(pool->display, pool->context);
+    if (pool->surfaces[0] != VA_INVALID_SURFACE)
+        vaDestroySurfaces(pool->display, pool->surfaces, SCALE_SURFACES);
+    if (pool->config != VA_INVALID_ID)
+        vaDestroyConfig(pool->display, pool->config);
+    picture_Release(pool->ref);
+    free(pool);
+}
+
+static scale_pool_t *PoolNew(filter_t *filter, picture_t *pic)
+{
+    const video_format_t *fmt = &filter->fmt_out.video;
+    scale_pool_t *pool = malloc(sizeof (*pool));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    atomic_init(&pool->refs, 1);
+    pool->display = vlc_vaapi_PictureGetSurface(pic)->display;
+    pool->ref = picture_Hold(pic);
+    pool->config = VA_INVALID_ID;
+    pool->context = VA_INVALID_ID;
+    pool->surfaces[0] = VA_INVALID_SURFACE;
+    for (unsigned i = 0; i < SCALE_SURFACES; i++)
+        atomic_init(&pool->used[i], false);
+
+    if (vaCreateConfig(pool->display, VAProfileNone, VAEntrypointVideoProc,
+                       NULL, 0, &pool->config))
+    {
+        pool->config = VA_INVALID_ID;
+        msg_Err(filter, "no VA video processing");
+        goto error;
+    }
+    if (vaCreateSurfaces(pool->display, VA_RT_FORMAT_YUV420,
+                         fmt->i_width, fmt->i_height,
+                         pool->surfaces, SCALE_SURFACES, NULL, 0))
+    {
+        pool->surfaces[0] = VA_INVALID_SURFACE;
+        goto error;
+    }
+    if (vaCreateContext(pool->display, pool->config,
+                        fmt->i_width, fmt->i_height, VA_PROGRESSIVE,
+                        pool->surfaces, SCALE_SURFACES, &pool->context))
+    {
+        pool->context = VA_INVALID_ID;
+        goto error;
+    }
+    return pool;
+error:
+    msg_Err(filter, "cannot create %ux%u VA video processing surfaces",
+            fmt->i_width, fmt->i_height);
+    PoolRelease(pool);
+    return NULL;
+}
+
+static void PictureDestroy(void *opaque)
+{
+    scale_picture_t *pic = opaque;
+
+    atomic_store(&pic->pool->used[pic->index], false);
+    PoolRelease(pic->pool);
+    free(pic);
+}
+
+/* Attaches a free surface of the pool to the picture */
+static int Attach(scale_pool_t *pool, picture_t *dst)
+{
+    for (unsigned i = 0; i < SCALE_SURFACES; i++)
+    {
+        if (atomic_exchange(&pool->used[i], true))
+            continue;
+
+        scale_picture_t *pic = malloc(sizeof (*pic));
+        if (unlikely(pic == NULL))
+        {
+            atomic_store(&pool->used[i], false);
+            return VLC_ENOMEM;
+        }
+        pic->context.destroy = PictureDestroy;
+        pic->context.display = pool->display;
+        pic->context.id = pool->surfaces[i];
+        pic->pool = pool;
+        pic->index = i;
+        atomic_fetch_add(&pool->refs, 1);
+
+        assert(dst->context == NULL);
+        dst->context = pic;
+        return VLC_SUCCESS;
+    }
+    return VLC_EGENERIC;
+}
+
+static int Render(filter_t *filter, VASurfaceID src, VASurfaceID dst)
+{
+    scale_pool_t *pool = filter->p_sys->pool;
+    const video_format_t *in = &filter->fmt_in.video;
+    const video_format_t *out = &filter->fmt_out.video;
+    VARectangle src_rect = {
+        .x = in->i_x_offset, .y = in->i_y_offset,
+        .width = in->i_visible_width, .height = in->i_visible_height,
+    };
+    VARectangle dst_rect = {
+        .x = out->i_x_offset, .y = out->i_y_offset,
+        .width = out->i_visible_width, .height = out->i_visible_height,
+    };
+    VAProcPipelineParameterBuffer params = {
+        .surface = src,
+        .surface_region = &src_rect,
+        .output_region = &dst_rect,
+        .output_background_color = 0xff000000,
+        .filter_flags = VA_FILTER_SCALING_HQ,
+    };
+    VABufferID buf;
+    int ret = VLC_EGENERIC;
+
+    if (vaCreateBuffer(pool->display, pool->context,
+                       VAProcPipelineParameterBufferType, sizeof (params), 1,
+                       &params, &buf))
+        return VLC_EGENERIC;
+
+    if (vaBeginPicture(pool->display, pool->context, dst) == VA_STATUS_SUCCESS)
+    {
+        if (vaRenderPicture(pool->display, pool->context, &buf, 1)
+                                                         == VA_STATUS_SUCCESS)
+            ret = VLC_SUCCESS;
+        if (vaEndPicture(pool->display, pool->context) != VA_STATUS_SUCCESS)
+            ret = VLC_EGENERIC;
+    }
+    vaDestroyBuffer(pool->display, buf);
+    return ret;
+}
+
+static picture_t *Scale(filter_t *filter, picture_t *src)
+{
+    filter_sys_t *sys = filter->p_sys;
+    vlc_vaapi_surface_t *surface = vlc_vaapi_PictureGetSurface(src);
+    picture_t *dst = NULL;
+
+    if (unlikely(surface == NULL))
+    {
+        msg_Err(filter, "corrupt VA surface %p", src);
+        goto out;
+    }
+
+    if (sys->pool == NULL || sys->pool->display != surface->display)
+    {
+        if (sys->pool != NULL)
+            PoolRelease(sys->pool);
+        sys->pool = PoolNew(filter, src);
+        if (sys->pool == NULL)
+            goto out;
+    }
+
+    dst = filter_NewPicture(filter);
+    if (dst == NULL)
+        goto out;
+
+    if (Attach(sys->pool, dst))
+    {
+        msg_Warn(filter, "all VA scaled surfaces in use, dropping picture");
+        goto error;
+    }
+    if (Render(filter, surface->id, vlc_vaapi_PictureGetSurface(dst)->id))
+    {
+        msg_Err(filter, "VA video processing failed");
+        goto error;
+    }
+    picture_CopyProperties(dst, src);
+out:
+    picture_Release(src);
+    return dst;
+error:
+    picture_Release(dst);
+    dst = NULL;
+    goto out;
+}
+
+static int Open(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    const video_format_t *in = &filter->fmt_in.video;
+    const video_format_t *out = &filter->fmt_out.video;
+
+    if (in->i_chroma != VLC_CODEC_VAAPI_420
+     || out->i_chroma != VLC_CODEC_VAAPI_420
+     || in->orientation != out->orientation)
+        return VLC_EGENERIC;
+    if (in->i_width == out->i_width && in->i_height == out->i_height
+     && in->i_visible_width == out->i_visible_width
+     && in->i_visible_height == out->i_visible_height)
+        return VLC_EGENERIC;
+
+    filter_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    sys->pool = NULL;
+    filter->pf_video_filter = Scale;
+    filter->p_sys = sys;
+    return VLC_SUCCESS;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    filter_sys_t *sys = filter->p_sys;
+
+    /* Surfaces still attached to pictures are destroyed with them */
+    if (sys->pool != NULL)
+        PoolRelease(sys->pool);
+    free(sys);
+}
+
+vlc_module_begin()
+    set_shortname(N_("VA-API"))
+    set_description(N_("VA-API video scaling"))
+    set_capability("video filter2", 20)
+    set_category(CAT_VIDEO)
+    set_subcategory(SUBCAT_VIDEO_VFILTER)
+    set_callbacks(Open, Close)
+vlc_module_end()
@@ -0,0 +1,50 @@
+/*****************************************************************************
+ * vlc_vaapi.h: VA-API surfaces shared between decoder and video output
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VAAPI_H
+# define VLC_VAAPI_H 1
+
+# include <assert.h>
+# include <va/va.h>
+# include <vlc_picture.h>
+
+/**
+ * Picture context of VLC_CODEC_VAAPI_420 pictures.
+ *
+ * The decoder allocates the surfaces and attaches one by picture. The surface
+ * is not reused by the decoder until the picture is released, and the VA
+ * display remains valid for as long as any such picture exists. The destroy
+ * callback lives in the decoder plugin, which stays loaded until the
+ * modules bank is released.
+ */
+typedef struct vlc_vaapi_surface
+{
+    void (*destroy)(void *); /**< picture context destructor (must be first) */
+    VADisplay display; /**< VA display owning the surface */
+    VASurfaceID id; /**< VA surface */
+} vlc_vaapi_surface_t;
+
+static inline vlc_vaapi_surface_t *vlc_vaapi_PictureGetSurface(picture_t *pic)
+{
+    assert(pic->format.i_chroma == VLC_CODEC_VAAPI_420);
+    return (vlc_vaapi_surface_t *)pic->context;
+}
+
+#endif
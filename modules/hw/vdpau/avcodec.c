@@ -39,7 +39,8 @@
 #include "vlc_vdpau.h"
 #include "../../codec/avcodec/va.h"
 
-static int Open(vlc_va_t *, AVCodecContext *, const es_format_t *);
+static int Open(vlc_va_t *, AVCodecContext *, const es_format_t *,
+                picture_sys_t *);
 static void Close(vlc_va_t *, AVCodecContext *);
 
 vlc_module_begin()
@@ -269,10 +270,13 @@ static int Setup(vlc_va_t *va, AVCodecContext *avctx, vlc_fourcc_t *chromap)
     return VLC_SUCCESS;
 }
 
-static int Open(vlc_va_t *va, AVCodecContext *avctx, const es_format_t *fmt)
+static int Open(vlc_va_t *va, AVCodecContext *avctx, const es_format_t *fmt,
+                picture_sys_t *p_sys)
 {
     void *func;
     VdpStatus err;
+
+    (void) p_sys;
 #if (LIBAVCODEC_VERSION_INT < AV_VERSION_INT(56, 2, 0))
     VdpDecoderProfile profile;
     int level = fmt->i_level;
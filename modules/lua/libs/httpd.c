@@ -34,6 +34,9 @@
 
 #include <vlc_common.h>
 #include <vlc_httpd.h>
+#include <vlc_input.h>
+#include <vlc_playlist.h>
+#include <vlc_atomic.h>
 
 #include "../vlc.h"
 #include "../libs.h"
@@ -79,6 +82,138 @@ static const char no_password_body[] = N_(
 
 static const char no_password_title[] = N_("VLC media player");
 
+/* The answer of a cached file to the requests without arguments is kept while
+ * the part of the player state it shows does not change. Not every change has
+ * an event (e.g. a playlist sort from another interface), hence the max age. */
+enum
+{
+    HTTPD_CACHE_NONE,
+    HTTPD_CACHE_PLAYLIST, /* playlist content */
+    HTTPD_CACHE_STATUS,   /* playlist, playback and output settings */
+};
+
+#define HTTPD_CACHE_MAX_AGE (5 * CLOCK_FREQ)
+
+static const char *const ppsz_cache[] = { "none", "playlist", "status", NULL };
+
+typedef struct
+{
+    httpd_host_t   *host;
+    playlist_t     *playlist; /* NULL if the state is not tracked */
+    vlc_mutex_t     lock;
+    input_thread_t *input;
+
+    /* bumped on the changes of the player state */
+    atomic_uint     playlist_version;
+    atomic_uint     status_version;
+} vlclua_httpd_t;
+
+static const char *const ppsz_playlist_vars[] = {
+    "playlist-item-append", "playlist-item-deleted", "item-change",
+    "leaf-to-parent",
+};
+
+static const char *const ppsz_status_vars[] = {
+    "volume", "mute", "random", "loop", "repeat", "fullscreen",
+};
+
+static int vlclua_httpd_playlist_change( vlc_object_t *p_this,
+                                         const char *psz_var,
+                                         vlc_value_t oldval,
+                                         vlc_value_t newval, void *p_data )
+{
+    vlclua_httpd_t *p_httpd = p_data;
+    VLC_UNUSED(p_this); VLC_UNUSED(psz_var);
+    VLC_UNUSED(oldval); VLC_UNUSED(newval);
+
+    atomic_fetch_add( &p_httpd->playlist_version, 1 );
+    atomic_fetch_add( &p_httpd->status_version, 1 );
+    return VLC_SUCCESS;
+}
+
+static int vlclua_httpd_status_change( vlc_object_t *p_this,
+                                       const char *psz_var,
+                                       vlc_value_t oldval,
+                                       vlc_value_t newval, void *p_data )
+{
+    vlclua_httpd_t *p_httpd = p_data;
+    VLC_UNUSED(p_this); VLC_UNUSED(psz_var);
+    VLC_UNUSED(oldval); VLC_UNUSED(newval);
+
+    atomic_fetch_add( &p_httpd->status_version, 1 );
+    return VLC_SUCCESS;
+}
+
+/* Follows the events of the current input. Takes a reference to it, so that
+ * its callback can still be removed when the host is deleted. */
+static void vlclua_httpd_set_input( vlclua_httpd_t *p_httpd,
+                                    input_thread_t *p_input )
+{
+    if( p_httpd->input != NULL )
+    {
+        var_DelCallback( p_httpd->input, "intf-event",
+                         vlclua_httpd_status_change, p_httpd );
+        vlc_object_release( p_httpd->input );
+    }
+    p_httpd->input = p_input;
+    if( p_input != NULL )
+        var_AddCallback( p_input, "intf-event",
+                         vlclua_httpd_status_change, p_httpd );
+}
+
+static int vlclua_httpd_input_change( vlc_object_t *p_this,
+                                      const char *psz_var,
+                                      vlc_value_t oldval,
+                                      vlc_value_t newval, void *p_data )
+{
+    vlclua_httpd_t *p_httpd = p_data;
+    input_thread_t *p_input = newval.p_address;
+
+    if( p_input != NULL )
+        vlc_object_hold( p_input );
+    vlc_mutex_lock( &p_httpd->lock );
+    vlclua_httpd_set_input( p_httpd, p_input );
+    vlc_mutex_unlock( &p_httpd->lock );
+
+    return vlclua_httpd_playlist_change( p_this, psz_var, oldval, newval,
+                                         p_data );
+}
+
+static void vlclua_httpd_track( vlclua_httpd_t *p_httpd )
+{
+    playlist_t *p_playlist = p_httpd->playlist;
+
+    for( size_t i = 0; i < ARRAY_SIZE(ppsz_playlist_vars); i++ )
+        var_AddCallback( p_playlist, ppsz_playlist_vars[i],
+                         vlclua_httpd_playlist_change, p_httpd );
+    for( size_t i = 0; i < ARRAY_SIZE(ppsz_status_vars); i++ )
+        var_AddCallback( p_playlist, ppsz_status_vars[i],
+                         vlclua_httpd_status_change, p_httpd );
+
+    /* The input callback waits for the current input to be set here */
+    vlc_mutex_lock( &p_httpd->lock );
+    var_AddCallback( p_playlist, "input-current",
+                     vlclua_httpd_input_change, p_httpd );
+    vlclua_httpd_set_input( p_httpd, playlist_CurrentInput( p_playlist ) );
+    vlc_mutex_unlock( &p_httpd->lock );
+}
+
+static void vlclua_httpd_untrack( vlclua_httpd_t *p_httpd )
+{
+    playlist_t *p_playlist = p_httpd->playlist;
+
+    var_DelCallback( p_playlist, "input-current",
+                     vlclua_httpd_input_change, p_httpd );
+    vlclua_httpd_set_input( p_httpd, NULL );
+
+    for( size_t i = 0; i < ARRAY_SIZE(ppsz_status_vars); i++ )
+        var_DelCallback( p_playlist, ppsz_status_vars[i],
+                         vlclua_httpd_status_change, p_httpd );
+    for( size_t i = 0; i < ARRAY_SIZE(ppsz_playlist_vars); i++ )
+        var_DelCallback( p_playlist, ppsz_playlist_vars[i],
+                         vlclua_httpd_playlist_change, p_httpd );
+}
+
 static int vlclua_httpd_tls_host_new( lua_State *L )
 {
     vlc_object_t *p_this = vlclua_get_this( L );
@@ -86,8 +221,15 @@ static int vlclua_httpd_tls_host_new( lua_State *L )
     if( !p_host )
         return luaL_error( L, "Failed to create HTTP host" );
 
-    httpd_host_t **pp_host = lua_newuserdata( L, sizeof( httpd_host_t * ) );
-    *pp_host = p_host;
+    vlclua_httpd_t *p_httpd = lua_newuserdata( L, sizeof( *p_httpd ) );
+    p_httpd->host = p_host;
+    p_httpd->playlist = vlclua_get_playlist_internal( L );
+    vlc_mutex_init( &p_httpd->lock );
+    p_httpd->input = NULL;
+    atomic_init( &p_httpd->playlist_version, 0 );
+    atomic_init( &p_httpd->status_version, 0 );
+    if( p_httpd->playlist != NULL )
+        vlclua_httpd_track( p_httpd );
 
     if( luaL_newmetatable( L, "httpd_host" ) )
     {
@@ -104,8 +246,11 @@ static int vlclua_httpd_tls_host_new( lua_State *L )
 
 static int vlclua_httpd_host_delete( lua_State *L )
 {
-    httpd_host_t **pp_host = (httpd_host_t **)luaL_checkudata( L, 1, "httpd_host" );
-    httpd_HostDelete( *pp_host );
+    vlclua_httpd_t *p_httpd = (vlclua_httpd_t *)luaL_checkudata( L, 1, "httpd_host" );
+    if( p_httpd->playlist != NULL )
+        vlclua_httpd_untrack( p_httpd );
+    httpd_HostDelete( p_httpd->host );
+    vlc_mutex_destroy( &p_httpd->lock );
     return 0;
 }
 
@@ -182,7 +327,7 @@ static int vlclua_httpd_handler_callback(
 
 static int vlclua_httpd_handler_new( lua_State * L )
 {
-    httpd_host_t **pp_host = (httpd_host_t **)luaL_checkudata( L, 1, "httpd_host" );
+    vlclua_httpd_t *p_httpd = (vlclua_httpd_t *)luaL_checkudata( L, 1, "httpd_host" );
     const char *psz_url = luaL_checkstring( L, 2 );
     const char *psz_user = luaL_nilorcheckstring( L, 3 );
     const char *psz_password = luaL_nilorcheckstring( L, 4 );
@@ -201,7 +346,7 @@ static int vlclua_httpd_handler_new( lua_State * L )
      * the callback's stack. */
     lua_xmove( L, p_sys->L, 2 );
     httpd_handler_t *p_handler = httpd_HandlerNew(
-                            *pp_host, psz_url, psz_user, psz_password,
+                            p_httpd->host, psz_url, psz_user, psz_password,
                             vlclua_httpd_handler_callback, p_sys );
     if( !p_handler )
     {
@@ -239,14 +384,77 @@ struct httpd_file_sys_t
     lua_State *L;
     int ref;
     bool password;
+
+    vlclua_httpd_t *httpd;
+    int httpd_ref;
+    int cache; /* HTTPD_CACHE_* */
+
+    /* last answer to a request without arguments */
+    uint8_t *p_cache;
+    int i_cache;
+    unsigned i_cache_version;
+    mtime_t i_cache_date;
 };
 
+static unsigned vlclua_httpd_version( const httpd_file_sys_t *p_sys )
+{
+    vlclua_httpd_t *p_httpd = p_sys->httpd;
+
+    if( p_sys->cache == HTTPD_CACHE_PLAYLIST )
+        return atomic_load( &p_httpd->playlist_version );
+    return atomic_load( &p_httpd->status_version );
+}
+
+static bool vlclua_httpd_cache_get( httpd_file_sys_t *p_sys,
+                                    unsigned i_version,
+                                    uint8_t **pp_data, int *pi_data )
+{
+    if( p_sys->p_cache == NULL || p_sys->i_cache_version != i_version
+     || mdate() - p_sys->i_cache_date >= HTTPD_CACHE_MAX_AGE )
+        return false;
+
+    uint8_t *p_data = malloc( p_sys->i_cache > 0 ? p_sys->i_cache : 1 );
+    if( unlikely(p_data == NULL) )
+        return false;
+    memcpy( p_data, p_sys->p_cache, p_sys->i_cache );
+    *pp_data = p_data;
+    *pi_data = p_sys->i_cache;
+    return true;
+}
+
+static void vlclua_httpd_cache_put( httpd_file_sys_t *p_sys,
+                                    unsigned i_version,
+                                    const uint8_t *p_data, int i_data )
+{
+    free( p_sys->p_cache );
+    p_sys->p_cache = malloc( i_data > 0 ? i_data : 1 );
+    if( unlikely(p_sys->p_cache == NULL) )
+        return;
+    if( i_data > 0 )
+        memcpy( p_sys->p_cache, p_data, i_data );
+    p_sys->i_cache = i_data;
+    p_sys->i_cache_version = i_version;
+    p_sys->i_cache_date = mdate();
+}
+
 static int vlclua_httpd_file_callback(
     httpd_file_sys_t *p_sys, httpd_file_t *p_file, uint8_t *psz_request,
     uint8_t **pp_data, int *pi_data )
 {
     VLC_UNUSED(p_file);
     lua_State *L = p_sys->L;
+    const bool b_cached = p_sys->cache != HTTPD_CACHE_NONE
+                       && (psz_request == NULL || *psz_request == '\0');
+    unsigned i_version = 0;
+
+    if( b_cached )
+    {
+        /* Read before running the callback: a change during the run makes
+         * the new answer stale already */
+        i_version = vlclua_httpd_version( p_sys );
+        if( vlclua_httpd_cache_get( p_sys, i_version, pp_data, pi_data ) )
+            return VLC_SUCCESS;
+    }
 
     /* function data */
     lua_pushvalue( L, 1 );
@@ -279,12 +487,21 @@ static int vlclua_httpd_file_callback(
     }
     lua_pop( L, 1 );
     /* function data */
+
+    if( b_cached )
+        vlclua_httpd_cache_put( p_sys, i_version, *pp_data, *pi_data );
+    else if( p_sys->cache != HTTPD_CACHE_NONE )
+    {
+        /* The arguments are commands, which may change anything */
+        atomic_fetch_add( &p_sys->httpd->playlist_version, 1 );
+        atomic_fetch_add( &p_sys->httpd->status_version, 1 );
+    }
     return VLC_SUCCESS;
 }
 
 static int vlclua_httpd_file_new( lua_State *L )
 {
-    httpd_host_t **pp_host = (httpd_host_t **)luaL_checkudata( L, 1, "httpd_host" );
+    vlclua_httpd_t *p_httpd = (vlclua_httpd_t *)luaL_checkudata( L, 1, "httpd_host" );
     const char *psz_url = luaL_checkstring( L, 2 );
     const char *psz_mime = luaL_nilorcheckstring( L, 3 );
     const char *psz_user = luaL_nilorcheckstring( L, 4 );
@@ -292,19 +509,29 @@ static int vlclua_httpd_file_new( lua_State *L )
     /* Stack item 7 is the callback function */
     luaL_argcheck( L, lua_isfunction( L, 6 ), 6, "Should be a function" );
     /* Stack item 8 is the callback data */
+    /* Stack item 9 is the cache policy */
+    int i_cache = luaL_checkoption( L, 8, "none", ppsz_cache );
+    lua_settop( L, 7 );
     httpd_file_sys_t *p_sys = (httpd_file_sys_t *)
                               malloc( sizeof( httpd_file_sys_t ) );
     if( !p_sys )
         return luaL_error( L, "Failed to allocate private buffer." );
+    /* The cache needs the player state, and the host to outlive the file */
+    p_sys->httpd = p_httpd;
+    p_sys->cache = p_httpd->playlist != NULL ? i_cache : HTTPD_CACHE_NONE;
+    p_sys->p_cache = NULL;
+    lua_pushvalue( L, 1 );
+    p_sys->httpd_ref = luaL_ref( L, LUA_REGISTRYINDEX );
     p_sys->L = lua_newthread( L );
     p_sys->password = psz_password && *psz_password;
     p_sys->ref = luaL_ref( L, LUA_REGISTRYINDEX ); /* pops the object too */
     lua_xmove( L, p_sys->L, 2 );
-    httpd_file_t *p_file = httpd_FileNew( *pp_host, psz_url, psz_mime,
+    httpd_file_t *p_file = httpd_FileNew( p_httpd->host, psz_url, psz_mime,
                                           psz_user, psz_password,
                                           vlclua_httpd_file_callback, p_sys );
     if( !p_file )
     {
+        luaL_unref( L, LUA_REGISTRYINDEX, p_sys->httpd_ref );
         free( p_sys );
         return luaL_error( L, "Failed to create HTTPd file." );
     }
@@ -326,7 +553,9 @@ static int vlclua_httpd_file_delete( lua_State *L )
 {
     httpd_file_t **pp_file = (httpd_file_t**)luaL_checkudata( L, 1, "httpd_file" );
     httpd_file_sys_t *p_sys = httpd_FileDelete( *pp_file );
+    luaL_unref( p_sys->L, LUA_REGISTRYINDEX, p_sys->httpd_ref );
     luaL_unref( p_sys->L, LUA_REGISTRYINDEX, p_sys->ref );
+    free( p_sys->p_cache );
     free( p_sys );
     return 0;
 }
@@ -336,10 +565,10 @@ static int vlclua_httpd_file_delete( lua_State *L )
  *****************************************************************************/
 static int vlclua_httpd_redirect_new( lua_State *L )
 {
-    httpd_host_t **pp_host = (httpd_host_t **)luaL_checkudata( L, 1, "httpd_host" );
+    vlclua_httpd_t *p_httpd = (vlclua_httpd_t *)luaL_checkudata( L, 1, "httpd_host" );
     const char *psz_url_dst = luaL_checkstring( L, 2 );
     const char *psz_url_src = luaL_checkstring( L, 3 );
-    httpd_redirect_t *p_redirect = httpd_RedirectNew( *pp_host,
+    httpd_redirect_t *p_redirect = httpd_RedirectNew( p_httpd->host,
                                                       psz_url_dst,
                                                       psz_url_src );
     if( !p_redirect )
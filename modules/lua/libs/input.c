@@ -202,6 +202,13 @@ static int vlclua_input_item_stats( lua_State *L )
         STATS_FLOAT( send_bitrate )
         STATS_INT( played_abuffers )
         STATS_INT( lost_abuffers )
+        STATS_INT( video_fifo_blocks )
+        STATS_INT( video_fifo_bytes )
+        STATS_INT( audio_fifo_blocks )
+        STATS_INT( audio_fifo_bytes )
+        STATS_INT( video_drop_level )
+        STATS_INT( video_drop_escalations )
+        STATS_INT( video_degraded_blocks )
 #undef STATS_INT
 #undef STATS_FLOAT
         vlc_mutex_unlock( &p_item->p_stats->lock );
@@ -209,6 +216,43 @@ static int vlclua_input_item_stats( lua_State *L )
     return 1;
 }
 
+static int vlclua_input_item_latency( lua_State *L )
+{
+    static const char *const ppsz_stages[INPUT_LATENCY_STAGES] = {
+        "demux", "video_queue", "video_decode", "video_output",
+        "audio_queue", "audio_decode", "audio_output",
+    };
+    input_item_t *p_item = vlclua_input_item_get_internal( L );
+    lua_newtable( L );
+    if( p_item )
+    {
+        vlc_mutex_lock( &p_item->p_stats->lock );
+        for( unsigned i = 0; i < INPUT_LATENCY_STAGES; i++ )
+        {
+            const input_latency_histogram_t *p_histo =
+                &p_item->p_stats->latency[i];
+
+            lua_newtable( L );
+            lua_pushnumber( L, p_histo->i_count );
+            lua_setfield( L, -2, "count" );
+            lua_pushnumber( L, p_histo->i_total );
+            lua_setfield( L, -2, "total" );
+            lua_pushnumber( L, p_histo->i_max );
+            lua_setfield( L, -2, "max" );
+            lua_newtable( L );
+            for( unsigned j = 0; j < INPUT_LATENCY_BUCKETS; j++ )
+            {
+                lua_pushnumber( L, p_histo->pi_buckets[j] );
+                lua_rawseti( L, -2, j + 1 );
+            }
+            lua_setfield( L, -2, "buckets" );
+            lua_setfield( L, -2, ppsz_stages[i] );
+        }
+        vlc_mutex_unlock( &p_item->p_stats->lock );
+    }
+    return 1;
+}
+
 static int vlclua_input_add_subtitle( lua_State *L )
 {
     input_thread_t *p_input = vlclua_get_input_internal( L );
@@ -387,6 +431,7 @@ static const luaL_Reg vlclua_input_item_reg[] = {
     { "name", vlclua_input_item_name },
     { "duration", vlclua_input_item_duration },
     { "stats", vlclua_input_item_stats },
+    { "latency", vlclua_input_item_latency },
     { "info", vlclua_input_item_info },
     { NULL, NULL }
 };
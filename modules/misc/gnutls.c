@@ -309,6 +309,66 @@ static void gnutls_SessionClose (vlc_tls_t *tls)
     gnutls_deinit (session);
 }
 
+/*
+ * Session data of the last servers, for resumption without a full
+ * handshake. Credentials are usually created per input, so the data is kept
+ * for the whole process rather than per credentials, the most recently used
+ * first.
+ */
+#define SESSION_CACHE_SIZE 16
+
+static struct
+{
+    char *host;
+    gnutls_datum_t data;
+} session_cache[SESSION_CACHE_SIZE];
+static vlc_mutex_t session_cache_lock = VLC_STATIC_MUTEX;
+
+static void gnutls_SessionResume (gnutls_session_t session, const char *host)
+{
+    vlc_mutex_lock (&session_cache_lock);
+    for (unsigned i = 0;
+         i < SESSION_CACHE_SIZE && session_cache[i].host != NULL; i++)
+        if (!strcmp (session_cache[i].host, host))
+        {
+            gnutls_session_set_data (session, session_cache[i].data.data,
+                                     session_cache[i].data.size);
+            break;
+        }
+    vlc_mutex_unlock (&session_cache_lock);
+}
+
+static void gnutls_SessionSave (gnutls_session_t session, const char *host)
+{
+    gnutls_datum_t data;
+
+    if (gnutls_session_get_data2 (session, &data))
+        return;
+
+    char *str = strdup (host);
+    if (unlikely(str == NULL))
+    {
+        gnutls_free (data.data);
+        return;
+    }
+
+    vlc_mutex_lock (&session_cache_lock);
+    unsigned i;
+    /* Replace the entry of the host, or the least recently used one */
+    for (i = 0; i < SESSION_CACHE_SIZE - 1 && session_cache[i].host != NULL;
+         i++)
+        if (!strcmp (session_cache[i].host, host))
+            break;
+
+    free (session_cache[i].host);
+    gnutls_free (session_cache[i].data.data);
+    memmove (&session_cache[1], &session_cache[0],
+             i * sizeof (session_cache[0]));
+    session_cache[0].host = str;
+    session_cache[0].data = data;
+    vlc_mutex_unlock (&session_cache_lock);
+}
+
 static int gnutls_ClientSessionOpen (vlc_tls_creds_t *crd, vlc_tls_t *tls,
                                      int fd, const char *hostname,
                                      const char *const *alpn)
@@ -323,9 +383,12 @@ static int gnutls_ClientSessionOpen (vlc_tls_creds_t *crd, vlc_tls_t *tls,
     gnutls_dh_set_prime_bits (session, 1024);
 
     if (likely(hostname != NULL))
+    {
         /* fill Server Name Indication */
         gnutls_server_name_set (session, GNUTLS_NAME_DNS,
                                 hostname, strlen (hostname));
+        gnutls_SessionResume (session, hostname);
+    }
 
     return VLC_SUCCESS;
 }
@@ -354,6 +417,10 @@ failure:
     if (status == 0)
     {   /* Good certificate */
 success:
+        if (gnutls_session_is_resumed (session))
+            msg_Dbg (tls, "TLS session resumed");
+        if (host != NULL)
+            gnutls_SessionSave (session, host);
         tls->sock.p_sys = tls;
         return 0;
     }
@@ -511,6 +578,7 @@ typedef struct vlc_tls_creds_sys
 {
     gnutls_certificate_credentials_t x509_cred;
     gnutls_dh_params_t dh_params;
+    gnutls_datum_t ticket_key; /**< session tickets, for resumption */
 } vlc_tls_creds_sys_t;
 
 /**
@@ -523,7 +591,10 @@ static int gnutls_ServerSessionOpen (vlc_tls_creds_t *crd, vlc_tls_t *tls,
     vlc_tls_creds_sys_t *sys = crd->sys;
 
     assert (hostname == NULL);
-    return gnutls_SessionOpen (tls, GNUTLS_SERVER, sys->x509_cred, fd, alpn);
+    int val = gnutls_SessionOpen (tls, GNUTLS_SERVER, sys->x509_cred, fd, alpn);
+    if (val == VLC_SUCCESS && sys->ticket_key.data != NULL)
+        gnutls_session_ticket_enable_server (tls->sys, &sys->ticket_key);
+    return val;
 }
 
 static int gnutls_ServerHandshake (vlc_tls_t *tls, const char *host,
@@ -624,6 +695,14 @@ static int OpenServer (vlc_tls_creds_t *crd, const char *cert, const char *key)
                  gnutls_strerror (val));
     }
 
+    val = gnutls_session_ticket_key_generate (&sys->ticket_key);
+    if (val < 0)
+    {
+        msg_Warn (crd, "cannot generate session ticket key: %s",
+                  gnutls_strerror (val));
+        sys->ticket_key.data = NULL;
+    }
+
     crd->sys = sys;
     crd->open = gnutls_ServerSessionOpen;
     crd->handshake = gnutls_ServerHandshake;
@@ -648,6 +727,7 @@ static void CloseServer (vlc_tls_creds_t *crd)
     /* all sessions depending on the server are now deinitialized */
     gnutls_certificate_free_credentials (sys->x509_cred);
     gnutls_dh_params_deinit (sys->dh_params);
+    gnutls_free (sys->ticket_key.data);
     free (sys);
     gnutls_Deinit ();
 }
@@ -158,6 +158,12 @@ struct vod_media_t
 
     /* Infos */
     mtime_t i_length;
+
+    /* SDP of the last DESCRIBE, shared by the sessions of the media as long
+     * as the ES list and the server address do not change */
+    char *psz_sdp;
+    char psz_sdp_ip[NI_MAXNUMERICHOST];
+    int  i_sdp_port;
 };
 
 struct vod_sys_t
@@ -231,6 +237,7 @@ static int RtspCallbackES( httpd_callback_sys_t *, httpd_client_t *,
                            httpd_message_t *, const httpd_message_t * );
 
 static char *SDPGenerate( const vod_media_t *, httpd_client_t *cl );
+static char *SDPGet( vod_media_t *, httpd_client_t *cl );
 
 static void sprintf_hexa( char *s, uint8_t *p_data, int i_data )
 {
@@ -460,6 +467,7 @@ static void MediaDel( vod_t *p_vod, vod_media_t *p_media )
     while( p_media->i_es )
         MediaDelES( p_vod, p_media, &p_media->es[0]->fmt );
     TAB_CLEAN( p_media->i_es, p_media->es );
+    free( p_media->psz_sdp );
 
     vlc_mutex_destroy( &p_media->lock );
 
@@ -703,6 +711,7 @@ static int MediaAddES( vod_t *p_vod, vod_media_t *p_media, es_format_t *p_fmt )
 
     vlc_mutex_lock( &p_media->lock );
     TAB_APPEND( p_media->i_es, p_media->es, p_es );
+    FREENULL( p_media->psz_sdp );
     vlc_mutex_unlock( &p_media->lock );
 
     return VLC_SUCCESS;
@@ -728,6 +737,7 @@ static void MediaDelES( vod_t *p_vod, vod_media_t *p_media, es_format_t *p_fmt)
 
     vlc_mutex_lock( &p_media->lock );
     TAB_REMOVE( p_media->i_es, p_media->es, p_es );
+    FREENULL( p_media->psz_sdp );
     vlc_mutex_unlock( &p_media->lock );
 
     free( p_es->psz_fmtp );
@@ -1179,7 +1189,7 @@ static int RtspCallback( httpd_callback_sys_t *p_args, httpd_client_t *cl,
         case HTTPD_MSG_DESCRIBE:
         {
             char *psz_sdp =
-                SDPGenerate( p_media, cl );
+                SDPGet( p_media, cl );
 
             if( psz_sdp != NULL )
             {
@@ -1497,6 +1507,34 @@ static int RtspCallbackES( httpd_callback_sys_t *p_args, httpd_client_t *cl,
  * SDPGenerate: TODO
  * FIXME: need to be moved to a common place ?
  *****************************************************************************/
+/*****************************************************************************
+ * SDPGet: returns a copy of the cached SDP of the media, generated again only
+ * when the ES or the address the client reached the server at changed
+ *****************************************************************************/
+static char *SDPGet( vod_media_t *p_media, httpd_client_t *cl )
+{
+    char ip[NI_MAXNUMERICHOST], *psz_sdp = NULL;
+    int port;
+
+    if( httpd_ServerIP( cl, ip, &port ) == NULL )
+        return NULL;
+
+    vlc_mutex_lock( &p_media->lock );
+    if( p_media->psz_sdp == NULL || port != p_media->i_sdp_port ||
+        strcmp( ip, p_media->psz_sdp_ip ) )
+    {
+        free( p_media->psz_sdp );
+        p_media->psz_sdp = SDPGenerate( p_media, cl );
+        strcpy( p_media->psz_sdp_ip, ip );
+        p_media->i_sdp_port = port;
+    }
+    if( p_media->psz_sdp != NULL )
+        psz_sdp = strdup( p_media->psz_sdp );
+    vlc_mutex_unlock( &p_media->lock );
+
+    return psz_sdp;
+}
+
 static char *SDPGenerate( const vod_media_t *p_media, httpd_client_t *cl )
 {
     char *psz_sdp, ip[NI_MAXNUMERICHOST];
@@ -140,7 +140,6 @@ static void ReaderErrorHandler( void *p_arg, const char *p_msg,
 struct xml_reader_sys_t
 {
     xmlTextReaderPtr xml;
-    char *node;
 };
 
 static int ReaderOpen( vlc_object_t *p_this )
@@ -172,7 +171,6 @@ static int ReaderOpen( vlc_object_t *p_this )
                                   ReaderErrorHandler, p_reader );
 
     p_sys->xml = p_libxml_reader;
-    p_sys->node = NULL;
     p_reader->p_sys = p_sys;
     p_reader->pf_next_node = ReaderNextNode;
     p_reader->pf_next_attr = ReaderNextAttr;
@@ -193,7 +191,6 @@ static void ReaderClose( vlc_object_t *p_this )
     xmlCleanupParser();
     vlc_mutex_unlock( &lock );
 #endif
-    free( p_sys->node );
     free( p_sys );
 }
 
@@ -214,9 +211,6 @@ static int ReaderNextNode( xml_reader_t *p_reader, const char **pval )
     const xmlChar *node;
     int ret;
 
-    free( p_sys->node );
-    p_sys->node = NULL;
-
 skip:
     switch( xmlTextReaderRead( p_sys->xml ) )
     {
@@ -226,6 +220,8 @@ skip:
             return -1;
     }
 
+    /* Names are interned in the dictionary of the reader, values are kept
+     * until the next read: neither needs to be copied */
     switch( xmlTextReaderNodeType( p_sys->xml ) )
     {
         case XML_READER_TYPE_ELEMENT:
@@ -254,10 +250,9 @@ skip:
     if( unlikely(node == NULL) )
         return -1;
 
-    p_sys->node = strdup( (const char *)node );
     if( pval != NULL )
-        *pval = p_sys->node;
-    return likely(p_sys->node != NULL) ? ret : -1;
+        *pval = (const char *)node;
+    return ret;
 }
 
 #if 0
@@ -37,6 +37,8 @@
 #include <vlc_block.h>
 #include <vlc_codecs.h>
 
+#include <errno.h>
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -114,12 +116,18 @@ typedef struct avi_idx1_entry_s
 
 } avi_idx1_entry_t;
 
+/* Index entries kept in memory: beyond, they are spilled to a temporary
+ * file, in the idx1 format, and copied from it to the output when closing */
+#define AVI_IDX1_WINDOW 10000
+
 typedef struct avi_idx1_s
 {
     unsigned int i_entry_count;
     unsigned int i_entry_max;
 
-    avi_idx1_entry_t *entry;
+    avi_idx1_entry_t *entry; /* from i_entry_spilled */
+    unsigned int i_entry_spilled;
+    FILE         *p_spill;
 } avi_idx1_t;
 
 struct sout_mux_sys_t
@@ -149,7 +157,8 @@ struct sout_mux_sys_t
 
 
 static block_t *avi_HeaderCreateRIFF( sout_mux_t * );
-static block_t *avi_HeaderCreateidx1( sout_mux_t * );
+static off_t    avi_WriteIdx1( sout_mux_t * );
+static bool     avi_SpillIdx1( sout_mux_t * );
 
 static void SetFCC( uint8_t *p, char *fcc )
 {
@@ -174,7 +183,9 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_movi_size = 0;
 
     p_sys->idx1.i_entry_count = 0;
-    p_sys->idx1.i_entry_max = 10000;
+    p_sys->idx1.i_entry_spilled = 0;
+    p_sys->idx1.p_spill = NULL;
+    p_sys->idx1.i_entry_max = AVI_IDX1_WINDOW;
     p_sys->idx1.entry = calloc( p_sys->idx1.i_entry_max,
                                 sizeof( avi_idx1_entry_t ) );
     if( !p_sys->idx1.entry )
@@ -202,15 +213,13 @@ static void Close( vlc_object_t * p_this )
     sout_mux_t      *p_mux = (sout_mux_t*)p_this;
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
 
-    block_t       *p_hdr, *p_idx1;
+    block_t       *p_hdr;
     int                 i_stream;
 
     msg_Dbg( p_mux, "AVI muxer closed" );
 
-    /* first create idx1 chunk (write at the end of the stream */
-    p_idx1 = avi_HeaderCreateidx1( p_mux );
-    p_sys->i_idx1_size = p_idx1->i_buffer;
-    sout_AccessOutWrite( p_mux->p_access, p_idx1 );
+    /* first write idx1 chunk (at the end of the stream) */
+    p_sys->i_idx1_size = avi_WriteIdx1( p_mux );
 
     /* calculate some value for headers creations */
     for( i_stream = 0; i_stream < p_sys->i_streams; i_stream++ )
@@ -533,7 +542,8 @@ static int Mux      ( sout_mux_t *p_mux )
             p_stream->i_totalsize += p_data->i_buffer;
 
             /* add idx1 entry for this frame */
-            p_idx = &p_sys->idx1.entry[p_sys->idx1.i_entry_count];
+            p_idx = &p_sys->idx1.entry[p_sys->idx1.i_entry_count -
+                                       p_sys->idx1.i_entry_spilled];
             memcpy( p_idx->fcc, p_stream->fcc, 4 );
             p_idx->i_flags = 0;
             if( ( p_data->i_flags & BLOCK_FLAG_TYPE_MASK ) == 0 || ( p_data->i_flags & BLOCK_FLAG_TYPE_I ) )
@@ -541,7 +551,8 @@ static int Mux      ( sout_mux_t *p_mux )
             p_idx->i_pos   = p_sys->i_movi_size + 4;
             p_idx->i_length= p_data->i_buffer;
             p_sys->idx1.i_entry_count++;
-            if( p_sys->idx1.i_entry_count >= p_sys->idx1.i_entry_max )
+            if( p_sys->idx1.i_entry_count - p_sys->idx1.i_entry_spilled
+                    >= p_sys->idx1.i_entry_max && !avi_SpillIdx1( p_mux ) )
             {
                 p_sys->idx1.i_entry_max += 10000;
                 p_sys->idx1.entry = xrealloc( p_sys->idx1.entry,
@@ -991,27 +1002,107 @@ static block_t *avi_HeaderCreateRIFF( sout_mux_t *p_mux )
     return( bo.p_block );
 }
 
-static block_t * avi_HeaderCreateidx1( sout_mux_t *p_mux )
+static void avi_Idx1Serialize( uint8_t *p, const avi_idx1_entry_t *p_entry,
+                               unsigned int i_count )
 {
-    sout_mux_sys_t      *p_sys = p_mux->p_sys;
-    uint32_t            i_idx1_size;
-    buffer_out_t        bo;
+    for( unsigned i = 0; i < i_count; i++, p += 16 )
+    {
+        memcpy( p, p_entry[i].fcc, 4 );
+        SetDWLE( p + 4, p_entry[i].i_flags );
+        SetDWLE( p + 8, p_entry[i].i_pos );
+        SetDWLE( p + 12, p_entry[i].i_length );
+    }
+}
 
-    i_idx1_size = 16 * p_sys->idx1.i_entry_count + 8;
+/* Writes the entries in memory to the spill file. Returns false to grow the
+ * entries in memory instead, if no spill file could be created (they then
+ * grow past the window, and it is not tried again) */
+static bool avi_SpillIdx1( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    avi_idx1_t *p_idx1 = &p_sys->idx1;
 
-    bo_Init( &bo, i_idx1_size );
-    memset( bo.p_block->p_buffer, 0, i_idx1_size);
+    if( p_idx1->p_spill == NULL )
+    {
+        if( p_idx1->i_entry_max > AVI_IDX1_WINDOW )
+            return false;
+        p_idx1->p_spill = tmpfile();
+        if( p_idx1->p_spill == NULL )
+        {
+            msg_Warn( p_mux, "cannot create the index spill file: %s",
+                      vlc_strerror_c(errno) );
+            return false;
+        }
+    }
 
-    bo_AddFCC( &bo, "idx1" );
-    bo_AddDWordLE( &bo, i_idx1_size - 8);
+    const unsigned int i_count = p_idx1->i_entry_count - p_idx1->i_entry_spilled;
+    uint8_t *p_buffer = malloc( 16 * i_count );
+    if( p_buffer == NULL )
+        return false;
+    avi_Idx1Serialize( p_buffer, p_idx1->entry, i_count );
 
-    for( unsigned i = 0; i < p_sys->idx1.i_entry_count; i++ )
+    const long i_offset = ftell( p_idx1->p_spill );
+    bool b_ok = fwrite( p_buffer, 16, i_count, p_idx1->p_spill ) == i_count;
+    if( !b_ok )
     {
-        bo_AddFCC( &bo, p_sys->idx1.entry[i].fcc );
-        bo_AddDWordLE( &bo, p_sys->idx1.entry[i].i_flags );
-        bo_AddDWordLE( &bo, p_sys->idx1.entry[i].i_pos );
-        bo_AddDWordLE( &bo, p_sys->idx1.entry[i].i_length );
+        msg_Err( p_mux, "cannot spill the index: %s", vlc_strerror_c(errno) );
+        fseek( p_idx1->p_spill, i_offset, SEEK_SET );
     }
+    else
+        p_idx1->i_entry_spilled += i_count;
+    free( p_buffer );
+    return b_ok;
+}
 
-    return( bo.p_block );
+/* Writes the idx1 chunk, from the spill file then the entries in memory,
+ * and returns its size */
+static off_t avi_WriteIdx1( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    avi_idx1_t *p_idx1 = &p_sys->idx1;
+    const off_t i_size = 16 * (off_t)p_idx1->i_entry_count;
+    block_t *p_block;
+
+    p_block = block_Alloc( 8 );
+    if( p_block )
+    {
+        SetFCC( p_block->p_buffer, "idx1" );
+        SetDWLE( p_block->p_buffer + 4, i_size );
+        sout_AccessOutWrite( p_mux->p_access, p_block );
+    }
+
+    if( p_idx1->p_spill != NULL )
+    {
+        off_t i_spilled = 16 * (off_t)p_idx1->i_entry_spilled;
+
+        rewind( p_idx1->p_spill );
+        while( i_spilled > 0 )
+        {
+            size_t i_chunk = __MIN( i_spilled, 65536 );
+
+            p_block = block_Alloc( i_chunk );
+            if( p_block == NULL )
+                break;
+            if( fread( p_block->p_buffer, 1, i_chunk, p_idx1->p_spill ) != i_chunk )
+            {
+                /* Keep the chunk size right */
+                msg_Err( p_mux, "cannot read the index back: %s",
+                         vlc_strerror_c(errno) );
+                memset( p_block->p_buffer, 0, i_chunk );
+            }
+            sout_AccessOutWrite( p_mux->p_access, p_block );
+            i_spilled -= i_chunk;
+        }
+        fclose( p_idx1->p_spill );
+        p_idx1->p_spill = NULL;
+    }
+
+    const unsigned int i_count = p_idx1->i_entry_count - p_idx1->i_entry_spilled;
+    if( i_count > 0 && ( p_block = block_Alloc( 16 * i_count ) ) )
+    {
+        avi_Idx1Serialize( p_block->p_buffer, p_idx1->entry, i_count );
+        sout_AccessOutWrite( p_mux->p_access, p_block );
+    }
+
+    return 8 + i_size;
 }
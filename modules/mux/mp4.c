@@ -36,6 +36,7 @@
 #include <vlc_block.h>
 
 #include <time.h>
+#include <errno.h>
 
 #include <vlc_iso_lang.h>
 #include <vlc_meta.h>
@@ -53,6 +54,12 @@
     "\"Fast Start\" files are optimized for downloads and allow the user " \
     "to start previewing the file while it is downloading.")
 
+#define MOOVRESERVE_TEXT N_("Space reserved for the index (KiB)")
+#define MOOVRESERVE_LONGTEXT N_(\
+    "Space to reserve at the start of the file for the index. If the index " \
+    "fits there, a \"Fast Start\" file is made without rewriting the whole " \
+    "file when closing. The index takes about 8 to 16 bytes per frame.")
+
 static int  Open   (vlc_object_t *);
 static void Close  (vlc_object_t *);
 static int  OpenFrag   (vlc_object_t *);
@@ -69,6 +76,9 @@ vlc_module_begin ()
     add_bool(SOUT_CFG_PREFIX "faststart", true,
               FASTSTART_TEXT, FASTSTART_LONGTEXT,
               true)
+    add_integer_with_range(SOUT_CFG_PREFIX "moov-reserve", 0, 0, 65536,
+              MOOVRESERVE_TEXT, MOOVRESERVE_LONGTEXT,
+              true)
     set_capability("sout mux", 5)
     add_shortcut("mp4", "mov", "3gp")
     set_callbacks(Open, Close)
@@ -88,7 +98,7 @@ vlc_module_end ()
  * Exported prototypes
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
-    "faststart", NULL
+    "faststart", "moov-reserve", NULL
 };
 
 static int Control(sout_mux_t *, int, va_list);
@@ -110,6 +120,10 @@ typedef struct
     unsigned int i_flags;
 } mp4_entry_t;
 
+/* Index entries kept in memory per track: beyond, they are spilled to a
+ * temporary file, and only read back to create the moov box when closing */
+#define MP4_ENTRIES_WINDOW 16000 /* multiple of the growth step */
+
 typedef struct mp4_fragentry_t mp4_fragentry_t;
 
 struct mp4_fragentry_t
@@ -142,7 +156,9 @@ typedef struct
     /* index */
     unsigned int i_entry_count;
     unsigned int i_entry_max;
-    mp4_entry_t  *entry;
+    mp4_entry_t  *entry; /* from i_entry_spilled, until LoadEntries() */
+    unsigned int i_entry_spilled;
+    FILE         *p_spill;
     int64_t      i_length_neg;
 
     /* stats */
@@ -191,6 +207,10 @@ struct sout_mux_sys_t
     uint64_t i_pos;
     mtime_t  i_read_duration;
 
+    /* free box reserved for the moov, 0 if none */
+    uint64_t i_moov_reserve_pos;
+    uint64_t i_moov_reserve;
+
     unsigned int   i_nb_streams;
     mp4_stream_t **pp_streams;
 
@@ -225,6 +245,7 @@ static void  box_fix     (bo_t *box);
 static void  box_gather  (bo_t *box, bo_t *box2);
 
 static void box_send(sout_mux_t *p_mux,  bo_t *box);
+static void free_box_send(sout_mux_t *p_mux, uint64_t i_size, bool b_fill);
 
 static bo_t *GetMoovBox(sout_mux_t *p_mux);
 
@@ -277,11 +298,18 @@ static int Open(vlc_object_t *p_this)
         box_fix(box);
 
         p_sys->i_pos += box->len;
-        p_sys->i_mdat_pos = p_sys->i_pos;
 
         box_send(p_mux, box);
     }
 
+    p_sys->i_moov_reserve_pos = p_sys->i_pos;
+    p_sys->i_moov_reserve = 1024 * var_GetInteger(p_mux, SOUT_CFG_PREFIX "moov-reserve");
+    if (p_sys->i_moov_reserve > 0) {
+        free_box_send(p_mux, p_sys->i_moov_reserve, true);
+        p_sys->i_pos += p_sys->i_moov_reserve;
+    }
+    p_sys->i_mdat_pos = p_sys->i_pos;
+
     /* FIXME FIXME
      * Quicktime actually doesn't like the 64 bits extensions !!! */
     p_sys->b_64_ext = false;
@@ -297,6 +325,72 @@ static int Open(vlc_object_t *p_this)
     return VLC_SUCCESS;
 }
 
+/* Writes the entries in memory to the spill file, but the last one which is
+ * still updated by Mux(). Returns false to grow the entries in memory instead:
+ * below the window, or if no spill file could be created (the entries then
+ * grow past the window, and it is not tried again). */
+static bool SpillEntries(sout_mux_t *p_mux, mp4_stream_t *p_stream)
+{
+    if (p_stream->i_entry_max < MP4_ENTRIES_WINDOW)
+        return false;
+
+    if (p_stream->p_spill == NULL) {
+        if (p_stream->i_entry_max > MP4_ENTRIES_WINDOW)
+            return false;
+        p_stream->p_spill = tmpfile();
+        if (p_stream->p_spill == NULL) {
+            msg_Warn(p_mux, "cannot create the index spill file: %s",
+                     vlc_strerror_c(errno));
+            return false;
+        }
+    }
+
+    const unsigned i_count = p_stream->i_entry_count -
+                             p_stream->i_entry_spilled - 1;
+    const long i_offset = ftell(p_stream->p_spill);
+    if (fwrite(p_stream->entry, sizeof(mp4_entry_t), i_count,
+               p_stream->p_spill) != i_count) {
+        msg_Err(p_mux, "cannot spill the index: %s", vlc_strerror_c(errno));
+        fseek(p_stream->p_spill, i_offset, SEEK_SET);
+        return false;
+    }
+
+    p_stream->entry[0] = p_stream->entry[i_count];
+    p_stream->i_entry_spilled += i_count;
+    return true;
+}
+
+/* Reads the spilled entries back, in one piece with the ones in memory,
+ * to create the moov box */
+static void LoadEntries(sout_mux_t *p_mux, mp4_stream_t *p_stream)
+{
+    if (p_stream->p_spill == NULL)
+        return;
+
+    if (p_stream->i_entry_spilled > 0) {
+        const unsigned i_count = p_stream->i_entry_count -
+                                 p_stream->i_entry_spilled;
+        mp4_entry_t *entry = xmalloc(p_stream->i_entry_count * sizeof(*entry));
+
+        rewind(p_stream->p_spill);
+        if (fread(entry, sizeof(*entry), p_stream->i_entry_spilled,
+                  p_stream->p_spill) != p_stream->i_entry_spilled) {
+            msg_Err(p_mux, "cannot read the index back: %s",
+                    vlc_strerror_c(errno));
+            memset(entry, 0, p_stream->i_entry_spilled * sizeof(*entry));
+        }
+        memcpy(&entry[p_stream->i_entry_spilled], p_stream->entry,
+               i_count * sizeof(*entry));
+
+        free(p_stream->entry);
+        p_stream->entry = entry;
+        p_stream->i_entry_max = p_stream->i_entry_count;
+        p_stream->i_entry_spilled = 0;
+    }
+    fclose(p_stream->p_spill);
+    p_stream->p_spill = NULL;
+}
+
 /*****************************************************************************
  * Close:
  *****************************************************************************/
@@ -327,11 +421,29 @@ static void Close(vlc_object_t *p_this)
     sout_AccessOutWrite(p_mux->p_access, bo.b);
 
     /* Create MOOV header */
+    for (unsigned int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++)
+        LoadEntries(p_mux, p_sys->pp_streams[i_trak]);
+
     uint64_t i_moov_pos = p_sys->i_pos;
     bo_t *moov = GetMoovBox(p_mux);
 
     /* Check we need to create "fast start" files */
     p_sys->b_fast_start = var_GetBool(p_this, SOUT_CFG_PREFIX "faststart");
+
+    /* Use the reserved space if the moov fits, as is or with a smaller free
+     * box after it, so that no data has to be moved */
+    uint64_t i_free = 0;
+    if (p_sys->i_moov_reserve > 0) {
+        if (moov->len == p_sys->i_moov_reserve ||
+            moov->len + 8 <= p_sys->i_moov_reserve) {
+            i_moov_pos = p_sys->i_moov_reserve_pos;
+            i_free = p_sys->i_moov_reserve - moov->len;
+            p_sys->b_fast_start = false;
+        } else
+            msg_Warn(p_mux, "moov box (%zu bytes) does not fit in the %"PRIu64
+                     " bytes reserved", moov->len, p_sys->i_moov_reserve);
+    }
+
     while (p_sys->b_fast_start) {
         /* Move data to the end of the file so we can fit the moov header
          * at the start */
@@ -388,6 +500,8 @@ static void Close(vlc_object_t *p_this)
     /* Write MOOV header */
     sout_AccessOutSeek(p_mux->p_access, i_moov_pos);
     box_send(p_mux, moov);
+    if (i_free > 0)
+        free_box_send(p_mux, i_free, false);
 
     /* Clean-up */
     for (unsigned int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++) {
@@ -479,6 +593,8 @@ static int AddStream(sout_mux_t *p_mux, sout_input_t *p_input)
     p_stream->i_entry_max   = 1000;
     p_stream->entry         =
         calloc(p_stream->i_entry_max, sizeof(mp4_entry_t));
+    p_stream->i_entry_spilled = 0;
+    p_stream->p_spill       = NULL;
     p_stream->i_dts_start   = 0;
     p_stream->i_read_duration    = 0;
     p_stream->a52_frame = NULL;
@@ -644,12 +760,15 @@ static int Mux(sout_mux_t *p_mux)
                 i_length = 1;
 
             /* Fix last entry */
-            if (p_stream->entry[p_stream->i_entry_count-1].i_length <= 0)
-                p_stream->entry[p_stream->i_entry_count-1].i_length = i_length;
+            mp4_entry_t *e = &p_stream->entry[p_stream->i_entry_count-1 -
+                                              p_stream->i_entry_spilled];
+            if (e->i_length <= 0)
+                e->i_length = i_length;
         }
 
         /* add index entry */
-        mp4_entry_t *e = &p_stream->entry[p_stream->i_entry_count];
+        mp4_entry_t *e = &p_stream->entry[p_stream->i_entry_count -
+                                          p_stream->i_entry_spilled];
         e->i_pos    = p_sys->i_pos;
         e->i_size   = p_data->i_buffer;
 
@@ -666,7 +785,8 @@ static int Mux(sout_mux_t *p_mux)
 
         p_stream->i_entry_count++;
         /* XXX: -1 to always have 2 entry for easy adding of empty SPU */
-        if (p_stream->i_entry_count >= p_stream->i_entry_max - 1) {
+        if (p_stream->i_entry_count - p_stream->i_entry_spilled >=
+            p_stream->i_entry_max - 1 && !SpillEntries(p_mux, p_stream)) {
             p_stream->i_entry_max += 1000;
             p_stream->entry = xrealloc(p_stream->entry,
                          p_stream->i_entry_max * sizeof(mp4_entry_t));
@@ -685,14 +805,16 @@ static int Mux(sout_mux_t *p_mux)
 
         /* close subtitle with empty frame */
         if (p_stream->fmt.i_cat == SPU_ES) {
-            int64_t i_length = p_stream->entry[p_stream->i_entry_count-1].i_length;
+            int64_t i_length = p_stream->entry[p_stream->i_entry_count-1 -
+                                               p_stream->i_entry_spilled].i_length;
 
             if ( i_length != 0 && (p_data = block_Alloc(3)) ) {
                 /* TODO */
                 msg_Dbg(p_mux, "writing an empty sub") ;
 
                 /* Append a idx entry */
-                mp4_entry_t *e = &p_stream->entry[p_stream->i_entry_count];
+                mp4_entry_t *e = &p_stream->entry[p_stream->i_entry_count -
+                                                  p_stream->i_entry_spilled];
                 e->i_pos    = p_sys->i_pos;
                 e->i_size   = 3;
                 e->i_pts_dts= 0;
@@ -751,6 +873,11 @@ static block_t *ConvertSUBT(block_t *p_block)
 
 static block_t *ConvertFromAnnexB(block_t *p_block)
 {
+    /* The start codes are rewritten in place */
+    p_block = block_Unshare(p_block);
+    if (!p_block)
+        return NULL;
+
     uint8_t *last = p_block->p_buffer;  /* Assume it starts with 0x00000001 */
     uint8_t *dat  = &p_block->p_buffer[4];
     uint8_t *end = &p_block->p_buffer[p_block->i_buffer];
@@ -1099,10 +1226,8 @@ static bo_t *GetD263Tag(void)
 static void hevcParseVPS(uint8_t * p_buffer, size_t i_buffer, uint8_t *general,
                          uint8_t * numTemporalLayer, bool * temporalIdNested)
 {
-    const size_t i_decoded_nal_size = 512;
-    uint8_t p_dec_nal[i_decoded_nal_size];
-    size_t i_size = (i_buffer < i_decoded_nal_size)?i_buffer:i_decoded_nal_size;
-    nal_decode(p_buffer, p_dec_nal, i_size);
+    bs_t bs;
+    bs_init_rbsp(&bs, p_buffer, i_buffer);
 
     /* first two bytes are the NAL header, 3rd and 4th are:
         vps_video_parameter_set_id(4)
@@ -1111,23 +1236,25 @@ static void hevcParseVPS(uint8_t * p_buffer, size_t i_buffer, uint8_t *general,
         vps_max_sub_layers_minus1(3)
         vps_temporal_id_nesting_flags
     */
-    *numTemporalLayer =  ((p_dec_nal[3] & 0x0E) >> 1) + 1;
-    *temporalIdNested = (bool)(p_dec_nal[3] & 0x01);
+    bs_skip(&bs, 16 + 4 + 2 + 6);
+    *numTemporalLayer = bs_read(&bs, 3) + 1;
+    *temporalIdNested = bs_read1(&bs);
 
     /* 5th & 6th are reserved 0xffff */
+    bs_skip(&bs, 16);
     /* copy the first 12 bytes of profile tier */
-    memcpy(general, &p_dec_nal[6], 12);
+    for (int i = 0; i < 12; i++)
+        general[i] = bs_read(&bs, 8);
 }
 
 static void hevcParseSPS(uint8_t * p_buffer, size_t i_buffer, uint8_t * chroma_idc,
                          uint8_t *bit_depth_luma_minus8, uint8_t *bit_depth_chroma_minus8)
 {
-    const size_t i_decoded_nal_size = 512;
-    uint8_t p_dec_nal[i_decoded_nal_size];
-    size_t i_size = (i_buffer < i_decoded_nal_size)?i_buffer-2:i_decoded_nal_size;
-    nal_decode(p_buffer+2, p_dec_nal, i_size);
     bs_t bs;
-    bs_init(&bs, p_dec_nal, i_size);
+    bs_init_rbsp(&bs, p_buffer, i_buffer);
+
+    /* skip the NAL header */
+    bs_skip(&bs, 16);
 
     /* skip vps id */
     bs_skip(&bs, 4);
@@ -2350,6 +2477,21 @@ static void box_send(sout_mux_t *p_mux,  bo_t *box)
     free(box);
 }
 
+/* Writes a free box of i_size bytes, or only its header if the space is
+ * already zeroed */
+static void free_box_send(sout_mux_t *p_mux, uint64_t i_size, bool b_fill)
+{
+    block_t *p_block = block_Alloc(b_fill ? i_size : 8);
+    if (!p_block)
+        return;
+
+    if (b_fill)
+        memset(p_block->p_buffer, 0, i_size);
+    SetDWBE(p_block->p_buffer, i_size);
+    memcpy(&p_block->p_buffer[4], "free", 4);
+    sout_AccessOutWrite(p_mux->p_access, p_block);
+}
+
 static int64_t get_timestamp(void)
 {
     int64_t i_timestamp = time(NULL);
@@ -30,6 +30,17 @@
 
 #include "csa.h"
 
+/* Word of the bitsliced stream cypher: bit k of a word belongs to the k-th
+ * packet of a batch, so the widest vectors run the most packets at once */
+#if defined(__GNUC__) && defined(__AVX2__)
+typedef uint64_t csa_word_t __attribute__((vector_size(32)));
+#elif defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON))
+typedef uint64_t csa_word_t __attribute__((vector_size(16)));
+#else
+typedef uint64_t csa_word_t;
+#endif
+#define CSA_LANES (8 * sizeof (csa_word_t))
+
 struct csa_t
 {
     /* odd and even keys */
@@ -47,6 +58,9 @@ struct csa_t
     int     p, q, r;
 
     bool    use_odd;
+
+    /* key stream of the packets of a batch */
+    uint8_t stream[CSA_LANES][184];
 };
 
 static void csa_ComputeKey( uint8_t kk[57], uint8_t ck[8] );
@@ -610,3 +624,469 @@ static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] )
     }
 }
 
+
+/*****************************************************************************
+ * Bitsliced stream cypher
+ *****************************************************************************
+ * Each bit of the cypher state is a word, with one bit per packet: one pass
+ * of csa_StreamCypher() runs for CSA_LANES packets at once. The s-boxes are
+ * evaluated as multiplexer trees on their 5 input bits.
+ *****************************************************************************/
+#define CSA_WORDS (sizeof (csa_word_t) / sizeof (uint64_t))
+
+typedef struct
+{
+    csa_word_t A[11][4];
+    csa_word_t B[11][4];
+    csa_word_t X[4], Y[4], Z[4];
+    csa_word_t D[4], E[4], F[4];
+    csa_word_t p, q, r;
+
+    csa_word_t zero, ones;
+} csa_bs_t;
+
+/* Truth tables of the low and high output bits of sbox1..sbox7 */
+static const uint32_t csa_bs_sbox[7][2] =
+{
+    { 0x78C6B16C, 0x4B368771 },
+    { 0xE41B4B63, 0x58B98679 },
+    { 0xE41B1BE4, 0x69D25879 },
+    { 0x92AD994B, 0x66B492AD },
+    { 0x35E29E58, 0x9C274CF1 },
+    { 0x66D2E61A, 0x691BB46C },
+    { 0x266D9D92, 0xB38C691E },
+};
+
+static inline csa_word_t csa_BsLoad( const uint64_t p[CSA_WORDS] )
+{
+    csa_word_t w;
+    memcpy( &w, p, sizeof (w) );
+    return w;
+}
+
+/* b where s is set, a elsewhere */
+static inline csa_word_t csa_BsMux( csa_word_t s, csa_word_t a, csa_word_t b )
+{
+    return a ^ ( s & ( a ^ b ) );
+}
+
+/* Transposes the byte at i_offset of each lane into 8 bit planes */
+static void csa_BsSlice( const uint8_t *const *pp, size_t i_offset,
+                         unsigned i_lanes, csa_word_t plane[8] )
+{
+    uint64_t bits[8][CSA_WORDS];
+
+    memset( bits, 0, sizeof (bits) );
+    for( unsigned k = 0; k < i_lanes; k++ )
+    {
+        const unsigned v = pp[k][i_offset];
+
+        for( unsigned b = 0; b < 8; b++ )
+            bits[b][k / 64] |= (uint64_t)( ( v >> b ) & 1 ) << ( k % 64 );
+    }
+    for( unsigned b = 0; b < 8; b++ )
+        plane[b] = csa_BsLoad( bits[b] );
+}
+
+/* Transposes 8 bit planes back into the byte at i_offset of each lane */
+static void csa_BsUnslice( const csa_word_t plane[8], unsigned i_lanes,
+                           uint8_t (*pp)[184], size_t i_offset )
+{
+    uint64_t bits[8][CSA_WORDS];
+
+    memcpy( bits, plane, sizeof (bits) );
+    for( unsigned k = 0; k < i_lanes; k++ )
+    {
+        unsigned v = 0;
+
+        for( unsigned b = 0; b < 8; b++ )
+            v |= ( ( bits[b][k / 64] >> ( k % 64 ) ) & 1 ) << b;
+        pp[k][i_offset] = v;
+    }
+}
+
+static inline csa_word_t csa_BsSbox( const csa_bs_t *s, uint32_t table,
+                                     const csa_word_t in[5] )
+{
+    csa_word_t v[16];
+
+    /* in[0] selects within pairs of table entries, in[4] between halves */
+    for( unsigned i = 0; i < 16; i++ )
+    {
+        switch( ( table >> ( 2 * i ) ) & 3 )
+        {
+            case 0: v[i] = s->zero; break;
+            case 1: v[i] = ~in[0]; break;
+            case 2: v[i] = in[0]; break;
+            default: v[i] = s->ones; break;
+        }
+    }
+    for( unsigned n = 8, b = 1; n > 0; n /= 2, b++ )
+        for( unsigned i = 0; i < n; i++ )
+            v[i] = csa_BsMux( in[b], v[2*i], v[2*i+1] );
+    return v[0];
+}
+
+/* Same as one of the 4 steps of an output byte of csa_StreamCypher(), with
+ * the input nibbles of the initialisation (or NULL) */
+static void csa_BsStep( csa_bs_t *s, const csa_word_t *in_a,
+                        const csa_word_t *in_b, csa_word_t *hi, csa_word_t *lo )
+{
+    csa_word_t (*A)[4] = s->A;
+    csa_word_t (*B)[4] = s->B;
+    csa_word_t o[7][2];
+
+    /* 5 input bits (least significant first) of each s-box */
+    const csa_word_t in[7][5] = {
+        { A[9][0], A[7][3], A[6][1], A[1][2], A[4][0] },
+        { A[9][1], A[7][0], A[6][3], A[3][2], A[2][1] },
+        { A[6][2], A[5][3], A[5][1], A[2][0], A[1][3] },
+        { A[8][0], A[4][2], A[2][3], A[1][1], A[3][3] },
+        { A[9][2], A[8][1], A[6][0], A[4][3], A[5][2] },
+        { A[9][3], A[7][2], A[5][0], A[4][1], A[3][1] },
+        { A[8][3], A[8][2], A[7][1], A[3][0], A[2][2] },
+    };
+    for( unsigned i = 0; i < 7; i++ )
+    {
+        o[i][0] = csa_BsSbox( s, csa_bs_sbox[i][0], in[i] );
+        o[i][1] = csa_BsSbox( s, csa_bs_sbox[i][1], in[i] );
+    }
+
+    /* 4x4 xor of B for T3 */
+    const csa_word_t extra_B[4] = {
+        B[9][2] ^ B[6][3] ^ B[3][1] ^ B[8][0],
+        B[5][3] ^ B[8][2] ^ B[4][0] ^ B[5][1],
+        B[6][0] ^ B[8][1] ^ B[3][3] ^ B[4][2],
+        B[3][0] ^ B[6][1] ^ B[7][2] ^ B[9][3],
+    };
+
+    csa_word_t next_A1[4], next_B1[4], next_B1r[4], sum[4];
+    csa_word_t carry = s->r;
+
+    for( unsigned b = 0; b < 4; b++ )
+    {
+        /* T1, T2 */
+        next_A1[b] = A[10][b] ^ s->X[b];
+        next_B1[b] = B[7][b] ^ B[10][b] ^ s->Y[b];
+        if( in_a != NULL )
+        {
+            next_A1[b] ^= s->D[b] ^ in_a[b];
+            next_B1[b] ^= in_b[b];
+        }
+
+        /* T4: Z + E + r */
+        sum[b] = s->Z[b] ^ s->E[b] ^ carry;
+        carry = ( s->Z[b] & s->E[b] ) | ( carry & ( s->Z[b] ^ s->E[b] ) );
+    }
+    /* if p=1, rotate T2 left */
+    for( unsigned b = 0; b < 4; b++ )
+        next_B1r[b] = csa_BsMux( s->p, next_B1[b], next_B1[(b + 3) & 3] );
+
+    for( unsigned b = 0; b < 4; b++ )
+    {
+        const csa_word_t next_E = s->F[b];
+
+        /* T3 */
+        s->D[b] = s->E[b] ^ s->Z[b] ^ extra_B[b];
+        s->F[b] = csa_BsMux( s->q, s->E[b], sum[b] );
+        s->E[b] = next_E;
+    }
+    s->r = csa_BsMux( s->q, s->r, carry );
+
+    memmove( &A[2], &A[1], 9 * sizeof (A[1]) );
+    memmove( &B[2], &B[1], 9 * sizeof (B[1]) );
+    memcpy( A[1], next_A1, sizeof (next_A1) );
+    memcpy( B[1], next_B1r, sizeof (next_B1r) );
+
+    s->X[3] = o[3][0]; s->X[2] = o[2][0]; s->X[1] = o[1][1]; s->X[0] = o[0][1];
+    s->Y[3] = o[5][0]; s->Y[2] = o[4][0]; s->Y[1] = o[3][1]; s->Y[0] = o[2][1];
+    s->Z[3] = o[1][0]; s->Z[2] = o[0][0]; s->Z[1] = o[5][1]; s->Z[0] = o[4][1];
+    s->p = o[6][1];
+    s->q = o[6][0];
+
+    /* 2 output bits are a function of the 4 bits of D */
+    *hi = s->D[2] ^ s->D[3];
+    *lo = s->D[0] ^ s->D[1];
+}
+
+/* Same as csa_StreamCypher() initialized with ck[k] and sb[k] for each lane
+ * k, followed by i_blocks generation calls, the output of which is stored */
+static void csa_StreamCypherBatch( csa_t *c, const uint8_t *const *ck,
+                                   const uint8_t *const *sb, unsigned i_lanes,
+                                   int i_blocks )
+{
+    const uint64_t zero[CSA_WORDS] = { 0 };
+    uint64_t ones[CSA_WORDS];
+    csa_bs_t s;
+    csa_word_t plane[8];
+
+    memset( ones, 0xff, sizeof (ones) );
+    s.zero = csa_BsLoad( zero );
+    s.ones = csa_BsLoad( ones );
+
+    /* load the first 32 bits of CK into A[1]..A[8], the last into B[1]..B[8]
+     * all other regs = 0 */
+    for( unsigned i = 0; i < 11; i++ )
+        for( unsigned b = 0; b < 4; b++ )
+            s.A[i][b] = s.B[i][b] = s.zero;
+    for( unsigned i = 0; i < 4; i++ )
+    {
+        csa_BsSlice( ck, i, i_lanes, plane );
+        memcpy( s.A[1+2*i+0], &plane[4], sizeof (s.A[0]) );
+        memcpy( s.A[1+2*i+1], &plane[0], sizeof (s.A[0]) );
+
+        csa_BsSlice( ck, 4 + i, i_lanes, plane );
+        memcpy( s.B[1+2*i+0], &plane[4], sizeof (s.B[0]) );
+        memcpy( s.B[1+2*i+1], &plane[0], sizeof (s.B[0]) );
+    }
+    for( unsigned b = 0; b < 4; b++ )
+        s.X[b] = s.Y[b] = s.Z[b] = s.D[b] = s.E[b] = s.F[b] = s.zero;
+    s.p = s.q = s.r = s.zero;
+
+    /* initialisation with the first block */
+    for( unsigned i = 0; i < 8; i++ )
+    {
+        csa_word_t hi, lo;
+
+        csa_BsSlice( sb, i, i_lanes, plane );
+        for( unsigned j = 0; j < 4; j++ )
+        {
+            /* in1 (high nibble) and in2 alternate between T1 and T2 */
+            const csa_word_t *in1 = &plane[4], *in2 = &plane[0];
+
+            csa_BsStep( &s, (j % 2) ? in2 : in1, (j % 2) ? in1 : in2,
+                        &hi, &lo );
+        }
+    }
+
+    /* generation */
+    for( int i = 0; i < 8 * i_blocks; i++ )
+    {
+        for( unsigned j = 0; j < 4; j++ )
+            csa_BsStep( &s, NULL, NULL, &plane[7 - 2*j], &plane[6 - 2*j] );
+        csa_BsUnslice( plane, i_lanes, c->stream, i );
+    }
+}
+
+/* Same as csa_BlockDecypher() on the blocks of independent packets, which
+ * interleaves their table lookups */
+#define CSA_BLOCK_WAYS 4
+static void csa_BlockDecypherWays( uint8_t *kk[CSA_BLOCK_WAYS],
+                                   uint8_t ib[CSA_BLOCK_WAYS][8],
+                                   uint8_t bd[CSA_BLOCK_WAYS][8] )
+{
+    unsigned R[CSA_BLOCK_WAYS][9];
+
+    for( unsigned w = 0; w < CSA_BLOCK_WAYS; w++ )
+        for( unsigned i = 0; i < 8; i++ )
+            R[w][i+1] = ib[w][i];
+
+    for( unsigned i = 56; i > 0; i-- )
+    {
+        for( unsigned w = 0; w < CSA_BLOCK_WAYS; w++ )
+        {
+            const unsigned sbox_out = block_sbox[ kk[w][i]^R[w][7] ];
+            const unsigned perm_out = block_perm[sbox_out];
+            const unsigned t = R[w][8] ^ sbox_out;
+            const unsigned next_R8 = R[w][7];
+
+            R[w][7] = R[w][6] ^ perm_out;
+            R[w][6] = R[w][5];
+            R[w][5] = R[w][4] ^ t;
+            R[w][4] = R[w][3] ^ t;
+            R[w][3] = R[w][2] ^ t;
+            R[w][2] = R[w][1];
+            R[w][1] = t;
+            R[w][8] = next_R8;
+        }
+    }
+
+    for( unsigned w = 0; w < CSA_BLOCK_WAYS; w++ )
+        for( unsigned i = 0; i < 8; i++ )
+            bd[w][i] = R[w][i+1];
+}
+
+/* Size of the header of a packet, up to its scrambled payload */
+static int csa_Header( const uint8_t *pkt )
+{
+    int i_hdr = 4;
+
+    if( pkt[3]&0x20 )
+    {
+        /* skip adaption field */
+        i_hdr += pkt[4] + 1;
+    }
+    return i_hdr;
+}
+
+/*****************************************************************************
+ * csa_DecryptBatch:
+ *****************************************************************************/
+static void csa_DecryptLanes( csa_t *c, uint8_t **pp_pkt, int i_pkt,
+                              int i_pkt_size )
+{
+    uint8_t *pkt[CSA_LANES];
+    const uint8_t *ck[CSA_LANES], *sb[CSA_LANES];
+    uint8_t *kk[CSA_LANES];
+    int hdr[CSA_LANES];
+    unsigned i_lanes = 0;
+    int i_blocks = 0;
+
+    for( int k = 0; k < i_pkt; k++ )
+    {
+        uint8_t *p = pp_pkt[k];
+
+        /* transport scrambling control */
+        if( (p[3]&0x80) == 0 )
+            continue;
+
+        ck[i_lanes] = (p[3]&0x40) ? c->o_ck : c->e_ck;
+        kk[i_lanes] = (p[3]&0x40) ? c->o_kk : c->e_kk;
+
+        /* clear transport scrambling control */
+        p[3] &= 0x3f;
+
+        const int i_hdr = csa_Header( p );
+        if( 188 - i_hdr < 8 || i_pkt_size < i_hdr )
+            continue;
+
+        const int n = (i_pkt_size - i_hdr) / 8;
+        const int i_residue = (i_pkt_size - i_hdr) % 8;
+        i_blocks = __MAX( i_blocks, __MAX( n - 1, 0 ) + (i_residue > 0) );
+
+        pkt[i_lanes] = p;
+        sb[i_lanes] = &p[i_hdr];
+        hdr[i_lanes] = i_hdr;
+        i_lanes++;
+    }
+    if( i_lanes == 0 )
+        return;
+
+    csa_StreamCypherBatch( c, ck, sb, i_lanes, i_blocks );
+
+    for( unsigned k0 = 0; k0 < i_lanes; k0 += CSA_BLOCK_WAYS )
+    {
+        const unsigned i_ways = __MIN( i_lanes - k0, CSA_BLOCK_WAYS );
+        uint8_t ib[CSA_BLOCK_WAYS][8], block[CSA_BLOCK_WAYS][8];
+        uint8_t *kkw[CSA_BLOCK_WAYS];
+        int n[CSA_BLOCK_WAYS], n_max = 0;
+
+        /* the unused ways repeat the last packet, and are not stored */
+        for( unsigned w = 0; w < CSA_BLOCK_WAYS; w++ )
+        {
+            const unsigned k = k0 + __MIN( w, i_ways - 1 );
+            kkw[w] = kk[k];
+            n[w] = (i_pkt_size - hdr[k]) / 8;
+            memcpy( ib[w], &pkt[k][hdr[k]], 8 );
+            n_max = __MAX( n_max, n[w] );
+        }
+
+        for( int i = 1; i < n_max + 1; i++ )
+        {
+            csa_BlockDecypherWays( kkw, ib, block );
+            for( unsigned w = 0; w < i_ways; w++ )
+            {
+                uint8_t *p = pkt[k0 + w] + hdr[k0 + w];
+                const uint8_t *stream = c->stream[k0 + w];
+
+                if( i > n[w] )
+                    continue;
+                for( int j = 0; j < 8; j++ )
+                {
+                    /* xor ib with stream, the last block with nothing */
+                    ib[w][j] = ( i != n[w] ) ? p[8*i+j] ^ stream[8*(i-1)+j] : 0;
+                    p[8*(i-1)+j] = ib[w][j] ^ block[w][j];
+                }
+            }
+        }
+
+        for( unsigned w = 0; w < i_ways; w++ )
+        {
+            uint8_t *p = pkt[k0 + w];
+            const int i_residue = (i_pkt_size - hdr[k0 + w]) % 8;
+            const uint8_t *stream = c->stream[k0 + w] + 8 * __MAX( n[w] - 1, 0 );
+
+            for( int j = 0; j < i_residue; j++ )
+                p[i_pkt_size - i_residue + j] ^= stream[j];
+        }
+    }
+}
+
+void csa_DecryptBatch( csa_t *c, uint8_t **pp_pkt, int i_pkt, int i_pkt_size )
+{
+    for( int i = 0; i < i_pkt; i += CSA_LANES )
+        csa_DecryptLanes( c, &pp_pkt[i], __MIN( i_pkt - i, (int)CSA_LANES ),
+                          i_pkt_size );
+}
+
+/*****************************************************************************
+ * csa_EncryptBatch:
+ *****************************************************************************/
+static void csa_EncryptLanes( csa_t *c, uint8_t **pp_pkt, int i_pkt,
+                              int i_pkt_size )
+{
+    uint8_t *pkt[CSA_LANES];
+    const uint8_t *ck[CSA_LANES], *sb[CSA_LANES];
+    int hdr[CSA_LANES];
+    unsigned i_lanes = 0;
+    int i_blocks = 0;
+
+    uint8_t *ck_use = c->use_odd ? c->o_ck : c->e_ck;
+    uint8_t *kk = c->use_odd ? c->o_kk : c->e_kk;
+
+    for( int k = 0; k < i_pkt; k++ )
+    {
+        uint8_t *p = pp_pkt[k];
+        const int i_hdr = csa_Header( p );
+        const int n = (i_pkt_size - i_hdr) / 8;
+        const int i_residue = (i_pkt_size - i_hdr) % 8;
+
+        if( n <= 0 )
+        {
+            p[3] &= 0x3f;
+            continue;
+        }
+
+        /* set transport scrambling control */
+        p[3] |= c->use_odd ? 0xc0 : 0x80;
+
+        /* chain the blocks backward, in place */
+        uint8_t ib[8] = { 0 }, block[8];
+        for( int i = n; i > 0; i-- )
+        {
+            for( int j = 0; j < 8; j++ )
+                block[j] = p[i_hdr+8*(i-1)+j] ^ ib[j];
+            csa_BlockCypher( kk, block, ib );
+            memcpy( &p[i_hdr+8*(i-1)], ib, 8 );
+        }
+        i_blocks = __MAX( i_blocks, n - 1 + (i_residue > 0) );
+
+        pkt[i_lanes] = p;
+        ck[i_lanes] = ck_use;
+        sb[i_lanes] = &p[i_hdr];
+        hdr[i_lanes] = i_hdr;
+        i_lanes++;
+    }
+    if( i_lanes == 0 )
+        return;
+
+    csa_StreamCypherBatch( c, ck, sb, i_lanes, i_blocks );
+
+    for( unsigned k = 0; k < i_lanes; k++ )
+    {
+        uint8_t *p = pkt[k];
+        const int i_hdr = hdr[k];
+        const int i_size = i_pkt_size - i_hdr - 8;
+
+        /* the first block initialized the stream cypher */
+        for( int j = 0; j < i_size; j++ )
+            p[i_hdr+8+j] ^= c->stream[k][j];
+    }
+}
+
+void csa_EncryptBatch( csa_t *c, uint8_t **pp_pkt, int i_pkt, int i_pkt_size )
+{
+    for( int i = 0; i < i_pkt; i += CSA_LANES )
+        csa_EncryptLanes( c, &pp_pkt[i], __MIN( i_pkt - i, (int)CSA_LANES ),
+                          i_pkt_size );
+}
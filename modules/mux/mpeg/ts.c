@@ -149,6 +149,11 @@ static void    Close  ( vlc_object_t * );
 #define BMAX_TEXT N_( "Maximum B (deprecated)")
 #define BMAX_LONGTEXT N_( "This setting is deprecated and not used anymore")
 
+#define MUXRATE_TEXT N_("Constant mux rate (bits/s)")
+#define MUXRATE_LONGTEXT N_("Output a constant bitrate stream, padded with " \
+  "null packets, with packets and PCRs dated from a fixed schedule at " \
+  "that rate. 0 disables it.")
+
 #define DTS_TEXT N_("DTS delay (ms)")
 #define DTS_LONGTEXT N_("Delay the DTS (decoding time " \
   "stamps) and PTS (presentation timestamps) of the data in the " \
@@ -210,6 +215,8 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "pcr", 70, PCR_TEXT, PCR_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "bmin", 0, BMIN_TEXT, BMIN_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "bmax", 0, BMAX_TEXT, BMAX_LONGTEXT, true)
+    add_integer_with_range( SOUT_CFG_PREFIX "muxrate", 0, 0, 200000000,
+                            MUXRATE_TEXT, MUXRATE_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "dts-delay", 400, DTS_TEXT, DTS_LONGTEXT, true)
 
     add_bool( SOUT_CFG_PREFIX "crypt-audio", true, ACRYPT_TEXT, ACRYPT_LONGTEXT, true)
@@ -228,7 +235,7 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "pid-video", "pid-audio", "pid-spu", "pid-pmt", "tsid",
     "netid", "sdtdesc",
-    "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
+    "es-id-pid", "shaping", "pcr", "bmin", "bmax", "muxrate", "use-key-frames",
     "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
     "muxpmt", "program-pmt", "alignment",
     NULL
@@ -352,10 +359,20 @@ struct sout_mux_sys_t
 
     sdt_psi_t       sdt;
 
+    /* PAT and PMT/SDT packets, rendered once per version */
+    sout_buffer_chain_t pat_cache;
+    sout_buffer_chain_t pmt_cache;
+
     /* for TS building */
     int64_t         i_bitrate_min;
     int64_t         i_bitrate_max;
 
+    /* constant bitrate schedule: packet i_cbr_packets is sent at
+     * i_cbr_start + i_cbr_packets * 188 * 8 / i_muxrate */
+    int64_t         i_muxrate;
+    mtime_t         i_cbr_start;
+    int64_t         i_cbr_packets;
+
     int64_t         i_shaping_delay;
     int64_t         i_pcr_delay;
 
@@ -370,6 +387,19 @@ struct sout_mux_sys_t
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
     bool            b_crypt_video;
+
+    /* output statistics */
+    struct
+    {
+        uint64_t    i_packets;
+        uint64_t    i_null;
+        mtime_t     i_first;
+        mtime_t     i_last;
+        int64_t     i_pcr;        /* last PCR (27 MHz), -1 if none */
+        uint64_t    i_pcr_packets; /* packets sent since */
+        int64_t     i_pcr_interval_max; /* 27 MHz */
+        int64_t     i_pcr_error_max;    /* 27 MHz, with a mux rate */
+    } stats;
 };
 
 /* Reserve a pid and return it */
@@ -421,6 +451,7 @@ static int Mux      ( sout_mux_t * );
 
 static block_t *FixPES( sout_mux_t *p_mux, block_fifo_t *p_fifo );
 static block_t *Add_ADTS( block_t *, es_format_t * );
+static void TSScramble  ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts );
 static void TSSchedule  ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
 static void TSDate      ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
@@ -429,7 +460,7 @@ static void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
-static void TSSetPCR( block_t *p_ts, mtime_t i_dts );
+static void TSSetPCR( block_t *p_ts, int64_t i_pcr27 );
 
 static csa_t *csaSetup( vlc_object_t *p_this )
 {
@@ -703,6 +734,11 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->b_use_key_frames = var_GetBool( p_mux, SOUT_CFG_PREFIX "use-key-frames" );
 
+    p_sys->i_muxrate = var_GetInteger( p_mux, SOUT_CFG_PREFIX "muxrate" );
+    p_sys->stats.i_pcr = -1;
+    BufferChainInit( &p_sys->pat_cache );
+    BufferChainInit( &p_sys->pmt_cache );
+
     p_mux->p_sys        = p_sys;
 
     p_sys->csa = csaSetup(p_this);
@@ -743,6 +779,17 @@ static void Close( vlc_object_t * p_this )
         free( p_sys->sdt.desc[i].psz_provider );
     }
 
+    if( p_sys->stats.i_last > p_sys->stats.i_first )
+        msg_Dbg( p_mux, "sent %"PRIu64" packets (%"PRIu64" null) at %"PRId64
+                 " bit/s, PCR interval max %"PRId64" us, PCR accuracy %"PRId64
+                 " ns", p_sys->stats.i_packets, p_sys->stats.i_null,
+                 (int64_t)( p_sys->stats.i_packets * 188 * 8 * CLOCK_FREQ /
+                            ( p_sys->stats.i_last - p_sys->stats.i_first ) ),
+                 p_sys->stats.i_pcr_interval_max / 27,
+                 p_sys->stats.i_pcr_error_max * 1000 / 27 );
+
+    BufferChainClean( &p_sys->pat_cache );
+    BufferChainClean( &p_sys->pmt_cache );
     free( p_sys );
 }
 
@@ -1075,6 +1122,7 @@ static int AddStream( sout_mux_t *p_mux, sout_input_t *p_input )
 
     /* We only change PMT version (PAT isn't changed) */
     p_sys->i_pmt_version_number = ( p_sys->i_pmt_version_number + 1 )%32;
+    BufferChainClean( &p_sys->pmt_cache );
 
     /* Update pcr_pid */
     if( p_input->p_fmt->i_cat != SPU_ES &&
@@ -1178,6 +1226,7 @@ static int DelStream( sout_mux_t *p_mux, sout_input_t *p_input )
     /* We only change PMT version (PAT isn't changed) */
     p_sys->i_pmt_version_number++;
     p_sys->i_pmt_version_number %= 32;
+    BufferChainClean( &p_sys->pmt_cache );
 
     return VLC_SUCCESS;
 }
@@ -1553,7 +1602,9 @@ static bool MuxStreams(sout_mux_t *p_mux )
         BufferChainAppend( &chain_ts, p_ts );
     }
 
-    /* 4: date and send */
+    /* 4: scramble, date and send */
+    if( p_sys->csa != NULL )
+        TSScramble( p_mux, &chain_ts );
     TSSchedule( p_mux, &chain_ts, i_pcr_length, i_pcr_dts );
     return false;
 }
@@ -1742,12 +1793,162 @@ static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
 }
 
+/* Scrambles the packets of a chain in batches, before they are dated: the
+ * PCR is written in the adaptation field, which is not scrambled */
+static void TSScramble( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts )
+{
+    sout_mux_sys_t  *p_sys = p_mux->p_sys;
+    uint8_t *pp_pkt[CSA_BATCH];
+    int i_pkt = 0;
+
+    vlc_mutex_lock( &p_sys->csa_lock );
+    for( block_t *p_ts = p_chain_ts->p_first; p_ts != NULL; p_ts = p_ts->p_next )
+    {
+        if( !( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED ) )
+            continue;
+
+        pp_pkt[i_pkt++] = p_ts->p_buffer;
+        if( i_pkt == CSA_BATCH )
+        {
+            csa_EncryptBatch( p_sys->csa, pp_pkt, i_pkt, p_sys->i_csa_pkt_size );
+            i_pkt = 0;
+        }
+    }
+    if( i_pkt > 0 )
+        csa_EncryptBatch( p_sys->csa, pp_pkt, i_pkt, p_sys->i_csa_pkt_size );
+    vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
+/* Dates (in 27 MHz ticks) and sends a packet */
+static void TSSend( sout_mux_t *p_mux, block_t *p_ts, int64_t i_date27,
+                    mtime_t i_length )
+{
+    sout_mux_sys_t  *p_sys = p_mux->p_sys;
+
+    p_ts->i_dts    = i_date27 / 27;
+    p_ts->i_length = i_length;
+
+    if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
+    {
+        /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
+        int64_t i_pcr27 = i_date27 - ( p_sys->i_dts_delay + p_sys->first_dts ) * 27;
+        TSSetPCR( p_ts, i_pcr27 );
+
+        if( p_sys->stats.i_pcr >= 0 )
+        {
+            int64_t i_interval = i_pcr27 - p_sys->stats.i_pcr;
+            p_sys->stats.i_pcr_interval_max =
+                __MAX( p_sys->stats.i_pcr_interval_max, i_interval );
+            if( p_sys->i_muxrate > 0 )
+            {
+                /* PCR accuracy (TR 101 290): distance to the PCR expected
+                 * from the previous one at the mux rate */
+                int64_t i_error = i_interval - (int64_t)p_sys->stats.i_pcr_packets
+                                  * 188 * 8 * 27000000 / p_sys->i_muxrate;
+                p_sys->stats.i_pcr_error_max =
+                    __MAX( p_sys->stats.i_pcr_error_max, llabs( i_error ) );
+            }
+        }
+        p_sys->stats.i_pcr = i_pcr27;
+        p_sys->stats.i_pcr_packets = 0;
+    }
+    if( p_sys->stats.i_packets++ == 0 )
+        p_sys->stats.i_first = p_ts->i_dts;
+    p_sys->stats.i_last = p_ts->i_dts + p_ts->i_length;
+    p_sys->stats.i_pcr_packets++;
+
+    /* latency */
+    p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
+
+    sout_AccessOutWrite( p_mux->p_access, p_ts );
+}
+
+static block_t *TSNull( void )
+{
+    block_t *p_ts = block_Alloc( 188 );
+    if( unlikely(p_ts == NULL) )
+        return NULL;
+
+    p_ts->p_buffer[0] = 0x47;
+    p_ts->p_buffer[1] = 0x1f;
+    p_ts->p_buffer[2] = 0xff;
+    p_ts->p_buffer[3] = 0x10;
+    memset( &p_ts->p_buffer[4], 0xff, 184 );
+    return p_ts;
+}
+
+/* Sends the packets in the slots of the constant bitrate schedule up to the
+ * end of the chain duration, filling the free ones with null packets. */
+static void TSDateCBR( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
+                       mtime_t i_pcr_length, mtime_t i_pcr_dts )
+{
+    sout_mux_sys_t  *p_sys = p_mux->p_sys;
+    const int64_t i_rate = p_sys->i_muxrate;
+    const mtime_t i_packet_length = 188 * 8 * CLOCK_FREQ / i_rate;
+    int i_packet_count = p_chain_ts->i_depth;
+
+    /* (Re)start the schedule on the first chain, or when the input jumped
+     * away from it by more than the shaping delay */
+    mtime_t i_next = p_sys->i_cbr_start +
+                     p_sys->i_cbr_packets * 188 * 8 * CLOCK_FREQ / i_rate;
+    if( p_sys->i_cbr_start == 0 ||
+        i_pcr_dts > i_next + p_sys->i_shaping_delay ||
+        i_pcr_dts + i_pcr_length + p_sys->i_shaping_delay < i_next )
+    {
+        if( p_sys->i_cbr_start != 0 )
+            msg_Warn( p_mux, "resetting the mux rate schedule (%"PRId64" us off)",
+                      i_pcr_dts - i_next );
+        p_sys->i_cbr_start = i_pcr_dts;
+        p_sys->i_cbr_packets = 0;
+        p_sys->stats.i_pcr = -1;
+    }
+
+    int64_t i_slots = ( i_pcr_dts + i_pcr_length - p_sys->i_cbr_start ) *
+                      i_rate / ( 188 * 8 * CLOCK_FREQ ) - p_sys->i_cbr_packets;
+    int64_t i_null = i_slots - i_packet_count;
+    if( i_null < 0 )
+    {
+        msg_Warn( p_mux, "mux rate exceeded by %"PRId64" packets", -i_null );
+        i_null = 0;
+    }
+
+    const int64_t i_total = i_packet_count + i_null;
+    for( int64_t i = 0; i < i_total; i++ )
+    {
+        /* spread the null packets evenly */
+        bool b_null = ( i + 1 ) * i_null / i_total > i * i_null / i_total;
+        block_t *p_ts = b_null ? TSNull() : BufferChainGet( p_chain_ts );
+        if( p_ts == NULL )
+            continue;
+        if( b_null )
+            p_sys->stats.i_null++;
+
+        int64_t i_date27 = p_sys->i_cbr_start * 27 +
+            p_sys->i_cbr_packets * 188 * 8 * 27000000 / i_rate;
+        TSSend( p_mux, p_ts, i_date27, i_packet_length );
+
+        /* Every i_rate packets, exactly 188 * 8 seconds have passed: moving
+         * the origin then keeps the products above from overflowing */
+        if( ++p_sys->i_cbr_packets == i_rate )
+        {
+            p_sys->i_cbr_start += 188 * 8 * CLOCK_FREQ;
+            p_sys->i_cbr_packets = 0;
+        }
+    }
+}
+
 static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                     mtime_t i_pcr_length, mtime_t i_pcr_dts )
 {
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
     int i_packet_count = p_chain_ts->i_depth;
 
+    if( p_sys->i_muxrate > 0 )
+    {
+        TSDateCBR( p_mux, p_chain_ts, i_pcr_length, i_pcr_dts );
+        return;
+    }
+
     if ( i_pcr_length / 1000 > 0 )
     {
         int i_bitrate = ((uint64_t)i_packet_count * 188 * 8000)
@@ -1771,27 +1972,10 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
     for (int i = 0; i < i_packet_count; i++ )
     {
         block_t *p_ts = BufferChainGet( p_chain_ts );
-        mtime_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
-
-        p_ts->i_dts    = i_new_dts;
-        p_ts->i_length = i_pcr_length / i_packet_count;
 
-        if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
-        {
-            /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
-            TSSetPCR( p_ts, p_ts->i_dts - p_sys->i_dts_delay - p_sys->first_dts );
-        }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
-        {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
-        }
-
-        /* latency */
-        p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
-
-        sout_AccessOutWrite( p_mux->p_access, p_ts );
+        /* dated at 27 MHz, not to round PCRs to the microsecond */
+        TSSend( p_mux, p_ts, i_pcr_dts * 27 + i_pcr_length * 27 * i / i_packet_count,
+                i_pcr_length / i_packet_count );
     }
 }
 
@@ -1898,33 +2082,81 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
     return p_ts;
 }
 
-static void TSSetPCR( block_t *p_ts, mtime_t i_dts )
+static void TSSetPCR( block_t *p_ts, int64_t i_pcr27 )
 {
-    mtime_t i_pcr = 9 * i_dts / 100;
+    int64_t i_pcr = i_pcr27 / 300;
+    int i_ext = i_pcr27 % 300;
 
     p_ts->p_buffer[6]  = ( i_pcr >> 25 )&0xff;
     p_ts->p_buffer[7]  = ( i_pcr >> 17 )&0xff;
     p_ts->p_buffer[8]  = ( i_pcr >> 9  )&0xff;
     p_ts->p_buffer[9]  = ( i_pcr >> 1  )&0xff;
     p_ts->p_buffer[10] = ( i_pcr << 7  )&0x80;
-    p_ts->p_buffer[10] |= 0x7e;
-    p_ts->p_buffer[11] = 0; /* we don't set PCR extension */
+    p_ts->p_buffer[10] |= 0x7e | ( ( i_ext >> 8 )&0x01 );
+    p_ts->p_buffer[11] = i_ext & 0xff;
+}
+
+/* Appends copies of cached PSI packets, with the continuity counters of their
+ * tables */
+static void PSICacheCopy( sout_mux_t *p_mux, const sout_buffer_chain_t *p_cache,
+                          sout_buffer_chain_t *c )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    for( block_t *p_pkt = p_cache->p_first; p_pkt != NULL; p_pkt = p_pkt->p_next )
+    {
+        block_t *p_ts = block_Duplicate( p_pkt );
+        if( unlikely(p_ts == NULL) )
+            break;
+
+        int i_pid = ( ( p_ts->p_buffer[1] & 0x1f ) << 8 ) | p_ts->p_buffer[2];
+        ts_stream_t *p_psi = NULL;
+        if( i_pid == p_sys->pat.i_pid )
+            p_psi = &p_sys->pat;
+        else if( i_pid == p_sys->sdt.ts.i_pid )
+            p_psi = &p_sys->sdt.ts;
+        for( unsigned i = 0; p_psi == NULL && i < p_sys->i_num_pmt; i++ )
+            if( i_pid == p_sys->pmt[i].i_pid )
+                p_psi = &p_sys->pmt[i];
+
+        if( p_psi != NULL )
+        {
+            p_ts->p_buffer[3] = ( p_ts->p_buffer[3] & 0xf0 ) |
+                                p_psi->i_continuity_counter;
+            p_psi->i_continuity_counter = ( p_psi->i_continuity_counter + 1 )%16;
+        }
+        BufferChainAppend( c, p_ts );
+    }
 }
 
 void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
 {
     sout_mux_sys_t       *p_sys = p_mux->p_sys;
 
-    BuildPAT( DVBPSI_HANDLE_PARAM(p_sys->p_dvbpsi)
-              c, (PEStoTSCallback)BufferChainAppend,
-              p_sys->i_tsid, p_sys->i_pat_version_number,
-              &p_sys->pat,
-              p_sys->i_num_pmt, p_sys->pmt, p_sys->i_pmt_program_number );
+    if( p_sys->pat_cache.i_depth == 0 )
+    {
+        /* counters are set when copying */
+        int i_cc = p_sys->pat.i_continuity_counter;
+        BuildPAT( DVBPSI_HANDLE_PARAM(p_sys->p_dvbpsi)
+                  &p_sys->pat_cache, (PEStoTSCallback)BufferChainAppend,
+                  p_sys->i_tsid, p_sys->i_pat_version_number,
+                  &p_sys->pat,
+                  p_sys->i_num_pmt, p_sys->pmt, p_sys->i_pmt_program_number );
+        p_sys->pat.i_continuity_counter = i_cc;
+    }
+    PSICacheCopy( p_mux, &p_sys->pat_cache, c );
 }
 
 static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
 {
     sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    if( p_sys->pmt_cache.i_depth > 0 )
+    {
+        PSICacheCopy( p_mux, &p_sys->pmt_cache, c );
+        return;
+    }
+
     pes_mapped_stream_t mappeds[p_mux->i_nb_inputs];
 
     for (int i_stream = 0; i_stream < p_mux->i_nb_inputs; i_stream++ )
@@ -1943,11 +2175,23 @@ static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
         mappeds[i_stream].ts = &p_stream->ts;
     }
 
+    /* counters are set when copying */
+    int pi_cc[MAX_PMT];
+    for( unsigned i = 0; i < p_sys->i_num_pmt; i++ )
+        pi_cc[i] = p_sys->pmt[i].i_continuity_counter;
+    int i_sdt_cc = p_sys->sdt.ts.i_continuity_counter;
+
     BuildPMT( DVBPSI_HANDLE_PARAM(p_sys->p_dvbpsi) VLC_OBJECT(p_mux),
-              c, (PEStoTSCallback)BufferChainAppend,
+              &p_sys->pmt_cache, (PEStoTSCallback)BufferChainAppend,
               p_sys->i_tsid, p_sys->i_pmt_version_number,
               p_sys->i_pcr_pid,
               &p_sys->sdt,
               p_sys->i_num_pmt, p_sys->pmt, p_sys->i_pmt_program_number,
               p_mux->i_nb_inputs, mappeds );
+
+    for( unsigned i = 0; i < p_sys->i_num_pmt; i++ )
+        p_sys->pmt[i].i_continuity_counter = pi_cc[i];
+    p_sys->sdt.ts.i_continuity_counter = i_sdt_cc;
+
+    PSICacheCopy( p_mux, &p_sys->pmt_cache, c );
 }
@@ -42,6 +42,7 @@
 #include <vlc_bits.h>
 #include "../codec/cc.h"
 #include "packetizer_helper.h"
+#include "startcode_helper.h"
 #include "../demux/mpeg/mpeg_parser_helpers.h"
 
 /*****************************************************************************
@@ -202,6 +203,7 @@ static int Open( vlc_object_t *p_this )
 
     packetizer_Init( &p_sys->packetizer,
                      p_h264_startcode, sizeof(p_h264_startcode),
+                     startcode_FindAnnexB,
                      p_h264_startcode, 1, 5,
                      PacketizeReset, PacketizeParse, PacketizeValidate, p_dec );
 
@@ -431,6 +433,17 @@ static block_t *PacketizeAVC1( decoder_t *p_dec, block_t **pp_block )
     p_block = *pp_block;
     *pp_block = NULL;
 
+    /* With 4 bytes NAL sizes, the sizes are overwritten with start codes and
+     * the NALs reference the sample payload instead of copies of it */
+    const bool b_inplace = p_sys->i_avcC_length_size == 4;
+    if( b_inplace )
+    {
+        p_block = block_Unshare( p_block );
+        if( !p_block )
+            return NULL;
+        p_block = block_Share( p_block );
+    }
+
     for( p = p_block->p_buffer; p < &p_block->p_buffer[p_block->i_buffer]; )
     {
         block_t *p_pic;
@@ -450,7 +463,27 @@ static block_t *PacketizeAVC1( decoder_t *p_dec, block_t **pp_block )
             break;
         }
 
-        block_t *p_part = CreateAnnexbNAL( p_dec, p, i_size );
+        /* SPS and PPS are kept around: they must not hold the sample */
+        const int i_nal_type = p[0]&0x1f;
+        block_t *p_part;
+        if( b_inplace && i_nal_type != NAL_SPS && i_nal_type != NAL_PPS )
+        {
+            /* Only the bytes of this NAL are modified, no reference to them
+             * has been handed out yet */
+            p[-4] = 0x00;
+            p[-3] = 0x00;
+            p[-2] = 0x00;
+            p[-1] = 0x01;
+
+            p_part = block_Clone( p_block );
+            if( p_part )
+            {
+                p_part->p_buffer += p - 4 - p_block->p_buffer;
+                p_part->i_buffer = 4 + i_size;
+            }
+        }
+        else
+            p_part = CreateAnnexbNAL( p_dec, p, i_size );
         if( !p_part )
             break;
 
@@ -466,6 +499,22 @@ static block_t *PacketizeAVC1( decoder_t *p_dec, block_t **pp_block )
     }
     block_Release( p_block );
 
+    /* A picture made of a single NAL may still reference a sample: it is
+     * made writable, which copies nothing once the sample is released */
+    for( block_t **pp_pic = &p_ret; b_inplace && *pp_pic != NULL; )
+    {
+        block_t *p_next = (*pp_pic)->p_next;
+
+        *pp_pic = block_Unshare( *pp_pic );
+        if( *pp_pic == NULL )
+        {
+            *pp_pic = p_next;
+            continue;
+        }
+        (*pp_pic)->p_next = p_next;
+        pp_pic = &(*pp_pic)->p_next;
+    }
+
     return p_ret;
 }
 
@@ -764,16 +813,11 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
 
-    uint8_t *pb_dec = NULL;
-    int     i_dec = 0;
     bs_t s;
     int i_tmp;
     int i_sps_id;
 
-    CreateDecodedNAL( &pb_dec, &i_dec, &p_frag->p_buffer[5],
-                     p_frag->i_buffer - 5 );
-
-    bs_init( &s, pb_dec, i_dec );
+    bs_init_rbsp( &s, &p_frag->p_buffer[5], p_frag->i_buffer - 5 );
     int i_profile_idc = bs_read( &s, 8 );
     p_dec->fmt_out.i_profile = i_profile_idc;
     /* Skip constraint_set0123, reserved(4) */
@@ -784,7 +828,6 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
     if( i_sps_id >= SPS_MAX || i_sps_id < 0 )
     {
         msg_Warn( p_dec, "invalid SPS (sps_id=%d)", i_sps_id );
-        free( pb_dec );
         block_Release( p_frag );
         return;
     }
@@ -947,8 +990,6 @@ static void PutSPS( decoder_t *p_dec, block_t *p_frag )
         }
     }
 
-    free( pb_dec );
-
     /* We have a new SPS */
     if( !p_sys->b_sps )
         msg_Dbg( p_dec, "found NAL_SPS (sps_id=%d)", i_sps_id );
@@ -966,7 +1007,7 @@ static void PutPPS( decoder_t *p_dec, block_t *p_frag )
     int i_pps_id;
     int i_sps_id;
 
-    bs_init( &s, &p_frag->p_buffer[5], p_frag->i_buffer - 5 );
+    bs_init_rbsp( &s, &p_frag->p_buffer[5], p_frag->i_buffer - 5 );
     i_pps_id = bs_read_ue( &s ); // pps id
     i_sps_id = bs_read_ue( &s ); // sps id
     if( i_pps_id >= PPS_MAX || i_sps_id >= SPS_MAX )
@@ -993,16 +1034,12 @@ static void ParseSlice( decoder_t *p_dec, bool *pb_new_picture, slice_t *p_slice
                         int i_nal_ref_idc, int i_nal_type, const block_t *p_frag )
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
-    uint8_t *pb_dec;
-    int i_dec;
     int i_slice_type;
     slice_t slice;
     bs_t s;
 
-    /* do not convert the whole frame */
-    CreateDecodedNAL( &pb_dec, &i_dec, &p_frag->p_buffer[5],
-                     __MIN( p_frag->i_buffer - 5, 60 ) );
-    bs_init( &s, pb_dec, i_dec );
+    /* only the header is read */
+    bs_init_rbsp( &s, &p_frag->p_buffer[5], p_frag->i_buffer - 5 );
 
     /* first_mb_in_slice */
     /* int i_first_mb = */ bs_read_ue( &s );
@@ -1068,7 +1105,6 @@ static void ParseSlice( decoder_t *p_dec, bool *pb_new_picture, slice_t *p_slice
         if( p_sys->i_pic_order_present_flag && !slice.i_field_pic_flag )
             slice.i_delta_pic_order_cnt1 = bs_read_se( &s );
     }
-    free( pb_dec );
 
     /* Detection of the first VCL NAL unit of a primary coded picture
      * (cf. 7.4.1.2.4) */
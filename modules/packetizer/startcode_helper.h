@@ -0,0 +1,162 @@
+/*****************************************************************************
+ * startcode_helper.h: Annex B start code lookup
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_STARTCODE_HELPER_H_
+#define VLC_STARTCODE_HELPER_H_
+
+#include <vlc_cpu.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define CAN_COMPILE_NEON_INTRINSICS 1
+#endif
+
+/* All the functions below return the first 0x00 0x00 0x01 sequence entirely
+ * within [p, end), or NULL if there is none. */
+
+static inline const uint8_t *startcode_FindAnnexB_C( const uint8_t *p,
+                                                     const uint8_t *end )
+{
+    /* Looks at the last byte of each candidate, and skips up to 3 bytes
+     * at once when it cannot end a start code */
+    for( p += 2; p < end; )
+    {
+        if( p[0] > 1 )
+            p += 3;
+        else if( p[-1] != 0 )
+            p += 2;
+        else if( p[-2] != 0 || p[0] != 1 )
+            p++;
+        else
+            return p - 2;
+    }
+    return NULL;
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE
+static inline const uint8_t *startcode_FindAnnexB_SSE2( const uint8_t *p,
+                                                        const uint8_t *end )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8( 1 );
+
+    /* 16 candidates at a time, reading 2 bytes past them */
+    for( ; end - p >= 18; p += 16 )
+    {
+        __m128i v0 = _mm_loadu_si128( (const __m128i *)p );
+        __m128i v1 = _mm_loadu_si128( (const __m128i *)(p + 1) );
+        __m128i v2 = _mm_loadu_si128( (const __m128i *)(p + 2) );
+        __m128i m = _mm_and_si128( _mm_and_si128( _mm_cmpeq_epi8( v0, zero ),
+                                                  _mm_cmpeq_epi8( v1, zero ) ),
+                                   _mm_cmpeq_epi8( v2, one ) );
+        uint32_t mask = _mm_movemask_epi8( m );
+        if( mask )
+            return p + ctz( mask );
+    }
+    return startcode_FindAnnexB_C( p, end );
+}
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static inline const uint8_t *startcode_FindAnnexB_AVX2( const uint8_t *p,
+                                                        const uint8_t *end )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8( 1 );
+
+    /* 32 candidates at a time. Most of the stream has no zero byte pair:
+     * only then compare the third byte. */
+    for( ; end - p >= 34; p += 32 )
+    {
+        __m256i z0 = _mm256_cmpeq_epi8(
+                         _mm256_loadu_si256( (const __m256i *)p ), zero );
+        __m256i z1 = _mm256_cmpeq_epi8(
+                         _mm256_loadu_si256( (const __m256i *)(p + 1) ), zero );
+        __m256i m = _mm256_and_si256( z0, z1 );
+        if( _mm256_testz_si256( m, m ) )
+            continue;
+
+        m = _mm256_and_si256( m, _mm256_cmpeq_epi8(
+                    _mm256_loadu_si256( (const __m256i *)(p + 2) ), one ) );
+        uint32_t mask = _mm256_movemask_epi8( m );
+        if( mask )
+            return p + ctz( mask );
+    }
+    return startcode_FindAnnexB_C( p, end );
+}
+#endif
+
+#ifdef CAN_COMPILE_NEON_INTRINSICS
+static inline const uint8_t *startcode_FindAnnexB_NEON( const uint8_t *p,
+                                                        const uint8_t *end )
+{
+    const uint8x16_t zero = vdupq_n_u8( 0 );
+    const uint8x16_t one = vdupq_n_u8( 1 );
+
+    for( ; end - p >= 18; p += 16 )
+    {
+        uint8x16_t m = vandq_u8( vandq_u8( vceqq_u8( vld1q_u8( p ), zero ),
+                                           vceqq_u8( vld1q_u8( p + 1 ), zero ) ),
+                                 vceqq_u8( vld1q_u8( p + 2 ), one ) );
+        /* Narrows the byte mask to 4 bits per byte */
+        uint64_t mask = vget_lane_u64( vreinterpret_u64_u8(
+                            vshrn_n_u16( vreinterpretq_u16_u8( m ), 4 ) ), 0 );
+        if( mask )
+        {
+            uint32_t lo = mask, hi = mask >> 32;
+            return p + ( lo ? ctz( lo ) : 32 + ctz( hi ) ) / 4;
+        }
+    }
+    return startcode_FindAnnexB_C( p, end );
+}
+#endif
+
+/**
+ * Looks up an Annex B start code (0x00 0x00 0x01) with the fastest
+ * implementation for the CPU.
+ * It can be used as block_startcode_helper_t.
+ */
+static inline const uint8_t *startcode_FindAnnexB( const uint8_t *p,
+                                                   const uint8_t *end )
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+        return startcode_FindAnnexB_AVX2( p, end );
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+        return startcode_FindAnnexB_SSE2( p, end );
+#endif
+#ifdef CAN_COMPILE_NEON_INTRINSICS
+    return startcode_FindAnnexB_NEON( p, end );
+#else
+    return startcode_FindAnnexB_C( p, end );
+#endif
+}
+
+#endif
@@ -30,11 +30,15 @@
 #endif
 
 #include <sys/stat.h>
+#include <errno.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_url.h>
 #include <vlc_fs.h>
+#include <vlc_meta.h>
+#include <vlc_arrays.h>
+#include <vlc_configuration.h>
 #include <vlc_services_discovery.h>
 
 /*****************************************************************************
@@ -103,6 +107,34 @@ static int onNewFileAdded( vlc_object_t*, char const *,
 static enum type_e fileType( services_discovery_t *p_sd, const char* psz_file );
 static void formatSnapshotItem( input_item_t* );
 
+static void CacheLoad( services_discovery_t * );
+static void CacheSave( services_discovery_t * );
+static void CacheApply( services_discovery_t *, input_item_t * );
+static void CacheRelease( services_discovery_t * );
+static void CacheEntryDelete( void *, void * );
+
+static const char *const ppsz_cache_name[] = { "video", "audio", "picture" };
+
+/* Metadata kept in the cache */
+static const vlc_meta_type_t cached_meta[] = {
+    vlc_meta_Title, vlc_meta_Artist, vlc_meta_Album, vlc_meta_Genre,
+    vlc_meta_TrackNumber, vlc_meta_Date, vlc_meta_ArtworkURL,
+};
+#define CACHED_META (sizeof (cached_meta) / sizeof (cached_meta[0]))
+
+/* Cached metadata of a file, valid as long as its size and modification
+ * date are unchanged */
+typedef struct
+{
+    uint64_t      i_size;
+    int64_t       i_mtime;
+    mtime_t       i_duration;
+    char         *ppsz_meta[CACHED_META];
+    bool          b_valid;  /* metadata known */
+    bool          b_seen;   /* file found by the last scan */
+    input_item_t *p_item;   /* held until it is preparsed */
+} cache_entry_t;
+
 struct services_discovery_sys_t
 {
     vlc_thread_t thread;
@@ -110,6 +142,13 @@ struct services_discovery_sys_t
 
     char* psz_dir[2];
     const char* psz_var;
+
+    /* Metadata cache, by URI */
+    vlc_mutex_t      lock;
+    vlc_dictionary_t cache;
+    char            *psz_cache;
+    bool             b_dirty;
+    bool             b_scanned; /* the files not seen are gone */
 };
 
 /*****************************************************************************
@@ -153,11 +192,15 @@ static int Open( vlc_object_t *p_this, enum type_e i_type )
         return VLC_EGENERIC;
     }
 
+    vlc_mutex_init( &p_sys->lock );
+    vlc_dictionary_init( &p_sys->cache, 0 );
+
     var_AddCallback( p_sd->p_libvlc, p_sys->psz_var, onNewFileAdded, p_sd );
 
     if( vlc_clone( &p_sys->thread, Run, p_sd, VLC_THREAD_PRIORITY_LOW ) )
     {
         var_DelCallback( p_sd->p_libvlc, p_sys->psz_var, onNewFileAdded, p_sd );
+        vlc_mutex_destroy( &p_sys->lock );
         free( p_sys->psz_dir[1] );
         free( p_sys->psz_dir[0] );
         free( p_sys );
@@ -177,6 +220,8 @@ static void *Run( void *data )
 
     int canc = vlc_savecancel();
 
+    CacheLoad( p_sd );
+
     int num_dir = sizeof( p_sys->psz_dir ) / sizeof( p_sys->psz_dir[0] );
     for( int i = 0; i < num_dir; i++ )
     {
@@ -213,6 +258,10 @@ static void *Run( void *data )
         free( psz_uri );
     }
 
+    vlc_mutex_lock( &p_sys->lock );
+    p_sys->b_scanned = true;
+    vlc_mutex_unlock( &p_sys->lock );
+
     vlc_restorecancel(canc);
     return NULL;
 }
@@ -230,6 +279,12 @@ static void Close( vlc_object_t *p_this )
 
     var_DelCallback( p_sd->p_libvlc, p_sys->psz_var, onNewFileAdded, p_sd );
 
+    CacheRelease( p_sd );
+    CacheSave( p_sd );
+    vlc_dictionary_clear( &p_sys->cache, CacheEntryDelete, NULL );
+    free( p_sys->psz_cache );
+    vlc_mutex_destroy( &p_sys->lock );
+
     free( p_sys->psz_dir[1] );
     free( p_sys->psz_dir[0] );
     free( p_sys );
@@ -251,6 +306,9 @@ static void input_item_subitem_added( const vlc_event_t * p_event,
     if( p_sys->i_type == Picture )
         formatSnapshotItem( p_item );
 
+    /* before it is added, so that it is not preparsed if it is known */
+    CacheApply( p_sd, p_item );
+
     services_discovery_AddItem( p_sd, p_item, NULL );
 }
 
@@ -344,6 +402,323 @@ enum type_e fileType( services_discovery_t *p_sd, const char* psz_file )
     return i_ret;
 }
 
+/*****************************************************************************
+ * Metadata cache
+ *****************************************************************************
+ * The metadata of the preparsed files is saved in the cache directory, so
+ * that the unchanged files are not preparsed again at the next start. One
+ * line per file: size, modification date, duration, then the URI and the
+ * metadata, separated by tabulations.
+ *****************************************************************************/
+static void CacheEntryDelete( void *p_data, void *p_obj )
+{
+    cache_entry_t *p_entry = p_data;
+    (void)p_obj;
+
+    for( unsigned i = 0; i < CACHED_META; i++ )
+        free( p_entry->ppsz_meta[i] );
+    free( p_entry );
+}
+
+static void CacheLoad( services_discovery_t *p_sd )
+{
+    services_discovery_sys_t *p_sys = p_sd->p_sys;
+
+    char *psz_dir = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_dir == NULL
+     || asprintf( &p_sys->psz_cache, "%s" DIR_SEP "mediadirs" DIR_SEP "%s",
+                  psz_dir, ppsz_cache_name[p_sys->i_type] ) == -1 )
+        p_sys->psz_cache = NULL;
+    free( psz_dir );
+    if( p_sys->psz_cache == NULL )
+        return;
+
+    FILE *file = vlc_fopen( p_sys->psz_cache, "rt" );
+    if( file == NULL )
+        return;
+
+    char *psz_line = NULL;
+    size_t i_line = 0;
+    ssize_t i_read;
+    unsigned i_entries = 0;
+
+    vlc_mutex_lock( &p_sys->lock );
+    while( ( i_read = getline( &psz_line, &i_line, file ) ) != -1 )
+    {
+        unsigned long long i_size;
+        long long i_mtime, i_duration;
+        int i_uri;
+
+        if( i_read > 0 && psz_line[i_read - 1] == '\n' )
+            psz_line[i_read - 1] = '\0';
+
+        if( sscanf( psz_line, "%llu %lld %lld\t%n", &i_size, &i_mtime,
+                    &i_duration, &i_uri ) != 3 )
+            continue;
+
+        char *psz_uri = &psz_line[i_uri];
+        char *psz_field = strchr( psz_uri, '\t' );
+        if( psz_field == NULL || psz_field == psz_uri )
+            continue;
+        *psz_field++ = '\0';
+
+        if( vlc_dictionary_value_for_key( &p_sys->cache, psz_uri )
+                                                    != kVLCDictionaryNotFound )
+            continue;
+
+        cache_entry_t *p_entry = calloc( 1, sizeof( *p_entry ) );
+        if( unlikely(p_entry == NULL) )
+            break;
+
+        p_entry->i_size = i_size;
+        p_entry->i_mtime = i_mtime;
+        p_entry->i_duration = i_duration;
+        p_entry->b_valid = true;
+        for( unsigned i = 0; i < CACHED_META && psz_field != NULL; i++ )
+        {
+            char *psz_next = strchr( psz_field, '\t' );
+            if( psz_next != NULL )
+                *psz_next++ = '\0';
+            if( *psz_field )
+                p_entry->ppsz_meta[i] = strdup( psz_field );
+            psz_field = psz_next;
+        }
+
+        vlc_dictionary_insert( &p_sys->cache, psz_uri, p_entry );
+        i_entries++;
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+
+    free( psz_line );
+    fclose( file );
+
+    msg_Dbg( p_sd, "loaded the metadata of %u files from %s", i_entries,
+             p_sys->psz_cache );
+}
+
+/* Whether a string can be saved as a field of the cache */
+static bool CacheField( const char *psz )
+{
+    return psz == NULL || strpbrk( psz, "\t\r\n" ) == NULL;
+}
+
+static void CacheSave( services_discovery_t *p_sd )
+{
+    services_discovery_sys_t *p_sys = p_sd->p_sys;
+    vlc_dictionary_t *p_cache = &p_sys->cache;
+
+    if( p_sys->psz_cache == NULL )
+        return;
+
+    /* Drop the files that are gone, once all the directories are scanned */
+    bool b_dirty = p_sys->b_dirty;
+    for( int i = 0; i < p_cache->i_size && !b_dirty; i++ )
+        for( vlc_dictionary_entry_t *p_dict_entry = p_cache->p_entries[i];
+             p_dict_entry != NULL; p_dict_entry = p_dict_entry->p_next )
+        {
+            cache_entry_t *p_entry = p_dict_entry->p_value;
+            if( p_sys->b_scanned && !p_entry->b_seen )
+                b_dirty = true;
+        }
+    if( !b_dirty )
+        return;
+
+    /* Make sure the directories exist */
+    char *psz_sep = strrchr( p_sys->psz_cache, DIR_SEP_CHAR );
+    *psz_sep = '\0';
+    char *psz_parent = strrchr( p_sys->psz_cache, DIR_SEP_CHAR );
+    if( psz_parent != NULL )
+    {
+        *psz_parent = '\0';
+        vlc_mkdir( p_sys->psz_cache, 0700 );
+        *psz_parent = DIR_SEP_CHAR;
+    }
+    vlc_mkdir( p_sys->psz_cache, 0700 );
+    *psz_sep = DIR_SEP_CHAR;
+
+    char *psz_tmp;
+    if( asprintf( &psz_tmp, "%s.tmp", p_sys->psz_cache ) == -1 )
+        return;
+
+    FILE *file = vlc_fopen( psz_tmp, "wt" );
+    if( file == NULL )
+    {
+        msg_Warn( p_sd, "cannot write the metadata cache %s: %s", psz_tmp,
+                  vlc_strerror_c(errno) );
+        free( psz_tmp );
+        return;
+    }
+
+    bool b_ok = true;
+    unsigned i_entries = 0;
+    for( int i = 0; i < p_cache->i_size; i++ )
+        for( vlc_dictionary_entry_t *p_dict_entry = p_cache->p_entries[i];
+             p_dict_entry != NULL; p_dict_entry = p_dict_entry->p_next )
+        {
+            cache_entry_t *p_entry = p_dict_entry->p_value;
+            bool b_save = p_entry->b_valid
+                       && ( !p_sys->b_scanned || p_entry->b_seen )
+                       && CacheField( p_dict_entry->psz_key );
+            for( unsigned j = 0; j < CACHED_META && b_save; j++ )
+                b_save = CacheField( p_entry->ppsz_meta[j] );
+            if( !b_save )
+                continue;
+
+            b_ok &= fprintf( file, "%"PRIu64" %"PRId64" %"PRId64"\t%s",
+                             p_entry->i_size, p_entry->i_mtime,
+                             p_entry->i_duration,
+                             p_dict_entry->psz_key ) >= 0;
+            for( unsigned j = 0; j < CACHED_META; j++ )
+                b_ok &= fprintf( file, "\t%s", p_entry->ppsz_meta[j]
+                                 ? p_entry->ppsz_meta[j] : "" ) >= 0;
+            b_ok &= fputc( '\n', file ) != EOF;
+            i_entries++;
+        }
+
+    if( fclose( file ) == 0 && b_ok && !vlc_rename( psz_tmp, p_sys->psz_cache ) )
+        msg_Dbg( p_sd, "saved the metadata of %u files", i_entries );
+    else
+        vlc_unlink( psz_tmp );
+    free( psz_tmp );
+}
+
+static void input_item_preparsed( const vlc_event_t *p_event,
+                                  void *user_data )
+{
+    services_discovery_t *p_sd = user_data;
+    services_discovery_sys_t *p_sys = p_sd->p_sys;
+    input_item_t *p_item = (input_item_t *)p_event->p_obj;
+    bool b_owned = false;
+
+    char *psz_uri = input_item_GetURI( p_item );
+    if( psz_uri == NULL )
+        return;
+
+    vlc_mutex_lock( &p_sys->lock );
+    cache_entry_t *p_entry = vlc_dictionary_value_for_key( &p_sys->cache,
+                                                           psz_uri );
+    if( p_entry != kVLCDictionaryNotFound && p_entry->p_item == p_item )
+    {
+        for( unsigned i = 0; i < CACHED_META; i++ )
+        {
+            free( p_entry->ppsz_meta[i] );
+            p_entry->ppsz_meta[i] = input_item_GetMeta( p_item,
+                                                        cached_meta[i] );
+        }
+        /* an attachment is only valid while the file is open */
+        char *psz_art = p_entry->ppsz_meta[CACHED_META - 1];
+        if( psz_art != NULL && strncmp( psz_art, "file://", 7 ) )
+        {
+            free( psz_art );
+            p_entry->ppsz_meta[CACHED_META - 1] = NULL;
+        }
+        p_entry->i_duration = input_item_GetDuration( p_item );
+        p_entry->b_valid = true;
+        p_entry->p_item = NULL;
+        p_sys->b_dirty = true;
+        b_owned = true;
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+    free( psz_uri );
+
+    if( b_owned )
+    {
+        vlc_event_detach( &p_item->event_manager,
+                          vlc_InputItemPreparsedChanged,
+                          input_item_preparsed, p_sd );
+        vlc_gc_decref( p_item );
+    }
+}
+
+/* Sets the cached metadata of an unchanged file, or waits for the
+ * preparsing of the others to cache it */
+static void CacheApply( services_discovery_t *p_sd, input_item_t *p_item )
+{
+    services_discovery_sys_t *p_sys = p_sd->p_sys;
+    struct stat st;
+
+    char *psz_uri = input_item_GetURI( p_item );
+    if( psz_uri == NULL )
+        return;
+
+    char *psz_path = make_path( psz_uri );
+    if( psz_path == NULL || vlc_stat( psz_path, &st ) || !S_ISREG( st.st_mode ) )
+    {
+        free( psz_path );
+        free( psz_uri );
+        return;
+    }
+    free( psz_path );
+
+    vlc_mutex_lock( &p_sys->lock );
+    cache_entry_t *p_entry = vlc_dictionary_value_for_key( &p_sys->cache,
+                                                           psz_uri );
+    if( p_entry == kVLCDictionaryNotFound )
+    {
+        p_entry = calloc( 1, sizeof( *p_entry ) );
+        if( unlikely(p_entry == NULL) )
+            goto out;
+        vlc_dictionary_insert( &p_sys->cache, psz_uri, p_entry );
+    }
+    p_entry->b_seen = true;
+
+    if( p_entry->b_valid && p_entry->i_size == (uint64_t)st.st_size
+     && p_entry->i_mtime == (int64_t)st.st_mtime )
+    {
+        for( unsigned i = 0; i < CACHED_META; i++ )
+            if( p_entry->ppsz_meta[i] != NULL )
+                input_item_SetMeta( p_item, cached_meta[i],
+                                    p_entry->ppsz_meta[i] );
+        input_item_SetDuration( p_item, p_entry->i_duration );
+        input_item_SetPreparsed( p_item, true );
+    }
+    else if( p_entry->p_item == NULL )
+    {
+        p_entry->b_valid = false;
+        p_entry->i_size = st.st_size;
+        p_entry->i_mtime = st.st_mtime;
+        p_entry->p_item = p_item;
+        vlc_gc_incref( p_item );
+        vlc_event_attach( &p_item->event_manager,
+                          vlc_InputItemPreparsedChanged,
+                          input_item_preparsed, p_sd );
+    }
+out:
+    vlc_mutex_unlock( &p_sys->lock );
+    free( psz_uri );
+}
+
+/* Releases the items that are still waiting for their preparsing */
+static void CacheRelease( services_discovery_t *p_sd )
+{
+    services_discovery_sys_t *p_sys = p_sd->p_sys;
+    vlc_dictionary_t *p_cache = &p_sys->cache;
+    input_item_t **pp_items = NULL;
+    int i_items = 0;
+
+    vlc_mutex_lock( &p_sys->lock );
+    for( int i = 0; i < p_cache->i_size; i++ )
+        for( vlc_dictionary_entry_t *p_dict_entry = p_cache->p_entries[i];
+             p_dict_entry != NULL; p_dict_entry = p_dict_entry->p_next )
+        {
+            cache_entry_t *p_entry = p_dict_entry->p_value;
+            if( p_entry->p_item == NULL )
+                continue;
+            TAB_APPEND( i_items, pp_items, p_entry->p_item );
+            p_entry->p_item = NULL;
+        }
+    vlc_mutex_unlock( &p_sys->lock );
+
+    for( int i = 0; i < i_items; i++ )
+    {
+        vlc_event_detach( &pp_items[i]->event_manager,
+                          vlc_InputItemPreparsedChanged,
+                          input_item_preparsed, p_sd );
+        vlc_gc_decref( pp_items[i] );
+    }
+    free( pp_items );
+}
+
 static int vlc_sd_probe_Open( vlc_object_t *obj )
 {
     vlc_probe_t *probe = (vlc_probe_t *)obj;
@@ -75,6 +75,9 @@
 #define SAP_V4_LINK_ADDRESS     "224.0.0.255"
 #define ADD_SESSION 1
 
+/* Interval between two checks for expired announces */
+#define SAP_CHECK_PERIOD CLOCK_FREQ
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -204,6 +207,11 @@ struct sap_announce_t
     uint16_t    i_hash;
     uint32_t    i_source[4];
 
+    /* Last received packet, to skip the parsing of its repetitions */
+    uint32_t    i_packet_hash;
+    size_t      i_packet;
+    uint8_t     *p_packet;
+
     /* SAP annnounces must only contain one SDP */
     sdp_t       *p_sdp;
 
@@ -250,6 +258,9 @@ struct demux_sys_t
     static sdp_t *ParseSDP (vlc_object_t *p_sd, const char *psz_sdp);
     static sap_announce_t *CreateAnnounce( services_discovery_t *, uint32_t *, uint16_t, sdp_t * );
     static int RemoveAnnounce( services_discovery_t *p_sd, sap_announce_t *p_announce );
+    static void RefreshAnnounce( sap_announce_t *p_announce, bool b_need_delete );
+    static void SetAnnouncePacket( sap_announce_t *p_announce, uint32_t i_packet_hash,
+                                   const uint8_t *p_packet, size_t i_packet );
 
 /* Helper functions */
     static inline attribute_t *MakeAttribute (const char *str);
@@ -268,6 +279,16 @@ static inline int min_int( int a, int b )
     return a > b ? b : a;
 }
 
+/* FNV-1a */
+static uint32_t HashPacket( const uint8_t *p, size_t i_len )
+{
+    uint32_t i_hash = 2166136261u;
+
+    while( i_len-- > 0 )
+        i_hash = (i_hash ^ *p++) * 16777619u;
+    return i_hash;
+}
+
 static bool IsWellKnownPayload (int type)
 {
     switch (type)
@@ -458,6 +479,7 @@ static void *Run( void *data )
     char *psz_addr;
     int i;
     int timeout = -1;
+    mtime_t i_next_check = 0;
     int canc = vlc_savecancel ();
 
     /* Braindead Winsock DNS resolver will get stuck over 2 seconds per failed
@@ -570,6 +592,15 @@ static void *Run( void *data )
 
         mtime_t now = mdate();
 
+        /* With many announces, do not scan them all after every packet */
+        if( now < i_next_check )
+        {
+            if( p_sd->p_sys->i_announces )
+                timeout = (i_next_check - now) / 1000 + 1;
+            continue;
+        }
+        i_next_check = now + SAP_CHECK_PERIOD;
+
         /* A 1 hour timeout correspond to the RFC Implicit timeout.
          * This timeout is tuned in the following loop. */
         timeout = 1000 * 60 * 60;
@@ -674,6 +705,24 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
     if (len < 4)
         return VLC_EGENERIC;
 
+    /* Announces are repeated as is: only parse the new or changed ones */
+    const uint8_t *packet = buf;
+    size_t packet_len = len;
+    uint32_t packet_hash = HashPacket( packet, packet_len );
+
+    for( i = 0; i < p_sd->p_sys->i_announces; i++ )
+    {
+        sap_announce_t *p_announce = p_sd->p_sys->pp_announces[i];
+
+        if( p_announce->i_packet_hash == packet_hash
+         && p_announce->i_packet == packet_len
+         && !memcmp( p_announce->p_packet, packet, packet_len ) )
+        {
+            RefreshAnnounce( p_announce, (buf[0] & 0x04) != 0 );
+            return VLC_SUCCESS;
+        }
+    }
+
     uint8_t flags = buf[0];
     uint8_t auth_len = buf[1];
 
@@ -805,25 +854,17 @@ static int ParseSAP( services_discovery_t *p_sd, const uint8_t *buf,
              * else
              */
 
-            if( !b_need_delete )
-            {
-                /* No need to go after six, as we start to trust the
-                 * average period at six */
-                if( p_announce->i_period_trust <= 5 )
-                    p_announce->i_period_trust++;
-
-                /* Compute the average period */
-                mtime_t now = mdate();
-                p_announce->i_period = ( p_announce->i_period * (p_announce->i_period_trust-1) + (now - p_announce->i_last) ) / p_announce->i_period_trust;
-                p_announce->i_last = now;
-            }
+            RefreshAnnounce( p_announce, b_need_delete );
+            SetAnnouncePacket( p_announce, packet_hash, packet, packet_len );
             FreeSDP( p_sdp );
             free (decomp);
             return VLC_SUCCESS;
         }
     }
 
-    CreateAnnounce( p_sd, i_source, i_hash, p_sdp );
+    sap_announce_t *p_announce = CreateAnnounce( p_sd, i_source, i_hash, p_sdp );
+    if( p_announce != NULL )
+        SetAnnouncePacket( p_announce, packet_hash, packet, packet_len );
 
     free (decomp);
     return VLC_SUCCESS;
@@ -850,6 +891,9 @@ sap_announce_t *CreateAnnounce( services_discovery_t *p_sd, uint32_t *i_source,
     p_sap->i_period_trust = 0;
     p_sap->i_hash = i_hash;
     memcpy (p_sap->i_source, i_source, sizeof(p_sap->i_source));
+    p_sap->i_packet_hash = 0;
+    p_sap->i_packet = 0;
+    p_sap->p_packet = NULL;
     p_sap->p_sdp = p_sdp;
 
     /* Released in RemoveAnnounce */
@@ -1577,11 +1621,45 @@ static int RemoveAnnounce( services_discovery_t *p_sd,
         }
     }
 
+    free( p_announce->p_packet );
     free( p_announce );
 
     return VLC_SUCCESS;
 }
 
+static void RefreshAnnounce( sap_announce_t *p_announce, bool b_need_delete )
+{
+    if( b_need_delete )
+        return;
+
+    /* No need to go after six, as we start to trust the
+     * average period at six */
+    if( p_announce->i_period_trust <= 5 )
+        p_announce->i_period_trust++;
+
+    /* Compute the average period */
+    mtime_t now = mdate();
+    p_announce->i_period = ( p_announce->i_period * (p_announce->i_period_trust-1) + (now - p_announce->i_last) ) / p_announce->i_period_trust;
+    p_announce->i_last = now;
+}
+
+static void SetAnnouncePacket( sap_announce_t *p_announce, uint32_t i_packet_hash,
+                               const uint8_t *p_packet, size_t i_packet )
+{
+    uint8_t *p = realloc( p_announce->p_packet, i_packet );
+    if( unlikely(p == NULL) )
+    {
+        free( p_announce->p_packet );
+        i_packet = 0;
+    }
+    else
+        memcpy( p, p_packet, i_packet );
+
+    p_announce->i_packet_hash = i_packet_hash;
+    p_announce->i_packet = i_packet;
+    p_announce->p_packet = p;
+}
+
 /*
  * Compare two sessions, when hash is not set (SAP v0)
  */
@@ -45,6 +45,9 @@
 */
 const char* MEDIA_SERVER_DEVICE_TYPE = "urn:schemas-upnp-org:device:MediaServer:1";
 const char* CONTENT_DIRECTORY_SERVICE_TYPE = "urn:schemas-upnp-org:service:ContentDirectory:1";
+/* Objects requested per Browse action, so that the first ones of a large
+ * container show up without waiting for the whole listing */
+const int BROWSE_PAGE_SIZE = 200;
 
 /*
  * VLC handle
@@ -174,9 +177,10 @@ static void Close( vlc_object_t *p_this )
     services_discovery_t *p_sd = ( services_discovery_t* )p_this;
 
     UpnpUnRegisterClient( p_sd->p_sys->client_handle );
+    /* Waits for the browsing threads, before libupnp is gone */
+    delete p_sd->p_sys->p_server_list;
     UpnpFinish();
 
-    delete p_sd->p_sys->p_server_list;
     vlc_mutex_destroy( &p_sd->p_sys->callback_lock );
 
     free( p_sd->p_sys );
@@ -374,7 +378,12 @@ static int Callback( Upnp_EventType event_type, void* p_event, void* p_user_data
         Upnp_Event* p_e = ( Upnp_Event* )p_event;
 
         MediaServer* p_server = p_sys->p_server_list->getServerBySID( p_e->Sid );
-        if ( p_server ) p_server->fetchContents();
+        if ( p_server && p_e->ChangedVariables )
+            p_server->fetchContents(
+                xml_getChildElementValue( p_e->ChangedVariables,
+                                          "SystemUpdateID" ) );
+        else if ( p_server )
+            p_server->fetchContents( NULL );
     }
     break;
 
@@ -582,7 +591,7 @@ void MediaServer::parseDeviceDescription( IXML_Document* p_doc,
                                 UPNP_E_SUCCESS )
                         {
                             p_server->setContentDirectoryControlURL( psz_url );
-                            p_server->fetchContents();
+                            p_server->fetchContents( NULL );
                         }
 
                         free( psz_url );
@@ -607,10 +616,27 @@ MediaServer::MediaServer( const char* psz_udn,
     _p_contents = NULL;
     _p_input_item = NULL;
     _i_content_directory_service_version = 1;
+
+    vlc_mutex_init( &_lock );
+    vlc_cond_init( &_wait );
+    _b_thread = false;
+    _b_fetch = false;
+    _b_stop = false;
 }
 
 MediaServer::~MediaServer()
 {
+    vlc_mutex_lock( &_lock );
+    _b_stop = true;
+    vlc_cond_signal( &_wait );
+    vlc_mutex_unlock( &_lock );
+
+    /* The current Browse action, if any, completes first */
+    if ( _b_thread )
+        vlc_join( _thread, NULL );
+
+    vlc_cond_destroy( &_wait );
+    vlc_mutex_destroy( &_lock );
     delete _p_contents;
 }
 
@@ -784,8 +810,115 @@ browseActionCleanup:
     return p_response;
 }
 
-void MediaServer::fetchContents()
+/*
+ * Returns the current SystemUpdateID of the server, which changes with its
+ * contents, or an empty string if unknown
+ */
+std::string MediaServer::_getSystemUpdateID()
+{
+    std::string update_id;
+    IXML_Document* p_response = 0;
+    const char* psz_url = getContentDirectoryControlURL();
+
+    char* psz_service_type = strdup( CONTENT_DIRECTORY_SERVICE_TYPE );
+    if ( !psz_service_type )
+        return update_id;
+
+    psz_service_type[strlen( psz_service_type ) - 1] =
+        _i_content_directory_service_version;
+
+    IXML_Document* p_action = UpnpMakeAction( "GetSystemUpdateID",
+                                              psz_service_type, 0, NULL );
+    if ( p_action )
+    {
+        int i_res = UpnpSendAction( _p_sd->p_sys->client_handle,
+                                    psz_url, psz_service_type,
+                                    0, /* ignored in SDK, must be NULL */
+                                    p_action, &p_response );
+        if ( i_res == UPNP_E_SUCCESS && p_response )
+        {
+            const char* psz_id = xml_getChildElementValue( p_response, "Id" );
+            if ( psz_id )
+                update_id = psz_id;
+        }
+        else
+            msg_Dbg( _p_sd, "GetSystemUpdateID failed: %s",
+                     UpnpGetErrorMessage( i_res ) );
+
+        ixmlDocument_free( p_response );
+        ixmlDocument_free( p_action );
+    }
+
+    free( psz_service_type );
+    return update_id;
+}
+
+/*
+ * Requests a listing of the contents, unless the server tells that they did
+ * not change since the current one. The listing is done by the browsing
+ * thread of the server, so that the servers are browsed in parallel and the
+ * UPnP callbacks are not blocked meanwhile.
+ */
+void MediaServer::fetchContents( const char* psz_update_id )
+{
+    vlc_mutex_locker locker( &_lock );
+
+    if ( psz_update_id && !_update_id.empty() && _update_id == psz_update_id )
+    {
+        msg_Dbg( _p_sd, "Contents of '%s' unchanged (update %s)",
+                 getFriendlyName(), psz_update_id );
+        return;
+    }
+
+    _b_fetch = true;
+    vlc_cond_signal( &_wait );
+
+    if ( !_b_thread )
+    {
+        if ( vlc_clone( &_thread, browseThread, this,
+                        VLC_THREAD_PRIORITY_LOW ) )
+            msg_Err( _p_sd, "Cannot browse '%s'", getFriendlyName() );
+        else
+            _b_thread = true;
+    }
+}
+
+void* MediaServer::browseThread( void* p_data )
 {
+    MediaServer* p_server = ( MediaServer* )p_data;
+
+    vlc_mutex_lock( &p_server->_lock );
+    for ( ;; )
+    {
+        while ( !p_server->_b_fetch && !p_server->_b_stop )
+            vlc_cond_wait( &p_server->_wait, &p_server->_lock );
+        if ( p_server->_b_stop )
+            break;
+        p_server->_b_fetch = false;
+        vlc_mutex_unlock( &p_server->_lock );
+
+        p_server->_fetchContents();
+
+        vlc_mutex_lock( &p_server->_lock );
+    }
+    vlc_mutex_unlock( &p_server->_lock );
+    return NULL;
+}
+
+bool MediaServer::_stopping()
+{
+    vlc_mutex_locker locker( &_lock );
+    return _b_stop;
+}
+
+void MediaServer::_fetchContents()
+{
+    /* Known before browsing: a change during the listing lists again */
+    std::string update_id = _getSystemUpdateID();
+    vlc_mutex_lock( &_lock );
+    _update_id = update_id;
+    vlc_mutex_unlock( &_lock );
+
     /* Delete previous contents to prevent duplicate entries */
     if ( _p_contents )
     {
@@ -794,48 +927,119 @@ void MediaServer::fetchContents()
         services_discovery_AddItem( _p_sd, _p_input_item, NULL );
     }
 
-    Container* root = new Container( 0, "0", getFriendlyName() );
-
-    _fetchContents( root, 0 );
-
-    _p_contents = root;
+    _p_contents = new Container( 0, "0", getFriendlyName() );
     _p_contents->setInputItem( _p_input_item );
 
-    _buildPlaylist( _p_contents, NULL );
+    if ( !_browseContainer( _p_contents ) )
+    {
+        /* Incomplete, do not skip the next listing */
+        vlc_mutex_lock( &_lock );
+        _update_id.clear();
+        vlc_mutex_unlock( &_lock );
+    }
 }
 
+// TODO: Create a permanent fix for the item duplication bug. The current fix
+// is essentially only a small hack. Although it fixes the problem, it introduces
+// annoying cosmetic issues with the playlist. For example, when the UPnP Server
+// rebroadcasts it's directory structure, the VLC Client deletes the old directory
+// structure, causing the user to go back to the root node of the directory. The
+// directory is then rebuilt, and the user is forced to traverse through the directory
+// to find the item they were looking for. Some servers may not push the directory
+// structure too often, but we cannot rely on this fix.
+//
+// I have thought up another fix, but this would require certain features to
+// be present within the VLC services discovery. Currently, services_discovery_AddItem
+// does not allow the programmer to nest items. It only allows a "2 deep" scope.
+// An example of the limitation is below:
+//
+// Root Directory
+// + Item 1
+// + Item 2
+//
+// services_discovery_AddItem will not let the programmer specify a child-node to
+// insert items into, so we would not be able to do the following:
+//
+// Root Directory
+// + Item 1
+//   + Sub Item 1
+// + Item 2
+//   + Sub Item 1 of Item 2
+//     + Sub-Sub Item 1 of Sub Item 1
+//
+// This creates a HUGE limitation on what we are able to do. If we were able to do
+// the above, we could simply preserve the old directory listing, and compare what items
+// do not exist in the new directory listing, then remove them from the shown listing using
+// services_discovery_RemoveItem. If new files were introduced within an already existing
+// container, we could simply do so with services_discovery_AddItem.
+
 /*
- * Fetches and parses the UPNP response
+ * Lists a container, then its sub-containers. The children are added to the
+ * playlist page by page, as they arrive.
  */
-bool MediaServer::_fetchContents( Container* p_parent, int i_offset )
+bool MediaServer::_browseContainer( Container* p_parent )
 {
-    if (!p_parent)
-    {
-        msg_Err( _p_sd, "No parent" );
+    input_item_node_t* p_node =
+        input_item_node_Create( p_parent->getInputItem() );
+    if ( !p_node )
         return false;
+
+    bool b_ok = true;
+    int i_offset = 0;
+    int i_total = 0;
+    do
+    {
+        int i_returned = _stopping() ? -1
+                       : _browsePage( p_parent, p_node, i_offset, &i_total );
+        if ( i_returned < 0 )
+            b_ok = false;
+        if ( i_returned <= 0 )
+            break;
+
+        i_offset += i_returned;
+        input_item_node_PostPartial( p_node );
     }
+    while ( i_offset < i_total );
+    input_item_node_PostAndDelete( p_node );
 
+    for ( unsigned int i = 0; b_ok && i < p_parent->getNumContainers(); i++ )
+        b_ok = _browseContainer( p_parent->getContainer( i ) );
+
+    return b_ok;
+}
+
+/*
+ * Fetches and parses a page of the children of a container, adds them to the
+ * input node, returns how many were returned or -1 on error
+ */
+int MediaServer::_browsePage( Container* p_parent, input_item_node_t* p_node,
+                              int i_offset, int* pi_total )
+{
     char* psz_starting_index;
     if( asprintf( &psz_starting_index, "%d", i_offset ) < 0 )
     {
         msg_Err( _p_sd, "asprintf error:%d", i_offset );
-        return false;
+        return -1;
     }
 
+    char psz_requested_count[16];
+    snprintf( psz_requested_count, sizeof( psz_requested_count ), "%d",
+              BROWSE_PAGE_SIZE );
+
     IXML_Document* p_response = _browseAction( p_parent->getObjectID(),
                                       "BrowseDirectChildren",
                                       "id,dc:title,res," /* Filter */
                                       "sec:CaptionInfo,sec:CaptionInfoEx,"
                                       "pv:subtitlefile",
                                       psz_starting_index, /* StartingIndex */
-                                      "0", /* RequestedCount */
+                                      psz_requested_count, /* RequestedCount */
                                       "" /* SortCriteria */
                                       );
     free( psz_starting_index );
     if ( !p_response )
     {
         msg_Err( _p_sd, "No response from browse() action" );
-        return false;
+        return -1;
     }
 
     IXML_Document* p_result = parseBrowseResult( p_response );
@@ -852,7 +1056,7 @@ bool MediaServer::_fetchContents( Container* p_parent, int i_offset )
     if ( !p_result )
     {
         msg_Err( _p_sd, "browse() response parsing failed" );
-        return false;
+        return -1;
     }
 
 #ifndef NDEBUG
@@ -883,7 +1087,13 @@ bool MediaServer::_fetchContents( Container* p_parent, int i_offset )
 
             Container* container = new Container( p_parent, objectID, title );
             p_parent->addContainer( container );
-            _fetchContents( container, 0 );
+
+            input_item_t* p_input_item = input_item_New( "vlc://nop", title );
+            if ( !p_input_item )
+                continue;
+            input_item_node_AppendItem( p_node, p_input_item );
+            container->setInputItem( p_input_item );
+            vlc_gc_decref( p_input_item );
         }
         ixmlNodeList_free( containerNodeList );
     }
@@ -946,6 +1156,7 @@ bool MediaServer::_fetchContents( Container* p_parent, int i_offset )
 
                     Item* item = new Item( p_parent, objectID, title, psz_resource_url, psz_subtitles, i_duration );
                     p_parent->addItem( item );
+                    _appendItem( item, p_node );
                 }
                 ixmlNodeList_free( p_resource_list );
             }
@@ -956,104 +1167,44 @@ bool MediaServer::_fetchContents( Container* p_parent, int i_offset )
 
     ixmlDocument_free( p_result );
 
-    if( i_offset + i_number_returned < i_total_matches )
-        return _fetchContents( p_parent, i_offset + i_number_returned );
-
-    return true;
+    *pi_total = i_total_matches;
+    return i_number_returned;
 }
 
-// TODO: Create a permanent fix for the item duplication bug. The current fix
-// is essentially only a small hack. Although it fixes the problem, it introduces
-// annoying cosmetic issues with the playlist. For example, when the UPnP Server
-// rebroadcasts it's directory structure, the VLC Client deletes the old directory
-// structure, causing the user to go back to the root node of the directory. The
-// directory is then rebuilt, and the user is forced to traverse through the directory
-// to find the item they were looking for. Some servers may not push the directory
-// structure too often, but we cannot rely on this fix.
-//
-// I have thought up another fix, but this would require certain features to
-// be present within the VLC services discovery. Currently, services_discovery_AddItem
-// does not allow the programmer to nest items. It only allows a "2 deep" scope.
-// An example of the limitation is below:
-//
-// Root Directory
-// + Item 1
-// + Item 2
-//
-// services_discovery_AddItem will not let the programmer specify a child-node to
-// insert items into, so we would not be able to do the following:
-//
-// Root Directory
-// + Item 1
-//   + Sub Item 1
-// + Item 2
-//   + Sub Item 1 of Item 2
-//     + Sub-Sub Item 1 of Sub Item 1
-//
-// This creates a HUGE limitation on what we are able to do. If we were able to do
-// the above, we could simply preserve the old directory listing, and compare what items
-// do not exist in the new directory listing, then remove them from the shown listing using
-// services_discovery_RemoveItem. If new files were introduced within an already existing
-// container, we could simply do so with services_discovery_AddItem.
-
 /*
- * Builds playlist based on available input items.
+ * Creates the input item of an item, in the given input node
  */
-void MediaServer::_buildPlaylist( Container* p_parent, input_item_node_t *p_input_node )
+void MediaServer::_appendItem( Item* p_item, input_item_node_t* p_input_node )
 {
-    bool b_send = p_input_node == NULL;
-    if( b_send )
-        p_input_node = input_item_node_Create( p_parent->getInputItem() );
-
-    for ( unsigned int i = 0; i < p_parent->getNumContainers(); i++ )
+    char **ppsz_opts = NULL;
+    char *psz_input_slave = p_item->buildInputSlaveOption();
+    if( psz_input_slave )
     {
-        Container* p_container = p_parent->getContainer( i );
-
-        input_item_t* p_input_item = input_item_New( "vlc://nop",
-                                                    p_container->getTitle() );
-        input_item_node_t *p_new_node =
-            input_item_node_AppendItem( p_input_node, p_input_item );
-
-        p_container->setInputItem( p_input_item );
-        _buildPlaylist( p_container, p_new_node );
+        ppsz_opts = (char**)malloc( 2 * sizeof( char* ) );
+        ppsz_opts[0] = psz_input_slave;
+        ppsz_opts[1] = p_item->buildSubTrackIdOption();
     }
 
-    for ( unsigned int i = 0; i < p_parent->getNumItems(); i++ )
-    {
-        Item* p_item = p_parent->getItem( i );
+    input_item_t* p_input_item = input_item_NewExt( p_item->getResource(),
+                                       p_item->getTitle(),
+                                       psz_input_slave ? 2 : 0,
+                                       psz_input_slave ? ppsz_opts : NULL,
+                                       VLC_INPUT_OPTION_TRUSTED, /* XXX */
+                                       p_item->getDuration() );
 
-        char **ppsz_opts = NULL;
-        char *psz_input_slave = p_item->buildInputSlaveOption();
-        if( psz_input_slave )
-        {
-            ppsz_opts = (char**)malloc( 2 * sizeof( char* ) );
-            ppsz_opts[0] = psz_input_slave;
-            ppsz_opts[1] = p_item->buildSubTrackIdOption();
-        }
-
-        input_item_t* p_input_item = input_item_NewExt( p_item->getResource(),
-                                           p_item->getTitle(),
-                                           psz_input_slave ? 2 : 0,
-                                           psz_input_slave ? ppsz_opts : NULL,
-                                           VLC_INPUT_OPTION_TRUSTED, /* XXX */
-                                           p_item->getDuration() );
-
-        assert( p_input_item );
-        if( ppsz_opts )
-        {
-            free( ppsz_opts[0] );
-            free( ppsz_opts[1] );
-            free( ppsz_opts );
-
-            psz_input_slave = NULL;
-        }
+    assert( p_input_item );
+    if( ppsz_opts )
+    {
+        free( ppsz_opts[0] );
+        free( ppsz_opts[1] );
+        free( ppsz_opts );
 
-        input_item_node_AppendItem( p_input_node, p_input_item );
-        p_item->setInputItem( p_input_item );
+        psz_input_slave = NULL;
     }
 
-    if( b_send )
-        input_item_node_PostAndDelete( p_input_node );
+    input_item_node_AppendItem( p_input_node, p_input_item );
+    p_item->setInputItem( p_input_item );
+    vlc_gc_decref( p_input_item );
 }
 
 void MediaServer::setInputItem( input_item_t* p_input_item )
@@ -1154,7 +1305,9 @@ void MediaServerList::removeServer( const char* psz_udn )
 
     msg_Dbg( _p_sd, "Removing server '%s'", p_server->getFriendlyName() );
 
-    services_discovery_RemoveItem( _p_sd, p_server->getInputItem() );
+    /* Once its browsing thread stopped adding items */
+    input_item_t* p_input_item = p_server->getInputItem();
+    vlc_gc_incref( p_input_item );
 
     std::vector<MediaServer*>::iterator it;
     for ( it = _list.begin(); it != _list.end(); ++it )
@@ -1166,6 +1319,9 @@ void MediaServerList::removeServer( const char* psz_udn )
             break;
         }
     }
+
+    services_discovery_RemoveItem( _p_sd, p_input_item );
+    vlc_gc_decref( p_input_item );
 }
 
 
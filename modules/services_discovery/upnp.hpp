@@ -35,6 +35,7 @@
 
 // Classes
 class Container;
+class Item;
 
 class MediaServer
 {
@@ -60,7 +61,7 @@ public:
     const char* getContentDirectoryControlURL() const;
 
     void subscribeToContentDirectory();
-    void fetchContents();
+    void fetchContents( const char* psz_update_id );
 
     void setInputItem( input_item_t* p_input_item );
     input_item_t* getInputItem() const;
@@ -69,8 +70,15 @@ public:
 
 private:
 
-    bool _fetchContents( Container* p_parent, int i_starting_index );
-    void _buildPlaylist( Container* p_container, input_item_node_t *p_item_node );
+    static void* browseThread( void* p_data );
+    bool _stopping();
+
+    void _fetchContents();
+    bool _browseContainer( Container* p_parent );
+    int _browsePage( Container* p_parent, input_item_node_t* p_node,
+                     int i_offset, int* pi_total );
+    void _appendItem( Item* p_item, input_item_node_t* p_input_node );
+    std::string _getSystemUpdateID();
 
     IXML_Document* _browseAction( const char*, const char*,
             const char*, const char*, const char*, const char* );
@@ -89,6 +97,15 @@ private:
     int _i_subscription_timeout;
     int _i_content_directory_service_version;
     Upnp_SID _subscription_id;
+
+    /* Browsing thread, one per server */
+    vlc_mutex_t _lock;
+    vlc_cond_t _wait;
+    vlc_thread_t _thread;
+    bool _b_thread;
+    bool _b_fetch; /* new listing requested */
+    bool _b_stop;
+    std::string _update_id; /* SystemUpdateID of the current listing */
 };
 
 
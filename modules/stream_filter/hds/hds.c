@@ -42,15 +42,14 @@ typedef struct chunk_s
     uint32_t    seg_num;
     uint32_t    frun_entry; /* Used to speed things up in vod situations */
 
-    uint32_t    data_len;
-
     uint32_t    mdat_pos;   /* position in the mdat */
     uint32_t    mdat_len;
 
     void        *next;
 
     uint8_t     *mdat_data;
-    uint8_t     *data;
+    block_t     *data;      /* downloaded fragment, set under dl_lock */
+    bool        downloading;
     bool        failed;
     bool        eof;
 } chunk_t;
@@ -74,7 +73,6 @@ typedef struct hds_stream_s
     /* linked-list of chunks */
     chunk_t        *chunks_head;
     chunk_t        *chunks_livereadpos;
-    chunk_t        *chunks_downloadpos;
 
     char*          quality_segment_modifier;
 
@@ -93,6 +91,7 @@ typedef struct hds_stream_s
 
     vlc_mutex_t    abst_lock;
 
+    /* protects the chunk list, and wakes the download threads up */
     vlc_mutex_t    dl_lock;
     vlc_cond_t     dl_cond;
 
@@ -129,7 +128,8 @@ struct stream_sys_t
 {
     char         *base_url;    /* URL common part for chunks */
     vlc_thread_t live_thread;
-    vlc_thread_t dl_thread;
+    vlc_thread_t *dl_threads; /* fragments are downloaded concurrently */
+    unsigned     dl_threads_count;
 
     /* we pend on peek until some number of segments arrives; otherwise
      * the downstream system dies in case of playback */
@@ -207,6 +207,10 @@ static unsigned char amf_object_end[] = { 0x0, 0x0, 0x9 };
 static int  Open( vlc_object_t * );
 static void Close( vlc_object_t * );
 
+#define PARALLEL_TEXT N_("Parallel fragment downloads")
+#define PARALLEL_LONGTEXT N_("Number of fragments downloaded at the same " \
+    "time. Several downloads help filling links with a high latency.")
+
 vlc_module_begin()
     set_category( CAT_INPUT )
     set_subcategory( SUBCAT_INPUT_STREAM_FILTER )
@@ -214,6 +218,8 @@ vlc_module_begin()
     set_shortname( "Dynamic Streaming")
     add_shortcut( "hds" )
     set_capability( "stream_filter", 30 )
+    add_integer( "hds-parallel", 2, PARALLEL_TEXT, PARALLEL_LONGTEXT, true )
+        change_integer_range( 1, 6 )
     set_callbacks( Open, Close )
 vlc_module_end()
 
@@ -380,10 +386,13 @@ static uint8_t* parse_asrt( vlc_object_t* p_this,
     return data_p;
 }
 
+/* merge: append the runs after the last known one instead of parsing the
+ * whole table, for the refreshes of a live bootstrap */
 static uint8_t* parse_afrt( vlc_object_t* p_this,
                         hds_stream_t* s,
                         uint8_t* data,
-                        uint8_t* data_end )
+                        uint8_t* data_end,
+                        bool merge )
 {
     uint8_t* data_p = data;
 
@@ -451,10 +460,20 @@ static uint8_t* parse_afrt( vlc_object_t* p_this,
         return NULL;
     }
 
-    uint32_t fragment_run_entry_count = U32_AT( data_p );
+    const uint32_t fragment_run_entry_count = U32_AT( data_p );
     data_p += sizeof(uint32_t);
 
-    while(fragment_run_entry_count-- > 0)
+    /* a live bootstrap repeats the runs already known: skip them up to the
+     * last known one, if it is still there */
+    uint8_t* runs_p = data_p;
+    bool append = !merge || s->fragment_run_count == 0;
+    fragment_run_t last = { 0, 0, 0, 0 };
+    if( !append )
+        last = s->fragment_runs[s->fragment_run_count - 1];
+
+restart:
+    data_p = runs_p;
+    for( uint32_t i = 0; i < fragment_run_entry_count; i++ )
     {
         if( data_end - data_p < 16 )
         {
@@ -462,32 +481,64 @@ static uint8_t* parse_afrt( vlc_object_t* p_this,
             return NULL;
         }
 
-        if( s->fragment_run_count >= MAX_HDS_FRAGMENT_RUNS )
-        {
-            msg_Err( p_this, "Too many fragment runs, exiting" );
-            return NULL;
-        }
-
-        s->fragment_runs[s->fragment_run_count].fragment_number_start = U32_AT(data_p);
+        fragment_run_t run;
+        run.fragment_number_start = U32_AT(data_p);
         data_p += 4;
 
-        s->fragment_runs[s->fragment_run_count].fragment_timestamp = U64_AT( data_p );
+        run.fragment_timestamp = U64_AT( data_p );
         data_p += 8;
 
-        s->fragment_runs[s->fragment_run_count].fragment_duration = U32_AT( data_p );
+        run.fragment_duration = U32_AT( data_p );
         data_p += 4;
 
-        s->fragment_runs[s->fragment_run_count].discont = 0;
-        if( s->fragment_runs[s->fragment_run_count].fragment_duration == 0 )
+        run.discont = 0;
+        if( run.fragment_duration == 0 )
         {
+            if( data_p >= data_end )
+            {
+                msg_Err( p_this, "Not enough data in afrt" );
+                return NULL;
+            }
             /* discontinuity flag */
-            s->fragment_runs[s->fragment_run_count].discont = *(data_p++);
+            run.discont = *(data_p++);
+        }
+
+        if( !append )
+        {
+            append = run.fragment_number_start == last.fragment_number_start &&
+                     run.fragment_timestamp == last.fragment_timestamp &&
+                     run.fragment_duration == last.fragment_duration &&
+                     run.discont == last.discont;
+            continue;
+        }
+
+        if( s->fragment_run_count >= MAX_HDS_FRAGMENT_RUNS )
+        {
+            if( !merge )
+            {
+                msg_Err( p_this, "Too many fragment runs, exiting" );
+                return NULL;
+            }
+            /* the oldest runs are long out of the live window */
+            memmove( s->fragment_runs,
+                     s->fragment_runs + MAX_HDS_FRAGMENT_RUNS / 2,
+                     sizeof(fragment_run_t) * ( MAX_HDS_FRAGMENT_RUNS / 2 ) );
+            s->fragment_run_count -= MAX_HDS_FRAGMENT_RUNS / 2;
         }
 
-        s->fragment_run_count++;
+        s->fragment_runs[s->fragment_run_count++] = run;
     }
 
-    if ( s->fragment_runs[s->fragment_run_count-1].fragment_number_start == 0 &&
+    if( !append )
+    {
+        msg_Dbg( p_this, "fragment runs changed, reloading them" );
+        s->fragment_run_count = 0;
+        append = true;
+        goto restart;
+    }
+
+    if ( s->fragment_run_count > 0 &&
+         s->fragment_runs[s->fragment_run_count-1].fragment_number_start == 0 &&
          s->fragment_runs[s->fragment_run_count-1].fragment_timestamp == 0 &&
          s->fragment_runs[s->fragment_run_count-1].fragment_duration == 0 &&
          s->fragment_runs[s->fragment_run_count-1].discont == 0 )
@@ -507,14 +558,17 @@ static inline chunk_t* chunk_new()
 
 static void chunk_free( chunk_t * chunk )
 {
-    FREENULL( chunk->data );
+    if( chunk->data )
+        block_Release( chunk->data );
     free( chunk );
 }
 
+/* live: the bootstrap is a refresh of the one already parsed */
 static void parse_BootstrapData( vlc_object_t* p_this,
                                  hds_stream_t * s,
                                  uint8_t* data,
-                                 uint8_t* data_end )
+                                 uint8_t* data_end,
+                                 bool live )
 {
     uint8_t* data_p = data;
 
@@ -555,6 +609,7 @@ static void parse_BootstrapData( vlc_object_t* p_this,
     /* smtpe time code offset */
     data_p += 8;
 
+    free( s->movie_id );
     s->movie_id = strndup( (char*)data_p, data_end - data_p );
     data_p += ( strlen( s->movie_id ) + 1 );
 
@@ -567,7 +622,8 @@ static void parse_BootstrapData( vlc_object_t* p_this,
     server_entry_count = (uint8_t) *data_p;
     data_p++;
 
-    s->server_entry_count = 0;
+    while( s->server_entry_count > 0 )
+        free( s->server_entries[--s->server_entry_count] );
     while( server_entry_count-- > 0 )
     {
         if( s->server_entry_count < MAX_HDS_SERVERS )
@@ -671,10 +727,13 @@ static void parse_BootstrapData( vlc_object_t* p_this,
     uint8_t afrt_count = *data_p;
     data_p++;
 
-    s->fragment_run_count = 0;
+    /* only a single table can be merged with the previous one */
+    const bool merge = live && afrt_count == 1;
+    if( !merge )
+        s->fragment_run_count = 0;
     while( afrt_count-- > 0 &&
            data_end > data_p &&
-           (data_p = parse_afrt( p_this, s, data_p, data_end )) );
+           (data_p = parse_afrt( p_this, s, data_p, data_end, merge )) );
 }
 
 /* this only works with ANSI characters - this is ok
@@ -760,13 +819,17 @@ static uint32_t find_chunk_mdat( vlc_object_t* p_this,
     return chunkdata_end - ((uint8_t*)boxdata);
 }
 
-/* returns data ptr if valid (updating the chunk itself
-   tells the reader that the chunk is safe to read, which is not yet correct)*/
-static uint8_t* download_chunk( stream_t *s,
+/* returns the fragment, or NULL with chunk->failed set */
+static block_t* download_chunk( stream_t *s,
                                 stream_sys_t* sys,
                                 hds_stream_t* stream, chunk_t* chunk )
 {
     const char* quality = "";
+    char* fragment_url;
+
+    /* the live thread refreshes the server entries */
+    vlc_mutex_lock( & stream->abst_lock );
+
     char* server_base = sys->base_url;
     if( stream->server_entry_count > 0 &&
         strlen(stream->server_entries[0]) > 0 )
@@ -792,13 +855,18 @@ static uint8_t* download_chunk( stream_t *s,
         }
     }
 
-    char* fragment_url;
     if( 0 > asprintf( &fragment_url, "%s/%s%sSeg%u-Frag%u",
               server_base,
               movie_id,
               quality,
               chunk->seg_num,
-                      chunk->frag_num ) ) {
+                      chunk->frag_num ) )
+        fragment_url = NULL;
+
+    vlc_mutex_unlock( & stream->abst_lock );
+
+    chunk->failed = true;
+    if( ! fragment_url ) {
         msg_Err(s, "Failed to allocate memory for fragment url" );
         return NULL;
     }
@@ -810,47 +878,57 @@ static uint8_t* download_chunk( stream_t *s,
     {
         msg_Err(s, "Failed to download fragment %s", fragment_url );
         free( fragment_url );
-        chunk->failed = true;
         return NULL;
     }
     free( fragment_url );
 
     int64_t size = stream_Size( download_stream );
-    chunk->data_len = (uint32_t) size;
+    block_t* data = NULL;
 
     if( size > MAX_REQUEST_SIZE )
     {
         msg_Err(s, "Strangely-large chunk of %"PRIi64" Bytes", size );
-        return NULL;
-    }
-
-    uint8_t* data = malloc( size );
-    if( ! data )
-    {
-        msg_Err(s, "Couldn't allocate chunk" );
-        return NULL;
     }
-
-    int read = stream_Read( download_stream, data,
-                            size );
-    chunk->data_len = read;
-
-    if( read < size )
+    else if( size > 0 )
     {
-        msg_Err( s, "Requested %"PRIi64" bytes, "\
-                 "but only got %d", size, read );
-        data = realloc( chunk->data, read );
-        if( data != NULL )
-            chunk->data = data;
-        chunk->failed = true;
-        return NULL;
+        /* a single read straight into the block */
+        data = stream_Block( download_stream, size );
+        if( data && data->i_buffer < (size_t)size )
+        {
+            msg_Err( s, "Requested %"PRIi64" bytes, "\
+                     "but only got %zu", size, data->i_buffer );
+            block_Release( data );
+            data = NULL;
+        }
     }
     else
     {
-        chunk->failed = false;
+        /* unknown size (chunked transfer): gather the pieces once */
+        block_t* list = NULL;
+        block_t** pp_last = &list;
+        size_t total = 0;
+        block_t* block;
+
+        while( total <= MAX_REQUEST_SIZE &&
+               (block = stream_Block( download_stream, 256 * 1024 )) )
+        {
+            total += block->i_buffer;
+            block_ChainLastAppend( &pp_last, block );
+        }
+
+        if( total > MAX_REQUEST_SIZE )
+        {
+            msg_Err(s, "Strangely-large chunk of %zu Bytes", total );
+            block_ChainRelease( list );
+        }
+        else if( list )
+            data = block_ChainGather( list );
     }
 
     stream_Delete( download_stream );
+
+    if( data )
+        chunk->failed = false;
     return data;
 }
 
@@ -872,46 +950,48 @@ static void* download_thread( void* p )
 
     while( ! sys->closed )
     {
-        if( ! hds_stream->chunks_downloadpos )
-        {
-            chunk_t* chunk = hds_stream->chunks_head;
-            while(chunk && chunk->data )
-            {
-                chunk = chunk->next;
-            }
+        /* the first fragment that no other thread is downloading */
+        chunk_t* chunk = hds_stream->chunks_head;
+        while( chunk && ( chunk->data || chunk->downloading ) )
+            chunk = chunk->next;
 
-            if( chunk && ! chunk->data )
-                hds_stream->chunks_downloadpos = chunk;
+        if( ! chunk )
+        {
+            vlc_cond_wait( & hds_stream->dl_cond,
+                           & hds_stream->dl_lock );
+            continue;
         }
 
-        while( hds_stream->chunks_downloadpos )
-        {
-            chunk_t *chunk = hds_stream->chunks_downloadpos;
+        chunk->downloading = true;
+        vlc_mutex_unlock( & hds_stream->dl_lock );
 
-            uint8_t *data = download_chunk( (stream_t*)p_this,
-                                            sys,
-                                            hds_stream,
-                                            chunk );
+        block_t* data = download_chunk( s, sys, hds_stream, chunk );
 
-            if( ! chunk->failed )
-            {
-                chunk->mdat_len =
-                    find_chunk_mdat( p_this,
-                                     data,
-                                     data + chunk->data_len,
-                                     & chunk->mdat_data );
-                if( chunk->mdat_len == 0 ) {
-                    chunk->mdat_len = chunk->data_len - (chunk->mdat_data - data);
-                }
-                hds_stream->chunks_downloadpos = chunk->next;
-                chunk->data = data;
+        vlc_mutex_lock( & hds_stream->dl_lock );
+        chunk->downloading = false;
 
-                sys->chunk_count++;
-            }
+        if( ! data )
+        {
+            /* do not hammer the server, retry later */
+            vlc_cond_timedwait( & hds_stream->dl_cond,
+                                & hds_stream->dl_lock,
+                                mdate() + CLOCK_FREQ );
+            continue;
+        }
+
+        chunk->mdat_len =
+            find_chunk_mdat( p_this,
+                             data->p_buffer,
+                             data->p_buffer + data->i_buffer,
+                             & chunk->mdat_data );
+        if( chunk->mdat_len == 0 ) {
+            if( ! chunk->mdat_data )
+                chunk->mdat_data = data->p_buffer;
+            chunk->mdat_len = data->i_buffer - (chunk->mdat_data - data->p_buffer);
         }
+        chunk->data = data;
 
-        vlc_cond_wait( & hds_stream->dl_cond,
-                       & hds_stream->dl_lock );
+        sys->chunk_count++;
     }
 
     vlc_mutex_unlock( & hds_stream->dl_lock );
@@ -1048,6 +1128,7 @@ static chunk_t* generate_new_chunk(
     return chunk;
 }
 
+/* called with dl_lock and abst_lock held */
 static void maintain_live_chunks(
     vlc_object_t* p_this,
     hds_stream_t* hds_stream
@@ -1083,7 +1164,7 @@ static void maintain_live_chunks(
     }
 
     if( dl )
-        vlc_cond_signal( & hds_stream->dl_cond );
+        vlc_cond_broadcast( & hds_stream->dl_cond );
 
     chunk = hds_stream->chunks_head;
     while( chunk && chunk->data && chunk->mdat_pos >= chunk->mdat_len && chunk->next )
@@ -1159,11 +1240,13 @@ static void* live_thread( void* p )
             }
             else
             {
+                vlc_mutex_lock( & hds_stream->dl_lock );
                 vlc_mutex_lock( & hds_stream->abst_lock );
                 parse_BootstrapData( p_this, hds_stream,
-                                     data, data + read );
-                vlc_mutex_unlock( & hds_stream->abst_lock );
+                                     data, data + read, true );
                 maintain_live_chunks( p_this, hds_stream );
+                vlc_mutex_unlock( & hds_stream->abst_lock );
+                vlc_mutex_unlock( & hds_stream->dl_lock );
             }
 
             free( data );
@@ -1171,7 +1254,13 @@ static void* live_thread( void* p )
             stream_Delete( download_stream );
         }
 
-        mwait( last_dl_start_time + ( ((int64_t)hds_stream->fragment_runs[hds_stream->fragment_run_count-1].fragment_duration) * 1000000LL) / ((int64_t)hds_stream->afrt_timescale) );
+        vlc_mutex_lock( & hds_stream->abst_lock );
+        mtime_t refresh = CLOCK_FREQ;
+        if( hds_stream->fragment_run_count > 0 && hds_stream->afrt_timescale )
+            refresh = ( ((int64_t)hds_stream->fragment_runs[hds_stream->fragment_run_count-1].fragment_duration) * 1000000LL) / ((int64_t)hds_stream->afrt_timescale);
+        vlc_mutex_unlock( & hds_stream->abst_lock );
+
+        mwait( last_dl_start_time + refresh );
 
 
     }
@@ -1546,7 +1635,8 @@ static int parse_Manifest( stream_t *s, manifest_t *m )
                     parse_BootstrapData( (vlc_object_t*)s,
                                          new_stream,
                                          bootstraps[j].data,
-                                         bootstraps[j].data + bootstraps[j].data_len );
+                                         bootstraps[j].data + bootstraps[j].data_len,
+                                         false );
 
                     new_stream->download_leadtime = 15;
 
@@ -1633,6 +1723,27 @@ static void SysCleanup( stream_sys_t *p_sys )
     free( p_sys->base_url );
 }
 
+static void JoinDownloadThreads( stream_sys_t *p_sys )
+{
+    // TODO: Change here for selectable stream
+    hds_stream_t *stream = p_sys->hds_streams &&
+        vlc_array_count(p_sys->hds_streams) ?
+        p_sys->hds_streams->pp_elems[0] : NULL;
+
+    p_sys->closed = true;
+    if( stream )
+    {
+        vlc_mutex_lock( & stream->dl_lock );
+        vlc_cond_broadcast( & stream->dl_cond );
+        vlc_mutex_unlock( & stream->dl_lock );
+    }
+
+    for( unsigned i = 0; i < p_sys->dl_threads_count; i++ )
+        vlc_join( p_sys->dl_threads[i], NULL );
+    p_sys->dl_threads_count = 0;
+    FREENULL( p_sys->dl_threads );
+}
+
 static int Open( vlc_object_t *p_this )
 {
     stream_t *s = (stream_t*)p_this;
@@ -1677,9 +1788,19 @@ static int Open( vlc_object_t *p_this )
     s->pf_peek = Peek;
     s->pf_control = Control;
 
-    if( vlc_clone( &p_sys->dl_thread, download_thread, s, VLC_THREAD_PRIORITY_INPUT ) )
-    {
+    unsigned parallel = var_InheritInteger( s, "hds-parallel" );
+    if( parallel < 1 )
+        parallel = 1;
+    p_sys->dl_threads = malloc( parallel * sizeof(*p_sys->dl_threads) );
+    if( unlikely( p_sys->dl_threads == NULL ) )
         goto error;
+
+    while( p_sys->dl_threads_count < parallel )
+    {
+        if( vlc_clone( &p_sys->dl_threads[p_sys->dl_threads_count],
+                       download_thread, s, VLC_THREAD_PRIORITY_INPUT ) )
+            goto error;
+        p_sys->dl_threads_count++;
     }
 
     if( p_sys->live ) {
@@ -1694,6 +1815,7 @@ static int Open( vlc_object_t *p_this )
     return VLC_SUCCESS;
 
 error:
+    JoinDownloadThreads( p_sys );
     SysCleanup( p_sys );
     free( p_sys );
     return VLC_EGENERIC;
@@ -1704,15 +1826,7 @@ static void Close( vlc_object_t *p_this )
     stream_t *s = (stream_t*)p_this;
     stream_sys_t *p_sys = s->p_sys;
 
-    // TODO: Change here for selectable stream
-    hds_stream_t *stream = vlc_array_count(p_sys->hds_streams) ?
-        s->p_sys->hds_streams->pp_elems[0] : NULL;
-
-    p_sys->closed = true;
-    if (stream)
-        vlc_cond_signal( & stream->dl_cond );
-
-    vlc_join( p_sys->dl_thread, NULL );
+    JoinDownloadThreads( p_sys );
 
     if( p_sys->live )
     {
@@ -1756,11 +1870,15 @@ static unsigned read_chunk_data(
 {
     stream_t* s = (stream_t*) p_this;
     stream_sys_t* sys = s->p_sys;
-    chunk_t* chunk = stream->chunks_head;
+    chunk_t* chunk;
     uint8_t* buffer_start = buffer;
     bool dl = false;
 
+    vlc_mutex_lock( & stream->dl_lock );
+    chunk = stream->chunks_head;
+
     if( chunk && chunk->eof && chunk->mdat_pos >= chunk->mdat_len ) {
+        vlc_mutex_unlock( & stream->dl_lock );
         *eof = true;
         return 0;
     }
@@ -1844,9 +1962,11 @@ static unsigned read_chunk_data(
         }
 
         if( dl )
-            vlc_cond_signal( & stream->dl_cond );
+            vlc_cond_broadcast( & stream->dl_cond );
     }
 
+    vlc_mutex_unlock( & stream->dl_lock );
+
     return ( ((uint8_t*)buffer) - ((uint8_t*)buffer_start));
 }
 
@@ -1910,23 +2030,26 @@ static int Peek( stream_t *s, const uint8_t **pp_peek, unsigned i_peek )
         return p_sys->flv_header_len - p_sys->flv_header_bytes_sent;
     }
 
-    if( stream->chunks_head && ! stream->chunks_head->failed && stream->chunks_head->data )
+    /* the peeked data stays valid: only this thread frees the chunk, or the
+     * live thread once it is entirely read */
+    int i_ret = 0;
+    vlc_mutex_lock( & stream->dl_lock );
+    if( stream->chunks_head && stream->chunks_head->data )
     {
         // TODO: change here for selectable stream
         chunk_t* chunk = stream->chunks_head;
         *pp_peek = chunk->mdat_data + chunk->mdat_pos;
         if( chunk->mdat_len - chunk->mdat_pos < i_peek )
         {
-            return chunk->mdat_len - chunk->mdat_pos;
+            i_ret = chunk->mdat_len - chunk->mdat_pos;
         }
         else
         {
-            return i_peek;
+            i_ret = i_peek;
         }
-    } else
-    {
-        return 0;
     }
+    vlc_mutex_unlock( & stream->dl_lock );
+    return i_ret;
 }
 
 static int Control( stream_t *s, int i_query, va_list args )
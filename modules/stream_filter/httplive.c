@@ -43,17 +43,25 @@
 #include <vlc_memory.h>
 #include <vlc_gcrypt.h>
 
+#include "../demux/adaptive_rate.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
 static int  Open (vlc_object_t *);
 static void Close(vlc_object_t *);
 
+#define PARALLEL_TEXT N_("Parallel segment downloads")
+#define PARALLEL_LONGTEXT N_("Number of segments downloaded at the same " \
+    "time. Several downloads help filling links with a high latency.")
+
 vlc_module_begin()
     set_category(CAT_INPUT)
     set_subcategory(SUBCAT_INPUT_STREAM_FILTER)
     set_description(N_("Http Live Streaming stream filter"))
     set_capability("stream_filter", 20)
+    add_integer("hls-parallel", 2, PARALLEL_TEXT, PARALLEL_LONGTEXT, true)
+        change_integer_range(1, 6)
     set_callbacks(Open, Close)
 vlc_module_end()
 
@@ -61,6 +69,10 @@ vlc_module_end()
  *
  *****************************************************************************/
 #define AES_BLOCK_SIZE 16 /* Only support AES-128 */
+/* Buffered media (in target durations) needed to switch to a faster stream,
+ * and above which a slower link does not make us switch down */
+#define HLS_SWITCH_UP_BUFFER 2
+#define HLS_KEEP_BUFFER      4
 typedef struct segment_s
 {
     int         sequence;   /* unique sequence number */
@@ -102,24 +114,37 @@ struct stream_sys_t
 {
     char         *m3u8;         /* M3U8 url */
     vlc_thread_t  reload;       /* HLS m3u8 reload thread */
-    vlc_thread_t  thread;       /* HLS segment download thread */
+    vlc_thread_t *threads;      /* HLS segment download threads */
+    unsigned      threads_count;
 
     block_t      *peeked;
 
     /* */
     vlc_array_t  *hls_stream;   /* bandwidth adaptation */
-    uint64_t      bandwidth;    /* measured bandwidth (bits per second) */
+    uint64_t      bandwidth;    /* estimated bandwidth (bits per second) */
 
     /* Download */
     struct hls_download_s
     {
         int         stream;     /* current hls_stream  */
-        int         segment;    /* current segment for downloading */
+        int         segment;    /* next segment for downloading */
         int         seek;       /* segment requested by seek (default -1) */
+        int         active;     /* segments being downloaded */
+        bool        closing;
         vlc_mutex_t lock_wait;  /* protect segment download counter */
         vlc_cond_t  wait;       /* some condition to wait on */
     } download;
 
+    /* Bandwidth estimation, protected by download.lock_wait */
+    adaptive_rate_t rate;
+
+    /* Statistics */
+    struct hls_stats_s
+    {
+        unsigned    stalls;     /* times playback waited for a segment */
+        mtime_t     stalled;    /* time playback waited */
+    } stats;
+
     /* Playback */
     struct hls_playback_s
     {
@@ -1519,7 +1544,7 @@ static int hls_ReloadPlaylist(stream_t *s)
     if (stream_appended == true)
     {
         vlc_mutex_lock(&p_sys->download.lock_wait);
-        vlc_cond_signal(&p_sys->download.wait);
+        vlc_cond_broadcast(&p_sys->download.wait);
         vlc_mutex_unlock(&p_sys->download.lock_wait);
     }
 
@@ -1559,6 +1584,26 @@ static int BandwidthAdaptation(stream_t *s, int progid, uint64_t *bandwidth)
     return candidate;
 }
 
+/* Chooses the stream to download from, given the bandwidth estimate and the
+ * media buffered ahead of playback (seconds). Switching up requires a buffer
+ * to absorb a wrong guess, and a large buffer absorbs a slower link. */
+static int ChooseStream(stream_t *s, hls_stream_t *hls, int current,
+                        uint64_t bw, int buffered)
+{
+    int candidate = BandwidthAdaptation(s, hls->id, &bw);
+
+    if ((candidate < 0) || (candidate == current))
+        return current;
+    if (bw > hls->bandwidth)
+    {
+        if (buffered < HLS_SWITCH_UP_BUFFER * hls->duration)
+            return current;
+    }
+    else if (buffered >= HLS_KEEP_BUFFER * hls->duration)
+        return current;
+    return candidate;
+}
+
 static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *segment, int *cur_stream)
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -1575,10 +1620,13 @@ static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *se
     }
 
     /* sanity check - can we download this segment on time? */
-    if ((p_sys->bandwidth > 0) && (hls->bandwidth > 0))
+    vlc_mutex_lock(&p_sys->download.lock_wait);
+    uint64_t bandwidth = p_sys->bandwidth;
+    vlc_mutex_unlock(&p_sys->download.lock_wait);
+    if ((bandwidth > 0) && (hls->bandwidth > 0))
     {
         uint64_t size = (segment->duration * hls->bandwidth); /* bits */
-        int estimated = (int)(size / p_sys->bandwidth);
+        int estimated = (int)(size / bandwidth);
         if (estimated > segment->duration)
         {
             msg_Warn(s,"downloading segment %d predicted to take %ds, which exceeds its length (%ds)",
@@ -1613,23 +1661,31 @@ static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *se
     msg_Dbg(s, "downloaded segment %d from stream %d",
                 segment->sequence, *cur_stream);
 
-    uint64_t bw = segment->size * 8 * 1000000 / __MAX(1, duration); /* bits / s */
-    p_sys->bandwidth = bw;
+    /* Concurrent downloads share the link: scale the throughput of this one
+     * by their count to estimate the available bandwidth. */
+    vlc_mutex_lock(&p_sys->download.lock_wait);
+    uint64_t bw = p_sys->bandwidth =
+        adaptive_rate_Add(&p_sys->rate, segment->size, duration,
+                          p_sys->download.active);
+    int buffered = (p_sys->download.segment - p_sys->download.active
+                    - p_sys->playback.segment) * hls->duration;
+    vlc_mutex_unlock(&p_sys->download.lock_wait);
+
     if (p_sys->b_meta && (hls->bandwidth != bw))
     {
-        int newstream = BandwidthAdaptation(s, hls->id, &bw);
-
-        /* FIXME: we need an average here */
-        if ((newstream >= 0) && (newstream != *cur_stream))
+        int newstream = ChooseStream(s, hls, *cur_stream, bw, buffered);
+        if (newstream != *cur_stream)
         {
-            msg_Dbg(s, "detected %s bandwidth (%"PRIu64") stream",
-                     (bw >= hls->bandwidth) ? "faster" : "lower", bw);
+            msg_Dbg(s, "detected %s bandwidth (%"PRIu64") stream, %ds buffered",
+                     (bw >= hls->bandwidth) ? "faster" : "lower", bw, buffered);
             *cur_stream = newstream;
         }
     }
     return VLC_SUCCESS;
 }
 
+/* Download thread. Several of them may run, each one taking the next segment
+ * to download until the download window is full. */
 static void* hls_Thread(void *p_this)
 {
     stream_t *s = (stream_t *)p_this;
@@ -1639,7 +1695,11 @@ static void* hls_Thread(void *p_this)
 
     while (vlc_object_alive(s))
     {
-        hls_stream_t *hls = hls_Get(p_sys->hls_stream, p_sys->download.stream);
+        vlc_mutex_lock(&p_sys->download.lock_wait);
+        int stream = p_sys->download.stream;
+        vlc_mutex_unlock(&p_sys->download.lock_wait);
+
+        hls_stream_t *hls = hls_Get(p_sys->hls_stream, stream);
         assert(hls);
 
         /* Sliding window (~60 seconds worth of movie) */
@@ -1647,15 +1707,15 @@ static void* hls_Thread(void *p_this)
         int count = vlc_array_count(hls->segments);
         vlc_mutex_unlock(&hls->lock);
 
+        vlc_mutex_lock(&p_sys->download.lock_wait);
         /* Is there a new segment to process? */
         if ((!p_sys->b_live && (p_sys->playback.segment < (count - 6))) ||
             (p_sys->download.segment >= count))
         {
             /* wait */
-            vlc_mutex_lock(&p_sys->download.lock_wait);
             while (((p_sys->download.segment - p_sys->playback.segment > 6) ||
                     (p_sys->download.segment >= count)) &&
-                   (p_sys->download.seek == -1))
+                   (p_sys->download.seek == -1) && !p_sys->download.closing)
             {
                 vlc_cond_wait(&p_sys->download.wait, &p_sys->download.lock_wait);
                 if (p_sys->b_live /*&& (mdate() >= p_sys->playlist.wakeup)*/)
@@ -1663,23 +1723,51 @@ static void* hls_Thread(void *p_this)
                 if (!vlc_object_alive(s))
                     break;
             }
-            /* */
-            if (p_sys->download.seek >= 0)
-            {
-                p_sys->download.segment = p_sys->download.seek;
-                p_sys->download.seek = -1;
-            }
+        }
+        /* */
+        if (p_sys->download.seek >= 0)
+        {
+            p_sys->download.segment = p_sys->download.seek;
+            p_sys->download.seek = -1;
+        }
+
+        if (p_sys->download.closing || !vlc_object_alive(s))
+        {
+            vlc_mutex_unlock(&p_sys->download.lock_wait);
+            break;
+        }
+
+        /* The stream changed or another thread took the last segment */
+        if ((p_sys->download.stream != stream) ||
+            (p_sys->download.segment >= count))
+        {
             vlc_mutex_unlock(&p_sys->download.lock_wait);
+            continue;
         }
 
-        if (!vlc_object_alive(s)) break;
+        int index = p_sys->download.segment++;
+        p_sys->download.active++;
+        vlc_mutex_unlock(&p_sys->download.lock_wait);
 
         vlc_mutex_lock(&hls->lock);
-        segment_t *segment = segment_GetSegment(hls, p_sys->download.segment);
+        segment_t *segment = segment_GetSegment(hls, index);
         vlc_mutex_unlock(&hls->lock);
 
-        if ((segment != NULL) &&
-            (hls_DownloadSegmentData(s, hls, segment, &p_sys->download.stream) != VLC_SUCCESS))
+        int ret = VLC_SUCCESS;
+        if (segment != NULL)
+            ret = hls_DownloadSegmentData(s, hls, segment, &stream);
+
+        vlc_mutex_lock(&p_sys->download.lock_wait);
+        p_sys->download.active--;
+        /* Follow the bandwidth adaptation, unless another download or a seek
+         * already changed the stream */
+        if ((stream != p_sys->download.stream) &&
+            (p_sys->download.seek == -1))
+            p_sys->download.stream = stream;
+        vlc_cond_broadcast(&p_sys->download.wait);
+        vlc_mutex_unlock(&p_sys->download.lock_wait);
+
+        if (ret != VLC_SUCCESS)
         {
             if (!vlc_object_alive(s)) break;
 
@@ -1690,19 +1778,6 @@ static void* hls_Thread(void *p_this)
             }
         }
 
-        /* download succeeded */
-        /* determine next segment to download */
-        vlc_mutex_lock(&p_sys->download.lock_wait);
-        if (p_sys->download.seek >= 0)
-        {
-            p_sys->download.segment = p_sys->download.seek;
-            p_sys->download.seek = -1;
-        }
-        else if (p_sys->download.segment < count)
-            p_sys->download.segment++;
-        vlc_cond_signal(&p_sys->download.wait);
-        vlc_mutex_unlock(&p_sys->download.lock_wait);
-
         // In case of a successful download signal the read thread that data is available
         vlc_mutex_lock(&p_sys->read.lock_wait);
         vlc_cond_signal(&p_sys->read.wait);
@@ -1785,8 +1860,11 @@ static int Prefetch(stream_t *s, int *current)
     else if (vlc_array_count(hls->segments) == 1 && p_sys->b_live)
         msg_Warn(s, "Only 1 segment available to prefetch in live stream; may stall");
 
-    /* Download ~10s worth of segments of this HLS stream if they exist */
-    unsigned segment_amount = (0.5f + 10/hls->duration);
+    /* Download ~10s worth of segments of this HLS stream if they exist, or
+     * only the first one if the download threads fetch several at a time */
+    unsigned segment_amount = 1;
+    if (p_sys->threads_count == 1)
+        segment_amount = (0.5f + 10/hls->duration);
     for (int i = 0; i < __MIN(vlc_array_count(hls->segments), segment_amount); i++)
     {
         segment_t *segment = segment_GetSegment(hls, p_sys->download.segment);
@@ -2049,6 +2127,7 @@ static int Open(vlc_object_t *p_this)
     s->psz_path = new_path;
 
     p_sys->bandwidth = 0;
+    adaptive_rate_Init(&p_sys->rate);
     p_sys->b_live = true;
     p_sys->b_meta = false;
     p_sys->b_error = false;
@@ -2094,22 +2173,29 @@ static int Open(vlc_object_t *p_this)
     /* manage encryption key if needed */
     hls_ManageSegmentKeys(s, hls_Get(p_sys->hls_stream, current));
 
+    p_sys->threads_count = var_InheritInteger(s, "hls-parallel");
+    if (p_sys->threads_count < 1)
+        p_sys->threads_count = 1;
+    p_sys->threads = malloc(p_sys->threads_count * sizeof(*p_sys->threads));
+    if (p_sys->threads == NULL)
+        goto fail;
+
+    vlc_mutex_init(&p_sys->download.lock_wait);
+    vlc_cond_init(&p_sys->download.wait);
+
+    vlc_mutex_init(&p_sys->read.lock_wait);
+    vlc_cond_init(&p_sys->read.wait);
+
     if (Prefetch(s, &current) != VLC_SUCCESS)
     {
         msg_Err(s, "fetching first segment failed.");
-        goto fail;
+        goto fail_thread;
     }
 
     p_sys->download.stream = current;
     p_sys->playback.stream = current;
     p_sys->download.seek = -1;
 
-    vlc_mutex_init(&p_sys->download.lock_wait);
-    vlc_cond_init(&p_sys->download.wait);
-
-    vlc_mutex_init(&p_sys->read.lock_wait);
-    vlc_cond_init(&p_sys->read.wait);
-
     /* Initialize HLS live stream */
     if (p_sys->b_live)
     {
@@ -2124,11 +2210,19 @@ static int Open(vlc_object_t *p_this)
         }
     }
 
-    if (vlc_clone(&p_sys->thread, hls_Thread, s, VLC_THREAD_PRIORITY_INPUT))
+    for (unsigned i = 0; i < p_sys->threads_count; i++)
     {
-        if (p_sys->b_live)
-            vlc_join(p_sys->reload, NULL);
-        goto fail_thread;
+        if (vlc_clone(&p_sys->threads[i], hls_Thread, s, VLC_THREAD_PRIORITY_INPUT))
+        {
+            if (i > 0)
+            {   /* run with the threads already started */
+                p_sys->threads_count = i;
+                break;
+            }
+            if (p_sys->b_live)
+                vlc_join(p_sys->reload, NULL);
+            goto fail_thread;
+        }
     }
 
     return VLC_SUCCESS;
@@ -2141,6 +2235,7 @@ fail_thread:
     vlc_cond_destroy(&p_sys->read.wait);
 
 fail:
+    free(p_sys->threads);
     /* Free hls streams */
     for (int i = 0; i < vlc_array_count(p_sys->hls_stream); i++)
     {
@@ -2178,13 +2273,22 @@ static void Close(vlc_object_t *p_this)
     /* negate the condition variable's predicate */
     p_sys->download.segment = p_sys->playback.segment = 0;
     p_sys->download.seek = 0; /* better safe than sorry */
-    vlc_cond_signal(&p_sys->download.wait);
+    p_sys->download.closing = true;
+    vlc_cond_broadcast(&p_sys->download.wait);
     vlc_mutex_unlock(&p_sys->download.lock_wait);
 
     /* */
     if (p_sys->b_live)
         vlc_join(p_sys->reload, NULL);
-    vlc_join(p_sys->thread, NULL);
+    for (unsigned i = 0; i < p_sys->threads_count; i++)
+        vlc_join(p_sys->threads[i], NULL);
+    free(p_sys->threads);
+
+    msg_Dbg(s, "downloaded %u segments (%"PRIu64" bytes, %"PRIu64" bits/s "
+            "per download, %"PRIu64" bits/s estimated), %u stalls (%"PRId64
+            " ms)", p_sys->rate.segments, p_sys->rate.bytes,
+            adaptive_rate_Average(&p_sys->rate), p_sys->bandwidth, p_sys->stats.stalls,
+            p_sys->stats.stalled / (CLOCK_FREQ / 1000));
     vlc_mutex_destroy(&p_sys->download.lock_wait);
     vlc_cond_destroy(&p_sys->download.wait);
 
@@ -2345,7 +2449,7 @@ static ssize_t hls_Read(stream_t *s, uint8_t *p_read, unsigned int i_read)
             /* signal download thread */
             vlc_mutex_lock(&p_sys->download.lock_wait);
             p_sys->playback.segment++;
-            vlc_cond_signal(&p_sys->download.wait);
+            vlc_cond_broadcast(&p_sys->download.wait);
             vlc_mutex_unlock(&p_sys->download.lock_wait);
             continue;
         }
@@ -2416,6 +2520,8 @@ static int Read(stream_t *s, void *buffer, unsigned int i_read)
             mtime_t timeout_limit = start + (10 * CLOCK_FREQ);
 
             int res = vlc_cond_timedwait(&p_sys->read.wait, &p_sys->read.lock_wait, timeout_limit);
+            p_sys->stats.stalls++;
+            p_sys->stats.stalled += mdate() - start;
 
             // Error - reached a timeout of 10 seconds without data arriving - kill the stream
             if (res == ETIMEDOUT)
@@ -2656,7 +2762,7 @@ static int segment_Seek(stream_t *s, const uint64_t pos)
         /* Wake up download thread */
         vlc_mutex_lock(&p_sys->download.lock_wait);
         p_sys->download.seek = p_sys->playback.segment;
-        vlc_cond_signal(&p_sys->download.wait);
+        vlc_cond_broadcast(&p_sys->download.wait);
 
         /* Wait for download to be finished */
         msg_Dbg(s, "seek to segment %d", p_sys->playback.segment);
@@ -459,12 +459,12 @@ static int Download( stream_t *s, sms_stream_t *sms )
     }
 
     /* sanity check - can we download this chunk on time? */
-    if( (sms->i_obw > 0) && (sms->current_qlvl->Bitrate > 0) )
+    if( (sms->rate.bps > 0) && (sms->current_qlvl->Bitrate > 0) )
     {
         /* duration in ms */
         unsigned chunk_duration = chunk->duration * 1000 / sms->timescale;
         uint64_t size = chunk_duration * sms->current_qlvl->Bitrate / 1000; /* bits */
-        unsigned estimated = size * 1000 / sms->i_obw;
+        unsigned estimated = size * 1000 / sms->rate.bps;
         if( estimated > chunk_duration )
         {
             msg_Warn( s,"downloading of chunk @%"PRIu64" would take %d ms, "
@@ -487,8 +487,7 @@ static int Download( stream_t *s, sms_stream_t *sms )
     msg_Info( s, "downloaded chunk @%"PRIu64" from stream %s at quality %u",
                  chunk->start_time, sms->name, sms->current_qlvl->Bitrate );
 
-    if (likely( duration ))
-        bw_stats_put( sms, chunk->size * 8 * CLOCK_FREQ / duration ); /* bits / s */
+    adaptive_rate_Add( &sms->rate, chunk->size, duration, 1 );
 
     /* Track could get disabled in mp4 demux if we trigger adaption too soon.
        And we don't need adaptation on last chunk */
@@ -497,15 +496,14 @@ static int Download( stream_t *s, sms_stream_t *sms )
 
     bool b_starved = false;
     vlc_mutex_lock( &p_sys->playback.lock );
-    if ( &p_sys->playback.b_underrun )
+    if ( p_sys->playback.b_underrun )
     {
         p_sys->playback.b_underrun = false;
-        bw_stats_underrun( sms );
         b_starved = true;
     }
     vlc_mutex_unlock( &p_sys->playback.lock );
 
-    quality_level_t *new_qlevel = BandwidthAdaptation( s, sms, sms->i_obw,
+    quality_level_t *new_qlevel = BandwidthAdaptation( s, sms, sms->rate.bps,
                                                        duration, b_starved );
     assert(new_qlevel);
 
@@ -639,15 +637,12 @@ void* sms_Thread( void *p_this )
         vlc_mutex_lock( &sms->chunks_lock );
         if ( sms->p_nextdownload )
         {
-            mtime_t duration = mdate();
+            /* Download() accounts for the chunk in the bandwidth estimate */
             if( Download( s, sms ) != VLC_SUCCESS )
             {
                 vlc_mutex_unlock( &sms->chunks_lock );
                 goto cancel;
             }
-            duration = mdate() - duration;
-            if (likely( duration ))
-                bw_stats_put( sms, sms->p_nextdownload->size * 8 * CLOCK_FREQ / duration ); /* bits / s */
             sms->p_nextdownload = sms->p_nextdownload->p_next;
         }
         vlc_mutex_unlock( &sms->chunks_lock );
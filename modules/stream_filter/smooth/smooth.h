@@ -31,11 +31,12 @@
 #include <vlc_common.h>
 #include <vlc_arrays.h>
 
+#include "../../demux/adaptive_rate.h"
+
 //#define DISABLE_BANDWIDTH_ADAPTATION
 
 #define CHUNK_OFFSET_UNSET 0
 #define CHUNK_OFFSET_0     1
-#define SMS_BW_SHORTSTATS  4
 #define SMS_PROBE_LENGTH   (CLOCK_FREQ * 2)
 
 typedef struct chunk_s chunk_t;
@@ -92,10 +93,7 @@ typedef struct sms_stream_s
     char           *url_template;
     int            type;
     quality_level_t *current_qlvl; /* current quality level for Download() */
-    uint64_t       rgi_bw[SMS_BW_SHORTSTATS]; /* Measured bandwidths of the N last chunks */
-    int            rgi_tidx;       /* tail index of rgi_bw */
-    uint64_t       i_obw;          /* Overwall bandwidth average */
-    unsigned int   i_obw_samples;  /* used to compute overall incrementally */
+    adaptive_rate_t rate;          /* bandwidth estimate */
 } sms_stream_t;
 
 struct stream_sys_t
@@ -145,9 +143,6 @@ struct stream_sys_t
 #define SMS_GET_SELECTED_ST( cat ) \
     sms_get_stream_by_cat( p_sys, cat )
 
-void bw_stats_put( sms_stream_t *, const uint64_t );
-uint64_t bw_stats_avg( sms_stream_t * );
-void bw_stats_underrun( sms_stream_t * );
 void* sms_Thread( void *);
 quality_level_t * ql_New( void );
 void ql_Free( quality_level_t *);
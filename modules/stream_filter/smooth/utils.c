@@ -123,6 +123,7 @@ sms_stream_t * sms_New( void )
 
     ARRAY_INIT( sms->qlevels );
     sms->type = UNKNOWN_ES;
+    adaptive_rate_Init( &sms->rate );
     vlc_mutex_init( &sms->chunks_lock );
     return sms;
 }
@@ -152,43 +153,6 @@ void sms_Free( sms_stream_t *sms )
     free( sms );
 }
 
-void bw_stats_put( sms_stream_t *sms, const uint64_t bw )
-{
-    /* overall bw update */
-    if ( bw >= sms->i_obw )
-        sms->i_obw = sms->i_obw + ( bw - sms->i_obw ) /
-                    (sms->i_obw_samples + 1);
-    else
-        sms->i_obw = sms->i_obw - ( sms->i_obw - bw ) /
-                    (sms->i_obw_samples + 1);
-    sms->i_obw_samples++;
-    /* limited history bw stats update */
-    if ( sms->rgi_bw[0] == 0 )
-    { /* first stats */
-        for( int i=0; i<SMS_BW_SHORTSTATS; i++ )
-            sms->rgi_bw[i] = bw;
-    }
-    else
-    {
-        sms->rgi_tidx = (sms->rgi_tidx + 1) % SMS_BW_SHORTSTATS;
-        sms->rgi_bw[sms->rgi_tidx] = bw;
-    }
-}
-
-uint64_t bw_stats_avg( sms_stream_t *sms )
-{
-    uint64_t sum = sms->rgi_bw[0];
-    for( int i=1; i<SMS_BW_SHORTSTATS; i++ )
-        sum += sms->rgi_bw[i];
-    return sum / SMS_BW_SHORTSTATS;
-}
-
-void bw_stats_underrun( sms_stream_t *sms )
-{
-    sms->i_obw = bw_stats_avg( sms );
-    sms->i_obw_samples = SMS_BW_SHORTSTATS;
-}
-
 sms_stream_t * sms_get_stream_by_cat( stream_sys_t *p_sys, int i_cat )
 {
     assert( p_sys->sms_selected.i_size >= 0 && p_sys->sms_selected.i_size <= 3 );
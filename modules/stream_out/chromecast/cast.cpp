@@ -74,7 +74,8 @@ struct sout_stream_sys_t
 {
     sout_stream_sys_t()
         : p_tls(NULL), i_requestId(0),
-          i_status(CHROMECAST_DISCONNECTED), p_out(NULL)
+          i_status(CHROMECAST_DISCONNECTED), p_out(NULL), b_webm(false),
+          p_audio_transcode(NULL), p_video_transcode(NULL)
     {
         atomic_init(&ab_error, false);
     }
@@ -98,6 +99,18 @@ struct sout_stream_sys_t
     vlc_cond_t loadCommandCond;
 
     sout_stream_t *p_out;
+
+    /* Chains transcoding the ES the receiver cannot play into p_out,
+     * created with the first such ES */
+    bool b_webm;
+    sout_stream_t *p_audio_transcode;
+    sout_stream_t *p_video_transcode;
+};
+
+struct sout_stream_id_sys_t
+{
+    sout_stream_t        *p_out; /* p_sys->p_out or a transcoding chain */
+    sout_stream_id_sys_t *p_sub_id;
 };
 
 // Media player Chromecast app id
@@ -175,17 +188,90 @@ vlc_module_end ()
 /*****************************************************************************
  * Sout callbacks
  *****************************************************************************/
+
+/**
+ * @brief Whether the receiver plays the codec as is in the container used
+ */
+static bool canRemux(const sout_stream_sys_t *p_sys, const es_format_t *p_fmt)
+{
+    switch (p_fmt->i_codec)
+    {
+    case VLC_CODEC_H264:
+    case VLC_CODEC_MP4A:
+    case VLC_CODEC_MPGA:
+        return !p_sys->b_webm;
+    case VLC_CODEC_VP8:
+    case VLC_CODEC_VP9:
+    case VLC_CODEC_VORBIS:
+    case VLC_CODEC_OPUS:
+        return p_sys->b_webm;
+    default:
+        return false;
+    }
+}
+
+
 static sout_stream_id_sys_t *Add(sout_stream_t *p_stream, es_format_t *p_fmt)
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
-    return p_sys->p_out->pf_add(p_sys->p_out, p_fmt);
+    sout_stream_t *p_out = p_sys->p_out;
+
+    /* Only the ES the receiver cannot play are transcoded */
+    if (!canRemux(p_sys, p_fmt))
+    {
+        sout_stream_t **pp_transcode;
+        const char *psz_chain;
+
+        switch (p_fmt->i_cat)
+        {
+        case AUDIO_ES:
+            pp_transcode = &p_sys->p_audio_transcode;
+            psz_chain = p_sys->b_webm ? "transcode{acodec=vorb,ab=192}"
+                                      : "transcode{acodec=mp4a,ab=192}";
+            break;
+        case VIDEO_ES:
+            pp_transcode = &p_sys->p_video_transcode;
+            psz_chain = p_sys->b_webm ? "transcode{vcodec=VP80}"
+                                      : "transcode{vcodec=h264}";
+            break;
+        default:
+            msg_Dbg(p_stream, "ignoring ES %4.4s", (const char *)&p_fmt->i_codec);
+            return NULL;
+        }
+
+        if (*pp_transcode == NULL)
+        {
+            msg_Dbg(p_stream, "%4.4s is not supported by the receiver, "
+                    "using %s", (const char *)&p_fmt->i_codec, psz_chain);
+            *pp_transcode = sout_StreamChainNew(p_stream->p_sout,
+                                                const_cast<char *>(psz_chain),
+                                                p_sys->p_out, NULL);
+            if (*pp_transcode == NULL)
+                return NULL;
+        }
+        p_out = *pp_transcode;
+    }
+
+    sout_stream_id_sys_t *id = new(std::nothrow) sout_stream_id_sys_t;
+    if (id == NULL)
+        return NULL;
+    id->p_out = p_out;
+    id->p_sub_id = p_out->pf_add(p_out, p_fmt);
+    if (id->p_sub_id == NULL)
+    {
+        delete id;
+        return NULL;
+    }
+    return id;
 }
 
 
 static int Del(sout_stream_t *p_stream, sout_stream_id_sys_t *id)
 {
-    sout_stream_sys_t *p_sys = p_stream->p_sys;
-    return p_sys->p_out->pf_del(p_sys->p_out, id);
+    int i_ret = id->p_out->pf_del(id->p_out, id->p_sub_id);
+    delete id;
+    VLC_UNUSED(p_stream);
+    return i_ret;
 }
 
 
@@ -196,7 +282,7 @@ static int Send(sout_stream_t *p_stream, sout_stream_id_sys_t *id,
     if (atomic_load(&p_sys->ab_error))
         return VLC_EGENERIC;
 
-    return p_sys->p_out->pf_send(p_sys->p_out, id, p_buffer);
+    return id->p_out->pf_send(id->p_out, id->p_sub_id, p_buffer);
 }
 
 
@@ -247,6 +333,8 @@ static int Open(vlc_object_t *p_this)
         Clean(p_stream);
         return VLC_EGENERIC;
     }
+    p_sys->b_webm = strstr(psz_mux, "webm") != NULL
+                 || strstr(psz_mux, "mkv") != NULL;
     char *psz_chain = NULL;
     int i_bytes = asprintf(&psz_chain, "http{dst=:%u/stream,mux=%s}",
                            (unsigned)var_InheritInteger(p_stream, SOUT_CFG_PREFIX"http-port"),
@@ -355,6 +443,12 @@ static void Clean(sout_stream_t *p_stream)
     {
         vlc_mutex_destroy(&p_sys->lock);
         vlc_cond_destroy(&p_sys->loadCommandCond);
+        if (p_sys->p_audio_transcode)
+            sout_StreamChainDelete(p_sys->p_audio_transcode,
+                                   p_sys->p_audio_transcode);
+        if (p_sys->p_video_transcode)
+            sout_StreamChainDelete(p_sys->p_video_transcode,
+                                   p_sys->p_video_transcode);
         sout_StreamChainDelete(p_sys->p_out, p_sys->p_out);
     }
 
@@ -187,8 +187,13 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             else
                 p_buffer->i_pts += p_sys->i_delay;
 
-            input_DecoderDecode( (decoder_t *)id, p_buffer, false );
+            /* The decoder may write to the payload */
+            p_buffer = block_Unshare( p_buffer );
+            if( p_buffer != NULL )
+                input_DecoderDecode( (decoder_t *)id, p_buffer, false );
         }
+        else
+            block_Release( p_buffer );
 
         p_buffer = p_next;
     }
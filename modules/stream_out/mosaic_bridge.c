@@ -570,18 +570,9 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
         {
             /* TODO: chroma conversion if needed */
 
-            p_new_pic = picture_New( p_pic->format.i_chroma,
-                                     p_pic->format.i_width, p_pic->format.i_height,
-                                     p_sys->p_decoder->fmt_out.video.i_sar_num,
-                                     p_sys->p_decoder->fmt_out.video.i_sar_den );
-            if( !p_new_pic )
-            {
-                picture_Release( p_pic );
-                msg_Err( p_stream, "image allocation failed" );
-                continue;
-            }
-
-            picture_Copy( p_new_pic, p_pic );
+            /* The decoder allocates a new picture every time: the mosaic
+             * can keep this one without a copy */
+            p_new_pic = picture_Hold( p_pic );
         }
         picture_Release( p_pic );
 
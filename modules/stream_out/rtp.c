@@ -283,7 +283,8 @@ static int               MuxSend( sout_stream_t *, sout_stream_id_sys_t *,
                                   block_t* );
 
 static sout_access_out_t *GrabberCreate( sout_stream_t *p_sout );
-static void* ThreadSend( void * );
+static void RtpSenderAttach( sout_stream_id_sys_t * );
+static void RtpSenderDetach( sout_stream_id_sys_t * );
 static void *rtp_listen_thread( void * );
 
 static void SDPHandleUrl( sout_stream_t *, const char * );
@@ -375,7 +376,6 @@ struct sout_stream_id_sys_t
 #endif
 
     /* Packets sinks */
-    vlc_thread_t      thread;
     vlc_mutex_t       lock_sink;
     int               sinkc;
     rtp_sink_t       *sinkv;
@@ -385,7 +385,10 @@ struct sout_stream_id_sys_t
         vlc_thread_t  thread;
     } listen;
 
-    block_fifo_t     *p_fifo;
+    /* Packets waiting for their send date (protected by the sender lock) */
+    struct rtp_sender *sender;
+    block_t          *p_first;
+    block_t         **pp_last;
     int64_t           i_caching;
 };
 
@@ -976,7 +979,7 @@ static sout_stream_id_sys_t *Add( sout_stream_t *p_stream, es_format_t *p_fmt )
     id->sinkc = 0;
     id->sinkv = NULL;
     id->rtsp_id = NULL;
-    id->p_fifo = NULL;
+    id->sender = NULL;
     id->listen.fd = NULL;
 
     id->b_first_packet = true;
@@ -1181,15 +1184,9 @@ static sout_stream_id_sys_t *Add( sout_stream_t *p_stream, es_format_t *p_fmt )
         id->rtsp_id = RtspAddId( p_sys->rtsp, id, GetDWBE( id->ssrc ),
                                  id->rtp_fmt.clock_rate, mcast_fd );
 
-    id->p_fifo = block_FifoNew();
-    if( unlikely(id->p_fifo == NULL) )
+    RtpSenderAttach( id );
+    if( unlikely(id->sender == NULL) )
         goto error;
-    if( vlc_clone( &id->thread, ThreadSend, id, VLC_THREAD_PRIORITY_HIGHEST ) )
-    {
-        block_FifoRelease( id->p_fifo );
-        id->p_fifo = NULL;
-        goto error;
-    }
 
     /* Update p_sys context */
     vlc_mutex_lock( &p_sys->lock_es );
@@ -1224,12 +1221,8 @@ static int Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
     TAB_REMOVE( p_sys->i_es, p_sys->es, id );
     vlc_mutex_unlock( &p_sys->lock_es );
 
-    if( likely(id->p_fifo != NULL) )
-    {
-        vlc_cancel( id->thread );
-        vlc_join( id->thread, NULL );
-        block_FifoRelease( id->p_fifo );
-    }
+    if( likely(id->sender != NULL) )
+        RtpSenderDetach( id );
 
     free( id->rtp_fmt.fmtp );
 
@@ -1392,94 +1385,429 @@ static int  HttpCallback( httpd_file_sys_t *p_args,
 /****************************************************************************
  * RTP send
  ****************************************************************************/
-static void* ThreadSend( void *data )
+/*****************************************************************************
+ * Scatter/gather packets:
+ *****************************************************************************
+ * Packetizers can send the RTP header and the payload header from the
+ * packet itself, and reference the payload in the (shared) ES frame, rather
+ * than copy it. The packet and the payload are then sent together with
+ * sendmsg().
+ *****************************************************************************/
+typedef struct
+{
+    block_t  self;
+    block_t *payload;
+    uint8_t  header[RTP_HEADROOM];
+} rtp_packet_t;
+
+static void rtp_packet_Release( block_t *block )
+{
+    rtp_packet_t *pkt = (rtp_packet_t *)block;
+
+    block_Release( pkt->payload );
+    free( pkt );
+}
+
+block_t *rtp_packet_New( block_t *frame, size_t i_header,
+                         const uint8_t *p_data, size_t i_data )
 {
+    assert( i_header <= RTP_HEADROOM );
+    assert( p_data >= frame->p_buffer
+         && p_data + i_data <= frame->p_buffer + frame->i_buffer );
+
+#ifdef _WIN32
+    /* No sendmsg(): copy the payload */
+    block_t *out = block_Alloc( i_header + i_data );
+    if( likely(out != NULL) )
+        memcpy( out->p_buffer + i_header, p_data, i_data );
+    return out;
+#else
+    rtp_packet_t *pkt = malloc( sizeof( *pkt ) );
+    if( unlikely(pkt == NULL) )
+        return NULL;
+
+    /* references the payload if the frame is shared, copies it otherwise */
+    block_t *payload = block_Clone( frame );
+    if( unlikely(payload == NULL) )
+    {
+        free( pkt );
+        return NULL;
+    }
+    payload->p_buffer += p_data - frame->p_buffer;
+    payload->i_buffer = i_data;
+
+    block_Init( &pkt->self, pkt->header, i_header );
+    pkt->self.pf_release = rtp_packet_Release;
+    pkt->payload = payload;
+    return &pkt->self;
+#endif
+}
+
+/* Returns the referenced payload of a packet, NULL if it is contiguous */
+static block_t *rtp_packet_payload( const block_t *out )
+{
+    if( out->pf_release != rtp_packet_Release )
+        return NULL;
+    return ((const rtp_packet_t *)out)->payload;
+}
+
+static size_t rtp_packet_size( const block_t *out )
+{
+    const block_t *payload = rtp_packet_payload( out );
+
+    return out->i_buffer + (payload != NULL ? payload->i_buffer : 0);
+}
+
+#ifdef HAVE_SRTP
+/* Makes a packet contiguous, with i_extra bytes of room at its end */
+static block_t *rtp_packet_Flatten( block_t *out, size_t i_extra )
+{
+    block_t *payload = rtp_packet_payload( out );
+    size_t len = rtp_packet_size( out );
+
+    if( payload == NULL )
+    {
+        out = block_Realloc( out, 0, len + i_extra );
+        if( likely(out != NULL) )
+            out->i_buffer = len;
+        return out;
+    }
+
+    block_t *flat = block_Alloc( len + i_extra );
+    if( likely(flat != NULL) )
+    {
+        block_CopyProperties( flat, out );
+        memcpy( flat->p_buffer, out->p_buffer, out->i_buffer );
+        memcpy( flat->p_buffer + out->i_buffer, payload->p_buffer,
+                payload->i_buffer );
+        flat->i_buffer = len;
+    }
+    block_Release( out );
+    return flat;
+}
+#endif
+
+/*****************************************************************************
+ * Sender:
+ *****************************************************************************
+ * Packets of all the ES of all the RTP stream outputs in the process are sent
+ * by a few shared threads, rather than by one thread per ES. Each ES is bound
+ * to the least loaded sender; the sender sends the packets of its ES in order
+ * of send date (DTS + caching), and each ES at its own pace.
+ *****************************************************************************/
+#define RTP_SENDERS 4
+#define RTP_BATCH   32 /* max packets per system call */
+
+struct rtp_sender
+{
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait;  /* sender, waiting for packets or their date */
+    vlc_cond_t   idle;  /* detach, waiting for the ES packets to be sent */
+    int          i_es;
+    sout_stream_id_sys_t **es;
+    sout_stream_id_sys_t *busy; /* ES being sent, outside the lock */
+    bool         b_quit;
+};
+
+static vlc_mutex_t sender_lock = VLC_STATIC_MUTEX;
+static struct rtp_sender senders[RTP_SENDERS];
+
 #ifdef _WIN32
 # define ENOBUFS      WSAENOBUFS
 # define EAGAIN       WSAEWOULDBLOCK
 # define EWOULDBLOCK  WSAEWOULDBLOCK
 #endif
-    sout_stream_id_sys_t *id = data;
-    unsigned i_caching = id->i_caching;
 
-    for (;;)
+/* Sends packets to one sink, with as few system calls as possible.
+ * Returns false if the connection is broken. */
+static bool SendPackets( int fd, block_t *const *pktv, unsigned pktc )
+{
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgv[RTP_BATCH];
+#elif !defined (_WIN32)
+    struct msghdr msgv[RTP_BATCH];
+#endif
+#ifndef _WIN32
+    struct iovec iov[2 * RTP_BATCH];
+
+    assert( pktc <= RTP_BATCH );
+    memset( msgv, 0, sizeof(msgv[0]) * pktc );
+    for( unsigned i = 0; i < pktc; i++ )
     {
-        block_t *out = block_FifoGet( id->p_fifo );
-        block_cleanup_push (out);
+# ifdef HAVE_SENDMMSG
+        struct msghdr *msg = &msgv[i].msg_hdr;
+# else
+        struct msghdr *msg = &msgv[i];
+# endif
+        block_t *payload = rtp_packet_payload( pktv[i] );
+
+        /* header (or whole packet), then referenced payload if any */
+        iov[2 * i].iov_base = pktv[i]->p_buffer;
+        iov[2 * i].iov_len = pktv[i]->i_buffer;
+        msg->msg_iov = &iov[2 * i];
+        msg->msg_iovlen = 1;
+        if( payload != NULL )
+        {
+            iov[2 * i + 1].iov_base = payload->p_buffer;
+            iov[2 * i + 1].iov_len = payload->i_buffer;
+            msg->msg_iovlen = 2;
+        }
+    }
+#endif
+    bool b_retried = false;
+
+    for( unsigned i = 0; i < pktc; )
+    {
+#if defined (HAVE_SENDMMSG)
+        int val = sendmmsg( fd, msgv + i, pktc - i, 0 );
+#else
+# ifndef _WIN32
+        int val = sendmsg( fd, &msgv[i], 0 );
+# else
+        int val = send( fd, pktv[i]->p_buffer, pktv[i]->i_buffer, 0 );
+# endif
+        if( val != -1 )
+            val = 1;
+#endif
+        if( val > 0 )
+        {
+            i += val;
+            b_retried = false;
+            continue;
+        }
+
+        if( net_errno != EAGAIN && net_errno != EWOULDBLOCK
+         && net_errno != ENOBUFS && net_errno != ENOMEM )
+        {
+            int type;
+            getsockopt( fd, SOL_SOCKET, SO_TYPE,
+                        &type, &(socklen_t){ sizeof(type) });
+            if( type != SOCK_DGRAM )
+                return false; /* Broken connection */
+            if( !b_retried )
+            {   /* ICMP soft error: ignore and retry */
+                b_retried = true;
+                continue;
+            }
+        }
+        /* drop the packet */
+        i++;
+        b_retried = false;
+    }
+    return true;
+}
 
+static void SendBatch( sout_stream_id_sys_t *id, block_t **pktv, unsigned pktc )
+{
 #ifdef HAVE_SRTP
-        if( id->srtp )
+    if( id->srtp )
+    {
+        uint8_t *bufv[RTP_BATCH];
+        size_t lenv[RTP_BATCH], sizev[RTP_BATCH];
+        int errv[RTP_BATCH];
+        unsigned n = 0;
+
+        for( unsigned i = 0; i < pktc; i++ )
         {   /* FIXME: this is awfully inefficient */
-            size_t len = out->i_buffer;
-            out = block_Realloc( out, 0, len + 10 );
-            out->i_buffer = len;
+            block_t *out = rtp_packet_Flatten( pktv[i], 10 );
+            if( unlikely(out == NULL) )
+                continue;
+            bufv[n] = out->p_buffer;
+            lenv[n] = out->i_buffer;
+            sizev[n] = out->i_buffer + 10;
+            pktv[n++] = out;
+        }
 
-            int canc = vlc_savecancel ();
-            int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
-            vlc_restorecancel (canc);
-            if( val )
+        /* Encrypts the whole batch at once */
+        srtp_send_batch( id->srtp, bufv, lenv, sizev, errv, n );
+        pktc = 0;
+        for( unsigned i = 0; i < n; i++ )
+        {
+            if( errv[i] )
             {
                 msg_Dbg( id->p_stream, "SRTP sending error: %s",
-                         vlc_strerror_c(val) );
-                block_Release( out );
-                out = NULL;
+                         vlc_strerror_c(errv[i]) );
+                block_Release( pktv[i] );
+                continue;
             }
-            else
-                out->i_buffer = len;
+            pktv[i]->i_buffer = lenv[i];
+            pktv[pktc++] = pktv[i];
         }
-        if (out)
-            mwait (out->i_dts + i_caching);
-        vlc_cleanup_pop ();
-        if (out == NULL)
-            continue;
-#else
-        mwait (out->i_dts + i_caching);
-        vlc_cleanup_pop ();
+        if( pktc == 0 )
+            return;
+    }
 #endif
 
-        ssize_t len = out->i_buffer;
-        int canc = vlc_savecancel ();
-
-        vlc_mutex_lock( &id->lock_sink );
-        unsigned deadc = 0; /* How many dead sockets? */
-        int deadv[id->sinkc]; /* Dead sockets list */
+    vlc_mutex_lock( &id->lock_sink );
+    unsigned deadc = 0; /* How many dead sockets? */
+    int deadv[id->sinkc]; /* Dead sockets list */
 
-        for( int i = 0; i < id->sinkc; i++ )
-        {
+    for( int i = 0; i < id->sinkc; i++ )
+    {
 #ifdef HAVE_SRTP
-            if( !id->srtp ) /* FIXME: SRTCP support */
+        if( !id->srtp ) /* FIXME: SRTCP support */
 #endif
-                SendRTCP( id->sinkv[i].rtcp, out );
+            for( unsigned j = 0; j < pktc; j++ )
+                SendRTCP( id->sinkv[i].rtcp, pktv[j],
+                          rtp_packet_size( pktv[j] ) );
+
+        if( !SendPackets( id->sinkv[i].rtp_fd, pktv, pktc ) )
+            deadv[deadc++] = id->sinkv[i].rtp_fd;
+    }
+    id->i_seq_sent_next = ntohs(((uint16_t *) pktv[pktc - 1]->p_buffer)[1]) + 1;
+    vlc_mutex_unlock( &id->lock_sink );
+
+    for( unsigned i = 0; i < pktc; i++ )
+        block_Release( pktv[i] );
+
+    for( unsigned i = 0; i < deadc; i++ )
+    {
+        msg_Dbg( id->p_stream, "removing socket %d", deadv[i] );
+        rtp_del_sink( id, deadv[i] );
+    }
+}
+
+static void *ThreadSend( void *data )
+{
+    struct rtp_sender *sender = data;
 
-            if( send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 ) == -1
-             && net_errno != EAGAIN && net_errno != EWOULDBLOCK
-             && net_errno != ENOBUFS && net_errno != ENOMEM )
+    vlc_mutex_lock( &sender->lock );
+    for( ;; )
+    {
+        /* Find the ES with the earliest packet */
+        sout_stream_id_sys_t *id = NULL;
+        mtime_t i_date = 0;
+
+        for( int i = 0; i < sender->i_es; i++ )
+        {
+            sout_stream_id_sys_t *es = sender->es[i];
+            if( es->p_first == NULL )
+                continue;
+
+            mtime_t i_es_date = es->p_first->i_dts + es->i_caching;
+            if( id == NULL || i_es_date < i_date )
             {
-                int type;
-                getsockopt( id->sinkv[i].rtp_fd, SOL_SOCKET, SO_TYPE,
-                            &type, &(socklen_t){ sizeof(type) });
-                if( type == SOCK_DGRAM )
-                    /* ICMP soft error: ignore and retry */
-                    send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 );
-                else
-                    /* Broken connection */
-                    deadv[deadc++] = id->sinkv[i].rtp_fd;
+                id = es;
+                i_date = i_es_date;
             }
         }
-        id->i_seq_sent_next = ntohs(((uint16_t *) out->p_buffer)[1]) + 1;
-        vlc_mutex_unlock( &id->lock_sink );
-        block_Release( out );
 
-        for( unsigned i = 0; i < deadc; i++ )
+        if( sender->b_quit )
+            break;
+        if( id == NULL )
+        {
+            vlc_cond_wait( &sender->wait, &sender->lock );
+            continue;
+        }
+        if( i_date > mdate() )
+        {
+            vlc_cond_timedwait( &sender->wait, &sender->lock, i_date );
+            continue;
+        }
+
+        /* Take all the packets of that ES that are due */
+        block_t *pktv[RTP_BATCH];
+        unsigned pktc = 0;
+        mtime_t now = mdate();
+
+        while( pktc < RTP_BATCH && id->p_first != NULL
+            && id->p_first->i_dts + id->i_caching <= now )
         {
-            msg_Dbg( id->p_stream, "removing socket %d", deadv[i] );
-            rtp_del_sink( id, deadv[i] );
+            block_t *out = id->p_first;
+
+            id->p_first = out->p_next;
+            out->p_next = NULL;
+            pktv[pktc++] = out;
         }
-        vlc_restorecancel (canc);
+        if( id->p_first == NULL )
+            id->pp_last = &id->p_first;
+
+        sender->busy = id;
+        vlc_mutex_unlock( &sender->lock );
+
+        SendBatch( id, pktv, pktc );
+
+        vlc_mutex_lock( &sender->lock );
+        sender->busy = NULL;
+        vlc_cond_broadcast( &sender->idle );
     }
+    vlc_mutex_unlock( &sender->lock );
     return NULL;
 }
 
+/* Binds an ES to the least loaded sender, starting it if needed.
+ * id->sender is left NULL on error. */
+static void RtpSenderAttach( sout_stream_id_sys_t *id )
+{
+    struct rtp_sender *sender = &senders[0];
+
+    id->p_first = NULL;
+    id->pp_last = &id->p_first;
+
+    vlc_mutex_lock( &sender_lock );
+    for( unsigned i = 1; i < RTP_SENDERS; i++ )
+        if( senders[i].i_es < sender->i_es )
+            sender = &senders[i];
+
+    if( sender->i_es == 0 )
+    {
+        vlc_mutex_init( &sender->lock );
+        vlc_cond_init( &sender->wait );
+        vlc_cond_init( &sender->idle );
+        sender->es = NULL;
+        sender->busy = NULL;
+        sender->b_quit = false;
+
+        if( vlc_clone( &sender->thread, ThreadSend, sender,
+                       VLC_THREAD_PRIORITY_HIGHEST ) )
+        {
+            vlc_cond_destroy( &sender->idle );
+            vlc_cond_destroy( &sender->wait );
+            vlc_mutex_destroy( &sender->lock );
+            vlc_mutex_unlock( &sender_lock );
+            return;
+        }
+    }
+
+    vlc_mutex_lock( &sender->lock );
+    TAB_APPEND( sender->i_es, sender->es, id );
+    vlc_mutex_unlock( &sender->lock );
+    id->sender = sender;
+    vlc_mutex_unlock( &sender_lock );
+}
+
+/* Unbinds an ES from its sender, dropping its pending packets, and stops the
+ * sender if it was the last ES. */
+static void RtpSenderDetach( sout_stream_id_sys_t *id )
+{
+    struct rtp_sender *sender = id->sender;
+
+    vlc_mutex_lock( &sender_lock );
+    vlc_mutex_lock( &sender->lock );
+    TAB_REMOVE( sender->i_es, sender->es, id );
+    while( sender->busy == id )
+        vlc_cond_wait( &sender->idle, &sender->lock );
+    bool b_last = sender->i_es == 0;
+    if( b_last )
+    {
+        sender->b_quit = true;
+        vlc_cond_signal( &sender->wait );
+    }
+    vlc_mutex_unlock( &sender->lock );
+
+    if( b_last )
+    {
+        vlc_join( sender->thread, NULL );
+        vlc_cond_destroy( &sender->idle );
+        vlc_cond_destroy( &sender->wait );
+        vlc_mutex_destroy( &sender->lock );
+    }
+    vlc_mutex_unlock( &sender_lock );
+
+    block_ChainRelease( id->p_first );
+    id->sender = NULL;
+}
 
 /* This thread dequeues incoming connections (DCCP streaming) */
 static void *rtp_listen_thread( void *data )
@@ -1654,7 +1982,16 @@ void rtp_packetize_common( sout_stream_id_sys_t *id, block_t *out,
 
 void rtp_packetize_send( sout_stream_id_sys_t *id, block_t *out )
 {
-    block_FifoPut( id->p_fifo, out );
+    struct rtp_sender *sender = id->sender;
+
+    out->p_next = NULL;
+    vlc_mutex_lock( &sender->lock );
+    *id->pp_last = out;
+    id->pp_last = &out->p_next;
+    /* a new head may be due before the one the sender is waiting for */
+    if( id->p_first == out )
+        vlc_cond_signal( &sender->wait );
+    vlc_mutex_unlock( &sender->lock );
 }
 
 /**
@@ -57,6 +57,10 @@ int64_t rtp_get_ts( const sout_stream_t *p_stream, const sout_stream_id_sys_t *i
 void rtp_packetize_common (sout_stream_id_sys_t *id, block_t *out,
                            int b_marker, int64_t i_pts);
 void rtp_packetize_send (sout_stream_id_sys_t *id, block_t *out);
+/* Max RTP and payload headers in front of a referenced payload */
+#define RTP_HEADROOM 32
+block_t *rtp_packet_New (block_t *frame, size_t i_header,
+                         const uint8_t *p_data, size_t i_data);
 size_t rtp_mtu (const sout_stream_id_sys_t *id);
 
 int rtp_packetize_xiph_config( sout_stream_id_sys_t *id, const char *fmtp,
@@ -67,7 +71,7 @@ typedef struct rtcp_sender_t rtcp_sender_t;
 rtcp_sender_t *OpenRTCP (vlc_object_t *obj, int rtp_fd, int proto,
                          bool mux);
 void CloseRTCP (rtcp_sender_t *rtcp);
-void SendRTCP (rtcp_sender_t *restrict rtcp, const block_t *rtp);
+void SendRTCP (rtcp_sender_t *restrict rtcp, const block_t *rtp, size_t len);
 
 typedef int (*pf_rtp_packetizer_t)( sout_stream_id_sys_t *, block_t * );
 
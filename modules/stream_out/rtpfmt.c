@@ -542,7 +542,7 @@ int rtp_get_fmt( vlc_object_t *obj, es_format_t *p_fmt, const char *mux,
 
 
 static int
-rtp_packetize_h264_nal( sout_stream_id_sys_t *id,
+rtp_packetize_h264_nal( sout_stream_id_sys_t *id, block_t *in,
                         const uint8_t *p_data, int i_data, int64_t i_pts,
                         int64_t i_dts, bool b_last, int64_t i_length );
 
@@ -873,6 +873,8 @@ static int rtp_packetize_split( sout_stream_id_sys_t *id, block_t *in )
     int     i_max   = rtp_mtu (id); /* payload max in one packet */
     int     i_count = ( in->i_buffer + i_max - 1 ) / i_max;
 
+    in = block_Share( in ); /* packets reference their payload */
+
     uint8_t *p_data = in->p_buffer;
     int     i_data  = in->i_buffer;
     int     i;
@@ -880,12 +882,13 @@ static int rtp_packetize_split( sout_stream_id_sys_t *id, block_t *in )
     for( i = 0; i < i_count; i++ )
     {
         int           i_payload = __MIN( i_max, i_data );
-        block_t *out = block_Alloc( 12 + i_payload );
+        block_t *out = rtp_packet_New( in, 12, p_data, i_payload );
+        if( unlikely(out == NULL) )
+            break;
 
         /* rtp common header */
         rtp_packetize_common( id, out, (i == i_count - 1),
                       (in->i_pts > VLC_TS_INVALID ? in->i_pts : in->i_dts) );
-        memcpy( &out->p_buffer[12], p_data, i_payload );
 
         out->i_dts    = in->i_dts + i * in->i_length / i_count;
         out->i_length = in->i_length / i_count;
@@ -904,12 +907,15 @@ static int rtp_packetize_pcm(sout_stream_id_sys_t *id, block_t *in)
 {
     unsigned max = rtp_mtu(id);
 
+    if (in->i_buffer > max)
+        in = block_Share(in); /* packets reference their payload */
+
     while (in->i_buffer > max)
     {
         unsigned duration = (in->i_length * max) / in->i_buffer;
         bool marker = (in->i_flags & BLOCK_FLAG_DISCONTINUITY) != 0;
 
-        block_t *out = block_Alloc(12 + max);
+        block_t *out = rtp_packet_New(in, 12, in->p_buffer, max);
         if (unlikely(out == NULL))
         {
             block_Release(in);
@@ -917,7 +923,6 @@ static int rtp_packetize_pcm(sout_stream_id_sys_t *id, block_t *in)
         }
 
         rtp_packetize_common(id, out, marker, in->i_pts);
-        memcpy(out->p_buffer + 12, in->p_buffer, max);
         rtp_packetize_send(id, out);
 
         in->p_buffer += max;
@@ -1021,6 +1026,8 @@ static int rtp_packetize_mp4a( sout_stream_id_sys_t *id, block_t *in )
     int     i_max   = rtp_mtu (id) - 4; /* payload max in one packet */
     int     i_count = ( in->i_buffer + i_max - 1 ) / i_max;
 
+    in = block_Share( in ); /* packets reference their payload */
+
     uint8_t *p_data = in->p_buffer;
     int     i_data  = in->i_buffer;
     int     i;
@@ -1028,7 +1035,9 @@ static int rtp_packetize_mp4a( sout_stream_id_sys_t *id, block_t *in )
     for( i = 0; i < i_count; i++ )
     {
         int           i_payload = __MIN( i_max, i_data );
-        block_t *out = block_Alloc( 16 + i_payload );
+        block_t *out = rtp_packet_New( in, 16, p_data, i_payload );
+        if( unlikely(out == NULL) )
+            break;
 
         /* rtp common header */
         rtp_packetize_common( id, out, ((i == i_count - 1)?1:0),
@@ -1040,8 +1049,6 @@ static int rtp_packetize_mp4a( sout_stream_id_sys_t *id, block_t *in )
         /* for each AU length 13 bits + idx 3bits, */
         SetWBE( out->p_buffer + 14, (in->i_buffer << 3) | 0 );
 
-        memcpy( &out->p_buffer[16], p_data, i_payload );
-
         out->i_dts    = in->i_dts + i * in->i_length / i_count;
         out->i_length = in->i_length / i_count;
 
@@ -1121,7 +1128,7 @@ static int rtp_packetize_h263( sout_stream_id_sys_t *id, block_t *in )
 
 /* rfc3984 */
 static int
-rtp_packetize_h264_nal( sout_stream_id_sys_t *id,
+rtp_packetize_h264_nal( sout_stream_id_sys_t *id, block_t *in,
                         const uint8_t *p_data, int i_data, int64_t i_pts,
                         int64_t i_dts, bool b_last, int64_t i_length )
 {
@@ -1143,15 +1150,15 @@ rtp_packetize_h264_nal( sout_stream_id_sys_t *id,
     if( i_data <= i_max )
     {
         /* Single NAL unit packet */
-        block_t *out = block_Alloc( 12 + i_data );
+        block_t *out = rtp_packet_New( in, 12, p_data, i_data );
+        if( unlikely(out == NULL) )
+            return VLC_ENOMEM;
         out->i_dts    = i_dts;
         out->i_length = i_length;
 
         /* */
         rtp_packetize_common( id, out, b_last, i_pts );
 
-        memcpy( &out->p_buffer[12], p_data, i_data );
-
         rtp_packetize_send( id, out );
     }
     else
@@ -1166,7 +1173,9 @@ rtp_packetize_h264_nal( sout_stream_id_sys_t *id,
         for( i = 0; i < i_count; i++ )
         {
             const int i_payload = __MIN( i_data, i_max-2 );
-            block_t *out = block_Alloc( 12 + 2 + i_payload );
+            block_t *out = rtp_packet_New( in, 12 + 2, p_data, i_payload );
+            if( unlikely(out == NULL) )
+                return VLC_ENOMEM;
             out->i_dts    = i_dts + i * i_length / i_count;
             out->i_length = i_length / i_count;
 
@@ -1177,7 +1186,6 @@ rtp_packetize_h264_nal( sout_stream_id_sys_t *id,
             out->p_buffer[12] = 0x00 | (i_nal_hdr & 0x60) | 28;
             /* FU header */
             out->p_buffer[13] = ( i == 0 ? 0x80 : 0x00 ) | ( (i == i_count-1) ? 0x40 : 0x00 )  | i_nal_type;
-            memcpy( &out->p_buffer[14], p_data, i_payload );
 
             rtp_packetize_send( id, out );
 
@@ -1190,6 +1198,8 @@ rtp_packetize_h264_nal( sout_stream_id_sys_t *id,
 
 static int rtp_packetize_h264( sout_stream_id_sys_t *id, block_t *in )
 {
+    in = block_Share( in ); /* packets reference their payload */
+
     const uint8_t *p_buffer = in->p_buffer;
     int i_buffer = in->i_buffer;
 
@@ -1218,7 +1228,7 @@ static int rtp_packetize_h264( sout_stream_id_sys_t *id, block_t *in )
             }
         }
         /* TODO add STAP-A to remove a lot of overhead with small slice/sei/... */
-        rtp_packetize_h264_nal( id, p_buffer, i_size,
+        rtp_packetize_h264_nal( id, in, p_buffer, i_size,
                 (in->i_pts > VLC_TS_INVALID ? in->i_pts : in->i_dts), in->i_dts,
                 (i_size >= i_buffer), in->i_length * i_size / in->i_buffer );
 
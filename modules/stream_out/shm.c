@@ -0,0 +1,315 @@
+/*****************************************************************************
+ * shm.c: stream output to a shared memory ring
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Publishes the decoded pictures and audio samples to other processes of the
+ * host, through a ring of frames in a memory mapped file (see
+ * vlc_shm_ring.h). The readers, e.g. libvlc_shm_reader_open(), poll the ring
+ * on their own and never slow down the stream output: a reader too slow to
+ * keep up loses the frames it was lapped on. For example:
+ * --sout="#transcode{vcodec=I420,acodec=s16l}:shm{file=/dev/shm/vlc}"
+ * The counterpart of the shm access, which reads a frame buffer.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_sout.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_shm_ring.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+#define FILE_TEXT N_("Shared memory file")
+#define FILE_LONGTEXT N_("Path of the file mapped by the readers, " \
+    "preferably on a memory file system such as /dev/shm.")
+
+#define SLOTS_TEXT N_("Frames")
+#define SLOTS_LONGTEXT N_("Number of frames kept in the ring for the " \
+    "readers to catch up.")
+
+#define SLOT_SIZE_TEXT N_("Frame size (KiB)")
+#define SLOT_SIZE_LONGTEXT N_("Largest frame, in kibibytes. Larger frames " \
+    "are dropped. A 1080p I420 picture takes 3038 KiB.")
+
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+#define SOUT_CFG_PREFIX "sout-shm-"
+
+vlc_module_begin ()
+    set_shortname( N_("Shared memory") )
+    set_description( N_("Shared memory stream output") )
+    set_capability( "sout stream", 0 )
+    add_shortcut( "shm" )
+    set_category( CAT_SOUT )
+    set_subcategory( SUBCAT_SOUT_STREAM )
+    add_string( SOUT_CFG_PREFIX "file", NULL, FILE_TEXT, FILE_LONGTEXT,
+                false )
+    add_integer_with_range( SOUT_CFG_PREFIX "frames", 16, 2, 1024,
+                            SLOTS_TEXT, SLOTS_LONGTEXT, true )
+    add_integer_with_range( SOUT_CFG_PREFIX "frame-size", 8192, 4, 262144,
+                            SLOT_SIZE_TEXT, SLOT_SIZE_LONGTEXT, true )
+    set_callbacks( Open, Close )
+vlc_module_end ()
+
+static const char *const ppsz_sout_options[] = {
+    "file", "frames", "frame-size", NULL
+};
+
+struct sout_stream_id_sys_t
+{
+    es_format_t fmt;
+};
+
+struct sout_stream_sys_t
+{
+    vlc_mutex_t        lock; /* single writer */
+    char              *psz_path;
+    shm_ring_header_t *p_ring;
+    size_t             i_length; /* of the mapping */
+    size_t             i_payload_max;
+    uint32_t           i_next_id;
+    bool               b_oversize_warned;
+};
+
+/* Writes a frame to the next slot */
+static void Write( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                   const block_t *p_block )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    shm_ring_header_t *p_ring = p_sys->p_ring;
+
+    if( p_block->i_buffer > p_sys->i_payload_max )
+    {
+        if( !p_sys->b_oversize_warned )
+            msg_Warn( p_stream, "dropping %zu bytes frame (%zu bytes at most)",
+                      p_block->i_buffer, p_sys->i_payload_max );
+        p_sys->b_oversize_warned = true;
+        return;
+    }
+
+    const uint64_t i_frame = atomic_load_explicit( &p_ring->written,
+                                                   memory_order_relaxed );
+    shm_ring_slot_t *p_slot = shm_ring_Slot( p_ring, i_frame );
+
+    /* Readers of the previous frame of this slot will see it torn */
+    atomic_store_explicit( &p_slot->seq, 2 * i_frame + 1,
+                           memory_order_relaxed );
+    atomic_thread_fence( memory_order_release );
+
+    const es_format_t *p_fmt = &id->fmt;
+    p_slot->es_id = p_fmt->i_id;
+    p_slot->cat = p_fmt->i_cat;
+    p_slot->codec = p_fmt->i_codec;
+    p_slot->flags = p_block->i_flags;
+    p_slot->pts = p_block->i_pts;
+    p_slot->dts = p_block->i_dts;
+    p_slot->length = p_block->i_length;
+    if( p_fmt->i_cat == VIDEO_ES )
+    {
+        p_slot->video.width = p_fmt->video.i_width;
+        p_slot->video.height = p_fmt->video.i_height;
+        p_slot->video.visible_width = p_fmt->video.i_visible_width;
+        p_slot->video.visible_height = p_fmt->video.i_visible_height;
+        p_slot->video.frame_rate = p_fmt->video.i_frame_rate;
+        p_slot->video.frame_rate_base = p_fmt->video.i_frame_rate_base;
+    }
+    else
+    {
+        p_slot->audio.rate = p_fmt->audio.i_rate;
+        p_slot->audio.channels = p_fmt->audio.i_channels;
+        p_slot->audio.bits_per_sample = p_fmt->audio.i_bitspersample;
+    }
+    p_slot->size = p_block->i_buffer;
+    memcpy( shm_ring_Payload( p_slot ), p_block->p_buffer,
+            p_block->i_buffer );
+
+    atomic_store_explicit( &p_slot->seq, 2 * i_frame + 2,
+                           memory_order_release );
+    atomic_store_explicit( &p_ring->written, i_frame + 1,
+                           memory_order_release );
+}
+
+static sout_stream_id_sys_t *Add( sout_stream_t *p_stream, es_format_t *p_fmt )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    if( p_fmt->i_cat != VIDEO_ES && p_fmt->i_cat != AUDIO_ES )
+        return NULL;
+
+    sout_stream_id_sys_t *id = malloc( sizeof( *id ) );
+    if( unlikely(id == NULL) )
+        return NULL;
+    es_format_Copy( &id->fmt, p_fmt );
+
+    /* The ES identifier may be unset, e.g. behind transcode */
+    vlc_mutex_lock( &p_sys->lock );
+    if( id->fmt.i_id <= 0 )
+        id->fmt.i_id = ++p_sys->i_next_id;
+    vlc_mutex_unlock( &p_sys->lock );
+
+    msg_Dbg( p_stream, "publishing ES %d (%4.4s)", id->fmt.i_id,
+             (const char *)&id->fmt.i_codec );
+    return id;
+}
+
+static int Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    VLC_UNUSED( p_stream );
+    es_format_Clean( &id->fmt );
+    free( id );
+    return VLC_SUCCESS;
+}
+
+static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                 block_t *p_chain )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    for( block_t *p_block = p_chain; p_block != NULL; p_block = p_block->p_next )
+        Write( p_stream, id, p_block );
+    vlc_mutex_unlock( &p_sys->lock );
+
+    block_ChainRelease( p_chain );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Open:
+ *****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    sout_stream_t *p_stream = (sout_stream_t *)p_this;
+
+    config_ChainParse( p_stream, SOUT_CFG_PREFIX, ppsz_sout_options,
+                       p_stream->p_cfg );
+
+    char *psz_path = var_GetNonEmptyString( p_stream, SOUT_CFG_PREFIX "file" );
+    if( psz_path == NULL )
+    {
+        msg_Err( p_stream, "no shared memory file specified" );
+        return VLC_EGENERIC;
+    }
+
+    sout_stream_sys_t *p_sys = malloc( sizeof( *p_sys ) );
+    if( unlikely(p_sys == NULL) )
+    {
+        free( psz_path );
+        return VLC_ENOMEM;
+    }
+
+    const unsigned i_slots = var_GetInteger( p_stream, SOUT_CFG_PREFIX "frames" );
+    p_sys->i_payload_max = var_GetInteger( p_stream,
+                                           SOUT_CFG_PREFIX "frame-size" ) * 1024;
+    const size_t i_slot_size = shm_ring_PayloadOffset() + p_sys->i_payload_max;
+    p_sys->i_length = shm_ring_HeaderSize() + i_slots * i_slot_size;
+
+    /* A new file rather than the old one truncated: the readers still
+     * mapping the old one see it closed and are not fed garbage */
+    vlc_unlink( psz_path );
+    int fd = vlc_open( psz_path, O_RDWR | O_CREAT | O_EXCL, 0644 );
+    if( fd == -1 )
+    {
+        msg_Err( p_stream, "cannot create %s: %s", psz_path,
+                 vlc_strerror_c(errno) );
+        goto error;
+    }
+    if( ftruncate( fd, p_sys->i_length ) )
+    {
+        msg_Err( p_stream, "cannot allocate %zu bytes in %s: %s",
+                 p_sys->i_length, psz_path, vlc_strerror_c(errno) );
+        close( fd );
+        vlc_unlink( psz_path );
+        goto error;
+    }
+
+    void *p_map = mmap( NULL, p_sys->i_length, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0 );
+    close( fd );
+    if( p_map == MAP_FAILED )
+    {
+        msg_Err( p_stream, "cannot map %s: %s", psz_path,
+                 vlc_strerror_c(errno) );
+        vlc_unlink( psz_path );
+        goto error;
+    }
+
+    /* The file is zeroed: all the slots are free, no frame is written.
+     * The magic goes last, for readers to not attach to a partial header. */
+    shm_ring_header_t *p_ring = p_map;
+    p_ring->version = SHM_RING_VERSION;
+    p_ring->slot_count = i_slots;
+    p_ring->slot_size = i_slot_size;
+    atomic_init( &p_ring->written, 0 );
+    atomic_init( &p_ring->state, SHM_RING_LIVE );
+    atomic_thread_fence( memory_order_release );
+    memcpy( p_ring->magic, SHM_RING_MAGIC, sizeof( SHM_RING_MAGIC ) );
+
+    vlc_mutex_init( &p_sys->lock );
+    p_sys->psz_path = psz_path;
+    p_sys->p_ring = p_ring;
+    p_sys->i_next_id = 0;
+    p_sys->b_oversize_warned = false;
+
+    msg_Dbg( p_stream, "publishing to %s: %u frames of %zu bytes at most",
+             psz_path, i_slots, p_sys->i_payload_max );
+
+    p_stream->pf_add  = Add;
+    p_stream->pf_del  = Del;
+    p_stream->pf_send = Send;
+    p_stream->p_sys   = p_sys;
+    p_stream->pace_nocontrol = true;
+    return VLC_SUCCESS;
+
+error:
+    free( psz_path );
+    free( p_sys );
+    return VLC_EGENERIC;
+}
+
+/*****************************************************************************
+ * Close:
+ *****************************************************************************/
+static void Close( vlc_object_t *p_this )
+{
+    sout_stream_t *p_stream = (sout_stream_t *)p_this;
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    /* The readers still attached keep the mapping of the file */
+    atomic_store( &p_sys->p_ring->state, SHM_RING_CLOSED );
+    munmap( p_sys->p_ring, p_sys->i_length );
+    vlc_unlink( p_sys->psz_path );
+
+    vlc_mutex_destroy( &p_sys->lock );
+    free( p_sys->psz_path );
+    free( p_sys );
+}
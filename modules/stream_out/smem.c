@@ -37,6 +37,12 @@
  *
  * the video-data and audio-data pointers will be passed to lock/unlock function
  *
+ * Alternatively, the render callbacks (audio and video) are given the data of
+ * the block directly, without copy, with a release function and its handle.
+ * The data belongs to the application until it calls the release function,
+ * from any thread. Once max-pending blocks are held by the application, the
+ * stream output waits for one of them to be released.
+ *
  ******************************************************************************/
 
 /*****************************************************************************
@@ -74,6 +80,20 @@
 #define LT_AUDIO_POSTRENDER_CALLBACK N_( "Address of the audio postrender callback function. " \
                                         "This function will be called when the render is into the buffer." )
 
+#define T_VIDEO_RENDER_CALLBACK N_( "Video render callback" )
+#define LT_VIDEO_RENDER_CALLBACK N_( "Address of the video render callback function. " \
+                                     "This function will be given the buffers without copy, " \
+                                     "instead of the prerender and postrender callbacks." )
+
+#define T_AUDIO_RENDER_CALLBACK N_( "Audio render callback" )
+#define LT_AUDIO_RENDER_CALLBACK N_( "Address of the audio render callback function. " \
+                                     "This function will be given the buffers without copy, " \
+                                     "instead of the prerender and postrender callbacks." )
+
+#define T_MAX_PENDING N_( "Maximum pending buffers" )
+#define LT_MAX_PENDING N_( "Number of buffers given to a render callback that can be " \
+                           "held by the application before the stream output waits (0 = no limit)." )
+
 #define T_VIDEO_DATA N_( "Video Callback data" )
 #define LT_VIDEO_DATA N_( "Data for the video callback function." )
 
@@ -107,6 +127,12 @@ vlc_module_begin ()
         change_volatile()
     add_string( SOUT_PREFIX_AUDIO "postrender-callback", "0", T_AUDIO_POSTRENDER_CALLBACK, LT_AUDIO_POSTRENDER_CALLBACK, true )
         change_volatile()
+    add_string( SOUT_PREFIX_VIDEO "render-callback", "0", T_VIDEO_RENDER_CALLBACK, LT_VIDEO_RENDER_CALLBACK, true )
+        change_volatile()
+    add_string( SOUT_PREFIX_AUDIO "render-callback", "0", T_AUDIO_RENDER_CALLBACK, LT_AUDIO_RENDER_CALLBACK, true )
+        change_volatile()
+    add_integer( SOUT_CFG_PREFIX "max-pending", 8, T_MAX_PENDING, LT_MAX_PENDING, true )
+        change_volatile()
     add_string( SOUT_PREFIX_VIDEO "data", "0", T_VIDEO_DATA, LT_VIDEO_DATA, true )
         change_volatile()
     add_string( SOUT_PREFIX_AUDIO "data", "0", T_AUDIO_DATA, LT_VIDEO_DATA, true )
@@ -122,7 +148,9 @@ vlc_module_end ()
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
     "video-prerender-callback", "audio-prerender-callback",
-    "video-postrender-callback", "audio-postrender-callback", "video-data", "audio-data", "time-sync", NULL
+    "video-postrender-callback", "audio-postrender-callback",
+    "video-render-callback", "audio-render-callback", "max-pending",
+    "video-data", "audio-data", "time-sync", NULL
 };
 
 static sout_stream_id_sys_t *Add ( sout_stream_t *, es_format_t * );
@@ -136,11 +164,31 @@ static int SendVideo( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                       block_t *p_buffer );
 static int SendAudio( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                       block_t *p_buffer );
+static int SendRender( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                       block_t *p_buffer );
+
+/* Counts the blocks held by the application, for one ES */
+typedef struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    unsigned    i_pending; /* blocks not released by the application yet */
+    unsigned    i_max; /* pending blocks limit, or 0 */
+    bool        b_alive; /* whether the ES still exists */
+} smem_tracker_t;
+
+/* Handle given to the application with a block */
+typedef struct
+{
+    block_t        *p_block;
+    smem_tracker_t *p_tracker;
+} smem_handle_t;
 
 struct sout_stream_id_sys_t
 {
     es_format_t* format;
     void *p_data;
+    smem_tracker_t *p_tracker; /* render callbacks only */
 };
 
 struct sout_stream_sys_t
@@ -150,6 +198,9 @@ struct sout_stream_sys_t
     void ( *pf_audio_prerender_callback ) ( void* p_audio_data, uint8_t** pp_pcm_buffer, size_t size );
     void ( *pf_video_postrender_callback ) ( void* p_video_data, uint8_t* p_pixel_buffer, int width, int height, int pixel_pitch, size_t size, mtime_t pts );
     void ( *pf_audio_postrender_callback ) ( void* p_audio_data, uint8_t* p_pcm_buffer, unsigned int channels, unsigned int rate, unsigned int nb_samples, unsigned int bits_per_sample, size_t size, mtime_t pts );
+    void ( *pf_video_render_callback ) ( void* p_video_data, const uint8_t* p_pixel_buffer, int width, int height, int pixel_pitch, size_t size, mtime_t pts, void ( *pf_release ) ( void* ), void* p_handle );
+    void ( *pf_audio_render_callback ) ( void* p_audio_data, const uint8_t* p_pcm_buffer, unsigned int channels, unsigned int rate, unsigned int nb_samples, unsigned int bits_per_sample, size_t size, mtime_t pts, void ( *pf_release ) ( void* ), void* p_handle );
+    unsigned i_max_pending;
     bool time_sync;
 };
 
@@ -188,6 +239,16 @@ static int Open( vlc_object_t *p_this )
     p_sys->pf_audio_postrender_callback = (void (*) (void*, uint8_t*, unsigned int, unsigned int, unsigned int, unsigned int, size_t, mtime_t))(intptr_t)atoll( psz_tmp );
     free( psz_tmp );
 
+    psz_tmp = var_GetString( p_stream, SOUT_PREFIX_VIDEO "render-callback" );
+    p_sys->pf_video_render_callback = (void (*) (void*, const uint8_t*, int, int, int, size_t, mtime_t, void (*) (void*), void*))(intptr_t)atoll( psz_tmp );
+    free( psz_tmp );
+
+    psz_tmp = var_GetString( p_stream, SOUT_PREFIX_AUDIO "render-callback" );
+    p_sys->pf_audio_render_callback = (void (*) (void*, const uint8_t*, unsigned int, unsigned int, unsigned int, unsigned int, size_t, mtime_t, void (*) (void*), void*))(intptr_t)atoll( psz_tmp );
+    free( psz_tmp );
+
+    p_sys->i_max_pending = var_GetInteger( p_stream, SOUT_CFG_PREFIX "max-pending" );
+
     /* Setting stream out module callbacks */
     p_stream->pf_add    = Add;
     p_stream->pf_del    = Del;
@@ -206,14 +267,98 @@ static void Close( vlc_object_t * p_this )
     free( p_stream->p_sys );
 }
 
+static smem_tracker_t *TrackerNew( unsigned i_max )
+{
+    smem_tracker_t *p_tracker = malloc( sizeof( *p_tracker ) );
+    if( !p_tracker )
+        return NULL;
+
+    vlc_mutex_init( &p_tracker->lock );
+    vlc_cond_init( &p_tracker->wait );
+    p_tracker->i_pending = 0;
+    p_tracker->i_max = i_max;
+    p_tracker->b_alive = true;
+    return p_tracker;
+}
+
+static void TrackerDelete( smem_tracker_t *p_tracker )
+{
+    vlc_cond_destroy( &p_tracker->wait );
+    vlc_mutex_destroy( &p_tracker->lock );
+    free( p_tracker );
+}
+
+/* Releases a block given to a render callback (from any thread) */
+static void ReleaseHandle( void *p_opaque )
+{
+    smem_handle_t *p_handle = p_opaque;
+    smem_tracker_t *p_tracker = p_handle->p_tracker;
+    bool b_last;
+
+    block_Release( p_handle->p_block );
+    free( p_handle );
+
+    vlc_mutex_lock( &p_tracker->lock );
+    p_tracker->i_pending--;
+    vlc_cond_signal( &p_tracker->wait );
+    b_last = !p_tracker->b_alive && p_tracker->i_pending == 0;
+    vlc_mutex_unlock( &p_tracker->lock );
+
+    if( b_last )
+        TrackerDelete( p_tracker );
+}
+
+static void TrackerCleanup( void *p_opaque )
+{
+    smem_handle_t *p_handle = p_opaque;
+
+    vlc_mutex_unlock( &p_handle->p_tracker->lock );
+    block_ChainRelease( p_handle->p_block );
+    free( p_handle );
+}
+
+/* Back-pressure: waits for the application to release blocks if it holds
+ * too many, and accounts for a new one */
+static void TrackerAcquire( smem_handle_t *p_handle )
+{
+    smem_tracker_t *p_tracker = p_handle->p_tracker;
+
+    vlc_mutex_lock( &p_tracker->lock );
+    vlc_cleanup_push( TrackerCleanup, p_handle );
+    while ( p_tracker->i_max != 0
+         && p_tracker->i_pending >= p_tracker->i_max )
+        vlc_cond_wait( &p_tracker->wait, &p_tracker->lock );
+    vlc_cleanup_pop();
+    p_tracker->i_pending++;
+    vlc_mutex_unlock( &p_tracker->lock );
+}
+
 static sout_stream_id_sys_t *Add( sout_stream_t *p_stream, es_format_t *p_fmt )
 {
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
     sout_stream_id_sys_t *id = NULL;
+    bool b_render = false;
 
     if ( p_fmt->i_cat == VIDEO_ES )
+    {
         id = AddVideo( p_stream, p_fmt );
+        b_render = p_sys->pf_video_render_callback != NULL;
+    }
     else if ( p_fmt->i_cat == AUDIO_ES )
+    {
         id = AddAudio( p_stream, p_fmt );
+        b_render = p_sys->pf_audio_render_callback != NULL;
+    }
+
+    if ( id != NULL && b_render )
+    {
+        id->p_tracker = TrackerNew( p_sys->i_max_pending );
+        if ( id->p_tracker == NULL )
+        {
+            free( id );
+            return NULL;
+        }
+    }
     return id;
 }
 
@@ -294,6 +439,20 @@ static sout_stream_id_sys_t *AddAudio( sout_stream_t *p_stream, es_format_t *p_f
 static int Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
 {
     VLC_UNUSED( p_stream );
+
+    smem_tracker_t *p_tracker = id->p_tracker;
+    if ( p_tracker != NULL )
+    {   /* The application may still hold blocks */
+        bool b_last;
+
+        vlc_mutex_lock( &p_tracker->lock );
+        p_tracker->b_alive = false;
+        b_last = p_tracker->i_pending == 0;
+        vlc_mutex_unlock( &p_tracker->lock );
+
+        if ( b_last )
+            TrackerDelete( p_tracker );
+    }
     free( id );
     return VLC_SUCCESS;
 }
@@ -301,6 +460,8 @@ static int Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
 static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                  block_t *p_buffer )
 {
+    if ( id->p_tracker != NULL )
+        return SendRender( p_stream, id, p_buffer );
     if ( id->format->i_cat == VIDEO_ES )
         return SendVideo( p_stream, id, p_buffer );
     else if ( id->format->i_cat == AUDIO_ES )
@@ -371,3 +532,53 @@ static int SendAudio( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
     return VLC_SUCCESS;
 }
 
+
+static int SendRender( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                       block_t *p_buffer )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    smem_tracker_t *p_tracker = id->p_tracker;
+    const es_format_t *p_fmt = id->format;
+
+    if ( p_fmt->i_cat == AUDIO_ES && p_fmt->audio.i_channels <= 0 )
+    {
+        msg_Warn( p_stream, "No channels!" );
+        block_ChainRelease( p_buffer );
+        return VLC_EGENERIC;
+    }
+
+    while ( p_buffer != NULL )
+    {
+        smem_handle_t *p_handle = malloc( sizeof( *p_handle ) );
+        if ( unlikely(p_handle == NULL) )
+        {
+            block_ChainRelease( p_buffer );
+            return VLC_ENOMEM;
+        }
+        p_handle->p_block = p_buffer;
+        p_handle->p_tracker = p_tracker;
+        TrackerAcquire( p_handle );
+
+        block_t *p_next = p_buffer->p_next;
+        p_buffer->p_next = NULL;
+
+        if ( p_fmt->i_cat == VIDEO_ES )
+            p_sys->pf_video_render_callback( id->p_data, p_buffer->p_buffer,
+                                             p_fmt->video.i_width, p_fmt->video.i_height,
+                                             p_fmt->video.i_bits_per_pixel, p_buffer->i_buffer,
+                                             p_buffer->i_pts, ReleaseHandle, p_handle );
+        else
+        {
+            unsigned i_samples = p_buffer->i_buffer
+                / ( ( p_fmt->audio.i_bitspersample / 8 ) * p_fmt->audio.i_channels );
+
+            p_sys->pf_audio_render_callback( id->p_data, p_buffer->p_buffer,
+                                             p_fmt->audio.i_channels, p_fmt->audio.i_rate,
+                                             i_samples, p_fmt->audio.i_bitspersample,
+                                             p_buffer->i_buffer, p_buffer->i_pts,
+                                             ReleaseHandle, p_handle );
+        }
+        p_buffer = p_next;
+    }
+    return VLC_SUCCESS;
+}
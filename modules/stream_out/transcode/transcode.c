@@ -80,6 +80,13 @@
 #define VFILTER_LONGTEXT N_( \
     "Video filters will be applied to the video streams (after overlays " \
     "are applied). You can enter a colon-separated list of filters." )
+#define RENDITIONS_TEXT N_("Video renditions")
+#define RENDITIONS_LONGTEXT N_( \
+    "Additional encodings of the video, sharing its decoder and filters, " \
+    "as a comma-separated list of WIDTHxHEIGHT@BITRATE (eg: " \
+    "1280x720@3000,0x360@800). A 0 dimension keeps the aspect ratio and " \
+    "a missing bitrate uses the main one. The n-th rendition is output as " \
+    "an extra stream whose ID is the source ID plus 1000 * n." )
 
 #define AENC_TEXT N_("Audio encoder")
 #define AENC_LONGTEXT N_( \
@@ -126,11 +133,12 @@
 
 #define THREADS_TEXT N_("Number of threads")
 #define THREADS_LONGTEXT N_( \
-    "Number of threads used for the transcoding." )
+    "Number of threads used for the transcoding. When not zero, the video " \
+    "is also filtered, scaled and encoded in separate threads." )
 #define HP_TEXT N_("High priority")
 #define HP_LONGTEXT N_( \
-    "Runs the optional encoder thread at the OUTPUT priority instead of " \
-    "VIDEO." )
+    "Runs the optional video filtering, scaling and encoding threads at " \
+    "the OUTPUT priority instead of VIDEO." )
 
 
 static const char *const ppsz_deinterlace_type[] =
@@ -179,6 +187,8 @@ vlc_module_begin ()
                  MAXHEIGHT_LONGTEXT, true )
     add_module_list( SOUT_CFG_PREFIX "vfilter", "video filter2",
                      NULL, VFILTER_TEXT, VFILTER_LONGTEXT, false )
+    add_string( SOUT_CFG_PREFIX "renditions", NULL, RENDITIONS_TEXT,
+                RENDITIONS_LONGTEXT, true )
 
     set_section( N_("Audio"), NULL )
     add_module( SOUT_CFG_PREFIX "aenc", "encoder", NULL, AENC_TEXT,
@@ -227,7 +237,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "osd", "high-priority", "maxwidth", "maxheight",
-    NULL
+    "renditions", NULL
 };
 
 /*****************************************************************************
@@ -237,6 +247,39 @@ static sout_stream_id_sys_t *Add ( sout_stream_t *, es_format_t * );
 static int               Del ( sout_stream_t *, sout_stream_id_sys_t * );
 static int               Send( sout_stream_t *, sout_stream_id_sys_t *, block_t* );
 
+static void ParseRenditions( sout_stream_t *p_stream, sout_stream_sys_t *p_sys,
+                             char *psz_list )
+{
+    char *psz_save;
+
+    for( char *psz_item = strtok_r( psz_list, ",", &psz_save );
+         psz_item != NULL; psz_item = strtok_r( NULL, ",", &psz_save ) )
+    {
+        transcode_rendition_cfg_t cfg = { 0, 0, 0 };
+
+        if( sscanf( psz_item, "%ux%u@%d", &cfg.i_width, &cfg.i_height,
+                    &cfg.i_bitrate ) < 2 || ( !cfg.i_width && !cfg.i_height ) )
+        {
+            msg_Warn( p_stream, "ignoring invalid rendition `%s'", psz_item );
+            continue;
+        }
+        cfg.i_width &= ~1;
+        cfg.i_height &= ~1;
+        if( cfg.i_bitrate < 16000 ) cfg.i_bitrate *= 1000;
+
+        transcode_rendition_cfg_t *p_renditions =
+            realloc( p_sys->p_renditions,
+                     (p_sys->i_renditions + 1) * sizeof(*p_renditions) );
+        if( !p_renditions )
+            break;
+        p_renditions[p_sys->i_renditions++] = cfg;
+        p_sys->p_renditions = p_renditions;
+
+        msg_Dbg( p_stream, "video rendition %ux%u %dkb/s", cfg.i_width,
+                 cfg.i_height, cfg.i_bitrate / 1000 );
+    }
+}
+
 /*****************************************************************************
  * Open:
  *****************************************************************************/
@@ -358,6 +401,11 @@ static int Open( vlc_object_t *p_this )
         p_sys->psz_vf2 = NULL;
     free( psz_string );
 
+    psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "renditions" );
+    if( psz_string && *psz_string )
+        ParseRenditions( p_stream, p_sys, psz_string );
+    free( psz_string );
+
     p_sys->b_deinterlace = var_GetBool( p_stream, SOUT_CFG_PREFIX "deinterlace" );
 
     psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "deinterlace-module" );
@@ -485,6 +533,7 @@ static void Close( vlc_object_t * p_this )
     free( p_sys->psz_alang );
 
     free( p_sys->psz_vf2 );
+    free( p_sys->p_renditions );
 
     config_ChainDestroy( p_sys->p_video_cfg );
     free( p_sys->psz_venc );
@@ -647,6 +696,14 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
         return VLC_EGENERIC;
     }
 
+    /* The decoders may write to the payload */
+    if( p_buffer != NULL )
+    {
+        p_buffer = block_Unshare( p_buffer );
+        if( p_buffer == NULL )
+            return VLC_ENOMEM;
+    }
+
     switch( id->p_decoder->fmt_in.i_cat )
     {
     case AUDIO_ES:
@@ -692,3 +749,160 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
         return sout_StreamIdSend( p_stream->p_next, id->id, p_out );
     return VLC_SUCCESS;
 }
+
+/*****************************************************************************
+ * Pipeline stages
+ *****************************************************************************/
+static void *StageThread( void *data )
+{
+    transcode_stage_t *p_stage = data;
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock( &p_stage->lock );
+    for( ;; )
+    {
+        while( !p_stage->b_quit && p_stage->i_count == 0 )
+            vlc_cond_wait( &p_stage->wait_request, &p_stage->lock );
+        if( p_stage->b_quit )
+            break;
+
+        picture_t *p_pic = p_stage->pp_queue[p_stage->i_first];
+        p_stage->i_first = (p_stage->i_first + 1) % TRANSCODE_STAGE_DEPTH;
+        p_stage->i_count--;
+        p_stage->b_busy = true;
+        vlc_cond_broadcast( &p_stage->wait_room );
+        vlc_mutex_unlock( &p_stage->lock );
+
+        /* The callback may block on the queue of the next stage */
+        mtime_t i_start = mdate();
+        p_stage->pf_process( p_stage->p_stream, p_stage->p_opaque, p_pic );
+        mtime_t i_busy = mdate() - i_start;
+
+        vlc_mutex_lock( &p_stage->lock );
+        p_stage->stats.i_busy += i_busy;
+        p_stage->stats.i_pictures++;
+        p_stage->b_busy = false;
+        vlc_cond_broadcast( &p_stage->wait_room );
+    }
+    vlc_mutex_unlock( &p_stage->lock );
+
+    vlc_restorecancel( canc );
+    return NULL;
+}
+
+int transcode_stage_Start( transcode_stage_t *p_stage, const char *psz_name,
+                           transcode_stage_cb pf_process,
+                           sout_stream_t *p_stream, void *p_opaque,
+                           int i_priority )
+{
+    memset( p_stage, 0, sizeof(*p_stage) );
+    p_stage->psz_name = psz_name;
+    p_stage->p_stream = p_stream;
+    p_stage->p_opaque = p_opaque;
+    p_stage->pf_process = pf_process;
+    p_stage->stats.i_start = mdate();
+
+    vlc_mutex_init( &p_stage->lock );
+    vlc_cond_init( &p_stage->wait_request );
+    vlc_cond_init( &p_stage->wait_room );
+
+    if( vlc_clone( &p_stage->thread, StageThread, p_stage, i_priority ) )
+    {
+        msg_Err( p_stream, "cannot spawn %s thread", psz_name );
+        vlc_cond_destroy( &p_stage->wait_room );
+        vlc_cond_destroy( &p_stage->wait_request );
+        vlc_mutex_destroy( &p_stage->lock );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+/* Stops the thread and drops the pending pictures. The downstream stages must
+ * still be running, as the callback may be waiting on them. */
+void transcode_stage_Stop( transcode_stage_t *p_stage )
+{
+    vlc_mutex_lock( &p_stage->lock );
+    p_stage->b_quit = true;
+    vlc_cond_signal( &p_stage->wait_request );
+    vlc_cond_broadcast( &p_stage->wait_room );
+    vlc_mutex_unlock( &p_stage->lock );
+
+    vlc_join( p_stage->thread, NULL );
+
+    for( ; p_stage->i_count > 0; p_stage->i_count-- )
+    {
+        picture_Release( p_stage->pp_queue[p_stage->i_first] );
+        p_stage->i_first = (p_stage->i_first + 1) % TRANSCODE_STAGE_DEPTH;
+    }
+
+    transcode_stats_Print( p_stage->p_stream, p_stage->psz_name,
+                           &p_stage->stats );
+
+    vlc_cond_destroy( &p_stage->wait_room );
+    vlc_cond_destroy( &p_stage->wait_request );
+    vlc_mutex_destroy( &p_stage->lock );
+}
+
+/* Queues a picture, waiting while the queue is full */
+void transcode_stage_Push( transcode_stage_t *p_stage, picture_t *p_pic )
+{
+    mtime_t i_stall = 0;
+
+    vlc_mutex_lock( &p_stage->lock );
+    while( !p_stage->b_quit && p_stage->i_count == TRANSCODE_STAGE_DEPTH )
+    {
+        if( i_stall == 0 )
+            i_stall = mdate();
+        vlc_cond_wait( &p_stage->wait_room, &p_stage->lock );
+    }
+    if( i_stall != 0 )
+        p_stage->stats.i_stalled += mdate() - i_stall;
+
+    if( p_stage->b_quit )
+    {
+        vlc_mutex_unlock( &p_stage->lock );
+        picture_Release( p_pic );
+        return;
+    }
+
+    p_stage->pp_queue[(p_stage->i_first + p_stage->i_count)
+                      % TRANSCODE_STAGE_DEPTH] = p_pic;
+    p_stage->i_count++;
+
+    p_stage->stats.i_queued++;
+    p_stage->stats.i_depth_sum += p_stage->i_count;
+    if( p_stage->i_count > p_stage->stats.i_depth_max )
+        p_stage->stats.i_depth_max = p_stage->i_count;
+
+    vlc_cond_signal( &p_stage->wait_request );
+    vlc_mutex_unlock( &p_stage->lock );
+}
+
+/* Waits until every queued picture has been processed */
+void transcode_stage_Drain( transcode_stage_t *p_stage )
+{
+    vlc_mutex_lock( &p_stage->lock );
+    while( !p_stage->b_quit && ( p_stage->i_count > 0 || p_stage->b_busy ) )
+        vlc_cond_wait( &p_stage->wait_room, &p_stage->lock );
+    vlc_mutex_unlock( &p_stage->lock );
+}
+
+void transcode_stats_Print( sout_stream_t *p_stream, const char *psz_name,
+                            const transcode_stats_t *p_stats )
+{
+    mtime_t i_duration = mdate() - p_stats->i_start;
+    int i_load = i_duration > 0 ? (int)(100 * p_stats->i_busy / i_duration) : 0;
+
+    if( p_stats->i_queued == 0 )
+    {
+        msg_Dbg( p_stream, "%s: %"PRIu64" pictures, busy %"PRId64" ms (%d%%)",
+                 psz_name, p_stats->i_pictures, p_stats->i_busy / 1000,
+                 i_load );
+        return;
+    }
+    msg_Dbg( p_stream, "%s: %"PRIu64" pictures, busy %"PRId64" ms (%d%%), "
+             "queue depth avg %.2f max %u, stalled %"PRId64" ms", psz_name,
+             p_stats->i_pictures, p_stats->i_busy / 1000, i_load,
+             (double)p_stats->i_depth_sum / p_stats->i_queued,
+             p_stats->i_depth_max, p_stats->i_stalled / 1000 );
+}
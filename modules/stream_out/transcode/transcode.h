@@ -9,21 +9,68 @@
 #include <vlc_es.h>
 #include <vlc_codec.h>
 
-#include <vlc_picture_fifo.h>
-
 /*100ms is around the limit where people are noticing lipsync issues*/
 #define MASTER_SYNC_MAX_DRIFT 100000
 
-struct sout_stream_sys_t
+/* Pictures a pipeline stage may have waiting before its producer blocks */
+#define TRANSCODE_STAGE_DEPTH 4
+
+typedef struct
+{
+    uint64_t        i_pictures;  /**< processed pictures */
+    uint64_t        i_queued;    /**< queued pictures */
+    uint64_t        i_depth_sum; /**< queue depth, summed at each queuing */
+    unsigned        i_depth_max;
+    mtime_t         i_busy;      /**< time spent processing */
+    mtime_t         i_stalled;   /**< time the producer waited for room */
+    mtime_t         i_start;
+} transcode_stats_t;
+
+typedef void (*transcode_stage_cb)( sout_stream_t *, void *, picture_t * );
+
+/* A thread processing the pictures of a bounded queue, in order */
+typedef struct
 {
-    sout_stream_id_sys_t *id_video;
-    block_t         *p_buffers;
-    vlc_mutex_t     lock_out;
-    vlc_cond_t      cond;
-    bool            b_abort;
-    picture_fifo_t *pp_pics;
+    const char           *psz_name;
+    sout_stream_t        *p_stream;
+    void                 *p_opaque;
+    transcode_stage_cb    pf_process;
+
     vlc_thread_t    thread;
+    vlc_mutex_t     lock;
+    vlc_cond_t      wait_request;
+    vlc_cond_t      wait_room;
+    picture_t      *pp_queue[TRANSCODE_STAGE_DEPTH];
+    unsigned        i_first;
+    unsigned        i_count;
+    bool            b_busy;
+    bool            b_quit;
+
+    transcode_stats_t stats;
+} transcode_stage_t;
+
+/* Extra encoding of the video, from the same decoded and filtered pictures */
+typedef struct
+{
+    unsigned int    i_width;   /**< 0 to keep the aspect ratio */
+    unsigned int    i_height;  /**< 0 to keep the aspect ratio */
+    int             i_bitrate; /**< 0 for the main video bitrate */
+} transcode_rendition_cfg_t;
+
+typedef struct
+{
+    encoder_t         *p_encoder;
+    filter_chain_t    *p_conv_chain; /**< Scaling and conversion */
+    filter_t          *p_spu_blend;
+    const video_format_t *p_fmt_source; /**< Of the decoded pictures */
+    void              *id;           /**< Output ES, NULL if disabled */
+    transcode_stage_t *p_stage;      /**< Scale and encode, NULL without threads */
+    vlc_mutex_t        lock_out;
+    block_t           *p_buffers;    /**< Encoded, not sent yet */
+} transcode_rendition_t;
 
+struct sout_stream_sys_t
+{
     /* Audio */
     vlc_fourcc_t    i_acodec;   /* codec audio (0 if not transcode) */
     char            *psz_aenc;
@@ -53,6 +100,9 @@ struct sout_stream_sys_t
 
     char            *psz_vf2;
 
+    transcode_rendition_cfg_t *p_renditions;
+    unsigned int    i_renditions;
+
     /* SPU */
     vlc_fourcc_t    i_scodec;   /* codec spu (0 if not transcode) */
     char            *psz_senc;
@@ -91,7 +141,17 @@ struct sout_stream_id_sys_t
          {
              filter_chain_t  *p_f_chain; /**< Video filters */
              filter_chain_t  *p_uf_chain; /**< User-specified video filters */
+             filter_chain_t  *p_conv_chain; /**< Scaling and conversion */
              video_format_t  fmt_input_video;
+
+             /* Filter, scale and encode stages, NULL without threads */
+             transcode_stage_t *p_stages;
+             transcode_stats_t  decode_stats;
+             vlc_mutex_t        lock_out;
+             block_t           *p_buffers; /**< Encoded, not sent yet */
+
+             transcode_rendition_t *p_renditions;
+             unsigned int       i_renditions;
          };
          struct
          {
@@ -110,6 +170,17 @@ struct sout_stream_id_sys_t
 
 };
 
+/* Pipeline */
+
+int  transcode_stage_Start( transcode_stage_t *, const char *psz_name,
+                            transcode_stage_cb, sout_stream_t *,
+                            void *p_opaque, int i_priority );
+void transcode_stage_Stop ( transcode_stage_t * );
+void transcode_stage_Push ( transcode_stage_t *, picture_t * );
+void transcode_stage_Drain( transcode_stage_t * );
+void transcode_stats_Print( sout_stream_t *, const char *psz_name,
+                            const transcode_stats_t * );
+
 /* OSD */
 
 int transcode_osd_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id );
@@ -66,58 +66,101 @@ static picture_t *transcode_video_filter_buffer_new( filter_t *p_filter )
     return picture_NewFromFormat( &p_filter->fmt_out.video );
 }
 
-static void* EncoderThread( void *obj )
+/* The pictures go from the decoder through these stages, each on its own
+ * thread when the pipeline is enabled, or synchronously otherwise. */
+enum
 {
-    sout_stream_sys_t *p_sys = (sout_stream_sys_t*)obj;
-    sout_stream_id_sys_t *id = p_sys->id_video;
-    picture_t *p_pic = NULL;
-    int canc = vlc_savecancel ();
-    block_t *p_block = NULL;
+    STAGE_FILTER,
+    STAGE_SCALE,
+    STAGE_ENCODE,
+    STAGE_COUNT
+};
 
-    vlc_mutex_lock( &p_sys->lock_out );
+static void FilterPicture( sout_stream_t *, void *, picture_t * );
+static void ScalePicture( sout_stream_t *, void *, picture_t * );
+static void EncodePicture( sout_stream_t *, void *, picture_t * );
+static void RenditionPicture( sout_stream_t *, void *, picture_t * );
 
-    for( ;; )
-    {
-        while( !p_sys->b_abort &&
-               (p_pic = picture_fifo_Pop( p_sys->pp_pics )) == NULL )
-            vlc_cond_wait( &p_sys->cond, &p_sys->lock_out );
+static const struct
+{
+    const char        *psz_name;
+    transcode_stage_cb pf_process;
+} stages[STAGE_COUNT] =
+{
+    [STAGE_FILTER] = { "video filter", FilterPicture },
+    [STAGE_SCALE]  = { "video scale",  ScalePicture },
+    [STAGE_ENCODE] = { "video encode", EncodePicture },
+};
 
-        if( p_pic )
-        {
-            /* release lock while encoding */
-            vlc_mutex_unlock( &p_sys->lock_out );
-            p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
-            picture_Release( p_pic );
-            vlc_mutex_lock( &p_sys->lock_out );
+static void SendToStage( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                         unsigned i_stage, picture_t *p_pic )
+{
+    if( id->p_stages )
+        transcode_stage_Push( &id->p_stages[i_stage], p_pic );
+    else
+        stages[i_stage].pf_process( p_stream, id, p_pic );
+}
 
-            block_ChainAppend( &p_sys->p_buffers, p_block );
-        }
+static void SendToRendition( sout_stream_t *p_stream,
+                             transcode_rendition_t *p_rend, picture_t *p_pic )
+{
+    if( !p_rend->id )
+        return;
 
-        if( p_sys->b_abort )
-            break;
-    }
+    picture_Hold( p_pic );
+    if( p_rend->p_stage )
+        transcode_stage_Push( p_rend->p_stage, p_pic );
+    else
+        RenditionPicture( p_stream, p_rend, p_pic );
+}
 
-    /*Encode what we have in the buffer on closing*/
-    while( (p_pic = picture_fifo_Pop( p_sys->pp_pics )) != NULL )
-    {
-        p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
-        picture_Release( p_pic );
-        block_ChainAppend( &p_sys->p_buffers, p_block );
-    }
+static void StopStages( sout_stream_id_sys_t *id, unsigned i_count )
+{
+    /* Upstream first, so that no stage is left waiting on a stopped one */
+    for( unsigned i = 0; i < i_count; i++ )
+        transcode_stage_Stop( &id->p_stages[i] );
+    free( id->p_stages );
+    id->p_stages = NULL;
+}
 
-    /*Now flush encoder*/
-    do {
-        p_block = id->p_encoder->pf_encode_video(id->p_encoder, NULL );
-        block_ChainAppend( &p_sys->p_buffers, p_block );
-    } while( p_block );
+static int StartStages( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
+{
+    int i_priority = p_stream->p_sys->b_high_priority ?
+                     VLC_THREAD_PRIORITY_OUTPUT : VLC_THREAD_PRIORITY_VIDEO;
 
-    vlc_mutex_unlock( &p_sys->lock_out );
+    id->p_stages = malloc( STAGE_COUNT * sizeof(*id->p_stages) );
+    if( !id->p_stages )
+        return VLC_ENOMEM;
 
-    vlc_restorecancel (canc);
+    for( unsigned i = 0; i < STAGE_COUNT; i++ )
+    {
+        if( transcode_stage_Start( &id->p_stages[i], stages[i].psz_name,
+                                   stages[i].pf_process, p_stream, id,
+                                   i_priority ) )
+        {
+            StopStages( id, i );
+            return VLC_EGENERIC;
+        }
+    }
+    return VLC_SUCCESS;
+}
 
-    return NULL;
+/* Waits for the pictures in flight to be encoded */
+static void DrainStages( sout_stream_id_sys_t *id )
+{
+    if( id->p_stages )
+        for( unsigned i = 0; i < STAGE_COUNT; i++ )
+            transcode_stage_Drain( &id->p_stages[i] );
+
+    /* Fed by the filter stage only */
+    for( unsigned i = 0; i < id->i_renditions; i++ )
+        if( id->p_renditions[i].p_stage )
+            transcode_stage_Drain( id->p_renditions[i].p_stage );
 }
 
+static void transcode_video_renditions_new( sout_stream_t *,
+                                            sout_stream_id_sys_t * );
+
 int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
@@ -212,36 +255,22 @@ int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
     }
     id->p_encoder->p_module = NULL;
 
-    if( p_sys->i_threads <= 0 )
-        return VLC_SUCCESS;
+    vlc_mutex_init( &id->lock_out );
+    id->p_buffers = NULL;
+    id->p_stages = NULL;
+    id->decode_stats.i_start = mdate();
 
-    int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
-                       VLC_THREAD_PRIORITY_VIDEO;
-    p_sys->id_video = id;
-    p_sys->pp_pics = picture_fifo_New();
-    if( p_sys->pp_pics == NULL )
+    if( p_sys->i_threads > 0 && StartStages( p_stream, id ) )
     {
-        msg_Err( p_stream, "cannot create picture fifo" );
-        module_unneed( id->p_decoder, id->p_decoder->p_module );
-        id->p_decoder->p_module = NULL;
-        free( id->p_decoder->p_owner );
-        return VLC_ENOMEM;
-    }
-    vlc_mutex_init( &p_sys->lock_out );
-    vlc_cond_init( &p_sys->cond );
-    p_sys->p_buffers = NULL;
-    p_sys->b_abort = false;
-    if( vlc_clone( &p_sys->thread, EncoderThread, p_sys, i_priority ) )
-    {
-        msg_Err( p_stream, "cannot spawn encoder thread" );
-        vlc_mutex_destroy( &p_sys->lock_out );
-        vlc_cond_destroy( &p_sys->cond );
-        picture_fifo_Delete( p_sys->pp_pics );
+        msg_Err( p_stream, "cannot start the video pipeline" );
+        vlc_mutex_destroy( &id->lock_out );
         module_unneed( id->p_decoder, id->p_decoder->p_module );
         id->p_decoder->p_module = NULL;
         free( id->p_decoder->p_owner );
         return VLC_EGENERIC;
     }
+
+    transcode_video_renditions_new( p_stream, id );
     return VLC_SUCCESS;
 }
 
@@ -260,14 +289,30 @@ static void transcode_video_filter_init( sout_stream_t *p_stream,
     id->p_f_chain = filter_chain_NewVideo( p_stream, false, &owner );
     filter_chain_Reset( id->p_f_chain, p_fmt_out, p_fmt_out );
 
+    /* Pictures in video memory (hardware decoding) are only downloaded
+     * once scaled to the encoder size, unless CPU filters need them first */
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( p_fmt_out->video.i_chroma );
+    if( ( p_stream->p_sys->b_deinterlace || p_stream->p_sys->b_master_sync )
+     && p_dsc != NULL && p_dsc->plane_count == 0 )
+    {
+        es_format_t fmt;
+
+        es_format_Copy( &fmt, p_fmt_out );
+        fmt.i_codec = fmt.video.i_chroma = id->p_encoder->fmt_in.video.i_chroma;
+        filter_chain_AppendFilter( id->p_f_chain, NULL, NULL, p_fmt_out, &fmt );
+        es_format_Clean( &fmt );
+
+        p_fmt_out = filter_chain_GetFmtOut( id->p_f_chain );
+    }
+
     /* Deinterlace */
     if( p_stream->p_sys->b_deinterlace )
     {
         filter_chain_AppendFilter( id->p_f_chain,
                                    p_stream->p_sys->psz_deinterlace,
                                    p_stream->p_sys->p_deinterlace_cfg,
-                                   &id->p_decoder->fmt_out,
-                                   &id->p_decoder->fmt_out );
+                                   p_fmt_out, p_fmt_out );
 
         p_fmt_out = filter_chain_GetFmtOut( id->p_f_chain );
     }
@@ -315,8 +360,34 @@ static void transcode_video_filter_init( sout_stream_t *p_stream,
 
 }
 
-/* Take care of the scaling and chroma conversions. */
-static void conversion_video_filter_append( sout_stream_id_sys_t *id )
+/* Take care of the scaling and chroma conversions.
+ * Returns NULL if the formats already match. */
+static filter_chain_t *conversion_chain_new( sout_stream_t *p_stream,
+                                             const es_format_t *p_fmt_in,
+                                             const es_format_t *p_fmt_out )
+{
+    if( ( p_fmt_in->video.i_chroma == p_fmt_out->video.i_chroma ) &&
+        ( p_fmt_in->video.i_width == p_fmt_out->video.i_width ) &&
+        ( p_fmt_in->video.i_height == p_fmt_out->video.i_height ) )
+        return NULL;
+
+    filter_owner_t owner = {
+        .sys = p_stream->p_sys,
+        .video = {
+            .buffer_new = transcode_video_filter_buffer_new,
+        },
+    };
+
+    filter_chain_t *p_chain = filter_chain_NewVideo( p_stream, false, &owner );
+    if( !p_chain )
+        return NULL;
+    filter_chain_Reset( p_chain, p_fmt_in, p_fmt_out );
+    filter_chain_AppendFilter( p_chain, NULL, NULL, p_fmt_in, p_fmt_out );
+    return p_chain;
+}
+
+/* Format of the pictures leaving the filter stage */
+static const es_format_t *filtered_format( sout_stream_id_sys_t *id )
 {
     const es_format_t *p_fmt_out = &id->p_decoder->fmt_out;
     if( id->p_f_chain )
@@ -324,16 +395,25 @@ static void conversion_video_filter_append( sout_stream_id_sys_t *id )
 
     if( id->p_uf_chain )
         p_fmt_out = filter_chain_GetFmtOut( id->p_uf_chain );
+    return p_fmt_out;
+}
 
-    if( ( p_fmt_out->video.i_chroma != id->p_encoder->fmt_in.video.i_chroma ) ||
-        ( p_fmt_out->video.i_width != id->p_encoder->fmt_in.video.i_width ) ||
-        ( p_fmt_out->video.i_height != id->p_encoder->fmt_in.video.i_height ) )
-    {
-        filter_chain_AppendFilter( id->p_uf_chain ? id->p_uf_chain : id->p_f_chain,
-                                   NULL, NULL,
-                                   p_fmt_out,
-                                   &id->p_encoder->fmt_in );
-    }
+static void conversion_video_filter_append( sout_stream_t *p_stream,
+                                            sout_stream_id_sys_t *id )
+{
+    id->p_conv_chain = conversion_chain_new( p_stream, filtered_format( id ),
+                                             &id->p_encoder->fmt_in );
+}
+
+static void transcode_video_filter_clean( sout_stream_id_sys_t *id )
+{
+    if( id->p_f_chain )
+        filter_chain_Delete( id->p_f_chain );
+    if( id->p_uf_chain )
+        filter_chain_Delete( id->p_uf_chain );
+    if( id->p_conv_chain )
+        filter_chain_Delete( id->p_conv_chain );
+    id->p_f_chain = id->p_uf_chain = id->p_conv_chain = NULL;
 }
 
 static void transcode_video_encoder_init( sout_stream_t *p_stream,
@@ -573,24 +653,249 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
     return VLC_SUCCESS;
 }
 
-void transcode_video_close( sout_stream_t *p_stream,
-                                   sout_stream_id_sys_t *id )
+/*
+ * Renditions: extra encoders fed with the pictures of the filter stage.
+ * A rendition whose encoder could not be created or opened is left out.
+ */
+static void transcode_video_renditions_new( sout_stream_t *p_stream,
+                                            sout_stream_id_sys_t *id )
 {
-    if( p_stream->p_sys->i_threads >= 1 && !p_stream->p_sys->b_abort )
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    id->p_renditions = NULL;
+    id->i_renditions = 0;
+    if( p_sys->i_renditions == 0 )
+        return;
+
+    id->p_renditions = calloc( p_sys->i_renditions,
+                               sizeof(*id->p_renditions) );
+    if( !id->p_renditions )
+        return;
+    id->i_renditions = p_sys->i_renditions;
+
+    int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
+                       VLC_THREAD_PRIORITY_VIDEO;
+
+    for( unsigned i = 0; i < id->i_renditions; i++ )
     {
-        vlc_mutex_lock( &p_stream->p_sys->lock_out );
-        p_stream->p_sys->b_abort = true;
-        vlc_cond_signal( &p_stream->p_sys->cond );
-        vlc_mutex_unlock( &p_stream->p_sys->lock_out );
+        transcode_rendition_t *p_rend = &id->p_renditions[i];
+        encoder_t *p_enc = sout_EncoderCreate( p_stream );
+
+        vlc_mutex_init( &p_rend->lock_out );
+        p_rend->p_fmt_source = &id->fmt_input_video;
+        if( !p_enc )
+            continue;
+
+        es_format_Init( &p_enc->fmt_in, VIDEO_ES, 0 );
+        es_format_Init( &p_enc->fmt_out, VIDEO_ES, p_sys->i_vcodec );
+        p_enc->fmt_out.i_id = id->p_encoder->fmt_out.i_id + 1000 * (i + 1);
+        p_enc->fmt_out.i_group = id->p_encoder->fmt_out.i_group;
+        p_enc->fmt_out.i_bitrate = p_sys->p_renditions[i].i_bitrate ?
+            p_sys->p_renditions[i].i_bitrate : p_sys->i_vbitrate;
+        p_enc->i_threads = p_sys->i_threads;
+        p_enc->p_cfg = p_sys->p_video_cfg;
+        p_enc->p_module = NULL;
+        p_rend->p_encoder = p_enc;
+
+        if( p_sys->i_threads <= 0 )
+            continue;
+
+        p_rend->p_stage = malloc( sizeof(*p_rend->p_stage) );
+        if( p_rend->p_stage &&
+            transcode_stage_Start( p_rend->p_stage, "video rendition",
+                                   RenditionPicture, p_stream, p_rend,
+                                   i_priority ) )
+        {
+            /* Run it on the filter thread then */
+            free( p_rend->p_stage );
+            p_rend->p_stage = NULL;
+        }
+    }
+}
 
-        vlc_join( p_stream->p_sys->thread, NULL );
+/* Sets the formats and the scaling of the renditions from the main encoder
+ * and the output of the filters */
+static void transcode_video_renditions_init( sout_stream_t *p_stream,
+                                             sout_stream_id_sys_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    const es_format_t *p_fmt_src = filtered_format( id );
+
+    unsigned i_src_width = p_fmt_src->video.i_visible_width ?
+        p_fmt_src->video.i_visible_width : p_fmt_src->video.i_width;
+    unsigned i_src_height = p_fmt_src->video.i_visible_height ?
+        p_fmt_src->video.i_visible_height : p_fmt_src->video.i_height;
+    unsigned i_sar_num = p_fmt_src->video.i_sar_num;
+    unsigned i_sar_den = p_fmt_src->video.i_sar_den;
+    if( !i_sar_num || !i_sar_den )
+        i_sar_num = i_sar_den = 1;
+    if( !i_src_width || !i_src_height )
+        return;
+
+    for( unsigned i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_rend = &id->p_renditions[i];
+        encoder_t *p_enc = p_rend->p_encoder;
+        if( !p_enc )
+            continue;
+
+        /* Keep the displayed aspect ratio for the missing dimension */
+        unsigned i_width = p_sys->p_renditions[i].i_width;
+        unsigned i_height = p_sys->p_renditions[i].i_height;
+        if( !i_width )
+            i_width = 2 * lround( (double)i_height * i_src_width * i_sar_num
+                                  / i_src_height / i_sar_den / 2 );
+        if( !i_height )
+            i_height = 2 * lround( (double)i_width * i_src_height * i_sar_den
+                                   / i_src_width / i_sar_num / 2 );
+        i_width = __MAX( i_width, 2 );
+        i_height = __MAX( i_height, 2 );
+
+        p_enc->fmt_in.i_codec = id->p_encoder->fmt_in.i_codec;
+        p_enc->fmt_in.video = id->p_encoder->fmt_in.video;
+        p_enc->fmt_in.video.p_palette = NULL;
+        p_enc->fmt_in.video.i_width =
+        p_enc->fmt_in.video.i_visible_width = i_width;
+        p_enc->fmt_in.video.i_height =
+        p_enc->fmt_in.video.i_visible_height = i_height;
+        p_enc->fmt_in.video.i_x_offset = p_enc->fmt_in.video.i_y_offset = 0;
+        vlc_ureduce( &p_enc->fmt_in.video.i_sar_num,
+                     &p_enc->fmt_in.video.i_sar_den,
+                     (uint64_t)i_sar_num * i_src_width * i_height,
+                     (uint64_t)i_sar_den * i_src_height * i_width, 0 );
+
+        p_enc->fmt_out.video.i_width =
+        p_enc->fmt_out.video.i_visible_width = i_width;
+        p_enc->fmt_out.video.i_height =
+        p_enc->fmt_out.video.i_visible_height = i_height;
+        p_enc->fmt_out.video.i_sar_num = p_enc->fmt_in.video.i_sar_num;
+        p_enc->fmt_out.video.i_sar_den = p_enc->fmt_in.video.i_sar_den;
+        p_enc->fmt_out.video.i_frame_rate =
+            id->p_encoder->fmt_out.video.i_frame_rate;
+        p_enc->fmt_out.video.i_frame_rate_base =
+            id->p_encoder->fmt_out.video.i_frame_rate_base;
+        p_enc->fmt_out.video.orientation =
+            id->p_encoder->fmt_out.video.orientation;
+
+        if( p_rend->p_conv_chain )
+            filter_chain_Delete( p_rend->p_conv_chain );
+        p_rend->p_conv_chain = conversion_chain_new( p_stream, p_fmt_src,
+                                                     &p_enc->fmt_in );
+
+        msg_Dbg( p_stream, "rendition %u: %ux%u", i + 1, i_width, i_height );
+    }
+}
 
-        picture_fifo_Delete( p_stream->p_sys->pp_pics );
-        block_ChainRelease( p_stream->p_sys->p_buffers );
+static void transcode_video_renditions_open( sout_stream_t *p_stream,
+                                             sout_stream_id_sys_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    for( unsigned i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_rend = &id->p_renditions[i];
+        encoder_t *p_enc = p_rend->p_encoder;
+        if( !p_enc || !p_enc->fmt_in.video.i_width )
+            continue;
+
+        p_enc->p_module = module_need( p_enc, "encoder", p_sys->psz_venc,
+                                       true );
+        if( !p_enc->p_module )
+        {
+            msg_Err( p_stream, "cannot open the encoder of rendition %u",
+                     i + 1 );
+            continue;
+        }
+        p_enc->fmt_in.video.i_chroma = p_enc->fmt_in.i_codec;
+        p_enc->fmt_out.i_codec =
+            vlc_fourcc_GetCodec( VIDEO_ES, p_enc->fmt_out.i_codec );
+
+        p_rend->id = sout_StreamIdAdd( p_stream->p_next, &p_enc->fmt_out );
+        if( !p_rend->id )
+            msg_Err( p_stream, "cannot add the stream of rendition %u",
+                     i + 1 );
     }
+}
+
+/* Sends what the renditions encoded, after flushing them if b_flush */
+static void transcode_video_renditions_send( sout_stream_t *p_stream,
+                                             sout_stream_id_sys_t *id,
+                                             bool b_flush )
+{
+    for( unsigned i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_rend = &id->p_renditions[i];
+        block_t *p_out;
+
+        if( !p_rend->id )
+            continue;
 
-    vlc_mutex_destroy( &p_stream->p_sys->lock_out );
-    vlc_cond_destroy( &p_stream->p_sys->cond );
+        vlc_mutex_lock( &p_rend->lock_out );
+        p_out = p_rend->p_buffers;
+        p_rend->p_buffers = NULL;
+        vlc_mutex_unlock( &p_rend->lock_out );
+
+        if( b_flush )
+        {
+            block_t *p_block;
+            do {
+                p_block = p_rend->p_encoder->pf_encode_video( p_rend->p_encoder,
+                                                              NULL );
+                block_ChainAppend( &p_out, p_block );
+            } while( p_block );
+        }
+
+        if( p_out )
+            sout_StreamIdSend( p_stream->p_next, p_rend->id, p_out );
+    }
+}
+
+/* The filter stage must be stopped already */
+static void transcode_video_renditions_close( sout_stream_t *p_stream,
+                                              sout_stream_id_sys_t *id )
+{
+    for( unsigned i = 0; i < id->i_renditions; i++ )
+    {
+        transcode_rendition_t *p_rend = &id->p_renditions[i];
+        encoder_t *p_enc = p_rend->p_encoder;
+
+        if( p_rend->p_stage )
+        {
+            transcode_stage_Stop( p_rend->p_stage );
+            free( p_rend->p_stage );
+        }
+        if( p_rend->id )
+            sout_StreamIdDel( p_stream->p_next, p_rend->id );
+        if( p_enc )
+        {
+            if( p_enc->p_module )
+                module_unneed( p_enc, p_enc->p_module );
+            es_format_Clean( &p_enc->fmt_in );
+            es_format_Clean( &p_enc->fmt_out );
+            vlc_object_release( p_enc );
+        }
+        if( p_rend->p_conv_chain )
+            filter_chain_Delete( p_rend->p_conv_chain );
+        if( p_rend->p_spu_blend )
+            filter_DeleteBlend( p_rend->p_spu_blend );
+        block_ChainRelease( p_rend->p_buffers );
+        vlc_mutex_destroy( &p_rend->lock_out );
+    }
+    free( id->p_renditions );
+    id->p_renditions = NULL;
+    id->i_renditions = 0;
+}
+
+void transcode_video_close( sout_stream_t *p_stream,
+                                   sout_stream_id_sys_t *id )
+{
+    if( id->p_stages )
+        StopStages( id, STAGE_COUNT );
+    transcode_video_renditions_close( p_stream, id );
+    transcode_stats_Print( p_stream, "video decode", &id->decode_stats );
+
+    block_ChainRelease( id->p_buffers );
+    vlc_mutex_destroy( &id->lock_out );
 
     /* Close decoder */
     if( id->p_decoder->p_module )
@@ -605,79 +910,155 @@ void transcode_video_close( sout_stream_t *p_stream,
         module_unneed( id->p_encoder, id->p_encoder->p_module );
 
     /* Close filters */
-    if( id->p_f_chain )
-        filter_chain_Delete( id->p_f_chain );
-    if( id->p_uf_chain )
-        filter_chain_Delete( id->p_uf_chain );
+    transcode_video_filter_clean( id );
 }
 
-static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_id_sys_t *id, block_t **out )
+static void FilterPicture( sout_stream_t *p_stream, void *p_opaque,
+                           picture_t *p_pic )
 {
-    sout_stream_sys_t *p_sys = p_stream->p_sys;
-    picture_t *p_pic2 = NULL;
+    sout_stream_id_sys_t *id = p_opaque;
 
-    /*
-     * Encoding
+    /* Run the filter chains; first with the picture, and then with NULL
+     * as many times as we need until they stop outputting frames.
      */
-    /* Check if we have a subpicture to overlay */
-    if( p_sys->p_spu )
-    {
-        video_format_t fmt = id->p_encoder->fmt_in.video;
-        if( fmt.i_visible_width <= 0 || fmt.i_visible_height <= 0 )
-        {
-            fmt.i_visible_width  = fmt.i_width;
-            fmt.i_visible_height = fmt.i_height;
-            fmt.i_x_offset       = 0;
-            fmt.i_y_offset       = 0;
+    for ( ;; ) {
+        picture_t *p_filtered_pic = p_pic;
+
+        /* Run filter chain */
+        if( id->p_f_chain )
+            p_filtered_pic = filter_chain_VideoFilter( id->p_f_chain, p_filtered_pic );
+        if( !p_filtered_pic )
+            break;
+
+        for ( ;; ) {
+            picture_t *p_user_filtered_pic = p_filtered_pic;
+
+            /* Run user specified filter chain */
+            if( id->p_uf_chain )
+                p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
+            if( !p_user_filtered_pic )
+                break;
+
+            for( unsigned i = 0; i < id->i_renditions; i++ )
+                SendToRendition( p_stream, &id->p_renditions[i],
+                                 p_user_filtered_pic );
+            SendToStage( p_stream, id, STAGE_SCALE, p_user_filtered_pic );
+
+            p_filtered_pic = NULL;
         }
 
-        subpicture_t *p_subpic = spu_Render( p_sys->p_spu, NULL, &fmt,
-                                             &id->p_decoder->fmt_out.video,
-                                             p_pic->date, p_pic->date, false );
+        p_pic = NULL;
+    }
+}
+
+static void ScalePicture( sout_stream_t *p_stream, void *p_opaque,
+                          picture_t *p_pic )
+{
+    sout_stream_id_sys_t *id = p_opaque;
+
+    if( id->p_conv_chain )
+    {
+        p_pic = filter_chain_VideoFilter( id->p_conv_chain, p_pic );
+        if( !p_pic )
+            return;
+    }
+    SendToStage( p_stream, id, STAGE_ENCODE, p_pic );
+}
+
+/* Blends the subpictures due at the picture date, on a copy of the picture if
+ * b_copy is set and the picture is shared */
+static picture_t *OverlaySubpicture( sout_stream_t *p_stream,
+                                     filter_t **pp_blend,
+                                     encoder_t *p_enc,
+                                     const video_format_t *p_fmt_src,
+                                     picture_t *p_pic, bool b_copy )
+{
+    spu_t *p_spu = p_stream->p_sys->p_spu;
 
-        /* Overlay subpicture */
-        if( p_subpic )
+    video_format_t fmt = p_enc->fmt_in.video;
+    if( fmt.i_visible_width <= 0 || fmt.i_visible_height <= 0 )
+    {
+        fmt.i_visible_width  = fmt.i_width;
+        fmt.i_visible_height = fmt.i_height;
+        fmt.i_x_offset       = 0;
+        fmt.i_y_offset       = 0;
+    }
+
+    subpicture_t *p_subpic = spu_Render( p_spu, NULL, &fmt, p_fmt_src,
+                                         p_pic->date, p_pic->date, false );
+
+    /* Overlay subpicture */
+    if( p_subpic )
+    {
+        if( b_copy && picture_IsReferenced( p_pic ) )
         {
-            if( picture_IsReferenced( p_pic ) && !filter_chain_GetLength( id->p_f_chain ) )
+            /* We can't modify the picture, we need to duplicate it,
+             * in this point the picture is already p_encoder->fmt.in format*/
+            picture_t *p_tmp = video_new_buffer_encoder( p_enc );
+            if( likely( p_tmp ) )
             {
-                /* We can't modify the picture, we need to duplicate it,
-                 * in this point the picture is already p_encoder->fmt.in format*/
-                picture_t *p_tmp = video_new_buffer_encoder( id->p_encoder );
-                if( likely( p_tmp ) )
-                {
-                    picture_Copy( p_tmp, p_pic );
-                    picture_Release( p_pic );
-                    p_pic = p_tmp;
-                }
+                picture_Copy( p_tmp, p_pic );
+                picture_Release( p_pic );
+                p_pic = p_tmp;
             }
-            if( unlikely( !p_sys->p_spu_blend ) )
-                p_sys->p_spu_blend = filter_NewBlend( VLC_OBJECT( p_sys->p_spu ), &fmt );
-            if( likely( p_sys->p_spu_blend ) )
-                picture_BlendSubpicture( p_pic, p_sys->p_spu_blend, p_subpic );
-            subpicture_Delete( p_subpic );
         }
+        if( unlikely( !*pp_blend ) )
+            *pp_blend = filter_NewBlend( VLC_OBJECT( p_spu ), &fmt );
+        if( likely( *pp_blend ) )
+            picture_BlendSubpicture( p_pic, *pp_blend, p_subpic );
+        subpicture_Delete( p_subpic );
     }
+    return p_pic;
+}
 
-    if( p_sys->i_threads == 0 )
-    {
-        block_t *p_block;
+static void EncodePicture( sout_stream_t *p_stream, void *p_opaque,
+                           picture_t *p_pic )
+{
+    sout_stream_id_sys_t *id = p_opaque;
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    block_t *p_block;
 
-        p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
-        block_ChainAppend( out, p_block );
-    }
+    /* The decoder may already be working on a picture of another format,
+     * use the one the filters were set up for.
+     * Pictures going to renditions as well are always shared. */
+    if( p_sys->p_spu )
+        p_pic = OverlaySubpicture( p_stream, &p_sys->p_spu_blend,
+                                   id->p_encoder, &id->fmt_input_video, p_pic,
+                                   id->i_renditions > 0 ||
+                                   !filter_chain_GetLength( id->p_f_chain ) );
+
+    p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
+    picture_Release( p_pic );
 
-    if( p_sys->i_threads )
+    vlc_mutex_lock( &id->lock_out );
+    block_ChainAppend( &id->p_buffers, p_block );
+    vlc_mutex_unlock( &id->lock_out );
+}
+
+static void RenditionPicture( sout_stream_t *p_stream, void *p_opaque,
+                              picture_t *p_pic )
+{
+    transcode_rendition_t *p_rend = p_opaque;
+    block_t *p_block;
+
+    if( p_rend->p_conv_chain )
     {
-        vlc_mutex_lock( &p_sys->lock_out );
-        picture_fifo_Push( p_sys->pp_pics, p_pic );
-        vlc_cond_signal( &p_sys->cond );
-        vlc_mutex_unlock( &p_sys->lock_out );
+        p_pic = filter_chain_VideoFilter( p_rend->p_conv_chain, p_pic );
+        if( !p_pic )
+            return;
     }
 
-    if( p_sys->i_threads && p_pic2 )
-        picture_Release( p_pic2 );
-    else if ( p_sys->i_threads == 0 )
-        picture_Release( p_pic );
+    if( p_stream->p_sys->p_spu )
+        p_pic = OverlaySubpicture( p_stream, &p_rend->p_spu_blend,
+                                   p_rend->p_encoder, p_rend->p_fmt_source,
+                                   p_pic, true );
+
+    p_block = p_rend->p_encoder->pf_encode_video( p_rend->p_encoder, p_pic );
+    picture_Release( p_pic );
+
+    vlc_mutex_lock( &p_rend->lock_out );
+    block_ChainAppend( &p_rend->p_buffers, p_block );
+    vlc_mutex_unlock( &p_rend->lock_out );
 }
 
 int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
@@ -689,7 +1070,19 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 
     if( unlikely( in == NULL ) )
     {
-        if( p_sys->i_threads == 0 )
+        if( id->p_stages )
+        {
+            msg_Dbg( p_stream, "Flushing thread and waiting that");
+            DrainStages( id );
+            msg_Dbg( p_stream, "Flushing done");
+        }
+
+        vlc_mutex_lock( &id->lock_out );
+        *out = id->p_buffers;
+        id->p_buffers = NULL;
+        vlc_mutex_unlock( &id->lock_out );
+
+        if( id->p_encoder->p_module )
         {
             block_t *p_block;
             do {
@@ -697,28 +1090,18 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                 block_ChainAppend( out, p_block );
             } while( p_block );
         }
-        else
-        {
-            msg_Dbg( p_stream, "Flushing thread and waiting that");
-            vlc_mutex_lock( &p_stream->p_sys->lock_out );
-            p_stream->p_sys->b_abort = true;
-            vlc_cond_signal( &p_stream->p_sys->cond );
-            vlc_mutex_unlock( &p_stream->p_sys->lock_out );
-
-            vlc_join( p_stream->p_sys->thread, NULL );
-            vlc_mutex_lock( &p_sys->lock_out );
-            *out = p_sys->p_buffers;
-            p_sys->p_buffers = NULL;
-            vlc_mutex_unlock( &p_sys->lock_out );
-
-            msg_Dbg( p_stream, "Flushing done");
-        }
+        transcode_video_renditions_send( p_stream, id, true );
         return VLC_SUCCESS;
     }
 
-
-    while( (p_pic = id->p_decoder->pf_decode_video( id->p_decoder, &in )) )
+    for( ;; )
     {
+        mtime_t i_start = mdate();
+        p_pic = id->p_decoder->pf_decode_video( id->p_decoder, &in );
+        id->decode_stats.i_busy += mdate() - i_start;
+        if( !p_pic )
+            break;
+        id->decode_stats.i_pictures++;
 
         if( unlikely (
              id->p_encoder->p_module &&
@@ -730,13 +1113,11 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                         id->fmt_input_video.i_sar_num, id->p_decoder->fmt_out.video.i_sar_num,
                         id->fmt_input_video.i_sar_den, id->p_decoder->fmt_out.video.i_sar_den
                     );
+            /* The stages use the filters and the encoder format */
+            DrainStages( id );
+
             /* Close filters */
-            if( id->p_f_chain )
-                filter_chain_Delete( id->p_f_chain );
-            id->p_f_chain = NULL;
-            if( id->p_uf_chain )
-                filter_chain_Delete( id->p_uf_chain );
-            id->p_uf_chain = NULL;
+            transcode_video_filter_clean( id );
 
             /* Reinitialize filters */
             id->p_encoder->fmt_out.video.i_visible_width  = p_sys->i_width & ~1;
@@ -745,22 +1126,20 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
 
             transcode_video_filter_init( p_stream, id );
             transcode_video_encoder_init( p_stream, id );
-            conversion_video_filter_append( id );
+            conversion_video_filter_append( p_stream, id );
+            transcode_video_renditions_init( p_stream, id );
             memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
         }
 
 
         if( unlikely( !id->p_encoder->p_module ) )
         {
-            if( id->p_f_chain )
-                filter_chain_Delete( id->p_f_chain );
-            if( id->p_uf_chain )
-                filter_chain_Delete( id->p_uf_chain );
-            id->p_f_chain = id->p_uf_chain = NULL;
+            transcode_video_filter_clean( id );
 
             transcode_video_filter_init( p_stream, id );
             transcode_video_encoder_init( p_stream, id );
-            conversion_video_filter_append( id );
+            conversion_video_filter_append( p_stream, id );
+            transcode_video_renditions_init( p_stream, id );
             memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
 
             if( transcode_video_encoder_open( p_stream, id ) != VLC_SUCCESS )
@@ -770,47 +1149,18 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                 id->b_transcode = false;
                 return VLC_EGENERIC;
             }
+            transcode_video_renditions_open( p_stream, id );
         }
 
-        /* Run the filter and output chains; first with the picture,
-         * and then with NULL as many times as we need until they
-         * stop outputting frames.
-         */
-        for ( ;; ) {
-            picture_t *p_filtered_pic = p_pic;
-
-            /* Run filter chain */
-            if( id->p_f_chain )
-                p_filtered_pic = filter_chain_VideoFilter( id->p_f_chain, p_filtered_pic );
-            if( !p_filtered_pic )
-                break;
-
-            for ( ;; ) {
-                picture_t *p_user_filtered_pic = p_filtered_pic;
-
-                /* Run user specified filter chain */
-                if( id->p_uf_chain )
-                    p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
-                if( !p_user_filtered_pic )
-                    break;
-
-                OutputFrame( p_stream, p_user_filtered_pic, id, out );
-
-                p_filtered_pic = NULL;
-            }
-
-            p_pic = NULL;
-        }
+        SendToStage( p_stream, id, STAGE_FILTER, p_pic );
     }
 
-    if( p_sys->i_threads >= 1 )
-    {
-        /* Pick up any return data the encoder thread wants to output. */
-        vlc_mutex_lock( &p_sys->lock_out );
-        *out = p_sys->p_buffers;
-        p_sys->p_buffers = NULL;
-        vlc_mutex_unlock( &p_sys->lock_out );
-    }
+    /* Pick up what the encoders produced so far */
+    vlc_mutex_lock( &id->lock_out );
+    *out = id->p_buffers;
+    id->p_buffers = NULL;
+    vlc_mutex_unlock( &id->lock_out );
+    transcode_video_renditions_send( p_stream, id, false );
 
     return VLC_SUCCESS;
 }
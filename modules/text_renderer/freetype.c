@@ -85,6 +85,11 @@
 
 #include "text_renderer.h"
 #include "platform_fonts.h"
+#include "text_cache.h"
+
+/* Bounds of the glyph and line caches, in bytes */
+#define GLYPH_CACHE_SIZE (2 * 1024 * 1024)
+#define LINE_CACHE_SIZE  (2 * 1024 * 1024)
 
 /*****************************************************************************
  * Module descriptor
@@ -292,6 +297,9 @@ struct filter_sys_t
                                bool bold, bool italic, int size,
                                int *index);
 
+    /* Rendered glyphs and laid out lines */
+    text_cache_t  *p_glyph_cache;
+    text_cache_t  *p_line_cache;
 };
 
 /* */
@@ -1044,16 +1052,63 @@ static FT_Face LoadFace( filter_t *p_filter,
     return p_face;
 }
 
-static int GetGlyph( filter_t *p_filter,
-                     FT_Glyph *pp_glyph,   FT_BBox *p_glyph_bbox,
-                     FT_Glyph *pp_outline, FT_BBox *p_outline_bbox,
-                     FT_Glyph *pp_shadow,  FT_BBox *p_shadow_bbox,
+/*****************************************************************************
+ * Glyph cache
+ *****************************************************************************
+ * The bitmaps are rendered for the sub-pixel part of the pens only: moving
+ * an outline by whole pixels does not change its rasterization, so the
+ * cached bitmaps only need to be translated.
+ *****************************************************************************/
+typedef struct
+{
+    FT_Glyph  glyph;
+    FT_Glyph  outline;
+    FT_Glyph  shadow;
+    FT_Vector advance;
+} glyph_cache_entry_t;
 
-                     FT_Face  p_face,
-                     int i_glyph_index,
-                     int i_style_flags,
-                     FT_Vector *p_pen,
-                     FT_Vector *p_pen_shadow )
+typedef struct
+{
+    int    i_glyph_index;
+    int    i_font_width;
+    int    i_font_size;
+    int    i_style_flags;
+    int    i_default_face;
+    int    i_outline_radius;
+    int    i_shadow;
+    FT_Pos pen_x;
+    FT_Pos pen_y;
+    FT_Pos pen_shadow_x;
+    FT_Pos pen_shadow_y;
+    /* followed by the font name */
+} glyph_cache_key_t;
+
+static size_t GlyphCost( FT_Glyph glyph )
+{
+    if( !glyph )
+        return 0;
+    const FT_Bitmap *p_bitmap = &((FT_BitmapGlyph)glyph)->bitmap;
+    return sizeof(FT_BitmapGlyphRec) + p_bitmap->rows * abs( p_bitmap->pitch );
+}
+
+static void GlyphCacheEntryFree( void *p_data )
+{
+    glyph_cache_entry_t *p_entry = p_data;
+
+    FT_Done_Glyph( p_entry->glyph );
+    if( p_entry->outline )
+        FT_Done_Glyph( p_entry->outline );
+    if( p_entry->shadow )
+        FT_Done_Glyph( p_entry->shadow );
+    free( p_entry );
+}
+
+static int RenderGlyph( filter_t *p_filter, glyph_cache_entry_t *p_entry,
+                        FT_Face  p_face,
+                        int i_glyph_index,
+                        int i_style_flags,
+                        FT_Vector *p_pen,
+                        FT_Vector *p_pen_shadow )
 {
     if( FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT ) &&
         FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
@@ -1091,15 +1146,8 @@ static int GetGlyph( filter_t *p_filter,
     {
         shadow = outline ? outline : glyph;
         if( FT_Glyph_To_Bitmap( &shadow, FT_RENDER_MODE_NORMAL, p_pen_shadow, 0  ) )
-        {
             shadow = NULL;
-        }
-        else
-        {
-            FT_Glyph_Get_CBox( shadow, ft_glyph_bbox_pixels, p_shadow_bbox );
-        }
     }
-    *pp_shadow = shadow;
 
     if( FT_Glyph_To_Bitmap( &glyph, FT_RENDER_MODE_NORMAL, p_pen, 1) )
     {
@@ -1110,32 +1158,158 @@ static int GetGlyph( filter_t *p_filter,
             FT_Done_Glyph( shadow );
         return VLC_EGENERIC;
     }
-    FT_Glyph_Get_CBox( glyph, ft_glyph_bbox_pixels, p_glyph_bbox );
-    *pp_glyph = glyph;
 
-    if( outline )
+    if( outline && FT_Glyph_To_Bitmap( &outline, FT_RENDER_MODE_NORMAL, p_pen, 1 ) )
     {
-        FT_Glyph_To_Bitmap( &outline, FT_RENDER_MODE_NORMAL, p_pen, 1 );
-        FT_Glyph_Get_CBox( outline, ft_glyph_bbox_pixels, p_outline_bbox );
+        FT_Done_Glyph( outline );
+        outline = NULL;
     }
-    *pp_outline = outline;
 
+    p_entry->glyph   = glyph;
+    p_entry->outline = outline;
+    p_entry->shadow  = shadow;
+    p_entry->advance = p_face->glyph->advance;
     return VLC_SUCCESS;
 }
 
-static void FixGlyph( FT_Glyph glyph, FT_BBox *p_bbox, FT_Face face, const FT_Vector *p_pen )
+/* Moves a bitmap glyph by the whole pixels of the pen, and returns its box */
+static void PlaceGlyph( FT_Glyph glyph, FT_BBox *p_bbox, const FT_Vector *p_pen )
+{
+    FT_BitmapGlyph glyph_bmp = (FT_BitmapGlyph)glyph;
+
+    glyph_bmp->left += p_pen->x >> 6;
+    glyph_bmp->top  += p_pen->y >> 6;
+    FT_Glyph_Get_CBox( glyph, ft_glyph_bbox_pixels, p_bbox );
+}
+
+static FT_Glyph CopyGlyph( FT_Glyph glyph )
+{
+    FT_Glyph copy;
+
+    if( !glyph || FT_Glyph_Copy( glyph, &copy ) )
+        return NULL;
+    return copy;
+}
+
+static int GetGlyph( filter_t *p_filter,
+                     FT_Glyph *pp_glyph,   FT_BBox *p_glyph_bbox,
+                     FT_Glyph *pp_outline, FT_BBox *p_outline_bbox,
+                     FT_Glyph *pp_shadow,  FT_BBox *p_shadow_bbox,
+                     FT_Vector *p_advance,
+
+                     FT_Face  p_face,
+                     bool b_default_face,
+                     const text_style_t *p_face_style,
+                     int i_outline_radius,
+                     int i_glyph_index,
+                     int i_style_flags,
+                     const FT_Vector *p_pen,
+                     const FT_Vector *p_pen_shadow )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    FT_Vector pen = {
+        .x = p_pen->x & 63,
+        .y = p_pen->y & 63,
+    };
+    FT_Vector pen_shadow = {
+        .x = p_pen_shadow->x & 63,
+        .y = p_pen_shadow->y & 63,
+    };
+
+    glyph_cache_key_t key;
+    memset( &key, 0, sizeof(key) );
+    key.i_glyph_index    = i_glyph_index;
+    key.i_font_width     = ( p_face_style->i_style_flags & STYLE_HALFWIDTH )
+                           ? p_face_style->i_font_size / 2
+                           : p_face_style->i_font_size;
+    key.i_font_size      = p_face_style->i_font_size;
+    key.i_style_flags    = i_style_flags & (STYLE_BOLD | STYLE_ITALIC);
+    key.i_default_face   = b_default_face;
+    key.i_outline_radius = p_sys->p_stroker ? i_outline_radius : 0;
+    key.i_shadow         = p_sys->style.i_shadow_alpha > 0;
+    key.pen_x            = pen.x;
+    key.pen_y            = pen.y;
+    key.pen_shadow_x     = pen_shadow.x;
+    key.pen_shadow_y     = pen_shadow.y;
+
+    const size_t i_fontname = strlen( p_face_style->psz_fontname ) + 1;
+    uint8_t p_key[sizeof(key) + i_fontname];
+    memcpy( p_key, &key, sizeof(key) );
+    memcpy( &p_key[sizeof(key)], p_face_style->psz_fontname, i_fontname );
+
+    glyph_cache_entry_t *p_cached = NULL;
+    if( p_sys->p_glyph_cache )
+        p_cached = TextCache_Get( p_sys->p_glyph_cache, p_key, sizeof(p_key) );
+
+    glyph_cache_entry_t entry;
+    if( p_cached )
+    {
+        entry.glyph = CopyGlyph( p_cached->glyph );
+        if( !entry.glyph )
+            return VLC_EGENERIC;
+        entry.outline = CopyGlyph( p_cached->outline );
+        entry.shadow  = CopyGlyph( p_cached->shadow );
+        entry.advance = p_cached->advance;
+    }
+    else
+    {
+        if( RenderGlyph( p_filter, &entry, p_face, i_glyph_index, i_style_flags,
+                         &pen, &pen_shadow ) )
+            return VLC_EGENERIC;
+
+        /* Keep the rendered bitmaps, and hand out copies */
+        glyph_cache_entry_t *p_new = p_sys->p_glyph_cache ? malloc( sizeof(*p_new) )
+                                                          : NULL;
+        if( p_new )
+        {
+            *p_new = entry;
+            entry.glyph = CopyGlyph( p_new->glyph );
+            if( !entry.glyph ||
+                TextCache_Put( p_sys->p_glyph_cache, p_key, sizeof(p_key), p_new,
+                               sizeof(*p_new) + GlyphCost( p_new->glyph ) +
+                               GlyphCost( p_new->outline ) +
+                               GlyphCost( p_new->shadow ) ) )
+            {
+                if( entry.glyph )
+                    FT_Done_Glyph( entry.glyph );
+                entry = *p_new;
+                free( p_new );
+            }
+            else
+            {
+                entry.outline = CopyGlyph( p_new->outline );
+                entry.shadow  = CopyGlyph( p_new->shadow );
+            }
+        }
+    }
+
+    PlaceGlyph( entry.glyph, p_glyph_bbox, p_pen );
+    if( entry.outline )
+        PlaceGlyph( entry.outline, p_outline_bbox, p_pen );
+    if( entry.shadow )
+        PlaceGlyph( entry.shadow, p_shadow_bbox, p_pen_shadow );
+
+    *pp_glyph   = entry.glyph;
+    *pp_outline = entry.outline;
+    *pp_shadow  = entry.shadow;
+    *p_advance  = entry.advance;
+    return VLC_SUCCESS;
+}
+
+static void FixGlyph( FT_Glyph glyph, FT_BBox *p_bbox, const FT_Vector *p_advance,
+                      const FT_Vector *p_pen )
 {
     FT_BitmapGlyph glyph_bmp = (FT_BitmapGlyph)glyph;
     if( p_bbox->xMin >= p_bbox->xMax )
     {
         p_bbox->xMin = FT_CEIL(p_pen->x);
-        p_bbox->xMax = FT_CEIL(p_pen->x + face->glyph->advance.x);
+        p_bbox->xMax = FT_CEIL(p_pen->x + p_advance->x);
         glyph_bmp->left = p_bbox->xMin;
     }
     if( p_bbox->yMin >= p_bbox->yMax )
     {
         p_bbox->yMax = FT_CEIL(p_pen->y);
-        p_bbox->yMin = FT_CEIL(p_pen->y + face->glyph->advance.y);
+        p_bbox->yMin = FT_CEIL(p_pen->y + p_advance->y);
         glyph_bmp->top  = p_bbox->yMax;
     }
 }
@@ -1148,11 +1322,137 @@ static void BBoxEnlarge( FT_BBox *p_max, const FT_BBox *p )
     p_max->yMax = __MAX(p_max->yMax, p->yMax);
 }
 
+/*****************************************************************************
+ * Line cache
+ *****************************************************************************
+ * Caches the laid out lines of a whole text, keyed by everything the layout
+ * depends upon. The cached lines are rendered directly and must not be
+ * modified nor freed by the caller.
+ *****************************************************************************/
+typedef struct
+{
+    line_desc_t *p_lines;
+    FT_BBox      bbox;
+    int          i_max_face_height;
+} line_cache_entry_t;
+
+typedef struct
+{
+    int i_length;
+    int i_width;
+    int i_height;
+    int i_outline_thickness;
+} line_cache_key_t;
+
+typedef struct
+{
+    int      i_font_size;
+    int      i_font_color;
+    unsigned i_font_alpha;
+    int      i_style_flags;
+    int      i_karaoke_background_color;
+    int      i_karaoke_background_alpha;
+    int      i_spacing;
+    /* followed by the font name */
+} line_cache_style_t;
+
+#define LINE_CACHE_KARAOKE 0x01
+#define LINE_CACHE_STYLE   0x02
+
+static void LineCacheEntryFree( void *p_data )
+{
+    line_cache_entry_t *p_entry = p_data;
+
+    FreeLines( p_entry->p_lines );
+    free( p_entry );
+}
+
+static size_t LinesCost( const line_desc_t *p_lines )
+{
+    size_t i_cost = 0;
+
+    for( const line_desc_t *p_line = p_lines; p_line != NULL; p_line = p_line->p_next )
+    {
+        i_cost += sizeof(*p_line);
+        for( int i = 0; i < p_line->i_character_count; i++ )
+        {
+            const line_character_t *ch = &p_line->p_character[i];
+            i_cost += sizeof(*ch) + GlyphCost( (FT_Glyph)ch->p_glyph ) +
+                      GlyphCost( (FT_Glyph)ch->p_outline ) +
+                      GlyphCost( (FT_Glyph)ch->p_shadow );
+        }
+    }
+    return i_cost;
+}
+
+/* Serializes the text, the styles, the karaoke state and the rendering
+ * parameters; a style is only written when it changes */
+static uint8_t *LineCacheKey( filter_t *p_filter, size_t *pi_key,
+                              const uni_char_t *psz_text,
+                              text_style_t *const *pp_styles,
+                              const uint32_t *pi_k_dates, int64_t i_elapsed,
+                              int i_len, int i_outline_thickness )
+{
+    size_t i_key = sizeof(line_cache_key_t) + i_len * (sizeof(*psz_text) + 1);
+    for( int i = 0; i < i_len; i++ )
+        if( i == 0 || pp_styles[i] != pp_styles[i - 1] )
+            i_key += sizeof(line_cache_style_t) +
+                     strlen( pp_styles[i]->psz_fontname ) + 1;
+
+    uint8_t *p_key = malloc( i_key );
+    if( !p_key )
+        return NULL;
+
+    line_cache_key_t key = {
+        .i_length            = i_len,
+        .i_width             = p_filter->fmt_out.video.i_visible_width,
+        .i_height            = p_filter->fmt_out.video.i_visible_height,
+        .i_outline_thickness = i_outline_thickness,
+    };
+    uint8_t *p = p_key;
+    memcpy( p, &key, sizeof(key) );
+    p += sizeof(key);
+    memcpy( p, psz_text, i_len * sizeof(*psz_text) );
+    p += i_len * sizeof(*psz_text);
+
+    for( int i = 0; i < i_len; i++ )
+    {
+        const text_style_t *p_style = pp_styles[i];
+        const bool b_new_style = i == 0 || p_style != pp_styles[i - 1];
+
+        *p++ = (pi_k_dates && pi_k_dates[i] >= i_elapsed ? LINE_CACHE_KARAOKE : 0) |
+               (b_new_style ? LINE_CACHE_STYLE : 0);
+        if( !b_new_style )
+            continue;
+
+        const line_cache_style_t style = {
+            .i_font_size                = p_style->i_font_size,
+            .i_font_color               = p_style->i_font_color,
+            .i_font_alpha               = p_style->i_font_alpha,
+            .i_style_flags              = p_style->i_style_flags,
+            .i_karaoke_background_color = p_style->i_karaoke_background_color,
+            .i_karaoke_background_alpha = p_style->i_karaoke_background_alpha,
+            .i_spacing                  = p_style->i_spacing,
+        };
+        const size_t i_fontname = strlen( p_style->psz_fontname ) + 1;
+        memcpy( p, &style, sizeof(style) );
+        p += sizeof(style);
+        memcpy( p, p_style->psz_fontname, i_fontname );
+        p += i_fontname;
+    }
+    assert( p == &p_key[i_key] );
+
+    *pi_key = i_key;
+    return p_key;
+}
+
 static int ProcessLines( filter_t *p_filter,
                          line_desc_t **pp_lines,
                          FT_BBox     *p_bbox,
                          int         *pi_max_face_height,
 
+                         bool        *pb_cached,
+
                          uni_char_t *psz_text,
                          text_style_t **pp_styles,
                          uint32_t *pi_k_dates,
@@ -1163,6 +1463,33 @@ static int ProcessLines( filter_t *p_filter,
     text_style_t   **pp_fribidi_styles = NULL;
     int            *p_new_positions = NULL;
 
+    const int i_outline_thickness = p_sys->p_stroker
+        ? var_InheritInteger( p_filter, "freetype-outline-thickness" ) : 0;
+    const int64_t i_elapsed = pi_k_dates
+        ? var_GetTime( p_filter, "spu-elapsed" ) / 1000 : 0;
+
+    /* Look for the same text already laid out */
+    *pb_cached = false;
+    size_t i_key = 0;
+    uint8_t *p_key = NULL;
+    if( p_sys->p_line_cache )
+        p_key = LineCacheKey( p_filter, &i_key, psz_text, pp_styles,
+                              pi_k_dates, i_elapsed, i_len, i_outline_thickness );
+    if( p_key )
+    {
+        const line_cache_entry_t *p_entry =
+            TextCache_Get( p_sys->p_line_cache, p_key, i_key );
+        if( p_entry )
+        {
+            free( p_key );
+            *pp_lines = p_entry->p_lines;
+            *p_bbox = p_entry->bbox;
+            *pi_max_face_height = p_entry->i_max_face_height;
+            *pb_cached = true;
+            return VLC_SUCCESS;
+        }
+    }
+
 #if defined(HAVE_FRIBIDI)
     {
         int    *p_old_positions;
@@ -1183,6 +1510,7 @@ static int ProcessLines( filter_t *p_filter,
             free( p_new_positions );
             free( p_fribidi_string );
             free( pp_fribidi_styles );
+            free( p_key );
             return VLC_ENOMEM;
         }
 
@@ -1237,7 +1565,6 @@ static int ProcessLines( filter_t *p_filter,
         pi_karaoke_bar = malloc( i_len * sizeof(*pi_karaoke_bar));
         if( pi_karaoke_bar )
         {
-            int64_t i_elapsed  = var_GetTime( p_filter, "spu-elapsed" ) / 1000;
             for( int i = 0; i < i_len; i++ )
             {
                 unsigned i_bar = p_new_positions ? p_new_positions[i] : i;
@@ -1261,6 +1588,7 @@ static int ProcessLines( filter_t *p_filter,
     int i_base_line = 0;
     const text_style_t *p_previous_style = NULL;
     FT_Face p_face = NULL;
+    int i_outline_radius = 0;
     for( int i_start = 0; i_start < i_len; )
     {
         /* Compute the length of the current text line */
@@ -1344,11 +1672,11 @@ static int ProcessLines( filter_t *p_filter,
                     msg_Err( p_filter, "Failed to set font size to %d", p_current_style->i_font_size );
                 if( p_sys->p_stroker )
                 {
-                    double f_outline_thickness = var_InheritInteger( p_filter, "freetype-outline-thickness" ) / 100.0;
+                    double f_outline_thickness = i_outline_thickness / 100.0;
                     f_outline_thickness = VLC_CLIP( f_outline_thickness, 0.0, 0.5 );
-                    int i_radius = (p_current_style->i_font_size << 6) * f_outline_thickness;
+                    i_outline_radius = (p_current_style->i_font_size << 6) * f_outline_thickness;
                     FT_Stroker_Set( p_sys->p_stroker,
-                                    i_radius,
+                                    i_outline_radius,
                                     FT_STROKER_LINECAP_ROUND,
                                     FT_STROKER_LINEJOIN_ROUND, 0 );
                 }
@@ -1418,20 +1746,24 @@ static int ProcessLines( filter_t *p_filter,
                 FT_BBox  outline_bbox;
                 FT_Glyph shadow;
                 FT_BBox  shadow_bbox;
+                FT_Vector glyph_advance;
 
                 if( GetGlyph( p_filter,
                               &glyph, &glyph_bbox,
                               &outline, &outline_bbox,
                               &shadow, &shadow_bbox,
-                              p_current_face, i_glyph_index, p_glyph_style->i_style_flags,
+                              &glyph_advance,
+                              p_current_face, p_face == NULL, p_current_style,
+                              i_outline_radius,
+                              i_glyph_index, p_glyph_style->i_style_flags,
                               &pen_new, &pen_shadow_new ) )
                     goto next;
 
-                FixGlyph( glyph, &glyph_bbox, p_current_face, &pen_new );
+                FixGlyph( glyph, &glyph_bbox, &glyph_advance, &pen_new );
                 if( outline )
-                    FixGlyph( outline, &outline_bbox, p_current_face, &pen_new );
+                    FixGlyph( outline, &outline_bbox, &glyph_advance, &pen_new );
                 if( shadow )
-                    FixGlyph( shadow, &shadow_bbox, p_current_face, &pen_shadow_new );
+                    FixGlyph( shadow, &shadow_bbox, &glyph_advance, &pen_shadow_new );
 
                 /* FIXME and what about outline */
 
@@ -1534,10 +1866,7 @@ static int ProcessLines( filter_t *p_filter,
                 /* the advance values from the last encountered base glyph,  */
                 /* since multiple diacritics may follow a single base glyph. */
                 if( !DIACRITIC( character ) )
-                {
-                    advance.x = p_current_face->glyph->advance.x;
-                    advance.y = p_current_face->glyph->advance.y;
-                }
+                    advance = glyph_advance;
 
                 pen.x = pen_new.x + advance.x;
                 pen.y = pen_new.y + advance.y;
@@ -1613,6 +1942,23 @@ static int ProcessLines( filter_t *p_filter,
     free( pi_karaoke_bar );
 
     *p_bbox = bbox;
+
+    if( p_key )
+    {
+        line_cache_entry_t *p_entry = malloc( sizeof(*p_entry) );
+        if( p_entry )
+        {
+            p_entry->p_lines = *pp_lines;
+            p_entry->bbox = bbox;
+            p_entry->i_max_face_height = *pi_max_face_height;
+            if( TextCache_Put( p_sys->p_line_cache, p_key, i_key, p_entry,
+                               sizeof(*p_entry) + LinesCost( *pp_lines ) ) )
+                free( p_entry );
+            else
+                *pb_cached = true;
+        }
+        free( p_key );
+    }
     return VLC_SUCCESS;
 }
 
@@ -1668,6 +2014,7 @@ static int RenderCommon( filter_t *p_filter, subpicture_region_t *p_region_out,
     FT_BBox bbox;
     int i_max_face_height;
     line_desc_t *p_lines = NULL;
+    bool b_lines_cached = false;
 
     uint32_t *pi_k_durations   = NULL;
 
@@ -1768,7 +2115,7 @@ static int RenderCommon( filter_t *p_filter, subpicture_region_t *p_region_out,
     if( !rv && i_text_length > 0 )
     {
         rv = ProcessLines( p_filter,
-                           &p_lines, &bbox, &i_max_face_height,
+                           &p_lines, &bbox, &i_max_face_height, &b_lines_cached,
                            psz_text, pp_styles, pi_k_durations, i_text_length );
     }
 
@@ -1823,7 +2170,8 @@ static int RenderCommon( filter_t *p_filter, subpicture_region_t *p_region_out,
             var_SetBool( p_filter, "text-rerender", true );
     }
 
-    FreeLines( p_lines );
+    if( !b_lines_cached )
+        FreeLines( p_lines );
 
     free( psz_text );
     for( int i = 0; i < i_text_length; i++ )
@@ -1936,6 +2284,8 @@ static int Create( vlc_object_t *p_this )
     p_sys->p_library        = 0;
     p_sys->style.i_font_size      = 0;
     p_sys->style.i_style_flags = 0;
+    p_sys->p_glyph_cache    = NULL;
+    p_sys->p_line_cache     = NULL;
 
     /*
      * The following variables should not be cached, as they might be changed on-the-fly:
@@ -2029,6 +2379,10 @@ static int Create( vlc_object_t *p_this )
     p_sys->pp_font_attachments = NULL;
     p_sys->i_font_attachments = 0;
 
+    /* The caches are optional */
+    p_sys->p_glyph_cache = TextCache_New( GLYPH_CACHE_SIZE, GlyphCacheEntryFree );
+    p_sys->p_line_cache = TextCache_New( LINE_CACHE_SIZE, LineCacheEntryFree );
+
     p_filter->pf_render_text = RenderText;
     p_filter->pf_render_html = RenderHtml;
 
@@ -2049,11 +2403,32 @@ error:
 }
 
 
+static void CacheStats( filter_t *p_filter, const char *psz_name,
+                        const text_cache_t *p_cache )
+{
+    uint64_t i_hits, i_misses;
+    size_t i_cost;
+
+    if( !p_cache )
+        return;
+    TextCache_GetStats( p_cache, &i_hits, &i_misses, &i_cost );
+    msg_Dbg( p_filter, "%s cache: %"PRIu64" hits, %"PRIu64" misses "
+             "(%.1f%% hit rate), %zu bytes used", psz_name, i_hits, i_misses,
+             i_hits + i_misses > 0 ? 100. * i_hits / (i_hits + i_misses) : 0.,
+             i_cost );
+}
+
 static void Destroy_FT( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
+    /* The cached glyphs belong to the library */
+    CacheStats( p_filter, "Line", p_sys->p_line_cache );
+    CacheStats( p_filter, "Glyph", p_sys->p_glyph_cache );
+    TextCache_Delete( p_sys->p_line_cache );
+    TextCache_Delete( p_sys->p_glyph_cache );
+
     if( p_sys->p_stroker )
         FT_Stroker_Done( p_sys->p_stroker );
     FT_Done_Face( p_sys->p_face );
@@ -0,0 +1,206 @@
+/*****************************************************************************
+ * text_cache.c : bounded LRU cache for the text renderers
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include "text_cache.h"
+
+#define TEXT_CACHE_BUCKETS 1024 /* power of 2 */
+
+typedef struct text_cache_entry_t text_cache_entry_t;
+struct text_cache_entry_t
+{
+    text_cache_entry_t *p_hash_next;
+    /* LRU list, the most recently used first */
+    text_cache_entry_t *p_prev;
+    text_cache_entry_t *p_next;
+
+    uint32_t            i_hash;
+    void               *p_value;
+    size_t              i_cost;
+    size_t              i_key;
+    uint8_t             p_key[];
+};
+
+struct text_cache_t
+{
+    text_cache_entry_t *pp_buckets[TEXT_CACHE_BUCKETS];
+    text_cache_entry_t *p_first;
+    text_cache_entry_t *p_last;
+
+    size_t              i_cost;
+    size_t              i_max_cost;
+    void              (*pf_free)( void * );
+
+    uint64_t            i_hits;
+    uint64_t            i_misses;
+};
+
+static uint32_t Hash( const uint8_t *p_key, size_t i_key )
+{
+    /* FNV-1a */
+    uint32_t i_hash = 2166136261u;
+    for( size_t i = 0; i < i_key; i++ )
+        i_hash = ( i_hash ^ p_key[i] ) * 16777619u;
+    return i_hash;
+}
+
+static text_cache_entry_t **Lookup( text_cache_t *p_cache, uint32_t i_hash,
+                                    const void *p_key, size_t i_key )
+{
+    text_cache_entry_t **pp_entry =
+        &p_cache->pp_buckets[i_hash & (TEXT_CACHE_BUCKETS - 1)];
+
+    for( ; *pp_entry != NULL; pp_entry = &(*pp_entry)->p_hash_next )
+    {
+        const text_cache_entry_t *p_entry = *pp_entry;
+        if( p_entry->i_hash == i_hash && p_entry->i_key == i_key &&
+            !memcmp( p_entry->p_key, p_key, i_key ) )
+            break;
+    }
+    return pp_entry;
+}
+
+static void Unlink( text_cache_t *p_cache, text_cache_entry_t *p_entry )
+{
+    if( p_entry->p_prev )
+        p_entry->p_prev->p_next = p_entry->p_next;
+    else
+        p_cache->p_first = p_entry->p_next;
+    if( p_entry->p_next )
+        p_entry->p_next->p_prev = p_entry->p_prev;
+    else
+        p_cache->p_last = p_entry->p_prev;
+}
+
+static void LinkFirst( text_cache_t *p_cache, text_cache_entry_t *p_entry )
+{
+    p_entry->p_prev = NULL;
+    p_entry->p_next = p_cache->p_first;
+    if( p_cache->p_first )
+        p_cache->p_first->p_prev = p_entry;
+    else
+        p_cache->p_last = p_entry;
+    p_cache->p_first = p_entry;
+}
+
+static void Remove( text_cache_t *p_cache, text_cache_entry_t *p_entry )
+{
+    text_cache_entry_t **pp_entry = Lookup( p_cache, p_entry->i_hash,
+                                            p_entry->p_key, p_entry->i_key );
+    *pp_entry = p_entry->p_hash_next;
+    Unlink( p_cache, p_entry );
+
+    p_cache->i_cost -= p_entry->i_cost;
+    p_cache->pf_free( p_entry->p_value );
+    free( p_entry );
+}
+
+text_cache_t *TextCache_New( size_t i_max_cost, void (*pf_free)( void * ) )
+{
+    text_cache_t *p_cache = calloc( 1, sizeof(*p_cache) );
+    if( !p_cache )
+        return NULL;
+
+    p_cache->i_max_cost = i_max_cost;
+    p_cache->pf_free = pf_free;
+    return p_cache;
+}
+
+void TextCache_Delete( text_cache_t *p_cache )
+{
+    if( !p_cache )
+        return;
+
+    for( text_cache_entry_t *p_entry = p_cache->p_first; p_entry != NULL; )
+    {
+        text_cache_entry_t *p_next = p_entry->p_next;
+        p_cache->pf_free( p_entry->p_value );
+        free( p_entry );
+        p_entry = p_next;
+    }
+    free( p_cache );
+}
+
+void *TextCache_Get( text_cache_t *p_cache, const void *p_key, size_t i_key )
+{
+    text_cache_entry_t *p_entry =
+        *Lookup( p_cache, Hash( p_key, i_key ), p_key, i_key );
+
+    if( !p_entry )
+    {
+        p_cache->i_misses++;
+        return NULL;
+    }
+    p_cache->i_hits++;
+
+    if( p_entry != p_cache->p_first )
+    {
+        Unlink( p_cache, p_entry );
+        LinkFirst( p_cache, p_entry );
+    }
+    return p_entry->p_value;
+}
+
+int TextCache_Put( text_cache_t *p_cache, const void *p_key, size_t i_key,
+                   void *p_value, size_t i_cost )
+{
+    if( i_cost > p_cache->i_max_cost )
+        return VLC_EGENERIC;
+
+    const uint32_t i_hash = Hash( p_key, i_key );
+    text_cache_entry_t *p_old = *Lookup( p_cache, i_hash, p_key, i_key );
+    if( p_old )
+        Remove( p_cache, p_old );
+
+    text_cache_entry_t *p_entry = malloc( sizeof(*p_entry) + i_key );
+    if( !p_entry )
+        return VLC_ENOMEM;
+
+    p_entry->i_hash = i_hash;
+    p_entry->p_value = p_value;
+    p_entry->i_cost = i_cost;
+    p_entry->i_key = i_key;
+    memcpy( p_entry->p_key, p_key, i_key );
+
+    /* Make room, the new entry excepted */
+    p_cache->i_cost += i_cost;
+    while( p_cache->i_cost > p_cache->i_max_cost )
+        Remove( p_cache, p_cache->p_last );
+
+    text_cache_entry_t **pp_bucket =
+        &p_cache->pp_buckets[i_hash & (TEXT_CACHE_BUCKETS - 1)];
+    p_entry->p_hash_next = *pp_bucket;
+    *pp_bucket = p_entry;
+    LinkFirst( p_cache, p_entry );
+    return VLC_SUCCESS;
+}
+
+void TextCache_GetStats( const text_cache_t *p_cache, uint64_t *pi_hits,
+                         uint64_t *pi_misses, size_t *pi_cost )
+{
+    *pi_hits = p_cache->i_hits;
+    *pi_misses = p_cache->i_misses;
+    *pi_cost = p_cache->i_cost;
+}
@@ -0,0 +1,40 @@
+/*****************************************************************************
+ * text_cache.h : bounded LRU cache for the text renderers
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Entries are keyed by an opaque byte string and weighted by a caller given
+ * cost (usually their size in bytes). The least recently used entries are
+ * released when the total cost goes over the limit. */
+
+typedef struct text_cache_t text_cache_t;
+
+text_cache_t *TextCache_New( size_t i_max_cost, void (*pf_free)( void * ) );
+void TextCache_Delete( text_cache_t * );
+
+/* Returns the value stored for the key, or NULL. The value remains owned by
+ * the cache, and valid until the next TextCache_Put() or TextCache_Delete() */
+void *TextCache_Get( text_cache_t *, const void *p_key, size_t i_key );
+
+/* Stores a value. On success, the cache owns the value; on error (out of
+ * memory or entry larger than the cache), the caller keeps it. */
+int TextCache_Put( text_cache_t *, const void *p_key, size_t i_key,
+                   void *p_value, size_t i_cost );
+
+void TextCache_GetStats( const text_cache_t *, uint64_t *pi_hits,
+                         uint64_t *pi_misses, size_t *pi_cost );
@@ -32,6 +32,7 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
+#include <vlc_modules.h>
 
 /*****************************************************************************
  * Module descriptor
@@ -68,11 +69,150 @@ static const vlc_fourcc_t pi_allowed_chromas[] = {
     0
 };
 
+/* Conversion a chain was built for */
+typedef struct
+{
+    vlc_fourcc_t        i_chroma_in;
+    vlc_fourcc_t        i_chroma_out;
+    video_orientation_t orientation_in;
+    video_orientation_t orientation_out;
+    unsigned            i_size_class;
+} chain_key_t;
+
+/* How the chain was built: the successful attempt of the builder, and the
+ * modules of its steps */
+typedef struct
+{
+    chain_key_t key;
+    int         i_attempt;
+    char        psz_module[2][32]; /* empty if none or a transform */
+    unsigned    i_used;
+} chain_plan_t;
+
 struct filter_sys_t
 {
     filter_chain_t *p_chain;
+    bool            b_replay;
+    chain_plan_t    replay; /* cached plan to build, if b_replay */
+    chain_plan_t    plan;   /* plan being built */
 };
 
+/*****************************************************************************
+ * Plan cache
+ *****************************************************************************
+ * The plan of the chains built for a conversion is kept process-wide, so
+ * that the next chain for the same conversion, typically after a resolution
+ * change, is built without probing the intermediate formats and modules.
+ *****************************************************************************/
+#define CACHE_SIZE 32
+
+static struct
+{
+    vlc_mutex_t  lock;
+    chain_plan_t plans[CACHE_SIZE];
+    unsigned     i_plans;
+    unsigned     i_clock;
+    unsigned     i_hits;
+    unsigned     i_misses;
+} cache = { .lock = VLC_STATIC_MUTEX, };
+
+static unsigned SizeAlign( unsigned i_size )
+{
+    return i_size ? __MIN( ctz( i_size ), 4 ) : 0;
+}
+
+/* Converters mostly depend on the alignment of the dimensions, and on the
+ * scaling direction */
+static unsigned SizeClass( const video_format_t *p_in,
+                           const video_format_t *p_out )
+{
+    unsigned i_scale = 0;
+
+    if( p_out->i_width > p_in->i_width || p_out->i_height > p_in->i_height )
+        i_scale |= 1;
+    if( p_out->i_width < p_in->i_width || p_out->i_height < p_in->i_height )
+        i_scale |= 2;
+
+    return SizeAlign( p_in->i_width ) | SizeAlign( p_in->i_height ) << 3 |
+           SizeAlign( p_out->i_width ) << 6 | SizeAlign( p_out->i_height ) << 9 |
+           i_scale << 12;
+}
+
+static void CacheKey( const filter_t *p_filter, chain_key_t *p_key )
+{
+    memset( p_key, 0, sizeof( *p_key ) );
+    p_key->i_chroma_in = p_filter->fmt_in.video.i_chroma;
+    p_key->i_chroma_out = p_filter->fmt_out.video.i_chroma;
+    p_key->orientation_in = p_filter->fmt_in.video.orientation;
+    p_key->orientation_out = p_filter->fmt_out.video.orientation;
+    p_key->i_size_class = SizeClass( &p_filter->fmt_in.video,
+                                     &p_filter->fmt_out.video );
+}
+
+static bool CacheLookup( const chain_key_t *p_key, chain_plan_t *p_plan )
+{
+    bool b_found = false;
+
+    vlc_mutex_lock( &cache.lock );
+    for( unsigned i = 0; i < cache.i_plans; i++ )
+    {
+        chain_plan_t *p = &cache.plans[i];
+        if( !memcmp( &p->key, p_key, sizeof( *p_key ) ) )
+        {
+            p->i_used = ++cache.i_clock;
+            *p_plan = *p;
+            b_found = true;
+            break;
+        }
+    }
+    vlc_mutex_unlock( &cache.lock );
+    return b_found;
+}
+
+static void CacheStore( const chain_plan_t *p_plan )
+{
+    vlc_mutex_lock( &cache.lock );
+    chain_plan_t *p_slot = NULL;
+    for( unsigned i = 0; i < cache.i_plans && !p_slot; i++ )
+        if( !memcmp( &cache.plans[i].key, &p_plan->key, sizeof( p_plan->key ) ) )
+            p_slot = &cache.plans[i];
+    if( !p_slot && cache.i_plans < CACHE_SIZE )
+        p_slot = &cache.plans[cache.i_plans++];
+    if( !p_slot )
+    {   /* Evict the least recently used plan */
+        p_slot = &cache.plans[0];
+        for( unsigned i = 1; i < CACHE_SIZE; i++ )
+            if( cache.plans[i].i_used < p_slot->i_used )
+                p_slot = &cache.plans[i];
+    }
+    *p_slot = *p_plan;
+    p_slot->i_used = ++cache.i_clock;
+    vlc_mutex_unlock( &cache.lock );
+}
+
+static void CacheCount( filter_t *p_filter, bool b_hit )
+{
+    vlc_mutex_lock( &cache.lock );
+    if( b_hit )
+        cache.i_hits++;
+    else
+        cache.i_misses++;
+    msg_Dbg( p_filter, "chain plan cache %s (%u hits, %u misses)",
+             b_hit ? "hit" : "miss", cache.i_hits, cache.i_misses );
+    vlc_mutex_unlock( &cache.lock );
+}
+
+/* Tells if the given attempt of a builder is to be tried */
+static bool Attempt( filter_t *p_filter, int i_attempt )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->b_replay && p_sys->replay.i_attempt != i_attempt )
+        return false;
+    p_sys->plan.i_attempt = i_attempt;
+    return true;
+}
+
 /*****************************************************************************
  * Buffer management
  *****************************************************************************/
@@ -122,14 +262,33 @@ static int Activate( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
-    if( b_transform )
-        i_ret = BuildTransformChain( p_filter );
-    else if( b_chroma && b_resize )
-        i_ret = BuildChromaResize( p_filter );
-    else if( b_chroma )
-        i_ret = BuildChromaChain( p_filter );
-    else
-        i_ret = VLC_EGENERIC;
+    CacheKey( p_filter, &p_sys->plan.key );
+    p_sys->b_replay = CacheLookup( &p_sys->plan.key, &p_sys->replay );
+
+    for( ;; )
+    {
+        if( b_transform )
+            i_ret = BuildTransformChain( p_filter );
+        else if( b_chroma && b_resize )
+            i_ret = BuildChromaResize( p_filter );
+        else if( b_chroma )
+            i_ret = BuildChromaChain( p_filter );
+        else
+            i_ret = VLC_EGENERIC;
+
+        if( !i_ret || !p_sys->b_replay )
+            break;
+        /* The modules may have changed, probe again */
+        msg_Dbg( p_filter, "cached chain plan failed" );
+        p_sys->b_replay = false;
+    }
+
+    if( !i_ret )
+    {
+        CacheCount( p_filter, p_sys->b_replay );
+        if( !p_sys->b_replay )
+            CacheStore( &p_sys->plan );
+    }
 
     if( i_ret )
     {
@@ -169,21 +328,27 @@ static int BuildTransformChain( filter_t *p_filter )
     int i_ret;
 
     /* Lets try transform first, then (potentially) resize+chroma */
-    msg_Dbg( p_filter, "Trying to build transform, then chroma+resize" );
-    es_format_Copy( &fmt_mid, &p_filter->fmt_in );
-    video_format_TransformTo(&fmt_mid.video, p_filter->fmt_out.video.orientation);
-    i_ret = CreateChain( p_filter, &fmt_mid, NULL );
-    es_format_Clean( &fmt_mid );
-    if( i_ret == VLC_SUCCESS )
-        return VLC_SUCCESS;
+    if( Attempt( p_filter, 0 ) )
+    {
+        msg_Dbg( p_filter, "Trying to build transform, then chroma+resize" );
+        es_format_Copy( &fmt_mid, &p_filter->fmt_in );
+        video_format_TransformTo(&fmt_mid.video, p_filter->fmt_out.video.orientation);
+        i_ret = CreateChain( p_filter, &fmt_mid, NULL );
+        es_format_Clean( &fmt_mid );
+        if( i_ret == VLC_SUCCESS )
+            return VLC_SUCCESS;
+    }
 
     /* Lets try resize+chroma first, then transform */
-    msg_Dbg( p_filter, "Trying to build chroma+resize" );
-    EsFormatMergeSize( &fmt_mid, &p_filter->fmt_out, &p_filter->fmt_in );
-    i_ret = CreateChain( p_filter, &fmt_mid, NULL );
-    es_format_Clean( &fmt_mid );
-    if( i_ret == VLC_SUCCESS )
-        return VLC_SUCCESS;
+    if( Attempt( p_filter, 1 ) )
+    {
+        msg_Dbg( p_filter, "Trying to build chroma+resize" );
+        EsFormatMergeSize( &fmt_mid, &p_filter->fmt_out, &p_filter->fmt_in );
+        i_ret = CreateChain( p_filter, &fmt_mid, NULL );
+        es_format_Clean( &fmt_mid );
+        if( i_ret == VLC_SUCCESS )
+            return VLC_SUCCESS;
+    }
 
     return VLC_EGENERIC;
 }
@@ -194,20 +359,26 @@ static int BuildChromaResize( filter_t *p_filter )
     int i_ret;
 
     /* Lets try resizing and then doing the chroma conversion */
-    msg_Dbg( p_filter, "Trying to build resize+chroma" );
-    EsFormatMergeSize( &fmt_mid, &p_filter->fmt_in, &p_filter->fmt_out );
-    i_ret = CreateChain( p_filter, &fmt_mid, NULL );
-    es_format_Clean( &fmt_mid );
-    if( i_ret == VLC_SUCCESS )
-        return VLC_SUCCESS;
+    if( Attempt( p_filter, 0 ) )
+    {
+        msg_Dbg( p_filter, "Trying to build resize+chroma" );
+        EsFormatMergeSize( &fmt_mid, &p_filter->fmt_in, &p_filter->fmt_out );
+        i_ret = CreateChain( p_filter, &fmt_mid, NULL );
+        es_format_Clean( &fmt_mid );
+        if( i_ret == VLC_SUCCESS )
+            return VLC_SUCCESS;
+    }
 
     /* Lets try it the other way arround (chroma and then resize) */
-    msg_Dbg( p_filter, "Trying to build chroma+resize" );
-    EsFormatMergeSize( &fmt_mid, &p_filter->fmt_out, &p_filter->fmt_in );
-    i_ret = CreateChain( p_filter, &fmt_mid, NULL );
-    es_format_Clean( &fmt_mid );
-    if( i_ret == VLC_SUCCESS )
-        return VLC_SUCCESS;
+    if( Attempt( p_filter, 1 ) )
+    {
+        msg_Dbg( p_filter, "Trying to build chroma+resize" );
+        EsFormatMergeSize( &fmt_mid, &p_filter->fmt_out, &p_filter->fmt_in );
+        i_ret = CreateChain( p_filter, &fmt_mid, NULL );
+        es_format_Clean( &fmt_mid );
+        if( i_ret == VLC_SUCCESS )
+            return VLC_SUCCESS;
+    }
 
     return VLC_EGENERIC;
 }
@@ -250,7 +421,8 @@ static int BuildChromaChain( filter_t *p_filter )
     {
         const vlc_fourcc_t i_chroma = pi_allowed_chromas[i];
         if( i_chroma == p_filter->fmt_in.i_codec ||
-            i_chroma == p_filter->fmt_out.i_codec )
+            i_chroma == p_filter->fmt_out.i_codec ||
+            !Attempt( p_filter, i ) )
             continue;
 
         msg_Dbg( p_filter, "Trying to use chroma %4.4s as middle man",
@@ -280,35 +452,66 @@ exit:
 /*****************************************************************************
  *
  *****************************************************************************/
+/* Gets the cached module of a step, if any */
+static const char *StepModule( filter_t *p_parent, int i_step )
+{
+    filter_sys_t *p_sys = p_parent->p_sys;
+
+    if( !p_sys->b_replay || !p_sys->replay.psz_module[i_step][0] )
+        return NULL;
+    return p_sys->replay.psz_module[i_step];
+}
+
+/* Remembers the module of a step */
+static void StepDone( filter_t *p_parent, int i_step, filter_t *p_filter,
+                      bool b_transform )
+{
+    char *psz_module = p_parent->p_sys->plan.psz_module[i_step];
+
+    psz_module[0] = '\0';
+    if( p_filter && !b_transform )
+        strlcpy( psz_module, module_get_object( p_filter->p_module ),
+                 sizeof( p_parent->p_sys->plan.psz_module[i_step] ) );
+}
+
 static int CreateChain( filter_t *p_parent, es_format_t *p_fmt_mid, config_chain_t *p_cfg )
 {
     filter_chain_Reset( p_parent->p_sys->p_chain, &p_parent->fmt_in, &p_parent->fmt_out );
 
     filter_t *p_filter;
+    bool b_transform;
 
-    if( p_parent->fmt_in.video.orientation != p_fmt_mid->video.orientation)
+    b_transform = p_parent->fmt_in.video.orientation != p_fmt_mid->video.orientation;
+    if( b_transform )
     {
         p_filter = AppendTransform( p_parent->p_sys->p_chain, &p_parent->fmt_in, p_fmt_mid );
     }
     else
     {
-        p_filter = filter_chain_AppendFilter( p_parent->p_sys->p_chain, NULL, p_cfg, NULL, p_fmt_mid );
+        p_filter = filter_chain_AppendFilter( p_parent->p_sys->p_chain,
+                                              StepModule( p_parent, 0 ),
+                                              p_cfg, NULL, p_fmt_mid );
     }
 
     if( !p_filter )
         return VLC_EGENERIC;
+    StepDone( p_parent, 0, p_filter, b_transform );
+    StepDone( p_parent, 1, NULL, false );
 
     //Check if first filter was enough (transform filter most likely):
     if( es_format_IsSimilar(&p_filter->fmt_out, &p_parent->fmt_out ))
        return VLC_SUCCESS;
 
-    if( p_fmt_mid->video.orientation != p_parent->fmt_out.video.orientation)
+    b_transform = p_fmt_mid->video.orientation != p_parent->fmt_out.video.orientation;
+    if( b_transform )
     {
         p_filter = AppendTransform( p_parent->p_sys->p_chain, p_fmt_mid, &p_parent->fmt_out );
     }
     else
     {
-        p_filter = filter_chain_AppendFilter( p_parent->p_sys->p_chain, NULL, p_cfg, p_fmt_mid, NULL );
+        p_filter = filter_chain_AppendFilter( p_parent->p_sys->p_chain,
+                                              StepModule( p_parent, 1 ),
+                                              p_cfg, p_fmt_mid, NULL );
     }
 
     if( !p_filter )
@@ -317,6 +520,7 @@ static int CreateChain( filter_t *p_parent, es_format_t *p_fmt_mid, config_chain
         filter_chain_Reset( p_parent->p_sys->p_chain, NULL, NULL );
         return VLC_EGENERIC;
     }
+    StepDone( p_parent, 1, p_filter, b_transform );
 
     return VLC_SUCCESS;
 }
@@ -0,0 +1,35 @@
+/*****************************************************************************
+ * d3d9_fmt.h: Direct3D9 surfaces of the video output pictures
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _VLC_VIDEOCHROMA_D3D9_FMT_H
+#define _VLC_VIDEOCHROMA_D3D9_FMT_H 1
+
+#include <d3d9.h>
+
+/* Pictures of the Direct3D9 video output. With the VLC_CODEC_D3D9_OPAQUE
+ * chroma, the surface belongs to the device of the video output, which the
+ * DXVA2 decoder shares to copy its surfaces into it on the GPU. */
+struct picture_sys_t
+{
+    LPDIRECT3DSURFACE9 surface;
+    picture_t          *fallback;
+};
+
+#endif
@@ -74,7 +74,12 @@ static int  Activate   ( vlc_object_t * );
 static void Deactivate ( vlc_object_t * );
 
 vlc_module_begin ()
-#if defined (SSE2)
+#if defined (AVX2)
+    set_description( N_( "AVX2 I420,IYUV,YV12 to "
+                        "RV15,RV16,RV24,RV32 conversions") )
+    set_capability( "video filter2", 130 )
+# define vlc_CPU_capable() vlc_CPU_AVX2()
+#elif defined (SSE2)
     set_description( N_( "SSE2 I420,IYUV,YV12 to "
                         "RV15,RV16,RV24,RV32 conversions") )
     set_capability( "video filter2", 120 )
@@ -112,6 +117,12 @@ static int Activate( vlc_object_t *p_this )
     {
         return VLC_EGENERIC;
     }
+#if defined (AVX2)
+    /* The last pixels of each line are converted again from 32 pixels
+     * before the end of the line */
+    if( p_filter->fmt_in.video.i_width < 32 )
+        return VLC_EGENERIC;
+#endif
 
     if( p_filter->fmt_in.video.orientation != p_filter->fmt_out.video.orientation )
     {
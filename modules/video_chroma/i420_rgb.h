@@ -21,7 +21,7 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
  *****************************************************************************/
 
-#if !defined (SSE2) && !defined (MMX)
+#if !defined (AVX2) && !defined (SSE2) && !defined (MMX)
 # define PLAIN
 #endif
 
@@ -31,7 +31,10 @@
 #include <vlc_cpu.h>
 
 #include "i420_rgb.h"
-#ifdef SSE2
+#if defined (AVX2)
+# include "i420_rgb_avx2.h"
+# define VLC_TARGET VLC_AVX2
+#elif defined (SSE2)
 # include "i420_rgb_sse2.h"
 # define VLC_TARGET VLC_SSE
 #else
@@ -150,7 +153,62 @@ void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     p_filter->fmt_out.video.i_height :
                     p_filter->fmt_in.video.i_height;
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    i_rewind = (-p_filter->fmt_in.video.i_width) & 31;
+
+    for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    {
+        p_pic_start = p_pic;
+        p_buffer = b_hscale ? p_buffer_start : p_pic;
+
+        for ( i_x = p_filter->fmt_in.video.i_width / 32; i_x--; )
+        {
+            AVX2_CALL (
+                AVX2_INIT
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_15
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            p_buffer += 32;
+        }
+
+        /* Here we do some unaligned reads and duplicate conversions, but
+         * at least we have all the pixels */
+        if( i_rewind )
+        {
+            p_y -= i_rewind;
+            p_u -= i_rewind >> 1;
+            p_v -= i_rewind >> 1;
+            p_buffer -= i_rewind;
+            AVX2_CALL (
+                AVX2_INIT
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_15
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+        }
+        SCALE_WIDTH;
+        SCALE_HEIGHT( 420, 2 );
+
+        p_y += i_source_margin;
+        if( i_y % 2 )
+        {
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+        }
+    }
+
+    /* avoid the AVX to SSE transition penalty */
+    AVX2_END;
+
+#elif defined (SSE2)
 
     i_rewind = (-p_filter->fmt_in.video.i_width) & 15;
 
@@ -380,7 +438,62 @@ void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     p_filter->fmt_out.video.i_height :
                     p_filter->fmt_in.video.i_height;
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    i_rewind = (-p_filter->fmt_in.video.i_width) & 31;
+
+    for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    {
+        p_pic_start = p_pic;
+        p_buffer = b_hscale ? p_buffer_start : p_pic;
+
+        for ( i_x = p_filter->fmt_in.video.i_width / 32; i_x--; )
+        {
+            AVX2_CALL (
+                AVX2_INIT
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_16
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            p_buffer += 32;
+        }
+
+        /* Here we do some unaligned reads and duplicate conversions, but
+         * at least we have all the pixels */
+        if( i_rewind )
+        {
+            p_y -= i_rewind;
+            p_u -= i_rewind >> 1;
+            p_v -= i_rewind >> 1;
+            p_buffer -= i_rewind;
+            AVX2_CALL (
+                AVX2_INIT
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_16
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+        }
+        SCALE_WIDTH;
+        SCALE_HEIGHT( 420, 2 );
+
+        p_y += i_source_margin;
+        if( i_y % 2 )
+        {
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+        }
+    }
+
+    /* avoid the AVX to SSE transition penalty */
+    AVX2_END;
+
+#elif defined (SSE2)
 
     i_rewind = (-p_filter->fmt_in.video.i_width) & 15;
 
@@ -609,7 +722,62 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
                     p_filter->fmt_out.video.i_height :
                     p_filter->fmt_in.video.i_height;
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    i_rewind = (-p_filter->fmt_in.video.i_width) & 31;
+
+    for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    {
+        p_pic_start = p_pic;
+        p_buffer = b_hscale ? p_buffer_start : p_pic;
+
+        for ( i_x = p_filter->fmt_in.video.i_width / 32; i_x--; )
+        {
+            AVX2_CALL (
+                AVX2_INIT
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_ARGB
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            p_buffer += 32;
+        }
+
+        /* Here we do some unaligned reads and duplicate conversions, but
+         * at least we have all the pixels */
+        if( i_rewind )
+        {
+            p_y -= i_rewind;
+            p_u -= i_rewind >> 1;
+            p_v -= i_rewind >> 1;
+            p_buffer -= i_rewind;
+            AVX2_CALL (
+                AVX2_INIT
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_ARGB
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+        }
+        SCALE_WIDTH;
+        SCALE_HEIGHT( 420, 4 );
+
+        p_y += i_source_margin;
+        if( i_y % 2 )
+        {
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+        }
+    }
+
+    /* avoid the AVX to SSE transition penalty */
+    AVX2_END;
+
+#elif defined (SSE2)
 
     i_rewind = (-p_filter->fmt_in.video.i_width) & 15;
 
@@ -837,7 +1005,62 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     p_filter->fmt_out.video.i_height :
                     p_filter->fmt_in.video.i_height;
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    i_rewind = (-p_filter->fmt_in.video.i_width) & 31;
+
+    for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    {
+        p_pic_start = p_pic;
+        p_buffer = b_hscale ? p_buffer_start : p_pic;
+
+        for ( i_x = p_filter->fmt_in.video.i_width / 32; i_x--; )
+        {
+            AVX2_CALL (
+                AVX2_INIT
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_RGBA
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            p_buffer += 32;
+        }
+
+        /* Here we do some unaligned reads and duplicate conversions, but
+         * at least we have all the pixels */
+        if( i_rewind )
+        {
+            p_y -= i_rewind;
+            p_u -= i_rewind >> 1;
+            p_v -= i_rewind >> 1;
+            p_buffer -= i_rewind;
+            AVX2_CALL (
+                AVX2_INIT
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_RGBA
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+        }
+        SCALE_WIDTH;
+        SCALE_HEIGHT( 420, 4 );
+
+        p_y += i_source_margin;
+        if( i_y % 2 )
+        {
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+        }
+    }
+
+    /* avoid the AVX to SSE transition penalty */
+    AVX2_END;
+
+#elif defined (SSE2)
 
     i_rewind = (-p_filter->fmt_in.video.i_width) & 15;
 
@@ -1065,7 +1288,62 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     p_filter->fmt_out.video.i_height :
                     p_filter->fmt_in.video.i_height;
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    i_rewind = (-p_filter->fmt_in.video.i_width) & 31;
+
+    for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    {
+        p_pic_start = p_pic;
+        p_buffer = b_hscale ? p_buffer_start : p_pic;
+
+        for ( i_x = p_filter->fmt_in.video.i_width / 32; i_x--; )
+        {
+            AVX2_CALL (
+                AVX2_INIT
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_BGRA
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            p_buffer += 32;
+        }
+
+        /* Here we do some unaligned reads and duplicate conversions, but
+         * at least we have all the pixels */
+        if( i_rewind )
+        {
+            p_y -= i_rewind;
+            p_u -= i_rewind >> 1;
+            p_v -= i_rewind >> 1;
+            p_buffer -= i_rewind;
+            AVX2_CALL (
+                AVX2_INIT
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_BGRA
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+        }
+        SCALE_WIDTH;
+        SCALE_HEIGHT( 420, 4 );
+
+        p_y += i_source_margin;
+        if( i_y % 2 )
+        {
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+        }
+    }
+
+    /* avoid the AVX to SSE transition penalty */
+    AVX2_END;
+
+#elif defined (SSE2)
 
     i_rewind = (-p_filter->fmt_in.video.i_width) & 15;
 
@@ -1290,7 +1568,62 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     p_filter->fmt_out.video.i_height :
                     p_filter->fmt_in.video.i_height;
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    i_rewind = (-p_filter->fmt_in.video.i_width) & 31;
+
+    for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    {
+        p_pic_start = p_pic;
+        p_buffer = b_hscale ? p_buffer_start : p_pic;
+
+        for ( i_x = p_filter->fmt_in.video.i_width / 32; i_x--; )
+        {
+            AVX2_CALL (
+                AVX2_INIT
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_ABGR
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+            p_buffer += 32;
+        }
+
+        /* Here we do some unaligned reads and duplicate conversions, but
+         * at least we have all the pixels */
+        if( i_rewind )
+        {
+            p_y -= i_rewind;
+            p_u -= i_rewind >> 1;
+            p_v -= i_rewind >> 1;
+            p_buffer -= i_rewind;
+            AVX2_CALL (
+                AVX2_INIT
+                AVX2_YUV_MUL
+                AVX2_YUV_ADD
+                AVX2_UNPACK_32_ABGR
+            );
+            p_y += 32;
+            p_u += 16;
+            p_v += 16;
+        }
+        SCALE_WIDTH;
+        SCALE_HEIGHT( 420, 4 );
+
+        p_y += i_source_margin;
+        if( i_y % 2 )
+        {
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+        }
+    }
+
+    /* avoid the AVX to SSE transition penalty */
+    AVX2_END;
+
+#elif defined (SSE2)
 
     i_rewind = (-p_filter->fmt_in.video.i_width) & 15;
 
@@ -0,0 +1,210 @@
+/*****************************************************************************
+ * i420_rgb_avx2.h: AVX2 YUV transformation intrinsics
+ *****************************************************************************
+ * Copyright (C) 1999-2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* This is the SSE2 intrinsics code working on 32 pixels at a time. The
+ * arithmetic is unchanged, so is the output.
+ *
+ * Most AVX2 instructions work within each 128-bit lane: the chroma samples
+ * are widened so that the low lane holds pixels 0-15 and the high lane
+ * pixels 16-31, and the 128-bit halves of the unpacked pixels are put back
+ * in order when they are stored. */
+
+#include <immintrin.h>
+
+#define AVX2_CALL(AVX2_INSTRUCTIONS)        \
+    do {                                    \
+        __m256i ymm0, ymm1, ymm2, ymm3,     \
+                ymm4, ymm5, ymm6, ymm7;     \
+        AVX2_INSTRUCTIONS                   \
+    } while(0)
+
+#define AVX2_END  _mm256_zeroupper()
+
+#define AVX2_INIT                                                       \
+    ymm0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *)p_u));       \
+    ymm1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *)p_v));       \
+    ymm6 = _mm256_loadu_si256((__m256i *)p_y);                          \
+    _mm_prefetch(p_buffer, _MM_HINT_NTA);
+
+#define AVX2_YUV_MUL                            \
+    ymm5 = _mm256_set1_epi32(0x00800080UL);     \
+    ymm0 = _mm256_subs_epi16(ymm0, ymm5);       \
+    ymm1 = _mm256_subs_epi16(ymm1, ymm5);       \
+    ymm0 = _mm256_slli_epi16(ymm0, 3);          \
+    ymm1 = _mm256_slli_epi16(ymm1, 3);          \
+    ymm2 = ymm0;                                \
+    ymm3 = ymm1;                                \
+    ymm5 = _mm256_set1_epi32(0xf37df37dUL);     \
+    ymm2 = _mm256_mulhi_epi16(ymm2, ymm5);      \
+    ymm5 = _mm256_set1_epi32(0xe5fce5fcUL);     \
+    ymm3 = _mm256_mulhi_epi16(ymm3, ymm5);      \
+    ymm5 = _mm256_set1_epi32(0x40934093UL);     \
+    ymm0 = _mm256_mulhi_epi16(ymm0, ymm5);      \
+    ymm5 = _mm256_set1_epi32(0x33123312UL);     \
+    ymm1 = _mm256_mulhi_epi16(ymm1, ymm5);      \
+    ymm2 = _mm256_adds_epi16(ymm2, ymm3);       \
+    \
+    ymm5 = _mm256_set1_epi32(0x10101010UL);     \
+    ymm6 = _mm256_subs_epu8(ymm6, ymm5);        \
+    ymm7 = ymm6;                                \
+    ymm5 = _mm256_set1_epi32(0x00ff00ffUL);     \
+    ymm6 = _mm256_and_si256(ymm6, ymm5);        \
+    ymm7 = _mm256_srli_epi16(ymm7, 8);          \
+    ymm6 = _mm256_slli_epi16(ymm6, 3);          \
+    ymm7 = _mm256_slli_epi16(ymm7, 3);          \
+    ymm5 = _mm256_set1_epi32(0x253f253fUL);     \
+    ymm6 = _mm256_mulhi_epi16(ymm6, ymm5);      \
+    ymm7 = _mm256_mulhi_epi16(ymm7, ymm5);
+
+#define AVX2_YUV_ADD                            \
+    ymm3 = ymm0;                                \
+    ymm4 = ymm1;                                \
+    ymm5 = ymm2;                                \
+    ymm0 = _mm256_adds_epi16(ymm0, ymm6);       \
+    ymm3 = _mm256_adds_epi16(ymm3, ymm7);       \
+    ymm1 = _mm256_adds_epi16(ymm1, ymm6);       \
+    ymm4 = _mm256_adds_epi16(ymm4, ymm7);       \
+    ymm2 = _mm256_adds_epi16(ymm2, ymm6);       \
+    ymm5 = _mm256_adds_epi16(ymm5, ymm7);       \
+    \
+    ymm0 = _mm256_packus_epi16(ymm0, ymm0);     \
+    ymm1 = _mm256_packus_epi16(ymm1, ymm1);     \
+    ymm2 = _mm256_packus_epi16(ymm2, ymm2);     \
+    \
+    ymm3 = _mm256_packus_epi16(ymm3, ymm3);     \
+    ymm4 = _mm256_packus_epi16(ymm4, ymm4);     \
+    ymm5 = _mm256_packus_epi16(ymm5, ymm5);     \
+    \
+    ymm0 = _mm256_unpacklo_epi8(ymm0, ymm3);    \
+    ymm1 = _mm256_unpacklo_epi8(ymm1, ymm4);    \
+    ymm2 = _mm256_unpacklo_epi8(ymm2, ymm5);
+
+/* lo holds pixels 0-7 and 16-23, hi pixels 8-15 and 24-31 */
+#define AVX2_STORE_16( lo, hi )                                         \
+    _mm256_storeu_si256((__m256i*)p_buffer,                             \
+                        _mm256_permute2x128_si256(lo, hi, 0x20));       \
+    _mm256_storeu_si256((__m256i*)(p_buffer+16),                        \
+                        _mm256_permute2x128_si256(lo, hi, 0x31));
+
+/* a holds pixels 0-3 and 16-19, b 4-7 and 20-23, c 8-11 and 24-27,
+ * d 12-15 and 28-31 */
+#define AVX2_STORE_32( a, b, c, d )                                     \
+    _mm256_storeu_si256((__m256i*)(p_buffer),                           \
+                        _mm256_permute2x128_si256(a, b, 0x20));         \
+    _mm256_storeu_si256((__m256i*)(p_buffer+8),                         \
+                        _mm256_permute2x128_si256(c, d, 0x20));         \
+    _mm256_storeu_si256((__m256i*)(p_buffer+16),                        \
+                        _mm256_permute2x128_si256(a, b, 0x31));         \
+    _mm256_storeu_si256((__m256i*)(p_buffer+24),                        \
+                        _mm256_permute2x128_si256(c, d, 0x31));
+
+#define AVX2_UNPACK_15                              \
+    ymm5 = _mm256_set1_epi32(0xf8f8f8f8UL);         \
+    ymm0 = _mm256_and_si256(ymm0, ymm5);            \
+    ymm0 = _mm256_srli_epi16(ymm0, 3);              \
+    ymm2 = _mm256_and_si256(ymm2, ymm5);            \
+    ymm1 = _mm256_and_si256(ymm1, ymm5);            \
+    ymm1 = _mm256_srli_epi16(ymm1, 1);              \
+    ymm4 = _mm256_setzero_si256();                  \
+    ymm5 = ymm0;                                    \
+    ymm7 = ymm2;                                    \
+    \
+    ymm2 = _mm256_unpacklo_epi8(ymm2, ymm4);        \
+    ymm0 = _mm256_unpacklo_epi8(ymm0, ymm1);        \
+    ymm2 = _mm256_slli_epi16(ymm2, 2);              \
+    ymm0 = _mm256_or_si256(ymm0, ymm2);             \
+    \
+    ymm7 = _mm256_unpackhi_epi8(ymm7, ymm4);        \
+    ymm5 = _mm256_unpackhi_epi8(ymm5, ymm1);        \
+    ymm7 = _mm256_slli_epi16(ymm7, 2);              \
+    ymm5 = _mm256_or_si256(ymm5, ymm7);             \
+    AVX2_STORE_16( ymm0, ymm5 )
+
+#define AVX2_UNPACK_16                              \
+    ymm5 = _mm256_set1_epi32(0xf8f8f8f8UL);         \
+    ymm0 = _mm256_and_si256(ymm0, ymm5);            \
+    ymm1 = _mm256_and_si256(ymm1, ymm5);            \
+    ymm5 = _mm256_set1_epi32(0xfcfcfcfcUL);         \
+    ymm2 = _mm256_and_si256(ymm2, ymm5);            \
+    ymm0 = _mm256_srli_epi16(ymm0, 3);              \
+    ymm4 = _mm256_setzero_si256();                  \
+    ymm5 = ymm0;                                    \
+    ymm7 = ymm2;                                    \
+    \
+    ymm2 = _mm256_unpacklo_epi8(ymm2, ymm4);        \
+    ymm0 = _mm256_unpacklo_epi8(ymm0, ymm1);        \
+    ymm2 = _mm256_slli_epi16(ymm2, 3);              \
+    ymm0 = _mm256_or_si256(ymm0, ymm2);             \
+    \
+    ymm7 = _mm256_unpackhi_epi8(ymm7, ymm4);        \
+    ymm5 = _mm256_unpackhi_epi8(ymm5, ymm1);        \
+    ymm7 = _mm256_slli_epi16(ymm7, 3);              \
+    ymm5 = _mm256_or_si256(ymm5, ymm7);             \
+    AVX2_STORE_16( ymm0, ymm5 )
+
+#define AVX2_UNPACK_32_ARGB                         \
+    ymm3 = _mm256_setzero_si256();                  \
+    ymm4 = _mm256_unpacklo_epi8(ymm0, ymm2);        \
+    ymm5 = _mm256_unpacklo_epi8(ymm1, ymm3);        \
+    ymm6 = _mm256_unpackhi_epi16(ymm4, ymm5);       \
+    ymm4 = _mm256_unpacklo_epi16(ymm4, ymm5);       \
+    ymm0 = _mm256_unpackhi_epi8(ymm0, ymm2);        \
+    ymm1 = _mm256_unpackhi_epi8(ymm1, ymm3);        \
+    ymm5 = _mm256_unpacklo_epi16(ymm0, ymm1);       \
+    ymm0 = _mm256_unpackhi_epi16(ymm0, ymm1);       \
+    AVX2_STORE_32( ymm4, ymm6, ymm5, ymm0 )
+
+#define AVX2_UNPACK_32_RGBA                         \
+    ymm3 = _mm256_setzero_si256();                  \
+    ymm4 = _mm256_unpacklo_epi8(ymm2, ymm1);        \
+    ymm3 = _mm256_unpacklo_epi8(ymm3, ymm0);        \
+    ymm5 = _mm256_unpackhi_epi16(ymm3, ymm4);       \
+    ymm3 = _mm256_unpacklo_epi16(ymm3, ymm4);       \
+    ymm6 = _mm256_setzero_si256();                  \
+    ymm2 = _mm256_unpackhi_epi8(ymm2, ymm1);        \
+    ymm6 = _mm256_unpackhi_epi8(ymm6, ymm0);        \
+    ymm0 = _mm256_unpackhi_epi16(ymm6, ymm2);       \
+    ymm6 = _mm256_unpacklo_epi16(ymm6, ymm2);       \
+    AVX2_STORE_32( ymm3, ymm5, ymm6, ymm0 )
+
+#define AVX2_UNPACK_32_BGRA                         \
+    ymm3 = _mm256_setzero_si256();                  \
+    ymm4 = _mm256_unpacklo_epi8(ymm2, ymm0);        \
+    ymm3 = _mm256_unpacklo_epi8(ymm3, ymm1);        \
+    ymm5 = _mm256_unpackhi_epi16(ymm3, ymm4);       \
+    ymm3 = _mm256_unpacklo_epi16(ymm3, ymm4);       \
+    ymm6 = _mm256_setzero_si256();                  \
+    ymm2 = _mm256_unpackhi_epi8(ymm2, ymm0);        \
+    ymm6 = _mm256_unpackhi_epi8(ymm6, ymm1);        \
+    ymm0 = _mm256_unpackhi_epi16(ymm6, ymm2);       \
+    ymm6 = _mm256_unpacklo_epi16(ymm6, ymm2);       \
+    AVX2_STORE_32( ymm3, ymm5, ymm6, ymm0 )
+
+#define AVX2_UNPACK_32_ABGR                         \
+    ymm3 = _mm256_setzero_si256();                  \
+    ymm4 = _mm256_unpacklo_epi8(ymm1, ymm2);        \
+    ymm5 = _mm256_unpacklo_epi8(ymm0, ymm3);        \
+    ymm6 = _mm256_unpackhi_epi16(ymm4, ymm5);       \
+    ymm4 = _mm256_unpacklo_epi16(ymm4, ymm5);       \
+    ymm1 = _mm256_unpackhi_epi8(ymm1, ymm2);        \
+    ymm0 = _mm256_unpackhi_epi8(ymm0, ymm3);        \
+    ymm2 = _mm256_unpackhi_epi16(ymm1, ymm0);       \
+    ymm1 = _mm256_unpacklo_epi16(ymm1, ymm0);       \
+    AVX2_STORE_32( ymm4, ymm6, ymm1, ymm2 )
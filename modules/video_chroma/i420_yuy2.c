@@ -52,6 +52,9 @@
 #elif defined (MODULE_NAME_IS_i420_yuy2_sse2)
 #    define DEST_FOURCC "YUY2,YUNV,YVYU,UYVY,UYNV,Y422,IUYV,cyuv"
 #    define VLC_TARGET VLC_SSE
+#elif defined (MODULE_NAME_IS_i420_yuy2_avx2)
+#    define DEST_FOURCC "YUY2,YUNV,YVYU,UYVY,UYNV,Y422"
+#    define VLC_TARGET VLC_AVX2
 #elif defined (MODULE_NAME_IS_i420_yuy2_altivec)
 #    define DEST_FOURCC "YUY2,YUNV,YVYU,UYVY,UYNV,Y422"
 #    define VLC_TARGET
@@ -68,7 +71,8 @@ static void I420_UYVY           ( filter_t *, picture_t *, picture_t * );
 static picture_t *I420_YUY2_Filter    ( filter_t *, picture_t * );
 static picture_t *I420_YVYU_Filter    ( filter_t *, picture_t * );
 static picture_t *I420_UYVY_Filter    ( filter_t *, picture_t * );
-#if !defined (MODULE_NAME_IS_i420_yuy2_altivec)
+#if !defined (MODULE_NAME_IS_i420_yuy2_altivec) \
+ && !defined (MODULE_NAME_IS_i420_yuy2_avx2)
 static void I420_IUYV           ( filter_t *, picture_t *, picture_t * );
 static void I420_cyuv           ( filter_t *, picture_t *, picture_t * );
 static picture_t *I420_IUYV_Filter    ( filter_t *, picture_t * );
@@ -101,6 +105,10 @@ vlc_module_begin ()
     set_description( N_("SSE2 conversions from " SRC_FOURCC " to " DEST_FOURCC) )
     set_capability( "video filter2", 250 )
 # define vlc_CPU_capable() vlc_CPU_SSE2()
+#elif defined (MODULE_NAME_IS_i420_yuy2_avx2)
+    set_description( N_("AVX2 conversions from " SRC_FOURCC " to " DEST_FOURCC) )
+    set_capability( "video filter2", 260 )
+# define vlc_CPU_capable() vlc_CPU_AVX2()
 #elif defined (MODULE_NAME_IS_i420_yuy2_altivec)
     set_description(
             _("AltiVec conversions from " SRC_FOURCC " to " DEST_FOURCC) );
@@ -149,7 +157,8 @@ static int Activate( vlc_object_t *p_this )
                 case VLC_CODEC_UYVY:
                     p_filter->pf_video_filter = I420_UYVY_Filter;
                     break;
-#if !defined (MODULE_NAME_IS_i420_yuy2_altivec)
+#if !defined (MODULE_NAME_IS_i420_yuy2_altivec) \
+ && !defined (MODULE_NAME_IS_i420_yuy2_avx2)
                 case VLC_FOURCC('I','U','Y','V'):
                     p_filter->pf_video_filter = I420_IUYV_Filter;
                     break;
@@ -192,7 +201,8 @@ static inline unsigned long long read_cycles(void)
 VIDEO_FILTER_WRAPPER( I420_YUY2 )
 VIDEO_FILTER_WRAPPER( I420_YVYU )
 VIDEO_FILTER_WRAPPER( I420_UYVY )
-#if !defined (MODULE_NAME_IS_i420_yuy2_altivec)
+#if !defined (MODULE_NAME_IS_i420_yuy2_altivec) \
+ && !defined (MODULE_NAME_IS_i420_yuy2_avx2)
 VIDEO_FILTER_WRAPPER( I420_IUYV )
 VIDEO_FILTER_WRAPPER( I420_cyuv )
 #endif
@@ -304,7 +314,8 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
     const int i_dest_margin = p_dest->p->i_pitch
                                - p_dest->p->i_visible_pitch;
 
-#if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
+#if !defined(MODULE_NAME_IS_i420_yuy2_sse2) \
+ && !defined(MODULE_NAME_IS_i420_yuy2_avx2)
     for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
@@ -349,6 +360,37 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
     }
 #endif
 
+#elif defined(MODULE_NAME_IS_i420_yuy2_avx2)
+    /*
+    ** AVX2 unaligned fetch and store instructions are as fast as the
+    ** aligned ones when the memory happens to be aligned
+    */
+    for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+    {
+        p_line1 = p_line2;
+        p_line2 += p_dest->p->i_pitch;
+
+        p_y1 = p_y2;
+        p_y2 += p_source->p[Y_PLANE].i_pitch;
+
+        for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
+        {
+            AVX2_CALL( AVX2_YUV420_YUYV );
+        }
+        for( i_x = ( p_filter->fmt_in.video.i_width % 32 ) / 2; i_x-- ; )
+        {
+            C_YUV420_YUYV( );
+        }
+
+        p_y1 += i_source_margin;
+        p_y2 += i_source_margin;
+        p_u += i_source_margin_c;
+        p_v += i_source_margin_c;
+        p_line1 += i_dest_margin;
+        p_line2 += i_dest_margin;
+    }
+    AVX2_END;
+
 #else // defined(MODULE_NAME_IS_i420_yuy2_sse2)
     /*
     ** SSE2 128 bits fetch/store instructions are faster
@@ -519,7 +561,8 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
     const int i_dest_margin = p_dest->p->i_pitch
                                - p_dest->p->i_visible_pitch;
 
-#if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
+#if !defined(MODULE_NAME_IS_i420_yuy2_sse2) \
+ && !defined(MODULE_NAME_IS_i420_yuy2_avx2)
     for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
@@ -561,6 +604,37 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
     }
 #endif
 
+#elif defined(MODULE_NAME_IS_i420_yuy2_avx2)
+    /*
+    ** AVX2 unaligned fetch and store instructions are as fast as the
+    ** aligned ones when the memory happens to be aligned
+    */
+    for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+    {
+        p_line1 = p_line2;
+        p_line2 += p_dest->p->i_pitch;
+
+        p_y1 = p_y2;
+        p_y2 += p_source->p[Y_PLANE].i_pitch;
+
+        for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
+        {
+            AVX2_CALL( AVX2_YUV420_YVYU );
+        }
+        for( i_x = ( p_filter->fmt_in.video.i_width % 32 ) / 2; i_x-- ; )
+        {
+            C_YUV420_YVYU( );
+        }
+
+        p_y1 += i_source_margin;
+        p_y2 += i_source_margin;
+        p_u += i_source_margin_c;
+        p_v += i_source_margin_c;
+        p_line1 += i_dest_margin;
+        p_line2 += i_dest_margin;
+    }
+    AVX2_END;
+
 #else // defined(MODULE_NAME_IS_i420_yuy2_sse2)
     /*
     ** SSE2 128 bits fetch/store instructions are faster
@@ -729,7 +803,8 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
     const int i_dest_margin = p_dest->p->i_pitch
                                - p_dest->p->i_visible_pitch;
 
-#if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
+#if !defined(MODULE_NAME_IS_i420_yuy2_sse2) \
+ && !defined(MODULE_NAME_IS_i420_yuy2_avx2)
     for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
@@ -771,6 +846,37 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
     }
 #endif
 
+#elif defined(MODULE_NAME_IS_i420_yuy2_avx2)
+    /*
+    ** AVX2 unaligned fetch and store instructions are as fast as the
+    ** aligned ones when the memory happens to be aligned
+    */
+    for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+    {
+        p_line1 = p_line2;
+        p_line2 += p_dest->p->i_pitch;
+
+        p_y1 = p_y2;
+        p_y2 += p_source->p[Y_PLANE].i_pitch;
+
+        for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
+        {
+            AVX2_CALL( AVX2_YUV420_UYVY );
+        }
+        for( i_x = ( p_filter->fmt_in.video.i_width % 32 ) / 2; i_x-- ; )
+        {
+            C_YUV420_UYVY( );
+        }
+
+        p_y1 += i_source_margin;
+        p_y2 += i_source_margin;
+        p_u += i_source_margin_c;
+        p_v += i_source_margin_c;
+        p_line1 += i_dest_margin;
+        p_line2 += i_dest_margin;
+    }
+    AVX2_END;
+
 #else // defined(MODULE_NAME_IS_i420_yuy2_sse2)
     /*
     ** SSE2 128 bits fetch/store instructions are faster
@@ -838,7 +944,8 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
 #endif // defined(MODULE_NAME_IS_i420_yuy2_sse2)
 }
 
-#if !defined (MODULE_NAME_IS_i420_yuy2_altivec)
+#if !defined (MODULE_NAME_IS_i420_yuy2_altivec) \
+ && !defined (MODULE_NAME_IS_i420_yuy2_avx2)
 /*****************************************************************************
  * I420_IUYV: planar YUV 4:2:0 to interleaved packed UYVY 4:2:2
  *****************************************************************************/
@@ -875,7 +982,8 @@ static void I420_cyuv( filter_t *p_filter, picture_t *p_source,
     const int i_dest_margin = p_dest->p->i_pitch
                                - p_dest->p->i_visible_pitch;
 
-#if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
+#if !defined(MODULE_NAME_IS_i420_yuy2_sse2) \
+ && !defined(MODULE_NAME_IS_i420_yuy2_avx2)
     for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
     {
         p_line1 -= 3 * p_dest->p->i_pitch;
@@ -979,7 +1087,7 @@ static void I420_cyuv( filter_t *p_filter, picture_t *p_source,
     SSE2_END;
 #endif // defined(MODULE_NAME_IS_i420_yuy2_sse2)
 }
-#endif // !defined (MODULE_NAME_IS_i420_yuy2_altivec)
+#endif // !altivec && !avx2
 
 /*****************************************************************************
  * I420_Y211: planar YUV 4:2:0 to packed YUYV 2:1:1
@@ -450,6 +450,67 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                               \n\
 
 #endif
 
+#elif defined( MODULE_NAME_IS_i420_yuy2_avx2 )
+
+/* AVX2 intrinsics */
+
+#include <immintrin.h>
+
+#define AVX2_CALL(AVX2_INSTRUCTIONS)            \
+    do {                                        \
+        __m256i ymm0, ymm1, ymm2, ymm3;         \
+        AVX2_INSTRUCTIONS                       \
+        p_line1 += 64; p_line2 += 64;           \
+        p_y1 += 32; p_y2 += 32;                 \
+        p_u += 16; p_v += 16;                   \
+    } while(0)
+
+#define AVX2_END  _mm256_zeroupper()
+
+/* The unpack instructions work within each 128-bit lane: put chroma samples
+ * 0-7 in the low lane and 8-15 in the high lane, then interleave them */
+#define AVX2_LOAD_CHROMA( p_a, p_b )                                        \
+    ymm0 = _mm256_castsi128_si256(_mm_loadu_si128((__m128i *)(p_a)));       \
+    ymm1 = _mm256_castsi128_si256(_mm_loadu_si128((__m128i *)(p_b)));       \
+    ymm0 = _mm256_permute4x64_epi64(ymm0, 0x50);                            \
+    ymm1 = _mm256_permute4x64_epi64(ymm1, 0x50);                            \
+    ymm0 = _mm256_unpacklo_epi8(ymm0, ymm1);
+
+/* The low unpack gives pixels 0-7 and 16-23, the high one pixels 8-15 and
+ * 24-31: reorder the 128-bit halves on store */
+#define AVX2_STORE_LINE( p_line )                                           \
+    _mm256_storeu_si256((__m256i*)(p_line),                                 \
+                        _mm256_permute2x128_si256(ymm2, ymm3, 0x20));       \
+    _mm256_storeu_si256((__m256i*)((p_line)+32),                            \
+                        _mm256_permute2x128_si256(ymm2, ymm3, 0x31));
+
+#define AVX2_LUMA_FIRST( p_line, p_y )                                      \
+    ymm1 = _mm256_loadu_si256((__m256i *)(p_y));                            \
+    ymm2 = _mm256_unpacklo_epi8(ymm1, ymm0);                                \
+    ymm3 = _mm256_unpackhi_epi8(ymm1, ymm0);                                \
+    AVX2_STORE_LINE( p_line )
+
+#define AVX2_CHROMA_FIRST( p_line, p_y )                                    \
+    ymm1 = _mm256_loadu_si256((__m256i *)(p_y));                            \
+    ymm2 = _mm256_unpacklo_epi8(ymm0, ymm1);                                \
+    ymm3 = _mm256_unpackhi_epi8(ymm0, ymm1);                                \
+    AVX2_STORE_LINE( p_line )
+
+#define AVX2_YUV420_YUYV                    \
+    AVX2_LOAD_CHROMA( p_u, p_v )            \
+    AVX2_LUMA_FIRST( p_line1, p_y1 )        \
+    AVX2_LUMA_FIRST( p_line2, p_y2 )
+
+#define AVX2_YUV420_YVYU                    \
+    AVX2_LOAD_CHROMA( p_v, p_u )            \
+    AVX2_LUMA_FIRST( p_line1, p_y1 )        \
+    AVX2_LUMA_FIRST( p_line2, p_y2 )
+
+#define AVX2_YUV420_UYVY                    \
+    AVX2_LOAD_CHROMA( p_u, p_v )            \
+    AVX2_CHROMA_FIRST( p_line1, p_y1 )      \
+    AVX2_CHROMA_FIRST( p_line2, p_y2 )
+
 #endif
 
 /* Used in both accelerated and C modules */
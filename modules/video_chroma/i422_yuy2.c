@@ -40,6 +40,8 @@
 #define SRC_FOURCC  "I422"
 #if defined (MODULE_NAME_IS_i422_yuy2)
 #    define DEST_FOURCC "YUY2,YUNV,YVYU,UYVY,UYNV,Y422,IUYV,cyuv,Y211"
+#elif defined (MODULE_NAME_IS_i422_yuy2_avx2)
+#    define DEST_FOURCC "YUY2,YUNV,YVYU,UYVY,UYNV,Y422"
 #else
 #    define DEST_FOURCC "YUY2,YUNV,YVYU,UYVY,UYNV,Y422,IUYV,cyuv"
 #endif
@@ -52,13 +54,15 @@ static int  Activate ( vlc_object_t * );
 static void I422_YUY2               ( filter_t *, picture_t *, picture_t * );
 static void I422_YVYU               ( filter_t *, picture_t *, picture_t * );
 static void I422_UYVY               ( filter_t *, picture_t *, picture_t * );
-static void I422_IUYV               ( filter_t *, picture_t *, picture_t * );
-static void I422_cyuv               ( filter_t *, picture_t *, picture_t * );
 static picture_t *I422_YUY2_Filter  ( filter_t *, picture_t * );
 static picture_t *I422_YVYU_Filter  ( filter_t *, picture_t * );
 static picture_t *I422_UYVY_Filter  ( filter_t *, picture_t * );
+#if !defined (MODULE_NAME_IS_i422_yuy2_avx2)
+static void I422_IUYV               ( filter_t *, picture_t *, picture_t * );
+static void I422_cyuv               ( filter_t *, picture_t *, picture_t * );
 static picture_t *I422_IUYV_Filter  ( filter_t *, picture_t * );
 static picture_t *I422_cyuv_Filter  ( filter_t *, picture_t * );
+#endif
 #if defined (MODULE_NAME_IS_i422_yuy2)
 static void I422_Y211               ( filter_t *, picture_t *, picture_t * );
 static picture_t *I422_Y211_Filter  ( filter_t *, picture_t * );
@@ -83,6 +87,11 @@ vlc_module_begin ()
     set_capability( "video filter2", 120 )
 # define vlc_CPU_capable() vlc_CPU_SSE2()
 # define VLC_TARGET VLC_SSE
+#elif defined (MODULE_NAME_IS_i422_yuy2_avx2)
+    set_description( N_("AVX2 conversions from " SRC_FOURCC " to " DEST_FOURCC) )
+    set_capability( "video filter2", 130 )
+# define vlc_CPU_capable() vlc_CPU_AVX2()
+# define VLC_TARGET VLC_AVX2
 #endif
     set_callbacks( Activate, NULL )
 vlc_module_end ()
@@ -126,6 +135,7 @@ static int Activate( vlc_object_t *p_this )
                     p_filter->pf_video_filter = I422_UYVY_Filter;
                     break;
 
+#if !defined (MODULE_NAME_IS_i422_yuy2_avx2)
                 case VLC_FOURCC('I','U','Y','V'):
                     p_filter->pf_video_filter = I422_IUYV_Filter;
                     break;
@@ -133,6 +143,7 @@ static int Activate( vlc_object_t *p_this )
                 case VLC_CODEC_CYUV:
                     p_filter->pf_video_filter = I422_cyuv_Filter;
                     break;
+#endif
 
 #if defined (MODULE_NAME_IS_i422_yuy2)
                 case VLC_CODEC_Y211:
@@ -156,8 +167,10 @@ static int Activate( vlc_object_t *p_this )
 VIDEO_FILTER_WRAPPER( I422_YUY2 )
 VIDEO_FILTER_WRAPPER( I422_YVYU )
 VIDEO_FILTER_WRAPPER( I422_UYVY )
+#if !defined (MODULE_NAME_IS_i422_yuy2_avx2)
 VIDEO_FILTER_WRAPPER( I422_IUYV )
 VIDEO_FILTER_WRAPPER( I422_cyuv )
+#endif
 #if defined (MODULE_NAME_IS_i422_yuy2)
 VIDEO_FILTER_WRAPPER( I422_Y211 )
 #endif
@@ -183,7 +196,26 @@ static void I422_YUY2( filter_t *p_filter, picture_t *p_source,
     const int i_dest_margin = p_dest->p->i_pitch
                                - p_dest->p->i_visible_pitch;
 
-#if defined (MODULE_NAME_IS_i422_yuy2_sse2)
+#if defined (MODULE_NAME_IS_i422_yuy2_avx2)
+
+    for( i_y = p_filter->fmt_in.video.i_height ; i_y-- ; )
+    {
+        for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
+        {
+            AVX2_CALL( AVX2_YUV422_YUYV );
+        }
+        for( i_x = ( p_filter->fmt_in.video.i_width % 32 ) / 2; i_x-- ; )
+        {
+            C_YUV422_YUYV( p_line, p_y, p_u, p_v );
+        }
+        p_y += i_source_margin;
+        p_u += i_source_margin_c;
+        p_v += i_source_margin_c;
+        p_line += i_dest_margin;
+    }
+    AVX2_END;
+
+#elif defined (MODULE_NAME_IS_i422_yuy2_sse2)
 
     if( 0 == (15 & (p_source->p[Y_PLANE].i_pitch|p_dest->p->i_pitch|
         ((intptr_t)p_line|(intptr_t)p_y))) )
@@ -277,7 +309,26 @@ static void I422_YVYU( filter_t *p_filter, picture_t *p_source,
     const int i_dest_margin = p_dest->p->i_pitch
                                - p_dest->p->i_visible_pitch;
 
-#if defined (MODULE_NAME_IS_i422_yuy2_sse2)
+#if defined (MODULE_NAME_IS_i422_yuy2_avx2)
+
+    for( i_y = p_filter->fmt_in.video.i_height ; i_y-- ; )
+    {
+        for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
+        {
+            AVX2_CALL( AVX2_YUV422_YVYU );
+        }
+        for( i_x = ( p_filter->fmt_in.video.i_width % 32 ) / 2; i_x-- ; )
+        {
+            C_YUV422_YVYU( p_line, p_y, p_u, p_v );
+        }
+        p_y += i_source_margin;
+        p_u += i_source_margin_c;
+        p_v += i_source_margin_c;
+        p_line += i_dest_margin;
+    }
+    AVX2_END;
+
+#elif defined (MODULE_NAME_IS_i422_yuy2_sse2)
 
     if( 0 == (15 & (p_source->p[Y_PLANE].i_pitch|p_dest->p->i_pitch|
         ((intptr_t)p_line|(intptr_t)p_y))) )
@@ -371,7 +422,26 @@ static void I422_UYVY( filter_t *p_filter, picture_t *p_source,
     const int i_dest_margin = p_dest->p->i_pitch
                                - p_dest->p->i_visible_pitch;
 
-#if defined (MODULE_NAME_IS_i422_yuy2_sse2)
+#if defined (MODULE_NAME_IS_i422_yuy2_avx2)
+
+    for( i_y = p_filter->fmt_in.video.i_height ; i_y-- ; )
+    {
+        for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
+        {
+            AVX2_CALL( AVX2_YUV422_UYVY );
+        }
+        for( i_x = ( p_filter->fmt_in.video.i_width % 32 ) / 2; i_x-- ; )
+        {
+            C_YUV422_UYVY( p_line, p_y, p_u, p_v );
+        }
+        p_y += i_source_margin;
+        p_u += i_source_margin_c;
+        p_v += i_source_margin_c;
+        p_line += i_dest_margin;
+    }
+    AVX2_END;
+
+#elif defined (MODULE_NAME_IS_i422_yuy2_sse2)
 
     if( 0 == (15 & (p_source->p[Y_PLANE].i_pitch|p_dest->p->i_pitch|
         ((intptr_t)p_line|(intptr_t)p_y))) )
@@ -444,6 +514,7 @@ static void I422_UYVY( filter_t *p_filter, picture_t *p_source,
 #endif
 }
 
+#if !defined (MODULE_NAME_IS_i422_yuy2_avx2)
 /*****************************************************************************
  * I422_IUYV: planar YUV 4:2:2 to interleaved packed IUYV 4:2:2
  *****************************************************************************/
@@ -553,6 +624,8 @@ static void I422_cyuv( filter_t *p_filter, picture_t *p_source,
 #endif
 }
 
+#endif // !defined (MODULE_NAME_IS_i422_yuy2_avx2)
+
 /*****************************************************************************
  * I422_Y211: planar YUV 4:2:2 to packed YUYV 2:1:1
  *****************************************************************************/
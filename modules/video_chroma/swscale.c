@@ -63,6 +63,11 @@ const char *const ppsz_mode_descriptions[] =
   N_("Area"), N_("Luma bicubic / chroma bilinear"), N_("Gauss"),
   N_("SincR"), N_("Lanczos"), N_("Bicubic spline") };
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_( \
+    "Number of threads used to scale large pictures in horizontal bands " \
+    "(0 for as many as the CPU count, 1 to disable).")
+
 vlc_module_begin ()
     set_description( N_("Video scaling filter") )
     set_shortname( N_("Swscale" ) )
@@ -72,6 +77,8 @@ vlc_module_begin ()
     set_callbacks( OpenScaler, CloseScaler )
     add_integer( "swscale-mode", 2, SCALEMODE_TEXT, SCALEMODE_LONGTEXT, true )
         change_integer_list( pi_mode_values, ppsz_mode_descriptions )
+    add_integer( "swscale-threads", 0, THREADS_TEXT, THREADS_LONGTEXT, true )
+        change_integer_range( 0, 16 )
 vlc_module_end ()
 
 /* Version checking */
@@ -80,6 +87,34 @@ vlc_module_end ()
  * Local prototypes
  ****************************************************************************/
 
+/**
+ * Horizontal band of the output picture.
+ *
+ * Each band has its own scaler context, taking the input lines needed for
+ * the band plus a margin on both sides, so that the scaling filter taps near
+ * the band edges see the same pixels as in a single pass. The margin lines
+ * are scaled into a scratch picture and only the band itself is copied out.
+ */
+typedef struct scaler_band scaler_band_t;
+struct scaler_band
+{
+    struct SwsContext *ctx;
+    picture_t *p_scratch;
+    unsigned i_in_start;  /* first input line (margin included) */
+    unsigned i_in_lines;
+    unsigned i_out_start; /* first output line of the band */
+    unsigned i_out_lines;
+    unsigned i_out_skip;  /* margin lines at the top of the scratch picture */
+
+    /* Current job */
+    filter_t *p_filter;
+    picture_t *p_src;
+    picture_t *p_dst;
+    scaler_band_t *p_next;
+};
+
+#define SCALER_BANDS_MAX (16)
+
 /**
  * Internal swscale filter structure.
  */
@@ -104,6 +139,12 @@ struct filter_sys_t
     bool b_copy;
     bool b_swap_uvi;
     bool b_swap_uvo;
+
+    unsigned i_threads;
+    unsigned i_bands;
+    scaler_band_t bands[SCALER_BANDS_MAX];
+    video_format_t fmt_band;
+    vlc_sem_t done;
 };
 
 static picture_t *Filter( filter_t *, picture_t * );
@@ -138,6 +179,14 @@ static int GetSwsCpuMask(void);
 /* XXX is it always 3 even for BIG_ENDIAN (blend.c seems to think so) ? */
 #define OFFSET_A (3)
 
+/* Smaller pictures are not worth splitting in bands */
+#define BAND_MIN_PIXELS (1280 * 720)
+/* Input lines of context around each band (per unit of downscaling) */
+#define BAND_MARGIN (8)
+
+static void PoolHold( unsigned );
+static void PoolRelease( void );
+
 /*****************************************************************************
  * OpenScaler: probe the filter and return score
  *****************************************************************************/
@@ -178,12 +227,24 @@ static int OpenScaler( vlc_object_t *p_this )
     default: p_sys->i_sws_flags = SWS_BICUBIC; i_sws_mode = 2; break;
     }
 
+    /* */
+    int i_threads = var_CreateGetInteger( p_filter, "swscale-threads" );
+    if( i_threads <= 0 )
+        i_threads = vlc_GetCPUCount();
+    p_sys->i_threads = __MIN( (unsigned)i_threads, SCALER_BANDS_MAX );
+    vlc_sem_init( &p_sys->done, 0 );
+    if( p_sys->i_threads > 1 )
+        PoolHold( p_sys->i_threads - 1 );
+
     /* Misc init */
     memset( &p_sys->fmt_in,  0, sizeof(p_sys->fmt_in) );
     memset( &p_sys->fmt_out, 0, sizeof(p_sys->fmt_out) );
 
     if( Init( p_filter ) )
     {
+        if( p_sys->i_threads > 1 )
+            PoolRelease();
+        vlc_sem_destroy( &p_sys->done );
         if( p_sys->p_filter )
             sws_freeFilter( p_sys->p_filter );
         free( p_sys );
@@ -193,14 +254,14 @@ static int OpenScaler( vlc_object_t *p_this )
     /* */
     p_filter->pf_video_filter = Filter;
 
-    msg_Dbg( p_filter, "%ix%i (%ix%i) chroma: %4.4s -> %ix%i (%ix%i) chroma: %4.4s with scaling using %s",
+    msg_Dbg( p_filter, "%ix%i (%ix%i) chroma: %4.4s -> %ix%i (%ix%i) chroma: %4.4s with scaling using %s (%u band(s))",
              p_filter->fmt_in.video.i_visible_width, p_filter->fmt_in.video.i_visible_height,
              p_filter->fmt_in.video.i_width, p_filter->fmt_in.video.i_height,
              (char *)&p_filter->fmt_in.video.i_chroma,
              p_filter->fmt_out.video.i_visible_width, p_filter->fmt_out.video.i_visible_height,
              p_filter->fmt_out.video.i_width, p_filter->fmt_out.video.i_height,
              (char *)&p_filter->fmt_out.video.i_chroma,
-             ppsz_mode_descriptions[i_sws_mode] );
+             ppsz_mode_descriptions[i_sws_mode], __MAX(p_sys->i_bands, 1) );
 
     return VLC_SUCCESS;
 }
@@ -214,6 +275,9 @@ static void CloseScaler( vlc_object_t *p_this )
     filter_sys_t *p_sys = p_filter->p_sys;
 
     Clean( p_filter );
+    if( p_sys->i_threads > 1 )
+        PoolRelease();
+    vlc_sem_destroy( &p_sys->done );
     if( p_sys->p_filter )
         sws_freeFilter( p_sys->p_filter );
     free( p_sys );
@@ -243,6 +307,145 @@ static int GetSwsCpuMask(void)
     return i_sws_cpu;
 }
 
+/*****************************************************************************
+ * Worker pool
+ *****************************************************************************
+ * All the scaler instances share the same worker threads. The thread calling
+ * the filter queues the bands of the picture, converts one itself, helps
+ * with whatever is still queued, and waits for the rest.
+ *****************************************************************************/
+static void ConvertBand( scaler_band_t * );
+
+static vlc_mutex_t pool_users_lock = VLC_STATIC_MUTEX;
+static unsigned pool_users = 0;
+
+static struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    scaler_band_t *p_first; /* queued bands */
+    bool b_quit;
+    unsigned i_threads;
+    vlc_thread_t threads[SCALER_BANDS_MAX];
+} pool = { VLC_STATIC_MUTEX, VLC_STATIC_COND, NULL, false, 0, { 0 } };
+
+/* Pops a queued band, with the pool lock held */
+static scaler_band_t *PoolPop( void )
+{
+    scaler_band_t *p_band = pool.p_first;
+    if( p_band )
+        pool.p_first = p_band->p_next;
+    return p_band;
+}
+
+static void RunBand( scaler_band_t *p_band )
+{
+    filter_sys_t *p_sys = p_band->p_filter->p_sys;
+
+    ConvertBand( p_band );
+    vlc_sem_post( &p_sys->done );
+}
+
+static void *PoolThread( void *data )
+{
+    (void)data;
+
+    vlc_mutex_lock( &pool.lock );
+    for( ;; )
+    {
+        while( pool.p_first == NULL && !pool.b_quit )
+            vlc_cond_wait( &pool.wait, &pool.lock );
+
+        scaler_band_t *p_band = PoolPop();
+        if( p_band == NULL )
+            break;
+        vlc_mutex_unlock( &pool.lock );
+        RunBand( p_band );
+        vlc_mutex_lock( &pool.lock );
+    }
+    vlc_mutex_unlock( &pool.lock );
+    return NULL;
+}
+
+/* The pool is started by its first user and stopped by its last one. Its
+ * size is set by the first user, any later one shares it as it is. */
+static void PoolHold( unsigned i_threads )
+{
+    vlc_mutex_lock( &pool_users_lock );
+    if( pool_users++ == 0 )
+    {
+        pool.b_quit = false;
+        pool.i_threads = 0;
+        for( unsigned i = 0; i < __MIN(i_threads, SCALER_BANDS_MAX); i++ )
+        {
+            if( vlc_clone( &pool.threads[pool.i_threads], PoolThread, NULL,
+                           VLC_THREAD_PRIORITY_VIDEO ) )
+                break;
+            pool.i_threads++;
+        }
+    }
+    vlc_mutex_unlock( &pool_users_lock );
+}
+
+static void PoolRelease( void )
+{
+    vlc_mutex_lock( &pool_users_lock );
+    assert( pool_users > 0 );
+    if( --pool_users == 0 )
+    {
+        vlc_mutex_lock( &pool.lock );
+        assert( pool.p_first == NULL );
+        pool.b_quit = true;
+        vlc_cond_broadcast( &pool.wait );
+        vlc_mutex_unlock( &pool.lock );
+
+        for( unsigned i = 0; i < pool.i_threads; i++ )
+            vlc_join( pool.threads[i], NULL );
+        pool.i_threads = 0;
+    }
+    vlc_mutex_unlock( &pool_users_lock );
+}
+
+/* Converts all the bands of a picture */
+static void ConvertBands( filter_t *p_filter, picture_t *p_dst,
+                          picture_t *p_src )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    for( unsigned i = 0; i < p_sys->i_bands; i++ )
+    {
+        scaler_band_t *p_band = &p_sys->bands[i];
+
+        p_band->p_filter = p_filter;
+        p_band->p_src = p_src;
+        p_band->p_dst = p_dst;
+    }
+
+    vlc_mutex_lock( &pool.lock );
+    for( unsigned i = 1; i < p_sys->i_bands; i++ )
+    {
+        p_sys->bands[i].p_next = pool.p_first;
+        pool.p_first = &p_sys->bands[i];
+    }
+    vlc_cond_broadcast( &pool.wait );
+    vlc_mutex_unlock( &pool.lock );
+
+    ConvertBand( &p_sys->bands[0] );
+
+    /* Do not sit idle while bands (ours or not) are still queued */
+    vlc_mutex_lock( &pool.lock );
+    for( scaler_band_t *p_band; (p_band = PoolPop()) != NULL; )
+    {
+        vlc_mutex_unlock( &pool.lock );
+        RunBand( p_band );
+        vlc_mutex_lock( &pool.lock );
+    }
+    vlc_mutex_unlock( &pool.lock );
+
+    for( unsigned i = 1; i < p_sys->i_bands; i++ )
+        vlc_sem_wait( &p_sys->done );
+}
+
 static void FixParameters( int *pi_fmt, bool *pb_has_a, bool *pb_swap_uv, vlc_fourcc_t fmt )
 {
     switch( fmt )
@@ -346,6 +549,106 @@ static int GetParameters( ScalerConfiguration *p_cfg,
     return VLC_SUCCESS;
 }
 
+/* Vertical subsampling of the chroma, bands must start on a chroma line */
+static unsigned GetVerticalAlign( const vlc_chroma_description_t *desc )
+{
+    unsigned i_align = 1;
+
+    for( unsigned i = 0; i < desc->plane_count; i++ )
+        i_align = __MAX( i_align, desc->p[i].h.den / desc->p[i].h.num );
+    return i_align;
+}
+
+static int InitBands( filter_t *p_filter, const ScalerConfiguration *p_cfg,
+                      unsigned i_width_in, unsigned i_width_out )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const video_format_t *p_fmti = &p_filter->fmt_in.video;
+    const video_format_t *p_fmto = &p_filter->fmt_out.video;
+    const unsigned i_in = p_fmti->i_visible_height;
+    const unsigned i_out = p_fmto->i_visible_height;
+
+    if( p_sys->i_threads < 2 || p_cfg->b_copy || p_sys->i_extend_factor != 1
+     || p_fmti->i_chroma == VLC_CODEC_RGBP
+     || (uint64_t)__MAX(i_width_in * i_in, i_width_out * i_out) < BAND_MIN_PIXELS )
+        return VLC_EGENERIC;
+
+    /* Band edges must fall on whole input, output and chroma lines */
+    const unsigned i_gcd = GCD( i_in, i_out );
+    const unsigned i_align_in = GetVerticalAlign( p_sys->desc_in );
+    const unsigned i_align_out = GetVerticalAlign( p_sys->desc_out );
+    unsigned i_step_in = i_in / i_gcd;
+    unsigned i_step_out = i_out / i_gcd;
+    unsigned k = 1;
+    while( (k * i_step_in) % i_align_in || (k * i_step_out) % i_align_out )
+        k++;
+    i_step_in *= k;
+    i_step_out *= k;
+
+    /* Margin, in steps, holding the filter taps of the edge lines */
+    const unsigned i_margin_lines = BAND_MARGIN * ((i_in + i_out - 1) / i_out);
+    const unsigned i_margin = (i_margin_lines + i_step_in - 1) / i_step_in;
+    const unsigned i_steps = i_out / i_step_out;
+    const unsigned i_count = __MIN( p_sys->i_threads, i_steps / (2 * i_margin) );
+    if( i_count < 2 )
+        return VLC_EGENERIC;
+
+    p_sys->fmt_band = *p_fmto;
+    p_sys->fmt_band.i_x_offset = 0;
+    p_sys->fmt_band.i_y_offset = 0;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        scaler_band_t *p_band = &p_sys->bands[i];
+        const unsigned i_first = i_steps * i / i_count;
+        const unsigned i_last = i_steps * (i + 1) / i_count;
+        const bool b_top = i == 0;
+        const bool b_bottom = i == i_count - 1;
+
+        const unsigned i_start = b_top ? 0 : i_first - __MIN(i_first, i_margin);
+        const unsigned i_end = i_last + i_margin;
+        const unsigned i_out_end = (b_bottom || i_end >= i_steps)
+                                 ? i_out : i_end * i_step_out;
+        const unsigned i_in_end = (b_bottom || i_end >= i_steps)
+                                ? i_in : i_end * i_step_in;
+
+        p_band->i_in_start = i_start * i_step_in;
+        p_band->i_in_lines = i_in_end - p_band->i_in_start;
+        p_band->i_out_start = i_first * i_step_out;
+        p_band->i_out_lines = (b_bottom ? i_out : i_last * i_step_out)
+                            - p_band->i_out_start;
+        p_band->i_out_skip = p_band->i_out_start - i_start * i_step_out;
+
+        const unsigned i_scratch_lines = i_out_end - i_start * i_step_out;
+        p_band->ctx = sws_getContext( i_width_in, p_band->i_in_lines, p_cfg->i_fmti,
+                                      i_width_out, i_scratch_lines, p_cfg->i_fmto,
+                                      p_cfg->i_sws_flags | p_sys->i_cpu_mask,
+                                      p_sys->p_filter, NULL, 0 );
+        p_band->p_scratch = picture_New( p_fmto->i_chroma, i_width_out,
+                                         i_scratch_lines, 0, 1 );
+        p_sys->i_bands++;
+        if( !p_band->ctx || !p_band->p_scratch )
+            return VLC_ENOMEM;
+    }
+    return VLC_SUCCESS;
+}
+
+static void CleanBands( filter_sys_t *p_sys )
+{
+    for( unsigned i = 0; i < p_sys->i_bands; i++ )
+    {
+        scaler_band_t *p_band = &p_sys->bands[i];
+
+        if( p_band->ctx )
+            sws_freeContext( p_band->ctx );
+        if( p_band->p_scratch )
+            picture_Release( p_band->p_scratch );
+        p_band->ctx = NULL;
+        p_band->p_scratch = NULL;
+    }
+    p_sys->i_bands = 0;
+}
+
 static int Init( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -357,7 +660,7 @@ static int Init( filter_t *p_filter )
 
     if( video_format_IsSimilar( p_fmti, &p_sys->fmt_in ) &&
         video_format_IsSimilar( p_fmto, &p_sys->fmt_out ) &&
-        p_sys->ctx )
+        ( p_sys->ctx || p_sys->i_bands > 0 ) )
     {
         return VLC_SUCCESS;
     }
@@ -407,6 +710,17 @@ static int Init( filter_t *p_filter )
         else
             p_sys->ctxA = ctx;
     }
+    if( InitBands( p_filter, &cfg, i_fmti_visible_width, i_fmto_visible_width ) == VLC_ENOMEM )
+    {
+        msg_Warn( p_filter, "could not init SwScaler bands" );
+        CleanBands( p_sys );
+    }
+    else if( p_sys->i_bands > 0 )
+    {
+        /* The bands replace the whole picture context */
+        sws_freeContext( p_sys->ctx );
+        p_sys->ctx = NULL;
+    }
     if( p_sys->ctxA )
     {
         p_sys->p_src_a = picture_New( VLC_CODEC_GREY, i_fmti_visible_width, p_fmti->i_visible_height, 0, 1 );
@@ -423,7 +737,7 @@ static int Init( filter_t *p_filter )
             memset( p_sys->p_dst_e->p[0].p_pixels, 0, p_sys->p_dst_e->p[0].i_pitch * p_sys->p_dst_e->p[0].i_lines );
     }
 
-    if( !p_sys->ctx ||
+    if( ( !p_sys->ctx && p_sys->i_bands == 0 ) ||
         ( cfg.b_has_a && ( !p_sys->ctxA || !p_sys->p_src_a || !p_sys->p_dst_a ) ) ||
         ( p_sys->i_extend_factor != 1 && ( !p_sys->p_src_e || !p_sys->p_dst_e ) ) )
     {
@@ -481,6 +795,7 @@ static void Clean( filter_t *p_filter )
 
     if( p_sys->ctx )
         sws_freeContext( p_sys->ctx );
+    CleanBands( p_sys );
 
     /* We have to set it to null has we call be called again :( */
     p_sys->ctx = NULL;
@@ -615,6 +930,54 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
 #endif
 }
 
+/* First line of a plane for a given picture line (rounding down), or end of
+ * the plane lines (rounding up) */
+static unsigned PlaneLine( const vlc_chroma_description_t *desc, unsigned i,
+                           unsigned y, bool b_up )
+{
+    return (y * desc->p[i].h.num + (b_up ? desc->p[i].h.den - 1 : 0))
+           / desc->p[i].h.den;
+}
+
+static void ConvertBand( scaler_band_t *p_band )
+{
+    filter_t *p_filter = p_band->p_filter;
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const vlc_chroma_description_t *desc = p_sys->desc_out;
+    const unsigned i_width = p_filter->fmt_out.video.i_visible_width;
+    uint8_t *src[4]; int src_stride[4];
+    uint8_t *tmp[4]; int tmp_stride[4];
+    uint8_t *dst[4]; int dst_stride[4];
+
+    GetPixels( src, src_stride, p_sys->desc_in, &p_filter->fmt_in.video,
+               p_band->p_src, 3, p_sys->b_swap_uvi );
+    for( unsigned i = 0; i < 4 && src[i] != NULL; i++ )
+        src[i] += PlaneLine( p_sys->desc_in, i, p_band->i_in_start, false )
+                  * src_stride[i];
+
+    GetPixels( tmp, tmp_stride, desc, &p_sys->fmt_band,
+               p_band->p_scratch, 3, p_sys->b_swap_uvo );
+    sws_scale( p_band->ctx, src, src_stride, 0, p_band->i_in_lines,
+               tmp, tmp_stride );
+
+    /* Copy the band itself, without the margins */
+    GetPixels( dst, dst_stride, desc, &p_filter->fmt_out.video,
+               p_band->p_dst, 3, p_sys->b_swap_uvo );
+    const unsigned i_end = p_band->i_out_start + p_band->i_out_lines;
+    for( unsigned i = 0; i < 4 && dst[i] != NULL; i++ )
+    {
+        const unsigned i_first = PlaneLine( desc, i, p_band->i_out_start, false );
+        const unsigned i_lines = PlaneLine( desc, i, i_end, true ) - i_first;
+        const unsigned i_skip = PlaneLine( desc, i, p_band->i_out_skip, false );
+        const size_t i_size = desc->pixel_size *
+            ((i_width * desc->p[i].w.num + desc->p[i].w.den - 1) / desc->p[i].w.den);
+
+        for( unsigned y = 0; y < i_lines; y++ )
+            memcpy( &dst[i][(i_first + y) * dst_stride[i]],
+                    &tmp[i][(i_skip + y) * tmp_stride[i]], i_size );
+    }
+}
+
 /****************************************************************************
  * Filter: the whole thing
  ****************************************************************************
@@ -657,6 +1020,8 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         picture_CopyPixels( p_dst, p_src );
     else if( p_sys->b_copy )
         SwapUV( p_dst, p_src );
+    else if( p_sys->i_bands > 0 )
+        ConvertBands( p_filter, p_dst, p_src );
     else
         Convert( p_filter, p_sys->ctx, p_dst, p_src, p_fmti->i_visible_height,
                  3, p_sys->b_swap_uvi, p_sys->b_swap_uvo );
@@ -38,6 +38,7 @@
 
 #include <vlc_filter.h>
 #include "filter_picture.h"
+#include "bands.h"
 
 #include "adjust_sat_hue.h"
 
@@ -47,6 +48,9 @@
 
 #define eight_times( x )    x x x x x x x x
 
+/* Minimum number of lines of a band */
+#define BAND_MIN_LINES (64)
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -77,6 +81,9 @@ static int AdjustCallback( vlc_object_t *p_this, char const *psz_var,
 #define LUM_LONGTEXT N_("Set the image brightness, between 0 and 2. Defaults to 1.")
 #define GAMMA_TEXT N_("Image gamma (0-10)")
 #define GAMMA_LONGTEXT N_("Set the image gamma, between 0.01 and 10. Defaults to 1.")
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads, each filtering a band of " \
+        "the picture (0 for the number of CPUs). Small pictures are not split.")
 
 vlc_module_begin ()
     set_description( N_("Image properties filter") )
@@ -103,6 +110,8 @@ vlc_module_begin ()
     add_bool( "brightness-threshold", false,
               THRES_TEXT, THRES_LONGTEXT, false )
         change_safe()
+    add_integer_with_range( "adjust-threads", 0, 0, BANDS_THREADS_MAX,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
 
     add_shortcut( "adjust" )
     set_callbacks( Create, Destroy )
@@ -110,12 +119,14 @@ vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
     "contrast", "brightness", "hue", "saturation", "gamma",
-    "brightness-threshold", NULL
+    "brightness-threshold", "adjust-threads", NULL
 };
 
 /*****************************************************************************
  * filter_sys_t: adjust filter method descriptor
  *****************************************************************************/
+typedef int (*sat_hue_t)( picture_t *, picture_t *, int, int, int, int, int );
+
 struct filter_sys_t
 {
     vlc_mutex_t lock;
@@ -125,12 +136,77 @@ struct filter_sys_t
     float f_saturation;
     float f_gamma;
     bool  b_brightness_threshold;
-    int (*pf_process_sat_hue)( picture_t *, picture_t *, int, int, int,
-                               int, int );
-    int (*pf_process_sat_hue_clip)( picture_t *, picture_t *, int, int,
-                                    int, int, int );
+
+    /* Derived from the parameters, when they change */
+    uint8_t pi_luma[256];
+    int i_sin, i_cos, i_sat, i_x, i_y;
+
+    sat_hue_t pf_process_sat_hue;
+    sat_hue_t pf_process_sat_hue_clip;
+    bands_sys_t bands;
 };
 
+/*****************************************************************************
+ * AdjustUpdate: computes the luma table and the hue/saturation coefficients
+ *****************************************************************************
+ * Called with the lock held, whenever a parameter changes.
+ *****************************************************************************/
+static void AdjustUpdate( filter_sys_t *p_sys )
+{
+    int32_t i_cont = lroundf( p_sys->f_contrast * 255.f );
+    int32_t i_lum = lroundf( (p_sys->f_brightness - 1.f) * 255.f );
+    float f_hue = p_sys->f_hue * (float)(M_PI / 180.);
+    int i_sat = (int)( p_sys->f_saturation * 256.f );
+    float f_gamma = 1.f / p_sys->f_gamma;
+
+    /*
+     * Threshold mode drops out everything about luma, contrast and gamma.
+     */
+    if( !p_sys->b_brightness_threshold )
+    {
+        uint8_t pi_gamma[256];
+
+        /* Contrast is a fast but kludged function, so I put this gap to be
+         * cleaner :) */
+        i_lum += 128 - i_cont / 2;
+
+        /* Fill the gamma lookup table */
+        for( unsigned i = 0 ; i < 256 ; i++ )
+        {
+            pi_gamma[ i ] = clip_uint8_vlc( powf(i / 255.f, f_gamma) * 255.f);
+        }
+
+        /* Fill the luma lookup table */
+        for( unsigned i = 0 ; i < 256 ; i++ )
+        {
+            p_sys->pi_luma[ i ] =
+                pi_gamma[clip_uint8_vlc( i_lum + i_cont * i / 256)];
+        }
+    }
+    else
+    {
+        /*
+         * We get luma as threshold value: the higher it is, the darker is
+         * the image. Should I reverse this?
+         */
+        for( int i = 0 ; i < 256 ; i++ )
+        {
+            p_sys->pi_luma[ i ] = (i < i_lum) ? 0 : 255;
+        }
+
+        /*
+         * Desaturates image to avoid that strange yellow halo...
+         */
+        i_sat = 0;
+    }
+
+    p_sys->i_sat = i_sat;
+    p_sys->i_sin = sinf(f_hue) * 256.f;
+    p_sys->i_cos = cosf(f_hue) * 256.f;
+    p_sys->i_x = ( cosf(f_hue) + sinf(f_hue) ) * 32768.f;
+    p_sys->i_y = ( cosf(f_hue) - sinf(f_hue) ) * 32768.f;
+}
+
 /*****************************************************************************
  * Create: allocates adjust video filter
  *****************************************************************************/
@@ -163,6 +239,7 @@ static int Create( vlc_object_t *p_this )
     p_sys->f_gamma = var_CreateGetFloatCommand( p_filter, "gamma" );
     p_sys->b_brightness_threshold =
         var_CreateGetBoolCommand( p_filter, "brightness-threshold" );
+    AdjustUpdate( p_sys );
 
     /* Choose Planar/Packed function and pointer to a Hue/Saturation processing
      * function*/
@@ -173,6 +250,13 @@ static int Create( vlc_object_t *p_this )
             p_filter->pf_video_filter = FilterPlanar;
             p_sys->pf_process_sat_hue_clip = planar_sat_hue_clip_C;
             p_sys->pf_process_sat_hue = planar_sat_hue_C;
+#ifdef HAVE_SSE2_INTRINSICS
+            if( vlc_CPU_SSE2() )
+            {
+                p_sys->pf_process_sat_hue_clip = planar_sat_hue_SSE2;
+                p_sys->pf_process_sat_hue = planar_sat_hue_SSE2;
+            }
+#endif
             break;
 
         CASE_PACKED_YUV_422
@@ -185,9 +269,15 @@ static int Create( vlc_object_t *p_this )
         default:
             msg_Err( p_filter, "Unsupported input chroma (%4.4s)",
                      (char*)&(p_filter->fmt_in.video.i_chroma) );
+            free( p_sys );
             return VLC_EGENERIC;
     }
 
+    unsigned i_threads = var_InheritInteger( p_filter, "adjust-threads" );
+    if( i_threads == 0 )
+        i_threads = vlc_GetCPUCount();
+    BandsInit( &p_sys->bands, VLC_CLIP( i_threads, 1, BANDS_THREADS_MAX ) );
+
     vlc_mutex_init( &p_sys->lock );
     var_AddCallback( p_filter, "contrast",   AdjustCallback, p_sys );
     var_AddCallback( p_filter, "brightness", AdjustCallback, p_sys );
@@ -216,95 +306,107 @@ static void Destroy( vlc_object_t *p_this )
     var_DelCallback( p_filter, "brightness-threshold",
                                              AdjustCallback, p_sys );
 
+    BandsClean( &p_sys->bands );
     vlc_mutex_destroy( &p_sys->lock );
     free( p_sys );
 }
 
 /*****************************************************************************
- * Run the filter on a Planar YUV picture
+ * Bands of a picture
  *****************************************************************************/
-static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
+typedef struct
 {
-    int pi_luma[256];
-    int pi_gamma[256];
-
+    picture_t *p_pic;
     picture_t *p_outpic;
-    uint8_t *p_in, *p_in_end, *p_line_end;
-    uint8_t *p_out;
-
-    filter_sys_t *p_sys = p_filter->p_sys;
-
-    if( !p_pic ) return NULL;
-
-    p_outpic = filter_NewPicture( p_filter );
-    if( !p_outpic )
+    void (*pf_luma)( const uint8_t *, plane_t *, const plane_t *, int );
+    int i_y_offset;
+    sat_hue_t pf_sat_hue;
+
+    /* Snapshot of the derived parameters */
+    uint8_t pi_luma[256];
+    int i_sin, i_cos, i_sat, i_x, i_y;
+} adjust_job_t;
+
+/* Describes the lines of band i_band out of i_bands, in each plane */
+static void BandPicture( picture_t *p_band, const picture_t *p_pic,
+                         unsigned i_band, unsigned i_bands )
+{
+    p_band->format = p_pic->format;
+    p_band->i_planes = p_pic->i_planes;
+    for( int i = 0; i < p_pic->i_planes; i++ )
     {
-        picture_Release( p_pic );
-        return NULL;
+        const plane_t *p_plane = &p_pic->p[i];
+        int i_start = p_plane->i_visible_lines * i_band / i_bands;
+        int i_end = p_plane->i_visible_lines * (i_band + 1) / i_bands;
+
+        p_band->p[i] = *p_plane;
+        p_band->p[i].p_pixels += i_start * p_plane->i_pitch;
+        p_band->p[i].i_lines = i_end - i_start;
+        p_band->p[i].i_visible_lines = i_end - i_start;
     }
+}
 
-    /* Get variables */
-    vlc_mutex_lock( &p_sys->lock );
-    int32_t i_cont = lroundf( p_sys->f_contrast * 255.f );
-    int32_t i_lum = lroundf( (p_sys->f_brightness - 1.f) * 255.f );
-    float f_hue = p_sys->f_hue * (float)(M_PI / 180.);
-    int i_sat = (int)( p_sys->f_saturation * 256.f );
-    float f_gamma = 1.f / p_sys->f_gamma;
-    bool b_thres = p_sys->b_brightness_threshold;
-    vlc_mutex_unlock( &p_sys->lock );
+static void FilterBand( void *p_opaque, unsigned i_band, unsigned i_bands )
+{
+    const adjust_job_t *p_job = p_opaque;
+    picture_t in, out;
+
+    BandPicture( &in, p_job->p_pic, i_band, i_bands );
+    BandPicture( &out, p_job->p_outpic, i_band, i_bands );
+
+    p_job->pf_luma( p_job->pi_luma, &out.p[Y_PLANE], &in.p[Y_PLANE],
+                    p_job->i_y_offset );
+    /* Currently no errors are implemented in the function, other than the
+     * chroma check already done by the caller */
+    p_job->pf_sat_hue( &in, &out, p_job->i_sin, p_job->i_cos, p_job->i_sat,
+                       p_job->i_x, p_job->i_y );
+}
 
-    /*
-     * Threshold mode drops out everything about luma, contrast and gamma.
-     */
-    if( !b_thres )
-    {
+/* Runs the job over the bands of the pictures */
+static void FilterPicture( filter_t *p_filter, adjust_job_t *p_job )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
 
-        /* Contrast is a fast but kludged function, so I put this gap to be
-         * cleaner :) */
-        i_lum += 128 - i_cont / 2;
+    /* Get the derived parameters */
+    vlc_mutex_lock( &p_sys->lock );
+    memcpy( p_job->pi_luma, p_sys->pi_luma, sizeof( p_job->pi_luma ) );
+    p_job->i_sin = p_sys->i_sin;
+    p_job->i_cos = p_sys->i_cos;
+    p_job->i_sat = p_sys->i_sat;
+    p_job->i_x = p_sys->i_x;
+    p_job->i_y = p_sys->i_y;
+    vlc_mutex_unlock( &p_sys->lock );
 
-        /* Fill the gamma lookup table */
-        for( unsigned i = 0 ; i < 256 ; i++ )
-        {
-            pi_gamma[ i ] = clip_uint8_vlc( powf(i / 255.f, f_gamma) * 255.f);
-        }
+    p_job->pf_sat_hue = ( p_job->i_sat > 256 ) ? p_sys->pf_process_sat_hue_clip
+                                               : p_sys->pf_process_sat_hue;
 
-        /* Fill the luma lookup table */
-        for( unsigned i = 0 ; i < 256 ; i++ )
-        {
-            pi_luma[ i ] = pi_gamma[clip_uint8_vlc( i_lum + i_cont * i / 256)];
-        }
-    }
-    else
-    {
-        /*
-         * We get luma as threshold value: the higher it is, the darker is
-         * the image. Should I reverse this?
-         */
-        for( int i = 0 ; i < 256 ; i++ )
-        {
-            pi_luma[ i ] = (i < i_lum) ? 0 : 255;
-        }
+    /* Chroma planes may have half the lines of the luma one */
+    unsigned i_bands = BandsCount( &p_sys->bands );
+    int i_lines = p_job->p_pic->p[p_job->p_pic->i_planes - 1].i_visible_lines;
+    if( i_lines < (int)(BAND_MIN_LINES * i_bands) )
+        i_bands = __MAX( i_lines / BAND_MIN_LINES, 1 );
 
-        /*
-         * Desaturates image to avoid that strange yellow halo...
-         */
-        i_sat = 0;
-    }
+    BandsRender( &p_sys->bands, FilterBand, p_job, i_bands );
+}
 
-    /*
-     * Do the Y plane
-     */
+/*****************************************************************************
+ * Run the filter on a Planar YUV picture
+ *****************************************************************************/
+static void LumaPlanar( const uint8_t *pi_luma, plane_t *p_dst,
+                        const plane_t *p_src, int i_offset )
+{
+    const uint8_t *p_in, *p_in_end, *p_line_end;
+    uint8_t *p_out;
 
-    p_in = p_pic->p[Y_PLANE].p_pixels;
-    p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-                      * p_pic->p[Y_PLANE].i_pitch - 8;
+    VLC_UNUSED(i_offset);
+    p_in = p_src->p_pixels;
+    p_in_end = p_in + p_src->i_visible_lines * p_src->i_pitch - 8;
 
-    p_out = p_outpic->p[Y_PLANE].p_pixels;
+    p_out = p_dst->p_pixels;
 
     for( ; p_in < p_in_end ; )
     {
-        p_line_end = p_in + p_pic->p[Y_PLANE].i_visible_pitch - 8;
+        p_line_end = p_in + p_src->i_visible_pitch - 8;
 
         for( ; p_in < p_line_end ; )
         {
@@ -322,149 +424,51 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
             *p_out++ = pi_luma[ *p_in++ ];
         }
 
-        p_in += p_pic->p[Y_PLANE].i_pitch
-              - p_pic->p[Y_PLANE].i_visible_pitch;
-        p_out += p_outpic->p[Y_PLANE].i_pitch
-               - p_outpic->p[Y_PLANE].i_visible_pitch;
+        p_in += p_src->i_pitch - p_src->i_visible_pitch;
+        p_out += p_dst->i_pitch - p_dst->i_visible_pitch;
     }
-
-    /*
-     * Do the U and V planes
-     */
-
-    int i_sin = sinf(f_hue) * 256.f;
-    int i_cos = cosf(f_hue) * 256.f;
-
-    int i_x = ( cosf(f_hue) + sinf(f_hue) ) * 32768.f;
-    int i_y = ( cosf(f_hue) - sinf(f_hue) ) * 32768.f;
-
-    if ( i_sat > 256 )
-    {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
-    }
-    else
-    {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
-    }
-
-    return CopyInfoAndRelease( p_outpic, p_pic );
 }
 
-/*****************************************************************************
- * Run the filter on a Packed YUV picture
- *****************************************************************************/
-static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
+static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
 {
-    int pi_luma[256];
-    int pi_gamma[256];
-
     picture_t *p_outpic;
-    uint8_t *p_in, *p_in_end, *p_line_end;
-    uint8_t *p_out;
-    int i_y_offset, i_u_offset, i_v_offset;
-
-    int i_pitch, i_visible_pitch;
-
-    bool b_thres;
-    double  f_hue;
-    double  f_gamma;
-    int32_t i_cont, i_lum;
-    int i_sat, i_sin, i_cos, i_x, i_y;
-    int i;
-
-    filter_sys_t *p_sys = p_filter->p_sys;
 
     if( !p_pic ) return NULL;
 
-    i_pitch = p_pic->p->i_pitch;
-    i_visible_pitch = p_pic->p->i_visible_pitch;
-
-    if( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
-                             &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
-    {
-        msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                  (char*)&(p_pic->format.i_chroma) );
-
-        picture_Release( p_pic );
-        return NULL;
-    }
-
     p_outpic = filter_NewPicture( p_filter );
     if( !p_outpic )
     {
-        msg_Warn( p_filter, "can't get output picture" );
-
         picture_Release( p_pic );
         return NULL;
     }
 
-    /* Get variables */
-    vlc_mutex_lock( &p_sys->lock );
-    i_cont = (int)( p_sys->f_contrast * 255 );
-    i_lum = (int)( (p_sys->f_brightness - 1.0)*255 );
-    f_hue = p_sys->f_hue * (float)(M_PI / 180.);
-    i_sat = (int)( p_sys->f_saturation * 256 );
-    f_gamma = 1.0 / p_sys->f_gamma;
-    b_thres = p_sys->b_brightness_threshold;
-    vlc_mutex_unlock( &p_sys->lock );
-
-    /*
-     * Threshold mode drops out everything about luma, contrast and gamma.
-     */
-    if( !b_thres )
-    {
+    adjust_job_t job = {
+        .p_pic = p_pic,
+        .p_outpic = p_outpic,
+        .pf_luma = LumaPlanar,
+    };
+    FilterPicture( p_filter, &job );
 
-        /* Contrast is a fast but kludged function, so I put this gap to be
-         * cleaner :) */
-        i_lum += 128 - i_cont / 2;
-
-        /* Fill the gamma lookup table */
-        for( i = 0 ; i < 256 ; i++ )
-        {
-          pi_gamma[ i ] = clip_uint8_vlc( pow(i / 255.0, f_gamma) * 255.0);
-        }
-
-        /* Fill the luma lookup table */
-        for( i = 0 ; i < 256 ; i++ )
-        {
-            pi_luma[ i ] = pi_gamma[clip_uint8_vlc( i_lum + i_cont * i / 256)];
-        }
-    }
-    else
-    {
-        /*
-         * We get luma as threshold value: the higher it is, the darker is
-         * the image. Should I reverse this?
-         */
-        for( i = 0 ; i < 256 ; i++ )
-        {
-            pi_luma[ i ] = (i < i_lum) ? 0 : 255;
-        }
-
-        /*
-         * Desaturates image to avoid that strange yellow halo...
-         */
-        i_sat = 0;
-    }
+    return CopyInfoAndRelease( p_outpic, p_pic );
+}
 
-    /*
-     * Do the Y plane
-     */
+/*****************************************************************************
+ * Run the filter on a Packed YUV picture
+ *****************************************************************************/
+static void LumaPacked( const uint8_t *pi_luma, plane_t *p_dst,
+                        const plane_t *p_src, int i_y_offset )
+{
+    const uint8_t *p_in, *p_in_end, *p_line_end;
+    uint8_t *p_out;
 
-    p_in = p_pic->p->p_pixels + i_y_offset;
-    p_in_end = p_in + p_pic->p->i_visible_lines * p_pic->p->i_pitch - 8 * 4;
+    p_in = p_src->p_pixels + i_y_offset;
+    p_in_end = p_in + p_src->i_visible_lines * p_src->i_pitch - 8 * 4;
 
-    p_out = p_outpic->p->p_pixels + i_y_offset;
+    p_out = p_dst->p_pixels + i_y_offset;
 
     for( ; p_in < p_in_end ; )
     {
-        p_line_end = p_in + i_visible_pitch - 8 * 4;
+        p_line_end = p_in + p_src->i_visible_pitch - 8 * 4;
 
         for( ; p_in < p_line_end ; )
         {
@@ -486,47 +490,45 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
             *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
         }
 
-        p_in += i_pitch - p_pic->p->i_visible_pitch;
-        p_out += i_pitch - p_outpic->p->i_visible_pitch;
+        p_in += p_src->i_pitch - p_src->i_visible_pitch;
+        p_out += p_dst->i_pitch - p_dst->i_visible_pitch;
     }
+}
 
-    /*
-     * Do the U and V planes
-     */
-
-    i_sin = sin(f_hue) * 256;
-    i_cos = cos(f_hue) * 256;
+static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
+{
+    picture_t *p_outpic;
+    int i_y_offset, i_u_offset, i_v_offset;
 
-    i_x = ( cos(f_hue) + sin(f_hue) ) * 32768;
-    i_y = ( cos(f_hue) - sin(f_hue) ) * 32768;
+    if( !p_pic ) return NULL;
 
-    if ( i_sat > 256 )
+    if( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
+                             &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
     {
-        if ( p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                             i_x, i_y ) != VLC_SUCCESS )
-        {
-            /* Currently only one error can happen in the function, but if there
-             * will be more of them, this message must go away */
-            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                      (char*)&(p_pic->format.i_chroma) );
-            picture_Release( p_pic );
-            return NULL;
-        }
+        msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
+                  (char*)&(p_pic->format.i_chroma) );
+
+        picture_Release( p_pic );
+        return NULL;
     }
-    else
+
+    p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
     {
-        if ( p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y ) != VLC_SUCCESS )
-        {
-            /* Currently only one error can happen in the function, but if there
-             * will be more of them, this message must go away */
-            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                      (char*)&(p_pic->format.i_chroma) );
-            picture_Release( p_pic );
-            return NULL;
-        }
+        msg_Warn( p_filter, "can't get output picture" );
+
+        picture_Release( p_pic );
+        return NULL;
     }
 
+    adjust_job_t job = {
+        .p_pic = p_pic,
+        .p_outpic = p_outpic,
+        .pf_luma = LumaPacked,
+        .i_y_offset = i_y_offset,
+    };
+    FilterPicture( p_filter, &job );
+
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
 
@@ -550,6 +552,7 @@ static int AdjustCallback( vlc_object_t *p_this, char const *psz_var,
         p_sys->f_gamma = newval.f_float;
     else if( !strcmp( psz_var, "brightness-threshold" ) )
         p_sys->b_brightness_threshold = newval.b_bool;
+    AdjustUpdate( p_sys );
     vlc_mutex_unlock( &p_sys->lock );
 
     return VLC_SUCCESS;
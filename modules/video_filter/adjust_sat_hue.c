@@ -30,6 +30,10 @@
 #include "filter_picture.h"
 #include "adjust_sat_hue.h"
 
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+
 #define PLANAR_WRITE_UV_CLIP() \
     i_u = *p_in++ ; i_v = *p_in_v++ ; \
     *p_out++ = clip_uint8_vlc( (( ((i_u * i_cos + i_v * i_sin - i_x) >> 8) \
@@ -162,6 +166,93 @@ int planar_sat_hue_C( picture_t * p_pic, picture_t * p_outpic, int i_sin, int i_
     return VLC_SUCCESS;
 }
 
+#ifdef HAVE_SSE2_INTRINSICS
+/* Eight U and eight V samples: the rotation is computed on 32 bits with
+ * pairs of 16-bits products, then the saturation on 16x16 bits products */
+VLC_SSE
+static inline void planar_sat_hue_8_SSE2( uint8_t *p_out, uint8_t *p_out_v,
+                                          const uint8_t *p_in,
+                                          const uint8_t *p_in_v,
+                                          __m128i coef_u, __m128i coef_v,
+                                          __m128i x, __m128i y, __m128i sat )
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i u = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *)p_in ),
+                                   zero );
+    __m128i v = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *)p_in_v ),
+                                   zero );
+    __m128i uv_lo = _mm_unpacklo_epi16( u, v );
+    __m128i uv_hi = _mm_unpackhi_epi16( u, v );
+    __m128i out[2];
+
+    for( int i = 0; i < 2; i++ )
+    {
+        const __m128i coef = i ? coef_v : coef_u;
+        const __m128i off = i ? y : x;
+
+        /* (u * cos + v * sin - x) >> 8, or (v * cos - u * sin - y) >> 8 */
+        __m128i lo = _mm_srai_epi32( _mm_sub_epi32(
+                         _mm_madd_epi16( uv_lo, coef ), off ), 8 );
+        __m128i hi = _mm_srai_epi32( _mm_sub_epi32(
+                         _mm_madd_epi16( uv_hi, coef ), off ), 8 );
+        __m128i a = _mm_packs_epi32( lo, hi );
+
+        /* (a * sat) >> 8 */
+        __m128i pl = _mm_mullo_epi16( a, sat );
+        __m128i ph = _mm_mulhi_epi16( a, sat );
+        lo = _mm_srai_epi32( _mm_unpacklo_epi16( pl, ph ), 8 );
+        hi = _mm_srai_epi32( _mm_unpackhi_epi16( pl, ph ), 8 );
+        out[i] = _mm_add_epi16( _mm_packs_epi32( lo, hi ),
+                                _mm_set1_epi16( 128 ) );
+    }
+
+    __m128i uv = _mm_packus_epi16( out[0], out[1] );
+    _mm_storel_epi64( (__m128i *)p_out, uv );
+    _mm_storel_epi64( (__m128i *)p_out_v, _mm_unpackhi_epi64( uv, uv ) );
+}
+
+VLC_SSE
+int planar_sat_hue_SSE2( picture_t * p_pic, picture_t * p_outpic, int i_sin,
+                         int i_cos, int i_sat, int i_x, int i_y )
+{
+    /* (cos, sin) and (-sin, cos) pairs */
+    const __m128i coef_u = _mm_unpacklo_epi16( _mm_set1_epi16( i_cos ),
+                                               _mm_set1_epi16( i_sin ) );
+    const __m128i coef_v = _mm_unpacklo_epi16( _mm_set1_epi16( -i_sin ),
+                                               _mm_set1_epi16( i_cos ) );
+    const __m128i x = _mm_set1_epi32( i_x );
+    const __m128i y = _mm_set1_epi32( i_y );
+    const __m128i sat = _mm_set1_epi16( i_sat );
+    const int i_width = p_pic->p[U_PLANE].i_visible_pitch;
+
+    for( int i_line = 0; i_line < p_pic->p[U_PLANE].i_visible_lines; i_line++ )
+    {
+        const uint8_t *p_in = p_pic->p[U_PLANE].p_pixels
+                            + i_line * p_pic->p[U_PLANE].i_pitch;
+        const uint8_t *p_in_v = p_pic->p[V_PLANE].p_pixels
+                              + i_line * p_pic->p[V_PLANE].i_pitch;
+        uint8_t *p_out = p_outpic->p[U_PLANE].p_pixels
+                       + i_line * p_outpic->p[U_PLANE].i_pitch;
+        uint8_t *p_out_v = p_outpic->p[V_PLANE].p_pixels
+                         + i_line * p_outpic->p[V_PLANE].i_pitch;
+        int i = 0;
+
+        for( ; i + 8 <= i_width; i += 8 )
+            planar_sat_hue_8_SSE2( p_out + i, p_out_v + i, p_in + i,
+                                   p_in_v + i, coef_u, coef_v, x, y, sat );
+
+        p_in += i; p_in_v += i; p_out += i; p_out_v += i;
+        for( ; i < i_width; i++ )
+        {
+            uint8_t i_u, i_v;
+            PLANAR_WRITE_UV_CLIP();
+        }
+    }
+
+    return VLC_SUCCESS;
+}
+#endif
+
 int packed_sat_hue_clip_C( picture_t * p_pic, picture_t * p_outpic, int i_sin, int i_cos,
                          int i_sat, int i_x, int i_y )
 {
@@ -50,6 +50,14 @@ int planar_sat_hue_clip_C( picture_t * p_pic, picture_t * p_outpic,
 int planar_sat_hue_C( picture_t * p_pic, picture_t * p_outpic,
                       int i_sin, int i_cos, int i_sat, int i_x, int i_y );
 
+#ifdef HAVE_SSE2_INTRINSICS
+/**
+ * SSE2 function for planar format, with clipping (any i_sat)
+ */
+int planar_sat_hue_SSE2( picture_t * p_pic, picture_t * p_outpic,
+                         int i_sin, int i_cos, int i_sat, int i_x, int i_y );
+#endif
+
 /**
  * Basic C compiler generated function for packed format, i_sat > 256
  */
@@ -0,0 +1,53 @@
+/*****************************************************************************
+ * bands.c : band-parallel processing for the video filters
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <vlc_common.h>
+
+#include "bands.h"
+
+void BandsInit( bands_sys_t *p_bands, unsigned i_bands )
+{
+    /* More bands than workers would only be rendered one after the other */
+    i_bands = __MIN( i_bands, BANDS_THREADS_MAX );
+    i_bands = __MIN( i_bands, vlc_threadpool_Size() + 1 );
+    p_bands->i_threads = __MAX( i_bands, 1 ) - 1;
+}
+
+void BandsClean( bands_sys_t *p_bands )
+{
+    VLC_UNUSED( p_bands );
+}
+
+void BandsRender( bands_sys_t *p_bands, band_render_t pf_render,
+                  void *p_opaque, unsigned i_bands )
+{
+    if( p_bands->i_threads == 0 )
+    {
+        for( unsigned i = 0; i < i_bands; i++ )
+            pf_render( p_opaque, i, i_bands );
+        return;
+    }
+
+    vlc_task_Parallel( pf_render, p_opaque, i_bands, VLC_TASK_PRIORITY_HIGH );
+}
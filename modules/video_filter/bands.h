@@ -0,0 +1,73 @@
+/*****************************************************************************
+ * bands.h : band-parallel processing for the video filters
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VIDEO_FILTER_BANDS_H
+#define VLC_VIDEO_FILTER_BANDS_H 1
+
+/**
+ * \file
+ * Horizontal bands of a frame rendered in parallel by the core thread pool,
+ * for the filters whose output lines can be computed independently.
+ */
+
+#include <vlc_threadpool.h>
+
+#define BANDS_THREADS_MAX (16)
+
+/**
+ * Renders band i_band out of i_bands.
+ */
+typedef void (*band_render_t)( void *p_opaque, unsigned i_band,
+                               unsigned i_bands );
+
+typedef struct
+{
+    unsigned      i_threads; /**< Bands rendered besides the caller's */
+} bands_sys_t;
+
+/**
+ * Sets the parallelism.
+ *
+ * @param i_bands Number of bands the frames will be split into; one of them
+ *                is always rendered by the calling thread. 1 disables the
+ *                parallel rendering.
+ */
+void BandsInit( bands_sys_t *p_bands, unsigned i_bands );
+
+/**
+ * Releases the resources.
+ */
+void BandsClean( bands_sys_t *p_bands );
+
+/**
+ * Number of bands to split a frame into.
+ */
+static inline unsigned BandsCount( const bands_sys_t *p_bands )
+{
+    return p_bands->i_threads + 1;
+}
+
+/**
+ * Renders all the bands of a job, and returns once they are done.
+ */
+void BandsRender( bands_sys_t *p_bands, band_render_t pf_render,
+                  void *p_opaque, unsigned i_bands );
+
+#endif
@@ -33,6 +33,7 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include "filter_picture.h"
+#include "blend_merge.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -615,11 +616,191 @@ static const struct {
 #undef YUV
 };
 
+/*****************************************************************************
+ * Vectorized blending of the common 8-bits cases
+ *****************************************************************************/
+struct filter_sys_t;
+
+/* Returns false if the generic blend must be used instead */
+typedef bool (*blend_fast_function_t)(filter_sys_t *sys,
+                                      const video_format_t *dst_fmt,
+                                      picture_t *dst, unsigned dst_x, unsigned dst_y,
+                                      const picture_t *src, unsigned src_x, unsigned src_y,
+                                      unsigned width, unsigned height, int alpha);
+
 struct filter_sys_t {
-    filter_sys_t() : blend(NULL)
+    filter_sys_t() : blend(NULL), blend_fast(NULL), line(NULL), line_width(0)
     {
+        BlendMergeGetFunctions(&merge);
     }
-    blend_function_t blend;
+    ~filter_sys_t()
+    {
+        free(line);
+    }
+    blend_function_t      blend;
+    blend_fast_function_t blend_fast;
+    blend_merge_t         merge;
+    /* RGBX source line in the destination byte order */
+    uint8_t               *line;
+    unsigned              line_width;
+};
+
+static inline uint8_t *getLine(const picture_t *picture, unsigned plane,
+                               unsigned y)
+{
+    return &picture->p[plane].p_pixels[y * picture->p[plane].i_pitch];
+}
+
+/* YUVA onto planar 4:2:0 and 4:2:2: the chroma is blended on the even
+ * columns (and lines for 4:2:0), like the generic code does */
+template <unsigned ry, bool swap_uv>
+static bool BlendFastYUVPlanar(filter_sys_t *sys, const video_format_t *,
+                               picture_t *dst, unsigned dst_x, unsigned dst_y,
+                               const picture_t *src, unsigned src_x, unsigned src_y,
+                               unsigned width, unsigned height, int alpha)
+{
+    const blend_merge_t &m = sys->merge;
+    const unsigned dx = dst_x % 2;
+    const unsigned count = (width - dx + 1) / 2;
+
+    for (unsigned y = 0; y < height; y++) {
+        const uint8_t *a = getLine(src, 3, src_y + y) + src_x;
+
+        m.plane(getLine(dst, 0, dst_y + y) + dst_x,
+                getLine(src, 0, src_y + y) + src_x, a, width, alpha);
+
+        if (((dst_y + y) % ry) != 0 || count == 0)
+            continue;
+        const unsigned cy = (dst_y + y) / ry;
+        const unsigned cx = (dst_x + dx) / 2;
+        m.plane_sub2(getLine(dst, swap_uv ? 2 : 1, cy) + cx,
+                     getLine(src, 1, src_y + y) + src_x + dx, a + dx,
+                     count, alpha);
+        m.plane_sub2(getLine(dst, swap_uv ? 1 : 2, cy) + cx,
+                     getLine(src, 2, src_y + y) + src_x + dx, a + dx,
+                     count, alpha);
+    }
+    return true;
+}
+
+template <bool swap_uv>
+static bool BlendFastYUVSemiPlanar(filter_sys_t *sys, const video_format_t *,
+                                   picture_t *dst, unsigned dst_x, unsigned dst_y,
+                                   const picture_t *src, unsigned src_x, unsigned src_y,
+                                   unsigned width, unsigned height, int alpha)
+{
+    const blend_merge_t &m = sys->merge;
+    const unsigned dx = dst_x % 2;
+    const unsigned count = (width - dx + 1) / 2;
+
+    for (unsigned y = 0; y < height; y++) {
+        const uint8_t *a = getLine(src, 3, src_y + y) + src_x;
+
+        m.plane(getLine(dst, 0, dst_y + y) + dst_x,
+                getLine(src, 0, src_y + y) + src_x, a, width, alpha);
+
+        if (((dst_y + y) % 2) != 0 || count == 0)
+            continue;
+        const uint8_t *u = getLine(src, 1, src_y + y) + src_x + dx;
+        const uint8_t *v = getLine(src, 2, src_y + y) + src_x + dx;
+        m.uv(getLine(dst, 1, (dst_y + y) / 2) + dst_x + dx,
+             swap_uv ? v : u, swap_uv ? u : v, a + dx, count, alpha);
+    }
+    return true;
+}
+
+/* YUVA or RGBA onto RGB32 with byte aligned masks */
+template <bool yuva>
+static bool BlendFastRGB32(filter_sys_t *sys, const video_format_t *dst_fmt,
+                           picture_t *dst, unsigned dst_x, unsigned dst_y,
+                           const picture_t *src, unsigned src_x, unsigned src_y,
+                           unsigned width, unsigned height, int alpha)
+{
+    const int shifts[3] = {
+        dst_fmt->i_lrshift, dst_fmt->i_lgshift, dst_fmt->i_lbshift,
+    };
+    unsigned offset[3];
+    unsigned used = 0;
+    for (unsigned c = 0; c < 3; c++) {
+        if ((shifts[c] % 8) != 0 || shifts[c] < 0 || shifts[c] >= 32)
+            return false;
+#ifdef WORDS_BIGENDIAN
+        offset[c] = 3 - shifts[c] / 8;
+#else
+        offset[c] = shifts[c] / 8;
+#endif
+        if (used & (1 << offset[c]))
+            return false;
+        used |= 1 << offset[c];
+    }
+    const unsigned ox = 6 - offset[0] - offset[1] - offset[2];
+    const bool direct = !yuva && ox == 3 &&
+                        offset[0] == 0 && offset[1] == 1 && offset[2] == 2;
+
+    if (!direct && width > sys->line_width) {
+        uint8_t *line = (uint8_t *)realloc(sys->line, 4 * width);
+        if (!line)
+            return false;
+        sys->line = line;
+        sys->line_width = width;
+    }
+
+    for (unsigned y = 0; y < height; y++) {
+        uint8_t *d = getLine(dst, 0, dst_y + y) + 4 * dst_x;
+
+        if (direct) {
+            sys->merge.rgbx(d, getLine(src, 0, src_y + y) + 4 * src_x,
+                            width, alpha, ox);
+            continue;
+        }
+
+        uint8_t *line = sys->line;
+        if (yuva) {
+            const uint8_t *py = getLine(src, 0, src_y + y) + src_x;
+            const uint8_t *pu = getLine(src, 1, src_y + y) + src_x;
+            const uint8_t *pv = getLine(src, 2, src_y + y) + src_x;
+            const uint8_t *pa = getLine(src, 3, src_y + y) + src_x;
+
+            for (unsigned x = 0; x < width; x++, line += 4) {
+                line[ox] = pa[x];
+                /* The color of a transparent pixel is not used */
+                if (pa[x] == 0)
+                    continue;
+                int r, g, b;
+                yuv_to_rgb(&r, &g, &b, py[x], pu[x], pv[x]);
+                line[offset[0]] = r;
+                line[offset[1]] = g;
+                line[offset[2]] = b;
+            }
+        } else {
+            const uint8_t *ps = getLine(src, 0, src_y + y) + 4 * src_x;
+
+            for (unsigned x = 0; x < width; x++, line += 4, ps += 4) {
+                line[offset[0]] = ps[0];
+                line[offset[1]] = ps[1];
+                line[offset[2]] = ps[2];
+                line[ox]        = ps[3];
+            }
+        }
+        sys->merge.rgbx(d, sys->line, width, alpha, ox);
+    }
+    return true;
+}
+
+static const struct {
+    vlc_fourcc_t          dst;
+    vlc_fourcc_t          src;
+    blend_fast_function_t blend;
+} blends_fast[] = {
+    { VLC_CODEC_I420,  VLC_CODEC_YUVA, BlendFastYUVPlanar<2, false> },
+    { VLC_CODEC_J420,  VLC_CODEC_YUVA, BlendFastYUVPlanar<2, false> },
+    { VLC_CODEC_YV12,  VLC_CODEC_YUVA, BlendFastYUVPlanar<2, true> },
+    { VLC_CODEC_I422,  VLC_CODEC_YUVA, BlendFastYUVPlanar<1, false> },
+    { VLC_CODEC_J422,  VLC_CODEC_YUVA, BlendFastYUVPlanar<1, false> },
+    { VLC_CODEC_NV12,  VLC_CODEC_YUVA, BlendFastYUVSemiPlanar<false> },
+    { VLC_CODEC_NV21,  VLC_CODEC_YUVA, BlendFastYUVSemiPlanar<true> },
+    { VLC_CODEC_RGB32, VLC_CODEC_YUVA, BlendFastRGB32<true> },
+    { VLC_CODEC_RGB32, VLC_CODEC_RGBA, BlendFastRGB32<false> },
 };
 
 /**
@@ -631,28 +812,40 @@ static void Blend(filter_t *filter,
 {
     filter_sys_t *sys = filter->p_sys;
 
-    if( x_offset < 0 || y_offset < 0 )
-    {
-        msg_Err( filter, "Blend cannot process negative offsets" );
-        return;
+    /* Clip the source to the destination first: the parts of the source
+     * out of the destination on the top/left are skipped */
+    int src_x = 0, src_y = 0;
+    if (x_offset < 0) {
+        src_x    = -x_offset;
+        x_offset = 0;
+    }
+    if (y_offset < 0) {
+        src_y    = -y_offset;
+        y_offset = 0;
     }
 
     int width  = __MIN((int)filter->fmt_out.video.i_visible_width - x_offset,
-                       (int)filter->fmt_in.video.i_visible_width);
+                       (int)filter->fmt_in.video.i_visible_width - src_x);
     int height = __MIN((int)filter->fmt_out.video.i_visible_height - y_offset,
-                       (int)filter->fmt_in.video.i_visible_height);
+                       (int)filter->fmt_in.video.i_visible_height - src_y);
     if (width <= 0 || height <= 0 || alpha <= 0)
         return;
 
     video_format_FixRgb(&filter->fmt_out.video);
     video_format_FixRgb(&filter->fmt_in.video);
 
-    sys->blend(CPicture(dst, &filter->fmt_out.video,
-                        filter->fmt_out.video.i_x_offset + x_offset,
-                        filter->fmt_out.video.i_y_offset + y_offset),
-               CPicture(src, &filter->fmt_in.video,
-                        filter->fmt_in.video.i_x_offset,
-                        filter->fmt_in.video.i_y_offset),
+    const unsigned dst_x = filter->fmt_out.video.i_x_offset + x_offset;
+    const unsigned dst_y = filter->fmt_out.video.i_y_offset + y_offset;
+    src_x += filter->fmt_in.video.i_x_offset;
+    src_y += filter->fmt_in.video.i_y_offset;
+
+    if (sys->blend_fast &&
+        sys->blend_fast(sys, &filter->fmt_out.video, dst, dst_x, dst_y,
+                        src, src_x, src_y, width, height, alpha))
+        return;
+
+    sys->blend(CPicture(dst, &filter->fmt_out.video, dst_x, dst_y),
+               CPicture(src, &filter->fmt_in.video, src_x, src_y),
                width, height, alpha);
 }
 
@@ -668,6 +861,11 @@ static int Open(vlc_object_t *object)
             sys->blend = blends[i].blend;
     }
 
+    for (size_t i = 0; i < sizeof(blends_fast) / sizeof(*blends_fast); i++) {
+        if (blends_fast[i].src == src && blends_fast[i].dst == dst)
+            sys->blend_fast = blends_fast[i].blend;
+    }
+
     if (!sys->blend) {
        msg_Err(filter, "no matching alpha blending routine (chroma: %4.4s -> %4.4s)",
                (char *)&src, (char *)&dst);
@@ -0,0 +1,585 @@
+/*****************************************************************************
+ * blend_merge.c : line blending routines for the blend module
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdint.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include "blend_merge.h"
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define CAN_COMPILE_NEON_INTRINSICS 1
+#endif
+
+/* All the routines below compute the products on 16-bits: with 8-bits
+ * samples, (255 - f) * dst + f * src and div255() cannot overflow. */
+
+static inline unsigned div255(unsigned v)
+{
+    return ((v >> 8) + v + 1) >> 8;
+}
+
+static inline void merge(uint8_t *dst, unsigned src, unsigned f)
+{
+    *dst = div255((255 - f) * (*dst) + src * f);
+}
+
+/*****************************************************************************
+ * Generic C
+ *****************************************************************************/
+static void PlaneGeneric(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                         unsigned count, int alpha)
+{
+    for (unsigned i = 0; i < count; i++)
+        merge(&dst[i], src[i], div255(alpha * a[i]));
+}
+
+static void PlaneSub2Generic(uint8_t *dst, const uint8_t *src,
+                             const uint8_t *a, unsigned count, int alpha)
+{
+    for (unsigned i = 0; i < count; i++)
+        merge(&dst[i], src[2 * i], div255(alpha * a[2 * i]));
+}
+
+static void UVGeneric(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                      const uint8_t *a, unsigned count, int alpha)
+{
+    for (unsigned i = 0; i < count; i++) {
+        const unsigned f = div255(alpha * a[2 * i]);
+
+        merge(&dst[2 * i + 0], u[2 * i], f);
+        merge(&dst[2 * i + 1], v[2 * i], f);
+    }
+}
+
+static void RGBXGeneric(uint8_t *dst, const uint8_t *src, unsigned count,
+                        int alpha, unsigned ox)
+{
+    for (unsigned i = 0; i < count; i++, dst += 4, src += 4) {
+        const unsigned f = div255(alpha * src[ox]);
+
+        for (unsigned c = 0; c < 4; c++)
+            if (c != ox)
+                merge(&dst[c], src[c], f);
+    }
+}
+
+/* The vector loops of the routines reading the sources with a step of 2
+ * stop one vector early: the last loads would otherwise read one byte past
+ * the last sample used. */
+
+/*****************************************************************************
+ * SSE2
+ *****************************************************************************/
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE
+static inline __m128i div255_sse2(__m128i v)
+{
+    v = _mm_add_epi16(v, _mm_srli_epi16(v, 8));
+    return _mm_srli_epi16(_mm_add_epi16(v, _mm_set1_epi16(1)), 8);
+}
+
+VLC_SSE
+static inline __m128i merge_sse2(__m128i d, __m128i s, __m128i f)
+{
+    const __m128i nf = _mm_sub_epi16(_mm_set1_epi16(255), f);
+
+    return div255_sse2(_mm_add_epi16(_mm_mullo_epi16(d, nf),
+                                     _mm_mullo_epi16(s, f)));
+}
+
+VLC_SSE
+static void PlaneSSE2(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                      unsigned count, int alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i va = _mm_set1_epi16(alpha);
+    unsigned i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        const __m128i f = _mm_loadu_si128((const __m128i *)&a[i]);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(f, zero)) == 0xffff)
+            continue;
+
+        const __m128i d = _mm_loadu_si128((const __m128i *)&dst[i]);
+        const __m128i s = _mm_loadu_si128((const __m128i *)&src[i]);
+        const __m128i lo =
+            merge_sse2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero),
+                       div255_sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(f, zero),
+                                                   va)));
+        const __m128i hi =
+            merge_sse2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero),
+                       div255_sse2(_mm_mullo_epi16(_mm_unpackhi_epi8(f, zero),
+                                                   va)));
+        _mm_storeu_si128((__m128i *)&dst[i], _mm_packus_epi16(lo, hi));
+    }
+    PlaneGeneric(&dst[i], &src[i], &a[i], count - i, alpha);
+}
+
+VLC_SSE
+static void PlaneSub2SSE2(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                          unsigned count, int alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i even = _mm_set1_epi16(0x00ff);
+    const __m128i va = _mm_set1_epi16(alpha);
+    unsigned i;
+
+    for (i = 0; i + 8 < count; i += 8) {
+        __m128i f = _mm_and_si128(_mm_loadu_si128((const __m128i *)&a[2 * i]),
+                                  even);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(f, zero)) == 0xffff)
+            continue;
+
+        const __m128i s =
+            _mm_and_si128(_mm_loadu_si128((const __m128i *)&src[2 * i]), even);
+        __m128i d = _mm_loadl_epi64((const __m128i *)&dst[i]);
+
+        f = div255_sse2(_mm_mullo_epi16(f, va));
+        d = merge_sse2(_mm_unpacklo_epi8(d, zero), s, f);
+        _mm_storel_epi64((__m128i *)&dst[i], _mm_packus_epi16(d, d));
+    }
+    PlaneSub2Generic(&dst[i], &src[2 * i], &a[2 * i], count - i, alpha);
+}
+
+VLC_SSE
+static void UVSSE2(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                   const uint8_t *a, unsigned count, int alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i even = _mm_set1_epi16(0x00ff);
+    const __m128i va = _mm_set1_epi16(alpha);
+    unsigned i;
+
+    for (i = 0; i + 8 < count; i += 8) {
+        __m128i f = _mm_and_si128(_mm_loadu_si128((const __m128i *)&a[2 * i]),
+                                  even);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(f, zero)) == 0xffff)
+            continue;
+
+        const __m128i su =
+            _mm_and_si128(_mm_loadu_si128((const __m128i *)&u[2 * i]), even);
+        const __m128i sv =
+            _mm_and_si128(_mm_loadu_si128((const __m128i *)&v[2 * i]), even);
+        const __m128i d = _mm_loadu_si128((const __m128i *)&dst[2 * i]);
+
+        f = div255_sse2(_mm_mullo_epi16(f, va));
+        const __m128i lo = merge_sse2(_mm_unpacklo_epi8(d, zero),
+                                      _mm_unpacklo_epi16(su, sv),
+                                      _mm_unpacklo_epi16(f, f));
+        const __m128i hi = merge_sse2(_mm_unpackhi_epi8(d, zero),
+                                      _mm_unpackhi_epi16(su, sv),
+                                      _mm_unpackhi_epi16(f, f));
+        _mm_storeu_si128((__m128i *)&dst[2 * i], _mm_packus_epi16(lo, hi));
+    }
+    UVGeneric(&dst[2 * i], &u[2 * i], &v[2 * i], &a[2 * i], count - i, alpha);
+}
+
+/* Takes two pixels as 16-bits words, returns their blending factors
+ * repeated over the 4 words of each pixel */
+VLC_SSE
+static inline __m128i factor_rgbx_sse2(__m128i s, __m128i keep,
+                                       __m128i shift, __m128i va)
+{
+    __m128i f = _mm_srl_epi64(_mm_and_si128(s, keep), shift);
+
+    f = _mm_or_si128(f, _mm_slli_epi64(f, 16));
+    f = _mm_or_si128(f, _mm_slli_epi64(f, 32));
+    return div255_sse2(_mm_mullo_epi16(f, va));
+}
+
+VLC_SSE
+static void RGBXSSE2(uint8_t *dst, const uint8_t *src, unsigned count,
+                     int alpha, unsigned ox)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i va = _mm_set1_epi16(alpha);
+    const __m128i shift = _mm_cvtsi32_si128(16 * ox);
+    const __m128i keep = _mm_sll_epi64(_mm_set1_epi64x(0xffff), shift);
+    const __m128i amask = _mm_sll_epi32(_mm_set1_epi32(0xff),
+                                        _mm_cvtsi32_si128(8 * ox));
+    unsigned i;
+
+    for (i = 0; i + 4 <= count; i += 4) {
+        const __m128i s = _mm_loadu_si128((const __m128i *)&src[4 * i]);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, amask),
+                                              zero)) == 0xffff)
+            continue;
+
+        const __m128i d = _mm_loadu_si128((const __m128i *)&dst[4 * i]);
+        const __m128i dlo = _mm_unpacklo_epi8(d, zero);
+        const __m128i dhi = _mm_unpackhi_epi8(d, zero);
+        const __m128i slo = _mm_unpacklo_epi8(s, zero);
+        const __m128i shi = _mm_unpackhi_epi8(s, zero);
+        __m128i lo = merge_sse2(dlo, slo,
+                                factor_rgbx_sse2(slo, keep, shift, va));
+        __m128i hi = merge_sse2(dhi, shi,
+                                factor_rgbx_sse2(shi, keep, shift, va));
+
+        /* leave the destination padding byte untouched */
+        lo = _mm_or_si128(_mm_andnot_si128(keep, lo), _mm_and_si128(keep, dlo));
+        hi = _mm_or_si128(_mm_andnot_si128(keep, hi), _mm_and_si128(keep, dhi));
+        _mm_storeu_si128((__m128i *)&dst[4 * i], _mm_packus_epi16(lo, hi));
+    }
+    RGBXGeneric(&dst[4 * i], &src[4 * i], count - i, alpha, ox);
+}
+#endif
+
+/*****************************************************************************
+ * AVX2
+ *****************************************************************************/
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static inline __m256i div255_avx2(__m256i v)
+{
+    v = _mm256_add_epi16(v, _mm256_srli_epi16(v, 8));
+    return _mm256_srli_epi16(_mm256_add_epi16(v, _mm256_set1_epi16(1)), 8);
+}
+
+VLC_AVX2
+static inline __m256i merge_avx2(__m256i d, __m256i s, __m256i f)
+{
+    const __m256i nf = _mm256_sub_epi16(_mm256_set1_epi16(255), f);
+
+    return div255_avx2(_mm256_add_epi16(_mm256_mullo_epi16(d, nf),
+                                        _mm256_mullo_epi16(s, f)));
+}
+
+/* Packs 2x16 words back to 32 bytes in order */
+VLC_AVX2
+static inline __m256i pack_avx2(__m256i lo, __m256i hi)
+{
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+}
+
+VLC_AVX2
+static inline __m256i low_epu16_avx2(__m256i v)
+{
+    return _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v));
+}
+
+VLC_AVX2
+static inline __m256i high_epu16_avx2(__m256i v)
+{
+    return _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1));
+}
+
+VLC_AVX2
+static void PlaneAVX2(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                      unsigned count, int alpha)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i va = _mm256_set1_epi16(alpha);
+    unsigned i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        const __m256i f = _mm256_loadu_si256((const __m256i *)&a[i]);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(f, zero)) == -1)
+            continue;
+
+        const __m256i d = _mm256_loadu_si256((const __m256i *)&dst[i]);
+        const __m256i s = _mm256_loadu_si256((const __m256i *)&src[i]);
+        const __m256i lo =
+            merge_avx2(low_epu16_avx2(d), low_epu16_avx2(s),
+                       div255_avx2(_mm256_mullo_epi16(low_epu16_avx2(f), va)));
+        const __m256i hi =
+            merge_avx2(high_epu16_avx2(d), high_epu16_avx2(s),
+                       div255_avx2(_mm256_mullo_epi16(high_epu16_avx2(f), va)));
+        _mm256_storeu_si256((__m256i *)&dst[i], pack_avx2(lo, hi));
+    }
+    PlaneGeneric(&dst[i], &src[i], &a[i], count - i, alpha);
+}
+
+VLC_AVX2
+static void PlaneSub2AVX2(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                          unsigned count, int alpha)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i even = _mm256_set1_epi16(0x00ff);
+    const __m256i va = _mm256_set1_epi16(alpha);
+    unsigned i;
+
+    for (i = 0; i + 16 < count; i += 16) {
+        __m256i f = _mm256_and_si256(
+                _mm256_loadu_si256((const __m256i *)&a[2 * i]), even);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(f, zero)) == -1)
+            continue;
+
+        const __m256i s = _mm256_and_si256(
+                _mm256_loadu_si256((const __m256i *)&src[2 * i]), even);
+        __m256i d = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i *)&dst[i]));
+
+        f = div255_avx2(_mm256_mullo_epi16(f, va));
+        d = pack_avx2(merge_avx2(d, s, f), zero);
+        _mm_storeu_si128((__m128i *)&dst[i], _mm256_castsi256_si128(d));
+    }
+    PlaneSub2Generic(&dst[i], &src[2 * i], &a[2 * i], count - i, alpha);
+}
+
+VLC_AVX2
+static void UVAVX2(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                   const uint8_t *a, unsigned count, int alpha)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i even = _mm256_set1_epi16(0x00ff);
+    const __m256i va = _mm256_set1_epi16(alpha);
+    unsigned i;
+
+    for (i = 0; i + 16 < count; i += 16) {
+        __m256i f = _mm256_and_si256(
+                _mm256_loadu_si256((const __m256i *)&a[2 * i]), even);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(f, zero)) == -1)
+            continue;
+
+        const __m256i su = _mm256_and_si256(
+                _mm256_loadu_si256((const __m256i *)&u[2 * i]), even);
+        const __m256i sv = _mm256_and_si256(
+                _mm256_loadu_si256((const __m256i *)&v[2 * i]), even);
+        const __m256i d = _mm256_loadu_si256((const __m256i *)&dst[2 * i]);
+
+        /* The unpacks work within 128-bits lanes: the low ones give the
+         * pairs 0-3 and 8-11, the high ones the pairs 4-7 and 12-15 */
+        f = div255_avx2(_mm256_mullo_epi16(f, va));
+        const __m256i uvlo = _mm256_unpacklo_epi16(su, sv);
+        const __m256i uvhi = _mm256_unpackhi_epi16(su, sv);
+        const __m256i flo = _mm256_unpacklo_epi16(f, f);
+        const __m256i fhi = _mm256_unpackhi_epi16(f, f);
+        const __m256i lo =
+            merge_avx2(low_epu16_avx2(d),
+                       _mm256_permute2x128_si256(uvlo, uvhi, 0x20),
+                       _mm256_permute2x128_si256(flo, fhi, 0x20));
+        const __m256i hi =
+            merge_avx2(high_epu16_avx2(d),
+                       _mm256_permute2x128_si256(uvlo, uvhi, 0x31),
+                       _mm256_permute2x128_si256(flo, fhi, 0x31));
+        _mm256_storeu_si256((__m256i *)&dst[2 * i], pack_avx2(lo, hi));
+    }
+    UVGeneric(&dst[2 * i], &u[2 * i], &v[2 * i], &a[2 * i], count - i, alpha);
+}
+
+VLC_AVX2
+static inline __m256i factor_rgbx_avx2(__m256i s, __m256i keep,
+                                       __m128i shift, __m256i va)
+{
+    __m256i f = _mm256_srl_epi64(_mm256_and_si256(s, keep), shift);
+
+    f = _mm256_or_si256(f, _mm256_slli_epi64(f, 16));
+    f = _mm256_or_si256(f, _mm256_slli_epi64(f, 32));
+    return div255_avx2(_mm256_mullo_epi16(f, va));
+}
+
+VLC_AVX2
+static void RGBXAVX2(uint8_t *dst, const uint8_t *src, unsigned count,
+                     int alpha, unsigned ox)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i va = _mm256_set1_epi16(alpha);
+    const __m128i shift = _mm_cvtsi32_si128(16 * ox);
+    const __m256i keep = _mm256_sll_epi64(_mm256_set1_epi64x(0xffff), shift);
+    const __m256i amask = _mm256_sll_epi32(_mm256_set1_epi32(0xff),
+                                           _mm_cvtsi32_si128(8 * ox));
+    unsigned i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        const __m256i s = _mm256_loadu_si256((const __m256i *)&src[4 * i]);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(s, amask),
+                                                    zero)) == -1)
+            continue;
+
+        const __m256i d = _mm256_loadu_si256((const __m256i *)&dst[4 * i]);
+        const __m256i dlo = low_epu16_avx2(d), dhi = high_epu16_avx2(d);
+        const __m256i slo = low_epu16_avx2(s), shi = high_epu16_avx2(s);
+        __m256i lo = merge_avx2(dlo, slo,
+                                factor_rgbx_avx2(slo, keep, shift, va));
+        __m256i hi = merge_avx2(dhi, shi,
+                                factor_rgbx_avx2(shi, keep, shift, va));
+
+        /* leave the destination padding byte untouched */
+        lo = _mm256_or_si256(_mm256_andnot_si256(keep, lo),
+                             _mm256_and_si256(keep, dlo));
+        hi = _mm256_or_si256(_mm256_andnot_si256(keep, hi),
+                             _mm256_and_si256(keep, dhi));
+        _mm256_storeu_si256((__m256i *)&dst[4 * i], pack_avx2(lo, hi));
+    }
+    RGBXGeneric(&dst[4 * i], &src[4 * i], count - i, alpha, ox);
+}
+#endif
+
+/*****************************************************************************
+ * ARM NEON
+ *****************************************************************************/
+#ifdef CAN_COMPILE_NEON_INTRINSICS
+static inline uint8x8_t div255_neon(uint16x8_t v)
+{
+    /* ((v >> 8) + v + 1) >> 8, narrowed */
+    return vaddhn_u16(vsraq_n_u16(v, v, 8), vdupq_n_u16(1));
+}
+
+static inline uint8x8_t merge_neon(uint8x8_t d, uint8x8_t s, uint8x8_t f)
+{
+    return div255_neon(vmlal_u8(vmull_u8(d, vsub_u8(vdup_n_u8(255), f)),
+                                s, f));
+}
+
+static inline uint8x16_t merge16_neon(uint8x16_t d, uint8x16_t s,
+                                      uint8x16_t f)
+{
+    return vcombine_u8(merge_neon(vget_low_u8(d), vget_low_u8(s),
+                                  vget_low_u8(f)),
+                       merge_neon(vget_high_u8(d), vget_high_u8(s),
+                                  vget_high_u8(f)));
+}
+
+static inline uint8x16_t factor_neon(uint8x16_t a, uint8x8_t va)
+{
+    return vcombine_u8(div255_neon(vmull_u8(vget_low_u8(a), va)),
+                       div255_neon(vmull_u8(vget_high_u8(a), va)));
+}
+
+static inline bool is_zero_neon(uint8x16_t a)
+{
+    const uint8x8_t r = vorr_u8(vget_low_u8(a), vget_high_u8(a));
+
+    return vget_lane_u64(vreinterpret_u64_u8(r), 0) == 0;
+}
+
+static void PlaneNEON(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                      unsigned count, int alpha)
+{
+    const uint8x8_t va = vdup_n_u8(alpha);
+    unsigned i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        const uint8x16_t f = vld1q_u8(&a[i]);
+        if (is_zero_neon(f))
+            continue;
+
+        vst1q_u8(&dst[i], merge16_neon(vld1q_u8(&dst[i]), vld1q_u8(&src[i]),
+                                       factor_neon(f, va)));
+    }
+    PlaneGeneric(&dst[i], &src[i], &a[i], count - i, alpha);
+}
+
+static void PlaneSub2NEON(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                          unsigned count, int alpha)
+{
+    const uint8x8_t va = vdup_n_u8(alpha);
+    unsigned i;
+
+    for (i = 0; i + 16 < count; i += 16) {
+        const uint8x16_t f = vld2q_u8(&a[2 * i]).val[0];
+        if (is_zero_neon(f))
+            continue;
+
+        vst1q_u8(&dst[i], merge16_neon(vld1q_u8(&dst[i]),
+                                       vld2q_u8(&src[2 * i]).val[0],
+                                       factor_neon(f, va)));
+    }
+    PlaneSub2Generic(&dst[i], &src[2 * i], &a[2 * i], count - i, alpha);
+}
+
+static void UVNEON(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                   const uint8_t *a, unsigned count, int alpha)
+{
+    const uint8x8_t va = vdup_n_u8(alpha);
+    unsigned i;
+
+    for (i = 0; i + 16 < count; i += 16) {
+        uint8x16_t f = vld2q_u8(&a[2 * i]).val[0];
+        if (is_zero_neon(f))
+            continue;
+
+        uint8x16x2_t d = vld2q_u8(&dst[2 * i]);
+
+        f = factor_neon(f, va);
+        d.val[0] = merge16_neon(d.val[0], vld2q_u8(&u[2 * i]).val[0], f);
+        d.val[1] = merge16_neon(d.val[1], vld2q_u8(&v[2 * i]).val[0], f);
+        vst2q_u8(&dst[2 * i], d);
+    }
+    UVGeneric(&dst[2 * i], &u[2 * i], &v[2 * i], &a[2 * i], count - i, alpha);
+}
+
+static void RGBXNEON(uint8_t *dst, const uint8_t *src, unsigned count,
+                     int alpha, unsigned ox)
+{
+    const uint8x8_t va = vdup_n_u8(alpha);
+    unsigned i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        const uint8x16x4_t s = vld4q_u8(&src[4 * i]);
+        if (is_zero_neon(s.val[ox]))
+            continue;
+
+        const uint8x16_t f = factor_neon(s.val[ox], va);
+        uint8x16x4_t d = vld4q_u8(&dst[4 * i]);
+
+        for (unsigned c = 0; c < 4; c++)
+            if (c != ox)
+                d.val[c] = merge16_neon(d.val[c], s.val[c], f);
+        vst4q_u8(&dst[4 * i], d);
+    }
+    RGBXGeneric(&dst[4 * i], &src[4 * i], count - i, alpha, ox);
+}
+#endif
+
+void BlendMergeGetFunctions(blend_merge_t *m)
+{
+    m->plane      = PlaneGeneric;
+    m->plane_sub2 = PlaneSub2Generic;
+    m->uv         = UVGeneric;
+    m->rgbx       = RGBXGeneric;
+
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2()) {
+        m->plane      = PlaneSSE2;
+        m->plane_sub2 = PlaneSub2SSE2;
+        m->uv         = UVSSE2;
+        m->rgbx       = RGBXSSE2;
+    }
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2()) {
+        m->plane      = PlaneAVX2;
+        m->plane_sub2 = PlaneSub2AVX2;
+        m->uv         = UVAVX2;
+        m->rgbx       = RGBXAVX2;
+    }
+#endif
+#ifdef CAN_COMPILE_NEON_INTRINSICS
+    if (vlc_CPU_ARM_NEON()) {
+        m->plane      = PlaneNEON;
+        m->plane_sub2 = PlaneSub2NEON;
+        m->uv         = UVNEON;
+        m->rgbx       = RGBXNEON;
+    }
+#endif
+}
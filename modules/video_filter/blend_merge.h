@@ -0,0 +1,74 @@
+/*****************************************************************************
+ * blend_merge.h : line blending routines for the blend module
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_BLEND_MERGE_H
+#define VLC_BLEND_MERGE_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \file
+ * Vectorized line blending for the common 8-bits subpicture blending cases.
+ *
+ * Every routine computes, for each sample, the same thing as the generic C++
+ * code of blend.cpp: with f = div255(alpha * a), the destination becomes
+ * div255((255 - f) * dst + f * src). The results are bit-exact.
+ *
+ * Routines taking a source "step" of 2 read every other sample of src and a
+ * (4:4:4 source onto a subsampled destination chroma plane).
+ */
+
+/**
+ * Blends count samples of a plane.
+ */
+typedef void (*blend_plane_t)(uint8_t *dst, const uint8_t *src,
+                              const uint8_t *a, unsigned count, int alpha);
+
+/**
+ * Blends count interleaved chroma pairs (NV12 chroma plane) from two
+ * source planes read with a step of 2.
+ */
+typedef void (*blend_uv_t)(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                           const uint8_t *a, unsigned count, int alpha);
+
+/**
+ * Blends count 4-bytes pixels. src is in the destination byte order, with
+ * the source alpha in the byte ox which is left untouched in dst.
+ */
+typedef void (*blend_rgbx_t)(uint8_t *dst, const uint8_t *src,
+                             unsigned count, int alpha, unsigned ox);
+
+typedef struct
+{
+    blend_plane_t plane;      /* source step 1 */
+    blend_plane_t plane_sub2; /* source step 2 */
+    blend_uv_t    uv;
+    blend_rgbx_t  rgbx;
+} blend_merge_t;
+
+void BlendMergeGetFunctions(blend_merge_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -68,6 +68,18 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
                                  " in")
 
+#define ALL_TEXT N_("Benchmark all the chromas")
+#define ALL_LONGTEXT N_("Blend synthetic pictures for every base and blend " \
+                        "chroma pair instead of the given images")
+
+#define WIDTH_TEXT N_("Width of the synthetic pictures")
+#define WIDTH_LONGTEXT N_("Width of the pictures blended when all the " \
+                          "chromas are benchmarked")
+
+#define HEIGHT_TEXT N_("Height of the synthetic pictures")
+#define HEIGHT_LONGTEXT N_("Height of the pictures blended when all the " \
+                           "chromas are benchmarked")
+
 #define CFG_PREFIX "blendbench-"
 
 vlc_module_begin ()
@@ -95,12 +107,29 @@ vlc_module_begin ()
     add_string( CFG_PREFIX "blend-chroma", "YUVA", BLEND_CHROMA_TEXT,
               BLEND_CHROMA_LONGTEXT, false )
 
+    set_section( N_("All chromas"), NULL )
+    add_bool( CFG_PREFIX "all", false, ALL_TEXT, ALL_LONGTEXT, false )
+    add_integer( CFG_PREFIX "width", 1280, WIDTH_TEXT, WIDTH_LONGTEXT, false )
+    add_integer( CFG_PREFIX "height", 720, HEIGHT_TEXT, HEIGHT_LONGTEXT,
+                 false )
+
     set_callbacks( Create, Destroy )
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
     "loops", "alpha", "base-image", "base-chroma", "blend-image",
-    "blend-chroma", NULL
+    "blend-chroma", "all", "width", "height", NULL
+};
+
+/* Chromas benchmarked with blendbench-all */
+static const vlc_fourcc_t p_base_chromas[] = {
+    VLC_CODEC_I420, VLC_CODEC_YV12, VLC_CODEC_I422, VLC_CODEC_I444,
+    VLC_CODEC_NV12, VLC_CODEC_NV21, VLC_CODEC_YUYV, VLC_CODEC_UYVY,
+    VLC_CODEC_RGB15, VLC_CODEC_RGB16, VLC_CODEC_RGB24, VLC_CODEC_RGB32,
+    VLC_CODEC_RGBA, 0
+};
+static const vlc_fourcc_t p_blend_chromas[] = {
+    VLC_CODEC_YUVA, VLC_CODEC_RGBA, VLC_CODEC_YUVP, 0
 };
 
 /*****************************************************************************
@@ -109,7 +138,9 @@ static const char *const ppsz_filter_options[] = {
 struct filter_sys_t
 {
     bool b_done;
+    bool b_all;
     int i_loops, i_alpha;
+    int i_width, i_height;
 
     picture_t *p_base_image;
     picture_t *p_blend_image;
@@ -175,6 +206,25 @@ static int Create( vlc_object_t *p_this )
     p_sys->i_alpha = var_CreateGetIntegerCommand( p_filter,
                                                   CFG_PREFIX "alpha" );
 
+    p_sys->p_base_image = NULL;
+    p_sys->p_blend_image = NULL;
+    p_sys->b_all = var_CreateGetBoolCommand( p_filter, CFG_PREFIX "all" );
+    if( p_sys->b_all )
+    {
+        p_sys->i_width = var_CreateGetIntegerCommand( p_filter,
+                                                      CFG_PREFIX "width" );
+        p_sys->i_height = var_CreateGetIntegerCommand( p_filter,
+                                                       CFG_PREFIX "height" );
+        if( p_sys->i_width <= 0 || p_sys->i_height <= 0 )
+        {
+            msg_Err( p_filter, "Invalid picture size %dx%d",
+                     p_sys->i_width, p_sys->i_height );
+            free( p_sys );
+            return VLC_EGENERIC;
+        }
+        return VLC_SUCCESS;
+    }
+
     psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
     p_sys->i_base_chroma = VLC_FOURCC( psz_temp[0], psz_temp[1],
                                        psz_temp[2], psz_temp[3] );
@@ -210,8 +260,133 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    picture_Release( p_sys->p_base_image );
-    picture_Release( p_sys->p_blend_image );
+    if( p_sys->p_base_image )
+        picture_Release( p_sys->p_base_image );
+    if( p_sys->p_blend_image )
+        picture_Release( p_sys->p_blend_image );
+    free( p_sys );
+}
+
+/*****************************************************************************
+ * blendbench_Run: blends p_blend onto p_base i_loops times
+ *****************************************************************************
+ * Returns the elapsed time, or -1 if there is no blending module for the pair
+ *****************************************************************************/
+static mtime_t blendbench_Run( filter_t *p_filter, picture_t *p_base,
+                               picture_t *p_blend )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    filter_t *p_blender;
+
+    p_blender = vlc_object_create( p_filter, sizeof(filter_t) );
+    if( !p_blender )
+        return -1;
+    p_blender->fmt_out.video = p_base->format;
+    p_blender->fmt_in.video = p_blend->format;
+    p_blender->p_module = module_need( p_blender, "video blending", NULL,
+                                       false );
+    if( !p_blender->p_module )
+    {
+        vlc_object_release( p_blender );
+        return -1;
+    }
+
+    mtime_t time = mdate();
+    for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
+    {
+        p_blender->pf_video_blend( p_blender, p_base, p_blend,
+                                   0, 0, p_sys->i_alpha );
+    }
+    time = mdate() - time;
+
+    module_unneed( p_blender, p_blender->p_module );
+    vlc_object_release( p_blender );
+    return time;
+}
+
+/*****************************************************************************
+ * blendbench_NewPicture: allocates a synthetic picture
+ *****************************************************************************
+ * The samples are a gradient, so that about one pixel in 256 of the blended
+ * pictures is fully transparent.
+ *****************************************************************************/
+static picture_t *blendbench_NewPicture( vlc_fourcc_t i_chroma,
+                                         int i_width, int i_height,
+                                         video_palette_t *p_palette )
+{
+    video_format_t fmt;
+
+    video_format_Init( &fmt, i_chroma );
+    fmt.i_width = fmt.i_visible_width = i_width;
+    fmt.i_height = fmt.i_visible_height = i_height;
+    fmt.p_palette = p_palette;
+
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    if( !p_pic )
+        return NULL;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+                p->p_pixels[y * p->i_pitch + x] = x + y;
+    }
+    return p_pic;
+}
+
+static void blendbench_RunAll( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const int i_width = p_sys->i_width, i_height = p_sys->i_height;
+    video_palette_t palette;
+
+    palette.i_entries = VIDEO_PALETTE_COLORS_MAX;
+    for( int i = 0; i < VIDEO_PALETTE_COLORS_MAX; i++ )
+    {
+        palette.palette[i][0] = i;
+        palette.palette[i][1] = 128;
+        palette.palette[i][2] = 255 - i;
+        palette.palette[i][3] = i;
+    }
+
+    for( const vlc_fourcc_t *p_base_chroma = p_base_chromas;
+         *p_base_chroma; p_base_chroma++ )
+    {
+        picture_t *p_base = blendbench_NewPicture( *p_base_chroma,
+                                                   i_width, i_height, NULL );
+        if( !p_base )
+            continue;
+
+        for( const vlc_fourcc_t *p_blend_chroma = p_blend_chromas;
+             *p_blend_chroma; p_blend_chroma++ )
+        {
+            picture_t *p_blend =
+                blendbench_NewPicture( *p_blend_chroma, i_width, i_height,
+                                       *p_blend_chroma == VLC_CODEC_YUVP ?
+                                       &palette : NULL );
+            if( !p_blend )
+                continue;
+
+            mtime_t time = blendbench_Run( p_filter, p_base, p_blend );
+            if( time < 0 )
+                msg_Warn( p_filter, "%4.4s onto %4.4s: not supported",
+                          (const char *)p_blend_chroma,
+                          (const char *)p_base_chroma );
+            else
+                msg_Info( p_filter, "%4.4s onto %4.4s: %f Mpixels/second",
+                          (const char *)p_blend_chroma,
+                          (const char *)p_base_chroma,
+                          (float) p_sys->i_loops * i_width * i_height /
+                              __MAX( time, 1 ) );
+
+            /* The palette is not owned by the picture */
+            p_blend->format.p_palette = NULL;
+            picture_Release( p_blend );
+        }
+        picture_Release( p_base );
+    }
 }
 
 /*****************************************************************************
@@ -220,35 +395,31 @@ static void Destroy( vlc_object_t *p_this )
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    filter_t *p_blend;
 
     if( p_sys->b_done )
         return p_pic;
 
-    p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
-    if( !p_blend )
+    if( p_sys->b_all )
     {
-        picture_Release( p_pic );
-        return NULL;
+        blendbench_RunAll( p_filter );
+        p_sys->b_done = true;
+        return p_pic;
     }
-    p_blend->fmt_out.video = p_sys->p_base_image->format;
-    p_blend->fmt_in.video = p_sys->p_blend_image->format;
-    p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
-    if( !p_blend->p_module )
+
+    if( !p_sys->p_blend_image )
     {
         picture_Release( p_pic );
-        vlc_object_release( p_blend );
         return NULL;
     }
 
-    mtime_t time = mdate();
-    for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
+    mtime_t time = blendbench_Run( p_filter, p_sys->p_base_image,
+                                   p_sys->p_blend_image );
+    if( time < 0 )
     {
-        p_blend->pf_video_blend( p_blend,
-                                 p_sys->p_base_image, p_sys->p_blend_image,
-                                 0, 0, p_sys->i_alpha );
+        picture_Release( p_pic );
+        return NULL;
     }
-    time = mdate() - time;
+    time = __MAX( time, 1 );
 
     msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
               time / 1000000.0f );
@@ -258,10 +429,6 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
                   p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
                   p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
 
-    module_unneed( p_blend, p_blend->p_module );
-
-    vlc_object_release( p_blend );
-
     p_sys->b_done = true;
     return p_pic;
 }
@@ -0,0 +1,293 @@
+/*****************************************************************************
+ * chromabench.c : chroma conversion benchmark plugin for vlc
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_modules.h>
+#include <vlc_filter.h>
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int Create( vlc_object_t * );
+static void Destroy( vlc_object_t * );
+
+static picture_t *Filter( filter_t *, picture_t * );
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+
+#define LOOPS_TEXT N_("Number of conversions")
+#define LOOPS_LONGTEXT N_("The number of pictures converted by each " \
+                          "conversion module")
+
+#define CHROMA_IN_TEXT N_("Source chroma")
+#define CHROMA_IN_LONGTEXT N_("Chroma of the pictures to convert")
+
+#define CHROMA_OUT_TEXT N_("Destination chroma")
+#define CHROMA_OUT_LONGTEXT N_("Chroma the pictures are converted to")
+
+#define WIDTH_TEXT N_("Picture width")
+#define WIDTH_LONGTEXT N_("Width of the pictures to convert")
+
+#define HEIGHT_TEXT N_("Picture height")
+#define HEIGHT_LONGTEXT N_("Height of the pictures to convert")
+
+#define CFG_PREFIX "chromabench-"
+
+vlc_module_begin ()
+    set_description( N_("Chroma conversion benchmark filter") )
+    set_shortname( N_("Chromabench" ))
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_VFILTER )
+    set_capability( "video filter2", 0 )
+
+    set_section( N_("Benchmarking"), NULL )
+    add_integer( CFG_PREFIX "loops", 100, LOOPS_TEXT,
+                 LOOPS_LONGTEXT, false )
+    add_string( CFG_PREFIX "chroma-in", "I420", CHROMA_IN_TEXT,
+                CHROMA_IN_LONGTEXT, false )
+    add_string( CFG_PREFIX "chroma-out", "RV32", CHROMA_OUT_TEXT,
+                CHROMA_OUT_LONGTEXT, false )
+    add_integer( CFG_PREFIX "width", 1920, WIDTH_TEXT,
+                 WIDTH_LONGTEXT, false )
+    add_integer( CFG_PREFIX "height", 1080, HEIGHT_TEXT,
+                 HEIGHT_LONGTEXT, false )
+
+    set_callbacks( Create, Destroy )
+vlc_module_end ()
+
+static const char *const ppsz_filter_options[] = {
+    "loops", "chroma-in", "chroma-out", "width", "height", NULL
+};
+
+/*****************************************************************************
+ * filter_sys_t: filter method descriptor
+ *****************************************************************************/
+struct filter_sys_t
+{
+    bool b_done;
+    int i_loops;
+
+    video_format_t fmt_in;
+    video_format_t fmt_out;
+};
+
+static vlc_fourcc_t chromabench_GetChroma( filter_t *p_filter,
+                                           const char *psz_var )
+{
+    char *psz_chroma = var_CreateGetString( p_filter, psz_var );
+    vlc_fourcc_t i_chroma = 0;
+
+    if( psz_chroma != NULL )
+        i_chroma = vlc_fourcc_GetCodecFromString( VIDEO_ES, psz_chroma );
+    if( i_chroma == 0 )
+        msg_Err( p_filter, "invalid chroma \"%s\"",
+                 psz_chroma ? psz_chroma : "" );
+    free( psz_chroma );
+    return i_chroma;
+}
+
+/*****************************************************************************
+ * Create: allocates video thread output method
+ *****************************************************************************/
+static int Create( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys;
+    vlc_fourcc_t i_chroma_in, i_chroma_out;
+    int i_width, i_height;
+
+    /* needed to get options passed in transcode using the
+     * chromabench{name=value} syntax */
+    config_ChainParse( p_filter, CFG_PREFIX, ppsz_filter_options,
+                       p_filter->p_cfg );
+
+    i_chroma_in = chromabench_GetChroma( p_filter, CFG_PREFIX "chroma-in" );
+    i_chroma_out = chromabench_GetChroma( p_filter, CFG_PREFIX "chroma-out" );
+    if( i_chroma_in == 0 || i_chroma_out == 0 )
+        return VLC_EGENERIC;
+
+    i_width = var_CreateGetInteger( p_filter, CFG_PREFIX "width" );
+    i_height = var_CreateGetInteger( p_filter, CFG_PREFIX "height" );
+    if( i_width <= 0 || i_height <= 0 )
+    {
+        msg_Err( p_filter, "invalid picture size %dx%d", i_width, i_height );
+        return VLC_EGENERIC;
+    }
+
+    /* Allocate structure */
+    p_filter->p_sys = malloc( sizeof( filter_sys_t ) );
+    if( p_filter->p_sys == NULL )
+        return VLC_ENOMEM;
+
+    p_sys = p_filter->p_sys;
+    p_sys->b_done = false;
+    p_sys->i_loops = var_CreateGetInteger( p_filter, CFG_PREFIX "loops" );
+
+    video_format_Init( &p_sys->fmt_in, 0 );
+    video_format_Setup( &p_sys->fmt_in, i_chroma_in, i_width, i_height,
+                        i_width, i_height, 1, 1 );
+    video_format_FixRgb( &p_sys->fmt_in );
+    video_format_Init( &p_sys->fmt_out, 0 );
+    video_format_Setup( &p_sys->fmt_out, i_chroma_out, i_width, i_height,
+                        i_width, i_height, 1, 1 );
+    video_format_FixRgb( &p_sys->fmt_out );
+
+    p_filter->pf_video_filter = Filter;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Destroy: destroy video thread output method
+ *****************************************************************************/
+static void Destroy( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    free( p_filter->p_sys );
+}
+
+static picture_t *chromabench_NewPicture( filter_t *p_conv )
+{
+    return picture_NewFromFormat( &p_conv->fmt_out.video );
+}
+
+/* Fills the source picture with something less regular than a flat colour */
+static void chromabench_FillPicture( picture_t *p_pic )
+{
+    uint32_t i_seed = 0x12345678;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+            {
+                i_seed = i_seed * 1103515245 + 12345;
+                p->p_pixels[y * p->i_pitch + x] = i_seed >> 24;
+            }
+    }
+}
+
+/* Converts the source picture i_loops times with the named module.
+ * Returns the elapsed time, or -1 if the module does not handle the
+ * conversion. */
+static mtime_t chromabench_Run( filter_t *p_filter, const char *psz_name,
+                                picture_t *p_src )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    filter_t *p_conv;
+    mtime_t time = -1;
+
+    p_conv = vlc_object_create( p_filter, sizeof(filter_t) );
+    if( !p_conv )
+        return -1;
+
+    es_format_Init( &p_conv->fmt_in, VIDEO_ES, p_sys->fmt_in.i_chroma );
+    p_conv->fmt_in.video = p_sys->fmt_in;
+    es_format_Init( &p_conv->fmt_out, VIDEO_ES, p_sys->fmt_out.i_chroma );
+    p_conv->fmt_out.video = p_sys->fmt_out;
+    p_conv->owner.video.buffer_new = chromabench_NewPicture;
+
+    p_conv->p_module = module_need( p_conv, "video filter2", psz_name, true );
+    if( p_conv->p_module )
+    {
+        time = mdate();
+        for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
+        {
+            picture_t *p_dst = p_conv->pf_video_filter( p_conv,
+                                                        picture_Hold( p_src ) );
+            if( p_dst == NULL )
+            {
+                msg_Warn( p_filter, "%s failed to convert", psz_name );
+                time = -1;
+                break;
+            }
+            picture_Release( p_dst );
+        }
+        if( time >= 0 )
+            time = mdate() - time;
+
+        module_unneed( p_conv, p_conv->p_module );
+    }
+
+    vlc_object_release( p_conv );
+    return time;
+}
+
+/*****************************************************************************
+ * Render: benchmarks every module of the conversion, once
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    picture_t *p_src;
+    module_t **pp_modules;
+    size_t i_modules;
+    const double f_pixels = (double)p_sys->fmt_in.i_visible_width
+                          * p_sys->fmt_in.i_visible_height * p_sys->i_loops;
+
+    if( p_sys->b_done )
+        return p_pic;
+    p_sys->b_done = true;
+
+    p_src = picture_NewFromFormat( &p_sys->fmt_in );
+    if( !p_src )
+        return p_pic;
+    chromabench_FillPicture( p_src );
+
+    msg_Info( p_filter, "Converting %d %4.4s pictures to %4.4s (%ux%u)",
+              p_sys->i_loops, (const char *)&p_sys->fmt_in.i_chroma,
+              (const char *)&p_sys->fmt_out.i_chroma,
+              p_sys->fmt_in.i_visible_width, p_sys->fmt_in.i_visible_height );
+
+    pp_modules = module_list_get( &i_modules );
+    for( size_t i = 0; i < i_modules; i++ )
+    {
+        const module_t *p_module = pp_modules[i];
+        const char *psz_name = module_get_object( p_module );
+
+        if( !module_provides( p_module, "video filter2" )
+         || !strcmp( psz_name, "chromabench" ) )
+            continue;
+
+        mtime_t time = chromabench_Run( p_filter, psz_name, p_src );
+        if( time < 0 )
+            continue;
+
+        msg_Info( p_filter, "%s: %f sec, %f Mpixel/s", psz_name,
+                  time / 1000000.0, time > 0 ? f_pixels / time : 0. );
+    }
+    module_list_free( pp_modules );
+
+    picture_Release( p_src );
+    return p_pic;
+}
@@ -0,0 +1,266 @@
+/*****************************************************************************
+ * convolution.h: separable convolution of 8 bits planes
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VIDEO_FILTER_CONVOLUTION_H
+#define VLC_VIDEO_FILTER_CONVOLUTION_H
+
+#include <math.h>
+
+/*
+ * Separable convolution in fixed point, shared by the blur and sharpen
+ * filters: a horizontal pass per line, then a vertical pass over the lines.
+ * The horizontally filtered lines are kept in a ring only as high as the
+ * vertical kernel, so that the working set stays in the cache whatever the
+ * picture size. The edges are replicated beforehand: the inner loops have
+ * neither branch nor bound check, and are vectorized by the compiler.
+ * Horizontal bands of a plane can be filtered independently (see bands.h).
+ */
+
+/* The taps of a normalized kernel sum to 1 << CONV_TAP_BITS */
+#define CONV_TAP_BITS 12
+
+typedef struct
+{
+    int      i_radius;
+    int16_t *pi_taps; /* 2 * i_radius + 1, non negative */
+} conv_kernel_t;
+
+/* Normalized gaussian kernel, up to 3 standard deviations */
+static inline int conv_kernel_InitGaussian( conv_kernel_t *p_kernel,
+                                            double f_sigma )
+{
+    const int i_radius = f_sigma > 0. ? (int)( 3. * f_sigma ) : 0;
+    int16_t *pi_taps = malloc( ( 2 * i_radius + 1 ) * sizeof( *pi_taps ) );
+    if( unlikely(pi_taps == NULL) )
+        return VLC_ENOMEM;
+
+    double f_sum = 0.;
+    for( int x = -i_radius; x <= i_radius; x++ )
+        f_sum += exp( -( x * x ) / ( 2. * f_sigma * f_sigma ) );
+
+    int i_sum = 0;
+    for( int x = -i_radius; x <= i_radius; x++ )
+    {
+        pi_taps[i_radius + x] =
+            lround( exp( -( x * x ) / ( 2. * f_sigma * f_sigma ) ) / f_sum
+                    * ( 1 << CONV_TAP_BITS ) );
+        i_sum += pi_taps[i_radius + x];
+    }
+    /* Rounding leftover, so that a flat area stays flat */
+    pi_taps[i_radius] += ( 1 << CONV_TAP_BITS ) - i_sum;
+
+    p_kernel->i_radius = i_radius;
+    p_kernel->pi_taps = pi_taps;
+    return VLC_SUCCESS;
+}
+
+static inline void conv_kernel_Clean( conv_kernel_t *p_kernel )
+{
+    free( p_kernel->pi_taps );
+}
+
+/* Horizontal pass of a line of i_width pixels, shifted right by i_shift.
+ * p_padded holds i_width + 2 * radius pixels, p_acc i_width values. */
+static inline void conv_Horizontal( int16_t *restrict p_out,
+                                    int32_t *restrict p_acc,
+                                    uint8_t *restrict p_padded,
+                                    const uint8_t *p_in, int i_width,
+                                    const conv_kernel_t *p_kernel,
+                                    int i_shift )
+{
+    const int i_radius = p_kernel->i_radius;
+    const int16_t *pi_taps = p_kernel->pi_taps;
+
+    memset( p_padded, p_in[0], i_radius );
+    memcpy( p_padded + i_radius, p_in, i_width );
+    memset( p_padded + i_radius + i_width, p_in[i_width - 1], i_radius );
+
+    /* Four or two taps at a time (their count after the first is even),
+     * to spare accesses to the accumulators */
+    for( int x = 0; x < i_width; x++ )
+        p_acc[x] = pi_taps[0] * p_padded[x];
+    int k = 1;
+    for( ; k + 3 <= 2 * i_radius; k += 4 )
+    {
+        const int16_t i_tap0 = pi_taps[k], i_tap1 = pi_taps[k + 1];
+        const int16_t i_tap2 = pi_taps[k + 2], i_tap3 = pi_taps[k + 3];
+        const uint8_t *p_src = p_padded + k;
+        for( int x = 0; x < i_width; x++ )
+            p_acc[x] += i_tap0 * p_src[x] + i_tap1 * p_src[x + 1]
+                      + i_tap2 * p_src[x + 2] + i_tap3 * p_src[x + 3];
+    }
+    for( ; k <= 2 * i_radius; k += 2 )
+    {
+        const int16_t i_tap0 = pi_taps[k], i_tap1 = pi_taps[k + 1];
+        const uint8_t *p_src0 = p_padded + k, *p_src1 = p_padded + k + 1;
+        for( int x = 0; x < i_width; x++ )
+            p_acc[x] += i_tap0 * p_src0[x] + i_tap1 * p_src1[x];
+    }
+
+    const int32_t i_round = i_shift > 0 ? 1 << ( i_shift - 1 ) : 0;
+    for( int x = 0; x < i_width; x++ )
+        p_out[x] = ( p_acc[x] + i_round ) >> i_shift;
+}
+
+/* Vertical pass over the 2 * radius + 1 given lines, not shifted, taps
+ * grouped as in conv_Horizontal() */
+static inline void conv_Vertical( int32_t *restrict p_acc,
+                                  const int16_t *const *pp_lines,
+                                  int i_width, const conv_kernel_t *p_kernel )
+{
+    const int16_t *pi_taps = p_kernel->pi_taps;
+
+    for( int x = 0; x < i_width; x++ )
+        p_acc[x] = pi_taps[0] * pp_lines[0][x];
+    int k = 1;
+    for( ; k + 3 <= 2 * p_kernel->i_radius; k += 4 )
+    {
+        const int16_t i_tap0 = pi_taps[k], i_tap1 = pi_taps[k + 1];
+        const int16_t i_tap2 = pi_taps[k + 2], i_tap3 = pi_taps[k + 3];
+        const int16_t *restrict p_src0 = pp_lines[k];
+        const int16_t *restrict p_src1 = pp_lines[k + 1];
+        const int16_t *restrict p_src2 = pp_lines[k + 2];
+        const int16_t *restrict p_src3 = pp_lines[k + 3];
+        for( int x = 0; x < i_width; x++ )
+            p_acc[x] += i_tap0 * p_src0[x] + i_tap1 * p_src1[x]
+                      + i_tap2 * p_src2[x] + i_tap3 * p_src3[x];
+    }
+    for( ; k <= 2 * p_kernel->i_radius; k += 2 )
+    {
+        const int16_t i_tap0 = pi_taps[k], i_tap1 = pi_taps[k + 1];
+        const int16_t *restrict p_src0 = pp_lines[k];
+        const int16_t *restrict p_src1 = pp_lines[k + 1];
+        for( int x = 0; x < i_width; x++ )
+            p_acc[x] += i_tap0 * p_src0[x] + i_tap1 * p_src1[x];
+    }
+}
+
+/* Ring of the horizontally filtered lines of a plane */
+typedef struct
+{
+    const plane_t     *p_src;
+    const conv_kernel_t *p_kernel;
+    int                i_shift;
+    int                i_width;
+    int                i_lines; /* in the ring */
+    int                i_next;  /* next line of the plane to filter */
+
+    int16_t           *p_ring;
+    int32_t           *p_acc;
+    uint8_t           *p_padded;
+    const int16_t    **pp_lines;
+} conv_ring_t;
+
+/* The lines will be requested from line i_first */
+static inline int conv_ring_Init( conv_ring_t *p_ring, const plane_t *p_src,
+                                  const conv_kernel_t *p_h, int i_shift,
+                                  int i_vradius, int i_first )
+{
+    p_ring->p_src = p_src;
+    p_ring->p_kernel = p_h;
+    p_ring->i_shift = i_shift;
+    p_ring->i_width = p_src->i_visible_pitch;
+    p_ring->i_lines = 2 * i_vradius + 1;
+    p_ring->i_next = __MAX( i_first - i_vradius, 0 );
+
+    p_ring->p_ring = malloc( p_ring->i_lines * p_ring->i_width
+                             * sizeof( *p_ring->p_ring ) );
+    p_ring->p_acc = malloc( p_ring->i_width * sizeof( *p_ring->p_acc ) );
+    p_ring->p_padded = malloc( p_ring->i_width + 2 * p_h->i_radius );
+    p_ring->pp_lines = malloc( p_ring->i_lines * sizeof( *p_ring->pp_lines ) );
+    if( unlikely(p_ring->p_ring == NULL || p_ring->p_acc == NULL
+              || p_ring->p_padded == NULL || p_ring->pp_lines == NULL) )
+    {
+        free( p_ring->p_ring );
+        free( p_ring->p_acc );
+        free( p_ring->p_padded );
+        free( p_ring->pp_lines );
+        return VLC_ENOMEM;
+    }
+    return VLC_SUCCESS;
+}
+
+static inline void conv_ring_Clean( conv_ring_t *p_ring )
+{
+    free( p_ring->p_ring );
+    free( p_ring->p_acc );
+    free( p_ring->p_padded );
+    free( p_ring->pp_lines );
+}
+
+/* Returns the horizontally filtered lines around line i_y of the plane, the
+ * lines out of the plane being replaced by its first or last one. The lines
+ * must be requested in order. */
+static inline const int16_t *const *conv_ring_Get( conv_ring_t *p_ring,
+                                                   int i_y )
+{
+    const int i_radius = p_ring->i_lines / 2;
+    const int i_last = p_ring->p_src->i_visible_lines - 1;
+    const int i_top = __MIN( i_y + i_radius, i_last );
+
+    for( ; p_ring->i_next <= i_top; p_ring->i_next++ )
+        conv_Horizontal( &p_ring->p_ring[( p_ring->i_next % p_ring->i_lines )
+                                         * p_ring->i_width],
+                         p_ring->p_acc, p_ring->p_padded,
+                         &p_ring->p_src->p_pixels[p_ring->i_next
+                                                  * p_ring->p_src->i_pitch],
+                         p_ring->i_width, p_ring->p_kernel, p_ring->i_shift );
+
+    for( int k = 0; k < p_ring->i_lines; k++ )
+    {
+        const int i_line = VLC_CLIP( i_y - i_radius + k, 0, i_last );
+        p_ring->pp_lines[k] = &p_ring->p_ring[( i_line % p_ring->i_lines )
+                                              * p_ring->i_width];
+    }
+    return p_ring->pp_lines;
+}
+
+/* Convolution of the lines i_first to i_end (excluded) of a plane of 1 byte
+ * pixels with normalized kernels */
+static inline int conv_Plane( plane_t *p_dst, const plane_t *p_src,
+                              const conv_kernel_t *p_h,
+                              const conv_kernel_t *p_v,
+                              int i_first, int i_end )
+{
+    /* The horizontal pass keeps 7 bits of fraction, to fit in 16 bits */
+    const int i_hshift = CONV_TAP_BITS - 7;
+    const int i_vshift = CONV_TAP_BITS + 7;
+    conv_ring_t ring;
+
+    if( conv_ring_Init( &ring, p_src, p_h, i_hshift, p_v->i_radius, i_first ) )
+        return VLC_ENOMEM;
+
+    const int i_width = __MIN( p_src->i_visible_pitch, p_dst->i_visible_pitch );
+    i_end = __MIN( i_end, __MIN( p_src->i_visible_lines,
+                                 p_dst->i_visible_lines ) );
+    for( int y = i_first; y < i_end; y++ )
+    {
+        conv_Vertical( ring.p_acc, conv_ring_Get( &ring, y ), i_width, p_v );
+
+        uint8_t *restrict p_out = &p_dst->p_pixels[y * p_dst->i_pitch];
+        for( int x = 0; x < i_width; x++ )
+            p_out[x] = ( ring.p_acc[x] + ( 1 << ( i_vshift - 1 ) ) )
+                       >> i_vshift;
+    }
+    conv_ring_Clean( &ring );
+    return VLC_SUCCESS;
+}
+
+#endif
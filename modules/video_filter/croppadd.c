@@ -42,6 +42,7 @@ static int  OpenFilter ( vlc_object_t * );
 static void CloseFilter( vlc_object_t * );
 
 static picture_t *Filter( filter_t *, picture_t * );
+static picture_t *Crop( filter_t *, picture_t * );
 
 #define CROPTOP_TEXT N_( "Pixels to crop from top" )
 #define CROPTOP_LONGTEXT N_( \
@@ -181,7 +182,12 @@ static int OpenFilter( vlc_object_t *p_this )
         - p_sys->i_cropleft - p_sys->i_cropright
         + p_sys->i_paddleft + p_sys->i_paddright;
 
-    p_filter->pf_video_filter = Filter;
+    /* Without padding, the output shares the pixels of the input */
+    if( p_sys->i_paddtop == 0 && p_sys->i_paddbottom == 0
+     && p_sys->i_paddleft == 0 && p_sys->i_paddright == 0 )
+        p_filter->pf_video_filter = Crop;
+    else
+        p_filter->pf_video_filter = Filter;
 
     msg_Dbg( p_filter, "Crop: Top: %d, Bottom: %d, Left: %d, Right: %d",
              p_sys->i_croptop, p_sys->i_cropbottom, p_sys->i_cropleft,
@@ -308,3 +314,55 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
+
+/****************************************************************************
+ * Crop: crop without copy
+ ****************************************************************************
+ * The output picture points into the planes of the input picture, which it
+ * holds until it is released itself.
+ ****************************************************************************/
+static void CropDestroy( picture_t *p_outpic )
+{
+    picture_Release( (picture_t *)p_outpic->p_sys );
+    free( p_outpic );
+}
+
+static picture_t *Crop( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( !p_pic ) return NULL;
+
+    picture_resource_t rsc = {
+        .p_sys = (picture_sys_t *)p_pic,
+        .pf_destroy = CropDestroy,
+    };
+
+    for( int i_plane = 0; i_plane < p_pic->i_planes; i_plane++ )
+    {
+        const plane_t *p_plane = &p_pic->p[i_plane];
+
+        /* Same rounding as in Filter() */
+        int i_xcrop = ( p_sys->i_cropleft * p_plane->i_visible_pitch )
+                      / p_pic->p->i_visible_pitch;
+        int i_ycrop = ( p_sys->i_croptop * p_plane->i_visible_lines )
+                      / p_pic->p->i_visible_lines;
+
+        rsc.p[i_plane].p_pixels = p_plane->p_pixels
+                                + i_ycrop * p_plane->i_pitch
+                                + i_xcrop * p_plane->i_pixel_pitch;
+        rsc.p[i_plane].i_lines = p_plane->i_lines - i_ycrop;
+        rsc.p[i_plane].i_pitch = p_plane->i_pitch;
+    }
+
+    picture_t *p_outpic = picture_NewFromResource( &p_filter->fmt_out.video,
+                                                   &rsc );
+    if( !p_outpic )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+    /* The input reference is now owned by the output picture */
+    picture_CopyProperties( p_outpic, p_pic );
+    return p_outpic;
+}
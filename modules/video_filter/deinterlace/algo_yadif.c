@@ -47,6 +47,81 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+/* Minimum number of lines of a band */
+#define YADIF_BAND_MIN_LINES (32)
+
+typedef struct
+{
+    picture_t *p_dst;
+    picture_t *p_prev;
+    picture_t *p_cur;
+    picture_t *p_next;
+    int        i_field;
+    int        i_parity;
+
+    void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
+                   int w, int prefs, int mrefs, int parity, int mode);
+} yadif_job_t;
+
+/* Renders the lines [1 + (lines - 2) * i_band / i_bands,
+ *                    1 + (lines - 2) * (i_band + 1) / i_bands) of each plane.
+ * The output lines only depend on the input pictures, so the bands can be
+ * rendered in parallel. */
+static void RenderYadifBand( void *p_opaque, unsigned i_band, unsigned i_bands )
+{
+    const yadif_job_t *job = p_opaque;
+    const int i_field = job->i_field;
+    const int yadif_parity = job->i_parity;
+
+    for( int n = 0; n < job->p_dst->i_planes; n++ )
+    {
+        const plane_t *prevp = &job->p_prev->p[n];
+        const plane_t *curp  = &job->p_cur->p[n];
+        const plane_t *nextp = &job->p_next->p[n];
+        plane_t *dstp        = &job->p_dst->p[n];
+
+        const int i_lines = dstp->i_visible_lines - 2;
+        const int y_start = 1 + i_lines * i_band / i_bands;
+        const int y_end   = 1 + i_lines * (i_band + 1) / i_bands;
+
+        for( int y = y_start; y < y_end; y++ )
+        {
+            if( (y % 2) == i_field  ||  yadif_parity == 2 )
+            {
+                memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                            &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+            }
+            else
+            {
+                int mode;
+                /* Spatial checks only when enough data */
+                mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+                assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+                job->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                             &prevp->p_pixels[y * prevp->i_pitch],
+                             &curp->p_pixels[y * curp->i_pitch],
+                             &nextp->p_pixels[y * nextp->i_pitch],
+                             dstp->i_visible_pitch,
+                             y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                             y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                             yadif_parity,
+                             mode );
+            }
+
+            /* We duplicate the first and last lines */
+            if( y == 1 )
+                memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+            else if( y == dstp->i_visible_lines - 2 )
+                memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+        }
+    }
+}
+
 int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
                  int i_order, int i_field )
 {
@@ -104,73 +179,52 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     /* Filter if we have all the pictures we need */
     if( p_prev && p_cur && p_next )
     {
-        /* */
-        void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
-                       int w, int prefs, int mrefs, int parity, int mode);
-
+        yadif_job_t job = {
+            .p_dst = p_dst, .p_prev = p_prev, .p_cur = p_cur, .p_next = p_next,
+            .i_field = i_field, .i_parity = yadif_parity,
+        };
+
+#if defined(HAVE_AVX2_INTRINSICS)
+        if( vlc_CPU_AVX2() )
+            job.filter = yadif_filter_line_avx2;
+        else
+#endif
 #if defined(HAVE_YADIF_SSSE3)
         if( vlc_CPU_SSSE3() )
-            filter = yadif_filter_line_ssse3;
+            job.filter = yadif_filter_line_ssse3;
         else
 #endif
 #if defined(HAVE_YADIF_SSE2)
         if( vlc_CPU_SSE2() )
-            filter = yadif_filter_line_sse2;
+            job.filter = yadif_filter_line_sse2;
         else
 #endif
 #if defined(HAVE_YADIF_MMX)
         if( vlc_CPU_MMX() )
-            filter = yadif_filter_line_mmx;
+            job.filter = yadif_filter_line_mmx;
         else
 #endif
-            filter = yadif_filter_line_c;
+#if defined(CAN_COMPILE_YADIF_NEON)
+        if( vlc_CPU_ARM_NEON() )
+            job.filter = yadif_filter_line_neon;
+        else
+#endif
+            job.filter = yadif_filter_line_c;
 
         if( p_sys->chroma->pixel_size == 2 )
-            filter = yadif_filter_line_c_16bit;
+            job.filter = yadif_filter_line_c_16bit;
+        else
+            for( int n = 0; n < p_dst->i_planes; n++ )
+                if( p_dst->p[n].i_visible_pitch < YADIF_SIMD_MIN_WIDTH )
+                    job.filter = yadif_filter_line_c;
 
-        for( int n = 0; n < p_dst->i_planes; n++ )
-        {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
+        /* Small frames are not worth waking the threads up */
+        unsigned i_bands = BandsCount( &p_sys->bands );
+        if( p_dst->p[0].i_visible_lines < (int)(YADIF_BAND_MIN_LINES * i_bands) )
+            i_bands = __MAX( p_dst->p[0].i_visible_lines
+                             / YADIF_BAND_MIN_LINES, 1 );
 
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
-        }
+        BandsRender( &p_sys->bands, RenderYadifBand, &job, i_bands );
 
         p_sys->i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
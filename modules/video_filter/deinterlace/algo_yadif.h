@@ -86,4 +86,23 @@ struct picture_t;
 int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
                  int i_order, int i_field );
 
+/* Intrinsics line filters, see yadif_simd.c. They need lines of at least
+ * YADIF_SIMD_MIN_WIDTH bytes. */
+#define YADIF_SIMD_MIN_WIDTH (16)
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define CAN_COMPILE_YADIF_NEON 1
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+void yadif_filter_line_avx2( uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                             uint8_t *next, int w, int prefs, int mrefs,
+                             int parity, int mode );
+#endif
+#ifdef CAN_COMPILE_YADIF_NEON
+void yadif_filter_line_neon( uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                             uint8_t *next, int w, int prefs, int mrefs,
+                             int parity, int mode );
+#endif
+
 #endif
@@ -92,6 +92,12 @@
                                     "in the Phosphor framerate doubler. "\
                                     "Default: Low.")
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads used by the Yadif "\
+                            "algorithms, each rendering a band of the "\
+                            "frame. 0 uses one thread per CPU, 1 renders "\
+                            "the whole frame in the filter thread.")
+
 vlc_module_begin ()
     set_description( N_("Deinterlacing video filter") )
     set_shortname( N_("Deinterlace" ))
@@ -111,6 +117,9 @@ vlc_module_begin ()
                 PHOSPHOR_DIMMER_LONGTEXT, true )
         change_integer_list( phosphor_dimmer_list, phosphor_dimmer_list_text )
         change_safe ()
+    add_integer_with_range( FILTER_CFG_PREFIX "threads", 0, 0, BANDS_THREADS_MAX,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
+        change_safe ()
     add_shortcut( "deinterlace" )
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -126,7 +135,7 @@ vlc_module_end ()
  * and reading logic for them implemented in Open().
  */
 static const char *const ppsz_filter_options[] = {
-    "mode", "phosphor-chroma", "phosphor-dimmer",
+    "mode", "phosphor-chroma", "phosphor-dimmer", "threads",
     NULL
 };
 
@@ -744,6 +753,20 @@ notsupp:
         p_sys->phosphor.i_dimmer_strength = 1;
     }
 
+    /* Only Yadif renders the lines of a frame independently */
+    unsigned i_bands = 1;
+    if( p_sys->i_mode == DEINTERLACE_YADIF ||
+        p_sys->i_mode == DEINTERLACE_YADIF2X )
+    {
+        i_bands = var_GetInteger( p_filter, FILTER_CFG_PREFIX "threads" );
+        if( i_bands == 0 )
+            i_bands = vlc_GetCPUCount();
+        i_bands = VLC_CLIP( i_bands, 1, BANDS_THREADS_MAX );
+    }
+    BandsInit( &p_sys->bands, i_bands );
+    if( BandsCount( &p_sys->bands ) > 1 )
+        msg_Dbg( p_filter, "using %u threads", BandsCount( &p_sys->bands ) );
+
     /* */
     video_format_t fmt;
     GetOutputFormat( p_filter, &fmt, &p_filter->fmt_in.video );
@@ -774,5 +797,6 @@ void Close( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t*)p_this;
 
     Flush( p_filter );
+    BandsClean( &p_filter->p_sys->bands );
     free( p_filter->p_sys );
 }
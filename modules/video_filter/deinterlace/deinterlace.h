@@ -42,6 +42,7 @@ struct vlc_object_t;
 #include "algo_yadif.h"
 #include "algo_phosphor.h"
 #include "algo_ivtc.h"
+#include "../bands.h"
 
 /*****************************************************************************
  * Local data
@@ -121,6 +122,8 @@ struct filter_sys_t
     /* Algorithm-specific substructures */
     phosphor_sys_t phosphor; /**< Phosphor algorithm state. */
     ivtc_sys_t ivtc;         /**< IVTC algorithm state. */
+
+    bands_sys_t bands;       /**< Threads of the band-parallel algorithms. */
 };
 
 /*****************************************************************************
@@ -0,0 +1,265 @@
+/*****************************************************************************
+ * yadif_simd.c : AVX2 and NEON Yadif line filters
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#   include "config.h"
+#endif
+
+#include <stdint.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "algo_yadif.h"
+
+/* These are intrinsics versions of the FILTER macro of yadif.h, computing
+ * the same results. Each line is processed in blocks, the last block being
+ * moved back to end at w (the output does not depend on itself), so w must
+ * be at least YADIF_SIMD_MIN_WIDTH. */
+
+#ifdef HAVE_AVX2_INTRINSICS
+#include <immintrin.h>
+
+#define LOAD(p) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+
+VLC_AVX2
+static inline __m256i AbsDiffAVX2(__m256i a, __m256i b)
+{
+    return _mm256_abs_epi16(_mm256_sub_epi16(a, b));
+}
+
+VLC_AVX2
+static inline __m256i AvgAVX2(__m256i a, __m256i b)
+{
+    return _mm256_srai_epi16(_mm256_add_epi16(a, b), 1);
+}
+
+/* Sum of the absolute differences of 3 consecutive pixel pairs */
+VLC_AVX2
+static inline __m256i ScoreAVX2(const __m256i *m, const __m256i *p)
+{
+    return _mm256_add_epi16(_mm256_add_epi16(AbsDiffAVX2(m[0], p[0]),
+                                             AbsDiffAVX2(m[1], p[1])),
+                            AbsDiffAVX2(m[2], p[2]));
+}
+
+VLC_AVX2
+static void FilterBlockAVX2(uint8_t *dst, const uint8_t *prev,
+                            const uint8_t *cur, const uint8_t *next,
+                            const uint8_t *prev2, const uint8_t *next2,
+                            int prefs, int mrefs, int mode)
+{
+    /* Lines above (m) and below (p), from x-3 to x+3 */
+    __m256i m[7], p[7];
+    for (int i = 0; i < 7; i++)
+    {
+        m[i] = LOAD(cur + mrefs + i - 3);
+        p[i] = LOAD(cur + prefs + i - 3);
+    }
+    const __m256i c = m[3], e = p[3];
+
+    const __m256i p2 = LOAD(prev2), n2 = LOAD(next2);
+    const __m256i d = AvgAVX2(p2, n2);
+    const __m256i td0 = AbsDiffAVX2(p2, n2);
+    const __m256i td1 = _mm256_srai_epi16(
+        _mm256_add_epi16(AbsDiffAVX2(LOAD(prev + mrefs), c),
+                         AbsDiffAVX2(LOAD(prev + prefs), e)), 1);
+    const __m256i td2 = _mm256_srai_epi16(
+        _mm256_add_epi16(AbsDiffAVX2(LOAD(next + mrefs), c),
+                         AbsDiffAVX2(LOAD(next + prefs), e)), 1);
+    __m256i diff = _mm256_max_epi16(_mm256_max_epi16(
+                       _mm256_srai_epi16(td0, 1), td1), td2);
+
+    __m256i pred = AvgAVX2(c, e);
+    __m256i score = _mm256_sub_epi16(
+        _mm256_add_epi16(_mm256_add_epi16(AbsDiffAVX2(m[2], p[2]),
+                                          AbsDiffAVX2(c, e)),
+                         AbsDiffAVX2(m[4], p[4])), _mm256_set1_epi16(1));
+
+    /* Edge directions: the second check only applies if the first one
+     * succeeded */
+    for (int dir = -1; dir <= 1; dir += 2)
+    {
+        /* cur[mrefs+j-1..j+1] against cur[prefs-j-1..-j+1], j = dir */
+        __m256i s = ScoreAVX2(&m[2 + dir], &p[2 - dir]);
+        __m256i mask = _mm256_cmpgt_epi16(score, s);
+        score = _mm256_blendv_epi8(score, s, mask);
+        pred = _mm256_blendv_epi8(pred, AvgAVX2(m[3 + dir], p[3 - dir]), mask);
+
+        /* j = 2 * dir */
+        s = ScoreAVX2(&m[2 + 2 * dir], &p[2 - 2 * dir]);
+        mask = _mm256_and_si256(mask, _mm256_cmpgt_epi16(score, s));
+        score = _mm256_blendv_epi8(score, s, mask);
+        pred = _mm256_blendv_epi8(pred,
+                                  AvgAVX2(m[3 + 2 * dir], p[3 - 2 * dir]), mask);
+    }
+
+    const __m256i de = _mm256_sub_epi16(d, e);
+    const __m256i dc = _mm256_sub_epi16(d, c);
+    if (mode < 2)
+    {
+        const __m256i b = AvgAVX2(LOAD(prev2 + 2 * mrefs),
+                                  LOAD(next2 + 2 * mrefs));
+        const __m256i f = AvgAVX2(LOAD(prev2 + 2 * prefs),
+                                  LOAD(next2 + 2 * prefs));
+        const __m256i bc = _mm256_sub_epi16(b, c);
+        const __m256i fe = _mm256_sub_epi16(f, e);
+        const __m256i max = _mm256_max_epi16(_mm256_max_epi16(de, dc),
+                                             _mm256_min_epi16(bc, fe));
+        const __m256i min = _mm256_min_epi16(_mm256_min_epi16(de, dc),
+                                             _mm256_max_epi16(bc, fe));
+
+        diff = _mm256_max_epi16(_mm256_max_epi16(diff, min),
+                                _mm256_sub_epi16(_mm256_setzero_si256(), max));
+    }
+
+    /* diff is never negative */
+    pred = _mm256_max_epi16(pred, _mm256_sub_epi16(d, diff));
+    pred = _mm256_min_epi16(pred, _mm256_add_epi16(d, diff));
+
+    _mm_storeu_si128((__m128i *)dst,
+                     _mm_packus_epi16(_mm256_castsi256_si128(pred),
+                                      _mm256_extracti128_si256(pred, 1)));
+}
+#undef LOAD
+
+VLC_AVX2
+void yadif_filter_line_avx2(uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                            uint8_t *next, int w, int prefs, int mrefs,
+                            int parity, int mode)
+{
+    const uint8_t *prev2 = parity ? prev : cur;
+    const uint8_t *next2 = parity ? cur  : next;
+
+    for (int x = 0;; x += 16)
+    {
+        if (x > w - 16)
+            x = w - 16;
+        FilterBlockAVX2(dst + x, prev + x, cur + x, next + x,
+                        prev2 + x, next2 + x, prefs, mrefs, mode);
+        if (x == w - 16)
+            break;
+    }
+}
+#endif
+
+#ifdef CAN_COMPILE_YADIF_NEON
+#include <arm_neon.h>
+
+#define LOAD(p) vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p)))
+
+static inline int16x8_t AvgNEON(int16x8_t a, int16x8_t b)
+{
+    return vshrq_n_s16(vaddq_s16(a, b), 1);
+}
+
+/* Sum of the absolute differences of 3 consecutive pixel pairs */
+static inline int16x8_t ScoreNEON(const int16x8_t *m, const int16x8_t *p)
+{
+    return vaddq_s16(vaddq_s16(vabdq_s16(m[0], p[0]), vabdq_s16(m[1], p[1])),
+                     vabdq_s16(m[2], p[2]));
+}
+
+static void FilterBlockNEON(uint8_t *dst, const uint8_t *prev,
+                            const uint8_t *cur, const uint8_t *next,
+                            const uint8_t *prev2, const uint8_t *next2,
+                            int prefs, int mrefs, int mode)
+{
+    /* Lines above (m) and below (p), from x-3 to x+3 */
+    int16x8_t m[7], p[7];
+    for (int i = 0; i < 7; i++)
+    {
+        m[i] = LOAD(cur + mrefs + i - 3);
+        p[i] = LOAD(cur + prefs + i - 3);
+    }
+    const int16x8_t c = m[3], e = p[3];
+
+    const int16x8_t p2 = LOAD(prev2), n2 = LOAD(next2);
+    const int16x8_t d = AvgNEON(p2, n2);
+    const int16x8_t td0 = vabdq_s16(p2, n2);
+    const int16x8_t td1 = vshrq_n_s16(vaddq_s16(vabdq_s16(LOAD(prev + mrefs), c),
+                                                vabdq_s16(LOAD(prev + prefs), e)), 1);
+    const int16x8_t td2 = vshrq_n_s16(vaddq_s16(vabdq_s16(LOAD(next + mrefs), c),
+                                                vabdq_s16(LOAD(next + prefs), e)), 1);
+    int16x8_t diff = vmaxq_s16(vmaxq_s16(vshrq_n_s16(td0, 1), td1), td2);
+
+    int16x8_t pred = AvgNEON(c, e);
+    int16x8_t score = vsubq_s16(vaddq_s16(vaddq_s16(vabdq_s16(m[2], p[2]),
+                                                    vabdq_s16(c, e)),
+                                          vabdq_s16(m[4], p[4])),
+                                vdupq_n_s16(1));
+
+    /* Edge directions: the second check only applies if the first one
+     * succeeded */
+    for (int dir = -1; dir <= 1; dir += 2)
+    {
+        int16x8_t s = ScoreNEON(&m[2 + dir], &p[2 - dir]);
+        uint16x8_t mask = vcltq_s16(s, score);
+        score = vbslq_s16(mask, s, score);
+        pred = vbslq_s16(mask, AvgNEON(m[3 + dir], p[3 - dir]), pred);
+
+        s = ScoreNEON(&m[2 + 2 * dir], &p[2 - 2 * dir]);
+        mask = vandq_u16(mask, vcltq_s16(s, score));
+        score = vbslq_s16(mask, s, score);
+        pred = vbslq_s16(mask, AvgNEON(m[3 + 2 * dir], p[3 - 2 * dir]), pred);
+    }
+
+    const int16x8_t de = vsubq_s16(d, e);
+    const int16x8_t dc = vsubq_s16(d, c);
+    if (mode < 2)
+    {
+        const int16x8_t b = AvgNEON(LOAD(prev2 + 2 * mrefs),
+                                    LOAD(next2 + 2 * mrefs));
+        const int16x8_t f = AvgNEON(LOAD(prev2 + 2 * prefs),
+                                    LOAD(next2 + 2 * prefs));
+        const int16x8_t bc = vsubq_s16(b, c);
+        const int16x8_t fe = vsubq_s16(f, e);
+        const int16x8_t max = vmaxq_s16(vmaxq_s16(de, dc), vminq_s16(bc, fe));
+        const int16x8_t min = vminq_s16(vminq_s16(de, dc), vmaxq_s16(bc, fe));
+
+        diff = vmaxq_s16(vmaxq_s16(diff, min), vnegq_s16(max));
+    }
+
+    /* diff is never negative */
+    pred = vmaxq_s16(pred, vsubq_s16(d, diff));
+    pred = vminq_s16(pred, vaddq_s16(d, diff));
+
+    vst1_u8(dst, vqmovun_s16(pred));
+}
+#undef LOAD
+
+void yadif_filter_line_neon(uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                            uint8_t *next, int w, int prefs, int mrefs,
+                            int parity, int mode)
+{
+    const uint8_t *prev2 = parity ? prev : cur;
+    const uint8_t *next2 = parity ? cur  : next;
+
+    for (int x = 0;; x += 8)
+    {
+        if (x > w - 8)
+            x = w - 8;
+        FilterBlockNEON(dst + x, prev + x, cur + x, next + x,
+                        prev2 + x, next2 + x, prefs, mrefs, mode);
+        if (x == w - 8)
+            break;
+    }
+}
+#endif
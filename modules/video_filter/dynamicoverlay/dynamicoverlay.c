@@ -354,7 +354,14 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
     {
         subpicture_region_t *p_region;
 
-        *pp_region = p_region = subpicture_region_New( &p_overlay->format );
+        /* The pictures are shared, the commands do not modify them while
+         * they are referenced */
+        if( p_overlay->format.i_chroma == VLC_CODEC_TEXT )
+            p_region = subpicture_region_New( &p_overlay->format );
+        else
+            p_region = subpicture_region_NewFromPicture( &p_overlay->format,
+                                                         p_overlay->data.p_pic );
+        *pp_region = p_region;
         if( !p_region )
             break;
 
@@ -367,11 +374,6 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
             p_region->psz_text = strdup( p_overlay->data.p_text );
             p_region->p_style = text_style_Duplicate( p_overlay->p_fontstyle );
         }
-        else
-        {
-            /* FIXME the copy is probably not needed anymore */
-            picture_Copy( p_region->p_picture, p_overlay->data.p_pic );
-        }
         p_region->i_x = p_overlay->i_x;
         p_region->i_y = p_overlay->i_y;
         p_region->i_align = SUBPICTURE_ALIGN_LEFT | SUBPICTURE_ALIGN_TOP;
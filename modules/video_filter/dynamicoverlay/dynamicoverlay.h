@@ -139,6 +139,17 @@ typedef struct overlay_t
         picture_t *p_pic;
         char *p_text;
     } data;
+
+    /* Shared memory kept attached by AttachSharedMem, NULL otherwise. The
+     * displayed picture (data.p_pic) may be held by the video output, so
+     * the updates go to a second picture when needed, and both are swapped.
+     * The dirty rectangle is what the second picture lacks. */
+    uint8_t *p_shm;
+    picture_t *p_back;
+    struct
+    {
+        int i_x, i_y, i_width, i_height;
+    } back_dirty;
 } overlay_t;
 
 overlay_t *OverlayCreate( void );
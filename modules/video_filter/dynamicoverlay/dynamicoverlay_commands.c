@@ -62,9 +62,34 @@ overlay_t *OverlayCreate( void )
     return p_ovl;
 }
 
+/* Releases the data of the overlay, which is not displayed any more */
+static void OverlayClean( overlay_t *p_ovl )
+{
+    if( p_ovl->format.i_chroma == VLC_CODEC_TEXT )
+        free( p_ovl->data.p_text );
+    else if( p_ovl->data.p_pic != NULL )
+        picture_Release( p_ovl->data.p_pic );
+    p_ovl->data.p_text = NULL;
+
+    if( p_ovl->p_back != NULL )
+    {
+        picture_Release( p_ovl->p_back );
+        p_ovl->p_back = NULL;
+    }
+#if defined(HAVE_SYS_SHM_H)
+    if( p_ovl->p_shm != NULL )
+    {
+        shmdt( p_ovl->p_shm );
+        p_ovl->p_shm = NULL;
+    }
+#endif
+    video_format_Setup( &p_ovl->format, VLC_FOURCC( '\0','\0','\0','\0') , 0, 0,
+                        0, 0, 1, 1 );
+}
+
 int OverlayDestroy( overlay_t *p_ovl )
 {
-    free( p_ovl->data.p_text );
+    OverlayClean( p_ovl );
     text_style_Delete( p_ovl->p_fontstyle );
 
     return VLC_SUCCESS;
@@ -311,6 +336,44 @@ static int parser_SetVisibility( char *psz_command, char *psz_end,
     return VLC_SUCCESS;
 }
 
+static int parser_UpdateSharedMem( char *psz_command, char *psz_end,
+                                   commandparams_t *p_params )
+{
+    /* Parse: 0 16 16 32 8 */
+    VLC_UNUSED(psz_end);
+    skip_space( &psz_command );
+    if( isdigit( (unsigned char)*psz_command ) )
+    {
+        if( parse_digit( &psz_command, &p_params->i_id ) == VLC_EGENERIC )
+            return VLC_EGENERIC;
+    }
+    skip_space( &psz_command );
+    if( isdigit( (unsigned char)*psz_command ) )
+    {
+        if( parse_digit( &psz_command, &p_params->i_x ) == VLC_EGENERIC )
+            return VLC_EGENERIC;
+    }
+    skip_space( &psz_command );
+    if( isdigit( (unsigned char)*psz_command ) )
+    {
+        if( parse_digit( &psz_command, &p_params->i_y ) == VLC_EGENERIC )
+            return VLC_EGENERIC;
+    }
+    skip_space( &psz_command );
+    if( isdigit( (unsigned char)*psz_command ) )
+    {
+        if( parse_digit( &psz_command, &p_params->i_width ) == VLC_EGENERIC )
+            return VLC_EGENERIC;
+    }
+    skip_space( &psz_command );
+    if( isdigit( (unsigned char)*psz_command ) )
+    {
+        if( parse_digit( &psz_command, &p_params->i_height ) == VLC_EGENERIC )
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
  * Command unparser functions
  *****************************************************************************/
@@ -405,9 +468,136 @@ static int unparse_GetVisibility( const commandparams_t *p_results,
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * Shared memory helpers
+ *****************************************************************************/
+#if defined(HAVE_SYS_SHM_H)
+/* Size of the picture in shared memory: each plane in turn, without padding */
+static size_t SharedMemSize( const picture_t *p_pic )
+{
+    size_t i_size = 0;
+
+    for( int i_plane = 0; i_plane < p_pic->i_planes; ++i_plane )
+        i_size += p_pic->p[i_plane].i_visible_lines *
+                  p_pic->p[i_plane].i_visible_pitch;
+    return i_size;
+}
+
+/* Copies a rectangle, in pixels of the first plane, from shared memory */
+static void SharedMemCopy( picture_t *p_pic, const uint8_t *p_in,
+                           int i_x, int i_y, int i_width, int i_height )
+{
+    const int i_pic_width = p_pic->format.i_width;
+    const int i_pic_height = p_pic->format.i_height;
+
+    for( int i_plane = 0; i_plane < p_pic->i_planes; ++i_plane )
+    {
+        const plane_t *p_plane = &p_pic->p[i_plane];
+        const int i_pixels = p_plane->i_visible_pitch / p_plane->i_pixel_pitch;
+        const int i_lines = p_plane->i_visible_lines;
+
+        /* The rectangle of the plane covers the one requested */
+        const int i_left = i_x * i_pixels / i_pic_width;
+        const int i_right = ( ( i_x + i_width ) * i_pixels + i_pic_width - 1 )
+                            / i_pic_width;
+        const int i_top = i_y * i_lines / i_pic_height;
+        const int i_bottom = ( ( i_y + i_height ) * i_lines + i_pic_height - 1 )
+                             / i_pic_height;
+        const int i_offset = i_left * p_plane->i_pixel_pitch;
+
+        for( int i_line = i_top; i_line < i_bottom; ++i_line )
+            memcpy( &p_plane->p_pixels[i_line * p_plane->i_pitch + i_offset],
+                    &p_in[i_line * p_plane->i_visible_pitch + i_offset],
+                    ( i_right - i_left ) * p_plane->i_pixel_pitch );
+        p_in += i_lines * p_plane->i_visible_pitch;
+    }
+}
+#endif
+
 /*****************************************************************************
  * Command functions
  *****************************************************************************/
+static int exec_AttachSharedMem( filter_t *p_filter,
+                                 const commandparams_t *p_params,
+                                 commandparams_t *p_results )
+{
+#if defined(HAVE_SYS_SHM_H)
+    filter_sys_t *p_sys = (filter_sys_t*) p_filter->p_sys;
+    struct shmid_ds shminfo;
+    overlay_t *p_ovl;
+    uint8_t *p_data;
+    size_t i_neededsize;
+    VLC_UNUSED(p_results);
+
+    p_ovl = ListGet( &p_sys->overlays, p_params->i_id );
+    if( p_ovl == NULL )
+    {
+        msg_Err( p_filter, "Invalid overlay: %d", p_params->i_id );
+        return VLC_EGENERIC;
+    }
+
+    if( p_params->fourcc == VLC_CODEC_TEXT )
+    {
+        msg_Err( p_filter, "Text cannot be attached, use DataSharedMem" );
+        return VLC_EGENERIC;
+    }
+
+    if( shmctl( p_params->i_shmid, IPC_STAT, &shminfo ) == -1 )
+    {
+        msg_Err( p_filter, "Unable to access shared memory" );
+        return VLC_EGENERIC;
+    }
+
+    OverlayClean( p_ovl );
+    p_ovl->data.p_pic = picture_New( p_params->fourcc,
+                                     p_params->i_width, p_params->i_height,
+                                     1, 1 );
+    p_ovl->p_back = picture_New( p_params->fourcc,
+                                 p_params->i_width, p_params->i_height, 1, 1 );
+    if( p_ovl->data.p_pic == NULL || p_ovl->p_back == NULL )
+    {
+        OverlayClean( p_ovl );
+        return VLC_ENOMEM;
+    }
+
+    i_neededsize = SharedMemSize( p_ovl->data.p_pic );
+    if( i_neededsize > shminfo.shm_segsz )
+    {
+        msg_Err( p_filter,
+                 "Insufficient data in shared memory. need %zu, got %zu",
+                 i_neededsize, (size_t)shminfo.shm_segsz );
+        OverlayClean( p_ovl );
+        return VLC_EGENERIC;
+    }
+
+    p_data = shmat( p_params->i_shmid, NULL, SHM_RDONLY );
+    if( p_data == (void *)-1 )
+    {
+        msg_Err( p_filter, "Unable to attach to shared memory" );
+        OverlayClean( p_ovl );
+        return VLC_ENOMEM;
+    }
+
+    /* The second picture is filled at the first update only */
+    SharedMemCopy( p_ovl->data.p_pic, p_data, 0, 0,
+                   p_params->i_width, p_params->i_height );
+    p_ovl->p_shm = p_data;
+    p_ovl->back_dirty.i_x = p_ovl->back_dirty.i_y = 0;
+    p_ovl->back_dirty.i_width = p_params->i_width;
+    p_ovl->back_dirty.i_height = p_params->i_height;
+    p_ovl->format = p_ovl->data.p_pic->format;
+    p_sys->b_updated = p_ovl->b_active;
+
+    return VLC_SUCCESS;
+#else
+    VLC_UNUSED(p_params);
+    VLC_UNUSED(p_results);
+
+    msg_Err( p_filter, "system doesn't support shared memory" );
+    return VLC_EGENERIC;
+#endif
+}
+
 static int exec_DataSharedMem( filter_t *p_filter,
                                const commandparams_t *p_params,
                                commandparams_t *p_results )
@@ -434,6 +624,7 @@ static int exec_DataSharedMem( filter_t *p_filter,
     }
     i_size = shminfo.shm_segsz;
 
+    OverlayClean( p_ovl );
     if( p_params->fourcc == VLC_CODEC_TEXT )
     {
         char *p_data;
@@ -466,7 +657,7 @@ static int exec_DataSharedMem( filter_t *p_filter,
                             0, 0, 0, 0, 0, 1 );
 
         p_data = shmat( p_params->i_shmid, NULL, SHM_RDONLY );
-        if( p_data == NULL )
+        if( p_data == (void *)-1 )
         {
             msg_Err( p_filter, "Unable to attach to shared memory" );
             free( p_ovl->data.p_text );
@@ -479,8 +670,8 @@ static int exec_DataSharedMem( filter_t *p_filter,
     }
     else
     {
-        uint8_t *p_data, *p_in;
-        size_t i_neededsize = 0;
+        uint8_t *p_data;
+        size_t i_neededsize;
 
         p_ovl->data.p_pic = picture_New( p_params->fourcc,
                                          p_params->i_width, p_params->i_height,
@@ -488,15 +679,7 @@ static int exec_DataSharedMem( filter_t *p_filter,
         if( p_ovl->data.p_pic == NULL )
             return VLC_ENOMEM;
 
-        p_ovl->format = p_ovl->data.p_pic->format;
-
-        for( size_t i_plane = 0; i_plane < (size_t)p_ovl->data.p_pic->i_planes;
-             ++i_plane )
-        {
-            i_neededsize += p_ovl->data.p_pic->p[i_plane].i_visible_lines *
-                            p_ovl->data.p_pic->p[i_plane].i_visible_pitch;
-        }
-
+        i_neededsize = SharedMemSize( p_ovl->data.p_pic );
         if( i_neededsize > i_size )
         {
             msg_Err( p_filter,
@@ -508,7 +691,7 @@ static int exec_DataSharedMem( filter_t *p_filter,
         }
 
         p_data = shmat( p_params->i_shmid, NULL, SHM_RDONLY );
-        if( p_data == NULL )
+        if( p_data == (void *)-1 )
         {
             msg_Err( p_filter, "Unable to attach to shared memory" );
             picture_Release( p_ovl->data.p_pic );
@@ -516,22 +699,10 @@ static int exec_DataSharedMem( filter_t *p_filter,
             return VLC_ENOMEM;
         }
 
-        p_in = p_data;
-        for( size_t i_plane = 0; i_plane < (size_t)p_ovl->data.p_pic->i_planes;
-             ++i_plane )
-        {
-            uint8_t *p_out = p_ovl->data.p_pic->p[i_plane].p_pixels;
-            for( size_t i_line = 0;
-                 i_line < (size_t)p_ovl->data.p_pic->p[i_plane].i_visible_lines;
-                 ++i_line )
-            {
-                memcpy( p_out, p_in,
-                            p_ovl->data.p_pic->p[i_plane].i_visible_pitch );
-                p_out += p_ovl->data.p_pic->p[i_plane].i_pitch;
-                p_in += p_ovl->data.p_pic->p[i_plane].i_visible_pitch;
-            }
-        }
+        SharedMemCopy( p_ovl->data.p_pic, p_data, 0, 0,
+                       p_params->i_width, p_params->i_height );
         shmdt( p_data );
+        p_ovl->format = p_ovl->data.p_pic->format;
     }
     p_sys->b_updated = p_ovl->b_active;
 
@@ -777,11 +948,108 @@ static int exec_StartAtomic( filter_t *p_filter,
     return VLC_SUCCESS;
 }
 
+static int exec_UpdateSharedMem( filter_t *p_filter,
+                                 const commandparams_t *p_params,
+                                 commandparams_t *p_results )
+{
+#if defined(HAVE_SYS_SHM_H)
+    filter_sys_t *p_sys = (filter_sys_t*) p_filter->p_sys;
+    VLC_UNUSED(p_results);
+
+    overlay_t *p_ovl = ListGet( &p_sys->overlays, p_params->i_id );
+    if( p_ovl == NULL || p_ovl->p_shm == NULL )
+    {
+        msg_Err( p_filter, "Invalid overlay or no attached shared memory: %d",
+                 p_params->i_id );
+        return VLC_EGENERIC;
+    }
+
+    /* Clip the rectangle to the overlay */
+    const int i_x = VLC_CLIP( p_params->i_x, 0, (int)p_ovl->format.i_width );
+    const int i_y = VLC_CLIP( p_params->i_y, 0, (int)p_ovl->format.i_height );
+    const int i_right = VLC_CLIP( p_params->i_x + p_params->i_width, i_x,
+                                  (int)p_ovl->format.i_width );
+    const int i_bottom = VLC_CLIP( p_params->i_y + p_params->i_height, i_y,
+                                   (int)p_ovl->format.i_height );
+    if( i_right == i_x || i_bottom == i_y )
+        return VLC_SUCCESS;
+
+    /* Both pictures lack the rectangle now */
+    if( p_ovl->back_dirty.i_width > 0 && p_ovl->back_dirty.i_height > 0 )
+    {
+        const int i_dirty_right = __MAX( i_right, p_ovl->back_dirty.i_x +
+                                                  p_ovl->back_dirty.i_width );
+        const int i_dirty_bottom = __MAX( i_bottom, p_ovl->back_dirty.i_y +
+                                                    p_ovl->back_dirty.i_height );
+        p_ovl->back_dirty.i_x = __MIN( i_x, p_ovl->back_dirty.i_x );
+        p_ovl->back_dirty.i_y = __MIN( i_y, p_ovl->back_dirty.i_y );
+        p_ovl->back_dirty.i_width = i_dirty_right - p_ovl->back_dirty.i_x;
+        p_ovl->back_dirty.i_height = i_dirty_bottom - p_ovl->back_dirty.i_y;
+    }
+    else
+    {
+        p_ovl->back_dirty.i_x = i_x;
+        p_ovl->back_dirty.i_y = i_y;
+        p_ovl->back_dirty.i_width = i_right - i_x;
+        p_ovl->back_dirty.i_height = i_bottom - i_y;
+    }
+
+    if( !picture_IsReferenced( p_ovl->data.p_pic ) )
+    {
+        /* Not displayed any more, update it in place */
+        SharedMemCopy( p_ovl->data.p_pic, p_ovl->p_shm,
+                       i_x, i_y, i_right - i_x, i_bottom - i_y );
+    }
+    else
+    {
+        if( picture_IsReferenced( p_ovl->p_back ) )
+        {
+            /* Both still displayed: use a new picture */
+            picture_t *p_pic = picture_NewFromFormat( &p_ovl->format );
+            if( p_pic == NULL )
+                return VLC_ENOMEM;
+            picture_Release( p_ovl->p_back );
+            p_ovl->p_back = p_pic;
+            p_ovl->back_dirty.i_x = p_ovl->back_dirty.i_y = 0;
+            p_ovl->back_dirty.i_width = p_ovl->format.i_width;
+            p_ovl->back_dirty.i_height = p_ovl->format.i_height;
+        }
+
+        SharedMemCopy( p_ovl->p_back, p_ovl->p_shm,
+                       p_ovl->back_dirty.i_x, p_ovl->back_dirty.i_y,
+                       p_ovl->back_dirty.i_width, p_ovl->back_dirty.i_height );
+
+        picture_t *p_front = p_ovl->p_back;
+        p_ovl->p_back = p_ovl->data.p_pic;
+        p_ovl->data.p_pic = p_front;
+        p_ovl->back_dirty.i_x = i_x;
+        p_ovl->back_dirty.i_y = i_y;
+        p_ovl->back_dirty.i_width = i_right - i_x;
+        p_ovl->back_dirty.i_height = i_bottom - i_y;
+    }
+    p_sys->b_updated = p_ovl->b_active;
+
+    return VLC_SUCCESS;
+#else
+    VLC_UNUSED(p_params);
+    VLC_UNUSED(p_results);
+
+    msg_Err( p_filter, "system doesn't support shared memory" );
+    return VLC_EGENERIC;
+#endif
+}
+
 /*****************************************************************************
  * Command functions
  *****************************************************************************/
 static const commanddesc_static_t p_commands[] =
 {
+    {   .psz_command = "AttachSharedMem",
+        .b_atomic = true,
+        .pf_parser = parser_DataSharedMem,
+        .pf_execute = exec_AttachSharedMem,
+        .pf_unparse = unparse_default,
+    },
     {   .psz_command = "DataSharedMem",
         .b_atomic = true,
         .pf_parser = parser_DataSharedMem,
@@ -883,6 +1151,12 @@ static const commanddesc_static_t p_commands[] =
         .pf_parser = parser_None,
         .pf_execute = exec_StartAtomic,
         .pf_unparse = unparse_default,
+    },
+    {   .psz_command = "UpdateSharedMem",
+        .b_atomic = true,
+        .pf_parser = parser_UpdateSharedMem,
+        .pf_execute = exec_UpdateSharedMem,
+        .pf_unparse = unparse_default,
     }
 };
 
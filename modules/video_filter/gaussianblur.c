@@ -31,12 +31,11 @@
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
-#include <vlc_memory.h>
 
 #include <vlc_filter.h>
 #include "filter_picture.h"
-
-#include <math.h>                                          /* exp(), sqrt() */
+#include "convolution.h"
+#include "bands.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -49,6 +48,10 @@ static void Destroy   ( vlc_object_t * );
     "Gaussian's standard deviation. The blurring will take " \
     "into account pixels up to 3*sigma away in any direction.")
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads, each filtering a band of the "\
+                            "picture. 0 uses one thread per CPU.")
+
 #define GAUSSIAN_HELP N_("Add a blurring effect")
 
 #define FILTER_PREFIX "gaussianblur-"
@@ -63,6 +66,8 @@ vlc_module_begin ()
 
     add_float( FILTER_PREFIX "sigma", 2., SIGMA_TEXT, SIGMA_LONGTEXT,
                false )
+    add_integer_with_range( FILTER_PREFIX "threads", 0, 0, BANDS_THREADS_MAX,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
 
     set_callbacks( Create, Destroy )
 vlc_module_end ()
@@ -73,53 +78,46 @@ vlc_module_end ()
 static picture_t *Filter( filter_t *, picture_t * );
 
 static const char *const ppsz_filter_options[] = {
-    "sigma", NULL
+    "sigma", "threads", NULL
 };
 
-/* Comment this to use floats instead of integers (faster for bigger sigma
- * values)
- * For sigma = 2 ints are faster
- * For sigma = 4 floats are faster
- */
-#define DONT_USE_FLOATS
-
-#ifdef DONT_USE_FLOATS
-#   define type_t int
-#else
-#   define type_t float
-#endif
-
 struct filter_sys_t
 {
     double f_sigma;
-    int i_dim;
 
-    type_t *pt_distribution;
-    type_t *pt_buffer;
-    type_t *pt_scale;
+    /* Kernels of the luma (0) and chroma (1) planes, in each direction */
+    conv_kernel_t h[2];
+    conv_kernel_t v[2];
+
+    bands_sys_t bands;
 };
 
-static void gaussianblur_InitDistribution( filter_sys_t *p_sys )
+/* The kernel of the chroma planes spans the same area of the picture */
+static int gaussianblur_InitKernels( filter_sys_t *p_sys,
+                                     const vlc_chroma_description_t *p_chroma )
 {
-    double f_sigma = p_sys->f_sigma;
-    int i_dim = (int)(3.*f_sigma);
-    type_t *pt_distribution = xmalloc( (2*i_dim+1) * sizeof( type_t ) );
-    int x;
+    const double f_hsigma = p_sys->f_sigma * p_chroma->p[1].w.num
+                                           / p_chroma->p[1].w.den;
+    const double f_vsigma = p_sys->f_sigma * p_chroma->p[1].h.num
+                                           / p_chroma->p[1].h.den;
 
-    for( x = -i_dim; x <= i_dim; x++ )
-    {
-        const float f_distribution = sqrt( exp(-(x*x)/(f_sigma*f_sigma) ) / (2.*M_PI*f_sigma*f_sigma) );
-#ifdef DONT_USE_FLOATS
-        const float f_factor = 1 << 8;
-#else
-        const float f_factor = 1;
-#endif
+    if( conv_kernel_InitGaussian( &p_sys->h[0], p_sys->f_sigma ) )
+        return VLC_ENOMEM;
+    if( conv_kernel_InitGaussian( &p_sys->v[0], p_sys->f_sigma ) )
+        goto error_v0;
+    if( conv_kernel_InitGaussian( &p_sys->h[1], f_hsigma ) )
+        goto error_h1;
+    if( conv_kernel_InitGaussian( &p_sys->v[1], f_vsigma ) )
+        goto error_v1;
+    return VLC_SUCCESS;
 
-        pt_distribution[i_dim+x] = (type_t)( f_distribution * f_factor );
-        //printf("%f\n",(float)pt_distribution[i_dim+x]);
-    }
-    p_sys->i_dim = i_dim;
-    p_sys->pt_distribution = pt_distribution;
+error_v1:
+    conv_kernel_Clean( &p_sys->h[1] );
+error_h1:
+    conv_kernel_Clean( &p_sys->v[0] );
+error_v0:
+    conv_kernel_Clean( &p_sys->h[0] );
+    return VLC_ENOMEM;
 }
 
 static int Create( vlc_object_t *p_this )
@@ -146,28 +144,41 @@ static int Create( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
-    p_filter->p_sys = malloc( sizeof( filter_sys_t ) );
-    if( p_filter->p_sys == NULL )
+    const vlc_chroma_description_t *p_chroma =
+        vlc_fourcc_GetChromaDescription( p_filter->fmt_in.video.i_chroma );
+    if( p_chroma == NULL || p_chroma->plane_count != 3 )
+        return VLC_EGENERIC;
+
+    filter_sys_t *p_sys = malloc( sizeof( filter_sys_t ) );
+    if( p_sys == NULL )
         return VLC_ENOMEM;
 
     config_ChainParse( p_filter, FILTER_PREFIX, ppsz_filter_options,
                        p_filter->p_cfg );
 
-    p_filter->pf_video_filter = Filter;
-
-    p_filter->p_sys->f_sigma =
-        var_CreateGetFloat( p_filter, FILTER_PREFIX "sigma" );
-    if( p_filter->p_sys->f_sigma <= 0. )
+    p_sys->f_sigma = var_CreateGetFloat( p_filter, FILTER_PREFIX "sigma" );
+    if( p_sys->f_sigma <= 0. )
     {
         msg_Err( p_filter, "sigma must be positive" );
+        free( p_sys );
         return VLC_EGENERIC;
     }
-    gaussianblur_InitDistribution( p_filter->p_sys );
+    if( gaussianblur_InitKernels( p_sys, p_chroma ) )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
     msg_Dbg( p_filter, "gaussian distribution is %d pixels wide",
-             p_filter->p_sys->i_dim*2+1 );
+             p_sys->h[0].i_radius*2+1 );
 
-    p_filter->p_sys->pt_buffer = NULL;
-    p_filter->p_sys->pt_scale = NULL;
+    unsigned i_threads = var_CreateGetInteger( p_filter,
+                                               FILTER_PREFIX "threads" );
+    if( i_threads == 0 )
+        i_threads = vlc_GetCPUCount();
+    BandsInit( &p_sys->bands, VLC_CLIP( i_threads, 1, BANDS_THREADS_MAX ) );
+
+    p_filter->p_sys = p_sys;
+    p_filter->pf_video_filter = Filter;
 
     return VLC_SUCCESS;
 }
@@ -176,22 +187,54 @@ static void Destroy( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
 
-    free( p_filter->p_sys->pt_distribution );
-    free( p_filter->p_sys->pt_buffer );
-    free( p_filter->p_sys->pt_scale );
+    filter_sys_t *p_sys = p_filter->p_sys;
 
-    free( p_filter->p_sys );
+    BandsClean( &p_sys->bands );
+    for( int i = 0; i < 2; i++ )
+    {
+        conv_kernel_Clean( &p_sys->h[i] );
+        conv_kernel_Clean( &p_sys->v[i] );
+    }
+    free( p_sys );
+}
+
+typedef struct
+{
+    filter_sys_t *p_sys;
+    picture_t    *p_in;
+    picture_t    *p_out;
+} blur_job_t;
+
+static void FilterBand( void *p_opaque, unsigned i_band, unsigned i_bands )
+{
+    blur_job_t *p_job = p_opaque;
+    filter_sys_t *p_sys = p_job->p_sys;
+
+    for( int i_plane = 0 ; i_plane < p_job->p_in->i_planes ; i_plane++ )
+    {
+        const int i = i_plane == Y_PLANE ? 0 : 1;
+        plane_t *p_dst = &p_job->p_out->p[i_plane];
+        const plane_t *p_src = &p_job->p_in->p[i_plane];
+        const int i_lines = p_src->i_visible_lines;
+        const int i_first = i_lines * i_band / i_bands;
+        const int i_end = i_lines * ( i_band + 1 ) / i_bands;
+
+        if( conv_Plane( p_dst, p_src, &p_sys->h[i], &p_sys->v[i],
+                        i_first, i_end ) )
+        {
+            const int i_width = __MIN( p_src->i_visible_pitch,
+                                       p_dst->i_visible_pitch );
+            for( int y = i_first; y < i_end; y++ )
+                memcpy( &p_dst->p_pixels[y * p_dst->i_pitch],
+                        &p_src->p_pixels[y * p_src->i_pitch], i_width );
+        }
+    }
 }
 
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
     picture_t *p_outpic;
     filter_sys_t *p_sys = p_filter->p_sys;
-    int i_plane;
-    const int i_dim = p_sys->i_dim;
-    type_t *pt_buffer;
-    type_t *pt_scale;
-    const type_t *pt_distribution = p_sys->pt_distribution;
 
     if( !p_pic ) return NULL;
 
@@ -201,100 +244,15 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         picture_Release( p_pic );
         return NULL;
     }
-    if( !p_sys->pt_buffer )
-    {
-        p_sys->pt_buffer = realloc_or_free( p_sys->pt_buffer,
-                               p_pic->p[Y_PLANE].i_visible_lines *
-                               p_pic->p[Y_PLANE].i_pitch * sizeof( type_t ) );
-    }
-
-    pt_buffer = p_sys->pt_buffer;
-    if( !p_sys->pt_scale )
-    {
-        const int i_visible_lines = p_pic->p[Y_PLANE].i_visible_lines;
-        const int i_visible_pitch = p_pic->p[Y_PLANE].i_visible_pitch;
-        const int i_pitch = p_pic->p[Y_PLANE].i_pitch;
-        int i_col, i_line;
 
-        p_sys->pt_scale = xmalloc( i_visible_lines * i_pitch * sizeof( type_t ) );
-        pt_scale = p_sys->pt_scale;
-
-        for( i_line = 0 ; i_line < i_visible_lines ; i_line++ )
-        {
-            for( i_col = 0; i_col < i_visible_pitch ; i_col++ )
-            {
-                int x, y;
-                type_t t_value = 0;
-
-                for( y = __MAX( -i_dim, -i_line );
-                     y <= __MIN( i_dim, i_visible_lines - i_line - 1 );
-                     y++ )
-                {
-                    for( x = __MAX( -i_dim, -i_col );
-                         x <= __MIN( i_dim, i_visible_pitch - i_col + 1 );
-                         x++ )
-                    {
-                        t_value += pt_distribution[y+i_dim] *
-                                   pt_distribution[x+i_dim];
-                    }
-                }
-                pt_scale[i_line*i_pitch+i_col] = t_value;
-            }
-        }
-    }
-
-    pt_scale = p_sys->pt_scale;
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
-    {
-
-        uint8_t *p_in = p_pic->p[i_plane].p_pixels;
-        uint8_t *p_out = p_outpic->p[i_plane].p_pixels;
-
-        const int i_visible_lines = p_pic->p[i_plane].i_visible_lines;
-        const int i_visible_pitch = p_pic->p[i_plane].i_visible_pitch;
-        const int i_in_pitch = p_pic->p[i_plane].i_pitch;
-
-        int i_line, i_col;
-        const int x_factor = p_pic->p[Y_PLANE].i_visible_pitch/i_visible_pitch-1;
-        const int y_factor = p_pic->p[Y_PLANE].i_visible_lines/i_visible_lines-1;
-
-        for( i_line = 0 ; i_line < i_visible_lines ; i_line++ )
-        {
-            for( i_col = 0; i_col < i_visible_pitch ; i_col++ )
-            {
-                type_t t_value = 0;
-                int x;
-                const int c = i_line*i_in_pitch+i_col;
-                for( x = __MAX( -i_dim, -i_col*(x_factor+1) );
-                     x <= __MIN( i_dim, (i_visible_pitch - i_col)*(x_factor+1) + 1 );
-                     x++ )
-                {
-                    t_value += pt_distribution[x+i_dim] *
-                               p_in[c+(x>>x_factor)];
-                }
-                pt_buffer[c] = t_value;
-            }
-        }
-        for( i_line = 0 ; i_line < i_visible_lines ; i_line++ )
-        {
-            for( i_col = 0; i_col < i_visible_pitch ; i_col++ )
-            {
-                type_t t_value = 0;
-                int y;
-                const int c = i_line*i_in_pitch+i_col;
-                for( y = __MAX( -i_dim, (-i_line)*(y_factor+1) );
-                     y <= __MIN( i_dim, (i_visible_lines - i_line)*(y_factor+1) - 1 );
-                     y++ )
-                {
-                    t_value += pt_distribution[y+i_dim] *
-                               pt_buffer[c+(y>>y_factor)*i_in_pitch];
-                }
-
-                const type_t t_scale = pt_scale[(i_line<<y_factor)*(i_in_pitch<<x_factor)+(i_col<<x_factor)];
-                p_out[i_line * p_outpic->p[i_plane].i_pitch + i_col] = (uint8_t)(t_value / t_scale); // FIXME wouldn't it be better to round instead of trunc ?
-            }
-        }
-    }
+    /* Each band filters the lines around its own again: a band should be
+     * much higher than the kernel */
+    blur_job_t job = { p_sys, p_pic, p_outpic };
+    const int i_lines = p_pic->p[Y_PLANE].i_visible_lines;
+    unsigned i_bands = BandsCount( &p_sys->bands );
+    i_bands = __MIN( i_bands, (unsigned)i_lines
+                              / ( 8 * ( p_sys->v[0].i_radius + 1 ) ) );
+    BandsRender( &p_sys->bands, FilterBand, &job, __MAX( i_bands, 1 ) );
 
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
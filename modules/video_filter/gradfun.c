@@ -36,6 +36,8 @@
 #include <vlc_cpu.h>
 #include <vlc_filter.h>
 
+#include "bands.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -54,6 +56,10 @@ static void Close(vlc_object_t *);
 #define STRENGTH_TEXT N_("Strength")
 #define STRENGTH_LONGTEXT N_("Strength used to modify the value of a pixel")
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads, each filtering a band of the "\
+                            "picture. 0 uses one thread per CPU.")
+
 vlc_module_begin()
     set_description(N_("Gradfun video filter"))
     set_shortname(N_("Gradfun"))
@@ -65,6 +71,8 @@ vlc_module_begin()
                            RADIUS_TEXT, RADIUS_LONGTEXT, false)
     add_float_with_range(CFG_PREFIX "strength", 1.2, STRENGTH_MIN, STRENGTH_MAX,
                          STRENGTH_TEXT, STRENGTH_LONGTEXT, false)
+    add_integer_with_range(CFG_PREFIX "threads", 0, 0, BANDS_THREADS_MAX,
+                           THREADS_TEXT, THREADS_LONGTEXT, true)
 
     set_callbacks(Open, Close)
 vlc_module_end()
@@ -88,6 +96,15 @@ vlc_module_end()
 #else
 #   define HAVE_SSSE3 0
 #endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   define HAVE_NEON 1
+#   include <arm_neon.h>
+#else
+#   define HAVE_NEON 0
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+#   include <emmintrin.h>
+#endif
 // FIXME too restrictive
 #ifdef __x86_64__
 #   define HAVE_6REGS 1
@@ -106,6 +123,7 @@ struct filter_sys_t {
     int              radius;
     const vlc_chroma_description_t *chroma;
     struct vf_priv_s cfg;
+    bands_sys_t      bands;
 };
 
 static int Open(vlc_object_t *object)
@@ -135,11 +153,17 @@ static int Open(vlc_object_t *object)
     cfg->thresh      = 0.0;
     cfg->radius      = 0;
     cfg->buf         = NULL;
+    cfg->buf_size    = 0;
 
-#if HAVE_SSE2 && HAVE_6REGS
+#if (HAVE_SSE2 && HAVE_6REGS) || defined(HAVE_BLUR_LINE_SSE2)
     if (vlc_CPU_SSE2())
         cfg->blur_line = blur_line_sse2;
     else
+#endif
+#if HAVE_NEON
+    if (vlc_CPU_ARM_NEON())
+        cfg->blur_line = blur_line_neon;
+    else
 #endif
         cfg->blur_line   = blur_line_c;
 #if HAVE_SSSE3
@@ -147,13 +171,28 @@ static int Open(vlc_object_t *object)
         cfg->filter_line = filter_line_ssse3;
     else
 #endif
+#if defined(HAVE_SSE2_INTRINSICS)
+    if (vlc_CPU_SSE2())
+        cfg->filter_line = filter_line_sse2;
+    else
+#endif
 #if HAVE_MMX2
     if (vlc_CPU_MMXEXT())
         cfg->filter_line = filter_line_mmx2;
     else
+#endif
+#if HAVE_NEON
+    if (vlc_CPU_ARM_NEON())
+        cfg->filter_line = filter_line_neon;
+    else
 #endif
         cfg->filter_line = filter_line_c;
 
+    unsigned threads = var_InheritInteger(filter, CFG_PREFIX "threads");
+    if (threads == 0)
+        threads = vlc_GetCPUCount();
+    BandsInit(&sys->bands, VLC_CLIP(threads, 1, BANDS_THREADS_MAX));
+
     filter->p_sys           = sys;
     filter->pf_video_filter = Filter;
     return VLC_SUCCESS;
@@ -166,11 +205,42 @@ static void Close(vlc_object_t *object)
 
     var_DelCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
     var_DelCallback(filter, CFG_PREFIX "strength", Callback, NULL);
+    BandsClean(&sys->bands);
     vlc_free(sys->cfg.buf);
     vlc_mutex_destroy(&sys->lock);
     free(sys);
 }
 
+typedef struct {
+    struct vf_priv_s *cfg;
+    picture_t        *src;
+    picture_t        *dst;
+    int               w[PICTURE_PLANE_MAX];
+    int               h[PICTURE_PLANE_MAX];
+    int               r[PICTURE_PLANE_MAX]; // 0 if the plane is only copied
+} filter_job_t;
+
+static void FilterBand(void *opaque, unsigned band, unsigned bands)
+{
+    const filter_job_t *job = opaque;
+    uint16_t *buf = job->cfg->buf + band * job->cfg->buf_size;
+
+    for (int i = 0; i < job->dst->i_planes; i++) {
+        if (job->r[i] == 0)
+            continue;
+
+        const plane_t *srcp = &job->src->p[i];
+        plane_t       *dstp = &job->dst->p[i];
+        int y_start = (job->h[i] * band / bands) & ~1;
+        int y_end   = band + 1 < bands ? (job->h[i] * (band + 1) / bands) & ~1
+                                       : job->h[i];
+
+        filter_plane(job->cfg, buf, dstp->p_pixels, srcp->p_pixels,
+                     job->w[i], job->h[i], dstp->i_pitch, srcp->i_pitch,
+                     job->r[i], y_start, y_end);
+    }
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     filter_sys_t *sys = filter->p_sys;
@@ -188,14 +258,21 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
 
     const video_format_t *fmt = &filter->fmt_in.video;
     struct vf_priv_s *cfg = &sys->cfg;
+    const unsigned max_bands = BandsCount(&sys->bands);
 
     cfg->thresh = (1 << 15) / strength;
     if (cfg->radius != radius) {
-        cfg->radius = radius;
-        cfg->buf    = vlc_memalign(16,
-                                   (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) * sizeof(*cfg->buf));
+        cfg->radius   = radius;
+        cfg->buf_size = ((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32;
+        vlc_free(cfg->buf);
+        cfg->buf      = vlc_memalign(16,
+                                     max_bands * cfg->buf_size * sizeof(*cfg->buf));
     }
 
+    /* Every band of a plane needs more than 2 * r lines, see filter_plane() */
+    filter_job_t job = { .cfg = cfg, .src = src, .dst = dst };
+    unsigned bands = max_bands;
+
     for (int i = 0; i < dst->i_planes; i++) {
         const plane_t *srcp = &src->p[i];
         plane_t       *dstp = &dst->p[i];
@@ -206,14 +283,19 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
         int r = (cfg->radius  * chroma->p[i].w.num / chroma->p[i].w.den +
                  cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
         r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
+        job.w[i] = w;
+        job.h[i] = h;
         if (__MIN(w, h) > 2 * r && cfg->buf) {
-            filter_plane(cfg, dstp->p_pixels, srcp->p_pixels,
-                         w, h, dstp->i_pitch, srcp->i_pitch, r);
+            job.r[i] = r;
+            bands = __MIN(bands, (unsigned)h / (2 * r + 2));
         } else {
+            job.r[i] = 0;
             plane_CopyPixels(dstp, srcp);
         }
     }
 
+    BandsRender(&sys->bands, FilterBand, &job, __MAX(bands, 1));
+
     picture_CopyProperties(dst, src);
     picture_Release(src);
     return dst;
@@ -32,6 +32,7 @@ struct vf_priv_s {
     int thresh;
     int radius;
     uint16_t *buf;
+    size_t buf_size; // per band, in elements
     void (*filter_line)(uint8_t *dst, uint8_t *src, uint16_t *dc,
                         int width, int thresh, const uint16_t *dithers);
     void (*blur_line)(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
@@ -223,15 +224,143 @@ static void blur_line_sse2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
 }
 #endif // HAVE_6REGS && HAVE_SSE2
 
-static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
-                         int width, int height, int dstride, int sstride, int r)
+#if defined(HAVE_SSE2_INTRINSICS)
+// Same as filter_line_c, including the rounding
+VLC_SSE
+static void filter_line_sse2(uint8_t *dst, uint8_t *src, uint16_t *dc,
+                             int width, int thresh, const uint16_t *dithers)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i th   = _mm_set1_epi16(thresh);
+    const __m128i c127 = _mm_load_si128((const __m128i *)pw_7f);
+    const __m128i dith = _mm_load_si128((const __m128i *)dithers);
+    int x;
+
+    for (x=0; x+8<=width; x+=8) {
+        __m128i pix = _mm_slli_epi16(_mm_unpacklo_epi8(
+                          _mm_loadl_epi64((const __m128i *)(src+x)), zero), 7);
+        // pixel x uses dc[(x+1)/2]
+        __m128i d = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(dc+x/2)),
+                                       _mm_loadl_epi64((const __m128i *)(dc+x/2+1)));
+        __m128i delta = _mm_sub_epi16(d, pix);
+        __m128i m = _mm_max_epi16(delta, _mm_sub_epi16(zero, delta));
+        m = _mm_mulhi_epu16(m, th);                      // abs(delta) * thresh >> 16
+        m = _mm_max_epi16(_mm_sub_epi16(c127, m), zero); // max(0, 127-m)
+        m = _mm_mullo_epi16(m, m);
+        __m128i lo = _mm_mullo_epi16(m, delta);
+        __m128i hi = _mm_mulhi_epi16(m, delta);
+        m = _mm_packs_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 14),
+                            _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 14));
+        pix = _mm_add_epi16(pix, _mm_add_epi16(m, dith));
+        pix = _mm_srai_epi16(pix, 7);
+        _mm_storel_epi64((__m128i *)(dst+x), _mm_packus_epi16(pix, pix));
+    }
+    if (x < width)
+        filter_line_c(dst+x, src+x, dc+x/2, width-x, thresh, dithers);
+}
+
+#if !(HAVE_SSE2 && HAVE_6REGS)
+#define HAVE_BLUR_LINE_SSE2 1
+VLC_SSE
+static void blur_line_sse2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
+                           uint8_t *src, int sstride, int width)
+{
+    const __m128i ff = _mm_load_si128((const __m128i *)pw_ff);
+    int x;
+
+    for (x=0; x+8<=width; x+=8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src+2*x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src+2*x+sstride));
+        __m128i v = _mm_add_epi16(_mm_add_epi16(_mm_srli_epi16(a, 8), _mm_and_si128(a, ff)),
+                                  _mm_add_epi16(_mm_srli_epi16(b, 8), _mm_and_si128(b, ff)));
+        v = _mm_add_epi16(v, _mm_loadu_si128((const __m128i *)(buf1+x)));
+        __m128i old = _mm_loadu_si128((const __m128i *)(buf+x));
+        _mm_storeu_si128((__m128i *)(buf+x), v);
+        _mm_storeu_si128((__m128i *)(dc+x), _mm_sub_epi16(v, old));
+    }
+    if (x < width)
+        blur_line_c(dc+x, buf+x, buf1+x, src+2*x, sstride, width-x);
+}
+#endif
+#endif // HAVE_SSE2_INTRINSICS
+
+#if HAVE_NEON
+// Same as filter_line_c, including the rounding
+static void filter_line_neon(uint8_t *dst, uint8_t *src, uint16_t *dc,
+                             int width, int thresh, const uint16_t *dithers)
+{
+    const uint16x4_t th   = vdup_n_u16(thresh);
+    const int16x8_t  c127 = vdupq_n_s16(127);
+    const int16x8_t  dith = vreinterpretq_s16_u16(vld1q_u16(dithers));
+    int x;
+
+    for (x=0; x+8<=width; x+=8) {
+        int16x8_t pix = vreinterpretq_s16_u16(vshll_n_u8(vld1_u8(src+x), 7));
+        // pixel x uses dc[(x+1)/2]
+        uint16x4x2_t d = vzip_u16(vld1_u16(dc+x/2), vld1_u16(dc+x/2+1));
+        int16x8_t delta = vsubq_s16(vreinterpretq_s16_u16(vcombine_u16(d.val[0], d.val[1])), pix);
+        uint16x8_t ad = vreinterpretq_u16_s16(vabsq_s16(delta));
+        // abs(delta) * thresh >> 16
+        int16x8_t m = vreinterpretq_s16_u16(vcombine_u16(
+                          vshrn_n_u32(vmull_u16(vget_low_u16(ad),  th), 16),
+                          vshrn_n_u32(vmull_u16(vget_high_u16(ad), th), 16)));
+        m = vmaxq_s16(vsubq_s16(c127, m), vdupq_n_s16(0));
+        m = vmulq_s16(m, m);
+        m = vcombine_s16(vmovn_s32(vshrq_n_s32(vmull_s16(vget_low_s16(m),  vget_low_s16(delta)),  14)),
+                         vmovn_s32(vshrq_n_s32(vmull_s16(vget_high_s16(m), vget_high_s16(delta)), 14)));
+        pix = vaddq_s16(pix, vaddq_s16(m, dith));
+        vst1_u8(dst+x, vqshrun_n_s16(pix, 7));
+    }
+    if (x < width)
+        filter_line_c(dst+x, src+x, dc+x/2, width-x, thresh, dithers);
+}
+
+static void blur_line_neon(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
+                           uint8_t *src, int sstride, int width)
+{
+    int x;
+
+    for (x=0; x+8<=width; x+=8) {
+        uint16x8_t v = vaddq_u16(vpaddlq_u8(vld1q_u8(src+2*x)),
+                                 vpaddlq_u8(vld1q_u8(src+2*x+sstride)));
+        v = vaddq_u16(v, vld1q_u16(buf1+x));
+        uint16x8_t old = vld1q_u16(buf+x);
+        vst1q_u16(buf+x, v);
+        vst1q_u16(dc+x, vsubq_u16(v, old));
+    }
+    if (x < width)
+        blur_line_c(dc+x, buf+x, buf1+x, src+2*x, sstride, width-x);
+}
+#endif // HAVE_NEON
+
+/* Filters the lines [y_start, y_end) of a plane, using its own buffer buf
+ * (of ctx->buf_size elements). The blur state of a band is built from the
+ * source lines above it, so that bands give the same output as a whole
+ * plane: y_start must be even and at least r, and y_start + r must be less
+ * than height, unless y_start is 0. */
+static void filter_plane(struct vf_priv_s *ctx, uint16_t *ctxbuf,
+                         uint8_t *dst, uint8_t *src,
+                         int width, int height, int dstride, int sstride, int r,
+                         int y_start, int y_end)
 {
     int bstride = ((width+15)&~15)/2;
     int y;
     uint32_t dc_factor = (1<<21)/(r*r);
-    uint16_t *dc = ctx->buf+16;
-    uint16_t *buf = ctx->buf+bstride+32;
+    uint16_t *dc = ctxbuf+16;
+    uint16_t *buf = ctxbuf+bstride+32;
     int thresh = ctx->thresh;
+    int first = 0; // first line to output
+    int offset = 0;
+
+    if (y_start > 0) {
+        // Run as if the plane started r lines above the band
+        offset = y_start - r;
+        src += offset*sstride;
+        dst += offset*dstride;
+        height -= offset;
+        y_end -= offset;
+        first = r;
+    }
 
     memset(dc, 0, (bstride+16)*sizeof(*buf));
     for (y=0; y<r; y++)
@@ -254,14 +383,14 @@ static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
             for (x=-r/2; x<0; x++)
                 dc[x] = dc[0];
         }
-        if (y == r) {
+        if (y == r && first == 0) {
             for (y=0; y<r; y++)
                 ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
         }
-        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
-        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
+        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[(y+offset)&7]);
+        if (++y >= y_end) break;
+        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[(y+offset)&7]);
+        if (++y >= y_end) break;
     }
 }
 
@@ -33,7 +33,7 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include "filter_picture.h"
-
+#include "bands.h"
 
 #include "hqdn3d.h"
 
@@ -57,6 +57,9 @@ static int DenoiseCallback( vlc_object_t *p_this, char const *psz_var,
 #define CHROMA_SPAT_TEXT        N_("Spatial chroma strength (0-254)")
 #define LUMA_TEMP_TEXT          N_("Temporal luma strength (0-254)")
 #define CHROMA_TEMP_TEXT        N_("Temporal chroma strength (0-254)")
+#define THREADS_TEXT            N_("Threads")
+#define THREADS_LONGTEXT        N_("Number of threads, each filtering a band "\
+                                   "of the picture. 0 uses one thread per CPU.")
 
 vlc_module_begin()
     set_shortname(N_("HQ Denoiser 3D"))
@@ -73,6 +76,8 @@ vlc_module_begin()
             LUMA_TEMP_TEXT, LUMA_TEMP_TEXT, false)
     add_float_with_range(FILTER_PREFIX "chroma-temp", 4.5, 0.0, 254.0,
             CHROMA_TEMP_TEXT, CHROMA_TEMP_TEXT, false)
+    add_integer_with_range(FILTER_PREFIX "threads", 0, 0, BANDS_THREADS_MAX,
+            THREADS_TEXT, THREADS_LONGTEXT, true)
 
     add_shortcut("hqdn3d")
 
@@ -80,9 +85,14 @@ vlc_module_begin()
 vlc_module_end()
 
 static const char *const filter_options[] = {
-    "luma-spat", "chroma-spat", "luma-temp", "chroma-temp", NULL
+    "luma-spat", "chroma-spat", "luma-temp", "chroma-temp", "threads", NULL
 };
 
+/* Minimum height of a band, and number of lines above a band used to
+ * rebuild the vertical low pass state (see deNoisePrime()) */
+#define BAND_MIN_LINES   (64)
+#define BAND_PRIME_LINES (16)
+
 /*****************************************************************************
  * filter_sys_t
  *****************************************************************************/
@@ -90,6 +100,9 @@ struct filter_sys_t
 {
     const vlc_chroma_description_t *chroma;
     int w[3], h[3];
+    int wmax;
+
+    bands_sys_t bands; /* cfg.Line holds one line per band */
 
     struct vf_priv_s cfg;
     bool   b_recalc_coefs;
@@ -137,15 +150,22 @@ static int Open(vlc_object_t *this)
         if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
     }
-    cfg->Line = malloc(wmax*sizeof(unsigned int));
-    if (!cfg->Line) {
-        free(sys);
-        return VLC_ENOMEM;
-    }
+    sys->wmax = wmax;
 
     config_ChainParse(filter, FILTER_PREFIX, filter_options,
                       filter->p_cfg);
 
+    unsigned threads = var_InheritInteger(filter, FILTER_PREFIX "threads");
+    if (threads == 0)
+        threads = vlc_GetCPUCount();
+    BandsInit(&sys->bands, VLC_CLIP(threads, 1, BANDS_THREADS_MAX));
+
+    cfg->Line = malloc(wmax*BandsCount(&sys->bands)*sizeof(unsigned int));
+    if (!cfg->Line) {
+        BandsClean(&sys->bands);
+        free(sys);
+        return VLC_ENOMEM;
+    }
 
     vlc_mutex_init( &sys->coefs_mutex );
     sys->b_recalc_coefs = true;
@@ -180,6 +200,7 @@ static void Close(vlc_object_t *this)
     var_DelCallback( filter, FILTER_PREFIX "chroma-temp", DenoiseCallback, sys );
 
     vlc_mutex_destroy( &sys->coefs_mutex );
+    BandsClean( &sys->bands );
 
     for (int i = 0; i < 3; ++i) {
         free(cfg->Frame[i]);
@@ -191,6 +212,38 @@ static void Close(vlc_object_t *this)
 /*****************************************************************************
  * Filter
  *****************************************************************************/
+typedef struct
+{
+    filter_sys_t *sys;
+    picture_t    *src;
+    picture_t    *dst;
+} filter_job_t;
+
+static void FilterBand(void *opaque, unsigned band, unsigned bands)
+{
+    const filter_job_t *job = opaque;
+    filter_sys_t *sys = job->sys;
+    struct vf_priv_s *cfg = &sys->cfg;
+
+    for (int i = 0; i < 3; ++i) {
+        const plane_t *srcp = &job->src->p[i];
+        const plane_t *dstp = &job->dst->p[i];
+        const int y_start = sys->h[i] * band / bands;
+        const int y_end   = sys->h[i] * (band + 1) / bands;
+        int *spat = cfg->Coefs[i == 0 ? 0 : 2];
+        int *temp = cfg->Coefs[i == 0 ? 1 : 3];
+
+        deNoise(&srcp->p_pixels[y_start * srcp->i_pitch],
+                &dstp->p_pixels[y_start * dstp->i_pitch],
+                &cfg->Line[band * sys->wmax],
+                &cfg->Frame[i][y_start * sys->w[i]],
+                sys->w[i], y_end - y_start,
+                srcp->i_pitch, dstp->i_pitch,
+                spat, spat, temp,
+                __MIN(y_start, BAND_PRIME_LINES));
+    }
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     picture_t *dst;
@@ -220,24 +273,27 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
+    for (int i = 0; i < 3; ++i) {
+        if (unlikely(!cfg->Frame[i])) {
+            cfg->Frame[i] = deNoiseNewFrameAnt(src->p[i].p_pixels,
+                                               sys->w[i], sys->h[i],
+                                               src->p[i].i_pitch);
+            if (!cfg->Frame[i]) {
+                picture_Release(dst);
+                picture_Release(src);
+                return NULL;
+            }
+        }
+    }
+
+    /* Each band reads the lines above it, and updates its own lines of the
+     * previous frame state */
+    unsigned bands = BandsCount(&sys->bands);
+    if (sys->h[0] < (int)(BAND_MIN_LINES * bands))
+        bands = __MAX(sys->h[0] / BAND_MIN_LINES, 1);
+
+    filter_job_t job = { .sys = sys, .src = src, .dst = dst };
+    BandsRender(&sys->bands, FilterBand, &job, bands);
 
     return CopyInfoAndRelease(dst, src);
 }
@@ -68,29 +68,64 @@ static void deNoiseTemporal(
     }
 }
 
+/* Runs the spatial low pass over the H lines starting at Frame, without
+ * output, so that LineAnt holds the vertical state of their last line.
+ * This lets a band of the frame be filtered on its own with no visible seam
+ * at its top. */
+static void deNoisePrime(
+                    unsigned char *Frame,
+                    unsigned int *LineAnt,
+                    int W, int H, int sStride,
+                    int *Horizontal, int *Vertical)
+{
+    long X, Y;
+    unsigned int PixelAnt;
+
+    LineAnt[0] = PixelAnt = Frame[0]<<16;
+    for (X = 1; X < W; X++)
+        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+
+    for (Y = 1; Y < H; Y++){
+        Frame += sStride;
+        PixelAnt = Frame[0]<<16;
+        LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
+        for (X = 1; X < W; X++){
+            PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+            LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
+        }
+    }
+}
+
 static void deNoiseSpacial(
                     unsigned char *Frame,        // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
                     unsigned int *LineAnt,       // vf->priv->Line (width bytes)
                     int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical)
+                    int *Horizontal, int *Vertical, int Primed)
 {
     long X, Y;
     long sLineOffs = 0, dLineOffs = 0;
     unsigned int PixelAnt;
     unsigned int PixelDst;
 
-    /* First pixel has no left nor top neighbor. */
-    PixelDst = LineAnt[0] = PixelAnt = Frame[0]<<16;
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+    if (Primed){
+        /* LineAnt already holds the line above, see deNoisePrime() */
+        sLineOffs = -sStride, dLineOffs = -dStride;
+        Y = 0;
+    } else {
+        /* First pixel has no left nor top neighbor. */
+        PixelDst = LineAnt[0] = PixelAnt = Frame[0]<<16;
+        FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
 
-    /* First line has no top neighbor, only left. */
-    for (X = 1; X < W; X++){
-        PixelDst = LineAnt[X] = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+        /* First line has no top neighbor, only left. */
+        for (X = 1; X < W; X++){
+            PixelDst = LineAnt[X] = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+            FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+        }
+        Y = 1;
     }
 
-    for (Y = 1; Y < H; Y++){
+    for (; Y < H; Y++){
         unsigned int PixelAnt;
         sLineOffs += sStride, dLineOffs += dStride;
         /* First pixel on each line doesn't have previous pixel */
@@ -108,55 +143,75 @@ static void deNoiseSpacial(
     }
 }
 
-static void deNoise(unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,      // vf->priv->Line (width bytes)
-                    unsigned short **FrameAntPtr,
-                    int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical, int *Temporal)
+/* Allocates the previous frame state of a plane, initialized from Frame */
+static unsigned short *deNoiseNewFrameAnt(unsigned char *Frame,
+                                          int W, int H, int sStride)
 {
     long X, Y;
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
-    unsigned short* FrameAnt=(*FrameAntPtr);
+    unsigned short* FrameAnt=malloc(W*H*sizeof(unsigned short));
 
-    if(!FrameAnt){
-        (*FrameAntPtr)=FrameAnt=malloc(W*H*sizeof(unsigned short));
+    if(FrameAnt){
         for (Y = 0; Y < H; Y++){
             unsigned short* dst=&FrameAnt[Y*W];
             unsigned char* src=Frame+Y*sStride;
             for (X = 0; X < W; X++) dst[X]=src[X]<<8;
         }
     }
+    return FrameAnt;
+}
+
+/* Filters H lines. If Prime is not zero, Frame is not the top of the
+ * picture and the spatial state is rebuilt from the Prime lines above. */
+static void deNoise(unsigned char *Frame,        // mpi->planes[x]
+                    unsigned char *FrameDest,    // dmpi->planes[x]
+                    unsigned int *LineAnt,      // vf->priv->Line (width bytes)
+                    unsigned short *FrameAnt,
+                    int W, int H, int sStride, int dStride,
+                    int *Horizontal, int *Vertical, int *Temporal,
+                    int Prime)
+{
+    long X, Y;
+    long sLineOffs = 0, dLineOffs = 0;
+    unsigned int PixelAnt;
+    unsigned int PixelDst;
 
     if(!Horizontal[0] && !Vertical[0]){
         deNoiseTemporal(Frame, FrameDest, FrameAnt,
                         W, H, sStride, dStride, Temporal);
         return;
     }
+    if(Prime)
+        deNoisePrime(Frame - Prime*sStride, LineAnt,
+                     W, Prime, sStride, Horizontal, Vertical);
     if(!Temporal[0]){
         deNoiseSpacial(Frame, FrameDest, LineAnt,
-                       W, H, sStride, dStride, Horizontal, Vertical);
+                       W, H, sStride, dStride, Horizontal, Vertical, Prime);
         return;
     }
 
-    /* First pixel has no left nor top neighbor. Only previous frame */
-    LineAnt[0] = PixelAnt = Frame[0]<<16;
-    PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
-    FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+    if (Prime){
+        /* LineAnt already holds the line above, see deNoisePrime() */
+        sLineOffs = -sStride, dLineOffs = -dStride;
+        Y = 0;
+    } else {
+        /* First pixel has no left nor top neighbor. Only previous frame */
+        LineAnt[0] = PixelAnt = Frame[0]<<16;
+        PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
+        FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
+        FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
 
-    /* First line has no top neighbor. Only left one for each pixel and
-     * last frame */
-    for (X = 1; X < W; X++){
-        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
-        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+        /* First line has no top neighbor. Only left one for each pixel and
+         * last frame */
+        for (X = 1; X < W; X++){
+            LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+            PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
+            FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
+            FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+        }
+        Y = 1;
     }
 
-    for (Y = 1; Y < H; Y++){
+    for (; Y < H; Y++){
         unsigned int PixelAnt;
         unsigned short* LinePrev=&FrameAnt[Y*W];
         sLineOffs += sStride, dLineOffs += dStride;
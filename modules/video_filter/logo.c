@@ -165,6 +165,7 @@ struct filter_sys_t
 
     /* On the fly control variable */
     bool b_spu_update;
+    const logo_t *p_spu_logo; /* logo of the last subpicture */
 
     /* */
     bool b_mouse_grab;
@@ -285,6 +286,7 @@ static int OpenCommon( vlc_object_t *p_this, bool b_sub )
     vlc_mutex_init( &p_sys->lock );
     LogoListLoad( p_this, p_list, psz_filename );
     p_sys->b_spu_update = true;
+    p_sys->p_spu_logo = NULL;
     p_sys->b_mouse_grab = false;
 
     for( int i = 0; ppsz_filter_callbacks[i]; i++ )
@@ -354,7 +356,18 @@ static subpicture_t *FilterSub( filter_t *p_filter, mtime_t date )
 
     /* adjust index to the next logo */
     p_logo = LogoListNext( p_list, date );
+
+    /* The subpicture already shown stays until it is replaced: do not send
+     * the same one again (a single image), so that it is neither converted
+     * nor scaled again */
+    if( !p_sys->b_spu_update && p_list->i_repeat == -1
+     && p_logo == p_sys->p_spu_logo )
+    {
+        vlc_mutex_unlock( &p_sys->lock );
+        return NULL;
+    }
     p_sys->b_spu_update = false;
+    p_sys->p_spu_logo = p_logo;
 
     p_pic = p_logo->p_pic;
 
@@ -386,7 +399,8 @@ static subpicture_t *FilterSub( filter_t *p_filter, mtime_t date )
     fmt.i_width = fmt.i_visible_width = p_pic->p[Y_PLANE].i_visible_pitch;
     fmt.i_height = fmt.i_visible_height = p_pic->p[Y_PLANE].i_visible_lines;
     fmt.i_x_offset = fmt.i_y_offset = 0;
-    p_region = subpicture_region_New( &fmt );
+    /* The logo pictures are not modified once loaded: share them */
+    p_region = subpicture_region_NewFromPicture( &fmt, p_pic );
     if( !p_region )
     {
         msg_Err( p_filter, "cannot allocate SPU region" );
@@ -395,9 +409,6 @@ static subpicture_t *FilterSub( filter_t *p_filter, mtime_t date )
         goto exit;
     }
 
-    /* */
-    picture_Copy( p_region->p_picture, p_pic );
-
     /*  where to locate the logo: */
     if( p_sys->i_pos < 0 )
     {   /*  set to an absolute xy */
@@ -41,6 +41,7 @@
 #include "mosaic.h"
 
 #define BLANK_DELAY INT64_C(1000000)
+#define STATS_PERIOD INT64_C(10000000)
 
 /*****************************************************************************
  * Local prototypes
@@ -55,6 +56,39 @@ static int MosaicCallback   ( vlc_object_t *, char const *, vlc_value_t,
 /*****************************************************************************
  * filter_sys_t : filter descriptor
  *****************************************************************************/
+
+/* A picture to show in the mosaic, scaled outside of the bridge lock */
+typedef struct
+{
+    picture_t     *p_picture;     /* Input picture (held) */
+    picture_t     *p_converted;   /* Scaled picture */
+    video_format_t fmt_in;
+    video_format_t fmt_out;
+    mtime_t        i_scale_time;
+
+    int i_x, i_y;
+    int i_alpha;
+    int i_stats;                  /* Index of the statistics of the tile */
+} mosaic_tile_t;
+
+/* Latency statistics of an input, reported every STATS_PERIOD */
+typedef struct
+{
+    char    *psz_id;
+    unsigned i_pictures;
+    mtime_t  i_age_total;         /* Age of the pictures when shown */
+    mtime_t  i_age_max;
+    mtime_t  i_scale_total;       /* Scaling time */
+    mtime_t  i_scale_max;
+} mosaic_stats_t;
+
+typedef struct
+{
+    filter_t        *p_filter;
+    image_handler_t *p_image;
+    vlc_thread_t     thread;
+} mosaic_worker_t;
+
 struct filter_sys_t
 {
     vlc_mutex_t lock;         /* Internal filter lock */
@@ -79,6 +113,22 @@ struct filter_sys_t
     int i_offsets_length;
 
     mtime_t i_delay;
+
+    /* Scaling workers, the filter thread being one more */
+    vlc_mutex_t      work_lock;
+    vlc_cond_t       work_wait;   /* Tiles to scale or quit */
+    vlc_cond_t       work_done;   /* All tiles scaled */
+    mosaic_worker_t *p_workers;
+    unsigned         i_workers;
+    mosaic_tile_t   *p_tiles;
+    unsigned         i_tiles;
+    unsigned         i_next_tile;
+    unsigned         i_done_tiles;
+    bool             b_quit;
+
+    mosaic_stats_t  *p_stats;
+    int              i_stats;
+    mtime_t          i_stats_date;
 };
 
 /*****************************************************************************
@@ -151,6 +201,11 @@ struct filter_sys_t
         "(only used if positioning method is set to \"offsets\"). You " \
         "must give a comma-separated list of coordinates (eg: 10,10,150,10)." )
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_( \
+        "Number of threads scaling the mosaic elements " \
+        "(0 for the number of processors)." )
+
 #define DELAY_TEXT N_("Delay")
 #define DELAY_LONGTEXT N_( \
         "Pictures coming from the mosaic elements will be delayed " \
@@ -223,13 +278,16 @@ vlc_module_begin ()
 
     add_integer( CFG_PREFIX "delay", 0, DELAY_TEXT, DELAY_LONGTEXT,
                  false )
+
+    add_integer_with_range( CFG_PREFIX "threads", 0, 0, 32,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
     "alpha", "height", "width", "align", "xoffset", "yoffset",
     "borderw", "borderh", "position", "rows", "cols",
     "keep-aspect-ratio", "keep-picture", "order", "offsets",
-    "delay", NULL
+    "delay", "threads", NULL
 };
 
 /*****************************************************************************
@@ -272,6 +330,161 @@ static void mosaic_ParseSetOffsets( vlc_object_t *p_this,
 #define mosaic_ParseSetOffsets( a, b, c ) \
             mosaic_ParseSetOffsets( VLC_OBJECT( a ), b, c )
 
+/*****************************************************************************
+ * Tiles scaling
+ *****************************************************************************/
+static void ScaleTile( image_handler_t *p_image, mosaic_tile_t *p_tile )
+{
+    mtime_t i_start = mdate();
+
+    p_tile->p_converted = image_Convert( p_image, p_tile->p_picture,
+                                         &p_tile->fmt_in, &p_tile->fmt_out );
+    p_tile->i_scale_time = mdate() - i_start;
+}
+
+/* Scales tiles until there are none left. Called with work_lock held. */
+static void ScaleTiles( filter_sys_t *p_sys, image_handler_t *p_image )
+{
+    while( p_sys->i_next_tile < p_sys->i_tiles )
+    {
+        mosaic_tile_t *p_tile = &p_sys->p_tiles[p_sys->i_next_tile++];
+
+        vlc_mutex_unlock( &p_sys->work_lock );
+        ScaleTile( p_image, p_tile );
+        vlc_mutex_lock( &p_sys->work_lock );
+
+        if( ++p_sys->i_done_tiles == p_sys->i_tiles )
+            vlc_cond_signal( &p_sys->work_done );
+    }
+}
+
+static void *Worker( void *p_data )
+{
+    mosaic_worker_t *p_worker = p_data;
+    filter_sys_t *p_sys = p_worker->p_filter->p_sys;
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock( &p_sys->work_lock );
+    for( ;; )
+    {
+        while( !p_sys->b_quit && p_sys->i_next_tile >= p_sys->i_tiles )
+            vlc_cond_wait( &p_sys->work_wait, &p_sys->work_lock );
+        if( p_sys->b_quit )
+            break;
+        ScaleTiles( p_sys, p_worker->p_image );
+    }
+    vlc_mutex_unlock( &p_sys->work_lock );
+
+    vlc_restorecancel( canc );
+    return NULL;
+}
+
+static void StartWorkers( filter_t *p_filter, unsigned i_threads )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( i_threads == 0 )
+        i_threads = vlc_GetCPUCount();
+
+    p_sys->i_workers = 0;
+    p_sys->p_workers = NULL;
+    if( i_threads <= 1 )
+        return;
+
+    p_sys->p_workers = calloc( i_threads - 1, sizeof( *p_sys->p_workers ) );
+    if( p_sys->p_workers == NULL )
+        return;
+
+    for( unsigned i = 0; i < i_threads - 1; i++ )
+    {
+        mosaic_worker_t *p_worker = &p_sys->p_workers[p_sys->i_workers];
+
+        p_worker->p_filter = p_filter;
+        p_worker->p_image = image_HandlerCreate( p_filter );
+        if( p_worker->p_image == NULL )
+            break;
+        if( vlc_clone( &p_worker->thread, Worker, p_worker,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            image_HandlerDelete( p_worker->p_image );
+            break;
+        }
+        p_sys->i_workers++;
+    }
+    msg_Dbg( p_filter, "scaling with %u threads", p_sys->i_workers + 1 );
+}
+
+static void StopWorkers( filter_sys_t *p_sys )
+{
+    vlc_mutex_lock( &p_sys->work_lock );
+    p_sys->b_quit = true;
+    vlc_cond_broadcast( &p_sys->work_wait );
+    vlc_mutex_unlock( &p_sys->work_lock );
+
+    for( unsigned i = 0; i < p_sys->i_workers; i++ )
+    {
+        vlc_join( p_sys->p_workers[i].thread, NULL );
+        image_HandlerDelete( p_sys->p_workers[i].p_image );
+    }
+    free( p_sys->p_workers );
+}
+
+/*****************************************************************************
+ * Statistics
+ *****************************************************************************/
+static int GetStats( filter_sys_t *p_sys, const char *psz_id )
+{
+    if( psz_id == NULL )
+        psz_id = "";
+
+    for( int i = 0; i < p_sys->i_stats; i++ )
+        if( !strcmp( p_sys->p_stats[i].psz_id, psz_id ) )
+            return i;
+
+    char *psz_dup = strdup( psz_id );
+    mosaic_stats_t *p_stats = realloc( p_sys->p_stats,
+                                 (p_sys->i_stats + 1) * sizeof( *p_stats ) );
+    if( unlikely(psz_dup == NULL || p_stats == NULL) )
+    {
+        free( psz_dup );
+        if( p_stats != NULL )
+            p_sys->p_stats = p_stats;
+        return -1;
+    }
+    p_sys->p_stats = p_stats;
+    memset( &p_stats[p_sys->i_stats], 0, sizeof( *p_stats ) );
+    p_stats[p_sys->i_stats].psz_id = psz_dup;
+    return p_sys->i_stats++;
+}
+
+static void ReportStats( filter_t *p_filter, mtime_t date )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( date < p_sys->i_stats_date + STATS_PERIOD )
+        return;
+    p_sys->i_stats_date = date;
+
+    for( int i = 0; i < p_sys->i_stats; i++ )
+    {
+        mosaic_stats_t *p_stats = &p_sys->p_stats[i];
+
+        if( p_stats->i_pictures == 0 )
+            continue;
+        msg_Dbg( p_filter, "input %s: %u pictures, latency %"PRId64
+                 "/%"PRId64" us (average/max), scaling %"PRId64"/%"PRId64
+                 " us", p_stats->psz_id, p_stats->i_pictures,
+                 p_stats->i_age_total / p_stats->i_pictures,
+                 p_stats->i_age_max,
+                 p_stats->i_scale_total / p_stats->i_pictures,
+                 p_stats->i_scale_max );
+
+        p_stats->i_pictures = 0;
+        p_stats->i_age_total = p_stats->i_age_max = 0;
+        p_stats->i_scale_total = p_stats->i_scale_max = 0;
+    }
+}
+
 /*****************************************************************************
  * CreateFiler: allocate mosaic video filter
  *****************************************************************************/
@@ -328,9 +541,23 @@ static int CreateFilter( vlc_object_t *p_this )
 
     p_sys->b_keep = var_CreateGetBoolCommand( p_filter,
                                               CFG_PREFIX "keep-picture" );
+    vlc_mutex_init( &p_sys->work_lock );
+    vlc_cond_init( &p_sys->work_wait );
+    vlc_cond_init( &p_sys->work_done );
+    p_sys->p_tiles = NULL;
+    p_sys->i_tiles = p_sys->i_next_tile = p_sys->i_done_tiles = 0;
+    p_sys->b_quit = false;
+    p_sys->i_workers = 0;
+    p_sys->p_workers = NULL;
+    p_sys->p_stats = NULL;
+    p_sys->i_stats = 0;
+    p_sys->i_stats_date = 0;
+
     if ( !p_sys->b_keep )
     {
         p_sys->p_image = image_HandlerCreate( p_filter );
+        StartWorkers( p_filter,
+                      var_CreateGetInteger( p_filter, CFG_PREFIX "threads" ) );
     }
 
     p_sys->i_order_length = 0;
@@ -403,8 +630,17 @@ static void DestroyFilter( vlc_object_t *p_this )
 
     if( !p_sys->b_keep )
     {
+        StopWorkers( p_sys );
         image_HandlerDelete( p_sys->p_image );
     }
+    vlc_cond_destroy( &p_sys->work_done );
+    vlc_cond_destroy( &p_sys->work_wait );
+    vlc_mutex_destroy( &p_sys->work_lock );
+    free( p_sys->p_tiles );
+
+    for( int i = 0; i < p_sys->i_stats; i++ )
+        free( p_sys->p_stats[i].psz_id );
+    free( p_sys->p_stats );
 
     if( p_sys->i_order_length )
     {
@@ -522,11 +758,23 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
 
     i_real_index = 0;
 
+    /* Hold the pictures to show, and lay them out, under the bridge lock */
+    mosaic_tile_t *p_tiles = realloc( p_sys->p_tiles, p_bridge->i_es_num
+                                      * sizeof( *p_tiles ) );
+    if( p_tiles == NULL && p_bridge->i_es_num > 0 )
+    {
+        vlc_global_unlock( VLC_MOSAIC_MUTEX );
+        vlc_mutex_unlock( &p_sys->lock );
+        return p_spu;
+    }
+    p_sys->p_tiles = p_tiles;
+    unsigned i_tiles = 0;
+
     for ( i_index = 0; i_index < p_bridge->i_es_num; i_index++ )
     {
         bridged_es_t *p_es = p_bridge->pp_es[i_index];
+        mosaic_tile_t *p_tile = &p_tiles[i_tiles];
         video_format_t fmt_in, fmt_out;
-        picture_t *p_converted;
 
         memset( &fmt_in, 0, sizeof( video_format_t ) );
         memset( &fmt_out, 0, sizeof( video_format_t ) );
@@ -618,51 +866,46 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
 
             fmt_out.i_visible_width = fmt_out.i_width;
             fmt_out.i_visible_height = fmt_out.i_height;
-
-            p_converted = image_Convert( p_sys->p_image, p_es->p_picture,
-                                         &fmt_in, &fmt_out );
-            if( !p_converted )
-            {
-                msg_Warn( p_filter,
-                           "image resizing and chroma conversion failed" );
-                continue;
-            }
         }
         else
         {
-            p_converted = p_es->p_picture;
-            fmt_in.i_width = fmt_out.i_width = p_converted->format.i_width;
-            fmt_in.i_height = fmt_out.i_height = p_converted->format.i_height;
-            fmt_in.i_chroma = fmt_out.i_chroma = p_converted->format.i_chroma;
+            picture_t *p_picture = p_es->p_picture;
+            fmt_in.i_width = fmt_out.i_width = p_picture->format.i_width;
+            fmt_in.i_height = fmt_out.i_height = p_picture->format.i_height;
+            fmt_in.i_chroma = fmt_out.i_chroma = p_picture->format.i_chroma;
             fmt_out.i_visible_width = fmt_out.i_width;
             fmt_out.i_visible_height = fmt_out.i_height;
         }
 
-        p_region = subpicture_region_New( &fmt_out );
-        /* FIXME the copy is probably not needed anymore */
-        if( p_region )
-            picture_Copy( p_region->p_picture, p_converted );
-        if( !p_sys->b_keep )
-            picture_Release( p_converted );
-
-        if( !p_region )
+        /* The bridged pictures are not modified once pushed: only hold it */
+        p_tile->p_picture = picture_Hold( p_es->p_picture );
+        p_tile->p_converted = NULL;
+        p_tile->fmt_in = fmt_in;
+        p_tile->fmt_out = fmt_out;
+        p_tile->i_scale_time = 0;
+        p_tile->i_alpha = p_es->i_alpha;
+        p_tile->i_stats = GetStats( p_sys, p_es->psz_id );
+        if( p_tile->i_stats >= 0 )
         {
-            msg_Err( p_filter, "cannot allocate SPU region" );
-            subpicture_Delete( p_spu );
-            vlc_global_unlock( VLC_MOSAIC_MUTEX );
-            vlc_mutex_unlock( &p_sys->lock );
-            return NULL;
+            mosaic_stats_t *p_stats = &p_sys->p_stats[p_tile->i_stats];
+            mtime_t i_age = date - p_es->p_picture->date;
+
+            p_stats->i_pictures++;
+            p_stats->i_age_total += i_age;
+            if( i_age > p_stats->i_age_max )
+                p_stats->i_age_max = i_age;
         }
+        i_tiles++;
 
         if( p_es->i_x >= 0 && p_es->i_y >= 0 )
         {
-            p_region->i_x = p_es->i_x;
-            p_region->i_y = p_es->i_y;
+            p_tile->i_x = p_es->i_x;
+            p_tile->i_y = p_es->i_y;
         }
         else if( p_sys->i_position == position_offsets )
         {
-            p_region->i_x = p_sys->pi_x_offsets[i_real_index];
-            p_region->i_y = p_sys->pi_y_offsets[i_real_index];
+            p_tile->i_x = p_sys->pi_x_offsets[i_real_index];
+            p_tile->i_y = p_sys->pi_y_offsets[i_real_index];
         }
         else
         {
@@ -671,14 +914,14 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
             {
                 /* we don't have to center the video since it takes the
                 whole rectangle area or it's larger than the rectangle */
-                p_region->i_x = p_sys->i_xoffset
+                p_tile->i_x = p_sys->i_xoffset
                             + i_col * ( p_sys->i_width / p_sys->i_cols )
                             + ( i_col * p_sys->i_borderw ) / p_sys->i_cols;
             }
             else
             {
                 /* center the video in the dedicated rectangle */
-                p_region->i_x = p_sys->i_xoffset
+                p_tile->i_x = p_sys->i_xoffset
                         + i_col * ( p_sys->i_width / p_sys->i_cols )
                         + ( i_col * p_sys->i_borderw ) / p_sys->i_cols
                         + ( col_inner_width - fmt_out.i_width ) / 2;
@@ -689,21 +932,82 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
             {
                 /* we don't have to center the video since it takes the
                 whole rectangle area or it's taller than the rectangle */
-                p_region->i_y = p_sys->i_yoffset
+                p_tile->i_y = p_sys->i_yoffset
                         + i_row * ( p_sys->i_height / p_sys->i_rows )
                         + ( i_row * p_sys->i_borderh ) / p_sys->i_rows;
             }
             else
             {
                 /* center the video in the dedicated rectangle */
-                p_region->i_y = p_sys->i_yoffset
+                p_tile->i_y = p_sys->i_yoffset
                         + i_row * ( p_sys->i_height / p_sys->i_rows )
                         + ( i_row * p_sys->i_borderh ) / p_sys->i_rows
                         + ( row_inner_height - fmt_out.i_height ) / 2;
             }
         }
+    }
+
+    vlc_global_unlock( VLC_MOSAIC_MUTEX );
+
+    /* Scale the tiles in parallel, while the bridges go on pushing */
+    if( !p_sys->b_keep )
+    {
+        vlc_mutex_lock( &p_sys->work_lock );
+        p_sys->i_tiles = i_tiles;
+        p_sys->i_next_tile = 0;
+        p_sys->i_done_tiles = 0;
+        vlc_cond_broadcast( &p_sys->work_wait );
+
+        ScaleTiles( p_sys, p_sys->p_image );
+        while( p_sys->i_done_tiles < i_tiles )
+            vlc_cond_wait( &p_sys->work_done, &p_sys->work_lock );
+        p_sys->i_tiles = 0;
+        vlc_mutex_unlock( &p_sys->work_lock );
+    }
+
+    for( unsigned i = 0; i < i_tiles; i++ )
+    {
+        mosaic_tile_t *p_tile = &p_tiles[i];
+        picture_t *p_converted;
+
+        if( p_sys->b_keep )
+            p_converted = p_tile->p_picture;
+        else
+        {
+            picture_Release( p_tile->p_picture );
+            p_converted = p_tile->p_converted;
+            if( p_tile->i_stats >= 0 )
+            {
+                mosaic_stats_t *p_stats = &p_sys->p_stats[p_tile->i_stats];
+
+                p_stats->i_scale_total += p_tile->i_scale_time;
+                if( p_tile->i_scale_time > p_stats->i_scale_max )
+                    p_stats->i_scale_max = p_tile->i_scale_time;
+            }
+        }
+
+        if( p_converted == NULL )
+        {
+            msg_Warn( p_filter,
+                      "image resizing and chroma conversion failed" );
+            continue;
+        }
+
+        p_region = subpicture_region_New( &p_tile->fmt_out );
+        if( p_region == NULL )
+        {
+            msg_Err( p_filter, "cannot allocate SPU region" );
+            picture_Release( p_converted );
+            continue;
+        }
+        /* Show the scaled (or bridged) picture as is, without copying it */
+        picture_Release( p_region->p_picture );
+        p_region->p_picture = p_converted;
+
+        p_region->i_x = p_tile->i_x;
+        p_region->i_y = p_tile->i_y;
         p_region->i_align = p_sys->i_align;
-        p_region->i_alpha = p_es->i_alpha;
+        p_region->i_alpha = p_tile->i_alpha;
 
         if( p_region_prev == NULL )
         {
@@ -717,7 +1021,7 @@ static subpicture_t *Filter( filter_t *p_filter, mtime_t date )
         p_region_prev = p_region;
     }
 
-    vlc_global_unlock( VLC_MOSAIC_MUTEX );
+    ReportStats( p_filter, date );
     vlc_mutex_unlock( &p_sys->lock );
 
     return p_spu;
@@ -41,6 +41,7 @@
 #include <vlc_cpu.h>
 
 #include "filter_picture.h"
+#include "bands.h"
 
 #ifdef HAVE_POSTPROC_POSTPROCESS_H
 #   include <postproc/postprocess.h>
@@ -75,6 +76,10 @@ static int PPNameCallback( vlc_object_t *, char const *,
 #define NAME_TEXT N_("FFmpeg post processing filter chains")
 #define NAME_LONGTEXT NAME_TEXT
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads, each filtering a band of the "\
+                            "picture. 0 uses one thread per CPU.")
+
 #define FILTER_PREFIX "postproc-"
 
 /*****************************************************************************
@@ -96,27 +101,51 @@ vlc_module_begin ()
         change_safe()
     add_string( FILTER_PREFIX "name", "default", NAME_TEXT,
                 NAME_LONGTEXT, true )
+    add_integer_with_range( FILTER_PREFIX "threads", 0, 0, BANDS_THREADS_MAX,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "q", "name", NULL
+    "q", "name", "threads", NULL
 };
 
+/* The bands are made of whole macroblock rows, at least that many of them */
+#define PP_MB_LINES 16
+#define PP_BAND_MIN_MB 4
+
 /*****************************************************************************
  * filter_sys_t : libpostproc video postprocessing descriptor
  *****************************************************************************/
 struct filter_sys_t
 {
-    /* Never changes after init */
-    pp_context *pp_context;
+    /* Never change after init */
+    bands_sys_t bands;
+    unsigned    i_bands;
+    pp_context *pp_context[BANDS_THREADS_MAX]; /* one per band */
+    picture_t  *p_band[BANDS_THREADS_MAX]; /* output of each band, if many */
+    int         i_chroma_vshift;
 
     /* Set to NULL if post processing is disabled */
     pp_mode *pp_mode;
 
     /* Lock when using or changing pp_mode */
     vlc_mutex_t lock;
+
+    bool b_qp_warned;
 };
 
+static void CleanBands( filter_sys_t *p_sys )
+{
+    for( unsigned i = 0; i < p_sys->i_bands; i++ )
+    {
+        if( p_sys->pp_context[i] != NULL )
+            pp_free_context( p_sys->pp_context[i] );
+        if( p_sys->p_band[i] != NULL )
+            picture_Release( p_sys->p_band[i] );
+    }
+    BandsClean( &p_sys->bands );
+}
+
 
 /*****************************************************************************
  * OpenPostproc: probe and open the postproc
@@ -177,23 +206,53 @@ static int OpenPostproc( vlc_object_t *p_this )
             return VLC_EGENERIC;
     }
 
-    p_sys = malloc( sizeof( filter_sys_t ) );
+    p_sys = calloc( 1, sizeof( filter_sys_t ) );
     if( !p_sys ) return VLC_ENOMEM;
     p_filter->p_sys = p_sys;
 
-    p_sys->pp_context = pp_get_context( p_filter->fmt_in.video.i_width,
-                                        p_filter->fmt_in.video.i_height,
-                                        i_flags );
-    if( !p_sys->pp_context )
-    {
-        msg_Err( p_filter, "Error while creating post processing context." );
-        free( p_sys );
-        return VLC_EGENERIC;
-    }
-
     config_ChainParse( p_filter, FILTER_PREFIX, ppsz_filter_options,
                        p_filter->p_cfg );
 
+    /* The bands are post processed independently, each with its own context
+     * since the context keeps the state of the temporal filters. With more
+     * than one, a band also filters a macroblock row on each side into its
+     * own picture, so that the block edges between the bands are deblocked
+     * as in a single pass, and only its own lines are copied. */
+    const unsigned i_mb = ( p_filter->fmt_in.video.i_height
+                            + PP_MB_LINES - 1 ) / PP_MB_LINES;
+    unsigned i_threads = var_CreateGetInteger( p_filter,
+                                               FILTER_PREFIX "threads" );
+    if( i_threads == 0 )
+        i_threads = vlc_GetCPUCount();
+    i_threads = __MIN( i_threads, i_mb / PP_BAND_MIN_MB );
+    BandsInit( &p_sys->bands, VLC_CLIP( i_threads, 1, BANDS_THREADS_MAX ) );
+    p_sys->i_bands = BandsCount( &p_sys->bands );
+    p_sys->i_chroma_vshift = ( i_flags & PP_FORMAT_420 ) == PP_FORMAT_420;
+
+    for( unsigned i = 0; i < p_sys->i_bands; i++ )
+    {
+        p_sys->pp_context[i] = pp_get_context( p_filter->fmt_in.video.i_width,
+                                               p_filter->fmt_in.video.i_height,
+                                               i_flags );
+        if( p_sys->i_bands > 1 )
+        {
+            video_format_t fmt = p_filter->fmt_in.video;
+            fmt.i_y_offset = 0;
+            fmt.i_height = fmt.i_visible_height =
+                ( ( i_mb + p_sys->i_bands - 1 ) / p_sys->i_bands + 2 )
+                * PP_MB_LINES;
+            p_sys->p_band[i] = picture_NewFromFormat( &fmt );
+        }
+        if( !p_sys->pp_context[i]
+         || ( p_sys->i_bands > 1 && !p_sys->p_band[i] ) )
+        {
+            msg_Err( p_filter, "Error while creating post processing context." );
+            CleanBands( p_sys );
+            free( p_sys );
+            return VLC_EGENERIC;
+        }
+    }
+
     var_Create( p_filter, FILTER_PREFIX "q", VLC_VAR_INTEGER |
                 VLC_VAR_HASCHOICE | VLC_VAR_DOINHERIT | VLC_VAR_ISCOMMAND );
 
@@ -215,7 +274,7 @@ static int OpenPostproc( vlc_object_t *p_this )
         {
             msg_Err( p_filter, "Error while creating post processing mode." );
             free( val.psz_string );
-            pp_free_context( p_sys->pp_context );
+            CleanBands( p_sys );
             free( p_sys );
             return VLC_EGENERIC;
         }
@@ -254,9 +313,6 @@ static int OpenPostproc( vlc_object_t *p_this )
     var_AddCallback( p_filter, FILTER_PREFIX "name", PPNameCallback, NULL );
 
     p_filter->pf_video_filter = PostprocPict;
-
-    msg_Warn( p_filter, "Quantification table was not set by video decoder. "
-                        "Postprocessing won't look good." );
     return VLC_SUCCESS;
 }
 
@@ -274,7 +330,7 @@ static void ClosePostproc( vlc_object_t *p_this )
 
     /* Destroy the resources */
     vlc_mutex_destroy( &p_sys->lock );
-    pp_free_context( p_sys->pp_context );
+    CleanBands( p_sys );
     pp_free_mode( p_sys->pp_mode );
     free( p_sys );
 }
@@ -282,6 +338,78 @@ static void ClosePostproc( vlc_object_t *p_this )
 /*****************************************************************************
  * PostprocPict
  *****************************************************************************/
+typedef struct
+{
+    filter_t        *p_filter;
+    const picture_t *p_in;
+    picture_t       *p_out;
+    const int8_t    *p_qp;     /* NULL if the decoder gave none */
+    int              i_qp_stride;
+    int              i_qp_type;
+} pp_job_t;
+
+static void PostprocBand( void *p_opaque, unsigned i_band, unsigned i_bands )
+{
+    pp_job_t *p_job = p_opaque;
+    filter_sys_t *p_sys = p_job->p_filter->p_sys;
+    const int i_width = p_job->p_filter->fmt_in.video.i_width;
+    const int i_height = p_job->p_filter->fmt_in.video.i_height;
+    const int i_mb = ( i_height + PP_MB_LINES - 1 ) / PP_MB_LINES;
+
+    /* Luma lines of the band, and of its post processing */
+    const int i_first = PP_MB_LINES * ( i_mb * i_band / i_bands );
+    const int i_end = __MIN( PP_MB_LINES * ( i_mb * ( i_band + 1 ) / i_bands ),
+                             i_height );
+    const int i_top = i_bands > 1 ? __MAX( i_first - PP_MB_LINES, 0 ) : 0;
+    const int i_bottom = i_bands > 1 ? __MIN( i_end + PP_MB_LINES, i_height )
+                                     : i_height;
+    picture_t *p_dst = i_bands > 1 ? p_sys->p_band[i_band] : p_job->p_out;
+
+    const uint8_t *src[3];
+    uint8_t *dst[3];
+    int i_src_stride[3], i_dst_stride[3];
+
+    for( int i_plane = 0; i_plane < p_job->p_in->i_planes; i_plane++ )
+    {
+        const int i_shift = i_plane == Y_PLANE ? 0 : p_sys->i_chroma_vshift;
+        const plane_t *p_src = &p_job->p_in->p[i_plane];
+
+        /* I'm not sure what happens if i_pitch != i_visible_pitch ...
+         * at least it shouldn't crash. */
+        i_src_stride[i_plane] = p_src->i_pitch;
+        i_dst_stride[i_plane] = p_dst->p[i_plane].i_pitch;
+        src[i_plane] = &p_src->p_pixels[( i_top >> i_shift ) * p_src->i_pitch];
+        /* The band picture starts at the first line post processed */
+        dst[i_plane] = &p_dst->p[i_plane].p_pixels[i_bands > 1 ? 0 :
+                           ( i_top >> i_shift ) * i_dst_stride[i_plane]];
+    }
+
+    const int8_t *p_qp = p_job->p_qp;
+    if( p_qp != NULL )
+        p_qp += i_top / PP_MB_LINES * p_job->i_qp_stride;
+    pp_postprocess( src, i_src_stride, dst, i_dst_stride,
+                    i_width, i_bottom - i_top, p_qp, p_job->i_qp_stride,
+                    p_sys->pp_mode, p_sys->pp_context[i_band],
+                    p_job->i_qp_type );
+
+    if( i_bands == 1 )
+        return;
+
+    for( int i_plane = 0; i_plane < p_job->p_out->i_planes; i_plane++ )
+    {
+        const int i_shift = i_plane == Y_PLANE ? 0 : p_sys->i_chroma_vshift;
+        const plane_t *p_band = &p_dst->p[i_plane];
+        plane_t *p_out = &p_job->p_out->p[i_plane];
+        const int i_lines = __MIN( i_end >> i_shift, p_out->i_visible_lines );
+
+        for( int y = i_first >> i_shift; y < i_lines; y++ )
+            memcpy( &p_out->p_pixels[y * p_out->i_pitch],
+                    &p_band->p_pixels[( y - ( i_top >> i_shift ) )
+                                      * p_band->i_pitch],
+                    __MIN( p_band->i_visible_pitch, p_out->i_visible_pitch ) );
+    }
+}
+
 static picture_t *PostprocPict( filter_t *p_filter, picture_t *p_pic )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -297,25 +425,26 @@ static picture_t *PostprocPict( filter_t *p_filter, picture_t *p_pic )
     vlc_mutex_lock( &p_sys->lock );
     if( p_sys->pp_mode != NULL )
     {
-        const uint8_t *src[3];
-        uint8_t *dst[3];
-        int i_src_stride[3], i_dst_stride[3];
+        pp_job_t job = { p_filter, p_pic, p_outpic, NULL, 0, 0 };
 
-        for( int i_plane = 0; i_plane < p_pic->i_planes; i_plane++ )
+        /* The table is only valid for the size the decoder gave */
+        const picture_qp_t *p_qp = p_pic->p_qp;
+        if( p_qp != NULL
+         && p_qp->i_width == p_filter->fmt_in.video.i_width
+         && p_qp->i_height == p_filter->fmt_in.video.i_height )
         {
-            src[i_plane] = p_pic->p[i_plane].p_pixels;
-            dst[i_plane] = p_outpic->p[i_plane].p_pixels;
-
-            /* I'm not sure what happens if i_pitch != i_visible_pitch ...
-             * at least it shouldn't crash. */
-            i_src_stride[i_plane] = p_pic->p[i_plane].i_pitch;
-            i_dst_stride[i_plane] = p_outpic->p[i_plane].i_pitch;
+            job.p_qp = p_qp->p_table;
+            job.i_qp_stride = p_qp->i_stride;
+            job.i_qp_type = p_qp->i_type ? PP_PICT_TYPE_QP2 : 0;
+        }
+        else if( !p_sys->b_qp_warned )
+        {
+            msg_Warn( p_filter, "Quantification table was not set by video "
+                                "decoder. Postprocessing won't look good." );
+            p_sys->b_qp_warned = true;
         }
 
-        pp_postprocess( src, i_src_stride, dst, i_dst_stride,
-                        p_filter->fmt_in.video.i_width,
-                        p_filter->fmt_in.video.i_height, NULL, 0,
-                        p_sys->pp_mode, p_sys->pp_context, 0 );
+        BandsRender( &p_sys->bands, PostprocBand, &job, p_sys->i_bands );
     }
     else
         picture_CopyPixels( p_outpic, p_pic );
@@ -51,7 +51,8 @@ static void Destroy     ( vlc_object_t * );
 static picture_t *Filter( filter_t *, picture_t * );
 
 static void SnapshotRatio( filter_t *p_filter, picture_t *p_pic );
-static void SavePicture( filter_t *, picture_t * );
+static void SavePicture( filter_t *, picture_t *, const char * );
+static void *Encoder( void * );
 
 /*****************************************************************************
  * Module descriptor
@@ -124,9 +125,13 @@ static const char *const ppsz_vfilter_options[] = {
     "format", "width", "height", "ratio", "prefix", "path", "replace", NULL
 };
 
+/* Pictures waiting to be encoded, at most: the scenes taken while the
+ * encoder lags behind are dropped rather than stalling the video */
+#define SCENE_QUEUE 4
+
 typedef struct scene_t {
     picture_t       *p_pic;
-    video_format_t  format;
+    char            *psz_filename;
 } scene_t;
 
 /*****************************************************************************
@@ -134,8 +139,16 @@ typedef struct scene_t {
  *****************************************************************************/
 struct filter_sys_t
 {
-    image_handler_t *p_image;
-    scene_t scene;
+    image_handler_t *p_image; /* only used by the encoder thread */
+
+    /* The pictures are encoded and written by a thread of their own */
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait;
+    scene_t      queue[SCENE_QUEUE];
+    unsigned     i_first;
+    unsigned     i_count;
+    bool         b_stop;
 
     char *psz_path;
     char *psz_prefix;
@@ -198,6 +211,21 @@ static int Create( vlc_object_t *p_this )
     if( p_sys->psz_path == NULL )
         p_sys->psz_path = config_GetUserDir( VLC_PICTURES_DIR );
 
+    vlc_mutex_init( &p_sys->lock );
+    vlc_cond_init( &p_sys->wait );
+    if( vlc_clone( &p_sys->thread, Encoder, p_filter,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        vlc_cond_destroy( &p_sys->wait );
+        vlc_mutex_destroy( &p_sys->lock );
+        image_HandlerDelete( p_sys->p_image );
+        free( p_sys->psz_format );
+        free( p_sys->psz_prefix );
+        free( p_sys->psz_path );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
     p_filter->pf_video_filter = Filter;
 
     return VLC_SUCCESS;
@@ -211,10 +239,17 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = (filter_sys_t *) p_filter->p_sys;
 
+    /* The pending pictures are still written */
+    vlc_mutex_lock( &p_sys->lock );
+    p_sys->b_stop = true;
+    vlc_cond_signal( &p_sys->wait );
+    vlc_mutex_unlock( &p_sys->lock );
+    vlc_join( p_sys->thread, NULL );
+
+    vlc_cond_destroy( &p_sys->wait );
+    vlc_mutex_destroy( &p_sys->lock );
     image_HandlerDelete( p_sys->p_image );
 
-    if( p_sys->scene.p_pic )
-        picture_Release( p_sys->scene.p_pic );
     free( p_sys->psz_format );
     free( p_sys->psz_prefix );
     free( p_sys->psz_path );
@@ -244,9 +279,6 @@ static void SnapshotRatio( filter_t *p_filter, picture_t *p_pic )
     }
     p_sys->i_frames++;
 
-    if( p_sys->scene.p_pic )
-        picture_Release( p_sys->scene.p_pic );
-
     if( (p_sys->i_width <= 0) && (p_sys->i_height > 0) )
     {
         p_sys->i_width = (p_pic->format.i_width * p_sys->i_height) / p_pic->format.i_height;
@@ -261,22 +293,90 @@ static void SnapshotRatio( filter_t *p_filter, picture_t *p_pic )
         p_sys->i_height = p_pic->format.i_height;
     }
 
-    p_sys->scene.p_pic = picture_NewFromFormat( &p_pic->format );
-    if( p_sys->scene.p_pic )
+    vlc_mutex_lock( &p_sys->lock );
+    bool b_full = p_sys->i_count >= SCENE_QUEUE;
+    vlc_mutex_unlock( &p_sys->lock );
+    if( b_full )
+    {
+        msg_Warn( p_filter, "scene encoding too slow, dropping picture" );
+        return;
+    }
+
+    /* The picture is only copied here, it is converted, scaled and encoded
+     * by the encoder thread */
+    char *psz_filename;
+    int i_ret;
+
+    if( p_sys->b_replace )
+        i_ret = asprintf( &psz_filename, "%s" DIR_SEP "%s.%s",
+                          p_sys->psz_path, p_sys->psz_prefix,
+                          p_sys->psz_format );
+    else
+        i_ret = asprintf( &psz_filename, "%s" DIR_SEP "%s%05d.%s",
+                          p_sys->psz_path, p_sys->psz_prefix,
+                          p_sys->i_frames, p_sys->psz_format );
+    if( i_ret == -1 )
+        return;
+    path_sanitize( psz_filename );
+
+    picture_t *p_copy = picture_NewFromFormat( &p_pic->format );
+    if( p_copy == NULL )
+    {
+        free( psz_filename );
+        return;
+    }
+    picture_Copy( p_copy, p_pic );
+
+    /* Only this thread adds pictures, there is still room */
+    vlc_mutex_lock( &p_sys->lock );
+    scene_t *p_scene = &p_sys->queue[( p_sys->i_first + p_sys->i_count )
+                                     % SCENE_QUEUE];
+    p_scene->p_pic = p_copy;
+    p_scene->psz_filename = psz_filename;
+    p_sys->i_count++;
+    vlc_cond_signal( &p_sys->wait );
+    vlc_mutex_unlock( &p_sys->lock );
+}
+
+/*****************************************************************************
+ * Encoder: encodes and writes the queued pictures
+ *****************************************************************************/
+static void *Encoder( void *p_data )
+{
+    filter_t *p_filter = p_data;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    for( ;; )
     {
-        picture_Copy( p_sys->scene.p_pic, p_pic );
-        SavePicture( p_filter, p_sys->scene.p_pic );
+        while( p_sys->i_count == 0 && !p_sys->b_stop )
+            vlc_cond_wait( &p_sys->wait, &p_sys->lock );
+        if( p_sys->i_count == 0 )
+            break;
+
+        scene_t scene = p_sys->queue[p_sys->i_first];
+        p_sys->i_first = ( p_sys->i_first + 1 ) % SCENE_QUEUE;
+        p_sys->i_count--;
+        vlc_mutex_unlock( &p_sys->lock );
+
+        SavePicture( p_filter, scene.p_pic, scene.psz_filename );
+        picture_Release( scene.p_pic );
+        free( scene.psz_filename );
+
+        vlc_mutex_lock( &p_sys->lock );
     }
+    vlc_mutex_unlock( &p_sys->lock );
+    return NULL;
 }
 
 /*****************************************************************************
  * Save Picture to disk
  *****************************************************************************/
-static void SavePicture( filter_t *p_filter, picture_t *p_pic )
+static void SavePicture( filter_t *p_filter, picture_t *p_pic,
+                         const char *psz_filename )
 {
     filter_sys_t *p_sys = (filter_sys_t *)p_filter->p_sys;
     video_format_t fmt_in, fmt_out;
-    char *psz_filename = NULL;
     char *psz_temp = NULL;
     int i_ret;
 
@@ -294,22 +394,6 @@ static void SavePicture( filter_t *p_filter, picture_t *p_pic )
      * Save the snapshot to a temporary file and
      * switch it to the real name afterwards.
      */
-    if( p_sys->b_replace )
-        i_ret = asprintf( &psz_filename, "%s" DIR_SEP "%s.%s",
-                          p_sys->psz_path, p_sys->psz_prefix,
-                          p_sys->psz_format );
-    else
-        i_ret = asprintf( &psz_filename, "%s" DIR_SEP "%s%05d.%s",
-                          p_sys->psz_path, p_sys->psz_prefix,
-                          p_sys->i_frames, p_sys->psz_format );
-
-    if( i_ret == -1 )
-    {
-        msg_Err( p_filter, "could not create snapshot %s", psz_filename );
-        goto error;
-    }
-    path_sanitize( psz_filename );
-
     i_ret = asprintf( &psz_temp, "%s.swp", psz_filename );
     if( i_ret == -1 )
     {
@@ -342,5 +426,4 @@ static void SavePicture( filter_t *p_filter, picture_t *p_pic )
 
 error:
     free( psz_temp );
-    free( psz_filename );
 }
@@ -42,6 +42,7 @@
 
 #include <vlc_filter.h>
 #include "filter_picture.h"
+#include "convolution.h"
 
 #define SIG_TEXT N_("Sharpen strength (0-2)")
 #define SIG_LONGTEXT N_("Set the Sharpen strength, between 0 and 2. Defaults to 0.05.")
@@ -167,6 +168,10 @@ static void Destroy( vlc_object_t *p_this )
  * until it is displayed and switch the two rendering buffers, preparing next
  * frame.
  *****************************************************************************/
+/* Sum of the 3x3 neighbourhood, as a separable convolution */
+static const int16_t pi_box[3] = { 1, 1, 1 };
+static const conv_kernel_t box = { 1, (int16_t *)pi_box };
+
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
     picture_t *p_outpic;
@@ -176,8 +181,7 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     int i_src_pitch;
     int i_out_pitch;
     int pix;
-    const int v1 = -1;
-    const int v2 = 3; /* 2^3 = 8 */
+    conv_ring_t ring;
 
     if( !p_pic ) return NULL;
 
@@ -194,40 +198,40 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     i_src_pitch = p_pic->p[Y_PLANE].i_pitch;
     i_out_pitch = p_outpic->p[Y_PLANE].i_pitch;
 
+    const int i_lines = p_pic->p[Y_PLANE].i_visible_lines;
+    const int i_pitch = p_pic->p[Y_PLANE].i_visible_pitch;
+
+    if( i_lines < 3 || i_pitch < 3
+     || conv_ring_Init( &ring, &p_pic->p[Y_PLANE], &box, 0, 1, 1 ) )
+    {
+        picture_CopyPixels( p_outpic, p_pic );
+        return CopyInfoAndRelease( p_outpic, p_pic );
+    }
+
     /* perform convolution only on Y plane. Avoid border line. */
+    memcpy( p_out, p_src, i_pitch );
+    memcpy( &p_out[(i_lines - 1) * i_out_pitch],
+            &p_src[(i_lines - 1) * i_src_pitch], i_pitch );
+
     vlc_mutex_lock( &p_filter->p_sys->lock );
-    for( i = 0; i < p_pic->p[Y_PLANE].i_visible_lines; i++ )
+    for( i = 1; i < i_lines - 1; i++ )
     {
-        if( (i == 0) || (i == p_pic->p[Y_PLANE].i_visible_lines - 1) )
-        {
-            for( j = 0; j < p_pic->p[Y_PLANE].i_visible_pitch; j++ )
-                p_out[i * i_out_pitch + j] = clip( p_src[i * i_src_pitch + j] );
-            continue ;
-        }
-        for( j = 0; j < p_pic->p[Y_PLANE].i_visible_pitch; j++ )
+        conv_Vertical( ring.p_acc, conv_ring_Get( &ring, i ), i_pitch, &box );
+
+        const uint8_t *p_line = &p_src[i * i_src_pitch];
+        p_out[i * i_out_pitch] = p_line[0];
+        for( j = 1; j < i_pitch - 1; j++ )
         {
-            if( (j == 0) || (j == p_pic->p[Y_PLANE].i_visible_pitch - 1) )
-            {
-                p_out[i * i_out_pitch + j] = p_src[i * i_src_pitch + j];
-                continue ;
-            }
-
-            pix = (p_src[(i - 1) * i_src_pitch + j - 1] * v1) +
-                  (p_src[(i - 1) * i_src_pitch + j    ] * v1) +
-                  (p_src[(i - 1) * i_src_pitch + j + 1] * v1) +
-                  (p_src[(i    ) * i_src_pitch + j - 1] * v1) +
-                  (p_src[(i    ) * i_src_pitch + j    ] << v2) +
-                  (p_src[(i    ) * i_src_pitch + j + 1] * v1) +
-                  (p_src[(i + 1) * i_src_pitch + j - 1] * v1) +
-                  (p_src[(i + 1) * i_src_pitch + j    ] * v1) +
-                  (p_src[(i + 1) * i_src_pitch + j + 1] * v1);
-
-           pix = pix >= 0 ? clip(pix) : -clip(pix * -1);
-           p_out[i * i_out_pitch + j] = clip( p_src[i * i_src_pitch + j] +
-               p_filter->p_sys->tab_precalc[pix + 256] );
+            /* 8 times the pixel minus its 8 neighbours */
+            pix = 9 * p_line[j] - ring.p_acc[j];
+            pix = pix >= 0 ? clip(pix) : -clip(pix * -1);
+            p_out[i * i_out_pitch + j] = clip( p_line[j] +
+                p_filter->p_sys->tab_precalc[pix + 256] );
         }
+        p_out[i * i_out_pitch + i_pitch - 1] = p_line[i_pitch - 1];
     }
     vlc_mutex_unlock( &p_filter->p_sys->lock );
+    conv_ring_Clean( &ring );
 
     plane_CopyPixels( &p_outpic->p[U_PLANE], &p_pic->p[U_PLANE] );
     plane_CopyPixels( &p_outpic->p[V_PLANE], &p_pic->p[V_PLANE] );
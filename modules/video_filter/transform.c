@@ -35,6 +35,15 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define CAN_COMPILE_NEON_INTRINSICS 1
+#endif
 
 /*****************************************************************************
  * Module descriptor
@@ -132,6 +141,227 @@ static void Plane##bits##_##f(plane_t *restrict dst, const plane_t *restrict src
     } \
 }
 
+/*
+ * The transposing transforms read the source by columns. They are done by
+ * tiles, so that the source lines of a tile stay in the cache, and by
+ * blocks of 8x8 pixels transposed in SIMD registers when possible.
+ */
+#define TILE_SIZE 64
+
+/* dst[i][j] = src[j][i] for a block of 8x8 pixels (the pitches are signed) */
+typedef void (*transpose_t)(void *dst, ptrdiff_t dst_pitch,
+                            const void *src, ptrdiff_t src_pitch);
+
+#ifdef HAVE_SSE2_INTRINSICS
+VLC_SSE
+static void Transpose8_SSE2(void *dst, ptrdiff_t dst_pitch,
+                            const void *src, ptrdiff_t src_pitch)
+{
+    const uint8_t *s = src;
+    uint8_t *d = dst;
+    __m128i a[8];
+
+    for (int i = 0; i < 8; i++)
+        a[i] = _mm_loadl_epi64((const __m128i *)(s + i * src_pitch));
+
+    __m128i b0 = _mm_unpacklo_epi8(a[0], a[1]);
+    __m128i b1 = _mm_unpacklo_epi8(a[2], a[3]);
+    __m128i b2 = _mm_unpacklo_epi8(a[4], a[5]);
+    __m128i b3 = _mm_unpacklo_epi8(a[6], a[7]);
+    __m128i c0 = _mm_unpacklo_epi16(b0, b1);
+    __m128i c1 = _mm_unpackhi_epi16(b0, b1);
+    __m128i c2 = _mm_unpacklo_epi16(b2, b3);
+    __m128i c3 = _mm_unpackhi_epi16(b2, b3);
+    __m128i r[4] = {
+        _mm_unpacklo_epi32(c0, c2), _mm_unpackhi_epi32(c0, c2),
+        _mm_unpacklo_epi32(c1, c3), _mm_unpackhi_epi32(c1, c3),
+    };
+
+    for (int i = 0; i < 4; i++) {
+        _mm_storel_epi64((__m128i *)(d + (2 * i) * dst_pitch), r[i]);
+        _mm_storel_epi64((__m128i *)(d + (2 * i + 1) * dst_pitch),
+                         _mm_unpackhi_epi64(r[i], r[i]));
+    }
+}
+
+VLC_SSE
+static void Transpose16_SSE2(void *dst, ptrdiff_t dst_pitch,
+                             const void *src, ptrdiff_t src_pitch)
+{
+    const uint8_t *s = src;
+    uint8_t *d = dst;
+    __m128i a[8], b[8], c[8];
+
+    for (int i = 0; i < 8; i++)
+        a[i] = _mm_loadu_si128((const __m128i *)(s + i * src_pitch));
+    for (int i = 0; i < 8; i += 2) {
+        b[i]     = _mm_unpacklo_epi16(a[i], a[i + 1]);
+        b[i + 1] = _mm_unpackhi_epi16(a[i], a[i + 1]);
+    }
+    for (int i = 0; i < 8; i += 4) {
+        c[i]     = _mm_unpacklo_epi32(b[i], b[i + 2]);
+        c[i + 1] = _mm_unpackhi_epi32(b[i], b[i + 2]);
+        c[i + 2] = _mm_unpacklo_epi32(b[i + 1], b[i + 3]);
+        c[i + 3] = _mm_unpackhi_epi32(b[i + 1], b[i + 3]);
+    }
+    for (int i = 0; i < 4; i++) {
+        _mm_storeu_si128((__m128i *)(d + (2 * i) * dst_pitch),
+                         _mm_unpacklo_epi64(c[i], c[i + 4]));
+        _mm_storeu_si128((__m128i *)(d + (2 * i + 1) * dst_pitch),
+                         _mm_unpackhi_epi64(c[i], c[i + 4]));
+    }
+}
+#endif
+
+#ifdef CAN_COMPILE_NEON_INTRINSICS
+static void Transpose8_NEON(void *dst, ptrdiff_t dst_pitch,
+                            const void *src, ptrdiff_t src_pitch)
+{
+    const uint8_t *s = src;
+    uint8_t *d = dst;
+    uint8x8_t a[8];
+
+    for (int i = 0; i < 8; i++)
+        a[i] = vld1_u8(s + i * src_pitch);
+
+    uint8x8x2_t t0 = vtrn_u8(a[0], a[1]);
+    uint8x8x2_t t1 = vtrn_u8(a[2], a[3]);
+    uint8x8x2_t t2 = vtrn_u8(a[4], a[5]);
+    uint8x8x2_t t3 = vtrn_u8(a[6], a[7]);
+    uint16x4x2_t u0 = vtrn_u16(vreinterpret_u16_u8(t0.val[0]),
+                               vreinterpret_u16_u8(t1.val[0]));
+    uint16x4x2_t u1 = vtrn_u16(vreinterpret_u16_u8(t0.val[1]),
+                               vreinterpret_u16_u8(t1.val[1]));
+    uint16x4x2_t u2 = vtrn_u16(vreinterpret_u16_u8(t2.val[0]),
+                               vreinterpret_u16_u8(t3.val[0]));
+    uint16x4x2_t u3 = vtrn_u16(vreinterpret_u16_u8(t2.val[1]),
+                               vreinterpret_u16_u8(t3.val[1]));
+    uint32x2x2_t v0 = vtrn_u32(vreinterpret_u32_u16(u0.val[0]),
+                               vreinterpret_u32_u16(u2.val[0]));
+    uint32x2x2_t v1 = vtrn_u32(vreinterpret_u32_u16(u1.val[0]),
+                               vreinterpret_u32_u16(u3.val[0]));
+    uint32x2x2_t v2 = vtrn_u32(vreinterpret_u32_u16(u0.val[1]),
+                               vreinterpret_u32_u16(u2.val[1]));
+    uint32x2x2_t v3 = vtrn_u32(vreinterpret_u32_u16(u1.val[1]),
+                               vreinterpret_u32_u16(u3.val[1]));
+    const uint32x2_t r[8] = {
+        v0.val[0], v1.val[0], v2.val[0], v3.val[0],
+        v0.val[1], v1.val[1], v2.val[1], v3.val[1],
+    };
+
+    for (int i = 0; i < 8; i++)
+        vst1_u8(d + i * dst_pitch, vreinterpret_u8_u32(r[i]));
+}
+
+static void Transpose16_NEON(void *dst, ptrdiff_t dst_pitch,
+                             const void *src, ptrdiff_t src_pitch)
+{
+    const uint8_t *s = src;
+    uint8_t *d = dst;
+    uint16x8_t a[8];
+
+    for (int i = 0; i < 8; i++)
+        a[i] = vld1q_u16((const uint16_t *)(s + i * src_pitch));
+
+    uint16x8x2_t t0 = vtrnq_u16(a[0], a[1]);
+    uint16x8x2_t t1 = vtrnq_u16(a[2], a[3]);
+    uint16x8x2_t t2 = vtrnq_u16(a[4], a[5]);
+    uint16x8x2_t t3 = vtrnq_u16(a[6], a[7]);
+    uint32x4x2_t u0 = vtrnq_u32(vreinterpretq_u32_u16(t0.val[0]),
+                                vreinterpretq_u32_u16(t1.val[0]));
+    uint32x4x2_t u1 = vtrnq_u32(vreinterpretq_u32_u16(t0.val[1]),
+                                vreinterpretq_u32_u16(t1.val[1]));
+    uint32x4x2_t u2 = vtrnq_u32(vreinterpretq_u32_u16(t2.val[0]),
+                                vreinterpretq_u32_u16(t3.val[0]));
+    uint32x4x2_t u3 = vtrnq_u32(vreinterpretq_u32_u16(t2.val[1]),
+                                vreinterpretq_u32_u16(t3.val[1]));
+    /* Rows 0-3 are in the low halves, rows 4-7 in the high halves */
+    const uint32x4_t lo[4] = { u0.val[0], u1.val[0], u0.val[1], u1.val[1] };
+    const uint32x4_t hi[4] = { u2.val[0], u3.val[0], u2.val[1], u3.val[1] };
+
+    for (int i = 0; i < 4; i++) {
+        vst1q_u16((uint16_t *)(d + i * dst_pitch),
+                  vreinterpretq_u16_u32(vcombine_u32(vget_low_u32(lo[i]),
+                                                     vget_low_u32(hi[i]))));
+        vst1q_u16((uint16_t *)(d + (i + 4) * dst_pitch),
+                  vreinterpretq_u16_u32(vcombine_u32(vget_high_u32(lo[i]),
+                                                     vget_high_u32(hi[i]))));
+    }
+}
+#endif
+
+static transpose_t GetTranspose(unsigned bits)
+{
+#ifdef CAN_COMPILE_NEON_INTRINSICS
+    if (bits == 8)
+        return Transpose8_NEON;
+    if (bits == 16)
+        return Transpose16_NEON;
+#endif
+#ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2()) {
+        if (bits == 8)
+            return Transpose8_SSE2;
+        if (bits == 16)
+            return Transpose16_SSE2;
+    }
+#endif
+    VLC_UNUSED(bits);
+    return NULL;
+}
+
+#define PLANE_TILED(f,bits) \
+static void Plane##bits##_##f(plane_t *restrict dst, const plane_t *restrict src) \
+{ \
+    const uint##bits##_t *src_pixels = (const void *)src->p_pixels; \
+    uint##bits##_t *restrict dst_pixels = (void *)dst->p_pixels; \
+    const unsigned src_width = src->i_pitch / sizeof (*src_pixels); \
+    const unsigned dst_width = dst->i_pitch / sizeof (*dst_pixels); \
+    const unsigned dst_visible_width = dst->i_visible_pitch / sizeof (*dst_pixels); \
+    const int dst_visible_lines = dst->i_visible_lines; \
+    const transpose_t transpose = GetTranspose(bits); \
+ \
+    for (int ty = 0; ty < dst_visible_lines; ty += TILE_SIZE) { \
+        const int ey = __MIN(ty + TILE_SIZE, dst_visible_lines); \
+        for (unsigned tx = 0; tx < dst_visible_width; tx += TILE_SIZE) { \
+            const unsigned ex = __MIN(tx + TILE_SIZE, dst_visible_width); \
+            int by = ty; \
+            unsigned bx = tx; \
+ \
+            if (transpose != NULL) { \
+                by = ty + ((ey - ty) & ~7); \
+                bx = tx + ((ex - tx) & ~7); \
+            } \
+            /* Whole 8x8 blocks: the source block is read by lines, upwards \
+             * or downwards, from its left or right edge */ \
+            for (int y = ty; y < by; y += 8) { \
+                for (unsigned x = tx; x < bx; x += 8) { \
+                    int sx, sy, sx1, sy1, sx2, sy2; \
+                    (f)(&sx, &sy, dst_visible_width, dst_visible_lines, x, y); \
+                    (f)(&sx1, &sy1, dst_visible_width, dst_visible_lines, \
+                        x + 1, y); \
+                    (f)(&sx2, &sy2, dst_visible_width, dst_visible_lines, \
+                        x, y + 1); \
+                    const bool up = sx2 < sx; \
+                    transpose(&dst_pixels[(up ? y + 7 : y) * dst_width + x], \
+                              up ? -dst->i_pitch : dst->i_pitch, \
+                              &src_pixels[sy * src_width + (up ? sx - 7 : sx)], \
+                              (sy1 - sy) * src->i_pitch); \
+                } \
+            } \
+            /* Edges of the tile */ \
+            for (int y = ty; y < ey; y++) { \
+                for (unsigned x = (y < by) ? bx : tx; x < ex; x++) { \
+                    int sx, sy; \
+                    (f)(&sx, &sy, dst_visible_width, dst_visible_lines, x, y); \
+                    dst_pixels[y * dst_width + x] = \
+                        src_pixels[sy * src_width + sx]; \
+                } \
+            } \
+        } \
+    } \
+}
+
 static void Plane_VFlip(plane_t *restrict dst, const plane_t *restrict src)
 {
     const uint8_t *src_pixels = src->p_pixels;
@@ -166,8 +396,10 @@ static void PlaneYUY2_##f(plane_t *restrict dst, const plane_t *restrict src) \
 { \
     unsigned dst_visible_width = dst->i_visible_pitch / 2; \
  \
-    for (int y = 0; y < dst->i_visible_lines; y += 2) { \
-        for (unsigned x = 0; x < dst_visible_width; x+= 2) { \
+    for (int ty = 0; ty < dst->i_visible_lines; ty += TILE_SIZE) \
+    for (unsigned tx = 0; tx < dst_visible_width; tx += TILE_SIZE) \
+    for (int y = ty; y < __MIN(ty + TILE_SIZE, dst->i_visible_lines); y += 2) { \
+        for (unsigned x = tx; x < __MIN(tx + TILE_SIZE, dst_visible_width); x+= 2) { \
             int sx0, sy0, sx1, sy1; \
             (f)(&sx0, &sy0, dst_visible_width, dst->i_visible_lines, x, y); \
             (f)(&sx1, &sy1, dst_visible_width, dst->i_visible_lines, \
@@ -203,11 +435,14 @@ PLANES(HFlip)
 #define Plane8_VFlip Plane_VFlip
 #define Plane16_VFlip Plane_VFlip
 #define Plane32_VFlip Plane_VFlip
-PLANES(Transpose)
-PLANES(AntiTranspose)
-PLANES(R90)
+#define PLANES_TILED(f) \
+PLANE_TILED(f,8) PLANE_TILED(f,16) PLANE_TILED(f,32)
+
+PLANES_TILED(Transpose)
+PLANES_TILED(AntiTranspose)
+PLANES_TILED(R90)
 PLANES(R180)
-PLANES(R270)
+PLANES_TILED(R270)
 
 #define Plane422_HFlip Plane16_HFlip
 #define Plane422_VFlip Plane_VFlip
@@ -34,6 +34,7 @@
 #endif
 
 #include <stdint.h>
+#include <new>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -46,8 +47,13 @@
 #include <vlc_image.h>
 #include <vlc_atomic.h>
 #include <vlc_aout.h>
+#include <vlc_cpu.h>
 #include <arpa/inet.h>
 
+#ifdef HAVE_SSE2_INTRINSICS
+# include <tmmintrin.h>
+#endif
+
 #include <DeckLinkAPI.h>
 #include <DeckLinkAPIDispatch.cpp>
 
@@ -528,6 +534,56 @@ static inline int clip(int a)
     else               return a;
 }
 
+#ifdef HAVE_SSE2_INTRINSICS
+/* Packs 6 pixels in each 4 words of a line, as long as the 8 lumas and
+ * 4 chromas loaded at once stay within the line. Returns the pixels done. */
+VLC_SSSE3
+static int v210_pack_ssse3(uint8_t *data, const uint16_t *y,
+                           const uint16_t *u, const uint16_t *v, int width)
+{
+    const __m128i min = _mm_set1_epi16(4), max = _mm_set1_epi16(1019);
+    /* The 1st, 2nd and 3rd components of the 4 words, as 32-bit lanes
+     * picked from the lumas and from the chromas (u0..u3 v0..v3) */
+    const __m128i a_y = _mm_setr_epi8(-1, -1, -1, -1, 2, 3, -1, -1,
+                                      -1, -1, -1, -1, 8, 9, -1, -1);
+    const __m128i a_uv = _mm_setr_epi8(0, 1, -1, -1, -1, -1, -1, -1,
+                                       10, 11, -1, -1, -1, -1, -1, -1);
+    const __m128i b_y = _mm_setr_epi8(0, 1, -1, -1, -1, -1, -1, -1,
+                                      6, 7, -1, -1, -1, -1, -1, -1);
+    const __m128i b_uv = _mm_setr_epi8(-1, -1, -1, -1, 2, 3, -1, -1,
+                                       -1, -1, -1, -1, 12, 13, -1, -1);
+    const __m128i c_y = _mm_setr_epi8(-1, -1, -1, -1, 4, 5, -1, -1,
+                                      -1, -1, -1, -1, 10, 11, -1, -1);
+    const __m128i c_uv = _mm_setr_epi8(8, 9, -1, -1, -1, -1, -1, -1,
+                                       4, 5, -1, -1, -1, -1, -1, -1);
+    int w;
+
+    for (w = 0; w + 8 <= width; w += 6) {
+        __m128i luma = _mm_loadu_si128((const __m128i *)y);
+        __m128i chroma = _mm_unpacklo_epi64(
+                _mm_loadl_epi64((const __m128i *)u),
+                _mm_loadl_epi64((const __m128i *)v));
+        luma = _mm_min_epi16(_mm_max_epi16(luma, min), max);
+        chroma = _mm_min_epi16(_mm_max_epi16(chroma, min), max);
+
+        __m128i a = _mm_or_si128(_mm_shuffle_epi8(luma, a_y),
+                                 _mm_shuffle_epi8(chroma, a_uv));
+        __m128i b = _mm_or_si128(_mm_shuffle_epi8(luma, b_y),
+                                 _mm_shuffle_epi8(chroma, b_uv));
+        __m128i c = _mm_or_si128(_mm_shuffle_epi8(luma, c_y),
+                                 _mm_shuffle_epi8(chroma, c_uv));
+        __m128i val = _mm_or_si128(a, _mm_or_si128(_mm_slli_epi32(b, 10),
+                                                   _mm_slli_epi32(c, 20)));
+        _mm_storeu_si128((__m128i *)data, val);
+        data += 16;
+        y += 6;
+        u += 3;
+        v += 3;
+    }
+    return w;
+}
+#endif
+
 static void v210_convert(void *frame_bytes, picture_t *pic, int dst_stride)
 {
     int width = pic->format.i_width;
@@ -548,9 +604,23 @@ static void v210_convert(void *frame_bytes, picture_t *pic, int dst_stride)
         put_le32(&data, val);           \
     } while (0)
 
+#ifdef HAVE_SSE2_INTRINSICS
+    const bool ssse3 = vlc_CPU_SSSE3();
+#endif
+
     for (h = 0; h < height; h++) {
         uint32_t val = 0;
-        for (w = 0; w < width - 5; w += 6) {
+        w = 0;
+#ifdef HAVE_SSE2_INTRINSICS
+        if (ssse3) {
+            w = v210_pack_ssse3(data, y, u, v, width);
+            data += w / 6 * 16;
+            y += w;
+            u += w / 2;
+            v += w / 2;
+        }
+#endif
+        for (; w < width - 5; w += 6) {
             WRITE_PIXELS(u, y, v);
             WRITE_PIXELS(y, u, y);
             WRITE_PIXELS(v, y, u);
@@ -581,6 +651,61 @@ static void v210_convert(void *frame_bytes, picture_t *pic, int dst_stride)
     }
 }
 
+/* Lends an UYVY picture to the card, which holds it until it is played out */
+class PictureFrame : public IDeckLinkVideoFrame
+{
+public:
+    PictureFrame(picture_t *pic, BMDPixelFormat fmt) : pic_(pic), fmt_(fmt)
+    {
+        atomic_store(&m_ref_, 1);
+        picture_Hold(pic_);
+    }
+
+    virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, LPVOID *) { return E_NOINTERFACE; }
+
+    virtual ULONG STDMETHODCALLTYPE AddRef(void)
+    {
+        return atomic_fetch_add(&m_ref_, 1) + 1;
+    }
+
+    virtual ULONG STDMETHODCALLTYPE Release(void)
+    {
+        uintptr_t new_ref = atomic_fetch_sub(&m_ref_, 1) - 1;
+        if (new_ref == 0)
+            delete this;
+        return new_ref;
+    }
+
+    virtual long STDMETHODCALLTYPE GetWidth(void) { return pic_->format.i_width; }
+    virtual long STDMETHODCALLTYPE GetHeight(void) { return pic_->format.i_height; }
+    virtual long STDMETHODCALLTYPE GetRowBytes(void) { return pic_->p[0].i_pitch; }
+    virtual BMDPixelFormat STDMETHODCALLTYPE GetPixelFormat(void) { return fmt_; }
+    virtual BMDFrameFlags STDMETHODCALLTYPE GetFlags(void) { return bmdFrameFlagDefault; }
+
+    virtual HRESULT STDMETHODCALLTYPE GetBytes(void **buffer)
+    {
+        *buffer = pic_->p[0].p_pixels;
+        return S_OK;
+    }
+
+    virtual HRESULT STDMETHODCALLTYPE GetTimecode(BMDTimecodeFormat, IDeckLinkTimecode **)
+    {
+        return S_FALSE;
+    }
+
+    virtual HRESULT STDMETHODCALLTYPE GetAncillaryData(IDeckLinkVideoFrameAncillary **)
+    {
+        return S_FALSE;
+    }
+
+private:
+    virtual ~PictureFrame() { picture_Release(pic_); }
+
+    atomic_uint m_ref_;
+    picture_t *pic_;
+    BMDPixelFormat fmt_;
+};
+
 static void DisplayVideo(vout_display_t *vd, picture_t *picture, subpicture_t *)
 {
     vout_display_sys_t *sys = vd->sys;
@@ -623,28 +748,39 @@ static void DisplayVideo(vout_display_t *vd, picture_t *picture, subpicture_t *)
     w = decklink_sys->i_width;
     h = decklink_sys->i_height;
 
-    IDeckLinkMutableVideoFrame *pDLVideoFrame;
-    result = decklink_sys->p_output->CreateVideoFrame(w, h, w*3,
-        sys->tenbits ? bmdFormat10BitYUV : bmdFormat8BitYUV,
-        bmdFrameFlagDefault, &pDLVideoFrame);
-
-    if (result != S_OK) {
-        msg_Err(vd, "Failed to create video frame: 0x%X", result);
-        pDLVideoFrame = NULL;
-        goto end;
-    }
+    IDeckLinkVideoFrame *pDLVideoFrame;
+    if (!sys->tenbits && (int)picture->format.i_width == w
+     && (int)picture->format.i_height == h
+     && picture->p[0].i_pitch == w * 2) {
+        /* The card reads the UYVY picture as is: no copy */
+        pDLVideoFrame = new (std::nothrow) PictureFrame(picture, bmdFormat8BitYUV);
+        if (!pDLVideoFrame)
+            goto end;
+    } else {
+        IDeckLinkMutableVideoFrame *pDLMutableFrame;
+        result = decklink_sys->p_output->CreateVideoFrame(w, h, w*3,
+            sys->tenbits ? bmdFormat10BitYUV : bmdFormat8BitYUV,
+            bmdFrameFlagDefault, &pDLMutableFrame);
 
-    void *frame_bytes;
-    pDLVideoFrame->GetBytes((void**)&frame_bytes);
-    stride = pDLVideoFrame->GetRowBytes();
-
-    if (sys->tenbits)
-        v210_convert(frame_bytes, picture, stride);
-    else for(int y = 0; y < h; ++y) {
-        uint8_t *dst = (uint8_t *)frame_bytes + stride * y;
-        const uint8_t *src = (const uint8_t *)picture->p[0].p_pixels +
-            picture->p[0].i_pitch * y;
-        memcpy(dst, src, w * 2 /* bpp */);
+        if (result != S_OK) {
+            msg_Err(vd, "Failed to create video frame: 0x%X", result);
+            pDLVideoFrame = NULL;
+            goto end;
+        }
+        pDLVideoFrame = pDLMutableFrame;
+
+        void *frame_bytes;
+        pDLMutableFrame->GetBytes((void**)&frame_bytes);
+        stride = pDLMutableFrame->GetRowBytes();
+
+        if (sys->tenbits)
+            v210_convert(frame_bytes, picture, stride);
+        else for(int y = 0; y < h; ++y) {
+            uint8_t *dst = (uint8_t *)frame_bytes + stride * y;
+            const uint8_t *src = (const uint8_t *)picture->p[0].p_pixels +
+                picture->p[0].i_pitch * y;
+            memcpy(dst, src, w * 2 /* bpp */);
+        }
     }
 
 
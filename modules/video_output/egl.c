@@ -45,6 +45,10 @@ typedef struct vlc_gl_sys_t
     EGLDisplay display;
     EGLSurface surface;
     EGLContext context;
+#ifdef EGL_KHR_image_base
+    PFNEGLCREATEIMAGEKHRPROC    eglCreateImageKHR;
+    PFNEGLDESTROYIMAGEKHRPROC   eglDestroyImageKHR;
+#endif
 #if defined (USE_PLATFORM_X11)
     Display *x11;
 #endif
@@ -100,6 +104,31 @@ static void *GetSymbol(vlc_gl_t *gl, const char *procname)
     return (void *)eglGetProcAddress (procname);
 }
 
+static const char *QueryString(vlc_gl_t *gl, int32_t name)
+{
+    vlc_gl_sys_t *sys = gl->sys;
+
+    return eglQueryString(sys->display, name);
+}
+
+#ifdef EGL_KHR_image_base
+static void *CreateImageKHR(vlc_gl_t *gl, unsigned target, void *buffer,
+                            const int32_t *attrib_list)
+{
+    vlc_gl_sys_t *sys = gl->sys;
+
+    return sys->eglCreateImageKHR(sys->display, EGL_NO_CONTEXT, target,
+                                  buffer, attrib_list);
+}
+
+static bool DestroyImageKHR(vlc_gl_t *gl, void *image)
+{
+    vlc_gl_sys_t *sys = gl->sys;
+
+    return sys->eglDestroyImageKHR(sys->display, image);
+}
+#endif
+
 static bool CheckToken(const char *haystack, const char *needle)
 {
     size_t len = strlen(needle);
@@ -359,6 +388,21 @@ static int Open (vlc_object_t *obj, const struct gl_api *api)
     gl->resize = Resize;
     gl->swap = SwapBuffers;
     gl->getProcAddress = GetSymbol;
+
+    gl->ext = VLC_GL_EXT_EGL;
+    gl->egl.queryString = QueryString;
+    gl->egl.createImageKHR = NULL;
+    gl->egl.destroyImageKHR = NULL;
+#ifdef EGL_KHR_image_base
+    sys->eglCreateImageKHR = (void *)eglGetProcAddress("eglCreateImageKHR");
+    sys->eglDestroyImageKHR = (void *)eglGetProcAddress("eglDestroyImageKHR");
+    if (CheckToken(ext, "EGL_KHR_image_base")
+     && sys->eglCreateImageKHR != NULL && sys->eglDestroyImageKHR != NULL)
+    {
+        gl->egl.createImageKHR = CreateImageKHR;
+        gl->egl.destroyImageKHR = DestroyImageKHR;
+    }
+#endif
     return VLC_SUCCESS;
 
 error:
@@ -163,6 +163,7 @@ struct vout_display_sys_t
     struct d3d_region_t     *d3dregion;
 
     picture_sys_t           *picsys;
+    bool                    opaque; /* pool of VLC_CODEC_D3D9_OPAQUE pictures */
 
     /* */
     bool                    reset_device;
@@ -50,6 +50,7 @@
 
 #include "common.h"
 #include "builtin_shaders.h"
+#include "../../video_chroma/d3d9_fmt.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -104,12 +105,6 @@ static const vlc_fourcc_t d3d_subpicture_chromas[] = {
     0
 };
 
-struct picture_sys_t
-{
-    LPDIRECT3DSURFACE9 surface;
-    picture_t          *fallback;
-};
-
 static int  Open(vlc_object_t *);
 
 static picture_pool_t *Pool  (vout_display_t *, unsigned);
@@ -202,10 +197,12 @@ static int Open(vlc_object_t *object)
 
     /* */
     vout_display_info_t info = vd->info;
-    info.is_slow = true;
+    /* The decoder surfaces are copied into the pool pictures directly, which
+     * can then be neither reallocated nor replaced by system memory */
+    info.is_slow = !sys->opaque;
     info.has_double_click = true;
     info.has_hide_mouse = false;
-    info.has_pictures_invalid = true;
+    info.has_pictures_invalid = !sys->opaque;
     info.has_event_thread = true;
     if (var_InheritBool(vd, "direct3d9-hw-blending") &&
         sys->d3dregion_format != D3DFMT_UNKNOWN &&
@@ -272,10 +269,15 @@ static void Close(vlc_object_t *object)
 }
 
 /* */
+static picture_pool_t *Direct3D9CreateOpaquePool(vout_display_t *, unsigned);
+
 static picture_pool_t *Pool(vout_display_t *vd, unsigned count)
 {
-    VLC_UNUSED(count);
-    return vd->sys->pool;
+    vout_display_sys_t *sys = vd->sys;
+
+    if (sys->pool == NULL && sys->opaque)
+        sys->pool = Direct3D9CreateOpaquePool(vd, count);
+    return sys->pool;
 }
 
 static int  Direct3D9LockSurface(picture_t *);
@@ -295,13 +297,17 @@ static void Prepare(vout_display_t *vd, picture_t *picture, subpicture_t *subpic
      * the vout doesn't keep a reference). But because of the vout
      * wrapper, we can't */
 
-    Direct3D9UnlockSurface(picture);
+    if (!sys->opaque)
+        Direct3D9UnlockSurface(picture);
     VLC_UNUSED(subpicture);
 #endif
 
     /* check if device is still available */
     HRESULT hr = IDirect3DDevice9_TestCooperativeLevel(sys->d3ddev);
     if (FAILED(hr)) {
+        /* The surfaces held by the decoder prevent the reset */
+        if (sys->opaque)
+            return;
         if (hr == D3DERR_DEVICENOTRESET && !sys->reset_device) {
             vout_display_SendEventPicturesInvalid(vd);
             sys->reset_device = true;
@@ -359,7 +365,8 @@ static void Display(vout_display_t *vd, picture_t *picture, subpicture_t *subpic
     VLC_UNUSED(subpicture);
 #else
     /* XXX See Prepare() */
-    Direct3D9LockSurface(picture);
+    if (!sys->opaque)
+        Direct3D9LockSurface(picture);
     picture_Release(picture);
 #endif
     if (subpicture)
@@ -480,7 +487,9 @@ static void Manage (vout_display_t *vd)
     sys->ch_desktop = false;
     vlc_mutex_unlock(&sys->lock);
 
-    if (ch_desktop) {
+    if (ch_desktop && sys->opaque) {
+        msg_Warn(vd, "cannot change the desktop mode of the decoder surfaces");
+    } else if (ch_desktop) {
         sys->reopen_device = true;
         vout_display_SendEventPicturesInvalid(vd);
     }
@@ -952,6 +961,18 @@ static int Direct3D9CreatePool(vout_display_t *vd, video_format_t *fmt)
     /* */
     *fmt = vd->source;
 
+    /* The pool of decoder surfaces is created by Pool() with as many
+     * pictures as requested */
+    sys->opaque = fmt->i_chroma == VLC_CODEC_D3D9_OPAQUE;
+    if (sys->opaque) {
+        if (Direct3D9CheckConversion(vd, MAKEFOURCC('N','V','1','2'),
+                                     sys->d3dpp.BackBufferFormat)) {
+            msg_Err(vd, "NV12 surfaces are not supported.");
+            return VLC_EGENERIC;
+        }
+        return VLC_SUCCESS;
+    }
+
     /* Find the appropriate D3DFORMAT for the render chroma, the format will be the closest to
      * the requested chroma which is usable by the hardware in an offscreen surface, as they
      * typically support more formats than textures */
@@ -1029,15 +1050,77 @@ static void Direct3D9DestroyPool(vout_display_t *vd)
     vout_display_sys_t *sys = vd->sys;
 
     if (sys->pool) {
-        picture_sys_t *picsys = sys->picsys;
-        IDirect3DSurface9_Release(picsys->surface);
-        if (picsys->fallback)
-            picture_Release(picsys->fallback);
+        if (!sys->opaque) {
+            picture_sys_t *picsys = sys->picsys;
+            IDirect3DSurface9_Release(picsys->surface);
+            if (picsys->fallback)
+                picture_Release(picsys->fallback);
+        }
         picture_pool_Release(sys->pool);
     }
     sys->pool = NULL;
 }
 
+static void Direct3D9DestroyPicture(picture_t *picture)
+{
+    IDirect3DSurface9_Release(picture->p_sys->surface);
+    free(picture->p_sys);
+    free(picture);
+}
+
+/**
+ * It creates the pool of VLC_CODEC_D3D9_OPAQUE pictures.
+ *
+ * Each picture has a NV12 surface in video memory, into which the DXVA2
+ * decoder copies its surfaces using the device of the picture.
+ */
+static picture_pool_t *Direct3D9CreateOpaquePool(vout_display_t *vd, unsigned count)
+{
+    vout_display_sys_t *sys = vd->sys;
+    picture_t *pictures[count];
+    unsigned i;
+
+    for (i = 0; i < count; i++) {
+        picture_sys_t *picsys = malloc(sizeof(*picsys));
+        if (unlikely(picsys == NULL))
+            break;
+
+        HRESULT hr = IDirect3DDevice9_CreateOffscreenPlainSurface(sys->d3ddev,
+                                                                  vd->fmt.i_visible_width,
+                                                                  vd->fmt.i_visible_height,
+                                                                  MAKEFOURCC('N','V','1','2'),
+                                                                  D3DPOOL_DEFAULT,
+                                                                  &picsys->surface,
+                                                                  NULL);
+        if (FAILED(hr)) {
+            msg_Err(vd, "Failed to create picture surface. (hr=0x%lx)", hr);
+            free(picsys);
+            break;
+        }
+        picsys->fallback = NULL;
+
+        picture_resource_t resource = {
+            .p_sys = picsys,
+            .pf_destroy = Direct3D9DestroyPicture,
+        };
+        pictures[i] = picture_NewFromResource(&vd->fmt, &resource);
+        if (unlikely(pictures[i] == NULL)) {
+            IDirect3DSurface9_Release(picsys->surface);
+            free(picsys);
+            break;
+        }
+    }
+    if (i == 0)
+        return NULL;
+    msg_Dbg(vd, "allocated %u of %u surfaces", i, count);
+
+    picture_pool_t *pool = picture_pool_New(i, pictures);
+    if (unlikely(pool == NULL))
+        while (i > 0)
+            picture_Release(pictures[--i]);
+    return pool;
+}
+
 /**
  * It allocates and initializes the resources needed to render the scene.
  */
@@ -95,6 +95,12 @@
 #   define SUPPORTS_FIXED_PIPELINE
 #endif
 
+/* Pixel buffer objects, for asynchronous texture uploads */
+#if !USE_OPENGL_ES && defined(GL_PIXEL_UNPACK_BUFFER) && defined(GL_MAP_PERSISTENT_BIT)
+#   define SUPPORTS_PBO
+#   define VLCGL_PBO_COUNT 3 /* streaming buffers, used in turn */
+#endif
+
 static const vlc_fourcc_t gl_subpicture_chromas[] = {
     VLC_CODEC_RGBA,
     0
@@ -102,6 +108,11 @@ static const vlc_fourcc_t gl_subpicture_chromas[] = {
 
 typedef struct {
     GLuint   texture;
+    /* Uploaded rendering (held): the SPU keeps handing over the same picture
+     * for a region until it is rendered again */
+    picture_t *picture;
+    int      x_offset;
+    int      y_offset;
     unsigned format;
     unsigned type;
     unsigned width;
@@ -118,6 +129,20 @@ typedef struct {
     float    tex_height;
 } gl_region_t;
 
+#ifdef SUPPORTS_PBO
+/* Picture from the pool, allocated in a persistently mapped pixel buffer:
+ * the decoder writes in it, and the GPU copies it to the textures */
+struct picture_sys_t {
+    GLuint         buffer;
+    const uint8_t *base;
+};
+
+typedef struct {
+    picture_t *picture;
+    GLsync     fence; /* signaled once the textures are updated */
+} gl_pbo_held_t;
+#endif
+
 struct vout_display_opengl_t {
 
     vlc_gl_t   *gl;
@@ -204,8 +229,48 @@ struct vout_display_opengl_t {
 
     uint8_t *texture_temp_buf;
     int      texture_temp_buf_size;
+
+#ifdef SUPPORTS_PBO
+    PFNGLBUFFERSTORAGEPROC   BufferStorage;
+    PFNGLMAPBUFFERRANGEPROC  MapBufferRange;
+    PFNGLUNMAPBUFFERPROC     UnmapBuffer;
+    PFNGLFENCESYNCPROC       FenceSync;
+    PFNGLCLIENTWAITSYNCPROC  ClientWaitSync;
+    PFNGLDELETESYNCPROC      DeleteSync;
+
+    /* Streaming buffers, for pictures in system memory and subpictures */
+    bool     supports_pbo;
+    GLuint   stream_buffer[VLCGL_PBO_COUNT];
+    unsigned stream_index;
+
+    /* Persistently mapped pool pictures, kept until the GPU copied them */
+    bool          supports_persistent;
+    GLuint        mapped_buffer[VLCGL_PICTURE_MAX];
+    unsigned      mapped_count;
+    gl_pbo_held_t held[VLCGL_PICTURE_MAX];
+    unsigned      held_first;
+    unsigned      held_count;
+#endif
+
+#ifdef HAVE_GL_VAAPI
+    /* VA-API surfaces are bound to the textures rather than uploaded */
+    vlc_gl_vaapi_t *vaapi;
+#endif
 };
 
+#ifdef HAVE_GL_VAAPI
+/* NV12 VA surfaces, as sampled from the imported textures: the chroma plane
+ * is made of half as many two-component pixels */
+static const vlc_chroma_description_t vaapi_chroma = {
+    .plane_count = 2,
+    .p = { { .w = {1, 1}, .h = {1, 1} }, { .w = {1, 2}, .h = {1, 2} } },
+    .pixel_size = 1,
+    .pixel_bits = 8,
+};
+#endif
+
+#define ALIGN(x, y) (((x) + ((y) - 1)) & ~((y) - 1))
+
 static inline int GetAlignedSize(unsigned size)
 {
     /* Return the smallest larger or equal power of 2 */
@@ -229,6 +294,29 @@ static bool IsLuminance16Supported(int target)
 
     return size == 16;
 }
+
+#ifdef GL_R16
+/* Luminance formats are gone from core profiles, single red components are
+ * sampled the same by the shaders */
+static bool IsRed16Supported(int target, const char *extensions)
+{
+    if (!HasExtension(extensions, "GL_ARB_texture_rg"))
+        return false;
+
+    GLuint texture;
+
+    glGenTextures(1, &texture);
+    glBindTexture(target, texture);
+    glTexImage2D(target, 0, GL_R16,
+                 64, 64, 0, GL_RED, GL_UNSIGNED_SHORT, NULL);
+    GLint size = 0;
+    glGetTexLevelParameteriv(target, 0, GL_TEXTURE_RED_SIZE, &size);
+
+    glDeleteTextures(1, &texture);
+
+    return size == 16;
+}
+#endif
 #endif
 
 #ifdef SUPPORTS_SHADERS
@@ -292,9 +380,38 @@ static void BuildYUVFragmentShader(vout_display_opengl_t *vgl,
 
         "void main(void) {"
         " vec4 x,y,z,result;"
-        " x  = texture2D(Texture0, TexCoord0.st);"
-        " %c = texture2D(Texture1, TexCoord1.st);"
-        " %c = texture2D(Texture2, TexCoord2.st);"
+        " x  = vec4(texture2D(Texture0, TexCoord0.st).r);"
+        " %c = vec4(texture2D(Texture1, TexCoord1.st).r);"
+        " %c = vec4(texture2D(Texture2, TexCoord2.st).r);"
+
+        " result = x * Coefficient[0] + Coefficient[3];"
+        " result = (y * Coefficient[1]) + result;"
+        " result = (z * Coefficient[2]) + result;"
+        "%s"
+        " gl_FragColor = result;"
+        "}";
+    /* More than 8 bits per component are rounded to the 8 bits of the
+     * framebuffer: dither with interleaved gradient noise against banding */
+    const char *dither_glsl =
+        " result.rgb += (fract(52.9829189 * fract(dot(gl_FragCoord.xy,"
+        " vec2(0.06711056, 0.00583715)))) - 0.5) / 255.0;";
+    /* Same with interleaved chroma (NV12) in one- and two-component
+     * textures */
+    const char *template_glsl_nv12 =
+        "#version " GLSL_VERSION "\n"
+        PRECISION
+        "uniform sampler2D Texture0;"
+        "uniform sampler2D Texture1;"
+        "uniform vec4      Coefficient[4];"
+        "varying vec4      TexCoord0,TexCoord1,TexCoord2;"
+
+        "void main(void) {"
+        " vec4 x,y,z,result;"
+        " vec2 uv;"
+        " x  = vec4(texture2D(Texture0, TexCoord0.st).r);"
+        " uv = texture2D(Texture1, TexCoord1.st).rg;"
+        " y  = vec4(uv.x);"
+        " z  = vec4(uv.y);"
 
         " result = x * Coefficient[0] + Coefficient[3];"
         " result = (y * Coefficient[1]) + result;"
@@ -305,9 +422,12 @@ static void BuildYUVFragmentShader(vout_display_opengl_t *vgl,
                    fmt->i_chroma == VLC_CODEC_YV9;
 
     char *code;
-    if (asprintf(&code, template_glsl_yuv,
-                 swap_uv ? 'z' : 'y',
-                 swap_uv ? 'y' : 'z') < 0)
+    if (vgl->chroma->plane_count == 2)
+        code = strdup(template_glsl_nv12);
+    else if (asprintf(&code, template_glsl_yuv,
+                      swap_uv ? 'z' : 'y',
+                      swap_uv ? 'y' : 'z',
+                      vgl->tex_type == GL_UNSIGNED_SHORT ? dither_glsl : "") < 0)
         code = NULL;
 
     for (int i = 0; i < 4; i++) {
@@ -505,6 +625,25 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
         supports_shaders = false;
 #endif
 
+#ifdef SUPPORTS_PBO
+    vgl->BufferStorage  = (PFNGLBUFFERSTORAGEPROC)vlc_gl_GetProcAddress(vgl->gl, "glBufferStorage");
+    vgl->MapBufferRange = (PFNGLMAPBUFFERRANGEPROC)vlc_gl_GetProcAddress(vgl->gl, "glMapBufferRange");
+    vgl->UnmapBuffer    = (PFNGLUNMAPBUFFERPROC)vlc_gl_GetProcAddress(vgl->gl, "glUnmapBuffer");
+    vgl->FenceSync      = (PFNGLFENCESYNCPROC)vlc_gl_GetProcAddress(vgl->gl, "glFenceSync");
+    vgl->ClientWaitSync = (PFNGLCLIENTWAITSYNCPROC)vlc_gl_GetProcAddress(vgl->gl, "glClientWaitSync");
+    vgl->DeleteSync     = (PFNGLDELETESYNCPROC)vlc_gl_GetProcAddress(vgl->gl, "glDeleteSync");
+
+    vgl->supports_pbo = supports_shaders
+        && (strverscmp((const char *)ogl_version, "2.1") >= 0
+         || HasExtension(extensions, "GL_ARB_pixel_buffer_object"))
+        && vgl->MapBufferRange != NULL && vgl->UnmapBuffer != NULL;
+    vgl->supports_persistent = vgl->supports_pbo
+        && (strverscmp((const char *)ogl_version, "4.4") >= 0
+         || HasExtension(extensions, "GL_ARB_buffer_storage"))
+        && vgl->BufferStorage != NULL && vgl->FenceSync != NULL
+        && vgl->ClientWaitSync != NULL && vgl->DeleteSync != NULL;
+#endif
+
 #if defined(_WIN32)
     vgl->ActiveTexture = (PFNGLACTIVETEXTUREPROC)vlc_gl_GetProcAddress(vgl->gl, "glActiveTexture");
     vgl->ClientActiveTexture = (PFNGLCLIENTACTIVETEXTUREPROC)vlc_gl_GetProcAddress(vgl->gl, "glClientActiveTexture");
@@ -555,6 +694,18 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
     bool need_fs_rgba = USE_OPENGL_ES == 2;
     float yuv_range_correction = 1.0;
 
+#ifdef HAVE_GL_VAAPI
+    if (fmt->i_chroma == VLC_CODEC_VAAPI_420 && supports_shaders
+     && max_texture_units >= 2)
+        vgl->vaapi = vlc_gl_vaapi_New(vgl->gl, extensions);
+    if (vgl->vaapi != NULL) {
+        need_fs_yuv       = true;
+        vgl->fmt          = *fmt;
+        vgl->tex_format   = GL_LUMINANCE;
+        vgl->tex_internal = GL_LUMINANCE;
+        vgl->tex_type     = GL_UNSIGNED_BYTE;
+    } else
+#endif
     if (max_texture_units >= 3 && supports_shaders && vlc_fourcc_IsYUV(fmt->i_chroma)) {
         const vlc_fourcc_t *list = vlc_fourcc_GetYUVFallback(fmt->i_chroma);
         while (*list) {
@@ -579,6 +730,18 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
                 vgl->tex_type     = GL_UNSIGNED_SHORT;
                 yuv_range_correction = (float)((1 << 16) - 1) / ((1 << dsc->pixel_bits) - 1);
                 break;
+#ifdef GL_R16
+            } else if (dsc && dsc->plane_count == 3 && dsc->pixel_size == 2 &&
+                       IsRed16Supported(vgl->tex_target, extensions)) {
+                need_fs_yuv       = true;
+                vgl->fmt          = *fmt;
+                vgl->fmt.i_chroma = *list;
+                vgl->tex_format   = GL_RED;
+                vgl->tex_internal = GL_R16;
+                vgl->tex_type     = GL_UNSIGNED_SHORT;
+                yuv_range_correction = (float)((1 << 16) - 1) / ((1 << dsc->pixel_bits) - 1);
+                break;
+#endif
 #endif
             }
             list++;
@@ -594,7 +757,15 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
         vgl->tex_type     = GL_UNSIGNED_SHORT;
     }
     vgl->chroma = vlc_fourcc_GetChromaDescription(vgl->fmt.i_chroma);
+#ifdef HAVE_GL_VAAPI
+    if (vgl->vaapi != NULL)
+        vgl->chroma = &vaapi_chroma;
+#endif
     assert(vgl->chroma != NULL);
+#if defined(SUPPORTS_PBO) && defined(HAVE_GL_VAAPI)
+    if (vgl->vaapi != NULL)
+        vgl->supports_persistent = false;
+#endif
     vgl->use_multitexture = vgl->chroma->plane_count > 1;
 
     /* Texture size */
@@ -701,6 +872,10 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
     vgl->subpicture_buffer_object_count = subpicture_buffer_object_count;
     vgl->GenBuffers(vgl->subpicture_buffer_object_count, vgl->subpicture_buffer_object);
 #endif
+#ifdef SUPPORTS_PBO
+    if (vgl->supports_pbo)
+        vgl->GenBuffers(VLCGL_PBO_COUNT, vgl->stream_buffer);
+#endif
 
     vlc_gl_Unlock(vgl->gl);
 
@@ -720,6 +895,109 @@ vout_display_opengl_t *vout_display_opengl_New(video_format_t *fmt,
     return vgl;
 }
 
+#ifdef SUPPORTS_PBO
+/* Gives the pictures back to the pool once the GPU is done copying them,
+ * or waits for the GPU if all is set. The GL context must be current. */
+static void ReleaseHeldPictures(vout_display_opengl_t *vgl, bool all)
+{
+    while (vgl->held_count > 0) {
+        gl_pbo_held_t *held = &vgl->held[vgl->held_first];
+        GLenum ret = vgl->ClientWaitSync(held->fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                         all ? GL_TIMEOUT_IGNORED : 0);
+        if (ret == GL_TIMEOUT_EXPIRED)
+            break; /* the next ones were queued after that one */
+
+        vgl->DeleteSync(held->fence);
+        picture_Release(held->picture);
+        vgl->held_first = (vgl->held_first + 1) % VLCGL_PICTURE_MAX;
+        vgl->held_count--;
+    }
+}
+
+/* Allocates pictures in persistently mapped pixel buffers, one per picture.
+ * The GL context must be current. */
+static unsigned NewMappedPictures(vout_display_opengl_t *vgl,
+                                  picture_t **picture, unsigned count)
+{
+    picture_t geometry;
+    size_t offset[PICTURE_PLANE_MAX];
+    size_t size = 0;
+
+    if (picture_Setup(&geometry, &vgl->fmt))
+        return 0;
+    for (int j = 0; j < geometry.i_planes; j++) {
+        offset[j] = size;
+        size += ALIGN(geometry.p[j].i_pitch * geometry.p[j].i_lines, 64);
+    }
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT
+                           | GL_MAP_COHERENT_BIT;
+    unsigned i;
+
+    vgl->GenBuffers(count, vgl->mapped_buffer);
+    for (i = 0; i < count; i++) {
+        picture_sys_t *picsys = malloc(sizeof (*picsys));
+        if (unlikely(picsys == NULL))
+            break;
+
+        picsys->buffer = vgl->mapped_buffer[i];
+        vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, picsys->buffer);
+        vgl->BufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+        picsys->base = vgl->MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                           flags);
+        if (picsys->base == NULL) {
+            free(picsys);
+            break;
+        }
+
+        picture_resource_t rsc = { .p_sys = picsys };
+
+        for (int j = 0; j < geometry.i_planes; j++) {
+            rsc.p[j].p_pixels = (uint8_t *)picsys->base + offset[j];
+            rsc.p[j].i_lines  = geometry.p[j].i_lines;
+            rsc.p[j].i_pitch  = geometry.p[j].i_pitch;
+        }
+
+        picture[i] = picture_NewFromResource(&vgl->fmt, &rsc);
+        if (picture[i] == NULL) {
+            free(picsys);
+            break;
+        }
+    }
+    vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (i < count)
+        vgl->DeleteBuffers(count - i, &vgl->mapped_buffer[i]);
+    vgl->mapped_count = i;
+    return i;
+}
+
+/* Copies pixels to a streaming buffer, and leaves it bound for the texture
+ * upload: the GPU then reads it asynchronously. Returns the pixels address
+ * to pass to glTexSubImage2D() (i.e. an offset within the bound buffer). */
+static const uint8_t *StreamPixels(vout_display_opengl_t *vgl,
+                                   const uint8_t *pixels, int pitch,
+                                   int width, int height, int pixel_pitch)
+{
+    size_t size = pitch * (height - 1) + width * pixel_pitch;
+
+    vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, vgl->stream_buffer[vgl->stream_index]);
+    vgl->stream_index = (vgl->stream_index + 1) % VLCGL_PBO_COUNT;
+
+    /* Orphan the previous storage, which the GPU may still be reading */
+    vgl->BufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    void *dst = vgl->MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (dst == NULL) {
+        vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return pixels;
+    }
+    memcpy(dst, pixels, size);
+    vgl->UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    return NULL;
+}
+#endif
+
 void vout_display_opengl_Delete(vout_display_opengl_t *vgl)
 {
     /* */
@@ -731,6 +1009,8 @@ void vout_display_opengl_Delete(vout_display_opengl_t *vgl)
         for (int i = 0; i < vgl->region_count; i++) {
             if (vgl->region[i].texture)
                 glDeleteTextures(1, &vgl->region[i].texture);
+            if (vgl->region[i].picture)
+                picture_Release(vgl->region[i].picture);
         }
         free(vgl->region);
 
@@ -747,8 +1027,20 @@ void vout_display_opengl_Delete(vout_display_opengl_t *vgl)
             vgl->DeleteBuffers(vgl->subpicture_buffer_object_count, vgl->subpicture_buffer_object);
         free(vgl->subpicture_buffer_object);
 #endif
+#ifdef SUPPORTS_PBO
+        ReleaseHeldPictures(vgl, true);
+        if (vgl->supports_pbo)
+            vgl->DeleteBuffers(VLCGL_PBO_COUNT, vgl->stream_buffer);
+        /* The pool pictures are not used anymore */
+        if (vgl->mapped_count > 0)
+            vgl->DeleteBuffers(vgl->mapped_count, vgl->mapped_buffer);
+#endif
 
         free(vgl->texture_temp_buf);
+#ifdef HAVE_GL_VAAPI
+        if (vgl->vaapi != NULL)
+            vlc_gl_vaapi_Delete(vgl->vaapi);
+#endif
         vlc_gl_Unlock(vgl->gl);
     }
     if (vgl->pool)
@@ -763,9 +1055,16 @@ picture_pool_t *vout_display_opengl_GetPool(vout_display_opengl_t *vgl, unsigned
 
     /* Allocate our pictures */
     picture_t *picture[VLCGL_PICTURE_MAX] = {NULL, };
-    unsigned count;
+    unsigned count = 0;
 
-    for (count = 0; count < __MIN(VLCGL_PICTURE_MAX, requested_count); count++) {
+    requested_count = __MIN(VLCGL_PICTURE_MAX, requested_count);
+#ifdef SUPPORTS_PBO
+    if (vgl->supports_persistent && !vlc_gl_Lock(vgl->gl)) {
+        count = NewMappedPictures(vgl, picture, requested_count);
+        vlc_gl_Unlock(vgl->gl);
+    }
+#endif
+    for (; count < requested_count; count++) {
         picture[count] = picture_NewFromFormat(&vgl->fmt);
         if (!picture[count])
             break;
@@ -802,6 +1101,11 @@ picture_pool_t *vout_display_opengl_GetPool(vout_display_opengl_t *vgl, unsigned
             glTexParameteri(vgl->tex_target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
             glTexParameteri(vgl->tex_target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
+#ifdef HAVE_GL_VAAPI
+            /* The storage comes from the VA surfaces */
+            if (vgl->vaapi != NULL)
+                continue;
+#endif
             /* Call glTexImage2D only once, and use glTexSubImage2D later */
             glTexImage2D(vgl->tex_target, 0,
                          vgl->tex_internal, vgl->tex_width[j], vgl->tex_height[j],
@@ -819,7 +1123,6 @@ error:
     return NULL;
 }
 
-#define ALIGN(x, y) (((x) + ((y) - 1)) & ~((y) - 1))
 static void Upload(vout_display_opengl_t *vgl, int in_width, int in_height,
                    int in_full_width, int in_full_height,
                    int w_num, int w_den, int h_num, int h_den,
@@ -890,18 +1193,73 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
     if (vlc_gl_Lock(vgl->gl))
         return VLC_EGENERIC;
 
+#ifdef HAVE_GL_VAAPI
+    if (vgl->vaapi != NULL) {
+        if (vlc_gl_vaapi_Bind(vgl->vaapi, picture, vgl->texture[0],
+                              vgl->tex_width, vgl->tex_height)) {
+            vlc_gl_Unlock(vgl->gl);
+            return VLC_EGENERIC;
+        }
+    } else
+#endif
+    {
+#ifdef SUPPORTS_PBO
+    /* Pool pictures are already in pixel buffers */
+    picture_sys_t *picsys = NULL;
+    if (vgl->supports_persistent) {
+        ReleaseHeldPictures(vgl, false);
+        picsys = picture->p_sys;
+    }
+    if (picsys != NULL)
+        vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, picsys->buffer);
+#endif
     /* Update the texture */
     for (unsigned j = 0; j < vgl->chroma->plane_count; j++) {
+        const uint8_t *pixels = picture->p[j].p_pixels;
+
         if (vgl->use_multitexture) {
             glActiveTexture(GL_TEXTURE0 + j);
             glClientActiveTexture(GL_TEXTURE0 + j);
         }
         glBindTexture(vgl->tex_target, vgl->texture[0][j]);
 
+#ifdef SUPPORTS_PBO
+        if (picsys != NULL)
+            pixels = (const uint8_t *)(uintptr_t)(pixels - picsys->base);
+        else if (vgl->supports_pbo)
+            pixels = StreamPixels(vgl, pixels, picture->p[j].i_pitch,
+                picture->format.i_visible_width * vgl->chroma->p[j].w.num / vgl->chroma->p[j].w.den,
+                vgl->fmt.i_visible_height * vgl->chroma->p[j].h.num / vgl->chroma->p[j].h.den,
+                picture->p[j].i_pixel_pitch);
+#endif
         Upload(vgl, picture->format.i_visible_width, vgl->fmt.i_visible_height,
                vgl->fmt.i_width, vgl->fmt.i_height,
                vgl->chroma->p[j].w.num, vgl->chroma->p[j].w.den, vgl->chroma->p[j].h.num, vgl->chroma->p[j].h.den,
-               picture->p[j].i_pitch, picture->p[j].i_pixel_pitch, 0, picture->p[j].p_pixels, vgl->tex_target, vgl->tex_format, vgl->tex_type);
+               picture->p[j].i_pitch, picture->p[j].i_pixel_pitch, 0, pixels, vgl->tex_target, vgl->tex_format, vgl->tex_type);
+#ifdef SUPPORTS_PBO
+        if (picsys == NULL && vgl->supports_pbo)
+            vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+#endif
+    }
+#ifdef SUPPORTS_PBO
+    if (picsys != NULL) {
+        vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        /* Keep the picture out of the pool until the GPU has copied it */
+        if (vgl->held_count == VLCGL_PICTURE_MAX)
+            ReleaseHeldPictures(vgl, true);
+
+        GLsync fence = vgl->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        if (fence != NULL) {
+            gl_pbo_held_t *held = &vgl->held[(vgl->held_first + vgl->held_count)
+                                             % VLCGL_PICTURE_MAX];
+            held->picture = picture_Hold(picture);
+            held->fence = fence;
+            vgl->held_count++;
+        } else
+            glFinish();
+    }
+#endif
     }
 
     int         last_count = vgl->region_count;
@@ -947,6 +1305,29 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
             glr->bottom = -2.0 * (r->i_y + r->fmt.i_visible_height) / subpicture->i_original_picture_height + 1.0;
 
             glr->texture = 0;
+            glr->picture = picture_Hold(r->p_picture);
+            glr->x_offset = r->fmt.i_x_offset;
+            glr->y_offset = r->fmt.i_y_offset;
+
+            /* Reuse the texture as is, if it holds the same rendering */
+            bool uploaded = false;
+            for (int j = 0; j < last_count; j++) {
+                if (last[j].texture &&
+                    last[j].picture  == glr->picture &&
+                    last[j].x_offset == glr->x_offset &&
+                    last[j].y_offset == glr->y_offset &&
+                    last[j].width    == glr->width &&
+                    last[j].height   == glr->height) {
+                    glr->texture = last[j].texture;
+                    picture_Release(last[j].picture);
+                    memset(&last[j], 0, sizeof(last[j]));
+                    uploaded = true;
+                    break;
+                }
+            }
+            if (uploaded)
+                continue;
+
             /* Try to recycle the textures allocated by the previous
                call to this function. */
             for (int j = 0; j < last_count; j++) {
@@ -956,6 +1337,7 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
                     last[j].format == glr->format &&
                     last[j].type   == glr->type) {
                     glr->texture = last[j].texture;
+                    picture_Release(last[j].picture);
                     memset(&last[j], 0, sizeof(last[j]));
                     break;
                 }
@@ -963,12 +1345,23 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
 
             const int pixels_offset = r->fmt.i_y_offset * r->p_picture->p->i_pitch +
                                       r->fmt.i_x_offset * r->p_picture->p->i_pixel_pitch;
+            const uint8_t *pixels = &r->p_picture->p->p_pixels[pixels_offset];
+#ifdef SUPPORTS_PBO
+            /* A new texture is allocated as large as the uploaded pixels,
+             * which the pixel buffer must hold, only if NPOT is supported */
+            const bool streamed = vgl->supports_pbo
+                               && (glr->texture || vgl->supports_npot);
+            if (streamed)
+                pixels = StreamPixels(vgl, pixels, r->p_picture->p->i_pitch,
+                                      r->fmt.i_visible_width, r->fmt.i_visible_height,
+                                      r->p_picture->p->i_pixel_pitch);
+#endif
             if (glr->texture) {
                 /* A texture was successfully recycled, reuse it. */
                 glBindTexture(GL_TEXTURE_2D, glr->texture);
                 Upload(vgl, r->fmt.i_visible_width, r->fmt.i_visible_height, glr->width, glr->height, 1, 1, 1, 1,
                        r->p_picture->p->i_pitch, r->p_picture->p->i_pixel_pitch, 0,
-                       &r->p_picture->p->p_pixels[pixels_offset], GL_TEXTURE_2D, glr->format, glr->type);
+                       pixels, GL_TEXTURE_2D, glr->format, glr->type);
             } else {
                 /* Could not recycle a previous texture, generate a new one. */
                 glGenTextures(1, &glr->texture);
@@ -983,13 +1376,19 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
                 Upload(vgl, r->fmt.i_visible_width, r->fmt.i_visible_height, glr->width, glr->height, 1, 1, 1, 1,
                        r->p_picture->p->i_pitch, r->p_picture->p->i_pixel_pitch, 1,
-                       &r->p_picture->p->p_pixels[pixels_offset], GL_TEXTURE_2D, glr->format, glr->type);
+                       pixels, GL_TEXTURE_2D, glr->format, glr->type);
             }
+#ifdef SUPPORTS_PBO
+            if (streamed)
+                vgl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+#endif
         }
     }
     for (int i = 0; i < last_count; i++) {
         if (last[i].texture)
             glDeleteTextures(1, &last[i].texture);
+        if (last[i].picture)
+            picture_Release(last[i].picture);
     }
     free(last);
 
@@ -1124,11 +1523,12 @@ static void DrawWithShaders(vout_display_opengl_t *vgl,
 {
     vgl->UseProgram(vgl->program[program]);
     if (program == 0) {
-        if (vgl->chroma->plane_count == 3) {
+        if (vgl->chroma->plane_count >= 2) {
             vgl->Uniform4fv(vgl->GetUniformLocation(vgl->program[0], "Coefficient"), 4, vgl->local_value);
             vgl->Uniform1i(vgl->GetUniformLocation(vgl->program[0], "Texture0"), 0);
             vgl->Uniform1i(vgl->GetUniformLocation(vgl->program[0], "Texture1"), 1);
-            vgl->Uniform1i(vgl->GetUniformLocation(vgl->program[0], "Texture2"), 2);
+            if (vgl->chroma->plane_count == 3)
+                vgl->Uniform1i(vgl->GetUniformLocation(vgl->program[0], "Texture2"), 2);
         }
         else if (vgl->chroma->plane_count == 1) {
             vgl->Uniform1i(vgl->GetUniformLocation(vgl->program[0], "Texture0"), 0);
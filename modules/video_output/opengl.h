@@ -94,4 +94,14 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
 int vout_display_opengl_Display(vout_display_opengl_t *vgl,
                                 const video_format_t *source);
 
+#ifdef HAVE_GL_VAAPI
+/* VA-API surfaces import (EGL only) */
+typedef struct vlc_gl_vaapi_t vlc_gl_vaapi_t;
+
+vlc_gl_vaapi_t *vlc_gl_vaapi_New(vlc_gl_t *gl, const char *extensions);
+void vlc_gl_vaapi_Delete(vlc_gl_vaapi_t *);
+int vlc_gl_vaapi_Bind(vlc_gl_vaapi_t *, picture_t *, const GLuint textures[2],
+                      const int widths[2], const int heights[2]);
+#endif
+
 #endif
@@ -0,0 +1,151 @@
+/*****************************************************************************
+ * opengl_vaapi.c: VA-API surfaces import into OpenGL textures
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "opengl.h"
+#include "../hw/vaapi/vlc_vaapi.h"
+
+/* The NV12 surface planes are imported as EGL images through their DMA
+ * buffer, which requires no copy: the luma plane as a one-component texture,
+ * the chroma plane as a two-component texture. */
+
+#ifndef DRM_FORMAT_R8
+# define DRM_FORMAT_R8   VLC_FOURCC('R', '8', ' ', ' ')
+#endif
+#ifndef DRM_FORMAT_GR88
+# define DRM_FORMAT_GR88 VLC_FOURCC('G', 'R', '8', '8')
+#endif
+
+typedef void (*vlc_egl_image_target_texture_2d_t)(GLenum, void *);
+
+struct vlc_gl_vaapi_t
+{
+    vlc_gl_t *gl;
+    vlc_egl_image_target_texture_2d_t EGLImageTargetTexture2DOES;
+    picture_t *current; /* picture bound to the textures */
+};
+
+vlc_gl_vaapi_t *vlc_gl_vaapi_New(vlc_gl_t *gl, const char *extensions)
+{
+#if VA_CHECK_VERSION(0, 36, 0)
+    if (gl->ext != VLC_GL_EXT_EGL || gl->egl.createImageKHR == NULL)
+        return NULL;
+
+    const char *eglexts = gl->egl.queryString(gl, EGL_EXTENSIONS);
+    if (!HasExtension(eglexts, "EGL_EXT_image_dma_buf_import")
+     || !HasExtension(extensions, "GL_OES_EGL_image"))
+        return NULL;
+
+    vlc_gl_vaapi_t *vaapi = malloc(sizeof (*vaapi));
+    if (unlikely(vaapi == NULL))
+        return NULL;
+
+    vaapi->EGLImageTargetTexture2DOES =
+        vlc_gl_GetProcAddress(gl, "glEGLImageTargetTexture2DOES");
+    if (vaapi->EGLImageTargetTexture2DOES == NULL)
+    {
+        free(vaapi);
+        return NULL;
+    }
+    vaapi->gl = gl;
+    vaapi->current = NULL;
+    return vaapi;
+#else
+    (void) gl; (void) extensions;
+    return NULL;
+#endif
+}
+
+void vlc_gl_vaapi_Delete(vlc_gl_vaapi_t *vaapi)
+{
+    if (vaapi->current != NULL)
+        picture_Release(vaapi->current);
+    free(vaapi);
+}
+
+int vlc_gl_vaapi_Bind(vlc_gl_vaapi_t *vaapi, picture_t *pic,
+                      const GLuint textures[2],
+                      const int widths[2], const int heights[2])
+{
+#if VA_CHECK_VERSION(0, 36, 0)
+    vlc_gl_t *gl = vaapi->gl;
+    vlc_vaapi_surface_t *surface = vlc_vaapi_PictureGetSurface(pic);
+    VABufferInfo info = { .mem_type = VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME };
+    VAImage image;
+    int ret = VLC_EGENERIC;
+
+    if (unlikely(surface == NULL))
+        return VLC_EGENERIC;
+    if (vaDeriveImage(surface->display, surface->id, &image))
+        return VLC_EGENERIC;
+    if (image.format.fourcc != VA_FOURCC_NV12
+     || vaAcquireBufferHandle(surface->display, image.buf, &info))
+        goto out;
+
+    for (unsigned i = 0; i < 2; i++)
+    {
+        const EGLint attribs[] = {
+            EGL_WIDTH, widths[i],
+            EGL_HEIGHT, heights[i],
+            EGL_LINUX_DRM_FOURCC_EXT, i == 0 ? DRM_FORMAT_R8 : DRM_FORMAT_GR88,
+            EGL_DMA_BUF_PLANE0_FD_EXT, info.handle,
+            EGL_DMA_BUF_PLANE0_OFFSET_EXT, image.offsets[i],
+            EGL_DMA_BUF_PLANE0_PITCH_EXT, image.pitches[i],
+            EGL_NONE
+        };
+        void *egl_image = gl->egl.createImageKHR(gl, EGL_LINUX_DMA_BUF_EXT,
+                                                 NULL, attribs);
+        if (egl_image == NULL)
+            goto release;
+
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        vaapi->EGLImageTargetTexture2DOES(GL_TEXTURE_2D, egl_image);
+        /* The texture keeps a reference to the buffer */
+        gl->egl.destroyImageKHR(gl, egl_image);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    /* Do not let the decoder overwrite the surface while it is displayed */
+    if (vaapi->current != NULL)
+        picture_Release(vaapi->current);
+    vaapi->current = picture_Hold(pic);
+    ret = VLC_SUCCESS;
+release:
+    vaReleaseBufferHandle(surface->display, image.buf);
+out:
+    vaDestroyImage(surface->display, image.image_id);
+    return ret;
+#else
+    (void) vaapi; (void) pic; (void) textures; (void) widths; (void) heights;
+    return VLC_EGENERIC;
+#endif
+}
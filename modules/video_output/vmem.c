@@ -35,6 +35,7 @@
 #include <vlc_plugin.h>
 #include <vlc_vout_display.h>
 #include <vlc_picture_pool.h>
+#include <vlc_atomic.h>
 
 /*****************************************************************************
  * Module descriptor
@@ -48,6 +49,10 @@
 #define T_PITCH N_("Pitch")
 #define LT_PITCH N_("Video memory buffer pitch in bytes.")
 
+#define T_DIRECT N_("Direct rendering")
+#define LT_DIRECT N_("Let the decoder write in the application pictures " \
+                     "(asynchronous mode only).")
+
 #define T_CHROMA N_("Chroma")
 #define LT_CHROMA N_("Output chroma for the memory image as a 4-character " \
                       "string, eg. \"RV32\".")
@@ -71,6 +76,8 @@ vlc_module_begin()
         change_private()
     add_string("vmem-chroma", "RV16", T_CHROMA, LT_CHROMA, true)
         change_private()
+    add_bool("vmem-direct", false, T_DIRECT, LT_DIRECT, true)
+        change_private()
     add_obsolete_string("vmem-lock") /* obsoleted since 1.1.1 */
     add_obsolete_string("vmem-unlock") /* obsoleted since 1.1.1 */
     add_obsolete_string("vmem-data") /* obsoleted since 1.1.1 */
@@ -97,6 +104,14 @@ struct vout_display_sys_t {
     void (*display)(void *sys, void *id);
     void (*cleanup)(void *sys);
 
+    /* Asynchronous mode: the application keeps the displayed pictures until
+     * it releases them, possibly after the display is closed. */
+    void *(*alloc)(void *sys, void **plane);
+    void (*destroy)(void *sys, void *id);
+    void (*present)(void *sys, void *id, void *const *plane, void *frame);
+    bool direct;
+    atomic_uint refs; /* display and pictures */
+
     unsigned pitches[PICTURE_PLANE_MAX];
     unsigned lines[PICTURE_PLANE_MAX];
 };
@@ -137,6 +152,30 @@ static void Unlock(void *data, picture_t *pic)
 
 }
 
+static void Release(vout_display_sys_t *sys)
+{
+    if (atomic_fetch_sub(&sys->refs, 1) != 1)
+        return;
+
+    if (sys->cleanup)
+        sys->cleanup(sys->opaque);
+    free(sys);
+}
+
+/* Destroys an asynchronous picture, once neither the pool nor the
+ * application refer to it */
+static void AsyncDestroy(picture_t *pic)
+{
+    picture_sys_t *picsys = pic->p_sys;
+    vout_display_sys_t *sys = picsys->sys;
+
+    if (sys->destroy != NULL)
+        sys->destroy(sys->opaque, picsys->id);
+    free(picsys);
+    free(pic);
+    Release(sys);
+}
+
 /*****************************************************************************
  * Open: allocates video thread
  *****************************************************************************
@@ -153,8 +192,13 @@ static int Open(vlc_object_t *object)
     vlc_format_cb setup = var_InheritAddress(vd, "vmem-setup");
 
     sys->lock = var_InheritAddress(vd, "vmem-lock");
-    if (sys->lock == NULL) {
-        msg_Err(vd, "missing lock callback");
+    sys->alloc = var_InheritAddress(vd, "vmem-alloc");
+    sys->destroy = var_InheritAddress(vd, "vmem-free");
+    sys->present = var_InheritAddress(vd, "vmem-present");
+    sys->direct = sys->present != NULL && var_InheritBool(vd, "vmem-direct");
+    atomic_init(&sys->refs, 1);
+    if (sys->present != NULL ? sys->alloc == NULL : sys->lock == NULL) {
+        msg_Err(vd, "missing %s callback", sys->present ? "alloc" : "lock");
         free(sys);
         return VLC_EGENERIC;
     }
@@ -264,6 +308,14 @@ static void Close(vlc_object_t *object)
     vout_display_t *vd = (vout_display_t *)object;
     vout_display_sys_t *sys = vd->sys;
 
+    if (sys->present != NULL) {
+        /* The pictures still held by the application keep sys alive */
+        if (sys->pool != NULL)
+            picture_pool_Release(sys->pool);
+        Release(sys);
+        return;
+    }
+
     if (sys->cleanup)
         sys->cleanup(sys->opaque);
 
@@ -272,12 +324,69 @@ static void Close(vlc_object_t *object)
     free(sys);
 }
 
+static picture_pool_t *AsyncPool(vout_display_t *vd, unsigned count)
+{
+    vout_display_sys_t *sys = vd->sys;
+
+    /* With direct rendering, the pool is large enough for the decoder to
+     * render in it, otherwise the video output copies into it. */
+    if (!sys->direct || count < sys->count)
+        count = sys->count;
+
+    picture_t *pictures[count];
+
+    for (unsigned i = 0; i < count; i++) {
+        picture_sys_t *picsys = malloc(sizeof (*picsys));
+        if (unlikely(picsys == NULL))
+        {
+            count = i;
+            break;
+        }
+
+        void *planes[PICTURE_PLANE_MAX] = { NULL };
+
+        picsys->sys = sys;
+        picsys->id = sys->alloc(sys->opaque, planes);
+
+        picture_resource_t rsc = {
+            .p_sys = picsys,
+            .pf_destroy = AsyncDestroy,
+        };
+
+        for (unsigned j = 0; j < PICTURE_PLANE_MAX; j++) {
+            rsc.p[j].p_pixels = planes[j];
+            rsc.p[j].i_lines  = sys->lines[j];
+            rsc.p[j].i_pitch  = sys->pitches[j];
+        }
+
+        atomic_fetch_add(&sys->refs, 1);
+        pictures[i] = picture_NewFromResource(&vd->fmt, &rsc);
+        if (!pictures[i]) {
+            if (sys->destroy != NULL)
+                sys->destroy(sys->opaque, picsys->id);
+            free(picsys);
+            Release(sys);
+            count = i;
+            break;
+        }
+    }
+
+    sys->pool = picture_pool_New(count, pictures);
+    if (!sys->pool) {
+        for (unsigned i = 0; i < count; i++)
+            picture_Release(pictures[i]);
+    }
+    return sys->pool;
+}
+
 static picture_pool_t *Pool(vout_display_t *vd, unsigned count)
 {
     vout_display_sys_t *sys = vd->sys;
 
     if (sys->pool)
         return sys->pool;
+    if (sys->present != NULL)
+        return AsyncPool(vd, count);
 
     if (count > sys->count)
         count = sys->count;
@@ -324,7 +433,8 @@ static picture_pool_t *Pool(vout_display_t *vd, unsigned count)
 
 static void Prepare(vout_display_t *vd, picture_t *pic, subpicture_t *subpic)
 {
-    Unlock(vd->sys, pic);
+    if (vd->sys->present == NULL)
+        Unlock(vd->sys, pic);
     VLC_UNUSED(subpic);
 }
 
@@ -333,6 +443,18 @@ static void Display(vout_display_t *vd, picture_t *pic, subpicture_t *subpic)
 {
     vout_display_sys_t *sys = vd->sys;
 
+    if (sys->present != NULL) {
+        void *planes[PICTURE_PLANE_MAX];
+
+        for (int i = 0; i < pic->i_planes; i++)
+            planes[i] = pic->p[i].p_pixels;
+
+        /* The application releases the picture when done with it */
+        sys->present(sys->opaque, pic->p_sys->id, planes, pic);
+        VLC_UNUSED(subpic);
+        return;
+    }
+
     if (sys->display != NULL)
         sys->display(sys->opaque, pic->p_sys->id);
 
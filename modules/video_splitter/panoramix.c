@@ -38,6 +38,9 @@
 
 /* FIXME it is needed for VOUT_ALIGN_* only */
 #include <vlc_vout.h>
+#include <vlc_cpu.h>
+
+#include "../video_filter/bands.h"
 
 #define OVERLAP
 
@@ -176,6 +179,11 @@ vlc_module_begin()
 #endif
 
     add_string( CFG_PREFIX "active", NULL, ACTIVE_TEXT, ACTIVE_LONGTEXT, true )
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads rendering the windows " \
+    "(0 for one per CPU).")
+    add_integer_with_range( CFG_PREFIX "threads", 0, 0, BANDS_THREADS_MAX,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
 
     add_shortcut( "panoramix" )
     set_callbacks( Open, Close )
@@ -192,7 +200,7 @@ static const char *const ppsz_filter_options[] = {
     "bz-blackcrush-green", "bz-blackcrush-blue", "bz-whitecrush-red",
     "bz-whitecrush-green", "bz-whitecrush-blue", "bz-blacklevel-red",
     "bz-blacklevel-green", "bz-blacklevel-blue", "bz-whitelevel-red",
-    "bz-whitelevel-green", "bz-whitelevel-blue", "active",
+    "bz-whitelevel-green", "bz-whitelevel-blue", "active", "threads",
     NULL
 };
 
@@ -296,6 +304,10 @@ struct video_splitter_sys_t
     int i_col;
     int i_row;
     panoramix_output_t pp_output[COL_MAX][ROW_MAX]; /* [x][y] */
+
+    bands_sys_t bands;
+    int i_tiles;
+    const panoramix_output_t *pp_tiles[COL_MAX * ROW_MAX]; /* active outputs */
 };
 
 /* */
@@ -694,6 +706,17 @@ static int Open( vlc_object_t *p_this )
     }
 
 
+    p_sys->i_tiles = 0;
+    for( int y = 0; y < p_sys->i_row; y++ )
+        for( int x = 0; x < p_sys->i_col; x++ )
+            if( p_sys->pp_output[x][y].b_active )
+                p_sys->pp_tiles[p_sys->i_tiles++] = &p_sys->pp_output[x][y];
+
+    unsigned i_threads = var_InheritInteger( p_splitter, CFG_PREFIX "threads" );
+    if( i_threads == 0 )
+        i_threads = vlc_GetCPUCount();
+    BandsInit( &p_sys->bands, VLC_CLIP( i_threads, 1, (unsigned)p_sys->i_tiles ) );
+
     /* */
     p_splitter->pf_filter = Filter;
     p_splitter->pf_mouse  = Mouse;
@@ -709,10 +732,76 @@ static void Close( vlc_object_t *p_this )
     video_splitter_t *p_splitter = (video_splitter_t*)p_this;
     video_splitter_sys_t *p_sys = p_splitter->p_sys;
 
+    BandsClean( &p_sys->bands );
     free( p_splitter->p_output );
     free( p_sys );
 }
 
+typedef struct
+{
+    video_splitter_sys_t *p_sys;
+    picture_t           **pp_dst;
+    picture_t            *p_src;
+} panoramix_job_t;
+
+/**
+ * It renders one window, with its blended zones
+ */
+static void RenderTile( void *p_opaque, unsigned i_tile, unsigned i_tiles )
+{
+    panoramix_job_t *p_job = p_opaque;
+    video_splitter_sys_t *p_sys = p_job->p_sys;
+    picture_t *p_src = p_job->p_src;
+    const panoramix_output_t *p_output = p_sys->pp_tiles[i_tile];
+
+    (void)i_tiles;
+
+    /* */
+    picture_t *p_dst = p_job->pp_dst[p_output->i_output];
+
+    /* */
+    picture_CopyProperties( p_dst, p_src );
+
+    /* */
+    for( int i_plane = 0; i_plane < p_src->i_planes; i_plane++ )
+    {
+        const int i_div_w = p_sys->p_chroma->pi_div_w[i_plane];
+        const int i_div_h = p_sys->p_chroma->pi_div_h[i_plane];
+
+        if( !i_div_w || !i_div_h )
+            continue;
+
+        const plane_t *p_srcp = &p_src->p[i_plane];
+        const plane_t *p_dstp = &p_dst->p[i_plane];
+
+        /* */
+        panoramix_filter_t filter;
+        filter.black.i_right  = p_output->filter.black.i_right / i_div_w;
+        filter.black.i_left   = p_output->filter.black.i_left / i_div_w;
+        filter.black.i_top    = p_output->filter.black.i_top / i_div_h;
+        filter.black.i_bottom = p_output->filter.black.i_bottom / i_div_h;
+
+        filter.attenuate.i_right  = p_output->filter.attenuate.i_right / i_div_w;
+        filter.attenuate.i_left   = p_output->filter.attenuate.i_left / i_div_w;
+        filter.attenuate.i_top    = p_output->filter.attenuate.i_top / i_div_h;
+        filter.attenuate.i_bottom = p_output->filter.attenuate.i_bottom / i_div_h;
+
+        /* */
+        const int i_x = p_output->i_src_x/i_div_w;
+        const int i_y = p_output->i_src_y/i_div_h;
+
+        assert( p_sys->p_chroma->b_planar );
+        FilterPlanar( p_dstp->p_pixels, p_dstp->i_pitch,
+                      &p_srcp->p_pixels[i_y * p_srcp->i_pitch + i_x * p_srcp->i_pixel_pitch], p_srcp->i_pitch,
+                      p_output->i_src_width/i_div_w, p_output->i_src_height/i_div_h,
+                      p_sys->p_chroma->pi_black[i_plane],
+                      &filter,
+                      p_sys->p_lut[i_plane],
+                      p_sys->lambdav[i_plane],
+                      p_sys->lambdah[i_plane] );
+    }
+}
+
 /**
  * It creates multiples pictures from the source one
  */
@@ -726,60 +815,9 @@ static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t
         return VLC_EGENERIC;
     }
 
-    for( int y = 0; y < p_sys->i_row; y++ )
-    {
-        for( int x = 0; x < p_sys->i_col; x++ )
-        {
-            const panoramix_output_t *p_output = &p_sys->pp_output[x][y];
-            if( !p_output->b_active )
-                continue;
-
-            /* */
-            picture_t *p_dst = pp_dst[p_output->i_output];
-
-            /* */
-            picture_CopyProperties( p_dst, p_src );
-
-            /* */
-            for( int i_plane = 0; i_plane < p_src->i_planes; i_plane++ )
-            {
-                const int i_div_w = p_sys->p_chroma->pi_div_w[i_plane];
-                const int i_div_h = p_sys->p_chroma->pi_div_h[i_plane];
-
-                if( !i_div_w || !i_div_h )
-                    continue;
-
-                const plane_t *p_srcp = &p_src->p[i_plane];
-                const plane_t *p_dstp = &p_dst->p[i_plane];
-
-                /* */
-                panoramix_filter_t filter;
-                filter.black.i_right  = p_output->filter.black.i_right / i_div_w;
-                filter.black.i_left   = p_output->filter.black.i_left / i_div_w;
-                filter.black.i_top    = p_output->filter.black.i_top / i_div_h;
-                filter.black.i_bottom = p_output->filter.black.i_bottom / i_div_h;
-
-                filter.attenuate.i_right  = p_output->filter.attenuate.i_right / i_div_w;
-                filter.attenuate.i_left   = p_output->filter.attenuate.i_left / i_div_w;
-                filter.attenuate.i_top    = p_output->filter.attenuate.i_top / i_div_h;
-                filter.attenuate.i_bottom = p_output->filter.attenuate.i_bottom / i_div_h;
-
-                /* */
-                const int i_x = p_output->i_src_x/i_div_w;
-                const int i_y = p_output->i_src_y/i_div_h;
-
-                assert( p_sys->p_chroma->b_planar );
-                FilterPlanar( p_dstp->p_pixels, p_dstp->i_pitch,
-                              &p_srcp->p_pixels[i_y * p_srcp->i_pitch + i_x * p_srcp->i_pixel_pitch], p_srcp->i_pitch,
-                              p_output->i_src_width/i_div_w, p_output->i_src_height/i_div_h,
-                              p_sys->p_chroma->pi_black[i_plane],
-                              &filter,
-                              p_sys->p_lut[i_plane],
-                              p_sys->lambdav[i_plane],
-                              p_sys->lambdah[i_plane] );
-            }
-        }
-    }
+    /* The windows are rendered in parallel */
+    panoramix_job_t job = { .p_sys = p_sys, .pp_dst = pp_dst, .p_src = p_src };
+    BandsRender( &p_sys->bands, RenderTile, &job, p_sys->i_tiles );
 
     picture_Release( p_src );
     return VLC_SUCCESS;
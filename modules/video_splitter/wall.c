@@ -36,6 +36,9 @@
 
 /* FIXME it is needed for VOUT_ALIGN_* only */
 #include <vlc_vout.h>
+#include <vlc_cpu.h>
+
+#include "../video_filter/bands.h"
 
 #define ROW_MAX (15)
 #define COL_MAX (15)
@@ -59,6 +62,15 @@
 #define ASPECT_LONGTEXT N_("Aspect ratio of the individual displays " \
    "building the wall.")
 
+#define CROP_TEXT N_("Crop without copying")
+#define CROP_LONGTEXT N_("The windows show the parts of the source picture " \
+    "as they are, instead of copies. This is faster when the video " \
+    "outputs convert the pictures anyway.")
+
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of threads copying the windows " \
+    "(0 for one per CPU).")
+
 #define CFG_PREFIX "wall-"
 
 static int  Open ( vlc_object_t * );
@@ -78,6 +90,9 @@ vlc_module_begin()
     add_string( CFG_PREFIX "active", NULL, ACTIVE_TEXT, ACTIVE_LONGTEXT,
                  true )
     add_string( CFG_PREFIX "element-aspect", "16:9", ASPECT_TEXT, ASPECT_LONGTEXT, false )
+    add_bool( CFG_PREFIX "crop", false, CROP_TEXT, CROP_LONGTEXT, true )
+    add_integer_with_range( CFG_PREFIX "threads", 0, 0, BANDS_THREADS_MAX,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
 
     add_shortcut( "wall" )
     set_callbacks( Open, Close )
@@ -87,7 +102,7 @@ vlc_module_end()
  * Local prototypes
  *****************************************************************************/
 static const char *const ppsz_filter_options[] = {
-    "cols", "rows", "active", "element-aspect", NULL
+    "cols", "rows", "active", "element-aspect", "crop", "threads", NULL
 };
 
 /* */
@@ -108,6 +123,11 @@ struct video_splitter_sys_t
     int           i_row;
     int           i_output;
     wall_output_t pp_output[COL_MAX][ROW_MAX]; /* [x][y] */
+
+    bool           b_crop;
+    bands_sys_t    bands;
+    int            i_tiles;
+    wall_output_t *pp_tiles[COL_MAX * ROW_MAX]; /* the active outputs */
 };
 
 static int Filter( video_splitter_t *, picture_t *pp_dst[], picture_t * );
@@ -368,6 +388,22 @@ static int Open( vlc_object_t *p_this )
         }
     }
 
+    p_sys->i_tiles = 0;
+    for( int y = 0; y < p_sys->i_row; y++ )
+        for( int x = 0; x < p_sys->i_col; x++ )
+            if( p_sys->pp_output[x][y].b_active )
+                p_sys->pp_tiles[p_sys->i_tiles++] = &p_sys->pp_output[x][y];
+
+    p_sys->b_crop = var_InheritBool( p_splitter, CFG_PREFIX "crop" );
+    p_splitter->b_source_ref = p_sys->b_crop;
+
+    unsigned i_threads = var_InheritInteger( p_splitter, CFG_PREFIX "threads" );
+    if( i_threads == 0 )
+        i_threads = vlc_GetCPUCount();
+    if( p_sys->b_crop )
+        i_threads = 1;
+    BandsInit( &p_sys->bands, VLC_CLIP( i_threads, 1, (unsigned)p_sys->i_tiles ) );
+
     /* */
     p_splitter->pf_filter = Filter;
     p_splitter->pf_mouse = Mouse;
@@ -383,45 +419,108 @@ static void Close( vlc_object_t *p_this )
     video_splitter_t *p_splitter = (video_splitter_t*)p_this;
     video_splitter_sys_t *p_sys = p_splitter->p_sys;
 
+    BandsClean( &p_sys->bands );
     free( p_splitter->p_output );
     free( p_sys );
 }
 
-static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t *p_src )
+/* Returns the offset of the window in the given plane of the source */
+static ptrdiff_t TileOffset( const picture_t *p_src, int i_plane,
+                             const wall_output_t *p_output, int *pi_lines )
 {
-    video_splitter_sys_t *p_sys = p_splitter->p_sys;
+    const plane_t *p0 = &p_src->p[0];
+    const plane_t *p = &p_src->p[i_plane];
+    const int i_y = p_output->i_top  * p->i_visible_pitch / p0->i_visible_pitch;
+    const int i_x = p_output->i_left * p->i_visible_lines / p0->i_visible_lines;
 
-    if( video_splitter_NewPicture( p_splitter, pp_dst ) )
+    *pi_lines = p->i_lines - i_y;
+    return i_y * p->i_pitch + ( i_x - (i_x % p->i_pixel_pitch));
+}
+
+typedef struct
+{
+    video_splitter_sys_t *p_sys;
+    picture_t           **pp_dst;
+    picture_t            *p_src;
+} wall_job_t;
+
+static void CopyTile( void *p_opaque, unsigned i_tile, unsigned i_tiles )
+{
+    wall_job_t *p_job = p_opaque;
+    const wall_output_t *p_output = p_job->p_sys->pp_tiles[i_tile];
+    picture_t tmp = *p_job->p_src;
+    int i_lines;
+
+    (void)i_tiles;
+    for( int i = 0; i < tmp.i_planes; i++ )
+        tmp.p[i].p_pixels += TileOffset( p_job->p_src, i, p_output, &i_lines );
+    picture_Copy( p_job->pp_dst[p_output->i_output], &tmp );
+}
+
+static void DestroyTile( picture_t *p_tile )
+{
+    picture_Release( (picture_t *)p_tile->p_sys );
+    free( p_tile );
+}
+
+/* Makes a picture of the window, referencing the source picture */
+static picture_t *CropTile( video_splitter_t *p_splitter,
+                            const wall_output_t *p_output, picture_t *p_src )
+{
+    picture_resource_t rsc = {
+        .p_sys = (picture_sys_t *)p_src,
+        .pf_destroy = DestroyTile,
+    };
+
+    for( int i = 0; i < p_src->i_planes; i++ )
     {
-        picture_Release( p_src );
-        return VLC_EGENERIC;
+        rsc.p[i].p_pixels = p_src->p[i].p_pixels
+                          + TileOffset( p_src, i, p_output, &rsc.p[i].i_lines );
+        rsc.p[i].i_pitch = p_src->p[i].i_pitch;
     }
 
-    for( int y = 0; y < p_sys->i_row; y++ )
+    picture_t *p_tile = picture_NewFromResource(
+                        &p_splitter->p_output[p_output->i_output].fmt, &rsc );
+    if( unlikely(p_tile == NULL) )
+        return NULL;
+    picture_Hold( p_src );
+    picture_CopyProperties( p_tile, p_src );
+    return p_tile;
+}
+
+static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t *p_src )
+{
+    video_splitter_sys_t *p_sys = p_splitter->p_sys;
+
+    if( p_sys->b_crop )
     {
-        for( int x = 0; x < p_sys->i_col; x++ )
+        for( int i = 0; i < p_sys->i_tiles; i++ )
         {
-            wall_output_t *p_output = &p_sys->pp_output[x][y];
-            if( !p_output->b_active )
-                continue;
-
-            picture_t *p_dst = pp_dst[p_output->i_output];
+            const wall_output_t *p_output = p_sys->pp_tiles[i];
 
-            /* */
-            picture_t tmp = *p_src;
-            for( int i = 0; i < tmp.i_planes; i++ )
+            pp_dst[p_output->i_output] = CropTile( p_splitter, p_output, p_src );
+            if( pp_dst[p_output->i_output] == NULL )
             {
-                plane_t *p0 = &tmp.p[0];
-                plane_t *p = &tmp.p[i];
-                const int i_y = p_output->i_top  * p->i_visible_pitch / p0->i_visible_pitch;
-                const int i_x = p_output->i_left * p->i_visible_lines / p0->i_visible_lines;
-
-                p->p_pixels += i_y * p->i_pitch + ( i_x - (i_x % p->i_pixel_pitch));
+                for( int j = 0; j < i; j++ )
+                    picture_Release( pp_dst[p_sys->pp_tiles[j]->i_output] );
+                picture_Release( p_src );
+                return VLC_ENOMEM;
             }
-            picture_Copy( p_dst, &tmp );
         }
+        picture_Release( p_src );
+        return VLC_SUCCESS;
+    }
+
+    if( video_splitter_NewPicture( p_splitter, pp_dst ) )
+    {
+        picture_Release( p_src );
+        return VLC_EGENERIC;
     }
 
+    /* The windows are copied in parallel */
+    wall_job_t job = { .p_sys = p_sys, .pp_dst = pp_dst, .p_src = p_src };
+    BandsRender( &p_sys->bands, CopyTile, &job, p_sys->i_tiles );
+
     picture_Release( p_src );
     return VLC_SUCCESS;
 }
@@ -79,8 +79,6 @@ struct filter_sys_t
     /* Audio data */
     unsigned i_channels;
     block_fifo_t    *fifo;
-    unsigned i_prev_nb_samples;
-    int16_t *p_prev_s16_buff;
 
     /* Opengl */
     vlc_gl_t *gl;
@@ -88,8 +86,9 @@ struct filter_sys_t
     float f_rotationAngle;
     float f_rotationIncrement;
 
-    /* FFT window parameters */
-    window_param wind_param;
+    /* FFT tables and window, computed once */
+    fft_state *p_state;
+    window_context wind_ctx;
 };
 
 
@@ -101,6 +100,8 @@ static void *Thread(void *);
 #define ROTATION_INCREMENT .1f
 #define BAR_DECREMENT .075f
 #define ROTATION_MAX 20
+/* Audio blocks queued for the rendering thread, beyond which they are dropped */
+#define MAX_BLOCKS 8
 
 const GLfloat lightZeroColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
 const GLfloat lightZeroPosition[] = {0.0f, 3.0f, 10.0f, 0.0f};
@@ -121,17 +122,26 @@ static int Open(vlc_object_t * p_this)
 
     /* Create the object for the thread */
     p_sys->i_channels = aout_FormatNbChannels(&p_filter->fmt_in.audio);
-    p_sys->i_prev_nb_samples = 0;
-    p_sys->p_prev_s16_buff = NULL;
 
     p_sys->f_rotationAngle = 0;
     p_sys->f_rotationIncrement = ROTATION_INCREMENT;
 
-    /* Fetch the FFT window parameters */
-    window_get_param( VLC_OBJECT( p_filter ), &p_sys->wind_param );
+    /* Compute the FFT tables and window */
+    window_param wind_param;
+    window_get_param( VLC_OBJECT( p_filter ), &wind_param );
+    p_sys->wind_ctx.pf_window_table = NULL;
+    p_sys->wind_ctx.i_buffer_size = 0;
+    p_sys->p_state = visual_fft_init();
+    if (p_sys->p_state == NULL
+     || !window_init(FFT_BUFFER_SIZE, &wind_param, &p_sys->wind_ctx))
+    {
+        msg_Err(p_filter,"unable to initialize FFT transform");
+        goto error;
+    }
 
-    /* Create the FIFO for the audio data. */
-    p_sys->fifo = block_FifoNew();
+    /* Create the FIFO for the audio data: only DoWork() puts, and only the
+     * thread gets. */
+    p_sys->fifo = block_FifoNewSPSC();
     if (p_sys->fifo == NULL)
         goto error;
 
@@ -160,6 +170,8 @@ static int Open(vlc_object_t * p_this)
     return VLC_SUCCESS;
 
 error:
+    window_close(&p_sys->wind_ctx);
+    fft_close(p_sys->p_state);
     free(p_sys);
     return VLC_EGENERIC;
 }
@@ -181,7 +193,8 @@ static void Close(vlc_object_t *p_this)
     /* Free the ressources */
     vlc_gl_surface_Destroy(p_sys->gl);
     block_FifoRelease(p_sys->fifo);
-    free(p_sys->p_prev_s16_buff);
+    window_close(&p_sys->wind_ctx);
+    fft_close(p_sys->p_state);
     free(p_sys);
 }
 
@@ -193,9 +206,15 @@ static void Close(vlc_object_t *p_this)
  */
 static block_t *DoWork(filter_t *p_filter, block_t *p_in_buf)
 {
+    block_fifo_t *fifo = p_filter->p_sys->fifo;
+
+    /* Do not let the rendering thread lag behind the audio */
+    if (block_FifoCount(fifo) >= MAX_BLOCKS)
+        return p_in_buf;
+
     block_t *block = block_Duplicate(p_in_buf);
     if (likely(block != NULL))
-        block_FifoPut(p_filter->p_sys->fifo, block);
+        block_FifoPut(fifo, block);
     return p_in_buf;
 }
 
@@ -350,10 +369,20 @@ static void *Thread( void *p_data )
     vlc_gl_ReleaseCurrent(gl);
 
     float height[NB_BANDS] = {0};
+    float p_output[FFT_BUFFER_SIZE] = {0}; /* Raw FFT Result; fft_perform()
+                                              only writes the lower half */
 
     while (1)
     {
         block_t *block = block_FifoGet(p_sys->fifo);
+        const mtime_t date = block->i_pts + (block->i_length / 2);
+
+        /* Skip the frames which could not be swapped on time anyway */
+        if (date < mdate())
+        {
+            block_Release(block);
+            continue;
+        }
 
         int canc = vlc_savecancel();
         unsigned win_width, win_height;
@@ -366,76 +395,39 @@ static void *Thread( void *p_data )
         const unsigned xscale[] = {0,1,2,3,4,5,6,7,8,11,15,20,27,
                                    36,47,62,82,107,141,184,255};
 
-        fft_state *p_state = NULL; /* internal FFT data */
-        DEFINE_WIND_CONTEXT(wind_ctx); /* internal window data */
-
         unsigned i, j;
-        float p_output[FFT_BUFFER_SIZE];           /* Raw FFT Result  */
         int16_t p_buffer1[FFT_BUFFER_SIZE];        /* Buffer on which we perform
                                                       the FFT (first channel) */
         int16_t p_dest[FFT_BUFFER_SIZE];           /* Adapted FFT result */
-        float *p_buffl = (float*)block->p_buffer;  /* Original buffer */
-
-        int16_t  *p_buffs;                         /* int16_t converted buffer */
-        int16_t  *p_s16_buff;                      /* int16_t converted buffer */
+        const float *p_buffl = (float*)block->p_buffer; /* Original buffer */
+        const unsigned i_total = block->i_nb_samples * p_sys->i_channels;
 
         if (!block->i_nb_samples) {
             msg_Err(p_filter, "no samples yet");
             goto release;
         }
 
-        /* Allocate the buffer only if the number of samples change */
-        if (block->i_nb_samples != p_sys->i_prev_nb_samples)
-        {
-            free(p_sys->p_prev_s16_buff);
-            p_sys->p_prev_s16_buff = malloc(block->i_nb_samples *
-                                            p_sys->i_channels *
-                                            sizeof(int16_t));
-            if (!p_sys->p_prev_s16_buff)
-                goto release;
-            p_sys->i_prev_nb_samples = block->i_nb_samples;
-        }
-        p_buffs = p_s16_buff = p_sys->p_prev_s16_buff;
-
-        /* Convert the buffer to int16_t
-           Pasted from float32tos16.c */
-        for (i = block->i_nb_samples * p_sys->i_channels; i--;)
+        /* Convert the first channel to int16_t, looping over the block if
+           it is shorter than the FFT. Pasted from float32tos16.c */
+        j = 0;
+        for (i = 0; i < FFT_BUFFER_SIZE; i++)
         {
             union {float f; int32_t i;} u;
 
-            u.f = *p_buffl + 384.f;
+            u.f = p_buffl[j] + 384.f;
             if (u.i > 0x43c07fff)
-                *p_buffs = 32767;
+                p_buffer1[i] = 32767;
             else if (u.i < 0x43bf8000)
-                *p_buffs = -32768;
+                p_buffer1[i] = -32768;
             else
-                *p_buffs = u.i - 0x43c00000;
-
-            p_buffl++; p_buffs++;
-        }
-        p_state = visual_fft_init();
-        if (!p_state)
-        {
-            msg_Err(p_filter,"unable to initialize FFT transform");
-            goto release;
-        }
-        if (!window_init(FFT_BUFFER_SIZE, &p_sys->wind_param, &wind_ctx))
-        {
-            msg_Err(p_filter,"unable to initialize FFT window");
-            goto release;
-        }
-        p_buffs = p_s16_buff;
-        for (i = 0 ; i < FFT_BUFFER_SIZE; i++)
-        {
-            p_output[i] = 0;
-            p_buffer1[i] = *p_buffs;
+                p_buffer1[i] = u.i - 0x43c00000;
 
-            p_buffs += p_sys->i_channels;
-            if (p_buffs >= &p_s16_buff[block->i_nb_samples * p_sys->i_channels])
-                p_buffs = p_s16_buff;
+            j += p_sys->i_channels;
+            if (j >= i_total)
+                j = 0;
         }
-        window_scale_in_place (p_buffer1, &wind_ctx);
-        fft_perform (p_buffer1, p_output, p_state);
+        window_scale_in_place (p_buffer1, &p_sys->wind_ctx);
+        fft_perform (p_buffer1, p_output, p_sys->p_state);
 
         for (i = 0; i< FFT_BUFFER_SIZE; ++i)
             p_dest[i] = p_output[i] *  (2 ^ 16)
@@ -478,7 +470,7 @@ static void *Thread( void *p_data )
         glPopMatrix();
 
         /* Wait to swapp the frame on time. */
-        mwait(block->i_pts + (block->i_length / 2));
+        mwait(date);
         if (!vlc_gl_Lock(gl))
         {
             vlc_gl_Swap(gl);
@@ -486,8 +478,6 @@ static void *Thread( void *p_data )
         }
 
 release:
-        window_close(&wind_ctx);
-        fft_close(p_state);
         vlc_gl_ReleaseCurrent(gl);
         block_Release(block);
         vlc_restorecancel(canc);
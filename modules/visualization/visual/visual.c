@@ -107,10 +107,18 @@
 #define COLOR1_LONGTEXT N_( \
         "YUV-Color cube shifting across the V-plane ( 0 - 127 )." )
 
+#define FPS_TEXT N_( "Maximum frame rate" )
+#define FPS_LONGTEXT N_( \
+        "The effects are rendered at most this many times per second. " \
+        "The audio blocks in between, and the late ones, are skipped." )
+
 /* Default vout size */
 #define VOUT_WIDTH  800
 #define VOUT_HEIGHT 500
 
+/* Audio blocks queued for the rendering thread, beyond which they are dropped */
+#define MAX_BLOCKS 8
+
 static int  Open         ( vlc_object_t * );
 static void Close        ( vlc_object_t * );
 
@@ -131,6 +139,8 @@ vlc_module_begin ()
         change_string_list( window_list, window_list_text )
     add_float("effect-kaiser-param", 3.0f,
             KAISER_PARAMETER_TEXT, KAISER_PARAMETER_LONGTEXT, true )
+    add_integer_with_range("effect-fps", 30, 1, 200,
+             FPS_TEXT, FPS_LONGTEXT, true )
     set_section( N_("Spectrum analyser") , NULL )
     add_obsolete_integer( "visual-nbbands" ) /* Since 1.0.0 */
     add_bool("visual-80-bands", true,
@@ -184,8 +194,46 @@ struct filter_sys_t
     visual_effect_t **effect;
     int             i_effect;
     vlc_thread_t    thread;
+
+    visual_spectrum_t spectrum;
+    mtime_t         i_period; /* minimum interval between two pictures */
+    mtime_t         i_last;   /* date of the last picture */
 };
 
+/*****************************************************************************
+ * visual_spectrum_Get: computes the spectrum of the block, once
+ *****************************************************************************/
+const float *visual_spectrum_Get( visual_spectrum_t *p_spectrum,
+                                  const block_t *p_buffer, int i_nb_chans )
+{
+    if( p_spectrum->b_valid )
+        return p_spectrum->output;
+
+    const float *p_buffl = (const float *)p_buffer->p_buffer;
+    const unsigned i_total = p_buffer->i_nb_samples * i_nb_chans;
+    int16_t p_buffer1[FFT_BUFFER_SIZE]; /* first channel, as int16_t */
+    unsigned j = 0;
+
+    /* Convert the first channel only, looping over the block if it is
+     * shorter than the FFT. Pasted from float32tos16.c */
+    for( int i = 0; i < FFT_BUFFER_SIZE; i++ )
+    {
+        union { float f; int32_t i; } u;
+        u.f = p_buffl[j] + 384.0;
+        if( u.i > 0x43c07fff ) p_buffer1[i] = 32767;
+        else if( u.i < 0x43bf8000 ) p_buffer1[i] = -32768;
+        else p_buffer1[i] = u.i - 0x43c00000;
+
+        j += i_nb_chans;
+        if( j >= i_total )
+            j = 0;
+    }
+    window_scale_in_place( p_buffer1, &p_spectrum->wind_ctx );
+    fft_perform( p_buffer1, p_spectrum->output, p_spectrum->p_state );
+    p_spectrum->b_valid = true;
+    return p_spectrum->output;
+}
+
 /*****************************************************************************
  * Open: open the visualizer
  *****************************************************************************/
@@ -213,6 +261,25 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_effect = 0;
     p_sys->effect   = NULL;
 
+    /* The FFT tables and the window are computed once for all */
+    window_param wind_param;
+    window_get_param( VLC_OBJECT( p_filter ), &wind_param );
+    p_sys->spectrum.p_state = visual_fft_init();
+    p_sys->spectrum.wind_ctx.pf_window_table = NULL;
+    p_sys->spectrum.wind_ctx.i_buffer_size = 0;
+    p_sys->spectrum.b_valid = false;
+    /* fft_perform() only writes the lower half */
+    memset( p_sys->spectrum.output, 0, sizeof( p_sys->spectrum.output ) );
+    if( p_sys->spectrum.p_state == NULL
+     || !window_init( FFT_BUFFER_SIZE, &wind_param, &p_sys->spectrum.wind_ctx ) )
+    {
+        msg_Err( p_filter, "unable to initialize FFT transform" );
+        goto error;
+    }
+
+    p_sys->i_period = CLOCK_FREQ / var_InheritInteger( p_filter, "effect-fps" );
+    p_sys->i_last = VLC_TS_INVALID;
+
     /* Parse the effect list */
     psz_parser = psz_effects = var_CreateGetString( p_filter, "effect-list" );
 
@@ -226,6 +293,7 @@ static int Open( vlc_object_t *p_this )
         p_effect->i_width     = width;
         p_effect->i_height    = height;
         p_effect->i_nb_chans  = aout_FormatNbChannels( &p_filter->fmt_in.audio);
+        p_effect->p_spectrum  = &p_sys->spectrum;
         p_effect->i_idx_left  = 0;
         p_effect->i_idx_right = __MIN( 1, p_effect->i_nb_chans-1 );
 
@@ -306,7 +374,8 @@ static int Open( vlc_object_t *p_this )
         goto error;
     }
 
-    p_sys->fifo = block_FifoNew();
+    /* Only DoWork() puts, and only the thread gets */
+    p_sys->fifo = block_FifoNewSPSC();
     if( unlikely( p_sys->fifo == NULL ) )
     {
         aout_filter_RequestVout( p_filter, p_sys->p_vout, NULL );
@@ -330,6 +399,8 @@ error:
     for( int i = 0; i < p_sys->i_effect; i++ )
         free( p_sys->effect[i] );
     free( p_sys->effect );
+    window_close( &p_sys->spectrum.wind_ctx );
+    fft_close( p_sys->spectrum.p_state );
     free( p_sys );
     return VLC_EGENERIC;
 }
@@ -351,6 +422,7 @@ static block_t *DoRealWork( filter_t *p_filter, block_t *p_in_buf )
     }
 
     /* We can now call our visualization effects */
+    p_sys->spectrum.b_valid = false;
     for( int i = 0; i < p_sys->i_effect; i++ )
     {
 #define p_effect p_sys->effect[i]
@@ -378,7 +450,17 @@ static void *Thread( void *data )
         block_t *block = block_FifoGet( sys->fifo );
 
         int canc = vlc_savecancel( );
-        block_Release( DoRealWork( p_filter, block ) );
+        /* Render at most one picture per period, and none that the vout
+         * would only drop for being late */
+        mtime_t date = block->i_pts + (block->i_length / 2);
+        if( date < mdate()
+         || ( date >= sys->i_last && date - sys->i_last < sys->i_period ) )
+            block_Release( block );
+        else
+        {
+            sys->i_last = date;
+            block_Release( DoRealWork( p_filter, block ) );
+        }
         vlc_restorecancel( canc );
     }
     assert(0);
@@ -386,9 +468,15 @@ static void *Thread( void *data )
 
 static block_t *DoWork( filter_t *p_filter, block_t *p_in_buf )
 {
+    block_fifo_t *fifo = p_filter->p_sys->fifo;
+
+    /* Do not let the rendering thread lag behind the audio */
+    if( block_FifoCount( fifo ) >= MAX_BLOCKS )
+        return p_in_buf;
+
     block_t *block = block_Duplicate( p_in_buf );
     if( likely(block != NULL) )
-        block_FifoPut( p_filter->p_sys->fifo, block );
+        block_FifoPut( fifo, block );
     return p_in_buf;
 }
 
@@ -415,5 +503,7 @@ static void Close( vlc_object_t *p_this )
     }
 
     free( p_sys->effect );
+    window_close( &p_sys->spectrum.wind_ctx );
+    fft_close( p_sys->spectrum.p_state );
     free( p_sys );
 }
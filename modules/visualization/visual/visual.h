@@ -21,6 +21,22 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
  *****************************************************************************/
 
+#include "fft.h"
+#include "window.h"
+
+/* Spectrum of the first channel of the block being rendered: it is computed
+ * at most once per block, and shared by all the effects */
+typedef struct
+{
+    fft_state      *p_state;
+    window_context  wind_ctx;
+    bool            b_valid;
+    float           output[FFT_BUFFER_SIZE];
+} visual_spectrum_t;
+
+const float *visual_spectrum_Get( visual_spectrum_t *, const block_t *,
+                                  int i_nb_chans );
+
 typedef struct visual_effect_t visual_effect_t;
 typedef int (*visual_run_t)(visual_effect_t *, vlc_object_t *,
                             const block_t *, picture_t *);
@@ -34,6 +50,7 @@ struct visual_effect_t
     int        i_width;
     int        i_height;
     int        i_nb_chans;
+    visual_spectrum_t *p_spectrum;
 
     /* Channels index */
     int        i_idx_left;
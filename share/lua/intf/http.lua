@@ -186,6 +186,15 @@ Error
     return content
 end
 
+-- pages answered from the cache while the player state they show is unchanged
+cached = {
+    ["/requests/status.xml"] = "status",
+    ["/requests/status.json"] = "status",
+    ["/requests/playlist.xml"] = "playlist",
+    ["/requests/playlist.json"] = "playlist",
+    ["/requests/playlist_jstree.xml"] = "playlist",
+}
+
 function file(h,path,url,mime)
     local generate_page = process(path)
     local callback = function(data,request)
@@ -212,7 +221,7 @@ function file(h,path,url,mime)
         end
         return table.concat(page)
     end
-    return h:file(url or path,mime,nil,password,callback,nil)
+    return h:file(url or path,mime,nil,password,callback,nil,cached[url])
 end
 
 function rawfile(h,path,url)
@@ -73,8 +73,19 @@ typedef struct
         unsigned resamp_start_drift; /**< Resampler drift absolute value */
         int resamp_type; /**< Resampler mode (FIXME: redundant / resampling) */
         bool discontinuity;
+        bool joined; /**< Continues the stream of a lingering output */
     } sync;
 
+    struct
+    {
+        aout_filters_t *filters; /**< Replaced filters fading out, or NULL */
+        unsigned length; /**< Fade length (samples) */
+        unsigned left; /**< Samples left to fade */
+        bool visual; /**< The filters include a visualization */
+    } xfade;
+
+    bool linger; /**< Output left playing without decoder */
+
     audio_sample_format_t input_format;
     audio_sample_format_t mixer_format;
 
@@ -136,11 +147,15 @@ bool aout_ChangeFilterString( vlc_object_t *manager, vlc_object_t *aout,
 int aout_DecNew(audio_output_t *, const audio_sample_format_t *,
                 const audio_replay_gain_t *, const aout_request_vout_t *);
 void aout_DecDelete(audio_output_t *);
+void aout_DecDeleteGapless(audio_output_t *);
+void aout_DecStopLinger(audio_output_t *);
 int aout_DecPlay(audio_output_t *, block_t *, int i_input_rate);
 int aout_DecGetResetLost(audio_output_t *);
 void aout_DecChangePause(audio_output_t *, bool b_paused, mtime_t i_date);
 void aout_DecFlush(audio_output_t *);
 bool aout_DecIsEmpty(audio_output_t *);
+bool aout_DecIsEnding(audio_output_t *, mtime_t lead);
+mtime_t aout_DecGetJoinDate(audio_output_t *);
 void aout_RequestRestart (audio_output_t *, unsigned);
 
 static inline void aout_InputRequestRestart(audio_output_t *aout)
@@ -350,19 +350,29 @@ do { \
  * \param chans channels/planes count
  * \param fourcc sample format (must be a linear sample format)
  * \note The samples must be naturally aligned in memory.
+ * \note Channels are reordered (or dropped) by passing the planes in the
+ * order of the output channels.
  * \warning Destination and source buffers MUST NOT overlap.
  */
 void aout_Interleave( void *restrict dst, const void *const *srcv,
                       unsigned samples, unsigned chans, vlc_fourcc_t fourcc )
 {
+    /* The output is written sequentially. Stereo, by far the most common
+     * case, gets a loop simple enough for the compiler to vectorize. */
 #define INTERLEAVE_TYPE(type) \
 do { \
-    type *d = dst; \
-    for( size_t i = 0; i < chans; i++ ) { \
-        const type *s = srcv[i]; \
-        for( size_t j = 0, k = 0; j < samples; j++, k += chans ) \
-            d[k] = *(s++); \
-        d++; \
+    type *restrict d = dst; \
+    if( chans == 2 ) { \
+        const type *restrict l = srcv[0]; \
+        const type *restrict r = srcv[1]; \
+        for( size_t j = 0; j < samples; j++ ) { \
+            d[2 * j] = l[j]; \
+            d[2 * j + 1] = r[j]; \
+        } \
+    } else { \
+        for( size_t j = 0; j < samples; j++ ) \
+            for( size_t i = 0; i < chans; i++ ) \
+                *(d++) = ((const type *)srcv[i])[j]; \
     } \
 } while(0)
 
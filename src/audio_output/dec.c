@@ -36,6 +36,32 @@
 
 #include "aout_internal.h"
 #include "libvlc.h"
+#include "../misc/trace.h"
+
+/* Crossfade from the filters to their replacement */
+#define AOUT_XFADE_TIME (CLOCK_FREQ / 50)
+
+static bool aout_DecHasVisual (audio_output_t *aout)
+{
+    char *visual = var_InheritString (aout, "audio-visual");
+    bool ret = visual != NULL && strcasecmp (visual, "none");
+    free (visual);
+    return ret;
+}
+
+/**
+ * Deletes the replaced filters, if any.
+ */
+static void aout_DecEndCrossfade (audio_output_t *aout)
+{
+    aout_owner_t *owner = aout_owner (aout);
+
+    if (owner->xfade.filters != NULL)
+    {
+        aout_FiltersDelete (aout, owner->xfade.filters);
+        owner->xfade.filters = NULL;
+    }
+}
 
 /**
  * Creates an audio output
@@ -70,21 +96,38 @@ int aout_DecNew( audio_output_t *p_aout,
     /* TODO: reduce lock scope depending on decoder's real need */
     aout_OutputLock (p_aout);
 
-    var_Destroy( p_aout, "stereo-mode" );
-
     /* Create the audio output stream */
     owner->volume = aout_volume_New (p_aout, p_replay_gain);
 
     atomic_store (&owner->restart, 0);
     owner->input_format = *p_format;
-    owner->mixer_format = owner->input_format;
     owner->request_vout = *p_request_vout;
 
-    if (aout_OutputNew (p_aout, &owner->mixer_format))
-        goto error;
+    /* Continue the stream of a lingering output if the filters can convert
+     * to its format. Otherwise, restart it. */
+    bool join = false;
+    if (owner->linger)
+    {
+        owner->linger = false;
+        join = AOUT_FMT_LINEAR(p_format);
+        if (join)
+            msg_Dbg (p_aout, "joining lingering output");
+        else
+            aout_OutputDelete (p_aout);
+    }
+
+    if (!join)
+    {
+        var_Destroy (p_aout, "stereo-mode");
+        owner->mixer_format = owner->input_format;
+        if (aout_OutputNew (p_aout, &owner->mixer_format))
+            goto error;
+    }
     aout_volume_SetFormat (owner->volume, owner->mixer_format.i_format);
 
     /* Create the audio filtering "input" pipeline */
+    owner->xfade.filters = NULL;
+    owner->xfade.visual = aout_DecHasVisual (p_aout);
     owner->filters = aout_FiltersNew (p_aout, p_format, &owner->mixer_format,
                                       &owner->request_vout);
     if (owner->filters == NULL)
@@ -96,9 +139,11 @@ error:
         return -1;
     }
 
-    owner->sync.end = VLC_TS_INVALID;
+    if (!join)
+        owner->sync.end = VLC_TS_INVALID;
     owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
-    owner->sync.discontinuity = true;
+    owner->sync.discontinuity = !join;
+    owner->sync.joined = join;
     aout_OutputUnlock (p_aout);
 
     atomic_init (&owner->buffers_lost, 0);
@@ -115,6 +160,7 @@ void aout_DecDelete (audio_output_t *aout)
     aout_OutputLock (aout);
     if (owner->mixer_format.i_format)
     {
+        aout_DecEndCrossfade (aout);
         aout_FiltersDelete (aout, owner->filters);
         aout_OutputDelete (aout);
     }
@@ -123,6 +169,117 @@ void aout_DecDelete (audio_output_t *aout)
     var_Destroy (aout, "stereo-mode");
 }
 
+/**
+ * Stops the decoder side of the audio output, but leaves the output playing
+ * the last samples, so that the next stream can continue them without gap
+ * (see aout_DecNew()). Falls back to aout_DecDelete() if the output is not
+ * playing linear PCM.
+ */
+void aout_DecDeleteGapless (audio_output_t *aout)
+{
+    aout_owner_t *owner = aout_owner (aout);
+
+    aout_OutputLock (aout);
+    if (!owner->mixer_format.i_format
+     || !AOUT_FMT_LINEAR(&owner->mixer_format)
+     || owner->sync.end == VLC_TS_INVALID)
+    {
+        aout_OutputUnlock (aout);
+        aout_DecDelete (aout);
+        return;
+    }
+
+    aout_DecEndCrossfade (aout);
+    aout_FiltersDelete (aout, owner->filters);
+    aout_volume_Delete (owner->volume);
+    owner->linger = true;
+    aout_OutputUnlock (aout);
+}
+
+/**
+ * Stops an output left playing by aout_DecDeleteGapless(), if any, once it
+ * has played its last samples.
+ */
+void aout_DecStopLinger (audio_output_t *aout)
+{
+    aout_owner_t *owner = aout_owner (aout);
+
+    aout_OutputLock (aout);
+    if (owner->linger)
+    {
+        owner->linger = false;
+        aout_OutputFlush (aout, true);
+        aout_OutputDelete (aout);
+    }
+    aout_OutputUnlock (aout);
+}
+
+/**
+ * Replaces the filters without interrupting the stream: the output of the
+ * new filters fades in while the output of the previous ones fades out.
+ * \return false if the filters must be restarted instead
+ */
+static bool aout_DecReplaceFilters (audio_output_t *aout)
+{
+    aout_owner_t *owner = aout_owner (aout);
+
+    /* The crossfade mixes float samples. A visualization cannot be shown
+     * twice at once. */
+    if (owner->mixer_format.i_format != VLC_CODEC_FL32
+     || owner->xfade.visual || aout_DecHasVisual (aout))
+        return false;
+
+    aout_filters_t *filters = aout_FiltersNew (aout, &owner->input_format,
+                                               &owner->mixer_format,
+                                               &owner->request_vout);
+    if (filters == NULL)
+        return false;
+
+    /* Replaced again while fading: the oldest filters are cut */
+    aout_DecEndCrossfade (aout);
+    owner->xfade.filters = owner->filters;
+    owner->xfade.length = owner->mixer_format.i_rate * AOUT_XFADE_TIME
+                          / CLOCK_FREQ;
+    owner->xfade.left = owner->xfade.length;
+    owner->filters = filters;
+    /* The new resampler starts at the nominal rate */
+    owner->sync.resamp_type = AOUT_RESAMPLING_NONE;
+    msg_Dbg (aout, "filters replaced");
+    return true;
+}
+
+/**
+ * Mixes the output of the replaced filters into the output of the new ones.
+ */
+static void aout_DecCrossfade (audio_output_t *aout, block_t *block,
+                               block_t *old)
+{
+    aout_owner_t *owner = aout_owner (aout);
+    const unsigned channels = owner->mixer_format.i_channels;
+    const float step = 1.f / owner->xfade.length;
+    float gain = owner->xfade.left * step; /* of the old samples */
+    unsigned count = __MIN(block->i_nb_samples, owner->xfade.left);
+
+    if (old != NULL)
+    {
+        float *out = (float *)block->p_buffer;
+        const float *in = (const float *)old->p_buffer;
+        const unsigned mixed = __MIN(count, old->i_nb_samples);
+
+        for (unsigned i = 0; i < mixed; i++, gain -= step)
+            for (unsigned j = 0; j < channels; j++, out++, in++)
+                *out = *out * (1.f - gain) + *in * gain;
+        block_Release (old);
+    }
+
+    owner->xfade.left -= count;
+    if (owner->xfade.left == 0)
+    {
+        aout_DecEndCrossfade (aout);
+        msg_Dbg (aout, "filters crossfade done");
+    }
+}
+
 static int aout_CheckReady (audio_output_t *aout)
 {
     aout_owner_t *owner = aout_owner (aout);
@@ -130,8 +287,15 @@ static int aout_CheckReady (audio_output_t *aout)
     int restart = atomic_exchange (&owner->restart, 0);
     if (unlikely(restart))
     {
+        if (restart == AOUT_RESTART_FILTERS && owner->mixer_format.i_format
+         && aout_DecReplaceFilters (aout))
+            return 0;
+
         if (owner->mixer_format.i_format)
+        {
+            aout_DecEndCrossfade (aout);
             aout_FiltersDelete (aout, owner->filters);
+        }
 
         if (restart & AOUT_RESTART_OUTPUT)
         {   /* Reinitializes the output */
@@ -151,6 +315,7 @@ static int aout_CheckReady (audio_output_t *aout)
 
         if (owner->mixer_format.i_format)
         {
+            owner->xfade.visual = aout_DecHasVisual (aout);
             owner->filters = aout_FiltersNew (aout, &owner->input_format,
                                               &owner->mixer_format,
                                               &owner->request_vout);
@@ -342,6 +507,7 @@ int aout_DecPlay (audio_output_t *aout, block_t *block, int input_rate)
     block->i_length = CLOCK_FREQ * block->i_nb_samples
                                  / owner->input_format.i_rate;
 
+    vlc_trace_Begin ("aout play");
     aout_OutputLock (aout);
     if (unlikely(aout_CheckReady (aout)))
         goto drop; /* Pipeline is unrecoverably broken :-( */
@@ -360,12 +526,32 @@ int aout_DecPlay (audio_output_t *aout, block_t *block, int input_rate)
         msg_Err (aout, "buffer too early (%"PRId64" us): dropped", advance);
         goto drop;
     }
-    if (block->i_flags & BLOCK_FLAG_DISCONTINUITY)
+    /* The first block of a joined stream follows the lingering samples */
+    if ((block->i_flags & BLOCK_FLAG_DISCONTINUITY) && !owner->sync.joined)
         owner->sync.discontinuity = true;
+    owner->sync.joined = false;
+
+    if (unlikely(owner->xfade.filters != NULL))
+    {   /* The replaced filters also get the samples, until faded out */
+        block_t *old = block_Duplicate (block);
+        if (likely(old != NULL))
+            old = aout_FiltersPlay (owner->xfade.filters, old, input_rate);
 
-    block = aout_FiltersPlay (owner->filters, block, input_rate);
-    if (block == NULL)
-        goto lost;
+        block = aout_FiltersPlay (owner->filters, block, input_rate);
+        if (block == NULL)
+        {
+            if (old != NULL)
+                block_Release (old);
+            goto lost;
+        }
+        aout_DecCrossfade (aout, block, old);
+    }
+    else
+    {
+        block = aout_FiltersPlay (owner->filters, block, input_rate);
+        if (block == NULL)
+            goto lost;
+    }
 
     /* Software volume */
     aout_volume_Amplify (owner->volume, block);
@@ -379,6 +565,7 @@ int aout_DecPlay (audio_output_t *aout, block_t *block, int input_rate)
     aout_OutputPlay (aout, block);
 out:
     aout_OutputUnlock (aout);
+    vlc_trace_End ("aout play");
     return 0;
 drop:
     owner->sync.discontinuity = true;
@@ -418,7 +605,10 @@ void aout_DecFlush (audio_output_t *aout)
     aout_OutputLock (aout);
     owner->sync.end = VLC_TS_INVALID;
     if (owner->mixer_format.i_format)
+    {
+        aout_DecEndCrossfade (aout);
         aout_OutputFlush (aout, false);
+    }
     aout_OutputUnlock (aout);
 }
 
@@ -439,3 +629,49 @@ bool aout_DecIsEmpty (audio_output_t *aout)
     aout_OutputUnlock (aout);
     return empty;
 }
+
+/**
+ * Checks if the output will have played all its samples within the given
+ * delay. Unlike aout_DecIsEmpty(), this does not drain the output, so that
+ * the next stream can continue it.
+ */
+bool aout_DecIsEnding (audio_output_t *aout, mtime_t lead)
+{
+    aout_owner_t *owner = aout_owner (aout);
+    bool ending = true;
+
+    aout_OutputLock (aout);
+    if (owner->sync.end != VLC_TS_INVALID)
+        ending = owner->sync.end <= mdate () + lead;
+    aout_OutputUnlock (aout);
+    return ending;
+}
+
+/**
+ * Returns the date when the samples of the lingering output joined by
+ * aout_DecNew() will have been played, until the first block of the new
+ * stream is played.
+ *
+ * @return the date, or VLC_TS_INVALID if the output was not joined or if it
+ * has already played all its samples
+ */
+mtime_t aout_DecGetJoinDate (audio_output_t *aout)
+{
+    aout_owner_t *owner = aout_owner (aout);
+    mtime_t date = VLC_TS_INVALID;
+
+    aout_OutputLock (aout);
+    if (owner->sync.joined && owner->sync.end != VLC_TS_INVALID)
+    {
+        mtime_t delay;
+
+        if (aout_OutputTimeGet (aout, &delay) == 0)
+            date = mdate () + delay;
+        else
+            date = owner->sync.end;
+        if (date <= mdate ())
+            date = VLC_TS_INVALID;
+    }
+    aout_OutputUnlock (aout);
+    return date;
+}
@@ -316,6 +316,8 @@ void aout_Destroy (audio_output_t *aout)
     aout_owner_t *owner = aout_owner (aout);
 
     aout_OutputLock (aout);
+    if (owner->linger)
+        aout_OutputDelete (aout);
     module_unneed (aout, owner->module);
     /* Protect against late call from intf.c */
     aout->volume_set = NULL;
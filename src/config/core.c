@@ -40,6 +40,7 @@
 
 vlc_rwlock_t config_lock = VLC_STATIC_RWLOCK;
 bool config_dirty = false;
+atomic_uint config_generation = ATOMIC_VAR_INIT(0);
 
 static inline char *strdupnull (const char *src)
 {
@@ -382,7 +383,7 @@ ssize_t config_GetIntChoices (vlc_object_t *obj, const char *name,
 static ssize_t config_ListModules (const char *cap, char ***restrict values,
                                    char ***restrict texts)
 {
-    module_t **list;
+    module_t *const *list;
     ssize_t n = module_list_cap (&list, cap);
     if (n <= 0)
     {
@@ -535,6 +536,9 @@ void config_UnsortConfig (void)
 {
     module_config_t **clist;
 
+    /* Items found before may be freed from now on */
+    atomic_fetch_add (&config_generation, 1);
+
     clist = config.list;
     config.list = NULL;
     config.count = 0;
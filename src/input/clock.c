@@ -74,6 +74,15 @@
  * new_average = (old_average * c_average + new_sample_value) / (c_average +1)
  */
 
+/*
+ * The average lets through any jitter slower than the averaging period,
+ * and it tracks a drift with a lag. Alternatively, the drift can be found
+ * by a linear regression over a sliding window: the network only ever
+ * adds delay, so the minimum of the drift samples over each period follows
+ * the true clock drift, and the excess over the fitted line is the jitter.
+ * The regression is always computed for the statistics.
+ */
+
 
 /*****************************************************************************
  * Constants
@@ -99,6 +108,12 @@
 /* Due to some problems in es_out, we cannot use a large value yet */
 #define CR_BUFFERING_TARGET (100000)
 
+/* Duration over which the minimal drift sample is taken, number of those
+ * minima in the regression window, and number needed for a first fit */
+#define CR_REGRESSION_PERIOD (CLOCK_FREQ)
+#define CR_REGRESSION_COUNT (64)
+#define CR_REGRESSION_MIN (4)
+
 /*****************************************************************************
  * Structures
  *****************************************************************************/
@@ -122,6 +137,39 @@ static void    AvgUpdate( average_t *, mtime_t i_value );
 static mtime_t AvgGet( average_t * );
 static void    AvgRescale( average_t *, int i_divider );
 
+/**
+ * This structure holds the linear regression of the drift lower envelope
+ */
+typedef struct
+{
+    /* Minimal drift sample of the past periods */
+    struct
+    {
+        mtime_t i_system;
+        mtime_t i_value;
+    } point[CR_REGRESSION_COUNT];
+    unsigned i_count;
+    unsigned i_index;
+
+    /* Current period */
+    mtime_t i_period_end;
+    mtime_t i_min_system;
+    mtime_t i_min_value;
+    mtime_t i_floor;
+
+    /* Fitted line: value = f_origin + f_slope * (system - i_origin) */
+    bool    b_fitted;
+    mtime_t i_origin;
+    double  f_origin;
+    double  f_slope;
+
+    /* Average excess of the samples over the line */
+    double  f_jitter;
+} regression_t;
+static void    RegReset( regression_t * );
+static void    RegUpdate( regression_t *, mtime_t i_system, mtime_t i_value );
+static mtime_t RegGet( regression_t *, mtime_t i_system );
+
 /* */
 typedef struct
 {
@@ -157,6 +205,8 @@ struct input_clock_t
     /* Clock drift */
     mtime_t i_next_drift_update;
     average_t drift;
+    regression_t drift_regression;
+    bool b_drift_regression;
 
     /* Late statistics */
     struct
@@ -184,11 +234,12 @@ static mtime_t ClockStreamToSystem( input_clock_t *, mtime_t i_stream );
 static mtime_t ClockSystemToStream( input_clock_t *, mtime_t i_system );
 
 static mtime_t ClockGetTsOffset( input_clock_t * );
+static mtime_t ClockGetDrift( input_clock_t * );
 
 /*****************************************************************************
  * input_clock_New: create a new clock
  *****************************************************************************/
-input_clock_t *input_clock_New( int i_rate )
+input_clock_t *input_clock_New( int i_rate, bool b_drift_regression )
 {
     input_clock_t *cl = malloc( sizeof(*cl) );
     if( !cl )
@@ -207,6 +258,8 @@ input_clock_t *input_clock_New( int i_rate )
 
     cl->i_next_drift_update = VLC_TS_INVALID;
     AvgInit( &cl->drift, 10 );
+    RegReset( &cl->drift_regression );
+    cl->b_drift_regression = b_drift_regression;
 
     cl->late.i_index = 0;
     for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
@@ -272,6 +325,7 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
     {
         cl->i_next_drift_update = VLC_TS_INVALID;
         AvgReset( &cl->drift );
+        RegReset( &cl->drift_regression );
 
         /* Feed synchro with a new reference point. */
         cl->b_has_reference = true;
@@ -287,6 +341,7 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
         const mtime_t i_converted = ClockSystemToStream( cl, i_ck_system );
 
         AvgUpdate( &cl->drift, i_converted - i_ck_stream );
+        RegUpdate( &cl->drift_regression, i_ck_system, i_converted - i_ck_stream );
 
         cl->i_next_drift_update = i_ck_system + CLOCK_FREQ/5; /* FIXME why that */
     }
@@ -314,7 +369,7 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
 
     /* It does not take the decoder latency into account but it is not really
      * the goal of the clock here */
-    const mtime_t i_system_expected = ClockStreamToSystem( cl, i_ck_stream + AvgGet( &cl->drift ) );
+    const mtime_t i_system_expected = ClockStreamToSystem( cl, i_ck_stream + ClockGetDrift( cl ) );
     const mtime_t i_late = ( i_ck_system - cl->i_pts_delay ) - i_system_expected;
     *pb_late = i_late > 0;
     if( i_late > 0 )
@@ -394,7 +449,7 @@ mtime_t input_clock_GetWakeup( input_clock_t *cl )
 
     /* Synchronized, we can wait */
     if( cl->b_has_reference )
-        i_wakeup = ClockStreamToSystem( cl, cl->last.i_stream + AvgGet( &cl->drift ) - cl->i_buffering_duration );
+        i_wakeup = ClockStreamToSystem( cl, cl->last.i_stream + ClockGetDrift( cl ) - cl->i_buffering_duration );
 
     vlc_mutex_unlock( &cl->lock );
 
@@ -426,11 +481,12 @@ int input_clock_ConvertTS( input_clock_t *cl,
     /* */
     const mtime_t i_ts_buffering = cl->i_buffering_duration * cl->i_rate / INPUT_RATE_DEFAULT;
     const mtime_t i_ts_delay = cl->i_pts_delay + ClockGetTsOffset( cl );
+    const mtime_t i_drift = ClockGetDrift( cl );
 
     /* */
     if( *pi_ts0 > VLC_TS_INVALID )
     {
-        *pi_ts0 = ClockStreamToSystem( cl, *pi_ts0 + AvgGet( &cl->drift ) );
+        *pi_ts0 = ClockStreamToSystem( cl, *pi_ts0 + i_drift );
         if( *pi_ts0 > cl->i_ts_max )
             cl->i_ts_max = *pi_ts0;
         *pi_ts0 += i_ts_delay;
@@ -439,7 +495,7 @@ int input_clock_ConvertTS( input_clock_t *cl,
     /* XXX we do not update i_ts_max on purpose */
     if( pi_ts1 && *pi_ts1 > VLC_TS_INVALID )
     {
-        *pi_ts1 = ClockStreamToSystem( cl, *pi_ts1 + AvgGet( &cl->drift ) ) +
+        *pi_ts1 = ClockStreamToSystem( cl, *pi_ts1 + i_drift ) +
                   i_ts_delay;
     }
 
@@ -596,6 +652,19 @@ mtime_t input_clock_GetJitter( input_clock_t *cl )
     return i_pts_delay + i_late_median;
 }
 
+void input_clock_GetDrift( input_clock_t *cl, double *pf_drift, mtime_t *pi_jitter )
+{
+    vlc_mutex_lock( &cl->lock );
+
+    const regression_t *p_reg = &cl->drift_regression;
+
+    /* The drift samples grow when the stream clock is slower */
+    *pf_drift = p_reg->b_fitted ? -p_reg->f_slope * 1000000. : 0.;
+    *pi_jitter = p_reg->f_jitter;
+
+    vlc_mutex_unlock( &cl->lock );
+}
+
 /*****************************************************************************
  * ClockStreamToSystem: converts a movie clock to system date
  *****************************************************************************/
@@ -629,6 +698,16 @@ static mtime_t ClockGetTsOffset( input_clock_t *cl )
     return cl->i_pts_delay * ( cl->i_rate - INPUT_RATE_DEFAULT ) / INPUT_RATE_DEFAULT;
 }
 
+/**
+ * It returns the current drift estimation (in stream unit)
+ */
+static mtime_t ClockGetDrift( input_clock_t *cl )
+{
+    if( cl->b_drift_regression )
+        return RegGet( &cl->drift_regression, cl->last.i_system );
+    return AvgGet( &cl->drift );
+}
+
 /*****************************************************************************
  * Long term average helpers
  *****************************************************************************/
@@ -671,3 +750,91 @@ static void AvgRescale( average_t *p_avg, int i_divider )
     p_avg->i_value   = i_tmp / p_avg->i_divider;
     p_avg->i_residue = i_tmp % p_avg->i_divider;
 }
+
+/*****************************************************************************
+ * Drift regression helpers
+ *****************************************************************************/
+static void RegReset( regression_t *p_reg )
+{
+    p_reg->i_count = 0;
+    p_reg->i_index = 0;
+    p_reg->i_period_end = VLC_TS_INVALID;
+    p_reg->i_min_system = VLC_TS_INVALID;
+    p_reg->i_min_value = 0;
+    p_reg->i_floor = 0;
+    p_reg->b_fitted = false;
+    p_reg->f_jitter = 0.;
+}
+static void RegFit( regression_t *p_reg )
+{
+    const unsigned i_count = p_reg->i_count;
+    if( i_count < CR_REGRESSION_MIN )
+        return;
+
+    /* Least squares, centered on the mean point */
+    const mtime_t i_base = p_reg->point[p_reg->i_index % i_count].i_system;
+    double f_x = 0., f_y = 0.;
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        f_x += p_reg->point[i].i_system - i_base;
+        f_y += p_reg->point[i].i_value;
+    }
+    f_x /= i_count;
+    f_y /= i_count;
+
+    double f_sxx = 0., f_sxy = 0.;
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        const double f_dx = p_reg->point[i].i_system - i_base - f_x;
+        f_sxx += f_dx * f_dx;
+        f_sxy += f_dx * ( p_reg->point[i].i_value - f_y );
+    }
+    if( f_sxx <= 0. )
+        return;
+
+    p_reg->b_fitted = true;
+    p_reg->i_origin = i_base + (mtime_t)f_x;
+    p_reg->f_origin = f_y;
+    p_reg->f_slope  = f_sxy / f_sxx;
+}
+static void RegUpdate( regression_t *p_reg, mtime_t i_system, mtime_t i_value )
+{
+    if( p_reg->b_fitted )
+    {
+        const mtime_t i_excess = __MAX( i_value - RegGet( p_reg, i_system ), 0 );
+        p_reg->f_jitter = ( 15. * p_reg->f_jitter + i_excess ) / 16.;
+    }
+
+    if( p_reg->i_min_system <= VLC_TS_INVALID || i_value < p_reg->i_min_value )
+    {
+        p_reg->i_min_system = i_system;
+        p_reg->i_min_value = i_value;
+    }
+    if( p_reg->i_count == 0 || p_reg->i_min_value < p_reg->i_floor )
+        p_reg->i_floor = p_reg->i_min_value;
+
+    if( p_reg->i_period_end <= VLC_TS_INVALID )
+        p_reg->i_period_end = i_system + CR_REGRESSION_PERIOD;
+    if( i_system < p_reg->i_period_end )
+        return;
+
+    /* Close the period */
+    p_reg->point[p_reg->i_index].i_system = p_reg->i_min_system;
+    p_reg->point[p_reg->i_index].i_value = p_reg->i_min_value;
+    p_reg->i_index = ( p_reg->i_index + 1 ) % CR_REGRESSION_COUNT;
+    if( p_reg->i_count < CR_REGRESSION_COUNT )
+        p_reg->i_count++;
+
+    p_reg->i_min_system = VLC_TS_INVALID;
+    p_reg->i_period_end = i_system + CR_REGRESSION_PERIOD;
+
+    RegFit( p_reg );
+}
+static mtime_t RegGet( regression_t *p_reg, mtime_t i_system )
+{
+    /* Until the first fit, use the lowest sample seen */
+    if( !p_reg->b_fitted )
+        return p_reg->i_floor;
+
+    return p_reg->f_origin + p_reg->f_slope * ( i_system - p_reg->i_origin );
+}
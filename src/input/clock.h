@@ -39,8 +39,11 @@ typedef struct input_clock_t input_clock_t;
 /**
  * This function creates a new input_clock_t.
  * You must use input_clock_Delete to delete it once unused.
+ *
+ * \param b_drift_regression selects the linear regression drift estimation
+ * instead of the moving average.
  */
-input_clock_t *input_clock_New( int i_rate );
+input_clock_t *input_clock_New( int i_rate, bool b_drift_regression );
 
 /**
  * This function destroys a input_clock_t created by input_clock_New.
@@ -135,4 +138,10 @@ void input_clock_SetJitter( input_clock_t *,
  */
 mtime_t input_clock_GetJitter( input_clock_t * );
 
+/**
+ * This function returns the estimated drift of the stream clock relative to
+ * the system clock (in ppm) and the reception jitter over it.
+ */
+void input_clock_GetDrift( input_clock_t *, double *pf_drift, mtime_t *pi_jitter );
+
 #endif
@@ -33,6 +33,7 @@
 
 #include <vlc_common.h>
 
+#include <vlc_atomic.h>
 #include <vlc_block.h>
 #include <vlc_vout.h>
 #include <vlc_aout.h>
@@ -52,16 +53,23 @@
 #include "resource.h"
 
 #include "../video_output/vout_control.h"
+#include "../misc/trace.h"
 
 static decoder_t *CreateDecoder( vlc_object_t *, input_thread_t *,
                                  es_format_t *, bool, input_resource_t *,
                                  sout_instance_t *p_sout );
 static void       DeleteDecoder( decoder_t * );
+static void       DecoderInitRun( decoder_t *, vlc_object_t *,
+                                  input_thread_t * );
+static bool       DecoderIsReusable( decoder_t * );
+static void       DecoderReleaseOutputs( decoder_t * );
 
 static void      *DecoderThread( void * );
 static void       DecoderProcess( decoder_t *, block_t * );
 static void       DecoderFlush( decoder_t * );
 static void       DecoderSignalWait( decoder_t *, bool );
+static void       DecoderTrickOutputGop( decoder_t * );
+static void       DecoderTrickReset( decoder_t * );
 
 static void       DecoderUnsupportedCodec( decoder_t *, vlc_fourcc_t );
 
@@ -71,9 +79,13 @@ static picture_t *vout_new_buffer( decoder_t * );
 static int aout_update_format( decoder_t * );
 static subpicture_t *spu_new_buffer( decoder_t *, const subpicture_updater_t * );
 
+/* Number of decoded pictures of a GOP cached for the reverse playback */
+#define DECODER_TRICK_GOP_MAX 32
+
 struct decoder_owner_sys_t
 {
     int64_t         i_preroll_end;
+    int64_t         i_preroll_date; /* exact end of the audio preroll */
 
     input_thread_t  *p_input;
     input_resource_t*p_resource;
@@ -103,6 +115,36 @@ struct decoder_owner_sys_t
     /* fifo */
     block_fifo_t *p_fifo;
 
+    /* Low-latency mode */
+    bool b_low_latency;
+
+    /* One video block at a time is timed through the fifo */
+    atomic_uintptr_t probe_block;
+    atomic_llong     probe_date;
+
+    /* Drop policy, fed by the lateness of the displayed pictures
+     * (decoder thread only) */
+    struct
+    {
+        bool    b_enabled;
+        int     i_level;
+        mtime_t i_lateness; /* moving average, negative when early */
+        mtime_t i_date;     /* date of the last level change */
+        mtime_t i_late_date;/* last date the average was late */
+    } drop;
+
+    /* Trick play: the mode and rate are set by the input thread while the
+     * decoder is flushed, the rest belongs to the decoder thread */
+    struct
+    {
+        atomic_int i_mode;
+        atomic_int i_rate;
+        bool       b_typed;     /* the blocks carry their frame type */
+        int        i_gop;
+        picture_t *pp_gop[DECODER_TRICK_GOP_MAX];
+        mtime_t    i_next_date; /* end of the GOP being displayed */
+    } trick;
+
     /* Lock for communication with decoder thread */
     vlc_mutex_t lock;
     vlc_cond_t  wait_request;
@@ -132,6 +174,12 @@ struct decoder_owner_sys_t
     /* Flushing */
     bool b_flushing;
 
+    /* Gapless audio */
+    bool b_gapless;      /* hand the aout over to the next input at the end */
+    bool b_aout_join;    /* the aout may continue the one of the last input */
+    bool b_keep_aout;    /* do not flush the aout when deleting */
+    atomic_bool drained; /* all the data has been output */
+
     /* CC */
     struct
     {
@@ -151,6 +199,175 @@ struct decoder_owner_sys_t
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION ((int)(0.200*CLOCK_FREQ))
 
+/* An ending audio decoder lets the input end once the aout has that much
+ * more than the clock delay left to play, and the next input is moved by at
+ * most DECODER_GAPLESS_MAX_SHIFT to continue it */
+#define DECODER_GAPLESS_LEAD (CLOCK_FREQ/4)
+#define DECODER_GAPLESS_MAX_SHIFT (CLOCK_FREQ)
+
+/* Backlog above which the low-latency mode drops the fifo to catch up */
+#define DECODER_LOW_LATENCY_FIFO_SIZE (2*1024*1024)
+
+/* The drop level is raised while the pictures are DECODER_DROP_LATE late on
+ * average, at most once per DECODER_DROP_ESCALATE_DELAY, and lowered once
+ * they have been on time for DECODER_DROP_RELAX_DELAY. A picture lost by the
+ * video output counts as DECODER_DROP_LOST_LATENESS late. */
+#define DECODER_DROP_LATE            (CLOCK_FREQ/50)
+#define DECODER_DROP_ESCALATE_DELAY  (CLOCK_FREQ/2)
+#define DECODER_DROP_RELAX_DELAY     (3*CLOCK_FREQ)
+#define DECODER_DROP_LOST_LATENESS   (4*DECODER_DROP_LATE)
+
+/* Checks if the decoder has output all the audio of its input, which the next
+ * input can then continue without gap */
+static bool DecoderIsGaplessEnd( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    return p_owner->b_gapless && atomic_load( &p_owner->drained );
+}
+
+static mtime_t DecoderGetGaplessLead( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    mtime_t i_lead = DECODER_GAPLESS_LEAD;
+
+    if( p_owner->p_clock != NULL )
+        i_lead += input_clock_GetJitter( p_owner->p_clock );
+    return i_lead;
+}
+
+enum
+{
+    LATENCY_QUEUE,  /* time spent in the decoder fifo */
+    LATENCY_DECODE, /* time spent decoding one block */
+    LATENCY_OUTPUT, /* time until the output renders a picture or buffer */
+};
+
+static void DecoderUpdateLatency( decoder_t *p_dec, int i_stage,
+                                  mtime_t i_value )
+{
+    input_thread_t *p_input = p_dec->p_owner->p_input;
+    const bool b_video = p_dec->fmt_in.i_cat == VIDEO_ES;
+    mtime_t *pi_latency = NULL;
+    int i_histo;
+
+    if( p_input == NULL )
+        return;
+
+    switch( i_stage )
+    {
+        case LATENCY_QUEUE:
+            if( b_video )
+                pi_latency = &p_input->p->counters.i_latency_queue;
+            i_histo = b_video ? INPUT_LATENCY_VIDEO_QUEUE
+                              : INPUT_LATENCY_AUDIO_QUEUE;
+            break;
+        case LATENCY_DECODE:
+            if( b_video )
+                pi_latency = &p_input->p->counters.i_latency_decode;
+            i_histo = b_video ? INPUT_LATENCY_VIDEO_DECODE
+                              : INPUT_LATENCY_AUDIO_DECODE;
+            break;
+        default:
+            if( b_video )
+                pi_latency = &p_input->p->counters.i_latency_output;
+            i_histo = b_video ? INPUT_LATENCY_VIDEO_OUTPUT
+                              : INPUT_LATENCY_AUDIO_OUTPUT;
+            break;
+    }
+
+    vlc_mutex_lock( &p_input->p->counters.counters_lock );
+    if( pi_latency != NULL )
+        *pi_latency = ( 7 * *pi_latency + i_value ) / 8;
+    stats_AddLatency( &p_input->p->counters.latency[i_histo], i_value );
+    vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+}
+
+/* Samples the depth of the fifo, along with the queue latency probe */
+static void DecoderUpdateFifoDepth( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    input_thread_t *p_input = p_owner->p_input;
+
+    if( p_input == NULL )
+        return;
+
+    const int64_t i_blocks = block_FifoCount( p_owner->p_fifo );
+    const int64_t i_bytes = block_FifoSize( p_owner->p_fifo );
+
+    vlc_mutex_lock( &p_input->p->counters.counters_lock );
+    if( p_dec->fmt_in.i_cat == VIDEO_ES )
+    {
+        p_input->p->counters.i_video_fifo_blocks = i_blocks;
+        p_input->p->counters.i_video_fifo_bytes = i_bytes;
+    }
+    else
+    {
+        p_input->p->counters.i_audio_fifo_blocks = i_blocks;
+        p_input->p->counters.i_audio_fifo_bytes = i_bytes;
+    }
+    vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+}
+
+static void DecoderResetDropLevel( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    input_thread_t *p_input = p_owner->p_input;
+
+    if( p_owner->drop.i_level != DECODER_DROP_NONE && p_input != NULL )
+    {
+        vlc_mutex_lock( &p_input->p->counters.counters_lock );
+        p_input->p->counters.i_video_drop_level = DECODER_DROP_NONE;
+        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+    }
+    p_owner->drop.i_level = DECODER_DROP_NONE;
+    p_owner->drop.i_lateness = 0;
+    p_owner->drop.i_date = p_owner->drop.i_late_date = VLC_TS_INVALID;
+}
+
+/* Feeds the drop policy with the lateness of a displayed picture */
+static void DecoderUpdateDropLevel( decoder_t *p_dec, mtime_t i_lateness )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const mtime_t i_now = mdate();
+    int i_level = p_owner->drop.i_level;
+
+    if( !p_owner->drop.b_enabled )
+        return;
+
+    p_owner->drop.i_lateness = ( 7 * p_owner->drop.i_lateness + i_lateness ) / 8;
+    if( p_owner->drop.i_lateness > 0 )
+        p_owner->drop.i_late_date = i_now;
+
+    if( p_owner->drop.i_lateness > DECODER_DROP_LATE &&
+        i_level < DECODER_DROP_NONKEY &&
+        i_now - p_owner->drop.i_date >= DECODER_DROP_ESCALATE_DELAY )
+        i_level++;
+    else if( i_level > DECODER_DROP_NONE &&
+             i_now - __MAX( p_owner->drop.i_date, p_owner->drop.i_late_date )
+                 >= DECODER_DROP_RELAX_DELAY )
+        i_level--;
+    else
+        return;
+
+    msg_Dbg( p_dec, "drop level %d -> %d (pictures %"PRId64" ms late)",
+             p_owner->drop.i_level, i_level,
+             p_owner->drop.i_lateness / 1000 );
+
+    const bool b_escalation = i_level > p_owner->drop.i_level;
+    p_owner->drop.i_level = i_level;
+    p_owner->drop.i_date = i_now;
+
+    input_thread_t *p_input = p_owner->p_input;
+    if( p_input != NULL )
+    {
+        vlc_mutex_lock( &p_input->p->counters.counters_lock );
+        p_input->p->counters.i_video_drop_level = i_level;
+        if( b_escalation )
+            p_input->p->counters.i_video_drop_escalations++;
+        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+    }
+}
 
 /*****************************************************************************
  * Public functions
@@ -220,6 +437,15 @@ int decoder_GetDisplayRate( decoder_t *p_dec )
 
     return p_dec->pf_get_display_rate( p_dec );
 }
+/* decoder_GetDropLevel:
+ */
+int decoder_GetDropLevel( decoder_t *p_dec )
+{
+    if( !p_dec->pf_get_drop_level || p_dec->b_pace_control )
+        return DECODER_DROP_NONE;
+
+    return p_dec->pf_get_drop_level( p_dec );
+}
 
 /* TODO: pass p_sout through p_resource? -- Courmisch */
 static decoder_t *decoder_New( vlc_object_t *p_parent, input_thread_t *p_input,
@@ -231,9 +457,22 @@ static decoder_t *decoder_New( vlc_object_t *p_parent, input_thread_t *p_input,
     const char *psz_type = p_sout ? N_("packetizer") : N_("decoder");
     int i_priority;
 
+    /* Reuse an idle decoder of the previous input, if any */
+    if( p_input != NULL && p_sout == NULL &&
+        ( fmt->i_cat == AUDIO_ES || fmt->i_cat == VIDEO_ES ) &&
+        var_InheritBool( p_parent, "decoder-reuse" ) )
+        p_dec = input_resource_TakeDecoder( p_resource, fmt );
+    if( p_dec != NULL )
+    {
+        msg_Dbg( p_parent, "reusing decoder fourcc `%4.4s'",
+                 (char *)&fmt->i_codec );
+        p_dec->fmt_in.audio_gapless = fmt->audio_gapless;
+        DecoderInitRun( p_dec, p_parent, p_input );
+    }
+    else
     /* Create the decoder configuration structure */
-    p_dec = CreateDecoder( p_parent, p_input, fmt,
-                           p_sout != NULL, p_resource, p_sout );
+        p_dec = CreateDecoder( p_parent, p_input, fmt,
+                               p_sout != NULL, p_resource, p_sout );
     if( p_dec == NULL )
     {
         msg_Err( p_parent, "could not create %s", psz_type );
@@ -307,6 +546,15 @@ decoder_t *input_DecoderCreate( vlc_object_t *p_parent, es_format_t *fmt,
 void input_DecoderDelete( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const bool b_reuse = DecoderIsReusable( p_dec );
+
+    if( b_reuse )
+    {   /* Make the decoder drop its state and the pictures it holds */
+        vlc_mutex_lock( &p_owner->lock );
+        p_owner->b_keep_aout = DecoderIsGaplessEnd( p_dec );
+        DecoderFlush( p_dec );
+        vlc_mutex_unlock( &p_owner->lock );
+    }
 
     vlc_cancel( p_owner->thread );
 
@@ -321,7 +569,8 @@ void input_DecoderDelete( decoder_t *p_dec )
 
     vlc_join( p_owner->thread, NULL );
 
-    module_unneed( p_dec, p_dec->p_module );
+    if( !b_reuse )
+        module_unneed( p_dec, p_dec->p_module );
 
     /* */
     if( p_dec->p_owner->cc.b_supported )
@@ -331,10 +580,31 @@ void input_DecoderDelete( decoder_t *p_dec )
             input_DecoderSetCcState( p_dec, false, i );
     }
 
+    if( b_reuse )
+    {   /* Keep the decoder module for the next input */
+        msg_Dbg( p_dec, "keeping decoder fourcc `%4.4s'",
+                 (char*)&p_dec->fmt_in.i_codec );
+        DecoderTrickReset( p_dec );
+        block_FifoEmpty( p_owner->p_fifo );
+        DecoderReleaseOutputs( p_dec );
+        p_owner->p_input = NULL;
+        input_resource_PutDecoder( p_owner->p_resource, p_dec );
+        return;
+    }
+
     /* Delete decoder */
     DeleteDecoder( p_dec );
 }
 
+/**
+ * Destroys a decoder kept idle by the input resource
+ */
+void input_DecoderDeleteIdle( decoder_t *p_dec )
+{
+    module_unneed( p_dec, p_dec->p_module );
+    DeleteDecoder( p_dec );
+}
+
 /**
  * Put a block_t in the decoder's fifo.
  * Thread-safe w.r.t. the decoder. May be a cancellation point.
@@ -355,6 +625,16 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
         if( !p_owner->b_waiting )
             block_FifoPace( p_owner->p_fifo, 10, SIZE_MAX );
     }
+    else if( p_owner->b_low_latency &&
+             block_FifoSize( p_owner->p_fifo ) > DECODER_LOW_LATENCY_FIFO_SIZE )
+    {
+        /* Old data is worthless in low-latency mode: drop it rather than
+         * lag behind the source. */
+        msg_Warn( p_dec, "decoder fifo late, dropping %zu bytes",
+                  block_FifoSize( p_owner->p_fifo ) );
+        atomic_store( &p_owner->probe_block, 0 );
+        block_FifoEmpty( p_owner->p_fifo );
+    }
 #ifdef __arm__
     else if( block_FifoSize( p_owner->p_fifo ) > 50*1024*1024 /* 50 MiB */ )
 #else
@@ -365,9 +645,17 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
          * in the FIFO instead of its size. */
         msg_Warn( p_dec, "decoder/packetizer fifo full (data not "
                   "consumed quickly enough), resetting fifo!" );
+        atomic_store( &p_owner->probe_block, 0 );
         block_FifoEmpty( p_owner->p_fifo );
     }
 
+    if( ( p_dec->fmt_in.i_cat == VIDEO_ES || p_dec->fmt_in.i_cat == AUDIO_ES )
+     && atomic_load( &p_owner->probe_block ) == 0 )
+    {
+        DecoderUpdateFifoDepth( p_dec );
+        atomic_store( &p_owner->probe_date, mdate() );
+        atomic_store( &p_owner->probe_block, (uintptr_t)p_block );
+    }
     block_FifoPut( p_owner->p_fifo, p_block );
 }
 
@@ -385,7 +673,13 @@ bool input_DecoderIsEmpty( decoder_t * p_dec )
         if( p_dec->fmt_out.i_cat == VIDEO_ES && p_owner->p_vout )
             b_empty = vout_IsEmpty( p_owner->p_vout );
         else if( p_dec->fmt_out.i_cat == AUDIO_ES && p_owner->p_aout )
-            b_empty = aout_DecIsEmpty( p_owner->p_aout );
+        {
+            if( DecoderIsGaplessEnd( p_dec ) )
+                b_empty = aout_DecIsEnding( p_owner->p_aout,
+                                            DecoderGetGaplessLead( p_dec ) );
+            else
+                b_empty = aout_DecIsEmpty( p_owner->p_aout );
+        }
         vlc_mutex_unlock( &p_owner->lock );
     }
     return b_empty;
@@ -512,6 +806,15 @@ void input_DecoderChangeDelay( decoder_t *p_dec, mtime_t i_delay )
     vlc_mutex_unlock( &p_owner->lock );
 }
 
+void input_DecoderSetPrerollDate( decoder_t *p_dec, mtime_t i_date )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &p_owner->lock );
+    p_owner->i_preroll_date = i_date;
+    vlc_mutex_unlock( &p_owner->lock );
+}
+
 void input_DecoderStartWait( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
@@ -558,6 +861,17 @@ void input_DecoderWait( decoder_t *p_dec )
     vlc_mutex_unlock( &p_owner->lock );
 }
 
+void input_DecoderSetTrickMode( decoder_t *p_dec, int i_trick, int i_rate )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &p_owner->lock );
+    DecoderFlush( p_dec );
+    atomic_store( &p_owner->trick.i_mode, i_trick );
+    atomic_store( &p_owner->trick.i_rate, i_rate );
+    vlc_mutex_unlock( &p_owner->lock );
+}
+
 void input_DecoderFrameNext( decoder_t *p_dec, mtime_t *pi_duration )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
@@ -671,6 +985,20 @@ static int DecoderGetDisplayRate( decoder_t *p_dec )
         return INPUT_RATE_DEFAULT;
     return input_clock_GetRate( p_owner->p_clock );
 }
+static int DecoderGetDropLevel( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    switch( atomic_load( &p_owner->trick.i_mode ) )
+    {
+        case INPUT_TRICK_KEYFRAMES:
+            return DECODER_DROP_NONKEY;
+        case INPUT_TRICK_REVERSE:
+            return DECODER_DROP_NONE;
+        default:
+            return p_owner->drop.i_level;
+    }
+}
 
 /* */
 static void DecoderUnsupportedCodec( decoder_t *p_dec, vlc_fourcc_t codec )
@@ -735,20 +1063,11 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         vlc_object_release( p_dec );
         return NULL;
     }
-    p_owner->i_preroll_end = VLC_TS_INVALID;
-    p_owner->i_last_rate = INPUT_RATE_DEFAULT;
-    p_owner->p_input = p_input;
     p_owner->p_resource = p_resource;
-    p_owner->p_aout = NULL;
-    p_owner->p_vout = NULL;
-    p_owner->p_spu_vout = NULL;
-    p_owner->i_spu_channel = 0;
-    p_owner->i_spu_order = 0;
     p_owner->p_sout = p_sout;
-    p_owner->p_sout_input = NULL;
     p_owner->p_packetizer = NULL;
     p_owner->b_packetizer = b_packetizer;
-    es_format_Init( &p_owner->fmt, UNKNOWN_ES, 0 );
+    DecoderInitRun( p_dec, p_parent, p_input );
 
     /* decoder fifo */
     p_owner->p_fifo = block_FifoNew();
@@ -768,6 +1087,7 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_dec->pf_get_attachments  = DecoderGetInputAttachments;
     p_dec->pf_get_display_date = DecoderGetDisplayDate;
     p_dec->pf_get_display_rate = DecoderGetDisplayRate;
+    p_dec->pf_get_drop_level   = DecoderGetDropLevel;
 
     /* Find a suitable decoder/packetizer module */
     if( !b_packetizer )
@@ -825,6 +1145,53 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     vlc_cond_init( &p_owner->wait_request );
     vlc_cond_init( &p_owner->wait_acknowledge );
 
+    /* */
+    p_owner->cc.b_supported = false;
+    if( !b_packetizer )
+    {
+        if( p_owner->p_packetizer && p_owner->p_packetizer->pf_get_cc )
+            p_owner->cc.b_supported = true;
+        if( p_dec->pf_get_cc )
+            p_owner->cc.b_supported = true;
+    }
+    return p_dec;
+}
+
+/**
+ * Initializes the state of a decoder for a run, when it is created or
+ * reused (see input_resource_TakeDecoder())
+ */
+static void DecoderInitRun( decoder_t *p_dec, vlc_object_t *p_parent,
+                            input_thread_t *p_input )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    p_owner->i_preroll_end = VLC_TS_INVALID;
+    p_owner->i_preroll_date = VLC_TS_INVALID;
+    p_owner->i_last_rate = INPUT_RATE_DEFAULT;
+    p_owner->p_input = p_input;
+    p_owner->p_aout = NULL;
+    p_owner->p_vout = NULL;
+    p_owner->p_spu_vout = NULL;
+    p_owner->i_spu_channel = 0;
+    p_owner->i_spu_order = 0;
+    p_owner->p_sout_input = NULL;
+    es_format_Init( &p_owner->fmt, UNKNOWN_ES, 0 );
+    p_owner->b_low_latency = var_InheritBool( p_parent, "low-latency" );
+    atomic_init( &p_owner->probe_block, 0 );
+    atomic_init( &p_owner->probe_date, 0 );
+    p_owner->drop.b_enabled = p_dec->fmt_in.i_cat == VIDEO_ES &&
+                              !p_owner->b_packetizer &&
+                              !p_owner->b_low_latency &&
+                              var_InheritBool( p_parent, "skip-frames" );
+    p_owner->drop.i_level = DECODER_DROP_NONE;
+    DecoderResetDropLevel( p_dec );
+    atomic_init( &p_owner->trick.i_mode, INPUT_TRICK_NONE );
+    atomic_init( &p_owner->trick.i_rate, INPUT_RATE_DEFAULT );
+    p_owner->trick.b_typed = false;
+    p_owner->trick.i_gop = 0;
+    p_owner->trick.i_next_date = VLC_TS_INVALID;
+
     p_owner->b_fmt_description = false;
     p_owner->p_description = NULL;
 
@@ -840,15 +1207,12 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
 
     p_owner->b_flushing = false;
 
-    /* */
-    p_owner->cc.b_supported = false;
-    if( !b_packetizer )
-    {
-        if( p_owner->p_packetizer && p_owner->p_packetizer->pf_get_cc )
-            p_owner->cc.b_supported = true;
-        if( p_dec->pf_get_cc )
-            p_owner->cc.b_supported = true;
-    }
+    p_owner->b_gapless = p_dec->fmt_in.i_cat == AUDIO_ES &&
+                         !p_owner->b_packetizer &&
+                         var_InheritBool( p_parent, "gapless" );
+    p_owner->b_aout_join = p_owner->b_gapless;
+    p_owner->b_keep_aout = false;
+    atomic_init( &p_owner->drained, false );
 
     for( unsigned i = 0; i < 4; i++ )
     {
@@ -856,7 +1220,6 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         p_owner->cc.pp_decoder[i] = NULL;
     }
     p_owner->i_ts_delay = 0;
-    return p_dec;
 }
 
 /**
@@ -874,6 +1237,14 @@ static void *DecoderThread( void *p_data )
     {
         block_t *p_block = block_FifoGet( p_owner->p_fifo );
 
+        if( p_block != NULL
+         && atomic_load( &p_owner->probe_block ) == (uintptr_t)p_block )
+        {
+            DecoderUpdateLatency( p_dec, LATENCY_QUEUE,
+                                  mdate() - atomic_load( &p_owner->probe_date ) );
+            atomic_store( &p_owner->probe_block, 0 );
+        }
+
         /* Make sure there is no cancellation point other than this one^^.
          * If you need one, be sure to push cleanup of p_block. */
         bool end_wait = !p_block || p_block->i_flags & BLOCK_FLAG_CORE_EOS;
@@ -892,8 +1263,19 @@ static void *DecoderThread( void *p_data )
                 block_Release( p_block );
                 p_block = NULL;
             }
+            else if( !(p_block->i_flags & BLOCK_FLAG_CORE_FLUSH) )
+                atomic_store( &p_owner->drained, false );
 
+            vlc_trace_Begin( "decoder" );
             DecoderProcess( p_dec, p_block );
+            vlc_trace_End( "decoder" );
+
+            if( p_block == NULL )
+                atomic_store( &p_owner->drained, true );
+
+            /* A drained decoder has received a whole GOP in reverse play */
+            if( p_block == NULL && p_dec->fmt_out.i_cat == VIDEO_ES )
+                DecoderTrickOutputGop( p_dec );
 
             vlc_restorecancel( canc );
         }
@@ -922,6 +1304,7 @@ static void DecoderFlush( decoder_t *p_dec )
     vlc_assert_locked( &p_owner->lock );
 
     /* Empty the fifo */
+    atomic_store( &p_owner->probe_block, 0 );
     block_FifoEmpty( p_owner->p_fifo );
 
     p_owner->b_waiting = false;
@@ -1095,6 +1478,36 @@ static void DecoderWaitDate( decoder_t *p_dec,
                                i_deadline ) == 0 );
 }
 
+/**
+ * Moves the clock of the input so that its first audio block continues the
+ * samples left playing by the previous input (see aout_DecDeleteGapless())
+ */
+static void DecoderJoinAudio( decoder_t *p_dec, audio_output_t *p_aout,
+                              block_t *p_audio, int i_rate )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_owner->p_clock == NULL || i_rate != INPUT_RATE_DEFAULT ||
+        p_audio->i_pts <= VLC_TS_INVALID )
+        return;
+
+    const mtime_t i_date = aout_DecGetJoinDate( p_aout );
+    if( i_date <= VLC_TS_INVALID )
+        return;
+
+    const mtime_t i_shift = i_date - p_audio->i_pts;
+    if( llabs( i_shift ) > DECODER_GAPLESS_MAX_SHIFT )
+        return;
+
+    mtime_t i_system;
+    input_clock_GetSystemOrigin( p_owner->p_clock, &i_system, NULL );
+    input_clock_ChangeSystemOrigin( p_owner->p_clock, true,
+                                    i_system + i_shift );
+    p_audio->i_pts += i_shift;
+    msg_Dbg( p_dec, "continuing the previous audio (%"PRId64" us shift)",
+             i_shift );
+}
+
 static void DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
                               int *pi_played_sum, int *pi_lost_sum )
 {
@@ -1136,13 +1549,20 @@ static void DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
         DecoderFixTs( p_dec, &p_audio->i_pts, NULL, &p_audio->i_length,
                       &i_rate, AOUT_MAX_ADVANCE_TIME );
 
+        if( p_owner->b_aout_join && p_aout != NULL )
+        {
+            p_owner->b_aout_join = false;
+            DecoderJoinAudio( p_dec, p_aout, p_audio, i_rate );
+        }
+
         if( p_audio->i_pts <= VLC_TS_INVALID
          || i_rate < INPUT_RATE_DEFAULT/AOUT_MAX_INPUT_RATE
          || i_rate > INPUT_RATE_DEFAULT*AOUT_MAX_INPUT_RATE )
             b_reject = true;
 
-        DecoderWaitDate( p_dec, &b_reject,
-                         p_audio->i_pts - AOUT_MAX_PREPARE_TIME );
+        if( !p_owner->b_low_latency )
+            DecoderWaitDate( p_dec, &b_reject,
+                             p_audio->i_pts - AOUT_MAX_PREPARE_TIME );
 
         if( unlikely(p_owner->b_paused != b_paused) )
             continue; /* race with input thread? retry... */
@@ -1152,8 +1572,12 @@ static void DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
         if( !b_reject )
         {
             assert( !p_owner->b_paused );
+            const mtime_t i_output_delay = p_audio->i_pts - mdate();
             if( !aout_DecPlay( p_aout, p_audio, i_rate ) )
+            {
                 *pi_played_sum += 1;
+                DecoderUpdateLatency( p_dec, LATENCY_OUTPUT, i_output_delay );
+            }
             *pi_lost_sum += aout_DecGetResetLost( p_aout );
         }
         else
@@ -1168,6 +1592,104 @@ static void DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
     vlc_mutex_unlock( &p_owner->lock );
 }
 
+/**
+ * Cuts the priming and padding samples of the stream (see audio_gapless_t)
+ * out of a decoded audio block.
+ *
+ * \return the block, or NULL if it was all cut out (and released)
+ */
+static block_t *DecoderTrimAudio( decoder_t *p_dec, block_t *p_block )
+{
+    const audio_gapless_t *p_gapless = &p_dec->fmt_in.audio_gapless;
+    const unsigned i_rate = p_dec->fmt_out.audio.i_rate;
+
+    if( ( p_gapless->i_delay == 0 && p_gapless->i_samples == 0 ) ||
+        i_rate == 0 || p_block->i_nb_samples == 0 ||
+        p_block->i_pts <= VLC_TS_INVALID )
+        return p_block;
+
+    /* Positions in samples from the start of the stream */
+    const int64_t i_start = p_gapless->i_delay;
+    const int64_t i_end = p_gapless->i_samples > 0
+                        ? i_start + (int64_t)p_gapless->i_samples : INT64_MAX;
+    int64_t i_pos = ( p_block->i_pts - VLC_TS_0 ) * i_rate / CLOCK_FREQ;
+    const size_t i_frame_size = p_block->i_buffer / p_block->i_nb_samples;
+
+    if( i_pos >= i_end || i_pos + p_block->i_nb_samples <= i_start )
+    {
+        block_Release( p_block );
+        return NULL;
+    }
+
+    if( i_pos < i_start )
+    {
+        const unsigned i_skip = i_start - i_pos;
+
+        p_block->p_buffer += i_skip * i_frame_size;
+        p_block->i_buffer -= i_skip * i_frame_size;
+        p_block->i_nb_samples -= i_skip;
+        p_block->i_pts += CLOCK_FREQ * i_skip / i_rate;
+        p_block->i_dts = p_block->i_pts;
+        i_pos = i_start;
+    }
+    if( i_end - i_pos < p_block->i_nb_samples )
+    {
+        const unsigned i_cut = i_pos + p_block->i_nb_samples - i_end;
+
+        p_block->i_buffer -= i_cut * i_frame_size;
+        p_block->i_nb_samples -= i_cut;
+    }
+    p_block->i_length = CLOCK_FREQ * p_block->i_nb_samples / i_rate;
+    return p_block;
+}
+
+/**
+ * Cuts the samples before the exact end of the preroll (see
+ * input_DecoderSetPrerollDate()) out of the decoded audio, so that a seek
+ * resumes on the requested sample rather than on a frame boundary.
+ *
+ * \return the block, or NULL if it was all cut out (and released)
+ */
+static block_t *DecoderTrimPreroll( decoder_t *p_dec, block_t *p_block )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const unsigned i_rate = p_dec->fmt_out.audio.i_rate;
+
+    vlc_mutex_lock( &p_owner->lock );
+    const mtime_t i_date = p_owner->i_preroll_date;
+    vlc_mutex_unlock( &p_owner->lock );
+
+    if( i_date <= VLC_TS_INVALID || p_block->i_pts <= VLC_TS_INVALID ||
+        i_rate == 0 || p_block->i_nb_samples == 0 )
+        return p_block;
+
+    const mtime_t i_end = p_block->i_pts +
+                          CLOCK_FREQ * p_block->i_nb_samples / i_rate;
+    if( i_end <= i_date )
+    {
+        block_Release( p_block );
+        return NULL;
+    }
+
+    if( p_block->i_pts < i_date )
+    {
+        const size_t i_frame_size = p_block->i_buffer / p_block->i_nb_samples;
+        const unsigned i_skip = ( i_date - p_block->i_pts ) * i_rate / CLOCK_FREQ;
+
+        p_block->p_buffer += i_skip * i_frame_size;
+        p_block->i_buffer -= i_skip * i_frame_size;
+        p_block->i_nb_samples -= i_skip;
+        p_block->i_pts += CLOCK_FREQ * i_skip / i_rate;
+        p_block->i_dts = p_block->i_pts;
+        p_block->i_length = CLOCK_FREQ * p_block->i_nb_samples / i_rate;
+    }
+
+    vlc_mutex_lock( &p_owner->lock );
+    p_owner->i_preroll_date = VLC_TS_INVALID;
+    vlc_mutex_unlock( &p_owner->lock );
+    return p_block;
+}
+
 static void DecoderDecodeAudio( decoder_t *p_dec, block_t *p_block )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
@@ -1175,13 +1697,21 @@ static void DecoderDecodeAudio( decoder_t *p_dec, block_t *p_block )
     int i_decoded = 0;
     int i_lost = 0;
     int i_played = 0;
+    const bool b_timed = p_block != NULL;
+    mtime_t i_decode_time = 0;
 
     if (!p_block) {
         /* Play a NULL block to output buffered frames */
         DecoderPlayAudio( p_dec, NULL, &i_played, &i_lost );
     }
-    else while( (p_aout_buf = p_dec->pf_decode_audio( p_dec, &p_block )) )
+    else for( ;; )
     {
+        const mtime_t i_start = mdate();
+        p_aout_buf = p_dec->pf_decode_audio( p_dec, &p_block );
+        i_decode_time += mdate() - i_start;
+        if( p_aout_buf == NULL )
+            break;
+
         if( DecoderIsExitRequested( p_dec ) )
         {
             /* It prevent freezing VLC in case of broken decoder */
@@ -1208,19 +1738,28 @@ static void DecoderDecodeAudio( decoder_t *p_dec, block_t *p_block )
             p_owner->i_preroll_end = VLC_TS_INVALID;
         }
 
+        p_aout_buf = DecoderTrimPreroll( p_dec, p_aout_buf );
+        if( p_aout_buf == NULL )
+            continue;
+
+        p_aout_buf = DecoderTrimAudio( p_dec, p_aout_buf );
+        if( p_aout_buf == NULL )
+            continue;
+
         DecoderPlayAudio( p_dec, p_aout_buf, &i_played, &i_lost );
     }
 
+    if( b_timed )
+        DecoderUpdateLatency( p_dec, LATENCY_DECODE, i_decode_time );
+
     /* Update ugly stat */
     input_thread_t  *p_input = p_owner->p_input;
 
     if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_played > 0) )
     {
-        vlc_mutex_lock( &p_input->p->counters.counters_lock);
         stats_Update( p_input->p->counters.p_lost_abuffers, i_lost, NULL );
         stats_Update( p_input->p->counters.p_played_abuffers, i_played, NULL );
         stats_Update( p_input->p->counters.p_decoded_audio, i_decoded, NULL );
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock);
     }
 }
 static void DecoderGetCc( decoder_t *p_dec, decoder_t *p_dec_cc )
@@ -1267,6 +1806,55 @@ static void DecoderGetCc( decoder_t *p_dec, decoder_t *p_dec_cc )
         block_Release( p_cc );
 }
 
+/* Releases the cached GOP */
+static void DecoderTrickReset( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    for( int i = 0; i < p_owner->trick.i_gop; i++ )
+        picture_Release( p_owner->trick.pp_gop[i] );
+    p_owner->trick.i_gop = 0;
+    p_owner->trick.i_next_date = VLC_TS_INVALID;
+}
+
+/* Tells if a block must be dropped before decoding, in key frame trick play
+ * (once the stream has shown that it flags the frame types) */
+static bool DecoderTrickSkip( decoder_t *p_dec, const block_t *p_block )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    if( p_block->i_flags & BLOCK_FLAG_TYPE_MASK )
+        p_owner->trick.b_typed = true;
+
+    return atomic_load( &p_owner->trick.i_mode ) == INPUT_TRICK_KEYFRAMES &&
+           p_owner->trick.b_typed &&
+           !(p_block->i_flags & (BLOCK_FLAG_TYPE_I|BLOCK_FLAG_DISCONTINUITY));
+}
+
+/* Keeps a copy of a decoded picture of the GOP played backward, so that the
+ * video output pool is not held. Returns false if it cannot be copied. */
+static bool DecoderTrickCache( decoder_t *p_dec, picture_t *p_picture )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    picture_t *p_copy = picture_NewFromFormat( &p_picture->format );
+    if( p_copy == NULL )
+        return false;
+    picture_Copy( p_copy, p_picture );
+    picture_Release( p_picture );
+
+    if( p_owner->trick.i_gop == DECODER_TRICK_GOP_MAX )
+    {
+        /* Keep the end of the GOP, which is displayed first */
+        picture_Release( p_owner->trick.pp_gop[0] );
+        memmove( &p_owner->trick.pp_gop[0], &p_owner->trick.pp_gop[1],
+                 ( DECODER_TRICK_GOP_MAX - 1 ) * sizeof( picture_t * ) );
+        p_owner->trick.i_gop--;
+    }
+    p_owner->trick.pp_gop[p_owner->trick.i_gop++] = p_copy;
+    return true;
+}
+
 static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
                               int *pi_played_sum, int *pi_lost_sum )
 {
@@ -1281,6 +1869,10 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
         return;
     }
 
+    const int i_trick = atomic_load( &p_owner->trick.i_mode );
+    if( i_trick == INPUT_TRICK_REVERSE && DecoderTrickCache( p_dec, p_picture ) )
+        return;
+
     /* */
     vlc_mutex_lock( &p_owner->lock );
 
@@ -1303,11 +1895,24 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
 
     const bool b_dated = p_picture->date > VLC_TS_INVALID;
     int i_rate = INPUT_RATE_DEFAULT;
-    DecoderFixTs( p_dec, &p_picture->date, NULL, NULL,
-                  &i_rate, DECODER_BOGUS_VIDEO_DELAY );
+    /* The clock is not fed in trick play */
+    if( i_trick == INPUT_TRICK_NONE )
+        DecoderFixTs( p_dec, &p_picture->date, NULL, NULL,
+                      &i_rate, DECODER_BOGUS_VIDEO_DELAY );
 
     vlc_mutex_unlock( &p_owner->lock );
 
+    mtime_t i_output_delay = 0;
+    if( p_owner->b_low_latency || i_trick != INPUT_TRICK_NONE )
+    {
+        /* Present the picture as soon as it is decoded */
+        if( p_picture->date > VLC_TS_INVALID )
+            p_picture->date = mdate();
+        p_picture->b_force = true;
+    }
+    else if( p_picture->date > VLC_TS_INVALID )
+        i_output_delay = __MAX( p_picture->date - mdate(), 0 );
+
     /* */
     if( !p_picture->b_force && p_picture->date <= VLC_TS_INVALID ) // FIXME --VLC_TS_INVALID verify video_output/*
         b_reject = true;
@@ -1320,7 +1925,12 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
             vout_Flush( p_vout, p_picture->date );
             p_owner->i_last_rate = i_rate;
         }
+        const mtime_t i_lateness = p_picture->b_force ? 0
+                                 : mdate() - p_picture->date;
         vout_PutPicture( p_vout, p_picture );
+        DecoderUpdateLatency( p_dec, LATENCY_OUTPUT, i_output_delay );
+        if( i_trick == INPUT_TRICK_NONE )
+            DecoderUpdateDropLevel( p_dec, i_lateness );
     }
     else
     {
@@ -1338,6 +1948,8 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
 
     *pi_played_sum += i_tmp_display;
     *pi_lost_sum += i_tmp_lost;
+    for( int i = 0; i < i_tmp_lost && i_trick == INPUT_TRICK_NONE; i++ )
+        DecoderUpdateDropLevel( p_dec, DECODER_DROP_LOST_LATENESS );
 }
 
 static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
@@ -1347,9 +1959,25 @@ static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
     int i_lost = 0;
     int i_decoded = 0;
     int i_displayed = 0;
+    const bool b_timed = p_block != NULL;
+    const bool b_degraded = p_block != NULL &&
+                            p_owner->drop.i_level != DECODER_DROP_NONE;
+    mtime_t i_decode_time = 0;
+
+    if( p_block != NULL && DecoderTrickSkip( p_dec, p_block ) )
+    {
+        block_Release( p_block );
+        return;
+    }
 
-    while( (p_pic = p_dec->pf_decode_video( p_dec, &p_block )) )
+    for( ;; )
     {
+        const mtime_t i_start = mdate();
+        p_pic = p_dec->pf_decode_video( p_dec, &p_block );
+        i_decode_time += mdate() - i_start;
+        if( p_pic == NULL )
+            break;
+
         vout_thread_t  *p_vout = p_owner->p_vout;
         if( DecoderIsExitRequested( p_dec ) )
         {
@@ -1362,7 +1990,9 @@ static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
 
         i_decoded++;
 
-        if( p_owner->i_preroll_end > VLC_TS_INVALID && p_pic->date < p_owner->i_preroll_end )
+        /* Show the first picture right away in low-latency mode */
+        if( p_owner->i_preroll_end > VLC_TS_INVALID && p_pic->date < p_owner->i_preroll_end
+         && !p_owner->b_low_latency )
         {
             picture_Release( p_pic );
             continue;
@@ -1384,17 +2014,82 @@ static void DecoderDecodeVideo( decoder_t *p_dec, block_t *p_block )
         DecoderPlayVideo( p_dec, p_pic, &i_displayed, &i_lost );
     }
 
+    if( b_timed )
+        DecoderUpdateLatency( p_dec, LATENCY_DECODE, i_decode_time );
+
     /* Update ugly stat */
     input_thread_t *p_input = p_owner->p_input;
 
-    if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_displayed > 0) )
+    if( p_input != NULL && (i_decoded > 0 || i_lost > 0 || i_displayed > 0 ||
+                            b_degraded) )
     {
-        vlc_mutex_lock( &p_input->p->counters.counters_lock );
+        if( b_degraded )
+        {
+            vlc_mutex_lock( &p_input->p->counters.counters_lock );
+            p_input->p->counters.i_video_degraded_blocks++;
+            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+        }
         stats_Update( p_input->p->counters.p_decoded_video, i_decoded, NULL );
         stats_Update( p_input->p->counters.p_lost_pictures, i_lost , NULL);
         stats_Update( p_input->p->counters.p_displayed_pictures,
                       i_displayed, NULL);
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+    }
+}
+
+/* Displays the cached GOP backward at the trick play rate, once the decoder
+ * has been drained, then resets the decoder for the previous GOP */
+static void DecoderTrickOutputGop( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    const int i_gop = p_owner->trick.i_gop;
+
+    if( i_gop == 0 )
+        return;
+
+    const int i_rate = abs( atomic_load( &p_owner->trick.i_rate ) );
+    const mtime_t i_last = p_owner->trick.pp_gop[i_gop - 1]->date;
+    const mtime_t i_origin = __MAX( mdate(), p_owner->trick.i_next_date );
+
+    p_owner->trick.i_next_date = i_origin +
+        ( i_last - p_owner->trick.pp_gop[0]->date ) * i_rate / INPUT_RATE_DEFAULT;
+
+    for( int i = i_gop - 1; i >= 0; i-- )
+    {
+        picture_t *p_cached = p_owner->trick.pp_gop[i];
+        picture_t *p_picture = NULL;
+
+        if( !DecoderIsExitRequested( p_dec ) && p_owner->p_vout != NULL )
+            p_picture = vout_new_buffer( p_dec );
+        if( p_picture != NULL )
+        {
+            picture_Copy( p_picture, p_cached );
+            p_picture->date = i_origin +
+                ( i_last - p_cached->date ) * i_rate / INPUT_RATE_DEFAULT;
+            p_picture->b_force = false;
+            vout_PutPicture( p_owner->p_vout, p_picture );
+        }
+        picture_Release( p_cached );
+    }
+    p_owner->trick.i_gop = 0;
+
+    /* The previous GOP does not follow this one */
+    if( p_owner->p_packetizer )
+    {
+        block_t *p_null = DecoderBlockFlushNew();
+        if( p_null )
+        {
+            p_null->i_flags &= ~BLOCK_FLAG_CORE_PRIVATE_MASK;
+            block_t *p_out = p_owner->p_packetizer->pf_packetize(
+                                            p_owner->p_packetizer, &p_null );
+            if( p_out )
+                block_ChainRelease( p_out );
+        }
+    }
+    block_t *p_null = DecoderBlockFlushNew();
+    if( p_null )
+    {
+        p_null->i_flags &= ~BLOCK_FLAG_CORE_PRIVATE_MASK;
+        DecoderDecodeVideo( p_dec, p_null );
     }
 }
 
@@ -1646,7 +2341,7 @@ static void DecoderProcessAudio( decoder_t *p_dec, block_t *p_block, bool b_flus
         DecoderDecodeAudio( p_dec, p_block );
     }
 
-    if( b_flush && p_owner->p_aout )
+    if( b_flush && p_owner->p_aout && !p_owner->b_keep_aout )
         aout_DecFlush( p_owner->p_aout );
 }
 
@@ -1663,11 +2358,7 @@ static void DecoderProcessSpu( decoder_t *p_dec, block_t *p_block, bool b_flush
     while( (p_spu = p_dec->pf_decode_sub( p_dec, p_block ? &p_block : NULL ) ) )
     {
         if( p_input != NULL )
-        {
-            vlc_mutex_lock( &p_input->p->counters.counters_lock );
             stats_Update( p_input->p->counters.p_decoded_sub, 1, NULL );
-            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
-        }
 
         p_vout = input_resource_HoldVout( p_owner->p_resource );
         if( p_vout && p_owner->p_spu_vout == p_vout )
@@ -1758,6 +2449,12 @@ static void DecoderProcess( decoder_t *p_dec, block_t *p_block )
     {
         bool b_flush = false;
 
+        if( b_flush_request )
+        {
+            DecoderResetDropLevel( p_dec );
+            DecoderTrickReset( p_dec );
+        }
+
         if( p_block )
         {
             const bool b_flushing = p_owner->i_preroll_end == INT64_MAX;
@@ -1794,29 +2491,37 @@ flush:
 }
 
 /**
- * Destroys a decoder object
- *
- * \param p_dec the decoder object
- * \return nothing
+ * Checks if a stopped decoder can be kept for the next input, that is,
+ * if it decodes the audio or video of an input for display.
  */
-static void DeleteDecoder( decoder_t * p_dec )
+static bool DecoderIsReusable( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
-    msg_Dbg( p_dec, "killing decoder fourcc `%4.4s', %u PES in FIFO",
-             (char*)&p_dec->fmt_in.i_codec,
-             (unsigned)block_FifoCount( p_owner->p_fifo ) );
+    return p_owner->p_input != NULL && !p_owner->b_packetizer &&
+           !p_dec->b_error && p_dec->p_module != NULL &&
+           ( p_dec->fmt_in.i_cat == AUDIO_ES ||
+             p_dec->fmt_in.i_cat == VIDEO_ES ) &&
+           var_InheritBool( p_dec, "decoder-reuse" );
+}
 
-    /* Free all packets still in the decoder fifo. */
-    block_FifoEmpty( p_owner->p_fifo );
-    block_FifoRelease( p_owner->p_fifo );
+/**
+ * Gives the outputs of a decoder back to the input resource
+ */
+static void DecoderReleaseOutputs( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
-    /* Cleanup */
     if( p_owner->p_aout )
     {
-        /* TODO: REVISIT gap-less audio */
-        aout_DecFlush( p_owner->p_aout );
-        aout_DecDelete( p_owner->p_aout );
+        if( DecoderIsGaplessEnd( p_dec ) )
+            /* Leave the last samples playing for the next input */
+            aout_DecDeleteGapless( p_owner->p_aout );
+        else
+        {
+            aout_DecFlush( p_owner->p_aout );
+            aout_DecDelete( p_owner->p_aout );
+        }
         input_resource_PutAout( p_owner->p_resource, p_owner->p_aout );
         if( p_owner->p_input != NULL )
             input_SendEventAout( p_owner->p_input );
@@ -1853,12 +2558,40 @@ static void DeleteDecoder( decoder_t * p_dec )
         }
     }
 
+    if( p_owner->p_description )
+        vlc_meta_Delete( p_owner->p_description );
+    p_owner->p_description = NULL;
+    p_owner->p_aout = NULL;
+    p_owner->p_vout = NULL;
+    p_owner->p_sout_input = NULL;
+}
+
+/**
+ * Destroys a decoder object
+ *
+ * \param p_dec the decoder object
+ * \return nothing
+ */
+static void DeleteDecoder( decoder_t * p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    msg_Dbg( p_dec, "killing decoder fourcc `%4.4s', %u PES in FIFO",
+             (char*)&p_dec->fmt_in.i_codec,
+             (unsigned)block_FifoCount( p_owner->p_fifo ) );
+
+    /* Free all packets still in the decoder fifo. */
+    DecoderTrickReset( p_dec );
+    block_FifoEmpty( p_owner->p_fifo );
+    block_FifoRelease( p_owner->p_fifo );
+
+    /* Cleanup */
+    DecoderReleaseOutputs( p_dec );
+
     es_format_Clean( &p_dec->fmt_in );
     es_format_Clean( &p_dec->fmt_out );
     if( p_dec->p_description )
         vlc_meta_Delete( p_dec->p_description );
-    if( p_owner->p_description )
-        vlc_meta_Delete( p_owner->p_description );
 
     if( p_owner->p_packetizer )
     {
@@ -34,6 +34,12 @@
 decoder_t *input_DecoderNew( input_thread_t *, es_format_t *, input_clock_t *,
                              sout_instance_t * ) VLC_USED;
 
+/**
+ * This function destroys a decoder kept idle by the input resource
+ * (see input_resource_PutDecoder()).
+ */
+void input_DecoderDeleteIdle( decoder_t * );
+
 /**
  * This function changes the pause state.
  * The date parameter MUST hold the exact date at wich the change has been
@@ -46,6 +52,13 @@ void input_DecoderChangePause( decoder_t *, bool b_paused, mtime_t i_date );
  */
 void input_DecoderChangeDelay( decoder_t *, mtime_t i_delay );
 
+/**
+ * This function sets the exact date at which the audio output of the
+ * decoder must resume after a preroll. The samples of the first decoded
+ * block that are before this date are cut out.
+ */
+void input_DecoderSetPrerollDate( decoder_t *, mtime_t i_date );
+
 /**
  * This function makes the decoder start waiting for a valid data block from its fifo.
  */
@@ -83,6 +96,13 @@ int input_DecoderGetCcState( decoder_t *, bool *pb_decode, int i_channel );
  */
 void input_DecoderIsCcPresent( decoder_t *, bool pb_present[4] );
 
+/**
+ * This function flushes the decoder and changes its trick play mode.
+ * In reverse mode, a GOP is displayed once the decoder is drained (see
+ * ES_OUT_SET_EOS), at the given (negative) rate.
+ */
+void input_DecoderSetTrickMode( decoder_t *, int i_trick, int i_rate );
+
 /**
  * This function force the display of the next picture and fills the stream
  * time consumed.
@@ -34,6 +34,9 @@
 
 static bool SkipID3Tag( demux_t * );
 static bool SkipAPETag( demux_t *p_demux );
+static void ProbeHints( demux_t *p_demux, const char *psz_ext_module,
+                        char *psz_list, size_t i_size );
+static void ProbeCachePut( demux_t *p_demux );
 
 /* Decode URL (which has had its scheme stripped earlier) to a file path. */
 /* XXX: evil code duplication from access.c */
@@ -143,7 +146,10 @@ demux_t *demux_New( vlc_object_t *p_obj, input_thread_t *p_parent_input,
         const char *psz_ext;
         const char *psz_module = p_demux->psz_demux;
 
-        if( !strcmp(psz_module, "any") && p_demux->psz_file != NULL
+        const bool b_any = !strcmp( psz_module, "any" );
+        char psz_hints[64];
+
+        if( b_any && p_demux->psz_file != NULL
          && (psz_ext = strrchr( p_demux->psz_file, '.' )) != NULL )
         {
             psz_ext++; // skip '.'
@@ -179,9 +185,20 @@ demux_t *demux_New( vlc_object_t *p_obj, input_thread_t *p_parent_input,
           ;
         SkipAPETag( p_demux );
 
+        /* Try the demuxers hinted by the stream first */
+        if( b_any )
+        {
+            ProbeHints( p_demux, psz_module, psz_hints, sizeof(psz_hints) );
+            if( psz_hints[0] != '\0' )
+                psz_module = psz_hints;
+        }
+
         p_demux->p_module =
             module_need( p_demux, "demux", psz_module,
                          !strcmp( psz_module, p_demux->psz_demux ) );
+
+        if( b_any && p_demux->p_module != NULL )
+            ProbeCachePut( p_demux );
     }
     else
     {
@@ -202,6 +219,199 @@ error:
     return NULL;
 }
 
+/*****************************************************************************
+ * Probe hints
+ *****************************************************************************
+ * A demuxer normally probes the stream only after all the demuxers of higher
+ * score failed to. To save those probes, the demuxers with a strong detection
+ * are tried first when the stream hints at them: by signature, by extension,
+ * by MIME type, or because they opened the last stream of the same location.
+ *****************************************************************************/
+
+/* Signatures at the start of the stream, after the ID3/APE tags */
+static const struct
+{
+    uint8_t i_offset;
+    uint8_t i_length;
+    char    magic[4];
+    char    demux[5];
+} probe_magic[] =
+{
+    { 0, 4, "\x1A\x45\xDF\xA3", "mkv" },
+    { 0, 4, "OggS", "ogg" },
+    { 0, 4, "fLaC", "flac" },
+    { 8, 4, "AVI ", "avi" },
+    { 8, 4, "WAVE", "wav" },
+    { 8, 4, "AIFF", "aiff" },
+    { 4, 4, "ftyp", "mp4" }, { 4, 4, "moov", "mp4" },
+    { 0, 4, "\x30\x26\xB2\x75", "asf" },
+    { 0, 4, ".snd", "au" },
+    { 0, 4, "NSVf", "nsv" }, { 0, 4, "NSVs", "nsv" },
+    { 0, 4, "MThd", "smf" },
+    { 0, 4, "\x00\x00\x01\xBA", "ps" },
+};
+
+/* MIME types of the HTTP content type */
+static const struct { char mime[18]; char demux[5]; } probe_mime[] =
+{
+    { "video/mp4", "mp4" }, { "audio/mp4", "mp4" },
+    { "video/quicktime", "mp4" },
+    { "video/x-matroska", "mkv" }, { "audio/x-matroska", "mkv" },
+    { "video/webm", "mkv" }, { "audio/webm", "mkv" },
+    { "application/ogg", "ogg" }, { "audio/ogg", "ogg" },
+    { "video/ogg", "ogg" },
+    { "audio/flac", "flac" }, { "audio/x-flac", "flac" },
+    { "video/x-msvideo", "avi" },
+    { "video/x-ms-asf", "asf" }, { "video/x-ms-wmv", "asf" },
+    { "audio/x-ms-wma", "asf" },
+    { "video/mp2t", "ts" },
+    { "", "" },
+};
+
+/* Demuxer which opened the last stream of a location prefix */
+#define PROBE_CACHE_SIZE 16
+static vlc_mutex_t probe_cache_lock = VLC_STATIC_MUTEX;
+static struct
+{
+    char psz_prefix[256];
+    char psz_demux[32];
+} probe_cache[PROBE_CACHE_SIZE];
+static unsigned probe_cache_next = 0;
+
+/* Only demuxers with a strong detection are tried early */
+static bool ProbeIsStrong( const char *psz_demux )
+{
+    if( !strcmp( psz_demux, "ts" ) )
+        return true;
+    for( size_t i = 0; i < ARRAY_SIZE(probe_magic); i++ )
+        if( !strcmp( psz_demux, probe_magic[i].demux ) )
+            return true;
+    return false;
+}
+
+static void ProbeAppend( char *psz_list, size_t i_size, const char *psz_demux )
+{
+    size_t i_len = strlen( psz_list );
+    size_t i_demux = strlen( psz_demux );
+
+    /* Skip duplicates */
+    for( const char *psz = psz_list; *psz; psz += strcspn( psz, "," ),
+                                           psz += strspn( psz, "," ) )
+        if( !strncmp( psz, psz_demux, i_demux ) &&
+            ( psz[i_demux] == ',' || psz[i_demux] == '\0' ) )
+            return;
+
+    if( i_len + (i_len > 0) + i_demux + 1 > i_size )
+        return;
+    if( i_len > 0 )
+        psz_list[i_len++] = ',';
+    memcpy( &psz_list[i_len], psz_demux, i_demux + 1 );
+}
+
+static bool ProbeCacheKey( demux_t *p_demux, char *psz_key, size_t i_size )
+{
+    const char *psz_end = strrchr( p_demux->psz_location, '/' );
+    if( psz_end == NULL )
+        return false;
+
+    int i_len = snprintf( psz_key, i_size, "%s://%.*s", p_demux->psz_access,
+                          (int)(psz_end - p_demux->psz_location),
+                          p_demux->psz_location );
+    return i_len > 0 && (size_t)i_len < i_size;
+}
+
+static void ProbeCachePut( demux_t *p_demux )
+{
+    const char *psz_demux = module_get_object( p_demux->p_module );
+    char psz_key[sizeof(probe_cache[0].psz_prefix)];
+
+    if( !ProbeIsStrong( psz_demux ) ||
+        strlen( psz_demux ) >= sizeof(probe_cache[0].psz_demux) ||
+        !ProbeCacheKey( p_demux, psz_key, sizeof(psz_key) ) )
+        return;
+
+    vlc_mutex_lock( &probe_cache_lock );
+    unsigned i;
+    for( i = 0; i < PROBE_CACHE_SIZE; i++ )
+        if( !strcmp( probe_cache[i].psz_prefix, psz_key ) )
+            break;
+    if( i == PROBE_CACHE_SIZE )
+    {   /* Replace the oldest entry */
+        i = probe_cache_next;
+        probe_cache_next = (probe_cache_next + 1) % PROBE_CACHE_SIZE;
+        strcpy( probe_cache[i].psz_prefix, psz_key );
+    }
+    strcpy( probe_cache[i].psz_demux, psz_demux );
+    vlc_mutex_unlock( &probe_cache_lock );
+}
+
+static void ProbeHints( demux_t *p_demux, const char *psz_ext_module,
+                        char *psz_list, size_t i_size )
+{
+    const uint8_t *p_peek;
+    int i_peek = stream_Peek( p_demux->s, &p_peek, 189 );
+
+    psz_list[0] = '\0';
+
+    /* Signature */
+    for( size_t i = 0; i < ARRAY_SIZE(probe_magic); i++ )
+    {
+        if( i_peek >= probe_magic[i].i_offset + probe_magic[i].i_length &&
+            !memcmp( &p_peek[probe_magic[i].i_offset], probe_magic[i].magic,
+                     probe_magic[i].i_length ) )
+        {
+            ProbeAppend( psz_list, i_size, probe_magic[i].demux );
+            break;
+        }
+    }
+    if( i_peek >= 189 && p_peek[0] == 0x47 && p_peek[188] == 0x47 )
+        ProbeAppend( psz_list, i_size, "ts" );
+
+    /* Extension */
+    if( strcmp( psz_ext_module, "any" ) )
+        ProbeAppend( psz_list, i_size, psz_ext_module );
+
+    /* MIME type */
+    char *psz_mime = stream_ContentType( p_demux->s );
+    if( psz_mime != NULL )
+    {
+        for( unsigned i = 0; probe_mime[i].mime[0]; i++ )
+        {
+            size_t i_len = strlen( probe_mime[i].mime );
+            if( !strncasecmp( psz_mime, probe_mime[i].mime, i_len ) &&
+                ( psz_mime[i_len] == '\0' || psz_mime[i_len] == ';' ||
+                  psz_mime[i_len] == ' ' ) )
+            {
+                ProbeAppend( psz_list, i_size, probe_mime[i].demux );
+                break;
+            }
+        }
+        free( psz_mime );
+    }
+
+    /* Last demuxer of the location */
+    char psz_key[sizeof(probe_cache[0].psz_prefix)];
+    if( ProbeCacheKey( p_demux, psz_key, sizeof(psz_key) ) )
+    {
+        char psz_demux[sizeof(probe_cache[0].psz_demux)] = "";
+
+        vlc_mutex_lock( &probe_cache_lock );
+        for( unsigned i = 0; i < PROBE_CACHE_SIZE; i++ )
+            if( !strcmp( probe_cache[i].psz_prefix, psz_key ) )
+            {
+                strcpy( psz_demux, probe_cache[i].psz_demux );
+                break;
+            }
+        vlc_mutex_unlock( &probe_cache_lock );
+
+        if( psz_demux[0] != '\0' )
+            ProbeAppend( psz_list, i_size, psz_demux );
+    }
+
+    if( psz_list[0] != '\0' )
+        msg_Dbg( p_demux, "probing hints: %s", psz_list );
+}
+
 /*****************************************************************************
  * demux_Delete:
  *****************************************************************************/
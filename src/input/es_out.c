@@ -160,6 +160,10 @@ struct es_out_sys_t
     /* Current preroll */
     mtime_t     i_preroll_end;
 
+    /* Trick play (input_trick_e) */
+    int         i_trick;
+    int         i_trick_rate;
+
     /* Used for buffering */
     bool        b_buffering;
     mtime_t     i_buffering_extra_initial;
@@ -291,6 +295,8 @@ es_out_t *input_EsOutNew( input_thread_t *p_input, int i_rate )
     p_sys->i_pause_date = -1;
 
     p_sys->i_rate = i_rate;
+    p_sys->i_trick = INPUT_TRICK_NONE;
+    p_sys->i_trick_rate = i_rate;
 
     p_sys->b_buffering = true;
     p_sys->i_preroll_end = -1;
@@ -563,10 +569,39 @@ static void EsOutChangeRate( es_out_t *out, int i_rate )
     EsOutProgramsChangeRate( out );
 }
 
+static void EsOutChangeTrickMode( es_out_t *out, int i_trick, int i_rate )
+{
+    es_out_sys_t      *p_sys = out->p_sys;
+
+    p_sys->i_trick = i_trick;
+    p_sys->i_trick_rate = i_rate;
+
+    /* The input thread paces the trick play: there is nothing to buffer */
+    if( i_trick != INPUT_TRICK_NONE )
+    {
+        p_sys->b_buffering = false;
+        p_sys->i_preroll_end = -1;
+        input_SendEventCache( p_sys->p_input, 1.0 );
+    }
+
+    for( int i = 0; i < p_sys->i_es; i++ )
+    {
+        es_out_id_t *p_es = p_sys->es[i];
+
+        if( p_es->p_dec )
+            input_DecoderSetTrickMode( p_es->p_dec, i_trick, i_rate );
+    }
+}
+
 static void EsOutChangePosition( es_out_t *out )
 {
     es_out_sys_t      *p_sys = out->p_sys;
 
+    /* The input thread seeks continuously in trick play: the decoders keep
+     * their state, and the pictures already queued for display */
+    if( p_sys->i_trick != INPUT_TRICK_NONE )
+        return;
+
     input_SendEventCache( p_sys->p_input, 0.0 );
 
     for( int i = 0; i < p_sys->i_es; i++ )
@@ -577,6 +612,8 @@ static void EsOutChangePosition( es_out_t *out )
             continue;
 
         input_DecoderStartWait( p_es->p_dec );
+        if( p_es->fmt.i_cat == AUDIO_ES )
+            input_DecoderSetPrerollDate( p_es->p_dec, VLC_TS_INVALID );
 
         if( p_es->p_dec_record )
             input_DecoderStartWait( p_es->p_dec_record );
@@ -1038,7 +1075,10 @@ static es_out_pgrm_t *EsOutProgramAdd( es_out_t *out, int i_group )
     p_pgrm->psz_name = NULL;
     p_pgrm->psz_now_playing = NULL;
     p_pgrm->psz_publisher = NULL;
-    p_pgrm->p_clock = input_clock_New( p_sys->i_rate );
+    char *psz_recovery = var_InheritString( p_input, "clock-recovery" );
+    p_pgrm->p_clock = input_clock_New( p_sys->i_rate, psz_recovery &&
+                                       !strcmp( psz_recovery, "regression" ) );
+    free( psz_recovery );
     if( !p_pgrm->p_clock )
     {
         free( p_pgrm );
@@ -1545,6 +1585,9 @@ static void EsCreateDecoder( es_out_t *out, es_out_id_t *p_es )
     {
         if( p_sys->b_buffering )
             input_DecoderStartWait( p_es->p_dec );
+        if( p_sys->i_trick != INPUT_TRICK_NONE )
+            input_DecoderSetTrickMode( p_es->p_dec, p_sys->i_trick,
+                                       p_sys->i_trick_rate );
 
         if( !p_es->p_master && p_sys->p_sout_record )
         {
@@ -1906,12 +1949,8 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
 
     if( libvlc_stats( p_input ) )
     {
-        uint64_t i_total;
-
-        vlc_mutex_lock( &p_input->p->counters.counters_lock );
         stats_Update( p_input->p->counters.p_demux_read,
-                      p_block->i_buffer, &i_total );
-        stats_Update( p_input->p->counters.p_demux_bitrate, i_total, NULL );
+                      p_block->i_buffer, NULL );
 
         /* Update number of corrupted data packats */
         if( p_block->i_flags & BLOCK_FLAG_CORRUPTED )
@@ -1923,7 +1962,6 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
         {
             stats_Update( p_input->p->counters.p_demux_discontinuity, 1, NULL );
         }
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
     }
 
     vlc_mutex_lock( &p_sys->lock );
@@ -1935,11 +1973,17 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
         if( p_block->i_pts <= VLC_TS_INVALID )
             i_date = p_block->i_dts;
 
-        if( i_date < p_sys->i_preroll_end )
+        /* The audio block across the end of the preroll is decoded, and cut
+         * by the decoder (see input_DecoderSetPrerollDate()) */
+        if( i_date < p_sys->i_preroll_end &&
+            ( es->fmt.i_cat != AUDIO_ES || p_block->i_length <= 0 ||
+              i_date + p_block->i_length <= p_sys->i_preroll_end ) )
             p_block->i_flags |= BLOCK_FLAG_PREROLL;
     }
 
-    if( !es->p_dec )
+    /* Only the video is decoded in trick play */
+    if( !es->p_dec ||
+        ( p_sys->i_trick != INPUT_TRICK_NONE && es->fmt.i_cat != VIDEO_ES ) )
     {
         block_Release( p_block );
         vlc_mutex_unlock( &p_sys->lock );
@@ -2304,6 +2348,10 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
             return VLC_EGENERIC;
         }
 
+        /* The clocks are not used in trick play */
+        if( p_sys->i_trick != INPUT_TRICK_NONE )
+            return VLC_SUCCESS;
+
         /* TODO do not use mdate() but proper stream acquisition date */
         bool b_late;
         input_clock_Update( p_pgrm->p_clock, VLC_OBJECT(p_sys->p_input),
@@ -2322,6 +2370,19 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         }
         else if( p_pgrm == p_sys->p_pgrm )
         {
+            input_thread_t *p_input = p_sys->p_input;
+            if( libvlc_stats( p_input ) )
+            {
+                double f_drift;
+                mtime_t i_jitter;
+
+                input_clock_GetDrift( p_pgrm->p_clock, &f_drift, &i_jitter );
+                vlc_mutex_lock( &p_input->p->counters.counters_lock );
+                p_input->p->counters.f_clock_drift = f_drift;
+                p_input->p->counters.i_clock_jitter = i_jitter;
+                vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+            }
+
             if( b_late && ( !p_sys->p_input->p->p_sout ||
                                  !p_sys->p_input->p->b_out_pace_control ) )
             {
@@ -2435,6 +2496,13 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
 
         p_sys->i_preroll_end = i_date;
 
+        for( int i = 0; i < p_sys->i_es; i++ )
+        {
+            es_out_id_t *p_es = p_sys->es[i];
+
+            if( p_es->p_dec && p_es->fmt.i_cat == AUDIO_ES )
+                input_DecoderSetPrerollDate( p_es->p_dec, i_date );
+        }
         return VLC_SUCCESS;
     }
     case ES_OUT_SET_GROUP_META:
@@ -2694,6 +2762,15 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         return VLC_SUCCESS;
     }
 
+    case ES_OUT_SET_TRICK_MODE:
+    {
+        const int i_trick = (int)va_arg( args, int );
+        const int i_rate = (int)va_arg( args, int );
+
+        EsOutChangeTrickMode( out, i_trick, i_rate );
+        return VLC_SUCCESS;
+    }
+
     default:
         msg_Err( p_sys->p_input, "unknown query in es_out_Control" );
         return VLC_EGENERIC;
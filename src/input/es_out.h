@@ -65,7 +65,8 @@ enum es_out_query_private_e
     /* Set rate */
     ES_OUT_SET_RATE,                                /* arg1=int i_source_rate arg2=int i_rate                  res=can fail */
 
-    /* Set a new time */
+    /* Set a new time: -1 resets the decoders and clocks before a seek of the
+     * source, a time seeks within the timeshift window (fails without one) */
     ES_OUT_SET_TIME,                                /* arg1=mtime_t             res=can fail */
 
     /* Set next frame */
@@ -82,6 +83,14 @@ enum es_out_query_private_e
 
     /* Set End Of Stream */
     ES_OUT_SET_EOS,                                 /* res=cannot fail */
+
+    /* Set trick play mode (input_trick_e): only the video is decoded, and
+     * the clocks are not used */
+    ES_OUT_SET_TRICK_MODE,                          /* arg1=int i_trick arg2=int i_rate res=can fail */
+
+    /* Set standby state: the last data is kept instead of being decoded,
+     * and it is all sent when the standby ends */
+    ES_OUT_SET_STANDBY,                             /* arg1=bool                res=can fail */
 };
 
 static inline void es_out_SetMode( es_out_t *p_out, int i_mode )
@@ -167,6 +176,14 @@ static inline void es_out_Eos( es_out_t *p_out )
     int i_ret = es_out_Control( p_out, ES_OUT_SET_EOS );
     assert( !i_ret );
 }
+static inline int es_out_SetTrickMode( es_out_t *p_out, int i_trick, int i_rate )
+{
+    return es_out_Control( p_out, ES_OUT_SET_TRICK_MODE, i_trick, i_rate );
+}
+static inline int es_out_SetStandby( es_out_t *p_out, bool b_standby )
+{
+    return es_out_Control( p_out, ES_OUT_SET_STANDBY, b_standby );
+}
 
 es_out_t  *input_EsOutNew( input_thread_t *, int i_rate );
 
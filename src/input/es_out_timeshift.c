@@ -66,6 +66,7 @@ enum
     C_SEND,
     C_DEL,
     C_CONTROL,
+    C_DONE,     /* executed, and not to be executed again after a seek */
 };
 
 typedef struct attribute_packed
@@ -163,6 +164,7 @@ struct ts_storage_t
     FILE    *p_filer;   /* FILE handle for data reading */
 
     /* */
+    int      i_cmd_first; /* First command that may be read again */
     int      i_cmd_r;
     int      i_cmd_w;
     int      i_cmd_max;
@@ -175,12 +177,17 @@ typedef struct
     input_thread_t *p_input;
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
+    int64_t        i_size_max;
     const char     *psz_tmp_path;
 
     /* Lock for all following fields */
     vlc_mutex_t    lock;
     vlc_cond_t     wait;
 
+    /* */
+    mtime_t        i_seek;      /* Pending seek time, or -1 */
+    bool           b_overflow;  /* The reader has to skip the oldest storage */
+
     /* */
     bool           b_paused;
     mtime_t        i_pause_date;
@@ -194,7 +201,9 @@ typedef struct
     /* */
     mtime_t        i_buffering_delay;
 
-    /* */
+    /* Storages are kept after being read, from the oldest one up to the
+     * written one, within i_size_max bytes. */
+    ts_storage_t   *p_storage_h;
     ts_storage_t   *p_storage_r;
     ts_storage_t   *p_storage_w;
 
@@ -205,6 +214,7 @@ typedef struct
 struct es_out_id_t
 {
     es_out_id_t *p_es;
+    int         i_cat;
 };
 
 struct es_out_sys_t
@@ -214,6 +224,7 @@ struct es_out_sys_t
 
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
+    int64_t        i_size_max;        /* Maximal size of all the files in byte */
     char           *psz_tmp_path;     /* Path for temporary files */
 
     /* Lock for all following fields */
@@ -232,6 +243,17 @@ struct es_out_sys_t
     /* */
     int            i_es;
     es_out_id_t    **pp_es;
+
+    /* Standby: the commands are kept in memory, instead of being executed,
+     * from the last video key frame (if they are flagged) or within a
+     * window, until the standby ends */
+    bool           b_standby;
+    bool           b_standby_keyframes;
+    mtime_t        i_standby_window;
+    mtime_t        i_standby_date;   /* Date of the oldest kept data */
+    int            i_standby;
+    int            i_standby_max;
+    ts_cmd_t       *p_standby;
 };
 
 static es_out_id_t *Add    ( es_out_t *, const es_format_t * );
@@ -243,6 +265,10 @@ static void         Destroy( es_out_t * );
 static int          TsStart( es_out_t * );
 static void         TsAutoStop( es_out_t * );
 
+static int          StandbyPush( es_out_sys_t *, ts_cmd_t * );
+static void         StandbyTrim( es_out_sys_t *, int i_cut );
+static int          StandbyStop( es_out_t *, bool b_flush );
+
 static void         TsStop( ts_thread_t * );
 static void         TsPushCmd( ts_thread_t *, ts_cmd_t * );
 static int          TsPopCmdLocked( ts_thread_t *, ts_cmd_t *, bool b_flush );
@@ -250,6 +276,7 @@ static bool         TsHasCmd( ts_thread_t * );
 static bool         TsIsUnused( ts_thread_t * );
 static int          TsChangePause( ts_thread_t *, bool b_source_paused, bool b_paused, mtime_t i_date );
 static int          TsChangeRate( ts_thread_t *, int i_src_rate, int i_rate );
+static int          TsSeek( ts_thread_t *, mtime_t i_time );
 
 static void         *TsRun( void * );
 
@@ -258,11 +285,14 @@ static void         TsStorageDelete( ts_storage_t * );
 static void         TsStoragePack( ts_storage_t *p_storage );
 static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
 static bool         TsStorageIsEmpty( ts_storage_t * );
+static int64_t      TsStorageChainSize( ts_storage_t * );
 static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
 static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
 
 static void CmdClean( ts_cmd_t * );
 static void cmd_cleanup_routine( void *p ) { CmdClean( p ); }
+static bool CmdIsReplayable( const ts_cmd_t * );
+static void CmdExecute( es_out_t *, ts_cmd_t * );
 
 static int  CmdInitAdd    ( ts_cmd_t *, es_out_id_t *, const es_format_t *, bool b_copy );
 static void CmdInitSend   ( ts_cmd_t *, es_out_id_t *, block_t * );
@@ -323,6 +353,14 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
 
     TAB_INIT( p_sys->i_es, p_sys->pp_es );
 
+    p_sys->b_standby = false;
+    p_sys->b_standby_keyframes = false;
+    p_sys->i_standby_window = var_InheritInteger( p_input, "input-standby-window" ) * 1000;
+    p_sys->i_standby_date = VLC_TS_INVALID;
+    p_sys->i_standby = 0;
+    p_sys->i_standby_max = 0;
+    p_sys->p_standby = NULL;
+
     /* */
     const int i_tmp_size_max = var_CreateGetInteger( p_input, "input-timeshift-granularity" );
     if( i_tmp_size_max < 0 )
@@ -330,11 +368,15 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     else
         p_sys->i_tmp_size_max = __MAX( i_tmp_size_max, 1*1024*1024 );
 
+    const int i_size_max = var_CreateGetInteger( p_input, "input-timeshift-size" );
+    p_sys->i_size_max = (int64_t)__MAX( i_size_max, 0 ) * 1024 * 1024;
+
     char *psz_tmp_path = var_CreateGetNonEmptyString( p_input, "input-timeshift-path" );
     p_sys->psz_tmp_path = GetTmpPath( psz_tmp_path );
 
-    msg_Dbg( p_input, "using timeshift granularity of %d MiB, in path '%s'",
-             (int)p_sys->i_tmp_size_max/(1024*1024), p_sys->psz_tmp_path );
+    msg_Dbg( p_input, "using timeshift granularity of %d MiB, window of %d MiB, in path '%s'",
+             (int)p_sys->i_tmp_size_max/(1024*1024),
+             (int)(p_sys->i_size_max/(1024*1024)), p_sys->psz_tmp_path );
 
 #if 0
 #define S(t) msg_Err( p_input, "SIZEOF("#t")=%d", sizeof(t) )
@@ -361,6 +403,8 @@ static void Destroy( es_out_t *p_out )
         TsStop( p_sys->p_ts );
         p_sys->b_delayed = false;
     }
+    if( p_sys->b_standby )
+        StandbyStop( p_out, false );
 
     while( p_sys->i_es > 0 )
         Del( p_out, p_sys->pp_es[0] );
@@ -381,11 +425,21 @@ static es_out_id_t *Add( es_out_t *p_out, const es_format_t *p_fmt )
     if( !p_es )
         return NULL;
 
+    p_es->p_es = NULL;
+    p_es->i_cat = p_fmt->i_cat;
+
     vlc_mutex_lock( &p_sys->lock );
 
     TsAutoStop( p_out );
 
-    if( CmdInitAdd( &cmd, p_es, p_fmt, p_sys->b_delayed ) )
+    if( CmdInitAdd( &cmd, p_es, p_fmt, p_sys->b_delayed || p_sys->b_standby ) )
+    {
+        vlc_mutex_unlock( &p_sys->lock );
+        free( p_es );
+        return NULL;
+    }
+
+    if( p_sys->b_standby && StandbyPush( p_sys, &cmd ) )
     {
         vlc_mutex_unlock( &p_sys->lock );
         free( p_es );
@@ -394,7 +448,9 @@ static es_out_id_t *Add( es_out_t *p_out, const es_format_t *p_fmt )
 
     TAB_APPEND( p_sys->i_es, p_sys->pp_es, p_es );
 
-    if( p_sys->b_delayed )
+    if( p_sys->b_standby )
+        ;
+    else if( p_sys->b_delayed )
         TsPushCmd( p_sys->p_ts, &cmd );
     else
         CmdExecuteAdd( p_sys->p_out, &cmd );
@@ -414,7 +470,39 @@ static int Send( es_out_t *p_out, es_out_id_t *p_es, block_t *p_block )
     TsAutoStop( p_out );
 
     CmdInitSend( &cmd, p_es, p_block );
-    if( p_sys->b_delayed )
+    if( p_sys->b_standby )
+    {
+        const bool b_key = p_es->i_cat == VIDEO_ES &&
+                           (p_block->i_flags & BLOCK_FLAG_TYPE_I);
+        /* Without key frames, keep at most a quarter more than the window
+         * between two trims. With them, keep the data from the last one,
+         * within four windows. */
+        const mtime_t i_max = p_sys->b_standby_keyframes
+                            ? 4 * p_sys->i_standby_window
+                            : 5 * p_sys->i_standby_window / 4;
+
+        i_ret = StandbyPush( p_sys, &cmd );
+        if( p_sys->i_standby_date == VLC_TS_INVALID )
+            p_sys->i_standby_date = cmd.i_date;
+
+        if( !i_ret && b_key )
+        {   /* Decoding can start from here */
+            p_sys->b_standby_keyframes = true;
+            StandbyTrim( p_sys, p_sys->i_standby - 1 );
+        }
+        else if( cmd.i_date - p_sys->i_standby_date > i_max )
+        {   /* Trim to the window */
+            const mtime_t i_limit = cmd.i_date - p_sys->i_standby_window;
+            int i_cut = 0;
+
+            while( i_cut < p_sys->i_standby - 1 &&
+                   ( !CmdIsReplayable( &p_sys->p_standby[i_cut] ) ||
+                     p_sys->p_standby[i_cut].i_date < i_limit ) )
+                i_cut++;
+            StandbyTrim( p_sys, i_cut );
+        }
+    }
+    else if( p_sys->b_delayed )
         TsPushCmd( p_sys->p_ts, &cmd );
     else
         i_ret = CmdExecuteSend( p_sys->p_out, &cmd) ;
@@ -433,7 +521,12 @@ static void Del( es_out_t *p_out, es_out_id_t *p_es )
     TsAutoStop( p_out );
 
     CmdInitDel( &cmd, p_es );
-    if( p_sys->b_delayed )
+    if( p_sys->b_standby )
+    {
+        /* On error, p_es is leaked: the kept commands still use it */
+        StandbyPush( p_sys, &cmd );
+    }
+    else if( p_sys->b_delayed )
         TsPushCmd( p_sys->p_ts, &cmd );
     else
         CmdExecuteDel( p_sys->p_out, &cmd );
@@ -447,7 +540,9 @@ static int ControlLockedGetEmpty( es_out_t *p_out, bool *pb_empty )
 {
     es_out_sys_t *p_sys = p_out->p_sys;
 
-    if( p_sys->b_delayed && TsHasCmd( p_sys->p_ts ) )
+    if( p_sys->b_standby )
+        *pb_empty = true;
+    else if( p_sys->b_delayed && TsHasCmd( p_sys->p_ts ) )
         *pb_empty = false;
     else
         *pb_empty = es_out_GetEmpty( p_sys->p_out );
@@ -458,7 +553,11 @@ static int ControlLockedGetWakeup( es_out_t *p_out, mtime_t *pi_wakeup )
 {
     es_out_sys_t *p_sys = p_out->p_sys;
 
-    if( p_sys->b_delayed )
+    if( p_sys->b_standby )
+    {
+        *pi_wakeup = 0;
+    }
+    else if( p_sys->b_delayed )
     {
         assert( !p_sys->p_input->p->b_can_pace_control );
         *pi_wakeup = 0;
@@ -474,7 +573,9 @@ static int ControlLockedGetBuffering( es_out_t *p_out, bool *pb_buffering )
 {
     es_out_sys_t *p_sys = p_out->p_sys;
 
-    if( p_sys->b_delayed )
+    if( p_sys->b_standby )
+        *pb_buffering = false;
+    else if( p_sys->b_delayed )
         *pb_buffering = true;
     else
         *pb_buffering = es_out_GetBuffering( p_sys->p_out );
@@ -557,11 +658,20 @@ static int ControlLockedSetTime( es_out_t *p_out, mtime_t i_date )
     es_out_sys_t *p_sys = p_out->p_sys;
 
     if( !p_sys->b_delayed )
+    {
+        /* There is no window to seek in */
+        if( i_date >= 0 )
+            return VLC_EGENERIC;
         return es_out_SetTime( p_sys->p_out, i_date );
+    }
 
-    /* TODO */
-    msg_Err( p_sys->p_input, "EsOutTimeshift does not yet support time change" );
-    return VLC_EGENERIC;
+    if( i_date < 0 )
+    {
+        /* TODO */
+        msg_Err( p_sys->p_input, "EsOutTimeshift does not yet support seeking the source" );
+        return VLC_EGENERIC;
+    }
+    return TsSeek( p_sys->p_ts, i_date );
 }
 static int ControlLockedSetFrameNext( es_out_t *p_out )
 {
@@ -570,10 +680,54 @@ static int ControlLockedSetFrameNext( es_out_t *p_out )
     return es_out_SetFrameNext( p_sys->p_out );
 }
 
+static int ControlLockedSetTrickMode( es_out_t *p_out, int i_trick, int i_rate )
+{
+    es_out_sys_t *p_sys = p_out->p_sys;
+
+    /* Trick play seeks the source, which the timeshift does not follow */
+    if( p_sys->b_delayed && i_trick != INPUT_TRICK_NONE )
+        return VLC_EGENERIC;
+    return es_out_SetTrickMode( p_sys->p_out, i_trick, i_rate );
+}
+
+static int ControlLockedSetStandby( es_out_t *p_out, bool b_standby )
+{
+    es_out_sys_t *p_sys = p_out->p_sys;
+
+    if( b_standby == p_sys->b_standby )
+        return VLC_SUCCESS;
+    if( !b_standby )
+        return StandbyStop( p_out, true );
+
+    /* Nothing must have been sent downstream yet */
+    if( p_sys->i_es > 0 || p_sys->b_delayed )
+        return VLC_EGENERIC;
+    p_sys->b_standby = true;
+    return VLC_SUCCESS;
+}
+
 static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
 {
     es_out_sys_t *p_sys = p_out->p_sys;
 
+    if( p_sys->b_standby )
+    {
+        switch( i_query )
+        {
+        /* Nothing is played in standby */
+        case ES_OUT_SET_PAUSE_STATE:
+        case ES_OUT_SET_RATE:
+        case ES_OUT_SET_TIME:
+        case ES_OUT_SET_FRAME_NEXT:
+        case ES_OUT_SET_TRICK_MODE:
+        case ES_OUT_GET_PCR_SYSTEM:
+        case ES_OUT_MODIFY_PCR_SYSTEM:
+            return VLC_EGENERIC;
+        default:
+            break;
+        }
+    }
+
     switch( i_query )
     {
     /* Invalid query for this es_out level */
@@ -608,8 +762,11 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
     case ES_OUT_SET_EOS:
     {
         ts_cmd_t cmd;
-        if( CmdInitControl( &cmd, i_query, args, p_sys->b_delayed ) )
+        if( CmdInitControl( &cmd, i_query, args,
+                            p_sys->b_delayed || p_sys->b_standby ) )
             return VLC_EGENERIC;
+        if( p_sys->b_standby )
+            return StandbyPush( p_sys, &cmd );
         if( p_sys->b_delayed )
         {
             TsPushCmd( p_sys->p_ts, &cmd );
@@ -624,7 +781,7 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
         es_out_id_t *p_es = (es_out_id_t*)va_arg( args, es_out_id_t * );
         bool *pb_enabled = (bool*)va_arg( args, bool* );
 
-        if( p_sys->b_delayed )
+        if( p_sys->b_delayed || p_sys->b_standby )
         {
             *pb_enabled = true;
             return VLC_SUCCESS;
@@ -672,6 +829,13 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
     {
         return ControlLockedSetFrameNext( p_out );
     }
+    case ES_OUT_SET_TRICK_MODE:
+    {
+        const int i_trick = (int)va_arg( args, int );
+        const int i_rate = (int)va_arg( args, int );
+
+        return ControlLockedSetTrickMode( p_out, i_trick, i_rate );
+    }
     case ES_OUT_GET_PCR_SYSTEM:
     {
         if( p_sys->b_delayed )
@@ -696,6 +860,12 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
         int *pi_group = va_arg( args, int * );
         return es_out_Control( p_sys->p_out, ES_OUT_GET_GROUP_FORCED, pi_group );
     }
+    case ES_OUT_SET_STANDBY:
+    {
+        const bool b_standby = (bool)va_arg( args, int );
+
+        return ControlLockedSetStandby( p_out, b_standby );
+    }
 
 
     default:
@@ -720,6 +890,112 @@ static int Control( es_out_t *p_out, int i_query, va_list args )
     return i_ret;
 }
 
+/*****************************************************************************
+ * Standby
+ *****************************************************************************/
+static int StandbyPush( es_out_sys_t *p_sys, ts_cmd_t *p_cmd )
+{
+    if( p_sys->i_standby >= p_sys->i_standby_max )
+    {
+        const int i_max = __MAX( 2 * p_sys->i_standby_max, 256 );
+        ts_cmd_t *p_standby = realloc( p_sys->p_standby,
+                                       i_max * sizeof(*p_standby) );
+        if( unlikely(p_standby == NULL) )
+        {
+            CmdClean( p_cmd );
+            return VLC_ENOMEM;
+        }
+        p_sys->p_standby = p_standby;
+        p_sys->i_standby_max = i_max;
+    }
+    p_sys->p_standby[p_sys->i_standby++] = *p_cmd;
+    return VLC_SUCCESS;
+}
+
+static bool StandbyIsPcr( const ts_cmd_t *p_cmd )
+{
+    return p_cmd->i_type == C_CONTROL &&
+           ( p_cmd->u.control.i_query == ES_OUT_SET_PCR ||
+             p_cmd->u.control.i_query == ES_OUT_SET_GROUP_PCR );
+}
+
+/* Drops the data and the clock commands before i_cut, but the last clock
+ * reference of each group, which the following data needs. */
+static void StandbyTrim( es_out_sys_t *p_sys, int i_cut )
+{
+    ts_cmd_t *p_standby = p_sys->p_standby;
+    int pi_group[16];
+    int i_group = 0;
+
+    /* Mark the last clock references, from the cut backward */
+    for( int i = i_cut - 1; i >= 0; i-- )
+    {
+        ts_cmd_t *p_cmd = &p_standby[i];
+        if( !StandbyIsPcr( p_cmd ) )
+            continue;
+
+        const int i_id = p_cmd->u.control.i_query == ES_OUT_SET_PCR
+                       ? 0 : p_cmd->u.control.u.int_i64.i_int;
+        bool b_seen = false;
+        for( int j = 0; j < i_group; j++ )
+            b_seen |= pi_group[j] == i_id;
+
+        if( b_seen || i_group >= (int)ARRAY_SIZE(pi_group) )
+        {
+            CmdClean( p_cmd );
+            p_cmd->i_type = C_DONE;
+        }
+        else
+            pi_group[i_group++] = i_id;
+    }
+
+    int j = 0;
+    for( int i = 0; i < p_sys->i_standby; i++ )
+    {
+        ts_cmd_t *p_cmd = &p_standby[i];
+
+        if( i == i_cut )
+            p_sys->i_standby_date = p_cmd->i_date;
+        if( i < i_cut && p_cmd->i_type == C_DONE )
+            continue;
+        if( i < i_cut && CmdIsReplayable( p_cmd ) && !StandbyIsPcr( p_cmd ) )
+        {
+            CmdClean( p_cmd );
+            continue;
+        }
+        p_standby[j++] = *p_cmd;
+    }
+    p_sys->i_standby = j;
+}
+
+/* Ends the standby, sending the kept commands downstream, or dropping them */
+static int StandbyStop( es_out_t *p_out, bool b_flush )
+{
+    es_out_sys_t *p_sys = p_out->p_sys;
+
+    if( b_flush )
+        msg_Dbg( p_sys->p_input, "leaving standby with %d commands",
+                 p_sys->i_standby );
+
+    for( int i = 0; i < p_sys->i_standby; i++ )
+    {
+        ts_cmd_t *p_cmd = &p_sys->p_standby[i];
+
+        if( b_flush )
+            CmdExecute( p_sys->p_out, p_cmd );
+        else if( p_cmd->i_type == C_DEL )
+            free( p_cmd->u.del.p_es );
+        else
+            CmdClean( p_cmd );
+    }
+    free( p_sys->p_standby );
+    p_sys->p_standby = NULL;
+    p_sys->i_standby = 0;
+    p_sys->i_standby_max = 0;
+    p_sys->b_standby = false;
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
  *
  *****************************************************************************/
@@ -741,6 +1017,7 @@ static int TsStart( es_out_t *p_out )
         return VLC_EGENERIC;
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
+    p_ts->i_size_max = p_sys->i_size_max;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
@@ -754,6 +1031,9 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_rate_delay = 0;
     p_ts->i_buffering_delay = 0;
     p_ts->i_cmd_delay = 0;
+    p_ts->i_seek = -1;
+    p_ts->b_overflow = false;
+    p_ts->p_storage_h = NULL;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
 
@@ -788,22 +1068,71 @@ static void TsStop( ts_thread_t *p_ts )
     vlc_join( p_ts->thread, NULL );
 
     vlc_mutex_lock( &p_ts->lock );
-    for( ;; )
+    while( p_ts->p_storage_h )
     {
-        ts_cmd_t cmd;
-
-        if( TsPopCmdLocked( p_ts, &cmd, true ) )
-            break;
+        ts_storage_t *p_next = p_ts->p_storage_h->p_next;
 
-        CmdClean( &cmd );
+        TsStorageDelete( p_ts->p_storage_h );
+        p_ts->p_storage_h = p_next;
     }
-    assert( !p_ts->p_storage_r || !p_ts->p_storage_r->p_next );
-    if( p_ts->p_storage_r )
-        TsStorageDelete( p_ts->p_storage_r );
     vlc_mutex_unlock( &p_ts->lock );
 
     TsDestroy( p_ts );
 }
+static bool TsIsEmptyLocked( ts_thread_t *p_ts )
+{
+    for( ts_storage_t *p_storage = p_ts->p_storage_r; p_storage; p_storage = p_storage->p_next )
+    {
+        if( !TsStorageIsEmpty( p_storage ) )
+            return false;
+    }
+    return true;
+}
+/* Drops the oldest storages beyond the window size, or all the read ones
+ * without a window */
+static void TsTrimLocked( ts_thread_t *p_ts )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    while( p_ts->p_storage_h != p_ts->p_storage_w )
+    {
+        if( p_ts->i_size_max > 0 )
+        {
+            if( TsStorageChainSize( p_ts->p_storage_h ) <= p_ts->i_size_max )
+                break;
+            if( p_ts->p_storage_h == p_ts->p_storage_r &&
+                !TsStorageIsEmpty( p_ts->p_storage_r ) )
+            {
+                /* The reader is late by more than the window */
+                p_ts->b_overflow = true;
+                vlc_cond_signal( &p_ts->wait );
+                break;
+            }
+        }
+        else if( !TsStorageIsEmpty( p_ts->p_storage_h ) )
+        {
+            break;
+        }
+
+        ts_storage_t *p_next = p_ts->p_storage_h->p_next;
+        if( p_ts->p_storage_r == p_ts->p_storage_h )
+            p_ts->p_storage_r = p_next;
+        TsStorageDelete( p_ts->p_storage_h );
+        p_ts->p_storage_h = p_next;
+    }
+}
+/* Forgets the storages already read (an ES deletion freed data they refer to) */
+static void TsDropHistoryLocked( ts_thread_t *p_ts )
+{
+    while( p_ts->p_storage_h != p_ts->p_storage_r )
+    {
+        ts_storage_t *p_next = p_ts->p_storage_h->p_next;
+
+        TsStorageDelete( p_ts->p_storage_h );
+        p_ts->p_storage_h = p_next;
+    }
+    p_ts->p_storage_r->i_cmd_first = p_ts->p_storage_r->i_cmd_r;
+}
 static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 {
     vlc_mutex_lock( &p_ts->lock );
@@ -822,13 +1151,14 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 
         if( !p_ts->p_storage_w )
         {
-            p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
+            p_ts->p_storage_h = p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
         }
         else
         {
             TsStoragePack( p_ts->p_storage_w );
             p_ts->p_storage_w->p_next = p_storage;
             p_ts->p_storage_w = p_storage;
+            TsTrimLocked( p_ts );
         }
     }
 
@@ -843,29 +1173,147 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
 {
     vlc_assert_locked( &p_ts->lock );
 
-    if( TsStorageIsEmpty( p_ts->p_storage_r ) )
-        return VLC_EGENERIC;
+    for( ;; )
+    {
+        while( TsStorageIsEmpty( p_ts->p_storage_r ) )
+        {
+            if( !p_ts->p_storage_r || !p_ts->p_storage_r->p_next )
+                return VLC_EGENERIC;
+
+            p_ts->p_storage_r = p_ts->p_storage_r->p_next;
+            if( p_ts->p_storage_r == p_ts->p_storage_w )
+                fflush( p_ts->p_storage_w->p_filew );
+            TsTrimLocked( p_ts );
+        }
+
+        TsStoragePopCmd( p_ts->p_storage_r, p_cmd, b_flush );
+
+        if( p_cmd->i_type == C_DEL )
+            TsDropHistoryLocked( p_ts );
+        if( p_cmd->i_type != C_DONE )
+            return VLC_SUCCESS;
+    }
+}
+/* Moves the reader forward up to the given command, executing on the way
+ * only the commands that are not data nor clock */
+static void TsSkipLocked( ts_thread_t *p_ts, ts_storage_t *p_target, int i_target )
+{
+    for( ;; )
+    {
+        while( p_ts->p_storage_r != p_target && TsStorageIsEmpty( p_ts->p_storage_r ) )
+            p_ts->p_storage_r = p_ts->p_storage_r->p_next;
+        if( p_ts->p_storage_r == p_target && p_target->i_cmd_r >= i_target )
+            break;
+
+        ts_cmd_t cmd;
+        if( TsPopCmdLocked( p_ts, &cmd, true ) )
+            break;
 
-    TsStoragePopCmd( p_ts->p_storage_r, p_cmd, b_flush );
+        if( CmdIsReplayable( &cmd ) )
+            CmdClean( &cmd );
+        else
+            CmdExecute( p_ts->p_out, &cmd );
+    }
+}
+/* Restarts the decoders and the command timing from the reader position */
+static void TsResetLocked( ts_thread_t *p_ts )
+{
+    mtime_t i_date = mdate();
 
-    while( p_ts->p_storage_r && TsStorageIsEmpty( p_ts->p_storage_r ) )
+    for( ts_storage_t *p_storage = p_ts->p_storage_r; p_storage; p_storage = p_storage->p_next )
     {
-        ts_storage_t *p_next = p_ts->p_storage_r->p_next;
-        if( !p_next )
+        int i = p_storage->i_cmd_r;
+        while( i < p_storage->i_cmd_w && p_storage->p_cmd[i].i_type == C_DONE )
+            i++;
+        if( i < p_storage->i_cmd_w )
+        {
+            i_date = p_storage->p_cmd[i].i_date;
             break;
+        }
+    }
+
+    es_out_SetTime( p_ts->p_out, -1 );
 
-        TsStorageDelete( p_ts->p_storage_r );
-        p_ts->p_storage_r = p_next;
+    p_ts->i_cmd_delay = ( p_ts->b_paused ? p_ts->i_pause_date : mdate() ) - i_date;
+    p_ts->i_rate_date = -1;
+    p_ts->i_rate_delay = 0;
+    p_ts->i_buffering_delay = 0;
+}
+/* Finds the last time update at or before i_time (or the first one), the
+ * time index of the window */
+static bool TsSeekFindLocked( ts_thread_t *p_ts, mtime_t i_time,
+                              ts_storage_t **pp_target, int *pi_target, bool *pb_backward )
+{
+    bool b_read = true;
+    bool b_found = false;
+
+    for( ts_storage_t *p_storage = p_ts->p_storage_h; p_storage; p_storage = p_storage->p_next )
+    {
+        for( int i = p_storage->i_cmd_first; i < p_storage->i_cmd_w; i++ )
+        {
+            const ts_cmd_t *p_cmd = &p_storage->p_cmd[i];
+
+            if( p_storage == p_ts->p_storage_r && i == p_storage->i_cmd_r )
+                b_read = false;
+            if( p_cmd->i_type != C_CONTROL || p_cmd->u.control.i_query != ES_OUT_SET_TIMES )
+                continue;
+            if( b_found && p_cmd->u.control.u.times.i_time > i_time )
+                return true;
+
+            *pp_target = p_storage;
+            *pi_target = i;
+            *pb_backward = b_read;
+            b_found = true;
+        }
+        if( p_storage == p_ts->p_storage_r )
+            b_read = false;
     }
+    return b_found;
+}
+static void TsSeekLocked( ts_thread_t *p_ts )
+{
+    ts_storage_t *p_target;
+    int i_target;
+    bool b_backward;
 
-    return VLC_SUCCESS;
+    const mtime_t i_time = p_ts->i_seek;
+    p_ts->i_seek = -1;
+
+    if( !TsSeekFindLocked( p_ts, i_time, &p_target, &i_target, &b_backward ) )
+        return;
+
+    if( b_backward )
+    {
+        p_ts->p_storage_r = p_target;
+        p_target->i_cmd_r = i_target;
+        for( ts_storage_t *p_storage = p_target->p_next; p_storage; p_storage = p_storage->p_next )
+            p_storage->i_cmd_r = p_storage->i_cmd_first;
+    }
+    else
+    {
+        TsSkipLocked( p_ts, p_target, i_target );
+    }
+    TsResetLocked( p_ts );
+}
+static void TsOverflowLocked( ts_thread_t *p_ts )
+{
+    p_ts->b_overflow = false;
+
+    ts_storage_t *p_next = p_ts->p_storage_h->p_next;
+    if( p_ts->p_storage_r != p_ts->p_storage_h || !p_next )
+        return;
+
+    msg_Warn( p_ts->p_input, "es out timeshift: window full, skipping ahead" );
+    TsSkipLocked( p_ts, p_next, p_next->i_cmd_r );
+    TsTrimLocked( p_ts );
+    TsResetLocked( p_ts );
 }
 static bool TsHasCmd( ts_thread_t *p_ts )
 {
     bool b_cmd;
 
     vlc_mutex_lock( &p_ts->lock );
-    b_cmd =  TsStorageIsEmpty( p_ts->p_storage_r );
+    b_cmd =  TsIsEmptyLocked( p_ts );
     vlc_mutex_unlock( &p_ts->lock );
 
     return b_cmd;
@@ -877,7 +1325,7 @@ static bool TsIsUnused( ts_thread_t *p_ts )
     vlc_mutex_lock( &p_ts->lock );
     b_unused = !p_ts->b_paused &&
                p_ts->i_rate == p_ts->i_rate_source &&
-               TsStorageIsEmpty( p_ts->p_storage_r );
+               TsIsEmptyLocked( p_ts );
     vlc_mutex_unlock( &p_ts->lock );
 
     return b_unused;
@@ -931,6 +1379,27 @@ static int TsChangeRate( ts_thread_t *p_ts, int i_src_rate, int i_rate )
 
     return i_ret;
 }
+static int TsSeek( ts_thread_t *p_ts, mtime_t i_time )
+{
+    ts_storage_t *p_target;
+    int i_target;
+    bool b_backward;
+    int i_ret = VLC_EGENERIC;
+
+    vlc_mutex_lock( &p_ts->lock );
+    if( TsSeekFindLocked( p_ts, i_time, &p_target, &i_target, &b_backward ) )
+    {
+        /* The thread does it, between two commands */
+        p_ts->i_seek = i_time;
+        vlc_cond_signal( &p_ts->wait );
+        i_ret = VLC_SUCCESS;
+    }
+    vlc_mutex_unlock( &p_ts->lock );
+
+    if( i_ret )
+        msg_Warn( p_ts->p_input, "es out timeshift: no time to seek to" );
+    return i_ret;
+}
 
 static void *TsRun( void *p_data )
 {
@@ -950,6 +1419,14 @@ static void *TsRun( void *p_data )
         for( ;; )
         {
             const int canc = vlc_savecancel();
+            if( p_ts->b_overflow || p_ts->i_seek >= 0 )
+            {
+                if( p_ts->b_overflow )
+                    TsOverflowLocked( p_ts );
+                if( p_ts->i_seek >= 0 )
+                    TsSeekLocked( p_ts );
+                i_buffering_date = -1;
+            }
             b_buffering = es_out_GetBuffering( p_ts->p_out );
 
             if( ( !p_ts->b_paused || b_buffering ) && !TsPopCmdLocked( p_ts, &cmd, false ) )
@@ -1023,27 +1500,7 @@ static void *TsRun( void *p_data )
 
         /* Execute the command  */
         const int canc = vlc_savecancel();
-        switch( cmd.i_type )
-        {
-        case C_ADD:
-            CmdExecuteAdd( p_ts->p_out, &cmd );
-            CmdCleanAdd( &cmd );
-            break;
-        case C_SEND:
-            CmdExecuteSend( p_ts->p_out, &cmd );
-            CmdCleanSend( &cmd );
-            break;
-        case C_CONTROL:
-            CmdExecuteControl( p_ts->p_out, &cmd );
-            CmdCleanControl( &cmd );
-            break;
-        case C_DEL:
-            CmdExecuteDel( p_ts->p_out, &cmd );
-            break;
-        default:
-            assert(0);
-            break;
-        }
+        CmdExecute( p_ts->p_out, &cmd );
         vlc_restorecancel( canc );
     }
 
@@ -1068,8 +1525,12 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     p_storage->p_filew = GetTmpFile( &p_storage->psz_file, psz_tmp_path );
     if( p_storage->psz_file )
         p_storage->p_filer = vlc_fopen( p_storage->psz_file, "rb" );
+    /* Write the data in large chunks */
+    if( p_storage->p_filew )
+        setvbuf( p_storage->p_filew, NULL, _IOFBF, 1024*1024 );
 
     /* */
+    p_storage->i_cmd_first = 0;
     p_storage->i_cmd_w = 0;
     p_storage->i_cmd_r = 0;
     p_storage->i_cmd_max = 30000;
@@ -1135,6 +1596,13 @@ static bool TsStorageIsEmpty( ts_storage_t *p_storage )
 {
     return !p_storage || p_storage->i_cmd_r >= p_storage->i_cmd_w;
 }
+static int64_t TsStorageChainSize( ts_storage_t *p_storage )
+{
+    int64_t i_size = 0;
+    for( ; p_storage; p_storage = p_storage->p_next )
+        i_size += p_storage->i_file_size;
+    return i_size;
+}
 static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bool b_flush )
 {
     ts_cmd_t cmd = *p_cmd;
@@ -1174,7 +1642,12 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
 {
     assert( !TsStorageIsEmpty( p_storage ) );
 
-    *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
+    ts_cmd_t *p_stored = &p_storage->p_cmd[p_storage->i_cmd_r++];
+
+    *p_cmd = *p_stored;
+    /* The data of the other commands is released once executed */
+    if( !CmdIsReplayable( p_stored ) )
+        p_stored->i_type = C_DONE;
     if( p_cmd->i_type == C_SEND )
     {
         block_t block;
@@ -1220,6 +1693,48 @@ static void CmdClean( ts_cmd_t *p_cmd )
         CmdCleanControl( p_cmd );
         break;
     case C_DEL:
+    case C_DONE:
+        break;
+    default:
+        assert(0);
+        break;
+    }
+}
+static bool CmdIsReplayable( const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type == C_SEND )
+        return true;
+    if( p_cmd->i_type != C_CONTROL )
+        return false;
+
+    switch( p_cmd->u.control.i_query )
+    {
+    case ES_OUT_SET_PCR:
+    case ES_OUT_SET_GROUP_PCR:
+    case ES_OUT_SET_TIMES:
+        return true;
+    default:
+        return false;
+    }
+}
+static void CmdExecute( es_out_t *p_out, ts_cmd_t *p_cmd )
+{
+    switch( p_cmd->i_type )
+    {
+    case C_ADD:
+        CmdExecuteAdd( p_out, p_cmd );
+        CmdCleanAdd( p_cmd );
+        break;
+    case C_SEND:
+        CmdExecuteSend( p_out, p_cmd );
+        CmdCleanSend( p_cmd );
+        break;
+    case C_CONTROL:
+        CmdExecuteControl( p_out, p_cmd );
+        CmdCleanControl( p_cmd );
+        break;
+    case C_DEL:
+        CmdExecuteDel( p_out, p_cmd );
         break;
     default:
         assert(0);
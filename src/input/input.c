@@ -36,6 +36,9 @@
 #include <errno.h>
 #include <math.h>
 #include <sys/stat.h>
+#ifdef HAVE_SCHED_GETAFFINITY
+# include <sched.h>
+#endif
 
 #include "input_internal.h"
 #include "event.h"
@@ -46,6 +49,7 @@
 #include "stream.h"
 #include "item.h"
 #include "resource.h"
+#include "../misc/trace.h"
 
 #include <vlc_sout.h>
 #include <vlc_dialog.h>
@@ -63,7 +67,8 @@ static void Destructor( input_thread_t * p_input );
 static  void *Run            ( void * );
 
 static input_thread_t * Create  ( vlc_object_t *, input_item_t *,
-                                  const char *, bool, input_resource_t * );
+                                  const char *, bool, input_resource_t *,
+                                  bool );
 static  int             Init    ( input_thread_t *p_input );
 static void             End     ( input_thread_t *p_input );
 static void             MainLoop( input_thread_t *p_input, bool b_interactive );
@@ -127,7 +132,26 @@ input_thread_t *input_Create( vlc_object_t *p_parent,
                               input_item_t *p_item,
                               const char *psz_log, input_resource_t *p_resource )
 {
-    return Create( p_parent, p_item, psz_log, false, p_resource );
+    return Create( p_parent, p_item, psz_log, false, p_resource, false );
+}
+
+#undef input_CreateStandby
+/**
+ * Create a new input_thread_t in standby.
+ *
+ * Once started, the input opens and demuxes its item, but keeps the last
+ * few seconds of data to itself, without decoders nor outputs, and without
+ * using the input resource. INPUT_LEAVE_STANDBY then plays it from the
+ * buffered data, which makes the switch to a live stream immediate.
+ *
+ * \see input_Create
+ */
+input_thread_t *input_CreateStandby( vlc_object_t *p_parent,
+                                     input_item_t *p_item,
+                                     const char *psz_log,
+                                     input_resource_t *p_resource )
+{
+    return Create( p_parent, p_item, psz_log, false, p_resource, true );
 }
 
 #undef input_CreateAndStart
@@ -161,7 +185,8 @@ input_thread_t *input_CreateAndStart( vlc_object_t *p_parent,
  */
 int input_Read( vlc_object_t *p_parent, input_item_t *p_item )
 {
-    input_thread_t *p_input = Create( p_parent, p_item, NULL, false, NULL );
+    input_thread_t *p_input = Create( p_parent, p_item, NULL, false, NULL,
+                                      false );
     if( !p_input )
         return VLC_EGENERIC;
 
@@ -188,7 +213,7 @@ int input_Preparse( vlc_object_t *p_parent, input_item_t *p_item )
     input_thread_t *p_input;
 
     /* Allocate descriptor */
-    p_input = Create( p_parent, p_item, NULL, true, NULL );
+    p_input = Create( p_parent, p_item, NULL, true, NULL, false );
     if( !p_input )
         return VLC_EGENERIC;
 
@@ -248,6 +273,8 @@ void input_Stop( input_thread_t *p_input, bool b_abort )
      * It is needed here even if it is done in INPUT_CONTROL_SET_DIE handler to
      * unlock the control loop */
     ObjectKillChildrens( VLC_OBJECT(p_input) );
+    /* Wake up the input thread if it is blocked on I/O */
+    vlc_interrupt_kill( p_input->p->interrupt );
 
     vlc_mutex_lock( &p_input->p->lock_control );
     p_input->p->b_abort |= b_abort;
@@ -298,7 +325,7 @@ input_item_t *input_GetItem( input_thread_t *p_input )
  *****************************************************************************/
 static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
                                const char *psz_header, bool b_quick,
-                               input_resource_t *p_resource )
+                               input_resource_t *p_resource, bool b_standby )
 {
     input_thread_t *p_input = NULL;                 /* thread descriptor */
     int i;
@@ -325,6 +352,14 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
         return NULL;
     }
 
+    p_input->p->interrupt = vlc_interrupt_create();
+    if( unlikely(p_input->p->interrupt == NULL) )
+    {
+        free( p_input->p );
+        vlc_object_release( p_input );
+        return NULL;
+    }
+
     /* Parse input options */
     vlc_mutex_lock( &p_item->lock );
     assert( (int)p_item->optflagc == p_item->i_options );
@@ -341,6 +376,10 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
     p_input->p->b_can_pace_control = true;
     p_input->p->i_start = 0;
     p_input->p->i_time  = 0;
+    p_input->p->trick.i_mode = INPUT_TRICK_NONE;
+    p_input->p->trick.i_time = -1;
+    p_input->p->trick.i_landing = -1;
+    p_input->p->trick.i_date = 0;
     p_input->p->i_stop  = 0;
     p_input->p->i_run   = 0;
     p_input->p->i_title = 0;
@@ -349,6 +388,7 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
     p_input->p->i_state = INIT_S;
     p_input->p->i_rate = INPUT_RATE_DEFAULT;
     p_input->p->b_recording = false;
+    p_input->p->b_standby = b_standby;
     memset( &p_input->p->bookmark, 0, sizeof(p_input->p->bookmark) );
     TAB_INIT( p_input->p->i_bookmark, p_input->p->pp_bookmark );
     TAB_INIT( p_input->p->i_attachment, p_input->p->attachment );
@@ -391,7 +431,9 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
         p_input->p->p_resource_private = input_resource_New( VLC_OBJECT( p_input ) );
         p_input->p->p_resource = input_resource_Hold( p_input->p->p_resource_private );
     }
-    input_resource_SetInput( p_input->p->p_resource, p_input );
+    /* A standby input must not take the resource from the playing one */
+    if( !b_standby )
+        input_resource_SetInput( p_input->p->p_resource, p_input );
 
     /* Init control buffer */
     vlc_mutex_init( &p_input->p->lock_control );
@@ -514,9 +556,110 @@ static void Destructor( input_thread_t * p_input )
 
     vlc_cond_destroy( &p_input->p->wait_control );
     vlc_mutex_destroy( &p_input->p->lock_control );
+    vlc_interrupt_destroy( p_input->p->interrupt );
     free( p_input->p );
 }
 
+#ifdef HAVE_SCHED_GETAFFINITY
+/* Parses a list of CPUs such as "0-7,16-23", as in the cpuset and sysfs
+ * files of Linux */
+static int ParseCPUList( cpu_set_t *p_set, const char *psz_list )
+{
+    CPU_ZERO( p_set );
+    for( const char *p = psz_list; *p != '\0' && *p != '\n'; )
+    {
+        char *end;
+        unsigned long i_first = strtoul( p, &end, 10 ), i_last = i_first;
+
+        if( end == p )
+            return VLC_EGENERIC;
+        if( *end == '-' )
+        {
+            p = end + 1;
+            i_last = strtoul( p, &end, 10 );
+            if( end == p || i_last < i_first )
+                return VLC_EGENERIC;
+        }
+        for( unsigned long i = i_first; i <= i_last && i < CPU_SETSIZE; i++ )
+            CPU_SET( i, p_set );
+
+        p = end;
+        if( *p == ',' )
+            p++;
+        else if( *p != '\0' && *p != '\n' )
+            return VLC_EGENERIC;
+    }
+    return CPU_COUNT( p_set ) > 0 ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+/* Restricts the input thread to the configured CPUs. The threads it starts
+ * afterwards (decoders, outputs, stream output) inherit its affinity, and
+ * with the default first touch policy of Linux, the pictures and blocks
+ * they allocate come from the memory of the NUMA node they run on. */
+static void SetAffinity( input_thread_t *p_input )
+{
+    const int i_node = var_InheritInteger( p_input, "cpu-node" );
+    char *psz_cpus = var_InheritString( p_input, "cpu-set" );
+    cpu_set_t set;
+
+    if( i_node < 0 && psz_cpus == NULL )
+        return;
+
+    if( sched_getaffinity( 0, sizeof(set), &set ) )
+        goto out;
+
+    if( i_node >= 0 )
+    {
+        char psz_path[64], *psz_list = NULL;
+        size_t i_list = 0;
+        cpu_set_t node;
+
+        snprintf( psz_path, sizeof(psz_path),
+                  "/sys/devices/system/node/node%d/cpulist", i_node );
+        FILE *file = vlc_fopen( psz_path, "rt" );
+        if( file != NULL )
+        {
+            if( getline( &psz_list, &i_list, file ) == -1 )
+            {
+                free( psz_list );
+                psz_list = NULL;
+            }
+            fclose( file );
+        }
+        if( psz_list == NULL || ParseCPUList( &node, psz_list ) )
+        {
+            msg_Err( p_input, "unknown NUMA node %d", i_node );
+            free( psz_list );
+            goto out;
+        }
+        free( psz_list );
+        CPU_AND( &set, &set, &node );
+    }
+
+    if( psz_cpus != NULL )
+    {
+        cpu_set_t cpus;
+
+        if( ParseCPUList( &cpus, psz_cpus ) )
+        {
+            msg_Err( p_input, "invalid CPU list \"%s\"", psz_cpus );
+            goto out;
+        }
+        CPU_AND( &set, &set, &cpus );
+    }
+
+    if( CPU_COUNT( &set ) == 0 )
+        msg_Err( p_input, "none of the configured CPUs is available" );
+    else if( sched_setaffinity( 0, sizeof(set), &set ) )
+        msg_Err( p_input, "cannot set CPU affinity: %s",
+                 vlc_strerror_c(errno) );
+    else
+        msg_Dbg( p_input, "running on %d CPU(s)", CPU_COUNT( &set ) );
+out:
+    free( psz_cpus );
+}
+#endif
+
 /*****************************************************************************
  * Run: main thread loop
  * This is the "normal" thread that spawns the input processing chain,
@@ -527,6 +670,12 @@ static void *Run( void *obj )
     input_thread_t *p_input = (input_thread_t *)obj;
     const int canc = vlc_savecancel();
 
+    vlc_interrupt_set( p_input->p->interrupt );
+
+#ifdef HAVE_SCHED_GETAFFINITY
+    SetAffinity( p_input );
+#endif
+
     if( Init( p_input ) )
         goto exit;
 
@@ -545,6 +694,7 @@ exit:
         input_SendEventAbort( p_input );
     input_SendEventDead( p_input );
 
+    vlc_interrupt_set( NULL );
     vlc_restorecancel( canc );
     return NULL;
 }
@@ -568,7 +718,17 @@ static void MainLoopDemux( input_thread_t *p_input, bool *pb_changed, bool *pb_d
         ( p_input->p->i_run > 0 && i_start_mdate+p_input->p->i_run < mdate() ) )
         i_ret = 0; /* EOF */
     else
+    {
+        const mtime_t i_start = mdate();
+        vlc_trace_Begin( "demux" );
         i_ret = demux_Demux( p_input->p->input.p_demux );
+        vlc_trace_End( "demux" );
+
+        vlc_mutex_lock( &p_input->p->counters.counters_lock );
+        stats_AddLatency( &p_input->p->counters.latency[INPUT_LATENCY_DEMUX],
+                          mdate() - i_start );
+        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+    }
 
     if( i_ret > 0 )
     {
@@ -608,6 +768,202 @@ static void MainLoopDemux( input_thread_t *p_input, bool *pb_changed, bool *pb_d
     }
 }
 
+/* Trick play: above INPUT_TRICK_SPEED times the normal speed, or backward,
+ * the input seeks from key frame to key frame. Backward and below that
+ * speed, it demuxes whole GOPs in reverse order, which the decoders cache and
+ * display backward. */
+#define INPUT_TRICK_SPEED       4
+#define INPUT_TRICK_PERIOD      (CLOCK_FREQ/8)
+#define INPUT_TRICK_GOP_STEP    (CLOCK_FREQ/2)
+#define INPUT_TRICK_DEMUX_MAX   1000
+
+/**
+ * Returns the trick play mode (input_trick_e) of a rate.
+ */
+static int InputGetTrickMode( input_thread_t *p_input, int i_rate )
+{
+    /* Trick play seeks the demuxer, and paces the input itself */
+    if( !p_input->p->input.b_can_pace_control || p_input->p->p_sout != NULL ||
+        !var_GetBool( p_input, "can-seek" ) )
+        return INPUT_TRICK_NONE;
+
+    if( i_rate < 0 )
+        return -i_rate * INPUT_TRICK_SPEED >= INPUT_RATE_DEFAULT ?
+               INPUT_TRICK_REVERSE : INPUT_TRICK_KEYFRAMES;
+    if( i_rate * INPUT_TRICK_SPEED < INPUT_RATE_DEFAULT )
+        return INPUT_TRICK_KEYFRAMES;
+    return INPUT_TRICK_NONE;
+}
+
+/* Ends the trick play: the normal playback resumes at the last step */
+static void MainLoopTrickEnd( input_thread_t *p_input )
+{
+    vlc_value_t val = { .i_int = INPUT_RATE_DEFAULT };
+
+    msg_Dbg( p_input, "trick play stopped" );
+    p_input->p->trick.i_date = mdate() + INPUT_TRICK_PERIOD;
+    input_ControlPush( p_input, INPUT_CONTROL_SET_RATE, &val );
+}
+
+/* Demuxes until the demuxer time passes i_time, returns as demux_Demux() */
+static int MainLoopTrickDemux( input_thread_t *p_input, mtime_t i_time )
+{
+    demux_t *p_demux = p_input->p->input.p_demux;
+    int i_ret = 1;
+
+    for( int i = 0; i < INPUT_TRICK_DEMUX_MAX && i_ret > 0; i++ )
+    {
+        mtime_t i_demux_time;
+
+        i_ret = demux_Demux( p_demux );
+        if( i_ret > 0 &&
+            ( demux_Control( p_demux, DEMUX_GET_TIME, &i_demux_time ) ||
+              i_demux_time > i_time ) )
+            break;
+    }
+    if( i_ret < 0 )
+        input_ChangeState( p_input, ERROR_S );
+    return i_ret;
+}
+
+/**
+ * MainLoopTrick
+ * It demuxes the next step of the trick play, in place of MainLoopDemux
+ */
+static void MainLoopTrick( input_thread_t *p_input )
+{
+    input_thread_private_t *p = p_input->p;
+    demux_t *p_demux = p->input.p_demux;
+    const int i_rate = p->i_rate;
+    mtime_t i_time = p->trick.i_time;
+    mtime_t i_landing;
+
+    if( i_time < 0 && demux_Control( p_demux, DEMUX_GET_TIME, &i_time ) )
+        i_time = 0;
+
+    if( p->trick.i_mode == INPUT_TRICK_KEYFRAMES )
+    {
+        /* Show a key frame every period, at the nearest stream time */
+        i_time += INPUT_TRICK_PERIOD * INPUT_RATE_DEFAULT / i_rate;
+        if( i_time < 0 )
+        {
+            p->trick.i_time = 0;
+            MainLoopTrickEnd( p_input );
+            return;
+        }
+        p->trick.i_time = i_time;
+        p->trick.i_date = mdate() + INPUT_TRICK_PERIOD;
+
+        if( demux_Control( p_demux, DEMUX_SET_TIME, i_time, false ) ||
+            demux_Control( p_demux, DEMUX_GET_TIME, &i_landing ) )
+        {
+            msg_Warn( p_input, "trick play seek to %"PRId64" failed", i_time );
+            MainLoopTrickEnd( p_input );
+            return;
+        }
+        /* Do not show the same key frame twice */
+        if( i_landing == p->trick.i_landing )
+            return;
+        p->trick.i_landing = i_landing;
+
+        if( MainLoopTrickDemux( p_input, i_landing ) == 0 && i_rate > 0 )
+        {
+            msg_Dbg( p_input, "EOF reached" );
+            p->input.b_eof = true;
+            es_out_Eos( p->p_es_out );
+        }
+        return;
+    }
+
+    /* Demux the GOP ending at i_time, then let the decoders show it
+     * backward: seek earlier until the landing is before its end */
+    if( i_time <= 0 )
+    {
+        p->trick.i_time = 0;
+        MainLoopTrickEnd( p_input );
+        return;
+    }
+    for( mtime_t i_step = INPUT_TRICK_GOP_STEP;; i_step *= 2 )
+    {
+        const mtime_t i_seek = __MAX( i_time - i_step, 0 );
+
+        if( demux_Control( p_demux, DEMUX_SET_TIME, i_seek, false ) ||
+            demux_Control( p_demux, DEMUX_GET_TIME, &i_landing ) )
+        {
+            msg_Warn( p_input, "trick play seek to %"PRId64" failed", i_seek );
+            MainLoopTrickEnd( p_input );
+            return;
+        }
+        if( i_landing < i_time || i_seek == 0 )
+            break;
+    }
+    i_landing = __MIN( i_landing, i_time );
+
+    /* The end of the stream ends the GOP as well */
+    if( MainLoopTrickDemux( p_input, i_time ) < 0 )
+        return;
+    es_out_Eos( p->p_es_out );
+
+    /* Demux the previous GOP when this one starts to be shown */
+    const mtime_t now = mdate();
+    p->trick.i_time = i_landing;
+    p->trick.i_date = __MAX( p->trick.i_date, now ) +
+                      ( i_time - i_landing ) * -i_rate / INPUT_RATE_DEFAULT;
+}
+
+/**
+ * Flushes the trick play before a seek: the next step starts from the time
+ * the demuxer lands at.
+ */
+static void ControlTrickSeek( input_thread_t *p_input )
+{
+    input_thread_private_t *p = p_input->p;
+
+    es_out_SetTrickMode( p->p_es_out, p->trick.i_mode, p->i_rate );
+    p->trick.i_time = -1;
+    p->trick.i_landing = -1;
+    p->trick.i_date = mdate();
+}
+
+/**
+ * Changes the trick play mode for a new rate.
+ */
+static int ControlSetTrickMode( input_thread_t *p_input, int i_rate )
+{
+    input_thread_private_t *p = p_input->p;
+    const int i_trick = InputGetTrickMode( p_input, i_rate );
+
+    if( i_trick == INPUT_TRICK_NONE )
+    {
+        if( p->trick.i_mode == INPUT_TRICK_NONE )
+            return VLC_SUCCESS;
+
+        es_out_SetTrickMode( p->p_es_out, INPUT_TRICK_NONE, i_rate );
+        p->trick.i_mode = INPUT_TRICK_NONE;
+
+        /* Resume the normal playback where the trick play stands */
+        es_out_SetTime( p->p_es_out, -1 );
+        if( p->trick.i_time >= 0 )
+            demux_Control( p->input.p_demux, DEMUX_SET_TIME, p->trick.i_time,
+                           !p->b_fast_seek );
+        if( p->i_slave > 0 )
+            SlaveSeek( p_input );
+        p->input.b_eof = false;
+        return VLC_SUCCESS;
+    }
+
+    if( es_out_SetTrickMode( p->p_es_out, i_trick, i_rate ) )
+        return VLC_EGENERIC;
+
+    if( p->trick.i_mode == INPUT_TRICK_NONE )
+        p->trick.i_time = p->i_time;
+    p->trick.i_mode = i_trick;
+    p->trick.i_landing = -1;
+    p->trick.i_date = mdate();
+    p->input.b_eof = false;
+    return VLC_SUCCESS;
+}
+
 static int MainLoopTryRepeat( input_thread_t *p_input, mtime_t *pi_start_mdate )
 {
     int i_repeat = var_GetInteger( p_input, "input-repeat" );
@@ -726,11 +1082,22 @@ static void MainLoop( input_thread_t *p_input, bool b_interactive )
          * The same problem can be seen when seeking while paused */
         b_paused = p_input->p->i_state == PAUSE_S &&
                    ( !es_out_GetBuffering( p_input->p->p_es_out ) || p_input->p->input.b_eof );
+        /* A paced input has nothing to buffer in standby: it waits, opened */
+        if( p_input->p->b_standby && p_input->p->b_can_pace_control )
+            b_paused = true;
 
         b_demux_polled = true;
         if( !b_paused )
         {
-            if( !p_input->p->input.b_eof )
+            if( !p_input->p->input.b_eof &&
+                p_input->p->trick.i_mode != INPUT_TRICK_NONE )
+            {
+                if( p_input->p->trick.i_date <= mdate() )
+                    MainLoopTrick( p_input );
+
+                i_wakeup = p_input->p->trick.i_date;
+            }
+            else if( !p_input->p->input.b_eof )
             {
                 MainLoopDemux( p_input, &b_force_update, &b_demux_polled, i_start_mdate );
 
@@ -818,7 +1185,10 @@ static void MainLoop( input_thread_t *p_input, bool b_interactive )
             }
 
             /* Update the wakeup time */
-            if( i_wakeup != 0 )
+            if( p_input->p->trick.i_mode != INPUT_TRICK_NONE )
+                i_wakeup = p_input->p->input.b_eof ? i_wakeup
+                                                   : p_input->p->trick.i_date;
+            else if( i_wakeup != 0 )
                 i_wakeup = es_out_GetWakeup( p_input->p->p_es_out );
         } while( i_current < i_wakeup );
     }
@@ -840,6 +1210,9 @@ static void InitStatistics( input_thread_t * p_input )
         INIT_COUNTER( read_packets, COUNTER );
         INIT_COUNTER( demux_read, COUNTER );
         INIT_COUNTER( input_bitrate, DERIVATIVE );
+        INIT_COUNTER( prefetch_hits, COUNTER );
+        INIT_COUNTER( prefetch_misses, COUNTER );
+        INIT_COUNTER( prefetch_stall, COUNTER );
         INIT_COUNTER( demux_bitrate, DERIVATIVE );
         INIT_COUNTER( demux_corrupted, COUNTER );
         INIT_COUNTER( demux_discontinuity, COUNTER );
@@ -1207,6 +1580,9 @@ static int Init( input_thread_t * p_input )
 
     /* Create es out */
     p_input->p->p_es_out = input_EsOutTimeshiftNew( p_input, p_input->p->p_es_out_display, p_input->p->i_rate );
+    if( p_input->p->b_standby &&
+        es_out_SetStandby( p_input->p->p_es_out, true ) )
+        goto error;
 
     /* */
     input_ChangeState( p_input, OPENING_S );
@@ -1299,7 +1675,8 @@ error:
         if( p_input->p->p_sout )
             input_resource_RequestSout( p_input->p->p_resource,
                                          p_input->p->p_sout, NULL );
-        input_resource_SetInput( p_input->p->p_resource, NULL );
+        if( !p_input->p->b_standby )
+            input_resource_SetInput( p_input->p->p_resource, NULL );
         if( p_input->p->p_resource_private )
             input_resource_Terminate( p_input->p->p_resource_private );
     }
@@ -1313,6 +1690,9 @@ error:
         EXIT_COUNTER( read_packets );
         EXIT_COUNTER( demux_read );
         EXIT_COUNTER( input_bitrate );
+        EXIT_COUNTER( prefetch_hits );
+        EXIT_COUNTER( prefetch_misses );
+        EXIT_COUNTER( prefetch_stall );
         EXIT_COUNTER( demux_bitrate );
         EXIT_COUNTER( demux_corrupted );
         EXIT_COUNTER( demux_discontinuity );
@@ -1384,6 +1764,9 @@ static void End( input_thread_t * p_input )
             CL_CO( read_packets );
             CL_CO( demux_read );
             CL_CO( input_bitrate );
+            CL_CO( prefetch_hits );
+            CL_CO( prefetch_misses );
+            CL_CO( prefetch_stall );
             CL_CO( demux_bitrate );
             CL_CO( demux_corrupted );
             CL_CO( demux_discontinuity );
@@ -1420,7 +1803,8 @@ static void End( input_thread_t * p_input )
     /* */
     input_resource_RequestSout( p_input->p->p_resource,
                                  p_input->p->p_sout, NULL );
-    input_resource_SetInput( p_input->p->p_resource, NULL );
+    if( !p_input->p->b_standby )
+        input_resource_SetInput( p_input->p->p_resource, NULL );
     if( p_input->p->p_resource_private )
         input_resource_Terminate( p_input->p->p_resource_private );
 }
@@ -1675,6 +2059,8 @@ static bool Control( input_thread_t *p_input,
                 f_pos = 1.f;
             /* Reset the decoders states and clock sync (before calling the demuxer */
             es_out_SetTime( p_input->p->p_es_out, -1 );
+            if( p_input->p->trick.i_mode != INPUT_TRICK_NONE )
+                ControlTrickSeek( p_input );
             if( demux_Control( p_input->p->input.p_demux, DEMUX_SET_POSITION,
                                (double) f_pos, !p_input->p->b_fast_seek ) )
             {
@@ -1707,8 +2093,17 @@ static bool Control( input_thread_t *p_input,
             if( i_time < 0 )
                 i_time = 0;
 
+            /* Seek within the timeshift window first, when there is one */
+            if( !es_out_SetTime( p_input->p->p_es_out, i_time ) )
+            {
+                b_force_update = true;
+                break;
+            }
+
             /* Reset the decoders states and clock sync (before calling the demuxer */
             es_out_SetTime( p_input->p->p_es_out, -1 );
+            if( p_input->p->trick.i_mode != INPUT_TRICK_NONE )
+                ControlTrickSeek( p_input );
 
             i_ret = demux_Control( p_input->p->input.p_demux,
                                    DEMUX_SET_TIME, i_time,
@@ -1789,7 +2184,8 @@ static bool Control( input_thread_t *p_input,
             /* Apply direction */
             if( i_rate_sign < 0 )
             {
-                if( p_input->p->input.b_rescale_ts )
+                if( p_input->p->input.b_rescale_ts &&
+                    InputGetTrickMode( p_input, -i_rate ) == INPUT_TRICK_NONE )
                 {
                     msg_Dbg( p_input, "cannot set negative rate" );
                     i_rate = p_input->p->i_rate;
@@ -1829,13 +2225,21 @@ static bool Control( input_thread_t *p_input,
                 }
             }
 
+            if( i_rate != p_input->p->i_rate &&
+                ControlSetTrickMode( p_input, i_rate ) )
+            {
+                msg_Warn( p_input, "cannot set trick play rate" );
+                i_rate = i_rate < 0 ? p_input->p->i_rate : i_rate;
+            }
+
             /* */
             if( i_rate != p_input->p->i_rate )
             {
                 p_input->p->i_rate = i_rate;
                 input_SendEventRate( p_input, i_rate );
 
-                if( p_input->p->input.b_rescale_ts )
+                if( p_input->p->input.b_rescale_ts &&
+                    p_input->p->trick.i_mode == INPUT_TRICK_NONE )
                 {
                     const int i_rate_source = (p_input->p->b_can_pace_control || p_input->p->b_can_rate_control ) ? i_rate : INPUT_RATE_DEFAULT;
                     es_out_SetRate( p_input->p->p_es_out, i_rate_source, i_rate );
@@ -2021,6 +2425,20 @@ static bool Control( input_thread_t *p_input,
             }
             break;
 
+        case INPUT_CONTROL_LEAVE_STANDBY:
+            if( !p_input->p->b_standby )
+                break;
+            p_input->p->b_standby = false;
+            input_resource_SetInput( p_input->p->p_resource, p_input );
+            es_out_SetStandby( p_input->p->p_es_out, false );
+
+            /* The events sent in standby went unnoticed */
+            input_SendEventState( p_input, p_input->p->i_state );
+            var_TriggerCallback( p_input, "can-seek" );
+            var_TriggerCallback( p_input, "can-pause" );
+            b_force_update = true;
+            break;
+
         case INPUT_CONTROL_SET_FRAME_NEXT:
             if( p_input->p->i_state == PAUSE_S )
             {
@@ -2278,12 +2696,16 @@ static int InputSourceInit( input_thread_t *p_input,
             in->b_can_pause = false;
         var_SetBool( p_input, "can-pause", in->b_can_pause || !in->b_can_pace_control ); /* XXX temporary because of es_out_timeshift*/
         var_SetBool( p_input, "can-rate", !in->b_can_pace_control || in->b_can_rate_control ); /* XXX temporary because of es_out_timeshift*/
-        var_SetBool( p_input, "can-rewind", !in->b_rescale_ts && !in->b_can_pace_control && in->b_can_rate_control );
 
         bool b_can_seek;
         if( demux_Control( in->p_demux, DEMUX_CAN_SEEK, &b_can_seek ) )
             b_can_seek = false;
         var_SetBool( p_input, "can-seek", b_can_seek );
+
+        /* Seekable paced demuxers rewind with the trick play */
+        var_SetBool( p_input, "can-rewind",
+                     ( !in->b_rescale_ts && !in->b_can_pace_control && in->b_can_rate_control ) ||
+                     ( in->b_can_pace_control && b_can_seek ) );
     }
     else
     {   /* Now try a real access */
@@ -2383,12 +2805,15 @@ static int InputSourceInit( input_thread_t *p_input,
                          in->b_can_pause || !in->b_can_pace_control ); /* XXX temporary because of es_out_timeshift*/
             var_SetBool( p_input, "can-rate",
                          !in->b_can_pace_control || in->b_can_rate_control ); /* XXX temporary because of es_out_timeshift*/
-            var_SetBool( p_input, "can-rewind",
-                         !in->b_rescale_ts && !in->b_can_pace_control );
 
             stream_Control( p_stream, STREAM_CAN_SEEK, &b );
             var_SetBool( p_input, "can-seek", b );
 
+            /* Seekable paced streams rewind with the trick play */
+            var_SetBool( p_input, "can-rewind",
+                         ( !in->b_rescale_ts && !in->b_can_pace_control ) ||
+                         ( in->b_can_pace_control && b ) );
+
             in->b_title_demux = false;
 
             stream_Control( p_stream, STREAM_GET_PTS_DELAY, &i_pts_delay );
@@ -3075,7 +3500,7 @@ void input_UpdateStatistic( input_thread_t *p_input,
 {
     assert( p_input->p->i_state != INIT_S );
 
-    vlc_mutex_lock( &p_input->p->counters.counters_lock);
+    /* The counters are atomic, the rates are computed with the statistics */
     switch( i_type )
     {
 #define I(c) stats_Update( p_input->p->counters.c, i_delta, NULL )
@@ -3091,20 +3516,14 @@ void input_UpdateStatistic( input_thread_t *p_input,
     case INPUT_STATISTIC_SENT_PACKET:
         I(p_sout_sent_packets);
         break;
-#undef I
     case INPUT_STATISTIC_SENT_BYTE:
-    {
-        uint64_t bytes;
-
-        stats_Update( p_input->p->counters.p_sout_sent_bytes, i_delta, &bytes );
-        stats_Update( p_input->p->counters.p_sout_send_bitrate, bytes, NULL );
+        I(p_sout_sent_bytes);
         break;
-    }
+#undef I
     default:
         msg_Err( p_input, "Invalid statistic type %d (internal error)", i_type );
         break;
     }
-    vlc_mutex_unlock( &p_input->p->counters.counters_lock);
 }
 
 /**/
@@ -30,7 +30,6 @@
 /**********************************************************************
  * Item metadata
  **********************************************************************/
-void input_item_SetPreparsed( input_item_t *p_i, bool b_preparsed );
 void input_item_SetArtNotFound( input_item_t *p_i, bool b_not_found );
 void input_item_SetArtFetched( input_item_t *p_i, bool b_art_fetched );
 void input_item_SetEpg( input_item_t *p_item, const vlc_epg_t *p_epg );
@@ -54,6 +53,17 @@ void input_resource_TerminateSout( input_resource_t *p_resource );
  */
 bool input_resource_HasVout( input_resource_t *p_resource );
 
+/**
+ * This function deletes the idle decoders kept in the resources.
+ */
+void input_resource_TerminateDecoders( input_resource_t *p_resource );
+
+/**
+ * This function stops the audio output left playing for gapless playback,
+ * once it has played its last samples.
+ */
+void input_resource_StopAout( input_resource_t *p_resource );
+
 /* input.c */
 
 /* */
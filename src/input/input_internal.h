@@ -27,6 +27,7 @@
 #include <vlc_access.h>
 #include <vlc_demux.h>
 #include <vlc_input.h>
+#include <vlc_interrupt.h>
 #include <libvlc.h>
 #include "input_interface.h"
 
@@ -74,6 +75,16 @@ typedef struct
     vlc_value_t val;
 } input_control_t;
 
+/**
+ * Trick play modes of the decoders (see input_DecoderSetTrickMode)
+ */
+enum input_trick_e
+{
+    INPUT_TRICK_NONE,      /* normal playback */
+    INPUT_TRICK_KEYFRAMES, /* decode the key frames only, display them at once */
+    INPUT_TRICK_REVERSE,   /* cache the decoded GOPs, display them backward */
+};
+
 /** Private input fields */
 struct input_thread_private_t
 {
@@ -86,6 +97,7 @@ struct input_thread_private_t
 
     /* Current state */
     bool        b_recording;
+    bool        b_standby;  /* see input_CreateStandby() */
     int         i_rate;
 
     /* Playtime configuration and state */
@@ -95,6 +107,15 @@ struct input_thread_private_t
     int64_t     i_time;     /* Current time */
     bool        b_fast_seek;/* :input-fast-seek */
 
+    /* Trick play (see MainLoopTrick) */
+    struct
+    {
+        int     i_mode;     /* input_trick_e */
+        int64_t i_time;     /* Stream time of the next step, -1 if unknown */
+        int64_t i_landing;  /* Stream time the last seek landed at */
+        mtime_t i_date;     /* Date of the next step */
+    } trick;
+
     /* Output */
     bool            b_out_pace_control; /* XXX Move it ot es_sout ? */
     sout_instance_t *p_sout;            /* Idem ? */
@@ -138,6 +159,9 @@ struct input_thread_private_t
         counter_t *p_read_packets;
         counter_t *p_read_bytes;
         counter_t *p_input_bitrate;
+        counter_t *p_prefetch_hits;
+        counter_t *p_prefetch_misses;
+        counter_t *p_prefetch_stall;
         counter_t *p_demux_read;
         counter_t *p_demux_bitrate;
         counter_t *p_demux_corrupted;
@@ -152,12 +176,31 @@ struct input_thread_private_t
         counter_t *p_lost_abuffers;
         counter_t *p_displayed_pictures;
         counter_t *p_lost_pictures;
+        /* Moving averages of the video latency per stage (microseconds) */
+        mtime_t i_latency_queue;
+        mtime_t i_latency_decode;
+        mtime_t i_latency_output;
+        /* Latency histograms and decoder fifo depths */
+        input_latency_histogram_t latency[INPUT_LATENCY_STAGES];
+        int64_t i_video_fifo_blocks;
+        int64_t i_video_fifo_bytes;
+        int64_t i_audio_fifo_blocks;
+        int64_t i_audio_fifo_bytes;
+        /* Video drop policy */
+        int64_t i_video_drop_level;
+        int64_t i_video_drop_escalations;
+        int64_t i_video_degraded_blocks;
+        /* Estimations of the master clock */
+        float f_clock_drift;
+        mtime_t i_clock_jitter;
         vlc_mutex_t counters_lock;
     } counters;
 
     /* Buffer of pending actions */
     vlc_mutex_t lock_control;
     vlc_cond_t  wait_control;
+    /* Interrupts the blocking I/O of the input thread when stopping */
+    vlc_interrupt_t *interrupt;
     int i_control;
     input_control_t control[INPUT_CONTROL_FIFO_SIZE];
 
@@ -212,6 +255,8 @@ enum input_control_e
     INPUT_CONTROL_SET_RECORD_STATE,
 
     INPUT_CONTROL_SET_FRAME_NEXT,
+
+    INPUT_CONTROL_LEAVE_STANDBY,
 };
 
 /* Internal helpers */
@@ -251,6 +296,9 @@ int subtitles_Filter( const char *);
 void input_SplitMRL( const char **, const char **, const char **,
                      const char **, char * );
 
+/* stats.c */
+void stats_AddLatency( input_latency_histogram_t *, mtime_t );
+
 /* meta.c */
 void vlc_audio_replay_gain_MergeFromMeta( audio_replay_gain_t *p_dst,
                                           const vlc_meta_t *p_meta );
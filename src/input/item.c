@@ -1053,18 +1053,41 @@ void input_item_node_AppendNode( input_item_node_t *p_parent, input_item_node_t
     p_child->p_parent = p_parent;
 }
 
-void input_item_node_PostAndDelete( input_item_node_t *p_root )
+static void post_tree( input_item_node_t *p_root, bool b_partial )
 {
     post_subitems( p_root );
 
     vlc_event_t event;
     event.type = vlc_InputItemSubItemTreeAdded;
     event.u.input_item_subitem_tree_added.p_root = p_root;
+    event.u.input_item_subitem_tree_added.b_partial = b_partial;
     vlc_event_send( &p_root->p_item->event_manager, &event );
+}
 
+void input_item_node_PostAndDelete( input_item_node_t *p_root )
+{
+    post_tree( p_root, false );
     input_item_node_Delete( p_root );
 }
 
+void input_item_node_PostPartial( input_item_node_t *p_root )
+{
+    if( p_root->i_children <= 0 )
+        return;
+
+    post_tree( p_root, true );
+
+    for( int i = 0; i < p_root->i_children; i++ )
+    {
+        /* detach the child, so that deleting it leaves the root alone */
+        p_root->pp_children[i]->p_parent = NULL;
+        input_item_node_Delete( p_root->pp_children[i] );
+    }
+    free( p_root->pp_children );
+    p_root->pp_children = NULL;
+    p_root->i_children = 0;
+}
+
 /* Called by es_out when a new Elementary Stream is added or updated. */
 void input_item_UpdateTracksInfo(input_item_t *item, const es_format_t *fmt)
 {
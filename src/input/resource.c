@@ -41,8 +41,13 @@
 #include "../audio_output/aout_internal.h"
 #include "../video_output/vout_control.h"
 #include "input_interface.h"
+#include "clock.h"
+#include "decoder.h"
 #include "resource.h"
 
+/* Maximum number of idle decoders kept for the next input */
+#define RESOURCE_DECODER_MAX 4
+
 struct input_resource_t
 {
     atomic_uint    refs;
@@ -73,6 +78,17 @@ struct input_resource_t
 
     bool            b_aout_busy;
     audio_output_t *p_aout;
+
+    /* Idle decoders of the previous input, which the current one can take
+     * over (see input_resource_TakeDecoder()). They are kept for one input
+     * only: they hold the input which created them. */
+    unsigned        i_generation;
+    int             i_decoder;
+    struct
+    {
+        decoder_t *p_dec;
+        unsigned   i_generation;
+    } decoder[RESOURCE_DECODER_MAX];
 };
 
 /* */
@@ -408,6 +424,68 @@ void input_resource_ResetAout( input_resource_t *p_resource )
         aout_Destroy( p_aout );
 }
 
+void input_resource_StopAout( input_resource_t *p_resource )
+{
+    audio_output_t *p_aout = NULL;
+
+    vlc_mutex_lock( &p_resource->lock_hold );
+    if( !p_resource->b_aout_busy && p_resource->p_aout != NULL )
+    {
+        p_aout = p_resource->p_aout;
+        vlc_object_hold( p_aout );
+    }
+    vlc_mutex_unlock( &p_resource->lock_hold );
+
+    if( p_aout != NULL )
+    {
+        aout_DecStopLinger( p_aout );
+        vlc_object_release( p_aout );
+    }
+}
+
+/* */
+static bool DecoderFormatIsReusable( const es_format_t *p_dec_fmt,
+                                     const es_format_t *p_fmt )
+{
+    return p_dec_fmt->i_codec == p_fmt->i_codec &&
+           p_dec_fmt->i_original_fourcc == p_fmt->i_original_fourcc &&
+           p_dec_fmt->i_profile == p_fmt->i_profile &&
+           p_dec_fmt->i_level == p_fmt->i_level &&
+           p_dec_fmt->b_packetized == p_fmt->b_packetized &&
+           es_format_IsSimilar( p_dec_fmt, p_fmt ) &&
+           p_dec_fmt->i_extra == p_fmt->i_extra &&
+           ( p_fmt->i_extra <= 0 ||
+             !memcmp( p_dec_fmt->p_extra, p_fmt->p_extra, p_fmt->i_extra ) );
+}
+
+/* Removes the idle decoders which fulfill b_all or were not kept by the
+ * current input, and returns them in pp_dec to be destroyed unlocked */
+static int DropDecoders( input_resource_t *p_resource, bool b_all,
+                         decoder_t **pp_dec )
+{
+    int i_drop = 0;
+    int j = 0;
+
+    vlc_assert_locked( &p_resource->lock );
+
+    for( int i = 0; i < p_resource->i_decoder; i++ )
+    {
+        if( b_all || p_resource->decoder[i].i_generation !=
+                     p_resource->i_generation )
+            pp_dec[i_drop++] = p_resource->decoder[i].p_dec;
+        else
+            p_resource->decoder[j++] = p_resource->decoder[i];
+    }
+    p_resource->i_decoder = j;
+    return i_drop;
+}
+
+static void DeleteDecoders( decoder_t **pp_dec, int i_dec )
+{
+    for( int i = 0; i < i_dec; i++ )
+        input_DecoderDeleteIdle( pp_dec[i] );
+}
+
 /* Common */
 input_resource_t *input_resource_New( vlc_object_t *p_parent )
 {
@@ -445,15 +523,84 @@ input_resource_t *input_resource_Hold( input_resource_t *p_resource )
 
 void input_resource_SetInput( input_resource_t *p_resource, input_thread_t *p_input )
 {
+    decoder_t *pp_dec[RESOURCE_DECODER_MAX];
+    int i_dec = 0;
+
     vlc_mutex_lock( &p_resource->lock );
 
     if( p_resource->p_input && !p_input )
         assert( p_resource->i_vout == 0 );
 
+    /* The decoders of the previous input that the ending one did not take
+     * are useless now */
+    if( p_input )
+        p_resource->i_generation++;
+    else
+        i_dec = DropDecoders( p_resource, false, pp_dec );
+
     /* */
     p_resource->p_input = p_input;
 
     vlc_mutex_unlock( &p_resource->lock );
+
+    DeleteDecoders( pp_dec, i_dec );
+}
+
+decoder_t *input_resource_TakeDecoder( input_resource_t *p_resource,
+                                       const es_format_t *p_fmt )
+{
+    decoder_t *p_dec = NULL;
+
+    vlc_mutex_lock( &p_resource->lock );
+    for( int i = 0; i < p_resource->i_decoder; i++ )
+    {
+        if( !DecoderFormatIsReusable( &p_resource->decoder[i].p_dec->fmt_in,
+                                      p_fmt ) )
+            continue;
+
+        p_dec = p_resource->decoder[i].p_dec;
+        p_resource->i_decoder--;
+        memmove( &p_resource->decoder[i], &p_resource->decoder[i + 1],
+                 (p_resource->i_decoder - i) * sizeof(p_resource->decoder[0]) );
+        break;
+    }
+    vlc_mutex_unlock( &p_resource->lock );
+
+    return p_dec;
+}
+
+void input_resource_PutDecoder( input_resource_t *p_resource,
+                                decoder_t *p_dec )
+{
+    decoder_t *p_old = NULL;
+
+    vlc_mutex_lock( &p_resource->lock );
+    if( p_resource->i_decoder >= RESOURCE_DECODER_MAX )
+    {
+        p_old = p_resource->decoder[0].p_dec;
+        p_resource->i_decoder--;
+        memmove( &p_resource->decoder[0], &p_resource->decoder[1],
+                 p_resource->i_decoder * sizeof(p_resource->decoder[0]) );
+    }
+    p_resource->decoder[p_resource->i_decoder].p_dec = p_dec;
+    p_resource->decoder[p_resource->i_decoder].i_generation =
+        p_resource->i_generation;
+    p_resource->i_decoder++;
+    vlc_mutex_unlock( &p_resource->lock );
+
+    if( p_old != NULL )
+        input_DecoderDeleteIdle( p_old );
+}
+
+void input_resource_TerminateDecoders( input_resource_t *p_resource )
+{
+    decoder_t *pp_dec[RESOURCE_DECODER_MAX];
+
+    vlc_mutex_lock( &p_resource->lock );
+    int i_dec = DropDecoders( p_resource, true, pp_dec );
+    vlc_mutex_unlock( &p_resource->lock );
+
+    DeleteDecoders( pp_dec, i_dec );
 }
 
 vout_thread_t *input_resource_RequestVout( input_resource_t *p_resource,
@@ -508,6 +655,7 @@ void input_resource_TerminateSout( input_resource_t *p_resource )
 
 void input_resource_Terminate( input_resource_t *p_resource )
 {
+    input_resource_TerminateDecoders( p_resource );
     input_resource_TerminateSout( p_resource );
     input_resource_ResetAout( p_resource );
     input_resource_TerminateVout( p_resource );
@@ -55,6 +55,17 @@ vout_thread_t *input_resource_HoldVout( input_resource_t * );
  */
 void input_resource_HoldVouts( input_resource_t *, vout_thread_t ***, size_t * );
 
+/**
+ * This function takes an idle decoder of the previous input which can
+ * decode the given format, if any.
+ */
+decoder_t *input_resource_TakeDecoder( input_resource_t *, const es_format_t * );
+
+/**
+ * This function keeps an idle decoder for the next input.
+ */
+void input_resource_PutDecoder( input_resource_t *, decoder_t * );
+
 /**
  * This function releases all resources (object).
  */
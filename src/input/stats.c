@@ -41,6 +41,7 @@ counter_t * stats_CounterCreate( int i_compute_type )
 
     if( !p_counter ) return NULL;
     p_counter->i_compute_type = i_compute_type;
+    atomic_init( &p_counter->value, 0 );
     p_counter->i_samples = 0;
     p_counter->pp_samples = NULL;
 
@@ -49,11 +50,11 @@ counter_t * stats_CounterCreate( int i_compute_type )
     return p_counter;
 }
 
-static inline int64_t stats_GetTotal(const counter_t *counter)
+static inline int64_t stats_GetTotal(counter_t *counter)
 {
-    if (counter == NULL || counter->i_samples == 0)
+    if (counter == NULL)
         return 0;
-    return counter->pp_samples[0]->value;
+    return atomic_load_explicit(&counter->value, memory_order_relaxed);
 }
 
 static inline float stats_GetRate(const counter_t *counter)
@@ -84,16 +85,30 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
         return;
 
     vlc_mutex_lock(&input->p->counters.counters_lock);
+
+    /* The rates are sampled here, rather than for every block */
+    stats_Update(input->p->counters.p_input_bitrate,
+                 stats_GetTotal(input->p->counters.p_read_bytes), NULL);
+    stats_Update(input->p->counters.p_demux_bitrate,
+                 stats_GetTotal(input->p->counters.p_demux_read), NULL);
+    stats_Update(input->p->counters.p_sout_send_bitrate,
+                 stats_GetTotal(input->p->counters.p_sout_sent_bytes), NULL);
+
     vlc_mutex_lock(&st->lock);
 
     /* Input */
     st->i_read_packets = stats_GetTotal(input->p->counters.p_read_packets);
     st->i_read_bytes = stats_GetTotal(input->p->counters.p_read_bytes);
     st->f_input_bitrate = stats_GetRate(input->p->counters.p_input_bitrate);
+    st->i_prefetch_hits = stats_GetTotal(input->p->counters.p_prefetch_hits);
+    st->i_prefetch_misses = stats_GetTotal(input->p->counters.p_prefetch_misses);
+    st->i_prefetch_stall = stats_GetTotal(input->p->counters.p_prefetch_stall);
     st->i_demux_read_bytes = stats_GetTotal(input->p->counters.p_demux_read);
     st->f_demux_bitrate = stats_GetRate(input->p->counters.p_demux_bitrate);
     st->i_demux_corrupted = stats_GetTotal(input->p->counters.p_demux_corrupted);
     st->i_demux_discontinuity = stats_GetTotal(input->p->counters.p_demux_discontinuity);
+    st->f_clock_drift = input->p->counters.f_clock_drift;
+    st->i_clock_jitter = input->p->counters.i_clock_jitter;
 
     /* Decoders */
     st->i_decoded_video = stats_GetTotal(input->p->counters.p_decoded_video);
@@ -114,6 +129,19 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
     /* Vouts */
     st->i_displayed_pictures = stats_GetTotal(input->p->counters.p_displayed_pictures);
     st->i_lost_pictures = stats_GetTotal(input->p->counters.p_lost_pictures);
+    st->i_latency_queue = input->p->counters.i_latency_queue;
+    st->i_latency_decode = input->p->counters.i_latency_decode;
+    st->i_latency_output = input->p->counters.i_latency_output;
+
+    /* Pipeline */
+    memcpy(st->latency, input->p->counters.latency, sizeof (st->latency));
+    st->i_video_fifo_blocks = input->p->counters.i_video_fifo_blocks;
+    st->i_video_fifo_bytes = input->p->counters.i_video_fifo_bytes;
+    st->i_audio_fifo_blocks = input->p->counters.i_audio_fifo_blocks;
+    st->i_audio_fifo_bytes = input->p->counters.i_audio_fifo_bytes;
+    st->i_video_drop_level = input->p->counters.i_video_drop_level;
+    st->i_video_drop_escalations = input->p->counters.i_video_drop_escalations;
+    st->i_video_degraded_blocks = input->p->counters.i_video_degraded_blocks;
 
     vlc_mutex_unlock(&st->lock);
     vlc_mutex_unlock(&input->p->counters.counters_lock);
@@ -124,17 +152,49 @@ void stats_ReinitInputStats( input_stats_t *p_stats )
     vlc_mutex_lock( &p_stats->lock );
     p_stats->i_read_packets = p_stats->i_read_bytes =
     p_stats->f_input_bitrate = p_stats->f_average_input_bitrate =
+    p_stats->i_prefetch_hits = p_stats->i_prefetch_misses =
+    p_stats->i_prefetch_stall =
     p_stats->i_demux_read_packets = p_stats->i_demux_read_bytes =
     p_stats->f_demux_bitrate = p_stats->f_average_demux_bitrate =
     p_stats->i_demux_corrupted = p_stats->i_demux_discontinuity =
+    p_stats->f_clock_drift = p_stats->i_clock_jitter =
     p_stats->i_displayed_pictures = p_stats->i_lost_pictures =
+    p_stats->i_latency_queue = p_stats->i_latency_decode =
+    p_stats->i_latency_output =
+    p_stats->i_video_fifo_blocks = p_stats->i_video_fifo_bytes =
+    p_stats->i_audio_fifo_blocks = p_stats->i_audio_fifo_bytes =
+    p_stats->i_video_drop_level = p_stats->i_video_drop_escalations =
+    p_stats->i_video_degraded_blocks =
     p_stats->i_played_abuffers = p_stats->i_lost_abuffers =
     p_stats->i_decoded_video = p_stats->i_decoded_audio =
     p_stats->i_sent_bytes = p_stats->i_sent_packets = p_stats->f_send_bitrate
      = 0;
+    memset( p_stats->latency, 0, sizeof( p_stats->latency ) );
     vlc_mutex_unlock( &p_stats->lock );
 }
 
+/**
+ * Add a sample to a latency histogram.
+ * The input counters lock must be held.
+ */
+void stats_AddLatency( input_latency_histogram_t *p_histo, mtime_t i_value )
+{
+    unsigned i_bucket = 0;
+
+    if( i_value < 0 )
+        i_value = 0;
+    for( mtime_t i_bound = INPUT_LATENCY_BUCKET_BASE;
+         i_value >= i_bound && i_bucket < INPUT_LATENCY_BUCKETS - 1;
+         i_bound *= 2 )
+        i_bucket++;
+
+    p_histo->i_count++;
+    p_histo->i_total += i_value;
+    if( i_value > p_histo->i_max )
+        p_histo->i_max = i_value;
+    p_histo->pi_buckets[i_bucket]++;
+}
+
 void stats_CounterClean( counter_t *p_c )
 {
     if( p_c )
@@ -157,6 +217,9 @@ void stats_CounterClean( counter_t *p_c )
  * \param val the vlc_value union containing the new value to aggregate. For
  * more information on how data is aggregated, \see stats_Create
  * \param val_new a pointer that will be filled with new data
+ *
+ * STATS_COUNTER counters are updated atomically, without the input counters
+ * lock. STATS_DERIVATIVE counters need it.
  */
 void stats_Update( counter_t *p_counter, uint64_t val, uint64_t *new_val )
 {
@@ -188,21 +251,12 @@ void stats_Update( counter_t *p_counter, uint64_t val, uint64_t *new_val )
         break;
     }
     case STATS_COUNTER:
-        if( p_counter->i_samples == 0 )
-        {
-            counter_sample_t *p_new = (counter_sample_t*)malloc(
-                                               sizeof( counter_sample_t ) );
-            p_new->value = 0;
-
-            INSERT_ELEM( p_counter->pp_samples, p_counter->i_samples,
-                         p_counter->i_samples, p_new );
-        }
-        if( p_counter->i_samples == 1 )
-        {
-            p_counter->pp_samples[0]->value += val;
-            if( new_val )
-                *new_val = p_counter->pp_samples[0]->value;
-        }
+    {
+        uint64_t total = atomic_fetch_add_explicit( &p_counter->value, val,
+                                                    memory_order_relaxed );
+        if( new_val )
+            *new_val = total + val;
         break;
     }
+    }
 }
@@ -38,6 +38,9 @@
 #include "stream.h"
 
 #include "input_internal.h"
+#include "../misc/trace.h"
+
+#include <vlc_interrupt.h>
 
 // #define STREAM_DEBUG 1
 
@@ -95,6 +98,19 @@
 #define STREAM_READ_ATONCE 1024
 #define STREAM_CACHE_TRACK_SIZE (STREAM_CACHE_SIZE/STREAM_CACHE_TRACK)
 
+/* Method2 prefetching (optional):
+ *  A thread reads from the access into a ring buffer ahead of the tracks,
+ *  so that a slow access does not stall the demuxer in AReadStream().
+ *  It stops when the ring holds i_window bytes. i_window follows the
+ *  consumption rate times the access read latency, and doubles whenever
+ *  the demuxer had to wait, up to the configured ring size.
+ *  Every call into the access goes through access_lock, while the ring
+ *  itself is protected by lock. A seek interrupts the pending access read,
+ *  whose data would be dropped anyway, rather than waiting for it.
+ */
+#define STREAM_PREFETCH_CHUNK  (64*1024)
+#define STREAM_PREFETCH_MIN    (4*STREAM_PREFETCH_CHUNK)
+
 typedef struct
 {
     int64_t i_date;
@@ -157,6 +173,36 @@ struct stream_sys_t
 
     } stream;
 
+    /* Method 2 prefetching */
+    struct
+    {
+        bool         b_active;
+        vlc_thread_t thread;
+        vlc_mutex_t  access_lock;
+        vlc_mutex_t  lock;
+        vlc_cond_t   wait_data;  /* Data added to the ring or EOF */
+        vlc_cond_t   wait_space; /* Data removed from the ring or flush */
+        vlc_interrupt_t *interrupt; /* Interrupts the thread access reads */
+        unsigned     i_seeks;    /* Seeks requested so far */
+        unsigned     i_waiters;  /* Seeks waiting for the access lock */
+
+        uint8_t *p_buffer;
+        size_t   i_size;         /* Ring buffer size */
+        size_t   i_begin;        /* Offset of the first buffered byte */
+        size_t   i_length;       /* Buffered bytes */
+        uint64_t i_pos;          /* Stream position of i_begin */
+        size_t   i_window;       /* Bytes the thread tries to keep buffered */
+        size_t   i_floor;        /* Lower bound of i_window, raised by misses */
+        bool     b_eof;
+        bool     b_stop;
+
+        /* Estimators for the window size */
+        mtime_t  i_rate_date;
+        uint64_t i_rate_bytes;
+        uint64_t i_rate;         /* Consumed bytes per second */
+        mtime_t  i_latency;      /* Duration of one access read */
+    } prefetch;
+
     /* Peek temporary buffer */
     unsigned int i_peek;
     uint8_t *p_peek;
@@ -197,6 +243,11 @@ static int  AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned in
 static int  AStreamSeekStream( stream_t *s, uint64_t i_pos );
 static void AStreamPrebufferStream( stream_t *s );
 static int  AReadStream( stream_t *s, void *p_read, unsigned int i_read );
+static int  APrefetchStart( stream_t *s );
+static int  APrefetchRead( stream_t *s, void *p_read, unsigned int i_read );
+static void APrefetchStop( stream_t *s );
+static void APrefetchLockSeek( stream_t *s );
+static void APrefetchFlush( stream_t *s );
 
 /* ReadDir */
 static int  AStreamReadDir( stream_t *s, input_item_node_t *p_node );
@@ -206,6 +257,7 @@ static int  AStreamGenericError( ) { return VLC_EGENERIC; }
 static int AStreamControl( stream_t *s, int i_query, va_list );
 static void AStreamDestroy( stream_t *s );
 static int  ASeek( stream_t *s, uint64_t i_pos );
+static int  AControl( stream_t *s, int i_query, ... );
 
 /****************************************************************************
  * stream_CommonNew: create an empty stream structure
@@ -319,6 +371,7 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
     TAB_INIT( p_sys->i_list, p_sys->list );
     p_sys->i_list_index = 0;
     p_sys->p_list_access = NULL;
+    p_sys->prefetch.b_active = false;
 
     /* Get the additional list of inputs if any (for concatenation) */
     if( ppsz_list && ppsz_list[0] )
@@ -424,6 +477,10 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
                 &p_sys->stream.p_buffer[i * STREAM_CACHE_TRACK_SIZE];
         }
 
+        /* Concatenated inputs switch accesses under our feet */
+        if( !p_sys->i_list && APrefetchStart( s ) )
+            goto error;
+
         /* Do the prebuffering */
         AStreamPrebufferStream( s );
 
@@ -450,6 +507,7 @@ error:
     }
     else if( p_sys->method == STREAM_METHOD_STREAM )
     {
+        APrefetchStop( s );
         free( p_sys->stream.p_buffer );
     }
     while( p_sys->i_list > 0 )
@@ -471,7 +529,10 @@ static void AStreamDestroy( stream_t *s )
     if( p_sys->method == STREAM_METHOD_BLOCK )
         block_ChainRelease( p_sys->block.p_first );
     else if( p_sys->method == STREAM_METHOD_STREAM )
+    {
+        APrefetchStop( s );
         free( p_sys->stream.p_buffer );
+    }
 
     free( p_sys->p_peek );
 
@@ -497,7 +558,10 @@ static void AStreamControlReset( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
 
-    p_sys->i_pos = p_sys->p_access->info.i_pos;
+    if( p_sys->prefetch.b_active )
+        p_sys->i_pos = p_sys->prefetch.i_pos;
+    else
+        p_sys->i_pos = p_sys->p_access->info.i_pos;
 
     if( p_sys->method == STREAM_METHOD_BLOCK )
     {
@@ -544,6 +608,10 @@ static void AStreamControlUpdate( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
 
+    /* The access is ahead of us when prefetching, and there is no list */
+    if( p_sys->prefetch.b_active )
+        return;
+
     p_sys->i_pos = p_sys->p_access->info.i_pos;
 
     if( p_sys->i_list )
@@ -602,7 +670,15 @@ static int AStreamControl( stream_t *s, int i_query, va_list args )
         case STREAM_SET_PRIVATE_ID_STATE:
         case STREAM_SET_PRIVATE_ID_CA:
         case STREAM_GET_PRIVATE_ID_STATE:
-            return access_vaControl( p_access, i_query, args );
+        {
+            if( !p_sys->prefetch.b_active )
+                return access_vaControl( p_access, i_query, args );
+
+            vlc_mutex_lock( &p_sys->prefetch.access_lock );
+            int ret = access_vaControl( p_access, i_query, args );
+            vlc_mutex_unlock( &p_sys->prefetch.access_lock );
+            return ret;
+        }
 
         case STREAM_GET_SIZE:
         {
@@ -615,7 +691,11 @@ static int AStreamControl( stream_t *s, int i_query, va_list args )
                     *pi_64 += s->p_sys->list[i]->i_size;
                 break;
             }
+            if( p_sys->prefetch.b_active )
+                vlc_mutex_lock( &p_sys->prefetch.access_lock );
             *pi_64 = access_GetSize( p_access );
+            if( p_sys->prefetch.b_active )
+                vlc_mutex_unlock( &p_sys->prefetch.access_lock );
             break;
         }
 
@@ -645,7 +725,15 @@ static int AStreamControl( stream_t *s, int i_query, va_list args )
         case STREAM_SET_TITLE:
         case STREAM_SET_SEEKPOINT:
         {
+            if( p_sys->prefetch.b_active )
+                APrefetchLockSeek( s );
             int ret = access_vaControl( p_access, i_query, args );
+            if( p_sys->prefetch.b_active )
+            {
+                if( ret == VLC_SUCCESS )
+                    APrefetchFlush( s );
+                vlc_mutex_unlock( &p_sys->prefetch.access_lock );
+            }
             if( ret == VLC_SUCCESS )
                 AStreamControlReset( s );
             return ret;
@@ -1024,7 +1112,10 @@ static int AStreamRefillBlock( stream_t *s )
             return VLC_EGENERIC;
 
         /* Fetch a block */
-        if( ( b = AReadBlock( s, &b_eof ) ) )
+        vlc_trace_Begin( "stream refill" );
+        b = AReadBlock( s, &b_eof );
+        vlc_trace_End( "stream refill" );
+        if( b != NULL )
             break;
         if( b_eof )
             return VLC_EGENERIC;
@@ -1144,7 +1235,6 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
     stream_sys_t *p_sys = s->p_sys;
 
     stream_track_t *p_current = &p_sys->stream.tk[p_sys->stream.i_tk];
-    access_t *p_access = p_sys->p_access;
 
     if( p_current->i_start >= p_current->i_end  && i_pos >= p_current->i_end )
         return 0; /* EOF */
@@ -1159,7 +1249,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
 #endif
 
     bool   b_aseek;
-    access_Control( p_access, ACCESS_CAN_SEEK, &b_aseek );
+    AControl( s, ACCESS_CAN_SEEK, &b_aseek );
     if( !b_aseek && i_pos < p_current->i_start )
     {
         msg_Warn( s, "AStreamSeekStream: can't seek" );
@@ -1167,7 +1257,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
     }
 
     bool   b_afastseek;
-    access_Control( p_access, ACCESS_CAN_FASTSEEK, &b_afastseek );
+    AControl( s, ACCESS_CAN_FASTSEEK, &b_afastseek );
 
     /* FIXME compute seek cost (instead of static 'stupid' value) */
     uint64_t i_skip_threshold;
@@ -1380,7 +1470,9 @@ static int AStreamRefillStream( stream_t *s )
             return VLC_EGENERIC;
 
         i_read = __MIN( i_toread, STREAM_CACHE_TRACK_SIZE - i_off );
+        vlc_trace_Begin( "stream refill" );
         i_read = AReadStream( s, &tk->p_buffer[i_off], i_read );
+        vlc_trace_End( "stream refill" );
 
         /* msg_Dbg( s, "AStreamRefillStream: read=%d", i_read ); */
         if( i_read <  0 )
@@ -1682,18 +1774,16 @@ static int AReadStream( stream_t *s, void *p_read, unsigned int i_read )
     input_thread_t *p_input = s->p_input;
     int i_read_orig = i_read;
 
+    if( p_sys->prefetch.b_active )
+        return APrefetchRead( s, p_read, i_read );
+
     if( !p_sys->i_list )
     {
         i_read = p_access->pf_read( p_access, p_read, i_read );
         if( p_input )
         {
-            uint64_t total;
-
-            vlc_mutex_lock( &p_input->p->counters.counters_lock );
-            stats_Update( p_input->p->counters.p_read_bytes, i_read, &total );
-            stats_Update( p_input->p->counters.p_input_bitrate, total, NULL );
+            stats_Update( p_input->p->counters.p_read_bytes, i_read, NULL );
             stats_Update( p_input->p->counters.p_read_packets, 1, NULL );
-            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
         }
         return i_read;
     }
@@ -1725,13 +1815,8 @@ static int AReadStream( stream_t *s, void *p_read, unsigned int i_read )
     /* Update read bytes in input */
     if( p_input )
     {
-        uint64_t total;
-
-        vlc_mutex_lock( &p_input->p->counters.counters_lock );
-        stats_Update( p_input->p->counters.p_read_bytes, i_read, &total );
-        stats_Update( p_input->p->counters.p_input_bitrate, total, NULL );
+        stats_Update( p_input->p->counters.p_read_bytes, i_read, NULL );
         stats_Update( p_input->p->counters.p_read_packets, 1, NULL );
-        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
     }
     return i_read;
 }
@@ -1750,15 +1835,9 @@ static block_t *AReadBlock( stream_t *s, bool *pb_eof )
         if( pb_eof ) *pb_eof = p_access->info.b_eof;
         if( p_input && p_block && libvlc_stats (p_access) )
         {
-            uint64_t total;
-
-            vlc_mutex_lock( &p_input->p->counters.counters_lock );
             stats_Update( p_input->p->counters.p_read_bytes,
-                          p_block->i_buffer, &total );
-            stats_Update( p_input->p->counters.p_input_bitrate,
-                          total, NULL );
+                          p_block->i_buffer, NULL );
             stats_Update( p_input->p->counters.p_read_packets, 1, NULL );
-            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
         }
         return p_block;
     }
@@ -1791,14 +1870,9 @@ static block_t *AReadBlock( stream_t *s, bool *pb_eof )
     {
         if( p_input )
         {
-            uint64_t total;
-
-            vlc_mutex_lock( &p_input->p->counters.counters_lock );
             stats_Update( p_input->p->counters.p_read_bytes,
-                          p_block->i_buffer, &total );
-            stats_Update( p_input->p->counters.p_input_bitrate, total, NULL );
+                          p_block->i_buffer, NULL );
             stats_Update( p_input->p->counters.p_read_packets, 1 , NULL);
-            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
         }
     }
     return p_block;
@@ -1809,6 +1883,16 @@ static int ASeek( stream_t *s, uint64_t i_pos )
     stream_sys_t *p_sys = s->p_sys;
     access_t *p_access = p_sys->p_access;
 
+    if( p_sys->prefetch.b_active )
+    {
+        APrefetchLockSeek( s );
+        int ret = p_access->pf_seek( p_access, i_pos );
+        if( ret == VLC_SUCCESS )
+            APrefetchFlush( s );
+        vlc_mutex_unlock( &p_sys->prefetch.access_lock );
+        return ret;
+    }
+
     /* Check which stream we need to access */
     if( p_sys->i_list )
     {
@@ -1853,6 +1937,303 @@ static int ASeek( stream_t *s, uint64_t i_pos )
     return p_access->pf_seek( p_access, i_pos );
 }
 
+static int AControl( stream_t *s, int i_query, ... )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    va_list args;
+    int ret;
+
+    va_start( args, i_query );
+    if( p_sys->prefetch.b_active )
+    {
+        vlc_mutex_lock( &p_sys->prefetch.access_lock );
+        ret = access_vaControl( p_sys->p_access, i_query, args );
+        vlc_mutex_unlock( &p_sys->prefetch.access_lock );
+    }
+    else
+        ret = access_vaControl( p_sys->p_access, i_query, args );
+    va_end( args );
+    return ret;
+}
+
+/****************************************************************************
+ * Method 2 prefetching
+ ****************************************************************************/
+/* Updates the window size. Must be called with the ring lock held. */
+static void APrefetchResize( stream_sys_t *p_sys )
+{
+    /* Keep enough data to feed the demuxer during four access reads */
+    uint64_t i_window = p_sys->prefetch.i_rate * 4
+                      * p_sys->prefetch.i_latency / CLOCK_FREQ;
+
+    if( i_window < p_sys->prefetch.i_floor )
+        i_window = p_sys->prefetch.i_floor;
+    if( i_window > p_sys->prefetch.i_size )
+        i_window = p_sys->prefetch.i_size;
+    p_sys->prefetch.i_window = i_window;
+}
+
+static void *APrefetchThread( void *data )
+{
+    stream_t *s = data;
+    stream_sys_t *p_sys = s->p_sys;
+    access_t *p_access = p_sys->p_access;
+    unsigned i_seeks = 0;
+
+    vlc_interrupt_set( p_sys->prefetch.interrupt );
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    while( !p_sys->prefetch.b_stop )
+    {
+        if( p_sys->prefetch.b_eof || p_sys->prefetch.i_waiters > 0
+         || p_sys->prefetch.i_length >= p_sys->prefetch.i_window )
+        {
+            vlc_cond_wait( &p_sys->prefetch.wait_space, &p_sys->prefetch.lock );
+            continue;
+        }
+        vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+        /* Only the access lock holder may flush the ring: compute where to
+         * write once it is held. */
+        vlc_mutex_lock( &p_sys->prefetch.access_lock );
+        vlc_mutex_lock( &p_sys->prefetch.lock );
+
+        size_t i_end = (p_sys->prefetch.i_begin + p_sys->prefetch.i_length)
+                     % p_sys->prefetch.i_size;
+        size_t i_chunk = __MIN( p_sys->prefetch.i_size - p_sys->prefetch.i_length,
+                                p_sys->prefetch.i_size - i_end );
+        i_chunk = __MIN( i_chunk, STREAM_PREFETCH_CHUNK );
+
+        if( p_sys->prefetch.b_stop || p_sys->prefetch.b_eof || i_chunk == 0
+         || p_sys->prefetch.i_waiters > 0 )
+        {
+            vlc_mutex_unlock( &p_sys->prefetch.access_lock );
+            continue;
+        }
+        if( i_seeks != p_sys->prefetch.i_seeks )
+        {   /* The seeks done since the last read have raised the interrupt,
+             * and must not interrupt this read */
+            i_seeks = p_sys->prefetch.i_seeks;
+            vlc_interrupt_forget();
+        }
+        vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+        mtime_t i_start = mdate();
+        int i_read = p_access->pf_read( p_access,
+                                        &p_sys->prefetch.p_buffer[i_end],
+                                        i_chunk );
+        mtime_t i_duration = mdate() - i_start;
+
+        vlc_mutex_lock( &p_sys->prefetch.lock );
+        vlc_mutex_unlock( &p_sys->prefetch.access_lock );
+
+        if( i_read > 0 )
+        {
+            p_sys->prefetch.i_length += i_read;
+            p_sys->prefetch.i_latency = ( 7 * p_sys->prefetch.i_latency
+                                          + i_duration ) / 8;
+            APrefetchResize( p_sys );
+        }
+        else if( i_read == 0 || !vlc_object_alive( p_access ) || vlc_killed() )
+            p_sys->prefetch.b_eof = true;
+        else
+            continue; /* error or interrupted by a seek: retry */
+        vlc_cond_signal( &p_sys->prefetch.wait_data );
+    }
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+    vlc_interrupt_set( NULL );
+    return NULL;
+}
+
+static int APrefetchStart( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    int64_t i_size = var_InheritInteger( s, "stream-prefetch" );
+
+    if( i_size <= 0 )
+        return VLC_SUCCESS;
+
+    i_size *= 1024;
+    if( i_size < STREAM_PREFETCH_MIN )
+        i_size = STREAM_PREFETCH_MIN;
+
+    p_sys->prefetch.p_buffer = malloc( i_size );
+    if( unlikely(p_sys->prefetch.p_buffer == NULL) )
+        return VLC_ENOMEM;
+
+    p_sys->prefetch.interrupt = vlc_interrupt_create();
+    if( unlikely(p_sys->prefetch.interrupt == NULL) )
+    {
+        free( p_sys->prefetch.p_buffer );
+        return VLC_ENOMEM;
+    }
+
+    vlc_mutex_init( &p_sys->prefetch.access_lock );
+    vlc_mutex_init( &p_sys->prefetch.lock );
+    vlc_cond_init( &p_sys->prefetch.wait_data );
+    vlc_cond_init( &p_sys->prefetch.wait_space );
+    p_sys->prefetch.i_size = i_size;
+    p_sys->prefetch.i_begin = 0;
+    p_sys->prefetch.i_length = 0;
+    p_sys->prefetch.i_pos = p_sys->i_pos;
+    p_sys->prefetch.i_floor = STREAM_PREFETCH_MIN;
+    p_sys->prefetch.b_eof = false;
+    p_sys->prefetch.b_stop = false;
+    p_sys->prefetch.i_seeks = 0;
+    p_sys->prefetch.i_waiters = 0;
+    p_sys->prefetch.i_rate_date = mdate();
+    p_sys->prefetch.i_rate_bytes = 0;
+    p_sys->prefetch.i_rate = 0;
+    p_sys->prefetch.i_latency = 0;
+    APrefetchResize( p_sys );
+
+    if( vlc_clone( &p_sys->prefetch.thread, APrefetchThread, s,
+                   VLC_THREAD_PRIORITY_INPUT ) )
+    {
+        vlc_cond_destroy( &p_sys->prefetch.wait_space );
+        vlc_cond_destroy( &p_sys->prefetch.wait_data );
+        vlc_mutex_destroy( &p_sys->prefetch.lock );
+        vlc_mutex_destroy( &p_sys->prefetch.access_lock );
+        vlc_interrupt_destroy( p_sys->prefetch.interrupt );
+        free( p_sys->prefetch.p_buffer );
+        return VLC_EGENERIC;
+    }
+    p_sys->prefetch.b_active = true;
+    msg_Dbg( s, "prefetching up to %zu bytes", p_sys->prefetch.i_size );
+    return VLC_SUCCESS;
+}
+
+static void APrefetchStop( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( !p_sys->prefetch.b_active )
+        return;
+
+    /* Abort any pending access read, the access is going away anyway */
+    ObjectKillChildrens( VLC_OBJECT(p_sys->p_access) );
+    vlc_interrupt_kill( p_sys->prefetch.interrupt );
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    p_sys->prefetch.b_stop = true;
+    vlc_cond_signal( &p_sys->prefetch.wait_space );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+    vlc_join( p_sys->prefetch.thread, NULL );
+
+    vlc_cond_destroy( &p_sys->prefetch.wait_space );
+    vlc_cond_destroy( &p_sys->prefetch.wait_data );
+    vlc_mutex_destroy( &p_sys->prefetch.lock );
+    vlc_mutex_destroy( &p_sys->prefetch.access_lock );
+    vlc_interrupt_destroy( p_sys->prefetch.interrupt );
+    free( p_sys->prefetch.p_buffer );
+    p_sys->prefetch.b_active = false;
+}
+
+/* Takes the access lock to seek. The pending access read of the thread is
+ * interrupted, and the thread does not start another one meanwhile. */
+static void APrefetchLockSeek( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    p_sys->prefetch.i_waiters++;
+    p_sys->prefetch.i_seeks++;
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+    vlc_interrupt_raise( p_sys->prefetch.interrupt );
+    vlc_mutex_lock( &p_sys->prefetch.access_lock );
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    p_sys->prefetch.i_waiters--;
+    vlc_cond_signal( &p_sys->prefetch.wait_space );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+}
+
+/* Wakes the thread up when the input thread waiting for it is stopped */
+static void APrefetchInterrupt( void *data )
+{
+    vlc_interrupt_kill( data );
+}
+
+/* Drops the ring after the access position changed.
+ * Must be called with the access lock held. */
+static void APrefetchFlush( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    p_sys->prefetch.i_begin = 0;
+    p_sys->prefetch.i_length = 0;
+    p_sys->prefetch.i_pos = p_sys->p_access->info.i_pos;
+    p_sys->prefetch.b_eof = false;
+    vlc_cond_signal( &p_sys->prefetch.wait_space );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+}
+
+static int APrefetchRead( stream_t *s, void *p_read, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    input_thread_t *p_input = s->p_input;
+    mtime_t i_stall = 0;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    const bool b_hit = p_sys->prefetch.i_length > 0;
+    if( !b_hit && !p_sys->prefetch.b_eof )
+    {
+        const mtime_t i_start = mdate();
+
+        /* The window was too small for this stream */
+        p_sys->prefetch.i_floor = __MIN( 2 * p_sys->prefetch.i_floor,
+                                         p_sys->prefetch.i_size );
+        APrefetchResize( p_sys );
+
+        vlc_interrupt_register( APrefetchInterrupt,
+                                p_sys->prefetch.interrupt );
+        while( p_sys->prefetch.i_length == 0 && !p_sys->prefetch.b_eof )
+            vlc_cond_wait( &p_sys->prefetch.wait_data, &p_sys->prefetch.lock );
+        vlc_interrupt_unregister();
+        i_stall = mdate() - i_start;
+    }
+
+    size_t i_copy = __MIN( (size_t)i_read, p_sys->prefetch.i_length );
+    i_copy = __MIN( i_copy, p_sys->prefetch.i_size - p_sys->prefetch.i_begin );
+
+    memcpy( p_read, &p_sys->prefetch.p_buffer[p_sys->prefetch.i_begin],
+            i_copy );
+    p_sys->prefetch.i_begin = (p_sys->prefetch.i_begin + i_copy)
+                            % p_sys->prefetch.i_size;
+    p_sys->prefetch.i_length -= i_copy;
+    p_sys->prefetch.i_pos += i_copy;
+
+    /* Measure the consumption rate over periods of 100 ms at least */
+    const mtime_t i_now = mdate();
+    p_sys->prefetch.i_rate_bytes += i_copy;
+    if( i_now - p_sys->prefetch.i_rate_date >= CLOCK_FREQ / 10 )
+    {
+        uint64_t i_rate = p_sys->prefetch.i_rate_bytes * CLOCK_FREQ
+                        / ( i_now - p_sys->prefetch.i_rate_date );
+
+        p_sys->prefetch.i_rate = ( 7 * p_sys->prefetch.i_rate + i_rate ) / 8;
+        p_sys->prefetch.i_rate_date = i_now;
+        p_sys->prefetch.i_rate_bytes = 0;
+        APrefetchResize( p_sys );
+    }
+    vlc_cond_signal( &p_sys->prefetch.wait_space );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+    if( p_input )
+    {
+        stats_Update( p_input->p->counters.p_read_bytes, i_copy, NULL );
+        stats_Update( p_input->p->counters.p_read_packets, 1, NULL );
+        stats_Update( b_hit ? p_input->p->counters.p_prefetch_hits
+                            : p_input->p->counters.p_prefetch_misses,
+                      1, NULL );
+        stats_Update( p_input->p->counters.p_prefetch_stall, i_stall, NULL );
+    }
+    return i_copy;
+}
+
 static int AStreamReadDir( stream_t *s, input_item_node_t *p_node )
 {
     access_t *p_access = s->p_sys->p_access;
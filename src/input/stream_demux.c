@@ -33,12 +33,18 @@
 
 /****************************************************************************
  * stream_Demux*: create a demuxer for an outpout stream (allow demuxer chain)
+ ****************************************************************************
+ * The demuxer either runs on its own thread, reading the data sent from a
+ * FIFO, or synchronously: then it is run by the thread sending the data, as
+ * long as enough data is queued for it not to hit the end of the queue.
  ****************************************************************************/
 struct stream_sys_t
 {
     /* Data buffer */
     block_fifo_t *p_fifo;
-    block_t      *p_block;
+    block_t      *p_block; /* queued data */
+    block_t     **pp_last;
+    size_t        i_queued;
 
     uint64_t    i_pos;
 
@@ -46,6 +52,12 @@ struct stream_sys_t
     char        *psz_name;
     es_out_t    *out;
 
+    bool         b_sync;
+    size_t       i_reserve; /* data left queued by the synchronous demuxer */
+    demux_t     *p_demux;   /* synchronous demuxer */
+    bool         b_failed;
+    mtime_t      next_update;
+
     atomic_bool  active;
     vlc_thread_t thread;
     vlc_mutex_t  lock;
@@ -64,7 +76,8 @@ static void DStreamDelete ( stream_t * );
 static void* DStreamThread ( void * );
 
 
-stream_t *stream_DemuxNew( demux_t *p_demux, const char *psz_demux, es_out_t *out )
+static stream_t *DStreamNew( demux_t *p_demux, const char *psz_demux,
+                             es_out_t *out, bool b_sync, size_t i_reserve )
 {
     vlc_object_t *p_obj = VLC_OBJECT(p_demux);
     /* We create a stream reader, and launch a thread */
@@ -91,40 +104,169 @@ stream_t *stream_DemuxNew( demux_t *p_demux, const char *psz_demux, es_out_t *ou
     p_sys->i_pos = 0;
     p_sys->out = out;
     p_sys->p_block = NULL;
+    p_sys->pp_last = &p_sys->p_block;
+    p_sys->i_queued = 0;
     p_sys->psz_name = strdup( psz_demux );
+    p_sys->b_sync = b_sync;
+    p_sys->i_reserve = i_reserve;
+    p_sys->p_demux = NULL;
+    p_sys->b_failed = false;
+    p_sys->next_update = 0;
     p_sys->stats.position = 0.;
     p_sys->stats.length = 0;
     p_sys->stats.time = 0;
+    p_sys->p_fifo = NULL;
+
+    atomic_init( &p_sys->active, true );
+    vlc_mutex_init( &p_sys->lock );
+
+    if( b_sync )
+        return s;
 
     /* decoder fifo */
     if( ( p_sys->p_fifo = block_FifoNew() ) == NULL )
+        goto error;
+
+    if( vlc_clone( &p_sys->thread, DStreamThread, s, VLC_THREAD_PRIORITY_INPUT ) )
     {
-        stream_CommonDelete( s );
-        free( p_sys->psz_name );
-        free( p_sys );
+        block_FifoRelease( p_sys->p_fifo );
+        goto error;
+    }
+
+    return s;
+
+error:
+    vlc_mutex_destroy( &p_sys->lock );
+    stream_CommonDelete( s );
+    free( p_sys->psz_name );
+    free( p_sys );
+    return NULL;
+}
+
+stream_t *stream_DemuxNew( demux_t *p_demux, const char *psz_demux, es_out_t *out )
+{
+    return DStreamNew( p_demux, psz_demux, out, false, 0 );
+}
+
+stream_t *stream_DemuxNewSync( demux_t *p_demux, const char *psz_demux,
+                               es_out_t *out, size_t i_reserve )
+{
+    return DStreamNew( p_demux, psz_demux, out, true, i_reserve );
+}
+
+static void DStreamQueue( stream_sys_t *p_sys, block_t *p_block )
+{
+    for( block_t *b = p_block; b != NULL; b = b->p_next )
+        p_sys->i_queued += b->i_buffer;
+    block_ChainLastAppend( &p_sys->pp_last, p_block );
+}
+
+static demux_t *DStreamDemuxNew( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    demux_t *p_demux = demux_New( s, s->p_input, "", p_sys->psz_name, "", s,
+                                  p_sys->out, false );
+    if( p_demux == NULL )
         return NULL;
+
+    /* stream_Demux cannot apply DVB filters.
+     * Get all programs and let the E/S output sort them out. */
+    demux_Control( p_demux, DEMUX_SET_GROUP, -1, NULL );
+    return p_demux;
+}
+
+static void DStreamDemuxDelete( demux_t *p_demux )
+{
+    /* Explicit kludge: the stream is destroyed by the owner of the
+     * streamDemux, not here. */
+    p_demux->s = NULL;
+    demux_Delete( p_demux );
+}
+
+static int DStreamDemux( stream_t *s, demux_t *p_demux )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( p_demux->info.i_update || mdate() >= p_sys->next_update )
+    {
+        double newpos;
+        int64_t newlen, newtime;
+
+        if( demux_Control( p_demux, DEMUX_GET_POSITION, &newpos ) )
+            newpos = 0.;
+        if( demux_Control( p_demux, DEMUX_GET_LENGTH, &newlen ) )
+            newlen = 0;
+        if( demux_Control( p_demux, DEMUX_GET_TIME, &newtime ) )
+            newtime = 0;
+
+        vlc_mutex_lock( &p_sys->lock );
+        p_sys->stats.position = newpos;
+        p_sys->stats.length = newlen;
+        p_sys->stats.time = newtime;
+        vlc_mutex_unlock( &p_sys->lock );
+
+        p_demux->info.i_update = 0;
+        p_sys->next_update = mdate() + (CLOCK_FREQ / 4);
     }
 
-    atomic_init( &p_sys->active, true );
-    vlc_mutex_init( &p_sys->lock );
+    return demux_Demux( p_demux );
+}
 
-    if( vlc_clone( &p_sys->thread, DStreamThread, s, VLC_THREAD_PRIORITY_INPUT ) )
+/* Runs the synchronous demuxer until no more than i_reserve bytes are
+ * queued, or until it stops making progress */
+static void DStreamRun( stream_t *s, size_t i_reserve )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( p_sys->b_failed || p_sys->i_queued <= i_reserve )
+        return;
+
+    if( p_sys->p_demux == NULL )
     {
-        vlc_mutex_destroy( &p_sys->lock );
-        block_FifoRelease( p_sys->p_fifo );
-        stream_CommonDelete( s );
-        free( p_sys->psz_name );
-        free( p_sys );
-        return NULL;
+        /* Probe with as much data as will be left queued */
+        p_sys->p_demux = DStreamDemuxNew( s );
+        if( p_sys->p_demux == NULL )
+        {
+            p_sys->b_failed = true;
+            return;
+        }
     }
 
-    return s;
+    while( p_sys->i_queued > i_reserve )
+    {
+        size_t i_queued = p_sys->i_queued;
+
+        if( DStreamDemux( s, p_sys->p_demux ) <= 0 && p_sys->i_queued == i_queued )
+            break;
+    }
 }
 
 void stream_DemuxSend( stream_t *s, block_t *p_block )
 {
     stream_sys_t *p_sys = s->p_sys;
-    block_FifoPut( p_sys->p_fifo, p_block );
+
+    if( !p_sys->b_sync )
+    {
+        block_FifoPut( p_sys->p_fifo, p_block );
+        return;
+    }
+
+    if( p_sys->b_failed )
+    {
+        block_ChainRelease( p_block );
+        return;
+    }
+    DStreamQueue( p_sys, p_block );
+    DStreamRun( s, p_sys->i_reserve );
+}
+
+void stream_DemuxDrain( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( p_sys->b_sync )
+        DStreamRun( s, 0 );
 }
 
 int stream_DemuxControlVa( stream_t *s, int query, va_list args )
@@ -157,23 +299,58 @@ int stream_DemuxControlVa( stream_t *s, int query, va_list args )
 static void DStreamDelete( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
-    block_t *p_empty;
 
-    atomic_store( &p_sys->active, false );
-    p_empty = block_Alloc( 0 );
-    block_FifoPut( p_sys->p_fifo, p_empty );
-    vlc_join( p_sys->thread, NULL );
+    if( p_sys->b_sync )
+    {
+        if( p_sys->p_demux != NULL )
+            DStreamDemuxDelete( p_sys->p_demux );
+    }
+    else
+    {
+        atomic_store( &p_sys->active, false );
+        block_FifoPut( p_sys->p_fifo, block_Alloc( 0 ) );
+        vlc_join( p_sys->thread, NULL );
+        block_FifoRelease( p_sys->p_fifo );
+    }
     vlc_mutex_destroy( &p_sys->lock );
 
-    if( p_sys->p_block )
-        block_Release( p_sys->p_block );
-
-    block_FifoRelease( p_sys->p_fifo );
+    block_ChainRelease( p_sys->p_block );
     free( p_sys->psz_name );
     free( p_sys );
     stream_CommonDelete( s );
 }
 
+/* Queues the next block sent to a threaded demuxer, waiting for it.
+ * The data sent to a synchronous demuxer is all queued already. */
+static bool DStreamQueueMore( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( p_sys->b_sync || !atomic_load( &p_sys->active ) || s->b_error )
+        return false;
+
+    block_t *p_block = block_FifoGet( p_sys->p_fifo );
+    if( p_block == NULL )
+    {
+        s->b_error = true;
+        return false;
+    }
+    DStreamQueue( p_sys, p_block );
+    return true;
+}
+
+/* Drops the first queued block */
+static void DStreamDequeue( stream_sys_t *p_sys )
+{
+    block_t *p_block = p_sys->p_block;
+
+    p_sys->p_block = p_block->p_next;
+    if( p_sys->p_block == NULL )
+        p_sys->pp_last = &p_sys->p_block;
+    p_sys->i_queued -= p_block->i_buffer;
+    p_block->p_next = NULL;
+    block_Release( p_block );
+}
 
 static int DStreamRead( stream_t *s, void *p_read, unsigned int i_read )
 {
@@ -183,33 +360,30 @@ static int DStreamRead( stream_t *s, void *p_read, unsigned int i_read )
 
     //msg_Dbg( s, "DStreamRead: wanted %d bytes", i_read );
 
-    while( atomic_load( &p_sys->active ) && !s->b_error && i_read )
+    while( i_read > 0 )
     {
         block_t *p_block = p_sys->p_block;
-        int i_copy;
 
-        if( !p_block )
+        if( p_block == NULL )
         {
-            p_block = block_FifoGet( p_sys->p_fifo );
-            if( !p_block ) s->b_error = 1;
-            p_sys->p_block = p_block;
+            if( !DStreamQueueMore( s ) )
+                break;
+            continue;
         }
 
-        if( p_block && i_read )
+        size_t i_copy = __MIN( i_read, p_block->i_buffer );
+        if( p_out && i_copy ) memcpy( p_out, p_block->p_buffer, i_copy );
+        i_read -= i_copy;
+        if ( p_out ) p_out += i_copy;
+        i_out += i_copy;
+
+        if( i_copy == p_block->i_buffer )
+            DStreamDequeue( p_sys );
+        else
         {
-            i_copy = __MIN( i_read, p_block->i_buffer );
-            if( p_out && i_copy ) memcpy( p_out, p_block->p_buffer, i_copy );
-            i_read -= i_copy;
-            if ( p_out ) p_out += i_copy;
-            i_out += i_copy;
             p_block->i_buffer -= i_copy;
             p_block->p_buffer += i_copy;
-
-            if( !p_block->i_buffer )
-            {
-                block_Release( p_block );
-                p_sys->p_block = NULL;
-            }
+            p_sys->i_queued -= i_copy;
         }
     }
 
@@ -220,39 +394,56 @@ static int DStreamRead( stream_t *s, void *p_read, unsigned int i_read )
 static int DStreamPeek( stream_t *s, const uint8_t **pp_peek, unsigned int i_peek )
 {
     stream_sys_t *p_sys = s->p_sys;
-    block_t **pp_block = &p_sys->p_block;
-    int i_out = 0;
-    *pp_peek = 0;
 
     //msg_Dbg( s, "DStreamPeek: wanted %d bytes", i_peek );
 
-    while( atomic_load( &p_sys->active ) && !s->b_error && i_peek )
+    while( p_sys->i_queued < i_peek && DStreamQueueMore( s ) );
+
+    block_t *p_block = p_sys->p_block;
+    if( p_block == NULL )
     {
-        int i_copy;
+        *pp_peek = NULL;
+        return 0;
+    }
 
-        if( !*pp_block )
-        {
-            *pp_block = block_FifoGet( p_sys->p_fifo );
-            if( !*pp_block ) s->b_error = 1;
-        }
+    if( p_block->i_buffer < i_peek && p_block->p_next != NULL )
+    {
+        /* Gather only the peeked data, not the whole queue */
+        size_t i_size = __MIN( (size_t)i_peek, p_sys->i_queued );
+        block_t *p_gather = block_Alloc( i_size );
 
-        if( *pp_block && i_peek )
+        if( likely(p_gather != NULL) )
         {
-            i_copy = __MIN( i_peek, (*pp_block)->i_buffer );
-            i_peek -= i_copy;
-            i_out += i_copy;
+            size_t i_done = 0;
 
-            if( i_peek ) pp_block = &(*pp_block)->p_next;
-        }
-    }
+            while( i_done < i_size )
+            {
+                block_t *b = p_sys->p_block;
+                size_t i_copy = __MIN( i_size - i_done, b->i_buffer );
+
+                memcpy( &p_gather->p_buffer[i_done], b->p_buffer, i_copy );
+                i_done += i_copy;
+                if( i_copy == b->i_buffer )
+                    DStreamDequeue( p_sys );
+                else
+                {
+                    b->p_buffer += i_copy;
+                    b->i_buffer -= i_copy;
+                    p_sys->i_queued -= i_copy;
+                }
+            }
 
-    if( p_sys->p_block )
-    {
-        p_sys->p_block = block_ChainGather( p_sys->p_block );
-        *pp_peek = p_sys->p_block->p_buffer;
+            p_gather->p_next = p_sys->p_block;
+            if( p_gather->p_next == NULL )
+                p_sys->pp_last = &p_gather->p_next;
+            p_sys->p_block = p_gather;
+            p_sys->i_queued += i_size;
+            p_block = p_gather;
+        }
     }
 
-    return i_out;
+    *pp_peek = p_block->p_buffer;
+    return __MIN( (size_t)i_peek, p_block->i_buffer );
 }
 
 static int DStreamControl( stream_t *s, int i_query, va_list args )
@@ -325,52 +516,20 @@ static void* DStreamThread( void *obj )
 {
     stream_t *s = (stream_t *)obj;
     stream_sys_t *p_sys = s->p_sys;
-    demux_t *p_demux;
 
     /* Create the demuxer */
-    p_demux = demux_New( s, s->p_input, "", p_sys->psz_name, "", s, p_sys->out,
-                         false );
+    demux_t *p_demux = DStreamDemuxNew( s );
     if( p_demux == NULL )
         return NULL;
 
-    /* stream_Demux cannot apply DVB filters.
-     * Get all programs and let the E/S output sort them out. */
-    demux_Control( p_demux, DEMUX_SET_GROUP, -1, NULL );
-
     /* Main loop */
-    mtime_t next_update = 0;
     while( atomic_load( &p_sys->active ) )
     {
-        if( p_demux->info.i_update || mdate() >= next_update )
-        {
-            double newpos;
-            int64_t newlen, newtime;
-
-            if( demux_Control( p_demux, DEMUX_GET_POSITION, &newpos ) )
-                newpos = 0.;
-            if( demux_Control( p_demux, DEMUX_GET_LENGTH, &newlen ) )
-                newlen = 0;
-            if( demux_Control( p_demux, DEMUX_GET_TIME, &newtime ) )
-                newtime = 0;
-
-            vlc_mutex_lock( &p_sys->lock );
-            p_sys->stats.position = newpos;
-            p_sys->stats.length = newlen;
-            p_sys->stats.time = newtime;
-            vlc_mutex_unlock( &p_sys->lock );
-
-            p_demux->info.i_update = 0;
-            next_update = mdate() + (CLOCK_FREQ / 4);
-        }
-
-        if( demux_Demux( p_demux ) <= 0 )
+        if( DStreamDemux( s, p_demux ) <= 0 )
             break;
     }
 
-    /* Explicit kludge: the stream is destroyed by the owner of the
-     * streamDemux, not here. */
-    p_demux->s = NULL;
-    demux_Delete( p_demux );
+    DStreamDemuxDelete( p_demux );
 
     return NULL;
 }
@@ -181,6 +181,186 @@ int subtitles_Filter( const char *psz_dir_content )
 }
 
 
+/*
+ * Listings of the subtitle files of the directories looked in, shared by all
+ * the inputs (including the preparser), so that the files of a directory
+ * are not all read again for each of its items. A listing is valid as long
+ * as the modification time of its directory is unchanged.
+ */
+#define SUB_DIR_CACHE_MAX 16
+
+typedef struct
+{
+    char *psz_name;
+    char *psz_trim; /* normalized name, without extension */
+    char *psz_ext;
+} sub_entry_t;
+
+typedef struct sub_dir sub_dir_t;
+struct sub_dir
+{
+    sub_dir_t   *p_next; /* most recently used first */
+    unsigned     i_refs;
+    char        *psz_dir;
+    dev_t        i_dev;
+    ino_t        i_ino;
+    time_t       i_mtime;
+    size_t       i_entries;
+    sub_entry_t *p_entries;
+};
+
+static vlc_mutex_t sub_dir_lock = VLC_STATIC_MUTEX;
+static sub_dir_t *sub_dir_cache = NULL;
+
+static void subdir_Delete( sub_dir_t *d )
+{
+    for( size_t i = 0; i < d->i_entries; i++ )
+    {
+        free( d->p_entries[i].psz_name );
+        free( d->p_entries[i].psz_trim );
+        free( d->p_entries[i].psz_ext );
+    }
+    free( d->p_entries );
+    free( d->psz_dir );
+    free( d );
+}
+
+static void subdir_Release( sub_dir_t *d )
+{
+    vlc_mutex_lock( &sub_dir_lock );
+    bool b_last = --d->i_refs == 0;
+    vlc_mutex_unlock( &sub_dir_lock );
+
+    if( b_last )
+        subdir_Delete( d );
+}
+
+/* Reads the subtitle files of a directory */
+static sub_dir_t *subdir_Load( const char *psz_dir, const struct stat *st )
+{
+    DIR *dir = vlc_opendir( psz_dir );
+    if( dir == NULL )
+        return NULL;
+
+    sub_dir_t *d = calloc( 1, sizeof( *d ) );
+    if( unlikely(d == NULL) )
+        goto out;
+    d->i_refs = 1;
+    d->psz_dir = strdup( psz_dir );
+    d->i_dev = st->st_dev;
+    d->i_ino = st->st_ino;
+    d->i_mtime = st->st_mtime;
+
+    const char *psz_name;
+    size_t i_alloc = 0;
+    while( (psz_name = vlc_readdir( dir )) != NULL )
+    {
+        if( psz_name[0] == '.' || !subtitles_Filter( psz_name ) )
+            continue;
+
+        if( d->i_entries >= i_alloc )
+        {
+            i_alloc = i_alloc ? 2 * i_alloc : 16;
+            sub_entry_t *p = realloc( d->p_entries, i_alloc * sizeof( *p ) );
+            if( unlikely(p == NULL) )
+                break;
+            d->p_entries = p;
+        }
+
+        char tmp_fname_noext[strlen( psz_name ) + 1];
+        char tmp_fname_trim[strlen( psz_name ) + 1];
+        char tmp_fname_ext[strlen( psz_name ) + 1];
+
+        /* retrieve various parts of the filename */
+        strcpy_strip_ext( tmp_fname_noext, psz_name );
+        strcpy_get_ext( tmp_fname_ext, psz_name );
+        strcpy_trim( tmp_fname_trim, tmp_fname_noext );
+
+        sub_entry_t *e = &d->p_entries[d->i_entries];
+        e->psz_name = strdup( psz_name );
+        e->psz_trim = strdup( tmp_fname_trim );
+        e->psz_ext = strdup( tmp_fname_ext );
+        if( unlikely(!e->psz_name || !e->psz_trim || !e->psz_ext) )
+        {
+            free( e->psz_name );
+            free( e->psz_trim );
+            free( e->psz_ext );
+            continue;
+        }
+        d->i_entries++;
+    }
+
+    if( unlikely(d->psz_dir == NULL) )
+    {
+        subdir_Delete( d );
+        d = NULL;
+    }
+out:
+    closedir( dir );
+    return d;
+}
+
+/* Gets the listing of a directory, from the cache if it is up to date */
+static sub_dir_t *subdir_Hold( vlc_object_t *obj, const char *psz_dir )
+{
+    struct stat st;
+
+    if( vlc_stat( psz_dir, &st ) || !S_ISDIR( st.st_mode ) )
+        return NULL;
+
+    vlc_mutex_lock( &sub_dir_lock );
+    for( sub_dir_t **pp = &sub_dir_cache; *pp != NULL; pp = &(*pp)->p_next )
+    {
+        sub_dir_t *d = *pp;
+
+        if( strcmp( d->psz_dir, psz_dir ) )
+            continue;
+
+        *pp = d->p_next;
+        if( d->i_dev == st.st_dev && d->i_ino == st.st_ino
+         && d->i_mtime == st.st_mtime )
+        {   /* still valid: move it first */
+            d->p_next = sub_dir_cache;
+            sub_dir_cache = d;
+            d->i_refs++;
+            vlc_mutex_unlock( &sub_dir_lock );
+            return d;
+        }
+        /* outdated */
+        if( --d->i_refs == 0 )
+            subdir_Delete( d );
+        break;
+    }
+    vlc_mutex_unlock( &sub_dir_lock );
+
+    msg_Dbg( obj, "looking for a subtitle file in %s", psz_dir );
+
+    sub_dir_t *d = subdir_Load( psz_dir, &st );
+    if( d == NULL )
+        return NULL;
+
+    /* A file could be added in the same second as the listing, unnoticed
+     * by the modification time: do not cache recently modified directories */
+    if( time( NULL ) <= d->i_mtime + 1 )
+        return d;
+
+    vlc_mutex_lock( &sub_dir_lock );
+    d->i_refs++;
+    d->p_next = sub_dir_cache;
+    sub_dir_cache = d;
+
+    /* Forget the least recently used directory */
+    sub_dir_t **pp = &sub_dir_cache;
+    for( unsigned i = 0; *pp != NULL && i < SUB_DIR_CACHE_MAX; i++ )
+        pp = &(*pp)->p_next;
+    sub_dir_t *p_old = *pp;
+    *pp = NULL;
+    if( p_old != NULL && --p_old->i_refs == 0 )
+        subdir_Delete( p_old );
+    vlc_mutex_unlock( &sub_dir_lock );
+    return d;
+}
+
 /**
  * Convert a list of paths separated by ',' to a char**
  */
@@ -306,29 +486,18 @@ char **subtitles_Detect( input_thread_t *p_this, char *psz_path,
             continue;
 
         /* parse psz_src dir */
-        DIR *dir = vlc_opendir( psz_dir );
+        sub_dir_t *dir = subdir_Hold( VLC_OBJECT(p_this), psz_dir );
         if( dir == NULL )
             continue;
 
-        msg_Dbg( p_this, "looking for a subtitle file in %s", psz_dir );
-
-        const char *psz_name;
-        while( (psz_name = vlc_readdir( dir )) && i_sub_count < MAX_SUBTITLE_FILES )
+        for( size_t i = 0; i < dir->i_entries && i_sub_count < MAX_SUBTITLE_FILES; i++ )
         {
-            if( psz_name[0] == '.' || !subtitles_Filter( psz_name ) )
-                continue;
-
-            char tmp_fname_noext[strlen( psz_name ) + 1];
-            char tmp_fname_trim[strlen( psz_name ) + 1];
-            char tmp_fname_ext[strlen( psz_name ) + 1];
+            const char *psz_name = dir->p_entries[i].psz_name;
+            const char *tmp_fname_trim = dir->p_entries[i].psz_trim;
+            const char *tmp_fname_ext = dir->p_entries[i].psz_ext;
             const char *tmp;
             int i_prio = SUB_PRIORITY_NONE;
 
-            /* retrieve various parts of the filename */
-            strcpy_strip_ext( tmp_fname_noext, psz_name );
-            strcpy_get_ext( tmp_fname_ext, psz_name );
-            strcpy_trim( tmp_fname_trim, tmp_fname_noext );
-
             if( !strcmp( tmp_fname_trim, f_fname_trim ) )
             {
                 /* matches the movie name exactly */
@@ -379,7 +548,7 @@ char **subtitles_Detect( input_thread_t *p_this, char *psz_path,
                 free( path );
             }
         }
-        closedir( dir );
+        subdir_Release( dir );
     }
     if( subdirs )
     {
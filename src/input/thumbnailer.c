@@ -0,0 +1,521 @@
+/*****************************************************************************
+ * thumbnailer.c: single picture extraction
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * The thumbnailer drives a demuxer by hand, through a minimal es_out that
+ * only feeds the first video track to a decoder of its own. There is no
+ * input thread, no clock, no buffering and no output: the first picture
+ * decoded after the (key frame) seek is scaled and returned.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_codec.h>
+#include <vlc_es_out.h>
+#include <vlc_image.h>
+#include <vlc_modules.h>
+#include <vlc_thumbnailer.h>
+
+#include "access.h"
+#include "demux.h"
+#include "stream.h"
+#include "input_internal.h"
+
+struct vlc_thumbnailer_t
+{
+    VLC_COMMON_MEMBERS
+
+    /* Kept across requests, for as long as the video format is the same */
+    decoder_t       *p_packetizer;
+    decoder_t       *p_dec;
+    es_format_t      fmt; /**< Format the decoder was created for */
+
+    image_handler_t *p_image;
+};
+
+struct es_out_id_t
+{
+    bool b_video; /**< Whether this is the decoded track */
+};
+
+struct es_out_sys_t
+{
+    vlc_thumbnailer_t *p_thumb;
+    es_out_id_t       *p_video; /**< Decoded track, or NULL */
+    picture_t         *p_pic;   /**< First decoded picture, or NULL */
+};
+
+/*****************************************************************************
+ * Decoder
+ *****************************************************************************/
+static int VideoUpdateFormat( decoder_t *p_dec )
+{
+    p_dec->fmt_out.video.i_chroma = p_dec->fmt_out.i_codec;
+    return 0;
+}
+
+static picture_t *VideoNewBuffer( decoder_t *p_dec )
+{
+    return picture_NewFromFormat( &p_dec->fmt_out.video );
+}
+
+static void DeleteDecoder( decoder_t *p_dec )
+{
+    if( p_dec->p_module )
+        module_unneed( p_dec, p_dec->p_module );
+
+    es_format_Clean( &p_dec->fmt_in );
+    es_format_Clean( &p_dec->fmt_out );
+
+    if( p_dec->p_description )
+        vlc_meta_Delete( p_dec->p_description );
+
+    vlc_object_release( p_dec );
+}
+
+static decoder_t *CreateDecoder( vlc_thumbnailer_t *p_thumb,
+                                 const es_format_t *p_fmt, bool b_packetizer )
+{
+    decoder_t *p_dec = vlc_custom_create( p_thumb, sizeof( *p_dec ),
+                                          b_packetizer ? "packetizer"
+                                                       : "decoder" );
+    if( unlikely(p_dec == NULL) )
+        return NULL;
+
+    p_dec->p_module = NULL;
+    es_format_Copy( &p_dec->fmt_in, p_fmt );
+    es_format_Init( &p_dec->fmt_out, VIDEO_ES, 0 );
+    p_dec->b_pace_control = true;
+
+    p_dec->pf_vout_format_update = VideoUpdateFormat;
+    p_dec->pf_vout_buffer_new = VideoNewBuffer;
+
+    if( b_packetizer )
+        p_dec->p_module = module_need( p_dec, "packetizer", "$packetizer",
+                                       false );
+    else
+        p_dec->p_module = module_need( p_dec, "decoder", "$codec", false );
+    if( p_dec->p_module == NULL )
+    {
+        DeleteDecoder( p_dec );
+        return NULL;
+    }
+    return p_dec;
+}
+
+static void ThumbnailerCloseDecoder( vlc_thumbnailer_t *p_thumb )
+{
+    if( p_thumb->p_packetizer != NULL )
+        DeleteDecoder( p_thumb->p_packetizer );
+    if( p_thumb->p_dec != NULL )
+        DeleteDecoder( p_thumb->p_dec );
+    p_thumb->p_packetizer = NULL;
+    p_thumb->p_dec = NULL;
+    es_format_Clean( &p_thumb->fmt );
+}
+
+/* Whether a decoder created for one format can decode another one */
+static bool FormatMatches( const es_format_t *a, const es_format_t *b )
+{
+    return a->i_codec == b->i_codec
+        && a->i_original_fourcc == b->i_original_fourcc
+        && a->b_packetized == b->b_packetized
+        && a->video.i_width == b->video.i_width
+        && a->video.i_height == b->video.i_height
+        && a->i_extra == b->i_extra
+        && (a->i_extra == 0 || !memcmp( a->p_extra, b->p_extra, a->i_extra ));
+}
+
+static block_t *FlushBlockNew( void )
+{
+    block_t *p_null = block_Alloc( 128 );
+    if( p_null == NULL )
+        return NULL;
+
+    p_null->i_flags |= BLOCK_FLAG_DISCONTINUITY | BLOCK_FLAG_CORRUPTED;
+    memset( p_null->p_buffer, 0, p_null->i_buffer );
+    return p_null;
+}
+
+static void DecodeVideo( vlc_thumbnailer_t *p_thumb, picture_t **pp_pic,
+                         block_t *p_block )
+{
+    decoder_t *p_dec = p_thumb->p_dec;
+    picture_t *p_pic;
+
+    while( (p_pic = p_dec->pf_decode_video( p_dec, &p_block )) != NULL )
+    {
+        if( *pp_pic == NULL )
+            *pp_pic = p_pic;
+        else
+            picture_Release( p_pic );
+    }
+}
+
+static void ProcessVideo( vlc_thumbnailer_t *p_thumb, picture_t **pp_pic,
+                          block_t *p_block )
+{
+    decoder_t *p_packetizer = p_thumb->p_packetizer;
+    decoder_t *p_dec = p_thumb->p_dec;
+
+    if( p_packetizer == NULL )
+    {
+        DecodeVideo( p_thumb, pp_pic, p_block );
+        return;
+    }
+
+    block_t *p_packetized;
+    while( (p_packetized =
+                p_packetizer->pf_packetize( p_packetizer, &p_block )) != NULL )
+    {
+        if( p_packetizer->fmt_out.i_extra && !p_dec->fmt_in.i_extra )
+        {
+            es_format_Clean( &p_dec->fmt_in );
+            es_format_Copy( &p_dec->fmt_in, &p_packetizer->fmt_out );
+        }
+        if( p_packetizer->fmt_out.video.i_sar_num > 0
+         && p_packetizer->fmt_out.video.i_sar_den > 0 )
+        {
+            p_dec->fmt_in.video.i_sar_num =
+                p_packetizer->fmt_out.video.i_sar_num;
+            p_dec->fmt_in.video.i_sar_den =
+                p_packetizer->fmt_out.video.i_sar_den;
+        }
+
+        while( p_packetized != NULL )
+        {
+            block_t *p_next = p_packetized->p_next;
+
+            p_packetized->p_next = NULL;
+            if( *pp_pic == NULL )
+                DecodeVideo( p_thumb, pp_pic, p_packetized );
+            else
+                block_Release( p_packetized );
+            p_packetized = p_next;
+        }
+    }
+}
+
+/* Forgets the previous media, as after a seek */
+static void ThumbnailerFlush( vlc_thumbnailer_t *p_thumb )
+{
+    picture_t *p_pic = NULL;
+    block_t *p_null;
+
+    /* The packetizer does not pass the flush on to the decoder */
+    if( p_thumb->p_packetizer != NULL
+     && (p_null = FlushBlockNew()) != NULL )
+        ProcessVideo( p_thumb, &p_pic, p_null );
+    if( (p_null = FlushBlockNew()) != NULL )
+        DecodeVideo( p_thumb, &p_pic, p_null );
+    if( p_pic != NULL )
+        picture_Release( p_pic );
+}
+
+/**
+ * Gets a decoder for the given format: the one of the previous request if
+ * it is compatible (after a flush), or a new one.
+ */
+static int ThumbnailerOpenDecoder( vlc_thumbnailer_t *p_thumb,
+                                   const es_format_t *p_fmt )
+{
+    if( p_thumb->p_dec != NULL )
+    {
+        if( FormatMatches( &p_thumb->fmt, p_fmt ) )
+        {
+            ThumbnailerFlush( p_thumb );
+            msg_Dbg( p_thumb, "reusing the %4.4s decoder",
+                     (const char *)&p_fmt->i_codec );
+            return VLC_SUCCESS;
+        }
+        ThumbnailerCloseDecoder( p_thumb );
+    }
+
+    p_thumb->p_dec = CreateDecoder( p_thumb, p_fmt, false );
+    if( p_thumb->p_dec == NULL )
+    {
+        msg_Err( p_thumb, "no suitable decoder module for fourcc `%4.4s'",
+                 (const char *)&p_fmt->i_codec );
+        return VLC_EGENERIC;
+    }
+
+    if( p_thumb->p_dec->b_need_packetized && !p_fmt->b_packetized )
+    {
+        p_thumb->p_packetizer = CreateDecoder( p_thumb, p_fmt, true );
+        if( p_thumb->p_packetizer == NULL )
+            msg_Warn( p_thumb, "no packetizer for fourcc `%4.4s'",
+                      (const char *)&p_fmt->i_codec );
+    }
+    es_format_Copy( &p_thumb->fmt, p_fmt );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * ES output
+ *****************************************************************************/
+static es_out_id_t *EsOutAdd( es_out_t *out, const es_format_t *p_fmt )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+    es_out_id_t *id = malloc( sizeof( *id ) );
+
+    if( unlikely(id == NULL) )
+        return NULL;
+
+    id->b_video = false;
+    if( p_fmt->i_cat == VIDEO_ES && p_sys->p_video == NULL
+     && p_fmt->i_priority >= ES_PRIORITY_SELECTABLE_MIN
+     && ThumbnailerOpenDecoder( p_sys->p_thumb, p_fmt ) == VLC_SUCCESS )
+    {
+        id->b_video = true;
+        p_sys->p_video = id;
+    }
+    return id;
+}
+
+static int EsOutSend( es_out_t *out, es_out_id_t *id, block_t *p_block )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( !id->b_video || p_sys->p_pic != NULL )
+    {
+        block_Release( p_block );
+        return VLC_SUCCESS;
+    }
+
+    ProcessVideo( p_sys->p_thumb, &p_sys->p_pic, p_block );
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel( es_out_t *out, es_out_id_t *id )
+{
+    es_out_sys_t *p_sys = out->p_sys;
+
+    if( p_sys->p_video == id )
+        p_sys->p_video = NULL;
+    free( id );
+}
+
+static int EsOutControl( es_out_t *out, int i_query, va_list args )
+{
+    VLC_UNUSED(out);
+
+    switch( i_query )
+    {
+        case ES_OUT_GET_ES_STATE:
+        {
+            es_out_id_t *id = va_arg( args, es_out_id_t * );
+            bool *pb = va_arg( args, bool * );
+
+            *pb = id->b_video;
+            return VLC_SUCCESS;
+        }
+
+        case ES_OUT_GET_EMPTY:
+            *va_arg( args, bool * ) = true;
+            return VLC_SUCCESS;
+
+        case ES_OUT_SET_ES:
+        case ES_OUT_RESTART_ES:
+        case ES_OUT_SET_ES_DEFAULT:
+        case ES_OUT_SET_ES_STATE:
+        case ES_OUT_SET_GROUP:
+        case ES_OUT_SET_PCR:
+        case ES_OUT_SET_GROUP_PCR:
+        case ES_OUT_RESET_PCR:
+        case ES_OUT_SET_ES_FMT:
+        case ES_OUT_SET_NEXT_DISPLAY_TIME:
+        case ES_OUT_SET_GROUP_META:
+        case ES_OUT_SET_GROUP_EPG:
+        case ES_OUT_DEL_GROUP:
+        case ES_OUT_SET_ES_SCRAMBLED_STATE:
+        case ES_OUT_SET_META:
+            return VLC_SUCCESS;
+
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+/*****************************************************************************
+ * Thumbnailer
+ *****************************************************************************/
+#undef vlc_thumbnailer_Create
+vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t *p_parent )
+{
+    vlc_thumbnailer_t *p_thumb = vlc_custom_create( p_parent,
+                                                    sizeof( *p_thumb ),
+                                                    "thumbnailer" );
+    if( unlikely(p_thumb == NULL) )
+        return NULL;
+
+    p_thumb->p_image = image_HandlerCreate( p_thumb );
+    if( p_thumb->p_image == NULL )
+    {
+        vlc_object_release( p_thumb );
+        return NULL;
+    }
+    p_thumb->p_packetizer = NULL;
+    p_thumb->p_dec = NULL;
+    es_format_Init( &p_thumb->fmt, UNKNOWN_ES, 0 );
+    return p_thumb;
+}
+
+void vlc_thumbnailer_Release( vlc_thumbnailer_t *p_thumb )
+{
+    ThumbnailerCloseDecoder( p_thumb );
+    image_HandlerDelete( p_thumb->p_image );
+    vlc_object_release( p_thumb );
+}
+
+/* Scales the picture to the requested size, keeping the display aspect
+ * ratio for the missing dimension */
+static picture_t *ThumbnailerScale( vlc_thumbnailer_t *p_thumb,
+                                    picture_t *p_pic, video_format_t *p_fmt )
+{
+    video_format_t fmt_in = p_thumb->p_dec->fmt_out.video;
+
+    if( fmt_in.i_sar_num == 0 || fmt_in.i_sar_den == 0 )
+        fmt_in.i_sar_num = fmt_in.i_sar_den = 1;
+
+    video_format_t fmt_out;
+    video_format_Init( &fmt_out, p_fmt->i_chroma ? p_fmt->i_chroma
+                                                 : fmt_in.i_chroma );
+    fmt_out.i_width = p_fmt->i_width;
+    fmt_out.i_height = p_fmt->i_height;
+
+    if( fmt_out.i_width == 0 && fmt_out.i_height != 0 )
+        fmt_out.i_width = (int64_t)fmt_in.i_visible_width * fmt_in.i_sar_num
+                          * fmt_out.i_height / fmt_in.i_visible_height
+                          / fmt_in.i_sar_den;
+    else if( fmt_out.i_height == 0 && fmt_out.i_width != 0 )
+        fmt_out.i_height = (int64_t)fmt_in.i_visible_height * fmt_in.i_sar_den
+                           * fmt_out.i_width / fmt_in.i_visible_width
+                           / fmt_in.i_sar_num;
+    if( fmt_out.i_width == 0 || fmt_out.i_height == 0 )
+    {
+        fmt_out.i_width = fmt_in.i_visible_width;
+        fmt_out.i_height = fmt_in.i_visible_height;
+        fmt_out.i_sar_num = fmt_in.i_sar_num;
+        fmt_out.i_sar_den = fmt_in.i_sar_den;
+    }
+    else
+        fmt_out.i_sar_num = fmt_out.i_sar_den = 1;
+    fmt_out.i_visible_width = fmt_out.i_width;
+    fmt_out.i_visible_height = fmt_out.i_height;
+
+    if( fmt_out.i_chroma == fmt_in.i_chroma
+     && fmt_out.i_width == fmt_in.i_width
+     && fmt_out.i_height == fmt_in.i_height )
+    {
+        *p_fmt = fmt_in;
+        return p_pic;
+    }
+
+    picture_t *p_scaled = image_Convert( p_thumb->p_image, p_pic, &fmt_in,
+                                         &fmt_out );
+    picture_Release( p_pic );
+    if( p_scaled != NULL )
+        *p_fmt = fmt_out;
+    return p_scaled;
+}
+
+picture_t *vlc_thumbnailer_Request( vlc_thumbnailer_t *p_thumb,
+                                    const char *psz_mrl,
+                                    mtime_t i_time, float f_pos,
+                                    video_format_t *p_fmt, mtime_t i_timeout )
+{
+    const mtime_t i_deadline = i_timeout > 0 ? mdate() + i_timeout : INT64_MAX;
+    const char *psz_access, *psz_demux, *psz_path, *psz_anchor;
+    char *psz_dup = strdup( psz_mrl );
+
+    if( unlikely(psz_dup == NULL) )
+        return NULL;
+    input_SplitMRL( &psz_access, &psz_demux, &psz_path, &psz_anchor,
+                    psz_dup );
+
+    access_t *p_access = access_New( p_thumb, NULL, psz_access, psz_demux,
+                                     psz_path );
+    if( p_access == NULL )
+    {
+        msg_Err( p_thumb, "cannot open `%s'", psz_mrl );
+        free( psz_dup );
+        return NULL;
+    }
+
+    /* Access-forced demuxer */
+    if( !psz_demux[0] || !strcasecmp( psz_demux, "any" ) )
+        psz_demux = p_access->psz_demux;
+
+    stream_t *p_stream = stream_AccessNew( p_access, NULL );
+    if( p_stream == NULL )
+    {
+        free( psz_dup );
+        return NULL;
+    }
+    p_stream = stream_FilterChainNew( p_stream, NULL, false );
+
+    es_out_sys_t sys = {
+        .p_thumb = p_thumb,
+        .p_video = NULL,
+        .p_pic = NULL,
+    };
+    es_out_t out = {
+        .pf_add = EsOutAdd,
+        .pf_send = EsOutSend,
+        .pf_del = EsOutDel,
+        .pf_control = EsOutControl,
+        .pf_destroy = NULL,
+        .p_sys = &sys,
+    };
+
+    demux_t *p_demux = demux_New( p_thumb, NULL, psz_access, psz_demux,
+                            p_stream->psz_path ? p_stream->psz_path : psz_path,
+                                  p_stream, &out, false );
+    free( psz_dup );
+    if( p_demux == NULL )
+    {
+        msg_Err( p_thumb, "no suitable demux module for `%s'", psz_mrl );
+        stream_Delete( p_stream );
+        return NULL;
+    }
+
+    /* Seek to the key frame before the requested point: any failure is not
+     * fatal, there will just be a thumbnail from the beginning */
+    if( i_time >= 0 )
+        demux_Control( p_demux, DEMUX_SET_TIME, i_time, false );
+    else if( f_pos > 0.f )
+        demux_Control( p_demux, DEMUX_SET_POSITION, (double)f_pos, false );
+
+    while( sys.p_pic == NULL && mdate() < i_deadline )
+        if( demux_Demux( p_demux ) <= 0 )
+            break;
+
+    demux_Delete( p_demux );
+
+    if( sys.p_pic == NULL )
+    {
+        msg_Warn( p_thumb, "no picture decoded from `%s'", psz_mrl );
+        return NULL;
+    }
+    return ThumbnailerScale( p_thumb, sys.p_pic, p_fmt );
+}
@@ -57,6 +57,7 @@
  *****************************************************************************/
 
 static void* Manage( void * );
+static void vlm_ReapInstances( vlm_t *, vlm_media_sys_t * );
 static int vlm_MediaVodControl( void *, vod_media_t *, const char *, int, va_list );
 
 typedef struct preparse_data_t
@@ -148,8 +149,10 @@ vlm_t *vlm_New ( vlc_object_t *p_this )
     vlc_mutex_init( &p_vlm->lock );
     vlc_mutex_init( &p_vlm->lock_manage );
     vlc_cond_init_daytime( &p_vlm->wait_manage );
+    vlc_cond_init( &p_vlm->wait_stopped );
     p_vlm->users = 1;
     p_vlm->input_state_changed = false;
+    TAB_INIT( p_vlm->i_stopping, p_vlm->stopping );
     p_vlm->i_id = 1;
     TAB_INIT( p_vlm->i_media, p_vlm->media );
     TAB_INIT( p_vlm->i_schedule, p_vlm->schedule );
@@ -158,6 +161,7 @@ vlm_t *vlm_New ( vlc_object_t *p_this )
 
     if( vlc_clone( &p_vlm->thread, Manage, p_vlm, VLC_THREAD_PRIORITY_LOW ) )
     {
+        vlc_cond_destroy( &p_vlm->wait_stopped );
         vlc_cond_destroy( &p_vlm->wait_manage );
         vlc_mutex_destroy( &p_vlm->lock );
         vlc_mutex_destroy( &p_vlm->lock_manage );
@@ -235,6 +239,9 @@ void vlm_Delete( vlm_t *p_vlm )
 
     vlc_join( p_vlm->thread, NULL );
 
+    assert( p_vlm->i_stopping == 0 );
+    TAB_CLEAN( p_vlm->i_stopping, p_vlm->stopping );
+    vlc_cond_destroy( &p_vlm->wait_stopped );
     vlc_cond_destroy( &p_vlm->wait_manage );
     vlc_mutex_destroy( &p_vlm->lock );
     vlc_mutex_destroy( &p_vlm->lock_manage );
@@ -383,6 +390,21 @@ static int vlm_MediaVodControl( void *p_private, vod_media_t *p_vod_media,
 }
 
 
+/**
+ * Returns the first date of a schedule after i_time, or its last date if it
+ * does not repeat any more.
+ */
+mtime_t vlm_ScheduleNext( const vlm_schedule_sys_t *sched, mtime_t i_time )
+{
+    if( sched->i_period == 0 || sched->i_date > i_time )
+        return sched->i_date;
+
+    int64_t n = ( i_time - sched->i_date ) / sched->i_period + 1;
+    if( sched->i_repeat >= 0 && n > sched->i_repeat )
+        n = sched->i_repeat;
+    return sched->i_date + n * sched->i_period;
+}
+
 /*****************************************************************************
  * Manage:
  *****************************************************************************/
@@ -404,7 +426,8 @@ static void* Manage( void* p_object )
 
         vlc_mutex_lock( &vlm->lock_manage );
         mutex_cleanup_push( &vlm->lock_manage );
-        while( !vlm->input_state_changed && !scheduled_command )
+        while( !vlm->input_state_changed && !scheduled_command
+            && vlm->i_stopping == 0 )
         {
             if( i_nextschedule )
                 scheduled_command = vlc_cond_timedwait( &vlm->wait_manage, &vlm->lock_manage, i_nextschedule ) != 0;
@@ -415,6 +438,9 @@ static void* Manage( void* p_object )
         vlc_cleanup_run( );
 
         int canc = vlc_savecancel ();
+        /* wait for the stopped inputs, without blocking the commands */
+        vlm_ReapInstances( vlm, NULL );
+
         /* destroy the inputs that wants to die, and launch the next input */
         vlc_mutex_lock( &vlm->lock );
         for( i = 0; i < vlm->i_media; i++ )
@@ -464,19 +490,10 @@ static void* Manage( void* p_object )
                     vlm->schedule[i]->i_date = (i_time / 1000000) * 1000000 ;
                     i_real_date = i_time;
                 }
-                else if( vlm->schedule[i]->i_period != 0 )
+                else
                 {
-                    int j = 0;
-                    while( vlm->schedule[i]->i_date + j *
-                           vlm->schedule[i]->i_period <= i_lastcheck &&
-                           ( vlm->schedule[i]->i_repeat > j ||
-                             vlm->schedule[i]->i_repeat == -1 ) )
-                    {
-                        j++;
-                    }
-
-                    i_real_date = vlm->schedule[i]->i_date + j *
-                        vlm->schedule[i]->i_period;
+                    i_real_date = vlm_ScheduleNext( vlm->schedule[i],
+                                                    i_lastcheck );
                 }
 
                 if( i_real_date <= i_time )
@@ -799,6 +816,7 @@ static int vlm_ControlMediaDel( vlm_t *p_vlm, int64_t id )
 
     while( p_media->i_instance > 0 )
         vlm_ControlInternal( p_vlm, VLM_STOP_MEDIA_INSTANCE, id, p_media->instance[0]->psz_name );
+    vlm_ReapInstances( p_vlm, p_media );
 
     if( p_media->cfg.b_vod )
     {
@@ -899,26 +917,76 @@ static vlm_media_instance_sys_t *vlm_MediaInstanceNew( vlm_t *p_vlm, const char
 
     return p_instance;
 }
+static void vlm_MediaInstanceDestroy( vlm_media_instance_sys_t *p_instance )
+{
+    input_resource_Terminate( p_instance->p_input_resource );
+    input_resource_Release( p_instance->p_input_resource );
+    vlc_object_release( p_instance->p_parent );
+
+    vlc_gc_decref( p_instance->p_item );
+    free( p_instance->psz_name );
+    free( p_instance );
+}
 static void vlm_MediaInstanceDelete( vlm_t *p_vlm, int64_t id, vlm_media_instance_sys_t *p_instance, vlm_media_sys_t *p_media )
 {
     input_thread_t *p_input = p_instance->p_input;
+
+    TAB_REMOVE( p_media->i_instance, p_media->instance, p_instance );
     if( p_input )
     {
+        /* The input can take a while to stop: the vlm thread waits for it */
         input_Stop( p_input, true );
-        input_Join( p_input );
-        var_DelCallback( p_instance->p_input, "intf-event", InputEvent, p_media );
-        input_Release( p_input );
-
         vlm_SendEventMediaInstanceStopped( p_vlm, id, p_media->cfg.psz_name );
+
+        p_instance->p_media = p_media;
+        vlc_mutex_lock( &p_vlm->lock_manage );
+        TAB_APPEND( p_vlm->i_stopping, p_vlm->stopping, p_instance );
+        p_media->i_stopping++;
+        vlc_cond_signal( &p_vlm->wait_manage );
+        vlc_mutex_unlock( &p_vlm->lock_manage );
+        return;
     }
-    input_resource_Terminate( p_instance->p_input_resource );
-    input_resource_Release( p_instance->p_input_resource );
-    vlc_object_release( p_instance->p_parent );
+    vlm_MediaInstanceDestroy( p_instance );
+}
 
-    TAB_REMOVE( p_media->i_instance, p_media->instance, p_instance );
-    vlc_gc_decref( p_instance->p_item );
-    free( p_instance->psz_name );
-    free( p_instance );
+/**
+ * Waits for the stopping instances of a media (of all media if NULL) and
+ * destroys them.
+ */
+static void vlm_ReapInstances( vlm_t *p_vlm, vlm_media_sys_t *p_media )
+{
+    vlc_mutex_lock( &p_vlm->lock_manage );
+    for( int i = 0; i < p_vlm->i_stopping; )
+    {
+        vlm_media_instance_sys_t *p_instance = p_vlm->stopping[i];
+        vlm_media_sys_t *p_owner = p_instance->p_media;
+
+        if( p_media != NULL && p_owner != p_media )
+        {
+            i++;
+            continue;
+        }
+        TAB_REMOVE( p_vlm->i_stopping, p_vlm->stopping, p_instance );
+        vlc_mutex_unlock( &p_vlm->lock_manage );
+
+        /* The media must remain until the input does not send events */
+        input_Join( p_instance->p_input );
+        var_DelCallback( p_instance->p_input, "intf-event", InputEvent,
+                         p_owner );
+        input_Release( p_instance->p_input );
+        vlm_MediaInstanceDestroy( p_instance );
+
+        vlc_mutex_lock( &p_vlm->lock_manage );
+        p_owner->i_stopping--;
+        vlc_cond_broadcast( &p_vlm->wait_stopped );
+        i = 0;
+    }
+
+    /* Another thread may be destroying one of them */
+    if( p_media != NULL )
+        while( p_media->i_stopping > 0 )
+            vlc_cond_wait( &p_vlm->wait_stopped, &p_vlm->lock_manage );
+    vlc_mutex_unlock( &p_vlm->lock_manage );
 }
 
 
@@ -43,10 +43,13 @@ typedef struct
     input_thread_t    *p_input;
     input_resource_t *p_input_resource;
 
+    /* media of the instance, once it is being stopped */
+    struct vlm_media_sys_t *p_media;
+
 } vlm_media_instance_sys_t;
 
 
-typedef struct
+typedef struct vlm_media_sys_t
 {
     vlm_media_t cfg;
 
@@ -59,6 +62,9 @@ typedef struct
     /* actual input instances */
     int                      i_instance;
     vlm_media_instance_sys_t **instance;
+
+    /* instances being stopped, protected by vlm_t.lock_manage */
+    int                      i_stopping;
 } vlm_media_sys_t;
 
 typedef struct
@@ -93,6 +99,12 @@ struct vlm_t
 
     /* tell vlm thread there is work to do */
     bool         input_state_changed;
+
+    /* Instances whose input is stopping, which the vlm thread waits for and
+     * destroys, outside of the lock (protected by lock_manage) */
+    int                      i_stopping;
+    vlm_media_instance_sys_t **stopping;
+    vlc_cond_t               wait_stopped;
     /* */
     int64_t        i_id;
 
@@ -109,6 +121,7 @@ struct vlm_t
 };
 
 int64_t vlm_Date(void);
+mtime_t vlm_ScheduleNext( const vlm_schedule_sys_t *, mtime_t );
 int vlm_ControlInternal( vlm_t *p_vlm, int i_query, ... );
 int ExecuteCommand( vlm_t *, const char *, vlm_message_t ** );
 void vlm_ScheduleDelete( vlm_t *vlm, vlm_schedule_sys_t *sched );
@@ -1496,19 +1496,7 @@ static vlm_message_t *vlm_Show( vlm_t *vlm, vlm_media_sys_t *media,
 
             /* calculate next date */
             i_time = vlm_Date();
-            i_next_date = s->i_date;
-
-            if( s->i_period != 0 )
-            {
-                int j = 0;
-                while( s->i_date + j * s->i_period <= i_time &&
-                       s->i_repeat > j )
-                {
-                    j++;
-                }
-
-                i_next_date = s->i_date + j * s->i_period;
-            }
+            i_next_date = vlm_ScheduleNext( s, i_time );
 
             if( i_next_date > i_time )
             {
@@ -31,6 +31,8 @@
 # include "config.h"
 #endif
 
+#include <limits.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_cpu.h>
@@ -465,14 +467,25 @@ static const char *const ppsz_pos_descriptions[] =
 
 #define SKIP_FRAMES_TEXT N_("Skip frames")
 #define SKIP_FRAMES_LONGTEXT N_( \
-    "Enables framedropping on MPEG2 stream. Framedropping " \
-    "occurs when your computer is not powerful enough" )
+    "Enables framedropping by the video decoders. Framedropping " \
+    "occurs when your computer is not powerful enough: the decoders " \
+    "then skip more and more work until the pictures are on time again." )
 
 #define DROP_LATE_FRAMES_TEXT N_("Drop late frames")
 #define DROP_LATE_FRAMES_LONGTEXT N_( \
     "This drops frames that are late (arrive to the video output after " \
     "their intended display date)." )
 
+#define VIDEO_FILTER_PIPELINE_TEXT N_("Run video filters in parallel")
+#define VIDEO_FILTER_PIPELINE_LONGTEXT N_( \
+    "Run each video filter on its own thread, so that long filter chains " \
+    "use several CPU cores.")
+
+#define RENDER_AHEAD_TEXT N_("Pictures rendered ahead")
+#define RENDER_AHEAD_LONGTEXT N_( \
+    "Number of upcoming pictures the video output filters in advance. " \
+    "Higher values absorb more filtering jitter at the expense of memory.")
+
 #define QUIET_SYNCHRO_TEXT N_("Quiet synchro")
 #define QUIET_SYNCHRO_LONGTEXT N_( \
     "This avoids flooding the message log with debug output from the " \
@@ -512,6 +525,12 @@ static const char *const ppsz_pos_descriptions[] =
 #define NETWORK_CACHING_LONGTEXT N_( \
     "Caching value for network resources, in milliseconds." )
 
+#define PREFETCH_TEXT N_("Stream prefetch buffer (KiB)")
+#define PREFETCH_LONGTEXT N_( \
+    "Maximum amount of data read ahead of the demuxer by a background " \
+    "thread, in kibibytes. The amount actually kept depends on the " \
+    "bitrate and on the latency of the input. 0 disables prefetching." )
+
 #define CR_AVERAGE_TEXT N_("Clock reference average counter")
 #define CR_AVERAGE_LONGTEXT N_( \
     "When using the PVR input (or a very irregular source), you should " \
@@ -528,6 +547,24 @@ static const char *const ppsz_pos_descriptions[] =
     "This defines the maximum input delay jitter that the synchronization " \
     "algorithms should try to compensate (in milliseconds)." )
 
+#define LOW_LATENCY_TEXT N_("Low-latency mode")
+#define LOW_LATENCY_LONGTEXT N_( \
+    "Show pictures as soon as they are decoded, and drop late data rather " \
+    "than buffering it. This suits live monitoring, where the delay " \
+    "matters more than smoothness and lip synchronisation." )
+
+#define DECODER_REUSE_TEXT N_("Reuse the decoders")
+#define DECODER_REUSE_LONGTEXT N_( \
+    "Keep the audio and video decoders of an ended item for the next one, " \
+    "if its streams have the same formats, instead of opening them again. " \
+    "This avoids the costly setup of hardware decoders between items." )
+
+#define GAPLESS_TEXT N_("Gapless audio")
+#define GAPLESS_LONGTEXT N_( \
+    "Open the next item of the playlist before the current one ends, and " \
+    "keep the audio output playing in between, so that the audio of " \
+    "consecutive items is played without gap." )
+
 #define NETSYNC_TEXT N_("Network synchronisation" )
 #define NETSYNC_LONGTEXT N_( "This allows you to remotely " \
         "synchronise clocks for server and client. The detailed settings " \
@@ -537,6 +574,17 @@ static const int pi_clock_values[] = { -1, 0, 1 };
 static const char *const ppsz_clock_descriptions[] =
 { N_("Default"), N_("Disable"), N_("Enable") };
 
+#define CLOCK_RECOVERY_TEXT N_("Clock recovery")
+#define CLOCK_RECOVERY_LONGTEXT N_( \
+    "Method used to estimate the drift of real-time sources clock. The " \
+    "regression over the lowest delays separates the network jitter from " \
+    "the drift, and gives smoother corrections on jittery streams." )
+
+static const char *const ppsz_clock_recovery[] =
+{ "average", "regression" };
+static const char *const ppsz_clock_recovery_text[] =
+{ N_("Moving average"), N_("Linear regression") };
+
 #define MTU_TEXT N_("MTU of the network interface")
 #define MTU_LONGTEXT N_( \
     "This is the maximum application-layer packet size that can be " \
@@ -680,6 +728,18 @@ static const char *const ppsz_prefres[] = {
     "This is the maximum size in bytes of the temporary files " \
     "that will be used to store the timeshifted streams." )
 
+#define INPUT_TIMESHIFT_SIZE_TEXT N_("Timeshift window size")
+#define INPUT_TIMESHIFT_SIZE_LONGTEXT N_( \
+    "Disk space in MiB kept for seeking back within the timeshifted " \
+    "streams. The oldest data is dropped beyond it. " \
+    "0 keeps only what has not been played yet." )
+
+#define INPUT_STANDBY_WINDOW_TEXT N_("Standby window (ms)")
+#define INPUT_STANDBY_WINDOW_LONGTEXT N_( \
+    "Duration of the stream kept by an input opened in standby, for a " \
+    "fast switch to it. When the key frames of the video are known, the " \
+    "data from the last one is kept instead, up to four times as long." )
+
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
     "$a: Artist<br>$b: Album<br>$c: Copyright<br>$t: Title<br>$g: Genre<br>"  \
@@ -813,6 +873,11 @@ static const char *const ppsz_prefres[] = {
     "However allocation of port numbers below 1025 is usually restricted " \
     "by the operating system." )
 
+#define HTTP_THREADS_TEXT N_( "HTTP server threads" )
+#define HTTP_THREADS_LONGTEXT N_( \
+    "Number of threads serving the connections of each HTTP, HTTPS and " \
+    "RTSP server. 0 picks a value from the number of CPUs." )
+
 #define HTTPS_PORT_TEXT N_( "HTTPS server port" )
 #define HTTPS_PORT_LONGTEXT N_( \
     "The HTTPS server will listen on this TCP port. " \
@@ -1032,6 +1097,12 @@ static const char *const ppsz_prefres[] = {
 #define STATS_LONGTEXT N_( \
      "Collect miscellaneous local statistics about the playing media.")
 
+#define TRACE_FILE_TEXT N_("Trace file")
+#define TRACE_FILE_LONGTEXT N_( \
+    "Record the timings of the decoders, outputs, demuxers and streams, " \
+    "and write them to this file in the Chrome trace event format, on " \
+    "exit or when the trace-dump variable is triggered.")
+
 #define DAEMON_TEXT N_("Run as daemon process")
 #define DAEMON_LONGTEXT N_( \
      "Runs VLC as a background daemon process.")
@@ -1044,6 +1115,19 @@ static const char *const ppsz_prefres[] = {
 #define FILE_LOG_LONGTEXT N_( \
     "Log all VLC messages to a text file." )
 
+#define LOG_ASYNC_TEXT N_( "Asynchronous logging" )
+#define LOG_ASYNC_LONGTEXT N_( \
+    "Pass messages on to the console or to the log handler from a " \
+    "dedicated thread, so that verbose logging does not slow playback " \
+    "down. Messages are dropped rather than waited for if they come in " \
+    "too fast. Disable this to debug crashes, as the last pending messages " \
+    "would be lost." )
+
+#define LOG_RATE_TEXT N_( "Log rate limit" )
+#define LOG_RATE_LONGTEXT N_( \
+    "Maximum number of non-error messages per second from any given " \
+    "module, with asynchronous logging (0 = no limit)." )
+
 #define SYSLOG_TEXT N_( "Log to syslog" )
 #define SYSLOG_LONGTEXT N_( \
     "Log all VLC messages to syslog (UNIX systems)." )
@@ -1083,6 +1167,19 @@ static const char *const ppsz_prefres[] = {
     "all the processor time and render the whole system unresponsive which " \
     "might require a reboot of your machine.")
 
+#define CPU_SET_TEXT N_("Input CPUs")
+#define CPU_SET_LONGTEXT N_( \
+    "Runs the threads of each input (demux, decoders, outputs started by " \
+    "it) on these CPUs only, as a list of CPU numbers and ranges, " \
+    "e.g. \"0-7,16-23\". This lets independent streams scale with the " \
+    "number of processors.")
+
+#define CPU_NODE_TEXT N_("Input NUMA node")
+#define CPU_NODE_LONGTEXT N_( \
+    "Runs the threads of each input on the CPUs of this NUMA node only, so " \
+    "that their buffers are allocated in the memory local to the node " \
+    "(-1 for any).")
+
 #define PLAYLISTENQUEUE_TEXT N_( \
     "Enqueue items into playlist in one instance mode")
 #define PLAYLISTENQUEUE_LONGTEXT N_( \
@@ -1105,6 +1202,15 @@ static const char *const ppsz_prefres[] = {
 
 #define METADATA_NETWORK_TEXT N_( "Allow metadata network access" )
 
+#define PREPARSE_THREADS_TEXT N_( "Preparser threads" )
+#define PREPARSE_THREADS_LONGTEXT N_( \
+    "Maximum number of items preparsed at the same time." )
+
+#define PREPARSE_HOST_THREADS_TEXT N_( "Preparser threads per server" )
+#define PREPARSE_HOST_THREADS_LONGTEXT N_( \
+    "Maximum number of network items from the same server preparsed at " \
+    "the same time." )
+
 #define SD_TEXT N_( "Services discovery modules")
 #define SD_LONGTEXT N_( \
      "Specifies the services discovery modules to preload, separated by " \
@@ -1499,6 +1605,9 @@ vlc_module_begin ()
         change_private ()
     add_bool( "drop-late-frames", 1, DROP_LATE_FRAMES_TEXT,
               DROP_LATE_FRAMES_LONGTEXT, true )
+    add_integer( "video-render-ahead", 1, RENDER_AHEAD_TEXT,
+                 RENDER_AHEAD_LONGTEXT, true )
+        change_integer_range( 1, 8 )
     /* Used in vout_synchro */
     add_bool( "skip-frames", 1, SKIP_FRAMES_TEXT,
               SKIP_FRAMES_LONGTEXT, true )
@@ -1599,6 +1708,8 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     add_module_list_cat( "video-filter", SUBCAT_VIDEO_VFILTER, NULL,
                 VIDEO_FILTER_TEXT, VIDEO_FILTER_LONGTEXT, false )
+    add_bool( "video-filter-pipeline", false, VIDEO_FILTER_PIPELINE_TEXT,
+              VIDEO_FILTER_PIPELINE_LONGTEXT, true )
     add_module_list( "video-splitter", "video splitter", NULL,
                      VIDEO_SPLITTER_TEXT, VIDEO_SPLITTER_LONGTEXT, false )
     add_obsolete_string( "vout-filter" ) /* since 2.0.0 */
@@ -1730,6 +1841,9 @@ vlc_module_begin ()
         change_integer_range( 1, 65535 )
     add_integer( "https-port", 8443, HTTPS_PORT_TEXT, HTTPS_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
+    add_integer( "http-threads", 0, HTTP_THREADS_TEXT,
+                 HTTP_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 64 )
     add_string( "rtsp-host", NULL, RTSP_HOST_TEXT, RTSP_HOST_LONGTEXT, true )
     add_integer( "rtsp-port", 554, RTSP_PORT_TEXT, RTSP_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
@@ -1824,15 +1938,27 @@ vlc_module_begin ()
     add_obsolete_integer( "smb-caching" ) /* 2.0.0 */
     add_obsolete_integer( "tcp-caching" ) /* 2.0.0 */
     add_obsolete_integer( "udp-caching" ) /* 2.0.0 */
+    add_integer( "stream-prefetch", 0, PREFETCH_TEXT, PREFETCH_LONGTEXT, true )
+        change_integer_range( 0, 1048576 )
 
     add_integer( "cr-average", 40, CR_AVERAGE_TEXT,
                  CR_AVERAGE_LONGTEXT, true )
     add_integer( "clock-synchro", -1, CLOCK_SYNCHRO_TEXT,
                  CLOCK_SYNCHRO_LONGTEXT, true )
         change_integer_list( pi_clock_values, ppsz_clock_descriptions )
+    add_string( "clock-recovery", ppsz_clock_recovery[0], CLOCK_RECOVERY_TEXT,
+                CLOCK_RECOVERY_LONGTEXT, true )
+        change_string_list( ppsz_clock_recovery, ppsz_clock_recovery_text )
+        change_safe()
     add_integer( "clock-jitter", 5 * CLOCK_FREQ/1000, CLOCK_JITTER_TEXT,
               CLOCK_JITTER_LONGTEXT, true )
         change_safe()
+    add_bool( "low-latency", false, LOW_LATENCY_TEXT,
+              LOW_LATENCY_LONGTEXT, true )
+        change_safe()
+    add_bool( "decoder-reuse", true, DECODER_REUSE_TEXT,
+              DECODER_REUSE_LONGTEXT, true )
+    add_bool( "gapless", true, GAPLESS_TEXT, GAPLESS_LONGTEXT, true )
 
     add_bool( "network-synchronisation", false, NETSYNC_TEXT,
               NETSYNC_LONGTEXT, true )
@@ -1846,6 +1972,11 @@ vlc_module_begin ()
                 INPUT_TIMESHIFT_PATH_LONGTEXT, true )
     add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
                  INPUT_TIMESHIFT_GRANULARITY_LONGTEXT, true )
+    add_integer( "input-timeshift-size", 1024, INPUT_TIMESHIFT_SIZE_TEXT,
+                 INPUT_TIMESHIFT_SIZE_LONGTEXT, true )
+    add_integer_with_range( "input-standby-window", 2000, 100, 60000,
+                            INPUT_STANDBY_WINDOW_TEXT,
+                            INPUT_STANDBY_WINDOW_LONGTEXT, true )
 
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT, false );
 
@@ -1961,6 +2092,13 @@ vlc_module_begin ()
                  RT_OFFSET_LONGTEXT, true )
 #endif
 
+#ifdef HAVE_SCHED_GETAFFINITY
+    add_string( "cpu-set", NULL, CPU_SET_TEXT, CPU_SET_LONGTEXT, true )
+        change_safe ()
+    add_integer( "cpu-node", -1, CPU_NODE_TEXT, CPU_NODE_LONGTEXT, true )
+        change_safe ()
+#endif
+
 #if defined(HAVE_DBUS)
     add_bool( "inhibit", 1, INHIBIT_TEXT,
               INHIBIT_LONGTEXT, true )
@@ -2021,6 +2159,12 @@ vlc_module_begin ()
     add_obsolete_integer( "album-art" )
     add_bool( "metadata-network-access", false, METADATA_NETWORK_TEXT,
                  METADATA_NETWORK_TEXT, false )
+    add_integer_with_range( "preparse-threads", 4, 1, 32,
+                            PREPARSE_THREADS_TEXT,
+                            PREPARSE_THREADS_LONGTEXT, true )
+    add_integer_with_range( "preparse-host-threads", 2, 1, 32,
+                            PREPARSE_HOST_THREADS_TEXT,
+                            PREPARSE_HOST_THREADS_LONGTEXT, true )
 
     set_subcategory( SUBCAT_PLAYLIST_SD )
     add_string( "services-discovery", "", SD_TEXT, SD_LONGTEXT, true )
@@ -2059,12 +2203,19 @@ vlc_module_begin ()
 
     add_bool( "color", true, COLOR_TEXT, COLOR_LONGTEXT, true )
         change_volatile ()
+    add_bool( "log-async", true, LOG_ASYNC_TEXT, LOG_ASYNC_LONGTEXT, true )
+        change_volatile ()
+    add_integer( "log-rate-limit", 0, LOG_RATE_TEXT, LOG_RATE_LONGTEXT, true )
+        change_integer_range( 0, INT_MAX )
+        change_volatile ()
     add_bool( "advanced", false, ADVANCED_TEXT, ADVANCED_LONGTEXT,
                     false )
     add_bool( "interact", true, INTERACTION_TEXT,
               INTERACTION_LONGTEXT, false )
 
     add_bool ( "stats", false, STATS_TEXT, STATS_LONGTEXT, true )
+    add_savefile( "trace-file", NULL, TRACE_FILE_TEXT, TRACE_FILE_LONGTEXT,
+                  true )
 
     set_subcategory( SUBCAT_INTERFACE_MAIN )
     add_module_cat( "intf", SUBCAT_INTERFACE_MAIN, NULL, INTF_TEXT,
@@ -39,6 +39,7 @@
 #include <vlc_common.h>
 #include "../lib/libvlc_internal.h"
 #include <vlc_input.h>
+#include <vlc_block.h>
 
 #include "modules/modules.h"
 #include "config/configuration.h"
@@ -69,6 +70,7 @@
 #include "libvlc.h"
 #include "playlist/playlist_internal.h"
 #include "misc/variables.h"
+#include "misc/trace.h"
 
 #include <vlc_vlm.h>
 
@@ -102,6 +104,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv->playlist = NULL;
     priv->p_dialog_provider = NULL;
     priv->p_vlm = NULL;
+    priv->http_pool = NULL;
 
     vlc_ExitInit( &priv->exit );
 
@@ -232,6 +235,9 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
     }
 #endif
 
+    /* Now that the process will not fork anymore, log asynchronously */
+    vlc_LogStart( p_libvlc );
+
 /* FIXME: could be replaced by using Unix sockets */
 #ifdef HAVE_DBUS
 
@@ -349,6 +355,8 @@ dbus_out:
     vlc_CPU_dump( VLC_OBJECT(p_libvlc) );
 
     priv->b_stats = var_InheritBool( p_libvlc, "stats" );
+    vlc_trace_Init( p_libvlc );
+    vlc_threadpool_Init();
 
     /*
      * Initialize hotkey handling
@@ -360,6 +368,11 @@ dbus_out:
      */
     priv->parser = playlist_preparser_New(VLC_OBJECT(p_libvlc));
 
+    /*
+     * Persistent HTTP connections
+     */
+    priv->http_pool = vlc_http_pool_New();
+
     /* Create a variable for showing the fullscreen interface */
     var_Create( p_libvlc, "intf-toggle-fscontrol", VLC_VAR_BOOL );
     var_SetBool( p_libvlc, "intf-toggle-fscontrol", true );
@@ -545,8 +558,21 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if (priv->parser != NULL)
         playlist_preparser_Delete(priv->parser);
 
+    vlc_http_pool_Delete( VLC_OBJECT(p_libvlc), priv->http_pool );
+
     vlc_DeinitActions( p_libvlc, priv->actions );
 
+    block_alloc_stats_t st;
+
+    block_GetAllocStats( &st );
+    msg_Dbg( p_libvlc, "block allocator: %"PRIu64" blocks from arenas "
+             "(%"PRIu64" recycled, %"PRIu64" spilled), %zu bytes cached in "
+             "%u arenas", st.allocs, st.hits, st.spills, st.cached,
+             st.arenas );
+
+    vlc_trace_Deinit( p_libvlc );
+    vlc_threadpool_Deinit();
+
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
@@ -25,6 +25,8 @@
 #ifndef LIBVLC_LIBVLC_H
 # define LIBVLC_LIBVLC_H 1
 
+# include <vlc_atomic.h>
+
 extern const char psz_vlc_changeset[];
 
 typedef struct variable_t variable_t;
@@ -64,6 +66,10 @@ int vlc_set_priority( vlc_thread_t, int );
 
 void vlc_threads_setup (libvlc_int_t *);
 
+/* Thread pool, refcounted by the LibVLC instances */
+void vlc_threadpool_Init(void);
+void vlc_threadpool_Deinit(void);
+
 void vlc_trace (const char *fn, const char *file, unsigned line);
 #define vlc_backtrace() vlc_trace(__func__, __FILE__, __LINE__)
 
@@ -77,6 +83,7 @@ void vlc_assert_locked (vlc_mutex_t *);
  * Logging
  */
 void vlc_LogInit(libvlc_int_t *);
+void vlc_LogStart(libvlc_int_t *);
 void vlc_LogDeinit(libvlc_int_t *);
 
 /*
@@ -151,6 +158,7 @@ typedef struct libvlc_priv_t
         void *opaque;
         signed char verbose;
         vlc_rwlock_t lock;
+        struct vlc_log_queue *queue; /**< Asynchronous logging, or NULL */
     } log;
     bool               b_stats;     ///< Whether to collect stats
 
@@ -160,6 +168,7 @@ typedef struct libvlc_priv_t
     struct playlist_t *playlist; ///< Playlist for interfaces
     struct playlist_preparser_t *parser; ///< Input item meta data handler
     struct vlc_actions *actions; ///< Hotkeys handler
+    struct vlc_http_pool_t *http_pool; ///< Idle HTTP client connections
 
     /* Objects tree */
     vlc_mutex_t        structure_lock;
@@ -177,6 +186,14 @@ void intf_InsertItem(libvlc_int_t *, const char *mrl, unsigned optc,
                      const char * const *optv, unsigned flags);
 void intf_DestroyAll( libvlc_int_t * );
 
+/*
+ * HTTP connection pool
+ */
+typedef struct vlc_http_pool_t vlc_http_pool_t;
+
+vlc_http_pool_t *vlc_http_pool_New( void );
+void vlc_http_pool_Delete( vlc_object_t *, vlc_http_pool_t * );
+
 #define libvlc_stats( o ) (libvlc_priv((VLC_OBJECT(o))->p_libvlc)->b_stats)
 
 /*
@@ -202,6 +219,9 @@ typedef struct counter_sample_t
 typedef struct counter_t
 {
     int                 i_compute_type;
+    /* STATS_COUNTER: updated without lock */
+    atomic_uint_least64_t value;
+    /* STATS_DERIVATIVE: under the input counters lock */
     int                 i_samples;
     counter_sample_t ** pp_samples;
 
@@ -37,6 +37,7 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
 
 /**
  * @section Block handling functions.
@@ -126,34 +127,434 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /* Maximum size of reserved footer before shrinking with realloc(). */
 #define BLOCK_WASTE_SIZE   2048
 
+/**
+ * @section Per-thread block arenas
+ *
+ * block_Alloc() serves small and medium blocks from power-of-two size
+ * classes cached by the allocating thread. A block always goes back to the
+ * arena of the thread that allocated it, whichever thread releases it. The
+ * arena is destroyed once its thread has exited and all its blocks are gone.
+ *
+ * @note On Windows, only threads created with vlc_clone() destroy their
+ * arena on exit.
+ */
+#define BLOCK_ARENA_MIN_SHIFT 9  /* 512 bytes */
+#define BLOCK_ARENA_MAX_SHIFT 16 /* 64 KiB */
+#define BLOCK_ARENA_CLASSES (BLOCK_ARENA_MAX_SHIFT - BLOCK_ARENA_MIN_SHIFT + 1)
+
+/** Maximum bytes cached per size class and per arena */
+#define BLOCK_ARENA_CACHE (512 << 10)
+
+typedef struct block_arena_t block_arena_t;
+
+typedef struct block_slab_t
+{
+    block_t self;
+    block_arena_t *arena;
+    struct block_slab_t *next_free;
+    unsigned cls;
+} block_slab_t;
+
+struct block_arena_t
+{
+    vlc_mutex_t lock;
+    block_slab_t *free[BLOCK_ARENA_CLASSES];
+    unsigned free_count[BLOCK_ARENA_CLASSES];
+    size_t outstanding; /**< blocks allocated and not released yet */
+    bool orphan; /**< owner thread has exited */
+    block_alloc_stats_t stats;
+
+    block_arena_t *next;
+    block_arena_t **pprev;
+};
+
+static vlc_mutex_t block_arena_lock = VLC_STATIC_MUTEX;
+static block_arena_t *block_arenas = NULL;
+static block_alloc_stats_t block_arena_totals; /* of destroyed arenas */
+static vlc_threadvar_t block_arena_key;
+static atomic_int block_arena_state = ATOMIC_VAR_INIT(0);
+
+static void block_arena_Destroy (block_arena_t *arena)
+{
+    vlc_mutex_lock (&block_arena_lock);
+    *arena->pprev = arena->next;
+    if (arena->next != NULL)
+        arena->next->pprev = arena->pprev;
+    block_arena_totals.allocs += arena->stats.allocs;
+    block_arena_totals.hits += arena->stats.hits;
+    block_arena_totals.spills += arena->stats.spills;
+    vlc_mutex_unlock (&block_arena_lock);
+
+    vlc_mutex_destroy (&arena->lock);
+    free (arena);
+}
+
+/** Thread exit handler: flushes the cache and disowns the arena. */
+static void block_arena_Orphan (void *data)
+{
+    block_arena_t *arena = data;
+    block_slab_t *list[BLOCK_ARENA_CLASSES];
+    bool destroy;
+
+    vlc_mutex_lock (&arena->lock);
+    for (unsigned i = 0; i < BLOCK_ARENA_CLASSES; i++)
+    {
+        list[i] = arena->free[i];
+        arena->free[i] = NULL;
+        arena->free_count[i] = 0;
+    }
+    arena->stats.cached = 0;
+    arena->orphan = true;
+    destroy = arena->outstanding == 0;
+    vlc_mutex_unlock (&arena->lock);
+
+    for (unsigned i = 0; i < BLOCK_ARENA_CLASSES; i++)
+        while (list[i] != NULL)
+        {
+            block_slab_t *next = list[i]->next_free;
+
+            free (list[i]);
+            list[i] = next;
+        }
+
+    if (destroy)
+        block_arena_Destroy (arena);
+}
+
+/** Gets the arena of the calling thread, creating it if needed. */
+static block_arena_t *block_arena_Get (void)
+{
+    int state = atomic_load_explicit (&block_arena_state,
+                                      memory_order_acquire);
+    if (unlikely(state == 0))
+    {
+        vlc_mutex_lock (&block_arena_lock);
+        state = atomic_load (&block_arena_state);
+        if (state == 0)
+        {
+            state = vlc_threadvar_create (&block_arena_key,
+                                          block_arena_Orphan) ? -1 : 1;
+            atomic_store_explicit (&block_arena_state, state,
+                                   memory_order_release);
+        }
+        vlc_mutex_unlock (&block_arena_lock);
+    }
+    if (state < 0)
+        return NULL;
+
+    block_arena_t *arena = vlc_threadvar_get (block_arena_key);
+    if (likely(arena != NULL))
+        return arena;
+
+    arena = calloc (1, sizeof (*arena));
+    if (unlikely(arena == NULL))
+        return NULL;
+    vlc_mutex_init (&arena->lock);
+    if (vlc_threadvar_set (block_arena_key, arena))
+    {
+        vlc_mutex_destroy (&arena->lock);
+        free (arena);
+        return NULL;
+    }
+
+    vlc_mutex_lock (&block_arena_lock);
+    arena->next = block_arenas;
+    if (arena->next != NULL)
+        arena->next->pprev = &arena->next;
+    arena->pprev = &block_arenas;
+    block_arenas = arena;
+    vlc_mutex_unlock (&block_arena_lock);
+    return arena;
+}
+
+static void block_slab_Release (block_t *block)
+{
+    block_slab_t *slab = (block_slab_t *)block;
+    block_arena_t *arena = slab->arena;
+    const unsigned cls = slab->cls;
+    const size_t size = (size_t)1 << (cls + BLOCK_ARENA_MIN_SHIFT);
+    bool destroy = false;
+
+    block_Invalidate (block);
+
+    vlc_mutex_lock (&arena->lock);
+    assert (arena->outstanding > 0);
+    arena->outstanding--;
+    if (!arena->orphan
+     && (arena->free_count[cls] + 1) * size <= BLOCK_ARENA_CACHE)
+    {
+        slab->next_free = arena->free[cls];
+        arena->free[cls] = slab;
+        arena->free_count[cls]++;
+        arena->stats.cached += size;
+        slab = NULL;
+    }
+    else
+    {
+        arena->stats.spills++;
+        destroy = arena->orphan && arena->outstanding == 0;
+    }
+    vlc_mutex_unlock (&arena->lock);
+
+    free (slab);
+    if (destroy)
+        block_arena_Destroy (arena);
+}
+
+/** Allocates a block of the given total size from the thread arena. */
+static block_t *block_slab_Alloc (size_t alloc)
+{
+    unsigned cls = 0;
+
+    while (((size_t)1 << (cls + BLOCK_ARENA_MIN_SHIFT)) < alloc)
+        if (++cls >= BLOCK_ARENA_CLASSES)
+            return NULL; /* too large */
+
+    block_arena_t *arena = block_arena_Get ();
+    if (unlikely(arena == NULL))
+        return NULL;
+
+    const size_t size = (size_t)1 << (cls + BLOCK_ARENA_MIN_SHIFT);
+    block_slab_t *slab;
+
+    vlc_mutex_lock (&arena->lock);
+    arena->outstanding++;
+    arena->stats.allocs++;
+    slab = arena->free[cls];
+    if (slab != NULL)
+    {
+        arena->free[cls] = slab->next_free;
+        arena->free_count[cls]--;
+        arena->stats.cached -= size;
+        arena->stats.hits++;
+    }
+    vlc_mutex_unlock (&arena->lock);
+
+    if (slab == NULL)
+    {
+        slab = malloc (size);
+        if (unlikely(slab == NULL))
+        {
+            vlc_mutex_lock (&arena->lock);
+            arena->outstanding--;
+            arena->stats.allocs--;
+            vlc_mutex_unlock (&arena->lock);
+            return NULL;
+        }
+        slab->arena = arena;
+        slab->cls = cls;
+    }
+
+    /* Only the requested size is exposed, so that block_Realloc() behaves
+     * as with a plain heap allocation. */
+    block_Init (&slab->self, slab + 1, alloc - sizeof (*slab));
+    slab->self.pf_release = block_slab_Release;
+    return &slab->self;
+}
+
+/**
+ * Fetches statistics of the block allocator, aggregated over all threads.
+ */
+void block_GetAllocStats (block_alloc_stats_t *st)
+{
+    vlc_mutex_lock (&block_arena_lock);
+    *st = block_arena_totals;
+    st->cached = 0;
+    st->arenas = 0;
+    for (block_arena_t *arena = block_arenas; arena; arena = arena->next)
+    {
+        vlc_mutex_lock (&arena->lock);
+        st->allocs += arena->stats.allocs;
+        st->hits += arena->stats.hits;
+        st->spills += arena->stats.spills;
+        st->cached += arena->stats.cached;
+        vlc_mutex_unlock (&arena->lock);
+        st->arenas++;
+    }
+    vlc_mutex_unlock (&block_arena_lock);
+}
+
 block_t *block_Alloc (size_t size)
 {
     /* 2 * BLOCK_PADDING: pre + post padding */
-    const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                       + size;
+    const size_t alloc = sizeof (block_slab_t) + BLOCK_ALIGN
+                       + (2 * BLOCK_PADDING) + size;
     if (unlikely(alloc <= size))
         return NULL;
 
-    block_t *b = malloc (alloc);
-    if (unlikely(b == NULL))
-        return NULL;
+    block_t *b = block_slab_Alloc (alloc);
+    if (b == NULL)
+    {
+        b = malloc (alloc);
+        if (unlikely(b == NULL))
+            return NULL;
+
+        block_Init (b, b + 1, alloc - sizeof (*b));
+        b->pf_release = block_generic_Release;
+    }
 
-    block_Init (b, b + 1, alloc - sizeof (*b));
     static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
                    "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
     b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
     b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
     b->i_buffer = size;
-    b->pf_release = block_generic_Release;
     return b;
 }
 
+/**
+ * @section Shared blocks
+ *
+ * A shared block is a reference to a read-only payload owned by another
+ * block, which is released with the last reference. Each reference has its
+ * own header, hence its own properties and payload boundaries.
+ */
+typedef struct
+{
+    atomic_uint refs;
+    block_t *block; /**< owner of the payload */
+} block_storage_t;
+
+typedef struct
+{
+    block_t self;
+    block_storage_t *storage;
+} block_shared_t;
+
+static void block_shared_Release (block_t *block)
+{
+    block_shared_t *sh = (block_shared_t *)block;
+    block_storage_t *storage = sh->storage;
+
+    block_Invalidate (block);
+    free (sh);
+
+    if (atomic_fetch_sub (&storage->refs, 1) == 1)
+    {
+        block_Release (storage->block);
+        free (storage);
+    }
+}
+
+/** Creates a reference to the storage, with the properties of src. */
+static block_t *block_shared_New (block_storage_t *storage, const block_t *src)
+{
+    block_shared_t *sh = malloc (sizeof (*sh));
+    if (unlikely(sh == NULL))
+        return NULL;
+
+    block_Init (&sh->self, src->p_start, src->i_size);
+    BlockMetaCopy (&sh->self, src);
+    sh->self.p_buffer = src->p_buffer;
+    sh->self.i_buffer = src->i_buffer;
+    sh->self.pf_release = block_shared_Release;
+    sh->storage = storage;
+    return &sh->self;
+}
+
+/**
+ * Turns a block into a shared one, which block_Clone() can reference without
+ * copying the payload. The payload must not be written to afterwards, other
+ * than through block_Realloc() or after block_Unshare().
+ *
+ * @return the shared block, or the block itself on error (block_Clone()
+ * then falls back to copies).
+ */
+block_t *block_Share (block_t *block)
+{
+    block_Check (block);
+    if (block->pf_release == block_shared_Release)
+        return block;
+
+    block_storage_t *storage = malloc (sizeof (*storage));
+    if (unlikely(storage == NULL))
+        return block;
+
+    atomic_init (&storage->refs, 1);
+    storage->block = block;
+
+    block_t *sh = block_shared_New (storage, block);
+    if (unlikely(sh == NULL))
+    {
+        free (storage);
+        return block;
+    }
+    block->p_next = NULL;
+    return sh;
+}
+
+/**
+ * Creates another reference to the payload of a shared block, with a copy
+ * of its properties. Other blocks are duplicated.
+ */
+block_t *block_Clone (block_t *block)
+{
+    block_Check (block);
+    if (block->pf_release != block_shared_Release)
+        return block_Duplicate (block);
+
+    block_storage_t *storage = ((block_shared_t *)block)->storage;
+
+    atomic_fetch_add (&storage->refs, 1);
+    block_t *clone = block_shared_New (storage, block);
+    if (unlikely(clone == NULL))
+    {
+        atomic_fetch_sub (&storage->refs, 1);
+        return NULL;
+    }
+    clone->p_next = NULL;
+    return clone;
+}
+
+/**
+ * Makes the payload of a block writable: a shared block is replaced with a
+ * private copy, unless it is the last reference to its payload. Other
+ * blocks are returned as is.
+ *
+ * @return the writable block, or NULL on error (the block is released).
+ */
+block_t *block_Unshare (block_t *block)
+{
+    block_Check (block);
+    if (block->pf_release != block_shared_Release)
+        return block;
+
+    block_shared_t *sh = (block_shared_t *)block;
+    block_storage_t *storage = sh->storage;
+    block_t *owner;
+
+    if (atomic_load (&storage->refs) == 1)
+    {   /* Nobody else can see the payload: take it back */
+        owner = storage->block;
+        BlockMetaCopy (owner, block);
+        owner->p_buffer = block->p_buffer;
+        owner->i_buffer = block->i_buffer;
+        block_Invalidate (block);
+        free (sh);
+        free (storage);
+        return owner;
+    }
+
+    owner = block_Alloc (block->i_buffer);
+    if (likely(owner != NULL))
+    {
+        BlockMetaCopy (owner, block);
+        memcpy (owner->p_buffer, block->p_buffer, block->i_buffer);
+    }
+    block_Release (block);
+    return owner;
+}
+
 block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
 {
     size_t requested = i_prebody + i_body;
 
     block_Check( p_block );
 
+    /* Even the padding of a shared payload must not be written to */
+    p_block = block_Unshare( p_block );
+    if( p_block == NULL )
+        return NULL;
+
     /* Corner case: empty block requested */
     if( i_prebody <= 0 && i_body <= (size_t)(-i_prebody) )
     {
@@ -520,9 +921,20 @@ struct block_fifo_t
     size_t              i_depth;
     size_t              i_size;
     bool          b_force_wake;
+
+    /* Single producer, single consumer mode. In that mode, p_first and
+     * pp_last are owned by the consumer, and the lock is only taken when
+     * either side actually needs to sleep. */
+    bool                b_spsc;
+    atomic_uintptr_t    pending; /**< LIFO of blocks queued by the producer */
+    atomic_size_t       depth;
+    atomic_size_t       size;
+    atomic_bool         sleeping; /**< Consumer waits on wait */
+    atomic_bool         pacing;   /**< Producer waits on wait_room */
+    atomic_bool         force_wake;
 };
 
-block_fifo_t *block_FifoNew( void )
+static block_fifo_t *FifoNew( bool spsc )
 {
     block_fifo_t *p_fifo = malloc( sizeof( block_fifo_t ) );
     if( !p_fifo )
@@ -536,9 +948,92 @@ block_fifo_t *block_FifoNew( void )
     p_fifo->i_depth = p_fifo->i_size = 0;
     p_fifo->b_force_wake = false;
 
+    p_fifo->b_spsc = spsc;
+    atomic_init( &p_fifo->pending, 0 );
+    atomic_init( &p_fifo->depth, 0 );
+    atomic_init( &p_fifo->size, 0 );
+    atomic_init( &p_fifo->sleeping, false );
+    atomic_init( &p_fifo->pacing, false );
+    atomic_init( &p_fifo->force_wake, false );
+
     return p_fifo;
 }
 
+block_fifo_t *block_FifoNew( void )
+{
+    return FifoNew( false );
+}
+
+/**
+ * Creates a block FIFO for exactly one producer and one consumer thread.
+ *
+ * Queuing and dequeuing do not take any lock unless the consumer has to wait
+ * for data, or the producer has to wait for room in block_FifoPace().
+ *
+ * @warning block_FifoGet(), block_FifoShow() and block_FifoEmpty() must only
+ * be called from the consumer thread. block_FifoPut() and block_FifoPace()
+ * must only be called from the producer thread.
+ */
+block_fifo_t *block_FifoNewSPSC( void )
+{
+    return FifoNew( true );
+}
+
+/**
+ * Moves the blocks queued by the producer to the consumer list (SPSC mode).
+ * @return whether the consumer list is not empty
+ */
+static bool FifoFetch( block_fifo_t *fifo )
+{
+    block_t *b = (block_t *)atomic_exchange( &fifo->pending, 0 );
+
+    if( b != NULL )
+    {
+        /* The pending list is in reverse order */
+        block_t *last = b, *prev = NULL;
+
+        while( b != NULL )
+        {
+            block_t *next = b->p_next;
+
+            b->p_next = prev;
+            prev = b;
+            b = next;
+        }
+
+        *fifo->pp_last = prev;
+        fifo->pp_last = &last->p_next;
+    }
+    return fifo->p_first != NULL;
+}
+
+/** Wakes the producer up if it waits for room (SPSC mode). */
+static void FifoWakeRoom( block_fifo_t *fifo )
+{
+    if( atomic_load( &fifo->pacing ) )
+    {
+        vlc_mutex_lock( &fifo->lock );
+        vlc_cond_broadcast( &fifo->wait_room );
+        vlc_mutex_unlock( &fifo->lock );
+    }
+}
+
+/** Waits until the consumer list is not empty or the FIFO is woken up. */
+static void FifoWaitData( block_fifo_t *fifo )
+{
+    if( FifoFetch( fifo ) )
+        return;
+
+    vlc_mutex_lock( &fifo->lock );
+    mutex_cleanup_push( &fifo->lock );
+    atomic_store( &fifo->sleeping, true );
+    while( !FifoFetch( fifo ) && !atomic_load( &fifo->force_wake ) )
+        vlc_cond_wait( &fifo->wait, &fifo->lock );
+    atomic_store( &fifo->sleeping, false );
+    vlc_cleanup_pop();
+    vlc_mutex_unlock( &fifo->lock );
+}
+
 void block_FifoRelease( block_fifo_t *p_fifo )
 {
     block_FifoEmpty( p_fifo );
@@ -552,6 +1047,31 @@ void block_FifoEmpty( block_fifo_t *p_fifo )
 {
     block_t *block;
 
+    if( p_fifo->b_spsc )
+    {
+        size_t i_depth = 0, i_size = 0;
+
+        FifoFetch( p_fifo );
+        block = p_fifo->p_first;
+        p_fifo->p_first = NULL;
+        p_fifo->pp_last = &p_fifo->p_first;
+
+        while( block != NULL )
+        {
+            block_t *buf = block->p_next;
+
+            i_depth++;
+            i_size += block->i_buffer;
+            block_Release( block );
+            block = buf;
+        }
+
+        atomic_fetch_sub( &p_fifo->depth, i_depth );
+        atomic_fetch_sub( &p_fifo->size, i_size );
+        FifoWakeRoom( p_fifo );
+        return;
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     block = p_fifo->p_first;
     if (block != NULL)
@@ -594,6 +1114,24 @@ void block_FifoPace (block_fifo_t *fifo, size_t max_depth, size_t max_size)
 {
     vlc_testcancel ();
 
+    if (fifo->b_spsc)
+    {
+        if (atomic_load (&fifo->depth) <= max_depth
+         && atomic_load (&fifo->size) <= max_size)
+            return;
+
+        vlc_mutex_lock (&fifo->lock);
+        mutex_cleanup_push (&fifo->lock);
+        atomic_store (&fifo->pacing, true);
+        while (atomic_load (&fifo->depth) > max_depth
+            || atomic_load (&fifo->size) > max_size)
+            vlc_cond_wait (&fifo->wait_room, &fifo->lock);
+        atomic_store (&fifo->pacing, false);
+        vlc_cleanup_pop ();
+        vlc_mutex_unlock (&fifo->lock);
+        return;
+    }
+
     vlc_mutex_lock (&fifo->lock);
     while ((fifo->i_depth > max_depth) || (fifo->i_size > max_size))
     {
@@ -625,6 +1163,40 @@ size_t block_FifoPut( block_fifo_t *p_fifo, block_t *p_block )
             break;
     }
 
+    if (p_fifo->b_spsc)
+    {
+        /* Reverse the chain and push it onto the pending LIFO at once */
+        block_t *first = p_block, *prev = NULL;
+
+        while (p_block != NULL)
+        {
+            block_t *next = p_block->p_next;
+
+            p_block->p_next = prev;
+            prev = p_block;
+            p_block = next;
+        }
+
+        /* Account for the blocks before the consumer can dequeue them */
+        atomic_fetch_add (&p_fifo->depth, i_depth);
+        atomic_fetch_add (&p_fifo->size, i_size);
+
+        uintptr_t head = atomic_load_explicit (&p_fifo->pending,
+                                               memory_order_relaxed);
+        do
+            first->p_next = (block_t *)head;
+        while (!atomic_compare_exchange_weak (&p_fifo->pending, &head,
+                                              (uintptr_t)prev));
+
+        if (atomic_load (&p_fifo->sleeping))
+        {
+            vlc_mutex_lock (&p_fifo->lock);
+            vlc_cond_signal (&p_fifo->wait);
+            vlc_mutex_unlock (&p_fifo->lock);
+        }
+        return i_size;
+    }
+
     vlc_mutex_lock (&p_fifo->lock);
     *p_fifo->pp_last = p_block;
     p_fifo->pp_last = &p_last->p_next;
@@ -640,6 +1212,10 @@ size_t block_FifoPut( block_fifo_t *p_fifo, block_t *p_block )
 void block_FifoWake( block_fifo_t *p_fifo )
 {
     vlc_mutex_lock( &p_fifo->lock );
+    if( p_fifo->b_spsc )
+        /* Consumed if there is data anyway, as in block_FifoGet() */
+        atomic_store( &p_fifo->force_wake, true );
+    else
     if( p_fifo->p_first == NULL )
         p_fifo->b_force_wake = true;
     vlc_cond_broadcast( &p_fifo->wait );
@@ -658,6 +1234,29 @@ block_t *block_FifoGet( block_fifo_t *p_fifo )
 
     vlc_testcancel( );
 
+    if( p_fifo->b_spsc )
+    {
+        FifoWaitData( p_fifo );
+
+        if( atomic_load_explicit( &p_fifo->force_wake, memory_order_relaxed ) )
+            atomic_store( &p_fifo->force_wake, false );
+
+        b = p_fifo->p_first;
+        if( b == NULL )
+            return NULL; /* Forced wakeup */
+
+        p_fifo->p_first = b->p_next;
+        if( p_fifo->p_first == NULL )
+            p_fifo->pp_last = &p_fifo->p_first;
+
+        atomic_fetch_sub( &p_fifo->depth, 1 );
+        atomic_fetch_sub( &p_fifo->size, b->i_buffer );
+        FifoWakeRoom( p_fifo );
+
+        b->p_next = NULL;
+        return b;
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     mutex_cleanup_push( &p_fifo->lock );
 
@@ -711,6 +1310,16 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
 
     vlc_testcancel( );
 
+    if( p_fifo->b_spsc )
+    {
+        while( !FifoFetch( p_fifo ) )
+        {
+            FifoWaitData( p_fifo );
+            atomic_store( &p_fifo->force_wake, false );
+        }
+        return p_fifo->p_first;
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     mutex_cleanup_push( &p_fifo->lock );
 
@@ -728,6 +1337,9 @@ size_t block_FifoSize (block_fifo_t *fifo)
 {
     size_t size;
 
+    if (fifo->b_spsc)
+        return atomic_load (&fifo->size);
+
     vlc_mutex_lock (&fifo->lock);
     size = fifo->i_size;
     vlc_mutex_unlock (&fifo->lock);
@@ -739,6 +1351,9 @@ size_t block_FifoCount (block_fifo_t *fifo)
 {
     size_t depth;
 
+    if (fifo->b_spsc)
+        return atomic_load (&fifo->depth);
+
     vlc_mutex_lock (&fifo->lock);
     depth = fifo->i_depth;
     vlc_mutex_unlock (&fifo->lock);
@@ -440,6 +440,7 @@ void es_format_Init( es_format_t *fmt,
 
     memset( &fmt->audio, 0, sizeof(audio_format_t) );
     memset( &fmt->audio_replay_gain, 0, sizeof(audio_replay_gain_t) );
+    memset( &fmt->audio_gapless, 0, sizeof(audio_gapless_t) );
     memset( &fmt->video, 0, sizeof(video_format_t) );
     memset( &fmt->subs, 0, sizeof(subs_format_t) );
 
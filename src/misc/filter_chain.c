@@ -39,8 +39,18 @@ typedef struct chained_filter_t
     struct chained_filter_t *prev, *next;
     vlc_mouse_t *mouse;
     picture_t *pending;
+
+    /* Pipelined execution */
+    vlc_mutex_t lock; /**< Serializes the filter callbacks */
+    vlc_thread_t thread;
+    picture_t *queue; /**< Input pictures, oldest first */
+    unsigned queue_length;
+    bool busy; /**< The worker thread holds pictures */
 } chained_filter_t;
 
+/* Maximum number of pictures waiting between two pipelined filters */
+#define FILTER_CHAIN_QUEUE_LENGTH 2
+
 /* Only use this with filter objects from _this_ C module */
 static inline chained_filter_t *chained (filter_t *filter)
 {
@@ -59,6 +69,16 @@ struct filter_chain_t
     es_format_t fmt_out; /**< Chain current output format */
     unsigned length; /**< Number of filters */
     bool b_allow_fmt_out_change; /**< Can the output format be changed? */
+
+    /* Pipelined execution: all the filters but the last one run on their
+     * own thread, the last one runs on the calling thread (as it usually
+     * allocates its pictures from the owner). */
+    bool pipelined; /**< Pipelined execution requested */
+    unsigned workers; /**< Number of running worker threads */
+    bool closing;
+    unsigned generation; /**< Incremented on flush */
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
     char psz_capability[1]; /**< Module capability for all chained filters */
 };
 
@@ -66,6 +86,7 @@ struct filter_chain_t
  * Local prototypes
  */
 static void FilterDeletePictures( picture_t * );
+static void FilterChainPipelineStop( filter_chain_t * );
 
 static filter_chain_t *filter_chain_NewInner( const filter_owner_t *callbacks,
     const char *cap, bool fmt_out_change, const filter_owner_t *owner )
@@ -86,6 +107,12 @@ static filter_chain_t *filter_chain_NewInner( const filter_owner_t *callbacks,
     es_format_Init( &chain->fmt_out, UNKNOWN_ES, 0 );
     chain->length = 0;
     chain->b_allow_fmt_out_change = fmt_out_change;
+    chain->pipelined = false;
+    chain->workers = 0;
+    chain->closing = false;
+    chain->generation = 0;
+    vlc_mutex_init( &chain->lock );
+    vlc_cond_init( &chain->wait );
     strcpy( chain->psz_capability, cap );
 
     return chain;
@@ -153,8 +180,17 @@ void filter_chain_Delete( filter_chain_t *p_chain )
     es_format_Clean( &p_chain->fmt_in );
     es_format_Clean( &p_chain->fmt_out );
 
+    vlc_cond_destroy( &p_chain->wait );
+    vlc_mutex_destroy( &p_chain->lock );
     free( p_chain );
 }
+
+void filter_chain_SetPipelined( filter_chain_t *chain, bool pipelined )
+{
+    if( !pipelined )
+        FilterChainPipelineStop( chain );
+    chain->pipelined = pipelined;
+}
 /**
  * Filter chain reinitialisation
  */
@@ -189,6 +225,9 @@ filter_t *filter_chain_AppendFilter( filter_chain_t *chain, const char *name,
 
     filter_t *filter = &chained->filter;
 
+    /* The previous last filter will run on a worker thread */
+    FilterChainPipelineStop( chain );
+
     if( fmt_in == NULL )
     {
         if( chain->last != NULL )
@@ -236,6 +275,10 @@ filter_t *filter_chain_AppendFilter( filter_chain_t *chain, const char *name,
         vlc_mouse_Init( mouse );
     chained->mouse = mouse;
     chained->pending = NULL;
+    vlc_mutex_init( &chained->lock );
+    chained->queue = NULL;
+    chained->queue_length = 0;
+    chained->busy = false;
 
     msg_Dbg( parent, "Filter '%s' (%p) appended to chain",
              (name != NULL) ? name : module_get_name(filter->p_module, false),
@@ -259,6 +302,8 @@ void filter_chain_DeleteFilter( filter_chain_t *chain, filter_t *filter )
     vlc_object_t *obj = chain->callbacks.sys;
     chained_filter_t *chained = (chained_filter_t *)filter;
 
+    FilterChainPipelineStop( chain );
+
     /* Remove it from the chain */
     if( chained->prev != NULL )
         chained->prev->next = chained->next;
@@ -283,6 +328,7 @@ void filter_chain_DeleteFilter( filter_chain_t *chain, filter_t *filter )
 
     msg_Dbg( obj, "Filter %p removed from chain", filter );
     FilterDeletePictures( chained->pending );
+    vlc_mutex_destroy( &chained->lock );
 
     free( chained->mouse );
     es_format_Clean( &filter->fmt_out );
@@ -385,8 +431,219 @@ static picture_t *FilterChainVideoFilter( chained_filter_t *f, picture_t *p_pic
     return p_pic;
 }
 
+/* Pipelined execution */
+static void FilterQueuePush( chained_filter_t *f, picture_t *pic )
+{
+    picture_t **pp = &f->queue;
+
+    while( *pp != NULL )
+        pp = &(*pp)->p_next;
+    *pp = pic;
+    f->queue_length++;
+}
+
+static picture_t *FilterQueuePop( chained_filter_t *f )
+{
+    picture_t *pic = f->queue;
+
+    f->queue = pic->p_next;
+    f->queue_length--;
+    pic->p_next = NULL;
+    return pic;
+}
+
+static void FilterQueueFlush( chained_filter_t *f )
+{
+    FilterDeletePictures( f->queue );
+    f->queue = NULL;
+    f->queue_length = 0;
+}
+
+static void *FilterChainWorker( void *data )
+{
+    chained_filter_t *f = data;
+    filter_chain_t *chain = f->filter.owner.sys;
+    filter_t *p_filter = &f->filter;
+
+    vlc_mutex_lock( &chain->lock );
+    for( ;; )
+    {
+        while( !chain->closing && f->queue == NULL )
+            vlc_cond_wait( &chain->wait, &chain->lock );
+        if( chain->closing )
+            break;
+
+        picture_t *pic = FilterQueuePop( f );
+        const unsigned generation = chain->generation;
+        f->busy = true;
+        vlc_mutex_unlock( &chain->lock );
+
+        vlc_mutex_lock( &f->lock );
+        pic = p_filter->pf_video_filter( p_filter, pic );
+        vlc_mutex_unlock( &f->lock );
+
+        vlc_mutex_lock( &chain->lock );
+        /* Forward every output picture, in order, to the next filter */
+        while( pic != NULL )
+        {
+            picture_t *next = pic->p_next;
+            pic->p_next = NULL;
+
+            while( !chain->closing && chain->generation == generation
+                && f->next->queue_length >= FILTER_CHAIN_QUEUE_LENGTH )
+                vlc_cond_wait( &chain->wait, &chain->lock );
+
+            if( chain->closing || chain->generation != generation )
+            {   /* Flushed meanwhile */
+                picture_Release( pic );
+                FilterDeletePictures( next );
+                break;
+            }
+            FilterQueuePush( f->next, pic );
+            vlc_cond_broadcast( &chain->wait );
+            pic = next;
+        }
+        f->busy = false;
+        vlc_cond_broadcast( &chain->wait );
+    }
+    vlc_mutex_unlock( &chain->lock );
+    return NULL;
+}
+
+static void FilterChainPipelineStop( filter_chain_t *chain )
+{
+    if( chain->workers == 0 )
+        return;
+
+    vlc_mutex_lock( &chain->lock );
+    chain->closing = true;
+    vlc_cond_broadcast( &chain->wait );
+    vlc_mutex_unlock( &chain->lock );
+
+    chained_filter_t *f = chain->first;
+    for( unsigned i = 0; i < chain->workers; i++, f = f->next )
+        vlc_join( f->thread, NULL );
+    chain->workers = 0;
+    chain->closing = false;
+
+    for( f = chain->first; f != NULL; f = f->next )
+        FilterQueueFlush( f );
+}
+
+static int FilterChainPipelineStart( filter_chain_t *chain )
+{
+    assert( chain->workers == 0 );
+
+    for( chained_filter_t *f = chain->first; f != chain->last; f = f->next )
+    {
+        FilterDeletePictures( f->pending );
+        f->pending = NULL;
+
+        if( vlc_clone( &f->thread, FilterChainWorker, f,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            FilterChainPipelineStop( chain );
+            return VLC_EGENERIC;
+        }
+        chain->workers++;
+    }
+    return VLC_SUCCESS;
+}
+
+/* Number of pictures held by the pipeline, the last filter excepted */
+static unsigned FilterChainPipelineCount( filter_chain_t *chain )
+{
+    unsigned count = 0;
+
+    for( chained_filter_t *f = chain->first; f != NULL; f = f->next )
+        count += f->queue_length + f->busy;
+    return count;
+}
+
+static picture_t *FilterChainPipelineFilter( filter_chain_t *chain,
+                                             picture_t *p_pic )
+{
+    chained_filter_t *last = chain->last;
+    filter_t *p_filter = &last->filter;
+    /* Enough pictures to keep every worker busy */
+    const unsigned depth = 2 * chain->workers;
+
+    vlc_mutex_lock( &chain->lock );
+    if( p_pic != NULL )
+    {
+        FilterQueuePush( chain->first, p_pic );
+        vlc_cond_broadcast( &chain->wait );
+    }
+
+    picture_t *pic;
+    for( ;; )
+    {
+        pic = last->pending;
+        if( pic != NULL )
+        {
+            last->pending = pic->p_next;
+            pic->p_next = NULL;
+            break;
+        }
+
+        if( last->queue != NULL )
+        {   /* Run the last filter on the calling thread */
+            pic = FilterQueuePop( last );
+            vlc_cond_broadcast( &chain->wait );
+            vlc_mutex_unlock( &chain->lock );
+
+            vlc_mutex_lock( &last->lock );
+            pic = p_filter->pf_video_filter( p_filter, pic );
+            vlc_mutex_unlock( &last->lock );
+
+            vlc_mutex_lock( &chain->lock );
+            if( pic != NULL )
+            {
+                last->pending = pic->p_next;
+                pic->p_next = NULL;
+                break;
+            }
+            continue;
+        }
+
+        /* Wait for the next picture only if the caller has no more input or
+         * the pipeline is full; always wait to drain it at the end. */
+        const unsigned count = FilterChainPipelineCount( chain );
+        if( count == 0 || (p_pic != NULL && count < depth) )
+            break;
+        vlc_cond_wait( &chain->wait, &chain->lock );
+    }
+    vlc_mutex_unlock( &chain->lock );
+    return pic;
+}
+
+static void FilterChainPipelineFlush( filter_chain_t *chain )
+{
+    vlc_mutex_lock( &chain->lock );
+    chain->generation++;
+    for( chained_filter_t *f = chain->first; f != NULL; f = f->next )
+        FilterQueueFlush( f );
+    vlc_cond_broadcast( &chain->wait );
+
+    /* Wait for the workers to drop the pictures being processed */
+    for( chained_filter_t *f = chain->first; f != NULL; f = f->next )
+        while( f->busy )
+            vlc_cond_wait( &chain->wait, &chain->lock );
+    vlc_mutex_unlock( &chain->lock );
+}
+
 picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
 {
+    if( p_chain->pipelined && p_chain->length >= 2 )
+    {
+        if( p_chain->workers > 0 || !FilterChainPipelineStart( p_chain ) )
+            return FilterChainPipelineFilter( p_chain, p_pic );
+
+        vlc_object_t *obj = p_chain->callbacks.sys;
+        msg_Warn( obj, "cannot run the filters in parallel" );
+        p_chain->pipelined = false;
+    }
+
     if( p_pic )
     {
         p_pic = FilterChainVideoFilter( p_chain->first, p_pic );
@@ -410,6 +667,10 @@ picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
 
 void filter_chain_VideoFlush( filter_chain_t *p_chain )
 {
+    /* The workers are idle once the pipeline is flushed */
+    if( p_chain->workers > 0 )
+        FilterChainPipelineFlush( p_chain );
+
     for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
@@ -417,7 +678,9 @@ void filter_chain_VideoFlush( filter_chain_t *p_chain )
         FilterDeletePictures( f->pending );
         f->pending = NULL;
 
+        vlc_mutex_lock( &f->lock );
         filter_FlushPictures( p_filter );
+        vlc_mutex_unlock( &f->lock );
     }
 }
 
@@ -476,7 +739,11 @@ int filter_chain_MouseFilter( filter_chain_t *p_chain, vlc_mouse_t *p_dst, const
             vlc_mouse_t filtered;
 
             *p_mouse = current;
-            if( p_filter->pf_video_mouse( p_filter, &filtered, &old, &current ) )
+            vlc_mutex_lock( &f->lock );
+            int ret = p_filter->pf_video_mouse( p_filter, &filtered, &old,
+                                                &current );
+            vlc_mutex_unlock( &f->lock );
+            if( ret )
                 return VLC_EGENERIC;
             current = filtered;
         }
@@ -31,6 +31,7 @@
 #include <vlc_common.h>
 #include <vlc_fourcc.h>
 #include <vlc_es.h>
+#include <vlc_atomic.h>
 #include <assert.h>
 
 
@@ -1598,39 +1599,108 @@ static inline vlc_fourcc_t CreateFourcc( const char *psz_fourcc )
                        psz_fourcc[2], psz_fourcc[3] );
 }
 
-/* */
-static entry_t Lookup( const staticentry_t p_list[], vlc_fourcc_t i_fourcc )
+/* The lists are indexed by fourcc on first use, so that the lookups are
+ * binary searches rather than scans of the (long) lists. */
+typedef struct
 {
-    const char *p_class = NULL;
-    const char *psz_description = NULL;
+    vlc_fourcc_t i_fourcc;
+    uint16_t     i_class;       /* entry of the class */
+    uint16_t     i_description; /* entry of the description */
+} lookup_t;
 
-    entry_t e = B(0, "");
+#define LIST_SIZE(list) (sizeof(list) / sizeof(*(list)))
+
+static lookup_t p_lookup_video[LIST_SIZE(p_list_video)];
+static lookup_t p_lookup_audio[LIST_SIZE(p_list_audio)];
+static lookup_t p_lookup_spu[LIST_SIZE(p_list_spu)];
+static size_t i_lookup_video, i_lookup_audio, i_lookup_spu;
+
+static int LookupCmp( const void *a, const void *b )
+{
+    const lookup_t *p_a = a, *p_b = b;
+
+    if( p_a->i_fourcc != p_b->i_fourcc )
+        return p_a->i_fourcc < p_b->i_fourcc ? -1 : 1;
+    /* the first entry of a fourcc wins, as with a scan of the list */
+    return (int)p_a->i_description - (int)p_b->i_description;
+}
+
+static size_t LookupInit( lookup_t *p_lookup, const staticentry_t p_list[] )
+{
+    size_t i_count = 0;
+    uint16_t i_class = 0;
 
-    for( int i = 0; ; i++ )
+    for( uint16_t i = 0; CreateFourcc( p_list[i].p_fourcc ) != 0; i++ )
     {
         const staticentry_t *p = &p_list[i];
-        const vlc_fourcc_t i_entry_fourcc = CreateFourcc( p->p_fourcc );
-        const vlc_fourcc_t i_entry_class = CreateFourcc( p->p_class );
 
-        if( i_entry_fourcc == 0 )
-            break;
+        if( CreateFourcc( p->p_class ) != 0 )
+            i_class = i;
 
-        if( i_entry_class != 0 )
-        {
-            p_class = p->p_class;
-            psz_description = p->psz_description;
-        }
+        p_lookup[i_count].i_fourcc = CreateFourcc( p->p_fourcc );
+        p_lookup[i_count].i_class = i_class;
+        p_lookup[i_count].i_description = i;
+        i_count++;
+    }
 
-        if( i_entry_fourcc == i_fourcc )
-        {
-            assert( p_class != NULL );
+    qsort( p_lookup, i_count, sizeof(*p_lookup), LookupCmp );
 
-            memcpy( e.p_class, p_class, 4 );
-            memcpy( e.p_fourcc, p->p_fourcc, 4 );
-            e.psz_description = p->psz_description[0] != '\0' ?
-                                p->psz_description : psz_description;
-            break;
-        }
+    /* Keep the first entry of each fourcc */
+    size_t i_unique = 0;
+    for( size_t i = 0; i < i_count; i++ )
+        if( i_unique == 0 || p_lookup[i_unique - 1].i_fourcc != p_lookup[i].i_fourcc )
+            p_lookup[i_unique++] = p_lookup[i];
+
+    /* the entries without description use the one of their class */
+    for( size_t i = 0; i < i_unique; i++ )
+        if( p_list[p_lookup[i].i_description].psz_description[0] == '\0' )
+            p_lookup[i].i_description = p_lookup[i].i_class;
+
+    return i_unique;
+}
+
+static void LookupInitAll( void )
+{
+    static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+    static atomic_bool b_init = ATOMIC_VAR_INIT( false );
+
+    if( atomic_load_explicit( &b_init, memory_order_acquire ) )
+        return;
+
+    vlc_mutex_lock( &lock );
+    if( !atomic_load_explicit( &b_init, memory_order_relaxed ) )
+    {
+        i_lookup_video = LookupInit( p_lookup_video, p_list_video );
+        i_lookup_audio = LookupInit( p_lookup_audio, p_list_audio );
+        i_lookup_spu = LookupInit( p_lookup_spu, p_list_spu );
+        atomic_store_explicit( &b_init, true, memory_order_release );
+    }
+    vlc_mutex_unlock( &lock );
+}
+
+/* */
+static entry_t Lookup( const staticentry_t p_list[], const lookup_t *p_lookup,
+                       size_t i_count, vlc_fourcc_t i_fourcc )
+{
+    entry_t e = B(0, "");
+    size_t i_low = 0, i_high = i_count;
+
+    while( i_low < i_high )
+    {
+        size_t i_mid = ( i_low + i_high ) / 2;
+
+        if( p_lookup[i_mid].i_fourcc < i_fourcc )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+
+    if( i_low < i_count && p_lookup[i_low].i_fourcc == i_fourcc )
+    {
+        const lookup_t *p = &p_lookup[i_low];
+
+        memcpy( e.p_class, p_list[p->i_class].p_class, 4 );
+        e.psz_description = p_list[p->i_description].psz_description;
     }
     return e;
 }
@@ -1640,14 +1710,16 @@ static entry_t Find( int i_cat, vlc_fourcc_t i_fourcc )
 {
     entry_t e;
 
+    LookupInitAll();
+
     switch( i_cat )
     {
     case VIDEO_ES:
-        return Lookup( p_list_video, i_fourcc );
+        return Lookup( p_list_video, p_lookup_video, i_lookup_video, i_fourcc );
     case AUDIO_ES:
-        return Lookup( p_list_audio, i_fourcc );
+        return Lookup( p_list_audio, p_lookup_audio, i_lookup_audio, i_fourcc );
     case SPU_ES:
-        return Lookup( p_list_spu, i_fourcc );
+        return Lookup( p_list_spu, p_lookup_spu, i_lookup_spu, i_fourcc );
 
     default:
         e = Find( VIDEO_ES, i_fourcc );
@@ -1982,6 +2054,8 @@ static const vlc_fourcc_t p_list_YUV[] = {
     VLC_CODEC_VDPAU_VIDEO_420,
     VLC_CODEC_VDPAU_VIDEO_422,
     VLC_CODEC_VDPAU_VIDEO_444,
+    VLC_CODEC_VAAPI_420,
+    VLC_CODEC_D3D9_OPAQUE,
     0,
 };
 
@@ -2174,7 +2248,8 @@ static const struct
     { { VLC_CODEC_VDPAU_VIDEO_420, VLC_CODEC_VDPAU_VIDEO_422,
         VLC_CODEC_VDPAU_VIDEO_444, VLC_CODEC_VDPAU_OUTPUT },
                                                FAKE_FMT() },
-    { { VLC_CODEC_ANDROID_OPAQUE, VLC_CODEC_MMAL_OPAQUE, },
+    { { VLC_CODEC_ANDROID_OPAQUE, VLC_CODEC_MMAL_OPAQUE,
+        VLC_CODEC_VAAPI_420, VLC_CODEC_D3D9_OPAQUE, },
                                                FAKE_FMT() },
 
     { { 0 },                                   FAKE_FMT() }
@@ -60,11 +60,14 @@ static int ImageWriteUrl( image_handler_t *, picture_t *,
 static picture_t *ImageConvert( image_handler_t *, picture_t *,
                                 video_format_t *, video_format_t * );
 
+static decoder_t *GetDecoder( image_handler_t *, video_format_t * );
 static decoder_t *CreateDecoder( vlc_object_t *, video_format_t * );
 static void DeleteDecoder( decoder_t * );
 static encoder_t *CreateEncoder( vlc_object_t *, video_format_t *,
                                  video_format_t * );
 static void DeleteEncoder( encoder_t * );
+static filter_t *GetFilter( image_handler_t *, es_format_t *,
+                            video_format_t * );
 static filter_t *CreateFilter( vlc_object_t *, es_format_t *,
                                video_format_t * );
 static void DeleteFilter( filter_t * );
@@ -103,9 +106,12 @@ void image_HandlerDelete( image_handler_t *p_image )
 {
     if( !p_image ) return;
 
-    if( p_image->p_dec ) DeleteDecoder( p_image->p_dec );
+    for( unsigned i = 0; i < IMAGE_HANDLER_CACHE; i++ )
+    {
+        if( p_image->pp_dec[i] ) DeleteDecoder( p_image->pp_dec[i] );
+        if( p_image->pp_filter[i] ) DeleteFilter( p_image->pp_filter[i] );
+    }
     if( p_image->p_enc ) DeleteEncoder( p_image->p_enc );
-    if( p_image->p_filter ) DeleteFilter( p_image->p_filter );
 
     free( p_image );
     p_image = NULL;
@@ -122,24 +128,20 @@ static picture_t *ImageRead( image_handler_t *p_image, block_t *p_block,
 {
     picture_t *p_pic = NULL, *p_tmp;
 
-    /* Check if we can reuse the current decoder */
-    if( p_image->p_dec &&
-        p_image->p_dec->fmt_in.i_codec != p_fmt_in->i_chroma )
+    decoder_t *p_dec = GetDecoder( p_image, p_fmt_in );
+    if( !p_dec )
     {
-        DeleteDecoder( p_image->p_dec );
-        p_image->p_dec = 0;
+        block_Release( p_block );
+        return NULL;
     }
 
-    /* Start a decoder */
-    if( !p_image->p_dec )
-    {
-        p_image->p_dec = CreateDecoder( p_image->p_parent, p_fmt_in );
-        if( !p_image->p_dec ) return NULL;
-    }
+    /* The decoder may scale the picture down to the requested size on
+     * the fly (JPEG) */
+    p_dec->fmt_out.video.i_width = p_fmt_out->i_width;
+    p_dec->fmt_out.video.i_height = p_fmt_out->i_height;
 
     p_block->i_pts = p_block->i_dts = mdate();
-    while( (p_tmp = p_image->p_dec->pf_decode_video( p_image->p_dec, &p_block ))
-             != NULL )
+    while( (p_tmp = p_dec->pf_decode_video( p_dec, &p_block )) != NULL )
     {
         if( p_pic != NULL )
             picture_Release( p_pic );
@@ -153,70 +155,45 @@ static picture_t *ImageRead( image_handler_t *p_image, block_t *p_block,
     }
 
     if( !p_fmt_out->i_chroma )
-        p_fmt_out->i_chroma = p_image->p_dec->fmt_out.video.i_chroma;
+        p_fmt_out->i_chroma = p_dec->fmt_out.video.i_chroma;
     if( !p_fmt_out->i_width && p_fmt_out->i_height )
-        p_fmt_out->i_width = (int64_t)p_image->p_dec->fmt_out.video.i_width *
-                             p_image->p_dec->fmt_out.video.i_sar_num *
+        p_fmt_out->i_width = (int64_t)p_dec->fmt_out.video.i_width *
+                             p_dec->fmt_out.video.i_sar_num *
                              p_fmt_out->i_height /
-                             p_image->p_dec->fmt_out.video.i_height /
-                             p_image->p_dec->fmt_out.video.i_sar_den;
+                             p_dec->fmt_out.video.i_height /
+                             p_dec->fmt_out.video.i_sar_den;
 
     if( !p_fmt_out->i_height && p_fmt_out->i_width )
-        p_fmt_out->i_height = (int64_t)p_image->p_dec->fmt_out.video.i_height *
-                              p_image->p_dec->fmt_out.video.i_sar_den *
+        p_fmt_out->i_height = (int64_t)p_dec->fmt_out.video.i_height *
+                              p_dec->fmt_out.video.i_sar_den *
                               p_fmt_out->i_width /
-                              p_image->p_dec->fmt_out.video.i_width /
-                              p_image->p_dec->fmt_out.video.i_sar_num;
+                              p_dec->fmt_out.video.i_width /
+                              p_dec->fmt_out.video.i_sar_num;
     if( !p_fmt_out->i_width )
-        p_fmt_out->i_width = p_image->p_dec->fmt_out.video.i_width;
+        p_fmt_out->i_width = p_dec->fmt_out.video.i_width;
     if( !p_fmt_out->i_height )
-        p_fmt_out->i_height = p_image->p_dec->fmt_out.video.i_height;
+        p_fmt_out->i_height = p_dec->fmt_out.video.i_height;
     if( !p_fmt_out->i_visible_width )
         p_fmt_out->i_visible_width = p_fmt_out->i_width;
     if( !p_fmt_out->i_visible_height )
         p_fmt_out->i_visible_height = p_fmt_out->i_height;
 
     /* Check if we need chroma conversion or resizing */
-    if( p_image->p_dec->fmt_out.video.i_chroma != p_fmt_out->i_chroma ||
-        p_image->p_dec->fmt_out.video.i_width != p_fmt_out->i_width ||
-        p_image->p_dec->fmt_out.video.i_height != p_fmt_out->i_height )
+    if( p_dec->fmt_out.video.i_chroma != p_fmt_out->i_chroma ||
+        p_dec->fmt_out.video.i_width != p_fmt_out->i_width ||
+        p_dec->fmt_out.video.i_height != p_fmt_out->i_height )
     {
-        if( p_image->p_filter )
-        if( p_image->p_filter->fmt_in.video.i_chroma !=
-            p_image->p_dec->fmt_out.video.i_chroma ||
-            p_image->p_filter->fmt_out.video.i_chroma != p_fmt_out->i_chroma )
+        filter_t *p_filter = GetFilter( p_image, &p_dec->fmt_out, p_fmt_out );
+        if( !p_filter )
         {
-            /* We need to restart a new filter */
-            DeleteFilter( p_image->p_filter );
-            p_image->p_filter = 0;
-        }
-
-        /* Start a filter */
-        if( !p_image->p_filter )
-        {
-            p_image->p_filter =
-                CreateFilter( p_image->p_parent, &p_image->p_dec->fmt_out,
-                              p_fmt_out );
-
-            if( !p_image->p_filter )
-            {
-                picture_Release( p_pic );
-                return NULL;
-            }
-        }
-        else
-        {
-            /* Filters should handle on-the-fly size changes */
-            p_image->p_filter->fmt_in = p_image->p_dec->fmt_out;
-            p_image->p_filter->fmt_out = p_image->p_dec->fmt_out;
-            p_image->p_filter->fmt_out.i_codec = p_fmt_out->i_chroma;
-            p_image->p_filter->fmt_out.video = *p_fmt_out;
+            picture_Release( p_pic );
+            return NULL;
         }
 
-        p_pic = p_image->p_filter->pf_video_filter( p_image->p_filter, p_pic );
-        *p_fmt_out = p_image->p_filter->fmt_out.video;
+        p_pic = p_filter->pf_video_filter( p_filter, p_pic );
+        *p_fmt_out = p_filter->fmt_out.video;
     }
-    else *p_fmt_out = p_image->p_dec->fmt_out.video;
+    else *p_fmt_out = p_dec->fmt_out.video;
 
     return p_pic;
 }
@@ -301,46 +278,19 @@ static block_t *ImageWrite( image_handler_t *p_image, picture_t *p_pic,
         p_image->p_enc->fmt_in.video.i_height != p_fmt_in->i_height )
     {
         picture_t *p_tmp_pic;
+        es_format_t fmt_in;
 
-        if( p_image->p_filter )
-        if( p_image->p_filter->fmt_in.video.i_chroma != p_fmt_in->i_chroma ||
-            p_image->p_filter->fmt_out.video.i_chroma !=
-            p_image->p_enc->fmt_in.video.i_chroma )
-        {
-            /* We need to restart a new filter */
-            DeleteFilter( p_image->p_filter );
-            p_image->p_filter = 0;
-        }
-
-        /* Start a filter */
-        if( !p_image->p_filter )
-        {
-            es_format_t fmt_in;
-            es_format_Init( &fmt_in, VIDEO_ES, p_fmt_in->i_chroma );
-            fmt_in.video = *p_fmt_in;
-
-            p_image->p_filter =
-                CreateFilter( p_image->p_parent, &fmt_in,
-                              &p_image->p_enc->fmt_in.video );
+        es_format_Init( &fmt_in, VIDEO_ES, p_fmt_in->i_chroma );
+        fmt_in.video = *p_fmt_in;
 
-            if( !p_image->p_filter )
-            {
-                return NULL;
-            }
-        }
-        else
-        {
-            /* Filters should handle on-the-fly size changes */
-            p_image->p_filter->fmt_in.i_codec = p_fmt_in->i_chroma;
-            p_image->p_filter->fmt_out.video = *p_fmt_in;
-            p_image->p_filter->fmt_out.i_codec =p_image->p_enc->fmt_in.i_codec;
-            p_image->p_filter->fmt_out.video = p_image->p_enc->fmt_in.video;
-        }
+        filter_t *p_filter = GetFilter( p_image, &fmt_in,
+                                        &p_image->p_enc->fmt_in.video );
+        if( !p_filter )
+            return NULL;
 
         picture_Hold( p_pic );
 
-        p_tmp_pic =
-            p_image->p_filter->pf_video_filter( p_image->p_filter, p_pic );
+        p_tmp_pic = p_filter->pf_video_filter( p_filter, p_pic );
 
         if( likely(p_tmp_pic != NULL) )
         {
@@ -440,40 +390,17 @@ static picture_t *ImageConvert( image_handler_t *p_image, picture_t *p_pic,
     if( !p_fmt_out->i_sar_num ) p_fmt_out->i_sar_num = p_fmt_in->i_sar_num;
     if( !p_fmt_out->i_sar_den ) p_fmt_out->i_sar_den = p_fmt_in->i_sar_den;
 
-    if( p_image->p_filter )
-    if( p_image->p_filter->fmt_in.video.i_chroma != p_fmt_in->i_chroma ||
-        p_image->p_filter->fmt_out.video.i_chroma != p_fmt_out->i_chroma )
-    {
-        /* We need to restart a new filter */
-        DeleteFilter( p_image->p_filter );
-        p_image->p_filter = NULL;
-    }
-
-    /* Start a filter */
-    if( !p_image->p_filter )
-    {
-        es_format_t fmt_in;
-        es_format_Init( &fmt_in, VIDEO_ES, p_fmt_in->i_chroma );
-        fmt_in.video = *p_fmt_in;
-
-        p_image->p_filter =
-            CreateFilter( p_image->p_parent, &fmt_in, p_fmt_out );
+    es_format_t fmt_in;
+    es_format_Init( &fmt_in, VIDEO_ES, p_fmt_in->i_chroma );
+    fmt_in.video = *p_fmt_in;
 
-        if( !p_image->p_filter )
-        {
-            return NULL;
-        }
-    }
-    else
-    {
-        /* Filters should handle on-the-fly size changes */
-        p_image->p_filter->fmt_in.video = *p_fmt_in;
-        p_image->p_filter->fmt_out.video = *p_fmt_out;
-    }
+    filter_t *p_filter = GetFilter( p_image, &fmt_in, p_fmt_out );
+    if( !p_filter )
+        return NULL;
 
     picture_Hold( p_pic );
 
-    p_pif = p_image->p_filter->pf_video_filter( p_image->p_filter, p_pic );
+    p_pif = p_filter->pf_video_filter( p_filter, p_pic );
 
     if( p_fmt_in->i_chroma == p_fmt_out->i_chroma &&
         p_fmt_in->i_width == p_fmt_out->i_width &&
@@ -481,7 +408,7 @@ static picture_t *ImageConvert( image_handler_t *p_image, picture_t *p_pic,
     {
         /* Duplicate image */
         picture_Release( p_pif ); /* XXX: Better fix must be possible */
-        p_pif = filter_NewPicture( p_image->p_filter );
+        p_pif = filter_NewPicture( p_filter );
         if( p_pif )
             picture_Copy( p_pif, p_pic );
     }
@@ -598,6 +525,37 @@ static picture_t *video_new_buffer( decoder_t *p_dec )
     return picture_NewFromFormat( &p_dec->fmt_out.video );
 }
 
+/**
+ * Gets a decoder for the format, reusing one of the last ones if possible
+ */
+static decoder_t *GetDecoder( image_handler_t *p_image, video_format_t *fmt )
+{
+    decoder_t **pp_dec = p_image->pp_dec;
+    decoder_t *p_dec;
+    unsigned i;
+
+    for( i = 0; i < IMAGE_HANDLER_CACHE && pp_dec[i] != NULL; i++ )
+        if( pp_dec[i]->fmt_in.i_codec == fmt->i_chroma )
+            break;
+
+    if( i == IMAGE_HANDLER_CACHE || pp_dec[i] == NULL )
+    {
+        p_dec = CreateDecoder( p_image->p_parent, fmt );
+        if( !p_dec )
+            return NULL;
+
+        /* Evict the least recently used one */
+        if( i == IMAGE_HANDLER_CACHE )
+            DeleteDecoder( pp_dec[--i] );
+    }
+    else
+        p_dec = pp_dec[i];
+
+    memmove( &pp_dec[1], &pp_dec[0], i * sizeof (*pp_dec) );
+    pp_dec[0] = p_dec;
+    return p_dec;
+}
+
 static decoder_t *CreateDecoder( vlc_object_t *p_this, video_format_t *fmt )
 {
     decoder_t *p_dec;
@@ -725,6 +683,48 @@ static void DeleteEncoder( encoder_t * p_enc )
     p_enc = NULL;
 }
 
+/**
+ * Gets a converter between the formats, reusing one of the last ones for the
+ * same chromas if possible
+ */
+static filter_t *GetFilter( image_handler_t *p_image, es_format_t *p_fmt_in,
+                            video_format_t *p_fmt_out )
+{
+    filter_t **pp_filter = p_image->pp_filter;
+    filter_t *p_filter;
+    unsigned i;
+
+    for( i = 0; i < IMAGE_HANDLER_CACHE && pp_filter[i] != NULL; i++ )
+        if( pp_filter[i]->fmt_in.video.i_chroma == p_fmt_in->video.i_chroma &&
+            pp_filter[i]->fmt_out.video.i_chroma == p_fmt_out->i_chroma )
+            break;
+
+    if( i == IMAGE_HANDLER_CACHE || pp_filter[i] == NULL )
+    {
+        p_filter = CreateFilter( p_image->p_parent, p_fmt_in, p_fmt_out );
+        if( !p_filter )
+            return NULL;
+
+        /* Evict the least recently used one */
+        if( i == IMAGE_HANDLER_CACHE )
+            DeleteFilter( pp_filter[--i] );
+    }
+    else
+    {
+        p_filter = pp_filter[i];
+
+        /* Filters should handle on-the-fly size changes */
+        p_filter->fmt_in = *p_fmt_in;
+        p_filter->fmt_out = *p_fmt_in;
+        p_filter->fmt_out.i_codec = p_fmt_out->i_chroma;
+        p_filter->fmt_out.video = *p_fmt_out;
+    }
+
+    memmove( &pp_filter[1], &pp_filter[0], i * sizeof (*pp_filter) );
+    pp_filter[0] = p_filter;
+    return p_filter;
+}
+
 static filter_t *CreateFilter( vlc_object_t *p_this, es_format_t *p_fmt_in,
                                video_format_t *p_fmt_out )
 {
@@ -0,0 +1,363 @@
+/*****************************************************************************
+ * interrupt.c: interruptible waits
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#ifdef HAVE_POLL
+# include <poll.h>
+#endif
+#ifndef _WIN32
+# include <unistd.h>
+#endif
+#ifdef HAVE_SYS_EVENTFD_H
+# include <sys/eventfd.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+#include <vlc_atomic.h>
+#include <vlc_interrupt.h>
+
+/*
+ * A wait registers a callback which wakes it up, then checks if it was
+ * interrupted once it has woken up. Raising the context calls the callback
+ * of the wait in progress, if any, or leaves the interruption pending for
+ * the next wait. A killed context interrupts all its waits.
+ */
+struct vlc_interrupt
+{
+    vlc_mutex_t lock;
+    bool        interrupted;
+    atomic_bool killed;
+    void      (*callback)(void *);
+    void       *data;
+};
+
+/* The key is created by the first vlc_interrupt_set(), and deleted never */
+static vlc_mutex_t key_lock = VLC_STATIC_MUTEX;
+static vlc_threadvar_t key;
+static atomic_bool key_created = ATOMIC_VAR_INIT(false);
+
+static vlc_interrupt_t *vlc_interrupt_get(void)
+{
+    if (!atomic_load_explicit(&key_created, memory_order_acquire))
+        return NULL;
+    return vlc_threadvar_get(key);
+}
+
+vlc_interrupt_t *vlc_interrupt_create(void)
+{
+    vlc_interrupt_t *ctx = malloc(sizeof (*ctx));
+    if (unlikely(ctx == NULL))
+        return NULL;
+
+    vlc_mutex_init(&ctx->lock);
+    ctx->interrupted = false;
+    atomic_init(&ctx->killed, false);
+    ctx->callback = NULL;
+    return ctx;
+}
+
+void vlc_interrupt_destroy(vlc_interrupt_t *ctx)
+{
+    assert(ctx->callback == NULL);
+    vlc_mutex_destroy(&ctx->lock);
+    free(ctx);
+}
+
+vlc_interrupt_t *vlc_interrupt_set(vlc_interrupt_t *ctx)
+{
+    if (!atomic_load_explicit(&key_created, memory_order_acquire))
+    {
+        vlc_mutex_lock(&key_lock);
+        if (!atomic_load_explicit(&key_created, memory_order_relaxed)
+         && vlc_threadvar_create(&key, NULL) == 0)
+            atomic_store_explicit(&key_created, true, memory_order_release);
+        vlc_mutex_unlock(&key_lock);
+
+        if (unlikely(!atomic_load(&key_created)))
+            return NULL;
+    }
+
+    vlc_interrupt_t *old = vlc_threadvar_get(key);
+    vlc_threadvar_set(key, ctx);
+    return old;
+}
+
+void vlc_interrupt_raise(vlc_interrupt_t *ctx)
+{
+    vlc_mutex_lock(&ctx->lock);
+    ctx->interrupted = true;
+    if (ctx->callback != NULL)
+        ctx->callback(ctx->data);
+    vlc_mutex_unlock(&ctx->lock);
+}
+
+void vlc_interrupt_kill(vlc_interrupt_t *ctx)
+{
+    atomic_store(&ctx->killed, true);
+    vlc_interrupt_raise(ctx);
+}
+
+bool vlc_killed(void)
+{
+    vlc_interrupt_t *ctx = vlc_interrupt_get();
+
+    return ctx != NULL && atomic_load(&ctx->killed);
+}
+
+void vlc_interrupt_forget(void)
+{
+    vlc_interrupt_t *ctx = vlc_interrupt_get();
+    if (ctx == NULL)
+        return;
+
+    vlc_mutex_lock(&ctx->lock);
+    ctx->interrupted = false;
+    vlc_mutex_unlock(&ctx->lock);
+}
+
+static void vlc_interrupt_prepare(vlc_interrupt_t *ctx,
+                                  void (*cb)(void *), void *data)
+{
+    vlc_mutex_lock(&ctx->lock);
+    assert(ctx->callback == NULL);
+    ctx->callback = cb;
+    ctx->data = data;
+    if (ctx->interrupted || atomic_load(&ctx->killed))
+        cb(data);
+    vlc_mutex_unlock(&ctx->lock);
+}
+
+/** Unregisters the callback, and consumes the interruption if any */
+static int vlc_interrupt_finish(vlc_interrupt_t *ctx)
+{
+    int ret = 0;
+
+    vlc_mutex_lock(&ctx->lock);
+    ctx->callback = NULL;
+    if (ctx->interrupted || atomic_load(&ctx->killed))
+        ret = EINTR;
+    ctx->interrupted = false;
+    vlc_mutex_unlock(&ctx->lock);
+    return ret;
+}
+
+static void vlc_interrupt_cleanup(void *opaque)
+{
+    vlc_interrupt_finish(opaque);
+}
+
+void vlc_interrupt_register(void (*cb)(void *), void *opaque)
+{
+    vlc_interrupt_t *ctx = vlc_interrupt_get();
+    if (ctx != NULL)
+        vlc_interrupt_prepare(ctx, cb, opaque);
+}
+
+int vlc_interrupt_unregister(void)
+{
+    vlc_interrupt_t *ctx = vlc_interrupt_get();
+    return (ctx != NULL) ? vlc_interrupt_finish(ctx) : 0;
+}
+
+/*** Semaphore ***/
+static void vlc_interrupt_sem(void *opaque)
+{
+    vlc_sem_post(opaque);
+}
+
+int vlc_sem_wait_i11e(vlc_sem_t *sem)
+{
+    vlc_interrupt_t *ctx = vlc_interrupt_get();
+    if (ctx == NULL)
+        return vlc_sem_wait(sem), 0;
+
+    /* If interrupted, the token consumed here is the one posted by the
+     * callback, or stands for it: the semaphore is unchanged. */
+    vlc_interrupt_prepare(ctx, vlc_interrupt_sem, sem);
+    vlc_cleanup_push(vlc_interrupt_cleanup, ctx);
+    vlc_sem_wait(sem);
+    vlc_cleanup_pop();
+    return vlc_interrupt_finish(ctx);
+}
+
+/*** Sleep ***/
+typedef struct
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    bool        woken;
+} vlc_interrupt_sleep_t;
+
+static void vlc_interrupt_wake(void *opaque)
+{
+    vlc_interrupt_sleep_t *s = opaque;
+
+    vlc_mutex_lock(&s->lock);
+    s->woken = true;
+    vlc_cond_signal(&s->wait);
+    vlc_mutex_unlock(&s->lock);
+}
+
+int vlc_mwait_i11e(mtime_t deadline)
+{
+    vlc_interrupt_t *ctx = vlc_interrupt_get();
+    if (ctx == NULL)
+        return mwait(deadline), 0;
+
+    vlc_interrupt_sleep_t s = { .woken = false };
+
+    vlc_mutex_init(&s.lock);
+    vlc_cond_init(&s.wait);
+
+    vlc_interrupt_prepare(ctx, vlc_interrupt_wake, &s);
+    vlc_cleanup_push(vlc_interrupt_cleanup, ctx);
+    vlc_mutex_lock(&s.lock);
+    mutex_cleanup_push(&s.lock);
+    while (!s.woken && vlc_cond_timedwait(&s.wait, &s.lock, deadline) == 0);
+    vlc_cleanup_pop();
+    vlc_mutex_unlock(&s.lock);
+    vlc_cleanup_pop();
+    int ret = vlc_interrupt_finish(ctx);
+
+    vlc_cond_destroy(&s.wait);
+    vlc_mutex_destroy(&s.lock);
+    return ret;
+}
+
+/*** Poll ***/
+#ifndef _WIN32
+static void vlc_poll_i11e_wake(void *opaque)
+{
+    int *fds = opaque;
+
+    write(fds[1], &(uint64_t){ 1 }, sizeof (uint64_t));
+}
+
+static void vlc_poll_i11e_cleanup(void *opaque)
+{
+    int *fds = opaque;
+
+    vlc_interrupt_finish(vlc_interrupt_get());
+    if (fds[1] != fds[0])
+        close(fds[1]);
+    close(fds[0]);
+}
+#endif
+
+/* Waits in slices, and checks the context in between. This is used when
+ * the descriptors cannot be polled along with a wake-up descriptor. */
+static int vlc_poll_i11e_slices(vlc_interrupt_t *ctx, struct pollfd *fds,
+                                unsigned nfds, int timeout)
+{
+    const int slice = 50; /* ms */
+
+    for (;;)
+    {
+        int delay = (timeout >= 0 && timeout < slice) ? timeout : slice;
+        int ret = poll(fds, nfds, delay);
+
+        vlc_mutex_lock(&ctx->lock);
+        bool interrupted = ctx->interrupted || atomic_load(&ctx->killed);
+        ctx->interrupted = false;
+        vlc_mutex_unlock(&ctx->lock);
+
+        if (interrupted)
+        {
+            errno = EINTR;
+            return -1;
+        }
+        if (ret != 0 || timeout == delay)
+            return ret;
+        if (timeout > 0)
+            timeout -= delay;
+    }
+}
+
+int vlc_poll_i11e(struct pollfd *fds, unsigned nfds, int timeout)
+{
+    vlc_interrupt_t *ctx = vlc_interrupt_get();
+    if (ctx == NULL)
+    {
+        int ret;
+
+        while ((ret = poll(fds, nfds, timeout)) == -1 && errno == EINTR
+            && timeout < 0);
+        return ret;
+    }
+
+#ifndef _WIN32
+    int wakefd[2];
+    int ret;
+
+# ifdef HAVE_SYS_EVENTFD_H
+    wakefd[0] = wakefd[1] = eventfd(0, EFD_CLOEXEC);
+    if (wakefd[0] == -1)
+# endif
+    if (vlc_pipe(wakefd))
+        return vlc_poll_i11e_slices(ctx, fds, nfds, timeout);
+
+    struct pollfd ufd[nfds + 1];
+
+    for (unsigned i = 0; i < nfds; i++)
+    {
+        ufd[i].fd = fds[i].fd;
+        ufd[i].events = fds[i].events;
+    }
+    ufd[nfds].fd = wakefd[0];
+    ufd[nfds].events = POLLIN;
+
+    vlc_interrupt_prepare(ctx, vlc_poll_i11e_wake, wakefd);
+    vlc_cleanup_push(vlc_poll_i11e_cleanup, wakefd);
+    for (;;)
+    {
+        ret = poll(ufd, nfds + 1, timeout);
+        /* A signal does not end an infinite wait */
+        if (ret != -1 || errno != EINTR || timeout >= 0)
+            break;
+    }
+    vlc_cleanup_pop();
+
+    if (vlc_interrupt_finish(ctx))
+    {
+        ret = -1;
+        errno = EINTR;
+    }
+    else
+    {   /* The wake-up descriptor is only written to on interruption */
+        for (unsigned i = 0; i < nfds; i++)
+            fds[i].revents = ufd[i].revents;
+    }
+
+    if (wakefd[1] != wakefd[0])
+        close(wakefd[1]);
+    close(wakefd[0]);
+    return ret;
+#else
+    /* The poll() replacement only handles sockets */
+    return vlc_poll_i11e_slices(ctx, fds, nfds, timeout);
+#endif
+}
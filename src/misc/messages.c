@@ -33,12 +33,14 @@
 #endif
 
 #include <stdlib.h>
+#include <limits.h>
 #include <stdarg.h>                                       /* va_list for BSD */
 #include <unistd.h>
 
 #include <vlc_common.h>
 #include <vlc_interface.h>
 #include <vlc_charset.h>
+#include <vlc_atomic.h>
 #include "../libvlc.h"
 
 #ifdef __ANDROID__
@@ -68,6 +70,243 @@ static void Win32DebugOutputMsg (void *, int , const vlc_log_t *,
                                  const char *, va_list);
 #endif
 
+/*
+ * Asynchronous logging
+ *
+ * Emitting threads format the message into a slot of a bounded queue,
+ * and a dedicated thread passes it on to the log callback. The queue is
+ * lock-free for the emitters (per-slot sequence numbers); the only lock is
+ * taken to wake up the writer thread when it sleeps on an empty queue.
+ * When the queue is full, or a module exceeds its rate limit, the message
+ * is dropped and counted, rather than stalling the emitter.
+ */
+#define LOG_QUEUE_SIZE 1024 /* must be a power of two */
+#define LOG_TEXT_SIZE 256
+#define LOG_RATE_BUCKETS 64
+
+typedef struct
+{
+    atomic_size_t seq;
+    int type;
+    bool has_header;
+    uintptr_t object_id;
+    char object_type[16];
+    char module[32];
+    char header[32];
+    char *heap; /**< Text that did not fit in the slot, or NULL */
+    char text[LOG_TEXT_SIZE];
+} vlc_log_entry_t;
+
+struct vlc_log_queue
+{
+    vlc_thread_t thread;
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    bool stop;
+    atomic_bool running;
+    atomic_bool sleeping;
+    atomic_int threshold; /**< Highest type - VLC_MSG_ERR to queue */
+
+    atomic_size_t head;
+    size_t tail; /**< Only used by the writer thread */
+
+    atomic_uint dropped_full;
+    atomic_uint dropped_rate;
+
+    /* Per module rate limit (modules with the same hash share a bucket) */
+    unsigned rate_limit; /**< Messages per second per module, 0 if none */
+    struct vlc_log_bucket
+    {
+        atomic_uint window; /**< Current second */
+        atomic_uint count; /**< Messages in the current second */
+    } buckets[LOG_RATE_BUCKETS];
+
+    vlc_log_entry_t entries[LOG_QUEUE_SIZE];
+};
+
+static bool LogRateLimited (struct vlc_log_queue *q, const char *module)
+{
+    uint32_t hash = 2166136261u;
+
+    for (const unsigned char *p = (const unsigned char *)module; *p; p++)
+        hash = (hash ^ *p) * 16777619u;
+
+    struct vlc_log_bucket *b = &q->buckets[hash % LOG_RATE_BUCKETS];
+    unsigned now = mdate () / CLOCK_FREQ;
+    unsigned window = atomic_load_explicit (&b->window, memory_order_relaxed);
+
+    /* Only the thread that opens the new window resets the count */
+    if (window != now
+     && atomic_compare_exchange_strong (&b->window, &window, now))
+        atomic_store_explicit (&b->count, 0, memory_order_relaxed);
+
+    return atomic_fetch_add_explicit (&b->count, 1, memory_order_relaxed)
+               >= q->rate_limit;
+}
+
+static void LogQueuePush (struct vlc_log_queue *q, int type,
+                          const vlc_log_t *msg, const char *format,
+                          va_list args)
+{
+    if (type - VLC_MSG_ERR > atomic_load_explicit (&q->threshold,
+                                                   memory_order_relaxed))
+        return;
+
+    if (q->rate_limit != 0 && type != VLC_MSG_ERR
+     && LogRateLimited (q, msg->psz_module))
+    {
+        atomic_fetch_add_explicit (&q->dropped_rate, 1, memory_order_relaxed);
+        return;
+    }
+
+    /* Reserve a slot */
+    size_t pos = atomic_load_explicit (&q->head, memory_order_relaxed);
+    vlc_log_entry_t *entry;
+
+    for (;;)
+    {
+        entry = &q->entries[pos % LOG_QUEUE_SIZE];
+
+        size_t seq = atomic_load_explicit (&entry->seq, memory_order_acquire);
+        ptrdiff_t diff = seq - pos;
+
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit (&q->head, &pos, pos + 1,
+                                                       memory_order_relaxed,
+                                                       memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {   /* full */
+            atomic_fetch_add_explicit (&q->dropped_full, 1,
+                                       memory_order_relaxed);
+            return;
+        }
+        else
+            pos = atomic_load_explicit (&q->head, memory_order_relaxed);
+    }
+
+    /* Fill it in */
+    entry->type = type;
+    entry->object_id = msg->i_object_id;
+    strlcpy (entry->object_type, msg->psz_object_type,
+             sizeof (entry->object_type));
+    strlcpy (entry->module, msg->psz_module, sizeof (entry->module));
+    entry->has_header = msg->psz_header != NULL;
+    if (entry->has_header)
+        strlcpy (entry->header, msg->psz_header, sizeof (entry->header));
+
+    va_list ap;
+
+    va_copy (ap, args);
+    int len = vsnprintf (entry->text, sizeof (entry->text), format, ap);
+    va_end (ap);
+
+    entry->heap = NULL;
+    if (len >= (int)sizeof (entry->text)
+     && vasprintf (&entry->heap, format, args) == -1)
+        entry->heap = NULL; /* keep the truncated text */
+
+    atomic_store_explicit (&entry->seq, pos + 1, memory_order_release);
+
+    /* Wake the writer up if it waits for a message */
+    atomic_thread_fence (memory_order_seq_cst);
+    if (atomic_load_explicit (&q->sleeping, memory_order_relaxed))
+    {
+        vlc_mutex_lock (&q->lock);
+        vlc_cond_signal (&q->wait);
+        vlc_mutex_unlock (&q->lock);
+    }
+}
+
+static bool LogQueueEmpty (struct vlc_log_queue *q)
+{
+    const vlc_log_entry_t *entry = &q->entries[q->tail % LOG_QUEUE_SIZE];
+
+    return atomic_load_explicit (&entry->seq, memory_order_acquire)
+               != q->tail + 1;
+}
+
+static void LogDeliver (libvlc_priv_t *priv, int type, const vlc_log_t *msg,
+                        const char *format, ...)
+{
+    va_list ap;
+
+    va_start (ap, format);
+    vlc_rwlock_rdlock (&priv->log.lock);
+    priv->log.cb (priv->log.opaque, type, msg, format, ap);
+    vlc_rwlock_unlock (&priv->log.lock);
+    va_end (ap);
+}
+
+static void LogQueueDrain (libvlc_priv_t *priv)
+{
+    struct vlc_log_queue *q = priv->log.queue;
+
+    while (!LogQueueEmpty (q))
+    {
+        vlc_log_entry_t *entry = &q->entries[q->tail % LOG_QUEUE_SIZE];
+        vlc_log_t msg = {
+            .i_object_id = entry->object_id,
+            .psz_object_type = entry->object_type,
+            .psz_module = entry->module,
+            .psz_header = entry->has_header ? entry->header : NULL,
+        };
+
+        LogDeliver (priv, entry->type, &msg, "%s",
+                    (entry->heap != NULL) ? entry->heap : entry->text);
+        free (entry->heap);
+
+        /* Give the slot back to the emitters, one lap ahead */
+        atomic_store_explicit (&entry->seq, q->tail + LOG_QUEUE_SIZE,
+                               memory_order_release);
+        q->tail++;
+    }
+
+    unsigned full = atomic_exchange_explicit (&q->dropped_full, 0,
+                                              memory_order_relaxed);
+    unsigned rate = atomic_exchange_explicit (&q->dropped_rate, 0,
+                                              memory_order_relaxed);
+    if (full != 0 || rate != 0)
+    {
+        const vlc_log_t msg = {
+            .i_object_id = (uintptr_t)&priv->public_data,
+            .psz_object_type = "logger",
+            .psz_module = "core",
+            .psz_header = NULL,
+        };
+
+        LogDeliver (priv, VLC_MSG_WARN, &msg, "dropped %u message(s) "
+                    "(%u with the queue full, %u over the rate limit)",
+                    full + rate, full, rate);
+    }
+}
+
+static void *LogThread (void *data)
+{
+    libvlc_priv_t *priv = data;
+    struct vlc_log_queue *q = priv->log.queue;
+    bool stop;
+
+    do
+    {
+        vlc_mutex_lock (&q->lock);
+        atomic_store_explicit (&q->sleeping, true, memory_order_relaxed);
+        atomic_thread_fence (memory_order_seq_cst);
+        while (!q->stop && LogQueueEmpty (q))
+            vlc_cond_wait (&q->wait, &q->lock);
+        atomic_store_explicit (&q->sleeping, false, memory_order_relaxed);
+        stop = q->stop;
+        vlc_mutex_unlock (&q->lock);
+
+        LogQueueDrain (priv);
+    }
+    while (!stop);
+
+    return NULL;
+}
+
 /**
  * Emit a log message. This function is the variable argument list equivalent
  * to vlc_Log().
@@ -120,6 +359,15 @@ void vlc_vaLog (vlc_object_t *obj, int type, const char *module,
 #endif
 
     if (priv) {
+        struct vlc_log_queue *q = priv->log.queue;
+
+        if (q != NULL && atomic_load_explicit (&q->running,
+                                               memory_order_acquire))
+        {
+            LogQueuePush (q, type, &msg, format, args);
+            return;
+        }
+
         vlc_rwlock_rdlock (&priv->log.lock);
         priv->log.cb (priv->log.opaque, type, &msg, format, args);
         vlc_rwlock_unlock (&priv->log.lock);
@@ -276,6 +524,9 @@ static void AndroidPrintMsg (void *d, int type, const vlc_log_t *p_item,
 void vlc_LogSet (libvlc_int_t *vlc, vlc_log_cb cb, void *opaque)
 {
     libvlc_priv_t *priv = libvlc_priv (vlc);
+    /* The default callbacks filter by verbosity: do not even queue what they
+     * would discard. Other callbacks get everything. */
+    int threshold = (cb == NULL) ? priv->log.verbose : INT_MAX;
 
     if (cb == NULL)
     {
@@ -297,6 +548,10 @@ void vlc_LogSet (libvlc_int_t *vlc, vlc_log_cb cb, void *opaque)
     priv->log.opaque = opaque;
     vlc_rwlock_unlock (&priv->log.lock);
 
+    if (priv->log.queue != NULL)
+        atomic_store_explicit (&priv->log.queue->threshold, threshold,
+                               memory_order_relaxed);
+
     /* Announce who we are */
     msg_Dbg (vlc, "VLC media player - %s", VERSION_MESSAGE);
     msg_Dbg (vlc, "%s", COPYRIGHT_MESSAGE);
@@ -318,12 +573,84 @@ void vlc_LogInit (libvlc_int_t *vlc)
         priv->log.verbose = var_InheritInteger (vlc, "verbose");
 
     vlc_rwlock_init (&priv->log.lock);
+
+    /* Messages are passed on synchronously until vlc_LogStart() */
+    priv->log.queue = NULL;
+    if (var_InheritBool (vlc, "log-async"))
+    {
+        struct vlc_log_queue *q = malloc (sizeof (*q));
+        if (likely(q != NULL))
+        {
+            vlc_mutex_init (&q->lock);
+            vlc_cond_init (&q->wait);
+            q->stop = false;
+            atomic_init (&q->running, false);
+            atomic_init (&q->sleeping, false);
+            atomic_init (&q->threshold, INT_MAX);
+            atomic_init (&q->head, 0);
+            q->tail = 0;
+            atomic_init (&q->dropped_full, 0);
+            atomic_init (&q->dropped_rate, 0);
+
+            int64_t rate = var_InheritInteger (vlc, "log-rate-limit");
+            q->rate_limit = (rate > 0) ? __MIN(rate, UINT_MAX) : 0;
+            for (size_t i = 0; i < LOG_RATE_BUCKETS; i++)
+            {
+                atomic_init (&q->buckets[i].window, 0);
+                atomic_init (&q->buckets[i].count, 0);
+            }
+            for (size_t i = 0; i < LOG_QUEUE_SIZE; i++)
+                atomic_init (&q->entries[i].seq, i);
+            priv->log.queue = q;
+        }
+    }
+
     vlc_LogSet (vlc, NULL, NULL);
 }
 
+/**
+ * Starts passing messages on from a dedicated thread.
+ * This must not be called before the process is daemonized (if ever), since
+ * the thread would not survive fork().
+ */
+void vlc_LogStart (libvlc_int_t *vlc)
+{
+    libvlc_priv_t *priv = libvlc_priv (vlc);
+    struct vlc_log_queue *q = priv->log.queue;
+
+    if (q == NULL)
+        return;
+
+    if (vlc_clone (&q->thread, LogThread, priv, VLC_THREAD_PRIORITY_LOW))
+    {
+        msg_Warn (vlc, "cannot start the logging thread");
+        return;
+    }
+    atomic_store_explicit (&q->running, true, memory_order_release);
+}
+
 void vlc_LogDeinit (libvlc_int_t *vlc)
 {
     libvlc_priv_t *priv = libvlc_priv (vlc);
+    struct vlc_log_queue *q = priv->log.queue;
+
+    if (q != NULL)
+    {
+        if (atomic_load_explicit (&q->running, memory_order_relaxed))
+        {
+            atomic_store_explicit (&q->running, false, memory_order_relaxed);
+
+            /* The thread passes on the pending messages before it exits */
+            vlc_mutex_lock (&q->lock);
+            q->stop = true;
+            vlc_cond_signal (&q->wait);
+            vlc_mutex_unlock (&q->lock);
+            vlc_join (q->thread, NULL);
+        }
+        vlc_cond_destroy (&q->wait);
+        vlc_mutex_destroy (&q->lock);
+        free (q);
+    }
 
     vlc_rwlock_destroy (&priv->log.lock);
 }
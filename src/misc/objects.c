@@ -132,6 +132,10 @@ void *vlc_custom_create (vlc_object_t *parent, size_t length,
     priv->var_root = NULL;
     vlc_mutex_init (&priv->var_lock);
     vlc_cond_init (&priv->var_wait);
+    vlc_rwlock_init (&priv->var_tree_lock);
+    vlc_mutex_init (&priv->inherit_lock);
+    priv->inherit_cache = NULL;
+    atomic_init (&priv->has_children, false);
     priv->pipes[0] = priv->pipes[1] = -1;
     atomic_init (&priv->alive, true);
     atomic_init (&priv->refs, 1);
@@ -155,6 +159,9 @@ void *vlc_custom_create (vlc_object_t *parent, size_t length,
         /* Attach the child to its parent (no lock needed) */
         obj->p_parent = vlc_object_hold (parent);
 
+        /* The variables of the parent may now be cached for the child */
+        atomic_store (&papriv->has_children, true);
+
         /* Attach the parent to its child (structure lock needed) */
         libvlc_lock (obj->p_libvlc);
         priv->next = papriv->first;
@@ -269,6 +276,8 @@ static void vlc_object_destroy( vlc_object_t *p_this )
     /* Destroy the associated variables. */
     var_DestroyAll( p_this );
 
+    vlc_rwlock_destroy( &p_priv->var_tree_lock );
+    vlc_mutex_destroy( &p_priv->inherit_lock );
     vlc_cond_destroy( &p_priv->var_wait );
     vlc_mutex_destroy( &p_priv->var_lock );
 
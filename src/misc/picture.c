@@ -37,6 +37,9 @@
 #include <vlc_picture.h>
 #include <vlc_image.h>
 #include <vlc_block.h>
+#include <vlc_cpu.h>
+#include <vlc_atomic.h>
+#include <vlc_threadpool.h>
 
 /**
  * Allocate a new picture in the heap.
@@ -84,6 +87,15 @@ static int AllocatePicture( picture_t *p_pic )
  *
  *****************************************************************************/
 
+static void PictureDestroyQP( picture_t *p_picture )
+{
+    if( p_picture->p_qp != NULL )
+    {
+        picture_qp_Release( p_picture->p_qp );
+        p_picture->p_qp = NULL;
+    }
+}
+
 static void PictureDestroyContext( picture_t *p_picture )
 {
     void (**context)( void * ) = p_picture->context;
@@ -127,6 +139,7 @@ void picture_Reset( picture_t *p_picture )
     p_picture->i_nb_fields = 2;
     p_picture->b_top_field_first = false;
     PictureDestroyContext( p_picture );
+    PictureDestroyQP( p_picture );
 }
 
 /*****************************************************************************
@@ -278,6 +291,35 @@ picture_t *picture_New( vlc_fourcc_t i_chroma, int i_width, int i_height, int i_
     return picture_NewFromFormat( &fmt );
 }
 
+/*****************************************************************************
+ *
+ *****************************************************************************/
+picture_qp_t *picture_qp_New( unsigned i_width, unsigned i_height,
+                              int i_stride, int i_lines )
+{
+    if( i_stride <= 0 || i_lines <= 0 )
+        return NULL;
+
+    /* The table follows the structure */
+    picture_qp_t *p_qp = malloc( sizeof( *p_qp ) + (size_t)i_stride * i_lines );
+    if( unlikely(p_qp == NULL) )
+        return NULL;
+
+    atomic_init( &p_qp->refs, 1 );
+    p_qp->i_width = i_width;
+    p_qp->i_height = i_height;
+    p_qp->i_stride = i_stride;
+    p_qp->i_type = 0;
+    p_qp->p_table = (int8_t *)( p_qp + 1 );
+    return p_qp;
+}
+
+void picture_qp_Release( picture_qp_t *p_qp )
+{
+    if( atomic_fetch_sub( &p_qp->refs, 1 ) == 1 )
+        free( p_qp );
+}
+
 /*****************************************************************************
  *
  *****************************************************************************/
@@ -299,6 +341,7 @@ void picture_Release( picture_t *p_picture )
         return;
 
     PictureDestroyContext( p_picture );
+    PictureDestroyQP( p_picture );
     assert( p_picture->gc.pf_destroy != NULL );
     p_picture->gc.pf_destroy( p_picture );
 }
@@ -311,6 +354,119 @@ bool picture_IsReferenced( picture_t *p_picture )
 /*****************************************************************************
  *
  *****************************************************************************/
+/* Planes from this size are copied bypassing the caches, as they would
+ * evict most of them anyway */
+#define COPY_STREAM_MIN (4 << 20)
+/* Smallest band of a plane copied by a thread of the pool */
+#define COPY_BAND_MIN   (1 << 20)
+
+static struct
+{
+    atomic_uint_fast64_t pictures;
+    atomic_uint_fast64_t planes;
+    atomic_uint_fast64_t bytes;
+    atomic_uint_fast64_t bulk_planes;
+    atomic_uint_fast64_t streamed;
+    atomic_uint_fast64_t parallel;
+    atomic_uint_fast64_t elided;
+} copy_stats;
+
+#define copy_stats_Add( field, val ) \
+    atomic_fetch_add_explicit( &copy_stats.field, val, memory_order_relaxed )
+
+void picture_GetCopyStats( picture_copy_stats_t *p_stats )
+{
+#define GET( field ) \
+    p_stats->field = atomic_load_explicit( &copy_stats.field, \
+                                           memory_order_relaxed )
+    GET( pictures );
+    GET( planes );
+    GET( bytes );
+    GET( bulk_planes );
+    GET( streamed );
+    GET( parallel );
+    GET( elided );
+#undef GET
+}
+
+typedef struct
+{
+    uint8_t       *p_dst;
+    const uint8_t *p_src;
+    size_t         i_dst_pitch;
+    size_t         i_src_pitch;
+    size_t         i_width;
+    unsigned       i_lines;
+    bool           b_stream;
+} plane_copy_t;
+
+#ifdef CAN_COMPILE_SSE2
+/* Copies with non-temporal stores, which do not pollute the caches */
+VLC_SSE
+static void CopyStream( uint8_t *p_dst, const uint8_t *p_src, size_t i_size )
+{
+    /* Align the destination */
+    size_t i_head = __MIN( (-(uintptr_t)p_dst) & 15, i_size );
+
+    memcpy( p_dst, p_src, i_head );
+    p_dst += i_head;
+    p_src += i_head;
+    i_size -= i_head;
+
+    for( ; i_size >= 64; i_size -= 64, p_dst += 64, p_src += 64 )
+        asm volatile (
+            "movdqu   0(%[src]), %%xmm1\n"
+            "movdqu  16(%[src]), %%xmm2\n"
+            "movdqu  32(%[src]), %%xmm3\n"
+            "movdqu  48(%[src]), %%xmm4\n"
+            "movntdq %%xmm1,  0(%[dst])\n"
+            "movntdq %%xmm2, 16(%[dst])\n"
+            "movntdq %%xmm3, 32(%[dst])\n"
+            "movntdq %%xmm4, 48(%[dst])\n"
+            : : [dst]"r"(p_dst), [src]"r"(p_src)
+            : "memory", "xmm1", "xmm2", "xmm3", "xmm4" );
+
+    memcpy( p_dst, p_src, i_size );
+}
+#endif
+
+static void CopyLines( const plane_copy_t *c, unsigned i_first,
+                       unsigned i_count )
+{
+    uint8_t *p_dst = c->p_dst + i_first * c->i_dst_pitch;
+    const uint8_t *p_src = c->p_src + i_first * c->i_src_pitch;
+    size_t i_width = c->i_width;
+
+    if( c->i_dst_pitch == i_width && c->i_src_pitch == i_width )
+    {   /* Contiguous lines */
+        i_width *= i_count;
+        i_count = 1;
+    }
+
+#ifdef CAN_COMPILE_SSE2
+    if( c->b_stream )
+    {
+        for( unsigned i = 0; i < i_count; i++ )
+            CopyStream( p_dst + i * c->i_dst_pitch,
+                        p_src + i * c->i_src_pitch, i_width );
+        asm volatile ( "sfence" ::: "memory" );
+        return;
+    }
+#endif
+    for( unsigned i = 0; i < i_count; i++ )
+        memcpy( p_dst + i * c->i_dst_pitch, p_src + i * c->i_src_pitch,
+                i_width );
+}
+
+static void CopyBand( void *opaque, unsigned i_band, unsigned i_bands )
+{
+    const plane_copy_t *c = opaque;
+    unsigned i_first = (uint64_t)c->i_lines * i_band / i_bands;
+    unsigned i_last = (uint64_t)c->i_lines * (i_band + 1) / i_bands;
+
+    CopyLines( c, i_first, i_last - i_first );
+}
+
 void plane_CopyPixels( plane_t *p_dst, const plane_t *p_src )
 {
     const unsigned i_width  = __MIN( p_dst->i_visible_pitch,
@@ -318,6 +474,23 @@ void plane_CopyPixels( plane_t *p_dst, const plane_t *p_src )
     const unsigned i_height = __MIN( p_dst->i_visible_lines,
                                      p_src->i_visible_lines );
 
+    copy_stats_Add( planes, 1 );
+    if( p_dst->p_pixels == p_src->p_pixels &&
+        p_dst->i_pitch == p_src->i_pitch )
+    {
+        copy_stats_Add( elided, 1 );
+        return;
+    }
+
+    plane_copy_t copy = {
+        .p_dst = p_dst->p_pixels,
+        .p_src = p_src->p_pixels,
+        .i_dst_pitch = p_dst->i_pitch,
+        .i_src_pitch = p_src->i_pitch,
+        .i_width = i_width,
+        .i_lines = i_height,
+    };
+
     /* The 2x visible pitch check does two things:
        1) Makes field plane_t's work correctly (see the deinterlacer module)
        2) Moves less data if the pitch and visible pitch differ much.
@@ -326,26 +499,33 @@ void plane_CopyPixels( plane_t *p_dst, const plane_t *p_src )
         p_src->i_pitch < 2*p_src->i_visible_pitch )
     {
         /* There are margins, but with the same width : perfect ! */
-        memcpy( p_dst->p_pixels, p_src->p_pixels,
-                    p_src->i_pitch * i_height );
+        copy.i_width = p_src->i_pitch;
+        copy_stats_Add( bulk_planes, 1 );
     }
-    else
+
+    const size_t i_size = copy.i_width * copy.i_lines;
+    copy_stats_Add( bytes, i_size );
+
+#ifdef CAN_COMPILE_SSE2
+    if( i_size >= COPY_STREAM_MIN && vlc_CPU_SSE2() )
     {
-        /* We need to proceed line by line */
-        uint8_t *p_in = p_src->p_pixels;
-        uint8_t *p_out = p_dst->p_pixels;
-        int i_line;
+        copy.b_stream = true;
+        copy_stats_Add( streamed, i_size );
+    }
+#endif
 
-        assert( p_in );
-        assert( p_out );
+    /* Split large planes across the thread pool */
+    unsigned i_bands = __MIN( i_size / COPY_BAND_MIN, copy.i_lines );
+    if( i_bands >= 2 )
+        i_bands = __MIN( i_bands, vlc_threadpool_Size() + 1 );
 
-        for( i_line = i_height; i_line--; )
-        {
-            memcpy( p_out, p_in, i_width );
-            p_in += p_src->i_pitch;
-            p_out += p_dst->i_pitch;
-        }
+    if( i_bands >= 2 )
+    {
+        copy_stats_Add( parallel, 1 );
+        vlc_task_Parallel( CopyBand, &copy, i_bands, VLC_TASK_PRIORITY_HIGH );
     }
+    else
+        CopyLines( &copy, 0, copy.i_lines );
 }
 
 void picture_CopyProperties( picture_t *p_dst, const picture_t *p_src )
@@ -356,12 +536,20 @@ void picture_CopyProperties( picture_t *p_dst, const picture_t *p_src )
     p_dst->b_progressive = p_src->b_progressive;
     p_dst->i_nb_fields = p_src->i_nb_fields;
     p_dst->b_top_field_first = p_src->b_top_field_first;
+
+    if( p_dst->p_qp != p_src->p_qp )
+    {
+        PictureDestroyQP( p_dst );
+        if( p_src->p_qp != NULL )
+            p_dst->p_qp = picture_qp_Hold( p_src->p_qp );
+    }
 }
 
 void picture_CopyPixels( picture_t *p_dst, const picture_t *p_src )
 {
     int i;
 
+    copy_stats_Add( pictures, 1 );
     for( i = 0; i < p_src->i_planes ; i++ )
         plane_CopyPixels( p_dst->p+i, p_src->p+i );
 }
@@ -30,42 +30,57 @@
 # include "config.h"
 #endif
 #include <assert.h>
+#include <limits.h>
 
 #include <vlc_common.h>
 #include <vlc_picture_pool.h>
+#include <vlc_atomic.h>
 
 /*****************************************************************************
  *
  *****************************************************************************/
+#define POOL_WORD_BITS (sizeof (unsigned) * CHAR_BIT)
+#define POOL_WORDS(count) (((count) + POOL_WORD_BITS - 1) / POOL_WORD_BITS)
+
 struct picture_gc_sys_t {
     picture_pool_t *pool;
     picture_t *picture;
-    bool in_use;
-    uint64_t tick;
+    unsigned index;
+    unsigned tick;
 };
 
 struct picture_pool_t {
-    uint64_t       tick;
+    atomic_uint    tick;
     /* */
     unsigned       picture_count;
     picture_t      **picture;
 
     int       (*pic_lock)(picture_t *);
     void      (*pic_unlock)(picture_t *);
-    unsigned    refs;
-    vlc_mutex_t lock;
+    atomic_uint refs;
+
+    /* Statistics */
+    atomic_uint hits;
+    atomic_uint misses;
+    atomic_uint exhausted;
+    atomic_uint in_use;
+    atomic_uint high_water;
+
+    /* Bitmap of free pictures */
+    atomic_uint available[];
 };
 
-void picture_pool_Release(picture_pool_t *pool)
+static bool picture_pool_IsFree(picture_pool_t *pool, unsigned index)
 {
-    bool destroy;
+    unsigned mask = 1u << (index % POOL_WORD_BITS);
 
-    vlc_mutex_lock(&pool->lock);
-    assert(pool->refs > 0);
-    destroy = --pool->refs == 0;
-    vlc_mutex_unlock(&pool->lock);
+    return atomic_load(&pool->available[index / POOL_WORD_BITS]) & mask;
+}
 
-    if (likely(!destroy))
+void picture_pool_Release(picture_pool_t *pool)
+{
+    assert(atomic_load(&pool->refs) > 0);
+    if (likely(atomic_fetch_sub(&pool->refs, 1) != 1))
         return;
 
     for (unsigned i = 0; i < pool->picture_count; i++) {
@@ -77,7 +92,6 @@ void picture_pool_Release(picture_pool_t *pool)
         free(picture);
     }
 
-    vlc_mutex_destroy(&pool->lock);
     free(pool->picture);
     free(pool);
 }
@@ -86,20 +100,23 @@ static void picture_pool_ReleasePicture(picture_t *picture)
 {
     picture_gc_sys_t *sys = picture->gc.p_sys;
     picture_pool_t *pool = sys->pool;
+    unsigned word = sys->index / POOL_WORD_BITS;
+    unsigned mask = 1u << (sys->index % POOL_WORD_BITS);
 
     if (pool->pic_unlock != NULL)
         pool->pic_unlock(picture);
 
-    vlc_mutex_lock(&pool->lock);
-    assert(sys->in_use);
-    sys->in_use = false;
-    vlc_mutex_unlock(&pool->lock);
+    atomic_fetch_sub_explicit(&pool->in_use, 1, memory_order_relaxed);
+    assert(!(atomic_load(&pool->available[word]) & mask));
+    atomic_fetch_or_explicit(&pool->available[word], mask,
+                             memory_order_release);
 
     picture_pool_Release(pool);
 }
 
 static picture_t *picture_pool_ClonePicture(picture_pool_t *pool,
-                                            picture_t *picture)
+                                            picture_t *picture,
+                                            unsigned index)
 {
     picture_gc_sys_t *sys = malloc(sizeof(*sys));
     if (unlikely(sys == NULL))
@@ -107,7 +124,7 @@ static picture_t *picture_pool_ClonePicture(picture_pool_t *pool,
 
     sys->pool = pool;
     sys->picture = picture;
-    sys->in_use = false;
+    sys->index = index;
     sys->tick = 0;
 
     picture_resource_t res = {
@@ -130,13 +147,15 @@ static picture_t *picture_pool_ClonePicture(picture_pool_t *pool,
     return clone;
 }
 
-static picture_pool_t *Create(int picture_count)
+static picture_pool_t *Create(unsigned picture_count)
 {
-    picture_pool_t *pool = calloc(1, sizeof(*pool));
+    const unsigned words = POOL_WORDS(picture_count);
+    picture_pool_t *pool = calloc(1, sizeof(*pool)
+                                     + words * sizeof(pool->available[0]));
     if (!pool)
         return NULL;
 
-    pool->tick = 1;
+    atomic_init(&pool->tick, 1);
     pool->picture_count = picture_count;
     pool->picture = calloc(pool->picture_count, sizeof(*pool->picture));
     if (!pool->picture) {
@@ -144,8 +163,18 @@ static picture_pool_t *Create(int picture_count)
         free(pool);
         return NULL;
     }
-    pool->refs = 1;
-    vlc_mutex_init(&pool->lock);
+    atomic_init(&pool->refs, 1);
+    atomic_init(&pool->hits, 0);
+    atomic_init(&pool->misses, 0);
+    atomic_init(&pool->exhausted, 0);
+    atomic_init(&pool->in_use, 0);
+    atomic_init(&pool->high_water, 0);
+
+    for (unsigned i = 0; i < words; i++) {
+        unsigned count = picture_count - i * POOL_WORD_BITS;
+        atomic_init(&pool->available[i], (count >= POOL_WORD_BITS)
+                                         ? ~0u : (1u << count) - 1);
+    }
     return pool;
 }
 
@@ -159,7 +188,8 @@ picture_pool_t *picture_pool_NewExtended(const picture_pool_configuration_t *cfg
     pool->pic_unlock = cfg->unlock;
 
     for (unsigned i = 0; i < cfg->picture_count; i++) {
-        picture_t *picture = picture_pool_ClonePicture(pool, cfg->picture[i]);
+        picture_t *picture = picture_pool_ClonePicture(pool, cfg->picture[i],
+                                                       i);
         if (unlikely(picture == NULL))
             abort();
 
@@ -229,62 +259,87 @@ error:
     return NULL;
 }
 
-picture_t *picture_pool_Get(picture_pool_t *pool)
+static void picture_pool_CountUse(picture_pool_t *pool)
 {
-    vlc_mutex_lock(&pool->lock);
-    assert(pool->refs > 0);
-
-    for (unsigned i = 0; i < pool->picture_count; i++) {
-        picture_t *picture = pool->picture[i];
-        picture_gc_sys_t *sys = picture->gc.p_sys;
-        uint64_t tick;
-
-        if (sys->in_use)
-            continue;
-
-        pool->refs++;
-        tick = ++pool->tick;
-        sys->in_use = true;
-        vlc_mutex_unlock(&pool->lock);
+    unsigned in_use = atomic_fetch_add_explicit(&pool->in_use, 1,
+                                                memory_order_relaxed) + 1;
+    unsigned high = atomic_load_explicit(&pool->high_water,
+                                         memory_order_relaxed);
+
+    atomic_fetch_add_explicit(&pool->hits, 1, memory_order_relaxed);
+    if (in_use >= pool->picture_count)
+        atomic_fetch_add_explicit(&pool->exhausted, 1, memory_order_relaxed);
+    while (in_use > high
+        && !atomic_compare_exchange_weak_explicit(&pool->high_water, &high,
+                                                  in_use, memory_order_relaxed,
+                                                  memory_order_relaxed));
+}
 
-        if (pool->pic_lock != NULL && pool->pic_lock(picture) != 0) {
-            vlc_mutex_lock(&pool->lock);
-            sys->in_use = false;
-            pool->refs--;
-            continue;
+picture_t *picture_pool_Get(picture_pool_t *pool)
+{
+    assert(atomic_load(&pool->refs) > 0);
+
+    for (unsigned w = 0; w < POOL_WORDS(pool->picture_count); w++) {
+        atomic_uint *word = &pool->available[w];
+        unsigned avail = atomic_load_explicit(word, memory_order_relaxed);
+        unsigned failed = 0;
+
+        while (avail != 0) {
+            unsigned bit = ctz(avail);
+            unsigned mask = 1u << bit;
+
+            if (!atomic_compare_exchange_weak_explicit(word, &avail,
+                                                       avail & ~mask,
+                                                       memory_order_acquire,
+                                                       memory_order_relaxed))
+                continue;
+
+            picture_t *picture = pool->picture[w * POOL_WORD_BITS + bit];
+
+            atomic_fetch_add(&pool->refs, 1);
+            if (pool->pic_lock != NULL && pool->pic_lock(picture) != 0) {
+                /* Keep the picture out of the way until the word is done */
+                atomic_fetch_sub(&pool->refs, 1);
+                failed |= mask;
+                avail &= ~mask;
+                continue;
+            }
+
+            if (failed)
+                atomic_fetch_or(word, failed);
+
+            picture->gc.p_sys->tick = atomic_fetch_add_explicit(&pool->tick, 1,
+                                                        memory_order_relaxed);
+            picture_pool_CountUse(pool);
+
+            assert(atomic_load(&picture->gc.refcount) == 0);
+            atomic_init(&picture->gc.refcount, 1);
+            picture->p_next = NULL;
+            return picture;
         }
 
-        sys->tick = tick;
-
-        assert(atomic_load(&picture->gc.refcount) == 0);
-        atomic_init(&picture->gc.refcount, 1);
-        picture->p_next = NULL;
-        return picture;
+        if (failed)
+            atomic_fetch_or(word, failed);
     }
 
-    vlc_mutex_unlock(&pool->lock);
+    atomic_fetch_add_explicit(&pool->misses, 1, memory_order_relaxed);
     return NULL;
 }
 
 unsigned picture_pool_Reset(picture_pool_t *pool)
 {
     unsigned ret = 0;
-retry:
-    vlc_mutex_lock(&pool->lock);
-    assert(pool->refs > 0);
+
+    assert(atomic_load(&pool->refs) > 0);
 
     for (unsigned i = 0; i < pool->picture_count; i++) {
         picture_t *picture = pool->picture[i];
-        picture_gc_sys_t *sys = picture->gc.p_sys;
 
-        if (sys->in_use) {
-            vlc_mutex_unlock(&pool->lock);
+        while (!picture_pool_IsFree(pool, i)) {
             picture_Release(picture);
             ret++;
-            goto retry;
         }
     }
-    vlc_mutex_unlock(&pool->lock);
 
     return ret;
 }
@@ -292,35 +347,40 @@ retry:
 void picture_pool_NonEmpty(picture_pool_t *pool)
 {
     picture_t *oldest = NULL;
-    uint64_t tick = 0;
+    unsigned oldest_index = 0;
+    unsigned now = atomic_load(&pool->tick);
+    unsigned age = 0;
 
-    vlc_mutex_lock(&pool->lock);
-    assert(pool->refs > 0);
+    assert(atomic_load(&pool->refs) > 0);
 
     for (unsigned i = 0; i < pool->picture_count; i++) {
         picture_t *picture = pool->picture[i];
-        picture_gc_sys_t *sys = picture->gc.p_sys;
 
-        if (!sys->in_use) {
-            vlc_mutex_unlock(&pool->lock);
+        if (picture_pool_IsFree(pool, i))
             return; /* Nothing to do */
-        }
 
-        if (picture->gc.p_sys->tick < tick) {
+        /* The tick is allowed to wrap around */
+        if (now - picture->gc.p_sys->tick > age) {
             oldest = picture;
-            tick = picture->gc.p_sys->tick;
+            oldest_index = i;
+            age = now - picture->gc.p_sys->tick;
         }
     }
 
-    if (oldest != NULL) {
-        while (oldest->gc.p_sys->in_use) {
-            vlc_mutex_unlock(&pool->lock);
+    if (oldest != NULL)
+        while (!picture_pool_IsFree(pool, oldest_index))
             picture_Release(oldest);
-            vlc_mutex_lock(&pool->lock);
-        }
-    }
+}
 
-    vlc_mutex_unlock(&pool->lock);
+void picture_pool_GetStats(picture_pool_t *pool, picture_pool_stats_t *st)
+{
+    st->hits = atomic_load_explicit(&pool->hits, memory_order_relaxed);
+    st->misses = atomic_load_explicit(&pool->misses, memory_order_relaxed);
+    st->exhausted = atomic_load_explicit(&pool->exhausted,
+                                         memory_order_relaxed);
+    st->in_use = atomic_load_explicit(&pool->in_use, memory_order_relaxed);
+    st->high_water = atomic_load_explicit(&pool->high_water,
+                                          memory_order_relaxed);
 }
 
 unsigned picture_pool_GetSize(const picture_pool_t *pool)
@@ -332,7 +392,7 @@ void picture_pool_Enum(picture_pool_t *pool, void (*cb)(void *, picture_t *),
                        void *opaque)
 {
     /* NOTE: So far, the pictures table cannot change after the pool is created
-     * so there is no need to lock the pool mutex here. */
+     * so there is no need to synchronize here. */
     for (unsigned i = 0; i < pool->picture_count; i++)
         cb(opaque, pool->picture[i]);
 }
@@ -21,11 +21,14 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
  *****************************************************************************/
 
+/* Scaled/converted renderings of a region, most recently used first */
 struct subpicture_region_private_t {
     video_format_t fmt;
     picture_t      *p_picture;
+    subpicture_region_private_t *p_next;
 };
 
 subpicture_region_private_t *subpicture_region_private_New(video_format_t *);
+/* Deletes the given entry and all the following ones */
 void subpicture_region_private_Delete(subpicture_region_private_t *);
 
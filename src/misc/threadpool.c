@@ -0,0 +1,367 @@
+/*****************************************************************************
+ * threadpool.c: shared worker threads
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_atomic.h>
+#include <vlc_threadpool.h>
+
+#include "libvlc.h"
+
+/*
+ * The tasks submitted by other threads are queued by priority. The tasks
+ * submitted by a worker (sub-tasks) are queued on its own queue: it takes
+ * them back in LIFO order, while their data is still in its cache, and the
+ * idle workers steal them in FIFO order. All the queues share one lock: the
+ * tasks are meant to be coarse, from a band of a picture upwards.
+ *
+ * The workers are started when the first task is submitted, and stopped
+ * when the last LibVLC instance is released.
+ */
+
+#define PRIORITIES (VLC_TASK_PRIORITY_HIGH + 1)
+
+enum
+{
+    TASK_QUEUED,
+    TASK_RUNNING,
+    TASK_DONE,
+    TASK_CANCELED,
+};
+
+typedef struct
+{
+    vlc_task_t *first;
+    vlc_task_t *last;
+} task_queue_t;
+
+struct vlc_task
+{
+    vlc_task_t   *prev;
+    vlc_task_t   *next;
+    task_queue_t *queue;
+    void        (*run)(void *);
+    void         *opaque;
+    int           state;
+};
+
+static struct
+{
+    vlc_mutex_t     lock;
+    vlc_cond_t      wait_work; /**< Signaled to the workers */
+    vlc_cond_t      wait_done; /**< Signaled when a task ends */
+    task_queue_t    queues[PRIORITIES];
+    task_queue_t   *locals;    /**< One queue per worker */
+    vlc_thread_t   *threads;
+    unsigned        count;     /**< Started workers */
+    unsigned        users;     /**< LibVLC instances */
+    bool            quit;
+    bool            key_created;
+    vlc_threadvar_t key;       /**< Local queue of the calling worker */
+} pool = {
+    .lock = VLC_STATIC_MUTEX,
+    .wait_work = VLC_STATIC_COND,
+    .wait_done = VLC_STATIC_COND,
+};
+
+static void QueueAppend(task_queue_t *queue, vlc_task_t *task)
+{
+    task->queue = queue;
+    task->next = NULL;
+    task->prev = queue->last;
+    if (queue->last != NULL)
+        queue->last->next = task;
+    else
+        queue->first = task;
+    queue->last = task;
+}
+
+static void QueueRemove(vlc_task_t *task)
+{
+    task_queue_t *queue = task->queue;
+
+    if (task->prev != NULL)
+        task->prev->next = task->next;
+    else
+        queue->first = task->next;
+    if (task->next != NULL)
+        task->next->prev = task->prev;
+    else
+        queue->last = task->prev;
+    task->queue = NULL;
+}
+
+/** Dequeues the next task for a worker, or returns NULL. Lock held. */
+static vlc_task_t *PoolPop(task_queue_t *local)
+{
+    vlc_task_t *task = local->last;
+
+    for (int i = PRIORITIES - 1; task == NULL && i >= 0; i--)
+        task = pool.queues[i].first;
+    for (unsigned i = 0; task == NULL && i < pool.count; i++)
+        task = pool.locals[i].first;
+
+    if (task != NULL)
+        QueueRemove(task);
+    return task;
+}
+
+/** Runs a dequeued task. Lock held. */
+static void TaskRun(vlc_task_t *task)
+{
+    task->state = TASK_RUNNING;
+    vlc_mutex_unlock(&pool.lock);
+
+    task->run(task->opaque);
+
+    vlc_mutex_lock(&pool.lock);
+    task->state = TASK_DONE;
+    vlc_cond_broadcast(&pool.wait_done);
+}
+
+static void *PoolThread(void *data)
+{
+    task_queue_t *local = data;
+
+    vlc_threadvar_set(pool.key, local);
+
+    vlc_mutex_lock(&pool.lock);
+    for (;;)
+    {
+        vlc_task_t *task;
+
+        while (!pool.quit && (task = PoolPop(local)) == NULL)
+            vlc_cond_wait(&pool.wait_work, &pool.lock);
+        if (pool.quit)
+            break;
+
+        TaskRun(task);
+    }
+    vlc_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+/** Starts the workers, if not started yet. Lock held. */
+static void PoolStart(void)
+{
+    if (pool.count > 0 || pool.threads != NULL)
+        return;
+
+    if (!pool.key_created)
+    {
+        if (vlc_threadvar_create(&pool.key, NULL))
+            return;
+        pool.key_created = true;
+    }
+
+    unsigned count = vlc_GetCPUCount();
+    if (count == 0)
+        count = 1;
+
+    pool.locals = calloc(count, sizeof (*pool.locals));
+    pool.threads = malloc(count * sizeof (*pool.threads));
+    if (unlikely(pool.locals == NULL || pool.threads == NULL))
+    {
+        free(pool.threads);
+        free(pool.locals);
+        pool.threads = NULL;
+        pool.locals = NULL;
+        return;
+    }
+
+    pool.quit = false;
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (vlc_clone(&pool.threads[pool.count], PoolThread, &pool.locals[i],
+                      VLC_THREAD_PRIORITY_VIDEO))
+            break;
+        pool.count++;
+    }
+}
+
+/** Stops the workers. Lock held, released meanwhile. */
+static void PoolStop(void)
+{
+    pool.quit = true;
+    vlc_cond_broadcast(&pool.wait_work);
+    vlc_mutex_unlock(&pool.lock);
+
+    for (unsigned i = 0; i < pool.count; i++)
+        vlc_join(pool.threads[i], NULL);
+
+    vlc_mutex_lock(&pool.lock);
+    /* The tasks left in the local queues are run by their waiters */
+    for (unsigned i = 0; i < pool.count; i++)
+    {
+        vlc_task_t *task;
+
+        while ((task = pool.locals[i].first) != NULL)
+        {
+            QueueRemove(task);
+            QueueAppend(&pool.queues[VLC_TASK_PRIORITY_NORMAL], task);
+        }
+    }
+
+    free(pool.threads);
+    free(pool.locals);
+    pool.threads = NULL;
+    pool.locals = NULL;
+    pool.count = 0;
+}
+
+void vlc_threadpool_Init(void)
+{
+    vlc_mutex_lock(&pool.lock);
+    pool.users++;
+    vlc_mutex_unlock(&pool.lock);
+}
+
+void vlc_threadpool_Deinit(void)
+{
+    vlc_mutex_lock(&pool.lock);
+    assert(pool.users > 0);
+    if (--pool.users == 0 && pool.threads != NULL)
+        PoolStop();
+    vlc_mutex_unlock(&pool.lock);
+}
+
+unsigned vlc_threadpool_Size(void)
+{
+    unsigned count;
+
+    vlc_mutex_lock(&pool.lock);
+    count = pool.count;
+    vlc_mutex_unlock(&pool.lock);
+
+    if (count == 0)
+        count = vlc_GetCPUCount();
+    return count ? count : 1;
+}
+
+vlc_task_t *vlc_task_Submit(void (*run)(void *), void *opaque, int priority)
+{
+    vlc_task_t *task = malloc(sizeof (*task));
+    if (unlikely(task == NULL))
+        return NULL;
+
+    task->run = run;
+    task->opaque = opaque;
+    task->state = TASK_QUEUED;
+
+    priority = VLC_CLIP(priority, 0, PRIORITIES - 1);
+
+    vlc_mutex_lock(&pool.lock);
+    PoolStart();
+
+    task_queue_t *local = NULL;
+    if (pool.key_created)
+        local = vlc_threadvar_get(pool.key);
+    QueueAppend((local != NULL) ? local : &pool.queues[priority], task);
+    vlc_cond_signal(&pool.wait_work);
+    vlc_mutex_unlock(&pool.lock);
+    return task;
+}
+
+bool vlc_task_Cancel(vlc_task_t *task)
+{
+    bool canceled = false;
+
+    vlc_mutex_lock(&pool.lock);
+    if (task->state == TASK_QUEUED)
+    {
+        QueueRemove(task);
+        task->state = TASK_CANCELED;
+    }
+    canceled = task->state == TASK_CANCELED;
+    vlc_mutex_unlock(&pool.lock);
+    return canceled;
+}
+
+void vlc_task_Wait(vlc_task_t *task)
+{
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock(&pool.lock);
+    if (task->state == TASK_QUEUED)
+    {   /* Nobody took it yet: help */
+        QueueRemove(task);
+        TaskRun(task);
+    }
+    while (task->state == TASK_RUNNING)
+        vlc_cond_wait(&pool.wait_done, &pool.lock);
+    vlc_mutex_unlock(&pool.lock);
+
+    vlc_restorecancel(canc);
+    free(task);
+}
+
+/*** Parallel runs ***/
+typedef struct
+{
+    void      (*run)(void *, unsigned, unsigned);
+    void       *opaque;
+    unsigned    count;
+    atomic_uint next;
+} parallel_job_t;
+
+static void ParallelRun(void *data)
+{
+    parallel_job_t *job = data;
+    unsigned i;
+
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->count)
+        job->run(job->opaque, i, job->count);
+}
+
+void vlc_task_Parallel(void (*run)(void *, unsigned, unsigned),
+                       void *opaque, unsigned count, int priority)
+{
+    if (count <= 1)
+    {
+        if (count == 1)
+            run(opaque, 0, 1);
+        return;
+    }
+
+    parallel_job_t job = { .run = run, .opaque = opaque, .count = count };
+    atomic_init(&job.next, 0);
+
+    /* One helper per worker at most: each one runs as many as it can */
+    unsigned helpers = __MIN(count, vlc_threadpool_Size() + 1) - 1;
+    vlc_task_t *tasks[helpers ? helpers : 1];
+
+    for (unsigned i = 0; i < helpers; i++)
+        tasks[i] = vlc_task_Submit(ParallelRun, &job, priority);
+
+    ParallelRun(&job);
+
+    for (unsigned i = 0; i < helpers; i++)
+        if (tasks[i] != NULL)
+        {   /* Helpers which did not start have nothing left to do */
+            vlc_task_Cancel(tasks[i]);
+            vlc_task_Wait(tasks[i]);
+        }
+}
@@ -0,0 +1,242 @@
+/*****************************************************************************
+ * trace.c: hot path tracing
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+#include <vlc_atomic.h>
+
+#include "../misc/trace.h"
+
+/* Number of events of a ring (power of two): the older ones are overwritten */
+#define TRACE_RING_SIZE 8192
+
+typedef struct
+{
+    mtime_t     date;
+    const char *name;
+    unsigned    tid;
+    char        phase;
+} trace_event_t;
+
+/*
+ * Each thread writes its own ring, with a single writer index. The reader
+ * copies the events, then discards those the writer may have overwritten in
+ * the meantime. The ring of a terminated thread is kept, with its events, for
+ * the next new thread.
+ */
+typedef struct trace_ring
+{
+    struct trace_ring *next;
+    atomic_uint        head; /**< index of the next event to write */
+    atomic_bool        orphan;
+    unsigned           tid;
+    trace_event_t      events[TRACE_RING_SIZE];
+} trace_ring_t;
+
+atomic_bool vlc_trace_enabled = ATOMIC_VAR_INIT(false);
+
+static vlc_mutex_t trace_lock = VLC_STATIC_MUTEX;
+static trace_ring_t *trace_rings = NULL;
+static unsigned trace_tids = 0;
+static vlc_threadvar_t trace_key;
+static bool trace_key_created = false;
+static unsigned trace_users = 0;
+
+static void trace_ring_Orphan(void *data)
+{
+    trace_ring_t *ring = data;
+
+    atomic_store_explicit(&ring->orphan, true, memory_order_release);
+}
+
+/** Gets the ring of the calling thread, creating or adopting one if needed */
+static trace_ring_t *trace_ring_Get(void)
+{
+    /* The key is created before tracing is enabled, and deleted never */
+    trace_ring_t *ring = vlc_threadvar_get(trace_key);
+    if (likely(ring != NULL))
+        return ring;
+
+    vlc_mutex_lock(&trace_lock);
+    for (ring = trace_rings; ring != NULL; ring = ring->next)
+        if (atomic_load_explicit(&ring->orphan, memory_order_acquire))
+            break;
+
+    if (ring == NULL)
+    {
+        ring = malloc(sizeof (*ring));
+        if (unlikely(ring == NULL))
+            goto out;
+        atomic_init(&ring->head, 0);
+        ring->next = trace_rings;
+        trace_rings = ring;
+    }
+    atomic_store(&ring->orphan, false);
+    ring->tid = ++trace_tids;
+
+    if (vlc_threadvar_set(trace_key, ring))
+    {
+        atomic_store(&ring->orphan, true);
+        ring = NULL;
+    }
+out:
+    vlc_mutex_unlock(&trace_lock);
+    return ring;
+}
+
+void vlc_trace_Event(const char *name, char phase)
+{
+    /* Pairs with the enabling of the tracing, after the key creation */
+    atomic_thread_fence(memory_order_acquire);
+
+    trace_ring_t *ring = trace_ring_Get();
+    if (unlikely(ring == NULL))
+        return;
+
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    trace_event_t *ev = &ring->events[head % TRACE_RING_SIZE];
+
+    ev->date = mdate();
+    ev->name = name;
+    ev->tid = ring->tid;
+    ev->phase = phase;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+/** Writes the recorded events in the Chrome trace event format */
+static int trace_Dump(vlc_object_t *obj, const char *path)
+{
+    trace_event_t *events = malloc(TRACE_RING_SIZE * sizeof (*events));
+    if (unlikely(events == NULL))
+        return VLC_ENOMEM;
+
+    FILE *stream = vlc_fopen(path, "wt");
+    if (stream == NULL)
+    {
+        msg_Err(obj, "cannot write trace to %s: %s", path,
+                vlc_strerror_c(errno));
+        free(events);
+        return VLC_EGENERIC;
+    }
+
+    const char *sep = "";
+    unsigned count = 0;
+
+    fputs("{\"traceEvents\":[", stream);
+    vlc_mutex_lock(&trace_lock);
+    for (trace_ring_t *ring = trace_rings; ring != NULL; ring = ring->next)
+    {
+        unsigned end = atomic_load_explicit(&ring->head, memory_order_acquire);
+        unsigned start = (end > TRACE_RING_SIZE) ? end - TRACE_RING_SIZE : 0;
+
+        for (unsigned i = start; i != end; i++)
+            events[i - start] = ring->events[i % TRACE_RING_SIZE];
+
+        /* Skip the events overwritten while they were copied */
+        unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        unsigned skip = 0;
+        if (head - start > TRACE_RING_SIZE)
+            skip = __MIN(head - start - TRACE_RING_SIZE, end - start);
+
+        for (unsigned i = skip; i < end - start; i++)
+        {
+            const trace_event_t *ev = &events[i];
+
+            fprintf(stream, "%s\n{\"name\":\"%s\",\"ph\":\"%c\","
+                    "\"ts\":%"PRId64",\"pid\":1,\"tid\":%u}", sep, ev->name,
+                    ev->phase, ev->date, ev->tid);
+            sep = ",";
+            count++;
+        }
+    }
+    vlc_mutex_unlock(&trace_lock);
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", stream);
+
+    int ret = fclose(stream) ? VLC_EGENERIC : VLC_SUCCESS;
+    free(events);
+    msg_Dbg(obj, "%u trace events written to %s", count, path);
+    return ret;
+}
+
+static int TraceDumpCallback(vlc_object_t *obj, const char *var,
+                             vlc_value_t oldval, vlc_value_t newval,
+                             void *data)
+{
+    char *path = var_InheritString(obj, "trace-file");
+
+    (void) var; (void) oldval; (void) newval; (void) data;
+    if (path == NULL)
+        return VLC_EGENERIC;
+
+    int ret = trace_Dump(obj, path);
+    free(path);
+    return ret;
+}
+
+/**
+ * Enables tracing if the instance has a trace file, and registers the
+ * trace-dump variable which writes it.
+ */
+void vlc_trace_Init(libvlc_int_t *libvlc)
+{
+    char *path = var_InheritString(libvlc, "trace-file");
+    if (path == NULL)
+        return;
+    free(path);
+
+    vlc_mutex_lock(&trace_lock);
+    if (!trace_key_created)
+        trace_key_created = !vlc_threadvar_create(&trace_key,
+                                                  trace_ring_Orphan);
+    if (trace_key_created)
+    {
+        trace_users++;
+        atomic_store(&vlc_trace_enabled, true);
+    }
+    vlc_mutex_unlock(&trace_lock);
+
+    var_Create(libvlc, "trace-dump", VLC_VAR_VOID);
+    var_AddCallback(libvlc, "trace-dump", TraceDumpCallback, NULL);
+}
+
+/**
+ * Writes the trace file of the instance, if any.
+ */
+void vlc_trace_Deinit(libvlc_int_t *libvlc)
+{
+    if (var_Type(libvlc, "trace-dump") == 0)
+        return;
+
+    var_TriggerCallback(libvlc, "trace-dump");
+    var_DelCallback(libvlc, "trace-dump", TraceDumpCallback, NULL);
+    var_Destroy(libvlc, "trace-dump");
+
+    vlc_mutex_lock(&trace_lock);
+    if (trace_users > 0 && --trace_users == 0)
+        atomic_store(&vlc_trace_enabled, false);
+    vlc_mutex_unlock(&trace_lock);
+}
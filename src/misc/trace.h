@@ -0,0 +1,63 @@
+/*****************************************************************************
+ * trace.h: hot path tracing
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_TRACE_H
+# define LIBVLC_TRACE_H 1
+
+# include <vlc_atomic.h>
+
+/*
+ * The traced sections are recorded as timestamped begin and end events in
+ * a ring buffer of the calling thread, without any lock, and written on
+ * demand in the Chrome trace event format (which Perfetto also reads).
+ *
+ * Tracing is enabled with the trace-file option. When it is not, a traced
+ * section costs a relaxed load and a branch.
+ */
+
+extern atomic_bool vlc_trace_enabled;
+
+void vlc_trace_Event(const char *name, char phase);
+
+/**
+ * Begins a traced section.
+ * \param name static string naming the section
+ */
+static inline void vlc_trace_Begin(const char *name)
+{
+    if (unlikely(atomic_load_explicit(&vlc_trace_enabled,
+                                      memory_order_relaxed)))
+        vlc_trace_Event(name, 'B');
+}
+
+/**
+ * Ends the last traced section begun by the calling thread.
+ */
+static inline void vlc_trace_End(const char *name)
+{
+    if (unlikely(atomic_load_explicit(&vlc_trace_enabled,
+                                      memory_order_relaxed)))
+        vlc_trace_Event(name, 'E');
+}
+
+void vlc_trace_Init(libvlc_int_t *);
+void vlc_trace_Deinit(libvlc_int_t *);
+
+#endif
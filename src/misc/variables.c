@@ -41,6 +41,7 @@
 
 #include <vlc_common.h>
 #include <vlc_charset.h>
+#include <vlc_plugin.h>
 #include "libvlc.h"
 #include "variables.h"
 #include "config/configuration.h"
@@ -123,25 +124,114 @@ static int      TriggerListCallback( vlc_object_t *, variable_t *,
                                      const char *, int,
                                      vlc_value_t * );
 
+/* The beginning of variable_t, for lookups */
+typedef struct
+{
+    const char *psz_name;
+    uint32_t    i_hash;
+} variable_key_t;
+
+/* FNV-1a hash of a variable name */
+static uint32_t VarHash( const char *psz_name )
+{
+    uint32_t i_hash = 2166136261u;
+
+    for( const unsigned char *p = (const unsigned char *)psz_name; *p; p++ )
+        i_hash = ( i_hash ^ *p ) * 16777619u;
+    return i_hash;
+}
+
+/* Variables are sorted by hash first, so that string comparisons are only
+ * needed to confirm a match */
 static int varcmp( const void *a, const void *b )
 {
-    const variable_t *va = a, *vb = b;
+    const variable_key_t *va = a, *vb = b;
 
-    /* psz_name must be first */
-    assert( va == (const void *)&va->psz_name );
+    /* psz_name and i_hash must be first */
+    assert( (const void *)va == (const void *)&va->psz_name );
+    if( va->i_hash != vb->i_hash )
+        return ( va->i_hash < vb->i_hash ) ? -1 : 1;
     return strcmp( va->psz_name, vb->psz_name );
 }
 
+/* Finds a variable, with either var_lock or var_tree_lock held */
 static variable_t *Lookup( vlc_object_t *obj, const char *psz_name )
 {
     vlc_object_internals_t *priv = vlc_internals( obj );
+    variable_key_t key = { psz_name, VarHash( psz_name ) };
     variable_t **pp_var;
 
-    vlc_assert_locked( &priv->var_lock );
-    pp_var = tfind( &psz_name, &priv->var_root, varcmp );
+    pp_var = tfind( &key, &priv->var_root, varcmp );
     return (pp_var != NULL) ? *pp_var : NULL;
 }
 
+/* Cache of where the variables inherited from an object are found (see
+ * var_Inherit()), so that the modules created again and again under the
+ * same object (e.g. while probing a filter chain) need not walk the object
+ * tree up to the configuration for each of their options. An entry tells
+ * the object holding the variable, or the configuration item. It is valid
+ * as long as no variable was created nor destroyed on an object with
+ * children, and no configuration item was added nor removed. */
+#define INHERIT_CACHE_SIZE 32
+
+struct inherit_entry_t
+{
+    char            *psz_name; /* NULL if the entry is free */
+    uint32_t         i_hash;
+    int              i_class;
+    unsigned         i_var_gen;
+    unsigned         i_config_gen;
+    vlc_object_t    *p_holder; /* NULL if not held by any object */
+    module_config_t *p_item;   /* when not held, NULL if no such item */
+};
+
+/* Changes whenever an inherited variable may be created or destroyed */
+static atomic_uint inherit_generation = ATOMIC_VAR_INIT(0);
+
+/* Invalidates the inheritance caches if the object may hold variables
+ * inherited by others. Called after a variable is added or removed. */
+static void InheritChanged( vlc_object_t *obj )
+{
+    if( atomic_load( &vlc_internals( obj )->has_children ) )
+        atomic_fetch_add( &inherit_generation, 1 );
+}
+
+static const variable_ops_t *ClassOps( int i_class )
+{
+    switch( i_class )
+    {
+        case VLC_VAR_BOOL:    return &bool_ops;
+        case VLC_VAR_INTEGER: return &int_ops;
+        case VLC_VAR_STRING:  return &string_ops;
+        case VLC_VAR_FLOAT:   return &float_ops;
+        case VLC_VAR_TIME:    return &time_ops;
+        case VLC_VAR_COORDS:  return &coords_ops;
+        case VLC_VAR_ADDRESS: return &addr_ops;
+        case VLC_VAR_VOID:    return &void_ops;
+    }
+    assert( 0 );
+    return &void_ops;
+}
+
+/* Non-string values fit in 64 bits */
+static uint_least64_t ScalarOf( const vlc_value_t *p_val )
+{
+    uint_least64_t scalar;
+
+    static_assert( sizeof (vlc_value_t) >= sizeof (scalar),
+                   "vlc_value_t too small" );
+    memcpy( &scalar, p_val, sizeof (scalar) );
+    return scalar;
+}
+
+/* Updates the copy of the value that var_GetChecked() reads without
+ * var_lock. Must be called, with var_lock held, whenever the value changes. */
+static void PublishValue( variable_t *p_var )
+{
+    atomic_store_explicit( &p_var->scalar, ScalarOf( &p_var->val ),
+                           memory_order_release );
+}
+
 static void Destroy( variable_t *p_var )
 {
     p_var->ops->pf_free( &p_var->val );
@@ -203,6 +293,7 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
         return VLC_ENOMEM;
 
     p_var->psz_name = strdup( psz_name );
+    p_var->i_hash = VarHash( psz_name );
     p_var->psz_text = NULL;
 
     p_var->i_type = i_type & ~VLC_VAR_DOINHERIT;
@@ -221,41 +312,30 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
     /* Always initialize the variable, even if it is a list variable; this
      * will lead to errors if the variable is not initialized, but it will
      * not cause crashes in the variable handling. */
+    p_var->ops = ClassOps( i_type & VLC_VAR_CLASS );
     switch( i_type & VLC_VAR_CLASS )
     {
         case VLC_VAR_BOOL:
-            p_var->ops = &bool_ops;
             p_var->val.b_bool = false;
             break;
         case VLC_VAR_INTEGER:
-            p_var->ops = &int_ops;
             p_var->val.i_int = 0;
             break;
         case VLC_VAR_STRING:
-            p_var->ops = &string_ops;
             p_var->val.psz_string = NULL;
             break;
         case VLC_VAR_FLOAT:
-            p_var->ops = &float_ops;
             p_var->val.f_float = 0.0;
             break;
         case VLC_VAR_TIME:
-            p_var->ops = &time_ops;
             p_var->val.i_time = 0;
             break;
         case VLC_VAR_COORDS:
-            p_var->ops = &coords_ops;
             p_var->val.coords.x = p_var->val.coords.y = 0;
             break;
         case VLC_VAR_ADDRESS:
-            p_var->ops = &addr_ops;
             p_var->val.p_address = NULL;
             break;
-        case VLC_VAR_VOID:
-            p_var->ops = &void_ops;
-            break;
-        default:
-            assert (0);
     }
 
     if( (i_type & VLC_VAR_DOINHERIT)
@@ -274,26 +354,36 @@ int var_Create( vlc_object_t *p_this, const char *psz_name, int i_type )
             p_var->choices_text.p_values[0].psz_string = NULL;
         }
     }
+    atomic_init( &p_var->scalar, ScalarOf( &p_var->val ) );
 
     vlc_object_internals_t *p_priv = vlc_internals( p_this );
     variable_t **pp_var, *p_oldvar;
     int ret = VLC_SUCCESS;
+    bool b_created = false;
 
     vlc_mutex_lock( &p_priv->var_lock );
+    vlc_rwlock_wrlock( &p_priv->var_tree_lock );
 
     pp_var = tsearch( p_var, &p_priv->var_root, varcmp );
     if( unlikely(pp_var == NULL) )
         ret = VLC_ENOMEM;
     else if( (p_oldvar = *pp_var) == p_var ) /* Variable create */
+    {
         p_var = NULL; /* Variable created */
+        b_created = true;
+    }
     else /* Variable already exists */
     {
         assert (((i_type ^ p_oldvar->i_type) & VLC_VAR_CLASS) == 0);
         p_oldvar->i_usage++;
         p_oldvar->i_type |= i_type & (VLC_VAR_ISCOMMAND|VLC_VAR_HASCHOICE);
     }
+    vlc_rwlock_unlock( &p_priv->var_tree_lock );
     vlc_mutex_unlock( &p_priv->var_lock );
 
+    if( b_created )
+        InheritChanged( p_this );
+
     /* If we did not need to create a new variable, free everything... */
     if( p_var != NULL )
         Destroy( p_var );
@@ -330,13 +420,20 @@ int var_Destroy( vlc_object_t *p_this, const char *psz_name )
     WaitUnused( p_this, p_var );
 
     if( --p_var->i_usage == 0 )
+    {
+        vlc_rwlock_wrlock( &p_priv->var_tree_lock );
         tdelete( p_var, &p_priv->var_root, varcmp );
+        vlc_rwlock_unlock( &p_priv->var_tree_lock );
+    }
     else
         p_var = NULL;
     vlc_mutex_unlock( &p_priv->var_lock );
 
     if( p_var != NULL )
+    {
+        InheritChanged( p_this );
         Destroy( p_var );
+    }
     return VLC_SUCCESS;
 }
 
@@ -351,6 +448,14 @@ void var_DestroyAll( vlc_object_t *obj )
 
     tdestroy( priv->var_root, CleanupVar );
     priv->var_root = NULL;
+
+    if( priv->inherit_cache != NULL )
+    {
+        for( unsigned i = 0; i < INHERIT_CACHE_SIZE; i++ )
+            free( priv->inherit_cache[i].psz_name );
+        free( priv->inherit_cache );
+        priv->inherit_cache = NULL;
+    }
 }
 
 #undef var_Change
@@ -395,6 +500,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
             p_var->min = *p_val;
             p_var->ops->pf_dup( &p_var->min );
             CheckValue( p_var, &p_var->val );
+            PublishValue( p_var );
             break;
         case VLC_VAR_GETMIN:
             if( p_var->i_type & VLC_VAR_HASMIN )
@@ -411,6 +517,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
             p_var->max = *p_val;
             p_var->ops->pf_dup( &p_var->max );
             CheckValue( p_var, &p_var->val );
+            PublishValue( p_var );
             break;
         case VLC_VAR_GETMAX:
             if( p_var->i_type & VLC_VAR_HASMAX )
@@ -427,6 +534,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
             p_var->step = *p_val;
             p_var->ops->pf_dup( &p_var->step );
             CheckValue( p_var, &p_var->val );
+            PublishValue( p_var );
             break;
         case VLC_VAR_GETSTEP:
             if( p_var->i_type & VLC_VAR_HASSTEP )
@@ -448,6 +556,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
                 strdup( p_val2->psz_string ) : NULL;
 
             CheckValue( p_var, &p_var->val );
+            PublishValue( p_var );
 
             TriggerListCallback(p_this, p_var, psz_name, VLC_VAR_ADDCHOICE, p_val);
             break;
@@ -479,6 +588,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
                          p_var->choices_text.i_count, i );
 
             CheckValue( p_var, &p_var->val );
+            PublishValue( p_var );
 
             TriggerListCallback(p_this, p_var, psz_name, VLC_VAR_DELCHOICE, p_val);
             break;
@@ -516,6 +626,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
 
             p_var->i_default = i;
             CheckValue( p_var, &p_var->val );
+            PublishValue( p_var );
             break;
         }
         case VLC_VAR_SETVALUE:
@@ -528,6 +639,7 @@ int var_Change( vlc_object_t *p_this, const char *psz_name,
             CheckValue( p_var, &newval );
             /* Set the variable */
             p_var->val = newval;
+            PublishValue( p_var );
             /* Free data if needed */
             p_var->ops->pf_free( &oldval );
             break;
@@ -641,6 +753,7 @@ int var_GetAndSet( vlc_object_t *p_this, const char *psz_name, int i_action,
 
     /*  Check boundaries */
     CheckValue( p_var, &p_var->val );
+    PublishValue( p_var );
     *p_val = p_var->val;
 
     /* Deal with callbacks.*/
@@ -720,6 +833,7 @@ int var_SetChecked( vlc_object_t *p_this, const char *psz_name,
 
     /* Set the variable */
     p_var->val = val;
+    PublishValue( p_var );
 
     /* Deal with callbacks */
     i_ret = TriggerCallback( p_this, p_var, psz_name, oldval );
@@ -754,16 +868,37 @@ int var_GetChecked( vlc_object_t *p_this, const char *psz_name,
     vlc_object_internals_t *p_priv = vlc_internals( p_this );
     variable_t *p_var;
     int err = VLC_SUCCESS;
+    bool b_string = false;
+
+    /* Other values than strings are copied atomically, without var_lock:
+     * getters never wait for setters, nor for their callbacks */
+    vlc_rwlock_rdlock( &p_priv->var_tree_lock );
+    p_var = Lookup( p_this, psz_name );
+    if( p_var != NULL )
+    {
+        assert( expected_type == 0 || p_var->ops == ClassOps( expected_type ) );
+        assert( p_var->ops != &void_ops );
+
+        b_string = p_var->ops == &string_ops;
+        if( !b_string )
+        {
+            uint_least64_t scalar = atomic_load_explicit( &p_var->scalar,
+                                                          memory_order_acquire );
+            memcpy( p_val, &scalar, sizeof (scalar) );
+        }
+    }
+    else
+        err = VLC_ENOVAR;
+    vlc_rwlock_unlock( &p_priv->var_tree_lock );
+
+    if( !b_string )
+        return err;
 
     vlc_mutex_lock( &p_priv->var_lock );
 
     p_var = Lookup( p_this, psz_name );
     if( p_var != NULL )
     {
-        assert( expected_type == 0 ||
-                (p_var->i_type & VLC_VAR_CLASS) == expected_type );
-        assert ((p_var->i_type & VLC_VAR_CLASS) != VLC_VAR_VOID);
-
         /* Really get the variable */
         *p_val = p_var->val;
 
@@ -1242,38 +1377,138 @@ static void CheckValue ( variable_t *p_var, vlc_value_t *p_val )
     }
 }
 
-/**
- * Finds the value of a variable. If the specified object does not hold a
- * variable with the specified name, try the parent object, and iterate until
- * the top of the tree. If no match is found, the value is read from the
- * configuration.
- */
-int var_Inherit( vlc_object_t *p_this, const char *psz_name, int i_type,
-                 vlc_value_t *p_val )
+/* Whether the object holds a variable of the given class */
+static bool HasVariable( vlc_object_t *obj, const char *psz_name, int i_class )
 {
-    i_type &= VLC_VAR_CLASS;
-    for( vlc_object_t *obj = p_this; obj != NULL; obj = obj->p_parent )
+    vlc_object_internals_t *p_priv = vlc_internals( obj );
+
+    vlc_rwlock_rdlock( &p_priv->var_tree_lock );
+    variable_t *p_var = Lookup( obj, psz_name );
+    bool b_found = p_var != NULL && p_var->ops == ClassOps( i_class );
+    vlc_rwlock_unlock( &p_priv->var_tree_lock );
+    return b_found;
+}
+
+/* Finds which of the object and its parents holds a variable, or else its
+ * configuration item, through the cache of the object */
+static void InheritLookup( vlc_object_t *p_obj, const char *psz_name,
+                           int i_class, vlc_object_t **pp_holder,
+                           module_config_t **pp_item )
+{
+    vlc_object_internals_t *p_priv = vlc_internals( p_obj );
+    const unsigned i_var_gen = atomic_load( &inherit_generation );
+    const unsigned i_config_gen = atomic_load( &config_generation );
+    const uint32_t i_hash = VarHash( psz_name );
+    struct inherit_entry_t *p_entry = NULL;
+
+    vlc_mutex_lock( &p_priv->inherit_lock );
+    if( p_priv->inherit_cache == NULL )
+        p_priv->inherit_cache = calloc( INHERIT_CACHE_SIZE,
+                                        sizeof (*p_priv->inherit_cache) );
+    if( likely(p_priv->inherit_cache != NULL) )
     {
-        if( var_GetChecked( obj, psz_name, i_type, p_val ) == VLC_SUCCESS )
-            return VLC_SUCCESS;
+        p_entry = &p_priv->inherit_cache[( i_hash ^ i_class )
+                                         % INHERIT_CACHE_SIZE];
+        if( p_entry->psz_name != NULL
+         && p_entry->i_var_gen == i_var_gen
+         && p_entry->i_config_gen == i_config_gen
+         && p_entry->i_hash == i_hash && p_entry->i_class == i_class
+         && !strcmp( p_entry->psz_name, psz_name ) )
+        {
+            *pp_holder = p_entry->p_holder;
+            *pp_item = p_entry->p_item;
+            vlc_mutex_unlock( &p_priv->inherit_lock );
+            return;
+        }
     }
+    vlc_mutex_unlock( &p_priv->inherit_lock );
 
-    /* else take value from config */
-    switch( i_type & VLC_VAR_CLASS )
+    vlc_object_t *p_holder = NULL;
+    for( vlc_object_t *obj = p_obj; obj != NULL; obj = obj->p_parent )
+        if( HasVariable( obj, psz_name, i_class ) )
+        {
+            p_holder = obj;
+            break;
+        }
+    module_config_t *p_item = NULL;
+    if( p_holder == NULL )
+        p_item = config_FindConfig( p_obj, psz_name );
+
+    *pp_holder = p_holder;
+    *pp_item = p_item;
+
+    if( p_entry == NULL )
+        return;
+    char *psz_dup = strdup( psz_name );
+    if( unlikely(psz_dup == NULL) )
+        return;
+
+    /* Stored with the generations from before the walk: if anything changed
+     * meanwhile, the entry is already stale */
+    vlc_mutex_lock( &p_priv->inherit_lock );
+    free( p_entry->psz_name );
+    p_entry->psz_name = psz_dup;
+    p_entry->i_hash = i_hash;
+    p_entry->i_class = i_class;
+    p_entry->i_var_gen = i_var_gen;
+    p_entry->i_config_gen = i_config_gen;
+    p_entry->p_holder = p_holder;
+    p_entry->p_item = p_item;
+    vlc_mutex_unlock( &p_priv->inherit_lock );
+}
+
+/* Reads an inherited value from its configuration item, if any */
+static int InheritConfig( vlc_object_t *p_this, const char *psz_name,
+                          const module_config_t *p_item, int i_class,
+                          vlc_value_t *p_val )
+{
+    /* Without a suitable item, config_Get*() report the error */
+    switch( i_class )
     {
         case VLC_VAR_STRING:
-            p_val->psz_string = config_GetPsz( p_this, psz_name );
-            if( !p_val->psz_string ) p_val->psz_string = strdup("");
+            if( p_item != NULL && IsConfigStringType( p_item->i_type ) )
+            {
+                vlc_rwlock_rdlock( &config_lock );
+                p_val->psz_string = strdup( p_item->value.psz != NULL
+                                            ? p_item->value.psz : "" );
+                vlc_rwlock_unlock( &config_lock );
+            }
+            else
+            {
+                p_val->psz_string = config_GetPsz( p_this, psz_name );
+                if( !p_val->psz_string ) p_val->psz_string = strdup("");
+            }
             break;
         case VLC_VAR_FLOAT:
-            p_val->f_float = config_GetFloat( p_this, psz_name );
+            if( p_item != NULL && IsConfigFloatType( p_item->i_type ) )
+            {
+                vlc_rwlock_rdlock( &config_lock );
+                p_val->f_float = p_item->value.f;
+                vlc_rwlock_unlock( &config_lock );
+            }
+            else
+                p_val->f_float = config_GetFloat( p_this, psz_name );
             break;
         case VLC_VAR_INTEGER:
-            p_val->i_int = config_GetInt( p_this, psz_name );
-            break;
         case VLC_VAR_BOOL:
-            p_val->b_bool = config_GetInt( p_this, psz_name );
+        {
+            int64_t i_value;
+
+            if( p_item != NULL && IsConfigIntegerType( p_item->i_type ) )
+            {
+                vlc_rwlock_rdlock( &config_lock );
+                i_value = p_item->value.i;
+                vlc_rwlock_unlock( &config_lock );
+            }
+            else
+                i_value = config_GetInt( p_this, psz_name );
+
+            if( i_class == VLC_VAR_BOOL )
+                p_val->b_bool = i_value;
+            else
+                p_val->i_int = i_value;
             break;
+        }
         default:
             assert(0);
         case VLC_VAR_ADDRESS:
@@ -1282,6 +1517,41 @@ int var_Inherit( vlc_object_t *p_this, const char *psz_name, int i_type,
     return VLC_SUCCESS;
 }
 
+/**
+ * Finds the value of a variable. If the specified object does not hold a
+ * variable with the specified name, try the parent object, and iterate until
+ * the top of the tree. If no match is found, the value is read from the
+ * configuration. Where the value of the parent is found is cached.
+ */
+int var_Inherit( vlc_object_t *p_this, const char *psz_name, int i_type,
+                 vlc_value_t *p_val )
+{
+    i_type &= VLC_VAR_CLASS;
+    if( var_GetChecked( p_this, psz_name, i_type, p_val ) == VLC_SUCCESS )
+        return VLC_SUCCESS;
+
+    vlc_object_t *p_holder = NULL;
+    module_config_t *p_item = NULL;
+
+    if( p_this->p_parent != NULL )
+        InheritLookup( p_this->p_parent, psz_name, i_type, &p_holder,
+                       &p_item );
+    else
+        p_item = config_FindConfig( p_this, psz_name );
+
+    if( p_holder != NULL )
+    {
+        if( var_GetChecked( p_holder, psz_name, i_type, p_val )
+                                                            == VLC_SUCCESS )
+            return VLC_SUCCESS;
+        /* Destroyed in the meantime */
+        p_item = config_FindConfig( p_this, psz_name );
+    }
+
+    /* else take value from config */
+    return InheritConfig( p_this, psz_name, p_item, i_type, p_val );
+}
+
 
 /**
  * It inherits a string as an unsigned rational number (it also accepts basic
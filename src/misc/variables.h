@@ -38,6 +38,12 @@ struct vlc_object_internals
     void           *var_root;
     vlc_mutex_t     var_lock;
     vlc_cond_t      var_wait;
+    vlc_rwlock_t    var_tree_lock; /* var_root changes, inside var_lock */
+
+    /* Where the variables inherited by the children are found */
+    vlc_mutex_t     inherit_lock;
+    struct inherit_entry_t *inherit_cache; /* allocated on first use */
+    atomic_bool     has_children; /* ever had, for var_Create() */
 
     /* Objects thread synchronization */
     int             pipes[2];
@@ -79,9 +85,12 @@ typedef struct callback_table_t
 struct variable_t
 {
     char *       psz_name; /**< The variable unique name (must be first) */
+    uint32_t     i_hash;   /**< Hash of the name (must be second) */
 
     /** The variable's exported value */
     vlc_value_t  val;
+    /** Copy of a non-string value, readable without var_lock */
+    atomic_uint_least64_t scalar;
 
     /** The variable display name, mainly for use by the interfaces */
     char *       psz_text;
@@ -41,16 +41,29 @@
 #include <vlc_plugin.h>
 #include <vlc_modules.h>
 #include <vlc_fs.h>
+#include <vlc_block.h>
 #include "libvlc.h"
 #include "config/configuration.h"
 #include "modules/modules.h"
 
+/** Modules of a given capability, by decreasing score */
+typedef struct
+{
+    const char *name; /**< Capability, interned from one of the modules */
+    module_t **modv;
+    size_t modc;
+} vlc_modcap_t;
+
 static struct
 {
     vlc_mutex_t lock;
     module_t *head;
     unsigned usage;
-} modules = { VLC_STATIC_MUTEX, NULL, 0 };
+    block_t *caches; /**< Mapped plugins caches, referred to by modules */
+    vlc_modcap_t *caps; /**< Capabilities, sorted by name */
+    size_t capc;
+    module_t **capmods; /**< Modules, sorted by capability then score */
+} modules = { VLC_STATIC_MUTEX, NULL, 0, NULL, NULL, 0, NULL };
 
 /*****************************************************************************
  * Local prototypes
@@ -59,6 +72,8 @@ static struct
 static void AllocateAllPlugins (vlc_object_t *);
 #endif
 static module_t *module_InitStatic (vlc_plugin_cb);
+static void module_SortCaps (void);
+static void module_FreeCaps (void);
 
 static void module_StoreBank (module_t *module)
 {
@@ -111,6 +126,7 @@ void module_InitBank (void)
         if (likely(module != NULL))
             module_StoreBank (module);
         config_SortConfig ();
+        module_SortCaps ();
     }
     modules.usage++;
 
@@ -131,6 +147,7 @@ void module_InitBank (void)
 void module_EndBank (bool b_plugins)
 {
     module_t *head = NULL;
+    block_t *caches = NULL;
 
     /* If plugins were _not_ loaded, then the caller still has the bank lock
      * from module_InitBank(). */
@@ -143,8 +160,11 @@ void module_EndBank (bool b_plugins)
     if (--modules.usage == 0)
     {
         config_UnsortConfig ();
+        module_FreeCaps ();
         head = modules.head;
         modules.head = NULL;
+        caches = modules.caches;
+        modules.caches = NULL;
     }
     vlc_mutex_unlock (&modules.lock);
 
@@ -162,6 +182,7 @@ void module_EndBank (bool b_plugins)
 #endif
         vlc_module_destroy (module);
     }
+    block_ChainRelease (caches);
 }
 
 #undef module_LoadPlugins
@@ -185,6 +206,7 @@ size_t module_LoadPlugins (vlc_object_t *obj)
 #endif
         config_UnsortConfig ();
         config_SortConfig ();
+        module_SortCaps ();
     }
     vlc_mutex_unlock (&modules.lock);
 
@@ -242,52 +264,108 @@ module_t **module_list_get (size_t *n)
 static int modulecmp (const void *a, const void *b)
 {
     const module_t *const *ma = a, *const *mb = b;
+    int ret = strcmp (module_get_capability (*ma),
+                      module_get_capability (*mb));
+    if (ret)
+        return ret;
     /* Note that qsort() uses _ascending_ order,
      * so the smallest module is the one with the biggest score. */
     return (*mb)->i_score - (*ma)->i_score;
 }
 
+static int capcmp (const void *key, const void *cap)
+{
+    return strcmp (key, ((const vlc_modcap_t *)cap)->name);
+}
+
+static void module_FreeCaps (void)
+{
+    free (modules.capmods);
+    free (modules.caps);
+    modules.capmods = NULL;
+    modules.caps = NULL;
+    modules.capc = 0;
+}
+
+/**
+ * Sorts the modules of the bank by capability, so that the modules of a
+ * capability can be looked up without allocating nor sorting anything.
+ * The bank lock must be held.
+ */
+static void module_SortCaps (void)
+{
+    size_t n;
+    module_t **tab = module_list_get (&n);
+
+    module_FreeCaps ();
+    if (unlikely(tab == NULL))
+        return;
+
+    qsort (tab, n, sizeof (*tab), modulecmp);
+
+    size_t capc = 0;
+    for (size_t i = 0; i < n; i++)
+        if (i == 0 || strcmp (module_get_capability (tab[i - 1]),
+                              module_get_capability (tab[i])))
+            capc++;
+
+    vlc_modcap_t *caps = malloc (capc * sizeof (*caps));
+    if (unlikely(caps == NULL))
+    {
+        free (tab);
+        return;
+    }
+
+    vlc_modcap_t *cap = caps - 1;
+    for (size_t i = 0; i < n; i++)
+    {
+        const char *name = module_get_capability (tab[i]);
+
+        if (i == 0 || strcmp (cap->name, name))
+        {
+            cap++;
+            cap->name = name;
+            cap->modv = tab + i;
+            cap->modc = 0;
+        }
+        cap->modc++;
+    }
+    assert (cap == caps + capc - 1 || capc == 0);
+
+    modules.capmods = tab;
+    modules.caps = caps;
+    modules.capc = capc;
+}
+
 /**
- * Builds a sorted list of all VLC modules with a given capability.
+ * Gets the sorted list of all VLC modules with a given capability.
  * The list is sorted from the highest module score to the lowest.
  * @param list pointer to the table of modules [OUT]
  * @param cap capability of modules to look for
  * @return the number of matching found, or -1 on error (*list is then NULL).
- * @note *list must be freed with module_list_free().
+ * @note The list belongs to the module bank and must not be modified nor
+ * freed. It remains valid until the bank is released.
  */
-ssize_t module_list_cap (module_t ***restrict list, const char *cap)
+ssize_t module_list_cap (module_t *const **restrict list, const char *cap)
 {
-    /* TODO: This is quite inefficient. List should be sorted by capability. */
-    ssize_t n = 0;
-
     assert (list != NULL);
 
-    for (module_t *mod = modules.head; mod != NULL; mod = mod->next)
+    if (unlikely(modules.capmods == NULL))
     {
-         if (module_provides (mod, cap))
-             n++;
-         for (module_t *subm = mod->submodule; subm != NULL; subm = subm->next)
-             if (module_provides (subm, cap))
-                 n++;
-    }
-
-    module_t **tab = malloc (sizeof (*tab) * n);
-    *list = tab;
-    if (unlikely(tab == NULL))
+        *list = NULL;
         return -1;
+    }
 
-    for (module_t *mod = modules.head; mod != NULL; mod = mod->next)
+    const vlc_modcap_t *c = bsearch (cap, modules.caps, modules.capc,
+                                     sizeof (*c), capcmp);
+    if (c == NULL)
     {
-         if (module_provides (mod, cap))
-             *(tab++)= mod;
-         for (module_t *subm = mod->submodule; subm != NULL; subm = subm->next)
-             if (module_provides (subm, cap))
-                 *(tab++) = subm;
+        *list = NULL;
+        return 0;
     }
 
-    assert (tab == *list + n);
-    qsort (*list, n, sizeof (*tab), modulecmp);
-    return n;
+    *list = c->modv;
+    return c->modc;
 }
 
 #ifdef HAVE_DYNAMIC_PLUGINS
@@ -359,6 +437,7 @@ typedef struct module_bank
 
     int            i_loaded_cache;
     module_cache_t *loaded_cache;
+    size_t         i_cache_hits;
 } module_bank_t;
 
 static void AllocatePluginDir (module_bank_t *, unsigned,
@@ -373,12 +452,13 @@ static void AllocatePluginPath (vlc_object_t *p_this, const char *path,
 {
     module_bank_t bank;
     module_cache_t *cache = NULL;
+    block_t *map = NULL;
     size_t count = 0;
 
     switch( mode )
     {
         case CACHE_USE:
-            count = CacheLoad( p_this, path, &cache );
+            count = CacheLoad( p_this, path, &cache, &map );
             break;
         case CACHE_RESET:
             CacheDelete( p_this, path );
@@ -396,6 +476,7 @@ static void AllocatePluginPath (vlc_object_t *p_this, const char *path,
     bank.i_cache = 0;
     bank.loaded_cache = cache;
     bank.i_loaded_cache = count;
+    bank.i_cache_hits = 0;
 
     /* Don't go deeper than 5 subdirectories */
     AllocatePluginDir (&bank, 5, path, NULL);
@@ -403,14 +484,28 @@ static void AllocatePluginPath (vlc_object_t *p_this, const char *path,
     switch( mode )
     {
         case CACHE_USE:
-            /* Discard unmatched cache entries */
+            /* Discard unmatched cache entries. Their paths, like the strings
+             * of the matched modules, are in the cache mapping. */
             for( size_t i = 0; i < count; i++ )
-            {
                 if (cache[i].p_module != NULL)
                    vlc_module_destroy (cache[i].p_module);
-                free (cache[i].path);
-            }
             free( cache );
+
+            if( map != NULL )
+            {
+                /*vlc_assert_locked (&modules.lock);*/
+                block_ChainAppend( &modules.caches, map );
+            }
+
+            /* Do not rewrite an up to date cache */
+            if( bank.i_cache_hits == count && bank.i_cache == count )
+            {
+                for( size_t i = 0; i < bank.i_cache; i++ )
+                    free( bank.cache[i].path );
+                free( bank.cache );
+                break;
+            }
+            /* fall through */
         case CACHE_RESET:
             CacheSave (p_this, path, bank.cache, bank.i_cache);
         case CACHE_IGNORE:
@@ -514,6 +609,7 @@ static int AllocatePluginFile (module_bank_t *bank, const char *abspath,
                             relpath, st);
         if (module != NULL)
         {
+            bank->i_cache_hits++;
             module->psz_filename = strdup (abspath);
             if (unlikely(module->psz_filename == NULL))
             {
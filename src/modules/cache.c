@@ -37,6 +37,7 @@
 #include <assert.h>
 
 #include <vlc_common.h>
+#include <vlc_block.h>
 #include "libvlc.h"
 
 #include <vlc_plugin.h>
@@ -55,7 +56,7 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 22
+#define CACHE_SUBVERSION_NUM 23
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
@@ -76,144 +77,301 @@ void CacheDelete( vlc_object_t *obj, const char *dir )
     free( path );
 }
 
-#define LOAD_IMMEDIATE(a) \
-    if (fread (&(a), sizeof (char), sizeof (a), file) != sizeof (a)) \
-        goto error
-#define LOAD_FLAG(a) \
-    do { \
-        unsigned char b; \
-        LOAD_IMMEDIATE(b); \
-        if (b > 1) \
-            goto error; \
-        (a) = b; \
-    } while (0)
-
-static int CacheLoadString (char **p, FILE *file)
+/*
+ * The cache is a flat, position-independent image of the module descriptors.
+ * It is loaded with a single mapping of the file, and the descriptor strings
+ * are used in place: only the module and configuration tables, and the
+ * mutable configuration values, are allocated.
+ *
+ * All references within the file are 32-bits offsets from its start, 0 being
+ * NULL. Records are aligned on 8 bytes. The file ends with a nul byte, so
+ * that any string offset within the file reads a terminated string.
+ */
+typedef struct
 {
-    char *psz = NULL;
-    uint16_t size;
+    uint32_t magic;
+    uint32_t size; /**< File size */
+    uint32_t plugins; /**< Offset of the cache_plugin_t table */
+    uint32_t plugin_count;
+} cache_header_t;
 
-    LOAD_IMMEDIATE (size);
-    if (size > 16384)
-    {
-error:
+typedef struct
+{
+    int64_t  mtime;
+    int64_t  size;
+    uint32_t path;
+    uint32_t module; /**< Offset of a cache_module_t */
+} cache_plugin_t;
+
+typedef struct
+{
+    uint32_t shortname;
+    uint32_t longname;
+    uint32_t help;
+    uint32_t capability;
+    uint32_t domain;
+    int32_t  score;
+    uint32_t shortcuts; /**< Offset of a table of string offsets */
+    uint32_t shortcut_count;
+    uint32_t config; /**< Offset of a cache_config_t table */
+    uint32_t confsize;
+    uint32_t config_items;
+    uint32_t bool_items;
+    uint32_t submodules; /**< Offset of a cache_module_t table */
+    uint32_t submodule_count;
+    uint8_t  unloadable;
+} cache_module_t;
+
+typedef struct
+{
+    module_value_t orig; /**< Unless a string */
+    module_value_t min;
+    module_value_t max;
+    void    *list_cb; /* XXX: see CacheLoadConfig() */
+    uint32_t type;
+    uint32_t flags;
+    uint32_t psz_type;
+    uint32_t psz_name;
+    uint32_t psz_text;
+    uint32_t psz_longtext;
+    uint32_t psz_orig;
+    uint32_t list_count;
+    uint32_t list; /**< Offset of an integer or string offset table */
+    uint32_t list_text; /**< Offset of a string offset table */
+    char     i_short;
+} cache_config_t;
+
+#define CACHE_MAGIC 0x56434301 /* detects byte order mismatches */
+
+#define CONFIG_ADVANCED   0x01
+#define CONFIG_INTERNAL   0x02
+#define CONFIG_UNSAVEABLE 0x04
+#define CONFIG_SAFE       0x08
+#define CONFIG_REMOVED    0x10
+
+/**
+ * Returns a pointer to a table of count records of the given size, or NULL
+ * if the table is not entirely within the cache.
+ */
+static const void *CacheGet (const block_t *map, uint32_t offset,
+                             size_t size, size_t count)
+{
+    if (offset == 0 || (offset & 7) || offset > map->i_buffer
+     || count > (map->i_buffer - offset) / size)
+        return NULL;
+    return map->p_buffer + offset;
+}
+
+static int CacheLoadString (char **p, const block_t *map, uint32_t offset)
+{
+    if (offset >= map->i_buffer)
         return -1;
-    }
+    *p = (offset != 0) ? (char *)map->p_buffer + offset : NULL;
+    return 0;
+}
+
+#define LOAD_STRING(a, offset) \
+    if (CacheLoadString (&(a), map, offset)) goto error
+
+/**
+ * Loads a table of strings. NULL entries are replaced with empty strings.
+ */
+static char **CacheLoadStrings (const block_t *map, uint32_t offset,
+                                size_t count)
+{
+    if (count == 0)
+        return NULL;
+
+    const uint32_t *offsets = CacheGet (map, offset, sizeof (*offsets), count);
+    if (offsets == NULL)
+        return NULL;
+
+    char **tab = malloc (count * sizeof (*tab));
+    if (unlikely(tab == NULL))
+        return NULL;
 
-    if (size > 0)
+    for (size_t i = 0; i < count; i++)
     {
-        psz = malloc (size+1);
-        if (unlikely(psz == NULL))
-            goto error;
-        if (fread (psz, 1, size, file) != size)
+        if (CacheLoadString (&tab[i], map, offsets[i]))
         {
-            free (psz);
-            goto error;
+            free (tab);
+            return NULL;
         }
-        psz[size] = '\0';
+        if (tab[i] == NULL)
+            tab[i] = (char *)"";
     }
-    *p = psz;
-    return 0;
+    return tab;
 }
 
-#define LOAD_STRING(a) \
-    if (CacheLoadString (&(a), file)) goto error
-
-static int CacheLoadConfig (module_config_t *cfg, FILE *file)
+static int CacheLoadConfig (module_config_t *cfg, const block_t *map,
+                            const cache_config_t *rec)
 {
-    LOAD_IMMEDIATE (cfg->i_type);
-    LOAD_IMMEDIATE (cfg->i_short);
-    LOAD_FLAG (cfg->b_advanced);
-    LOAD_FLAG (cfg->b_internal);
-    LOAD_FLAG (cfg->b_unsaveable);
-    LOAD_FLAG (cfg->b_safe);
-    LOAD_FLAG (cfg->b_removed);
-    LOAD_STRING (cfg->psz_type);
-    LOAD_STRING (cfg->psz_name);
-    LOAD_STRING (cfg->psz_text);
-    LOAD_STRING (cfg->psz_longtext);
-    LOAD_IMMEDIATE (cfg->list_count);
+    cfg->i_type = rec->type;
+    cfg->i_short = rec->i_short;
+    cfg->b_advanced = (rec->flags & CONFIG_ADVANCED) != 0;
+    cfg->b_internal = (rec->flags & CONFIG_INTERNAL) != 0;
+    cfg->b_unsaveable = (rec->flags & CONFIG_UNSAVEABLE) != 0;
+    cfg->b_safe = (rec->flags & CONFIG_SAFE) != 0;
+    cfg->b_removed = (rec->flags & CONFIG_REMOVED) != 0;
+    LOAD_STRING (cfg->psz_type, rec->psz_type);
+    LOAD_STRING (cfg->psz_name, rec->psz_name);
+    LOAD_STRING (cfg->psz_text, rec->psz_text);
+    LOAD_STRING (cfg->psz_longtext, rec->psz_longtext);
+    if (rec->list_count > UINT16_MAX)
+        goto error;
+    cfg->list_count = rec->list_count;
+    cfg->list.psz = NULL;
+    cfg->list_text = NULL;
 
     if (IsConfigStringType (cfg->i_type))
     {
-        LOAD_STRING (cfg->orig.psz);
+        LOAD_STRING (cfg->orig.psz, rec->psz_orig);
+        /* The value is the only string that can change */
         if (cfg->orig.psz != NULL)
+        {
             cfg->value.psz = strdup (cfg->orig.psz);
+            if (unlikely(cfg->value.psz == NULL))
+                goto error;
+        }
         else
             cfg->value.psz = NULL;
 
         if (cfg->list_count)
-            cfg->list.psz = xmalloc (cfg->list_count * sizeof (char *));
-        else /* TODO: fix config_GetPszChoices() instead of this hack: */
-            LOAD_IMMEDIATE(cfg->list.psz_cb);
-        for (unsigned i = 0; i < cfg->list_count; i++)
         {
-            LOAD_STRING (cfg->list.psz[i]);
-            if (cfg->list.psz[i] == NULL /* NULL -> empty string */
-             && (cfg->list.psz[i] = calloc (1, 1)) == NULL)
+            cfg->list.psz = CacheLoadStrings (map, rec->list, cfg->list_count);
+            if (cfg->list.psz == NULL)
                 goto error;
         }
+        else /* TODO: fix config_GetPszChoices() instead of this hack: */
+            cfg->list.psz_cb = rec->list_cb;
     }
     else
     {
-        LOAD_IMMEDIATE (cfg->orig);
-        LOAD_IMMEDIATE (cfg->min);
-        LOAD_IMMEDIATE (cfg->max);
+        cfg->orig = rec->orig;
+        cfg->min = rec->min;
+        cfg->max = rec->max;
         cfg->value = cfg->orig;
 
         if (cfg->list_count)
-            cfg->list.i = xmalloc (cfg->list_count * sizeof (int));
+        {
+            /* Integer lists are used in place */
+            cfg->list.i = (int *)CacheGet (map, rec->list, sizeof (int),
+                                           cfg->list_count);
+            if (cfg->list.i == NULL)
+                goto error;
+        }
         else /* TODO: fix config_GetPszChoices() instead of this hack: */
-            LOAD_IMMEDIATE(cfg->list.i_cb);
-        for (unsigned i = 0; i < cfg->list_count; i++)
-             LOAD_IMMEDIATE (cfg->list.i[i]);
+            cfg->list.i_cb = (vlc_integer_list_cb)rec->list_cb;
     }
-    cfg->list_text = xmalloc (cfg->list_count * sizeof (char *));
-    for (unsigned i = 0; i < cfg->list_count; i++)
+
+    if (cfg->list_count)
     {
-        LOAD_STRING (cfg->list_text[i]);
-        if (cfg->list_text[i] == NULL /* NULL -> empty string */
-         && (cfg->list_text[i] = calloc (1, 1)) == NULL)
+        cfg->list_text = CacheLoadStrings (map, rec->list_text,
+                                           cfg->list_count);
+        if (cfg->list_text == NULL)
             goto error;
     }
-
     return 0;
 error:
-    return -1; /* FIXME: leaks */
+    return -1;
 }
 
-static int CacheLoadModuleConfig (module_t *module, FILE *file)
+static int CacheLoadModuleConfig (module_t *module, const block_t *map,
+                                  const cache_module_t *rec)
 {
-    uint16_t lines;
+    module->i_config_items = rec->config_items;
+    module->i_bool_items = rec->bool_items;
+    if (rec->confsize == 0)
+        return 0;
+
+    const cache_config_t *cfg = CacheGet (map, rec->config, sizeof (*cfg),
+                                          rec->confsize);
+    if (cfg == NULL || rec->confsize > UINT16_MAX)
+        return -1;
 
-    /* Calculate the structure length */
-    LOAD_IMMEDIATE (module->i_config_items);
-    LOAD_IMMEDIATE (module->i_bool_items);
-    LOAD_IMMEDIATE (lines);
+    /* Zeroed, so that the table can be freed at any point */
+    module->p_config = calloc (rec->confsize, sizeof (module_config_t));
+    if (unlikely(module->p_config == NULL))
+        return -1;
 
-    /* Allocate memory */
-    if (lines)
+    for (size_t i = 0; i < rec->confsize; i++)
     {
-        module->p_config = malloc (lines * sizeof (module_config_t));
-        if (unlikely(module->p_config == NULL))
-        {
-            module->confsize = 0;
+        module->confsize = i + 1;
+        if (CacheLoadConfig (module->p_config + i, map, cfg + i))
             return -1;
-        }
     }
-    else
-        module->p_config = NULL;
-    module->confsize = lines;
+    return 0;
+}
 
-    /* Do the duplication job */
-    for (size_t i = 0; i < lines; i++)
-        if (CacheLoadConfig (module->p_config + i, file))
-            return -1;
+static int CacheLoadShortcuts (module_t *module, const block_t *map,
+                               const cache_module_t *rec)
+{
+    if (rec->shortcut_count > MODULE_SHORTCUT_MAX)
+        return -1;
+    module->pp_shortcuts = CacheLoadStrings (map, rec->shortcuts,
+                                             rec->shortcut_count);
+    if (module->pp_shortcuts == NULL && rec->shortcut_count > 0)
+        return -1;
+    module->i_shortcuts = rec->shortcut_count;
     return 0;
-error:
-    return -1; /* FIXME: leaks */
 }
 
+/**
+ * Creates a module descriptor from a cache record. The descriptor strings
+ * remain in the cache.
+ */
+static module_t *CacheLoadModule (const block_t *map,
+                                  const cache_module_t *rec)
+{
+    module_t *module = vlc_module_create (NULL);
+    if (unlikely(module == NULL))
+        return NULL;
+    module->b_mapped = true;
+
+    LOAD_STRING(module->psz_shortname, rec->shortname);
+    LOAD_STRING(module->psz_longname, rec->longname);
+    LOAD_STRING(module->psz_help, rec->help);
+    if (CacheLoadShortcuts (module, map, rec))
+        goto error;
+    LOAD_STRING(module->psz_capability, rec->capability);
+    module->i_score = rec->score;
+    module->b_unloadable = rec->unloadable != 0;
+
+    /* Config stuff */
+    if (CacheLoadModuleConfig (module, map, rec))
+        goto error;
+
+    LOAD_STRING(module->domain, rec->domain);
+    if (module->domain != NULL)
+        vlc_bindtextdomain (module->domain);
+
+    const cache_module_t *subrec = CacheGet (map, rec->submodules,
+                                             sizeof (*subrec),
+                                             rec->submodule_count);
+    if (subrec == NULL && rec->submodule_count > 0)
+        goto error;
+
+    /* Submodules are prepended, so create the last one first */
+    for (size_t i = rec->submodule_count; i-- > 0;)
+    {
+        module_t *submodule = vlc_module_create (module);
+        if (unlikely(submodule == NULL))
+            goto error;
+        submodule->b_mapped = true;
+
+        LOAD_STRING(submodule->psz_shortname, subrec[i].shortname);
+        LOAD_STRING(submodule->psz_longname, subrec[i].longname);
+        if (CacheLoadShortcuts (submodule, map, subrec + i))
+            goto error;
+        LOAD_STRING(submodule->psz_capability, subrec[i].capability);
+        submodule->i_score = subrec[i].score;
+    }
+    return module;
+
+error:
+    vlc_module_destroy (module);
+    return NULL;
+}
 
 /**
  * Loads a plugins cache file.
@@ -222,26 +380,28 @@ error:
  * will in turn be queried by AllocateAllPlugins() to see if it needs to
  * actually load the dynamically loadable module.
  * This allows us to only fully load plugins when they are actually used.
+ *
+ * The cache entries and the modules refer to the cache file content, which is
+ * returned in *mapp. It must be kept until the modules are destroyed.
  */
-size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r )
+size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r,
+                  block_t **mapp )
 {
     char *psz_filename;
-    FILE *file;
-    int i_size, i_read;
-    char p_cachestring[sizeof(CACHE_STRING)];
-    size_t i_cache;
-    int32_t i_marker;
+    block_t *map;
+    size_t i_size;
 
     assert( dir != NULL );
 
     *r = NULL;
+    *mapp = NULL;
     if( asprintf( &psz_filename, "%s"DIR_SEP CACHE_NAME, dir ) == -1 )
         return 0;
 
     msg_Dbg( p_this, "loading plugins cache file %s", psz_filename );
 
-    file = vlc_fopen( psz_filename, "rb" );
-    if( !file )
+    map = block_FilePath( psz_filename );
+    if( map == NULL )
     {
         msg_Warn( p_this, "cannot read %s: %s", psz_filename,
                   vlc_strerror_c(errno) );
@@ -250,230 +410,262 @@ size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r )
     }
     free( psz_filename );
 
+    const uint8_t *p = map->p_buffer;
+    size_t i_left = map->i_buffer;
+
     /* Check the file is a plugins cache */
     i_size = sizeof(CACHE_STRING) - 1;
-    i_read = fread( p_cachestring, 1, i_size, file );
-    if( i_read != i_size ||
-        memcmp( p_cachestring, CACHE_STRING, i_size ) )
-    {
-        msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
-        fclose( file );
-        return 0;
-    }
+    if( i_left < i_size || memcmp( p, CACHE_STRING, i_size ) )
+        goto invalid;
+    p += i_size;
+    i_left -= i_size;
 
 #ifdef DISTRO_VERSION
     /* Check for distribution specific version */
-    char p_distrostring[sizeof( DISTRO_VERSION )];
     i_size = sizeof( DISTRO_VERSION ) - 1;
-    i_read = fread( p_distrostring, 1, i_size, file );
-    if( i_read != i_size ||
-        memcmp( p_distrostring, DISTRO_VERSION, i_size ) )
-    {
-        msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
-        fclose( file );
-        return 0;
-    }
+    if( i_left < i_size || memcmp( p, DISTRO_VERSION, i_size ) )
+        goto invalid;
+    p += i_size;
+    i_left -= i_size;
 #endif
 
-    /* Check Sub-version number */
-    i_read = fread( &i_marker, 1, sizeof(i_marker), file );
-    if( i_read != sizeof(i_marker) || i_marker != CACHE_SUBVERSION_NUM )
+    /* Check Sub-version number and header marker */
+    uint32_t i_marker[2];
+    if( i_left < sizeof(i_marker) )
+        goto invalid;
+    memcpy( i_marker, p, sizeof(i_marker) );
+    if( i_marker[0] != CACHE_SUBVERSION_NUM
+     || i_marker[1] != (uint32_t)(p + 4 - map->p_buffer) )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache "
                   "(corrupted header)" );
-        fclose( file );
+        block_Release( map );
         return 0;
     }
 
-    /* Check header marker */
-    i_read = fread( &i_marker, 1, sizeof(i_marker), file );
-    if( i_read != sizeof(i_marker) ||
-        i_marker != ftell( file ) - (int)sizeof(i_marker) )
+    const cache_header_t *hdr = CacheGet( map, (p + 8 - map->p_buffer + 7) & ~7,
+                                          sizeof(*hdr), 1 );
+    if( hdr == NULL || hdr->magic != CACHE_MAGIC
+     || hdr->size != map->i_buffer || map->p_buffer[map->i_buffer - 1] != 0 )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache "
-                  "(corrupted header)" );
-        fclose( file );
+                  "(file too short)" );
+        block_Release( map );
         return 0;
     }
 
-    if (fread( &i_cache, 1, sizeof(i_cache), file ) != sizeof(i_cache) )
+    const cache_plugin_t *plugin = NULL;
+    if( hdr->plugin_count > 0 )
     {
-        msg_Warn( p_this, "This doesn't look like a valid plugins cache "
-                  "(file too short)" );
-        fclose( file );
-        return 0;
+        plugin = CacheGet( map, hdr->plugins, sizeof(*plugin),
+                           hdr->plugin_count );
+        if( plugin == NULL )
+            goto error;
     }
 
-    module_cache_t *cache = NULL;
-
-    for (size_t count = 0; count < i_cache;)
+    module_cache_t *cache = malloc( hdr->plugin_count * sizeof(*cache) );
+    if( unlikely(cache == NULL) && hdr->plugin_count > 0 )
     {
-        module_t *module;
-        int i_submodules;
-
-        module = vlc_module_create (NULL);
-
-        /* Load additional infos */
-        LOAD_STRING(module->psz_shortname);
-        LOAD_STRING(module->psz_longname);
-        LOAD_STRING(module->psz_help);
+        block_Release( map );
+        return 0;
+    }
 
-        LOAD_IMMEDIATE(module->i_shortcuts);
-        if (module->i_shortcuts > MODULE_SHORTCUT_MAX)
-            goto error;
-        else
+    for( size_t i = 0; i < hdr->plugin_count; i++ )
+    {
+        const cache_module_t *rec = CacheGet( map, plugin[i].module,
+                                              sizeof(*rec), 1 );
+        module_t *module = NULL;
+
+        if( rec == NULL || CacheLoadString( &cache[i].path, map,
+                                            plugin[i].path )
+         || cache[i].path == NULL
+         || (module = CacheLoadModule( map, rec )) == NULL )
         {
-            module->pp_shortcuts =
-                              xmalloc (sizeof (*module->pp_shortcuts) * module->i_shortcuts);
-            for (unsigned j = 0; j < module->i_shortcuts; j++)
-                LOAD_STRING(module->pp_shortcuts[j]);
+            while( i > 0 )
+                vlc_module_destroy( cache[--i].p_module );
+            free( cache );
+            goto error;
         }
+        cache[i].mtime = plugin[i].mtime;
+        cache[i].size = plugin[i].size;
+        cache[i].p_module = module;
+    }
 
-        LOAD_STRING(module->psz_capability);
-        LOAD_IMMEDIATE(module->i_score);
-        LOAD_IMMEDIATE(module->b_unloadable);
-
-        /* Config stuff */
-        if (CacheLoadModuleConfig (module, file) != VLC_SUCCESS)
-            goto error;
+    *r = cache;
+    *mapp = map;
+    return hdr->plugin_count;
 
-        LOAD_STRING(module->domain);
-        if (module->domain != NULL)
-            vlc_bindtextdomain (module->domain);
+invalid:
+    msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
+    block_Release( map );
+    return 0;
 
-        LOAD_IMMEDIATE( i_submodules );
+error:
+    msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
+    block_Release( map );
+    return 0;
+}
 
-        while( i_submodules-- )
-        {
-            module_t *submodule = vlc_module_create (module);
-            free (submodule->pp_shortcuts);
-            LOAD_STRING(submodule->psz_shortname);
-            LOAD_STRING(submodule->psz_longname);
+/**
+ * Builds a cache image in memory.
+ */
+typedef struct
+{
+    uint8_t *buf;
+    size_t   len;
+    size_t   size;
+    bool     error;
+} cache_writer_t;
 
-            LOAD_IMMEDIATE(submodule->i_shortcuts);
-            if (submodule->i_shortcuts > MODULE_SHORTCUT_MAX)
-                goto error;
-            else
-            {
-                submodule->pp_shortcuts =
-                           xmalloc (sizeof (*submodule->pp_shortcuts) * submodule->i_shortcuts);
-                for (unsigned j = 0; j < submodule->i_shortcuts; j++)
-                    LOAD_STRING(submodule->pp_shortcuts[j]);
-            }
-
-            LOAD_STRING(submodule->psz_capability);
-            LOAD_IMMEDIATE(submodule->i_score);
-        }
+/**
+ * Appends len bytes at the given alignment. Returns their offset, or 0 if
+ * the image is too large.
+ */
+static uint32_t CacheAppend (cache_writer_t *w, const void *data, size_t len,
+                             size_t align)
+{
+    size_t offset = (w->len + align - 1) & ~(align - 1);
 
-        char *path;
-        struct stat st;
+    if (w->error || offset + len > UINT32_MAX)
+        goto error;
 
-        /* Load common info */
-        LOAD_STRING(path);
-        if (path == NULL)
+    if (offset + len > w->size)
+    {
+        size_t size = __MAX(2 * w->size, offset + len);
+        uint8_t *buf = realloc (w->buf, size);
+        if (unlikely(buf == NULL))
             goto error;
-        LOAD_IMMEDIATE(st.st_mtime);
-        LOAD_IMMEDIATE(st.st_size);
-
-        CacheAdd (&cache, &count, path, &st, module);
-        free (path);
-        /* TODO: deal with errors */
+        w->buf = buf;
+        w->size = size;
     }
-    fclose( file );
-
-    *r = cache;
-    return i_cache;
 
+    memset (w->buf + w->len, 0, offset - w->len);
+    if (data != NULL)
+        memcpy (w->buf + offset, data, len);
+    else
+        memset (w->buf + offset, 0, len);
+    w->len = offset + len;
+    return offset;
 error:
-    msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
-
-    /* TODO: cleanup */
-    fclose( file );
+    w->error = true;
     return 0;
 }
 
-#define SAVE_IMMEDIATE( a ) \
-    if (fwrite (&(a), sizeof(a), 1, file) != 1) \
-        goto error
-#define SAVE_FLAG(a) \
-    do { \
-        char b = (a); \
-        SAVE_IMMEDIATE(b); \
-    } while (0)
+static uint32_t CacheSaveString (cache_writer_t *w, const char *str)
+{
+    if (str == NULL)
+        return 0;
+    return CacheAppend (w, str, strlen (str) + 1, 1);
+}
 
-static int CacheSaveString (FILE *file, const char *str)
+static uint32_t CacheSaveStrings (cache_writer_t *w, char *const *tab,
+                                  size_t count)
 {
-    uint16_t size = (str != NULL) ? strlen (str) : 0;
+    if (count == 0)
+        return 0;
 
-    SAVE_IMMEDIATE (size);
-    if (size != 0 && fwrite (str, 1, size, file) != size)
+    uint32_t offset = CacheAppend (w, NULL, count * sizeof (uint32_t), 8);
+    for (size_t i = 0; i < count && !w->error; i++)
     {
-error:
-        return -1;
+        uint32_t str = CacheSaveString (w, tab[i]);
+        if (!w->error)
+            memcpy (w->buf + offset + i * sizeof (str), &str, sizeof (str));
     }
-    return 0;
+    return offset;
 }
 
-#define SAVE_STRING( a ) \
-    if (CacheSaveString (file, (a))) \
-        goto error
-
-static int CacheSaveConfig (FILE *file, const module_config_t *cfg)
+static void CacheSaveConfig (cache_writer_t *w, uint32_t offset,
+                             const module_config_t *cfg)
 {
-    SAVE_IMMEDIATE (cfg->i_type);
-    SAVE_IMMEDIATE (cfg->i_short);
-    SAVE_FLAG (cfg->b_advanced);
-    SAVE_FLAG (cfg->b_internal);
-    SAVE_FLAG (cfg->b_unsaveable);
-    SAVE_FLAG (cfg->b_safe);
-    SAVE_FLAG (cfg->b_removed);
-    SAVE_STRING (cfg->psz_type);
-    SAVE_STRING (cfg->psz_name);
-    SAVE_STRING (cfg->psz_text);
-    SAVE_STRING (cfg->psz_longtext);
-    SAVE_IMMEDIATE (cfg->list_count);
+    cache_config_t rec;
+
+    memset (&rec, 0, sizeof (rec));
+    rec.type = cfg->i_type;
+    rec.i_short = cfg->i_short;
+    rec.flags = (cfg->b_advanced ? CONFIG_ADVANCED : 0)
+              | (cfg->b_internal ? CONFIG_INTERNAL : 0)
+              | (cfg->b_unsaveable ? CONFIG_UNSAVEABLE : 0)
+              | (cfg->b_safe ? CONFIG_SAFE : 0)
+              | (cfg->b_removed ? CONFIG_REMOVED : 0);
+    rec.psz_type = CacheSaveString (w, cfg->psz_type);
+    rec.psz_name = CacheSaveString (w, cfg->psz_name);
+    rec.psz_text = CacheSaveString (w, cfg->psz_text);
+    rec.psz_longtext = CacheSaveString (w, cfg->psz_longtext);
+    rec.list_count = cfg->list_count;
 
     if (IsConfigStringType (cfg->i_type))
     {
-        SAVE_STRING (cfg->orig.psz);
+        rec.psz_orig = CacheSaveString (w, cfg->orig.psz);
         if (cfg->list_count == 0)
-            SAVE_IMMEDIATE (cfg->list.psz_cb); /* XXX: see CacheLoadConfig() */
-        for (unsigned i = 0; i < cfg->list_count; i++)
-            SAVE_STRING (cfg->list.psz[i]);
+            rec.list_cb = cfg->list.psz_cb; /* XXX: see CacheLoadConfig() */
+        else
+            rec.list = CacheSaveStrings (w, cfg->list.psz, cfg->list_count);
     }
     else
     {
-        SAVE_IMMEDIATE (cfg->orig);
-        SAVE_IMMEDIATE (cfg->min);
-        SAVE_IMMEDIATE (cfg->max);
+        rec.orig = cfg->orig;
+        rec.min = cfg->min;
+        rec.max = cfg->max;
         if (cfg->list_count == 0)
-            SAVE_IMMEDIATE (cfg->list.i_cb); /* XXX: see CacheLoadConfig() */
-        for (unsigned i = 0; i < cfg->list_count; i++)
-             SAVE_IMMEDIATE (cfg->list.i[i]);
+            rec.list_cb = cfg->list.i_cb; /* XXX: see CacheLoadConfig() */
+        else
+            rec.list = CacheAppend (w, cfg->list.i,
+                                    cfg->list_count * sizeof (int), 8);
     }
-    for (unsigned i = 0; i < cfg->list_count; i++)
-        SAVE_STRING (cfg->list_text[i]);
+    rec.list_text = CacheSaveStrings (w, cfg->list_text, cfg->list_count);
 
-    return 0;
-error:
-    return -1;
+    if (!w->error)
+        memcpy (w->buf + offset, &rec, sizeof (rec));
 }
 
-static int CacheSaveModuleConfig (FILE *file, const module_t *module)
+static void CacheSaveModule (cache_writer_t *w, uint32_t offset,
+                             const module_t *module)
 {
-    uint16_t lines = module->confsize;
+    cache_module_t rec;
+
+    memset (&rec, 0, sizeof (rec));
+    rec.shortname = CacheSaveString (w, module->psz_shortname);
+    rec.longname = CacheSaveString (w, module->psz_longname);
+    rec.shortcuts = CacheSaveStrings (w, module->pp_shortcuts,
+                                      module->i_shortcuts);
+    rec.shortcut_count = module->i_shortcuts;
+    rec.capability = CacheSaveString (w, module->psz_capability);
+    rec.score = module->i_score;
+
+    if (module->parent == NULL)
+    {
+        rec.help = CacheSaveString (w, module->psz_help);
+        rec.unloadable = module->b_unloadable;
+        rec.domain = CacheSaveString (w, module->domain);
 
-    SAVE_IMMEDIATE (module->i_config_items);
-    SAVE_IMMEDIATE (module->i_bool_items);
-    SAVE_IMMEDIATE (lines);
+        /* Config stuff */
+        rec.config_items = module->i_config_items;
+        rec.bool_items = module->i_bool_items;
+        rec.confsize = module->confsize;
+        if (module->confsize > 0)
+        {
+            rec.config = CacheAppend (w, NULL, module->confsize
+                                      * sizeof (cache_config_t), 8);
+            for (size_t i = 0; i < module->confsize && !w->error; i++)
+                CacheSaveConfig (w, rec.config + i * sizeof (cache_config_t),
+                                 module->p_config + i);
+        }
 
-    for (size_t i = 0; i < lines; i++)
-        if (CacheSaveConfig (file, module->p_config + i))
-           goto error;
+        rec.submodule_count = module->submodule_count;
+        if (module->submodule_count > 0)
+        {
+            rec.submodules = CacheAppend (w, NULL, module->submodule_count
+                                          * sizeof (cache_module_t), 8);
+            uint32_t sub = rec.submodules;
+            for (const module_t *submodule = module->submodule;
+                 submodule != NULL && !w->error;
+                 submodule = submodule->next, sub += sizeof (cache_module_t))
+                CacheSaveModule (w, sub, submodule);
+        }
+    }
 
-    return 0;
-error:
-    return -1;
+    if (!w->error)
+        memcpy (w->buf + offset, &rec, sizeof (rec));
 }
 
 static int CacheSaveBank( FILE *file, const module_cache_t *, size_t );
@@ -529,95 +721,65 @@ out:
     free (entries);
 }
 
-static int CacheSaveSubmodule (FILE *, const module_t *);
-
 static int CacheSaveBank (FILE *file, const module_cache_t *cache,
                           size_t i_cache)
 {
-    uint32_t i_file_size = 0;
+    cache_writer_t w = { NULL, 0, 0, false };
+    cache_header_t hdr;
+    uint32_t i_marker;
 
     /* Contains version number */
-    if (fputs (CACHE_STRING, file) == EOF)
-        goto error;
+    CacheAppend (&w, CACHE_STRING, strlen (CACHE_STRING), 1);
 #ifdef DISTRO_VERSION
     /* Allow binary maintaner to pass a string to detect new binary version*/
-    if (fputs( DISTRO_VERSION, file ) == EOF)
-        goto error;
+    CacheAppend (&w, DISTRO_VERSION, strlen (DISTRO_VERSION), 1);
 #endif
     /* Sub-version number (to avoid breakage in the dev version when cache
      * structure changes) */
-    i_file_size = CACHE_SUBVERSION_NUM;
-    if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1 )
-        goto error;
+    i_marker = CACHE_SUBVERSION_NUM;
+    CacheAppend (&w, &i_marker, sizeof (i_marker), 1);
 
     /* Header marker */
-    i_file_size = ftell( file );
-    if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
-        goto error;
+    i_marker = w.len;
+    CacheAppend (&w, &i_marker, sizeof (i_marker), 1);
 
-    if (fwrite( &i_cache, sizeof (i_cache), 1, file) != 1)
-        goto error;
+    uint32_t header = CacheAppend (&w, NULL, sizeof (hdr), 8);
+    hdr.magic = CACHE_MAGIC;
+    hdr.plugin_count = i_cache;
+    hdr.plugins = CacheAppend (&w, NULL, i_cache * sizeof (cache_plugin_t), 8);
 
-    for (unsigned i = 0; i < i_cache; i++)
+    for (size_t i = 0; i < i_cache && !w.error; i++)
     {
-        module_t *module = cache[i].p_module;
-        uint32_t i_submodule;
-
-        /* Save additional infos */
-        SAVE_STRING(module->psz_shortname);
-        SAVE_STRING(module->psz_longname);
-        SAVE_STRING(module->psz_help);
-        SAVE_IMMEDIATE(module->i_shortcuts);
-        for (unsigned j = 0; j < module->i_shortcuts; j++)
-            SAVE_STRING(module->pp_shortcuts[j]);
-
-        SAVE_STRING(module->psz_capability);
-        SAVE_IMMEDIATE(module->i_score);
-        SAVE_IMMEDIATE(module->b_unloadable);
-
-        /* Config stuff */
-        if (CacheSaveModuleConfig (file, module))
-            goto error;
-
-        SAVE_STRING(module->domain);
-
-        i_submodule = module->submodule_count;
-        SAVE_IMMEDIATE( i_submodule );
-        if (CacheSaveSubmodule (file, module->submodule))
-            goto error;
-
-        /* Save common info */
-        SAVE_STRING(cache[i].path);
-        SAVE_IMMEDIATE(cache[i].mtime);
-        SAVE_IMMEDIATE(cache[i].size);
+        cache_plugin_t plugin;
+
+        memset (&plugin, 0, sizeof (plugin));
+        plugin.path = CacheSaveString (&w, cache[i].path);
+        plugin.mtime = cache[i].mtime;
+        plugin.size = cache[i].size;
+        plugin.module = CacheAppend (&w, NULL, sizeof (cache_module_t), 8);
+        CacheSaveModule (&w, plugin.module, cache[i].p_module);
+
+        if (!w.error)
+            memcpy (w.buf + hdr.plugins + i * sizeof (plugin), &plugin,
+                    sizeof (plugin));
     }
 
-    if (fflush (file)) /* flush libc buffers */
+    /* Terminates the last string, and any corrupted one */
+    CacheAppend (&w, NULL, 1, 1);
+    hdr.size = w.len;
+    if (w.error)
         goto error;
-    return 0; /* success! */
-
-error:
-    return -1;
-}
+    memcpy (w.buf + header, &hdr, sizeof (hdr));
 
-static int CacheSaveSubmodule( FILE *file, const module_t *p_module )
-{
-    if( !p_module )
-        return 0;
-    if( CacheSaveSubmodule( file, p_module->next ) )
+    if (fwrite (w.buf, 1, w.len, file) != w.len)
         goto error;
-
-    SAVE_STRING( p_module->psz_shortname );
-    SAVE_STRING( p_module->psz_longname );
-    SAVE_IMMEDIATE( p_module->i_shortcuts );
-    for( unsigned j = 0; j < p_module->i_shortcuts; j++ )
-         SAVE_STRING( p_module->pp_shortcuts[j] );
-
-    SAVE_STRING( p_module->psz_capability );
-    SAVE_IMMEDIATE( p_module->i_score );
-    return 0;
+    if (fflush (file)) /* flush libc buffers */
+        goto error;
+    free (w.buf);
+    return 0; /* success! */
 
 error:
+    free (w.buf);
     return -1;
 }
 
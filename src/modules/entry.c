@@ -71,6 +71,7 @@ module_t *vlc_module_create (module_t *parent)
     module->i_score = (parent != NULL) ? parent->i_score : 1;
     module->b_loaded = false;
     module->b_unloadable = parent == NULL;
+    module->b_mapped = false;
     module->pf_activate = NULL;
     module->pf_deactivate = NULL;
     module->p_config = NULL;
@@ -83,6 +84,28 @@ module_t *vlc_module_create (module_t *parent)
     return module;
 }
 
+/**
+ * Frees the configuration of a module loaded from the plugins cache.
+ * Only the tables and the current values were allocated.
+ */
+static void vlc_module_free_mapped_config (module_config_t *tab,
+                                           size_t confsize)
+{
+    for (size_t i = 0; i < confsize; i++)
+    {
+        module_config_t *item = &tab[i];
+
+        if (IsConfigStringType (item->i_type))
+        {
+            free (item->value.psz);
+            if (item->list_count)
+                free (item->list.psz);
+        }
+        free (item->list_text);
+    }
+    free (tab);
+}
+
 /**
  * Destroys a plug-in.
  * @warning If the plug-in is loaded in memory, the handle will be leaked.
@@ -97,10 +120,18 @@ void vlc_module_destroy (module_t *module)
         vlc_module_destroy (m);
     }
 
+    free (module->psz_filename);
+    if (module->b_mapped)
+    {   /* The strings belong to the plugins cache */
+        vlc_module_free_mapped_config (module->p_config, module->confsize);
+        free (module->pp_shortcuts);
+        free (module);
+        return;
+    }
+
     config_Free (module->p_config, module->confsize);
 
     free (module->domain);
-    free (module->psz_filename);
     for (unsigned i = 0; i < module->i_shortcuts; i++)
         free (module->pp_shortcuts[i]);
     free (module->pp_shortcuts);
@@ -226,19 +226,21 @@ module_t *vlc_module_load(vlc_object_t *obj, const char *capability,
     }
 
     /* Find matching modules */
-    module_t **mods;
+    module_t *const *mods;
     ssize_t total = module_list_cap (&mods, capability);
 
     msg_Dbg (obj, "looking for %s module matching \"%s\": %zd candidates",
              capability, name, total);
     if (total <= 0)
     {
-        module_list_free (mods);
         msg_Dbg (obj, "no %s modules", capability);
+        free (var);
         return NULL;
     }
 
     module_t *module = NULL;
+    bool tried[total]; /* only try each module once at most... */
+    memset (tried, 0, sizeof (tried));
     const bool b_force_backup = obj->b_force; /* FIXME: remove this */
     va_list args;
 
@@ -268,11 +270,11 @@ module_t *vlc_module_load(vlc_object_t *obj, const char *capability,
         for (ssize_t i = 0; i < total; i++)
         {
             module_t *cand = mods[i];
-            if (cand == NULL)
+            if (tried[i])
                 continue; // module failed in previous iteration
             if (!module_match_name (cand, shortcut))
                 continue;
-            mods[i] = NULL; // only try each module once at most...
+            tried[i] = true;
 
             int ret = module_load (obj, cand, probe, args);
             switch (ret)
@@ -293,7 +295,7 @@ module_t *vlc_module_load(vlc_object_t *obj, const char *capability,
         for (ssize_t i = 0; i < total; i++)
         {
             module_t *cand = mods[i];
-            if (cand == NULL || module_get_score (cand) <= 0)
+            if (tried[i] || module_get_score (cand) <= 0)
                 continue;
 
             int ret = module_load (obj, cand, probe, args);
@@ -310,7 +312,6 @@ module_t *vlc_module_load(vlc_object_t *obj, const char *capability,
 done:
     va_end (args);
     obj->b_force = b_force_backup;
-    module_list_free (mods);
     free (var);
 
     if (module != NULL)
@@ -78,6 +78,7 @@ struct module_t
 
     bool          b_loaded;        /* Set to true if the dll is loaded */
     bool b_unloadable;                        /**< Can we be dlclosed? */
+    bool b_mapped;           /**< Strings are in the mapped plugins cache */
 
     /* Callbacks */
     void *pf_activate;
@@ -110,7 +111,7 @@ size_t module_LoadPlugins( vlc_object_t * );
 void module_EndBank (bool);
 int module_Map (vlc_object_t *, module_t *);
 
-ssize_t module_list_cap (module_t ***, const char *);
+ssize_t module_list_cap (module_t *const **, const char *);
 
 int vlc_bindtextdomain (const char *);
 
@@ -122,7 +123,8 @@ void module_Unload (module_handle_t);
 /* Plugins cache */
 void   CacheMerge (vlc_object_t *, module_t *, module_t *);
 void   CacheDelete(vlc_object_t *, const char *);
-size_t CacheLoad  (vlc_object_t *, const char *, module_cache_t **);
+size_t CacheLoad  (vlc_object_t *, const char *, module_cache_t **,
+                   block_t **);
 
 struct stat;
 
@@ -0,0 +1,298 @@
+/*****************************************************************************
+ * http_pool.c: pool of persistent HTTP client connections
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#ifdef HAVE_POLL
+# include <poll.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_network.h>
+#include <vlc_tls.h>
+#include <vlc_http.h>
+
+#include "libvlc.h"
+
+/* Idle connections are kept for a while only: servers time them out anyway,
+ * usually after 15 to 60 seconds. */
+#define HTTP_POOL_IDLE_DELAY   (CLOCK_FREQ * 15)
+#define HTTP_POOL_MAX_PER_HOST 4
+#define HTTP_POOL_MAX          32
+
+typedef struct
+{
+    int        fd;
+    vlc_tls_t *p_tls;
+    mtime_t    i_date; /* when the connection became idle */
+} http_pool_conn_t;
+
+typedef struct
+{
+    char            *psz_key;
+    /* Idle connections, the most recently used last */
+    http_pool_conn_t conns[HTTP_POOL_MAX_PER_HOST];
+    unsigned         i_conns;
+
+    uint64_t         i_reused;
+    uint64_t         i_missed;
+} http_pool_host_t;
+
+struct vlc_http_pool_t
+{
+    vlc_mutex_t        lock;
+    int                i_hosts;
+    http_pool_host_t **pp_hosts;
+    unsigned           i_conns; /* idle connections of all hosts */
+};
+
+static void ConnClose( http_pool_conn_t *p_conn )
+{
+    if( p_conn->p_tls != NULL )
+    {
+        vlc_tls_creds_t *p_creds = (vlc_tls_creds_t *)p_conn->p_tls->p_parent;
+
+        vlc_tls_SessionDelete( p_conn->p_tls );
+        vlc_tls_Delete( p_creds );
+    }
+    net_Close( p_conn->fd );
+}
+
+/* Whether an idle connection is still usable: the server must not have sent
+ * anything, in particular not closed the connection. */
+static bool ConnAlive( const http_pool_conn_t *p_conn )
+{
+    struct pollfd ufd = { .fd = p_conn->fd, .events = POLLIN };
+
+    return poll( &ufd, 1, 0 ) == 0;
+}
+
+static http_pool_host_t *HostGet( vlc_http_pool_t *p_pool, const char *psz_key,
+                                  bool b_create )
+{
+    for( int i = 0; i < p_pool->i_hosts; i++ )
+        if( !strcmp( p_pool->pp_hosts[i]->psz_key, psz_key ) )
+            return p_pool->pp_hosts[i];
+
+    if( !b_create )
+        return NULL;
+
+    http_pool_host_t *p_host = calloc( 1, sizeof(*p_host) );
+    if( unlikely(p_host == NULL) )
+        return NULL;
+    p_host->psz_key = strdup( psz_key );
+    if( unlikely(p_host->psz_key == NULL) )
+    {
+        free( p_host );
+        return NULL;
+    }
+    TAB_APPEND( p_pool->i_hosts, p_pool->pp_hosts, p_host );
+    return p_host;
+}
+
+/* Removes the i-th idle connection of a host, copying it to *p_conn */
+static void HostRemove( vlc_http_pool_t *p_pool, http_pool_host_t *p_host,
+                        unsigned i, http_pool_conn_t *p_conn )
+{
+    assert( i < p_host->i_conns );
+    *p_conn = p_host->conns[i];
+    memmove( &p_host->conns[i], &p_host->conns[i + 1],
+             ( p_host->i_conns - i - 1 ) * sizeof(p_host->conns[0]) );
+    p_host->i_conns--;
+    p_pool->i_conns--;
+}
+
+/* Removes the connections which have been idle for too long. They are stored
+ * in p_old, to be closed once the pool is unlocked. */
+static unsigned Expire( vlc_http_pool_t *p_pool, mtime_t i_now,
+                        http_pool_conn_t *p_old )
+{
+    unsigned i_old = 0;
+
+    for( int i = 0; i < p_pool->i_hosts; i++ )
+    {
+        http_pool_host_t *p_host = p_pool->pp_hosts[i];
+
+        /* The oldest connections are first */
+        while( p_host->i_conns > 0 &&
+               p_host->conns[0].i_date + HTTP_POOL_IDLE_DELAY <= i_now )
+            HostRemove( p_pool, p_host, 0, &p_old[i_old++] );
+    }
+    return i_old;
+}
+
+vlc_http_pool_t *vlc_http_pool_New( void )
+{
+    vlc_http_pool_t *p_pool = malloc( sizeof(*p_pool) );
+    if( unlikely(p_pool == NULL) )
+        return NULL;
+
+    vlc_mutex_init( &p_pool->lock );
+    TAB_INIT( p_pool->i_hosts, p_pool->pp_hosts );
+    p_pool->i_conns = 0;
+    return p_pool;
+}
+
+void vlc_http_pool_Delete( vlc_object_t *p_obj, vlc_http_pool_t *p_pool )
+{
+    if( p_pool == NULL )
+        return;
+
+    for( int i = 0; i < p_pool->i_hosts; i++ )
+    {
+        http_pool_host_t *p_host = p_pool->pp_hosts[i];
+
+        msg_Dbg( p_obj, "HTTP connections to %s: %"PRIu64" reused, "
+                 "%"PRIu64" opened", p_host->psz_key, p_host->i_reused,
+                 p_host->i_missed );
+        for( unsigned j = 0; j < p_host->i_conns; j++ )
+            ConnClose( &p_host->conns[j] );
+        free( p_host->psz_key );
+        free( p_host );
+    }
+    TAB_CLEAN( p_pool->i_hosts, p_pool->pp_hosts );
+    vlc_mutex_destroy( &p_pool->lock );
+    free( p_pool );
+}
+
+int vlc_http_pool_Take( vlc_object_t *p_obj, const char *psz_key,
+                        vlc_tls_t **pp_tls )
+{
+    vlc_http_pool_t *p_pool = libvlc_priv( p_obj->p_libvlc )->http_pool;
+    http_pool_conn_t old[HTTP_POOL_MAX];
+    http_pool_conn_t conn = { .fd = -1, .p_tls = NULL };
+    unsigned i_old;
+
+    *pp_tls = NULL;
+    if( p_pool == NULL )
+        return -1;
+
+    vlc_mutex_lock( &p_pool->lock );
+    i_old = Expire( p_pool, mdate(), old );
+
+    http_pool_host_t *p_host = HostGet( p_pool, psz_key, true );
+    if( p_host != NULL )
+    {
+        /* Use the most recently used connection, the least likely to have
+         * been timed out by the server. */
+        while( p_host->i_conns > 0 )
+        {
+            HostRemove( p_pool, p_host, p_host->i_conns - 1, &conn );
+            if( ConnAlive( &conn ) )
+                break;
+            old[i_old++] = conn;
+            conn.fd = -1;
+            conn.p_tls = NULL;
+        }
+
+        if( conn.fd != -1 )
+        {
+            p_host->i_reused++;
+            msg_Dbg( p_obj, "reusing connection to %s (%"PRIu64" reused, "
+                     "%"PRIu64" opened)", psz_key, p_host->i_reused,
+                     p_host->i_missed );
+        }
+        else
+            p_host->i_missed++;
+    }
+    vlc_mutex_unlock( &p_pool->lock );
+
+    for( unsigned i = 0; i < i_old; i++ )
+        ConnClose( &old[i] );
+
+    *pp_tls = conn.p_tls;
+    return conn.fd;
+}
+
+void vlc_http_pool_Give( vlc_object_t *p_obj, const char *psz_key,
+                         int fd, vlc_tls_t *p_tls )
+{
+    vlc_http_pool_t *p_pool = libvlc_priv( p_obj->p_libvlc )->http_pool;
+    http_pool_conn_t old[HTTP_POOL_MAX + 1];
+    http_pool_conn_t conn = { .fd = fd, .p_tls = p_tls, .i_date = mdate() };
+    unsigned i_old;
+
+    if( p_pool == NULL )
+    {
+        ConnClose( &conn );
+        return;
+    }
+
+    vlc_mutex_lock( &p_pool->lock );
+    i_old = Expire( p_pool, conn.i_date, old );
+
+    http_pool_host_t *p_host = HostGet( p_pool, psz_key, true );
+    if( p_host == NULL )
+        old[i_old++] = conn;
+    else
+    {
+        /* Make room, dropping the oldest connections first */
+        if( p_host->i_conns >= HTTP_POOL_MAX_PER_HOST )
+            HostRemove( p_pool, p_host, 0, &old[i_old++] );
+        else if( p_pool->i_conns >= HTTP_POOL_MAX )
+        {
+            http_pool_host_t *p_oldest = NULL;
+
+            for( int i = 0; i < p_pool->i_hosts; i++ )
+            {
+                http_pool_host_t *p_cur = p_pool->pp_hosts[i];
+                if( p_cur->i_conns > 0 && ( p_oldest == NULL ||
+                    p_cur->conns[0].i_date < p_oldest->conns[0].i_date ) )
+                    p_oldest = p_cur;
+            }
+            assert( p_oldest != NULL );
+            HostRemove( p_pool, p_oldest, 0, &old[i_old++] );
+        }
+
+        p_host->conns[p_host->i_conns++] = conn;
+        p_pool->i_conns++;
+    }
+    vlc_mutex_unlock( &p_pool->lock );
+
+    for( unsigned i = 0; i < i_old; i++ )
+        ConnClose( &old[i] );
+}
+
+int vlc_http_pool_GetStats( vlc_object_t *p_obj, const char *psz_key,
+                            vlc_http_pool_stats_t *p_stats )
+{
+    vlc_http_pool_t *p_pool = libvlc_priv( p_obj->p_libvlc )->http_pool;
+    int i_ret = VLC_EGENERIC;
+
+    if( p_pool == NULL )
+        return VLC_EGENERIC;
+
+    vlc_mutex_lock( &p_pool->lock );
+    http_pool_host_t *p_host = HostGet( p_pool, psz_key, false );
+    if( p_host != NULL )
+    {
+        p_stats->i_reused = p_host->i_reused;
+        p_stats->i_missed = p_host->i_missed;
+        p_stats->i_idle = p_host->i_conns;
+        i_ret = VLC_SUCCESS;
+    }
+    vlc_mutex_unlock( &p_pool->lock );
+    return i_ret;
+}
@@ -49,6 +49,10 @@
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#ifdef __linux__
+# include <sys/epoll.h>
+# define HTTPD_EPOLL 1
+#endif
 
 #if defined(_WIN32)
 #   include <winsock2.h>
@@ -63,10 +67,36 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* worker threads per host, when not set by the user */
+#define HTTPD_WORKERS_AUTO_MAX 4
+#define HTTPD_WORKERS_MAX      64
+
+#ifdef HTTPD_EPOLL
+/* events handled per wake up */
+# define HTTPD_EPOLL_EVENTS 64
+#endif
+
 static void httpd_ClientClean(httpd_client_t *cl);
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
 
-/* each host run in his own thread */
+typedef struct httpd_worker_t httpd_worker_t;
+
+/* each host runs a set of worker threads, each one serving its own clients */
+struct httpd_worker_t
+{
+    httpd_host_t  *host;
+    vlc_thread_t   thread;
+
+    int            i_client;
+    httpd_client_t **client;
+
+#ifdef HTTPD_EPOLL
+    int            epfd;
+#endif
+
+    /* bytes waiting to be sent, as of the last pass */
+    size_t         i_backlog;
+};
+
 struct httpd_host_t
 {
     VLC_COMMON_MEMBERS
@@ -79,7 +109,6 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
-    vlc_thread_t thread;
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
@@ -90,11 +119,16 @@ struct httpd_host_t
     int         i_url;
     httpd_url_t **url;
 
-    int            i_client;
-    httpd_client_t **client;
+    unsigned        i_worker;
+    httpd_worker_t *worker;
 
     /* TLS data */
     vlc_tls_creds_t *p_tls;
+
+    /* statistics, see httpd_HostGetStats() */
+    uint64_t    i_accepted;
+    uint64_t    i_sent;
+    uint64_t    i_lagged;
 };
 
 
@@ -142,10 +176,15 @@ enum
 struct httpd_client_t
 {
     httpd_url_t *url;
+    httpd_worker_t *worker;
 
     int     i_ref;
 
     int     fd;
+    short   i_events;   /* poll events being watched */
+
+    /* set while the worker does I/O without the host lock */
+    bool    b_busy;
 
     bool    b_stream_mode;
     uint8_t i_state;
@@ -158,6 +197,11 @@ struct httpd_client_t
     int     i_buffer;
     uint8_t *p_buffer;
 
+    /* Shared stream chunks backing p_buffer and answer.p_body, if not NULL.
+     * Stream data is sent straight from them rather than copied. */
+    block_t *p_buffer_chunk;
+    block_t *p_body_chunk;
+
     /*
      * If waiting for a keyframe, this is the position (in bytes) of the
      * last keyframe the stream saw before this client connected.
@@ -345,13 +389,32 @@ httpd_FileCallBack(httpd_callback_sys_t *p_sys, httpd_client_t *cl,
 
     if (query->i_type == HTTPD_MSG_HEAD)
         free(p_body);
+    else if (answer->i_body > 0) {
+        /* Let the client revalidate its copy, rather than download it again */
+        char etag[19];
+        uint64_t hash = 0xcbf29ce484222325; /* FNV-1a */
+
+        for (int i = 0; i < answer->i_body; i++)
+            hash = (hash ^ answer->p_body[i]) * 0x100000001b3;
+        snprintf(etag, sizeof (etag), "\"%016"PRIx64"\"", hash);
+        httpd_MsgAdd(answer, "ETag", "%s", etag);
+
+        const char *psz_match = httpd_MsgGet(query, "If-None-Match");
+        if (psz_match != NULL && strstr(psz_match, etag) != NULL) {
+            answer->i_status = 304;
+            free(answer->p_body);
+            answer->p_body = NULL;
+            answer->i_body = 0;
+        }
+    }
 
     /* We respect client request */
     psz_connection = httpd_MsgGet(&cl->query, "Connection");
     if (!psz_connection)
         httpd_MsgAdd(answer, "Connection", "%s", psz_connection);
 
-    httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+    if (answer->i_status != 304) /* no body, whatever its length */
+        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
 
     return VLC_SUCCESS;
 }
@@ -592,6 +655,12 @@ void httpd_RedirectDelete(httpd_redirect_t *rdir)
 /*****************************************************************************
  * High Level Funtions: httpd_stream_t
  *****************************************************************************/
+typedef struct
+{
+    int64_t  i_pos;     /* absolute position of the first byte */
+    block_t *p_block;   /* shared payload */
+} httpd_chunk_t;
+
 struct httpd_stream_t
 {
     vlc_mutex_t lock;
@@ -607,13 +676,22 @@ struct httpd_stream_t
      * as keyframes, to ensure that the stream starts with one.
      * (This is particularly important for WebM streaming to certain
      * browsers.) Store if we've ever seen any such keyframe blocks,
-     * and if so, the byte position of the start of the last one. */
+     * and if so, the byte position of the start of the last one.
+     * Keyframes always start a chunk, so new clients begin with the last
+     * one as long as it is in the ring. */
     bool        b_has_keyframes;
     int64_t     i_last_keyframe_seen_pos;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
+    int         i_slow_clients;     /* HTTPD_STREAM_SLOW_* */
+
+    /* Ring of shared chunks, oldest first. The clients reference the
+     * chunks they are sending, so nothing is copied per client. */
+    httpd_chunk_t *p_chunks;
+    unsigned    i_chunks_max;       /* ring size, power of 2 */
+    unsigned    i_chunks_first;
+    unsigned    i_chunks;
+    int64_t     i_buffer_size;      /* bytes kept for slow and new clients */
+    int64_t     i_buffer_used;      /* bytes held by the ring */
     int64_t     i_buffer_pos;       /* absolute position from begining */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
 
@@ -622,6 +700,50 @@ struct httpd_stream_t
     httpd_header * p_http_headers;
 };
 
+static httpd_chunk_t *httpd_StreamChunk(const httpd_stream_t *stream,
+                                        unsigned i)
+{
+    assert(i < stream->i_chunks);
+    i = (stream->i_chunks_first + i) & (stream->i_chunks_max - 1);
+    return &stream->p_chunks[i];
+}
+
+/* Finds the chunk holding the byte at the given position */
+static const httpd_chunk_t *httpd_StreamFind(const httpd_stream_t *stream,
+                                             int64_t i_pos)
+{
+    unsigned lo = 0, hi = stream->i_chunks;
+
+    assert(hi > 0 && i_pos >= httpd_StreamChunk(stream, 0)->i_pos);
+    while (hi - lo > 1) {
+        unsigned mid = (lo + hi) / 2;
+
+        if (httpd_StreamChunk(stream, mid)->i_pos <= i_pos)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return httpd_StreamChunk(stream, lo);
+}
+
+/* Where a new or skipped client (re)starts: at the last keyframe if it is
+ * still in the ring, else at the next one. Streams without keyframes start
+ * at the last chunk. */
+static int64_t httpd_StreamStart(const httpd_stream_t *stream,
+                                 httpd_client_t *cl)
+{
+    cl->i_keyframe_wait_to_pass = -1;
+    if (!stream->b_has_keyframes)
+        return stream->i_buffer_last_pos;
+
+    if (stream->i_chunks > 0
+     && stream->i_last_keyframe_seen_pos >= httpd_StreamChunk(stream, 0)->i_pos)
+        return stream->i_last_keyframe_seen_pos;
+
+    cl->i_keyframe_wait_to_pass = stream->i_last_keyframe_seen_pos;
+    return stream->i_buffer_last_pos;
+}
+
 static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query)
@@ -632,43 +754,61 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
-
-        if (answer->i_body_offset >= stream->i_buffer_pos)
+        vlc_mutex_lock(&stream->lock);
+        if (answer->i_body_offset >= stream->i_buffer_pos) {
+            vlc_mutex_unlock(&stream->lock);
             return VLC_EGENERIC;    /* wait, no data available */
+        }
 
         if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass) {
                 /* still waiting for the next keyframe */
+                vlc_mutex_unlock(&stream->lock);
                 return VLC_EGENERIC;
+            }
 
             /* seek to the new keyframe */
             answer->i_body_offset = stream->i_last_keyframe_seen_pos;
             cl->i_keyframe_wait_to_pass = -1;
         }
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
-
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
+        if (answer->i_body_offset < httpd_StreamChunk(stream, 0)->i_pos) {
+            /* this client isn't fast enough */
+            cl->worker->host->i_lagged++;
+            if (stream->i_slow_clients == HTTPD_STREAM_SLOW_DROP) {
+                vlc_mutex_unlock(&stream->lock);
+                cl->i_state = HTTPD_CLIENT_DEAD;
+                return VLC_EGENERIC;
+            }
 
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
+            answer->i_body_offset = httpd_StreamStart(stream, cl);
+            if (cl->i_keyframe_wait_to_pass >= 0) {
+                vlc_mutex_unlock(&stream->lock);
+                return VLC_EGENERIC;
+            }
+        }
 
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
+        const httpd_chunk_t *chunk = httpd_StreamFind(stream,
+                                                      answer->i_body_offset);
+        size_t i_skip = answer->i_body_offset - chunk->i_pos;
+        size_t i_write = chunk->p_block->i_buffer - i_skip;
 
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
 
+        assert(cl->p_body_chunk == NULL);
+        cl->p_body_chunk = block_Clone(chunk->p_block);
+        if (likely(cl->p_body_chunk != NULL))
+            answer->p_body = cl->p_body_chunk->p_buffer + i_skip;
+        else {
+            i_write = __MIN(i_write, HTTPD_CL_BUFSIZE);
+            answer->p_body = xmalloc(i_write);
+            memcpy(answer->p_body, chunk->p_block->p_buffer + i_skip, i_write);
+        }
         answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
+        vlc_mutex_unlock(&stream->lock);
 
         answer->i_body_offset += i_write;
 
@@ -705,11 +845,7 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                 answer->p_body = xmalloc(stream->i_header);
                 memcpy(answer->p_body, stream->p_header, stream->i_header);
             }
-            answer->i_body_offset = stream->i_buffer_last_pos;
-            if (stream->b_has_keyframes)
-                cl->i_keyframe_wait_to_pass = stream->i_last_keyframe_seen_pos;
-            else
-                cl->i_keyframe_wait_to_pass = -1;
+            answer->i_body_offset = httpd_StreamStart(stream, cl);
             vlc_mutex_unlock(&stream->lock);
         } else {
             httpd_MsgAdd(answer, "Content-Length", "0");
@@ -766,13 +902,18 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
     stream->i_header = 0;
     stream->p_header = NULL;
     stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc(stream->i_buffer_size);
+    stream->i_buffer_used = 0;
+    stream->i_chunks_max = 256;
+    stream->i_chunks_first = 0;
+    stream->i_chunks = 0;
+    stream->p_chunks = xmalloc(stream->i_chunks_max * sizeof(*stream->p_chunks));
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
     stream->i_buffer_last_pos = 1;
     stream->b_has_keyframes = false;
     stream->i_last_keyframe_seen_pos = 0;
+    stream->i_slow_clients = HTTPD_STREAM_SLOW_SKIP;
     stream->i_http_headers = 0;
     stream->p_http_headers = NULL;
 
@@ -802,29 +943,60 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
     return VLC_SUCCESS;
 }
 
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
+static void httpd_StreamDropChunk(httpd_stream_t *stream)
 {
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
+    httpd_chunk_t *chunk = httpd_StreamChunk(stream, 0);
 
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
+    stream->i_buffer_used -= chunk->p_block->i_buffer;
+    block_Release(chunk->p_block);
+    stream->i_chunks_first = (stream->i_chunks_first + 1)
+                           & (stream->i_chunks_max - 1);
+    stream->i_chunks--;
+}
 
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
+static void httpd_AppendData(httpd_stream_t *stream, block_t *p_chunk)
+{
+    /* Forget the oldest data. Clients still sending it hold a reference. */
+    while (stream->i_chunks > 0
+        && stream->i_buffer_used + (int64_t)p_chunk->i_buffer > stream->i_buffer_size)
+        httpd_StreamDropChunk(stream);
+
+    if (stream->i_chunks == stream->i_chunks_max) {
+        httpd_chunk_t *p_chunks = malloc(2 * stream->i_chunks_max
+                                         * sizeof(*p_chunks));
+        if (likely(p_chunks != NULL)) {
+            for (unsigned i = 0; i < stream->i_chunks; i++)
+                p_chunks[i] = *httpd_StreamChunk(stream, i);
+            free(stream->p_chunks);
+            stream->p_chunks = p_chunks;
+            stream->i_chunks_max *= 2;
+            stream->i_chunks_first = 0;
+        } else
+            httpd_StreamDropChunk(stream);
     }
 
-    stream->i_buffer_pos += i_data;
+    unsigned i = (stream->i_chunks_first + stream->i_chunks)
+               & (stream->i_chunks_max - 1);
+    stream->p_chunks[i].i_pos = stream->i_buffer_pos;
+    stream->p_chunks[i].p_block = p_chunk;
+    stream->i_chunks++;
+
+    stream->i_buffer_used += p_chunk->i_buffer;
+    stream->i_buffer_pos += p_chunk->i_buffer;
 }
 
 int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
 {
-    if (!p_block || !p_block->p_buffer)
+    if (!p_block || !p_block->p_buffer || p_block->i_buffer == 0)
         return VLC_SUCCESS;
 
+    /* Copy once, then share the payload between all the clients */
+    block_t *p_chunk = block_Alloc(p_block->i_buffer);
+    if (unlikely(p_chunk == NULL))
+        return VLC_ENOMEM;
+    memcpy(p_chunk->p_buffer, p_block->p_buffer, p_block->i_buffer);
+    p_chunk = block_Share(p_chunk);
+
     vlc_mutex_lock(&stream->lock);
 
     /* save this pointer (to be used by new connection) */
@@ -835,12 +1007,19 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
         stream->i_last_keyframe_seen_pos = stream->i_buffer_pos;
     }
 
-    httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
+    httpd_AppendData(stream, p_chunk);
 
     vlc_mutex_unlock(&stream->lock);
     return VLC_SUCCESS;
 }
 
+void httpd_StreamSetSlowClients(httpd_stream_t *stream, int i_policy)
+{
+    vlc_mutex_lock(&stream->lock);
+    stream->i_slow_clients = i_policy;
+    vlc_mutex_unlock(&stream->lock);
+}
+
 void httpd_StreamDelete(httpd_stream_t *stream)
 {
     httpd_UrlDelete(stream->url);
@@ -852,7 +1031,9 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     vlc_mutex_destroy(&stream->lock);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+    while (stream->i_chunks > 0)
+        httpd_StreamDropChunk(stream);
+    free(stream->p_chunks);
     free(stream);
 }
 
@@ -860,6 +1041,8 @@ void httpd_StreamDelete(httpd_stream_t *stream)
  * Low level
  *****************************************************************************/
 static void* httpd_HostThread(void *);
+static void httpd_HostStopWorkers(httpd_host_t *);
+static void httpd_WorkerRemove(httpd_worker_t *, httpd_client_t *);
 static httpd_host_t *httpd_HostCreate(vlc_object_t *, const char *,
                                        const char *, vlc_tls_creds_t *);
 
@@ -959,6 +1142,8 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     vlc_mutex_init(&host->lock);
     vlc_cond_init(&host->wait);
     host->i_ref = 1;
+    host->i_worker = 0;
+    host->worker = NULL;
 
     host->fds = net_ListenTCP(p_this, url.psz_host, port);
     if (!host->fds) {
@@ -975,16 +1160,54 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     host->port     = port;
     host->i_url    = 0;
     host->url      = NULL;
-    host->i_client = 0;
-    host->client   = NULL;
     host->p_tls    = p_tls;
-
-    /* create the thread */
-    if (vlc_clone(&host->thread, httpd_HostThread, host,
-                   VLC_THREAD_PRIORITY_LOW)) {
-        msg_Err(p_this, "cannot spawn http host thread");
+    host->i_accepted = 0;
+    host->i_sent   = 0;
+    host->i_lagged = 0;
+
+    /* create the worker threads */
+    int64_t i_workers = var_InheritInteger(p_this, "http-threads");
+    if (i_workers <= 0)
+        i_workers = __MIN(vlc_GetCPUCount(), HTTPD_WORKERS_AUTO_MAX);
+    i_workers = VLC_CLIP(i_workers, 1, HTTPD_WORKERS_MAX);
+
+    host->worker = calloc(i_workers, sizeof(*host->worker));
+    if (unlikely(host->worker == NULL))
         goto error;
+
+    while (host->i_worker < i_workers) {
+        httpd_worker_t *w = &host->worker[host->i_worker];
+
+        w->host = host;
+#ifdef HTTPD_EPOLL
+        w->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (w->epfd == -1) {
+            msg_Err(p_this, "cannot create epoll instance: %s",
+                    vlc_strerror_c(errno));
+            goto error;
+        }
+
+        /* Only one worker is woken up per incoming connection */
+        for (unsigned i = 0; i < host->nfd; i++) {
+            struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+# ifdef EPOLLEXCLUSIVE
+            ev.events |= EPOLLEXCLUSIVE;
+# endif
+            epoll_ctl(w->epfd, EPOLL_CTL_ADD, host->fds[i], &ev);
+        }
+#endif
+
+        if (vlc_clone(&w->thread, httpd_HostThread, w,
+                       VLC_THREAD_PRIORITY_LOW)) {
+            msg_Err(p_this, "cannot spawn http host thread");
+#ifdef HTTPD_EPOLL
+            close(w->epfd);
+#endif
+            goto error;
+        }
+        host->i_worker++;
     }
+    msg_Dbg(host, "serving with %u thread(s)", host->i_worker);
 
     /* now add it to httpd */
     TAB_APPEND(httpd.i_host, httpd.host, host);
@@ -998,6 +1221,7 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+        httpd_HostStopWorkers(host);
         net_ListenClose(host->fds);
         vlc_cond_destroy(&host->wait);
         vlc_mutex_destroy(&host->lock);
@@ -1009,6 +1233,45 @@ error:
     return NULL;
 }
 
+/* stop the worker threads and close their connections */
+static void httpd_HostStopWorkers(httpd_host_t *host)
+{
+    for (unsigned i = 0; i < host->i_worker; i++)
+        vlc_cancel(host->worker[i].thread);
+
+    for (unsigned i = 0; i < host->i_worker; i++) {
+        httpd_worker_t *w = &host->worker[i];
+
+        vlc_join(w->thread, NULL);
+        while (w->i_client > 0) {
+            msg_Warn(host, "client still connected");
+            httpd_WorkerRemove(w, w->client[0]);
+        }
+#ifdef HTTPD_EPOLL
+        close(w->epfd);
+#endif
+    }
+    free(host->worker);
+    host->worker = NULL;
+    host->i_worker = 0;
+}
+
+void httpd_HostGetStats(httpd_host_t *host, httpd_host_stats_t *stats)
+{
+    vlc_mutex_lock(&host->lock);
+    stats->i_workers = host->i_worker;
+    stats->i_clients = 0;
+    stats->i_backlog = 0;
+    for (unsigned i = 0; i < host->i_worker; i++) {
+        stats->i_clients += host->worker[i].i_client;
+        stats->i_backlog += host->worker[i].i_backlog;
+    }
+    stats->i_accepted = host->i_accepted;
+    stats->i_sent     = host->i_sent;
+    stats->i_lagged   = host->i_lagged;
+    vlc_mutex_unlock(&host->lock);
+}
+
 /* delete a host */
 void httpd_HostDelete(httpd_host_t *host)
 {
@@ -1029,24 +1292,18 @@ void httpd_HostDelete(httpd_host_t *host)
     }
     TAB_REMOVE(httpd.i_host, httpd.host, host);
 
-    vlc_cancel(host->thread);
-    vlc_join(host->thread, NULL);
+    httpd_host_stats_t stats;
+    httpd_HostGetStats(host, &stats);
+
+    httpd_HostStopWorkers(host);
 
-    msg_Dbg(host, "HTTP host removed");
+    msg_Dbg(host, "HTTP host removed (%"PRIu64" connections, "
+            "%"PRIu64" bytes sent, %"PRIu64" lagging clients)",
+            stats.i_accepted, stats.i_sent, stats.i_lagged);
 
     for (int i = 0; i < host->i_url; i++)
         msg_Err(host, "url still registered: %s", host->url[i]->psz_url);
 
-    for (int i = 0; i < host->i_client; i++) {
-        httpd_client_t *cl = host->client[i];
-        msg_Warn(host, "client still connected");
-        httpd_ClientClean(cl);
-        TAB_REMOVE(host->i_client, host->client, cl);
-        free(cl);
-        i--;
-        /* TODO */
-    }
-
     vlc_tls_Delete(host->p_tls);
     net_ListenClose(host->fds);
     vlc_cond_destroy(&host->wait);
@@ -1084,7 +1341,7 @@ httpd_url_t *httpd_UrlNew(httpd_host_t *host, const char *psz_url,
     }
 
     TAB_APPEND(host->i_url, host->url, url);
-    vlc_cond_signal(&host->wait);
+    vlc_cond_broadcast(&host->wait);
     vlc_mutex_unlock(&host->lock);
 
     return url;
@@ -1110,24 +1367,42 @@ void httpd_UrlDelete(httpd_url_t *url)
     vlc_mutex_lock(&host->lock);
     TAB_REMOVE(host->i_url, host->url, url);
 
-    vlc_mutex_destroy(&url->lock);
-    free(url->psz_url);
-    free(url->psz_user);
-    free(url->psz_password);
+    /* Wait for the workers to be done with the clients of this url. Then
+     * detach the clients, and wake their workers up to close them. */
+    for (;;) {
+        bool b_busy = false;
 
-    for (int i = 0; i < host->i_client; i++) {
-        httpd_client_t *client = host->client[i];
+        for (unsigned i = 0; i < host->i_worker && !b_busy; i++) {
+            httpd_worker_t *w = &host->worker[i];
 
-        if (client->url != url)
-            continue;
+            for (int j = 0; j < w->i_client && !b_busy; j++)
+                b_busy = w->client[j]->url == url && w->client[j]->b_busy;
+        }
+        if (!b_busy)
+            break;
+        vlc_cond_wait(&host->wait, &host->lock);
+    }
 
-        /* TODO complete it */
-        msg_Warn(host, "force closing connections");
-        httpd_ClientClean(client);
-        TAB_REMOVE(host->i_client, host->client, client);
-        free(client);
-        i--;
+    for (unsigned i = 0; i < host->i_worker; i++) {
+        httpd_worker_t *w = &host->worker[i];
+
+        for (int j = 0; j < w->i_client; j++) {
+            httpd_client_t *client = w->client[j];
+
+            if (client->url != url)
+                continue;
+
+            msg_Warn(host, "force closing connections");
+            client->url = NULL;
+            client->i_state = HTTPD_CLIENT_DEAD;
+            shutdown(client->fd, SHUT_RDWR);
+        }
     }
+
+    vlc_mutex_destroy(&url->lock);
+    free(url->psz_url);
+    free(url->psz_user);
+    free(url->psz_password);
     free(url);
     vlc_mutex_unlock(&host->lock);
 }
@@ -1209,6 +1484,8 @@ static void httpd_ClientInit(httpd_client_t *cl, mtime_t now)
     cl->i_buffer_size = HTTPD_CL_BUFSIZE;
     cl->i_buffer = 0;
     cl->p_buffer = xmalloc(cl->i_buffer_size);
+    cl->p_buffer_chunk = NULL;
+    cl->p_body_chunk = NULL;
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
 
@@ -1226,6 +1503,31 @@ char* httpd_ServerIP(const httpd_client_t *cl, char *ip, int *port)
     return net_GetSockAddress(cl->fd, ip, port) ? NULL : ip;
 }
 
+/* Releases the data being sent */
+static void httpd_ClientFreeBuffer(httpd_client_t *cl)
+{
+    if (cl->p_buffer_chunk != NULL) {
+        block_Release(cl->p_buffer_chunk);
+        cl->p_buffer_chunk = NULL;
+    } else
+        free(cl->p_buffer);
+    cl->p_buffer = NULL;
+}
+
+/* Moves the answer body to the send buffer */
+static void httpd_ClientTakeBody(httpd_client_t *cl)
+{
+    httpd_ClientFreeBuffer(cl);
+    cl->p_buffer       = cl->answer.p_body;
+    cl->p_buffer_chunk = cl->p_body_chunk;
+    cl->i_buffer_size  = cl->answer.i_body;
+    cl->i_buffer       = 0;
+
+    cl->answer.p_body = NULL;
+    cl->answer.i_body = 0;
+    cl->p_body_chunk  = NULL;
+}
+
 static void httpd_ClientClean(httpd_client_t *cl)
 {
     if (cl->fd >= 0) {
@@ -1235,11 +1537,15 @@ static void httpd_ClientClean(httpd_client_t *cl)
         cl->fd = -1;
     }
 
+    if (cl->p_body_chunk != NULL) {
+        block_Release(cl->p_body_chunk);
+        cl->p_body_chunk = NULL;
+        cl->answer.p_body = NULL;
+    }
     httpd_MsgClean(&cl->answer);
     httpd_MsgClean(&cl->query);
 
-    free(cl->p_buffer);
-    cl->p_buffer = NULL;
+    httpd_ClientFreeBuffer(cl);
 }
 
 static httpd_client_t *httpd_ClientNew(int fd, vlc_tls_t *p_tls, mtime_t now)
@@ -1250,7 +1556,10 @@ static httpd_client_t *httpd_ClientNew(int fd, vlc_tls_t *p_tls, mtime_t now)
 
     cl->i_ref   = 0;
     cl->fd      = fd;
+    cl->i_events = 0;
+    cl->b_busy  = false;
     cl->url     = NULL;
+    cl->worker  = NULL;
     cl->p_tls = p_tls;
 
     httpd_ClientInit(cl, now);
@@ -1592,7 +1901,8 @@ static void httpd_ClientRecv(httpd_client_t *cl)
         cl->i_activity_timeout = 0;
 }
 
-static void httpd_ClientSend(httpd_client_t *cl)
+/* Called without the host lock, returns the number of bytes sent */
+static size_t httpd_ClientSend(httpd_client_t *cl)
 {
     int i_len;
 
@@ -1607,9 +1917,9 @@ static void httpd_ClientSend(httpd_client_t *cl)
             i_size += strlen(cl->answer.p_headers[i].name) + 2 +
                       strlen(cl->answer.p_headers[i].value) + 2;
 
-        if (cl->i_buffer_size < i_size) {
+        if (cl->p_buffer_chunk != NULL || cl->i_buffer_size < i_size) {
             cl->i_buffer_size = i_size;
-            free(cl->p_buffer);
+            httpd_ClientFreeBuffer(cl);
             cl->p_buffer = xmalloc(i_size);
         }
         p = (char *)cl->p_buffer;
@@ -1635,28 +1945,25 @@ static void httpd_ClientSend(httpd_client_t *cl)
         if (cl->i_buffer >= cl->i_buffer_size) {
             if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
                 /* catch more body data */
+                httpd_host_t *host = cl->worker->host;
                 int     i_msg = cl->query.i_type;
                 int64_t i_offset = cl->answer.i_body_offset;
 
                 httpd_MsgClean(&cl->answer);
                 cl->answer.i_body_offset = i_offset;
 
+                vlc_mutex_lock(&host->lock);
                 cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
                                           &cl->answer, &cl->query);
+                vlc_mutex_unlock(&host->lock);
             }
 
-            if (cl->answer.i_body > 0) {
-                /* send the body data */
-                free(cl->p_buffer);
-                cl->p_buffer = cl->answer.p_body;
-                cl->i_buffer_size = cl->answer.i_body;
-                cl->i_buffer = 0;
-
-                cl->answer.i_body = 0;
-                cl->answer.p_body = NULL;
-            } else /* send finished */
+            if (cl->answer.i_body > 0) /* send the body data */
+                httpd_ClientTakeBody(cl);
+            else if (cl->i_state != HTTPD_CLIENT_DEAD) /* send finished */
                 cl->i_state = HTTPD_CLIENT_SEND_DONE;
         }
+        return i_len;
     } else {
 #if defined(_WIN32)
         if ((i_len < 0 && WSAGetLastError() != WSAEWOULDBLOCK) || (i_len == 0))
@@ -1667,6 +1974,7 @@ static void httpd_ClientSend(httpd_client_t *cl)
             /* error */
             cl->i_state = HTTPD_CLIENT_DEAD;
         }
+        return 0;
     }
 }
 
@@ -1721,18 +2029,108 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+/* Poll events a client waits for in its current state */
+static short httpd_ClientEvents(const httpd_client_t *cl)
+{
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING:
+        case HTTPD_CLIENT_TLS_HS_IN:
+            return POLLIN;
+
+        case HTTPD_CLIENT_SENDING:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            return POLLOUT;
+    }
+    return 0;
+}
+
+static void httpd_WorkerRemove(httpd_worker_t *w, httpd_client_t *cl)
+{
+#ifdef HTTPD_EPOLL
+    epoll_ctl(w->epfd, EPOLL_CTL_DEL, cl->fd, NULL);
+#endif
+    httpd_ClientClean(cl);
+    TAB_REMOVE(w->i_client, w->client, cl);
+    free(cl);
+}
+
+/* Accepts a connection from a listening socket, if no other worker did */
+static void httpd_WorkerAccept(httpd_worker_t *w, int fd, mtime_t now)
+{
+    httpd_host_t *host = w->host;
+
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+            &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *p_tls;
+
+    if (host->p_tls != NULL)
+    {
+        const char *alpn[] = { "http/1.1", NULL };
+
+        p_tls = vlc_tls_SessionCreate(host->p_tls, fd, NULL, alpn);
+    }
+    else
+        p_tls = NULL;
+
+    httpd_client_t *cl = httpd_ClientNew(fd, p_tls, now);
+    if (unlikely(cl == NULL)) {
+        if (p_tls != NULL)
+            vlc_tls_SessionDelete(p_tls);
+        net_Close(fd);
+        return;
+    }
+    cl->worker = w;
+
+#ifdef HTTPD_EPOLL
+    /* the events are set by the next pass */
+    struct epoll_event ev = { .events = 0, .data.ptr = cl };
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, fd, &ev)) {
+        msg_Err(host, "cannot watch client: %s", vlc_strerror_c(errno));
+        httpd_ClientClean(cl);
+        free(cl);
+        return;
+    }
+#endif
+
+    TAB_APPEND(w->i_client, w->client, cl);
+    host->i_accepted++;
+}
+
+/* Does the network I/O of a client, without the host lock */
+static size_t httpd_ClientIO(httpd_client_t *cl)
+{
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
+        case HTTPD_CLIENT_SENDING:   return httpd_ClientSend(cl);
+        case HTTPD_CLIENT_TLS_HS_IN:
+        case HTTPD_CLIENT_TLS_HS_OUT: httpd_ClientTlsHandshake(cl); break;
+    }
+    return 0;
+}
+
+static void httpdLoop(httpd_worker_t *w)
 {
-    struct pollfd ufd[host->nfd + host->i_client];
+    httpd_host_t *host = w->host;
+#ifdef HTTPD_EPOLL
+    struct epoll_event ev[HTTPD_EPOLL_EVENTS];
+    httpd_client_t *ready[HTTPD_EPOLL_EVENTS];
+#else
+    struct pollfd ufd[host->nfd + w->i_client];
+    httpd_client_t *ready[w->i_client + 1];
     unsigned nfd;
     for (nfd = 0; nfd < host->nfd; nfd++) {
         ufd[nfd].fd = host->fds[nfd];
         ufd[nfd].events = POLLIN;
         ufd[nfd].revents = 0;
     }
+#endif
 
     /* add all socket that should be read/write and close dead connection */
-    while (host->i_url <= 0) {
+    while (host->i_url <= 0 && w->i_client == 0) {
         mutex_cleanup_push(&host->lock);
         vlc_cond_wait(&host->wait, &host->lock);
         vlc_cleanup_pop();
@@ -1740,39 +2138,22 @@ static void httpdLoop(httpd_host_t *host)
 
     mtime_t now = mdate();
     bool b_low_delay = false;
+    size_t i_backlog = 0;
 
     int canc = vlc_savecancel();
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
+    for (int i_client = 0; i_client < w->i_client; i_client++) {
         int64_t i_offset;
-        httpd_client_t *cl = host->client[i_client];
+        httpd_client_t *cl = w->client[i_client];
         if (cl->i_ref < 0 || (cl->i_ref == 0 &&
                     (cl->i_state == HTTPD_CLIENT_DEAD ||
                       (cl->i_activity_timeout > 0 &&
                         cl->i_activity_date+cl->i_activity_timeout < now)))) {
-            httpd_ClientClean(cl);
-            TAB_REMOVE(host->i_client, host->client, cl);
-            free(cl);
+            httpd_WorkerRemove(w, cl);
             i_client--;
             continue;
         }
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
-
-        pufd->fd = cl->fd;
-        pufd->events = pufd->revents = 0;
-
         switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-            case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
-                break;
-
-            case HTTPD_CLIENT_SENDING:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
-                break;
-
             case HTTPD_CLIENT_RECEIVE_DONE: {
                 httpd_message_t *answer = &cl->answer;
                 httpd_message_t *query  = &cl->query;
@@ -1937,9 +2318,9 @@ static void httpdLoop(httpd_host_t *host)
                         httpd_MsgClean(&cl->query);
                         httpd_MsgInit(&cl->query);
 
+                        httpd_ClientFreeBuffer(cl);
                         cl->i_buffer = 0;
                         cl->i_buffer_size = 1000;
-                        free(cl->p_buffer);
                         cl->p_buffer = xmalloc(cl->i_buffer_size);
                         cl->i_state = HTTPD_CLIENT_RECEIVING;
                     } else
@@ -1950,8 +2331,7 @@ static void httpdLoop(httpd_host_t *host)
                     httpd_MsgClean(&cl->answer);
 
                     cl->answer.i_body_offset = i_offset;
-                    free(cl->p_buffer);
-                    cl->p_buffer = NULL;
+                    httpd_ClientFreeBuffer(cl);
                     cl->i_buffer = 0;
                     cl->i_buffer_size = 0;
 
@@ -1970,25 +2350,52 @@ static void httpdLoop(httpd_host_t *host)
                         &cl->answer, &cl->query);
                 if (cl->answer.i_type != HTTPD_MSG_NONE) {
                     /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
+                    httpd_ClientTakeBody(cl);
                     cl->i_state = HTTPD_CLIENT_SENDING;
                 }
         }
 
-        if (pufd->events != 0)
-            nfd++;
-        else
+        short events = httpd_ClientEvents(cl);
+        if (events == 0)
             b_low_delay = true;
+        else if (cl->i_state == HTTPD_CLIENT_SENDING && cl->i_buffer >= 0)
+            i_backlog += cl->i_buffer_size - cl->i_buffer;
+
+#ifdef HTTPD_EPOLL
+        if (events != cl->i_events) {
+            struct epoll_event cev = {
+                .events = ((events & POLLIN) ? EPOLLIN : 0)
+                        | ((events & POLLOUT) ? EPOLLOUT : 0),
+                .data.ptr = cl,
+            };
+
+            if (epoll_ctl(w->epfd, EPOLL_CTL_MOD, cl->fd, &cev) == 0)
+                cl->i_events = events;
+            else
+                cl->i_state = HTTPD_CLIENT_DEAD;
+        }
+#else
+        if (events != 0) {
+            assert(nfd < sizeof (ufd) / sizeof (ufd[0]));
+            ufd[nfd].fd = cl->fd;
+            ufd[nfd].events = events;
+            ufd[nfd].revents = 0;
+            nfd++;
+        }
+        cl->i_events = events;
+#endif
     }
+    w->i_backlog = i_backlog;
     vlc_mutex_unlock(&host->lock);
     vlc_restorecancel(canc);
 
     /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
+#ifdef HTTPD_EPOLL
+    int ret = epoll_wait(w->epfd, ev, HTTPD_EPOLL_EVENTS,
+                         b_low_delay ? 20 : -1);
+#else
     int ret = poll(ufd, nfd, b_low_delay ? 20 : -1);
+#endif
 
     canc = vlc_savecancel();
     vlc_mutex_lock(&host->lock);
@@ -2004,75 +2411,83 @@ static void httpdLoop(httpd_host_t *host)
             return;
     }
 
-    /* Handle client sockets */
+    /* Pick the client sockets with events, and accept new connections */
     now = mdate();
-    nfd = host->nfd;
+    unsigned i_ready = 0;
+    bool b_accept = false;
 
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
-        httpd_client_t *cl = host->client[i_client];
-        const struct pollfd *pufd = &ufd[nfd];
+#ifdef HTTPD_EPOLL
+    for (int i = 0; i < ret; i++) {
+        httpd_client_t *cl = ev[i].data.ptr;
 
-        assert(pufd < &ufd[sizeof(ufd) / sizeof(ufd[0])]);
+        if (cl == NULL) {
+            b_accept = true; /* listening socket */
+            continue;
+        }
+
+        if (cl->i_state == HTTPD_CLIENT_DEAD)
+            continue;
+        if (httpd_ClientEvents(cl) == 0) {
+            /* not waiting for I/O: the connection was closed or broken */
+            if (ev[i].events & (EPOLLHUP|EPOLLERR))
+                cl->i_state = HTTPD_CLIENT_DEAD;
+            continue;
+        }
+        cl->i_activity_date = now;
+        cl->b_busy = true;
+        ready[i_ready++] = cl;
+    }
+#else
+    for (nfd = 0; nfd < host->nfd; nfd++)
+        if (ufd[nfd].revents != 0)
+            b_accept = true;
 
-        if (cl->fd != pufd->fd)
+    for (int i_client = 0; i_client < w->i_client; i_client++) {
+        httpd_client_t *cl = w->client[i_client];
+        const struct pollfd *pufd = &ufd[nfd];
+
+        if (cl->i_events == 0)
             continue; // we were not waiting for this client
+        assert(pufd < &ufd[sizeof(ufd) / sizeof(ufd[0])]);
+        assert(cl->fd == pufd->fd);
         ++nfd;
-        if (pufd->revents == 0)
+        if (pufd->revents == 0 || cl->i_state == HTTPD_CLIENT_DEAD)
             continue; // no event received
 
         cl->i_activity_date = now;
-
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
-            case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
-            case HTTPD_CLIENT_TLS_HS_IN:
-            case HTTPD_CLIENT_TLS_HS_OUT: httpd_ClientTlsHandshake(cl); break;
-        }
+        cl->b_busy = true;
+        ready[i_ready++] = cl;
     }
+#endif
 
-    /* Handle server sockets (accept new connections) */
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        httpd_client_t *cl;
-        int fd = ufd[nfd].fd;
-
-        assert (fd == host->fds[nfd]);
-
-        if (ufd[nfd].revents == 0)
-            continue;
-
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
-            continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
-
-        vlc_tls_t *p_tls;
-
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
-
-            p_tls = vlc_tls_SessionCreate(host->p_tls, fd, NULL, alpn);
-        }
-        else
-            p_tls = NULL;
+    if (b_accept)
+        for (unsigned i = 0; i < host->nfd; i++)
+            httpd_WorkerAccept(w, host->fds[i], now);
+    vlc_mutex_unlock(&host->lock);
 
-        cl = httpd_ClientNew(fd, p_tls, now);
+    /* Handle client sockets, other workers can run meanwhile */
+    uint64_t i_sent = 0;
+    for (unsigned i = 0; i < i_ready; i++)
+        i_sent += httpd_ClientIO(ready[i]);
 
-        TAB_APPEND(host->i_client, host->client, cl);
-    }
+    vlc_mutex_lock(&host->lock);
+    for (unsigned i = 0; i < i_ready; i++)
+        ready[i]->b_busy = false;
+    if (i_ready > 0)
+        vlc_cond_broadcast(&host->wait); /* see httpd_UrlDelete() */
+    host->i_sent += i_sent;
 
     vlc_restorecancel(canc);
 }
 
 static void* httpd_HostThread(void *data)
 {
-    httpd_host_t *host = data;
+    httpd_worker_t *w = data;
+    httpd_host_t *host = w->host;
 
     vlc_mutex_lock(&host->lock);
     while (host->i_ref > 0)
-        httpdLoop(host);
+        httpdLoop(w);
     vlc_mutex_unlock(&host->lock);
     return NULL;
 }
@@ -48,6 +48,7 @@
 #endif
 
 #include <vlc_network.h>
+#include <vlc_interrupt.h>
 
 #ifndef INADDR_ANY
 #   define INADDR_ANY  0x00000000
@@ -256,6 +257,8 @@ int *net_Listen (vlc_object_t *p_this, const char *psz_host,
  * If waitall is true, then we repeat until we have read the right amount of
  * data; in that case, a short count means EOF has been reached or the VLC
  * object has been signaled.
+ * The wait for data is interrupted (EINTR) by the VLC object being killed or
+ * by the interrupt context of the calling thread.
  *****************************************************************************/
 ssize_t
 net_Read (vlc_object_t *restrict p_this, int fd, const v_socket_t *vs,
@@ -341,10 +344,13 @@ net_Read (vlc_object_t *restrict p_this, int fd, const v_socket_t *vs,
 do_poll:
 #endif
         /* Wait for more data */
-        if (poll (ufd, sizeof (ufd) / sizeof (ufd[0]), -1) < 0)
+        if (vlc_poll_i11e (ufd, sizeof (ufd) / sizeof (ufd[0]), -1) < 0)
         {
             if (errno == EINTR)
-                continue;
+            {
+                msg_Dbg (p_this, "socket %d read interrupted", fd);
+                return -1;
+            }
             goto error;
         }
 
@@ -372,6 +378,8 @@ error:
  *
  * This function is a cancellation point if p_vs is NULL.
  * This function is not cancellation-safe if p_vs is not NULL.
+ * The wait for buffer space is interrupted by the VLC object being killed or
+ * by the interrupt context of the calling thread.
  *
  * @return the total number of bytes written, or -1 if an error occurs
  * before any data is written.
@@ -397,10 +405,14 @@ ssize_t net_Write( vlc_object_t *p_this, int fd, const v_socket_t *p_vs,
 
         ufd[0].revents = ufd[1].revents = 0;
 
-        if (poll (ufd, sizeof (ufd) / sizeof (ufd[0]), -1) == -1)
+        if (vlc_poll_i11e (ufd, sizeof (ufd) / sizeof (ufd[0]), -1) == -1)
         {
             if (errno == EINTR)
-                continue;
+            {   /* Interrupted: return what was written, if anything */
+                if (i_total > 0)
+                    break;
+                goto error;
+            }
             msg_Err (p_this, "Polling error: %s", vlc_strerror_c(errno));
             return -1;
         }
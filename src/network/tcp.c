@@ -40,6 +40,7 @@
 #endif
 
 #include <vlc_network.h>
+#include <vlc_interrupt.h>
 #if defined (_WIN32)
 #   undef EINPROGRESS
 #   define EINPROGRESS WSAEWOULDBLOCK
@@ -172,14 +173,17 @@ int net_Connect( vlc_object_t *p_this, const char *psz_host, int i_port,
                 { .fd = evfd, .events = POLLIN },
             };
 
-            do
-                /* NOTE: timeout screwed up if we catch a signal (EINTR) */
-                val = poll (ufd, sizeof (ufd) / sizeof (ufd[0]), timeout);
-            while ((val == -1) && (net_errno == EINTR));
-
+            val = vlc_poll_i11e (ufd, sizeof (ufd) / sizeof (ufd[0]),
+                                 timeout);
             switch (val)
             {
                  case -1: /* error */
+                     if (net_errno == EINTR)
+                     {   /* thread interrupted: do not try other addresses */
+                         msg_Dbg (p_this, "connection interrupted");
+                         net_Close (fd);
+                         goto out;
+                     }
                      msg_Err (p_this, "polling error: %s",
                               vlc_strerror_c(net_errno));
                      goto next_ai;
@@ -211,7 +215,7 @@ int net_Connect( vlc_object_t *p_this, const char *psz_host, int i_port,
 next_ai: /* failure */
         net_Close( fd );
     }
-
+out:
     freeaddrinfo( res );
 
     if( i_handle == -1 )
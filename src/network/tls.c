@@ -34,12 +34,14 @@
 # include <poll.h>
 #endif
 #include <assert.h>
+#include <errno.h>
 
 #include <vlc_common.h>
 #include "libvlc.h"
 
 #include <vlc_tls.h>
 #include <vlc_modules.h>
+#include <vlc_interrupt.h>
 
 /*** TLS credentials ***/
 
@@ -219,11 +221,17 @@ vlc_tls_t *vlc_tls_ClientSessionCreate (vlc_tls_creds_t *crd, int fd,
         assert (val <= 2);
         ufd[0] .events = (val == 1) ? POLLIN : POLLOUT;
 
-        if (poll (ufd, 1, (deadline - now) / 1000) == 0)
+        val = vlc_poll_i11e (ufd, 1, (deadline - now) / 1000);
+        if (val == 0)
         {
             msg_Err (session, "TLS client session handshake timeout");
             goto error;
         }
+        if (val < 0 && errno == EINTR)
+        {
+            msg_Dbg (session, "TLS client session handshake interrupted");
+            goto error;
+        }
     }
     return session;
 error:
@@ -136,26 +136,78 @@ end:
     return psz_path;
 }
 
-static char *ArtCacheName( input_item_t *p_item, const char *psz_type )
+/* The images are stored once, named after the MD5 sum of their data, and
+ * the directories of the items only link to them: the tracks of an album
+ * sharing the same embedded cover use a single file. */
+static char *ArtCacheContentDir( void )
 {
-    char *psz_path = ArtCachePath( p_item );
-    if( !psz_path )
-        return NULL;
+    char *psz_cachedir = config_GetUserDir(VLC_CACHE_DIR);
+    char *psz_dir;
+    if( psz_cachedir == NULL
+     || asprintf( &psz_dir, "%s" DIR_SEP "art" DIR_SEP "content",
+                  psz_cachedir ) == -1 )
+        psz_dir = NULL;
+    free( psz_cachedir );
+    return psz_dir;
+}
 
-    ArtCacheCreateDir( psz_path );
+static char *ArtCacheContentName( const void *data, size_t length,
+                                  const char *psz_type )
+{
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, data, length );
+    EndMD5( &md5 );
 
+    char *psz_hash = psz_md5_hash( &md5 );
     char *psz_ext = strdup( psz_type ? psz_type : "" );
-    filename_sanitize( psz_ext );
-    char *psz_filename;
-    if( asprintf( &psz_filename, "%s" DIR_SEP "art%s", psz_path, psz_ext ) < 0 )
-        psz_filename = NULL;
+    char *psz_dir = ArtCacheContentDir();
+    char *psz_filename = NULL;
 
+    if( psz_hash != NULL && psz_ext != NULL && psz_dir != NULL )
+    {
+        filename_sanitize( psz_ext );
+        if( asprintf( &psz_filename, "%s" DIR_SEP "%s%s", psz_dir, psz_hash,
+                      psz_ext ) < 0 )
+            psz_filename = NULL;
+    }
+    free( psz_dir );
     free( psz_ext );
-    free( psz_path );
-
+    free( psz_hash );
     return psz_filename;
 }
 
+/* Reads the URI of the stored image linked by a directory of the cache */
+static char *ArtCacheReadLink( const char *psz_link )
+{
+    FILE *f = vlc_fopen( psz_link, "rt" );
+    if( f == NULL )
+        return NULL;
+
+    char *psz_uri = NULL;
+    size_t i_len = 0;
+    ssize_t i_read = getline( &psz_uri, &i_len, f );
+    fclose( f );
+    if( i_read <= 0 )
+    {
+        free( psz_uri );
+        return NULL;
+    }
+    if( psz_uri[i_read - 1] == '\n' )
+        psz_uri[i_read - 1] = '\0';
+
+    /* The image itself may have been cleaned up */
+    struct stat s;
+    char *psz_file = make_path( psz_uri );
+    if( psz_file == NULL || vlc_stat( psz_file, &s ) )
+    {
+        free( psz_uri );
+        psz_uri = NULL;
+    }
+    free( psz_file );
+    return psz_uri;
+}
+
 /* */
 int playlist_FindArtInCache( input_item_t *p_item )
 {
@@ -164,7 +216,21 @@ int playlist_FindArtInCache( input_item_t *p_item )
     if( !psz_path )
         return VLC_EGENERIC;
 
-    /* Check if file exists */
+    char *psz_link;
+    if( asprintf( &psz_link, "%s" DIR_SEP "link", psz_path ) != -1 )
+    {
+        char *psz_uri = ArtCacheReadLink( psz_link );
+        free( psz_link );
+        if( psz_uri )
+        {
+            input_item_SetArtURL( p_item, psz_uri );
+            free( psz_uri );
+            free( psz_path );
+            return VLC_SUCCESS;
+        }
+    }
+
+    /* Check if file exists (art stored in the directory itself) */
     DIR *p_dir = vlc_opendir( psz_path );
     if( !p_dir )
     {
@@ -266,44 +332,71 @@ int playlist_FindArtInCacheUsingItemUID( input_item_t *p_item )
 int playlist_SaveArt( vlc_object_t *obj, input_item_t *p_item,
                       const void *data, size_t length, const char *psz_type )
 {
-    char *psz_filename = ArtCacheName( p_item, psz_type );
-
-    if( !psz_filename )
+    char *psz_path = ArtCachePath( p_item );
+    if( !psz_path )
         return VLC_EGENERIC;
 
-    char *psz_uri = vlc_path2uri( psz_filename, "file" );
+    char *psz_filename = ArtCacheContentName( data, length, psz_type );
+    char *psz_uri = psz_filename ? vlc_path2uri( psz_filename, "file" ) : NULL;
     if( !psz_uri )
     {
         free( psz_filename );
+        free( psz_path );
         return VLC_EGENERIC;
     }
 
-    /* Check if we already dumped it */
+    /* Check if we already dumped it, maybe for another item */
     struct stat s;
     if( !vlc_stat( psz_filename, &s ) )
+        msg_Dbg( obj, "album art already saved to %s", psz_filename );
+    else
     {
-        input_item_SetArtURL( p_item, psz_uri );
-        free( psz_filename );
-        free( psz_uri );
-        return VLC_SUCCESS;
-    }
-
-    /* Dump it otherwise */
-    FILE *f = vlc_fopen( psz_filename, "wb" );
-    if( f )
-    {
-        if( fwrite( data, 1, length, f ) != length )
+        /* Dump it otherwise, to a temporary file first, so that a partial
+         * image is never found */
+        char *psz_dir = ArtCacheContentDir();
+        if( psz_dir == NULL )
+            goto error;
+        ArtCacheCreateDir( psz_dir );
+        free( psz_dir );
+
+        char *psz_tmp;
+        if( asprintf( &psz_tmp, "%s.tmp", psz_filename ) == -1 )
+            goto error;
+
+        FILE *f = vlc_fopen( psz_tmp, "wb" );
+        bool b_ok = f != NULL && fwrite( data, 1, length, f ) == length;
+        if( f != NULL && fclose( f ) )
+            b_ok = false;
+        if( b_ok && vlc_rename( psz_tmp, psz_filename ) )
+            b_ok = false;
+        if( !b_ok )
         {
             msg_Err( obj, "%s: %s", psz_filename, vlc_strerror_c(errno) );
+            vlc_unlink( psz_tmp );
+            free( psz_tmp );
+            goto error;
         }
-        else
+        free( psz_tmp );
+        msg_Dbg( obj, "album art saved to %s", psz_filename );
+    }
+    input_item_SetArtURL( p_item, psz_uri );
+
+    /* link the directory of the item to the image */
+    ArtCacheCreateDir( psz_path );
+
+    char *psz_link;
+    if( asprintf( &psz_link, "%s" DIR_SEP "link", psz_path ) != -1 )
+    {
+        FILE *f = vlc_fopen( psz_link, "wt" );
+        if( f )
         {
-            msg_Dbg( obj, "album art saved to %s", psz_filename );
-            input_item_SetArtURL( p_item, psz_uri );
+            if( fputs( psz_uri, f ) < 0 )
+                msg_Err( obj, "Error writing %s: %s", psz_link,
+                         vlc_strerror_c(errno) );
+            fclose( f );
         }
-        fclose( f );
+        free( psz_link );
     }
-    free( psz_uri );
 
     /* save uid info */
     char *uid = input_item_GetInfo( p_item, "uid", "md5" );
@@ -320,10 +413,10 @@ int playlist_SaveArt( vlc_object_t *obj, input_item_t *p_item,
 
     if ( psz_byuidfile )
     {
-        f = vlc_fopen( psz_byuidfile, "wb" );
+        FILE *f = vlc_fopen( psz_byuidfile, "wb" );
         if ( f )
         {
-            if( fputs( "file://", f ) < 0 || fputs( psz_filename, f ) < 0 )
+            if( fputs( psz_uri, f ) < 0 )
                 msg_Err( obj, "Error writing %s: %s", psz_byuidfile,
                          vlc_strerror_c(errno) );
             fclose( f );
@@ -333,7 +426,14 @@ int playlist_SaveArt( vlc_object_t *obj, input_item_t *p_item,
     free( uid );
     /* !save uid info */
 end:
+    free( psz_uri );
     free( psz_filename );
+    free( psz_path );
     return VLC_SUCCESS;
-}
 
+error:
+    free( psz_uri );
+    free( psz_filename );
+    free( psz_path );
+    return VLC_EGENERIC;
+}
@@ -230,6 +230,12 @@ playlist_t *playlist_Create( vlc_object_t *p_parent )
 
     pl_priv(p_playlist)->b_tree = var_InheritBool( p_parent, "playlist-tree" );
 
+    p->input_index.pp_slots = NULL;
+    p->input_index.i_size = 0;
+    p->input_index.i_used = 0;
+    p->sort.i_node_id = -1;
+    p->search.psz_string = NULL;
+
     /* Create the root, playing items and meida library nodes */
     playlist_item_t *root, *playing, *ml;
 
@@ -353,6 +359,8 @@ void playlist_Destroy( playlist_t *p_playlist )
         free( p_del );
     FOREACH_END();
     ARRAY_RESET( p_playlist->all_items );
+    playlist_InputIndexClean( p_playlist );
+    free( p_sys->search.psz_string );
     FOREACH_ARRAY( playlist_item_t *p_del, p_sys->items_to_delete )
         free( p_del->pp_children );
         vlc_gc_decref( p_del->p_input );
@@ -55,6 +55,7 @@ static void input_item_add_subitem_tree ( const vlc_event_t * p_event,
     input_item_t *p_input = p_event->p_obj;
     playlist_t *p_playlist = (( playlist_item_t* ) user_data)->p_playlist;
     input_item_node_t *p_new_root = p_event->u.input_item_subitem_tree_added.p_root;
+    bool b_partial = p_event->u.input_item_subitem_tree_added.b_partial;
 
     PL_LOCK;
 
@@ -67,8 +68,12 @@ static void input_item_add_subitem_tree ( const vlc_event_t * p_event,
     bool b_autostart = var_GetBool( p_playlist, "playlist-autostart" );
     bool b_stop = p_item->i_flags & PLAYLIST_SUBITEM_STOP_FLAG;
     bool b_flat = false;
+    /* items inserted for the partial posts of the sub-items, if any */
+    playlist_item_t *p_expanded = p_item;
+    int i_partial = p_item->i_partial;
 
-    p_item->i_flags &= ~PLAYLIST_SUBITEM_STOP_FLAG;
+    if( !b_partial )
+        p_item->i_flags &= ~PLAYLIST_SUBITEM_STOP_FLAG;
 
     /* We will have to flatten the tree out if we are in "the playlist" node and
     the user setting demands flat playlist */
@@ -89,7 +94,7 @@ static void input_item_add_subitem_tree ( const vlc_event_t * p_event,
     int pos = 0;
 
     /* If we have to flatten out, then take the item's position in the parent as
-    insertion point and delete the item */
+    insertion point and delete the item (once all its sub-items are there) */
 
     if( b_flat )
     {
@@ -107,7 +112,8 @@ static void input_item_add_subitem_tree ( const vlc_event_t * p_event,
         }
         assert( i < p_parent->i_children );
 
-        playlist_DeleteItem( p_playlist, p_item, true );
+        if( !b_partial )
+            playlist_DeleteItem( p_playlist, p_item, true );
 
         p_item = p_parent;
     }
@@ -128,6 +134,20 @@ static void input_item_add_subitem_tree ( const vlc_event_t * p_event,
 
     if( !b_flat ) var_SetInteger( p_playlist, "leaf-to-parent", p_item->i_id );
 
+    /* The input expanding the item would be stopped by the playback of one of
+    its sub-items: playback waits for all of them */
+    if( b_partial )
+    {
+        p_expanded->i_partial += last_pos - pos;
+        b_current = false;
+    }
+    else
+    {
+        pos -= i_partial; /* first sub-item inserted */
+        if( !b_flat )
+            p_expanded->i_partial = 0;
+    }
+
     //control playback only if it was the current playing item that got subitems
     if( b_current )
     {
@@ -238,6 +258,7 @@ playlist_item_t *playlist_ItemNewFromInput( playlist_t *p_playlist,
     p_item->i_children = -1;
     p_item->pp_children = NULL;
     p_item->i_nb_played = 0;
+    p_item->i_partial = 0;
     p_item->i_flags = 0;
     p_item->p_playlist = p_playlist;
 
@@ -563,7 +584,11 @@ int playlist_InsertInputItemTree (
     input_item_node_t *p_node, int i_pos, bool b_flat )
 {
     playlist_item_t *p_first_leaf = NULL;
-    return RecursiveAddIntoParent ( p_playlist, p_parent, p_node, i_pos, b_flat, &p_first_leaf );
+    int i_ret = RecursiveAddIntoParent ( p_playlist, p_parent, p_node, i_pos, b_flat, &p_first_leaf );
+
+    /* Wake the engine up once for the whole tree */
+    vlc_cond_signal( &pl_priv(p_playlist)->signal );
+    return i_ret;
 }
 
 
@@ -629,6 +654,9 @@ int playlist_TreeMove( playlist_t * p_playlist, playlist_item_t *p_item,
 {
     PL_ASSERT_LOCKED;
 
+    /* The user order replaces the sort */
+    pl_priv( p_playlist )->sort.i_node_id = -1;
+
     if( p_node->i_children == -1 ) return VLC_EGENERIC;
 
     playlist_item_t *p_detach = p_item->p_parent;
@@ -665,6 +693,9 @@ int playlist_TreeMoveMany( playlist_t *p_playlist,
 {
     PL_ASSERT_LOCKED;
 
+    /* The user order replaces the sort */
+    pl_priv( p_playlist )->sort.i_node_id = -1;
+
     if ( p_node->i_children == -1 ) return VLC_EGENERIC;
 
     int i;
@@ -765,7 +796,9 @@ static void GoAndPreparse( playlist_t *p_playlist, int i_mode,
     char *psz_album = input_item_GetAlbum( p_item->p_input );
     if( sys->p_preparser != NULL && !input_item_IsPreparsed( p_item->p_input )
      && (EMPTY_STR(psz_artist) || EMPTY_STR(psz_album)) )
-        playlist_preparser_Push( sys->p_preparser, p_item->p_input, 0 );
+        playlist_preparser_Push( sys->p_preparser, p_item->p_input,
+                                 (i_mode & PLAYLIST_GO)
+                                     ? META_REQUEST_OPTION_PRIORITY : 0 );
     free( psz_artist );
     free( psz_album );
 }
@@ -777,11 +810,12 @@ static void AddItem( playlist_t *p_playlist, playlist_item_t *p_item,
     PL_ASSERT_LOCKED;
     ARRAY_APPEND(p_playlist->items, p_item);
     ARRAY_APPEND(p_playlist->all_items, p_item);
+    playlist_InputIndexAdd( p_playlist, p_item );
 
+    /* Keep the order of the sorted nodes */
     if( i_pos == PLAYLIST_END )
-        playlist_NodeAppend( p_playlist, p_item, p_node );
-    else
-        playlist_NodeInsert( p_playlist, p_item, p_node, i_pos );
+        i_pos = playlist_NodeSortedPosition( p_playlist, p_node, p_item );
+    playlist_NodeInsert( p_playlist, p_item, p_node, i_pos );
 
     playlist_SendAddNotify( p_playlist, p_item->i_id, p_node->i_id,
                             !( i_mode & PLAYLIST_NO_REBUILD ) );
@@ -840,7 +874,7 @@ static int RecursiveAddIntoParent (
             p_new_item = playlist_NodeAddInput( p_playlist,
                     p_child_node->p_item,
                     p_parent,
-                    PLAYLIST_INSERT, i_pos,
+                    PLAYLIST_INSERT | PLAYLIST_NO_REBUILD, i_pos,
                     pl_Locked );
             if( !p_new_item ) return i_pos;
 
@@ -106,19 +106,27 @@ int playlist_Import( playlist_t *p_playlist, const char *psz_file )
     return input_Read( p_playlist, p_input );
 }
 
+struct ml_load
+{
+    playlist_t *p_playlist;
+    int         i_pos; /* insertion position of the next subitems */
+};
+
 /*****************************************************************************
  * A subitem has been added to the Media Library (Event Callback)
  *****************************************************************************/
 static void input_item_subitem_tree_added( const vlc_event_t * p_event,
                                       void * user_data )
 {
-    playlist_t *p_playlist = user_data;
+    struct ml_load *p_load = user_data;
+    playlist_t *p_playlist = p_load->p_playlist;
     input_item_node_t *p_root =
         p_event->u.input_item_subitem_tree_added.p_root;
 
     PL_LOCK;
-    playlist_InsertInputItemTree ( p_playlist, p_playlist->p_media_library,
-                                   p_root, 0, false );
+    p_load->i_pos = playlist_InsertInputItemTree( p_playlist,
+                                                  p_playlist->p_media_library,
+                                                  p_root, p_load->i_pos, false );
     PL_UNLOCK;
 }
 
@@ -168,14 +176,15 @@ int playlist_MLLoad( playlist_t *p_playlist )
 
     p_playlist->p_media_library->p_input = p_input;
 
+    struct ml_load load = { p_playlist, 0 };
     vlc_event_attach( &p_input->event_manager, vlc_InputItemSubItemTreeAdded,
-                        input_item_subitem_tree_added, p_playlist );
+                        input_item_subitem_tree_added, &load );
     PL_UNLOCK;
 
     input_Read( p_playlist, p_input );
 
     vlc_event_detach( &p_input->event_manager, vlc_InputItemSubItemTreeAdded,
-                        input_item_subitem_tree_added, p_playlist );
+                        input_item_subitem_tree_added, &load );
 
     return VLC_SUCCESS;
 }
@@ -58,6 +58,11 @@ typedef struct playlist_private_t
     input_thread_t *      p_input;  /**< the input thread associated
                                      * with the current item */
     input_resource_t *   p_input_resource; /**< input resources */
+    struct {
+        input_thread_t *p_input; /**< next input, pre-opened in standby */
+        bool            b_wanted; /**< the current input is about to end */
+        bool            b_done; /**< the next input was pre-opened, or not */
+    } standby;
     struct {
         /* Current status. These fields are readonly, only the playlist
          * main loop can touch it*/
@@ -87,6 +92,25 @@ typedef struct playlist_private_t
     bool     b_reset_currently_playing; /** Reset current item array */
 
     bool     b_tree; /**< Display as a tree */
+
+    struct {
+        /* All the items, by input item, with open addressing */
+        playlist_item_t **pp_slots;
+        size_t   i_size; /**< Number of slots (a power of two) */
+        size_t   i_used; /**< Slots in use, removed ones included */
+    } input_index;
+
+    struct {
+        int      i_node_id; /**< Last sorted node, or -1 */
+        int      i_mode;
+        int      i_type;
+    } sort;
+
+    struct {
+        char    *psz_string; /**< Last live search, or NULL */
+        int      i_root_id;
+        bool     b_recursive;
+    } search;
 } playlist_private_t;
 
 #define pl_priv( pl ) ((playlist_private_t *)(pl))
@@ -141,6 +165,13 @@ int playlist_NodeEmpty( playlist_t *, playlist_item_t *, bool );
 int playlist_DeleteItem( playlist_t * p_playlist, playlist_item_t *, bool);
 
 void ResetCurrentlyPlaying( playlist_t *p_playlist, playlist_item_t *p_cur );
+
+/* Indexes */
+void playlist_InputIndexAdd( playlist_t *, playlist_item_t * );
+void playlist_InputIndexRemove( playlist_t *, playlist_item_t * );
+void playlist_InputIndexClean( playlist_t * );
+int playlist_NodeSortedPosition( playlist_t *, playlist_item_t *,
+                                 playlist_item_t * );
 void ResyncCurrentIndex( playlist_t *p_playlist, playlist_item_t *p_cur );
 
 /**
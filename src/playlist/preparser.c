@@ -25,11 +25,15 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
+#include <vlc_url.h>
 
 #include "fetcher.h"
 #include "preparser.h"
 #include "input/input_interface.h"
+#include "input/item.h"
 
 /*****************************************************************************
  * Structures/definitions
@@ -40,6 +44,15 @@ struct preparser_entry_t
 {
     input_item_t    *p_item;
     input_item_meta_request_option_t i_options;
+    char            *psz_host; /**< server of a network item, or NULL */
+    preparser_entry_t *p_next;
+};
+
+enum
+{
+    QUEUE_PRIORITY = 0,
+    QUEUE_NORMAL,
+    QUEUE_COUNT
 };
 
 struct playlist_preparser_t
@@ -49,13 +62,52 @@ struct playlist_preparser_t
 
     vlc_mutex_t     lock;
     vlc_cond_t      wait;
-    bool            b_live;
-    preparser_entry_t  **pp_waiting;
-    int             i_waiting;
+    preparser_entry_t *p_waiting_head[QUEUE_COUNT];
+    preparser_entry_t **pp_waiting_tail[QUEUE_COUNT];
+    unsigned        i_waiting;
+
+    unsigned        i_live;      /**< worker threads */
+    unsigned        i_idle;      /**< workers waiting for an eligible item */
+    unsigned        i_max_live;
+    unsigned        i_max_host;  /**< concurrent requests per server */
+    preparser_entry_t **pp_running; /**< requests being processed */
+
+    struct
+    {
+        mtime_t     i_start;
+        unsigned    i_done;
+        unsigned    i_stale;
+    } stats;
 };
 
 static void *Thread( void * );
 
+/* Returns the server of a network item, which limits its concurrency */
+static char *GetHost( input_item_t *p_item )
+{
+    char *psz_host = NULL;
+
+    vlc_mutex_lock( &p_item->lock );
+    if( p_item->i_type == ITEM_TYPE_NET && p_item->psz_uri != NULL )
+    {
+        vlc_url_t url;
+
+        vlc_UrlParse( &url, p_item->psz_uri, 0 );
+        if( url.psz_host != NULL && *url.psz_host )
+            psz_host = strdup( url.psz_host );
+        vlc_UrlClean( &url );
+    }
+    vlc_mutex_unlock( &p_item->lock );
+    return psz_host;
+}
+
+static void EntryDelete( preparser_entry_t *p_entry )
+{
+    vlc_gc_decref( p_entry->p_item );
+    free( p_entry->psz_host );
+    free( p_entry );
+}
+
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
@@ -65,6 +117,21 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t *parent )
     if( !p_preparser )
         return NULL;
 
+    p_preparser->i_max_live = var_InheritInteger( parent, "preparse-threads" );
+    if( p_preparser->i_max_live < 1 )
+        p_preparser->i_max_live = 1;
+    p_preparser->i_max_host = var_InheritInteger( parent,
+                                                  "preparse-host-threads" );
+    if( p_preparser->i_max_host < 1 )
+        p_preparser->i_max_host = 1;
+    p_preparser->pp_running = calloc( p_preparser->i_max_live,
+                                      sizeof(*p_preparser->pp_running) );
+    if( unlikely(p_preparser->pp_running == NULL) )
+    {
+        free( p_preparser );
+        return NULL;
+    }
+
     p_preparser->object = parent;
     p_preparser->p_fetcher = playlist_fetcher_New( parent );
     if( unlikely(p_preparser->p_fetcher == NULL) )
@@ -72,9 +139,16 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t *parent )
 
     vlc_mutex_init( &p_preparser->lock );
     vlc_cond_init( &p_preparser->wait );
-    p_preparser->b_live = false;
+    for( int i = 0; i < QUEUE_COUNT; i++ )
+    {
+        p_preparser->p_waiting_head[i] = NULL;
+        p_preparser->pp_waiting_tail[i] = &p_preparser->p_waiting_head[i];
+    }
     p_preparser->i_waiting = 0;
-    p_preparser->pp_waiting = NULL;
+    p_preparser->i_live = 0;
+    p_preparser->i_idle = 0;
+    p_preparser->stats.i_done = 0;
+    p_preparser->stats.i_stale = 0;
 
     return p_preparser;
 }
@@ -88,18 +162,32 @@ void playlist_preparser_Push( playlist_preparser_t *p_preparser, input_item_t *p
         return;
     p_entry->p_item = p_item;
     p_entry->i_options = i_options;
+    p_entry->psz_host = GetHost( p_item );
+    p_entry->p_next = NULL;
     vlc_gc_incref( p_entry->p_item );
 
+    const int i_queue = ( i_options & META_REQUEST_OPTION_PRIORITY )
+                      ? QUEUE_PRIORITY : QUEUE_NORMAL;
+
     vlc_mutex_lock( &p_preparser->lock );
-    INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
-                 p_preparser->i_waiting, p_entry );
-    if( !p_preparser->b_live )
+    *p_preparser->pp_waiting_tail[i_queue] = p_entry;
+    p_preparser->pp_waiting_tail[i_queue] = &p_entry->p_next;
+    if( p_preparser->i_waiting++ == 0 && p_preparser->i_live == 0 )
+    {
+        p_preparser->stats.i_start = mdate();
+        p_preparser->stats.i_done = 0;
+        p_preparser->stats.i_stale = 0;
+    }
+
+    if( p_preparser->i_idle > 0 )
+        vlc_cond_broadcast( &p_preparser->wait );
+    else if( p_preparser->i_live < p_preparser->i_max_live )
     {
         if( vlc_clone_detach( NULL, Thread, p_preparser,
                               VLC_THREAD_PRIORITY_LOW ) )
             msg_Warn( p_preparser->object, "cannot spawn pre-parser thread" );
         else
-            p_preparser->b_live = true;
+            p_preparser->i_live++;
     }
     vlc_mutex_unlock( &p_preparser->lock );
 }
@@ -115,15 +203,20 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 {
     vlc_mutex_lock( &p_preparser->lock );
     /* Remove pending item to speed up preparser thread exit */
-    while( p_preparser->i_waiting > 0 )
+    for( int i = 0; i < QUEUE_COUNT; i++ )
     {
-        preparser_entry_t *p_entry = p_preparser->pp_waiting[0];
-        vlc_gc_decref( p_entry->p_item );
-        free( p_entry );
-        REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
+        while( p_preparser->p_waiting_head[i] != NULL )
+        {
+            preparser_entry_t *p_entry = p_preparser->p_waiting_head[i];
+            p_preparser->p_waiting_head[i] = p_entry->p_next;
+            EntryDelete( p_entry );
+        }
+        p_preparser->pp_waiting_tail[i] = &p_preparser->p_waiting_head[i];
     }
+    p_preparser->i_waiting = 0;
 
-    while( p_preparser->b_live )
+    vlc_cond_broadcast( &p_preparser->wait );
+    while( p_preparser->i_live > 0 )
         vlc_cond_wait( &p_preparser->wait, &p_preparser->lock );
     vlc_mutex_unlock( &p_preparser->lock );
 
@@ -133,6 +226,7 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 
     if( p_preparser->p_fetcher != NULL )
         playlist_fetcher_Delete( p_preparser->p_fetcher );
+    free( p_preparser->pp_running );
     free( p_preparser );
 }
 
@@ -219,6 +313,67 @@ static void Art( playlist_preparser_t *p_preparser, input_item_t *p_item )
         playlist_fetcher_Push( p_fetcher, p_item, 0 );
 }
 
+/**
+ * Tells whether one more request may be sent to the given server
+ */
+static bool HostAvailable( playlist_preparser_t *p_preparser,
+                           const char *psz_host )
+{
+    unsigned i_busy = 0;
+
+    if( psz_host == NULL )
+        return true;
+    for( unsigned i = 0; i < p_preparser->i_max_live; i++ )
+    {
+        const preparser_entry_t *p_running = p_preparser->pp_running[i];
+
+        if( p_running != NULL && p_running->psz_host != NULL
+         && !strcasecmp( p_running->psz_host, psz_host ) )
+            i_busy++;
+    }
+    return i_busy < p_preparser->i_max_host;
+}
+
+/**
+ * Dequeues the first request, visible items first, whose server is not
+ * saturated. Returns NULL if there is none.
+ */
+static preparser_entry_t *Dequeue( playlist_preparser_t *p_preparser )
+{
+    for( int i = 0; i < QUEUE_COUNT; i++ )
+    {
+        preparser_entry_t **pp_entry = &p_preparser->p_waiting_head[i];
+
+        for( ; *pp_entry != NULL; pp_entry = &(*pp_entry)->p_next )
+        {
+            preparser_entry_t *p_entry = *pp_entry;
+
+            if( !HostAvailable( p_preparser, p_entry->psz_host ) )
+                continue;
+
+            *pp_entry = p_entry->p_next;
+            if( p_entry->p_next == NULL )
+                p_preparser->pp_waiting_tail[i] = pp_entry;
+            p_preparser->i_waiting--;
+            return p_entry;
+        }
+    }
+    return NULL;
+}
+
+static void Statistics( playlist_preparser_t *p_preparser, bool b_end )
+{
+    mtime_t i_elapsed = mdate() - p_preparser->stats.i_start;
+
+    msg_Dbg( p_preparser->object, "%s %u items (%u stale) in %.3f s, "
+             "%.1f items/s, %u waiting",
+             b_end ? "preparsed" : "preparsing",
+             p_preparser->stats.i_done, p_preparser->stats.i_stale,
+             i_elapsed / 1000000., i_elapsed > 0 ?
+             p_preparser->stats.i_done * 1000000. / i_elapsed : 0.,
+             p_preparser->i_waiting );
+}
+
 /**
  * This function does the preparsing and issues the art fetching requests
  */
@@ -227,37 +382,59 @@ static void *Thread( void *data )
     playlist_preparser_t *p_preparser = data;
     vlc_object_t *obj = p_preparser->object;
 
+    vlc_mutex_lock( &p_preparser->lock );
     for( ;; )
     {
-        input_item_t *p_current;
-        input_item_meta_request_option_t i_options;
+        preparser_entry_t *p_entry = Dequeue( p_preparser );
 
-        /* */
-        vlc_mutex_lock( &p_preparser->lock );
-        if( p_preparser->i_waiting > 0 )
+        if( p_entry == NULL )
         {
-            preparser_entry_t *p_entry = p_preparser->pp_waiting[0];
-            p_current = p_entry->p_item;
-            i_options = p_entry->i_options;
-            free( p_entry );
-            REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
+            /* Only the requests to saturated servers are left: wait for
+             * one of the running requests to finish */
+            if( p_preparser->i_waiting > 0 )
+            {
+                p_preparser->i_idle++;
+                vlc_cond_wait( &p_preparser->wait, &p_preparser->lock );
+                p_preparser->i_idle--;
+                continue;
+            }
+            break;
         }
-        else
+
+        /* Nobody else holds the item anymore (deleted from the playlist,
+         * released media...): the result would be lost */
+        if( atomic_load( &item_owner(p_entry->p_item)->refs ) == 1 )
         {
-            p_current = NULL;
-            p_preparser->b_live = false;
-            vlc_cond_signal( &p_preparser->wait );
+            p_preparser->stats.i_stale++;
+            EntryDelete( p_entry );
+            continue;
         }
-        vlc_mutex_unlock( &p_preparser->lock );
 
-        if( !p_current )
-            break;
+        unsigned i_slot = 0;
+        while( p_preparser->pp_running[i_slot] != NULL )
+            i_slot++;
+        assert( i_slot < p_preparser->i_max_live );
+        p_preparser->pp_running[i_slot] = p_entry;
+        vlc_mutex_unlock( &p_preparser->lock );
 
-        Preparse( obj, p_current, i_options );
+        Preparse( obj, p_entry->p_item, p_entry->i_options );
+        Art( p_preparser, p_entry->p_item );
 
-        Art( p_preparser, p_current );
-        vlc_gc_decref(p_current);
+        vlc_mutex_lock( &p_preparser->lock );
+        p_preparser->pp_running[i_slot] = NULL;
+        EntryDelete( p_entry );
+        if( ++p_preparser->stats.i_done % 1000 == 0 )
+            Statistics( p_preparser, false );
+        /* a server slot was freed */
+        if( p_preparser->i_idle > 0 )
+            vlc_cond_broadcast( &p_preparser->wait );
     }
+
+    /* report on bulk imports only */
+    if( --p_preparser->i_live == 0
+     && mdate() - p_preparser->stats.i_start > CLOCK_FREQ )
+        Statistics( p_preparser, true );
+    vlc_cond_broadcast( &p_preparser->wait );
+    vlc_mutex_unlock( &p_preparser->lock );
     return NULL;
 }
-
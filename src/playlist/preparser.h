@@ -36,7 +36,10 @@
 typedef struct playlist_preparser_t playlist_preparser_t;
 
 /**
- * This function creates the preparser object and thread.
+ * This function creates the preparser object.
+ *
+ * Items are preparsed by a pool of up to "preparse-threads" threads, with at
+ * most "preparse-host-threads" of them querying the same network server.
  */
 playlist_preparser_t *playlist_preparser_New( vlc_object_t * );
 
@@ -44,7 +47,9 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t * );
  * This function enqueues the provided item to be preparsed.
  *
  * The input item is retained until the preparsing is done or until the
- * preparser object is deleted.
+ * preparser object is deleted. Items pushed with META_REQUEST_OPTION_PRIORITY
+ * go before the others. The request is dropped if the preparser holds the
+ * last reference to the item when its turn comes.
  */
 void playlist_preparser_Push( playlist_preparser_t *, input_item_t *,
                               input_item_meta_request_option_t );
@@ -53,7 +58,7 @@ void playlist_preparser_fetcher_Push( playlist_preparser_t *, input_item_t *,
                                       input_item_meta_request_option_t );
 
 /**
- * This function destroys the preparser object and thread.
+ * This function destroys the preparser object and threads.
  *
  * All pending input items will be released.
  */
@@ -30,6 +30,111 @@
 #include <vlc_charset.h>
 #include "playlist_internal.h"
 
+/***************************************************************************
+ * Input item index
+ ***************************************************************************/
+
+/* Marks the slots of the removed items, so that the probes go on */
+static playlist_item_t removed_slot;
+#define REMOVED_SLOT (&removed_slot)
+
+static size_t InputIndexHash( const input_item_t *p_input, size_t i_size )
+{
+    uint64_t i_hash = (uintptr_t)p_input * UINT64_C(0x9E3779B97F4A7C15);
+    return (i_hash >> 32) & (i_size - 1);
+}
+
+static void InputIndexResize( playlist_private_t *p_sys, size_t i_size )
+{
+    playlist_item_t **pp_slots = calloc( i_size, sizeof( *pp_slots ) );
+    if( unlikely(pp_slots == NULL) )
+        return; /* keep probing the full table */
+
+    size_t i_used = 0;
+    for( size_t i = 0; i < p_sys->input_index.i_size; i++ )
+    {
+        playlist_item_t *p_item = p_sys->input_index.pp_slots[i];
+        if( p_item == NULL || p_item == REMOVED_SLOT )
+            continue;
+
+        size_t j = InputIndexHash( p_item->p_input, i_size );
+        while( pp_slots[j] != NULL )
+            j = (j + 1) & (i_size - 1);
+        pp_slots[j] = p_item;
+        i_used++;
+    }
+
+    free( p_sys->input_index.pp_slots );
+    p_sys->input_index.pp_slots = pp_slots;
+    p_sys->input_index.i_size = i_size;
+    p_sys->input_index.i_used = i_used;
+}
+
+/**
+ * Index an item of the all_items array by its input item
+ * The playlist have to be locked
+ */
+void playlist_InputIndexAdd( playlist_t *p_playlist, playlist_item_t *p_item )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+    PL_ASSERT_LOCKED;
+
+    /* Keep at least a quarter of the slots empty, for short probes */
+    if( (p_sys->input_index.i_used + 1) * 4 > p_sys->input_index.i_size * 3 )
+    {
+        size_t i_size = 64;
+        while( (size_t)p_playlist->all_items.i_size * 2 > i_size )
+            i_size *= 2;
+        InputIndexResize( p_sys, i_size );
+    }
+
+    if( unlikely(p_sys->input_index.i_used + 1 >= p_sys->input_index.i_size) )
+        return; /* out of memory */
+
+    size_t i_mask = p_sys->input_index.i_size - 1;
+    size_t i = InputIndexHash( p_item->p_input, p_sys->input_index.i_size );
+    while( p_sys->input_index.pp_slots[i] != NULL &&
+           p_sys->input_index.pp_slots[i] != REMOVED_SLOT )
+        i = (i + 1) & i_mask;
+    if( p_sys->input_index.pp_slots[i] == NULL )
+        p_sys->input_index.i_used++;
+    p_sys->input_index.pp_slots[i] = p_item;
+}
+
+/**
+ * Remove an item from the input item index
+ * The playlist have to be locked
+ */
+void playlist_InputIndexRemove( playlist_t *p_playlist, playlist_item_t *p_item )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+    PL_ASSERT_LOCKED;
+
+    if( p_sys->input_index.i_size == 0 )
+        return;
+
+    size_t i_mask = p_sys->input_index.i_size - 1;
+    for( size_t i = InputIndexHash( p_item->p_input, p_sys->input_index.i_size );
+         p_sys->input_index.pp_slots[i] != NULL; i = (i + 1) & i_mask )
+    {
+        if( p_sys->input_index.pp_slots[i] == p_item )
+        {
+            p_sys->input_index.pp_slots[i] = REMOVED_SLOT;
+            return;
+        }
+    }
+}
+
+void playlist_InputIndexClean( playlist_t *p_playlist )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    free( p_sys->input_index.pp_slots );
+    p_sys->input_index.pp_slots = NULL;
+    p_sys->input_index.i_size = 0;
+    p_sys->input_index.i_used = 0;
+}
+
 /***************************************************************************
  * Item search functions
  ***************************************************************************/
@@ -62,22 +167,29 @@ playlist_item_t* playlist_ItemGetById( playlist_t * p_playlist , int i_id )
 playlist_item_t* playlist_ItemGetByInput( playlist_t * p_playlist,
                                           input_item_t *p_item )
 {
-    int i;
+    playlist_private_t *p_sys = pl_priv(p_playlist);
     PL_ASSERT_LOCKED;
     if( get_current_status_item( p_playlist ) &&
         get_current_status_item( p_playlist )->p_input == p_item )
     {
         return get_current_status_item( p_playlist );
     }
-    /** \todo Check if this is always incremental and whether we can bsearch */
-    for( i =  0 ; i < p_playlist->all_items.i_size; i++ )
+    if( p_sys->input_index.i_size == 0 )
+        return NULL;
+
+    /* The oldest item wins when an input item is shared */
+    playlist_item_t *p_found = NULL;
+    size_t i_mask = p_sys->input_index.i_size - 1;
+    for( size_t i = InputIndexHash( p_item, p_sys->input_index.i_size );
+         p_sys->input_index.pp_slots[i] != NULL; i = (i + 1) & i_mask )
     {
-        if( ARRAY_VAL(p_playlist->all_items, i)->p_input == p_item )
-        {
-            return ARRAY_VAL(p_playlist->all_items, i);
-        }
+        playlist_item_t *p_slot = p_sys->input_index.pp_slots[i];
+
+        if( p_slot != REMOVED_SLOT && p_slot->p_input == p_item &&
+            ( p_found == NULL || p_slot->i_id < p_found->i_id ) )
+            p_found = p_slot;
     }
-    return NULL;
+    return p_found;
 }
 
 
@@ -108,7 +220,8 @@ static void playlist_LiveSearchClean( playlist_item_t *p_root )
  * @return true if an item match
  */
 static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
-                                               const char *psz_string, bool b_recursive )
+                                               const char *psz_string, bool b_recursive,
+                                               bool b_refine )
 {
     int i;
     bool b_match = false;
@@ -116,9 +229,15 @@ static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
     {
         bool b_enable = false;
         playlist_item_t *p_item = p_root->pp_children[i];
+
+        /* What did not match the previous search cannot match a longer one */
+        if( b_refine && ( p_item->i_flags & PLAYLIST_DBL_FLAG ) )
+            continue;
+
         // Go recurssively if their is some children
         if( b_recursive && p_item->i_children >= 0 &&
-            playlist_LiveSearchUpdateInternal( p_item, psz_string, true ) )
+            playlist_LiveSearchUpdateInternal( p_item, psz_string, true,
+                                               b_refine ) )
         {
             b_enable = true;
         }
@@ -158,6 +277,9 @@ static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
 
 /**
  * Launch the recursive search in the playlist
+ *
+ * When the string extends the previous one (as the user types), only the
+ * items which matched the previous search are searched again.
  * @param p_playlist: the playlist
  * @param p_root: the current root item
  * @param psz_string: the string to find
@@ -166,12 +288,30 @@ static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
 int playlist_LiveSearchUpdate( playlist_t *p_playlist, playlist_item_t *p_root,
                                const char *psz_string, bool b_recursive )
 {
+    playlist_private_t *p_sys = pl_priv(p_playlist);
     PL_ASSERT_LOCKED;
-    pl_priv(p_playlist)->b_reset_currently_playing = true;
+    p_sys->b_reset_currently_playing = true;
     if( *psz_string )
-        playlist_LiveSearchUpdateInternal( p_root, psz_string, b_recursive );
+    {
+        bool b_refine = p_sys->search.psz_string != NULL &&
+                        p_sys->search.i_root_id == p_root->i_id &&
+                        p_sys->search.b_recursive == b_recursive &&
+                        vlc_strcasestr( psz_string, p_sys->search.psz_string );
+
+        playlist_LiveSearchUpdateInternal( p_root, psz_string, b_recursive,
+                                           b_refine );
+
+        free( p_sys->search.psz_string );
+        p_sys->search.psz_string = strdup( psz_string );
+        p_sys->search.i_root_id = p_root->i_id;
+        p_sys->search.b_recursive = b_recursive;
+    }
     else
+    {
         playlist_LiveSearchClean( p_root );
+        free( p_sys->search.psz_string );
+        p_sys->search.psz_string = NULL;
+    }
     vlc_cond_signal( &pl_priv(p_playlist)->signal );
     return VLC_SUCCESS;
 }
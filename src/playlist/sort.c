@@ -193,13 +193,67 @@ static int recursiveNodeSort( playlist_t *p_playlist, playlist_item_t *p_node,
 int playlist_RecursiveNodeSort( playlist_t *p_playlist, playlist_item_t *p_node,
                                 int i_mode, int i_type )
 {
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
     /* Ask the playlist to reset as we are changing the order */
-    pl_priv(p_playlist)->b_reset_currently_playing = true;
+    p_sys->b_reset_currently_playing = true;
+
+    /* Remember the order, for the items appended later */
+    p_sys->sort.i_node_id = -1;
+    if( find_sorting_fn( i_mode, i_type ) != NULL )
+    {
+        p_sys->sort.i_node_id = p_node->i_id;
+        p_sys->sort.i_mode = i_mode;
+        p_sys->sort.i_type = i_type;
+    }
 
     /* Do the real job recursively */
     return recursiveNodeSort(p_playlist,p_node,find_sorting_fn(i_mode,i_type));
 }
 
+/**
+ * Find where to append an item to a node, to keep the order of the last
+ * sorted node, and of the nodes below it.
+ *
+ * This function must be entered with the playlist lock !
+ *
+ * \param p_playlist the playlist
+ * \param p_node the node to append to
+ * \param p_item the item to append
+ * \return the position, or -1 to append at the end
+ */
+int playlist_NodeSortedPosition( playlist_t *p_playlist, playlist_item_t *p_node,
+                                 playlist_item_t *p_item )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    PL_ASSERT_LOCKED;
+    if( p_sys->sort.i_node_id == -1 )
+        return -1;
+
+    playlist_item_t *p_up = p_node;
+    while( p_up != NULL && p_up->i_id != p_sys->sort.i_node_id )
+        p_up = p_up->p_parent;
+    if( p_up == NULL )
+        return -1;
+
+    /* After the equal items, as they were before */
+    sortfn_t p_sortfn = find_sorting_fn( p_sys->sort.i_mode,
+                                         p_sys->sort.i_type );
+    int i_low = 0;
+    int i_high = p_node->i_children;
+
+    while( i_low < i_high )
+    {
+        int i_mid = ( i_low + i_high ) / 2;
+
+        if( p_sortfn( &p_node->pp_children[i_mid], &p_item ) <= 0 )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
 
 /* This is the stuff the sorting functions are made of. The proto_##
  * functions are wrapped in cmp_a_## and cmp_d_## functions that do
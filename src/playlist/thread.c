@@ -89,12 +89,34 @@ void playlist_Deactivate( playlist_t *p_playlist )
 
 /* */
 
+/* The next input is pre-opened when the current one has less left to play */
+#define STANDBY_WINDOW (INT64_C(5)*CLOCK_FREQ)
+
 /* Input Callback */
 static int InputEvent( vlc_object_t *p_this, char const *psz_cmd,
                        vlc_value_t oldval, vlc_value_t newval, void *p_data )
 {
-    VLC_UNUSED(p_this); VLC_UNUSED(psz_cmd); VLC_UNUSED(oldval);
+    VLC_UNUSED(psz_cmd); VLC_UNUSED(oldval);
     playlist_t *p_playlist = p_data;
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    if( newval.i_int == INPUT_EVENT_POSITION )
+    {
+        mtime_t i_length = var_GetTime( p_this, "length" );
+        mtime_t i_time = var_GetTime( p_this, "time" );
+
+        if( i_length <= 0 || i_length - i_time > STANDBY_WINDOW )
+            return VLC_SUCCESS;
+
+        PL_LOCK;
+        if( !p_sys->standby.b_wanted && !p_sys->standby.b_done )
+        {
+            p_sys->standby.b_wanted = true;
+            vlc_cond_signal( &p_sys->signal );
+        }
+        PL_UNLOCK;
+        return VLC_SUCCESS;
+    }
 
     if( newval.i_int != INPUT_EVENT_STATE &&
         newval.i_int != INPUT_EVENT_DEAD )
@@ -185,6 +207,35 @@ void ResetCurrentlyPlaying( playlist_t *p_playlist,
 }
 
 
+/**
+ * Take the input pre-opened in standby, if any
+ *
+ * \param p_playlist the playlist object
+ * \return the input, or NULL
+ */
+static input_thread_t *TakeStandby( playlist_t *p_playlist )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+    input_thread_t *p_input = p_sys->standby.p_input;
+
+    PL_ASSERT_LOCKED;
+
+    p_sys->standby.p_input = NULL;
+    p_sys->standby.b_wanted = false;
+    p_sys->standby.b_done = false;
+    return p_input;
+}
+
+/**
+ * Stop and destroy an input pre-opened in standby
+ * (without the playlist lock)
+ */
+static void CloseStandby( input_thread_t *p_input )
+{
+    input_Stop( p_input, true );
+    input_Close( p_input );
+}
+
 /**
  * Start the input for an item
  *
@@ -198,26 +249,48 @@ static bool PlayItem( playlist_t *p_playlist, playlist_item_t *p_item )
 
     PL_ASSERT_LOCKED;
 
-    msg_Dbg( p_playlist, "creating new input thread" );
-
     p_item->i_nb_played++;
     set_current_status_item( p_playlist, p_item );
     assert( p_sys->p_input == NULL );
+    input_thread_t *p_standby = TakeStandby( p_playlist );
     PL_UNLOCK;
 
-    input_thread_t *p_input_thread = input_Create( p_playlist, p_input, NULL,
-                                                   p_sys->p_input_resource );
-    if( likely(p_input_thread != NULL) )
+    input_thread_t *p_input_thread = NULL;
+
+    /* Play the pre-opened input, if it is the one of the item */
+    if( p_standby != NULL && input_GetItem( p_standby ) == p_input )
+    {
+        var_AddCallback( p_standby, "intf-event", InputEvent, p_playlist );
+        if( input_Control( p_standby, INPUT_LEAVE_STANDBY ) == VLC_SUCCESS )
+        {
+            msg_Dbg( p_playlist, "using pre-opened input thread" );
+            p_input_thread = p_standby;
+            p_standby = NULL;
+        }
+        else
+            var_DelCallback( p_standby, "intf-event", InputEvent, p_playlist );
+    }
+    if( p_standby != NULL )
+        CloseStandby( p_standby );
+
+    if( p_input_thread == NULL )
     {
-        var_AddCallback( p_input_thread, "intf-event",
-                         InputEvent, p_playlist );
+        msg_Dbg( p_playlist, "creating new input thread" );
 
-        if( input_Start( p_input_thread ) )
+        p_input_thread = input_Create( p_playlist, p_input, NULL,
+                                       p_sys->p_input_resource );
+        if( likely(p_input_thread != NULL) )
         {
-            var_DelCallback( p_input_thread, "intf-event",
+            var_AddCallback( p_input_thread, "intf-event",
                              InputEvent, p_playlist );
-            vlc_object_release( p_input_thread );
-            p_input_thread = NULL;
+
+            if( input_Start( p_input_thread ) )
+            {
+                var_DelCallback( p_input_thread, "intf-event",
+                                 InputEvent, p_playlist );
+                vlc_object_release( p_input_thread );
+                p_input_thread = NULL;
+            }
         }
     }
 
@@ -428,6 +501,89 @@ static playlist_item_t *NextItem( playlist_t *p_playlist )
     return p_new;
 }
 
+/**
+ * Compute the item that NextItem() will return at the end of the current
+ * one, if it is predictable
+ *
+ * \param p_playlist the playlist object
+ * \return the item, or NULL
+ */
+static playlist_item_t *PeekNextItem( playlist_t *p_playlist )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+    playlist_item_t *p_cur = get_current_status_item( p_playlist );
+
+    PL_ASSERT_LOCKED;
+
+    if( p_cur == NULL || p_sys->request.b_request ||
+        p_sys->b_reset_currently_playing ||
+        var_GetBool( p_playlist, "repeat" ) ||
+        var_InheritBool( p_playlist, "play-and-stop" ) )
+        return NULL;
+
+    for( playlist_item_t *p_parent = p_cur; p_parent; p_parent = p_parent->p_parent )
+        if( p_parent->i_flags & PLAYLIST_SKIP_FLAG )
+            return NULL;
+
+    int i_next = p_playlist->i_current_index + 1;
+    if( i_next >= p_playlist->current.i_size )
+    {
+        /* The playlist is reshuffled when looping in random mode */
+        if( !var_GetBool( p_playlist, "loop" ) ||
+            var_GetBool( p_playlist, "random" ) )
+            return NULL;
+        i_next = 0;
+    }
+    if( i_next >= p_playlist->current.i_size )
+        return NULL;
+
+    playlist_item_t *p_next = ARRAY_VAL( p_playlist->current, i_next );
+    if( p_next->i_flags & PLAYLIST_SKIP_FLAG )
+        return NULL;
+    return p_next;
+}
+
+/**
+ * Pre-open the input of the next item in standby, so that it can continue
+ * the current one without gap
+ *
+ * \param p_playlist the playlist object
+ */
+static void OpenStandby( playlist_t *p_playlist )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    PL_ASSERT_LOCKED;
+    assert( p_sys->standby.p_input == NULL );
+
+    p_sys->standby.b_wanted = false;
+    p_sys->standby.b_done = true;
+
+    if( !var_InheritBool( p_playlist, "gapless" ) )
+        return;
+
+    playlist_item_t *p_next = PeekNextItem( p_playlist );
+    if( p_next == NULL )
+        return;
+
+    input_item_t *p_item = p_next->p_input;
+    vlc_gc_incref( p_item );
+    PL_UNLOCK;
+
+    msg_Dbg( p_playlist, "pre-opening the next item" );
+    input_thread_t *p_input = input_CreateStandby( p_playlist, p_item, NULL,
+                                                   p_sys->p_input_resource );
+    if( p_input != NULL && input_Start( p_input ) )
+    {
+        vlc_object_release( p_input );
+        p_input = NULL;
+    }
+    vlc_gc_decref( p_item );
+
+    PL_LOCK;
+    p_sys->standby.p_input = p_input;
+}
+
 static void LoopInput( playlist_t *p_playlist )
 {
     playlist_private_t *p_sys = pl_priv(p_playlist);
@@ -468,6 +624,11 @@ static void LoopInput( playlist_t *p_playlist )
         PL_DEBUG( "finished input" );
         input_Stop( p_input, false );
     }
+    else if( p_sys->standby.b_wanted && !p_sys->killed )
+    {
+        OpenStandby( p_playlist );
+        return;
+    }
 
     vlc_cond_wait( &p_sys->signal, &p_sys->lock );
 }
@@ -526,6 +687,15 @@ static void *Thread ( void *data )
             input_resource_TerminateVout( p_sys->p_input_resource );
             PL_LOCK;
         }
+        /* The input, the decoders and the audio output kept for a next item
+         * are useless now */
+        input_thread_t *p_standby = TakeStandby( p_playlist );
+        PL_UNLOCK;
+        if( p_standby != NULL )
+            CloseStandby( p_standby );
+        input_resource_TerminateDecoders( p_sys->p_input_resource );
+        input_resource_StopAout( p_sys->p_input_resource );
+        PL_LOCK;
     }
     PL_UNLOCK;
 
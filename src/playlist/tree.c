@@ -78,10 +78,14 @@ playlist_item_t * playlist_NodeCreate( playlist_t *p_playlist,
     p_item->i_children = 0;
 
     ARRAY_APPEND(p_playlist->all_items, p_item);
+    playlist_InputIndexAdd( p_playlist, p_item );
 
     if( p_parent != NULL )
-        playlist_NodeInsert( p_playlist, p_item, p_parent,
-                             i_pos == PLAYLIST_END ? -1 : i_pos );
+    {
+        if( i_pos == PLAYLIST_END )
+            i_pos = playlist_NodeSortedPosition( p_playlist, p_parent, p_item );
+        playlist_NodeInsert( p_playlist, p_item, p_parent, i_pos );
+    }
     playlist_SendAddNotify( p_playlist, p_item->i_id,
                             p_parent ? p_parent->i_id : -1,
                             !( i_flags & PLAYLIST_NO_REBUILD ));
@@ -159,6 +163,7 @@ int playlist_NodeDelete( playlist_t *p_playlist, playlist_item_t *p_root,
     ARRAY_BSEARCH( p_playlist->all_items, ->i_id, int, p_root->i_id, i );
     if( i != -1 )
         ARRAY_REMOVE( p_playlist->all_items, i );
+    playlist_InputIndexRemove( p_playlist, p_root );
 
     if( p_root->i_children == -1 ) {
         ARRAY_BSEARCH( p_playlist->items,->i_id, int, p_root->i_id, i );
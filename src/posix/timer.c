@@ -1,5 +1,5 @@
 /*****************************************************************************
- * timer.c: simple threaded timer
+ * timer.c: threaded timer wheel
  *****************************************************************************
  * Copyright (C) 2009-2012 Rémi Denis-Courmont
  *
@@ -23,6 +23,7 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <assert.h>
 
@@ -35,54 +36,227 @@
  * they typically require one thread per timer plus one thread per iteration,
  * which is inefficient and overkill (unless you need multiple iteration
  * of the same timer concurrently).
- * Thus, this is a generic manual implementation of timers using a thread.
+ * Thus, this is a generic manual implementation of timers, shared by all the
+ * timers of the process: a hierarchical timer wheel serviced by a few
+ * threads. Arming and disarming are constant time, and the timers expiring
+ * within the same tick are fired by the same wake-up.
  */
 
+#define VLC_TIMER_TICK        (CLOCK_FREQ / 1000)
+#define VLC_TIMER_WHEEL_BITS  5
+#define VLC_TIMER_WHEEL_SIZE  (1 << VLC_TIMER_WHEEL_BITS)
+#define VLC_TIMER_WHEEL_MASK  (VLC_TIMER_WHEEL_SIZE - 1)
+#define VLC_TIMER_LEVELS      6 /* 2^30 ticks, about 12 days */
+/* A thread is added when all others are busy running callbacks */
+#define VLC_TIMER_THREADS_MAX 4
+
 struct vlc_timer
 {
-    vlc_thread_t thread;
-    vlc_cond_t   reschedule;
-    vlc_mutex_t  lock;
-    void       (*func) (void *);
-    void        *data;
-    mtime_t      value, interval;
-    atomic_uint  overruns;
+    struct vlc_timer  *next, **pprev; /* in a wheel slot or the due list */
+    unsigned char      level, slot;
+    bool               running, rescheduled;
+    void             (*func) (void *);
+    void              *data;
+    mtime_t            value, interval;
+    uint64_t           tick;
+    atomic_uint        overruns;
 };
 
-VLC_NORETURN
-static void *vlc_timer_thread (void *data)
+static struct
 {
-    struct vlc_timer *timer = data;
+    vlc_mutex_t       lock;
+    vlc_cond_t        wait; /* wheel changed */
+    vlc_cond_t        done; /* a callback returned */
+    struct vlc_timer *slots[VLC_TIMER_LEVELS][VLC_TIMER_WHEEL_SIZE];
+    uint32_t          occupied[VLC_TIMER_LEVELS];
+    struct vlc_timer *due;
+    uint64_t          tick; /* next tick to process */
+    bool              exiting;
+    unsigned          idle;
+    unsigned          threads;
+    vlc_thread_t      thread[VLC_TIMER_THREADS_MAX];
+} wheel;
 
-    vlc_mutex_lock (&timer->lock);
-    mutex_cleanup_push (&timer->lock);
+/* Protects the creation and destruction of the wheel */
+static vlc_mutex_t wheel_lock = VLC_STATIC_MUTEX;
+static unsigned wheel_refs = 0;
 
-    for (;;)
-    {
-        while (timer->value == 0)
-            vlc_cond_wait (&timer->reschedule, &timer->lock);
+static void vlc_timer_link (struct vlc_timer **head, struct vlc_timer *timer)
+{
+    timer->next = *head;
+    if (timer->next != NULL)
+        timer->next->pprev = &timer->next;
+    timer->pprev = head;
+    *head = timer;
+}
+
+static void vlc_timer_unlink (struct vlc_timer *timer)
+{
+    if (timer->pprev == NULL)
+        return;
+
+    *timer->pprev = timer->next;
+    if (timer->next != NULL)
+        timer->next->pprev = timer->pprev;
+    else if (timer->level < VLC_TIMER_LEVELS
+          && timer->pprev == &wheel.slots[timer->level][timer->slot])
+        wheel.occupied[timer->level] &= ~(1u << timer->slot);
+    timer->pprev = NULL;
+}
+
+static void vlc_timer_insert (struct vlc_timer *timer)
+{
+    uint64_t tick = timer->tick;
+
+    if (tick < wheel.tick)
+    {   /* Already due */
+        timer->level = VLC_TIMER_LEVELS;
+        vlc_timer_link (&wheel.due, timer);
+        return;
+    }
+
+    uint64_t delta = tick - wheel.tick;
+    unsigned level = 0;
+
+    while (level < VLC_TIMER_LEVELS - 1
+        && delta >= (UINT64_C(1) << ((level + 1) * VLC_TIMER_WHEEL_BITS)))
+        level++;
+    if (delta >= (UINT64_C(1) << (VLC_TIMER_LEVELS * VLC_TIMER_WHEEL_BITS)))
+        /* Too far: park in the last slot, it will be cascaded again */
+        tick = wheel.tick
+             + (UINT64_C(1) << (VLC_TIMER_LEVELS * VLC_TIMER_WHEEL_BITS)) - 1;
+
+    unsigned slot = (tick >> (level * VLC_TIMER_WHEEL_BITS))
+                  & VLC_TIMER_WHEEL_MASK;
+
+    timer->level = level;
+    timer->slot = slot;
+    vlc_timer_link (&wheel.slots[level][slot], timer);
+    wheel.occupied[level] |= 1u << slot;
+}
+
+static void vlc_timer_arm (struct vlc_timer *timer)
+{
+    timer->tick = (timer->value + VLC_TIMER_TICK - 1) / VLC_TIMER_TICK;
+    vlc_timer_insert (timer);
+}
+
+/**
+ * Finds the next tick at which timers expire, or must be cascaded to a lower
+ * level of the wheel.
+ */
+static uint64_t vlc_timer_wheel_next (void)
+{
+    uint64_t next = UINT64_MAX;
 
-        if (vlc_cond_timedwait (&timer->reschedule, &timer->lock,
-                                timer->value) == 0)
+    for (unsigned level = 0; level < VLC_TIMER_LEVELS; level++)
+    {
+        uint32_t bits = wheel.occupied[level];
+        if (bits == 0)
             continue;
-        if (timer->interval == 0)
-            timer->value = 0; /* disarm */
-        vlc_mutex_unlock (&timer->lock);
 
-        int canc = vlc_savecancel ();
-        timer->func (timer->data);
-        vlc_restorecancel (canc);
+        unsigned shift = level * VLC_TIMER_WHEEL_BITS;
+        uint64_t base = wheel.tick >> shift;
+        unsigned cur = base & VLC_TIMER_WHEEL_MASK;
+        unsigned dist;
+
+        /* Rotate so that the current slot is the lowest bit */
+        if (cur != 0)
+            bits = (bits >> cur) | (bits << (VLC_TIMER_WHEEL_SIZE - cur));
+        if (level > 0 && (wheel.tick & ((UINT64_C(1) << shift) - 1)))
+            /* The current slot was cascaded already, it is for next turn */
+            dist = (bits & ~1u) ? ctz (bits & ~1u) : VLC_TIMER_WHEEL_SIZE;
+        else
+            dist = ctz (bits);
+
+        uint64_t tick = (base + dist) << shift;
+        if (tick < next)
+            next = tick;
+    }
+    return next;
+}
+
+/**
+ * Processes one tick: cascades the higher levels slots starting at it, and
+ * moves the timers expiring at it to the due list.
+ */
+static void vlc_timer_wheel_process (uint64_t tick)
+{
+    wheel.tick = tick;
 
-        mtime_t now = mdate ();
-        unsigned misses;
+    for (unsigned level = VLC_TIMER_LEVELS - 1; level > 0; level--)
+    {
+        unsigned shift = level * VLC_TIMER_WHEEL_BITS;
 
-        vlc_mutex_lock (&timer->lock);
-        if (timer->interval == 0)
+        if (tick & ((UINT64_C(1) << shift) - 1))
             continue;
 
-        misses = (now - timer->value) / timer->interval;
+        unsigned slot = (tick >> shift) & VLC_TIMER_WHEEL_MASK;
+        struct vlc_timer *timer = wheel.slots[level][slot];
+
+        wheel.slots[level][slot] = NULL;
+        wheel.occupied[level] &= ~(1u << slot);
+        while (timer != NULL)
+        {
+            struct vlc_timer *next = timer->next;
+
+            vlc_timer_insert (timer);
+            timer = next;
+        }
+    }
+
+    unsigned slot = tick & VLC_TIMER_WHEEL_MASK;
+    struct vlc_timer *timer = wheel.slots[0][slot];
+
+    wheel.slots[0][slot] = NULL;
+    wheel.occupied[0] &= ~(1u << slot);
+    while (timer != NULL)
+    {
+        struct vlc_timer *next = timer->next;
+
+        assert (timer->tick == tick);
+        timer->level = VLC_TIMER_LEVELS;
+        vlc_timer_link (&wheel.due, timer);
+        timer = next;
+    }
+
+    wheel.tick = tick + 1;
+}
+
+static void *vlc_timer_thread (void *data);
+
+/**
+ * Runs the callback of a due timer, then re-arms it if it is periodic.
+ * The wheel lock is released in the mean time.
+ */
+static void vlc_timer_run (struct vlc_timer *timer)
+{
+    vlc_timer_unlink (timer);
+    if (timer->interval == 0)
+        timer->value = 0; /* disarm */
+    timer->running = true;
+    timer->rescheduled = false;
+
+    /* Keep a thread waiting for the wheel while the callback runs */
+    if (wheel.idle == 0 && wheel.threads < VLC_TIMER_THREADS_MAX
+     && vlc_clone (&wheel.thread[wheel.threads], vlc_timer_thread, NULL,
+                   VLC_THREAD_PRIORITY_INPUT) == 0)
+        wheel.threads++;
+    vlc_mutex_unlock (&wheel.lock);
+
+    timer->func (timer->data);
+
+    mtime_t now = mdate ();
+
+    vlc_mutex_lock (&wheel.lock);
+    timer->running = false;
+
+    if (!timer->rescheduled && timer->interval != 0)
+    {
+        unsigned misses = (now - timer->value) / timer->interval;
+
         timer->value += timer->interval;
-        /* Try to compensate for one miss (mwait() will return immediately)
+        /* Try to compensate for one miss (the timer will fire immediately)
          * but no more. Otherwise, we might busy loop, after extended periods
          * without scheduling (suspend, SIGSTOP, RT preemption, ...). */
         if (misses > 1)
@@ -93,9 +267,101 @@ static void *vlc_timer_thread (void *data)
                                        memory_order_relaxed);
         }
     }
+    if (timer->value != 0)
+        vlc_timer_arm (timer);
+    vlc_cond_broadcast (&wheel.done);
+}
+
+static void *vlc_timer_thread (void *data)
+{
+    vlc_mutex_lock (&wheel.lock);
+    while (!wheel.exiting)
+    {
+        if (wheel.due != NULL)
+        {
+            vlc_timer_run (wheel.due);
+            continue;
+        }
+
+        uint64_t now = mdate () / VLC_TIMER_TICK;
+        uint64_t next = vlc_timer_wheel_next ();
 
-    vlc_cleanup_pop ();
-    assert (0);
+        if (next <= now)
+        {
+            vlc_timer_wheel_process (next);
+            continue;
+        }
+
+        wheel.idle++;
+        if (next == UINT64_MAX)
+        {   /* Empty wheel: the past ticks need no processing */
+            if (wheel.tick <= now)
+                wheel.tick = now + 1;
+            vlc_cond_wait (&wheel.wait, &wheel.lock);
+        }
+        else
+            vlc_cond_timedwait (&wheel.wait, &wheel.lock,
+                                next * VLC_TIMER_TICK);
+        wheel.idle--;
+    }
+    vlc_mutex_unlock (&wheel.lock);
+    (void) data;
+    return NULL;
+}
+
+static int vlc_timer_wheel_hold (void)
+{
+    int ret = 0;
+
+    vlc_mutex_lock (&wheel_lock);
+    if (wheel_refs == 0)
+    {
+        vlc_mutex_init (&wheel.lock);
+        vlc_cond_init (&wheel.wait);
+        vlc_cond_init (&wheel.done);
+        memset (wheel.slots, 0, sizeof (wheel.slots));
+        memset (wheel.occupied, 0, sizeof (wheel.occupied));
+        wheel.due = NULL;
+        wheel.tick = mdate () / VLC_TIMER_TICK;
+        wheel.exiting = false;
+        wheel.idle = 0;
+        wheel.threads = 1;
+
+        if (vlc_clone (&wheel.thread[0], vlc_timer_thread, NULL,
+                       VLC_THREAD_PRIORITY_INPUT))
+        {
+            vlc_cond_destroy (&wheel.done);
+            vlc_cond_destroy (&wheel.wait);
+            vlc_mutex_destroy (&wheel.lock);
+            ret = ENOMEM;
+        }
+    }
+    if (ret == 0)
+        wheel_refs++;
+    vlc_mutex_unlock (&wheel_lock);
+    return ret;
+}
+
+static void vlc_timer_wheel_release (void)
+{
+    vlc_mutex_lock (&wheel_lock);
+    assert (wheel_refs > 0);
+    if (--wheel_refs == 0)
+    {
+        /* No timers are left, so no callbacks run and no threads start */
+        vlc_mutex_lock (&wheel.lock);
+        wheel.exiting = true;
+        vlc_cond_broadcast (&wheel.wait);
+        vlc_mutex_unlock (&wheel.lock);
+
+        for (unsigned i = 0; i < wheel.threads; i++)
+            vlc_join (wheel.thread[i], NULL);
+
+        vlc_cond_destroy (&wheel.done);
+        vlc_cond_destroy (&wheel.wait);
+        vlc_mutex_destroy (&wheel.lock);
+    }
+    vlc_mutex_unlock (&wheel_lock);
 }
 
 /**
@@ -115,20 +381,18 @@ int vlc_timer_create (vlc_timer_t *id, void (*func) (void *), void *data)
 
     if (unlikely(timer == NULL))
         return ENOMEM;
-    vlc_mutex_init (&timer->lock);
-    vlc_cond_init (&timer->reschedule);
     assert (func);
+    timer->pprev = NULL;
+    timer->running = false;
+    timer->rescheduled = false;
     timer->func = func;
     timer->data = data;
     timer->value = 0;
     timer->interval = 0;
     atomic_init(&timer->overruns, 0);
 
-    if (vlc_clone (&timer->thread, vlc_timer_thread, timer,
-                   VLC_THREAD_PRIORITY_INPUT))
+    if (vlc_timer_wheel_hold ())
     {
-        vlc_cond_destroy (&timer->reschedule);
-        vlc_mutex_destroy (&timer->lock);
         free (timer);
         return ENOMEM;
     }
@@ -148,10 +412,21 @@ int vlc_timer_create (vlc_timer_t *id, void (*func) (void *), void *data)
  */
 void vlc_timer_destroy (vlc_timer_t timer)
 {
-    vlc_cancel (timer->thread);
-    vlc_join (timer->thread, NULL);
-    vlc_cond_destroy (&timer->reschedule);
-    vlc_mutex_destroy (&timer->lock);
+    vlc_mutex_lock (&wheel.lock);
+    for (;;)
+    {
+        /* The callback may re-arm the timer until it returns */
+        vlc_timer_unlink (timer);
+        timer->value = 0;
+        timer->interval = 0;
+        timer->rescheduled = true;
+        if (!timer->running)
+            break;
+        vlc_cond_wait (&wheel.done, &wheel.lock);
+    }
+    vlc_mutex_unlock (&wheel.lock);
+
+    vlc_timer_wheel_release ();
     free (timer);
 }
 
@@ -178,11 +453,16 @@ void vlc_timer_schedule (vlc_timer_t timer, bool absolute,
     if (!absolute && value != 0)
         value += mdate();
 
-    vlc_mutex_lock (&timer->lock);
+    vlc_mutex_lock (&wheel.lock);
+    vlc_timer_unlink (timer);
     timer->value = value;
     timer->interval = interval;
-    vlc_cond_signal (&timer->reschedule);
-    vlc_mutex_unlock (&timer->lock);
+    if (timer->running)
+        timer->rescheduled = true; /* re-armed once the callback returns */
+    else if (value != 0)
+        vlc_timer_arm (timer);
+    vlc_cond_signal (&wheel.wait);
+    vlc_mutex_unlock (&wheel.lock);
 }
 
 /**
@@ -84,10 +84,139 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void *test_arena_thread (void *data)
+{
+    block_t **blocks = data;
+
+    /* Allocated here, released from the main thread after exit */
+    for (unsigned i = 0; i < 16; i++)
+    {
+        blocks[i] = block_Alloc (i * 1000);
+        assert (blocks[i] != NULL);
+        memset (blocks[i]->p_buffer, i, blocks[i]->i_buffer);
+    }
+    return NULL;
+}
+
+static void test_block_arena (void)
+{
+    block_alloc_stats_t before, after;
+    block_t *blocks[16];
+    vlc_thread_t th;
+
+    block_GetAllocStats (&before);
+
+    /* A released block is recycled by the next allocation of its class */
+    block_t *block = block_Alloc (1000);
+    assert (block != NULL);
+    uint8_t *start = block->p_start;
+    block_Release (block);
+    block = block_Alloc (900);
+    assert (block != NULL);
+    assert (block->p_start == start);
+    assert (block->i_buffer == 900);
+    assert (((uintptr_t)block->p_buffer % 32) == 0);
+    block_Release (block);
+
+    block_GetAllocStats (&after);
+    assert (after.allocs == before.allocs + 2);
+    assert (after.hits >= before.hits + 1);
+    assert (after.cached > 0);
+
+    /* Large blocks bypass the arenas */
+    block = block_Alloc (1 << 20);
+    assert (block != NULL);
+    block_Release (block);
+    block_GetAllocStats (&before);
+    assert (before.allocs == after.allocs);
+
+    int val = vlc_clone (&th, test_arena_thread, blocks,
+                         VLC_THREAD_PRIORITY_LOW);
+    assert (val == 0);
+    vlc_join (th, NULL);
+
+    for (unsigned i = 0; i < 16; i++)
+    {
+        assert (blocks[i]->i_buffer == i * 1000);
+        for (size_t j = 0; j < blocks[i]->i_buffer; j++)
+            assert (blocks[i]->p_buffer[j] == i);
+        block_Release (blocks[i]);
+    }
+
+    /* The orphaned arena is gone with its last block */
+    block_GetAllocStats (&after);
+    assert (after.arenas == before.arenas);
+    assert (after.allocs == before.allocs + 16);
+}
+
+#define FIFO_BLOCKS 10000
+
+static void *test_fifo_producer (void *data)
+{
+    block_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < FIFO_BLOCKS; i += 2)
+    {
+        block_t *a = block_Alloc (1), *b = block_Alloc (2);
+        assert (a != NULL && b != NULL);
+        a->i_dts = i;
+        b->i_dts = i + 1;
+        a->p_next = b;
+
+        block_FifoPace (fifo, 64, SIZE_MAX);
+        block_FifoPut (fifo, a);
+    }
+    return NULL;
+}
+
+static void test_block_fifo (block_fifo_t *fifo)
+{
+    vlc_thread_t th;
+
+    assert (fifo != NULL);
+    assert (block_FifoCount (fifo) == 0);
+
+    int val = vlc_clone (&th, test_fifo_producer, fifo,
+                         VLC_THREAD_PRIORITY_LOW);
+    assert (val == 0);
+
+    for (unsigned i = 0; i < FIFO_BLOCKS; i++)
+    {
+        block_t *block = block_FifoShow (fifo);
+        assert (block != NULL);
+        assert (block->i_dts == (mtime_t)i);
+
+        block = block_FifoGet (fifo);
+        assert (block != NULL);
+        assert (block->i_dts == (mtime_t)i);
+        assert (block->i_buffer == 1 + (i & 1));
+        assert (block->p_next == NULL);
+        block_Release (block);
+    }
+    vlc_join (th, NULL);
+
+    assert (block_FifoCount (fifo) == 0);
+
+    /* Forced wake-up on an empty FIFO */
+    block_FifoWake (fifo);
+    assert (block_FifoGet (fifo) == NULL);
+
+    block_FifoPut (fifo, block_Alloc (16));
+    assert (block_FifoCount (fifo) == 1);
+    block_FifoEmpty (fifo);
+    assert (block_FifoCount (fifo) == 0);
+
+    block_FifoPut (fifo, block_Alloc (16));
+    block_FifoRelease (fifo);
+}
+
 int main (void)
 {
     test_block_File ();
     test_block ();
+    test_block_arena ();
+    test_block_fifo (block_FifoNew ());
+    test_block_fifo (block_FifoNewSPSC ());
     return 0;
 }
 
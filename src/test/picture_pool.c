@@ -50,6 +50,15 @@ static void test(bool zombie)
     for (unsigned i = 0; i < PICTURES; i++)
         assert(picture_pool_Get(pool) == NULL);
 
+    picture_pool_stats_t st;
+
+    picture_pool_GetStats(pool, &st);
+    assert(st.hits == PICTURES);
+    assert(st.misses == PICTURES);
+    assert(st.exhausted == 1);
+    assert(st.in_use == PICTURES);
+    assert(st.high_water == PICTURES);
+
     // Reserve currently assumes that all pictures are free (or reserved).
     //assert(picture_pool_Reserve(pool, 1) == NULL);
 
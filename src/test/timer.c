@@ -45,6 +45,14 @@ static void callback (void *ptr)
     vlc_mutex_unlock (&data->lock);
 }
 
+static void shot (void *ptr)
+{
+    struct timer_data *data = ptr;
+
+    vlc_mutex_lock (&data->lock);
+    data->count++;
+    vlc_mutex_unlock (&data->lock);
+}
 
 int main (void)
 {
@@ -80,6 +88,26 @@ int main (void)
     vlc_mutex_unlock (&data.lock);
 
     vlc_timer_destroy (data.timer);
+
+    /* Many one-shot timers */
+    struct timer_data many[100];
+
+    data.count = 0;
+    for (unsigned i = 0; i < 100; i++)
+    {
+        val = vlc_timer_create (&many[i].timer, shot, &data);
+        assert (val == 0);
+        vlc_timer_schedule (many[i].timer, false, 1 + i * (CLOCK_FREQ / 1000),
+                            0);
+    }
+    msleep (CLOCK_FREQ);
+    vlc_mutex_lock (&data.lock);
+    printf ("Count = %u\n", data.count);
+    assert (data.count == 100);
+    vlc_mutex_unlock (&data.lock);
+    for (unsigned i = 0; i < 100; i++)
+        vlc_timer_destroy (many[i].timer);
+
     vlc_mutex_destroy (&data.lock);
 
     return 0;
@@ -282,6 +282,127 @@ const char *IsUTF8( const char *str )
     return str;
 }
 
+/* Whether the bytes are all ASCII characters, 8 bytes at a time */
+static bool IsASCII (const void *data, size_t size)
+{
+    const unsigned char *p = data;
+    uint64_t bits = 0;
+
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        uint64_t word;
+
+        memcpy (&word, p, 8);
+        bits |= word;
+    }
+    while (size-- > 0)
+        bits |= *(p++);
+    return (bits & UINT64_C(0x8080808080808080)) == 0;
+}
+
+/* Whether a character encoding represents ASCII as itself, so that ASCII
+ * text needs no conversion. Only the common ones, the others use iconv. */
+static bool IsASCIICompatible (const char *charset)
+{
+    static const char prefixes[][12] = {
+        "UTF-8", "UTF8", "ASCII", "US-ASCII", "ANSI_X3.4",
+        "ISO-8859-", "ISO_8859-", "ISO8859-", "LATIN", "CP125", "WINDOWS-125",
+        "ISO_6937", "EUC-", "GB2312",
+    };
+
+    for (size_t i = 0; i < sizeof (prefixes) / sizeof (prefixes[0]); i++)
+        if (!strncasecmp (charset, prefixes[i], strlen (prefixes[i])))
+            return true;
+    return false;
+}
+
+/* Whether a conversion descriptor for the encoding can be reused: that of
+ * the UTF-16/UTF-32 encodings without explicit byte order detects the byte
+ * order mark, or writes one, only once. */
+static bool IsIconvReusable (const char *charset)
+{
+    static const char prefixes[][8] = {
+        "UTF-16", "UTF16", "UTF-32", "UTF32", "UCS-2", "UCS2", "UCS-4",
+        "UCS4", "UNICODE",
+    };
+    size_t len = strlen (charset);
+
+    if (len >= 2 && (!strcasecmp (charset + len - 2, "LE")
+                  || !strcasecmp (charset + len - 2, "BE")))
+        return true;
+    for (size_t i = 0; i < sizeof (prefixes) / sizeof (prefixes[0]); i++)
+        if (!strncasecmp (charset, prefixes[i], strlen (prefixes[i])))
+            return false;
+    return true;
+}
+
+/* Conversion descriptors kept for the next conversions between the same
+ * encodings: opening one costs much more than converting a short string,
+ * and some demuxers and decoders convert every string they get (EPG
+ * events, metadata, subtitle lines). The descriptors in use are taken out
+ * of the cache, so that the threads do not share them. */
+#define ICONV_CACHE_SIZE 8
+
+static struct
+{
+    vlc_iconv_t handle;
+    char to[24];
+    char from[24];
+} iconv_cache[ICONV_CACHE_SIZE];
+static unsigned iconv_cache_next = 0;
+static vlc_mutex_t iconv_cache_lock = VLC_STATIC_MUTEX;
+
+static vlc_iconv_t IconvOpen (const char *to, const char *from)
+{
+    vlc_mutex_lock (&iconv_cache_lock);
+    for (unsigned i = 0; i < ICONV_CACHE_SIZE; i++)
+        if (iconv_cache[i].handle != NULL
+         && !strcmp (iconv_cache[i].to, to)
+         && !strcmp (iconv_cache[i].from, from))
+        {
+            vlc_iconv_t handle = iconv_cache[i].handle;
+
+            iconv_cache[i].handle = NULL;
+            vlc_mutex_unlock (&iconv_cache_lock);
+            return handle;
+        }
+    vlc_mutex_unlock (&iconv_cache_lock);
+
+    return vlc_iconv_open (to, from);
+}
+
+static void IconvClose (vlc_iconv_t handle, const char *to, const char *from)
+{
+    if (strlen (to) >= sizeof (iconv_cache[0].to)
+     || strlen (from) >= sizeof (iconv_cache[0].from)
+     || !IsIconvReusable (to) || !IsIconvReusable (from)
+    /* Back to the initial shift state, whatever the last conversion did */
+     || vlc_iconv (handle, NULL, NULL, NULL, NULL) == (size_t)(-1))
+    {
+        vlc_iconv_close (handle);
+        return;
+    }
+
+    vlc_mutex_lock (&iconv_cache_lock);
+    unsigned i = 0;
+    while (i < ICONV_CACHE_SIZE && iconv_cache[i].handle != NULL)
+        i++;
+    if (i == ICONV_CACHE_SIZE)
+    {   /* Replace the entries in turn */
+        i = iconv_cache_next;
+        iconv_cache_next = (i + 1) % ICONV_CACHE_SIZE;
+    }
+
+    vlc_iconv_t old = iconv_cache[i].handle;
+    iconv_cache[i].handle = handle;
+    strcpy (iconv_cache[i].to, to);
+    strcpy (iconv_cache[i].from, from);
+    vlc_mutex_unlock (&iconv_cache_lock);
+
+    if (old != NULL)
+        vlc_iconv_close (old);
+}
+
 /**
  * Converts a string from the given character encoding to utf-8.
  *
@@ -290,7 +411,18 @@ const char *IsUTF8( const char *str )
  */
 char *FromCharset(const char *charset, const void *data, size_t data_size)
 {
-    vlc_iconv_t handle = vlc_iconv_open ("UTF-8", charset);
+    if (IsASCIICompatible (charset) && IsASCII (data, data_size))
+    {
+        char *out = malloc (data_size + 1);
+        if (likely(out != NULL))
+        {
+            memcpy (out, data, data_size);
+            out[data_size] = '\0';
+        }
+        return out;
+    }
+
+    vlc_iconv_t handle = IconvOpen ("UTF-8", charset);
     if (handle == (vlc_iconv_t)(-1))
         return NULL;
 
@@ -314,7 +446,7 @@ char *FromCharset(const char *charset, const void *data, size_t data_size)
         if (errno != E2BIG)
             break;
     }
-    vlc_iconv_close(handle);
+    IconvClose (handle, "UTF-8", charset);
     return out;
 }
 
@@ -332,11 +464,20 @@ char *FromCharset(const char *charset, const void *data, size_t data_size)
  */
 void *ToCharset(const char *charset, const char *in, size_t *outsize)
 {
-    vlc_iconv_t hd = vlc_iconv_open (charset, "UTF-8");
+    const size_t inlen = strlen (in);
+
+    if (IsASCIICompatible (charset) && IsASCII (in, inlen))
+    {
+        void *res = strdup (in);
+        if (likely(res != NULL))
+            *outsize = inlen;
+        return res;
+    }
+
+    vlc_iconv_t hd = IconvOpen (charset, "UTF-8");
     if (hd == (vlc_iconv_t)(-1))
         return NULL;
 
-    const size_t inlen = strlen (in);
     void *res;
 
     for (unsigned mul = 4; mul < 16; mul++)
@@ -367,7 +508,7 @@ void *ToCharset(const char *charset, const char *in, size_t *outsize)
         if (errno != E2BIG) /* conversion failure */
             break;
     }
-    vlc_iconv_close (hd);
+    IconvClose (hd, charset, "UTF-8");
     return res;
 }
 
@@ -1396,6 +1396,18 @@ static picture_pool_t *SplitterPool(vout_display_t *vd, unsigned count)
         sys->pool = picture_pool_NewFromFormat(&vd->fmt, count);
     return sys->pool;
 }
+/* Copies a picture referencing the source into a picture of the display */
+static picture_t *SplitterCopy(vout_display_t *vd, picture_t *src)
+{
+    picture_pool_t *pool = vout_display_Pool(vd, 1);
+    picture_t *dst = pool ? picture_pool_Get(pool) : NULL;
+
+    if (dst)
+        picture_Copy(dst, src);
+    picture_Release(src);
+    return dst;
+}
+
 static void SplitterPrepare(vout_display_t *vd,
                             picture_t *picture,
                             subpicture_t *subpicture)
@@ -1415,6 +1427,8 @@ static void SplitterPrepare(vout_display_t *vd,
     for (int i = 0; i < sys->count; i++) {
         if (vout_IsDisplayFiltered(sys->display[i]))
             sys->picture[i] = vout_FilterDisplay(sys->display[i], sys->picture[i]);
+        else if (sys->splitter->b_source_ref)
+            sys->picture[i] = SplitterCopy(sys->display[i], sys->picture[i]);
         if (sys->picture[i])
             vout_display_Prepare(sys->display[i], sys->picture[i], NULL);
     }
@@ -68,6 +68,7 @@ vlc_gl_t *vlc_gl_Create(struct vout_window_t *wnd, unsigned flags,
         return NULL;
 
     gl->surface = wnd;
+    gl->ext = VLC_GL_EXT_DEFAULT;
     gl->module = module_need(gl, type, name, true);
     if (gl->module == NULL)
     {
@@ -31,12 +31,22 @@
 typedef struct {
     atomic_uint displayed;
     atomic_uint lost;
+
+    /* Totals by cause, they are not reset by vout_statistic_GetReset() */
+    atomic_uint lost_late;      /* too late to be filtered */
+    atomic_uint lost_skipped;   /* filtered but superseded by a later one */
+    atomic_uint late;           /* displayed after their date */
+    atomic_uint render_failed;
 } vout_statistic_t;
 
 static inline void vout_statistic_Init(vout_statistic_t *stat)
 {
     atomic_init(&stat->displayed, 0);
     atomic_init(&stat->lost, 0);
+    atomic_init(&stat->lost_late, 0);
+    atomic_init(&stat->lost_skipped, 0);
+    atomic_init(&stat->late, 0);
+    atomic_init(&stat->render_failed, 0);
 }
 
 static inline void vout_statistic_Clean(vout_statistic_t *stat)
@@ -56,9 +66,28 @@ static inline void vout_statistic_AddDisplayed(vout_statistic_t *stat,
     atomic_fetch_add(&stat->displayed, displayed);
 }
 
-static inline void vout_statistic_AddLost(vout_statistic_t *stat, int lost)
+static inline void vout_statistic_AddLostLate(vout_statistic_t *stat, int lost)
+{
+    atomic_fetch_add(&stat->lost, lost);
+    atomic_fetch_add(&stat->lost_late, lost);
+}
+
+static inline void vout_statistic_AddLostSkipped(vout_statistic_t *stat,
+                                                 int lost)
 {
     atomic_fetch_add(&stat->lost, lost);
+    atomic_fetch_add(&stat->lost_skipped, lost);
+}
+
+static inline void vout_statistic_AddLate(vout_statistic_t *stat, int late)
+{
+    atomic_fetch_add(&stat->late, late);
+}
+
+static inline void vout_statistic_AddRenderFailed(vout_statistic_t *stat,
+                                                  int failed)
+{
+    atomic_fetch_add(&stat->render_failed, failed);
 }
 
 #endif
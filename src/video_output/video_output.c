@@ -51,6 +51,7 @@
 #include "interlacing.h"
 #include "display.h"
 #include "window.h"
+#include "../misc/trace.h"
 
 /*****************************************************************************
  * Local prototypes
@@ -657,9 +658,9 @@ static void ThreadFilterFlush(vout_thread_t *vout, bool is_locked)
         picture_Release( vout->p->displayed.current );
     vout->p->displayed.current = NULL;
 
-    if (vout->p->displayed.next)
-        picture_Release( vout->p->displayed.next );
-    vout->p->displayed.next = NULL;
+    for (unsigned i = 0; i < vout->p->displayed.next_count; i++)
+        picture_Release(vout->p->displayed.next[i]);
+    vout->p->displayed.next_count = 0;
 
     if (!is_locked)
         vlc_mutex_lock(&vout->p->filter.lock);
@@ -789,7 +790,7 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
                     if (late > VOUT_DISPLAY_LATE_THRESHOLD) {
                         msg_Warn(vout, "picture is too late to be displayed (missing %"PRId64" ms)", late/1000);
                         picture_Release(decoded);
-                        vout_statistic_AddLost(&vout->p->statistic, 1);
+                        vout_statistic_AddLostLate(&vout->p->statistic, 1);
                         continue;
                     } else if (late > 0) {
                         msg_Dbg(vout, "picture might be displayed late (missing %"PRId64" ms)", late/1000);
@@ -819,14 +820,25 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
     if (!picture)
         return VLC_EGENERIC;
 
-    assert(!vout->p->displayed.next);
+    assert(vout->p->displayed.next_count < vout->p->render_ahead);
     if (!vout->p->displayed.current)
         vout->p->displayed.current = picture;
     else
-        vout->p->displayed.next    = picture;
+        vout->p->displayed.next[vout->p->displayed.next_count++] = picture;
     return VLC_SUCCESS;
 }
 
+static picture_t *ThreadDisplayPopNext(vout_thread_t *vout)
+{
+    picture_t **next = vout->p->displayed.next;
+    picture_t *picture = next[0];
+
+    assert(vout->p->displayed.next_count > 0);
+    vout->p->displayed.next_count--;
+    memmove(&next[0], &next[1], vout->p->displayed.next_count * sizeof(*next));
+    return picture;
+}
+
 static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
 {
     vout_thread_sys_t *sys = vout->p;
@@ -846,6 +858,9 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     if (filtered->date != vout->p->displayed.current->date)
         msg_Warn(vout, "Unsupported timestamp modifications done by chain_interactive");
 
+    /* The picture may be released by the display filters */
+    const mtime_t display_date = filtered->date;
+
     /*
      * Get the subpicture to be displayed
      */
@@ -1011,10 +1026,13 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
         msg_Warn(vout, "picture is late (%lld ms)", delay / 1000);
 #endif
     if (!is_forced)
-        mwait(todisplay->date);
+        mwait(display_date);
 
     /* Display the direct buffer returned by vout_RenderPicture */
     vout->p->displayed.date = mdate();
+    if (!is_forced &&
+        vout->p->displayed.date > display_date + VOUT_DISPLAY_LATE_THRESHOLD)
+        vout_statistic_AddLate(&vout->p->statistic, 1);
     vout_display_Display(vd,
                          sys->display.filtered ? sys->display.filtered
                                                 : todisplay,
@@ -1036,8 +1054,11 @@ static int ThreadDisplayPicture(vout_thread_t *vout, mtime_t *deadline)
         if (ThreadDisplayPreparePicture(vout, true, frame_by_frame)) /* FIXME not sure it is ok */
             return VLC_EGENERIC;
 
+    /* Filter up to render_ahead pictures in advance, so that the filtering
+     * jitter is absorbed before their deadlines */
     if (!paused || frame_by_frame)
-        while (!vout->p->displayed.next && !ThreadDisplayPreparePicture(vout, false, frame_by_frame))
+        while (vout->p->displayed.next_count < vout->p->render_ahead &&
+               !ThreadDisplayPreparePicture(vout, false, frame_by_frame))
             ;
 
     const mtime_t date = mdate();
@@ -1045,8 +1066,8 @@ static int ThreadDisplayPicture(vout_thread_t *vout, mtime_t *deadline)
 
     bool drop_next_frame = frame_by_frame;
     mtime_t date_next = VLC_TS_INVALID;
-    if (!paused && vout->p->displayed.next) {
-        date_next = vout->p->displayed.next->date - render_delay;
+    if (!paused && vout->p->displayed.next_count > 0) {
+        date_next = vout->p->displayed.next[0]->date - render_delay;
         if (date_next /* + 0 FIXME */ <= date)
             drop_next_frame = true;
     }
@@ -1079,10 +1100,22 @@ static int ThreadDisplayPicture(vout_thread_t *vout, mtime_t *deadline)
         return VLC_EGENERIC;
     }
 
-    if (drop_next_frame) {
+    if (drop_next_frame && vout->p->displayed.next_count > 0) {
+        picture_Release(vout->p->displayed.current);
+        vout->p->displayed.current = ThreadDisplayPopNext(vout);
+
+        /* Do not render the pictures already superseded by a later one */
+        while (!frame_by_frame && vout->p->is_late_dropped &&
+               vout->p->displayed.next_count > 0 &&
+               !vout->p->displayed.current->b_force &&
+               vout->p->displayed.next[0]->date - render_delay <= date) {
+            picture_Release(vout->p->displayed.current);
+            vout->p->displayed.current = ThreadDisplayPopNext(vout);
+            vout_statistic_AddLostSkipped(&vout->p->statistic, 1);
+        }
+    } else if (drop_next_frame) {
         picture_Release(vout->p->displayed.current);
-        vout->p->displayed.current = vout->p->displayed.next;
-        vout->p->displayed.next    = NULL;
+        vout->p->displayed.current = NULL;
     }
 
     if (!vout->p->displayed.current)
@@ -1090,7 +1123,11 @@ static int ThreadDisplayPicture(vout_thread_t *vout, mtime_t *deadline)
 
     /* display the picture immediately */
     bool is_forced = frame_by_frame || force_refresh || vout->p->displayed.current->b_force;
+    vlc_trace_Begin("vout display");
     int ret = ThreadDisplayRenderPicture(vout, is_forced);
+    vlc_trace_End("vout display");
+    if (ret != VLC_SUCCESS)
+        vout_statistic_AddRenderFailed(&vout->p->statistic, 1);
     return force_refresh ? VLC_EGENERIC : ret;
 }
 
@@ -1315,6 +1352,8 @@ static int ThreadStart(vout_thread_t *vout, const vout_display_state_t *state)
     };
     vout->p->filter.chain_static =
         filter_chain_NewVideo( vout, true, &owner );
+    if (var_InheritBool(vout, "video-filter-pipeline"))
+        filter_chain_SetPipelined(vout->p->filter.chain_static, true);
 
     owner.video.buffer_new = VoutVideoFilterInteractiveNewPicture;
     vout->p->filter.chain_interactive =
@@ -1345,7 +1384,7 @@ static int ThreadStart(vout_thread_t *vout, const vout_display_state_t *state)
     assert(vout->p->decoder_pool);
 
     vout->p->displayed.current       = NULL;
-    vout->p->displayed.next          = NULL;
+    vout->p->displayed.next_count    = 0;
     vout->p->displayed.decoded       = NULL;
     vout->p->displayed.date          = VLC_TS_INVALID;
     vout->p->displayed.timestamp     = VLC_TS_INVALID;
@@ -1363,6 +1402,12 @@ static int ThreadStart(vout_thread_t *vout, const vout_display_state_t *state)
 
 static void ThreadStop(vout_thread_t *vout, vout_display_state_t *state)
 {
+    vout_statistic_t *stat = &vout->p->statistic;
+    msg_Dbg(vout, "%u pictures dropped as late, %u skipped, "
+            "%u displayed late, %u rendering failures",
+            atomic_load(&stat->lost_late), atomic_load(&stat->lost_skipped),
+            atomic_load(&stat->late), atomic_load(&stat->render_failed));
+
     if (vout->p->spu_blend)
         filter_DeleteBlend(vout->p->spu_blend);
 
@@ -1390,6 +1435,8 @@ static void ThreadInit(vout_thread_t *vout)
 {
     vout->p->dead            = false;
     vout->p->is_late_dropped = var_InheritBool(vout, "drop-late-frames");
+    vout->p->render_ahead    = VLC_CLIP(var_InheritInteger(vout, "video-render-ahead"),
+                                        1, VOUT_MAX_RENDER_AHEAD);
     vout->p->pause.is_on     = false;
     vout->p->pause.date      = VLC_TS_INVALID;
 
@@ -43,6 +43,9 @@
  */
 #define VOUT_MAX_PICTURES (20)
 
+/* Maximum number of pictures filtered ahead of the displayed one */
+#define VOUT_MAX_RENDER_AHEAD (8)
+
 /* */
 struct vout_thread_sys_t
 {
@@ -90,7 +93,8 @@ struct vout_thread_sys_t
         bool        is_interlaced;
         picture_t   *decoded;
         picture_t   *current;
-        picture_t   *next;
+        picture_t   *next[VOUT_MAX_RENDER_AHEAD]; /* oldest first */
+        unsigned    next_count;
     } displayed;
 
     struct {
@@ -112,6 +116,7 @@ struct vout_thread_sys_t
 
     /* */
     bool            is_late_dropped;
+    unsigned        render_ahead;
 
     /* Video filter2 chain */
     struct {
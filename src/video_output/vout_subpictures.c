@@ -51,6 +51,9 @@
 /* Number of simultaneous subpictures */
 #define VOUT_MAX_SUBPICTURES (__MAX(VOUT_MAX_PICTURES, SPU_MAX_PREPARE_TIME/5000))
 
+/* Number of scaled renderings kept per region */
+#define SPU_REGION_CACHE_MAX (2)
+
 /* */
 typedef struct {
     subpicture_t *subpicture;
@@ -776,31 +779,44 @@ static void SpuRenderRegion(spu_t *spu,
         const unsigned dst_width  = spu_scale_w(region->fmt.i_visible_width,  scale_size);
         const unsigned dst_height = spu_scale_h(region->fmt.i_visible_height, scale_size);
 
-        /* Destroy the cache if unusable */
-        if (region->p_private) {
-            subpicture_region_private_t *private = region->p_private;
-            bool is_changed = false;
-
-            /* Check resize changes */
-            if (dst_width  != private->fmt.i_visible_width ||
-                dst_height != private->fmt.i_visible_height)
-                is_changed = true;
+        /* Forced palette changes invalidate every cached rendering */
+        if (changed_palette && region->p_private) {
+            subpicture_region_private_Delete(region->p_private);
+            region->p_private = NULL;
+        }
 
-            /* Check forced palette changes */
-            if (changed_palette)
-                is_changed = true;
+        /* Look for a rendering at the destination size and chroma. A few of
+         * them are kept so that alternating outputs (display, snapshots,
+         * early blending) do not scale the region again every time. */
+        subpicture_region_private_t *cached = NULL;
+        subpicture_region_private_t **cache_ptr = &region->p_private;
+        unsigned cache_count = 0;
+        while (*cache_ptr) {
+            subpicture_region_private_t *private = *cache_ptr;
+            bool is_usable = dst_width  == private->fmt.i_visible_width &&
+                             dst_height == private->fmt.i_visible_height;
 
             if (convert_chroma && private->fmt.i_chroma != chroma_list[0])
-                is_changed = true;
+                is_usable = false;
 
-            if (is_changed) {
+            if (is_usable) {
+                /* Move it first */
+                *cache_ptr = private->p_next;
+                private->p_next = region->p_private;
+                region->p_private = cached = private;
+                break;
+            }
+            if (++cache_count >= SPU_REGION_CACHE_MAX) {
+                /* Drop the least recently used ones */
                 subpicture_region_private_Delete(private);
-                region->p_private = NULL;
+                *cache_ptr = NULL;
+                break;
             }
+            cache_ptr = &private->p_next;
         }
 
         /* Scale if needed into cache */
-        if (!region->p_private && dst_width > 0 && dst_height > 0) {
+        if (!cached && dst_width > 0 && dst_height > 0) {
             filter_t *scale = sys->scale;
 
             picture_t *picture = region->p_picture;
@@ -853,13 +869,12 @@ static void SpuRenderRegion(spu_t *spu,
 
             /* */
             if (picture) {
-                region->p_private = subpicture_region_private_New(&picture->format);
-                if (region->p_private) {
-                    region->p_private->p_picture = picture;
-                    if (!region->p_private->p_picture) {
-                        subpicture_region_private_Delete(region->p_private);
-                        region->p_private = NULL;
-                    }
+                subpicture_region_private_t *private =
+                    subpicture_region_private_New(&picture->format);
+                if (private) {
+                    private->p_picture = picture;
+                    private->p_next    = region->p_private;
+                    region->p_private  = cached = private;
                 } else {
                     picture_Release(picture);
                 }
@@ -867,9 +882,9 @@ static void SpuRenderRegion(spu_t *spu,
         }
 
         /* And use the scaled picture */
-        if (region->p_private) {
-            region_fmt     = region->p_private->fmt;
-            region_picture = region->p_private->p_picture;
+        if (cached) {
+            region_fmt     = cached->fmt;
+            region_picture = cached->p_picture;
         }
     }
 
@@ -907,14 +922,13 @@ static void SpuRenderRegion(spu_t *spu,
         }
     }
 
-    subpicture_region_t *dst = *dst_ptr = subpicture_region_New(&region_fmt);
+    /* The output region only references the (cached) rendering */
+    subpicture_region_t *dst = *dst_ptr =
+        subpicture_region_NewFromPicture(&region_fmt, region_picture);
     if (dst) {
         dst->i_x       = x_offset;
         dst->i_y       = y_offset;
         dst->i_align   = 0;
-        if (dst->p_picture)
-            picture_Release(dst->p_picture);
-        dst->p_picture = picture_Hold(region_picture);
         int fade_alpha = 255;
         if (subpic->b_fade) {
             mtime_t fade_start = subpic->i_start + 3 * (subpic->i_stop - subpic->i_start) / 4;
@@ -124,9 +124,10 @@ int vout_InitWrapper(vout_thread_t *vout)
 
     sys->display.use_dr = !vout_IsDisplayFiltered(vd);
     const bool allow_dr = !vd->info.has_pictures_invalid && !vd->info.is_slow && sys->display.use_dr;
-    const unsigned private_picture  = 4; /* XXX 3 for filter, 1 for SPU */
+    const unsigned ahead_picture    = sys->render_ahead - 1; /* filtered in advance */
+    const unsigned private_picture  = 4 + ahead_picture; /* XXX 3 for filter, 1 for SPU */
     const unsigned decoder_picture  = 1 + sys->dpb_size;
-    const unsigned kept_picture     = 1; /* last displayed picture */
+    const unsigned kept_picture     = 1 + ahead_picture; /* last displayed picture */
     const unsigned reserved_picture = DISPLAY_PICTURE_COUNT +
                                       private_picture +
                                       kept_picture;
@@ -166,6 +167,15 @@ void vout_EndWrapper(vout_thread_t *vout)
     vout_thread_sys_t *sys = vout->p;
 
     assert(!sys->display.filtered);
+
+    picture_pool_stats_t st;
+
+    picture_pool_GetStats(sys->decoder_pool, &st);
+    msg_Dbg(vout, "decoder pool: %u of %u pictures used at most, "
+            "%u hits, %u misses, exhausted %u times", st.high_water,
+            picture_pool_GetSize(sys->decoder_pool), st.hits, st.misses,
+            st.exhausted);
+
     if (sys->private_pool)
         picture_pool_Release(sys->private_pool);
 
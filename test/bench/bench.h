@@ -0,0 +1,143 @@
+/*****************************************************************************
+ * bench.h: micro-benchmark harness
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * Each benchmark program is a suite of named cases. A case is a function
+ * doing a fixed amount of work per iteration, on data generated from a fixed
+ * seed: it is run once to warm up, then BENCH_RUNS times, and the median run
+ * is reported, along with the fastest and the slowest.
+ *
+ * The results are written to the standard output as a JSON document, one per
+ * suite, and the progress to the standard error:
+ *
+ * { "suite": "core", "version": "3.0.0", "results": [
+ *   { "name": "block_fifo/put_get", "iterations": 100000,
+ *     "ns_per_op": 48.2, "ns_per_op_min": 47.9, "ns_per_op_max": 52.0,
+ *     "throughput": 20.7, "unit": "Mop/s" }, ... ] }
+ */
+
+#include "../libvlc/test.h"
+
+#include <string.h>
+#include <time.h>
+
+#define BENCH_RUNS 5
+
+typedef struct
+{
+    unsigned i_results;
+} bench_suite_t;
+
+static inline double bench_now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1000000000.;
+}
+
+static inline int bench_cmp( const void *a, const void *b )
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static inline void bench_begin( bench_suite_t *suite, const char *psz_name )
+{
+    test_init();
+    alarm( 300 ); /* some pipelines take a while on slow machines */
+
+    suite->i_results = 0;
+    printf( "{ \"suite\": \"%s\", \"version\": \"%s\", \"results\": [",
+            psz_name, libvlc_get_version() );
+    fprintf( stderr, "bench: suite %s\n", psz_name );
+}
+
+static inline void bench_end( bench_suite_t *suite )
+{
+    (void) suite;
+    printf( "\n] }\n" );
+}
+
+static inline void bench_print( bench_suite_t *suite, const char *psz_name )
+{
+    printf( "%s\n  { \"name\": \"%s\"", suite->i_results++ ? "," : "",
+            psz_name );
+}
+
+/**
+ * Runs a benchmark case.
+ * \param pf_run runs one iteration
+ * \param i_loops number of iterations per run
+ * \param f_work amount of work per iteration, in units of psz_unit
+ * (e.g. megabytes for "MB/s"), or zero to report the rate of iterations
+ */
+static inline void bench_run( bench_suite_t *suite, const char *psz_name,
+                              void (*pf_run)( void * ), void *opaque,
+                              unsigned i_loops, double f_work,
+                              const char *psz_unit )
+{
+    double pf_time[BENCH_RUNS];
+
+    pf_run( opaque ); /* warm up the caches and the lazy allocations */
+    for( unsigned i = 0; i < BENCH_RUNS; i++ )
+    {
+        double f_start = bench_now();
+        for( unsigned j = 0; j < i_loops; j++ )
+            pf_run( opaque );
+        pf_time[i] = ( bench_now() - f_start ) / i_loops;
+    }
+    qsort( pf_time, BENCH_RUNS, sizeof( *pf_time ), bench_cmp );
+
+    const double f_median = pf_time[BENCH_RUNS / 2];
+    double f_throughput;
+
+    if( f_work <= 0. )
+    {
+        f_work = 1e-6;
+        psz_unit = "Mop/s";
+    }
+    f_throughput = f_median > 0. ? f_work / f_median : 0.;
+
+    bench_print( suite, psz_name );
+    printf( ", \"iterations\": %u, \"ns_per_op\": %.1f, "
+            "\"ns_per_op_min\": %.1f, \"ns_per_op_max\": %.1f, "
+            "\"throughput\": %.2f, \"unit\": \"%s\" }", i_loops,
+            f_median * 1e9, pf_time[0] * 1e9, pf_time[BENCH_RUNS - 1] * 1e9,
+            f_throughput, psz_unit );
+    fprintf( stderr, "bench: %-32s %12.1f ns/op %10.2f %s\n", psz_name,
+             f_median * 1e9, f_throughput, psz_unit );
+}
+
+/**
+ * Reports a case that cannot run here (e.g. missing plugin).
+ */
+static inline void bench_skip( bench_suite_t *suite, const char *psz_name,
+                               const char *psz_reason )
+{
+    bench_print( suite, psz_name );
+    printf( ", \"skipped\": \"%s\" }", psz_reason );
+    fprintf( stderr, "bench: %-32s skipped (%s)\n", psz_name, psz_reason );
+}
+
+#endif
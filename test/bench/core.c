@@ -0,0 +1,165 @@
+/*****************************************************************************
+ * core.c: benchmarks of the core data structures and kernels
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "bench.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_block_helper.h>
+#include <vlc_picture.h>
+#include <vlc_picture_pool.h>
+
+#include "../../modules/packetizer/startcode_helper.h"
+
+/*****************************************************************************
+ * block_Fifo*
+ *****************************************************************************/
+#define FIFO_BATCH 64
+
+typedef struct
+{
+    block_fifo_t *p_fifo;
+    block_t      *pp_blocks[FIFO_BATCH];
+} fifo_bench_t;
+
+/* Queues a batch of blocks, as a demuxer does, then dequeues them */
+static void FifoPutGet( void *opaque )
+{
+    fifo_bench_t *b = opaque;
+
+    for( unsigned i = 0; i < FIFO_BATCH; i++ )
+        block_FifoPut( b->p_fifo, b->pp_blocks[i] );
+    for( unsigned i = 0; i < FIFO_BATCH; i++ )
+        b->pp_blocks[i] = block_FifoGet( b->p_fifo );
+}
+
+static void BenchFifo( bench_suite_t *suite, const char *psz_name,
+                       block_fifo_t *p_fifo )
+{
+    fifo_bench_t b = { .p_fifo = p_fifo };
+
+    assert( p_fifo != NULL );
+    for( unsigned i = 0; i < FIFO_BATCH; i++ )
+    {
+        b.pp_blocks[i] = block_Alloc( 188 * 7 );
+        assert( b.pp_blocks[i] != NULL );
+    }
+
+    bench_run( suite, psz_name, FifoPutGet, &b, 20000, FIFO_BATCH * 1e-6,
+               "Mblock/s" );
+
+    for( unsigned i = 0; i < FIFO_BATCH; i++ )
+        block_Release( b.pp_blocks[i] );
+    block_FifoRelease( p_fifo );
+}
+
+/*****************************************************************************
+ * picture_pool_Get
+ *****************************************************************************/
+#define POOL_SIZE 8
+
+typedef struct
+{
+    picture_pool_t *p_pool;
+} pool_bench_t;
+
+/* Takes all the pictures of the pool, as a decoder with references does */
+static void PoolGet( void *opaque )
+{
+    pool_bench_t *b = opaque;
+    picture_t *pp_pics[POOL_SIZE];
+
+    for( unsigned i = 0; i < POOL_SIZE; i++ )
+        pp_pics[i] = picture_pool_Get( b->p_pool );
+    for( unsigned i = 0; i < POOL_SIZE; i++ )
+        picture_Release( pp_pics[i] );
+}
+
+static void BenchPool( bench_suite_t *suite )
+{
+    video_format_t fmt;
+    pool_bench_t b;
+
+    video_format_Setup( &fmt, VLC_CODEC_I420, 1280, 720, 1280, 720, 1, 1 );
+    b.p_pool = picture_pool_NewFromFormat( &fmt, POOL_SIZE );
+    assert( b.p_pool != NULL );
+
+    bench_run( suite, "picture_pool/get_release", PoolGet, &b, 100000,
+               POOL_SIZE * 1e-6, "Mpicture/s" );
+
+    picture_pool_Release( b.p_pool );
+}
+
+/*****************************************************************************
+ * Annex B start code scan
+ *****************************************************************************/
+#define SCAN_SIZE (1 << 20)
+
+typedef struct
+{
+    uint8_t *p_buf;
+    block_startcode_helper_t pf_find;
+    unsigned i_count;
+} scan_bench_t;
+
+static void Scan( void *opaque )
+{
+    scan_bench_t *b = opaque;
+    const uint8_t *end = b->p_buf + SCAN_SIZE;
+
+    for( const uint8_t *p = b->pf_find( b->p_buf, end ); p != NULL;
+         p = b->pf_find( p + 1, end ) )
+        b->i_count++;
+}
+
+static void BenchScan( bench_suite_t *suite )
+{
+    scan_bench_t b = { .pf_find = startcode_FindAnnexB };
+
+    /* Slice-like data: random bytes with a start code every few kB */
+    b.p_buf = malloc( SCAN_SIZE );
+    assert( b.p_buf != NULL );
+    srand( 42 );
+    for( size_t i = 0; i < SCAN_SIZE; i++ )
+        b.p_buf[i] = rand();
+    for( size_t i = 0; i + 3 < SCAN_SIZE; i += 1 + rand() % 4096 )
+        memcpy( &b.p_buf[i], "\x00\x00\x01", 3 );
+
+    bench_run( suite, "startcode/annexb", Scan, &b, 200, SCAN_SIZE * 1e-6,
+               "MB/s" );
+    b.pf_find = startcode_FindAnnexB_C;
+    bench_run( suite, "startcode/annexb_c", Scan, &b, 200, SCAN_SIZE * 1e-6,
+               "MB/s" );
+
+    free( b.p_buf );
+}
+
+int main( void )
+{
+    bench_suite_t suite;
+
+    bench_begin( &suite, "core" );
+    BenchFifo( &suite, "block_fifo/put_get", block_FifoNew() );
+    BenchFifo( &suite, "block_fifo/put_get_spsc", block_FifoNewSPSC() );
+    BenchPool( &suite );
+    BenchScan( &suite );
+    bench_end( &suite );
+    return 0;
+}
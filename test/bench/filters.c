@@ -0,0 +1,340 @@
+/*****************************************************************************
+ * filters.c: benchmarks of the video and audio processing plugins
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "bench.h"
+#include "../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_aout.h>
+#include <vlc_aout_volume.h>
+
+#define WIDTH  1280
+#define HEIGHT 720
+
+static picture_t *NewPicture( vlc_fourcc_t i_chroma, unsigned i_width,
+                              unsigned i_height )
+{
+    video_format_t fmt;
+
+    video_format_Setup( &fmt, i_chroma, i_width, i_height, i_width, i_height,
+                        1, 1 );
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    assert( p_pic != NULL );
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const plane_t *p = &p_pic->p[i];
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+                p->p_pixels[y * p->i_pitch + x] = rand();
+    }
+    return p_pic;
+}
+
+/*****************************************************************************
+ * Video filters: chroma converters and deinterlacers
+ *****************************************************************************/
+typedef struct
+{
+    filter_chain_t *p_chain;
+    picture_t      *p_src;
+    mtime_t         i_date;
+} video_bench_t;
+
+static picture_t *VideoBufferNew( filter_t *p_filter )
+{
+    return picture_NewFromFormat( &p_filter->fmt_out.video );
+}
+
+static void VideoFilter( void *opaque )
+{
+    video_bench_t *b = opaque;
+
+    b->p_src->date = b->i_date;
+    b->i_date += CLOCK_FREQ / 25;
+
+    picture_t *p_out = filter_chain_VideoFilter( b->p_chain,
+                                                 picture_Hold( b->p_src ) );
+    while( p_out != NULL )
+    {
+        picture_t *p_next = p_out->p_next;
+        p_out->p_next = NULL;
+        picture_Release( p_out );
+        p_out = p_next;
+    }
+}
+
+/* Runs a chain of one filter from a chroma to another, with the filter of
+ * the given description, or the best converter if it is NULL */
+static void BenchVideo( bench_suite_t *suite, vlc_object_t *obj,
+                        const char *psz_name, const char *psz_filter,
+                        vlc_fourcc_t i_in, vlc_fourcc_t i_out )
+{
+    const filter_owner_t owner = {
+        .video = {
+            .buffer_new = VideoBufferNew,
+        },
+    };
+    video_bench_t b = { .i_date = VLC_TS_0 };
+    es_format_t fmt_in, fmt_out;
+
+    b.p_src = NewPicture( i_in, WIDTH, HEIGHT );
+    b.p_src->b_progressive = false;
+    b.p_src->b_top_field_first = true;
+
+    es_format_Init( &fmt_in, VIDEO_ES, i_in );
+    video_format_Copy( &fmt_in.video, &b.p_src->format );
+    es_format_Copy( &fmt_out, &fmt_in );
+    fmt_out.i_codec = fmt_out.video.i_chroma = i_out;
+
+    b.p_chain = filter_chain_NewVideo( obj, false, &owner );
+    assert( b.p_chain != NULL );
+    filter_chain_Reset( b.p_chain, &fmt_in, &fmt_out );
+
+    int i_ret;
+    if( psz_filter != NULL )
+        i_ret = filter_chain_AppendFromString( b.p_chain, psz_filter );
+    else
+        i_ret = filter_chain_AppendFilter( b.p_chain, NULL, NULL, NULL,
+                                           NULL ) != NULL ? 1 : -1;
+    if( i_ret > 0 )
+        bench_run( suite, psz_name, VideoFilter, &b, 50,
+                   WIDTH * HEIGHT * 1e-6, "Mpixel/s" );
+    else
+        bench_skip( suite, psz_name, "no filter" );
+
+    filter_chain_Delete( b.p_chain );
+    es_format_Clean( &fmt_out );
+    es_format_Clean( &fmt_in );
+    picture_Release( b.p_src );
+}
+
+/*****************************************************************************
+ * Blending
+ *****************************************************************************/
+typedef struct
+{
+    filter_t  *p_blend;
+    picture_t *p_dst;
+    picture_t *p_src;
+} blend_bench_t;
+
+static void Blend( void *opaque )
+{
+    blend_bench_t *b = opaque;
+
+    filter_Blend( b->p_blend, b->p_dst, 64, HEIGHT / 2, b->p_src, 0xc0 );
+}
+
+/* Blends a subtitle-sized picture of the given chroma on an I420 video */
+static void BenchBlend( bench_suite_t *suite, vlc_object_t *obj,
+                        const char *psz_name, vlc_fourcc_t i_chroma )
+{
+    blend_bench_t b;
+
+    b.p_dst = NewPicture( VLC_CODEC_I420, WIDTH, HEIGHT );
+    b.p_src = NewPicture( i_chroma, WIDTH - 128, HEIGHT / 4 );
+    b.p_blend = filter_NewBlend( obj, &b.p_dst->format );
+
+    if( b.p_blend != NULL
+     && filter_ConfigureBlend( b.p_blend, WIDTH, HEIGHT,
+                               &b.p_src->format ) == VLC_SUCCESS )
+        bench_run( suite, psz_name, Blend, &b, 200,
+                   (WIDTH - 128) * (HEIGHT / 4) * 1e-6, "Mpixel/s" );
+    else
+        bench_skip( suite, psz_name, "no blender" );
+
+    if( b.p_blend != NULL )
+        filter_DeleteBlend( b.p_blend );
+    picture_Release( b.p_src );
+    picture_Release( b.p_dst );
+}
+
+/*****************************************************************************
+ * Audio: float mixer and resamplers
+ *****************************************************************************/
+#define AUDIO_RATE    48000
+#define AUDIO_SAMPLES 1024
+
+static block_t *NewAudioBlock( const audio_sample_format_t *fmt )
+{
+    block_t *p_block = block_Alloc( AUDIO_SAMPLES * fmt->i_bytes_per_frame );
+    assert( p_block != NULL );
+
+    float *p = (float *)p_block->p_buffer;
+    for( unsigned i = 0; i < AUDIO_SAMPLES * fmt->i_channels; i++ )
+        p[i] = rand() / (float)RAND_MAX - .5f;
+    p_block->i_nb_samples = AUDIO_SAMPLES;
+    p_block->i_pts = p_block->i_dts = VLC_TS_0;
+    p_block->i_length = AUDIO_SAMPLES * CLOCK_FREQ / fmt->i_rate;
+    return p_block;
+}
+
+static void AudioFormat( audio_sample_format_t *fmt, unsigned i_rate )
+{
+    memset( fmt, 0, sizeof( *fmt ) );
+    fmt->i_format = VLC_CODEC_FL32;
+    fmt->i_rate = i_rate;
+    fmt->i_physical_channels = fmt->i_original_channels = AOUT_CHANS_STEREO;
+    aout_FormatPrepare( fmt );
+}
+
+typedef struct
+{
+    audio_volume_t *p_volume;
+    block_t        *p_block;
+} volume_bench_t;
+
+static void Amplify( void *opaque )
+{
+    volume_bench_t *b = opaque;
+
+    b->p_volume->amplify( b->p_volume, b->p_block, .99f );
+}
+
+static void BenchMixer( bench_suite_t *suite, vlc_object_t *obj )
+{
+    audio_sample_format_t fmt;
+    volume_bench_t b;
+
+    AudioFormat( &fmt, AUDIO_RATE );
+    b.p_block = NewAudioBlock( &fmt );
+    b.p_volume = vlc_object_create( obj, sizeof( *b.p_volume ) );
+    assert( b.p_volume != NULL );
+    b.p_volume->format = VLC_CODEC_FL32;
+
+    module_t *p_module = module_need( b.p_volume, "audio volume", "float",
+                                      true );
+    if( p_module != NULL )
+    {
+        bench_run( suite, "mixer/float", Amplify, &b, 20000,
+                   AUDIO_SAMPLES * 1e-6, "Msample/s" );
+        module_unneed( b.p_volume, p_module );
+    }
+    else
+        bench_skip( suite, "mixer/float", "no plugin" );
+
+    vlc_object_release( b.p_volume );
+    block_Release( b.p_block );
+}
+
+typedef struct
+{
+    filter_t *p_filter;
+    block_t  *p_block;
+} resampler_bench_t;
+
+static void Resample( void *opaque )
+{
+    resampler_bench_t *b = opaque;
+    block_t *p_out;
+
+    p_out = b->p_filter->pf_audio_filter( b->p_filter,
+                                          block_Duplicate( b->p_block ) );
+    if( p_out != NULL )
+        block_Release( p_out );
+}
+
+/* Resamples 44.1 kHz stereo to 48 kHz, as the audio output often does */
+static void BenchResampler( bench_suite_t *suite, vlc_object_t *obj,
+                            const char *psz_name, const char *psz_module )
+{
+    resampler_bench_t b;
+
+    b.p_filter = vlc_object_create( obj, sizeof( *b.p_filter ) );
+    assert( b.p_filter != NULL );
+    es_format_Init( &b.p_filter->fmt_in, AUDIO_ES, VLC_CODEC_FL32 );
+    es_format_Init( &b.p_filter->fmt_out, AUDIO_ES, VLC_CODEC_FL32 );
+    AudioFormat( &b.p_filter->fmt_in.audio, 44100 );
+    AudioFormat( &b.p_filter->fmt_out.audio, AUDIO_RATE );
+    b.p_block = NewAudioBlock( &b.p_filter->fmt_in.audio );
+
+    module_t *p_module = module_need( b.p_filter, "audio resampler",
+                                      psz_module, true );
+    if( p_module != NULL )
+    {
+        bench_run( suite, psz_name, Resample, &b, 2000,
+                   AUDIO_SAMPLES * 1e-6, "Msample/s" );
+        module_unneed( b.p_filter, p_module );
+    }
+    else
+        bench_skip( suite, psz_name, "no plugin" );
+
+    vlc_object_release( b.p_filter );
+    block_Release( b.p_block );
+}
+
+int main( void )
+{
+    bench_suite_t suite;
+
+    bench_begin( &suite, "filters" );
+    srand( 42 );
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    BenchVideo( &suite, obj, "chroma/i420_rv32", NULL,
+                VLC_CODEC_I420, VLC_CODEC_RGB32 );
+    BenchVideo( &suite, obj, "chroma/i420_yuy2", NULL,
+                VLC_CODEC_I420, VLC_CODEC_YUYV );
+    BenchVideo( &suite, obj, "chroma/yuy2_i420", NULL,
+                VLC_CODEC_YUYV, VLC_CODEC_I420 );
+    BenchVideo( &suite, obj, "chroma/i422_i420", NULL,
+                VLC_CODEC_I422, VLC_CODEC_I420 );
+    BenchVideo( &suite, obj, "chroma/i420_nv12", NULL,
+                VLC_CODEC_I420, VLC_CODEC_NV12 );
+
+    static const char *const ppsz_modes[] = {
+        "discard", "blend", "mean", "bob", "linear", "x", "yadif",
+        "yadif2x", "phosphor", "ivtc",
+    };
+    for( size_t i = 0; i < ARRAY_SIZE(ppsz_modes); i++ )
+    {
+        char psz_name[32], psz_filter[48];
+
+        snprintf( psz_name, sizeof( psz_name ), "deinterlace/%s",
+                  ppsz_modes[i] );
+        snprintf( psz_filter, sizeof( psz_filter ), "deinterlace{mode=%s}",
+                  ppsz_modes[i] );
+        BenchVideo( &suite, obj, psz_name, psz_filter,
+                    VLC_CODEC_I420, VLC_CODEC_I420 );
+    }
+
+    BenchBlend( &suite, obj, "blend/yuva_i420", VLC_CODEC_YUVA );
+    BenchBlend( &suite, obj, "blend/rgba_i420", VLC_CODEC_RGBA );
+    BenchBlend( &suite, obj, "blend/yuvp_i420", VLC_CODEC_YUVP );
+
+    BenchMixer( &suite, obj );
+    BenchResampler( &suite, obj, "resampler/ugly", "ugly_resampler" );
+    BenchResampler( &suite, obj, "resampler/polyphase",
+                    "polyphase_resampler" );
+    BenchResampler( &suite, obj, "resampler/speex", "speex_resampler" );
+    BenchResampler( &suite, obj, "resampler/samplerate", "samplerate" );
+
+    libvlc_release( vlc );
+    bench_end( &suite );
+    return 0;
+}
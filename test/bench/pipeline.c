@@ -0,0 +1,290 @@
+/*****************************************************************************
+ * pipeline.c: end-to-end benchmarks of the playback and streaming pipelines
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "bench.h"
+
+#include <vlc_common.h>
+
+/*
+ * The pipelines run through the stream output, which does not pace the
+ * input: a media is processed as fast as possible, and the whole run is
+ * timed, from the start of the player to the end of the stream.
+ */
+
+/*****************************************************************************
+ * Synthetic MPEG-TS file
+ *****************************************************************************/
+#define TS_SIZE     188
+#define TS_PACKETS  (32 * 1024) /* ~6 MB */
+#define TS_PMT_PID  0x100
+#define TS_ES_PID   0x101
+#define TS_FRAME    40 /* packets per frame */
+
+static uint32_t Crc32( const uint8_t *p, size_t i_size )
+{
+    uint32_t i_crc = 0xffffffff;
+
+    while( i_size-- > 0 )
+    {
+        i_crc ^= (uint32_t)*p++ << 24;
+        for( int i = 0; i < 8; i++ )
+            i_crc = (i_crc << 1) ^ ((i_crc & 0x80000000) ? 0x04c11db7 : 0);
+    }
+    return i_crc;
+}
+
+/* Writes one packet, with a PCR (90 kHz base) or some stuffing in its
+ * adaptation field */
+static void WritePacket( FILE *stream, unsigned i_pid, bool b_start,
+                         unsigned *pi_cc, const uint8_t *p_payload,
+                         size_t i_payload, int64_t i_pcr )
+{
+    uint8_t p[TS_SIZE];
+    size_t i_header = 4;
+
+    assert( i_payload <= TS_SIZE - 4 );
+    p[0] = 0x47;
+    p[1] = (b_start ? 0x40 : 0) | (i_pid >> 8);
+    p[2] = i_pid;
+    p[3] = 0x10 | (*pi_cc & 0xf);
+    *pi_cc += 1;
+
+    if( i_pcr >= 0 || i_payload < TS_SIZE - 4 )
+    {
+        size_t i_af = TS_SIZE - 4 - 1 - i_payload; /* adaptation field size */
+
+        if( i_pcr >= 0 )
+            assert( i_af >= 7 );
+        p[3] |= 0x20;
+        p[4] = i_af;
+        if( i_af > 0 )
+        {
+            p[5] = (i_pcr >= 0) ? 0x10 : 0x00;
+            memset( &p[6], 0xff, i_af - 1 );
+            if( i_pcr >= 0 )
+            {
+                p[6] = i_pcr >> 25;
+                p[7] = i_pcr >> 17;
+                p[8] = i_pcr >> 9;
+                p[9] = i_pcr >> 1;
+                p[10] = ((i_pcr & 1) << 7) | 0x7e;
+                p[11] = 0;
+            }
+        }
+        i_header += 1 + i_af;
+    }
+    memcpy( &p[i_header], p_payload, i_payload );
+
+    size_t i_written = fwrite( p, TS_SIZE, 1, stream );
+    assert( i_written == 1 );
+    (void) i_written;
+}
+
+static void WriteSection( FILE *stream, unsigned i_pid, unsigned *pi_cc,
+                          uint8_t *p_section, size_t i_size )
+{
+    uint8_t p[TS_SIZE - 4];
+
+    /* section_length covers the rest of the section and the CRC */
+    p_section[1] = 0xb0 | ((i_size + 4 - 3) >> 8);
+    p_section[2] = i_size + 4 - 3;
+    uint32_t i_crc = Crc32( p_section, i_size );
+    p_section[i_size++] = i_crc >> 24;
+    p_section[i_size++] = i_crc >> 16;
+    p_section[i_size++] = i_crc >> 8;
+    p_section[i_size++] = i_crc;
+
+    p[0] = 0; /* pointer field */
+    memcpy( &p[1], p_section, i_size );
+    memset( &p[1 + i_size], 0xff, sizeof( p ) - 1 - i_size );
+    WritePacket( stream, i_pid, true, pi_cc, p, sizeof( p ), -1 );
+}
+
+/* Writes a program with one MPEG-2 video stream: frames of random data
+ * behind picture start codes, with a PTS and a PCR (base) per frame */
+static void WriteTs( const char *psz_path )
+{
+    FILE *stream = fopen( psz_path, "wb" );
+    unsigned i_pat_cc = 0, i_pmt_cc = 0, i_es_cc = 0;
+    uint8_t p[TS_SIZE];
+
+    assert( stream != NULL );
+    srand( 42 );
+
+    for( unsigned i = 0; i < TS_PACKETS; i++ )
+    {
+        const unsigned i_frame = i / TS_FRAME;
+        const int64_t i_pts = 90000 + i_frame * 3600; /* 25 fps */
+
+        if( i % TS_FRAME == 0 )
+        {
+            if( i_frame % 25 == 0 )
+            {
+                uint8_t pat[16] = {
+                    0x00, 0, 0, 0x00, 0x01, 0xc1, 0x00, 0x00,
+                    0x00, 0x01, 0xe0 | (TS_PMT_PID >> 8), TS_PMT_PID & 0xff,
+                };
+                uint8_t pmt[24] = {
+                    0x02, 0, 0, 0x00, 0x01, 0xc1, 0x00, 0x00,
+                    0xe0 | (TS_ES_PID >> 8), TS_ES_PID & 0xff, 0xf0, 0x00,
+                    0x02, 0xe0 | (TS_ES_PID >> 8), TS_ES_PID & 0xff,
+                    0xf0, 0x00,
+                };
+                WriteSection( stream, 0, &i_pat_cc, pat, 12 );
+                WriteSection( stream, TS_PMT_PID, &i_pmt_cc, pmt, 17 );
+            }
+
+            /* PES header with a PTS, then the picture start code */
+            static const uint8_t pes[] = { 0x00, 0x00, 0x01, 0xe0, 0x00, 0x00,
+                                           0x80, 0x80, 0x05 };
+            size_t i_size = sizeof( pes );
+            memcpy( p, pes, i_size );
+            p[i_size++] = 0x21 | ((i_pts >> 29) & 0x0e);
+            p[i_size++] = i_pts >> 22;
+            p[i_size++] = ((i_pts >> 14) & 0xfe) | 0x01;
+            p[i_size++] = i_pts >> 7;
+            p[i_size++] = (i_pts << 1) | 0x01;
+            memcpy( &p[i_size], "\x00\x00\x01\x00", 4 );
+            i_size += 4;
+            while( i_size < TS_SIZE - 4 - 8 )
+                p[i_size++] = rand() | 0x80; /* no emulated start code */
+            WritePacket( stream, TS_ES_PID, true, &i_es_cc, p, i_size,
+                         i_pts - 9000 );
+        }
+        else
+        {
+            for( size_t j = 0; j < TS_SIZE - 4; j++ )
+                p[j] = rand() | 0x80;
+            WritePacket( stream, TS_ES_PID, false, &i_es_cc, p, TS_SIZE - 4,
+                         -1 );
+        }
+    }
+    fclose( stream );
+}
+
+/*****************************************************************************
+ * Player runs
+ *****************************************************************************/
+typedef struct
+{
+    libvlc_instance_t *p_vlc;
+    const char        *psz_path;
+    const char *const *ppsz_options;
+    vlc_sem_t          done;
+    bool               b_error;
+} pipeline_bench_t;
+
+static void OnEnd( const libvlc_event_t *p_event, void *opaque )
+{
+    pipeline_bench_t *b = opaque;
+
+    if( p_event->type == libvlc_MediaPlayerEncounteredError )
+        b->b_error = true;
+    vlc_sem_post( &b->done );
+}
+
+static void Play( void *opaque )
+{
+    pipeline_bench_t *b = opaque;
+
+    libvlc_media_t *p_media = libvlc_media_new_path( b->p_vlc, b->psz_path );
+    assert( p_media != NULL );
+    for( const char *const *ppsz = b->ppsz_options; *ppsz != NULL; ppsz++ )
+        libvlc_media_add_option( p_media, *ppsz );
+
+    libvlc_media_player_t *p_mp = libvlc_media_player_new_from_media( p_media );
+    assert( p_mp != NULL );
+    libvlc_media_release( p_media );
+
+    libvlc_event_manager_t *p_em = libvlc_media_player_event_manager( p_mp );
+    libvlc_event_attach( p_em, libvlc_MediaPlayerEndReached, OnEnd, b );
+    libvlc_event_attach( p_em, libvlc_MediaPlayerEncounteredError, OnEnd, b );
+
+    if( libvlc_media_player_play( p_mp ) == 0 )
+        vlc_sem_wait( &b->done );
+    else
+        b->b_error = true;
+
+    libvlc_media_player_stop( p_mp );
+    libvlc_media_player_release( p_mp );
+}
+
+static void BenchPipeline( bench_suite_t *suite, libvlc_instance_t *p_vlc,
+                           const char *psz_name, const char *psz_path,
+                           const char *const *ppsz_options, double f_work,
+                           const char *psz_unit )
+{
+    pipeline_bench_t b = {
+        .p_vlc = p_vlc,
+        .psz_path = psz_path,
+        .ppsz_options = ppsz_options,
+        .b_error = false,
+    };
+
+    vlc_sem_init( &b.done, 0 );
+
+    /* Make sure the pipeline can be built here before timing it */
+    Play( &b );
+    if( !b.b_error )
+        bench_run( suite, psz_name, Play, &b, 1, f_work, psz_unit );
+    else
+        bench_skip( suite, psz_name, "pipeline failed" );
+
+    vlc_sem_destroy( &b.done );
+}
+
+int main( void )
+{
+    bench_suite_t suite;
+    char psz_ts[] = "/tmp/vlc-bench-XXXXXX.ts";
+
+    bench_begin( &suite, "pipeline" );
+
+    int fd = mkstemps( psz_ts, 3 );
+    assert( fd != -1 );
+    close( fd );
+    WriteTs( psz_ts );
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+
+    /* file -> TS demux -> packetizer -> null output */
+    static const char *const ppsz_demux[] = {
+        ":demux=ts", ":sout=#dummy", NULL
+    };
+    BenchPipeline( &suite, vlc, "pipeline/ts_demux", psz_ts, ppsz_demux,
+                   TS_PACKETS * TS_SIZE * 1e-6, "MB/s" );
+
+    /* still picture -> decoder -> scaler -> encoder -> null output */
+    static const char *const ppsz_transcode[] = {
+        ":image-duration=10", ":image-fps=25/1",
+        ":sout=#transcode{vcodec=mp2v,vb=2000,width=640,height=360}:dummy",
+        NULL
+    };
+    BenchPipeline( &suite, vlc, "pipeline/transcode",
+                   SRCDIR"/samples/image.jpg", ppsz_transcode,
+                   10 * 25 * 1e-3, "kframe/s" );
+
+    libvlc_release( vlc );
+    unlink( psz_ts );
+    bench_end( &suite );
+    return 0;
+}
@@ -42,6 +42,8 @@
 #define WIDTH 128
 #define HEIGHT 128
 
+#define BAR 16
+
 #define TEXT "Hello world!"
 #define TEXTSIZE sizeof( TEXT )
 
@@ -126,6 +128,21 @@ void DataSharedMem( FILE *p_cmd, FILE *p_res, int i_overlay, int i_width,
     printf( " done\n" );
 }
 
+void AttachSharedMem( FILE *p_cmd, FILE *p_res, int i_overlay, int i_width,
+                      int i_height, char *psz_format, int i_shmid ) {
+
+    printf( "Attaching shared memory..." );
+    CheckedCommand( p_cmd, p_res, "AttachSharedMem %d %d %d %s %d\n",
+                    i_overlay, i_width, i_height, psz_format, i_shmid );
+    printf( " done\n" );
+}
+
+void UpdateSharedMem( FILE *p_cmd, FILE *p_res, int i_overlay, int i_x,
+                      int i_y, int i_width, int i_height ) {
+    CheckedCommand( p_cmd, p_res, "UpdateSharedMem %d %d %d %d %d\n",
+                    i_overlay, i_x, i_y, i_width, i_height );
+}
+
 void SetAlpha( FILE *p_cmd, FILE *p_res, int i_overlay, int i_alpha ) {
     CheckedCommand( p_cmd, p_res, "SetAlpha %d %d\n", i_overlay, i_alpha );
 }
@@ -244,6 +261,28 @@ void TextTest( FILE *p_cmd, FILE *p_res, int i_overlay ) {
     sleep( 5 );
 }
 
+void SharedMemTest( FILE *p_cmd, FILE *p_res, int i_overlay ) {
+    printf( "Activating overlay..." );
+    SetVisibility( p_cmd, p_res, i_overlay, 1 );
+    printf( " done\n" );
+
+    /* Only the columns of the bar that moved are sent again. The shared
+     * memory can be written as soon as the previous update succeeded. */
+    printf( "Moving bar..." );
+    for( int i_bar = 0; i_bar < WIDTH - BAR; ++i_bar ) {
+        for( int i_line = 0; i_line < HEIGHT; ++i_line ) {
+            char *p_line = p_imageRGBA + i_line * WIDTH * 4;
+            memset( p_line + i_bar * 4, 0x00, 4 );
+            memset( p_line + ( i_bar + BAR ) * 4, 0xFF, 4 );
+        }
+        UpdateSharedMem( p_cmd, p_res, i_overlay, i_bar, 0, BAR + 1, HEIGHT );
+        usleep( 40000 );
+    }
+    printf( " done\n" );
+
+    sleep( 5 );
+}
+
 /*****************************************************************************
  * main
  *****************************************************************************/
@@ -347,4 +386,10 @@ int main( int i_argc, char *ppsz_argv[] ) {
 
     DeleteImage( p_cmd, p_res, i_overlay_image );
     DeleteImage( p_cmd, p_res, i_overlay_text );
+
+    int i_overlay_shared = GenImage( p_cmd, p_res );
+    AttachSharedMem( p_cmd, p_res, i_overlay_shared, WIDTH, HEIGHT, "RGBA",
+                     i_shmRGBA );
+    SharedMemTest( p_cmd, p_res, i_overlay_shared );
+    DeleteImage( p_cmd, p_res, i_overlay_shared );
 }
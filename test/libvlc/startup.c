@@ -0,0 +1,73 @@
+/*
+ * startup.c - libvlc start up time benchmark
+ */
+
+/**********************************************************************
+ *  Copyright (C) 2015 VLC authors and VideoLAN                       *
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+#include "test.h"
+
+#include <time.h>
+
+#define WARM_RUNS 20
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000. + ts.tv_nsec / 1000000.;
+}
+
+/* Returns the time to create and destroy a LibVLC instance, in milliseconds */
+static double test_startup (const char *option)
+{
+    const char *argv[] = { "--ignore-config", "--quiet", option };
+    int argc = (option != NULL) ? 3 : 2;
+    double start = now ();
+
+    libvlc_instance_t *vlc = libvlc_new (argc, argv);
+    assert (vlc != NULL);
+    libvlc_release (vlc);
+
+    return now () - start;
+}
+
+int main (void)
+{
+    test_init ();
+    alarm (60); /* loading every plug-in may take a while */
+
+    /* Cold: all plug-ins are loaded, and the cache is written */
+    log ("cold start up: %.1f ms\n", test_startup ("--reset-plugins-cache"));
+    log ("start up without cache: %.1f ms\n",
+         test_startup ("--no-plugins-cache"));
+
+    /* Warm: the plug-ins are described by the cache */
+    double total = 0., best = -1.;
+    for (unsigned i = 0; i < WARM_RUNS; i++)
+    {
+        double time = test_startup (NULL);
+
+        total += time;
+        if (best < 0. || time < best)
+            best = time;
+    }
+    log ("warm start up: %.1f ms average, %.1f ms best (%u runs)\n",
+         total / WARM_RUNS, best, WARM_RUNS);
+    return 0;
+}
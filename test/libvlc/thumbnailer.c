@@ -0,0 +1,82 @@
+/*
+ * thumbnailer.c - libvlc smoke test
+ */
+
+/**********************************************************************
+ *  Copyright (C) 2015 VLC authors and VideoLAN                       *
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+#include "test.h"
+
+#include <string.h>
+
+static void test_thumbnailer (const char** argv, int argc)
+{
+    const char * file = SRCDIR"/samples/image.jpg";
+    char path[] = "/tmp/vlc-thumbnail-XXXXXX.png";
+
+    log ("Testing thumbnailer\n");
+
+    int fd = mkstemps (path, 4);
+    assert (fd != -1);
+    close (fd);
+
+    libvlc_instance_t *vlc = libvlc_new (argc, argv);
+    assert (vlc != NULL);
+
+    libvlc_media_t *media = libvlc_media_new_path (vlc, file);
+    assert (media != NULL);
+
+    libvlc_thumbnailer_t *thumbnailer = libvlc_thumbnailer_new (vlc);
+    assert (thumbnailer != NULL);
+
+    /* The second request reuses the decoder of the first one */
+    for (int i = 0; i < 2; i++)
+    {
+        int ret = libvlc_thumbnailer_take (thumbnailer, media, 0, 64, 0,
+                                           10000, path);
+        assert (ret == 0);
+
+        FILE *stream = fopen (path, "rb");
+        assert (stream != NULL);
+
+        unsigned char sig[8];
+        assert (fread (sig, 1, sizeof (sig), stream) == sizeof (sig));
+        assert (!memcmp (sig, "\x89PNG\r\n\x1a\n", sizeof (sig)));
+        fclose (stream);
+    }
+
+    /* A media without any video track */
+    libvlc_media_t *audio = libvlc_media_new_path (vlc, test_default_sample);
+    assert (audio != NULL);
+    assert (libvlc_thumbnailer_take_at_position (thumbnailer, audio, .5f,
+                                                 64, 0, 10000, path) == -1);
+    libvlc_media_release (audio);
+
+    libvlc_thumbnailer_release (thumbnailer);
+    libvlc_media_release (media);
+    libvlc_release (vlc);
+    unlink (path);
+}
+
+int main (void)
+{
+    test_init();
+
+    test_thumbnailer (test_defaults_args, test_defaults_nargs);
+
+    return 0;
+}
@@ -0,0 +1,182 @@
+/*****************************************************************************
+ * startcode.c: Annex B start code lookup test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_block_helper.h>
+
+#include "../../../modules/packetizer/startcode_helper.h"
+
+#define BUFFER_SIZE (1 << 20)
+#define BENCH_LOOPS 200
+
+static const uint8_t p_startcode[3] = { 0x00, 0x00, 0x01 };
+
+static const uint8_t *FindReference( const uint8_t *p, const uint8_t *end )
+{
+    for( ; end - p >= 3; p++ )
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+            return p;
+    return NULL;
+}
+
+/* Fills the buffer with slice-like data: mostly random, with runs of zeroes,
+ * near misses and a start code every few kilobytes */
+static void FillBuffer( uint8_t *p, size_t i_size, unsigned i_seed )
+{
+    srand( i_seed );
+    for( size_t i = 0; i < i_size; i++ )
+        p[i] = rand();
+
+    for( size_t i = 0; i + 4 < i_size; i += 1 + rand() % 4096 )
+    {
+        switch( rand() % 4 )
+        {
+            case 0: memcpy( &p[i], p_startcode, 3 ); break;
+            case 1: memset( &p[i], 0, 2 ); p[i + 2] = 2; break;
+            case 2: memset( &p[i], 0, 4 ); break;
+            default: p[i] = 0; p[i + 1] = 1; break;
+        }
+    }
+}
+
+static void CheckHelper( const char *psz_name, block_startcode_helper_t pf_find,
+                         const uint8_t *p_buf, size_t i_size )
+{
+    const uint8_t *end = p_buf + i_size;
+
+    /* every alignment and every end, near the start of the buffer */
+    for( size_t i = 0; i < 64; i++ )
+        for( size_t j = i; j < 128; j++ )
+            assert( pf_find( p_buf + i, p_buf + j ) ==
+                    FindReference( p_buf + i, p_buf + j ) );
+
+    /* every start code of the buffer */
+    for( const uint8_t *p = p_buf; p < end; )
+    {
+        const uint8_t *p_ref = FindReference( p, end );
+        assert( pf_find( p, end ) == p_ref );
+        if( p_ref == NULL )
+            break;
+        p = p_ref + 1;
+    }
+    log( "%s: ok\n", psz_name );
+}
+
+/* Looks up every start code through a bytestream of blocks cut at random,
+ * with and without the helper */
+static void CheckBytestream( const uint8_t *p_buf, size_t i_size )
+{
+    block_bytestream_t bs;
+
+    block_BytestreamInit( &bs );
+    for( size_t i = 0; i < i_size; )
+    {
+        size_t i_len = __MIN( i_size - i, 1 + (size_t)rand() % 300 );
+        block_t *p_block = block_Alloc( i_len );
+        assert( p_block != NULL );
+        memcpy( p_block->p_buffer, &p_buf[i], i_len );
+        block_BytestreamPush( &bs, p_block );
+        i += i_len;
+    }
+
+    size_t i_ref = 0, i_fast = 0;
+    for( ;; )
+    {
+        int i_ret_ref = block_FindStartcodeFromOffset( &bs, &i_ref,
+                                                       p_startcode, 3, NULL );
+        int i_ret_fast = block_FindStartcodeFromOffset( &bs, &i_fast,
+                                                        p_startcode, 3,
+                                                        startcode_FindAnnexB );
+        assert( i_ret_ref == i_ret_fast );
+        assert( i_ref == i_fast );
+        if( i_ret_ref != VLC_SUCCESS )
+            break;
+        i_ref++;
+        i_fast++;
+    }
+    block_BytestreamRelease( &bs );
+    log( "bytestream: ok\n" );
+}
+
+static void Bench( const char *psz_name, block_startcode_helper_t pf_find,
+                   const uint8_t *p_buf, size_t i_size )
+{
+    const uint8_t *end = p_buf + i_size;
+    struct timespec start, stop;
+    unsigned i_count = 0;
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for( int i = 0; i < BENCH_LOOPS; i++ )
+        for( const uint8_t *p = pf_find( p_buf, end ); p != NULL;
+             p = pf_find( p + 1, end ) )
+            i_count++;
+    clock_gettime( CLOCK_MONOTONIC, &stop );
+
+    double f_time = ( stop.tv_sec - start.tv_sec ) +
+                    ( stop.tv_nsec - start.tv_nsec ) / 1000000000.;
+    log( "%s: %u start codes, %.0f MB/s\n", psz_name, i_count / BENCH_LOOPS,
+         (double)i_size * BENCH_LOOPS / f_time / 1000000. );
+}
+
+int main( void )
+{
+    test_init();
+
+    uint8_t *p_buf = malloc( BUFFER_SIZE );
+    assert( p_buf != NULL );
+    FillBuffer( p_buf, BUFFER_SIZE, 42 );
+
+    CheckHelper( "C", startcode_FindAnnexB_C, p_buf, BUFFER_SIZE );
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+        CheckHelper( "SSE2", startcode_FindAnnexB_SSE2, p_buf, BUFFER_SIZE );
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+        CheckHelper( "AVX2", startcode_FindAnnexB_AVX2, p_buf, BUFFER_SIZE );
+#endif
+#ifdef CAN_COMPILE_NEON_INTRINSICS
+    CheckHelper( "NEON", startcode_FindAnnexB_NEON, p_buf, BUFFER_SIZE );
+#endif
+    CheckBytestream( p_buf, BUFFER_SIZE );
+
+    Bench( "reference", FindReference, p_buf, BUFFER_SIZE );
+    Bench( "C", startcode_FindAnnexB_C, p_buf, BUFFER_SIZE );
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+        Bench( "SSE2", startcode_FindAnnexB_SSE2, p_buf, BUFFER_SIZE );
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+        Bench( "AVX2", startcode_FindAnnexB_AVX2, p_buf, BUFFER_SIZE );
+#endif
+#ifdef CAN_COMPILE_NEON_INTRINSICS
+    Bench( "NEON", startcode_FindAnnexB_NEON, p_buf, BUFFER_SIZE );
+#endif
+
+    free( p_buf );
+    return 0;
+}
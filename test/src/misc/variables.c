@@ -401,6 +401,46 @@ static void test_creation_and_type( libvlc_int_t *p_libvlc )
     assert( var_Get( p_libvlc, "bla", &val ) == VLC_ENOVAR );
 }
 
+static void test_inherit( libvlc_int_t *p_libvlc )
+{
+    vlc_object_t *p_parent = vlc_object_create( p_libvlc, sizeof( *p_parent ) );
+    assert( p_parent != NULL );
+    const int64_t i_config = config_GetInt( p_libvlc, "file-caching" );
+
+    /* Children created and destroyed again and again, as while probing
+     * modules, must see the changes of their ancestors despite the cache */
+    for( int i = 0; i < 4; i++ )
+    {
+        vlc_object_t *p_child = vlc_object_create( p_parent,
+                                                   sizeof( *p_child ) );
+        assert( p_child != NULL );
+
+        assert( var_InheritInteger( p_child, "file-caching" ) == i_config );
+        assert( var_InheritInteger( p_child, "file-caching" ) == i_config );
+
+        var_Create( p_libvlc, "file-caching", VLC_VAR_INTEGER );
+        var_SetInteger( p_libvlc, "file-caching", i_config + 1 );
+        assert( var_InheritInteger( p_child, "file-caching" ) == i_config + 1 );
+
+        var_Create( p_parent, "file-caching", VLC_VAR_INTEGER );
+        var_SetInteger( p_parent, "file-caching", i_config + 2 );
+        assert( var_InheritInteger( p_child, "file-caching" ) == i_config + 2 );
+
+        /* Set, not created: no invalidation is needed */
+        var_SetInteger( p_parent, "file-caching", i_config + 3 );
+        assert( var_InheritInteger( p_child, "file-caching" ) == i_config + 3 );
+
+        var_Destroy( p_parent, "file-caching" );
+        assert( var_InheritInteger( p_child, "file-caching" ) == i_config + 1 );
+
+        var_Destroy( p_libvlc, "file-caching" );
+        assert( var_InheritInteger( p_child, "file-caching" ) == i_config );
+
+        vlc_object_release( p_child );
+    }
+    vlc_object_release( p_parent );
+}
+
 static void test_variables( libvlc_instance_t *p_vlc )
 {
     libvlc_int_t *p_libvlc = p_vlc->p_libvlc_int;
@@ -438,6 +478,9 @@ static void test_variables( libvlc_instance_t *p_vlc )
 
     log( "Testing type at creation\n" );
     test_creation_and_type( p_libvlc );
+
+    log( "Testing inheritance\n" );
+    test_inherit( p_libvlc );
 }
 
 
@@ -0,0 +1,121 @@
+/*****************************************************************************
+ * variables_bench.c: benchmark of variables under contention
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_atomic.h>
+
+#define MAX_READERS 8
+
+/* Mimics the input: "time" and "position" are set many times per second,
+ * with callbacks, while interfaces poll them */
+static atomic_bool stop;
+
+static int SlowCallback( vlc_object_t *obj, const char *name,
+                         vlc_value_t oldval, vlc_value_t newval, void *data )
+{
+    (void) obj; (void) name; (void) oldval; (void) newval; (void) data;
+    for( volatile int i = 0; i < 1000; i++ );
+    return VLC_SUCCESS;
+}
+
+static void *Reader( void *data )
+{
+    vlc_object_t *obj = data;
+    unsigned long count = 0;
+
+    while( !atomic_load( &stop ) )
+    {
+        var_GetTime( obj, "bench-time" );
+        var_GetFloat( obj, "bench-position" );
+        count += 2;
+    }
+    return (void *)count;
+}
+
+static void *Writer( void *data )
+{
+    vlc_object_t *obj = data;
+    unsigned long count = 0;
+
+    while( !atomic_load( &stop ) )
+    {
+        var_SetTime( obj, "bench-time", count );
+        var_SetFloat( obj, "bench-position", count * .001f );
+        count += 2;
+    }
+    return (void *)count;
+}
+
+static void bench( vlc_object_t *obj, int readers )
+{
+    vlc_thread_t threads[MAX_READERS + 1];
+    unsigned long gets = 0, sets;
+    void *ret;
+
+    atomic_store( &stop, false );
+    for( int i = 0; i < readers; i++ )
+        assert( vlc_clone( &threads[i], Reader, obj,
+                           VLC_THREAD_PRIORITY_LOW ) == 0 );
+    assert( vlc_clone( &threads[readers], Writer, obj,
+                       VLC_THREAD_PRIORITY_LOW ) == 0 );
+
+    msleep( CLOCK_FREQ );
+    atomic_store( &stop, true );
+
+    for( int i = 0; i < readers; i++ )
+    {
+        vlc_join( threads[i], &ret );
+        gets += (unsigned long)ret;
+    }
+    vlc_join( threads[readers], &ret );
+    sets = (unsigned long)ret;
+
+    log( "%d reader(s): %.2f M gets/s, %.2f M sets/s\n", readers,
+         gets / 1000000., sets / 1000000. );
+}
+
+int main( void )
+{
+    test_init();
+    alarm( 30 );
+
+    libvlc_instance_t *vlc = libvlc_new( test_defaults_nargs,
+                                         test_defaults_args );
+    assert( vlc != NULL );
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    var_Create( obj, "bench-time", VLC_VAR_TIME );
+    var_Create( obj, "bench-position", VLC_VAR_FLOAT );
+    var_AddCallback( obj, "bench-time", SlowCallback, NULL );
+    var_AddCallback( obj, "bench-position", SlowCallback, NULL );
+
+    for( int readers = 1; readers <= MAX_READERS; readers *= 2 )
+        bench( obj, readers );
+
+    var_DelCallback( obj, "bench-time", SlowCallback, NULL );
+    var_DelCallback( obj, "bench-position", SlowCallback, NULL );
+    var_Destroy( obj, "bench-time" );
+    var_Destroy( obj, "bench-position" );
+
+    libvlc_release( vlc );
+    return 0;
+}